@@ -234,6 +234,12 @@ public:
 	 */
 	void appendDockAreas(const QList<CDockAreaWidget*> NewDockAreas);
 
+	/**
+	 * The dock areas registered in Container's dock area list. Drop handling
+	 * uses this instead of scanning the container's widget tree.
+	 */
+	static QList<CDockAreaWidget*> registeredDockAreas(CDockContainerWidget* Container);
+
 	/**
 	 * Save state of child nodes
 	 */
@@ -468,8 +474,7 @@ void DockContainerWidgetPrivate::dropIntoContainer(CFloatingDockContainer* Float
 {
 	auto InsertParam = internal::dockAreaInsertParameters(area);
 	CDockContainerWidget* FloatingDockContainer = FloatingWidget->dockContainer();
-	auto NewDockAreas = FloatingDockContainer->findChildren<CDockAreaWidget*>(
-		QString(), Qt::FindChildrenRecursively);
+	auto NewDockAreas = registeredDockAreas(FloatingDockContainer);
 	auto Splitter = RootSplitter;
 
 	if (DockAreas.count() <= 1)
@@ -525,8 +530,7 @@ void DockContainerWidgetPrivate::dropIntoContainer(CFloatingDockContainer* Float
 void DockContainerWidgetPrivate::dropIntoAutoHideSideBar(CFloatingDockContainer* FloatingWidget, DockWidgetArea area)
 {
 	auto SideBarLocation = internal::toSideBarLocation(area);
-	auto NewDockAreas = FloatingWidget->findChildren<CDockAreaWidget*>(
-		QString(), Qt::FindChildrenRecursively);
+	auto NewDockAreas = registeredDockAreas(FloatingWidget->dockContainer());
 	int TabIndex = DockManager->containerOverlay()->tabIndexUnderCursor();
 	for (auto DockArea : NewDockAreas)
 	{
@@ -589,8 +593,7 @@ void DockContainerWidgetPrivate::dropIntoSection(CFloatingDockContainer* Floatin
 
 	CDockContainerWidget* FloatingContainer = FloatingWidget->dockContainer();
 	auto InsertParam = internal::dockAreaInsertParameters(area);
-	auto NewDockAreas = FloatingContainer->findChildren<CDockAreaWidget*>(
-		QString(), Qt::FindChildrenRecursively);
+	auto NewDockAreas = registeredDockAreas(FloatingContainer);
 	auto TargetAreaSplitter = TargetArea->parentSplitter();
 	int AreaIndex = TargetAreaSplitter->indexOf(TargetArea);
 	auto FloatingSplitter = FloatingContainer->rootSplitter();
@@ -925,6 +928,23 @@ void DockContainerWidgetPrivate::addDockAreasToList(const QList<CDockAreaWidget*
 }
 
 
+//============================================================================
+QList<CDockAreaWidget*> DockContainerWidgetPrivate::registeredDockAreas(
+	CDockContainerWidget* Container)
+{
+	QList<CDockAreaWidget*> Result;
+	Result.reserve(Container->d->DockAreas.count());
+	for (const auto& DockArea : Container->d->DockAreas)
+	{
+		if (DockArea)
+		{
+			Result.append(DockArea);
+		}
+	}
+	return Result;
+}
+
+
 //============================================================================
 void DockContainerWidgetPrivate::appendDockAreas(const QList<CDockAreaWidget*> NewDockAreas)
 {
@@ -49,6 +49,8 @@
 #include <QWindow>
 #include <QWindowStateChangeEvent>
 #include <QVector>
+#include <QSet>
+#include <QCryptographicHash>
 
 #include "FloatingDockContainer.h"
 #include "DockOverlay.h"
@@ -113,7 +115,8 @@ struct DockManagerPrivate
 	CDockOverlay* ContainerOverlay;
 	CDockOverlay* DockAreaOverlay;
 	QMap<QString, CDockWidget*> DockWidgetsMap;
-	QMap<QString, QByteArray> Perspectives;
+	QMap<QString, QByteArray> Perspectives;///< uncompressed XML, compressed only in QSettings
+	QSet<QByteArray> ValidatedStates;///< digests of states saved or checked in this session
 	QMap<QString, QMenu*> ViewMenuGroups;
 	QMenu* ViewMenu;
 	CDockManager::eViewMenuInsertionOrder MenuInsertionOrder = CDockManager::MenuAlphabeticallySorted;
@@ -140,6 +143,25 @@ struct DockManagerPrivate
 	 */
 	bool checkFormat(const QByteArray &state, int version);
 
+	/**
+	 * Key of an uncompressed state and user version in ValidatedStates
+	 */
+	static QByteArray stateDigest(const QByteArray &state, int version);
+
+	/**
+	 * Writes the uncompressed XML state and records it as valid: a state
+	 * this dock manager wrote needs no testing pass to be restored.
+	 */
+	QByteArray saveStateXml(int version);
+
+	/**
+	 * Applies State without rebuilding the layout if it differs from the
+	 * current one only in the current tabs of dock areas and in splitter
+	 * sizes - the common case of perspectives sharing one structure.
+	 * Returns false, with nothing changed, if the structure differs.
+	 */
+	bool restoreStateInPlace(const QByteArray& State, int version);
+
 	/**
 	 * Restores the state
 	 */
@@ -259,6 +281,45 @@ bool DockManagerPrivate::checkFormat(const QByteArray &state, int version)
 }
 
 
+//============================================================================
+QByteArray DockManagerPrivate::stateDigest(const QByteArray &state, int version)
+{
+	QCryptographicHash Hash(QCryptographicHash::Sha1);
+	Hash.addData(QByteArray::number(version));
+	Hash.addData(state);
+	return Hash.result();
+}
+
+
+//============================================================================
+QByteArray DockManagerPrivate::saveStateXml(int version)
+{
+    QByteArray xmldata;
+    QXmlStreamWriter s(&xmldata);
+    auto ConfigFlags = CDockManager::configFlags();
+	s.setAutoFormatting(ConfigFlags.testFlag(CDockManager::XmlAutoFormattingEnabled));
+    s.writeStartDocument();
+		s.writeStartElement("QtAdvancedDockingSystem");
+		s.writeAttribute("Version", QString::number(CurrentVersion));
+		s.writeAttribute("UserVersion", QString::number(version));
+		s.writeAttribute("Containers", QString::number(Containers.count()));
+		if (CentralWidget)
+		{
+			s.writeAttribute("CentralWidget", CentralWidget->objectName());
+		}
+		for (auto Container : Containers)
+		{
+			Container->saveState(s);
+		}
+
+		s.writeEndElement();
+    s.writeEndDocument();
+
+    ValidatedStates.insert(stateDigest(xmldata, version));
+    return xmldata;
+}
+
+
 //============================================================================
 bool DockManagerPrivate::restoreStateFromXml(const QByteArray &state,  int version,
 	bool Testing)
@@ -445,15 +506,192 @@ void DockManagerPrivate::emitTopLevelEvents()
 }
 
 
+//============================================================================
+/**
+ * Attributes of a start element as name=value pairs, without the ones a
+ * state may change in place
+ */
+static QStringList structuralAttributes(const QXmlStreamReader& s)
+{
+	QStringList Result;
+	for (const auto& Attribute : s.attributes())
+	{
+		if (s.name() == QLatin1String("Area") && Attribute.name() == QLatin1String("Current"))
+		{
+			continue;
+		}
+		Result.append(Attribute.name().toString() + '=' + Attribute.value().toString());
+	}
+	return Result;
+}
+
+
+//============================================================================
+/**
+ * Splitters in the order their Sizes are saved (children first) and dock
+ * areas in the order they are saved, as CDockContainerWidget::saveState()
+ * walks the tree
+ */
+static void collectLayoutNodes(QWidget* Widget, QList<QSplitter*>& Splitters,
+	QList<CDockAreaWidget*>& DockAreas)
+{
+	QSplitter* Splitter = qobject_cast<QSplitter*>(Widget);
+	if (Splitter)
+	{
+		for (int i = 0; i < Splitter->count(); ++i)
+		{
+			collectLayoutNodes(Splitter->widget(i), Splitters, DockAreas);
+		}
+		Splitters.append(Splitter);
+	}
+	else if (auto DockArea = qobject_cast<CDockAreaWidget*>(Widget))
+	{
+		DockAreas.append(DockArea);
+	}
+}
+
+
+//============================================================================
+bool DockManagerPrivate::restoreStateInPlace(const QByteArray& State, int version)
+{
+	// Walk the current and the target state in lockstep: everything but
+	// the Current attribute of splitter areas and the splitter sizes must
+	// match.
+	QByteArray CurrentState = saveStateXml(version);
+	QXmlStreamReader Current(CurrentState);
+	QXmlStreamReader Target(State.startsWith("<?xml") ? State : qUncompress(State));
+	QStringList CurrentTabs;
+	QList<QList<int>> SplitterSizes;
+	QString SizesText;
+	int SideBarDepth = 0;// areas of auto hide side bars are not in a splitter
+	bool InSizes = false;
+	while (!Current.atEnd() && !Target.atEnd())
+	{
+		auto Token = Current.readNext();
+		if (Target.readNext() != Token || Current.hasError() || Target.hasError())
+		{
+			return false;
+		}
+
+		switch (Token)
+		{
+		case QXmlStreamReader::StartElement:
+			if (Current.name() != Target.name()
+			 || structuralAttributes(Current) != structuralAttributes(Target))
+			{
+				return false;
+			}
+			if (Target.name() == QLatin1String("SideBar"))
+			{
+				SideBarDepth++;
+			}
+			else if (Target.name() == QLatin1String("Area") && !SideBarDepth)
+			{
+				CurrentTabs.append(Target.attributes().value("Current").toString());
+			}
+			else if (Target.name() == QLatin1String("Sizes"))
+			{
+				InSizes = true;
+				SizesText.clear();
+			}
+			break;
+
+		case QXmlStreamReader::EndElement:
+			if (Target.name() == QLatin1String("SideBar"))
+			{
+				SideBarDepth--;
+			}
+			else if (Target.name() == QLatin1String("Sizes"))
+			{
+				QList<int> Sizes;
+				for (const auto& Size : SizesText.split(' '))
+				{
+					if (!Size.isEmpty())
+					{
+						Sizes.append(Size.toInt());
+					}
+				}
+				SplitterSizes.append(Sizes);
+				InSizes = false;
+			}
+			break;
+
+		case QXmlStreamReader::Characters:
+			if (InSizes)
+			{
+				SizesText += Target.text();
+			}
+			else if (Current.text() != Target.text())
+			{
+				return false;
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+	if (!Current.atEnd() || !Target.atEnd() || Current.hasError() || Target.hasError())
+	{
+		return false;
+	}
+
+	QList<QSplitter*> Splitters;
+	QList<CDockAreaWidget*> DockAreas;
+	for (auto Container : Containers)
+	{
+		collectLayoutNodes(Container->rootSplitter(), Splitters, DockAreas);
+	}
+	if (Splitters.count() != SplitterSizes.count() || DockAreas.count() != CurrentTabs.count())
+	{
+		return false;
+	}
+
+	for (auto Container : Containers)
+	{
+		Container->setUpdatesEnabled(false);
+	}
+	for (int i = 0; i < Splitters.count(); ++i)
+	{
+		if (SplitterSizes[i].count() == Splitters[i]->count())
+		{
+			Splitters[i]->setSizes(SplitterSizes[i]);
+		}
+	}
+	for (int i = 0; i < DockAreas.count(); ++i)
+	{
+		CDockWidget* DockWidget = CurrentTabs[i].isEmpty() ? nullptr : _this->findDockWidget(CurrentTabs[i]);
+		if (DockWidget && DockWidget->dockAreaWidget() == DockAreas[i] && !DockWidget->isClosed())
+		{
+			DockAreas[i]->internalSetCurrentDockWidget(DockWidget);
+		}
+	}
+	for (auto Container : Containers)
+	{
+		Container->setUpdatesEnabled(true);
+	}
+
+	_this->dumpLayout();
+	return true;
+}
+
+
 //============================================================================
 bool DockManagerPrivate::restoreState(const QByteArray& State, int version)
 {
 	QByteArray state = State.startsWith("<?xml") ? State : qUncompress(State);
-    if (!checkFormat(state, version))
-    {
-        ADS_PRINT("checkFormat: Error checking format!!!!!!!");
-    	return false;
-    }
+	// States saved or already checked in this session skip the testing pass,
+	// so a perspective switch parses its XML once.
+	const QByteArray Digest = stateDigest(state, version);
+	if (!ValidatedStates.contains(Digest))
+	{
+		if (!checkFormat(state, version))
+		{
+			ADS_PRINT("checkFormat: Error checking format!!!!!!!");
+			return false;
+		}
+		ValidatedStates.insert(Digest);
+	}
 
     // Hide updates of floating widgets from use
     hideFloatingWidgets();
@@ -812,28 +1050,8 @@ unsigned int CDockManager::zOrderIndex() const
 //============================================================================
 QByteArray CDockManager::saveState(int version) const
 {
-    QByteArray xmldata;
-    QXmlStreamWriter s(&xmldata);
-    auto ConfigFlags = CDockManager::configFlags();
-	s.setAutoFormatting(ConfigFlags.testFlag(XmlAutoFormattingEnabled));
-    s.writeStartDocument();
-		s.writeStartElement("QtAdvancedDockingSystem");
-		s.writeAttribute("Version", QString::number(CurrentVersion));
-		s.writeAttribute("UserVersion", QString::number(version));
-		s.writeAttribute("Containers", QString::number(d->Containers.count()));
-		if (d->CentralWidget)
-		{
-			s.writeAttribute("CentralWidget", d->CentralWidget->objectName());
-		}
-		for (auto Container : d->Containers)
-		{
-			Container->saveState(s);
-		}
-
-		s.writeEndElement();
-    s.writeEndDocument();
-
-    return ConfigFlags.testFlag(XmlCompressionEnabled)
+    QByteArray xmldata = d->saveStateXml(version);
+    return CDockManager::configFlags().testFlag(XmlCompressionEnabled)
     	? qCompress(xmldata, 9) : xmldata;
 }
 
@@ -1050,7 +1268,9 @@ QMap<QString, CDockWidget*> CDockManager::dockWidgetsMap() const
 //============================================================================
 void CDockManager::addPerspective(const QString& UniquePrespectiveName)
 {
-	d->Perspectives.insert(UniquePrespectiveName, saveState());
+	// Kept uncompressed: compressing at level 9 here and inflating on every
+	// openPerspective() cost more than the memory saved.
+	d->Perspectives.insert(UniquePrespectiveName, d->saveStateXml(0));
 	Q_EMIT perspectiveListChanged();
 }
 
@@ -1096,7 +1316,24 @@ void CDockManager::openPerspective(const QString& PerspectiveName)
 	}
 
 	Q_EMIT openingPerspective(PerspectiveName);
-	restoreState(Iterator.value());
+	// Perspectives that share the current layout structure only switch tabs
+	// and splitter sizes, the others rebuild the layout
+	bool InPlace = false;
+	if (!d->RestoringState)
+	{
+		d->RestoringState = true;
+		Q_EMIT restoringState();
+		InPlace = d->restoreStateInPlace(Iterator.value(), 0);
+		d->RestoringState = false;
+		if (InPlace)
+		{
+			Q_EMIT stateRestored();
+		}
+	}
+	if (!InPlace)
+	{
+		restoreState(Iterator.value());
+	}
 	Q_EMIT perspectiveOpened(PerspectiveName);
 }
 
@@ -1110,7 +1347,8 @@ void CDockManager::savePerspectives(QSettings& Settings) const
 	{
 		Settings.setArrayIndex(i);
 		Settings.setValue("Name", it.key());
-		Settings.setValue("State", it.value());
+		Settings.setValue("State", configFlags().testFlag(XmlCompressionEnabled)
+			? qCompress(it.value(), 9) : it.value());
 		++i;
 	}
 	Settings.endArray();
@@ -1133,6 +1371,10 @@ void CDockManager::loadPerspectives(QSettings& Settings)
 		Settings.setArrayIndex(i);
 		QString Name = Settings.value("Name").toString();
 		QByteArray Data = Settings.value("State").toByteArray();
+		if (!Data.startsWith("<?xml"))
+		{
+			Data = qUncompress(Data);
+		}
 		if (Name.isEmpty() || Data.isEmpty())
 		{
 			continue;
@@ -34,6 +34,7 @@
 #include <QtGlobal>
 #include <QDebug>
 #include <QMap>
+#include <QPixmapCache>
 #include <QWindow>
 
 #include "DockAreaWidget.h"
@@ -208,9 +209,42 @@ struct DockOverlayCrossPrivate
 	}
 
 	//============================================================================
+	/**
+	 * Returns the drop indicator icon from the application pixmap cache,
+	 * rasterizing it only the first time a size, area, mode, device pixel
+	 * ratio and colour set is asked for. Moving a drag between screens of
+	 * different DPI then swaps cached icons instead of repainting them.
+	 */
 	QPixmap createHighDpiDropIndicatorPixmap(const QSizeF& size, DockWidgetArea DockWidgetArea,
 		CDockOverlay::eMode Mode)
 	{
+#if QT_VERSION >= 0x050600
+		double DevicePixelRatio = _this->window()->devicePixelRatioF();
+#else
+		double DevicePixelRatio = _this->window()->devicePixelRatio();
+#endif
+		QString CacheKey = QString("ads_drop_indicator_%1x%2_%3_%4_%5")
+			.arg(size.width()).arg(size.height()).arg(int(DockWidgetArea)).arg(int(Mode))
+			.arg(DevicePixelRatio);
+		for (int i = CDockOverlayCross::FrameColor; i <= CDockOverlayCross::ShadowColor; ++i)
+		{
+			CacheKey += QString("_%1").arg(iconColor(CDockOverlayCross::eIconColor(i)).rgba(), 8, 16, QChar('0'));
+		}
+
+		QPixmap pm;
+		if (QPixmapCache::find(CacheKey, &pm))
+		{
+			return pm;
+		}
+		pm = renderDropIndicatorPixmap(size, DevicePixelRatio, DockWidgetArea, Mode);
+		QPixmapCache::insert(CacheKey, pm);
+		return pm;
+	}
+
+	//============================================================================
+	QPixmap renderDropIndicatorPixmap(const QSizeF& size, double DevicePixelRatio,
+		DockWidgetArea DockWidgetArea, CDockOverlay::eMode Mode)
+	{
 		QColor borderColor = iconColor(CDockOverlayCross::FrameColor);
 		QColor backgroundColor = iconColor(CDockOverlayCross::WindowBackgroundColor);
 		QColor overlayColor = iconColor(CDockOverlayCross::OverlayColor);
@@ -219,11 +253,6 @@ struct DockOverlayCrossPrivate
 			overlayColor.setAlpha(64);
 		}
 
-#if QT_VERSION >= 0x050600
-		double DevicePixelRatio = _this->window()->devicePixelRatioF();
-#else
-        double DevicePixelRatio = _this->window()->devicePixelRatio();
-#endif
 		QSizeF PixmapSize = size * DevicePixelRatio;
 		QPixmap pm(PixmapSize.toSize());
 		pm.fill(QColor(0, 0, 0, 0));
@@ -29,6 +29,7 @@
 //============================================================================
 #include "ElidingLabel.h"
 #include <QMouseEvent>
+#include <QHash>
 
 
 namespace ads
@@ -42,11 +43,24 @@ struct ElidingLabelPrivate
 	Qt::TextElideMode ElideMode = Qt::ElideNone;
 	QString Text;
 	bool IsElided = false;
+	QHash<int, QString> ElidedTexts;///< elided Text per available width
+	int TextWidth = -1;///< horizontal advance of Text, -1 if not measured yet
+	int MinimumTextWidth = -1;///< horizontal advance of the shortest elided Text
 
 	ElidingLabelPrivate(CElidingLabel* _public) : _this(_public) {}
 
 	void elideText(int Width);
 
+	/**
+	 * Drops the elided texts and widths measured for the previous text or font
+	 */
+	void invalidateCache()
+	{
+		ElidedTexts.clear();
+		TextWidth = -1;
+		MinimumTextWidth = -1;
+	}
+
 	/**
 	 * Convenience function to check if the
 	 */
@@ -64,11 +78,28 @@ void ElidingLabelPrivate::elideText(int Width)
 	{
 		return;
 	}
-    QFontMetrics fm = _this->fontMetrics();
-    QString  str = fm.elidedText(Text, ElideMode, Width - _this->margin() * 2 - _this->indent());
-    if (str == "…")
+    // Tab bars with many tabs resize every label on each layout pass, so
+    // the elided text is measured once per available width
+    int AvailableWidth = Width - _this->margin() * 2 - _this->indent();
+    auto it = ElidedTexts.constFind(AvailableWidth);
+    QString str;
+    if (it != ElidedTexts.constEnd())
     {
-    	str = Text.at(0);
+    	str = it.value();
+    }
+    else
+    {
+		QFontMetrics fm = _this->fontMetrics();
+		str = fm.elidedText(Text, ElideMode, AvailableWidth);
+		if (str == "…")
+		{
+			str = Text.at(0);
+		}
+		if (ElidedTexts.count() >= 32)
+		{
+			ElidedTexts.clear();
+		}
+		ElidedTexts.insert(AvailableWidth, str);
     }
     bool WasElided = IsElided;
     IsElided = str != Text;
@@ -76,7 +107,11 @@ void ElidingLabelPrivate::elideText(int Width)
     {
         Q_EMIT _this->elidedChanged(IsElided);
     }
-    _this->QLabel::setText(str);
+    // QLabel::setText() invalidates the layout even for the same text
+    if (str != _this->QLabel::text())
+    {
+    	_this->QLabel::setText(str);
+    }
 }
 
 
@@ -117,6 +152,7 @@ Qt::TextElideMode CElidingLabel::elideMode() const
 void CElidingLabel::setElideMode(Qt::TextElideMode mode)
 {
 	d->ElideMode = mode;
+	d->invalidateCache();
 	d->elideText(size().width());
 }
 
@@ -160,6 +196,18 @@ void CElidingLabel::resizeEvent(QResizeEvent *event)
 }
 
 
+//============================================================================
+void CElidingLabel::changeEvent(QEvent *event)
+{
+	Super::changeEvent(event);
+	if (event->type() == QEvent::FontChange || event->type() == QEvent::StyleChange)
+	{
+		d->invalidateCache();
+		d->elideText(size().width());
+	}
+}
+
+
 //============================================================================
 QSize CElidingLabel::minimumSizeHint() const
 {
@@ -173,12 +221,15 @@ QSize CElidingLabel::minimumSizeHint() const
         return QLabel::minimumSizeHint();
     }
     const QFontMetrics  &fm = fontMetrics();
+    if (d->MinimumTextWidth < 0)
+    {
     #if (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
-        QSize size(fm.horizontalAdvance(d->Text.left(2) + "…"), fm.height());
+        d->MinimumTextWidth = fm.horizontalAdvance(d->Text.left(2) + "…");
     #else
-        QSize size(fm.width(d->Text.left(2) + "…"), fm.height());
+        d->MinimumTextWidth = fm.width(d->Text.left(2) + "…");
     #endif
-    return size;
+    }
+    return QSize(d->MinimumTextWidth, fm.height());
 }
 
 
@@ -194,19 +245,26 @@ QSize CElidingLabel::sizeHint() const
     {
         return QLabel::sizeHint();
     }
-    const QFontMetrics& fm = fontMetrics();
+    if (d->TextWidth < 0)
+    {
+        const QFontMetrics& fm = fontMetrics();
     #if (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
-        QSize size(fm.horizontalAdvance(d->Text), QLabel::sizeHint().height());
+        d->TextWidth = fm.horizontalAdvance(d->Text);
     #else
-        QSize size(fm.width(d->Text), QLabel::sizeHint().height());
+        d->TextWidth = fm.width(d->Text);
     #endif
-	return size;
+    }
+	return QSize(d->TextWidth, QLabel::sizeHint().height());
 }
 
 
 //============================================================================
 void CElidingLabel::setText(const QString &text)
 {
+	if (text != d->Text)
+	{
+		d->invalidateCache();
+	}
 	d->Text = text;
 	if (d->isModeElideNone())
 	{
@@ -0,0 +1,101 @@
+// krstudio_bench_gate: compares a krstudio_bench JSON run with this
+// machine's stored baseline, kernel by kernel, through PerfGate.
+//
+//   krstudio_bench_gate run.json --baseline-dir bench/baselines [--verdict v.json]
+//
+// Exits 0 when nothing regressed (or a first baseline was recorded), 1 if a
+// file could not be read or written, 2 on a regression.
+
+#include "PerfGate.hpp"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+
+#include <map>
+#include <vector>
+
+namespace {
+// Every repetition's real time per benchmark, in ns; aggregates are skipped.
+std::map<QString, std::vector<double>> repetitions(const QJsonObject& run)
+{
+    std::map<QString, std::vector<double>> out;
+    for (const QJsonValue& value : run.value("benchmarks").toArray()) {
+        const QJsonObject b = value.toObject();
+        if (b.value("run_type").toString("iteration") != QLatin1String("iteration")) continue;
+        const QString unit = b.value("time_unit").toString("ns");
+        const double scale = unit == "s" ? 1e9 : unit == "ms" ? 1e6 : unit == "us" ? 1e3 : 1.0;
+        const QString name = b.value("run_name").toString(b.value("name").toString());
+        out[name].push_back(b.value("real_time").toDouble() * scale);
+    }
+    return out;
+}
+
+// Same host, same CPU count and clock: google benchmark's context.
+QString machineKey(const QJsonObject& run)
+{
+    const QJsonObject context = run.value("context").toObject();
+    return PerfGate::machineKey(QStringLiteral("%1cpu_%2MHz")
+        .arg(context.value("num_cpus").toInt()).arg(context.value("mhz_per_cpu").toInt()));
+}
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument("run", "krstudio_bench --benchmark_out JSON.");
+    const QCommandLineOption baseline("baseline", "Run to compare against.", "file");
+    const QCommandLineOption baselineDir("baseline-dir", "Per-machine baselines.", "dir");
+    const QCommandLineOption record("record", "Store the run as this machine's baseline.");
+    const QCommandLineOption tolerance("tolerance", "Allowed median growth.", "fraction", "0.1");
+    const QCommandLineOption alpha("alpha", "Significance level of a regression.", "p", "0.01");
+    const QCommandLineOption verdict("verdict", "Write the verdict JSON to <file>.", "file");
+    parser.addOptions({ baseline, baselineDir, record, tolerance, alpha, verdict });
+    parser.process(app);
+    if (parser.positionalArguments().size() != 1 || (!parser.isSet(baseline) && !parser.isSet(baselineDir)))
+        parser.showHelp(1);
+
+    const QString runPath = parser.positionalArguments().front();
+    const QJsonObject run = PerfGate::readJson(runPath);
+    if (run.isEmpty()) {
+        qCritical() << "[BenchGate] Cannot read" << runPath;
+        return 1;
+    }
+    const QString machine = machineKey(run);
+
+    QString baselinePath = parser.value(baseline);
+    if (baselinePath.isEmpty()) {
+        baselinePath = PerfGate::baselinePath(parser.value(baselineDir), machine, "krstudio_bench.json");
+        if (parser.isSet(record) || !QFile::exists(baselinePath)) {
+            qInfo().noquote() << "[BenchGate] Recording the baseline for" << machine;
+            return PerfGate::writeJson(baselinePath, run) ? 0 : 1;
+        }
+    }
+    const QJsonObject stored = PerfGate::readJson(baselinePath);
+    if (stored.isEmpty()) {
+        qCritical() << "[BenchGate] Cannot read" << baselinePath;
+        return 1;
+    }
+
+    PerfGate::Thresholds thresholds;
+    thresholds.tolerance = parser.value(tolerance).toDouble();
+    thresholds.alpha = parser.value(alpha).toDouble();
+
+    const auto before = repetitions(stored), now = repetitions(run);
+    std::vector<PerfGate::Comparison> comparisons;
+    for (const auto& [name, samples] : before) {
+        const auto current = now.find(name);
+        comparisons.push_back(PerfGate::compare(name, samples,
+            current != now.end() ? current->second : std::vector<double>(), thresholds));
+    }
+    for (const auto& [name, samples] : now)
+        if (!before.count(name)) comparisons.push_back(PerfGate::compare(name, {}, samples, thresholds));
+
+    const QJsonObject report = PerfGate::verdictReport(std::move(comparisons), thresholds, machine);
+    if (parser.isSet(verdict) && !PerfGate::writeJson(parser.value(verdict), report)) return 1;
+    return PerfGate::passed(report) ? 0 : 2;
+}
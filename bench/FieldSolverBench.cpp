@@ -0,0 +1,65 @@
+#include "FieldSolver.hpp"
+#include "components.hpp"
+
+#include <benchmark/benchmark.h>
+#include <entt/entt.hpp>
+#include <random>
+#include <vector>
+
+namespace {
+// 'effectors' point sources scattered over a 20 m cube, as FieldSourceTag entities.
+void addPointEffectors(entt::registry& registry, int effectors)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> pos(-10.0f, 10.0f);
+    for (int i = 0; i < effectors; ++i) {
+        const entt::entity e = registry.create();
+        registry.emplace<FieldSourceTag>(e);
+        registry.emplace<TransformComponent>(e).translation = { pos(rng), pos(rng), pos(rng) };
+        auto& point = registry.emplace<PointEffectorComponent>(e);
+        point.strength = (i % 2) ? 1.0f : -1.0f;
+        point.radius = 4.0f;
+    }
+}
+
+std::vector<glm::vec3> samplePoints(std::size_t count)
+{
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> pos(-10.0f, 10.0f);
+    std::vector<glm::vec3> points(count);
+    for (glm::vec3& p : points) p = { pos(rng), pos(rng), pos(rng) };
+    return points;
+}
+
+constexpr std::size_t kSamples = 4096;   ///< one flow visualizer's worth of points
+}
+
+// Per-point registry walk, as the visualizers used to sample.
+static void BM_FieldGetVectorAt(benchmark::State& state)
+{
+    entt::registry registry;
+    addPointEffectors(registry, int(state.range(0)));
+    const std::vector<glm::vec3> points = samplePoints(kSamples);
+    FieldSolver solver;
+    for (auto _ : state) {
+        for (const glm::vec3& p : points) benchmark::DoNotOptimize(solver.getVectorAt(registry, p));
+    }
+    state.SetItemsProcessed(state.iterations() * std::int64_t(points.size()));
+}
+BENCHMARK(BM_FieldGetVectorAt)->Arg(16)->Arg(128)->Arg(1024);
+
+// One snapshot per pass, then the batch kernel over every point.
+static void BM_FieldEvaluateBatch(benchmark::State& state)
+{
+    entt::registry registry;
+    addPointEffectors(registry, int(state.range(0)));
+    const std::vector<glm::vec3> points = samplePoints(kSamples);
+    std::vector<glm::vec3> out(points.size());
+    for (auto _ : state) {
+        const FieldSnapshot snapshot = FieldSolver::snapshot(registry);
+        FieldSolver::evaluateBatch(snapshot, points.data(), out.data(), points.size());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * std::int64_t(points.size()));
+}
+BENCHMARK(BM_FieldEvaluateBatch)->Arg(16)->Arg(128)->Arg(1024);
@@ -0,0 +1,51 @@
+#include "ConvexCollision.hpp"
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+namespace {
+// Points of a link-like mesh: an elongated ellipsoid shell with some interior.
+std::vector<glm::vec3> linkPoints(std::size_t count)
+{
+    std::mt19937 rng(5);
+    std::normal_distribution<float> n(0.0f, 1.0f);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    std::vector<glm::vec3> points(count);
+    for (glm::vec3& p : points) {
+        const glm::vec3 d = glm::normalize(glm::vec3(n(rng), n(rng), n(rng)));
+        const float r = u(rng) < 0.8f ? 1.0f : u(rng);
+        p = d * r * glm::vec3(0.05f, 0.05f, 0.3f);
+    }
+    return points;
+}
+}
+
+// The hull CollisionWorld fits for a link seen the first time.
+static void BM_HullSupportPoints(benchmark::State& state)
+{
+    const std::vector<glm::vec3> points = linkPoints(std::size_t(state.range(0)));
+    for (auto _ : state) benchmark::DoNotOptimize(ConvexCollision::hullSupportPoints(points, 64));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HullSupportPoints)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 17);
+
+static void BM_FitCapsule(benchmark::State& state)
+{
+    const std::vector<glm::vec3> points = linkPoints(std::size_t(state.range(0)));
+    for (auto _ : state) benchmark::DoNotOptimize(ConvexCollision::fitCapsule(points));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FitCapsule)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 17);
+
+// Narrowphase on two fitted hulls, near contact.
+static void BM_ConvexIntersects(benchmark::State& state)
+{
+    const std::vector<glm::vec3> hull = ConvexCollision::hullSupportPoints(linkPoints(4096), 64);
+    ConvexCollision::Shape a, b;
+    a.points = b.points = hull.data();
+    a.count = b.count = hull.size();
+    b.translation = { 0.09f, 0.0f, 0.1f };
+    for (auto _ : state) benchmark::DoNotOptimize(ConvexCollision::intersects(a, b));
+}
+BENCHMARK(BM_ConvexIntersects);
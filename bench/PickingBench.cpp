@@ -0,0 +1,78 @@
+#include "MeshBvh.hpp"
+#include "components.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+// A wavy n x n quad sheet in the xz plane, 2 n^2 triangles.
+RenderableMeshComponent sheetMesh(int n)
+{
+    auto data = std::make_shared<MeshData>();
+    for (int z = 0; z <= n; ++z)
+        for (int x = 0; x <= n; ++x) {
+            const float fx = float(x) / n - 0.5f, fz = float(z) / n - 0.5f;
+            const float y = 0.05f * std::sin(20.0f * fx) * std::cos(20.0f * fz);
+            data->vertices.emplace_back(glm::vec3(fx, y, fz), glm::vec3(0.0f, 1.0f, 0.0f));
+        }
+    for (int z = 0; z < n; ++z)
+        for (int x = 0; x < n; ++x) {
+            const unsigned i = unsigned(z * (n + 1) + x);
+            data->indices.insert(data->indices.end(), { i, i + 1, i + unsigned(n) + 1, i + 1, i + unsigned(n) + 2, i + unsigned(n) + 1 });
+        }
+    RenderableMeshComponent mesh;
+    mesh.mesh = std::move(data);
+    return mesh;
+}
+
+int sheetSize(std::int64_t triangles) { return int(std::sqrt(double(triangles) / 2.0)); }
+}
+
+// BLAS build, paid once per mesh the first time it is picked.
+static void BM_MeshBvhBuild(benchmark::State& state)
+{
+    const RenderableMeshComponent mesh = sheetMesh(sheetSize(state.range(0)));
+    for (auto _ : state) benchmark::DoNotOptimize(MeshBvh::build(mesh));
+    state.SetItemsProcessed(state.iterations() * std::int64_t(mesh.indices().size() / 3));
+}
+BENCHMARK(BM_MeshBvhBuild)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 18)->Unit(benchmark::kMillisecond);
+
+// The per-click (and per-hover) cost of selectObjectAt/pickPoint once the
+// BLAS exists: camera rays from above against the mesh.
+static void BM_MeshBvhRaycast(benchmark::State& state)
+{
+    const auto bvh = MeshBvh::build(sheetMesh(sheetSize(state.range(0))));
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> pos(-0.6f, 0.6f);
+    std::vector<glm::vec3> origins(1024);
+    for (glm::vec3& o : origins) o = { pos(rng), 2.0f, pos(rng) };
+
+    const glm::vec3 dir = glm::normalize(glm::vec3(0.1f, -1.0f, 0.05f));
+    std::size_t next = 0;
+    for (auto _ : state) {
+        float t = 1e30f;
+        benchmark::DoNotOptimize(bvh->raycast(origins[next++ & 1023], dir, t));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MeshBvhRaycast)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 18);
+
+// The per-frame cost of measure-mode snapping on a million-triangle mesh:
+// a point on the surface and a radius of a few cells.
+static void BM_MeshBvhSnap(benchmark::State& state)
+{
+    const int n = sheetSize(state.range(0));
+    const auto bvh = MeshBvh::build(sheetMesh(n));
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> pos(-0.5f, 0.5f);
+    std::vector<glm::vec3> points(1024);
+    for (glm::vec3& p : points) p = { pos(rng), 0.0f, pos(rng) };
+
+    const float radius = 3.0f / float(n);
+    std::size_t next = 0;
+    for (auto _ : state) benchmark::DoNotOptimize(bvh->snap(points[next++ & 1023], radius));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MeshBvhSnap)->Arg(1 << 14)->Arg(1 << 20);
@@ -0,0 +1,69 @@
+#include "SplineEvaluation.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <vector>
+
+namespace {
+std::vector<glm::vec3> helixPoints(std::size_t count)
+{
+    std::vector<glm::vec3> points(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const float t = 0.3f * float(i);
+        points[i] = { std::cos(t), 0.05f * float(i), std::sin(t) };
+    }
+    return points;
+}
+
+// Samples per curve, as RenderingSystem caches them.
+constexpr int kSegments = 64;
+}
+
+static void BM_SplineCatmullRom(benchmark::State& state)
+{
+    const std::vector<glm::vec3> points = helixPoints(std::size_t(state.range(0)));
+    for (auto _ : state) benchmark::DoNotOptimize(SplineEvaluation::catmullRom(points, kSegments));
+    state.SetItemsProcessed(state.iterations() * (state.range(0) - 3) * kSegments);
+}
+BENCHMARK(BM_SplineCatmullRom)->Arg(4)->Arg(64)->Arg(1024);
+
+static void BM_SplineBezier(benchmark::State& state)
+{
+    const std::vector<glm::vec3> points = helixPoints(std::size_t(state.range(0)));
+    for (auto _ : state) benchmark::DoNotOptimize(SplineEvaluation::bezier(points, kSegments));
+    state.SetItemsProcessed(state.iterations() * kSegments);
+}
+BENCHMARK(BM_SplineBezier)->Arg(4)->Arg(16)->Arg(64);
+
+static void BM_SplinePiecewiseBezier(benchmark::State& state)
+{
+    const std::vector<glm::vec3> points = helixPoints(std::size_t(state.range(0)));
+    for (auto _ : state) benchmark::DoNotOptimize(SplineEvaluation::piecewiseBezier(points, kSegments));
+    state.SetItemsProcessed(state.iterations() * ((state.range(0) - 1) / 3) * kSegments);
+}
+BENCHMARK(BM_SplinePiecewiseBezier)->Arg(4)->Arg(64)->Arg(1024);
+
+static void BM_SplineParametric(benchmark::State& state)
+{
+    const auto helix = [](float t) { return glm::vec3(2.0f * std::cos(18.85f * t), 6.0f * t, 2.0f * std::sin(18.85f * t)); };
+    const int samples = int(state.range(0));
+    for (auto _ : state) benchmark::DoNotOptimize(SplineEvaluation::parametric(helix, samples));
+    state.SetItemsProcessed(state.iterations() * samples);
+}
+BENCHMARK(BM_SplineParametric)->Arg(128)->Arg(4096);
+
+// Items evenly spaced along a conveyor: the sorted batch walks the table once.
+static void BM_SplineArcLengthBatch(benchmark::State& state)
+{
+    const std::vector<glm::vec3> vertices = SplineEvaluation::catmullRom(helixPoints(64), kSegments);
+    const SplineEvaluation::ArcLengthTable table = SplineEvaluation::arcLength(vertices);
+    std::vector<float> distances(std::size_t(state.range(0)));
+    for (std::size_t i = 0; i < distances.size(); ++i) distances[i] = table.length() * float(i) / float(distances.size());
+    std::vector<SplineEvaluation::ArcSample> samples(distances.size());
+    for (auto _ : state) {
+        SplineEvaluation::sampleBatch(table, vertices, distances.data(), distances.size(), samples.data());
+        benchmark::DoNotOptimize(samples.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SplineArcLengthBatch)->Arg(1024)->Arg(65536);
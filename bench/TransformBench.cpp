@@ -0,0 +1,79 @@
+#include "TransformSystem.hpp"
+#include "AnimationTracks.hpp"
+#include "components.hpp"
+
+#include <benchmark/benchmark.h>
+#include <entt/entt.hpp>
+#include <vector>
+
+namespace {
+constexpr int kChainLength = 10;   ///< links per "robot"
+
+// state.range(0) entities as independent chains of kChainLength, like robots.
+std::vector<entt::entity> buildChains(entt::registry& registry, int entities)
+{
+    std::vector<entt::entity> roots;
+    entt::entity parent = entt::null;
+    for (int i = 0; i < entities; ++i) {
+        const entt::entity e = registry.create();
+        auto& transform = registry.emplace<TransformComponent>(e);
+        transform.translation = { 0.0f, 0.0f, 0.1f };
+        transform.rotation = glm::angleAxis(0.05f, glm::vec3(0.0f, 1.0f, 0.0f));
+        if (i % kChainLength == 0) {
+            roots.push_back(e);
+            transform.translation = { float(i), 0.0f, 0.0f };
+        }
+        else {
+            registry.emplace<ParentComponent>(e, parent);
+        }
+        parent = e;
+    }
+    return roots;
+}
+}
+
+// Every root moves each pass: the whole hierarchy is recomputed.
+static void BM_PropagateTransformsMoving(benchmark::State& state)
+{
+    entt::registry registry;
+    const std::vector<entt::entity> roots = buildChains(registry, int(state.range(0)));
+    TransformSystem::propagate(registry);
+    float offset = 0.0f;
+    for (auto _ : state) {
+        offset += 1e-3f;
+        for (entt::entity root : roots) registry.get<TransformComponent>(root).translation.y = offset;
+        benchmark::DoNotOptimize(TransformSystem::propagate(registry));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PropagateTransformsMoving)->Arg(100)->Arg(1000)->Arg(10000);
+
+// Nothing moves: the cost of finding out that nothing changed.
+static void BM_PropagateTransformsStatic(benchmark::State& state)
+{
+    entt::registry registry;
+    buildChains(registry, int(state.range(0)));
+    TransformSystem::propagate(registry);
+    for (auto _ : state) benchmark::DoNotOptimize(TransformSystem::propagate(registry));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PropagateTransformsStatic)->Arg(100)->Arg(1000)->Arg(10000);
+
+// One tick of pulsing indicators: state.range(0) LEDs at eight blink rates.
+static void BM_AnimationTracks(benchmark::State& state)
+{
+    entt::registry registry;
+    AnimationTracks& tracks = AnimationTracks::of(registry);
+    for (int i = 0; i < int(state.range(0)); ++i) {
+        const entt::entity e = registry.create();
+        registry.emplace<MaterialComponent>(e);
+        registry.emplace<PulsingLightComponent>(e).speed = 2.0f + float(i % 8);
+    }
+    double time = 0.0;
+    for (auto _ : state) {
+        tracks.evaluate(time);
+        time += 1.0 / 60.0;
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AnimationTracks)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 17);
@@ -0,0 +1,44 @@
+#include "URDFParser.hpp"
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+// A serial arm of 'links' box links joined by revolute joints, written once
+// per size to the temp directory (the parser reads files).
+std::string syntheticUrdf(int links)
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path()
+        / ("krstudio_bench_" + std::to_string(links) + ".urdf");
+    std::ofstream out(path);
+    out << "<?xml version=\"1.0\"?>\n<robot name=\"bench_arm\">\n";
+    for (int i = 0; i < links; ++i) {
+        out << "  <link name=\"link" << i << "\">\n"
+            << "    <inertial><mass value=\"1.0\"/><inertia ixx=\"0.01\" ixy=\"0\" ixz=\"0\" iyy=\"0.01\" iyz=\"0\" izz=\"0.01\"/></inertial>\n"
+            << "    <visual><origin xyz=\"0 0 0.05\" rpy=\"0 0 0\"/><geometry><box size=\"0.05 0.05 0.1\"/></geometry>"
+            << "<material name=\"grey\"><color rgba=\"0.6 0.6 0.6 1\"/></material></visual>\n"
+            << "    <collision><origin xyz=\"0 0 0.05\" rpy=\"0 0 0\"/><geometry><cylinder radius=\"0.03\" length=\"0.1\"/></geometry></collision>\n"
+            << "  </link>\n";
+        if (i > 0) {
+            out << "  <joint name=\"joint" << i << "\" type=\"revolute\">\n"
+                << "    <parent link=\"link" << i - 1 << "\"/><child link=\"link" << i << "\"/>\n"
+                << "    <origin xyz=\"0 0 0.1\" rpy=\"0 0 0.1\"/><axis xyz=\"0 1 0\"/>\n"
+                << "    <limit lower=\"-3.14\" upper=\"3.14\" effort=\"10\" velocity=\"1\"/>\n"
+                << "  </joint>\n";
+        }
+    }
+    out << "</robot>\n";
+    return path.string();
+}
+}
+
+static void BM_UrdfParse(benchmark::State& state)
+{
+    const std::string path = syntheticUrdf(int(state.range(0)));
+    for (auto _ : state) benchmark::DoNotOptimize(URDFParser::parse(path));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_UrdfParse)->Arg(10)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * @class AabbTree
+ * @brief Dynamic AABB tree for broadphase over moving bodies.
+ *
+ * Unlike BoundsBvh, which is rebuilt from scratch, leaves are inserted and
+ * removed one at a time and the tree is kept balanced by rotations. Each
+ * leaf stores a "fat" box grown by a margin, so a body that moves a little
+ * stays inside its leaf and moveProxy() is a containment test. Node storage
+ * is a flat array with a free list; proxy ids are node indices and stay
+ * valid until destroyProxy().
+ */
+class AabbTree
+{
+public:
+    static constexpr std::int32_t kNull = -1;
+
+    explicit AabbTree(float margin = 0.02f) : m_margin(margin) {}
+
+    std::int32_t createProxy(const glm::vec3& min, const glm::vec3& max, std::uint32_t userData);
+    void destroyProxy(std::int32_t proxy);
+
+    // Returns true if the proxy had to be reinserted (the tight box left the fat one).
+    bool moveProxy(std::int32_t proxy, const glm::vec3& min, const glm::vec3& max);
+
+    std::uint32_t userData(std::int32_t proxy) const { return m_nodes[proxy].userData; }
+    const glm::vec3& fatMin(std::int32_t proxy) const { return m_nodes[proxy].min; }
+    const glm::vec3& fatMax(std::int32_t proxy) const { return m_nodes[proxy].max; }
+
+    std::size_t proxyCount() const { return m_proxyCount; }
+    int height() const { return m_root == kNull ? 0 : m_nodes[m_root].height; }
+    void clear();
+
+    // Calls visit(proxy) for every leaf whose fat box overlaps [min, max].
+    // Read-only, so several threads may query at once.
+    template <class VisitFn>
+    void query(const glm::vec3& min, const glm::vec3& max, VisitFn&& visit) const;
+
+    // Calls visit(proxy) for every leaf whose node boxes all pass
+    // overlaps(min, max); the generic form for rays, spheres and frusta.
+    template <class OverlapFn, class VisitFn>
+    void query(OverlapFn&& overlaps, VisitFn&& visit) const;
+
+private:
+    struct Node {
+        glm::vec3     min;
+        std::int32_t  parent;     ///< next free node while on the free list
+        glm::vec3     max;
+        std::int32_t  child1;
+        std::int32_t  child2;
+        std::int32_t  height;     ///< 0 for leaves, -1 when free
+        std::uint32_t userData;
+
+        bool isLeaf() const { return child1 == kNull; }
+    };
+
+    std::int32_t allocateNode();
+    void freeNode(std::int32_t node);
+    void insertLeaf(std::int32_t leaf);
+    void removeLeaf(std::int32_t leaf);
+    std::int32_t balance(std::int32_t node);
+    void refit(std::int32_t node);
+
+    std::vector<Node> m_nodes;
+    std::int32_t m_root = kNull;
+    std::int32_t m_freeList = kNull;
+    std::size_t m_proxyCount = 0;
+    float m_margin;
+};
+
+// --- Template implementation ---
+
+template <class VisitFn>
+void AabbTree::query(const glm::vec3& min, const glm::vec3& max, VisitFn&& visit) const
+{
+    query([&](const glm::vec3& nodeMin, const glm::vec3& nodeMax) {
+        return !(nodeMax.x < min.x || nodeMin.x > max.x ||
+                 nodeMax.y < min.y || nodeMin.y > max.y ||
+                 nodeMax.z < min.z || nodeMin.z > max.z);
+    }, std::forward<VisitFn>(visit));
+}
+
+template <class OverlapFn, class VisitFn>
+void AabbTree::query(OverlapFn&& overlaps, VisitFn&& visit) const
+{
+    if (m_root == kNull) return;
+
+    // Balanced trees stay far below this depth.
+    std::int32_t stack[256];
+    int top = 0;
+    stack[top++] = m_root;
+
+    while (top > 0) {
+        const Node& node = m_nodes[stack[--top]];
+        if (!overlaps(node.min, node.max)) continue;
+
+        if (node.isLeaf()) {
+            visit(std::int32_t(&node - m_nodes.data()));
+        }
+        else if (top + 2 <= 256) {
+            stack[top++] = node.child1;
+            stack[top++] = node.child2;
+        }
+    }
+}
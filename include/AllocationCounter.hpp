@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+/*------------------------------------------------------------------
+ *  AllocationCounter – counts global operator new calls
+ *
+ *  With KR_COUNT_ALLOCATIONS=1 (CMake option KR_COUNT_ALLOCATIONS)
+ *  the global operator new/delete are replaced by counting wrappers
+ *  around malloc/free. SystemScheduler uses the per-thread count to
+ *  report systems that allocate on a tick where they changed nothing.
+ *  Qt's own containers allocate with malloc and are not seen.
+ *
+ *  Without it both counts are always 0 and nothing is replaced.
+ *-----------------------------------------------------------------*/
+
+#ifndef KR_COUNT_ALLOCATIONS
+#  define KR_COUNT_ALLOCATIONS 0
+#endif
+
+namespace AllocationCounter
+{
+#if KR_COUNT_ALLOCATIONS
+    // Allocations made by the calling thread since it started.
+    std::uint64_t threadCount();
+    // Allocations made by every thread.
+    std::uint64_t totalCount();
+#else
+    inline std::uint64_t threadCount() { return 0; }
+    inline std::uint64_t totalCount() { return 0; }
+#endif
+}
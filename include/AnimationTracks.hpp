@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <entt/fwd.hpp>
+
+/**
+ * @class AnimationTracks
+ * @brief Every time-driven component value of a registry, evaluated as one
+ *        batch per tick.
+ *
+ * A track is a curve of time; a binding says which component field its
+ * value goes to and how it is scaled there. Both are flat arrays compiled
+ * from the authoring components: a PulsingLightComponent drives its
+ * MaterialComponent's albedo between offColor and onColor, a
+ * PulsingSplineTag its spline's glow alpha. Tracks with the same curve are
+ * shared, so a thousand LEDs blinking at one rate cost one sine.
+ *
+ * of() creates the tracks on first use and connects them to the
+ * construct, update and destroy signals of those components, and to the
+ * construct and destroy signals of the targets, whose storage moves then.
+ * The next evaluate() recompiles; in between it only computes the weights,
+ * four tracks per SSE2 sine, and writes them through the bindings, over
+ * ThreadPool::shared() past kParallelBindings. Pulses edited in place
+ * without registry.patch() or replace() are not seen.
+ *
+ * Curves are sine pulses, w = (1 + sin(speed * t)) / 2, the form every
+ * pulse already had. Time is the caller's clock in seconds,
+ * reduced in double precision so a session of days keeps its phase.
+ */
+class AnimationTracks
+{
+public:
+    static constexpr std::size_t kParallelBindings = 16384;   ///< below this one thread writes them all
+
+    static AnimationTracks& of(entt::registry& registry);
+
+    explicit AnimationTracks(entt::registry& registry) : m_registry(registry) {}
+
+    // Evaluates every track at 'time' and writes the bound fields.
+    void evaluate(double time);
+
+    // True if any field is animated, i.e. the next evaluate() changes something.
+    bool active();
+
+    std::size_t trackCount() const { return m_trackCount; }
+    std::size_t bindingCount() const { return m_alphas.size() + m_colors.size(); }
+
+    // Queues a recompile; called by the registry signals.
+    void invalidate() { m_dirty = true; }
+
+private:
+    struct ScalarBinding {
+        float* target;
+        std::uint32_t track;
+        float lo, hi;                        ///< the value at weight 0 and 1
+    };
+    struct ColorBinding {
+        glm::vec3* target;
+        std::uint32_t track;
+        glm::vec3 lo, hi;
+    };
+
+    void rebuild();
+    std::uint32_t trackFor(float speed);
+    void writeBindings(const float* weight, std::size_t first, std::size_t last);
+
+    entt::registry& m_registry;
+    bool m_dirty = true;
+
+    // Tracks, structure of arrays, padded to whole SSE2 lanes.
+    std::vector<float> m_speed;              ///< radians per second
+    std::vector<float> m_angle;              ///< per evaluate(): the phase, reduced to [-pi, pi); 16-byte aligned inside
+    std::vector<float> m_weight;             ///< per evaluate(): the curve's value in [0, 1]; likewise
+    std::size_t m_trackCount = 0;
+    std::unordered_map<std::uint32_t, std::uint32_t> m_trackOf;   ///< speed bits -> track
+
+    std::vector<ScalarBinding> m_alphas;
+    std::vector<ColorBinding> m_colors;
+};
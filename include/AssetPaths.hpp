@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Maps asset URIs to files, instead of paths baked into the code.
+ *
+ *   asset://<name>          the first mount that holds <name>
+ *   package://<pkg>/<rest>  a ROS package on ROS_PACKAGE_PATH, or an
+ *                           ancestor of 'baseDir' that is (or holds) <pkg>
+ *   file://<path>, <path>   as is; relative paths against 'baseDir'
+ *
+ * Mounts are searched in order: addMount() directories, KR_ASSET_PATH,
+ * <application dir>/assets, then the source tree's external/ in builds
+ * that know it (KR_SOURCE_ASSET_DIR). Each asset:// and package:// URI is
+ * looked up once; the answer is remembered for the process. Thread-safe.
+ */
+namespace AssetPaths
+{
+    // A file path for 'uri'. If no candidate exists, the first one is
+    // returned, so a failing load names a sensible path.
+    std::string resolve(const std::string& uri, const std::string& baseDir = {});
+
+    // Searched before the default mounts; clears remembered lookups.
+    void addMount(const std::string& directory);
+    std::vector<std::string> mounts();
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "RobotDescription.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <entt/fwd.hpp>
+
+class MotorSimulation;
+class QSaveFile;
+class Scene;
+
+/**
+ * @brief Non-interactive jobs behind the krbatch tool (src/BatchMain.cpp).
+ *
+ * Everything here runs on the calling thread plus ThreadPool::shared(),
+ * needs no widgets and no GL context, and writes its results through a
+ * TableWriter: CSV, or the columnar .krcol format below for anything large.
+ * Time series (step responses) go to a session log instead, so the editor
+ * can replay them.
+ *
+ * .krcol, little-endian:
+ *
+ *   char[8]   "KRCOL\0\0\1"
+ *   uint32    column count
+ *   per column: uint8 type (0 float32, 1 float64, 2 uint8), uint16 name
+ *               length, name bytes (UTF-8, no terminator)
+ *   batches:  uint64 row count, then each column's values for those rows,
+ *             contiguous, column after column
+ *   uint64    0, ending the file
+ *
+ * A reader can therefore stream batch by batch, and one column of a batch
+ * is a single array read (numpy.frombuffer).
+ */
+namespace BatchJobs
+{
+    struct Column {
+        enum class Type : std::uint8_t { Float32, Float64, UInt8 };
+        std::string name;
+        Type type = Type::Float32;
+    };
+
+    // Rows of fixed columns into a CSV or .krcol file; the file only
+    // replaces 'path' once close() succeeds.
+    class TableWriter
+    {
+    public:
+        enum class Format { Csv, Columnar };
+
+        TableWriter();
+        ~TableWriter();
+        TableWriter(const TableWriter&) = delete;
+        TableWriter& operator=(const TableWriter&) = delete;
+
+        // Csv unless 'path' ends in .krcol.
+        static Format formatFor(const std::string& path);
+
+        bool open(const std::string& path, std::vector<Column> columns, std::string* error = nullptr);
+        // Appends 'rows' rows: columns[c] points at column c's 'rows' values,
+        // of the column's type.
+        bool append(const void* const* columns, std::size_t rows);
+        // Ends the file and moves it into place.
+        bool close(std::string* error = nullptr);
+
+        std::size_t rowsWritten() const { return m_rows; }
+
+    private:
+        bool write(const void* data, std::size_t bytes);
+
+        std::unique_ptr<QSaveFile> m_file;
+        Format m_format = Format::Csv;
+        std::vector<Column> m_columns;
+        std::string m_text;   ///< CSV staging, reused per batch
+        std::size_t m_rows = 0;
+        bool m_failed = false;
+    };
+
+    // Adds the scene or robot at 'path' to 'scene': .krscene through
+    // SceneFile, .krobot / .urdf / .sdf through SceneBuilder, then applies
+    // joint positions and propagates transforms so the registry is ready
+    // to query. False with 'error' set if nothing could be loaded.
+    bool load(Scene& scene, const std::string& path, std::string* error = nullptr);
+
+    struct FieldExport {
+        glm::vec3 min{ -1.0f }, max{ 1.0f };
+        glm::ivec3 resolution{ 64 };   ///< samples per axis, including both ends; 1 samples the centre
+    };
+
+    // Samples the scene's field on a regular grid over [min, max] and
+    // writes x, y, z, vx, vy, vz per point, x fastest, to 'path'. The grid
+    // is a FieldGrid, sampled by FieldGridSampler in slabs of z-layers, so
+    // only one slab of results is held at a time.
+    bool exportField(entt::registry& registry, const FieldExport& job, const std::string& path,
+        std::string* error = nullptr);
+
+    struct JointSweep {
+        std::size_t samples = 100000;
+        std::uint32_t seed = 1;
+        int robot = 0;                 ///< index into the scene's robots, in registry order
+        bool environment = true;       ///< also test against EnvironmentColliderTag meshes
+    };
+
+    // Draws 'samples' configurations of one robot uniformly within its
+    // joint limits (unlimited joints over one turn), poses them with
+    // KinematicModel::forwardBatch and checks them with
+    // CollisionWorld::validateTrajectory, in batches. Writes one column per
+    // joint (named after it), the tip link's tip_x, tip_y, tip_z and
+    // collides (0/1) per configuration to 'path'; the tip is the last end
+    // effector, or the last link. Main thread, not a pool worker.
+    bool sweepJoints(entt::registry& registry, const JointSweep& job, const std::string& path,
+        std::string* error = nullptr);
+
+    struct StepResponse {
+        int robot = 0;                 ///< index into the scene's robots, in registry order
+        int joint = -1;                ///< DOF to step; -1 steps every joint at once
+        ControlMode mode = ControlMode::POSITION;
+        double step = 0.1;             ///< added to the held position, else the setpoint in the mode's unit
+        double settle = 0.5;           ///< seconds of holding before the step, not recorded
+        double seconds = 1.0;          ///< recorded after the step
+        double rate = 20000.0;         ///< simulation steps per second
+        std::size_t decimation = 20;   ///< steps per recorded sample
+    };
+
+    // Runs MotorSimulation for one robot: every joint holds its position
+    // for 'settle' seconds, then the step is applied at t = 'startNs' and
+    // 'seconds' of the response are written to the session log at 'path'
+    // (see MotorSimulation::record() for the channels). Any thread; the
+    // simulation is used exclusively. False if cancelled or unwritable.
+    bool stepResponse(MotorSimulation& simulation, const StepResponse& job, const std::string& path,
+        std::int64_t startNs = 0, const std::atomic<bool>* cancel = nullptr, std::string* error = nullptr);
+    // The same for the job's robot in 'registry'.
+    bool stepResponse(const entt::registry& registry, const StepResponse& job, const std::string& path,
+        std::string* error = nullptr);
+}
@@ -29,8 +29,16 @@ public:
     Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 5.0f));
 
     // --- Core Functions ---
+    // World space. Far from the world origin the float translation is coarse;
+    // camera-relative passes use getEyeViewMatrix() and worldPosition().
     glm::mat4 getViewMatrix() const;
-    glm::mat4 getProjectionMatrix(float aspectRatio) const;
+    // The view with the eye at the origin: rotation only. Positions given to
+    // it are world positions minus worldPosition(), taken in double.
+    glm::mat4 getEyeViewMatrix() const;
+    // reverseZ maps the near plane to depth 1 and the far plane to 0, for use
+    // with glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE) and GL_GREATER; the
+    // perspective far plane then sits at infinity.
+    glm::mat4 getProjectionMatrix(float aspectRatio, bool reverseZ = false) const;
 
     // --- NEW: Camera Control Functions ---
     void orbit(float xoffset, float yoffset);
@@ -38,6 +46,7 @@ public:
     void dolly(float yoffset);
     void move(Camera_Movement direction, float deltaTime);
     void focusOn(const glm::vec3& target, float distance = 5.0f);
+    void focusOn(const glm::dvec3& target, float distance = 5.0f);   ///< for georeferenced targets
 
     // --- Utility and State Functions ---
     void toggleProjection();
@@ -48,8 +57,9 @@ public:
     void setToKnownGoodView();
 
     // --- Getters ---
-    glm::vec3 getPosition() const { return m_Position; }
-    glm::vec3 getFocalPoint() const { return m_FocalPoint; }
+    glm::vec3 getPosition() const { return glm::vec3(worldPosition()); }
+    glm::vec3 getFocalPoint() const { return glm::vec3(m_Origin + glm::dvec3(m_FocalPoint)); }
+    glm::dvec3 worldPosition() const { return m_Origin + glm::dvec3(m_Position); }
     float getDistance() const { return m_Distance; }
     bool isPerspective() const { return m_IsPerspective; }
 
@@ -61,8 +71,13 @@ private:
     float      m_smoothAlpha = 0.25f; // 0 = instant, 1 = very smooth
 
     void updateCameraVectors();
+    // Moves m_Origin to the focal point once it is kRecentreDistance away,
+    // so the float members stay small wherever the camera travels.
+    void recentre();
+    static constexpr float kRecentreDistance = 256.0f;
 
     // Camera Attributes
+    glm::dvec3 m_Origin{ 0.0 };   ///< what m_Position and m_FocalPoint are relative to
     glm::vec3 m_Position;
     glm::vec3 m_FocalPoint;
     glm::vec3 m_Up;
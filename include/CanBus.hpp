@@ -0,0 +1,224 @@
+#pragma once
+
+#include "SpscRing.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <entt/fwd.hpp>
+
+/// One classic CAN frame as captured (24 bytes).
+struct CanFrame {
+    static constexpr std::uint8_t kExtended = 1;   ///< 29-bit identifier
+    static constexpr std::uint8_t kRemote = 2;     ///< RTR, no payload
+    static constexpr std::uint8_t kError = 4;      ///< controller error frame
+
+    std::int64_t  timestampNs = 0;   ///< steady clock, as TelemetryHub::nowNs()
+    std::uint32_t id = 0;
+    std::uint8_t  dlc = 0;
+    std::uint8_t  flags = 0;
+    std::uint8_t  reserved[2] = {};
+    std::uint8_t  data[8] = {};
+};
+
+/// Accepts a frame when (frame.id & mask) == (id & mask), like CAN_RAW_FILTER.
+struct CanFilter {
+    std::uint32_t id = 0;
+    std::uint32_t mask = 0;
+};
+
+/**
+ * @class CanReader
+ * @brief Driver interface for CAN adapters (SocketCAN, vendor USB/PCIe).
+ *
+ * read() runs on the capture's own thread and may block on I/O, but should
+ * return within 'timeout' so the thread can notice when it is stopped.
+ * Filters are applied as close to the hardware as the driver can; an empty
+ * list accepts everything.
+ */
+class CanReader
+{
+public:
+    virtual ~CanReader() = default;
+
+    virtual bool open(const std::vector<CanFilter>& filters) = 0;
+    // Fills up to 'max' frames; returns how many were written (0 on timeout).
+    virtual std::size_t read(CanFrame* out, std::size_t max, std::chrono::milliseconds timeout) = 0;
+    virtual void close() {}
+    // Frames the driver or kernel lost before read() saw them, if it knows.
+    virtual std::uint64_t overruns() const { return 0; }
+    virtual std::string name() const = 0;
+};
+
+#ifdef __linux__
+/**
+ * @class SocketCanReader
+ * @brief Linux SocketCAN raw socket ("can0", "vcan0", ...).
+ *
+ * Filters go to the kernel, frames are pulled in batches with recvmmsg and
+ * the socket's receive buffer is enlarged so a burst does not overflow it;
+ * the kernel's own drop counter (SO_RXQ_OVFL) is reported as overruns().
+ */
+class SocketCanReader : public CanReader
+{
+public:
+    explicit SocketCanReader(std::string interfaceName) : m_interface(std::move(interfaceName)) {}
+    ~SocketCanReader() override { close(); }
+
+    bool open(const std::vector<CanFilter>& filters) override;
+    std::size_t read(CanFrame* out, std::size_t max, std::chrono::milliseconds timeout) override;
+    void close() override;
+    std::uint64_t overruns() const override { return m_overruns; }
+    std::string name() const override { return m_interface; }
+
+private:
+    std::string m_interface;
+    int m_socket = -1;
+    std::uint32_t m_lastDropCount = 0;
+    std::atomic<std::uint64_t> m_overruns{ 0 };   ///< read by the GUI thread
+};
+#endif
+
+/**
+ * @class SimulatedCanReader
+ * @brief CANopen traffic for a set of nodes, paced to a fixed frame rate.
+ *
+ * Each node sends TPDO1..4 in turn with a heartbeat every 100 ms and a SYNC
+ * leads each round, so the monitor and decode tables can be exercised
+ * without an adapter at the rates a saturated bus reaches.
+ */
+class SimulatedCanReader : public CanReader
+{
+public:
+    SimulatedCanReader(std::vector<std::uint8_t> nodes, double framesPerSecond = 8000.0)
+        : m_nodes(std::move(nodes)), m_rate(framesPerSecond) {}
+
+    bool open(const std::vector<CanFilter>& filters) override;
+    std::size_t read(CanFrame* out, std::size_t max, std::chrono::milliseconds timeout) override;
+    std::string name() const override { return "simulated"; }
+
+private:
+    CanFrame next(std::int64_t timestampNs);
+
+    std::vector<std::uint8_t> m_nodes;
+    double m_rate;
+    std::vector<CanFilter> m_filters;
+    std::uint64_t m_sent = 0;              ///< frames generated so far, filtered or not
+    std::size_t m_slot = 0;                ///< position in the SYNC + PDO round
+    std::size_t m_heartbeats = 0;          ///< heartbeats still to send this period
+    std::int64_t m_lastHeartbeatNs = 0;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * @class CanDecodeTable
+ * @brief Identifier -> meaning, compiled from the robots' hardware interfaces.
+ *
+ * Every joint whose HardwareInterface::protocol is CANOPEN contributes the
+ * CANopen objects of its node (controller_id 1..127): EMCY, TPDO/RPDO 1-4,
+ * SDO and heartbeat. Lookup of an 11-bit identifier is one array index.
+ */
+class CanDecodeTable
+{
+public:
+    enum class Object : std::uint8_t { Unknown, Nmt, Sync, Emergency, Tpdo, Rpdo, SdoTx, SdoRx, Heartbeat };
+
+    struct Entry {
+        Object        object = Object::Unknown;
+        std::uint8_t  index = 0;      ///< PDO number 1..4
+        std::uint8_t  node = 0;
+        std::int32_t  joint = -1;     ///< into jointNames(), -1 for broadcast objects
+    };
+
+    static CanDecodeTable compile(entt::registry& registry);
+
+    const Entry& lookup(const CanFrame& frame) const;
+    // One-line meaning of 'frame', e.g. "heartbeat: operational".
+    std::string describe(const CanFrame& frame) const;
+    // "TPDO2", "EMCY", ... for the identifier's object.
+    static const char* objectName(Object object);
+
+    const std::vector<std::string>& jointNames() const { return m_jointNames; }
+    const std::vector<std::uint8_t>& nodes() const { return m_nodes; }
+    // Kernel filters for just the identifiers in the table (bound nodes plus NMT and SYNC).
+    std::vector<CanFilter> filters() const;
+
+private:
+    static constexpr std::uint32_t kStandardIds = 2048;
+    std::vector<Entry> m_entries = std::vector<Entry>(kStandardIds);
+    std::vector<std::string> m_jointNames;
+    std::vector<std::uint8_t> m_nodes;
+};
+
+/**
+ * @class CanCapture
+ * @brief Captures one bus on a dedicated thread, losslessly up to the ring size.
+ *
+ * The reader thread pushes frames into an SpscRing and never waits on the
+ * GUI. drain(), on the GUI thread, moves everything that has arrived into
+ * the capture history and the per-identifier statistics the monitor shows.
+ * The ring holds kRingCapacity frames, several seconds at 8k frames/s, so a
+ * stalled GUI loses nothing unless it stalls for longer; frames that do not
+ * fit are counted in dropped(), as are the driver's own overruns().
+ */
+class CanCapture
+{
+public:
+    static constexpr std::size_t kRingCapacity = std::size_t(1) << 16;
+    static constexpr std::size_t kReadBatch = 256;
+    static constexpr std::size_t kHistoryCapacity = std::size_t(1) << 19;   ///< newest frames kept for saving
+
+    struct IdStats {
+        std::uint32_t id = 0;
+        bool          extended = false;
+        std::uint64_t count = 0;
+        CanFrame      last;
+    };
+
+    CanCapture() = default;
+    ~CanCapture() { stop(); }
+
+    CanCapture(const CanCapture&) = delete;
+    CanCapture& operator=(const CanCapture&) = delete;
+
+    // Opens 'reader' with 'filters' and starts the capture thread.
+    bool start(std::unique_ptr<CanReader> reader, const std::vector<CanFilter>& filters = {});
+    void stop();
+    bool running() const { return m_running.load(std::memory_order_relaxed); }
+    std::string busName() const { return m_reader ? m_reader->name() : std::string(); }
+
+    // GUI thread: takes every pending frame. Never blocks. Returns how many.
+    std::size_t drain();
+
+    // Sorted by identifier; grows when a new identifier is seen.
+    const std::vector<IdStats>& ids() const { return m_ids; }
+    std::uint64_t captured() const { return m_captured; }
+    std::uint64_t dropped() const;
+
+    // Writes the history as a candump log ("(sec.usec) bus ID#DATA" per line).
+    bool saveLog(const std::string& path) const;
+    void clear();
+
+private:
+    void run();
+    IdStats& statsFor(const CanFrame& frame);
+
+    std::unique_ptr<CanReader> m_reader;
+    std::unique_ptr<SpscRing<CanFrame, kRingCapacity>> m_ring;
+    std::atomic<std::uint64_t> m_dropped{ 0 };
+    std::atomic<bool> m_running{ false };
+    std::thread m_thread;
+
+    std::vector<CanFrame> m_history;   ///< ring of kHistoryCapacity once full
+    std::size_t m_historyHead = 0;
+    std::uint64_t m_captured = 0;
+    std::vector<IdStats> m_ids;
+    std::vector<std::int32_t> m_standardIndex = std::vector<std::int32_t>(2048, -1);   ///< 11-bit id -> m_ids
+    std::unordered_map<std::uint32_t, std::int32_t> m_extendedIndex;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "CanBus.hpp"
+
+#include <QWidget>
+#include <QElapsedTimer>
+#include <memory>
+
+class QCheckBox;
+class QLabel;
+class QTableView;
+class QTimer;
+class CanIdModel;
+
+/**
+ * Live CAN bus monitor: one row per identifier (count, rate, last payload
+ * and its CANopen meaning). The capture runs on its own thread; the panel
+ * drains it and refreshes the table at kRefreshHz, and the table model
+ * formats only the rows the view asks for, so the cost of a refresh does
+ * not grow with the frame rate.
+ */
+class CanMonitorPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kRefreshHz = 20;
+
+    explicit CanMonitorPanel(QWidget* parent = nullptr);
+    ~CanMonitorPanel() override;
+
+    // Starts capturing with 'reader', decoding against 'table'. Returns false
+    // if the reader could not be opened.
+    bool start(std::unique_ptr<CanReader> reader, CanDecodeTable table);
+    void stop();
+    bool capturing() const { return m_capture.running(); }
+
+private:
+    void refresh();
+    void saveLog();
+
+    CanCapture m_capture;
+    CanDecodeTable m_table;
+    QTableView* m_view;
+    CanIdModel* m_model;
+    QLabel* m_status;
+    QCheckBox* m_knownOnly;
+    QTimer* m_refreshTimer;
+    QElapsedTimer m_sinceRefresh;
+    double m_unsyncedSeconds = 0.0;   ///< drained but not shown while hidden
+    std::uint64_t m_capturedAtRefresh = 0;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <entt/fwd.hpp>
+#include <entt/entity/entity.hpp>
+#include <glm/glm.hpp>
+
+class DistanceField;
+struct CollisionShapeComponent;
+
+/**
+ * @class ClearanceMonitor
+ * @brief Live minimum distance between every robot and the environment
+ *        colliders, written to a ClearanceComponent on each robot root.
+ *
+ * Environment colliders (EnvironmentColliderTag meshes) are read through
+ * their DistanceField, which is built in the background the first time the
+ * mesh is seen. Robot links are read as a few spheres. The spheres are
+ * fitted to the link's CollisionShapeComponent and enclose it, so the
+ * clearance errs on the small side. A capsule becomes spheres along its
+ * axis. A hull becomes the spheres around slices of its box along the
+ * longest side.
+ *
+ * Each sphere costs one field lookup per obstacle whose world bounds it
+ * lies within the band of, whatever the meshes' size. Distances at or
+ * beyond Settings::band read as the band. Obstacles are assumed to be
+ * scaled uniformly. Run after CollisionWorld::update(), which fits the
+ * link shapes.
+ */
+class ClearanceMonitor
+{
+public:
+    struct Settings {
+        float band = 0.3f;                   ///< largest clearance measured, world units
+        float voxelSize = 0.02f;             ///< distance field spacing, world units
+    };
+
+    struct Stats {
+        std::size_t obstacles = 0;           ///< environment colliders with a field
+        std::size_t pendingFields = 0;       ///< still being built
+        std::size_t spheres = 0;             ///< link spheres queried
+        std::size_t lookups = 0;             ///< field lookups
+        double microseconds = 0.0;           ///< duration of the last update()
+    };
+
+    ClearanceMonitor();
+    ~ClearanceMonitor();
+
+    void setSettings(const Settings& settings) { m_settings = settings; }
+    const Settings& settings() const { return m_settings; }
+
+    // Returns true if any robot's nearest link, obstacle or distance (by
+    // more than a millimetre) changed.
+    bool update(entt::registry& registry);
+
+    const Stats& stats() const { return m_stats; }
+
+    // Spheres (xyz centre, w radius, shape-local) enclosing 'shape'.
+    static void fitSpheres(const CollisionShapeComponent& shape, std::vector<glm::vec4>& spheres);
+
+private:
+    struct Obstacle {
+        entt::entity entity;
+        std::shared_ptr<const DistanceField> field;
+        glm::mat4 worldToLocal;
+        glm::mat3 localToWorld;              ///< rotation and scale, for gradients
+        float scale;
+        glm::vec3 min, max;                  ///< world bounds grown by the band
+    };
+    struct LinkSpheres {
+        std::size_t meshKey = 0;             ///< CollisionShapeComponent::meshKey it was fitted for
+        std::size_t points = 0;
+        float radius = 0.0f;
+        std::vector<glm::vec4> spheres;
+    };
+
+    Settings m_settings;
+    Stats m_stats;
+    std::vector<Obstacle> m_obstacles;       ///< update() scratch
+    std::unordered_map<entt::entity, LinkSpheres> m_spheres;
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "AabbTree.hpp"
+#include "ConvexCollision.hpp"
+#include "KinematicModel.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <entt/fwd.hpp>
+
+struct KinematicModelComponent;
+
+/**
+ * @class CollisionWorld
+ * @brief Self- and environment collision checking for every spawned robot.
+ *
+ * Robot links and meshes tagged EnvironmentColliderTag get a
+ * CollisionShapeComponent fitted from their render mesh (a link's
+ * CollisionMeshComponent if it has one) the first time they are seen: a
+ * capsule for elongated links, a hull of up to 64 vertices otherwise. Each update moves their AabbTree leaves from
+ * WorldTransformComponent, and only pairs whose boxes overlap reach GJK/EPA.
+ * Pairs where neither collider moved keep last frame's answer.
+ *
+ * A link whose CollisionMeshComponent carries a convex decomposition is
+ * one leaf bounded by the hull of all its pieces, but its contacts come
+ * from the pieces: the deepest of the piece pairs whose boxes overlap. A
+ * gripper's open jaws then no longer collide with what sits between them.
+ * queryLinks() hands out the enclosing hull, which errs on the safe side.
+ *
+ * Pairs never tested: two environment colliders, links of one robot joined
+ * by a joint, pairs switched off with disableSelfCollision() and pairs that
+ * already touch in the robot's zero configuration, tested as soon as its
+ * links have shapes (placeholder geometry of neighbouring links often
+ * overlaps there). Shapes are refitted when their mesh's content changes.
+ */
+class CollisionWorld
+{
+public:
+    struct Stats {
+        std::size_t colliders = 0;
+        std::size_t candidatePairs = 0;   ///< broadphase pairs past filtering, last narrowphase
+        std::size_t narrowphaseTests = 0; ///< of those, pairs actually run through GJK
+        std::size_t contacts = 0;
+    };
+
+    // A robot link's collider as of the last update(), world space.
+    struct LinkShape {
+        entt::entity entity;
+        entt::entity robot;
+        int link;
+        const ConvexCollision::Shape& shape;
+        const glm::vec3& min;                ///< tight bounds, radius included
+        const glm::vec3& max;
+    };
+
+    // Fits new shapes, moves leaves, runs the narrowphase if anything moved
+    // and keeps CollisionContactComponent on exactly the colliders in
+    // contact. Run after transform propagation. Returns true if the set of
+    // contacts changed. Without 'narrowphase' only the shapes and the tree
+    // are brought up to date, for queryLinks(); the pairs are tested the
+    // next time it is asked for.
+    bool update(entt::registry& registry, bool narrowphase = true);
+
+    // Calls visit(const LinkShape&) for every robot link whose bounds
+    // overlap [min, max], through the broadphase tree.
+    template <class VisitFn>
+    void queryLinks(const glm::vec3& min, const glm::vec3& max, VisitFn&& visit) const;
+
+    // Removes every CollisionContactComponent, e.g. when checking is switched off.
+    void clearContacts(entt::registry& registry);
+
+    // Self-collision filter for the robot whose root link is 'robot', by model link index.
+    void disableSelfCollision(entt::entity robot, int linkA, int linkB);
+    void enableSelfCollision(entt::entity robot, int linkA, int linkB);
+    bool isSelfCollisionEnabled(entt::entity robot, int linkA, int linkB) const;
+
+    // Checks 'count' configurations of 'robot' ('q' is count x dofCount(),
+    // row-major) against itself and, if asked, against the environment
+    // colliders where they are now. collides[i] becomes 1 for configurations
+    // in collision, 0 otherwise; returns how many collide. Link poses come
+    // from KinematicModel::forwardBatch() and configurations are checked on
+    // ThreadPool::shared(). Call from the GUI thread once update() has seen
+    // the robot; links without a fitted shape are ignored.
+    std::size_t validateTrajectory(entt::registry& registry, entt::entity robot, const double* q,
+        std::size_t count, std::uint8_t* collides, bool includeEnvironment = true);
+
+    // Bumped whenever an environment collider appears, moves or goes away;
+    // other robots do not count. For caches of what is free around a robot.
+    std::uint64_t environmentVersion() const { return m_environmentVersion; }
+
+    const Stats& stats() const { return m_stats; }
+
+private:
+    struct Part {
+        ConvexCollision::Shape shape;        ///< world space
+        glm::vec3 min{ 0.0f }, max{ 0.0f };
+    };
+
+    struct Body {
+        bool alive = false;                  ///< false for a free slot
+        entt::entity entity{};
+        entt::entity robot{};
+        int link = -1;
+        std::int32_t proxy = AabbTree::kNull;
+        ConvexCollision::Shape shape;        ///< world space
+        glm::vec3 min{ 0.0f }, max{ 0.0f };  ///< tight world bounds of 'shape'
+        std::vector<Part> parts;             ///< the decomposition's pieces, or just 'shape'
+        glm::mat4 sourceMatrix{ 1.0f };
+        bool moved = false;
+    };
+
+    struct RobotState {
+        std::shared_ptr<const KinematicModel> model;
+        bool primed = false;                 ///< zero-configuration contacts already filtered
+    };
+
+    void reset();
+    void fitShapes(entt::registry& registry);
+    bool syncBodies(entt::registry& registry);
+    bool filterSpawnContacts(entt::registry& registry);
+    void linkBodies(const KinematicModelComponent& kin, int links, std::vector<std::int64_t>& linkBody,
+        std::vector<std::size_t>& partBegin) const;
+    void poseLinks(const std::int64_t* linkBody, int links, const KinematicModel::Pose* world,
+        const std::size_t* partBegin, ConvexCollision::Shape* shapes, glm::vec3* mins, glm::vec3* maxs, Part* parts) const;
+    bool pairEnabled(const Body& a, const Body& b) const;
+    std::uint32_t addBody(entt::entity entity);
+    void removeBody(std::uint32_t slot);
+
+    // Deepest contact, or the first hit, among part pairs whose boxes overlap.
+    static ConvexCollision::Contact collideParts(const std::vector<Part>& a, const std::vector<Part>& b);
+    static bool intersectParts(const Part* a, std::size_t aCount, const Part* b, std::size_t bCount);
+    static void placeParts(std::vector<Part>& parts, const ConvexCollision::Shape& shape);
+
+    static std::uint64_t pairKey(std::uint32_t a, std::uint32_t b);
+    static std::uint64_t linkPairKey(entt::entity robot, int linkA, int linkB);
+
+    AabbTree m_tree;
+    std::vector<Body> m_bodies;
+    std::vector<std::uint32_t> m_freeBodies;
+    std::unordered_map<entt::entity, std::uint32_t> m_bodyOf;
+    std::unordered_map<entt::entity, RobotState> m_robots;
+    std::unordered_set<std::uint64_t> m_disabledPairs;
+    std::unordered_map<std::uint64_t, float> m_contacts;   ///< body pair -> penetration depth
+    std::vector<KinematicModel::Pose> m_poses;             ///< validateTrajectory scratch
+    entt::registry* m_registry = nullptr;
+    std::uint64_t m_environmentVersion = 0;
+    Stats m_stats;
+};
+
+// --- Template implementation ---
+
+template <class VisitFn>
+void CollisionWorld::queryLinks(const glm::vec3& min, const glm::vec3& max, VisitFn&& visit) const
+{
+    m_tree.query(min, max, [&](std::int32_t proxy) {
+        const Body& b = m_bodies[m_tree.userData(proxy)];
+        if (!b.alive || b.link < 0) return;   // environment collider
+        if (b.max.x < min.x || b.min.x > max.x || b.max.y < min.y || b.min.y > max.y
+            || b.max.z < min.z || b.min.z > max.z) return;
+        visit(LinkShape{ b.entity, b.robot, b.link, b.shape, b.min, b.max });
+    });
+}
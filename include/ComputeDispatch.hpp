@@ -0,0 +1,131 @@
+#pragma once
+
+#include <QString>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <qopengl.h>
+
+class QOpenGLFunctions_4_3_Core;
+class Shader;
+
+/**
+ * @class ComputeDispatch
+ * @brief The field compute kernels, in several workgroup sizes, with
+ *        per-dispatch timing and invocation counts.
+ *
+ * Each kernel's shader reads its workgroup size from KR_LOCAL_SIZE_X, so
+ * the same source builds once per entry of kLocalSizes. select() returns
+ * the program to bind for a batch of dispatches and dispatch() sizes the
+ * grid for it (ceil(items / local size) groups, the shaders bound-check).
+ *
+ * Auto-tune: without a stored choice for this GL driver, every variant is
+ * built and the first batches cycle through them; once each variant has
+ * kTuneSamples timed dispatches the one with the lowest median time per
+ * item is kept, written to the cache directory, and the others freed.
+ * Later runs on the same driver build only the stored size.
+ * KR_COMPUTE_TUNE=0 skips tuning (local size 256), =1 tunes again.
+ *
+ * Timing brackets each dispatch with GL_TIMESTAMP queries, so it nests in
+ * GpuProfiler's passes. With GL_ARB_pipeline_statistics_query a
+ * GL_COMPUTE_SHADER_INVOCATIONS query counts the invocations the GPU ran,
+ * against the items asked for: the lanes the last group wastes.
+ * Results are harvested without waiting, a few frames late. Queries are
+ * per context: each context passes its own ContextQueries.
+ *
+ * GUI thread; a context of the renderer's share group must be current.
+ */
+class ComputeDispatch
+{
+public:
+    enum class Kernel : std::uint8_t { FieldArrows, ParticleUpdate, FlowUpdate, Count };
+    static constexpr std::size_t kKernelCount = std::size_t(Kernel::Count);
+    static constexpr std::array<GLuint, 4> kLocalSizes = { 64, 128, 256, 512 };
+    static constexpr GLuint kDefaultLocalSize = 256;
+    static constexpr int kTuneSamples = 24;        ///< timed dispatches per variant before choosing
+
+    static const char* kernelName(Kernel kernel);
+    static const char* kernelFile(Kernel kernel);
+
+    /// One context's query objects; destroy() them with that context current.
+    struct ContextQueries {
+        struct Pending {
+            Kernel kernel;
+            int variant;
+            GLuint items, groups;
+            GLuint queries[3];                    ///< start, end timestamps; invocations or 0
+        };
+        std::vector<Pending> pending;             ///< in submission order
+        std::vector<GLuint> freeQueries;
+    };
+
+    struct KernelStats {
+        GLuint localSize = kDefaultLocalSize;     ///< in use
+        bool tuning = false;
+        std::uint64_t dispatches = 0;             ///< timed and harvested
+        double gpuUs = 0.0;                       ///< per dispatch, smoothed
+        double nsPerItem = 0.0;                   ///< smoothed
+        GLuint items = 0, groups = 0;             ///< of the newest harvested dispatch
+        std::uint64_t invocations = 0;            ///< 0 without pipeline statistics
+        std::array<double, kLocalSizes.size()> tunedNsPerItem{};   ///< median per variant, after tuning
+    };
+
+    using Builder = std::function<std::unique_ptr<Shader>(Kernel kernel, GLuint localSize)>;
+
+    ~ComputeDispatch();
+
+    // Builds the kernels' programs through 'build' (which adds the
+    // KR_LOCAL_SIZE_X define): the stored sizes, or every variant of the
+    // kernels still to tune. Rethrows the builder's errors.
+    void initialize(QOpenGLFunctions_4_3_Core* gl, const Builder& build);
+    // Rebuilds one kernel's current variants, e.g. after a source edit.
+    void rebuild(Kernel kernel, const Builder& build);
+    void release();
+
+    // Times and counts dispatches while on (the HUD); tuning does so anyway.
+    void setRecording(bool on) { m_recording = on; }
+
+    // The program for the next batch of 'kernel'; null if it failed to build.
+    Shader* select(Kernel kernel);
+    // glDispatchCompute for 'items' items with the selected variant.
+    void dispatch(ContextQueries& context, Kernel kernel, GLuint items);
+    // glDispatchComputeIndirect from the bound GL_DISPATCH_INDIRECT_BUFFER,
+    // whose group count a previous pass wrote for localSize(). 'maxItems'
+    // stands in for the item count in the timings: it is all the CPU knows.
+    void dispatchIndirect(ContextQueries& context, Kernel kernel, GLintptr offset, GLuint maxItems);
+    // Workgroup size of the variant select() returned; 0 before that.
+    GLuint localSize(Kernel kernel) const;
+    // Reads every finished query; call once per frame per context.
+    void harvest(ContextQueries& context);
+    void destroy(ContextQueries& context);
+
+    const KernelStats& stats(Kernel kernel) const { return m_kernels[std::size_t(kernel)].stats; }
+    bool pipelineStatistics() const { return m_pipelineStatistics; }
+
+private:
+    struct KernelState {
+        std::array<std::unique_ptr<Shader>, kLocalSizes.size()> variants;
+        int selected = -1;                        ///< variant index of select()
+        int chosen = -1;                          ///< tuned or stored; -1 while tuning
+        int nextTuned = 0;                        ///< round robin while tuning
+        std::array<std::vector<double>, kLocalSizes.size()> samples;   ///< ns per item while tuning
+        KernelStats stats;
+    };
+
+    static int variantOf(GLuint localSize);
+    void launch(ContextQueries& context, Kernel kernel, GLuint items, GLintptr indirectOffset);
+    void finishTuning(Kernel kernel);
+    void loadChoices();
+    void storeChoices() const;
+
+    QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+    std::array<KernelState, kKernelCount> m_kernels;
+    QString m_driverId;
+    QString m_cachePath;
+    bool m_recording = false;
+    bool m_pipelineStatistics = false;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * Convex narrowphase: GJK for separation, EPA for penetration.
+ *
+ * A shape is a point set (its convex hull) swept by a sphere of 'radius':
+ * two points and a radius make a capsule, a hull's vertices with radius 0 a
+ * convex polytope. GJK runs on the cores only, so shallow contacts between
+ * rounded shapes come from the core distance and the radii; EPA on the full
+ * shapes only runs when the cores themselves overlap.
+ */
+namespace ConvexCollision
+{
+    struct Shape {
+        const glm::vec3* points = nullptr;   ///< local-space core points
+        std::size_t count = 0;
+        float radius = 0.0f;                 ///< world units
+        glm::mat3 linear{ 1.0f };            ///< local -> world (rotation and scale)
+        glm::vec3 translation{ 0.0f };
+
+        glm::vec3 center() const;            ///< world-space centroid of the core points
+        glm::vec3 supportCore(const glm::vec3& dir) const;  ///< world-space, radius excluded
+    };
+
+    struct Contact {
+        bool      hit = false;
+        float     distance = 0.0f;           ///< > 0 separated, <= 0 penetration depth (negated)
+        glm::vec3 normal{ 0.0f, 0.0f, 1.0f };///< from a towards b
+        glm::vec3 pointA{ 0.0f }, pointB{ 0.0f };
+    };
+
+    // Full query: distance or penetration, normal and witness points.
+    Contact collide(const Shape& a, const Shape& b);
+
+    // Cheaper yes/no, stopping as soon as a separating direction is found.
+    bool intersects(const Shape& a, const Shape& b);
+
+    // World-space AABB of the shape, radius included.
+    void bounds(const Shape& shape, glm::vec3& min, glm::vec3& max);
+
+    // --- Fitting ---
+
+    struct Capsule {
+        glm::vec3 a{ 0.0f }, b{ 0.0f };
+        float radius = 0.0f;
+    };
+    // Principal axis of the points, then ends and radius chosen so every
+    // point lies inside.
+    Capsule fitCapsule(const std::vector<glm::vec3>& points);
+
+    // Up to 'maxPoints' points on the convex hull of 'points' (extremes along
+    // evenly spread directions, duplicates removed). Their hull is a slightly
+    // inner approximation that supports the same GJK queries as the full set.
+    std::vector<glm::vec3> hullSupportPoints(const std::vector<glm::vec3>& points, std::size_t maxPoints = 64);
+}
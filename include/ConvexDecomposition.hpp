@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Convex pieces of one mesh, mesh-local, packed back to back.
+struct ConvexHullSet {
+    std::vector<glm::vec3> points;        ///< every hull's points, one hull after another
+    std::vector<std::uint32_t> offsets;   ///< hull i is points [offsets[i], offsets[i + 1])
+
+    std::size_t hullCount() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    const glm::vec3* hull(std::size_t i) const { return points.data() + offsets[i]; }
+    std::size_t hullSize(std::size_t i) const { return offsets[i + 1] - offsets[i]; }
+};
+
+/**
+ * Approximate convex decomposition, in the spirit of V-HACD without the
+ * voxels: the triangle soup is cut greedily by axis-aligned planes until
+ * every piece is close to its convex hull or there are maxHulls pieces.
+ *
+ * A piece's concavity is the largest gap, along a triangle's outward
+ * normal, between the triangle and the piece's hull (the hull's support
+ * in that direction). Surface on the hull scores 0; the floor of a pocket
+ * scores its depth. The worst piece is split next, by whichever of a few
+ * planes per axis leaves the least concavity on both sides. Triangles go
+ * to the side their centroid is on, so neighbouring hulls overlap a
+ * little at the cut rather than leave a gap. Finally, pieces whose union
+ * is still good enough are merged back, as V-HACD does.
+ *
+ * Concavity is measured on at most kEvaluationTriangles triangles per
+ * piece; the final hulls take every vertex. Free of Qt and the registry.
+ */
+namespace ConvexDecomposition
+{
+    constexpr std::size_t kEvaluationTriangles = 1024;
+
+    struct Params {
+        int maxHulls = 16;
+        float maxConcavity = 0.02f;        ///< good enough below this, relative to the mesh's bounding diagonal
+        std::size_t maxHullPoints = 32;    ///< per hull, as ConvexCollision::hullSupportPoints
+        int planesPerAxis = 7;             ///< split candidates, evenly across a piece's extent
+
+        // Stable across runs, for caches.
+        std::uint64_t key() const;
+    };
+
+    // Without triangles the result is the hull of the points.
+    ConvexHullSet decompose(const std::vector<glm::vec3>& positions, const std::vector<unsigned>& indices,
+        const Params& params = {});
+}
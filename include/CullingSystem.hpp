@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <entt/fwd.hpp>
+
+struct WorldBoundsComponent;
+
+// Six inward-facing planes (ax + by + cz + d >= 0 is inside), extracted
+// from a combined projection * view matrix.
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+namespace CullingSystem
+{
+    // Refreshes WorldBoundsComponent for every renderable mesh whose world
+    // matrix (or mesh) changed since the last call. Run once per tick,
+    // after transform propagation. Returns how many bounds changed, which
+    // doubles as a cheap "did anything move" signal for frame skipping.
+    std::size_t updateWorldBounds(entt::registry& registry);
+
+    // The AABB of box [localMin, localMax] under 'm' (Arvo's method).
+    void transformBox(const glm::mat4& m, const glm::vec3& localMin, const glm::vec3& localMax,
+        glm::vec3& min, glm::vec3& max);
+
+    Frustum extractFrustum(const glm::mat4& viewProjection);
+
+    // Conservative AABB test: false only if the box is fully outside a plane.
+    bool isVisible(const Frustum& frustum, const glm::vec3& min, const glm::vec3& max);
+    bool isVisible(const Frustum& frustum, const WorldBoundsComponent& bounds);
+}
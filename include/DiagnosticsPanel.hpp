@@ -1,24 +1,48 @@
 #pragma once
 
 #include <QDockWidget>
-#include <map>
-#include <string>
+#include <QElapsedTimer>
+#include <entt/fwd.hpp>
+#include <vector>
 
 // Forward declarations
-class QLabel;
-class QVBoxLayout;
+class QTableView;
+class QTimer;
 class Robot;
+class JointStateModel;
+class JointStateBuffer;
 
+/**
+ * Joint readout. Rows live in a table model behind a QTableView, so only the
+ * visible rows are ever painted, and a refresh touches only rows whose
+ * displayed text changed. Refreshes are capped at kRefreshHz no matter how
+ * often data arrives.
+ */
 class DiagnosticsPanel : public QDockWidget
 {
     Q_OBJECT
 
 public:
+    static constexpr int kRefreshHz = 20;
+
     explicit DiagnosticsPanel(QWidget* parent = nullptr);
+    ~DiagnosticsPanel() override;
+
+    // Polls the JointStateBuffer of every robot in 'registry' (the
+    // telemetry-fed positions) at kRefreshHz while the panel is visible.
+    // nullptr stops polling.
+    void setRegistry(entt::registry* registry);
+
+    // Legacy push path; calls closer together than the refresh interval are ignored.
     void updateData(const Robot& robot);
 
 private:
-    QWidget* m_mainWidget;
-    QVBoxLayout* m_layout;
-    std::map<std::string, QLabel*> m_jointLabels;
-};
\ No newline at end of file
+    void refreshFromRegistry();
+
+    QTableView* m_view;
+    JointStateModel* m_model;
+    QTimer* m_refreshTimer;
+    QElapsedTimer m_sinceRefresh;
+    entt::registry* m_registry = nullptr;
+    std::vector<const JointStateBuffer*> m_rowBuffers;   ///< one per robot; rows are rebuilt when this changes
+};
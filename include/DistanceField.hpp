@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct MeshData;
+
+/**
+ * @class DistanceField
+ * @brief Sparse signed distance field of one mesh, in mesh-local space.
+ *
+ * Distances are sampled on a grid of voxelSize() spacing and stored as
+ * 16-bit fractions of the band, but only in
+ * bricks of kBrickSamples^3 samples that lie within band() of a triangle.
+ * Neighbouring bricks share their boundary samples, so trilinear
+ * interpolation in any cell reads one brick. A query is a hash lookup and
+ * eight reads, whatever the mesh's size. Outside the bricks, distance()
+ * returns band(). That also holds deep inside a solid, which is already in
+ * collision.
+ *
+ * Each sample holds the distance to the nearest triangle. It is negative
+ * behind that triangle's face, as wound. Where several triangles are
+ * nearest (edges, corners), the one facing the sample most squarely
+ * decides the sign. Open or inconsistently wound meshes therefore give
+ * unreliable signs close to the surface, but correct magnitudes.
+ *
+ * Bricks are built on ThreadPool::shared(), each against only the
+ * triangles whose inflated bounds reach it. Immutable once built and safe
+ * to query from any thread.
+ */
+class DistanceField
+{
+public:
+    static constexpr int kBrickSamples = 8;
+    static constexpr int kBrickCells = kBrickSamples - 1;
+    static constexpr int kMaxCells = 1024;   ///< per axis; voxelSize is raised to stay within it
+
+    DistanceField(const MeshData& mesh, float voxelSize, float band);
+
+    // Built in the background and cached: one field per mesh, band and
+    // voxel size, dropped once the mesh is gone. Null until ready, so a
+    // caller falls back to the triangles meanwhile and asks again later.
+    static std::shared_ptr<const DistanceField> shared(const std::shared_ptr<const MeshData>& mesh,
+        float voxelSize, float band);
+
+    // Signed distance at 'p', clamped to +-band().
+    float distance(const glm::vec3& p) const;
+    // Distance and its gradient (the outward direction), if 'p' is inside a brick.
+    bool sample(const glm::vec3& p, float& distance, glm::vec3& gradient) const;
+
+    float voxelSize() const { return m_voxelSize; }
+    float band() const { return m_band; }
+    std::size_t brickCount() const { return m_brickOf.size(); }
+    std::size_t memoryBytes() const { return m_values.size() * sizeof(std::int16_t); }
+
+private:
+    static std::uint64_t brickKey(const glm::ivec3& brick)
+    {
+        return std::uint64_t(std::uint32_t(brick.x)) | std::uint64_t(std::uint32_t(brick.y)) << 21
+            | std::uint64_t(std::uint32_t(brick.z)) << 42;
+    }
+    // The lowest sample of the cell holding 'p' and p's position within the
+    // cell (0..1 per axis); false outside every brick.
+    bool locate(const glm::vec3& p, const std::int16_t*& corner, glm::vec3& fraction) const;
+
+    float m_voxelSize = 0.0f;
+    float m_band = 0.0f;
+    glm::vec3 m_origin{ 0.0f };              ///< position of sample (0, 0, 0)
+    glm::ivec3 m_cells{ 0 };                 ///< grid extent, cells per axis
+    std::unordered_map<std::uint64_t, std::uint32_t> m_brickOf;
+    std::vector<std::int16_t> m_values;      ///< kBrickSamples^3 per brick, x fastest, band / 32767 per step
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "JointCommandLoop.hpp"
+#include "RigidBodyDynamics.hpp"
+#include "TripleBuffer.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <entt/fwd.hpp>
+
+/**
+ * @class DynamicsSimulation
+ * @brief Steps every robot's RigidBodyDynamics on a fixed-rate background thread.
+ *
+ * bind() builds one RigidBodyDynamics per robot from its components and
+ * starts from the joint state the robots show now. The thread then steps
+ * all of them every cycle (1 kHz by default) on absolute deadlines, like
+ * JointCommandLoop, and drives each joint from a JointCommand with the
+ * joint's own PID gains on top of RNEA gravity compensation:
+ *
+ *   POSITION   tau = g(q) + p (setpoint - q) - d qd
+ *   VELOCITY   tau = g(q) + p (setpoint - qd)
+ *   TORQUE     tau = setpoint (CURRENT and DUTY_CYCLE likewise)
+ *   INACTIVE   tau = 0, the joint hangs under gravity and friction
+ *
+ * plus the command's feed-forward. Every joint starts holding its position.
+ * Commands travel in through one TripleBuffer and the simulated state out
+ * through another, so neither thread waits on the other; apply() copies the
+ * newest state into the robots' JointStateBuffers on the GUI thread. A third
+ * TripleBuffer hands the same state to one more thread, e.g. SimulatedSensors,
+ * which then reports it through TelemetryHub instead (setMeasured()).
+ */
+class DynamicsSimulation
+{
+public:
+    struct Stats {
+        std::uint64_t steps = 0;
+        std::uint64_t overruns = 0;       ///< deadlines skipped because a cycle ran long
+        double stepUs = 0.0;              ///< mean time to step every robot once
+    };
+    struct State {
+        std::vector<double> position, velocity, effort;   ///< all robots, by frame DOF
+    };
+
+    DynamicsSimulation() = default;
+    ~DynamicsSimulation() { stop(); }
+    DynamicsSimulation(const DynamicsSimulation&) = delete;
+    DynamicsSimulation& operator=(const DynamicsSimulation&) = delete;
+
+    void setRate(double hz) { m_rateHz = hz; }
+    double rate() const { return m_rateHz; }
+
+    // GUI thread. (Re)starts the simulation for every robot in 'registry'
+    // with moving joints. Returns how many robots are simulated.
+    std::size_t bind(entt::registry& registry);
+    void stop();
+    bool running() const { return m_thread.joinable(); }
+
+    // GUI thread: stage a command for a joint entity, then publish() all
+    // staged commands at once. False if the joint is not simulated.
+    bool setCommand(entt::entity joint, const JointCommand& command);
+    void publish();
+
+    // GUI thread: writes the newest simulated state into the robots'
+    // JointStateBuffers. True if there was a new state.
+    bool apply(entt::registry& registry);
+
+    // GUI thread: newest statistics from the simulation thread.
+    const Stats& stats();
+
+    // GUI thread, after bind(): the joint's index in State, -1 if it is not
+    // simulated.
+    int frameDof(entt::entity joint) const;
+
+    // One thread other than the GUI thread: takes the newest state into
+    // sensorState() if a step ran since the last call. The state stays valid
+    // until the next bind(), so stop the consumer before rebinding.
+    bool pollSensorState() { return m_sensorState.update(); }
+    const State& sensorState() const { return m_sensorState.front(); }
+
+    // GUI thread. While set, apply() writes nothing: the joint states come
+    // back measured through telemetry.
+    void setMeasured(bool measured) { m_measured = measured; }
+    bool measured() const { return m_measured; }
+
+private:
+    struct Robot {
+        entt::entity root{};
+        std::unique_ptr<RigidBodyDynamics> dynamics;
+        std::size_t first = 0;            ///< first DOF in the frame-wide arrays
+        std::vector<double> positionP, positionD, velocityP;   ///< by DOF, from the joint's PIDs
+        std::vector<double> gravity;      ///< scratch: RNEA gravity and Coriolis torques
+        std::vector<double> tau;          ///< scratch: commanded torques
+    };
+    void run();
+
+    double m_rateHz = 1000.0;
+    std::vector<Robot> m_robots;
+    std::size_t m_dofs = 0;
+    std::unordered_map<entt::entity, std::size_t> m_slotOf;   ///< joint entity -> frame DOF
+    std::vector<JointCommand> m_staged;                        ///< GUI thread only
+    State m_working;                                           ///< simulation thread once started
+    TripleBuffer<std::vector<JointCommand>> m_commands;        ///< GUI -> simulation
+    TripleBuffer<State> m_state;                               ///< simulation -> GUI
+    TripleBuffer<State> m_sensorState;                         ///< simulation -> sensor models
+    TripleBuffer<Stats> m_stats;                               ///< simulation -> GUI
+    bool m_measured = false;                                   ///< GUI thread
+    std::atomic<bool> m_running{ false };
+    std::thread m_thread;
+};
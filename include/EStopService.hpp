@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+class JointCommandLoop;
+
+/**
+ * @class EStopService
+ * @brief Emergency-stop input on its own thread, straight into the
+ *        JointCommandLoop, with no Qt event loop in between.
+ *
+ * The thread blocks on the stop input and calls
+ * JointCommandLoop::emergencyStop() the moment it fires, so a long frame or
+ * a modal dialog (RobotEnrichmentDialog::exec and the like) on the GUI
+ * thread does not delay it. The input is:
+ *  - Linux: a key on an evdev device (a keyboard's Pause key, or a USB
+ *    stop button or foot switch that reports as one), with the kernel's
+ *    monotonic event time as the trip time. An empty 'device' watches every
+ *    /dev/input/event* that has the key and is readable (the input group).
+ *  - Windows: a global hotkey registered on the service thread.
+ * trip() is the same path for everything else (the toolbar button).
+ *
+ * The command thread measures trip to stop frames written;
+ * JointCommandLoop::jitter().stopLatencyUs reports it.
+ */
+class EStopService
+{
+public:
+#ifdef _WIN32
+    static constexpr int kDefaultKey = 0x13;   ///< VK_PAUSE
+#else
+    static constexpr int kDefaultKey = 119;    ///< KEY_PAUSE
+#endif
+
+    struct Settings {
+        std::string device;              ///< evdev path; empty for every device with 'key'
+        int key = kDefaultKey;           ///< evdev key code on Linux, virtual key on Windows
+        bool realtime = true;            ///< SCHED_FIFO / TIME_CRITICAL, where permitted
+        int realtimePriority = 90;       ///< above the command loop's default
+    };
+
+    explicit EStopService(JointCommandLoop& loop) : m_loop(loop) {}
+    ~EStopService() { stop(); }
+
+    EStopService(const EStopService&) = delete;
+    EStopService& operator=(const EStopService&) = delete;
+
+    // (Re)starts the input thread. Returns false if no input could be
+    // opened; trip() works either way.
+    bool start(const Settings& settings);
+    bool start() { return start(Settings{}); }
+    void stop();
+    bool watching() const { return m_thread.joinable(); }
+
+    // Any thread.
+    void trip(std::chrono::steady_clock::time_point at = std::chrono::steady_clock::now());
+
+private:
+    void run();
+
+    JointCommandLoop& m_loop;
+    Settings m_settings;
+    std::atomic<bool> m_running{ false };
+    std::thread m_thread;
+#ifdef _WIN32
+    std::atomic<unsigned long> m_threadId{ 0 };   ///< for WM_QUIT
+#else
+    struct Input {
+        int fd = -1;
+        bool monotonic = false;                   ///< event times are steady_clock's
+    };
+    std::vector<Input> m_inputs;
+    int m_wakeFds[2] = { -1, -1 };                ///< pipe: written by stop()
+#endif
+};
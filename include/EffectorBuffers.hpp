@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <entt/fwd.hpp>
+#include <qopengl.h>
+#include "GpuResources.hpp"
+
+class QOpenGLFunctions_4_3_Core;
+class PointCloudGrid;
+
+/**
+ * @class EffectorBuffers
+ * @brief GPU copies of every field effector, shared by the field compute shaders.
+ *
+ * Point (incl. spline proxies), directional and triangle effectors each live
+ * in an std430 SSBO laid out as { uvec4 header; T items[]; } with the item
+ * count in header.x, so there is no fixed cap. The registry is gathered every
+ * frame but a stream is uploaded only when its contents actually changed;
+ * mesh effectors are re-triangulated only when their mesh, transform or
+ * settings change. Triangles are accompanied by a flattened BVH (see
+ * TriangleBvh) so the shaders visit only the triangles near each sample.
+ * Point-cloud effectors upload their PointCloudGrid (bucket starts and
+ * points, concatenated across clouds) only when the set of grids changes;
+ * their per-cloud records, which carry the transform, are cheap to resend.
+ *
+ * Each stream rotates through three buffers. A buffer is rewritten with an
+ * unsynchronized map once the fence placed on its last use has passed; if
+ * the GPU still reads it, its storage is orphaned instead of waited for,
+ * so uploads never stall on frames still in flight.
+ */
+class EffectorBuffers
+{
+public:
+    static constexpr int kRingSize = 3;
+
+    void setFunctions(QOpenGLFunctions_4_3_Core* gl) { m_gl = gl; }
+
+    // Gathers effectors and uploads changed streams. Returns true if
+    // anything changed since the previous call.
+    bool update(entt::registry& registry);
+
+    // Binds the current buffers at kPointEffectorBinding, kDirectionalEffectorBinding,
+    // kTriangleEffectorBinding, kTriangleBvhBinding and the kPointCloud* bindings.
+    void bind() const;
+
+    // Fences the current buffers; call after the last dispatch that reads them.
+    void fenceInFlight();
+
+    void destroy();
+
+    /// Bumped on every upload; lets caches keyed on the field detect staleness.
+    std::uint64_t version() const { return m_version; }
+
+    std::size_t pointCount() const { return m_points.size(); }
+    std::size_t directionalCount() const { return m_directionals.size(); }
+    std::size_t triangleCount() const { return m_triangles.size(); }
+    std::size_t bvhNodeCount() const { return m_bvhNodes.size(); }
+    std::size_t pointCloudCount() const { return m_clouds.size(); }
+    std::size_t pointCloudPointCount() const { return m_cloudPoints.size(); }
+    const std::vector<TriangleGpu>& triangles() const { return m_triangles; }
+
+private:
+    struct Stream {
+        GLuint     buffers[kRingSize] = {};
+        GLsync     fences[kRingSize] = {};
+        GLsizeiptr capacity[kRingSize] = {};
+        int        current = -1;   ///< -1 until the first upload
+    };
+
+    struct MeshEffectorCache {
+        std::uint64_t transformVersion = 0;   ///< TransformComponent::version() the triangles were built from
+        float       strength = 0.0f;
+        float       distance = 0.0f;
+        std::size_t meshKey = 0;              ///< MeshCache::keyOf the mesh they were built from
+        std::vector<TriangleGpu> triangles;
+        bool        seen = false;
+    };
+
+    void upload(Stream& stream, const void* items, std::size_t count, std::size_t itemSize);
+    void destroyStream(Stream& stream);
+
+    QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+
+    Stream m_pointStream;
+    Stream m_directionalStream;
+    Stream m_triangleStream;
+    Stream m_bvhStream;
+    Stream m_cloudStream;
+    Stream m_cloudBucketStream;
+    Stream m_cloudPointStream;
+
+    std::vector<PointEffectorGpu>       m_points, m_pointScratch;
+    std::vector<DirectionalEffectorGpu> m_directionals, m_directionalScratch;
+    std::vector<TriangleGpu>            m_triangles;   ///< in BVH leaf order
+    std::vector<BvhNodeGpu>             m_bvhNodes;
+    std::unordered_map<entt::entity, MeshEffectorCache> m_meshCache;
+    std::vector<PointCloudEffectorGpu>  m_clouds, m_cloudScratch;
+    std::vector<std::shared_ptr<const PointCloudGrid>> m_cloudGrids, m_cloudGridScratch;
+    std::vector<std::uint32_t>          m_cloudBuckets;
+    std::vector<glm::vec4>              m_cloudPoints;
+
+    std::uint64_t m_version = 0;
+};
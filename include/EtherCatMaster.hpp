@@ -0,0 +1,116 @@
+#pragma once
+
+#include "JointCommandLoop.hpp"
+#include "SpscRing.hpp"
+#include "TelemetryHub.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @class EtherCatMaster
+ * @brief CommunicationProtocol::ETHERCAT backend on SOEM: CiA 402 drives in
+ *        cyclic synchronous position, velocity or torque mode.
+ *
+ * install() registers a CommandWriter with the JointCommandLoop and a
+ * TelemetryReader with the TelemetryHub, both on one master. The cyclic task
+ * is the command loop's own thread: each write() packs the commands straight
+ * into the drives' RxPDOs in SOEM's process image, exchanges one frame and
+ * decodes the TxPDOs of that same frame into JointSamples for the reader. So
+ * the cycle runs at the loop's rate (1-4 kHz), real-time priority and CPU pin,
+ * and the only copies are in and out of the NIC frame. With distributed clocks
+ * on, SYNC0 fires every loop period and deadlineCorrection() locks the loop's
+ * phase to the reference clock.
+ *
+ * HardwareInterface::controller_id is the drive's position on the bus
+ * (1-based). Each drive gets the fixed mapping of Rx and Tx below at
+ * PRE-OP -> SAFE-OP. A frame that times out or comes back with a short
+ * working counter counts in Stats::missedFrames and its inputs are dropped.
+ * Assumes a little-endian host, like the wire format.
+ */
+class EtherCatMaster
+{
+public:
+    struct Settings {
+        std::string interfaceName = "eth0";
+        double countsPerUnit = 131072.0 / 6.283185307179586;   ///< encoder counts per radian (or metre)
+        double ratedTorqueNm = 1.0;      ///< 0x6071/0x6077 are per mille of this
+        bool distributedClocks = true;
+        std::chrono::microseconds syncShift{ 50 };   ///< SYNC0 this long after the cycle starts
+    };
+
+    // Any thread; from atomics the cycle updates.
+    struct Stats {
+        int slaves = 0;
+        bool operational = false;
+        std::uint64_t cycles = 0;
+        std::uint64_t missedFrames = 0;
+        int lastWkc = 0, expectedWkc = 0;
+        double dcErrorUs = 0.0;          ///< reference clock against the SYNC0 phase, last cycle
+    };
+
+#pragma pack(push, 1)
+    struct Rx {                          ///< 0x1600
+        std::uint16_t controlword;       ///< 0x6040
+        std::int8_t   mode;              ///< 0x6060
+        std::int32_t  targetPosition;    ///< 0x607A
+        std::int32_t  targetVelocity;    ///< 0x60FF
+        std::int16_t  targetTorque;      ///< 0x6071
+    };
+    struct Tx {                          ///< 0x1A00
+        std::uint16_t statusword;        ///< 0x6041
+        std::int8_t   mode;              ///< 0x6061
+        std::int32_t  position;          ///< 0x6064
+        std::int32_t  velocity;          ///< 0x606C
+        std::int16_t  torque;            ///< 0x6077
+    };
+#pragma pack(pop)
+
+    static std::shared_ptr<EtherCatMaster> install(JointCommandLoop& loop, TelemetryHub& hub, const Settings& settings);
+
+    explicit EtherCatMaster(JointCommandLoop& loop, const Settings& settings) : m_loop(loop), m_settings(settings) {}
+    ~EtherCatMaster() { close(); }
+
+    EtherCatMaster(const EtherCatMaster&) = delete;
+    EtherCatMaster& operator=(const EtherCatMaster&) = delete;
+
+    Stats stats() const;
+
+private:
+    class Writer;
+    class Reader;
+
+    struct Drive {
+        int slave = 0;
+        std::uint16_t lastControlword = 0;
+    };
+
+    // Command thread (open/close on the GUI thread, before and after it runs).
+    bool open(const std::vector<int>& slaves);
+    void close();
+    void exchange(const JointCommand* commands, std::size_t count);
+    std::chrono::nanoseconds dcCorrection();
+
+    JointCommandLoop& m_loop;
+    Settings m_settings;
+    bool m_open = false;
+    std::vector<Drive> m_drives;                 ///< parallel to the writer's endpoints
+    std::vector<std::uint8_t> m_image;           ///< SOEM's IOmap
+    std::int64_t m_cycleNs = 1000000;
+    std::int64_t m_dcIntegral = 0;
+    std::int64_t m_correctionNs = 0;
+
+    // Decoded inputs, channel = bus position; the reader renumbers them.
+    SpscRing<JointSample, 16384> m_samples;
+    std::atomic<bool> m_readerAttached{ false };
+
+    std::atomic<int> m_slaves{ 0 };
+    std::atomic<bool> m_operational{ false };
+    std::atomic<std::uint64_t> m_cycles{ 0 }, m_missed{ 0 };
+    std::atomic<int> m_lastWkc{ 0 }, m_expectedWkc{ 0 };
+    std::atomic<std::int64_t> m_dcErrorNs{ 0 };
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QtGlobal>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class QMessageLogContext;
+class QString;
+
+/**
+ * @brief Asynchronous binary log behind the Qt message handler.
+ *
+ * message() is the handler's body. It copies the record (time, level,
+ * thread, category and call-site ids, and the text as UTF-16) into a ring
+ * owned by the calling thread: no lock, no conversion, no system call, so a
+ * qDebug() on the render thread costs a memcpy. A category or call site seen
+ * for the first time by a thread is interned once under a lock; the thread
+ * caches its id after that. A full ring drops the record and counts it.
+ *
+ * A writer thread drains every ring a few times a second, or at once for
+ * critical and fatal messages, into kFileName in the log directory, and
+ * echoes warnings and worse (everything with KR_LOG_STDERR=1) to stderr.
+ * Past kMaxFileBytes the file rotates to events.1.krlog ... and kKeepFiles
+ * are kept. Before start() and after stop() messages go straight to stderr
+ * as they always did.
+ *
+ * File layout, little-endian: a FileHeader, then records, each a
+ * RecordHeader and 'size' - sizeof(RecordHeader) payload bytes. A Definition
+ * record names a category or call-site id (UTF-8) and comes before the
+ * first message that uses it; each rotated file repeats the ones so far.
+ * EventLogPanel reads the file through a memory mapping.
+ */
+namespace EventLog
+{
+    constexpr const char* kFileName = "events.krlog";
+    constexpr std::size_t kRingBytes = std::size_t(1) << 18;       ///< per thread, on its first message
+    constexpr std::int64_t kMaxFileBytes = std::int64_t(64) << 20;
+    constexpr int kKeepFiles = 4;                                   ///< the current file and three rotated ones
+    constexpr int kMaxMessageChars = 8192;                          ///< UTF-16 units; longer texts are cut
+
+    enum class Kind : std::uint8_t { Message = 0, Definition = 1 };
+    enum class Defines : std::uint8_t { Category = 0, Site = 1 };
+
+#pragma pack(push, 1)
+    struct FileHeader {
+        char magic[8];                  ///< "KRLOG\0\1\0"
+        std::int64_t epochMs;           ///< wall clock (ms since 1970) at timestampNs 0
+    };
+
+    struct RecordHeader {
+        std::uint32_t size;             ///< header and payload
+        Kind kind;
+        std::uint8_t level;             ///< QtMsgType for messages, Defines for definitions
+        std::uint16_t thread;           ///< in order of each thread's first message
+        std::uint32_t category;         ///< for definitions, the id being defined
+        std::uint32_t site;
+        std::int64_t timestampNs;       ///< steady clock since start-up
+    };
+#pragma pack(pop)
+    static_assert(sizeof(FileHeader) == 16 && sizeof(RecordHeader) == 24, "log layout");
+
+    constexpr char kMagic[8] = { 'K', 'R', 'L', 'O', 'G', 0, 1, 0 };
+
+    // Starts a new 'directory'/kFileName, rotating the previous run's file
+    // away, and starts the writer.
+    bool start(const QString& directory, std::string* error = nullptr);
+    // Writes what is queued and joins the writer.
+    void stop();
+    bool running();
+    // Returns once everything logged before the call is in the file.
+    void flush();
+    QString currentPath();
+    std::uint64_t droppedRecords();
+
+    void message(QtMsgType type, const QMessageLogContext& context, const QString& text);
+}
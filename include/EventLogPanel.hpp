@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QWidget>
+
+class QCheckBox;
+class QLabel;
+class QTableView;
+class QTimer;
+class EventLogModel;
+
+/**
+ * Event log viewer: the current EventLog file, one row per message. The
+ * file is memory-mapped and indexed by record offset only; the model
+ * decodes a record's time, level, category and text in data(), for the
+ * rows being painted, so a log of millions of messages opens and scrolls
+ * at the cost of the rows on screen. While shown it picks up what the
+ * writer appended kRefreshHz times a second.
+ */
+class EventLogPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kRefreshHz = 4;
+
+    explicit EventLogPanel(QWidget* parent = nullptr);
+    ~EventLogPanel() override;
+
+protected:
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+
+private:
+    void refresh();
+
+    EventLogModel* m_model;
+    QTableView* m_view;
+    QLabel* m_status;
+    QCheckBox* m_follow;
+    QTimer* m_refreshTimer;
+};
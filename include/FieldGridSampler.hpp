@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <glm/glm.hpp>
+
+struct FieldSnapshot;
+class ThreadPool;
+
+// Regular grid over an AABB. Samples sit on the grid vertices, so both
+// faces of the box are included; an axis with resolution 1 samples its centre.
+struct FieldGrid {
+    glm::vec3  boundsMin{ -1.0f };
+    glm::vec3  boundsMax{ 1.0f };
+    glm::ivec3 resolution{ 32 };
+
+    std::size_t sampleCount() const {
+        return std::size_t(resolution.x) * std::size_t(resolution.y) * std::size_t(resolution.z);
+    }
+    glm::vec3 samplePosition(int x, int y, int z) const;
+};
+
+// Evaluates a FieldSnapshot on every grid vertex across a ThreadPool.
+namespace FieldGridSampler
+{
+    // (samples done, samples total). Called on the calling thread only.
+    using ProgressFn = std::function<void(std::size_t, std::size_t)>;
+    // Polled on the calling thread; returning true stops the run.
+    using CancelFn = std::function<bool()>;
+
+    // Samples per task; a few x-rows so tasks are large enough to amortise
+    // scheduling but numerous enough for stealing to balance the load.
+    constexpr std::size_t kChunkSamples = 4096;
+
+    // Writes the field vector for each sample into 'out', laid out x-fastest
+    // (index = x + res.x * (y + res.y * z)). 'out' must hold grid.sampleCount()
+    // vectors. Blocks until done; returns false if cancelled, in which case
+    // the contents of 'out' are partial.
+    bool sample(const FieldSnapshot& snapshot, const FieldGrid& grid, glm::vec3* out,
+        ThreadPool& pool, const ProgressFn& progress = {}, const CancelFn& cancelled = {});
+}
@@ -1,16 +1,98 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
 #include <glm/glm.hpp>
 #include <entt/fwd.hpp>
 
+class PointCloudGrid;
+class DistanceField;
+
+// Flat copy of every field source, taken once and reused for many samples.
+// Stored as structure-of-arrays so FieldSolver::evaluateBatch can run each
+// effector against several sample points at a time.
+struct FieldSnapshot {
+    glm::vec3 directional{ 0.0f };   ///< all directional effectors summed (position independent)
+
+    // Point effectors. Falloff is folded into k = c0 + c1 * d + c2 / d, pre-scaled by strength.
+    std::vector<float> pointX, pointY, pointZ, pointRadiusSq;
+    std::vector<float> pointC0, pointC1, pointC2;
+
+    // Spline effectors: segments [splineSegFirst[i], splineSegFirst[i] + splineSegCount[i]).
+    std::vector<float> segAX, segAY, segAZ, segDX, segDY, segDZ, segInvLenSq;
+    std::vector<std::uint32_t> splineSegFirst, splineSegCount;
+    std::vector<float> splineRadiusSq, splineStrength;
+    std::vector<std::uint32_t> segSpline;   ///< owning spline of each segment
+
+    // Mesh effectors: world-space triangles (3 vertices each), grouped per mesh.
+    std::vector<glm::vec3> triangles;
+    std::vector<std::uint32_t> meshTriFirst, meshTriCount;
+    std::vector<float> meshDistance, meshStrength;
+
+    // Mesh effectors whose DistanceField is ready: one lookup per sample
+    // instead of a walk over the triangles. Each field is in its mesh's space.
+    std::vector<std::shared_ptr<const DistanceField>> meshFields;
+    std::vector<glm::mat4> meshFieldWorldToLocal;
+    std::vector<float> meshFieldScale, meshFieldDistance, meshFieldStrength;
+
+    // Point-cloud effectors: each grid is in its cloud's space.
+    std::vector<std::shared_ptr<const PointCloudGrid>> cloudGrids;
+    std::vector<glm::mat4> cloudWorldToLocal;
+    std::vector<float> cloudStrength;
+
+    // Uniform spatial hash over point and spline-segment influence volumes
+    // (AABB inflated by the radius). Entries are point indices, or segment
+    // indices with kSegmentBit set. Hash collisions only add candidates; the
+    // exact radius test still runs. Built by FieldSolver::snapshot, so it is
+    // rebuilt whenever a fresh snapshot is taken after effectors move.
+    struct EffectorHash {
+        static constexpr std::uint32_t kSegmentBit = 0x80000000u;
+        float cellSize = 0.0f;                   ///< 0 when the hash is not built
+        std::uint32_t bucketMask = 0;
+        std::vector<std::uint32_t> bucketStart;  ///< CSR offsets, bucketMask + 2 entries
+        std::vector<std::uint32_t> entries;
+        std::vector<std::uint32_t> unbounded;    ///< too large to bin, always visited
+        bool enabled() const { return cellSize > 0.0f; }
+    } hash;
+
+    std::size_t pointCount() const { return pointX.size(); }
+    std::size_t splineCount() const { return splineSegFirst.size(); }
+    std::size_t meshCount() const { return meshTriFirst.size(); }
+    std::size_t meshFieldCount() const { return meshFields.size(); }
+    std::size_t cloudCount() const { return cloudGrids.size(); }
+};
+
+// Everything FieldSolver knows about one point, from a single pass over the sources.
+struct FieldSample {
+    float     potential = 0.0f;        ///< sum of -strength / d^2 over point effectors
+    glm::vec3 vector{ 0.0f };          ///< same as getVectorAt
+    glm::vec3 gradient{ 0.0f };        ///< same as getPotentialGradientAt (the negated gradient)
+};
+
 class FieldSolver {
 public:
+    // Potential, vector and potential gradient in one walk of the registry.
+    // The gradient is analytic, so it has no finite-difference epsilon noise.
+    FieldSample evaluate(entt::registry& registry, glm::vec3 worldPos, const std::vector<entt::entity>& sources = {});
+
     // Calculates the total scalar potential at a point from all sources.
     float getPotentialAt(entt::registry& registry, glm::vec3 worldPos, const std::vector<entt::entity>& sources = {});
 
     // Calculates the total vector at a point from all sources.
     glm::vec3 getVectorAt(entt::registry& registry, glm::vec3 worldPos, const std::vector<entt::entity>& sources = {});
 
-    // Calculates the gradient of the potential field at a point using finite differences.
+    // Negated gradient of the potential field at a point (the force it implies).
     glm::vec3 getPotentialGradientAt(entt::registry& registry, glm::vec3 worldPos, const std::vector<entt::entity>& sources = {});
-    
-};
\ No newline at end of file
+
+    // --- Batched evaluation ---
+    // Captures all FieldSourceTag entities (optionally filtered by 'sources').
+    // Take one snapshot, then evaluate as many points as needed against it.
+    static FieldSnapshot snapshot(entt::registry& registry, const std::vector<entt::entity>& sources = {});
+
+    // Same result as getVectorAt for each of the 'count' points, written to 'out'.
+    // Points are processed kBatchLanes at a time in branch-free loops the
+    // compiler can vectorize (AVX2 / NEON width).
+    static constexpr std::size_t kBatchLanes = 8;
+    static void evaluateBatch(const FieldSnapshot& snapshot, const glm::vec3* points, glm::vec3* out, std::size_t count);
+};
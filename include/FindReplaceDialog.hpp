@@ -0,0 +1,49 @@
+#pragma once
+
+#include "NameIndex.hpp"
+
+#include <QDialog>
+#include <vector>
+#include <entt/entity/entity.hpp>
+
+class QLabel;
+class QLineEdit;
+class QListWidget;
+class QPushButton;
+class Scene;
+
+/**
+ * Non-modal find and replace over entity names (TagComponent), served by
+ * the scene's NameIndex. Each keystroke restarts the search and lists the
+ * first kPageSize matches; "Show more" fetches the next page from where
+ * the last one stopped. Replace All rewrites every match as one undo step.
+ */
+class FindReplaceDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kPageSize = 200;
+
+    explicit FindReplaceDialog(Scene* scene, QWidget* parent = nullptr);
+
+signals:
+    // A result was double-clicked or chosen with Enter.
+    void entityActivated(entt::entity entity);
+    void namesChanged();
+
+private:
+    void search();
+    void showMore();
+    void replaceAll();
+
+    Scene* m_scene;
+    QLineEdit* m_find;
+    QLineEdit* m_replace;
+    QListWidget* m_results;
+    QLabel* m_status;
+    QPushButton* m_more;
+    QPushButton* m_replaceAll;
+    NameIndex::Cursor m_cursor;
+    std::vector<entt::entity> m_page;   ///< scratch for one find()
+};
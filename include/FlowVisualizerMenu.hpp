@@ -35,6 +35,7 @@ public:
 
     // --- PUBLIC GETTERS FOR MAINWINDOW ---
     bool isMasterVisible() const;
+    bool isTemporal() const;
     glm::vec3 getFieldPosition() const;
     glm::vec3 getFieldOrientation() const;
     AABB getBounds() const;
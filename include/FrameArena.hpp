@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+/*------------------------------------------------------------------
+ *  FrameArena – scratch memory that lives for one master tick
+ *
+ *  FrameVector<entt::entity> stale(&FrameArena::local());
+ *
+ *  Every thread has its own arena: a bump pointer in one block, so an
+ *  allocation is an add and a free is nothing. MainWindow calls
+ *  nextFrame() at the start of each tick, and a thread's arena
+ *  rewinds on its first use after that. A tick that runs past the
+ *  block takes overflow blocks from the heap; the next rewind swaps
+ *  them for one block large enough for the whole tick, so once the
+ *  scene settles the arenas stop allocating.
+ *
+ *  Only code running inside a tick (scheduler systems and what they
+ *  call) may use it. Nothing from it may outlive the tick, and a
+ *  container must only grow on the thread that created it.
+ *-----------------------------------------------------------------*/
+class FrameArena final : public std::pmr::memory_resource
+{
+public:
+    // The calling thread's arena, rewound if a tick began since its last use.
+    static FrameArena& local();
+    // Starts a tick; GUI thread, before the tick systems run.
+    static void nextFrame();
+
+    std::size_t used() const { return m_used + m_overflowBytes; }
+    std::size_t capacity() const { return m_capacity; }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+private:
+    FrameArena() = default;
+
+    void rewind();
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    static constexpr std::size_t kInitialBytes = std::size_t(64) << 10;
+
+    std::unique_ptr<std::byte[]> m_block;
+    std::size_t m_capacity = 0;
+    std::size_t m_used = 0;
+    std::vector<std::unique_ptr<std::byte[]>> m_overflow;   ///< this tick's spill, folded in by rewind()
+    std::size_t m_overflowBytes = 0;
+    std::uint64_t m_frame = 0;
+};
+
+template <class T>
+using FrameVector = std::pmr::vector<T>;
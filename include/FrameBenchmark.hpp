@@ -0,0 +1,121 @@
+#pragma once
+
+#include "PerfGate.hpp"
+
+#include <QString>
+#include <glm/glm.hpp>
+
+#include <entt/fwd.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Scene;
+
+/**
+ * @class FrameBenchmark
+ * @brief Renders a fixed, seeded scene headless along a camera path and
+ *        reports per-pass GPU and CPU frame time percentiles.
+ *
+ * The scene is N robots on a grid, M closed Catmull-Rom splines, V pairs of
+ * an arrow visualizer of K^3 arrows and a flow visualizer of P particles,
+ * driven by the same effectors as the default scene plus E more that cycle
+ * through point, spline, mesh and directional. Robot joints sweep on fixed
+ * sinusoids and the simulation steps at a fixed 1/60 s, so two runs with the
+ * same Config draw the same frames on any machine; only the timings differ.
+ *
+ * Frames go through OffscreenRenderer without readback and with dynamic
+ * resolution off. Timings are the GpuProfiler's raw per-frame queries (not
+ * its smoothed values) of the measured frames, after 'warmupFrames' that
+ * let shaders, caches and the flow simulation settle.
+ *
+ * The report is JSON: the GL vendor, renderer and version, the Config, and
+ * p50/p95/p99/mean/max of the frame's summed GPU time, summed CPU time,
+ * wall time per frame and each pass, and the scene's entity, triangle and
+ * effector counts, plus the raw samples behind every percentile.
+ * compareWithBaseline() gates one report against a stored baseline with
+ * PerfGate, timing by timing: the frame totals and each pass. runSweep() measures the same scene at
+ * several values of one parameter and reports how each pass scales.
+ *
+ * populateScene() is also the stress-scene generator for the editor
+ * (--stress-scene), so a scaling problem seen in a curve can be opened and
+ * profiled interactively.
+ *
+ * GUI thread; needs a GL 4.3 context (QT_QPA_PLATFORM=offscreen works).
+ */
+class FrameBenchmark
+{
+public:
+    struct CameraKey {
+        float time = 0.0f;                   ///< seconds from the start of the path
+        glm::vec3 position{ 0.0f };
+        glm::vec3 target{ 0.0f };
+    };
+
+    struct Config {
+        int robots = 4;
+        int splines = 16;
+        int arrowDensity = 16;               ///< arrows per axis
+        int particles = 20000;
+        int visualizers = 1;                 ///< arrow + flow pairs, side by side along x
+        int effectors = 0;                   ///< on top of the three default ones
+        int frames = 600;
+        int warmupFrames = 60;
+        int width = 1920, height = 1080;
+        std::uint32_t seed = 1;
+        QString robotFile = QStringLiteral("simple_arm.urdf");
+        QString cameraPath;                  ///< JSON key list; empty = built-in orbit
+    };
+
+    struct SceneStats {
+        std::size_t entities = 0;
+        std::size_t triangles = 0;
+        std::size_t effectors = 0;           ///< FieldSourceTag entities
+    };
+
+    // Builds the scene into 'scene': fog, a grid, then populateScene(). False
+    // if the robot file cannot be used while robots were requested.
+    static bool buildScene(Scene& scene, const Config& config);
+    // Adds the robots, splines, visualizers and effectors of 'config' to an
+    // existing scene. Same seed, same entities.
+    static bool populateScene(Scene& scene, const Config& config);
+    static SceneStats sceneStats(const entt::registry& registry);
+
+    // Sets the Config field named 'key' (robots, splines, arrows, particles,
+    // visualizers, effectors, seed) from 'value'. False for an unknown key.
+    static bool setParameter(Config& config, const QString& key, int value);
+    // "robots=16,effectors=40" through setParameter(). False on a bad item.
+    static bool parseParameters(Config& config, const QString& list);
+
+    // Reads {"keys": [{"time", "position": [x,y,z], "target": [x,y,z]}, ...]},
+    // sorted by time. Empty on error.
+    static std::vector<CameraKey> loadCameraPath(const QString& path);
+    // Two laps around the scene at changing height and distance, 20 s.
+    static std::vector<CameraKey> defaultCameraPath();
+    // Catmull-Rom through the keys' positions and targets, clamped at the ends.
+    static CameraKey sampleCameraPath(const std::vector<CameraKey>& keys, float time);
+
+    // Runs the benchmark and writes the report. False if rendering could not
+    // start or the report could not be written.
+    static bool run(const Config& config, const QString& reportPath);
+    // Runs once per value of 'parameter' and writes one report with every
+    // run's scene counts and timings, plus each pass's scaling exponent:
+    // log(p95 ratio) / log(value ratio) from the first run to the last, so
+    // 1 is linear and a pass that stops scaling stands out above it.
+    static bool runSweep(const Config& config, const QString& parameter, const std::vector<int>& values,
+        const QString& reportPath);
+
+    // Compares every sampled timing of 'reportPath' (frame GPU, CPU and wall
+    // time, each pass's GPU and CPU time) with 'baselinePath' and writes
+    // PerfGate's verdict to 'verdictPath' if given. False on a regression or
+    // if a report cannot be read.
+    static bool compareWithBaseline(const QString& reportPath, const QString& baselinePath,
+        const PerfGate::Thresholds& thresholds, const QString& verdictPath);
+    // PerfGate::machineKey() of the host and the report's GL renderer.
+    static QString machineKey(const QJsonObject& report);
+
+private:
+    // One run's report, or an empty object if it could not run.
+    static QJsonObject measure(const Config& config);
+};
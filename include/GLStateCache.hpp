@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <qopengl.h>
+
+class QOpenGLFunctions_4_3_Core;
+class Shader;
+
+/**
+ * @class GLStateCache
+ * @brief Shadows the GL state the render passes toggle most, so redundant
+ *        calls are skipped and save/restore is a struct copy instead of glGet.
+ *
+ * Tracks blend, depth, cull and stencil enables, the depth mask and blend
+ * function, and the program, VAO and draw-framebuffer bindings. Values start
+ * out unknown; invalidate() returns to that state and must be called whenever
+ * a different context becomes current or code outside the cache has touched
+ * GL (RenderingSystem does so at the top of every renderView).
+ */
+class GLStateCache
+{
+public:
+    static constexpr GLuint kUnknownName = ~0u;
+    static constexpr GLenum kUnknownEnum = ~0u;
+
+    struct State {
+        std::int8_t blend = -1;        ///< -1 unknown, 0 off, 1 on
+        std::int8_t depthTest = -1;
+        std::int8_t depthMask = -1;
+        std::int8_t cullFace = -1;
+        std::int8_t stencilTest = -1;
+        GLenum blendSrcRGB = kUnknownEnum, blendDstRGB = kUnknownEnum;
+        GLenum blendSrcAlpha = kUnknownEnum, blendDstAlpha = kUnknownEnum;
+        GLuint program = kUnknownName;
+        GLuint vertexArray = kUnknownName;
+        GLuint drawFramebuffer = kUnknownName;
+    };
+
+    explicit GLStateCache(QOpenGLFunctions_4_3_Core* gl = nullptr) : m_gl(gl) {}
+    void setFunctions(QOpenGLFunctions_4_3_Core* gl) { m_gl = gl; }
+
+    void invalidate() { m_state = State{}; }
+    // Deleting a bound VAO or FBO silently rebinds 0 and the name may be
+    // handed out again, so call this after glDelete* on either.
+    void invalidateBindings()
+    {
+        m_state.vertexArray = kUnknownName;
+        m_state.drawFramebuffer = kUnknownName;
+    }
+
+    void setBlend(bool on);
+    void setDepthTest(bool on);
+    void setDepthMask(bool on);
+    void setCullFace(bool on);
+    void setStencilTest(bool on);
+    void setBlendFunc(GLenum src, GLenum dst) { setBlendFuncSeparate(src, dst, src, dst); }
+    void setBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+
+    void use(const Shader& shader);
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void bindFramebuffer(GLuint fbo); ///< GL_FRAMEBUFFER, i.e. draw and read
+
+    State snapshot() const { return m_state; }
+    // Re-applies every field that was known when 'saved' was taken.
+    void restore(const State& saved);
+
+private:
+    void toggle(std::int8_t& cached, bool on, GLenum cap);
+
+    QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+    State m_state;
+};
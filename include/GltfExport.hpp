@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <entt/fwd.hpp>
+
+/**
+ * @brief Exports the scene as one binary glTF 2.0 file (.glb), for viewers
+ *        outside the editor.
+ *
+ * Split like a scene load, the other way round: gather() walks the
+ * registry once on the GUI thread and keeps only node records and the
+ * shared MeshData handles, so the export sees a consistent scene; write()
+ * then runs on any thread but a pool worker.
+ *
+ * Every TransformComponent entity becomes a node, parented as
+ * ParentComponent says, named from its TagComponent. Meshes on the Visual
+ * layer are written once per distinct MeshData (the MeshCache already
+ * collapses equal content onto one handle) and drawn by every node holding
+ * it; each distinct material becomes one glTF material (base colour,
+ * metallic, roughness, emissive; texture maps are not exported). LODs and
+ * clusters are not written: they are the editor's own.
+ *
+ * Every offset in the file follows from vertex and index counts, so the
+ * JSON goes out first and the binary chunk is streamed after it: meshes
+ * are encoded on ThreadPool::shared(), a bounded number ahead of the one
+ * being written, and appended in order. Memory stays at those few encoded
+ * meshes, not the file. With 'quantize' positions are stored as 16-bit
+ * and normals as 8-bit normalized integers (KHR_mesh_quantization), 20
+ * bytes a vertex instead of 32; each instance then gets a child node
+ * holding the uniform scale and offset that decode them.
+ */
+namespace GltfExport
+{
+    struct Options {
+        bool quantize = false;
+    };
+
+    // A gathered scene, ready for write(). Opaque.
+    struct Plan;
+
+    std::shared_ptr<const Plan> gather(const entt::registry& registry, const Options& options = {});
+
+    // Writes the plan to 'path'. False with 'error' set if it cannot be
+    // written; the file is only replaced on success.
+    bool write(const Plan& plan, const std::string& path, std::string* error = nullptr);
+
+    std::size_t meshCount(const Plan& plan);
+    std::size_t nodeCount(const Plan& plan);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * @class GlyphAtlas
+ * @brief Signed distance field atlas of the printable ASCII glyphs, and the
+ *        cached layout of every string drawn with it.
+ *
+ * Built once, on first use, from the application font: each glyph is
+ * rasterized by Qt at kSupersample times the atlas resolution, and the
+ * exact Euclidean distance to its outline (inside and outside) is sampled
+ * at the centre of every atlas texel and stored as one byte, 0.5 on the
+ * edge and kSpread texels of distance across the rest of the range. Any
+ * label size then reads the same texels and resolves a sharp edge with a
+ * screen-space derivative. Characters outside the set draw as '?'.
+ *
+ * Positions are in ems (the font's ascent plus descent), y up, the pen
+ * starting at the origin on the baseline. No GL calls: the renderer
+ * uploads texels() once per context group. GUI thread only.
+ */
+class GlyphAtlas
+{
+public:
+    static constexpr int kFirstChar = 32;
+    static constexpr int kCharCount = 95;          ///< ' ' to '~'
+    static constexpr int kEmTexels = 32;           ///< atlas texels per em
+    static constexpr int kSpread = 4;              ///< texels of distance either side of the edge
+    static constexpr int kSupersample = 4;
+
+    struct Glyph {
+        glm::vec4 rect{ 0.0f };                    ///< x0, y0, x1, y1 from the pen, ems, kSpread included
+        glm::vec4 uv{ 0.0f };                      ///< u0, v0, u1, v1 of the same rect
+        float advance = 0.0f;                      ///< ems
+    };
+
+    struct Quad {
+        glm::vec4 rect;                            ///< from the string's origin, ems
+        glm::vec4 uv;
+    };
+
+    // One string, laid out on a single line and centred on its origin
+    // horizontally. Shared: hold on to it for as long as it is drawn.
+    struct Layout {
+        std::vector<Quad> quads;                   ///< one per visible glyph (spaces have none)
+        float width = 0.0f;                        ///< ems
+    };
+
+    static GlyphAtlas& instance();
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    const std::vector<std::uint8_t>& texels() const { return m_texels; }   ///< R8, row 0 at v = 0
+
+    // The string's layout, computed once and cached by content.
+    std::shared_ptr<const Layout> layout(const std::string& text);
+
+private:
+    GlyphAtlas();
+    const Glyph& glyph(char c) const;
+
+    int m_width = 0, m_height = 0;
+    std::vector<std::uint8_t> m_texels;
+    Glyph m_glyphs[kCharCount];
+    std::unordered_map<std::string, std::shared_ptr<const Layout>> m_layouts;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <qopengl.h>
+
+class QOpenGLFunctions_4_3_Core;
+
+/*------------------------------------------------------------------
+ *  GpuMemory – what the renderer holds in VRAM, by category
+ *
+ *  Every buffer and texture allocation goes through bufferData() or
+ *  is reported with trackBuffer() / trackTexture(), and every delete
+ *  through deleteBuffers() / deleteTextures(). Sizes are what was
+ *  requested from GL; driver padding and the window system's
+ *  framebuffers are not seen. Objects are keyed by share group and
+ *  name, so an object re-allocated under the same name replaces its
+ *  old size, and separate context groups (offscreen, preview) count
+ *  separately.
+ *
+ *  Budget: with setBudget() above 0, enforceBudget() runs the
+ *  registered evictors in order, each asked to free what is over,
+ *  until usage is back under the budget. Evictors drop caches that
+ *  are rebuilt on demand (pooled render targets, point cloud nodes),
+ *  never data the next frame needs.
+ *
+ *  GUI thread only, with a context of the objects' group current.
+ *-----------------------------------------------------------------*/
+namespace GpuMemory
+{
+    enum class Category : std::uint8_t {
+        Meshes,             ///< mesh arena vertices and indices
+        Materials,          ///< material records and texture arrays
+        Splines,            ///< control points, styles, indirect commands
+        Instances,          ///< batched mesh instances and commands
+        Particles,          ///< flow visualizer ping-pong buffers
+        FieldVisualizers,   ///< arrow sample points and instances, baked fields
+        Effectors,
+        PointClouds,        ///< node pool and per-context draw buffers
+        Sensors,
+        Reconstruction,
+        RenderTargets,      ///< per-viewport FBO attachments and bloom chains
+        Readback,           ///< pixel pack buffers
+        Other,              ///< frame uniforms, grid and primitive geometry
+        Count
+    };
+    constexpr std::size_t kCategoryCount = std::size_t(Category::Count);
+
+    const char* categoryName(Category category);
+
+    // glBufferData on 'buffer', which must be bound to 'target'.
+    void bufferData(QOpenGLFunctions_4_3_Core* gl, GLenum target, GLuint buffer, GLsizeiptr bytes,
+        const void* data, GLenum usage, Category category);
+    // For allocations made by other calls (glBufferStorage, glTex*).
+    void trackBuffer(GLuint buffer, std::size_t bytes, Category category);
+    void trackTexture(GLuint texture, std::size_t bytes, Category category);
+
+    // Forget and delete; the names are left for the caller to clear.
+    void deleteBuffers(QOpenGLFunctions_4_3_Core* gl, GLsizei count, const GLuint* buffers);
+    void deleteTextures(QOpenGLFunctions_4_3_Core* gl, GLsizei count, const GLuint* textures);
+
+    struct Usage {
+        std::array<std::size_t, kCategoryCount> bytes{};
+        std::size_t total = 0;
+        std::size_t peak = 0;       ///< highest total seen
+        std::size_t objects = 0;
+        std::size_t evicted = 0;    ///< bytes freed by evictors so far
+    };
+    Usage usage();
+
+    void setBudget(std::size_t bytes);   ///< 0 = no budget
+    std::size_t budget();
+
+    // Frees what it can of 'over', how far usage exceeds the budget.
+    using Evictor = std::function<void(std::size_t over)>;
+    int addEvictor(Evictor evictor);
+    void removeEvictor(int id);
+    // Cheap when under budget; call between frames.
+    std::size_t enforceBudget();
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "TraceZones.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <qopengl.h>
+
+class QOpenGLFunctions_4_3_Core;
+
+/**
+ * @class GpuProfiler
+ * @brief Per-pass GPU and CPU timings for one context, without stalls.
+ *
+ * Each pass is bracketed by a GL_TIME_ELAPSED query and a steady_clock
+ * timer. Queries rotate through kSlots frames: beginFrame() harvests only
+ * slots whose last query is already available, so results arrive two or
+ * three frames late and the CPU never waits. Query objects are not shared
+ * between contexts, so keep one profiler per viewport.
+ *
+ * Passes must not nest (GL_TIME_ELAPSED queries cannot overlap).
+ * beginFrame() also opens a GL_PRIMITIVES_GENERATED query that endFrame()
+ * closes; its result goes to RenderStats when the frame is harvested.
+ */
+class GpuProfiler
+{
+public:
+    static constexpr int kSlots = 3;
+
+    struct PassTiming {
+        std::string name;
+        double gpuMs = 0.0;   ///< exponentially smoothed
+        double cpuMs = 0.0;
+    };
+
+    /// One completed pass, times in microseconds since nowUs()'s epoch.
+    struct TraceEvent {
+        std::string name;
+        double cpuBeginUs = 0.0, cpuDurUs = 0.0;
+        double gpuDurUs = 0.0;
+        std::uint64_t frame = 0;   ///< beginFrame() calls before the pass's frame
+    };
+
+    void beginFrame(QOpenGLFunctions_4_3_Core* gl);
+    void endFrame(QOpenGLFunctions_4_3_Core* gl);
+    /// Frames begun so far; the one being recorded is frameCount() - 1.
+    std::uint64_t frameCount() const { return m_frameCount; }
+    void begin(QOpenGLFunctions_4_3_Core* gl, const char* name);
+    void end(QOpenGLFunctions_4_3_Core* gl);
+    void destroy(QOpenGLFunctions_4_3_Core* gl);
+
+    const std::vector<PassTiming>& timings() const { return m_timings; }
+    double gpuFrameMs() const;
+    double cpuFrameMs() const;
+    /// Unsmoothed GPU time of the newest harvested frame.
+    double lastGpuFrameMs() const { return m_lastGpuFrameMs; }
+
+    // While capturing, every harvested pass is appended to capturedEvents().
+    void setCapturing(bool on) { m_capturing = on; if (on) m_captured.clear(); }
+    bool capturing() const { return m_capturing; }
+    const std::vector<TraceEvent>& capturedEvents() const { return m_captured; }
+
+    // Brackets each pass with a KHR_debug group of its name, so driver
+    // messages and external GL debuggers see the pass structure.
+    void setDebugGroups(bool on) { m_debugGroups = on; }
+
+    // Microseconds on the clock the trace events use.
+    static double nowUs();
+
+    /// Also a TraceZones zone of the same name, so traces show the pass on
+    /// its thread even while GPU profiling is off.
+    class Scope {
+    public:
+        Scope(GpuProfiler* p, QOpenGLFunctions_4_3_Core* gl, const char* name) :
+#if KR_ZONES_ENABLED
+            m_zone(name),
+#endif
+            m_p(p), m_gl(gl)
+        { if (m_p) m_p->begin(m_gl, name); }
+        ~Scope() { if (m_p) m_p->end(m_gl); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+#if KR_ZONES_ENABLED
+        TraceZones::Zone m_zone;
+#endif
+        GpuProfiler* m_p;
+        QOpenGLFunctions_4_3_Core* m_gl;
+    };
+
+private:
+    struct Pass {
+        const char* name = nullptr;
+        GLuint query = 0;
+        double cpuBeginUs = 0.0, cpuDurUs = 0.0;
+    };
+    struct Slot {
+        std::vector<Pass> passes;
+        std::vector<GLuint> queryPool;  ///< grows to the most passes seen in a frame
+        GLuint primitivesQuery = 0;
+        bool primitivesEnded = false;
+        std::uint64_t frame = 0;
+        bool pending = false;
+    };
+
+    void harvest(QOpenGLFunctions_4_3_Core* gl, Slot& slot);
+    PassTiming& timingFor(const char* name);
+
+    Slot m_slots[kSlots];
+    int  m_head = -1;                   ///< slot being recorded, -1 before the first frame
+    int  m_open = -1;                   ///< index of the pass inside begin()/end()
+    bool m_primitivesOpen = false;
+    std::uint64_t m_frameCount = 0;
+    double m_lastGpuFrameMs = 0.0;
+    std::vector<PassTiming> m_timings;  ///< in first-seen pass order
+    std::vector<TraceEvent> m_captured;
+    bool m_capturing = false;
+    bool m_debugGroups = false;
+    bool m_groupOpen = false;           ///< a group was pushed by the open pass
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <qopengl.h>
+
+class QOpenGLFunctions_4_3_Core;
+
+/**
+ * @class GpuReadbackRing
+ * @brief Non-blocking GPU -> CPU readback with a few frames of latency.
+ *
+ * Each frame the caller copies the bytes it wants to inspect into the next
+ * staging slot (a GPU-side glCopyBufferSubData) and fences it. tryRead()
+ * returns the newest slot whose fence has already signalled and never
+ * waits, so the CPU only ever sees data that is one or two frames old.
+ *
+ * GL 4.3 has no persistent mapping (ARB_buffer_storage is 4.4), so a slot
+ * is mapped read-only only after its fence has passed.
+ */
+class GpuReadbackRing
+{
+public:
+    static constexpr int kSlots = 3;
+
+    // (Re)allocates the staging buffers if 'bytes' grew.
+    void ensure(QOpenGLFunctions_4_3_Core* gl, GLsizeiptr bytes);
+    void destroy(QOpenGLFunctions_4_3_Core* gl);
+
+    // Queues a copy of src[srcOffset, srcOffset + bytes) into the current slot at dstOffset.
+    void copy(QOpenGLFunctions_4_3_Core* gl, GLuint src,
+        GLintptr srcOffset, GLintptr dstOffset, GLsizeiptr bytes);
+
+    // Fences the current slot and advances to the next one. A slot that was
+    // never read is recycled; readback is best-effort by design.
+    void submit(QOpenGLFunctions_4_3_Core* gl);
+
+    // Copies the newest completed slot into 'dst'. Returns false if no slot is ready.
+    bool tryRead(QOpenGLFunctions_4_3_Core* gl, void* dst, GLsizeiptr bytes);
+
+private:
+    struct Slot {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+    };
+
+    Slot       m_slots[kSlots];
+    GLsizeiptr m_capacity = 0;
+    int        m_head = 0;   ///< slot that receives the next copy
+};
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <glm/glm.hpp>
 #include <qopengl.h> // For GLuint
+#include "GpuReadbackRing.hpp"
+
+struct ScalarVolume;
 
 // --- GPU-Aligned Data Structures for Uniform Buffers ---
 
@@ -30,12 +35,400 @@ struct TriangleGpu {
     glm::vec4 normal;
 };
 
+// One node of the mesh-effector BVH (std430, 32 bytes). Leaves have count > 0
+// and reference triangles [leftOrFirst, leftOrFirst + count); inner nodes
+// have count == 0 and their children at leftOrFirst and leftOrFirst + 1.
+struct BvhNodeGpu {
+    glm::vec3 boundsMin;
+    std::int32_t leftOrFirst = 0;
+    glm::vec3 boundsMax;
+    std::int32_t count = 0;
+};
+
+// One point-cloud effector (std430, 96 bytes). Its PointCloudGrid lives in
+// the shared bucket and point streams: bucket starts at firstBucket
+// (bucketMask + 2 entries, relative to firstPoint), points at firstPoint.
+struct PointCloudEffectorGpu {
+    glm::mat4 worldToCloud;
+    float strength = 0.0f;
+    float radius = 0.0f;           ///< cloud space
+    float cellSize = 0.0f;         ///< cloud space
+    std::uint32_t bucketMask = 0;
+    std::uint32_t firstBucket = 0;
+    std::uint32_t firstPoint = 0;
+    std::uint32_t padding[2] = {};
+};
+
+// One instanced draw record (96 bytes): arrows, flow vectors and batched meshes.
+struct InstanceData {
+    glm::mat4 modelMatrix;
+    glm::vec4 color;
+    glm::vec4 padding;   ///< batched meshes: x carries the entity pick ID, y the MaterialGpu index, as raw uint bits
+};
+
+// Layout mandated by glDrawElementsIndirect / glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLuint baseVertex;
+    GLuint baseInstance;
+};
+
+// A batched mesh instance under occlusion culling (144 bytes).
+// occlusion_cull_comp appends 'instance' to the draw of 'command' (phase
+// one) or of command + the command count (phase two).
+struct OcclusionCandidateGpu {
+    InstanceData instance;
+    glm::vec4 boundsMin;   ///< world AABB, from WorldBoundsComponent
+    glm::vec4 boundsMax;
+    GLuint    command;
+    GLuint    slot;        ///< entity index into the target's visibility buffer
+    GLuint    flags;       ///< kOcclusionBounded; kOcclusionDrawn is set by phase one
+    GLuint    padding;
+};
+static_assert(sizeof(OcclusionCandidateGpu) == 144, "must match Candidate in occlusion_cull_comp");
+constexpr GLuint kOcclusionBounded = 1u;
+constexpr GLuint kOcclusionDrawn = 2u;
+constexpr GLuint kOcclusionCandidateBinding = 30;
+constexpr GLuint kOcclusionInstanceBinding = 31;   ///< the context's mesh instance buffer
+constexpr GLuint kOcclusionCommandBinding = 32;    ///< its indirect buffer
+constexpr GLuint kOcclusionVisibilityBinding = 33; ///< uint per entity index, per target
+constexpr GLuint kHiZTextureUnit = 9;
+
+// A batched mesh drawn cluster by cluster (96 bytes): cluster_cull_comp
+// tests its MeshArena::ClusterGpu records and appends a draw for each one
+// that survives. The draws follow a uvec4 header (x = how many).
+struct ClusterInstanceGpu {
+    glm::mat4 model;
+    glm::vec4 eye;            ///< camera position in object space; w = largest axis scale
+    GLuint    firstCluster;   ///< MeshArena::Range
+    GLuint    clusterCount;
+    GLint     baseVertex;
+    GLuint    baseInstance;   ///< its InstanceData in the mesh instance buffer
+};
+static_assert(sizeof(ClusterInstanceGpu) == 96, "must match ClusterInstance in cluster_cull_comp");
+// The occlusion pass's bindings; the two never run at the same time.
+constexpr GLuint kClusterInstanceBinding = 30;
+constexpr GLuint kClusterBinding = 31;             ///< MeshArena::clusterBuffer()
+constexpr GLuint kClusterDrawBinding = 32;
+
+// Forward kinematics of the snapshot's GPU posed fleets (fleet_kinematics_comp),
+// written straight into the batched mesh pass's instance buffer. A fleet's
+// links are uploaded in level order, parents a level above their children,
+// so stage 0 runs once per level; stage 1 writes the parts' InstanceData.
+// Per snapshot only a root and the joint coordinates go up per instance.
+struct FleetLinkGpu {
+    glm::vec4  rotation;      ///< joint origin, quaternion xyzw
+    glm::vec4  translation;   ///< joint origin; w unused
+    glm::vec4  axis;          ///< unit, joint frame; w unused
+    glm::ivec4 info;          ///< x model link, y its parent (-1 for roots), z DOF (-1 fixed), w KinematicModel::Motion
+};
+static_assert(sizeof(FleetLinkGpu) == 64, "must match Link in fleet_kinematics_comp");
+struct FleetPartGpu {
+    glm::mat4  offset;        ///< Prefab::Part::offset, from its link's frame
+    glm::vec4  color;
+    glm::uvec4 info;          ///< x model link, y MaterialGpu index
+};
+static_assert(sizeof(FleetPartGpu) == 96, "must match Part in fleet_kinematics_comp");
+struct FleetInstanceGpu {
+    glm::vec4  rows[3];       ///< root * model-to-prefab, first three rows, translation from the fleet's origin
+    glm::uvec4 info;          ///< x pick ID, y first joint coordinate
+};
+static_assert(sizeof(FleetInstanceGpu) == 64, "must match FleetInstance in fleet_kinematics_comp");
+// The occlusion and cluster passes' bindings again; all run one after another.
+constexpr GLuint kFleetLinkBinding = 30;
+constexpr GLuint kFleetPartBinding = 31;
+constexpr GLuint kFleetInstanceBinding = 32;
+constexpr GLuint kFleetJointBinding = 33;     ///< float per joint coordinate
+constexpr GLuint kFleetVisibleBinding = 34;   ///< uint per instance this view draws, into the fleet instances
+constexpr GLuint kFleetPoseBinding = 35;      ///< rotation, translation per drawn instance and link
+constexpr GLuint kFleetOutputBinding = 36;    ///< the context's mesh instance buffer
+
+// Layout mandated by glDrawArraysIndirect / glMultiDrawArraysIndirect.
+struct DrawArraysIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance;
+};
+
+// One spline's draw record (64 bytes), sourced as divisor-1 attributes so a
+// single multi-draw covers every spline; baseInstance selects the record.
+struct SplineStyleGpu {
+    glm::vec4 glowColour;
+    glm::vec4 coreColour;
+    float thickness = 8.0f;
+    std::int32_t firstPoint = 0;   ///< tessellated only: control-point range in the spline arena
+    std::int32_t pointCount = 0;
+    std::int32_t splineType = 0;   ///< 0 = Linear, 1 = Catmull-Rom, 2 = Bezier, 3 = piecewise cubic Bezier
+    std::int32_t segmentCount = 0; ///< patches drawn, one per curve segment
+    std::int32_t padding[3] = {};
+};
+
+// One point cloud node's draw record (64 bytes), sourced as divisor-1
+// attributes like SplineStyleGpu. Quantized positions (0..65535) map to
+// eye-relative space (see FrameUniformsGpu::eyeView) as
+// origin + q.x * axisX + q.y * axisY + q.z * axisZ.
+struct PointCloudDrawGpu {
+    glm::vec4 origin;   ///< xyz = node min relative to the eye, w = world point spacing
+    glm::vec4 axisX;    ///< xyz = model axis * node size / 65535
+    glm::vec4 axisY;
+    glm::vec4 axisZ;
+};
+
+// std140 per-frame camera block shared by the raster shaders (FrameUniforms, binding 0).
+// Camera-relative passes (meshes, lights, point clouds) take positions minus
+// the eye, subtracted in double on the CPU, through eyeView; the rest use the
+// world view. Shaders declare the block by including
+// shaders/frame_uniforms.glsl; keep the two in step.
+struct FrameUniformsGpu {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 cameraPos;    // xyz = eye
+    glm::vec4 viewportTime; // xy = viewport size (px), z = elapsed time, w = delta time
+    glm::mat4 eyeView;      // view with the eye at the origin: rotation only
+    glm::mat4 stereoEyeViewProjection[2]; // stereo frames: per eye, projection * eyeView offset to that eye
+};
+constexpr GLuint kFrameUniformsBinding = 0;
+
+// std140 grid block (GridUniforms, binding 1): one per grid, rewritten only
+// when the grid's settings change. A level with spacing <= 0 is hidden.
+constexpr int kMaxGridLevels = 5;
+struct GridLevelGpu {
+    glm::vec4 colorSpacing;   // xyz = colour, w = spacing
+    glm::vec4 fade;           // x = fade-in start, y = fade-in end (camera distance)
+};
+struct GridUniformsGpu {
+    glm::mat4 model;
+    glm::mat4 inverseModel;
+    GridLevelGpu levels[kMaxGridLevels];
+    glm::vec4 xAxisColor;     // w = axis line width (px)
+    glm::vec4 zAxisColor;     // w = base line width (px)
+    glm::vec4 fogColor;       // w = fog on
+    glm::vec4 params;         // x = fog start, y = fog end, z = dotted, w = show axes
+};
+static_assert(sizeof(GridUniformsGpu) == 352, "must match GridUniforms in grid_vert/grid_frag");
+constexpr GLuint kGridUniformsBinding = 1;
+
+// std430 effector streams read by the field compute shaders. Each buffer is
+// { uvec4 header; T items[]; } with the item count in header.x.
+constexpr GLuint kPointEffectorBinding = 3;
+constexpr GLuint kTriangleEffectorBinding = 4;
+constexpr GLuint kDirectionalEffectorBinding = 8;
+constexpr GLuint kTriangleBvhBinding = 9;
+constexpr GLuint kPointCloudEffectorBinding = 16;   ///< PointCloudEffectorGpu[]
+constexpr GLuint kPointCloudBucketBinding = 17;     ///< uint[], every cloud's bucket starts
+constexpr GLuint kPointCloudPointBinding = 18;      ///< vec4[], every cloud's points
+
+// std430 SensorPoint[] ring of one sensor stream, read by the sensor point pass.
+constexpr GLuint kSensorPointsBinding = 10;
+
+// std430 FrameTriad[] read by frame_triad_vert: one coordinate frame per
+// instance, the first three rows of its world matrix.
+struct FrameTriadGpu {
+    glm::vec4 rows[3];        ///< xyz rotation and scale, w translation
+};
+static_assert(sizeof(FrameTriadGpu) == 48, "must match FrameTriad in frame_triad_vert");
+constexpr GLuint kFrameTriadBinding = 5;
+
+// std430 buffers of the label pass (label_vert): LabelGlyphGpu[], one quad
+// per instance, laid out once per string and rewritten only where a label
+// changed, and LabelGpu[], where each label sits this snapshot. The glyph
+// atlas (GlyphAtlas, R8 distances) is sampled on its own unit.
+struct LabelGlyphGpu {
+    glm::vec4 rect;           ///< x0, y0, x1, y1 from the anchor, ems
+    glm::vec4 uv;             ///< u0, v0, u1, v1 in the glyph atlas
+    std::uint32_t label;      ///< into LabelGpu[]
+    std::uint32_t pad[3];
+};
+static_assert(sizeof(LabelGlyphGpu) == 48, "must match LabelGlyph in label_vert");
+struct LabelGpu {
+    glm::vec4 anchor;         ///< xyz world, w = em height in pixels
+    glm::vec4 colour;
+};
+static_assert(sizeof(LabelGpu) == 32, "must match Label in label_vert");
+constexpr GLuint kLabelGlyphBinding = 6;
+constexpr GLuint kLabelBinding = 7;
+constexpr GLuint kGlyphAtlasTextureUnit = 13;
+
+// Compute point splatting (PointCloudRenderer::splat): the per-pixel uvec2
+// (sRGB colour, linear depth bits) target, then the node pool as uint[], the
+// PointCloudDrawGpu records and the DrawArraysIndirectCommands of the selection.
+constexpr GLuint kPointSplatTargetBinding = 19;
+constexpr GLuint kPointSplatPointsBinding = 20;
+constexpr GLuint kPointSplatDrawsBinding = 21;
+constexpr GLuint kPointSplatCommandsBinding = 22;
+
+// Clustered forward lighting: light_cull_comp bins the view's point lights
+// into kLightTilesX x kLightTilesY screen tiles by kLightSlices depth slices,
+// spaced exponentially in view depth from kLightSliceNear to kLightSliceFar
+// (the first slice runs on to the eye, fragments past the last clamp into it).
+// The grid holds an (offset, count) uvec2 per froxel into the index list, which
+// is a uint counter, then light indices. Bound over the point splat bindings:
+// only the mesh pass reads them, and the splat pass rebinds its own after it.
+struct LightGpu {
+    glm::vec4 positionRange;  ///< position relative to the eye, range (the light is zero there)
+    glm::vec4 color;          ///< rgb already scaled by intensity
+};
+static_assert(sizeof(LightGpu) == 32, "must match Light in light_cull_comp and the phong shaders");
+constexpr GLuint kLightTilesX = 16;
+constexpr GLuint kLightTilesY = 9;
+constexpr GLuint kLightSlices = 24;
+constexpr GLuint kLightFroxels = kLightTilesX * kLightTilesY * kLightSlices;
+constexpr float kLightSliceNear = 0.1f;
+constexpr float kLightSliceFar = 1000.0f;
+constexpr GLuint kLightIndexCapacity = kLightFroxels * 64;   ///< average lights per froxel before the list truncates
+constexpr GLuint kLightBinding = 19;
+constexpr GLuint kLightGridBinding = 20;
+constexpr GLuint kLightIndexBinding = 21;
+
+// Cascaded shadow maps of the key light, one depth array per viewport:
+// layers [0, kShadowCascades) are sampled, the next kShadowCascades hold
+// each cascade's static casters, copied under the dynamic ones every frame.
+constexpr int kShadowCascades = 4;                 ///< u_shadowMatrices[] in the phong shaders
+constexpr GLsizei kShadowMapSize = 1024;
+constexpr GLuint kShadowTextureUnit = 10;
+
+// Material records of the mesh passes (MaterialTable), indexed by each
+// instance's padding.y or the per-entity path's u_material. Albedo stays in
+// the instance colour, which the maps multiply, so the pulsing LED and every
+// differently tinted link share records. Map layers index the two texture
+// arrays; -1 is no map. Levels are the finest mip TextureStreamer has up,
+// which sampling is clamped to. Bound over the point splat commands, as the
+// lights.
+struct MaterialGpu {
+    glm::vec4 emissive;       ///< rgb already scaled by intensity
+    float metallic;
+    float roughness;
+    GLint albedoLayer;        ///< sRGB array
+    GLint metalRoughnessLayer;///< linear array, glTF channels: g = roughness, b = metallic
+    float albedoLevel;
+    float metalRoughnessLevel;
+    float padding[2];
+};
+static_assert(sizeof(MaterialGpu) == 48, "must match Material in the phong shaders");
+constexpr GLuint kMaterialBinding = 22;
+constexpr GLuint kAlbedoArrayTextureUnit = 11;
+constexpr GLuint kMetalRoughnessArrayTextureUnit = 12;
+
+// Particle lists of one Particles-mode visualizer: this header, then three
+// uint index lists of particleCount entries each: the alive list of
+// particleBuffer[0], the alive list of particleBuffer[1], the dead list.
+// particle_emit_comp refills the alive list of the read half from the dead
+// list and writes both indirect dispatches; particle_update_comp moves each
+// alive index to the other half's list or back to the dead one.
+struct ParticleListHeaderGpu {
+    GLuint updateGroups[3];   ///< DispatchIndirectCommand of the update kernel
+    GLuint deadCount;
+    GLuint cullGroups[3];     ///< DispatchIndirectCommand of particle_cull_comp
+    GLuint padding0;
+    GLuint aliveCount[2];     ///< per particle buffer half
+    GLuint padding1[2];
+};
+static_assert(sizeof(ParticleListHeaderGpu) == 48, "must match ParticleListBuffer in the particle shaders");
+constexpr GLuint kParticleListBinding = 23;
+constexpr GLuint kParticleCullGroupSize = 64;   ///< local_size_x of particle_cull_comp
+
+// Per-context particle draw buffer: a DrawArraysIndirectCommand, then the
+// ParticleVertexGpu records particle_cull_comp appended, sourced as attributes.
+struct ParticleVertexGpu {
+    glm::vec4 positionSize;   ///< xyz = interpolated world position, w = point size
+    glm::vec4 color;
+};
+constexpr GLuint kParticleDrawBinding = 24;
+
+// Back-to-front radix sort of the draw buffer (particle_sort_comp): a
+// scratch buffer of the draw buffer's layout, and per digit pass one
+// 256-bin histogram per tile of kParticleSortTile records.
+constexpr GLuint kParticleSortSourceBinding = 26;
+constexpr GLuint kParticleSortDestBinding = 27;
+constexpr GLuint kParticleSortCountsBinding = 28;
+constexpr GLuint kParticleSortTile = 4096;
+
+// Adaptive arrow refinement (arrow_refine_comp): the cell counts of the
+// coarse list and the two ping-pong lists, then the field arrow kernel's
+// DispatchIndirectCommand for each of ComputeDispatch::kLocalSizes.
+struct AdaptiveArrowCountersGpu {
+    GLuint cellCount[4];      ///< coarse, ping, pong, unused
+    GLuint arrowGroups[4][3];
+};
+constexpr GLuint kAdaptiveArrowCountersBinding = 25;
+constexpr GLuint kMaxAdaptiveArrowSamples = 1u << 18;   ///< refineLevels is lowered to stay within
+
+// Uniform arrow grids on the effector field share one field_visualizer_comp
+// dispatch: one entry per visualizer, its samples at [firstSample, next
+// entry's), its instances at firstInstance (its draw's baseInstance).
+struct ArrowBatchEntryGpu {
+    glm::mat4 model;          ///< visualizer -> world
+    glm::vec4 boundsMin;      ///< visualizer space; w = vector scale
+    glm::vec4 boundsMax;      ///< w = head scale
+    glm::vec4 density;        ///< samples per axis; w = culling threshold
+    GLuint    firstSample;
+    GLuint    firstInstance;
+    GLuint    gradientRow;    ///< intensity gradient's row of the gradient atlas
+    GLuint    padding;
+};
+static_assert(sizeof(ArrowBatchEntryGpu) == 128, "must match ArrowBatchEntry in field_visualizer_comp");
+constexpr GLuint kArrowBatchBinding = 29;
 
 // --- GPU Resource Handles ---
 // This struct now only contains data unique to each visualizer grid.
 struct FieldVisGpuData {
-    GLuint samplePointsSSBO = 0;
+    bool   arrowBatched = false;   ///< drawn from the shared arrow batch this tick, not these buffers
+    GLuint samplePointsSSBO = 0;   ///< adaptive arrows only: uvec4 header (x = count), then vec4 points (w = arrow size)
     GLuint instanceDataSSBO = 0;
+    std::size_t instanceCapacity = 0;   ///< InstanceData slots allocated in instanceDataSSBO
     GLuint commandUBO = 0;
-    int numSamplePoints = 0;
+    int numSamplePoints = 0;       ///< adaptive arrows: the most the refinement can produce
+
+    // Adaptive arrows: two ping-pong cell lists (the coarse cells are the
+    // grid) and their AdaptiveArrowCountersGpu; refined against
+    // 'adaptiveBakeGeneration'.
+    GLuint        adaptiveCellBuffers[2] = { 0, 0 };
+    GLuint        adaptiveCounterBuffer = 0;
+    int           adaptiveCoarseCount = 0;
+    int           adaptiveLevels = 0;
+    glm::vec3     adaptiveHalfExtent{ 0.0f };
+    std::uint64_t adaptiveBakeGeneration = ~0ull;
+    GpuReadbackRing debugReadback;   ///< only used when field readback debugging is on
+
+    // Baked field cache (FieldVisualizerComponent::useBakedField) and the inputs it was built from.
+    GLuint        bakedFieldTexture = 0;
+    glm::ivec3    bakedResolution{ 0 };
+    std::uint64_t bakedEffectorVersion = ~0ull;
+    glm::mat4     bakedModel{ 0.0f };
+    glm::vec3     bakedMin{ 0.0f };
+    glm::vec3     bakedMax{ 0.0f };
+    std::uint64_t bakeGeneration = 0;   ///< bumped by every bake
+
+    // Temporal mode: keyframes at temporalTime in a ring of textures at
+    // bakedResolution. The newest complete one and the one before it are
+    // blended into bakedFieldTexture while the third is baked slice by slice.
+    static constexpr int kTemporalFrames = 3;
+    GLuint        temporalTextures[kTemporalFrames] = {};
+    double        temporalTime[kTemporalFrames] = {};
+    int           temporalNewest = 0;            ///< last complete keyframe
+    int           temporalComplete = 0;          ///< complete keyframes, counted up to 2
+    int           temporalSlice = -1;            ///< next slice of the keyframe after the newest; -1 when idle
+    double        temporalNextKey = 0.0;         ///< simulation time due for the next keyframe
+    int           temporalShownNewest = -1;      ///< what bakedFieldTexture holds
+    float         temporalShownBlend = -1.0f;
+
+    // Streamlines mode: 'streamlineCount' polylines of up to
+    // 'streamlinePointsPerLine' vec4 points (xyz, w = field speed), one
+    // DrawArraysIndirectCommand each, traced against 'streamlineBakeGeneration'.
+    GLuint        streamlinePointBuffer = 0;
+    GLuint        streamlineCommandBuffer = 0;
+    GLuint        streamlineCount = 0;
+    GLuint        streamlinePointsPerLine = 0;
+    std::uint64_t streamlineBakeGeneration = ~0ull;
+
+    // Volume mode: the source volume as an R16F 3D texture, uploaded from
+    // 'volumeUploaded', and this tick's gradient atlas row.
+    GLuint        volumeTexture = 0;
+    std::shared_ptr<const ScalarVolume> volumeUploaded;
+    int           volumeGradientRow = 0;
 };
+constexpr GLuint kBakedFieldTextureUnit = 7;
+constexpr GLuint kGradientAtlasTextureUnit = 8;   ///< GradientLut rows, sampled by the arrow and particle kernels
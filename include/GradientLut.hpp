@@ -0,0 +1,25 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct ColorStop;
+
+// A colour gradient baked to kSize evenly spaced texels over [0, 1], so a
+// lookup is one index and one lerp instead of a search through the stops.
+// The GPU samples the same texels from RenderingSystem's gradient atlas;
+// CPU consumers (the menu's previews) use sample().
+struct GradientLut {
+    static constexpr int kSize = 256;
+    std::array<glm::vec4, kSize> texels;
+
+    // Stops in any order; positions outside [0, 1] clamp. No stops bake
+    // white, one stop a flat colour.
+    static GradientLut bake(const std::vector<ColorStop>& stops);
+
+    // Linear between the two nearest texels; 'value' clamps to [0, 1].
+    glm::vec4 sample(float value) const;
+
+    static bool sameStops(const std::vector<ColorStop>& a, const std::vector<ColorStop>& b);
+};
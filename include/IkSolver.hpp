@@ -0,0 +1,79 @@
+#pragma once
+
+#include "KinematicModel.hpp"
+
+#include <vector>
+
+/**
+ * @class IkSolver
+ * @brief Damped-least-squares (Levenberg-Marquardt) inverse kinematics on a
+ *        KinematicModel.
+ *
+ * Each iteration runs forward() with the tip Jacobian J and takes the step
+ * dq = J^T (J J^T + lambda^2 I)^-1 e, where e is the weighted position (and
+ * optionally orientation) error. Steps that do not reduce the error are
+ * rejected and the damping grows; accepted steps shrink it again. Joint
+ * coordinates are clamped to the model's limits after every step.
+ *
+ * The iteration count is fixed by Settings::maxIterations rather than by
+ * convergence alone, so the worst case is bounded: with the defaults a 6-7
+ * DOF arm solves in a few microseconds, well inside an interactive drag.
+ * 'q' is both the warm start and the result, so passing the previous frame's
+ * solution back in keeps successive solves short and the arm from flipping
+ * between branches.
+ *
+ * Scratch is held by the solver and sized in setModel(); solve() does not
+ * allocate.
+ */
+class IkSolver
+{
+public:
+    using Pose = KinematicModel::Pose;
+
+    struct Settings {
+        int    maxIterations = 32;
+        double damping = 0.05;               ///< initial lambda, in metres
+        double minDamping = 1e-4;
+        double maxDamping = 10.0;
+        double positionTolerance = 1e-4;     ///< metres
+        double orientationTolerance = 1e-3;  ///< radians
+        double orientationWeight = 0.25;     ///< metres per radian when both are solved
+        double maxStep = 0.35;               ///< largest |dq| per iteration (rad or m)
+    };
+
+    struct Result {
+        bool   converged = false;
+        int    iterations = 0;
+        double positionError = 0.0;
+        double orientationError = 0.0;       ///< 0 for position-only solves
+    };
+
+    IkSolver() = default;
+    explicit IkSolver(const KinematicModel& model) { setModel(model); }
+
+    void setModel(const KinematicModel& model);
+    const KinematicModel* model() const { return m_model; }
+
+    void setSettings(const Settings& settings) { m_settings = settings; }
+    const Settings& settings() const { return m_settings; }
+
+    /// Moves link 'tip' to 'target' (world space, with the model rooted at
+    /// 'base'). Only the position is matched unless 'matchOrientation'.
+    /// 'q' (dofCount() values) is read as the warm start and overwritten with
+    /// the best configuration found, which always respects the joint limits.
+    Result solve(int tip, const Pose& target, double* q, bool matchOrientation = false, const Pose& base = {});
+
+private:
+    // Fills m_error (3 rows, or 6 with orientation) and returns its squared norm.
+    double error(const Pose& target, const Pose& current, bool matchOrientation,
+        double& positionError, double& orientationError);
+    void clampToLimits(double* q) const;
+
+    const KinematicModel* m_model = nullptr;
+    Settings m_settings;
+
+    std::vector<Pose>   m_world;
+    std::vector<double> m_jacobian;   ///< 6 x dofs, column-major
+    std::vector<double> m_previous;   ///< q before the step being tried
+    double m_error[6] = {};
+};
@@ -1,22 +1,62 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
 #include <optional>
+#include <entt/entity/entity.hpp>
+#include <entt/fwd.hpp>
 
 // Forward declarations
+class Camera;
 class Scene;
-class ViewportWidget;
 
 namespace IntersectionSystem
 {
-    // Calculates and returns all intersection outlines for a given scene state.
-    std::vector<std::vector<glm::vec3>> update(Scene* scene);
+    // Sections every mesh with each grid plane that has showIntersections set,
+    // once per tick on the GUI thread. Results are cached per (mesh, grid)
+    // pair; outlines() holds the ones of the last call.
+    void update(Scene* scene);
 
-    // Handles object selection via mouse-clicking.
-    void selectObjectAt(Scene& scene, ViewportWidget& viewport, int mouseX, int mouseY);
+    // Ordered world-space polylines from the last update(); closed loops
+    // repeat their first point at the end. Empty before the first one.
+    const std::vector<std::vector<glm::vec3>>& outlines(const entt::registry& registry);
 
-    std::optional<glm::vec3> pickPoint(Scene& scene,
-        ViewportWidget& vp,
-        int mouseX, int mouseY);
+    // Changes whenever update() found different outlines from the call
+    // before, so a consumer can skip re-uploading identical ones. 0 before
+    // the first update().
+    std::uint64_t generation(const entt::registry& registry);
+
+    struct Ray { glm::vec3 origin; glm::vec3 dir; };
+
+    // World-space ray through pixel (mouseX, mouseY) of a width x height view.
+    Ray cameraRay(const Camera& camera, int width, int height, int mouseX, int mouseY);
+
+    // Closest mesh entity along the ray, or entt::null. Uses the scene
+    // TLAS and per-mesh BLAS, so it is cheap enough for hover queries.
+    entt::entity pickEntity(Scene& scene, const Ray& ray);
+
+    // Selects the entity pickEntity() finds, clearing any other selection.
+    void selectObjectAt(Scene& scene, const Ray& ray);
+
+    // World-space point where the ray first hits a mesh.
+    std::optional<glm::vec3> pickPoint(Scene& scene, const Ray& ray);
+
+    enum class SnapKind : std::uint8_t { None, Vertex, Edge, Face, Grid };
+
+    struct Snap {
+        SnapKind kind = SnapKind::None;
+        glm::vec3 point{ 0.0f };                 ///< world space
+        entt::entity entity = entt::null;        ///< the mesh snapped to; null for grid points
+    };
+
+    // Point to snap to under pixel (mouseX, mouseY), for measuring and
+    // placing. Where the cursor ray hits a mesh, every mesh the scene index
+    // finds within 'pixelRadius' of the hit (measured at the hit's depth)
+    // is searched through its BLAS, in object space, and the nearest corner
+    // wins over the nearest edge point, which wins over the hit itself.
+    // Prefab instances give their surface point only. Where the ray hits
+    // nothing, grids with snappingEnabled give their nearest line crossing.
+    Snap snapPoint(Scene& scene, const Camera& camera, int width, int height, int mouseX, int mouseY,
+        float pixelRadius = 8.0f);
 }
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "RobotDescription.hpp"
+#include "TripleBuffer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <entt/fwd.hpp>
+
+/// What one joint controller is told to do this cycle.
+struct JointCommand {
+    ControlMode mode = ControlMode::INACTIVE;
+    double setpoint = 0.0;       ///< position, velocity, torque, current or duty, per 'mode'
+    double feedForward = 0.0;
+};
+
+/**
+ * @class CommandWriter
+ * @brief Protocol driver interface for sending joint commands.
+ *
+ * write() is called on the command thread once per cycle with one command per
+ * endpoint, in the order given to open(). It must not block beyond the time
+ * it takes to hand the frame to the bus.
+ */
+class CommandWriter
+{
+public:
+    struct Endpoint {
+        std::uint32_t controllerId = 0;   ///< HardwareInterface::controller_id
+        std::string   commandTopic;       ///< HardwareInterface::command_topic_name
+        ControlMode   defaultMode = ControlMode::POSITION;
+        PIDParameters positionPid, velocityPid, torquePid;
+    };
+
+    virtual ~CommandWriter() = default;
+
+    virtual bool open(const std::vector<Endpoint>& endpoints) = 0;
+    virtual void write(const JointCommand* commands, std::size_t count) = 0;
+    virtual void close() {}
+
+    // After each write(): added to the next deadline, so a bus with its own
+    // clock (EtherCAT distributed clocks) can pull the loop into phase.
+    virtual std::chrono::nanoseconds deadlineCorrection() { return std::chrono::nanoseconds(0); }
+};
+
+/**
+ * @class JointCommandLoop
+ * @brief Fixed-rate command output thread, decoupled from the render loop.
+ *
+ * One thread runs every registered CommandWriter on absolute deadlines
+ * (sleep until shortly before the deadline, then spin), optionally pinned to
+ * a CPU and raised to real-time priority (SCHED_FIFO on Linux,
+ * TIME_CRITICAL on Windows). Setpoints travel from the GUI thread through a
+ * TripleBuffer, so neither side ever waits on the other and a slow frame
+ * only delays when a new setpoint appears, never the cycle itself.
+ *
+ * Wake-up lateness per cycle is accumulated into jitter statistics that the
+ * GUI can read at any time through a second TripleBuffer.
+ *
+ * emergencyStop() may be called from any thread (see EStopService). It wakes
+ * the command thread out of its sleep, which hands every writer an INACTIVE
+ * frame straight away, off schedule, and keeps doing so every cycle until
+ * the GUI calls clearEmergencyStop(). Staged setpoints are ignored meanwhile
+ * and the latch survives bind().
+ */
+class JointCommandLoop
+{
+public:
+    using WriterFactory = std::function<std::unique_ptr<CommandWriter>()>;
+
+    struct Settings {
+        double rateHz = 1000.0;                        ///< 1-4 kHz is the intended range
+        int    cpu = -1;                               ///< pin to this CPU; -1 leaves affinity alone
+        bool   realtime = false;                       ///< SCHED_FIFO / TIME_CRITICAL
+        int    realtimePriority = 80;                  ///< SCHED_FIFO priority (1-99)
+#ifdef _WIN32
+        std::chrono::microseconds spinWindow{ 1500 };  ///< default timer resolution is ~1 ms
+#else
+        std::chrono::microseconds spinWindow{ 200 };
+#endif
+    };
+
+    struct Jitter {
+        std::uint64_t cycles = 0;
+        std::uint64_t overruns = 0;     ///< deadlines skipped because a cycle ran long
+        double lastUs = 0.0;            ///< wake-up lateness of the latest cycle
+        double meanUs = 0.0;
+        double stddevUs = 0.0;
+        double maxUs = 0.0;
+        double stopLatencyUs = -1.0;    ///< latest trip to its stop frames written; -1 before any
+        std::uint64_t stopTrip = 0;     ///< trips() value stopLatencyUs belongs to
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    JointCommandLoop() = default;
+    ~JointCommandLoop() { stop(); }
+
+    JointCommandLoop(const JointCommandLoop&) = delete;
+    JointCommandLoop& operator=(const JointCommandLoop&) = delete;
+
+    void registerWriter(CommunicationProtocol protocol, WriterFactory factory);
+    void setSettings(const Settings& settings) { m_settings = settings; }
+    const Settings& settings() const { return m_settings; }
+
+    // Opens writers for the JointComponents in 'registry' and (re)starts the
+    // thread if any joint is bound. Every bound joint starts INACTIVE.
+    // Returns how many joints are bound.
+    std::size_t bind(entt::registry& registry);
+    void stop();
+    bool running() const { return m_thread.joinable(); }
+
+    // GUI thread: stage a command, then publish() all staged commands at once.
+    // Returns false if 'joint' is not bound.
+    bool setCommand(entt::entity joint, const JointCommand& command);
+    void publish();
+
+    // GUI thread: newest statistics from the command thread.
+    const Jitter& jitter();
+
+    // Any thread, never blocks on the command thread. 'trippedAt' is when
+    // the stop was asked for (the input event's time), for stopLatencyUs.
+    void emergencyStop(Clock::time_point trippedAt = Clock::now());
+    // GUI thread: staged setpoints flow again from the next cycle.
+    void clearEmergencyStop();
+    bool emergencyStopped() const { return m_stopped.load(std::memory_order_acquire); }
+    // Trips so far, over the loop's lifetime.
+    std::uint64_t trips() const { return m_trips.load(std::memory_order_acquire); }
+
+private:
+    struct Stream {
+        std::unique_ptr<CommandWriter> writer;
+        std::size_t first = 0, count = 0;   ///< slice of the command frame
+    };
+
+    void run();
+    void resetJitter();
+
+    std::unordered_map<CommunicationProtocol, WriterFactory> m_factories;
+    Settings m_settings;
+
+    std::vector<Stream> m_streams;
+    std::unordered_map<entt::entity, std::size_t> m_slotOf;
+    std::vector<JointCommand> m_staged;                  ///< GUI thread only
+    std::vector<JointCommand> m_stopFrame;               ///< all INACTIVE, built in bind()
+    TripleBuffer<std::vector<JointCommand>> m_commands;  ///< GUI -> command thread
+    TripleBuffer<Jitter> m_jitter;                       ///< command thread -> GUI
+
+    std::atomic<bool> m_running{ false };
+    std::thread m_thread;
+
+    std::atomic<bool> m_stopped{ false };
+    std::atomic<std::int64_t> m_trippedAtTicks{ 0 };       ///< Clock ticks of the latest trip
+    std::atomic<std::uint64_t> m_trips{ 0 };            ///< bumped per trip, so a new one is answered at once
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+};
@@ -3,8 +3,15 @@
 #include "RobotDescription.hpp"
 #include <QWidget>
 
-// A widget for displaying and editing the properties of a single JointDescription.
-// For now, it's just a placeholder.
+class QTreeView;
+class QTimer;
+class JointPropertyModel;
+
+// Editor for one JointDescription: a tree of groups (limits, motor, the
+// three PID sets, interface, ...) over a model built from a table of field
+// accessors. Selecting another joint repoints the model, so no editor
+// widgets are rebuilt; the view creates an editor only for the cell being
+// edited. Edits are written straight into the description.
 class JointPropertiesWidget : public QWidget
 {
     Q_OBJECT
@@ -12,13 +19,15 @@ class JointPropertiesWidget : public QWidget
 public:
     explicit JointPropertiesWidget(QWidget* parent = nullptr);
 
-    // A public method to populate the editor with data from a specific joint.
-    void setData(const JointDescription& jointDesc);
+    // Edits 'jointDesc' in place until the next call; null disables the editor.
+    void setJoint(JointDescription* jointDesc);
 
 signals:
-    // A signal to notify the parent dialog that data has changed.
+    // Once per event loop turn with edits, however many fields changed.
     void propertiesChanged();
 
 private:
-    // In the future, you will add UI elements for all the rich joint data.
+    JointPropertyModel* m_model = nullptr;
+    QTreeView* m_view = nullptr;
+    QTimer* m_notifyTimer = nullptr;
 };
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @class JointStateBuffer
+ * @brief Dense, DOF-ordered joint state of one robot, shared between systems and threads.
+ *
+ * The working set is three contiguous arrays (position, velocity, effort),
+ * read and written in place on the GUI thread by telemetry, IK, FK and the
+ * UI. publish() stamps a new frame and copies the working set into one of
+ * two published slots, each guarded by a sequence counter. snapshot() copies
+ * the newest slot out from any thread without taking a lock. It retries only
+ * if two publishes land while it is copying, which at one publish per tick
+ * means practically never.
+ *
+ * Published values are stored as relaxed atomics, so the copies are plain
+ * moves on every mainstream target and the handoff is free of data races.
+ */
+class JointStateBuffer
+{
+public:
+    struct Snapshot {
+        std::uint64_t frame = 0;            ///< 0 until something was published
+        std::vector<double> position, velocity, effort;
+    };
+
+    explicit JointStateBuffer(std::size_t dofs);
+
+    JointStateBuffer(const JointStateBuffer&) = delete;
+    JointStateBuffer& operator=(const JointStateBuffer&) = delete;
+
+    std::size_t size() const { return m_dofs; }
+
+    // --- Working set: owner (GUI) thread only ---
+    double* position() { return m_working.data(); }
+    double* velocity() { return m_working.data() + m_dofs; }
+    double* effort() { return m_working.data() + 2 * m_dofs; }
+    const double* position() const { return m_working.data(); }
+    const double* velocity() const { return m_working.data() + m_dofs; }
+    const double* effort() const { return m_working.data() + 2 * m_dofs; }
+
+    // Owner thread: makes the working set visible to snapshot() as the next frame.
+    void publish();
+
+    // Frame stamp of the last publish(); any thread.
+    std::uint64_t frame() const { return m_frame.load(std::memory_order_acquire); }
+
+    // Any thread: copies the newest published frame into 'out' (resized as
+    // needed, so reusing one Snapshot does not allocate). Returns false if
+    // nothing was published yet, or 'out' already holds the newest frame.
+    bool snapshot(Snapshot& out) const;
+
+private:
+    struct Slot {
+        std::atomic<std::uint64_t> sequence{ 0 };    ///< odd while being written
+        std::unique_ptr<std::atomic<double>[]> values;
+    };
+
+    std::size_t m_dofs;
+    std::vector<double> m_working;                   ///< position | velocity | effort
+    Slot m_slots[2];
+    std::atomic<std::uint64_t> m_frame{ 0 };
+};
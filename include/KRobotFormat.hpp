@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Binary robot description ("*.krobot"), little-endian. Every record is
+ * plain data read straight out of a file mapping:
+ *
+ *   FileHeader        magic, version, robot name, where the section table is
+ *   Section[]         type, byte range and record count of each section
+ *   Strings           UTF-8 bytes; every text field is a StringRef into it
+ *   Links             LinkRecord[]
+ *   Mounts            MountRecord[]   (LinkRecord::firstMount/mountCount)
+ *   Joints            JointRecord[]
+ *   Sensors           SensorRecord[]  (JointRecord::firstSensor/sensorCount)
+ *   Meshes            MeshRecord[], then the .kmesh blobs they point at
+ *                     (optional, see MeshBinaryFormat)
+ *
+ * Sections and blobs start 8-byte aligned. Unknown section types are
+ * skipped, so later versions can add sections without breaking readers.
+ */
+namespace KRobotFormat
+{
+    constexpr std::uint32_t kMagic = 0x424F524Bu;   // "KROB"
+    constexpr std::uint32_t kVersion = 1;
+
+    enum SectionType : std::uint32_t {
+        Strings = 1,
+        Links = 2,
+        Mounts = 3,
+        Joints = 4,
+        Sensors = 5,
+        Meshes = 6,
+    };
+
+    enum LinkFlags : std::uint32_t {
+        CastsShadow = 1u << 0,
+        Visible = 1u << 1,
+        Static = 1u << 2,
+        EndEffector = 1u << 3,
+    };
+
+    enum SensorKind : std::uint32_t {   // SensorVariant index
+        Encoder = 0,
+        Potentiometer = 1,
+        HallEffect = 2,
+    };
+
+    struct StringRef {
+        std::uint32_t offset = 0;     ///< into the Strings section
+        std::uint32_t length = 0;
+    };
+
+    struct FileHeader {
+        std::uint32_t magic = kMagic;
+        std::uint32_t version = kVersion;
+        std::uint32_t sectionCount = 0;
+        std::uint32_t reserved = 0;
+        std::uint64_t sectionTableOffset = 0;
+        StringRef robotName;
+    };
+
+    struct Section {
+        std::uint32_t type = 0;
+        std::uint32_t count = 0;      ///< records in the section
+        std::uint64_t offset = 0;
+        std::uint64_t size = 0;       ///< bytes
+    };
+
+    struct MaterialRecord {
+        float albedo[4] = {};
+        float emissive[3] = {};
+        float emissiveIntensity = 1.0f;
+        float metalness = 0.0f;
+        float roughness = 0.5f;
+        StringRef albedoTexture;
+        StringRef metalRoughnessTexture;
+    };
+
+    struct LinkRecord {
+        std::uint64_t persistentId = 0;
+        StringRef name;
+        StringRef mesh;
+        StringRef collisionMesh;
+        StringRef editorLayer;
+        float visualXyz[3] = {};
+        float visualRpy[3] = {};
+        float mass = 1.0f;
+        float inertia[9] = {};        ///< column-major
+        float centerOfMass[3] = {};
+        float friction = 0.5f;
+        float restitution = 0.1f;
+        std::uint32_t flags = 0;      ///< LinkFlags
+        std::uint32_t firstMount = 0;
+        std::uint32_t mountCount = 0;
+        MaterialRecord material;
+    };
+
+    struct MountRecord {
+        StringRef name;
+        float position[3] = {};
+        float rpy[3] = {};
+    };
+
+    struct PidRecord {
+        double p = 0, i = 0, d = 0, iMax = 0, iMin = 0, feedForward = 0;
+    };
+
+    struct JointRecord {
+        std::uint64_t persistentId = 0;
+        double limits[4] = {};        ///< lower, upper, velocity, effort
+        double gearReduction = 1.0;
+        double transmissionEfficiency = 1.0;
+        double staticFriction = 0.0;
+        double dynamicFriction = 0.0;
+
+        // MotorProperties
+        double stepsPerRevolution = 200.0;
+        double torqueConstant = 0.0;
+        double backEmfConstant = 0.0;
+        double terminalResistance = 0.0;
+        double terminalInductance = 0.0;
+        double maxContinuousCurrent = 1.0;
+        double peakCurrent = 1.0;
+        double maxVoltage = 48.0;
+
+        PidRecord positionPid;
+        PidRecord velocityPid;
+        PidRecord torquePid;
+
+        StringRef name;
+        StringRef parentLink;
+        StringRef childLink;
+        StringRef motorModel;
+        StringRef commandTopic;
+        StringRef feedbackTopic;
+        float originXyz[3] = {};
+        float originRpy[3] = {};
+        float axis[3] = {};
+        std::uint32_t type = 0;             ///< JointType
+        std::uint32_t motorType = 0;        ///< MotorType
+        std::uint32_t commutation = 0;      ///< CommutationType
+        std::uint32_t polePairs = 7;
+        std::uint32_t phases = 3;
+        std::uint32_t controlMode = 0;      ///< ControlMode
+        std::uint32_t controllerId = 0;
+        std::uint32_t protocol = 0;         ///< CommunicationProtocol
+        std::uint32_t firstSensor = 0;
+        std::uint32_t sensorCount = 0;
+        std::uint32_t reserved = 0;
+    };
+
+    struct SensorRecord {
+        double values[3] = {};        ///< Encoder: counts, gear ratio, zero offset; Potentiometer: min V, max V, gear ratio
+        StringRef model;
+        std::uint32_t kind = 0;       ///< SensorKind
+        std::uint32_t encoderType = 0;
+        std::uint32_t pins[3] = {};   ///< HallEffect: phase A, B, C
+        std::uint32_t reserved = 0;
+    };
+
+    struct MeshRecord {
+        std::uint64_t offset = 0;     ///< absolute, of the .kmesh blob
+        std::uint64_t size = 0;
+        StringRef path;               ///< the source path the links refer to
+    };
+}
@@ -7,7 +7,12 @@
 class KRobotWriter
 {
 public:
-    // Saves the provided RobotDescription to a .krobot file at the given path.
-    // Returns true on success, false on failure.
-    static bool save(const RobotDescription& description, const std::string& filepath);
+    // Saves the complete RobotDescription as a binary .krobot (see
+    // KRobotFormat). With 'embedMeshes' the preprocessed copy of every link
+    // mesh goes into the file too, so it reloads without the sources and
+    // without importing. Returns true on success, false on failure.
+    static bool save(const RobotDescription& description, const std::string& filepath, bool embedMeshes = false);
+
+    // Writes names and mesh paths as XML, for diffing. Not read back.
+    static bool exportXml(const RobotDescription& description, const std::string& filepath);
 };
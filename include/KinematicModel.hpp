@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+struct RobotDescription;
+struct JointLimits;
+
+/// Rigid transform; cheaper to compose than a mat4 and never picks up scale.
+struct KinematicPose {
+    glm::quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+    glm::vec3 translation{ 0.0f };
+
+    KinematicPose operator*(const KinematicPose& b) const { return { rotation * b.rotation, translation + rotation * b.translation }; }
+    glm::vec3 transformPoint(const glm::vec3& p) const { return translation + rotation * p; }
+    glm::mat4 matrix() const;
+};
+
+/**
+ * @class KinematicModel
+ * @brief A robot's kinematic tree compiled into flat, topologically ordered arrays.
+ *
+ * Links are sorted so every parent precedes its children; link i is attached
+ * to parentOf(i) through its (single) parent joint, whose fixed origin
+ * (origin_xyz, origin_rpy) is baked into a rigid pose. forward() is then one
+ * linear pass: world[i] = world[parent[i]] * origin[i] * motion_i(q).
+ *
+ * Only joints with a single degree of freedom move: REVOLUTE and CONTINUOUS
+ * rotate about their axis, PRISMATIC slides along it. PLANAR and FLOATING
+ * joints are compiled as FIXED (they need more than one coordinate).
+ * Joint coordinates q are indexed by DOF, in link order.
+ */
+class KinematicModel
+{
+public:
+    using Pose = KinematicPose;
+
+    enum class Motion : std::uint8_t { Fixed, Revolute, Prismatic };
+
+    static KinematicModel fromDescription(const RobotDescription& description);
+
+    int linkCount() const { return int(m_parent.size()); }
+    int dofCount() const { return int(m_dofLink.size()); }
+
+    int parentOf(int link) const { return m_parent[link]; }      ///< -1 for roots
+    int dofOf(int link) const { return m_dof[link]; }            ///< -1 if the parent joint does not move
+    Motion motionOf(int link) const { return m_motion[link]; }
+    const glm::vec3& axisOf(int link) const { return m_axis[link]; } ///< unit, in the joint frame
+    const Pose& originOf(int link) const { return m_origin[link]; }
+
+    const std::string& linkName(int link) const { return m_linkName[link]; }
+    int linkIndex(const std::string& name) const;                ///< -1 if unknown
+    int descriptionLink(int link) const { return m_sourceLink[link]; }    ///< index into RobotDescription::links
+    int descriptionJoint(int link) const { return m_sourceJoint[link]; }  ///< index into RobotDescription::joints, -1 for roots
+    bool isEndEffector(int link) const { return m_endEffector[link] != 0; }
+
+    int dofLink(int dof) const { return m_dofLink[dof]; }
+    const std::string& dofName(int dof) const { return m_dofName[dof]; }
+    int dofIndex(const std::string& jointName) const;           ///< -1 if unknown or not moving
+    double lowerLimit(int dof) const { return m_lower[dof]; }
+    double upperLimit(int dof) const { return m_upper[dof]; }
+    bool isLimited(int dof) const { return m_lower[dof] < m_upper[dof]; }
+
+    /// Local pose of 'link' relative to its parent for joint coordinate 'q'.
+    Pose localPose(int link, double q) const;
+
+    /// World pose of every link for joint coordinates 'q' (dofCount() values).
+    /// 'world' must hold linkCount() poses.
+    void forward(const double* q, Pose* world, const Pose& base = {}) const;
+
+    /// forward() plus the geometric Jacobian of link 'tip' in world space,
+    /// taken from the same pass. 'jacobian' holds 6 x dofCount() doubles,
+    /// column-major: column d is (linear xyz, angular xyz) for DOF d, and is
+    /// zero for DOFs that are not on the path from the root to 'tip'.
+    void forward(const double* q, Pose* world, int tip, double* jacobian, const Pose& base = {}) const;
+
+    /// Configurations per SoA pass in forwardBatch() (AVX2 / NEON width).
+    static constexpr std::size_t kBatchLanes = 8;
+
+    /// forward() for 'count' configurations: 'q' is count x dofCount(),
+    /// row-major, and 'world' receives count x linkCount() poses in the same
+    /// order. kBatchLanes configurations go through each link at once in
+    /// branch-free loops the compiler can vectorize; chunks of them are spread
+    /// over ThreadPool::shared(). Scratch is per thread and reused, so steady
+    /// state does not allocate. Must not be called from a pool worker.
+    void forwardBatch(const double* q, std::size_t count, Pose* world, const Pose& base = {}) const;
+
+private:
+    struct PoseLanes;
+    void forwardLanes(const double* q, std::size_t lanes, Pose* world, const Pose& base,
+        std::vector<PoseLanes>& scratch) const;
+
+    std::vector<std::int32_t> m_parent;
+    std::vector<std::int32_t> m_dof;
+    std::vector<Motion>       m_motion;
+    std::vector<glm::vec3>    m_axis;
+    std::vector<Pose>         m_origin;
+
+    std::vector<std::string>  m_linkName;
+    std::vector<std::int32_t> m_sourceLink;
+    std::vector<std::int32_t> m_sourceJoint;
+    std::vector<std::uint8_t> m_endEffector;
+
+    std::vector<std::int32_t> m_dofLink;
+    std::vector<std::string>  m_dofName;
+    std::vector<double>       m_lower, m_upper;  ///< lower >= upper means unlimited
+};
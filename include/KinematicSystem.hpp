@@ -0,0 +1,36 @@
+#pragma once
+
+#include "IkSolver.hpp"
+
+#include <cstddef>
+#include <entt/fwd.hpp>
+
+namespace KinematicSystem
+{
+    // For every robot with a KinematicModelComponent, copies the positions
+    // in its JointStateBuffer into the model's joint coordinates, rewrites
+    // the local TransformComponent of each link whose coordinate changed
+    // (origin_xyz/rpy and the joint motion) and publishes the buffer as this
+    // tick's frame. TransformSystem then propagates world matrices as usual.
+    // Run before propagation. Returns how many link transforms were written.
+    std::size_t applyJointPositions(entt::registry& registry);
+
+    // Moves end-effector 'link' (model link index) of the robot whose root
+    // link is 'robot' to 'target' in world space, warm-started from the
+    // robot's current joint coordinates. The solution is written to the
+    // JointStateBuffer, so the next applyJointPositions() shows it. The root
+    // link's TransformComponent is the model base (scale is ignored).
+    IkSolver::Result solveEndEffector(entt::registry& registry, entt::entity robot, int link,
+        const KinematicModel::Pose& target, bool matchOrientation = false);
+
+    // 'requested' if it is a link of 'model', else the last end-effector
+    // link, else the last link.
+    int endEffectorLink(const KinematicModel& model, int requested = -1);
+
+    // Recomputes the ghost poses and end-effector path of every dirty
+    // TrajectoryGhostComponent, ghosts and path samples in one forwardBatch(),
+    // and keeps the path's SplineComponent placed under its robot's root
+    // link. Run after propagation, on the GUI thread (forwardBatch() uses the
+    // pool). True if anything visible changed.
+    bool updateTrajectoryGhosts(entt::registry& registry);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QImage>
+#include <QObject>
+#include <QString>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+struct MeshData;
+
+/**
+ * @class LinkThumbnails
+ * @brief Small shaded pictures of link meshes, drawn off the GUI thread.
+ *
+ * request() loads the mesh through MeshCache and rasterises it in software
+ * on ThreadPool::shared(): a fixed three-quarter view, flat shaded in the
+ * link's colour. ready() then arrives on the GUI thread. Pictures are
+ * cached by mesh content and colour, so a request after an edit that
+ * changed neither, or for another link with the same mesh, is a lookup.
+ * No GL is involved, so a dialog listing a hundred links never waits on
+ * a context. Requests still running when the object goes away finish on
+ * the pool but deliver nothing.
+ */
+class LinkThumbnails : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kSize = 64;   ///< pixels, square
+
+    explicit LinkThumbnails(QObject* parent = nullptr) : QObject(parent) {}
+
+    // Queues the picture of 'meshPath' in 'colour' for 'id'; ready() follows,
+    // at once if it is cached. Nothing is emitted for an empty path or a
+    // mesh that fails to load.
+    void request(const QString& id, const std::string& meshPath, const glm::vec4& colour);
+
+    // The picture itself; any thread. Transparent where the mesh is not.
+    static QImage render(const MeshData& mesh, const glm::vec4& colour, int size = kSize);
+
+signals:
+    void ready(const QString& id, const QImage& image);
+
+private:
+    using Key = std::pair<std::size_t, std::uint32_t>;   ///< MeshCache::keyOf, packed colour
+
+    std::map<Key, QImage> m_images;
+    std::unordered_map<std::string, std::size_t> m_contentOf;   ///< path -> MeshCache::keyOf, once loaded
+};
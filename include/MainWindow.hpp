@@ -3,8 +3,16 @@
 
 #include <QMainWindow>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QResizeEvent>
 #include <memory> // Required for std::unique_ptr
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <entt/fwd.hpp>
+#include <entt/signal/sigh.hpp>
 
 // Forward declarations
 class QWidget;
@@ -12,8 +20,36 @@ class StaticToolbar;
 class ViewportWidget;
 class Scene;
 class RenderingSystem;
+class TelemetryHub;
+class JointCommandLoop;
+class EStopService;
+class EtherCatMaster;
+class DynamicsSimulation;
+class CollisionWorld;
+class MotionPlanner;
+class SafetyZoneMonitor;
+class ClearanceMonitor;
+class SessionRecorder;
+class SessionPlayback;
+class RobotImportJob;
+class WorldPartition;
+class ScriptHost;
+class SystemScheduler;
+class PerfHud;
+class QProgressBar;
+class QToolButton;
+class QMenu;
+class QLabel;
 class QTimer;
 class FlowVisualizerMenu; // Forward-declare our new menu
+class PropertiesPanel;
+class CanMonitorPanel;
+class EventLogPanel;
+class FindReplaceDialog;
+class SceneOutlinerModel;
+class RemoteViewServer;
+class TwinPublisher;
+class TwinMirror;
 
 namespace ads {
     class CDockManager;
@@ -30,32 +66,266 @@ public:
 
     void updateVisualizerUI();
 
+    /// How the master loop is clocked.
+    ///  FixedInterval: precise timer at the target rate (default 60 Hz).
+    ///  VSync:         next tick is scheduled when a viewport frame is swapped,
+    ///                 so ticks follow the display's swap interval.
+    ///  Uncapped:      zero-interval timer; ticks as fast as the event loop allows.
+    enum class FramePacing { FixedInterval, VSync, Uncapped };
+    void setFramePacing(FramePacing mode, int targetFps = 60);
+    FramePacing framePacing() const { return m_framePacing; }
+
+    /// Rate of the fixed simulation step (particles, flow), independent of
+    /// the frame pacing. Frames show the state interpolated between steps.
+    void setSimulationRate(int hz);
+    int simulationRate() const { return m_simulationRate; }
+
+    /// Adds FrameBenchmark's generated scene ("robots=16,effectors=40", see
+    /// FrameBenchmark::parseParameters) to the current one. False on a bad
+    /// parameter or an unreadable robot file.
+    bool addStressScene(const QString& parameters);
+
+    // --- Session recording / playback ---
+    // Recording taps every telemetry sample; playback replaces the live
+    // readers with one replaying 'path' until returnToLive().
+    bool startSessionRecording(const QString& path);
+    void stopSessionRecording();
+    bool openSessionPlayback(const QString& path);
+    void returnToLive();
+    SessionPlayback* sessionPlayback() const { return m_playback.get(); }
 
 
 protected:
-    // No changes needed here
+    // Marks the scene dirty on input to the side panels; their edits write
+    // straight into the registry and would otherwise go unnoticed by frame skipping.
+    // Input to any watched widget, viewports included, wakes an idle master loop.
+    bool eventFilter(QObject* watched, QEvent* event) override;
 
 private:
     // --- Member variables updated for the new layout ---
     QWidget* m_centralContainer;
     StaticToolbar* m_fixedTopToolbar;
     ads::CDockManager* m_dockManager;
+    // Fills the toolbar's View menu with the display and renderer settings.
+    void buildViewMenu(QMenu* menu);
 
     // The MainWindow now owns the single, shared scene.
     std::unique_ptr<Scene> m_scene;
 
     std::unique_ptr<RenderingSystem> m_renderingSystem;
 
+    // Hardware joint feedback; drained into the registry once per tick.
+    std::unique_ptr<TelemetryHub> m_telemetry;
+    // Joint command output on its own fixed-rate thread; setpoints published per tick.
+    std::unique_ptr<JointCommandLoop> m_commandLoop;
+    // Pause key / stop button input on its own thread, latching m_commandLoop
+    // without the event loop. The toolbar's V-STOP trips it, or releases it.
+    std::unique_ptr<EStopService> m_estop;
+    std::uint64_t m_estopReported = 0;   ///< JointCommandLoop::trips() last shown in the status bar
+    void onEmergencyStopPressed();
+#if KR_ETHERCAT_ENABLED
+    // ETHERCAT joints' command writer and telemetry reader (NIC from KR_ETHERCAT_IFNAME).
+    std::shared_ptr<EtherCatMaster> m_ethercat;
+#endif
+    // Ctrl+Shift+Y: simulated robot dynamics on a 1 kHz thread, written into
+    // the joint state each tick in place of hardware feedback.
+    std::unique_ptr<DynamicsSimulation> m_dynamics;
+    void setDynamicsSimulation(bool enabled);
+    // Ctrl+Shift+N: the simulated joints read through their encoders and
+    // potentiometers (SimulatedSensors) into the telemetry path, or back to
+    // hardware feedback. Starts the simulation if it is not running.
+    void toggleSimulatedSensors();
+    // Ctrl+Shift+M: position step response of the selected robot's drives
+    // (MotorSimulation), simulated on this thread into a session log that
+    // is then played back.
+    std::thread m_stepResponse;
+    std::atomic<bool> m_stepResponseCancel{ false };
+    void runStepResponse();
+    // Ctrl+Shift+V: virtual sensors at every sensor mount of the selected
+    // robot (SceneBuilder::addVirtualSensors), or off again.
+    void toggleVirtualSensors();
+    // Ctrl+Shift+G: ghosts of the selected robot's collision-free move home
+    // (MotionPlanner), timed within its joint limits (TrajectoryTiming) and
+    // spaced evenly in time (TrajectoryGhostComponent), or off again.
+    // Ctrl+Shift+E plays the previewed trajectory on the robot
+    // (TrajectoryPlaybackComponent).
+    std::unique_ptr<MotionPlanner> m_planner;
+    std::vector<double> m_plannedPath, m_plannedTimes;
+    entt::entity m_plannedRobot = entt::null;
+    void toggleTrajectoryGhosts();
+    void executePlannedPath();
+    // Ctrl+Shift+W: the selected robot's workspace (WorkspaceMap), sampled
+    // on this thread and drawn by a Volume mode visualizer placed at its
+    // base. Pressed again, cancels the computation or removes the map.
+    std::thread m_workspaceMap;
+    std::atomic<bool> m_workspaceMapCancel{ false };
+    entt::entity m_workspaceMapEntity = entt::null;
+    void toggleWorkspaceMap();
+    entt::entity selectedRobot();   ///< the selection's robot, else the first; null if none
+    std::unique_ptr<SessionRecorder> m_recorder;
+    std::shared_ptr<SessionPlayback> m_playback;
+    void setupSessionShortcuts();
+    // Self/environment contacts, flagged in the viewports while checking is on.
+    std::unique_ptr<CollisionWorld> m_collision;
+    bool m_collisionChecking = true;
+    // Laser gates, light curtains and keep-out volumes against the robot links.
+    std::unique_ptr<SafetyZoneMonitor> m_safetyZones;
+    void addLaserGate();
+    void onSafetyZoneEvent(entt::entity zone, entt::entity link, bool entered);
+    // Minimum distance from each robot to the environment colliders; the
+    // selected robot's is shown in the status bar.
+    std::unique_ptr<ClearanceMonitor> m_clearance;
+    QLabel* m_clearanceLabel = nullptr;
+    void showClearance();
+
+    // The per-tick logic systems, run in dependency waves; see setupTickSystems().
+    std::unique_ptr<SystemScheduler> m_tickSystems;
+    void setupTickSystems();
+    // F6 overlay of every viewport; fed by onMasterRender().
+    std::unique_ptr<PerfHud> m_perfHud;
+
+    // Robot files are parsed and prepared off the GUI thread; polled once per
+    // tick, and the finished scene delta is committed in one batch.
+    std::unique_ptr<RobotImportJob> m_robotImport;
+    QProgressBar* m_importProgress = nullptr;
+    QToolButton* m_importCancel = nullptr;
+    QString m_importName;
+    std::size_t m_importCommitted = 0;   ///< models of the running import already in the scene
+    void setupImportStatus();
+    bool pollRobotImport();   ///< true once the registry changed
+
+    // Text scans are converted to a cached .kpc on this thread, one at a
+    // time; .kpc files open directly.
+    std::thread m_pointCloudImport;
+    void addPointCloud(const QString& octreePath, const QString& name);
+
+    // Ctrl+S / Ctrl+O: .krscene files (see SceneFile). Opening reads and
+    // decodes on this thread and commits on the GUI thread.
+    std::thread m_sceneLoad;
+    void saveScene();
+    void openScene();
+    // The toolbar's Export button: a .glb of the scene (see GltfExport),
+    // gathered on the GUI thread and written on this one.
+    std::thread m_gltfExport;
+    void exportGltf();
+    // Ctrl+Shift+U / Ctrl+Shift+J: push the project folder to, or pull it
+    // from, the chunk store in KR_SYNC_STORE (see ProjectSync), on this thread.
+    std::thread m_projectSync;
+    QString m_syncFolder;
+    void syncProject(bool upload);
+    // Ctrl+Shift+S writes the scene as a .krworld; opening one streams its
+    // cells around the cameras from the "worldStreaming" tick system.
+    std::unique_ptr<WorldPartition> m_world;
+    void saveWorld();
+    // Ctrl+D: another instance of the selection's hierarchy, sharing one
+    // Prefab with every earlier copy (see Prefab.hpp).
+    void instanceSelection();
+#if KR_PYTHON_ENABLED
+    // Ctrl+Shift+P runs a Python script against the scene between ticks
+    // (see ScriptHost). The interpreter starts on first use.
+    std::unique_ptr<ScriptHost> m_scripts;
+    void runScript();
+#endif
+
+    // The simulated LiDAR entity while the toolbar toggle is down.
+    entt::entity m_simulatedLidar = entt::null;
+    void setSimulatedLidar(bool enabled);
+    // Creates the scene's ReconstructionComponent on first use; turning it
+    // off keeps the surface and stops fusing.
+    void setLiveReconstruction(bool enabled);
+
+    // CAN capture: SocketCAN (can0, then vcan0) where available, otherwise
+    // simulated traffic for the scene's CANopen nodes.
+    CanMonitorPanel* m_canMonitor = nullptr;
+    ads::CDockWidget* m_canMonitorDock = nullptr;
+    void setCanMonitor(bool enabled);
+
+    // The EventLog file, memory-mapped; only reads while shown.
+    EventLogPanel* m_eventLog = nullptr;
+    ads::CDockWidget* m_eventLogDock = nullptr;
+
+    // Entity name search and replace; created on first use.
+    FindReplaceDialog* m_findReplace = nullptr;
+    void showFindReplace();
+
+    // Behind the Outliner tab; created with it.
+    SceneOutlinerModel* m_outlinerModel = nullptr;
+
+    // A LabelComponent with the joint's name on every joint of the robots
+    // in the scene now; re-toggle after loading another.
+    void setJointLabels(bool enabled);
+
+    // Browser streaming of the main viewport; created on first use.
+    RemoteViewServer* m_remoteView = nullptr;
+    void setRemoteView(bool enabled);
+
+    // Digital-twin sync: publish this scene's live state, or mirror another
+    // workstation's onto the same scene loaded here. Created on first use.
+    TwinPublisher* m_twinPublisher = nullptr;
+    TwinMirror* m_twinMirror = nullptr;
+    QString m_twinPublisherAddress;
+    void setTwinSync(bool enabled);
+
     // A pointer to our menu widget
-    FlowVisualizerMenu* m_flowVisualizerMenu;
+    FlowVisualizerMenu* m_flowVisualizerMenu = nullptr;
+    PropertiesPanel* m_propertiesPanel = nullptr;
+
+    /* --- lazy dock content ---
+     * The side panels are built the first time their dock is shown (a tab
+     * selected, a restored layout, toggleView), not at startup; until then
+     * their pointers above are null. ensureDockContent() builds one early. */
+    std::unordered_map<ads::CDockWidget*, std::function<QWidget*()>> m_lazyDocks;
+    void setLazyDockContent(ads::CDockWidget* dock, std::function<QWidget*()> create);
+    void ensureDockContent(ads::CDockWidget* dock);
+
+    // Applies one undo (or redo) step of the scene's history and refreshes
+    // the panels showing the edited components.
+    void stepHistory(bool redo);
 
     std::vector<ViewportWidget*> m_viewports;
 
     QTimer* m_masterRenderTimer;
 
+    /* --- field visualizer settings ---
+     * Menu edits that only reach shader uniforms apply at once. Edits the
+     * renderer reallocates buffers for (mode, density, particle counts)
+     * wait until the menu has been still for kFieldRebuildDelayMs, so a
+     * dragged slider rebuilds once; the old buffers draw until then. */
+    static constexpr int kFieldRebuildDelayMs = 150;
+    QTimer* m_fieldRebuildTimer = nullptr;
+    bool    m_applyingFieldRebuild = false;
+
+    /* --- frame pacing --- */
+    FramePacing   m_framePacing = FramePacing::FixedInterval;
+    int           m_targetFps = 60;
+    QElapsedTimer m_frameClock;          ///< measures the real time between ticks
+    bool          m_sceneDirty = true;   ///< set by UI edits that bounds tracking cannot see
+    bool          m_tickPending = false; ///< VSync mode: a tick is already queued
+    int           m_simulationRate = 60;
+    float         m_simAccumulator = 0.0f;   ///< real time not yet consumed by simulation steps
+    void advanceSimulation(float deltaTime);
+    void startMasterLoop();
+
+    /* --- idle mode ---
+     * After kQuietTicksBeforeIdle ticks with nothing to draw and no live
+     * source (telemetry, command output, import), the master timer stops.
+     * Input, UI edits and registry signals wake it again. */
+    static constexpr int kQuietTicksBeforeIdle = 30;
+    int  m_quietTicks = 0;
+    std::atomic<bool> m_idle{ false };
+    std::atomic<bool> m_registryDirty{ false };   ///< set by registry signals, possibly on a pool worker
+    std::vector<entt::scoped_connection> m_registryWatch;
+    void markSceneDirty();
+    bool hasLiveSources() const;
+    template <class... C> void watchComponents(entt::registry& registry);
+    void onRegistryChanged(entt::registry& registry, entt::entity entity);
+    void wakeMasterLoop();
+
 protected slots:
     void onLoadRobotClicked();
+    void onImportPointCloudClicked();
     void onMasterRender();
+    void onViewportFrameSwapped();
     void onFlowVisualizerTransformChanged();
     void onFlowVisualizerSettingsChanged();
 };
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "GpuResources.hpp"
+#include "TextureStreamer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <qopengl.h>
+
+class QOpenGLFunctions_4_3_Core;
+
+/**
+ * @class MaterialTable
+ * @brief The mesh passes' materials as one SSBO of MaterialGpu records,
+ *        with their maps streamed into two texture arrays.
+ *
+ * The caller clear()s, add()s the materials it will draw and upload()s;
+ * add() returns the record index an instance carries, equal materials share
+ * one record and record 0 is always the default. Maps go through a
+ * TextureStreamer: a record names a map's layer and finest resident level,
+ * so update() returning true (a map arrived or gained a level) means the
+ * records should be built again.
+ *
+ * This stands in for bindless texture handles, which OpenGL 4.3 lacks: one
+ * binding per array covers every material, so a multi-draw mixes them freely.
+ *
+ * The buffer and arrays live in the share group, like MeshArena's.
+ */
+class MaterialTable
+{
+public:
+    using Map = TextureStreamer::Kind;
+
+    explicit MaterialTable(QOpenGLFunctions_4_3_Core* gl = nullptr) : m_gl(gl), m_streamer(gl) {}
+    ~MaterialTable() = default; // GL objects must be freed explicitly via destroy()
+
+    void setFunctions(QOpenGLFunctions_4_3_Core* gl) { m_gl = gl; m_streamer.setFunctions(gl); }
+
+    void clear();
+    // Empty paths are no map.
+    GLuint add(const std::string& albedoMap, const std::string& metalRoughnessMap,
+        float metallic, float roughness, const glm::vec3& emissive);
+    void upload();
+
+    // A mesh with these maps covers about 'pixels' on screen.
+    void request(const std::string& albedoMap, const std::string& metalRoughnessMap, float pixels);
+    // Streams maps in; true when the records are out of date.
+    bool update() { return m_streamer.update(); }
+    // Frees 'bytes' of map memory if it can; for a GpuMemory evictor.
+    std::size_t trim(std::size_t bytes) { return m_streamer.trim(bytes); }
+
+    std::size_t size() const { return m_records.size(); }
+    GLuint buffer() const { return m_buffer; }
+    GLuint texture(Map map) const { return m_streamer.texture(map); }
+
+    // Deletes the buffer and arrays and forgets every map.
+    // A context of the share group must be current.
+    void destroy();
+
+private:
+    QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+    TextureStreamer m_streamer;
+    std::vector<MaterialGpu> m_records;
+    std::unordered_map<std::uint64_t, GLuint> m_recordIndex;   ///< by hash of the record's bytes
+    GLuint m_buffer = 0;
+    GLsizeiptr m_capacity = 0;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <qopengl.h>
+
+class QOpenGLFunctions_4_3_Core;
+struct Vertex;
+struct MeshData;
+
+/**
+ * @class MeshArena
+ * @brief One vertex buffer and one index buffer shared by every mesh.
+ *
+ * Meshes are identified by a content key (see RenderResourceComponent::meshKey)
+ * and receive a (baseVertex, firstIndex) range inside the two big buffers.
+ * Buffer objects are created in the application share group, so every
+ * viewport context reuses the same copy; only the VAO that points at them
+ * is per-context. When a buffer has to grow its name changes and
+ * generation() is bumped so callers can re-point their VAOs.
+ *
+ * Vertices are stored either as the full 32-byte Vertex or, with
+ * VertexLayout::Compact, as a 16-byte PackedVertex (float position plus a
+ * 2_10_10_10 normal; uv is not kept since no arena shader reads it).
+ *
+ * A mesh's coarser MeshData::lods are uploaded with it, right after its
+ * full index list and sharing its vertices; Range::lods names each level.
+ * Its MeshData::clusters go to a third buffer, as ClusterGpu records whose
+ * index ranges are already rebased into the index buffer.
+ */
+class MeshArena
+{
+public:
+    enum class VertexLayout { Full, Compact };
+
+    struct PackedVertex {
+        float position[3];
+        std::uint32_t normal;   ///< GL_INT_2_10_10_10_REV, normalized
+    };
+
+    static constexpr int kMaxLods = 4;
+
+    // One MeshCluster as the cluster culling kernel reads it (48 bytes).
+    struct ClusterGpu {
+        float sphere[4];          ///< object-space centre, radius
+        float cone[4];            ///< axis, cutoff (> 1: none)
+        GLuint firstIndex;        ///< into indexBuffer()
+        GLuint indexCount;
+        GLuint padding[2];
+    };
+
+    struct Lod {
+        GLuint  firstIndex = 0;
+        GLsizei indexCount = 0;
+        float   error = 0.0f;     ///< object-space deviation from lod 0
+    };
+
+    struct Range {
+        GLint   baseVertex = 0;
+        GLuint  firstIndex = 0;   ///< lod 0, the full mesh
+        GLsizei indexCount = 0;
+        GLsizei vertexCount = 0;
+        GLsizei indexSpan = 0;    ///< indices allocated for all levels
+        int     lodCount = 1;
+        Lod     lods[kMaxLods];   ///< lods[0] repeats firstIndex/indexCount
+        GLuint  firstCluster = 0; ///< into clusterBuffer()
+        GLsizei clusterCount = 0; ///< 0 unless the mesh has MeshData::clusters
+    };
+
+    explicit MeshArena(QOpenGLFunctions_4_3_Core* gl = nullptr) : m_gl(gl) {}
+    ~MeshArena() = default; // GL objects must be freed explicitly via destroy()
+
+    void setFunctions(QOpenGLFunctions_4_3_Core* gl) { m_gl = gl; }
+
+    // Takes effect for the next upload; call destroy() first if the arena
+    // already holds meshes in the other layout.
+    void setVertexLayout(VertexLayout layout) { m_layout = layout; }
+    VertexLayout vertexLayout() const { return m_layout; }
+    GLsizei vertexStride() const;   ///< of the stored vertices; decides the VAO format
+
+    // Returns the range for 'key', or nullptr if the mesh was never uploaded.
+    const Range* find(std::size_t key) const;
+
+    // Uploads the mesh and its levels on first use; later calls with the
+    // same key are free. Levels past kMaxLods are not uploaded.
+    const Range& acquire(std::size_t key, const MeshData& mesh);
+
+    // Returns the mesh's ranges to the free lists.
+    void release(std::size_t key);
+
+    // Deletes both buffers. A context of the share group must be current.
+    void destroy();
+
+    GLuint vertexBuffer() const { return m_vertices.buffer; }
+    GLuint indexBuffer() const { return m_indices.buffer; }
+    GLuint clusterBuffer() const { return m_clusters.buffer; }   ///< ClusterGpu[]
+    std::uint32_t generation() const { return m_generation; }
+
+    std::size_t vertexCountInUse() const { return m_vertexUsed; }
+    std::size_t indexCountInUse() const { return m_indexUsed; }
+
+private:
+    struct Block { GLsizei offset; GLsizei size; };
+
+    struct Pool {
+        GLuint buffer = 0;
+        GLenum target = 0;
+        GLsizei elementSize = 0;
+        GLsizei capacity = 0;  ///< in elements
+        GLsizei top = 0;       ///< bump pointer, in elements
+        std::vector<Block> freeList; ///< sorted by offset, adjacent blocks merged
+    };
+
+    GLsizei allocate(Pool& pool, GLsizei count);
+    void    free(Pool& pool, GLsizei offset, GLsizei count);
+    void    grow(Pool& pool, GLsizei required);
+
+    QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+    VertexLayout m_layout = VertexLayout::Full;
+    std::vector<PackedVertex> m_packScratch;
+    std::vector<ClusterGpu> m_clusterScratch;
+    Pool m_vertices;
+    Pool m_indices;
+    Pool m_clusters;
+
+    std::unordered_map<std::size_t, Range> m_ranges;
+    std::uint32_t m_generation = 0;
+    std::size_t m_vertexUsed = 0;
+    std::size_t m_indexUsed = 0;
+};
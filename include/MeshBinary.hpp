@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct MeshData;
+struct ConvexHullSet;
+
+/**
+ * Preprocessed mesh layout ("*.kmesh"), little-endian, every section 8-byte
+ * aligned so the file can be mapped and read in place:
+ *
+ *   FileHeader        counts, bounds, section offsets, source stamp
+ *   positions         uint16 x/y/z per vertex, quantized inside the bounds
+ *   normals           int16 x/y per vertex, octahedral, snorm
+ *   uvs               float u/v per vertex (only if kHasUv)
+ *   indices           uint16 or uint32 (indexSize)
+ *   lods              Lod[lodCount]; lod 0 is the full mesh, then coarser
+ *                     levels over the same vertices (MeshData::lods)
+ *   clusters          Cluster[clusterCount] over lod 0 (MeshData::clusters),
+ *                     built from the quantized positions; version 2 only
+ *
+ * Version 1 files (no clusters) still decode; load() rebuilds its own
+ * cached copies, embedded ones are used as they are.
+ *
+ * A file is tied to the source it was converted from by size, modification
+ * time and import flags; any mismatch makes it stale and it is rebuilt.
+ */
+namespace MeshBinaryFormat
+{
+    constexpr std::uint32_t kMagic = 0x48534D4Bu;   // "KMSH"
+    constexpr std::uint32_t kVersion = 2;
+    constexpr std::uint32_t kMinVersion = 1;
+    constexpr std::uint32_t kHasUv = 1u << 0;
+
+    struct FileHeader {
+        std::uint32_t magic = kMagic;
+        std::uint32_t version = kVersion;
+        std::uint32_t vertexCount = 0;
+        std::uint32_t indexCount = 0;         ///< all levels together
+        std::uint32_t indexSize = 4;          ///< bytes per index: 2 or 4
+        std::uint32_t attributes = 0;         ///< kHasUv
+        std::uint32_t importFlags = 0;        ///< MeshCache::ImportFlags used for the conversion
+        std::uint32_t lodCount = 0;
+        std::int64_t  sourceBytes = 0;
+        std::int64_t  sourceModifiedMs = 0;   ///< ms since the Unix epoch
+        float boundsMin[3] = {};
+        float boundsMax[3] = {};
+        std::uint64_t positionsOffset = 0;
+        std::uint64_t normalsOffset = 0;
+        std::uint64_t uvsOffset = 0;          ///< 0 without kHasUv
+        std::uint64_t indicesOffset = 0;
+        std::uint64_t lodsOffset = 0;
+        std::uint32_t clusterCount = 0;       ///< version 2
+        std::uint32_t reserved = 0;
+        std::uint64_t clustersOffset = 0;
+    };
+    constexpr std::size_t kHeaderSizeV1 = offsetof(FileHeader, clusterCount);
+    struct Lod {
+        std::uint32_t firstIndex = 0;
+        std::uint32_t indexCount = 0;
+        float error = 0.0f;                   ///< object-space deviation from lod 0
+        std::uint32_t reserved = 0;
+    };
+    struct Cluster {
+        float center[3];
+        float radius;
+        float coneAxis[3];
+        float coneCutoff;
+        std::uint32_t firstIndex = 0;         ///< into lod 0
+        std::uint32_t indexCount = 0;
+    };
+
+    // The header of a file of either version; false if too short or not a .kmesh.
+    bool readHeader(const unsigned char* data, std::size_t size, FileHeader& header);
+
+    // Convex decompositions ("*.khull"), keyed by mesh content and
+    // ConvexDecomposition::Params rather than by source file, so every copy
+    // of a mesh shares one:
+    //   HullHeader   counts and the key
+    //   offsets      uint32[hullCount + 1], padded to 8 bytes
+    //   points       float x/y/z per point
+    constexpr std::uint32_t kHullMagic = 0x4C55484Bu;   // "KHUL"
+    constexpr std::uint32_t kHullVersion = 1;
+
+    struct HullHeader {
+        std::uint32_t magic = kHullMagic;
+        std::uint32_t version = kHullVersion;
+        std::uint32_t hullCount = 0;
+        std::uint32_t pointCount = 0;
+        std::uint64_t contentHash = 0;        ///< MeshData::contentHash
+        std::uint64_t paramsKey = 0;          ///< ConvexDecomposition::Params::key()
+    };
+}
+
+namespace MeshBinary
+{
+    struct SourceStamp {
+        std::int64_t bytes = -1;              ///< -1 if the source does not exist
+        std::int64_t modifiedMs = 0;
+    };
+    SourceStamp stampOf(const std::string& sourcePath);
+
+    // Serializes 'mesh' (indices must fit its vertices) into the layout above.
+    std::vector<unsigned char> encode(const MeshData& mesh, const SourceStamp& stamp, std::uint32_t importFlags);
+
+    // Expands an encoded mesh back into float vertices. The bytes may be a
+    // file mapping. False if they are not a valid .kmesh.
+    bool decode(const unsigned char* data, std::size_t size, MeshData& out);
+
+    // Where the preprocessed copy of 'sourcePath' lives: the user cache
+    // directory, named by a hash of the absolute path and the flags.
+    std::string cachePathFor(const std::string& sourcePath, std::uint32_t importFlags);
+
+    // Reads the preprocessed copy if it is current; otherwise imports the
+    // source with Assimp, reorders it and builds levels if asked
+    // (MeshCache::Optimize, MeshCache::GenerateLods), writes
+    // the copy for next time and returns what later reads will return
+    // (positions and normals already quantized).
+    // A current copy is also used when the source no longer exists.
+    // Throws std::runtime_error if the source cannot be imported.
+    void load(const std::string& sourcePath, std::uint32_t importFlags, MeshData& out);
+
+    // Places an encoded mesh (e.g. one embedded in a .krobot) where load()
+    // looks for the preprocessed copy of 'sourcePath', under the flags it
+    // was encoded with. Skipped if the source has changed since; false if
+    // the blob is not a .kmesh or cannot be written.
+    bool install(const std::string& sourcePath, const unsigned char* data, std::size_t size);
+
+    std::vector<unsigned char> encodeHulls(const ConvexHullSet& hulls, std::uint64_t contentHash, std::uint64_t paramsKey);
+    // False unless the bytes are a .khull for exactly this key.
+    bool decodeHulls(const unsigned char* data, std::size_t size, std::uint64_t contentHash, std::uint64_t paramsKey,
+        ConvexHullSet& out);
+
+    // The cached decomposition of a mesh with this content under these
+    // parameters; false if there is none yet.
+    bool loadHulls(std::uint64_t contentHash, std::uint64_t paramsKey, ConvexHullSet& out);
+    void storeHulls(std::uint64_t contentHash, std::uint64_t paramsKey, const ConvexHullSet& hulls);
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct RenderableMeshComponent;
+
+/**
+ * @class BoundsBvh
+ * @brief CPU bounding volume hierarchy over axis-aligned boxes, for ray casts.
+ *
+ * Built with a binned SAH split. It is reused for the per-mesh BLAS (one box
+ * per triangle, mesh-local space) and for the scene TLAS (one box per
+ * entity, world space). Children of an inner node are stored adjacently at
+ * leftOrFirst and leftOrFirst + 1.
+ */
+class BoundsBvh
+{
+public:
+    struct Node {
+        glm::vec3     min;
+        std::uint32_t leftOrFirst;  ///< first child (inner) or first primitive slot (leaf)
+        glm::vec3     max;
+        std::uint32_t count;        ///< 0 for inner nodes
+    };
+
+    static constexpr std::uint32_t kLeafSize = 4;
+
+    void build(const std::vector<glm::vec3>& mins, const std::vector<glm::vec3>& maxs);
+
+    bool empty() const { return m_nodes.empty(); }
+    std::uint32_t depth() const { return m_depth; }   ///< levels below the root
+    const std::vector<std::uint32_t>& primitives() const { return m_prims; }
+
+    // Calls hit(slot, tMax) for every primitive whose box the ray enters
+    // before tMax; primitives()[slot] is the original primitive index.
+    // 'hit' may lower tMax to prune the rest of the walk.
+    template <class HitFn>
+    void raycast(const glm::vec3& origin, const glm::vec3& dir, float& tMax, HitFn&& hit) const;
+
+    // Calls visit(slot) for every leaf primitive whose node boxes all pass
+    // overlaps(min, max); the generic form used for plane and box queries.
+    template <class OverlapFn, class VisitFn>
+    void query(OverlapFn&& overlaps, VisitFn&& visit) const;
+
+private:
+    // Traversal stack: a depth-first walk holds at most depth + 1 nodes.
+    // Trees that fit use 'local'; deeper ones (degenerate input) 'heap'.
+    std::uint32_t* stackFor(std::uint32_t (&local)[64], std::vector<std::uint32_t>& heap) const
+    {
+        if (m_depth < 63) return local;
+        heap.resize(std::size_t(m_depth) + 2);
+        return heap.data();
+    }
+
+    std::vector<Node> m_nodes;
+    std::vector<std::uint32_t> m_prims;  ///< primitive indices in leaf order
+    std::uint32_t m_depth = 0;
+};
+
+// Bottom-level picking structure for one mesh, in mesh-local space.
+// Triangle corners are copied in leaf order so the walk never touches the
+// original vertex/index arrays.
+class MeshBvh
+{
+public:
+    static std::shared_ptr<const MeshBvh> build(const RenderableMeshComponent& mesh);
+
+    // 'dir' need not be normalised; t is returned in units of 'dir', so a
+    // world ray transformed into object space keeps its world-space t.
+    bool raycast(const glm::vec3& origin, const glm::vec3& dir, float& tHit) const;
+
+    // Appends one segment (two points, mesh-local) per triangle crossing the
+    // plane dot(n, x) + w = 0. Only nodes whose box straddles the plane are visited.
+    void slice(const glm::vec4& plane, std::vector<glm::vec3>& segmentPoints) const;
+
+    enum class Feature : std::uint8_t { None, Vertex, Edge, Face };
+    struct Snap {
+        Feature kind = Feature::None;
+        glm::vec3 point{ 0.0f };           ///< mesh-local
+        float distance = 0.0f;             ///< from the query point
+    };
+
+    // Nearest feature within 'radius' of 'p', by rank: the closest corner
+    // if any is that close, else the closest point on an edge, else the
+    // closest surface point. Only nodes whose box the sphere touches are
+    // visited, and once a corner is found the sphere shrinks to it.
+    Snap snap(const glm::vec3& p, float radius) const;
+
+    std::size_t triangleCount() const { return m_corners.size() / 3; }
+
+private:
+    BoundsBvh m_tree;
+    std::vector<glm::vec3> m_corners;  ///< 3 per triangle, indexed by tree leaf slot
+};
+
+// --- Template implementation ---
+
+namespace BvhDetail
+{
+    // Slab test; returns the entry distance or a negative value on a miss.
+    inline float rayBox(const glm::vec3& o, const glm::vec3& invDir, const glm::vec3& mn, const glm::vec3& mx, float tMax)
+    {
+        const glm::vec3 t0 = (mn - o) * invDir;
+        const glm::vec3 t1 = (mx - o) * invDir;
+        const glm::vec3 lo = glm::min(t0, t1), hi = glm::max(t0, t1);
+        const float tNear = glm::max(glm::max(lo.x, lo.y), glm::max(lo.z, 0.0f));
+        const float tFar = glm::min(glm::min(hi.x, hi.y), glm::min(hi.z, tMax));
+        return tNear <= tFar ? tNear : -1.0f;
+    }
+}
+
+template <class HitFn>
+void BoundsBvh::raycast(const glm::vec3& origin, const glm::vec3& dir, float& tMax, HitFn&& hit) const
+{
+    if (m_nodes.empty()) return;
+
+    const glm::vec3 invDir = 1.0f / dir;   // +-inf on zero components is what the slab test wants
+    if (BvhDetail::rayBox(origin, invDir, m_nodes[0].min, m_nodes[0].max, tMax) < 0.0f) return;
+
+    std::uint32_t local[64];
+    std::vector<std::uint32_t> heap;
+    std::uint32_t* stack = stackFor(local, heap);
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = m_nodes[stack[--top]];
+        if (node.count > 0) {
+            for (std::uint32_t i = 0; i < node.count; ++i)
+                hit(node.leftOrFirst + i, tMax);
+            continue;
+        }
+
+        // Near child last so it is popped first.
+        std::uint32_t a = node.leftOrFirst, b = node.leftOrFirst + 1;
+        float ta = BvhDetail::rayBox(origin, invDir, m_nodes[a].min, m_nodes[a].max, tMax);
+        float tb = BvhDetail::rayBox(origin, invDir, m_nodes[b].min, m_nodes[b].max, tMax);
+        if (ta >= 0.0f && tb >= 0.0f && ta < tb) { std::swap(a, b); std::swap(ta, tb); }
+        if (ta >= 0.0f) stack[top++] = a;
+        if (tb >= 0.0f) stack[top++] = b;
+    }
+}
+
+template <class OverlapFn, class VisitFn>
+void BoundsBvh::query(OverlapFn&& overlaps, VisitFn&& visit) const
+{
+    if (m_nodes.empty() || !overlaps(m_nodes[0].min, m_nodes[0].max)) return;
+
+    std::uint32_t local[64];
+    std::vector<std::uint32_t> heap;
+    std::uint32_t* stack = stackFor(local, heap);
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = m_nodes[stack[--top]];
+        if (node.count > 0) {
+            for (std::uint32_t i = 0; i < node.count; ++i) visit(node.leftOrFirst + i);
+            continue;
+        }
+        for (std::uint32_t c = node.leftOrFirst; c < node.leftOrFirst + 2; ++c)
+            if (overlaps(m_nodes[c].min, m_nodes[c].max)) stack[top++] = c;
+    }
+}
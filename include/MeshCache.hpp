@@ -0,0 +1,108 @@
+#pragma once
+
+#include "ConvexDecomposition.hpp"
+#include "components.hpp"
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class MeshCache
+ * @brief Hands out shared, immutable MeshData so each mesh is decoded once.
+ *
+ * load() is keyed by path plus import flags: links of one robot that reuse
+ * an STL, and every further spawn of a robot whose meshes are still alive,
+ * get the handle already decoded. Every mesh is also hashed by content, and
+ * with content deduplication on (the default) a mesh equal to a live one,
+ * e.g. the same file under two names or intern()ed placeholder geometry,
+ * collapses onto the existing handle. The hash doubles as
+ * RenderResourceComponent::meshKey, so equal handles also share one
+ * MeshArena upload.
+ *
+ * Entries are weak: a mesh is freed once no component holds it. All
+ * members are thread-safe; loads of different files run concurrently.
+ */
+class MeshCache
+{
+public:
+    using Handle = std::shared_ptr<const MeshData>;
+
+    enum ImportFlags : unsigned {
+        None = 0,
+        RecalcNormals = 1u << 0,   ///< generate smooth normals
+        Optimize = 1u << 1,        ///< reorder for vertex cache, overdraw and fetch (MeshOptimize)
+        GenerateLods = 1u << 2,    ///< build simplified levels for distant draws
+        Default = RecalcNormals | Optimize | GenerateLods,
+    };
+
+    struct Stats {
+        std::size_t fileHits = 0;      ///< load() answered without reading the file
+        std::size_t fileLoads = 0;     ///< files actually decoded
+        std::size_t contentHits = 0;   ///< new meshes collapsed onto an equal live one
+        std::size_t live = 0;          ///< distinct meshes still referenced
+        std::size_t hullsComputed = 0; ///< decompositions neither in memory nor on disk
+    };
+
+    // Decodes 'path' on first use, from its preprocessed .kmesh copy when
+    // that is current (see MeshBinary::load). Throws std::runtime_error if
+    // it cannot be read.
+    Handle load(const std::string& path, unsigned flags = Default);
+
+    // load() as a task on ThreadPool::shared(); returns at once. The future
+    // is ready immediately for a mesh already in memory and holds load()'s
+    // exception if the file cannot be read.
+    std::shared_future<Handle> loadAsync(const std::string& path, unsigned flags = Default);
+
+    // Wraps geometry built in code (primitives, placeholders).
+    Handle intern(std::vector<Vertex> vertices, std::vector<unsigned> indices);
+
+    // Takes geometry decoded elsewhere (e.g. from a .krscene); hashes it and
+    // dedups by content like every other entry.
+    Handle adopt(MeshData&& data);
+
+    // A live mesh with this contentHash and these counts, or null. Lets a
+    // file that stored the hash skip decoding geometry still in memory.
+    Handle findContent(std::size_t contentHash, std::size_t vertexCount, std::size_t indexCount) const;
+
+    // The convex decomposition of 'mesh' (ConvexDecomposition::decompose)
+    // for collision: shared while held, kept on disk by content hash and
+    // parameters (MeshBinary::loadHulls) and only computed when neither has
+    // it. Runs on the calling thread; two threads asking for the same
+    // missing one may both compute it.
+    std::shared_ptr<const ConvexHullSet> decomposition(const Handle& mesh,
+        const ConvexDecomposition::Params& params = {});
+
+    void setContentDedup(bool enabled);
+    Stats stats() const;
+
+    // FNV-1a over the raw vertex and index bytes; never 0.
+    static std::size_t hashContent(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices);
+
+    // The key everything caching per mesh content uses (MeshArena ranges,
+    // picking BLASes, prefab parts): MeshData::contentHash, or the content
+    // hashed now for a mesh built outside the cache or edited since, whose
+    // contentHash is 0. Never 0.
+    static std::size_t keyOf(const MeshData& data)
+    {
+        return data.contentHash ? data.contentHash : hashContent(data.vertices, data.indices);
+    }
+
+    // Process-wide cache, created on first use.
+    static MeshCache& shared();
+
+private:
+    void pruneLocked();
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, std::weak_ptr<const MeshData>> m_byFile;         ///< path + '|' + flags
+    std::unordered_multimap<std::size_t, std::weak_ptr<const MeshData>> m_byContent; ///< by contentHash
+    std::unordered_map<std::uint64_t, std::weak_ptr<const ConvexHullSet>> m_hulls;   ///< by contentHash and params
+    std::size_t m_insertsSincePrune = 0;
+    bool m_contentDedup = true;
+    Stats m_stats;
+};
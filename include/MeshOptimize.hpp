@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct Vertex;
+struct MeshData;
+
+// Import-time reordering of triangle lists for the GPU. None of these change
+// what is drawn, only the order: run them once per mesh (MeshBinary::load
+// does, so the result is cached on disk) and never per frame.
+namespace MeshOptimize
+{
+    // Reorders triangles for post-transform cache hits (Forsyth's linear-speed algorithm).
+    void optimizeVertexCache(std::vector<unsigned>& indices, std::size_t vertexCount);
+
+    // Reorders clusters of the cache-optimized order so outward-facing
+    // clusters come first and occlude the rest, costing at most 'threshold'
+    // times the cache miss ratio (Sander et al., "Fast triangle reordering").
+    void optimizeOverdraw(std::vector<unsigned>& indices, const std::vector<Vertex>& vertices,
+        float threshold = 1.05f);
+
+    // Renumbers vertices in order of first use and drops unused ones, so the
+    // vertex fetch walks memory forwards.
+    void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned>& indices);
+
+    // All three, in order.
+    void optimize(MeshData& mesh);
+
+    // Quadric-error edge collapse down to about 'targetIndexCount' indices.
+    // Vertices are kept where they are, so the result indexes 'vertices'
+    // unchanged; 'error' receives the largest object-space deviation.
+    std::vector<unsigned> simplify(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices,
+        std::size_t targetIndexCount, float* error = nullptr);
+
+    // Fills mesh.lods with a chain of halvings of mesh.indices, up to
+    // 'maxLevels' including the full mesh, each cache-optimized.
+    void generateLods(MeshData& mesh, std::size_t maxLevels = 4);
+
+    // Meshes below this many triangles get no clusters: per entity culling suffices.
+    constexpr std::size_t kMinClusteredTriangles = 1u << 16;
+
+    // Splits mesh.indices, in their current order, into runs of at most
+    // 'maxVertices' distinct vertices and 'maxTriangles' triangles, each with
+    // a bounding sphere. Closed, outward-wound meshes also get a cone of each
+    // run's face normals, so a run facing away can be skipped whole.
+    void buildClusters(MeshData& mesh, std::size_t maxVertices = 64, std::size_t maxTriangles = 124);
+
+    // Average cache misses per triangle for a FIFO cache of 'cacheSize' (0.5 is ideal, 3 the worst).
+    float acmr(const std::vector<unsigned>& indices, std::size_t vertexCount, unsigned cacheSize = 16);
+}
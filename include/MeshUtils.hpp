@@ -4,38 +4,58 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <glm/vec3.hpp>  
+#include <cstddef>
+#include <stdexcept>
+#include <string>
 
-inline void loadStlIntoRenderable(const std::string& path,
-    RenderableMeshComponent& meshOut,
+// Reads every mesh in 'path' (any format Assimp reads) into one MeshData,
+// leaving contentHash alone. Each thread uses its own importer, so reads may
+// run concurrently. Throws std::runtime_error on failure. Prefer
+// MeshCache::load(), which reads each file once.
+inline void loadMeshFile(const std::string& path,
+    MeshData& meshOut,
     bool recalcNormals = true)
 {
-    static Assimp::Importer importer;
+    // Assimp::Importer is not thread-safe and keeps the last scene alive
+    // until the next ReadFile(); one per thread avoids both problems.
+    thread_local Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(
         path,
         aiProcess_Triangulate |
         aiProcess_JoinIdenticalVertices |
-        aiProcess_GenSmoothNormals);
+        (recalcNormals ? aiProcess_GenSmoothNormals : 0));
 
     if (!scene || !scene->HasMeshes())
         throw std::runtime_error("Failed to load " + path);
 
-    const aiMesh* m = scene->mMeshes[0];
-    meshOut.vertices.resize(m->mNumVertices);
+    std::size_t vertexCount = 0, indexCount = 0;
+    for (unsigned mi = 0; mi < scene->mNumMeshes; ++mi) {
+        vertexCount += scene->mMeshes[mi]->mNumVertices;
+        indexCount += std::size_t(scene->mMeshes[mi]->mNumFaces) * 3;
+    }
+    meshOut.vertices.clear();
+    meshOut.indices.clear();
+    meshOut.vertices.reserve(vertexCount);
+    meshOut.indices.reserve(indexCount);
 
-    for (unsigned i = 0; i < m->mNumVertices; ++i) {
-        meshOut.vertices[i].position = glm::vec3(      // ← changed
-            m->mVertices[i].x,
-            m->mVertices[i].y,
-            m->mVertices[i].z);
+    for (unsigned mi = 0; mi < scene->mNumMeshes; ++mi) {
+        const aiMesh* m = scene->mMeshes[mi];
+        const unsigned base = static_cast<unsigned>(meshOut.vertices.size());
 
-        meshOut.vertices[i].normal = glm::vec3(      // ← changed
-            m->mNormals[i].x,
-            m->mNormals[i].y,
-            m->mNormals[i].z);
-    }
+        for (unsigned i = 0; i < m->mNumVertices; ++i) {
+            Vertex v{};
+            v.position = glm::vec3(m->mVertices[i].x, m->mVertices[i].y, m->mVertices[i].z);
+            if (m->HasNormals())
+                v.normal = glm::vec3(m->mNormals[i].x, m->mNormals[i].y, m->mNormals[i].z);
+            if (m->HasTextureCoords(0))
+                v.uv = glm::vec2(m->mTextureCoords[0][i].x, m->mTextureCoords[0][i].y);
+            meshOut.vertices.push_back(v);
+        }
 
-    meshOut.indices.reserve(m->mNumFaces * 3);
-    for (unsigned f = 0; f < m->mNumFaces; ++f)
-        for (unsigned k = 0; k < 3; ++k)
-            meshOut.indices.push_back(m->mFaces[f].mIndices[k]);
-}
\ No newline at end of file
+        for (unsigned f = 0; f < m->mNumFaces; ++f) {
+            if (m->mFaces[f].mNumIndices != 3) continue;   // points and lines survive triangulation
+            for (unsigned k = 0; k < 3; ++k)
+                meshOut.indices.push_back(base + m->mFaces[f].mIndices[k]);
+        }
+    }
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "KinematicModel.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <entt/entity/entity.hpp>
+#include <entt/fwd.hpp>
+
+class CollisionWorld;
+
+/**
+ * @class MotionPlanner
+ * @brief Collision-free joint-space paths for one robot through
+ *        CollisionWorld: a lazy roadmap (PRM) reused across queries, and
+ *        RRT-Connect for what the roadmap cannot answer.
+ *
+ * A query tries, in order:
+ *  - The straight segment from start to goal.
+ *  - The robot's roadmap: Settings::roadmapNodes collision-free samples,
+ *    each joined to its k nearest. Edges are not checked when they are
+ *    made. A* finds the shortest path over the edges not known to be
+ *    blocked, and only that path's unchecked edges are then tested. The
+ *    search repeats until a path is free or none is left (Lazy PRM).
+ *    Start, goal and every RRT-Connect solution join the roadmap, so
+ *    queries between stations that come up again get answered from it.
+ *  - RRT-Connect in the remaining time, growing trees from both ends. An
+ *    extension goes a stepSize towards a random sample. A connect goes all
+ *    the way to the other tree's new node. Both check their whole segment
+ *    at once and keep its longest free prefix.
+ * A found path is shortcut, then checked once more end to end.
+ *
+ * Segments are checked as configurations at most edgeResolution apart. All
+ * configurations of one step (a segment, or every unchecked edge of a
+ * roadmap path) go to one CollisionWorld::validateTrajectory() call, which
+ * poses them with forwardBatch() and tests them across the thread pool.
+ * Nearest neighbours come from a k-d tree over the configurations
+ * (ConfigurationIndex). It is built incrementally, and random samples keep
+ * it balanced enough.
+ *
+ * A roadmap is kept per robot and is thrown away when the robot's model,
+ * its base pose or CollisionWorld::environmentVersion() changes. Other
+ * robots are not part of that key. Edges they block are found by the
+ * final check, which then forgets the roadmap's edge results and runs the
+ * query once more.
+ *
+ * GUI thread only, between ticks, like validateTrajectory(). Distances are
+ * Euclidean in joint coordinates (rad and m alike). Joints without limits
+ * are sampled over one turn (revolute) or +-1 m (prismatic).
+ */
+class MotionPlanner
+{
+public:
+    struct Settings {
+        double edgeResolution = 0.03;     ///< largest joint step between checked configurations
+        double stepSize = 0.4;            ///< RRT-Connect extension length
+        int    roadmapNodes = 600;        ///< samples drawn for a new roadmap
+        int    neighbours = 8;            ///< roadmap edges per node
+        int    shortcutAttempts = 40;
+        std::chrono::milliseconds timeLimit{ 500 };
+        std::uint64_t seed = 1;
+    };
+
+    enum class Method { None, Direct, Roadmap, RrtConnect };
+
+    struct Result {
+        bool success = false;
+        Method method = Method::None;
+        std::vector<double> path;         ///< waypoints of dofCount() values each, start and goal included
+        std::size_t waypoints = 0;
+        std::size_t checked = 0;          ///< configurations collision-checked
+        std::size_t roadmapNodes = 0;     ///< in the robot's roadmap afterwards
+        double milliseconds = 0.0;
+        std::string error;
+    };
+
+    MotionPlanner();
+    ~MotionPlanner();
+
+    void setSettings(const Settings& settings) { m_settings = settings; }
+    const Settings& settings() const { return m_settings; }
+
+    // A path for the robot whose root link is 'robot' from 'start' to
+    // 'goal' (dofCount() values each). 'collision' must have been updated
+    // with the scene this tick.
+    Result plan(entt::registry& registry, CollisionWorld& collision, entt::entity robot,
+        const double* start, const double* goal);
+
+    // Drops every cached roadmap.
+    void clear();
+
+    // Length of 'path' ('dofs' values per waypoint) measured by the largest
+    // joint move of each segment, and the configuration 'along' that far
+    // into it by the same measure. Used to play a path back at a joint speed.
+    static double pathLength(const std::vector<double>& path, std::size_t dofs);
+    static void samplePath(const std::vector<double>& path, std::size_t dofs, double along, double* q);
+
+    /**
+     * @class ConfigurationIndex
+     * @brief Insert-only k-d tree over configurations, for nearest-neighbour queries.
+     */
+    class ConfigurationIndex
+    {
+    public:
+        ConfigurationIndex() = default;
+        explicit ConfigurationIndex(std::size_t dims) : m_dims(dims) {}
+
+        std::uint32_t add(const double* q);   ///< 'q' must not point into this index
+        const double* at(std::uint32_t i) const { return &m_points[std::size_t(i) * m_dims]; }
+        std::size_t size() const { return m_nodes.size(); }
+        std::size_t dims() const { return m_dims; }
+
+        std::uint32_t nearest(const double* q) const;   ///< the index must not be empty
+        // The k nearest, closest first, leaving out 'skip'.
+        void nearest(const double* q, std::size_t k, std::vector<std::uint32_t>& out,
+            std::uint32_t skip = kNone) const;
+
+        static constexpr std::uint32_t kNone = ~0u;
+
+    private:
+        struct Node {
+            std::uint32_t left = kNone, right = kNone;
+            std::uint32_t axis = 0;
+        };
+        double distanceSquared(const double* q, std::uint32_t i) const;
+
+        std::size_t m_dims = 0;
+        std::vector<double> m_points;
+        std::vector<Node> m_nodes;
+    };
+
+private:
+    enum class EdgeState : std::uint8_t { Unknown, Free, Blocked };
+
+    struct Edge {
+        std::uint32_t to;
+        float length;
+        EdgeState state;
+    };
+
+    struct Roadmap {
+        std::shared_ptr<const KinematicModel> model;
+        std::uint64_t environmentVersion = 0;
+        KinematicModel::Pose base;
+        ConfigurationIndex nodes;
+        std::vector<std::vector<Edge>> edges;   ///< both directions, states kept alike
+    };
+
+    struct Query;
+
+    bool roadmapValid(const Roadmap& roadmap, const Query& query) const;
+    void buildRoadmap(Roadmap& roadmap, Query& query);
+    // Adds 'q' with unchecked edges to its nearest nodes.
+    std::uint32_t addRoadmapNode(Roadmap& roadmap, const double* q);
+    // Sets the edge between two nodes, adding it if there is none.
+    void setEdgeState(Roadmap& roadmap, std::uint32_t a, std::uint32_t b, EdgeState state);
+    bool searchRoadmap(Roadmap& roadmap, Query& query, std::uint32_t start, std::uint32_t goal,
+        std::vector<std::uint32_t>& nodes);
+    // 'path' holds the start and the goal on entry and the path on success.
+    bool rrtConnect(Query& query, std::vector<double>& path);
+    void shortcut(Query& query, std::vector<double>& path);
+
+    Settings m_settings;
+    std::mt19937_64 m_random;
+    std::unordered_map<entt::entity, Roadmap> m_roadmaps;
+};
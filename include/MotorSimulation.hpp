@@ -0,0 +1,132 @@
+#pragma once
+
+#include "JointCommandLoop.hpp"
+#include "RobotDescription.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <entt/fwd.hpp>
+
+class SessionRecorder;
+
+/**
+ * @class MotorSimulation
+ * @brief Drive electronics, motor and gearbox of every joint of one robot, at 10-20 kHz.
+ *
+ * Each joint is a servo drive's cascade in front of a DC motor model:
+ *
+ *   position PID -> velocity PID -> torque PID -> voltage
+ *   L di/dt = V - R i - Ke N qd              (terminal_inductance, _resistance)
+ *   J qdd   = eta N Kt i - g - friction      (gear_reduction, transmission_efficiency)
+ *
+ * A JointCommand enters the cascade at its mode's loop (DUTY_CYCLE sets the
+ * voltage as a fraction of max_voltage). Every loop computes
+ * p e + i ∫e - d d(measured)/dt + feed_forward * setpoint, so steps do not
+ * kick the derivative; the integral term stays within [i_min, i_max] when
+ * those differ. A loop whose gains are all zero is skipped: the position
+ * loop then outputs torque directly, and the torque loop is replaced by the
+ * inverse model V = R i* + Ke N qd. A motor with neither R nor L is an
+ * ideal current source.
+ *
+ * Joints are decoupled. fromRobot() reflects the load through
+ * RigidBodyDynamics at the robot's current pose: J is the mass matrix
+ * diagonal plus the joint armature, and g the gravity torque there, both
+ * held constant. That is the usual tuning model; for coupled motion under
+ * the same commands use DynamicsSimulation.
+ *
+ * State lives in one array per quantity, and step() is one pass over all
+ * joints per step in which modes and model variants are selects rather
+ * than branches, so the compiler vectorizes it across joints. The
+ * electrical pole is integrated exactly (exp(-R dt / L) is precomputed),
+ * which stays stable at any rate.
+ */
+class MotorSimulation
+{
+public:
+    struct Joint {
+        std::string name;
+        MotorProperties motor;
+        PIDParameters positionPid, velocityPid, torquePid;
+        JointLimits limits;
+        double gearReduction = 1.0;
+        double efficiency = 1.0;
+        double staticFriction = 0.0;
+        double dynamicFriction = 0.0;
+        double inertia = 1e-3;        ///< at the joint side, rotor included (kg m^2 or kg)
+        double gravity = 0.0;         ///< constant load torque (force) at the joint
+    };
+
+    explicit MotorSimulation(std::vector<Joint> joints);
+
+    // Every moving joint of 'root', with the load reflected at its current
+    // joint positions. Null if 'root' is not a robot with moving joints.
+    static std::unique_ptr<MotorSimulation> fromRobot(const entt::registry& registry, entt::entity root);
+
+    std::size_t jointCount() const { return m_joints.size(); }
+    const Joint& joint(std::size_t index) const { return m_joints[index]; }
+
+    void setRate(double hz);
+    double rate() const { return m_rateHz; }
+    double time() const { return m_time; }
+
+    // Rest at 'q' (one per joint; null for the joint limits' midpoints),
+    // every controller cleared, every joint INACTIVE.
+    void reset(const double* q = nullptr);
+    void setCommand(std::size_t joint, const JointCommand& command);
+    // Every joint in POSITION mode holding where it is.
+    void holdPosition();
+
+    void step(std::size_t steps = 1);
+
+    const std::vector<double>& position() const { return m_q; }
+    const std::vector<double>& velocity() const { return m_qd; }
+    const std::vector<double>& effort() const { return m_effort; }     ///< at the joint, after efficiency
+    const std::vector<double>& current() const { return m_i; }
+    const std::vector<double>& voltage() const { return m_v; }
+
+    // Steps for 'seconds' and appends every 'decimation'-th step of every
+    // joint to 'recorder' as "<joint>/position", "/velocity", "/effort"
+    // (which SessionPlayback replays), "/current", "/voltage" and
+    // "/setpoint", stamped 'startNs' plus the simulated time. Returns false
+    // if 'cancel' was raised first.
+    bool record(SessionRecorder& recorder, double seconds, std::size_t decimation, std::int64_t startNs,
+        const std::atomic<bool>* cancel = nullptr);
+
+private:
+    /// One PID per joint.
+    struct Loop {
+        std::vector<double> p, i, d, feedForward;
+        std::vector<double> low, high;           ///< integral term bounds, infinite when unset
+        std::vector<double> active;              ///< 1 if any gain is set
+        std::vector<double> integral;
+    };
+
+    void updateElectrical();
+
+    std::vector<Joint> m_joints;
+    double m_rateHz = 20000.0;
+    double m_time = 0.0;
+
+    // Per joint, from the description.
+    Loop m_position, m_velocity, m_torque;
+    std::vector<double> m_resistance, m_maxVoltage, m_peakCurrent, m_effortLimit;
+    std::vector<double> m_torquePerAmp;          ///< eta N Kt: joint torque per motor amp while driving
+    std::vector<double> m_efficiency, m_emfPerSpeed;   ///< eta; N Ke
+    std::vector<double> m_inverseInertia, m_gravity, m_staticFriction, m_dynamicFriction;
+    std::vector<double> m_lower, m_upper;        ///< equal when unlimited
+    // Per joint, from the description and the rate.
+    std::vector<double> m_ideal;                 ///< 1 for an ideal current source (no R, no L)
+    std::vector<double> m_decay, m_admittance;   ///< i' = decay i + admittance (V - emf)
+
+    // Per joint, command.
+    std::vector<double> m_mode;                  ///< 0 position, 1 velocity, 2 torque, 3 duty, 4 off
+    std::vector<double> m_setpoint, m_feedForward;
+
+    // Per joint, state.
+    std::vector<double> m_q, m_qd, m_i, m_v, m_effort;
+    std::vector<double> m_qdd, m_di;             ///< last step's derivatives, for the D terms
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <entt/fwd.hpp>
+#include <entt/entity/entity.hpp>
+
+/**
+ * @class NameIndex
+ * @brief Case-insensitive substring search over every TagComponent, through
+ *        a trigram index kept in the registry context.
+ *
+ * of() creates the index on first use and connects it to TagComponent's
+ * construct, update and destroy signals. Those only queue the entity; the
+ * queue is folded in at the next find(), so loading a plant costs one
+ * indexing pass at the first search rather than work per emplace. Tags
+ * edited in place without registry.patch() or replace() are not seen.
+ *
+ * A query of three or more characters walks the shortest posting list of
+ * its trigrams and checks each candidate's name; shorter ones scan every
+ * name. Either way find() stops at its cap and the Cursor resumes from
+ * there, so results arrive a page at a time. GUI thread only.
+ */
+class NameIndex
+{
+public:
+    // Where a search got to; reset by assigning a fresh Cursor.
+    struct Cursor {
+        std::string query;
+        std::uint32_t next = 0;              ///< first slot not yet looked at
+        bool done = false;
+    };
+
+    static NameIndex& of(entt::registry& registry);
+
+    explicit NameIndex(entt::registry& registry) : m_registry(registry) {}
+
+    // Appends up to 'cap' more entities whose tag contains cursor.query to
+    // 'out', in index order; returns how many. Sets cursor.done at the end.
+    std::size_t find(Cursor& cursor, std::size_t cap, std::vector<entt::entity>& out);
+
+    // Every case-insensitive occurrence of 'query' in the tags of
+    // 'entities' (e.g. find()'s results) replaced, in one pass with
+    // registry.patch(). Returns the number of tags changed.
+    std::size_t replace(const std::vector<entt::entity>& entities, const std::string& query,
+        const std::string& replacement);
+
+    std::size_t size() { flush(); return m_entities.size() - m_free.size(); }
+
+    // Queues an entity whose tag appeared, changed or went away.
+    void touch(entt::entity entity) { m_pending.push_back(entity); }
+
+private:
+    void flush();
+    void add(entt::entity entity, const std::string& tag);
+    void remove(entt::entity entity);
+    bool matches(std::uint32_t slot, const std::string& query) const;
+
+    static std::uint32_t trigram(const char* p)
+    {
+        return std::uint32_t(std::uint8_t(p[0])) | std::uint32_t(std::uint8_t(p[1])) << 8
+            | std::uint32_t(std::uint8_t(p[2])) << 16;
+    }
+
+    entt::registry& m_registry;
+    std::vector<entt::entity> m_entities;    ///< per slot; null for a free one
+    std::vector<std::string> m_names;        ///< per slot, lower-cased
+    std::vector<std::uint32_t> m_free;
+    std::unordered_map<entt::entity, std::uint32_t> m_slotOf;
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> m_postings;   ///< trigram -> ascending slots
+    std::vector<entt::entity> m_pending;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <entt/entt.hpp>
+#include <qopengl.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+class QImage;
+class QOffscreenSurface;
+class QOpenGLContext;
+class QOpenGLFunctions_4_3_Core;
+class RenderingSystem;
+
+/**
+ * @class OffscreenRenderer
+ * @brief Renders a scene without a window, for batch image and video output.
+ *
+ * Owns a QOffscreenSurface, a context in the application's share group (or
+ * a standalone one when no widget exists) and an FBO of the output size.
+ * Each frame goes through RenderingSystem::renderView() with this object as
+ * the render target id and the FBO as the composite target, so it looks
+ * exactly like a viewport.
+ *
+ * Pixels come back through a ring of fenced pixel-pack buffers: a frame is
+ * handed to the sink a couple of frames after it was drawn, and the CPU only
+ * waits when the ring is full. Frames are never dropped and arrive in order,
+ * top row first. Without a display, run with QT_QPA_PLATFORM=offscreen (or
+ * eglfs) so the surface can be created.
+ *
+ * Must be created and used on the GUI thread.
+ */
+class OffscreenRenderer
+{
+public:
+    using FrameSink = std::function<void(const QImage& frame, std::uint64_t frameIndex)>;
+
+    explicit OffscreenRenderer(RenderingSystem& renderer);
+    ~OffscreenRenderer();
+
+    // Creates the context, surface and output FBO. Returns false if no
+    // GL 4.3 context is available.
+    bool create(int width, int height);
+    void setFrameSink(FrameSink sink) { m_sink = std::move(sink); }
+    /// Without readback frames are drawn and fenced but never copied back or
+    /// handed to the sink (the ring still bounds the frames in flight): for
+    /// timing runs, where the copy would skew the numbers.
+    void setReadbackEnabled(bool on) { m_readback = on; }
+
+    /// Advances the renderer's frame and simulation clocks by 'frameTime'
+    /// (fixed, so output runs as fast as the GPU allows and independent of
+    /// wall time), draws 'cameraEntity''s view and queues its readback. The
+    /// caller updates the scene logic for the frame first.
+    void renderFrame(entt::registry& registry, entt::entity cameraEntity, float frameTime);
+    /// Blocks until every queued frame has reached the sink.
+    void finish();
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    std::uint64_t framesRendered() const { return m_nextFrame; }
+
+private:
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        std::uint64_t frame = 0;
+    };
+    static constexpr int kSlots = 3;
+
+    bool makeCurrent();
+    void queueReadback();
+    bool deliverOldest(bool block);   ///< false if nothing was ready
+    void destroy();
+
+    RenderingSystem& m_renderer;
+    std::unique_ptr<QOffscreenSurface> m_surface;
+    std::unique_ptr<QOpenGLContext> m_context;
+    QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+    FrameSink m_sink;
+    bool m_readback = true;
+
+    int m_width = 0, m_height = 0;
+    GLuint m_outputFBO = 0;
+    GLuint m_outputTexture = 0;       ///< sRGB, like a viewport's default framebuffer
+
+    Slot m_slots[kSlots];
+    int m_head = 0;                   ///< slot that receives the next frame
+    int m_pending = 0;                ///< queued slots, oldest at m_head - m_pending
+    std::uint64_t m_nextFrame = 0;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+
+#include <vector>
+
+/*------------------------------------------------------------------
+ *  PerfGate – did a benchmark get slower than its baseline?
+ *
+ *  Each timing (a microbenchmark kernel, a frame, a render pass) is
+ *  compared as two sample sets: the baseline's repetitions and the
+ *  current ones. It regresses when both hold:
+ *    - the median grew by more than 'tolerance' (0.1 = 10 %), and
+ *    - a one-sided Mann-Whitney U test says the current samples are
+ *      larger with p below 'alpha'.
+ *  The test keeps noise from failing the gate, the tolerance keeps a
+ *  real but tiny shift on a quiet machine from failing it. With fewer
+ *  than 'minSamples' on either side there is nothing to test, and
+ *  the median change decides alone. Improvements are the mirror
+ *  image and never fail.
+ *
+ *  Baselines are per machine: a timing is only comparable with one
+ *  taken on the same host and hardware, so they live under
+ *  <dir>/<machineKey>/ and the first run on a new machine records
+ *  instead of comparing.
+ *-----------------------------------------------------------------*/
+namespace PerfGate
+{
+    struct Thresholds {
+        double tolerance = 0.1;
+        double alpha = 0.01;
+        int minSamples = 5;
+    };
+
+    enum class Verdict { Unchanged, Regressed, Improved, Missing, Added };
+    const char* verdictName(Verdict verdict);
+
+    struct Comparison {
+        QString name;
+        Verdict verdict = Verdict::Unchanged;
+        double baselineMedian = 0.0;
+        double currentMedian = 0.0;
+        double change = 0.0;            ///< current / baseline median - 1
+        double pValue = -1.0;           ///< of the direction of 'change'; -1 = not tested
+        int baselineSamples = 0;
+        int currentSamples = 0;
+    };
+
+    // One-sided p of "b tends to be larger than a": normal approximation
+    // with tie correction and continuity correction. 1 if either is empty.
+    double mannWhitneyGreater(const std::vector<double>& a, const std::vector<double>& b);
+    double median(std::vector<double> values);
+
+    // Missing if 'current' is empty, Added if 'baseline' is.
+    Comparison compare(const QString& name, const std::vector<double>& baseline, const std::vector<double>& current,
+        const Thresholds& thresholds);
+
+    // {"verdict": "pass"/"fail", "machine", "thresholds", counts, "results": [...]},
+    // regressions first, then by change. Logs the same as a table.
+    QJsonObject verdictReport(std::vector<Comparison> comparisons, const Thresholds& thresholds,
+        const QString& machine);
+    bool passed(const QJsonObject& verdictReport);
+
+    // Host name plus 'hardware' (a GPU or CPU description), reduced to
+    // [A-Za-z0-9_-] for use as a directory name.
+    QString machineKey(const QString& hardware);
+    // <dir>/<machine>/<name>, creating the machine directory.
+    QString baselinePath(const QString& dir, const QString& machine, const QString& name);
+
+    bool writeJson(const QString& path, const QJsonObject& object);
+    QJsonObject readJson(const QString& path);   ///< empty on error
+}
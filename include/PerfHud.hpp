@@ -0,0 +1,102 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+#include <entt/fwd.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class QPainter;
+class QRect;
+class ComputeDispatch;
+class GpuProfiler;
+class SystemScheduler;
+
+/**
+ * @class PerfHud
+ * @brief Rolling per-tick performance history for the F6 viewport overlay.
+ *
+ * MainWindow feeds it once per master tick: beginTick() at the start,
+ * mark() after each step of the tick, endTick() with the scheduler once the
+ * tick systems ran. Each viewport adds its GPU frame time when it paints and
+ * draws the HUD over its finished image with QPainter, like the F3 overlay.
+ *
+ * Graphs cover the last kHistory ticks: frame interval, tick CPU time, GPU
+ * time, draw calls, primitives, compute dispatches and upload bytes (the
+ * RenderStats deltas of the tick). Below them, the last and peak time of
+ * every tick step and tick system, the viewport's GPU passes, the field
+ * compute kernels' workgroup size and per-dispatch cost, and the
+ * largest component pools, recounted every kCountRefreshTicks ticks.
+ * Real-time loops (joint commands, EtherCAT) report their cycle counts,
+ * wake-up jitter and missed cycles through setCyclic().
+ *
+ * Hidden, every call returns at once. GUI thread only.
+ */
+class PerfHud
+{
+public:
+    static constexpr int kHistory = 240;
+    static constexpr int kCountRefreshTicks = 15;
+    static constexpr int kComponentRows = 10;
+
+    bool visible() const { return m_visible; }
+    void setVisible(bool on);
+
+    void beginTick();
+    // CPU time since beginTick() or the previous mark(), under 'step'.
+    void mark(const char* step);
+    void endTick(const entt::registry& registry, const SystemScheduler& systems);
+
+    // GPU time of a viewport's newest harvested frame.
+    void recordGpu(const void* viewport, double gpuMs);
+
+    // Totals of one real-time loop, as its thread last published them.
+    struct Cyclic {
+        const char* name = "";
+        std::uint64_t cycles = 0;
+        double meanUs = 0.0, maxUs = 0.0;    ///< wake-up lateness
+        std::uint64_t overruns = 0;          ///< deadlines skipped
+        std::uint64_t missed = 0;            ///< frames lost on the bus
+    };
+    // Replaces the rows; call while visible, once per tick.
+    void setCyclic(const Cyclic* loops, std::size_t count) { m_cyclic.assign(loops, loops + count); }
+
+    void paint(QPainter& painter, const QRect& area, const void* viewport, const GpuProfiler* profiler,
+        const ComputeDispatch* compute = nullptr) const;
+
+private:
+    using Series = std::array<float, kHistory>;
+
+    struct Step {
+        std::string name;
+        Series ms{};
+    };
+
+    void record(const std::string& name, double ms);
+    // 'lag' 1 ends the graph at the previous tick, for values that are only
+    // complete once the next tick begins.
+    void paintGraph(QPainter& painter, const QRect& box, const QString& label, const Series& series,
+        int lag, const char* unit) const;
+
+    bool m_visible = false;
+    int m_head = 0;                          ///< column of the current tick
+    int m_ticks = 0;
+    QElapsedTimer m_frameClock;
+    QElapsedTimer m_stepClock;
+    QElapsedTimer m_tickClock;
+
+    Series m_frameMs{}, m_tickMs{};
+    Series m_draws{}, m_primitives{}, m_dispatches{}, m_uploadKb{};
+    std::unordered_map<const void*, Series> m_gpuMs;
+    std::vector<Step> m_steps;               ///< tick steps, then tick systems, first-seen order
+
+    std::uint64_t m_lastDraws = 0, m_lastPrimitives = 0, m_lastDispatches = 0, m_lastUploadBytes = 0;
+    std::vector<std::pair<QString, std::size_t>> m_components;
+    std::vector<Cyclic> m_cyclic;
+    std::size_t m_entities = 0;
+};
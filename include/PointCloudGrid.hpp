@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+class PointCloudOctree;
+
+/**
+ * @class PointCloudGrid
+ * @brief Hashed uniform grid for nearest-point queries within a fixed radius.
+ *
+ * Cells are half the radius, so the nearest point within the radius always
+ * lies in the 5^3 cells around the query; the search walks them ring by ring
+ * and stops after the first ring that cannot hold anything closer, which on
+ * a surface is usually the first or second. Cells hash into a power-of-two
+ * bucket table stored CSR-style (bucketStart has bucketMask + 2 entries,
+ * points are sorted by bucket), the same layout the field compute shaders
+ * read, so the cost per query does not depend on the cloud's size.
+ *
+ * Built in the cloud's own space; immutable once built and safe to query
+ * from any thread.
+ */
+class PointCloudGrid
+{
+public:
+    static constexpr int kSearchRings = 2;                  ///< radius / cellSize
+    static constexpr std::size_t kMaxPoints = 1u << 21;     ///< octree subsample budget
+
+    PointCloudGrid(const std::vector<glm::vec3>& points, float radius);
+
+    // Subsamples 'octree' at about a quarter of 'radius' using its additive
+    // levels (coarsest first, at most kMaxPoints) and grids the result.
+    static std::shared_ptr<const PointCloudGrid> fromOctree(const PointCloudOctree& octree, float radius);
+
+    // fromOctree, cached: one grid per open octree, rebuilt when the radius
+    // changes and dropped once the octree is gone.
+    static std::shared_ptr<const PointCloudGrid> shared(const std::shared_ptr<const PointCloudOctree>& octree, float radius);
+
+    // Closest point strictly within radius() of 'p', if any.
+    bool nearest(const glm::vec3& p, glm::vec3& out) const;
+
+    static std::uint32_t hashCell(const glm::ivec3& cell, std::uint32_t mask)
+    {
+        return (std::uint32_t(cell.x) * 73856093u ^ std::uint32_t(cell.y) * 19349663u
+            ^ std::uint32_t(cell.z) * 83492791u) & mask;
+    }
+
+    float radius() const { return m_radius; }
+    float cellSize() const { return m_cellSize; }
+    std::uint32_t bucketMask() const { return m_bucketMask; }
+    const std::vector<std::uint32_t>& bucketStart() const { return m_bucketStart; }
+    const std::vector<glm::vec4>& points() const { return m_points; }   ///< xyz, w unused (std430 stride)
+
+private:
+    float m_radius = 0.0f;
+    float m_cellSize = 0.0f;
+    std::uint32_t m_bucketMask = 0;
+    std::vector<std::uint32_t> m_bucketStart;
+    std::vector<glm::vec4> m_points;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class QFile;
+
+/**
+ * Point cloud octree layout ("*.kpc"), little-endian:
+ *
+ *   FileHeader   counts, the cubic root cell, section offsets
+ *   nodes        Node[nodeCount] breadth-first; a node's children are
+ *                consecutive, in octant order, from firstChild
+ *   points       PackedPoint[pointCount], one run per node, in node order
+ *
+ * Each node keeps a subsample of the points below it, about one per cell of
+ * a kGridCells^3 grid over its cube; the rest go to its children. Levels
+ * are additive: a node drawn with its ancestors shows the density of its
+ * depth, so a view loads only the nodes its screen-space error asks for and
+ * the file is read in node-sized pieces. Positions are quantized to 16 bits
+ * inside the node's cube.
+ */
+namespace PointCloudFormat
+{
+    constexpr std::uint32_t kMagic = 0x4C43504Bu;   // "KPCL"
+    constexpr std::uint32_t kVersion = 1;
+    constexpr int kGridCells = 32;                  ///< subsample grid per node side
+    constexpr std::uint32_t kMaxNodePoints = kGridCells * kGridCells * kGridCells;
+
+    struct FileHeader {
+        std::uint32_t magic = kMagic;
+        std::uint32_t version = kVersion;
+        std::uint32_t nodeCount = 0;
+        std::uint32_t reserved = 0;
+        std::uint64_t pointCount = 0;
+        float rootMin[3] = {};
+        float rootSize = 0.0f;                      ///< edge of the root cube
+        std::uint64_t nodesOffset = 0;
+        std::uint64_t pointsOffset = 0;
+    };
+    struct Node {
+        float min[3] = {};
+        float size = 0.0f;                          ///< cube edge; point spacing is size / kGridCells
+        std::uint64_t firstPoint = 0;
+        std::uint32_t pointCount = 0;
+        std::uint32_t firstChild = 0;               ///< 0 for a leaf (the root is never a child)
+        std::uint32_t childMask = 0;                ///< bit k: octant k (x = bit 0, y = 1, z = 2) exists
+        std::uint32_t depth = 0;
+    };
+    struct PackedPoint {
+        std::uint16_t x, y, z;                      ///< 0..65535 across the node's cube
+        std::uint16_t reserved;
+        std::uint8_t rgba[4];                       ///< sRGB
+    };
+}
+
+/**
+ * @class PointCloudOctree
+ * @brief An opened .kpc file: the node table in memory, the points mapped.
+ *
+ * Point runs are read straight from a file mapping, so only the nodes
+ * something asks for are paged in and the scan may be far larger than RAM.
+ * points() is safe to call from any thread.
+ */
+class PointCloudOctree
+{
+public:
+    using Node = PointCloudFormat::Node;
+    using PackedPoint = PointCloudFormat::PackedPoint;
+
+    // Nullptr (and 'error' set) if the file is missing or not a .kpc.
+    static std::shared_ptr<PointCloudOctree> open(const std::string& path, std::string* error = nullptr);
+
+    // Converts a text scan (one "x y z [intensity] [r g b]" point per line:
+    // .xyz, .txt, .pts) into a .kpc at 'outputPath'. The points are held in
+    // memory while the tree is built; 'progress' gets 0..1 if given.
+    static bool build(const std::string& sourcePath, const std::string& outputPath,
+                      std::string* error = nullptr, const std::function<void(float)>& progress = {});
+
+    // Where the converted copy of 'sourcePath' lives in the user cache.
+    static std::string cachePathFor(const std::string& sourcePath);
+
+    ~PointCloudOctree();
+
+    const PointCloudFormat::FileHeader& header() const { return m_header; }
+    const std::vector<Node>& nodes() const { return m_nodes; }
+    const PackedPoint* points(std::uint32_t node) const { return m_points + m_nodes[node].firstPoint; }
+    // Index of the child in 'octant', or 0 if there is none.
+    std::uint32_t child(std::uint32_t node, int octant) const;
+
+    const std::string& path() const { return m_path; }
+    /// Unique per opened file, for caches that outlive the object.
+    std::uint64_t id() const { return m_id; }
+
+private:
+    PointCloudOctree() = default;
+
+    std::string m_path;
+    std::uint64_t m_id = 0;
+    std::unique_ptr<QFile> m_file;
+    PointCloudFormat::FileHeader m_header;
+    std::vector<Node> m_nodes;
+    const PackedPoint* m_points = nullptr;      ///< into the mapping
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm.hpp>
+#include <entt/fwd.hpp>
+#include <qopengl.h>
+#include "CullingSystem.hpp"
+#include "GpuResources.hpp"
+#include "PointCloudOctree.hpp"
+
+class QOpenGLContext;
+class QOpenGLFunctions_4_3_Core;
+class GLStateCache;
+class Shader;
+
+/**
+ * @class PointCloudRenderer
+ * @brief Streams PointCloudComponent octrees through a fixed VRAM budget.
+ *
+ * Every view walks each cloud's octree from the root, refining a node while
+ * its point spacing projects to more than pixelError pixels, largest error
+ * first, until the point budget is spent. Nodes that are not resident are
+ * queued for a loader thread, which copies them out of the file mapping;
+ * each view then uploads a bounded number of finished nodes, so a fast
+ * camera move costs a few frames of coarse detail, never a stall.
+ *
+ * Resident nodes live in one pool buffer of equal slots (kMaxNodePoints
+ * points each) that grows up to the VRAM budget. When it is full, the least
+ * recently drawn slot is reused, but only once no view has drawn it for a
+ * full tick, so a node another viewport is still showing stays put. Every
+ * visible node of every cloud then draws with one multi-draw indirect call.
+ *
+ * The pool is shared by the context group; the VAO and the draw/indirect
+ * buffers are per context, like the spline pass's.
+ *
+ * splat() is the alternative to draw() for dense clouds: a compute pass
+ * writes every selected point as one pixel into a per-context SSBO target
+ * with atomics, skipping the rasterizer and its per-fragment cost; the
+ * caller resolves the target into its FBO.
+ */
+class PointCloudRenderer
+{
+public:
+    static constexpr GLsizeiptr kSlotBytes =
+        GLsizeiptr(PointCloudFormat::kMaxNodePoints) * GLsizeiptr(sizeof(PointCloudFormat::PackedPoint));
+
+    struct ContextState {
+        GLuint vao = 0;
+        std::uint32_t poolGeneration = ~0u;   ///< pool buffer the VAO points at
+        GLuint drawBuffer = 0;                ///< PointCloudDrawGpu[]
+        GLsizeiptr drawCapacity = 0;
+        GLuint indirectBuffer = 0;            ///< DrawArraysIndirectCommand[]
+        GLsizeiptr indirectCapacity = 0;
+        GLuint splatTarget = 0;               ///< uvec2 per pixel, see splat()
+        GLsizeiptr splatCapacity = 0;
+    };
+
+    /// What a view needs for node selection. pixelScale is pixels per world
+    /// unit at distance 1 (at any distance if orthographic).
+    struct View {
+        Frustum frustum;
+        glm::vec3 camPos;
+        glm::dvec3 eye{ 0.0 };   ///< the node origins are uploaded relative to it
+        float pixelScale = 0.0f;
+        bool orthographic = false;
+        std::uint64_t tick = 0;
+    };
+
+    PointCloudRenderer() = default;
+    ~PointCloudRenderer();
+    PointCloudRenderer(const PointCloudRenderer&) = delete;
+    PointCloudRenderer& operator=(const PointCloudRenderer&) = delete;
+
+    void setFunctions(QOpenGLFunctions_4_3_Core* gl) { m_gl = gl; }
+
+    void setVramBudget(std::size_t bytes) { m_vramBudget = bytes; }
+    std::size_t vramBudget() const { return m_vramBudget; }
+    void setPointBudget(std::size_t points) { m_pointBudget = points; }
+    void setPixelError(float pixels) { m_pixelError = pixels; }
+
+    // Selects this view's nodes, requests the missing ones and uploads what
+    // the loader has finished. Returns the number of nodes to draw.
+    std::size_t prepare(entt::registry& registry, const View& view);
+    // Draws what prepare() selected; the point shader must be in use.
+    void draw(ContextState& context, GLStateCache& state);
+    // Rasterizes what prepare() selected into context.splatTarget, one
+    // uvec2(sRGB colour, linear depth bits) per pixel of a width x height
+    // view, all ones where no point landed. 'program' is point_splat_comp
+    // (passes = 2: depth, then colour) or its 64-bit twin (passes = 1).
+    // Returns false if there was nothing to splat.
+    bool splat(ContextState& context, GLStateCache& state, Shader& program, int passes, int width, int height);
+
+    void destroyContext(ContextState& context);
+    void destroy();   ///< GL objects only; a context of the group must be current
+
+    // Shrinks the pool by at least 'bytes' where it can, keeping the most
+    // recently drawn nodes, and lowers the VRAM budget to the new size.
+    // Nodes drawn at 'tick' or the tick before always stay. Returns the
+    // bytes freed; call between views.
+    std::size_t trimPool(std::size_t bytes, std::uint64_t tick);
+
+    std::size_t residentNodes() const { return m_resident.size(); }
+    std::size_t pointsSelected() const { return m_pointsSelected; }
+    /// Nodes a view asked for are still loading: keep drawing until they land.
+    bool streaming() const { return !m_requested.empty(); }
+
+private:
+    using Key = std::uint64_t;   ///< octree id << 32 | node
+    struct Slot {
+        Key key = 0;
+        std::uint64_t lastUsed = 0;
+        bool used = false;
+    };
+    struct Request {
+        std::shared_ptr<const PointCloudOctree> octree;
+        std::uint32_t node = 0;
+        float priority = 0.0f;   ///< projected spacing in pixels; largest loads first
+        bool operator<(const Request& other) const { return priority < other.priority; }
+    };
+    struct Loaded {
+        Key key;
+        std::vector<PointCloudFormat::PackedPoint> points;
+    };
+
+    static Key keyOf(const PointCloudOctree& octree, std::uint32_t node)
+    {
+        return (octree.id() << 32) | node;
+    }
+
+    void uploadLoaded(std::uint64_t tick);
+    void waitForUploads();
+    void uploadSelection(ContextState& context);
+    int acquireSlot(std::uint64_t tick);
+    bool growPool();
+    void loaderMain();
+
+    QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+    std::size_t m_vramBudget = std::size_t(512) << 20;
+    std::size_t m_pointBudget = 10'000'000;
+    float m_pixelError = 2.0f;
+    static constexpr int kUploadsPerView = 24;
+    static constexpr std::size_t kMaxLoaded = 2 * kUploadsPerView;   ///< loader runs this far ahead
+    static constexpr std::size_t kInitialSlots = 16;
+    static constexpr GLuint kSplatGroupSize = 256;           ///< local_size_x of the splat shaders
+    static constexpr GLuint kMaxSplatNodesPerDispatch = 65535;
+
+    /* --- GPU pool (shared by the context group) --- */
+    GLuint m_pool = 0;
+    std::uint32_t m_poolGeneration = 0;
+    std::vector<Slot> m_slots;
+    std::unordered_map<Key, int> m_resident;
+    GLsync m_uploadFence = nullptr;          ///< after the last upload
+    QOpenGLContext* m_uploadContext = nullptr;
+
+    /* --- this view's selection --- */
+    std::vector<PointCloudDrawGpu> m_draws;
+    std::vector<DrawArraysIndirectCommand> m_commands;
+    std::size_t m_pointsSelected = 0;
+    std::vector<Request> m_wanted;
+    struct Candidate {
+        float error;             ///< projected point spacing in pixels
+        std::uint32_t cloud, node;
+        bool operator<(const Candidate& other) const { return error < other.error; }
+    };
+    struct CloudView {
+        std::shared_ptr<const PointCloudOctree> octree;
+        glm::mat4 model;
+        float scale;             ///< largest axis scale of the model matrix
+    };
+    std::vector<CloudView> m_cloudScratch;
+    std::vector<Candidate> m_candidates;
+
+    /* --- loader thread --- */
+    std::thread m_loader;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+    std::vector<Request> m_queue;            ///< max-heap on priority, rebuilt every tick
+    std::uint64_t m_queueTick = ~0ull;
+    std::vector<Loaded> m_loaded;
+    std::unordered_set<Key> m_requested;     ///< queued or loading; main thread only
+};
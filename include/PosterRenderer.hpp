@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QString>
+#include <entt/entt.hpp>
+
+class RenderingSystem;
+
+/**
+ * @class PosterRenderer
+ * @brief Renders one camera view far larger than a texture or FBO can be,
+ *        tile by tile through OffscreenRenderer, into a PosterWriter.
+ *
+ * Each tile is the camera's full-image projection cropped to the tile
+ * (RenderingSystem::setProjectionWindow()), widened by kGutter pixels a
+ * side so the screen-space passes (ambient occlusion, glow, FXAA-like
+ * blurs) see past the seam, and drawn 'samples' times with sub-pixel
+ * Halton jitter; the readbacks are averaged in linear light and the
+ * interior goes to the writer, which encodes it on the workers while the
+ * next tile draws. Memory: the one tile being averaged, the readback ring
+ * and the writer's buffers.
+ *
+ * For the duration the renderer's own anti-aliasing is off (the samples
+ * replace it) and so is the vignette, which would darken every tile's
+ * corners. Widths given in pixels (lines, frame triads, labels) stay that
+ * many pixels, so they come out thin on a large poster. The caller updates
+ * the scene logic first, as for OffscreenRenderer::renderFrame(). GUI
+ * thread only.
+ */
+class PosterRenderer
+{
+public:
+    static constexpr int kGutter = 32;
+
+    struct Settings {
+        QString path;                   ///< .exr for half-float OpenEXR, else PNG
+        int width = 16384;
+        int height = 9216;
+        int tile = 2048;                ///< plus 2 * kGutter must fit GL_MAX_TEXTURE_SIZE
+        int samples = 4;                ///< jittered draws per tile
+    };
+
+    explicit PosterRenderer(RenderingSystem& renderer) : m_renderer(renderer) {}
+
+    bool render(entt::registry& registry, entt::entity cameraEntity, const Settings& settings);
+    QString errorString() const { return m_error; }
+
+private:
+    RenderingSystem& m_renderer;
+    QString m_error;
+};
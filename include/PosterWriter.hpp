@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QString>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class QSaveFile;
+
+/**
+ * @class PosterWriter
+ * @brief Writes an image too large to hold, a tile at a time, as PNG or
+ *        OpenEXR, encoding on ThreadPool::shared() workers.
+ *
+ * Tiles are linear RGB floats and arrive in any order within a row of
+ * tiles, rows top first. What is kept meanwhile:
+ *  - PNG (8-bit sRGB): the row of tiles being filled, plus up to
+ *    kBandsInFlight finished rows being deflated in parallel. Each is one
+ *    raw deflate run ended with a sync flush, so the runs concatenate into
+ *    the one zlib stream PNG needs (the pigz scheme; the Adler-32 is
+ *    combined), and go out as IDAT chunks in order.
+ *  - EXR (half RGB, tiled, ZIP per tile): nothing of the caller's; each
+ *    tile is converted, compressed and appended in the order it finishes,
+ *    and the offset table is filled in by close(). At most one tile per
+ *    worker is in flight.
+ * write() blocks while that many are in flight. The file only replaces
+ * 'path' when close() succeeds.
+ */
+class PosterWriter
+{
+public:
+    static constexpr int kBandsInFlight = 2;
+
+    PosterWriter();
+    ~PosterWriter();
+
+    PosterWriter(const PosterWriter&) = delete;
+    PosterWriter& operator=(const PosterWriter&) = delete;
+
+    // EXR for a .exr path, PNG otherwise.
+    bool open(const QString& path, int width, int height, int tileSize);
+    // 'rgb' holds the tile's w x h pixels (tileSize, less at the right and
+    // bottom edges), 3 floats each, rows 'stride' floats apart, top first.
+    bool write(int tileX, int tileY, const float* rgb, std::size_t stride);
+    bool close();
+    void abort();
+
+    int tilesX() const { return (m_width + m_tile - 1) / m_tile; }
+    int tilesY() const { return (m_height + m_tile - 1) / m_tile; }
+    QString errorString() const;
+
+private:
+    struct Band;
+    struct Deflated {
+        std::vector<std::uint8_t> bytes;
+        std::uint32_t adler = 1;                           ///< of the filtered rows deflated
+        std::size_t rawBytes = 0;
+    };
+
+    bool writeHeader();
+    void submitBand();
+    void bandDone(int row, Deflated deflated);
+    void tileDone(int tileX, int tileY, const std::vector<std::uint8_t>& chunk);
+    bool writeRaw(const void* data, std::size_t bytes);   ///< under m_mutex
+    bool writePngChunk(const char type[4], const std::uint8_t* data, std::size_t bytes);
+    void fail(const QString& error);                       ///< under m_mutex
+    void waitBelow(int inFlight);
+
+    std::unique_ptr<QSaveFile> m_file;
+    bool m_exr = false;
+    int m_width = 0, m_height = 0, m_tile = 0;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_done;
+    int m_inFlight = 0;
+    QString m_error;
+
+    // PNG
+    std::unique_ptr<Band> m_band;                          ///< the row of tiles being filled
+    std::vector<std::uint8_t> m_lastRow;                   ///< raw bottom row of the previous band, for the Up filter
+    std::map<int, Deflated> m_deflated;                   ///< finished out of order, by band row
+    std::uint32_t m_adler = 1;
+    int m_nextBand = 0;                                    ///< next band row to go to the file
+
+    // EXR
+    std::int64_t m_tableAt = 0;
+    std::vector<std::uint64_t> m_offsets;                  ///< per tile, row-major
+};
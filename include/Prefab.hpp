@@ -0,0 +1,109 @@
+#pragma once
+
+#include "components.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <entt/fwd.hpp>
+
+class KinematicModel;
+class MeshBvh;
+
+/**
+ * @class Prefab
+ * @brief A repeated substructure (a robot cell, a conveyor run) shared by every placement of it.
+ *
+ * PrefabSystem::capture() flattens an entity subtree into parts: a mesh, a
+ * material and a fixed offset from the prefab root or, inside a robot, from
+ * the link the part rides on. The prefab never changes afterwards, so any
+ * number of PrefabInstanceComponents hold it by pointer. Per instance there
+ * is one entity with a root transform and, for articulated prefabs, a
+ * joint state; transform propagation costs one root per instance, not one
+ * entity per part. Instances of one articulated prefab share its
+ * KinematicModel, so update() poses all of them whose joints moved in one
+ * KinematicModel::forwardBatch(). The parts are expanded into the render
+ * snapshot at extract time, where equal meshes batch into instanced draws
+ * as usual: a fleet of identical arms draws as one instance array per link
+ * mesh.
+ *
+ * With setGpuPosing(true), a prefab with kGpuPosingMinInstances or more
+ * instances is not posed here at all: the snapshot carries each instance's
+ * joint coordinates and the renderer's compute pass turns them into part
+ * matrices (RenderSnapshot::Fleet). Such instances keep no linkMatrices and
+ * are bounded by reachMin/Max, which holds every pose.
+ */
+struct Prefab
+{
+    struct Part {
+        std::shared_ptr<const MeshData> mesh;
+        std::size_t meshKey = 0;                     ///< MeshArena key, as RenderResourceComponent
+        std::shared_ptr<const MeshBvh> blas;         ///< for picking, shared by every instance
+        MaterialComponent material;
+        glm::mat4 offset{ 1.0f };                    ///< from the link frame, or the prefab root if link < 0
+        int link = -1;                               ///< KinematicModel link index
+        glm::vec3 localMin{ 0.0f }, localMax{ 0.0f };   ///< mesh space
+        bool castsShadow = true;
+    };
+
+    std::string name;
+    std::vector<Part> parts;
+    std::shared_ptr<const KinematicModel> model;     ///< null for rigid prefabs
+    glm::mat4 modelBase{ 1.0f };                     ///< the model's root link, prefab space
+    std::vector<double> restQ;                       ///< joint coordinates at capture, by DOF
+    glm::vec3 reachMin{ 0.0f }, reachMax{ 0.0f };    ///< every part at any joint coordinates, prefab space
+    bool reachBounded = false;                       ///< false with an unlimited prismatic joint: never GPU posed
+};
+
+namespace PrefabSystem
+{
+    /// Instances of one prefab from which setGpuPosing() hands them to the renderer.
+    constexpr std::size_t kGpuPosingMinInstances = 64;
+
+    // Lets update() leave large fleets to the renderer's forward kinematics
+    // (off by default). Selected instances, and those in contact, stay posed
+    // here, since the outline passes and the gizmo need their parts. GUI thread.
+    void setGpuPosing(bool on);
+    bool gpuPosing();
+
+    // Flattens the subtree under 'root' (ParentComponent links) into a
+    // prefab, relative to the root's world transform. Every entity with a
+    // mesh becomes a part. The first robot in the subtree (a
+    // KinematicModelComponent, 'root' itself included) stays articulated:
+    // parts under one of its links ride on that link. Further robots are
+    // frozen in their current pose. World transforms must be current.
+    // GUI thread. Null if the subtree has no meshes.
+    std::shared_ptr<const Prefab> capture(const entt::registry& registry, entt::entity root);
+
+    // One instance entity placing 'prefab' at the given root pose.
+    entt::entity instantiate(entt::registry& registry, std::shared_ptr<const Prefab> prefab,
+        const glm::vec3& translation, const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+
+    // For every instance: re-poses articulated prefabs whose joint state
+    // changed (one batched forward pass per prefab, none for GPU posed ones),
+    // publishes that state like KinematicSystem does for robots, and refreshes the instance's
+    // WorldBoundsComponent when its pose or world matrix moved. Run after
+    // transform propagation. GUI thread. Returns how many bounds changed.
+    std::size_t update(entt::registry& registry);
+
+    // Link matrices of an articulated prefab for joint coordinates 'q', in
+    // prefab space, as update() keeps them; for an instance without them.
+    void poseLinks(const Prefab& prefab, const double* q, std::vector<glm::mat4>& out);
+
+    // Part 'part' relative to the instance root, given its link matrices.
+    inline glm::mat4 partMatrix(const Prefab& prefab, const std::vector<glm::mat4>& linkMatrices, std::size_t part)
+    {
+        const Prefab::Part& p = prefab.parts[part];
+        if (p.link < 0 || std::size_t(p.link) >= linkMatrices.size()) return p.offset;
+        return linkMatrices[std::size_t(p.link)] * p.offset;
+    }
+
+    // Part 'part' relative to the instance root, at the instance's pose.
+    inline glm::mat4 partMatrix(const Prefab& prefab, const PrefabInstanceComponent& instance, std::size_t part)
+    {
+        return partMatrix(prefab, instance.linkMatrices, part);
+    }
+}
@@ -146,3 +146,32 @@ inline void createArrowPrimitive(std::vector<Vertex>& vertices, std::vector<unsi
     indices.insert(indices.end(), { 7, 11, 12, 7, 12, 8 });
     indices.insert(indices.end(), { 8, 12, 9, 8, 9, 5 });
 }
+
+/* ------------------------------------------------------------------------- */
+/* createTriadPrimitive - X, Y and Z arrows from the origin, length 1        */
+/* ------------------------------------------------------------------------- */
+// The three arrows follow each other in the vertex buffer, X first, so a
+// shader tells the axis from gl_VertexID / (vertices.size() / 3).
+inline void createTriadPrimitive(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    std::vector<Vertex> arrowVertices;
+    std::vector<unsigned int> arrowIndices;
+    createArrowPrimitive(arrowVertices, arrowIndices);
+
+    vertices.clear();
+    indices.clear();
+    for (int axis = 0; axis < 3; ++axis) {
+        const unsigned int base = static_cast<unsigned int>(vertices.size());
+        for (const Vertex& v : arrowVertices) {
+            // Thinner than a field arrow, starting at the origin; a cyclic
+            // permutation of the components turns +Z into +X or +Y.
+            const glm::vec3 p(v.position.x * 0.5f, v.position.y * 0.5f, v.position.z + 0.5f);
+            const glm::vec3& n = v.normal;
+            Vertex out = v;
+            out.position = axis == 0 ? glm::vec3(p.z, p.x, p.y) : axis == 1 ? glm::vec3(p.y, p.z, p.x) : p;
+            out.normal = axis == 0 ? glm::vec3(n.z, n.x, n.y) : axis == 1 ? glm::vec3(n.y, n.z, n.x) : n;
+            vertices.push_back(out);
+        }
+        for (unsigned int i : arrowIndices) indices.push_back(base + i);
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Project folder sync through a content-addressed chunk store, so a
+ *        small edit to a multi-GB mesh or recording moves kilobytes.
+ *
+ * Files are cut into content-defined chunks (FastCDC: a gear rolling hash
+ * with normalized chunking, kMinChunk to kMaxChunk, about kAvgChunk on
+ * average), so an insert or delete only moves the boundaries next to it.
+ * Each chunk is named by its BLAKE2b-256 and stored once, whichever file
+ * or version it came from.
+ *
+ * push() describes the folder as a snapshot (every file's path, size and
+ * chunk list), asks the store which chunks it lacks and uploads just those,
+ * in parallel on ThreadPool::shared(). The snapshot is itself cut into
+ * chunks and published under a name as the list of its own chunks, so a
+ * changed multi-GB file costs a few chunks of listing too, not the whole
+ * listing. pull() reads a snapshot and rebuilds each changed file in a
+ * memory-mapped temporary next to it: chunks the local copy already holds
+ * are copied from it, the rest are fetched (in parallel, hash-checked),
+ * and the temporary replaces the file once complete. Files missing from
+ * the snapshot are left alone.
+ *
+ * Each folder keeps the last snapshot it pushed or pulled in
+ * .krsync/state, so unchanged files (same size and modification time) are
+ * not read again. Run either off the GUI thread, not on a pool worker.
+ */
+namespace ProjectSync
+{
+    constexpr std::uint32_t kMinChunk = 16 * 1024;
+    constexpr std::uint32_t kAvgChunk = 64 * 1024;
+    constexpr std::uint32_t kMaxChunk = 256 * 1024;
+
+    using ChunkHash = std::array<std::uint8_t, 32>;
+
+    struct Chunk {
+        ChunkHash hash{};
+        std::uint32_t size = 0;
+    };
+
+    struct FileEntry {
+        std::string path;                   ///< relative, '/' separated
+        std::uint64_t size = 0;
+        std::int64_t modifiedMs = 0;        ///< of the local copy when last chunked
+        std::vector<Chunk> chunks;
+    };
+
+    struct Stats {
+        std::size_t files = 0;
+        std::size_t filesChanged = 0;       ///< re-chunked (push) or rebuilt (pull)
+        std::size_t chunksTransferred = 0;
+        std::uint64_t bytesTransferred = 0; ///< chunk payload sent or fetched
+        std::uint64_t bytesReused = 0;      ///< pull: copied from the local copy instead
+    };
+
+    // Where chunks and published snapshots live. Implementations must allow
+    // concurrent calls.
+    class ChunkStore
+    {
+    public:
+        virtual ~ChunkStore() = default;
+        // One flag per hash: true if the store holds that chunk.
+        virtual std::vector<bool> has(const std::vector<ChunkHash>& hashes) = 0;
+        virtual bool put(const ChunkHash& hash, const unsigned char* data, std::size_t size, std::string* error) = 0;
+        virtual bool get(const ChunkHash& hash, std::vector<unsigned char>& out, std::string* error) = 0;
+        virtual bool putRef(const std::string& name, const std::vector<unsigned char>& bytes, std::string* error) = 0;
+        virtual bool getRef(const std::string& name, std::vector<unsigned char>& out, std::string* error) = 0;
+    };
+
+    // A store in a folder (a network share or a mounted bucket):
+    // chunks/<2 hex>/<64 hex> and refs/<name>, each written atomically.
+    class DirectoryStore : public ChunkStore
+    {
+    public:
+        explicit DirectoryStore(std::string root) : m_root(std::move(root)) {}
+
+        std::vector<bool> has(const std::vector<ChunkHash>& hashes) override;
+        bool put(const ChunkHash& hash, const unsigned char* data, std::size_t size, std::string* error) override;
+        bool get(const ChunkHash& hash, std::vector<unsigned char>& out, std::string* error) override;
+        bool putRef(const std::string& name, const std::vector<unsigned char>& bytes, std::string* error) override;
+        bool getRef(const std::string& name, std::vector<unsigned char>& out, std::string* error) override;
+
+    private:
+        std::string chunkPath(const ChunkHash& hash) const;
+
+        std::string m_root;
+    };
+
+    // Chunk sizes for 'data', in order, summing to 'size'.
+    std::vector<std::uint32_t> cut(const unsigned char* data, std::size_t size);
+
+    ChunkHash hashOf(const unsigned char* data, std::size_t size);
+
+    bool push(const std::string& folder, ChunkStore& store, const std::string& name, Stats* stats = nullptr,
+        std::string* error = nullptr);
+    bool pull(ChunkStore& store, const std::string& name, const std::string& folder, Stats* stats = nullptr,
+        std::string* error = nullptr);
+}
@@ -22,6 +22,9 @@ public:
     explicit PropertiesPanel(Scene* scene, QWidget* parent = nullptr);
     ~PropertiesPanel();
 
+    // Re-reads every editor from the registry, e.g. after an undo.
+    void refresh();
+
 private slots:
     void onGridAdded(entt::registry& registry, entt::entity entity);
     void onGridRemoved(entt::registry& registry, entt::entity entity);
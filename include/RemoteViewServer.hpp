@@ -0,0 +1,121 @@
+#pragma once
+
+#include "VideoEncoder.hpp"
+#include "ViewportCapture.hpp"
+
+#include <QByteArray>
+#include <QImage>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <memory>
+#include <vector>
+
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+class ViewportWidget;
+
+/**
+ * @class RemoteViewServer
+ * @brief Streams one viewport to web browsers and takes their input back.
+ *
+ * Serves a small page over HTTP on 'port'; the page opens a WebSocket on
+ * the same port and plays the stream with Media Source Extensions, so a
+ * viewer needs nothing but a browser. Frames come from the viewport's
+ * composite output through a ViewportCapture (asynchronous PBO readback),
+ * are paced to 'fps' (a still view repeats its last frame) and encoded by
+ * VideoEncoder into fragmented MP4, hardware H.264 by default. Every
+ * fragment is broadcast as one binary message; a client that joins or has
+ * fallen behind is fed again from the next keyframe.
+ *
+ * Bitrate follows the slowest client along kBitrateLadder: when a socket
+ * backs up by more than kMaxBacklogSeconds of video the encoder restarts one
+ * step lower, and after kStepUpSeconds without congestion one step higher.
+ * Each restart announces a fresh init segment, which the page appends in
+ * "sequence" mode so playback continues.
+ *
+ * Mouse, wheel and key events from the page are replayed on the viewport
+ * as Qt events when Settings::allowInput is set.
+ */
+class RemoteViewServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kBitrateLadder[] = { 8000, 4000, 2000, 1000, 500 };   ///< kbit/s
+    static constexpr double kMaxBacklogSeconds = 0.5;
+    static constexpr int kStepUpSeconds = 5;
+    static constexpr int kMaxMessageBytes = 64 * 1024;   ///< client -> server
+
+    struct Settings {
+        quint16 port = 8090;
+        int fps = 30;
+        QString codec = QStringLiteral("h264_nvenc");   ///< or hevc_nvenc, h264_qsv, libx264, ...
+        QString program = QStringLiteral("ffmpeg");
+        bool allowInput = true;
+    };
+
+    explicit RemoteViewServer(QObject* parent = nullptr);
+    ~RemoteViewServer() override;
+
+    bool start(ViewportWidget* viewport, const Settings& settings = Settings());
+    void stop();
+    bool running() const;
+
+    // "http://<first non-loopback IPv4>:<port>/".
+    QString url() const;
+    int viewerCount() const;
+    int bitrateKbps() const { return kBitrateLadder[m_rung]; }
+
+signals:
+    void viewersChanged(int count);
+
+private:
+    struct Client {
+        QTcpSocket* socket = nullptr;
+        QByteArray incoming;          ///< unparsed request or WebSocket bytes
+        QByteArray message;           ///< text message being reassembled
+        bool websocket = false;
+        bool synced = false;          ///< has the current init segment and a keyframe
+        bool congested = false;       ///< dropped a fragment since the last bitrate check
+    };
+
+    void acceptConnections();
+    void readClient(QTcpSocket* socket);
+    bool handleRequest(Client& client);   ///< false once the connection is done
+    bool handleFrames(Client& client);
+    void handleInput(const QByteArray& json);
+    void dropClient(QTcpSocket* socket);
+    Client* findClient(QTcpSocket* socket);
+
+    void pushFrame();
+    bool restartEncoder();
+    void stopEncoder();
+    void encoded(const QByteArray& bytes);
+    void sendInit(Client& client);
+    void sendFragment(const QByteArray& fragment, bool keyframe);
+    void adaptBitrate();
+
+    static void sendFrame(QTcpSocket* socket, quint8 opcode, const QByteArray& payload);
+    static void respond(QTcpSocket* socket, const char* status, const char* contentType, const QByteArray& body);
+
+    Settings m_settings;
+    QPointer<ViewportWidget> m_viewport;
+    QTcpServer* m_server = nullptr;
+    QTimer* m_frameTimer = nullptr;
+    QTimer* m_bitrateTimer = nullptr;
+    ViewportCapture m_capture;
+    std::vector<Client> m_clients;
+
+    std::unique_ptr<VideoEncoder> m_encoder;
+    QSize m_encodedSize;
+    bool m_encoderFailed = false;     ///< ffmpeg would not start; not retried until start()
+    QImage m_latest;                  ///< newest captured frame, re-sent while the view is still
+    QByteArray m_encoded;             ///< encoder output not yet split into boxes
+    QByteArray m_init;                ///< ftyp + moov of the running encoder
+    QByteArray m_fragment;            ///< moof waiting for its mdat
+    QString m_mime;                   ///< of m_init, for MediaSource.addSourceBuffer
+    int m_rung = 0;                   ///< index into kBitrateLadder
+    int m_calmSeconds = 0;
+};
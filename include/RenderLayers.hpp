@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Bits of LayerComponent::mask and CameraComponent::layerMask: a viewport
+// draws a mesh when the two share a bit. The first three are fixed; editor
+// layer names (LinkDescription::editor_layer) take the free bits in the
+// order they are first seen in this process.
+namespace RenderLayers
+{
+    constexpr std::uint32_t Visual = 1u << 0;      ///< render meshes; the "Default" editor layer
+    constexpr std::uint32_t Collision = 1u << 1;   ///< collision meshes, drawn as entries of their own
+    constexpr std::uint32_t Helpers = 1u << 2;     ///< camera gizmos and other editor-only meshes
+    constexpr std::uint32_t All = ~0u;
+    constexpr std::uint32_t DefaultView = All & ~Collision;
+    constexpr int kFirstNamed = 3;
+
+    // The bit for an editor layer name. Visual for "Default" and empty
+    // names, and for new names once every bit is taken. Thread-safe.
+    std::uint32_t fromName(const std::string& name);
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "RenderLayers.hpp"
+
+#include <glm/glm.hpp>
+#include <entt/entt.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct MeshData;
+struct Prefab;
+struct Texture;
+struct RenderResourceComponent;
+
+/**
+ * @brief What the mesh passes draw, copied out of the registry once per tick.
+ *
+ * Built by RenderSnapshotBuffer::extract() after the logic update and
+ * never changed once published: a view renders from it without touching
+ * the registry's mesh, transform, material or selection components, so a
+ * paint between ticks (resize, dock drag) draws the last complete frame and
+ * every viewport shares one registry walk. Each camera also gets its draw
+ * list here: the meshes on its layers, minus its own gizmo.
+ */
+struct RenderSnapshot
+{
+    struct Mesh {
+        entt::entity entity = entt::null;
+        entt::entity camera = entt::null;    ///< the camera this mesh hangs under (its gizmo), or null
+        std::shared_ptr<const MeshData> data;
+        std::size_t meshKey = 0;             ///< MeshArena key, see RenderResourceComponent
+        glm::mat4 model{ 1.0f };             ///< world matrix
+        glm::vec3 albedo{ 0.8f };
+        float metallic = 0.1f;               ///< MaterialComponent; the defaults without one
+        float roughness = 0.8f;
+        glm::vec3 emissive{ 0.0f };
+        std::shared_ptr<const Texture> albedoMap;
+        std::shared_ptr<const Texture> metalRoughnessMap;
+        glm::vec3 boundsMin{ 0.0f };         ///< world AABB, if boundsValid
+        glm::vec3 boundsMax{ 0.0f };
+        bool boundsValid = false;
+        bool selected = false;               ///< SelectedComponent
+        bool contact = false;                ///< CollisionContactComponent
+        bool castsShadow = true;             ///< LinkDescription::casts_shadow; true for non-links
+        std::uint32_t layers = RenderLayers::Visual;   ///< LayerComponent; 0 for hidden links
+    };
+
+    // One link mesh of a TrajectoryGhostComponent: every ghost's copy of it
+    // is one instance of a single draw.
+    struct Ghost {
+        std::shared_ptr<const MeshData> data;
+        std::size_t meshKey = 0;
+        glm::mat4 root{ 1.0f };              ///< the robot root link's world matrix
+        std::shared_ptr<const std::vector<glm::mat4>> poses;   ///< ghosts x linkCount, root relative
+        int link = 0, linkCount = 0;
+        glm::vec3 colour{ 1.0f };
+        float startAlpha = 0.0f, endAlpha = 0.0f;
+    };
+
+    // Instances of one articulated prefab whose links the renderer poses
+    // (PrefabSystem::setGpuPosing): only their roots and joint coordinates
+    // are extracted, the parts are never expanded into 'meshes'.
+    struct Fleet {
+        std::shared_ptr<const Prefab> prefab;
+        std::uint32_t firstInstance = 0, instanceCount = 0;   ///< into fleetInstances
+    };
+    struct FleetInstance {
+        entt::entity entity = entt::null;
+        glm::mat4 root{ 1.0f };              ///< the prefab root's world matrix
+        glm::vec3 boundsMin{ 0.0f };         ///< world AABB of Prefab::reachMin/Max
+        glm::vec3 boundsMax{ 0.0f };
+        std::uint32_t firstJoint = 0;        ///< into fleetJoints, the prefab's DOF count of them
+        std::uint32_t layers = RenderLayers::Visual;
+    };
+
+    // A LabelComponent, anchored in the world.
+    struct Label {
+        entt::entity entity = entt::null;
+        glm::vec3 anchor{ 0.0f };            ///< world
+        std::string text;
+        glm::vec4 colour{ 1.0f };
+        float pixelHeight = 14.0f;
+    };
+
+    struct View {
+        entt::entity camera = entt::null;
+        std::uint32_t mask = RenderLayers::All;   ///< CameraComponent::layerMask at extract
+        std::vector<std::uint32_t> meshes;   ///< into 'meshes', in order
+    };
+
+    struct Light {
+        entt::entity camera = entt::null;    ///< as Mesh::camera: a view skips its own gizmo's lights
+        glm::vec3 position{ 0.0f };          ///< world
+        float range = 0.0f;
+        glm::vec3 color{ 0.0f };             ///< scaled by intensity
+    };
+
+    std::vector<Mesh> meshes;                ///< renderable, non-empty meshes
+    std::vector<Light> lights;               ///< PointLightComponents with a range and intensity
+    std::vector<View> views;                 ///< one per CameraComponent
+    std::vector<Ghost> ghosts;               ///< drawn by views showing RenderLayers::Visual
+    std::vector<glm::mat4> frames;           ///< world link and sensor-mount frames, if extracted
+    std::vector<Label> labels;               ///< drawn over views showing RenderLayers::Visual
+    std::vector<Fleet> fleets;               ///< drawn by the batched mesh pass only
+    std::vector<FleetInstance> fleetInstances;
+    std::vector<float> fleetJoints;          ///< joint coordinates of every fleet instance
+    std::size_t selectedCount = 0;
+    std::size_t contactCount = 0;
+    std::uint64_t frame = 0;                 ///< increases with every extract
+
+    // The camera's draw list, or null if it had no CameraComponent then.
+    const View* viewOf(entt::entity camera) const
+    {
+        for (const View& view : views)
+            if (view.camera == camera) return &view;
+        return nullptr;
+    }
+};
+
+/**
+ * @class MeshKeyRefs
+ * @brief How many entities of a registry show each mesh key.
+ *
+ * Kept in the registry's context. RenderSnapshotBuffer::extract() moves an
+ * entity's count whenever its RenderResourceComponent::meshKey changes;
+ * removing the entity's RenderableMeshComponent or RenderResourceComponent
+ * (destroying it included) drops it. Keys nobody shows any more are
+ * collected for RenderingSystem, which hands their MeshArena ranges back.
+ */
+class MeshKeyRefs
+{
+public:
+    // Created, and hooked to the registry's destroy signals, on first use.
+    static MeshKeyRefs& of(entt::registry& registry);
+
+    // Moves 'res' from its current key to 'key'; 0 for none.
+    void assign(RenderResourceComponent& res, std::size_t key);
+
+    // Keys whose count reached zero since the last call and stayed there.
+    std::vector<std::size_t> takeUnused();
+
+private:
+    std::unordered_map<std::size_t, std::uint32_t> m_count;
+    std::vector<std::size_t> m_unused;
+};
+
+/**
+ * @class RenderSnapshotBuffer
+ * @brief The published snapshot plus a spare to extract the next one into.
+ *
+ * extract() refills the spare once no reader holds it any more (otherwise
+ * a fresh snapshot is allocated), then swaps it to the front. Readers keep
+ * whatever latest() returned for as long as they draw, from any thread.
+ */
+class RenderSnapshotBuffer
+{
+public:
+    // GUI thread, after the logic update. Also refreshes each mesh's
+    // RenderResourceComponent::meshKey and its MeshKeyRefs count.
+    void extract(entt::registry& registry);
+
+    // Whether extract() fills RenderSnapshot::frames: every link's world
+    // matrix from TransformSystem's propagation output, its sensor mounts,
+    // and the links of articulated prefab instances.
+    void setExtractFrames(bool on) { m_extractFrames = on; }
+
+    // Any thread. Null before the first extract().
+    std::shared_ptr<const RenderSnapshot> latest() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::shared_ptr<RenderSnapshot> m_front;
+    std::shared_ptr<RenderSnapshot> m_spare;
+    std::uint64_t m_frame = 0;
+    bool m_extractFrames = false;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Running totals of the GL work the render code issues, for the performance
+ * HUD. Counting is a plain increment at each draw, dispatch and data upload
+ * (indirect and multi-draws count one per command), so it stays on in every
+ * build. Primitives come from GpuProfiler's per-frame GL_PRIMITIVES_GENERATED
+ * query and are only counted while profiling, a few frames late.
+ *
+ * GUI thread only, like every GL call; readers diff two samples of totals().
+ */
+namespace RenderStats
+{
+    struct Totals {
+        std::uint64_t drawCalls = 0;
+        std::uint64_t dispatches = 0;
+        std::uint64_t uploadBytes = 0;   ///< CPU data handed to buffers and textures
+        std::uint64_t primitives = 0;
+    };
+
+    inline Totals& totals()
+    {
+        static Totals t;
+        return t;
+    }
+
+    inline void draw(std::uint64_t commands = 1) { totals().drawCalls += commands; }
+    inline void dispatch() { ++totals().dispatches; }
+    inline void upload(std::uint64_t bytes) { totals().uploadBytes += bytes; }
+}
@@ -6,22 +6,53 @@
  *  Works with Qt 6.9, OpenGL 4.1 core profile.
  *-----------------------------------------------------------------*/
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include "Camera.hpp"
 #include <glm/glm.hpp>
 #include <entt/entt.hpp>
 #include "GpuResources.hpp"
+#include "MeshArena.hpp"
+#include "SplineArena.hpp"
+#include "MaterialTable.hpp"
+#include "GLStateCache.hpp"
+#include "ShaderBinaryCache.hpp"
+#include "ComputeDispatch.hpp"
+#include "GpuProfiler.hpp"
+#include "EffectorBuffers.hpp"
+#include "PointCloudRenderer.hpp"
+#include "SensorBuffers.hpp"
+#include "VoxelReconstruction.hpp"
+#include "VirtualSensors.hpp"
+#include "CullingSystem.hpp"
+#include "RenderSnapshot.hpp"
+#include "GlyphAtlas.hpp"
  /*  Qt / OpenGL --------------------------------------------------- */
 #include <QOpenGLFunctions_4_3_Core>   // gives GLuint / GLenum, etc.
 #include <QOpenGLWidget>               // we pass a pointer to one
 #include <QTimer>
+#include <QSet>
+#include <QString>
+
+// Dev builds (CMake option KR_SHADER_HOT_RELOAD) read shaders from the source
+// tree and recompile a program when one of its files changes; otherwise the
+// sources compiled into resources.qrc are used.
+#ifndef KR_SHADER_HOT_RELOAD
+#  define KR_SHADER_HOT_RELOAD 0
+#endif
 
 /*  Forward declarations (keeps compile times low) ---------------- */
 class Shader;
 class FieldSolver;
 struct ColorStop;
+struct RenderableMeshComponent;
+struct FieldVisualizerComponent;
 class QOpenGLContext;
+class QFileSystemWatcher;
+class QOpenGLDebugLogger;
+class QOpenGLDebugMessage;
 
 /*==================================================================
  *  Class
@@ -56,6 +87,27 @@ public:
     QOpenGLContext* m_ownerCtx = nullptr;
 
     void renderView(QOpenGLWidget* viewport, entt::registry& registry, entt::entity cameraEntity, int viewportWidth, int viewportHeight);
+    /// Identifies a render target's FBO set: a viewport widget, or any stable
+    /// address a headless target picks for itself (see OffscreenRenderer).
+    using RenderTargetId = const void*;
+    /// Same pipeline, composited into 'outputFBO' instead of the current
+    /// context's default framebuffer. No widget is involved, so picking is
+    /// unavailable for such targets.
+    void renderView(RenderTargetId targetId, GLuint outputFBO, entt::registry& registry,
+        entt::entity cameraEntity, int outputWidth, int outputHeight);
+    /// Both eyes of 'cameraEntity' in one pass (see setStereo), composited into
+    /// 'leftFBO' and 'rightFBO'. When both are 0, a native stereo window's
+    /// default framebuffer, the eyes go to its GL_BACK_LEFT and GL_BACK_RIGHT.
+    /// The projection window (setProjectionWindow) does not apply.
+    void renderStereoView(RenderTargetId targetId, GLuint leftFBO, GLuint rightFBO, entt::registry& registry,
+        entt::entity cameraEntity, int outputWidth, int outputHeight);
+    /// Frees a target's FBO set; a context of the share group must be current.
+    void releaseTarget(RenderTargetId targetId);
+    /// GUI thread, once per tick after the logic update: copies what the mesh
+    /// passes draw into a RenderSnapshot. Views of this registry render from
+    /// the latest copy until the next call; views of a registry that is never
+    /// extracted (the import preview) take their own copy at paint time.
+    void extractSnapshot(entt::registry& registry);
 
     void shutdown(entt::registry& registry);
     void ensureGlResolved();
@@ -75,7 +127,20 @@ public:
     /* ------------------------------------------------------------ */
     void setCurrentCamera(entt::entity e) { m_currentCamera = e; }
     void updateCameraTransforms(entt::registry& r);
-    void updateAnimations(entt::registry& registry, float frameDt);
+    /// Pulses are functions of time: AnimationTracks, sampled at the interpolated render clock.
+    void updateAnimations(entt::registry& registry);
+    /// Real time since the previous master tick (not once per viewport).
+    void advanceFrameTime(float deltaTime);
+    float frameDelta() const { return m_frameDelta; }
+    /// One fixed simulation step, from MainWindow's accumulator. Particle and
+    /// flow fields integrate every step they missed the next time one is drawn,
+    /// so their speed depends neither on the frame rate nor the viewport count.
+    void stepSimulation(float step);
+    /// Where the displayed frame sits between the last two steps, in [0, 1).
+    void setSimulationAlpha(float alpha);
+    /// True if something changes every frame on its own (pulses, particles),
+    /// so viewports cannot skip redraws even when nothing moved.
+    bool hasContinuousAnimation(entt::registry& registry) const;
     static bool isDescendantOf(entt::registry&, entt::entity child, entt::entity potentialAncestor);
     bool isRenderCtx(const QOpenGLContext* ctx) const noexcept;
     /* ------------------------------------------------------------ */
@@ -86,10 +151,256 @@ public:
     {
         m_gl = funcs; // Set the internal pointer to the one provided by the active context.
     }
-    
+
+    /// PerEntity: one glDrawElements per mesh entity (legacy path).
+    /// Batched:   entities grouped by mesh content, one indirect draw per unique mesh.
+    enum class MeshPassMode { PerEntity, Batched };
+    void setMeshPassMode(MeshPassMode mode) { m_meshPassMode = mode; }
+    MeshPassMode meshPassMode() const { return m_meshPassMode; }
+
+    /// Store arena vertices as 16-byte MeshArena::PackedVertex instead of the
+    /// 32-byte Vertex. Switching re-uploads every mesh on the next mesh pass.
+    void setCompactVertices(bool on) { m_compactVertices = on; }
+    bool compactVertices() const { return m_compactVertices; }
+
+    /// Draw the coarsest MeshData::lods level whose error projects to at most
+    /// this many pixels. 0 always draws the full mesh.
+    void setLodPixelError(float pixels) { m_lodPixelError = pixels; }
+    float lodPixelError() const { return m_lodPixelError; }
+
+    /// Skip meshes whose WorldBoundsComponent lies outside the view frustum.
+    void setFrustumCullingEnabled(bool on) { m_frustumCulling = on; }
+    bool frustumCullingEnabled() const { return m_frustumCulling; }
+
+    /// Batched mesh pass only: draw what the view saw last frame, reduce its
+    /// depth to a Hi-Z pyramid, then draw the rest of what that pyramid does
+    /// not hide. Off, or short of SSBO bindings, every in-frustum mesh draws.
+    void setOcclusionCullingEnabled(bool on) { m_occlusionCulling = on; }
+    bool occlusionCullingEnabled() const { return m_occlusionCulling; }
+    /// Batched mesh pass only: meshes that MeshBinary split into clusters
+    /// draw at full detail cluster by cluster, each tested on the GPU
+    /// against the frustum, its normal cone and the Hi-Z pyramid.
+    void setClusterCullingEnabled(bool on) { m_clusterCulling = on; }
+    bool clusterCullingEnabled() const { return m_clusterCulling; }
+    /// Batched mesh pass only: the snapshot's GPU posed fleets (see
+    /// PrefabSystem::setGpuPosing) are posed by a compute pass that writes
+    /// their part instances into the pass's instance buffer. False before
+    /// initialize() or short of SSBO bindings; fleets are not drawn then.
+    bool gpuKinematicsSupported() const;
+    /// PointLightComponents light the meshes through a froxel grid binned
+    /// per view, so each fragment shades only the lights that reach it.
+    void setClusteredLightingEnabled(bool on) { m_clusteredLighting = on; }
+    bool clusteredLightingEnabled() const { return m_clusteredLighting; }
+    /// Cascaded shadow maps of the directional key light. Casters that have
+    /// not moved for a while are cached per cascade and redrawn only when
+    /// one of them moves or the cascade does.
+    void setShadowsEnabled(bool on) { m_shadows = on; }
+    bool shadowsEnabled() const { return m_shadows; }
+    /// A coordinate triad at every link frame and sensor mount, robots and
+    /// articulated prefab instances alike, a fixed size on screen. All of
+    /// them are one instanced draw.
+    void setFramesShown(bool on) { m_showFrames = on; }
+    bool framesShown() const { return m_showFrames; }
+
+    /// The final full-screen pass runs the enabled effects, applied in the
+    /// order fog, glow, tonemap, saturation, vignette, as one program
+    /// generated per combination (compiled on first use). The scene is read
+    /// once and the output written once however many are on; an effect that
+    /// is off is compiled out. Glow drops out on frames without a glow.
+    enum PostEffect : std::uint32_t {
+        PostGlow       = 1u << 0,   ///< selection glow, screen-blended
+        PostTonemap    = 1u << 1,   ///< exposure and ACES filmic
+        PostSaturation = 1u << 2,
+        PostFog        = 1u << 3,   ///< exponential in view distance, from the scene depth
+        PostVignette   = 1u << 4,
+    };
+    void setPostEffects(std::uint32_t effects) { m_postEffects = effects & kPostUserEffects; }
+    std::uint32_t postEffects() const { return m_postEffects; }
+    void setFog(const glm::vec3& color, float density) { m_fogColor = color; m_fogDensity = std::max(0.0f, density); }
+    void setVignette(float strength) { m_vignette = std::clamp(strength, 0.0f, 1.0f); }
+
+    /// Anti-aliasing of each viewport's scene, cheapest first:
+    /// None: one sample per pixel.
+    /// Fxaa: an edge-directed blur folded into the composite pass; no extra
+    ///       memory, softens text-like detail a little.
+    /// Taa:  the projection jitters by a sub-pixel Halton offset each frame
+    ///       and a resolve pass blends the frame into a reprojected history
+    ///       (two extra RGBA16F textures). Best on thin lines while the
+    ///       camera is still; movers are clamped rather than reprojected.
+    /// Msaa: the scene passes draw into 'samples'-sample attachments that are
+    ///       resolved with glBlitFramebuffer before the selection passes; fill
+    ///       and target memory grow with the sample count, clamped to what
+    ///       the driver allows. Changing it recreates the targets.
+    /// KR_ANTIALIASING=none|fxaa|taa|msaa<N> picks one at start-up.
+    enum class AntiAliasing { None, Fxaa, Taa, Msaa };
+    void setAntiAliasing(AntiAliasing mode, int samples = 4) { m_antiAliasing = mode; m_msaaSamples = std::max(2, samples); }
+    AntiAliasing antiAliasing() const { return m_antiAliasing; }
+    int msaaSamples() const { return m_msaaSamples; }
+
+    /// CpuEvaluated:   curves sampled on the CPU and re-expanded into GL_LINES every frame.
+    /// GpuTessellated: only control points are uploaded (once per edit); the
+    ///                 tessellator sizes each segment by its on-screen length.
+    ///                 Parametric splines always take the CPU path.
+    enum class SplineRenderMode { CpuEvaluated, GpuTessellated };
+    void setSplineRenderMode(SplineRenderMode mode) { m_splineRenderMode = mode; }
+    SplineRenderMode splineRenderMode() const { return m_splineRenderMode; }
+
+    /// Selection glow blur. GaussianPingPong: nine separable passes at full
+    /// viewport resolution. MipChain: downsample to 1/2, 1/4 and 1/8, then
+    /// tent-upsample back, so the wide blur is paid for at low resolution.
+    enum class GlowMode { GaussianPingPong, MipChain };
+    void setGlowMode(GlowMode mode) { m_glowMode = mode; }
+    GlowMode glowMode() const { return m_glowMode; }
+
+    /// Glow:           selected meshes drawn emissive, blurred (see GlowMode), composited.
+    /// StencilOutline: a crisp outline straight into the scene FBO; two draws per
+    ///                 selected mesh (stencil mark, extruded hull) and no blur passes.
+    enum class SelectionStyle { Glow, StencilOutline };
+    void setSelectionStyle(SelectionStyle style) { m_selectionStyle = style; }
+    SelectionStyle selectionStyle() const { return m_selectionStyle; }
+    void setSelectionOutlineWidth(float pixels) { m_selectionOutlineWidth = pixels; }
+    float selectionOutlineWidth() const { return m_selectionOutlineWidth; }
+
+    /// Standard: 24-bit depth, [-1, 1] clip z, GL_LESS.
+    /// ReverseZ: 32F depth, glClipControl(GL_ZERO_TO_ONE), an infinite reversed
+    ///           projection and GL_GREATER, so precision holds from millimetres
+    ///           to hundreds of metres. Falls back to Standard without clip control.
+    enum class DepthMode { Standard, ReverseZ };
+    void setDepthMode(DepthMode mode) { m_depthMode = mode; }
+    DepthMode depthMode() const { return m_depthMode; }
+    bool reverseZActive() const { return m_depthMode == DepthMode::ReverseZ && m_clipControl; }
+
+    /// Logs the arrow field's indirect command and first instances, read back
+    /// asynchronously a frame or two late. Off by default: the normal path never
+    /// waits on the GPU.
+    void setFieldReadbackDebug(bool on) { m_fieldReadbackDebug = on; }
+    bool fieldReadbackDebug() const { return m_fieldReadbackDebug; }
+
+    /// GPU picking: the mesh pass also writes entity ID + 1 into an R32UI
+    /// attachment of each viewport's main FBO. Toggling recreates the targets.
+    void setIdBufferPicking(bool on);
+    bool idBufferPicking() const { return m_idBufferPicking; }
+
+    /// Stereo viewports, on surfaces granted QSurfaceFormat::StereoBuffers:
+    /// culling, lights, shadows and the batched mesh submission are shared,
+    /// and one indirect draw covers both eyes, instanced into the two layers
+    /// of a layered FBO. The overlays (grid, point clouds, labels, ...) draw
+    /// once per eye. Without MSAA, TAA, occlusion or cluster culling, glow or
+    /// ID-buffer picking; the selection is outlined instead. Mono without a
+    /// stereo surface or when off.
+    void setStereo(bool on) { m_stereo = on; }
+    bool stereo() const { return m_stereo; }
+    bool stereoActive(const QOpenGLWidget* viewport) const;
+    /// Distance between the eyes, and to the plane both eyes see at the same
+    /// place (zero parallax), in metres.
+    void setEyeSeparation(float metres) { m_eyeSeparation = std::max(0.0f, metres); }
+    float eyeSeparation() const { return m_eyeSeparation; }
+    void setStereoConvergence(float metres) { m_stereoConvergence = std::max(0.01f, metres); }
+    float stereoConvergence() const { return m_stereoConvergence; }
+    /// Queues a read of the ID buffer under a widget-space rectangle (logical
+    /// pixels). It is issued after that viewport's next mesh pass through a
+    /// PBO and fenced, so the result arrives a frame or more later.
+    void requestPick(QOpenGLWidget* viewport, int x, int y, int w = 1, int h = 1);
+    /// Non-blocking. Once the queued read has landed, fills 'entities' with the
+    /// unique entities under the rectangle and returns true. Needs a context
+    /// of the share group current.
+    bool takePickResult(QOpenGLWidget* viewport, std::vector<entt::entity>& entities);
+
+    /// Per-pass GPU (GL_TIME_ELAPSED) and CPU timings for every viewport, read
+    /// back a few frames late so profiling never stalls. Off by default.
+    void setProfilingEnabled(bool on) { m_profiling = on; }
+    bool profilingEnabled() const { return m_profiling; }
+    /// Timings of one viewport or headless target, or nullptr before it has
+    /// been rendered.
+    const GpuProfiler* profiler(RenderTargetId targetId) const;
+    /// Workgroup size, tuning state and per-dispatch timings of the field
+    /// compute kernels; timed while profiling is on.
+    const ComputeDispatch& computeDispatch() const { return m_compute; }
+    /// Records every harvested pass of every viewport until stopped, and
+    /// runs a TraceZones capture alongside.
+    void setProfileCapture(bool on);
+    bool profileCapture() const { return m_profileCapture; }
+    /// Writes the capture as Chrome trace JSON (chrome://tracing, Perfetto):
+    /// one CPU and one GPU track per viewport, then one track per thread
+    /// that closed a zone.
+    bool writeProfileTrace(const QString& path) const;
+
+    /// Diagnostic GL capture for the next 'frames' ticks: a profile capture
+    /// with every pass in a KHR_debug group, plus the driver's debug
+    /// messages, logged asynchronously per viewport (QOpenGLDebugLogger) and
+    /// bounded to kMaxGlMessages. Written as writeProfileTrace() to 'path'
+    /// at the end, the messages as instant events on their viewport's CPU
+    /// track. Debug contexts (KR_GL_DEBUG=1, debug builds) report
+    /// everything; others only what the driver sends without one.
+    static constexpr int kGlCaptureFrames = 120;
+    static constexpr std::size_t kMaxGlMessages = 20000;
+    void startGlCapture(int frames, const QString& path);
+    bool glCaptureActive() const { return m_glCaptureFrames > 0; }
+
+    /// Dynamic resolution: each viewport lowers its internal render scale
+    /// (down to minRenderScale) while its GPU time misses the budget and
+    /// raises it again once there is headroom. The composite upscales with a
+    /// Catmull-Rom filter. Runs the GPU timers even with the overlay off.
+    void setDynamicResolution(bool on) { m_dynamicResolution = on; }
+    // Seeds the particle spawns (CPU and GPU): the same seed and steps give
+    // the same particles on any machine. Applies to buffers seeded from now on.
+    void setRandomSeed(std::uint32_t seed) { m_randomSeed = seed; }
+    std::uint32_t randomSeed() const { return m_randomSeed; }
+    bool dynamicResolution() const { return m_dynamicResolution; }
+    /// Renders the next views as one window of a larger image (see
+    /// PosterRenderer): the projection is that of a 'full' sized view,
+    /// cropped to 'window' (x, y, w, h in its pixels, y down) and shifted by
+    /// 'jitter' window pixels. A zero-sized window goes back to whole views.
+    void setProjectionWindow(const glm::ivec2& full, const glm::ivec4& window, const glm::vec2& jitter = glm::vec2(0.0f))
+    {
+        m_windowFull = full;
+        m_window = window;
+        m_windowJitter = jitter;
+    }
+    void setGpuFrameBudgetMs(float ms) { m_gpuFrameBudgetMs = std::max(1.0f, ms); }
+    float gpuFrameBudgetMs() const { return m_gpuFrameBudgetMs; }
+    void setMinRenderScale(float scale) { m_minRenderScale = std::clamp(scale, 0.25f, 1.0f); }
+    /// Scale of a viewport's last frame, 1 before it has been rendered.
+    float renderScale(RenderTargetId targetId) const;
+    /// Draws the viewport's next frame at full resolution without touching
+    /// its controller: used to refine the image once the view is idle.
+    void requestFullResolution(RenderTargetId targetId);
+    /// While the dock layout is dragged or resized, viewports draw at the
+    /// minimum render scale and keep any FBOs that cover that, so resize
+    /// steps neither reallocate nor render full size. The controller is
+    /// left alone; end it with requestFullResolution() for the final frame.
+    void setLayoutInteraction(bool active) { m_layoutInteraction = active; }
+    bool layoutInteraction() const { return m_layoutInteraction; }
+
+    /// Points: GL_POINTS sized to each octree node's spacing.
+    /// Splat:  a compute rasterizer, one pixel per point, nearest kept with
+    ///         atomics in an SSBO and resolved into the scene FBO with depth
+    ///         (one pass with 64-bit atomics, else a depth and a colour pass).
+    ///         Nodes refine to one pixel of spacing instead of two.
+    enum class PointCloudMode { Points, Splat };
+    void setPointCloudMode(PointCloudMode mode) { m_pointCloudMode = mode; }
+    PointCloudMode pointCloudMode() const { return m_pointCloudMode; }
+    /// Eye-dome lighting on splatted clouds: shades each point by how far its
+    /// neighbours 'radius' pixels away stand in front of it. 0 turns it off.
+    void setEyeDomeLighting(float strength, float radius = 1.4f)
+    {
+        m_edlStrength = std::max(0.0f, strength);
+        m_edlRadius = std::max(1.0f, radius);
+    }
+    float eyeDomeLightingStrength() const { return m_edlStrength; }
+
+    struct ShadowCascade
+    {
+        glm::mat4 lightViewProjection{ 1.0f }; ///< of the cached static layer; snapped, so it changes rarely
+        std::uint64_t staticKey = 0;           ///< the static casters it holds
+        bool staticValid = false;
+        bool dynamicDrawn = false;             ///< the sampled layer differs from the static one
+    };
+
     struct TargetFBOs
     {
-        int    w = 0, h = 0;
+        int    w = 0, h = 0;                 ///< allocated size, in 256 px buckets
+        int    viewW = 0, viewH = 0;         ///< region drawn this frame, bottom-left aligned
         GLuint mainFBO = 0,
             mainColorTexture = 0,
             mainDepthTexture = 0,
@@ -97,15 +408,101 @@ public:
             glowTexture = 0,
             pingpongFBO[2] = { 0,0 },
             pingpongTexture[2] = { 0,0 };
+        GLuint idTexture = 0;             ///< R32UI pick IDs, only with ID-buffer picking
+        GLenum depthFormat = 0;           ///< internal format of mainDepthTexture
+
+        /* --- AntiAliasing::Msaa: the scene passes draw here, resolved into mainFBO --- */
+        GLuint msaaFBO = 0;
+        GLuint msaaColor = 0, msaaDepth = 0, msaaId = 0;   ///< multisample textures, as the main ones
+        int    msaaSamples = 0;                            ///< 0: no multisampled attachments
+        GLuint sceneFBO() const { return stereoDrawFBO ? stereoDrawFBO : msaaSamples ? msaaFBO : mainFBO; }
+
+        /* --- stereo, created on first use: layer 0 the left eye, 1 the right --- */
+        GLuint stereoColor = 0, stereoDepth = 0;   ///< RGBA16F and depth-stencil 2D arrays, immutable
+        GLuint stereoFBO = 0;                      ///< both layers (layered): the shared mesh pass
+        GLuint stereoEyeFBO[2] = {};               ///< one layer each: the per-eye passes
+        GLuint stereoEyeColor[2] = {};             ///< 2D views of one layer, read by the composite
+        GLuint stereoEyeDepth[2] = {};
+        int    stereoW = 0, stereoH = 0;
+        GLenum stereoDepthFormat = 0;
+        GLuint stereoDrawFBO = 0;                  ///< during a stereo frame: what sceneFBO() returns
+
+        /* --- AntiAliasing::Taa, created on first use --- */
+        GLuint taaFBO = 0;
+        GLuint taaHistory[2] = {};        ///< RGBA16F, ping-ponged; the resolved scene
+        int    taaCurrent = 0;            ///< written by the last resolve
+        bool   taaValid = false;
+        std::uint32_t taaFrame = 0;       ///< picks the jitter
+        int    taaViewW = 0, taaViewH = 0;                 ///< region of the current history
+        glm::mat4 taaViewProjection{ 1.0f };               ///< unjittered, of the current history
+
+        /* --- occlusion culling, created on first use --- */
+        GLuint hizTexture = 0;            ///< R32F farthest-depth pyramid, level 0 at half size
+        int    hizLevels = 0;
+        GLuint visibilityBuffer = 0;      ///< uint per entity index: passed the last test
+        GLsizeiptr visibilityCapacity = 0;
+
+        /* --- cascaded shadows, created on first use; independent of the size --- */
+        GLuint shadowFBO = 0;
+        GLuint shadowTexture = 0;         ///< depth array, see kShadowCascades
+        ShadowCascade shadowCascades[kShadowCascades];
+
+        /* --- GlowMode::MipChain, created on first use --- */
+        static constexpr int kBloomLevels = 3; ///< 1/2, 1/4, 1/8 of the target size
+        GLuint bloomFBO[kBloomLevels] = {};
+        GLuint bloomTexture[kBloomLevels] = {};
+
+        /* --- ID-buffer pick readback --- */
+        bool   pickRequested = false;
+        int    pickX = 0, pickY = 0, pickW = 0, pickH = 0;  ///< widget space, as requested
+        int    readW = 0, readH = 0;                        ///< size of the read in flight
+        GLuint pickPBO = 0;
+        GLsizeiptr pickPBOSize = 0;
+        GLsync pickFence = nullptr;
+
+        GpuProfiler profiler;             ///< queries belong to this viewport's context
+        QOpenGLWidget* widget = nullptr;  ///< null for headless targets
+        QOpenGLDebugLogger* debugLogger = nullptr;   ///< during a GL capture, on this context
+        bool debugLoggerTried = false;
+
+        /* --- dynamic resolution --- */
+        float renderScale = 1.0f;         ///< controller's choice
+        float drawnScale = 1.0f;          ///< what the last frame actually used
+        int   scaleHoldFrames = 0;        ///< timings still include frames at an older scale
+        bool  fullResolutionOnce = false;
     };
 
 
 
 
-    void renderMeshes(entt::registry& registry,
+    void renderMeshes(const RenderSnapshot& snapshot,
         const glm::mat4& view,
         const glm::mat4& projection,
-        const glm::vec3& camPos);
+        const glm::vec3& camPos,
+        TargetFBOs& target);
+    // Streams and draws every PointCloudComponent into the region of
+    // 'target' drawn this frame, so point sizes follow the render scale.
+    void renderPointClouds(entt::registry& registry, const glm::vec3& camPos,
+        const glm::mat4& projection, TargetFBOs& target);
+    // Fuses the sensors into the ReconstructionComponent's surface, once per
+    // tick, tracking them first if asked; its blocks are drawn by the mesh passes.
+    void updateReconstruction(entt::registry& registry, GpuProfiler* profiler);
+    // Renders the VirtualSensorComponents due this tick from the scene's
+    // meshes and packs their points, once per tick; restores 'target'.
+    void simulateVirtualSensors(entt::registry& registry, const RenderSnapshot& snapshot, TargetFBOs& target);
+    // Live SensorStreamComponent points, drawn straight from their rings;
+    // point sizes scale with the view's render scale.
+    void renderSensorStreams(entt::registry& registry, float renderScale);
+    // The snapshot's trajectory ghosts, blended over the scene without
+    // writing depth: one indirect draw per link mesh, instanced per ghost.
+    void renderGhosts(const RenderSnapshot& snapshot);
+    // The snapshot's frames as triads: one instanced draw, its matrices
+    // uploaded once per snapshot and context.
+    void renderFrames(const RenderSnapshot& snapshot);
+    // The snapshot's labels over the scene: one instanced draw of every
+    // glyph quad. Only the quads of labels whose text changed (or moved in
+    // the buffer) are rewritten; anchors and colours go up once per snapshot.
+    void renderLabels(const RenderSnapshot& snapshot);
     void renderGrid(entt::registry& registry,
         const glm::mat4& view,
         const glm::mat4& projection,
@@ -116,17 +513,32 @@ public:
         const glm::vec3& eye,
         int viewportWidth,
         int viewportHeight);
+    // Effector gather and particle / flow / arrow compute, once per tick into
+    // buffers every viewport shares; the first view of the tick runs it.
+    void simulateFieldVisualizers(entt::registry& registry);
+    // Draw only; adding a viewport adds draws, not compute.
     void renderFieldVisualizers(entt::registry& registry,
         const glm::mat4& view,
-        const glm::mat4& projection,
-        float deltaTime);
-    void renderSelectionGlow(QOpenGLWidget* viewport, entt::registry& registry,
+        const glm::mat4& projection);
+    // Returns the blurred glow texture to composite, or 0 when nothing is selected.
+    GLuint renderSelectionGlow(RenderTargetId targetId, const RenderSnapshot& snapshot,
         const glm::mat4& view, 
         const glm::mat4& projection, 
         TargetFBOs& target);
-    void drawIntersections(const std::vector<std::vector<glm::vec3>>& allOutlines,
-        const glm::mat4& view,
-        const glm::mat4& proj);
+    GLuint blurGlowGaussian(TargetFBOs& target, GLuint compositeVAO);
+    GLuint blurGlowMipChain(TargetFBOs& target, GLuint compositeVAO);
+    void destroyBloomChain(TargetFBOs& target);
+    void renderSelectionOutline(const RenderSnapshot& snapshot, TargetFBOs& target);
+    // Red outline around every CollisionContactComponent entity, whatever the selection style.
+    void renderContactOutline(const RenderSnapshot& snapshot, TargetFBOs& target);
+    // Stencil mark + extruded hull for every snapshot mesh with 'flag' set.
+    void renderStencilOutline(const RenderSnapshot& snapshot, bool RenderSnapshot::Mesh::* flag,
+        TargetFBOs& target, const glm::vec3& colour);
+    // IntersectionSystem::outlines(), all in one buffer and one multi-draw;
+    // re-uploaded only when 'generation' (IntersectionSystem::generation())
+    // differs from the last upload. Timed as the "intersections" GPU scope
+    // of renderView and the "drawIntersections" zone.
+    void drawIntersections(const std::vector<std::vector<glm::vec3>>& allOutlines, std::uint64_t generation);
 
 private slots:
     void onContextDestroyed(QObject* context);
@@ -138,6 +550,59 @@ private:
     /* ------------------------------------------------------------ */
     void initShaders();
     void initFramebuffers(int width, int height);
+    void resolveClipControl();
+    // Clip range, depth func and clear depth for the scene pass; restoreDepthConvention()
+    // returns the context to GL defaults for Qt and the composite.
+    void applyDepthConvention(bool reverseZ);
+    void restoreDepthConvention(bool reverseZ);
+
+    // One linked program: the member it lives in and its files under shaders/.
+    // Stages are inferred from the _vert/_tesc/_tese/_geom/_frag/_comp suffix,
+    // except two-file programs, which are always vertex + fragment.
+    struct ShaderProgramSource {
+        std::unique_ptr<Shader> RenderingSystem::* slot;
+        std::vector<std::string> files;
+    };
+    static const std::vector<ShaderProgramSource>& shaderProgramSources();
+    static std::string shaderPath(const std::string& file);
+    std::unique_ptr<Shader> buildShaderProgram(const ShaderProgramSource& source);
+    std::unique_ptr<Shader> buildComputeKernel(ComputeDispatch::Kernel kernel, GLuint localSize);
+#if KR_SHADER_HOT_RELOAD
+    void watchShaderSources();
+    void reloadChangedShaders(); // renderView only: needs a current context
+    std::unique_ptr<QFileSystemWatcher> m_shaderWatcher;
+    QSet<QString> m_changedShaderFiles;   ///< file names edited since the last reload
+#endif
+
+    void renderMeshesPerEntity(const RenderSnapshot& snapshot, QOpenGLContext* ctx,
+        const glm::mat4& view, const glm::mat4& projection, const glm::vec3& camPos);
+    void renderMeshesBatched(const RenderSnapshot& snapshot, QOpenGLContext* ctx,
+        const glm::mat4& view, const glm::mat4& projection, const glm::vec3& camPos, TargetFBOs& target);
+    // The cluster pass over m_clusterJobScratch, after the batched draws;
+    // tests against target's Hi-Z pyramid when 'hizBuilt'.
+    void renderClusters(QOpenGLContext* ctx, TargetFBOs& target, GLuint drawSlots, GLuint maxClusters, bool hizBuilt);
+    // GPU posed fleets. layoutFleets() packs the snapshot's links (in level
+    // order), parts and instance roots, with the material records. Per view,
+    // appendFleetDraws() picks the instances in the frustum and appends a
+    // command per part whose instances start at 'firstInstance'; it returns
+    // how many instances poseFleets() then writes there.
+    struct FleetLayout {
+        GLuint firstLink = 0, linkCount = 0;
+        GLuint firstPart = 0, partCount = 0;
+        std::uint32_t firstLevel = 0, levelCount = 0;   ///< into m_fleetLevelScratch
+        glm::dvec3 origin{ 0.0 };                        ///< the instances' translations are from here
+    };
+    struct FleetDraw { GLuint firstDrawn = 0, drawCount = 0, firstPose = 0, firstOutput = 0; };
+    void layoutFleets(const RenderSnapshot& snapshot);
+    GLuint appendFleetDraws(const RenderSnapshot& snapshot, GLuint firstInstance);
+    void poseFleets(QOpenGLContext* ctx, const RenderSnapshot& snapshot);
+    std::vector<FleetLayout> m_fleetLayouts;            ///< per snapshot fleet
+    std::vector<glm::uvec2> m_fleetLevelScratch;       ///< each level's first link (fleet relative) and count
+    std::vector<FleetLinkGpu> m_fleetLinkScratch;
+    std::vector<FleetPartGpu> m_fleetPartScratch;
+    std::vector<FleetInstanceGpu> m_fleetInstanceScratch;
+    std::vector<FleetDraw> m_fleetDraws;               ///< per snapshot fleet, this view
+    std::vector<GLuint> m_fleetDrawnScratch;           ///< this view's instances, into the fleet instances
     
     /* ------------------------------------------------------------ */
     /*  Private render sub-passes                                   */
@@ -146,6 +611,78 @@ private:
     glm::mat4 m_sceneViewMatrix;
     glm::mat4 m_sceneProjectionMatrix;
     glm::vec3 m_sceneCameraPos;
+    Frustum   m_frustum{};              ///< frustum of the view being rendered
+    Frustum   m_stereoFrustum{};        ///< stereo frames: the right eye's, m_frustum being the left's
+    bool      m_stereoFrame = false;    ///< while renderView draws both eyes of a stereo view
+    // Bounds against m_frustum, or against either eye's in a stereo frame.
+    bool inFrustum(const glm::vec3& min, const glm::vec3& max) const;
+    glm::dvec3 m_eye{ 0.0 };            ///< its eye, in double: see eyeRelative()
+    // 'model' with the eye subtracted from its translation in double, for
+    // the camera-relative passes: no large coordinate reaches the GPU.
+    glm::mat4 eyeRelative(const glm::mat4& model) const;
+    bool      m_frustumCulling = true;
+    bool isCulled(const RenderSnapshot::Mesh& mesh) const;
+    // The current view's draw list (indices into the snapshot's meshes) and
+    // layers; see RenderSnapshot::View. Set by renderView().
+    const std::vector<std::uint32_t>* m_viewMeshes = nullptr;
+    std::vector<std::uint32_t> m_viewMeshScratch;
+    std::uint32_t m_viewLayers = RenderLayers::All;
+    bool inView(const RenderSnapshot::Mesh& mesh) const
+    {
+        return mesh.camera != m_currentCamera && (mesh.layers & m_viewLayers) != 0;
+    }
+    bool      m_occlusionCulling = true;
+    GLint     m_storageBindings = 0;    ///< GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS
+    bool occlusionCullingActive() const;
+    void buildHiZ(TargetFBOs& target);
+    void destroyOcclusion(TargetFBOs& target);
+    bool      m_clusterCulling = true;
+    bool clusterCullingActive() const;
+    // Bins the snapshot's lights for this view (before the mesh pass) and
+    // leaves the grid bound; setSceneShading() points a phong shader at it,
+    // the shadow cascades and the material table.
+    void cullLights(const RenderSnapshot& snapshot, const glm::mat4& projection);
+    void setSceneShading(Shader& shader) const;
+    // Material records of the snapshot's meshes, rebuilt when the snapshot
+    // changes or a map streamed in, and bound for the mesh pass. Asks the
+    // streamer for each map by its meshes' footprint from 'camPos'.
+    void updateMaterials(const RenderSnapshot& snapshot, const glm::vec3& camPos);
+    MaterialTable m_materials;
+    std::vector<GLuint> m_meshMaterials;            ///< record index per snapshot.meshes entry
+    const RenderSnapshot* m_materialSnapshot = nullptr;
+    std::uint64_t m_materialFrame = 0;
+    bool      m_clusteredLighting = true;
+    GLuint    m_viewLights = 0;         ///< lights binned for the view being rendered
+    GLuint    m_lightBuffer = 0;        ///< LightGpu[], shared by every view
+    GLsizeiptr m_lightCapacity = 0;
+    GLuint    m_lightGridBuffer = 0;    ///< uvec2 per froxel
+    GLuint    m_lightIndexBuffer = 0;   ///< counter, then kLightIndexCapacity indices
+    std::vector<LightGpu> m_lightScratch;
+    // Draws the view's shadow cascades, before the mesh pass, and leaves the
+    // map bound on kShadowTextureUnit for setSceneShading().
+    void renderShadows(const entt::registry& registry, const RenderSnapshot& snapshot,
+        const glm::mat4& view, const glm::mat4& projection, const glm::vec3& camPos, TargetFBOs& target);
+    void destroyShadows(TargetFBOs& target);
+    bool      m_shadows = true;
+    bool      m_showFrames = false;
+    bool      m_viewShadows = false;    ///< the view being rendered has cascades
+    glm::mat4 m_shadowMatrices[kShadowCascades];   ///< world -> [0, 1] shadow map space
+    float     m_shadowTexels[kShadowCascades] = {}; ///< world size of a shadow texel
+    struct ShadowCasterState {
+        glm::mat4 model{ 1.0f };
+        std::size_t meshKey = 0;
+        std::uint64_t movedFrame = 0;   ///< snapshot frame of the last change
+        std::uint64_t seenFrame = 0;
+    };
+    struct ShadowCasters {
+        std::uint64_t frame = 0;        ///< snapshot frame the states were updated for
+        std::unordered_map<entt::entity, ShadowCasterState> states;
+    };
+    std::unordered_map<const entt::registry*, ShadowCasters> m_shadowCasters;
+    float     m_lodPixelError = 1.0f;
+    float     m_lodPixelScale = 0.0f;   ///< pixels per world unit at distance 1 (or at any distance if orthographic)
+    bool      m_lodOrthographic = false;
+    int selectLod(const RenderSnapshot::Mesh& mesh, const MeshArena::Range& range, const glm::vec3& camPos) const;
     /* ==============================
      *  Data members
      * ============================== */
@@ -159,7 +696,20 @@ private:
     /* --- dimensions --- */
     int m_width = 0;
     int m_height = 0;
-    float m_elapsedTime = 0.0f;
+    float m_elapsedTime = 0.0f;         ///< render clock: the simulation clock, interpolated
+    float m_frameDelta = 1.0f / 60.0f;  ///< measured by MainWindow, see advanceFrameTime()
+    double m_simTime = 0.0;             ///< time of the latest simulation step
+    std::uint64_t m_simStep = 0;        ///< simulation steps taken so far
+    std::uint32_t m_randomSeed = 0;     ///< keys the particle RNG, see setRandomSeed()
+    float m_simStepSize = 1.0f / 60.0f;
+    float m_simAlpha = 0.0f;
+    static constexpr std::uint64_t kMaxCatchUpSteps = 8; ///< per visualizer and tick; more are dropped
+    std::uint64_t m_tick = 0;                        ///< master ticks, see advanceFrameTime()
+    std::uint64_t m_fieldSimTick = ~0ull;            ///< tick simulateFieldVisualizers() last ran
+    const entt::registry* m_fieldSimRegistry = nullptr;
+    GLsync m_fieldSimFence = nullptr;                ///< after that tick's compute
+    QOpenGLContext* m_fieldSimContext = nullptr;     ///< the context it ran in
+    int pendingSimSteps(FieldVisualizerComponent& vis) const;
     /* --- core services --- */
     std::unique_ptr<FieldSolver> m_fieldSolver;
     entt::entity                 m_currentCamera{ entt::null };
@@ -174,15 +724,86 @@ private:
     std::unique_ptr<Shader> m_instancedArrowShader;
     std::unique_ptr<Shader> m_emissiveSolidShader;
     std::unique_ptr<Shader> m_blurShader;
-    std::unique_ptr<Shader> m_compositeShader;
+    std::unique_ptr<Shader> m_bloomDownShader;
+    std::unique_ptr<Shader> m_bloomUpShader;
+    GlowMode m_glowMode = GlowMode::MipChain;
+    std::unique_ptr<Shader> m_selectionOutlineShader;
+    SelectionStyle m_selectionStyle = SelectionStyle::Glow;
+    float m_selectionOutlineWidth = 3.0f;
+    DepthMode m_depthMode = DepthMode::ReverseZ;
+    using ClipControlFn = void (QOPENGLF_APIENTRYP)(GLenum origin, GLenum depth);
+    ClipControlFn m_clipControl = nullptr; ///< GL 4.5 / ARB_clip_control, resolved in initialize()
+    using MultiDrawIndirectCountFn = void (QOPENGLF_APIENTRYP)(GLenum mode, GLenum type, const void* indirect,
+        GLintptr drawCount, GLsizei maxDrawCount, GLsizei stride);
+    MultiDrawIndirectCountFn m_multiDrawIndirectCount = nullptr; ///< GL 4.6 / ARB_indirect_parameters, or null
+    std::unique_ptr<Shader> m_compositeShader;   ///< the default post stack, KR_POST_EFFECTS unset
+    // The post program for 'effects' (PostEffect bits, plus kPostBicubic).
+    Shader* postShader(std::uint32_t effects);
+    static constexpr std::uint32_t kPostUserEffects = 0x1f;
+    static constexpr std::uint32_t kPostDefaultEffects = PostGlow | PostTonemap | PostSaturation;
+    static constexpr std::uint32_t kPostBicubic = 1u << 5;   ///< view drawn below output resolution
+    std::unordered_map<std::uint32_t, std::unique_ptr<Shader>> m_postShaders;   ///< null: failed to build
+    std::uint32_t m_postEffects = kPostDefaultEffects;
+    glm::vec3 m_fogColor{ 0.55f, 0.6f, 0.65f };
+    float m_fogDensity = 0.02f;
+    float m_vignette = 0.35f;
+    static constexpr std::uint32_t kPostFxaa = 1u << 6;
+    AntiAliasing m_antiAliasing = AntiAliasing::Fxaa;
+    int m_msaaSamples = 4;              ///< as asked for
+    GLint m_maxMsaaSamples = 0;         ///< of every scene attachment format, from initialize()
+    int activeMsaaSamples() const;
+    void destroyMsaa(TargetFBOs& target);
+    // Blits the multisampled scene's 'buffers' into mainFBO and leaves mainFBO
+    // bound; colour comes from and goes to 'attachment'.
+    void resolveMsaa(TargetFBOs& target, GLbitfield buffers, GLenum attachment = GL_COLOR_ATTACHMENT0);
+    // Sub-pixel offset for this frame, applied to the projection in NDC.
+    glm::mat4 temporalJitter(const TargetFBOs& target) const;
+    // Blends the frame into the target's history; returns the texture the
+    // composite should read. 'viewProjection' without the jitter.
+    GLuint resolveTemporal(TargetFBOs& target, const glm::mat4& viewProjection,
+        const glm::mat4& jitteredViewProjection, GLuint compositeVAO);
+    std::unique_ptr<Shader> m_taaResolveShader;
     std::unique_ptr<Shader> m_outlineShader;
-    std::unique_ptr<Shader> m_arrowFieldComputeShader;
-    std::unique_ptr<Shader> m_particleUpdateComputeShader;
     std::unique_ptr<Shader> m_particleRenderShader;
-    std::unique_ptr<Shader> m_flowVectorComputeShader;
+    std::unique_ptr<Shader> m_particleEmitShader;   ///< dead list -> alive list, indirect arguments
+    std::unique_ptr<Shader> m_particleCullShader;   ///< alive, in-frustum particles -> draw buffer
+    std::unique_ptr<Shader> m_particleSortShader;   ///< back-to-front radix sort of the draw buffer
+    std::unique_ptr<Shader> m_hizBuildShader;       ///< one level of a target's Hi-Z pyramid
+    std::unique_ptr<Shader> m_occlusionCullShader;  ///< both phases of the batched mesh occlusion test
+    std::unique_ptr<Shader> m_clusterCullShader;    ///< cluster draws of the batched pass's large meshes
+    std::unique_ptr<Shader> m_fleetKinematicsShader; ///< GPU posed fleets' link poses and part instances
+    std::unique_ptr<Shader> m_lightCullShader;      ///< point lights -> froxel grid
+    std::unique_ptr<Shader> m_shadowDepthShader;    ///< caster depth into one cascade, vertex stage only
+    std::unique_ptr<Shader> m_streamlineShader;     ///< RK4 streamline tracing through a baked field
+    std::unique_ptr<Shader> m_arrowRefineShader;    ///< adaptive arrow sampling from a baked field
+    ComputeDispatch m_compute;             ///< arrow, particle and flow kernels, in tuned workgroup sizes
+    std::unique_ptr<Shader> m_fieldBakeComputeShader;
+    std::unique_ptr<Shader> m_fieldTemporalBlendShader;   ///< temporal mode: two keyframes into the baked field
+    std::unique_ptr<Shader> m_instancedPhongShader;
+    std::unique_ptr<Shader> m_instancedPhongStereoShader;   ///< with stereo_layer_geom: both eyes per draw
+    std::unique_ptr<Shader> m_pointCloudShader;
+    std::unique_ptr<Shader> m_pointSplatShader;
+    std::unique_ptr<Shader> m_pointSplat64Shader;   ///< null without 64-bit atomics
+    std::unique_ptr<Shader> m_pointSplatResolveShader;
+    std::unique_ptr<Shader> m_sensorPointShader;
+    std::unique_ptr<Shader> m_reconstructionSplatShader;
+    std::unique_ptr<Shader> m_reconstructionIntegrateShader;
+    std::unique_ptr<Shader> m_reconstructionTrackShader;
+    std::unique_ptr<Shader> m_virtualSensorDepthShader;   ///< casters into up to 16 sensor views at once
+    std::unique_ptr<Shader> m_virtualSensorPackShader;
+    std::unique_ptr<Shader> m_ghostShader;
+    std::unique_ptr<Shader> m_frameTriadShader;
+    std::unique_ptr<Shader> m_labelShader;
+    std::unique_ptr<Shader> m_fieldVolumeShader;
+    ShaderBinaryCache m_shaderBinaryCache; ///< linked programs persisted across runs
     /* --- GPU resources --- */
 
-    GLuint m_intersectionVAO = 0, m_intersectionVBO = 0;
+    GLuint m_intersectionVBO = 0;           ///< every outline back to back, shared by the context group
+    GLsizeiptr m_intersectionCapacity = 0;
+    std::uint64_t m_intersectionGeneration = 0;   ///< IntersectionSystem::generation() in the buffer
+    std::vector<GLint> m_intersectionFirsts;      ///< per outline of length > 1, into the buffer
+    std::vector<GLsizei> m_intersectionCounts;
+    std::vector<glm::vec3> m_intersectionScratch;
 
     /* --- framebuffers / textures --- */
  
@@ -192,27 +813,296 @@ private:
     bool m_isInitialized = false;
 
     
-    std::unordered_map<QOpenGLWidget*, TargetFBOs> m_targets;
+    std::unordered_map<RenderTargetId, TargetFBOs> m_targets;
 
 
+    /// Static geometry, uploaded once. Buffers are shared by the context
+    /// group, so each context only keeps the VAOs that point at them.
+    struct SharedPrimitives
+    {
+        GLuint gridVBO = 0;
+        GLuint arrowVBO = 0, arrowEBO = 0;
+        size_t arrowIndexCount = 0;
+        GLuint triadVBO = 0, triadEBO = 0;
+        size_t triadIndexCount = 0;
+        GLint triadAxisVertices = 0;      ///< vertices per arrow of the triad
+        GLuint glyphAtlas = 0;            ///< GlyphAtlas texels, R8
+    };
+    SharedPrimitives m_sharedPrimitives;
+
+    /// Container objects (VAOs) can't be shared between contexts. The spline
+    /// style and indirect buffers stay here too: they are rewritten for every
+    /// view, and a per-context copy needs no cross-context synchronisation.
     struct ContextPrimitives
     {
-        GLuint gridVAO = 0, gridVBO = 0;
-        GLuint lineVAO = 0, lineVBO = 0;
-        GLuint capVAO = 0, capVBO = 0;
+        GLuint gridVAO = 0;
+        GLuint splineVAO = 0;             ///< sampled vertices + style records (CPU-evaluated glow and caps)
+        GLuint splinePatchVAO = 0;        ///< style records only (tessellated glow)
+        GLuint splineCapVAO = 0;          ///< control points + style records (tessellated caps)
+        std::uint32_t splineVertexGeneration = ~0u;
+        std::uint32_t splineCapGeneration = ~0u;
+        GLuint splineStyleBuffer = 0;     ///< SplineStyleGpu[], sourced as divisor-1 attributes
+        GLsizeiptr splineStyleCapacity = 0;
+        GLuint splineIndirectBuffer = 0;  ///< DrawArraysIndirectCommand[] for all four spline draws
+        GLsizeiptr splineIndirectCapacity = 0;
         GLuint compositeVAO = 0; // For the fullscreen composite pass
 
-        GLuint arrowVAO = 0, arrowVBO = 0, arrowEBO = 0, instanceVBO = 0;
-        size_t arrowIndexCount = 0;
+        GLuint arrowVAO = 0;
+        GLuint triadVAO = 0;
+        GLuint frameBuffer = 0;           ///< FrameTriadGpu[] of the snapshot below
+        GLsizeiptr frameCapacity = 0;
+        std::uint64_t frameSnapshot = ~0ull; ///< RenderSnapshot::frame uploaded to frameBuffer
+        GLuint intersectionVAO = 0;       ///< positions of m_intersectionVBO
+        GLuint labelVAO = 0;              ///< no attributes: the label pass reads its buffers
+        GLuint labelGlyphBuffer = 0;      ///< LabelGlyphGpu[] of every label, in snapshot order
+        GLsizeiptr labelGlyphCapacity = 0;
+        GLuint labelBuffer = 0;           ///< LabelGpu[] of the snapshot below
+        GLsizeiptr labelCapacity = 0;
+        std::uint64_t labelSnapshot = ~0ull;
+        GLsizei labelGlyphCount = 0;
+        struct LabelRange {
+            std::shared_ptr<const GlyphAtlas::Layout> layout;
+            std::uint32_t first = 0;      ///< into labelGlyphBuffer
+        };
+        std::vector<LabelRange> labelRanges;   ///< what labelGlyphBuffer holds, per label
+        GLuint particleVAO = 0;           ///< ParticleVertexGpu attributes of particleDrawBuffer
+        GLuint particleDrawBuffer = 0;    ///< culled particles of the visualizer being drawn, see kParticleDrawBinding
+        GLsizeiptr particleDrawCapacity = 0;
+        GLuint particleSortBuffer = 0;    ///< scratch half of the depth sort, particleDrawCapacity bytes
+        GLuint particleSortCounts = 0;    ///< per tile digit histograms, see kParticleSortCountsBinding
+        GLsizeiptr particleSortCountsCapacity = 0;
+        GLuint streamlineVAO = 0;         ///< position attribute re-pointed at each visualizer's lines
+        PointCloudRenderer::ContextState pointClouds;
+        ComputeDispatch::ContextQueries computeQueries;
     };
+    GLuint ensureArrowPrimitive(QOpenGLContext* ctx);   ///< this context's arrow VAO
+    GLuint ensureTriadPrimitive(QOpenGLContext* ctx);   ///< this context's triad VAO
 
-    GLuint m_effectorDataUBO = 0;
-    GLuint m_triangleDataSSBO = 0;
+    GLStateCache m_state;           ///< shadowed blend/depth/cull/program/VAO/FBO state, reset per view
+    GLuint m_frameUBO = 0;          ///< FrameUniformsGpu, rewritten at the start of every renderView
+    GLuint m_gridUBO = 0;           ///< GridUniformsGpu per visible grid, m_gridUniformStride apart
+    GLsizeiptr m_gridUniformStride = 0;
+    std::vector<GridUniformsGpu> m_gridUniforms;   ///< what each slot holds, to skip unchanged uploads
+    std::vector<bool> m_gridUniformsValid;
+    EffectorBuffers m_effectorBuffers; ///< point/directional/triangle SSBOs for the field compute passes
+    PointCloudRenderer m_pointClouds;  ///< node pool under a VRAM budget, shared by every viewport
+    SensorBuffers m_sensorBuffers;     ///< one GPU ring per live sensor stream
+    VoxelReconstruction m_reconstruction; ///< TSDF volume whose block meshes live in m_meshArena
+    VirtualSensors m_virtualSensors;   ///< depth cameras and LiDARs feeding m_sensorBuffers
     const GLsizei stride = 96;
-    GLuint m_debugBuffer = 0;
-    GLuint m_debugAtomicCounter = 0;
 
 
     QHash<QOpenGLContext*, ContextPrimitives> m_contextPrimitives;
+
+    /* --- mesh arena & batched mesh pass --- */
+    MeshArena m_meshArena; ///< one VBO/EBO pair in the share group, used by every viewport
+    SplineArena m_splineArena;       ///< spline control points for the tessellated spline pass
+    SplineArena m_splineVertexArena; ///< cached CPU samples for the CPU-evaluated spline pass
+    SplineRenderMode m_splineRenderMode = SplineRenderMode::GpuTessellated;
+    std::vector<SplineStyleGpu> m_splineStyleScratch;
+    std::vector<DrawArraysIndirectCommand> m_splineGlowCommands, m_splineCapCommands;
+    std::vector<DrawArraysIndirectCommand> m_splinePatchCommands, m_splinePatchCapCommands;
+    std::vector<DrawArraysIndirectCommand> m_splineCommandScratch;
+    void prepareSplineVAOs(ContextPrimitives& primitives);
+    struct MeshBatchBuffers
+    {
+        GLuint arenaVAO = 0;            ///< per-context: VAOs cannot be shared
+        std::uint32_t arenaGeneration = ~0u;
+        GLuint instanceBuffer = 0;      ///< InstanceData[], sourced as divisor-1 attributes
+        GLsizeiptr instanceCapacity = 0;
+        GLuint indirectBuffer = 0;      ///< DrawElementsIndirectCommand[], one per unique mesh
+        GLsizeiptr indirectCapacity = 0;
+        GLuint candidateBuffer = 0;     ///< OcclusionCandidateGpu[], only with occlusion culling
+        GLsizeiptr candidateCapacity = 0;
+        GLuint clusterJobBuffer = 0;    ///< ClusterInstanceGpu[], only with cluster culling
+        GLsizeiptr clusterJobCapacity = 0;
+        GLuint clusterDrawBuffer = 0;   ///< uvec4 count, then DrawElementsIndirectCommand[]
+        GLsizeiptr clusterDrawCapacity = 0;
+        GLuint shadowVAO = 0;           ///< the arena VAO again, over shadowInstanceBuffer
+        std::uint32_t shadowGeneration = ~0u;
+        GLuint shadowInstanceBuffer = 0;
+        GLsizeiptr shadowInstanceCapacity = 0;
+        GLuint shadowIndirectBuffer = 0;
+        GLsizeiptr shadowIndirectCapacity = 0;
+        GLuint ghostVAO = 0;            ///< and over ghostInstanceBuffer
+        std::uint32_t ghostGeneration = ~0u;
+        GLuint ghostInstanceBuffer = 0;
+        GLsizeiptr ghostInstanceCapacity = 0;
+        GLuint ghostIndirectBuffer = 0;
+        GLsizeiptr ghostIndirectCapacity = 0;
+        std::uint64_t fleetSnapshot = ~0ull;   ///< RenderSnapshot::frame of the fleet records below
+        GLuint fleetLinkBuffer = 0, fleetPartBuffer = 0, fleetInstanceBuffer = 0, fleetJointBuffer = 0;
+        GLsizeiptr fleetLinkCapacity = 0, fleetPartCapacity = 0, fleetInstanceCapacity = 0, fleetJointCapacity = 0;
+        GLuint fleetDrawnBuffer = 0, fleetPoseBuffer = 0;   ///< per view
+        GLsizeiptr fleetDrawnCapacity = 0, fleetPoseCapacity = 0;
+    };
+    struct MeshBounds
+    {
+        glm::vec3 min, max;
+        std::uint32_t slot;             ///< entity index
+        bool valid;
+    };
+    struct MeshBatch
+    {
+        const MeshArena::Range* range = nullptr;
+        std::vector<InstanceData> instances[MeshArena::kMaxLods];   ///< by selected level
+        std::vector<MeshBounds> bounds[MeshArena::kMaxLods];        ///< parallel to instances
+    };
+    MeshPassMode m_meshPassMode = MeshPassMode::Batched;
+    bool m_compactVertices = false;
+    QHash<QOpenGLContext*, MeshBatchBuffers> m_meshBatches;
+    std::unordered_map<std::size_t, MeshBatch> m_meshBatchScratch; ///< reused each frame to avoid reallocation
+    std::vector<InstanceData> m_instanceScratch;
+    std::vector<DrawElementsIndirectCommand> m_indirectScratch;
+    std::vector<OcclusionCandidateGpu> m_occlusionScratch;
+    std::vector<ClusterInstanceGpu> m_clusterJobScratch;
+    std::vector<InstanceData> m_clusterInstanceScratch;  ///< parallel to m_clusterJobScratch
+    std::unordered_map<std::size_t, MeshBatch> m_shadowBatchScratch;
+    std::vector<InstanceData> m_shadowInstanceScratch;
+    std::vector<DrawElementsIndirectCommand> m_shadowCommandScratch;
+    // Appends m_shadowBatchScratch's instances and commands to the shadow
+    // scratch and empties the buckets; returns the commands appended.
+    std::size_t flattenShadowBatches();
+    // The shadow scratch into the context's shadow instance and indirect
+    // buffers; binds the indirect buffer.
+    void uploadShadowDraws(MeshBatchBuffers& batch);
+    std::vector<InstanceData> m_ghostInstanceScratch;
+    std::vector<DrawElementsIndirectCommand> m_ghostCommandScratch;
+    std::vector<FrameTriadGpu> m_frameScratch;
+    std::vector<LabelGlyphGpu> m_labelGlyphScratch;
+    std::vector<LabelGpu> m_labelScratch;
+    std::vector<std::shared_ptr<const GlyphAtlas::Layout>> m_labelLayoutScratch;
+
+    const MeshArena::Range& acquireMeshRange(const RenderSnapshot::Mesh& mesh);
+    const MeshArena::Range& acquireMeshRange(std::size_t key, const MeshData& data);
+
+    /* --- render snapshots --- */
+    std::unordered_map<const entt::registry*, RenderSnapshotBuffer> m_snapshots; ///< registries extracted once per tick
+    RenderSnapshotBuffer m_paintSnapshot;                  ///< for views of any other registry
+    std::shared_ptr<const RenderSnapshot> m_viewSnapshot;  ///< held while one renderView runs
+    GLuint bindArenaVAO(QOpenGLContext* ctx);
+    GLuint bindShadowVAO(QOpenGLContext* ctx);
+    GLuint bindGhostVAO(QOpenGLContext* ctx);
+    void pointArenaVAO(GLuint instanceBuffer);   // the bound VAO: arena vertices, then InstanceData
     void initOrResizeFBOsForTarget(TargetFBOs& target, int width, int height);
+    void recycleTargetTextures(TargetFBOs& target);
+
+    /// Attachment textures of resized or released targets, reused by the next
+    /// target that needs the same format and size. Textures are shared by the
+    /// context group, unlike the FBOs that hold them.
+    struct PooledTexture { GLuint id; GLenum format; int w, h; };
+    static constexpr std::size_t kTexturePoolSize = 12;
+    std::vector<PooledTexture> m_texturePool;
+    /// GpuMemory evictors: the texture pool first, then the point cloud pool.
+    std::vector<int> m_gpuEvictors;
+    void registerGpuEvictors();
+    GLuint acquireTexture(GLenum format, int w, int h);
+    void recycleTexture(GLuint& texture, GLenum format, int w, int h);
+    void readBackArrowField(FieldVisGpuData& gpu);
+    bool ensureBakedField(FieldVisualizerComponent& vis, const glm::mat4& model);
+    GLuint createFieldTexture(const glm::ivec3& res);
+    void bakeFieldSlices(GLuint texture, const FieldVisualizerComponent& vis, const glm::mat4& model,
+        const glm::ivec3& res, int firstSlice, int sliceEnd);
+    // Temporal mode: starts, continues or finishes a keyframe within the
+    // tick's slice budget, then re-blends the baked field if the shown
+    // time moved. False until the first keyframe exists.
+    bool ensureTemporalField(FieldVisualizerComponent& vis, const glm::mat4& model);
+    void releaseTemporalField(FieldVisGpuData& gpu);
+    void bindFieldSource(const Shader& shader, const FieldVisualizerComponent& vis,
+        const glm::mat4& model, bool baked);
+    // Streamlines mode: re-traces the lines when the bake or settings changed.
+    void traceStreamlines(FieldVisualizerComponent& vis, const glm::mat4& model);
+    void releaseStreamlines(FieldVisGpuData& gpu);
+    // Volume mode: uploads the settings' ScalarVolume when it is a new one;
+    // without one the mode draws the baked field.
+    void ensureScalarVolume(FieldVisualizerComponent& vis);
+    // Adaptive arrows: buffers for 'levels' refinements of the coarse grid,
+    // and the refinement itself, re-run when the field is re-baked.
+    void createAdaptiveArrows(FieldVisualizerComponent& vis, int coarseCount, int levels);
+    void refineArrowSamples(FieldVisualizerComponent& vis);
+    void releaseAdaptiveArrows(FieldVisGpuData& gpu);
+    // Uniform arrow grids on the effector field, computed in one dispatch into
+    // one instance buffer and drawn with one multi-draw, a command per grid.
+    struct ArrowBatch {
+        GLuint entryBuffer = 0, commandBuffer = 0, instanceBuffer = 0;
+        std::size_t entryCapacity = 0, commandCapacity = 0, instanceCapacity = 0;   ///< in elements
+        std::vector<ArrowBatchEntryGpu> entries;               ///< this tick's, by firstSample
+        std::vector<DrawElementsIndirectCommand> commands;
+        GLuint sampleCount = 0;
+        GLsizei drawCount = 0;                                 ///< commands of the last dispatch
+    };
+    ArrowBatch m_arrowBatch;
+    // Colour gradients baked to GradientLut rows of one RGBA16F texture.
+    // Rows are handed out afresh each simulation tick, in visualizer order,
+    // and a row is re-baked and uploaded only when its gradient differs from
+    // the one it holds, i.e. when a table in the menu changed.
+    struct GradientAtlas {
+        GLuint texture = 0;
+        int capacity = 0;                              ///< rows allocated
+        int used = 0;                                  ///< rows handed out this tick
+        std::vector<std::vector<ColorStop>> rowStops;  ///< baked into each row
+        std::vector<bool> rowValid;
+    };
+    GradientAtlas m_gradientAtlas;
+    GLuint gradientRow(const std::vector<ColorStop>& stops);
+    void bindGradientAtlas(const Shader& shader);
+    void releaseGradientAtlas();
+    // Per-visualizer instance and command buffers of an unbatched arrow grid.
+    void ensureArrowBuffers(FieldVisGpuData& gpu);
+    void dispatchArrowBatch(ComputeDispatch::ContextQueries& queries);
+    void releaseArrowBatch();
+    // Solid particles: orders the draw buffer the cull just filled back to
+    // front for this view, in place (two radix digits via the scratch buffer).
+    void sortParticlesByDepth(ContextPrimitives& primitives, GLuint capacity);
+    bool m_fieldReadbackDebug = false;
+    bool m_profiling = false;
+    bool m_profileCapture = false;
+
+    /* --- diagnostic GL capture --- */
+    struct GlMessage {
+        RenderTargetId target = nullptr;
+        double us = 0.0;                  ///< on GpuProfiler::nowUs(), when it arrived
+        QString text;
+        int severity = 0, type = 0, source = 0;
+        unsigned id = 0;
+    };
+    void updateGlCapture(TargetFBOs& target, RenderTargetId targetId);   ///< context current
+    void recordGlMessage(RenderTargetId targetId, const QOpenGLDebugMessage& message);
+    void finishGlCapture();
+    int m_glCaptureFrames = 0;            ///< ticks left
+    QString m_glCapturePath;
+    bool m_profilingBeforeGlCapture = false;
+    mutable std::mutex m_glMessageMutex;  ///< async messages may arrive on a driver thread
+    std::vector<GlMessage> m_glMessages;
+    std::size_t m_glMessagesDropped = 0;
+    bool m_glRecording = false;           ///< under m_glMessageMutex
+    bool m_idBufferPicking = false;
+    bool m_dynamicResolution = true;
+    glm::ivec2 m_windowFull{ 0 };
+    glm::ivec4 m_window{ 0 };          ///< see setProjectionWindow(); w = 0 when off
+    glm::vec2 m_windowJitter{ 0.0f };
+    float m_gpuFrameBudgetMs = 12.0f;   ///< leaves headroom under a 60 Hz frame
+    float m_minRenderScale = 0.5f;
+    bool m_layoutInteraction = false;
+    PointCloudMode m_pointCloudMode = PointCloudMode::Splat;
+    float m_edlStrength = 1.0f;
+    float m_edlRadius = 1.4f;
+    void updateRenderScale(TargetFBOs& target);
+    void issuePickRead(TargetFBOs& target);
+    void destroyTarget(TargetFBOs& target);
+    // renderView's body. With 'stereo', renderStereo draws the frame and
+    // 'rightOutputFBO' receives the right eye.
+    void drawView(RenderTargetId targetId, GLuint outputFBO, GLuint rightOutputFBO, bool stereo,
+        entt::registry& registry, entt::entity cameraEntity, int outputWidth, int outputHeight);
+    // The passes and composites of a stereo frame, into a target drawView has sized.
+    void renderStereo(TargetFBOs& target, GLuint leftFBO, GLuint rightFBO, entt::registry& registry,
+        const Camera& camera, int outputWidth, int outputHeight, float deltaTime, GpuProfiler* prof);
+    void ensureStereoTarget(TargetFBOs& target);
+    void destroyStereo(TargetFBOs& target);
+    bool m_stereo = true;
+    float m_eyeSeparation = 0.065f;
+    float m_stereoConvergence = 2.0f;
+    glm::mat4 m_stereoEyeViewProjection[2]{ glm::mat4(1.0f), glm::mat4(1.0f) };   ///< into FrameUniforms
+    void uploadFrameUniforms(const glm::mat4& view, const glm::mat4& eyeView, const glm::mat4& projection,
+        const glm::vec3& camPos, int viewportWidth, int viewportHeight, float deltaTime);
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "KinematicModel.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include <entt/fwd.hpp>
+
+/**
+ * @class RigidBodyDynamics
+ * @brief O(n) rigid-body dynamics of one robot over its KinematicModel.
+ *
+ * Featherstone's algorithms in link coordinates: inverseDynamics() is the
+ * recursive Newton-Euler pass (torques for a given motion), forwardDynamics()
+ * the articulated-body algorithm (accelerations for given torques). Both are
+ * two or three linear passes over the model's parent-first link order, so
+ * the cost grows with the link count, not its cube.
+ *
+ * Spatial quantities are kept as pairs of 3-vectors (angular first) and
+ * articulated inertias as their three distinct 3x3 blocks, so transforming
+ * between link frames is a handful of 3x3 products instead of 6x6 ones.
+ * Everything runs in double precision on per-link workspaces sized once in
+ * the constructor; no call allocates.
+ *
+ * Link inertia comes from LinkDescription (mass, inertia about the centre
+ * of mass, centre_of_mass_offset in the link frame); friction, effort and
+ * velocity limits from JointDescription. Fixed-base: link 0 is welded to
+ * the robot's placement, and gravity is given in that frame.
+ */
+class RigidBodyDynamics
+{
+public:
+    struct LinkInertia {
+        double mass = 0.0;
+        glm::dvec3 centerOfMass{ 0.0 };          ///< link frame
+        glm::dmat3 inertia{ 0.0 };               ///< about the centre of mass, link frame axes
+    };
+    struct JointParameters {
+        double staticFriction = 0.0;             ///< breakaway torque (force) at rest
+        double dynamicFriction = 0.0;            ///< Coulomb torque (force) while moving
+        double effortLimit = 0.0;                ///< |tau| cap in step(); 0 for none
+        double velocityLimit = 0.0;              ///< |qd| cap in step(); 0 for none
+        double armature = 1e-4;                  ///< reflected rotor inertia; keeps massless chains solvable
+    };
+
+    // 'links' is parallel to the model's links, 'joints' to its DOFs.
+    RigidBodyDynamics(std::shared_ptr<const KinematicModel> model, std::vector<LinkInertia> links,
+        std::vector<JointParameters> joints);
+
+    // From a spawned robot: its KinematicModelComponent, LinkComponents and
+    // JointComponents, with gravity (world -Y) turned into the root's frame.
+    // Null if 'root' is not a robot root with a model.
+    static std::unique_ptr<RigidBodyDynamics> fromRobot(const entt::registry& registry, entt::entity root);
+
+    const KinematicModel& model() const { return *m_model; }
+    std::size_t dofCount() const { return m_joints.size(); }
+    const JointParameters& joint(std::size_t dof) const { return m_joints[dof]; }
+
+    /// Gravitational acceleration in the frame of the robot's placement.
+    void setGravity(const glm::dvec3& gravity) { m_gravity = gravity; }
+    const glm::dvec3& gravity() const { return m_gravity; }
+
+    /// RNEA: the joint torques (forces) that produce accelerations 'qdd' at
+    /// (q, qd), gravity included. qdd = 0 gives the gravity and Coriolis
+    /// compensation torques.
+    void inverseDynamics(const double* q, const double* qd, const double* qdd, double* tau);
+
+    /// ABA: joint accelerations for torques 'tau' at (q, qd), gravity included.
+    void forwardDynamics(const double* q, const double* qd, const double* tau, double* qdd);
+
+    /// One semi-implicit Euler step of 'dt' seconds. 'tau' is clamped to the
+    /// effort limits and reduced by joint friction before forwardDynamics();
+    /// the new velocities are clamped to the velocity limits and positions
+    /// stop at the joint limits. 'applied' (optional) receives the torques
+    /// after clamping and friction.
+    void step(double* q, double* qd, const double* tau, double dt, double* applied = nullptr);
+
+private:
+    struct Motion { glm::dvec3 angular{ 0.0 }, linear{ 0.0 }; };   ///< velocity, acceleration
+    struct Force { glm::dvec3 angular{ 0.0 }, linear{ 0.0 }; };    ///< moment, force
+    /// Symmetric 6x6 inertia as [A B; B^T D].
+    struct Inertia { glm::dmat3 A{ 0.0 }, B{ 0.0 }, D{ 0.0 }; };
+
+    // Parent-to-link transform for the current q: rotation E (parent to
+    // link coordinates) and the link origin r in parent coordinates.
+    void updateTransforms(const double* q);
+
+    std::shared_ptr<const KinematicModel> m_model;
+    std::vector<JointParameters> m_joints;
+    glm::dvec3 m_gravity{ 0.0, -9.81, 0.0 };
+
+    // Per link, constant.
+    std::vector<int> m_parent, m_dof;
+    std::vector<Motion> m_axis;                  ///< motion subspace S, zero for fixed joints
+    std::vector<glm::dmat3> m_originRotation;
+    std::vector<glm::dvec3> m_originTranslation;
+    std::vector<Inertia> m_inertia;
+
+    // Per link, workspace.
+    std::vector<glm::dmat3> m_E;
+    std::vector<glm::dvec3> m_r;
+    std::vector<Motion> m_v, m_a, m_c;
+    std::vector<Force> m_f, m_U;                 ///< m_f: RNEA forces, ABA bias forces
+    std::vector<Inertia> m_IA;
+    std::vector<double> m_Dinv, m_u;
+    std::vector<double> m_tau, m_qdd;            ///< step() scratch, by DOF
+};
@@ -1,43 +1,48 @@
 #pragma once
 
-#include <string>
-#include <vector>
-#include <map>
 #include <memory>
-#include <glm/glm.hpp>
+#include <string>
+#include <entt/fwd.hpp>
 
-class Shader;
-class Mesh;
+class KinematicModel;
+class JointStateBuffer;
 
+/**
+ * @class Robot
+ * @brief Lightweight handle to a robot spawned into the registry.
+ *
+ * Holds no kinematic tree of its own: links and joints are the entities
+ * SceneBuilder::spawnRobot() created, and the tree is the KinematicModel on
+ * the root link. Joint names are resolved to DOF indices once, through
+ * jointIndex(); everything per frame indexes the robot's JointStateBuffer.
+ */
 class Robot {
 public:
-    Robot(const std::string& urdf_path);
+    // 'root' is the root link entity carrying KinematicModelComponent.
+    Robot(entt::registry& registry, entt::entity root);
+
+    bool isValid() const;
+    entt::entity root() const { return m_root; }
+    const KinematicModel* model() const { return m_model.get(); }
+
+    int jointCount() const;                                      ///< moving joints, by DOF
+    int jointIndex(const std::string& name) const;               ///< -1 if unknown; resolve once, not per frame
+    const std::string& jointName(int joint) const;
+    bool isPrismatic(int joint) const;
+
+    double jointPosition(int joint) const;
+    void setJointPosition(int joint, double value);
+
+    // Demo motion: sweeps joint_1 and joint_2 (if present) on sine/cosine curves.
     void update(double deltaTime);
-    void draw(Shader& shader, Mesh& link_mesh) const;
-    std::map<std::string, double> getJointStates() const;
+
 private:
-    struct Joint;
-    struct Link {
-        std::string name;
-        std::vector<std::shared_ptr<Link>> child_links;
-        std::vector<std::shared_ptr<Joint>> child_joints;
-    };
-
-    struct Joint {
-        std::string name;
-        glm::vec3 origin_xyz;
-        glm::vec3 axis;
-        double current_angle_rad = 0.0;
-    };
-
-    void loadModel(const std::string& urdf_path);
-    void drawRecursive(const std::shared_ptr<Link>& link, Shader& shader, Mesh& mesh, const glm::mat4& parentTransform) const;
-
-    std::shared_ptr<Link> rootLink;
-    std::map<std::string, std::shared_ptr<Link>> linkMap;
-    std::map<std::string, std::shared_ptr<Joint>> jointMap;
-    std::string modelName;
-
-    // Add this member to track time for animation
+    entt::registry* m_registry;
+    entt::entity m_root;
+    std::shared_ptr<const KinematicModel> m_model;
+    std::shared_ptr<JointStateBuffer> m_state;
+
+    int m_sweepA = -1;
+    int m_sweepB = -1;
     double m_totalTime = 0.0;
-};
\ No newline at end of file
+};
@@ -44,7 +44,7 @@ struct NamedTransform {
 struct LinkDescription {
     // --- Core Identification ---
     std::string name; // The human-readable name of the link.
-    uint64_t persistent_id; // A unique, permanent ID for this link.
+    uint64_t persistent_id = 0; // A unique, permanent ID for this link; 0 until SceneBuilder assigns one.
 
     // --- Visual Properties ---
     glm::vec3 visual_origin_xyz; // The offset of the visual mesh from the link's origin.
@@ -113,7 +113,7 @@ enum class CommutationType {
 
 enum class CommunicationProtocol {
     NONE,
-    SERIAL_CUSTOM, // A custom text- or binary-based protocol over UART.
+    SERIAL_CUSTOM, // COBS-framed binary joint feedback over UART (see SerialTelemetry).
     CANOPEN,       // A standard industrial protocol over CAN bus.
     ETHERCAT       // A high-speed industrial protocol over Ethernet.
 };
@@ -208,7 +208,7 @@ struct HardwareInterface {
 struct JointDescription {
     // --- Core Kinematic Properties ---
     std::string name;                                     // The human-readable name of the joint, e.g., "elbow_joint".
-    uint64_t persistent_id;                               // A unique, permanent ID for this joint.
+    uint64_t persistent_id = 0;                           // A unique, permanent ID for this joint; 0 until SceneBuilder assigns one.
     JointType type = JointType::REVOLUTE;                 // The type of motion this joint allows.
     std::string parent_link_name;                         // The name of the parent link this joint connects to.
     std::string child_link_name;                          // The name of the child link this joint moves.
@@ -245,6 +245,10 @@ struct RobotDescription {
     std::vector<LinkDescription> links;
     std::vector<JointDescription> joints;
 
+    // Where the root link is placed in the scene, e.g. a model's pose in an SDF world.
+    glm::vec3 base_origin_xyz = glm::vec3(0.0f);
+    glm::vec3 base_origin_rpy = glm::vec3(0.0f);
+
     bool needsEnrichment = false;
 };
 
@@ -11,6 +11,7 @@ class QTreeWidgetItem;
 class QStackedWidget;
 class LinkPropertiesWidget;
 class JointPropertiesWidget;
+class LinkThumbnails;
 
 class RobotEnrichmentDialog : public QDialog
 {
@@ -36,6 +37,7 @@ private slots:
 private:
     void populateTree();
     void createPropertyEditors();
+    void requestThumbnail(const LinkDescription& link);
 
     // The dialog now owns a modifiable copy of the robot description via a smart pointer.
     std::unique_ptr<RobotDescription> m_robotDescription;
@@ -44,6 +46,7 @@ private:
     PreviewViewport* m_previewViewport;
     QTreeWidget* m_robotTreeWidget;
     QStackedWidget* m_propertyEditorStack;
+    LinkThumbnails* m_thumbnails;            ///< link icons in the tree, drawn on the pool
 
     // Property Editor Widgets
     LinkPropertiesWidget* m_linkEditor;
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "SceneBuilder.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class RobotImportJob
+ * @brief Parses a robot file and prepares its scene delta off the GUI thread.
+ *
+ * start() launches one worker thread that runs the URDF/SDF/KRobot parser
+ * for the file and then SceneBuilder::prepareRobot(), which loads the link
+ * meshes in parallel on ThreadPool::shared(). The GUI thread polls
+ * progress() each tick to drive the status bar, and once finished() is true,
+ * take() joins the worker and hands over the delta for
+ * SceneBuilder::commitRobot(), so the registry changes in one batch on the
+ * GUI thread.
+ *
+ * Descriptions that need enrichment stop after parsing: the caller shows
+ * its dialog and starts the job again from the final description.
+ *
+ * SDF worlds hold many models. Each is prepared as soon as SDFParser yields
+ * it and queued for takeModels(), so the GUI commits the first models while
+ * later ones are still loading; take() then only reports how it ended.
+ */
+class RobotImportJob
+{
+public:
+    enum class Stage { Idle, Parsing, Decoding, Ready, NeedsEnrichment, Failed, Cancelled };
+
+    struct Progress {
+        Stage stage = Stage::Idle;
+        std::size_t done = 0;    ///< mesh files loaded
+        std::size_t total = 0;   ///< 0 until the first file is done (no known total yet)
+        std::size_t models = 0;  ///< world files: models prepared so far
+    };
+
+    struct Result {
+        Stage stage = Stage::Idle;
+        RobotSceneDelta delta;   ///< prepared (Ready) or just parsed (NeedsEnrichment)
+        std::string error;       ///< Failed only
+    };
+
+    RobotImportJob() = default;
+    ~RobotImportJob();  // cancels and joins
+
+    RobotImportJob(const RobotImportJob&) = delete;
+    RobotImportJob& operator=(const RobotImportJob&) = delete;
+
+    // Parse 'path' (by extension) and prepare it. False if a job is still running.
+    bool start(const std::string& path);
+    // Prepare an already parsed description, e.g. after enrichment.
+    bool start(RobotDescription description);
+
+    // Any thread. The worker stops at the next mesh file and take() reports Cancelled.
+    void cancel() { m_cancel.store(true, std::memory_order_relaxed); }
+
+    bool busy() const { return m_thread.joinable(); }
+    bool finished() const { return m_finished.load(std::memory_order_acquire); }
+    Progress progress() const;
+
+    // GUI thread, once finished(): joins the worker and returns its result.
+    Result take();
+
+    // GUI thread, any time: the world models prepared since the last call,
+    // in file order. Drain it before take() so no model is lost.
+    std::vector<RobotSceneDelta> takeModels();
+
+private:
+    void launch(std::string path, RobotDescription description);
+    void run(const std::string& path, RobotDescription description);
+    void runWorld(const std::string& path);
+    bool prepare(RobotDescription description, RobotSceneDelta& out);
+
+    std::thread m_thread;
+    Result m_result;                           ///< written by the worker, read after join
+
+    std::mutex m_modelsMutex;
+    std::vector<RobotSceneDelta> m_models;     ///< prepared world models not taken yet
+
+    std::atomic<Stage> m_stage{ Stage::Idle };
+    std::atomic<std::size_t> m_done{ 0 };
+    std::atomic<std::size_t> m_total{ 0 };
+    std::atomic<std::size_t> m_modelCount{ 0 };
+    std::atomic<bool> m_cancel{ false };
+    std::atomic<bool> m_finished{ false };
+};
@@ -1,14 +1,26 @@
 #pragma once
 
 #include "RobotDescription.hpp"
+#include <cstddef>
+#include <functional>
 #include <string>
 
 // A static utility class for parsing SDF files.
 class SDFParser
 {
 public:
-    // Parses the SDF file at the given path.
-    // SDF is more complex than URDF, but will still result in one RobotDescription.
-    // Throws a std::runtime_error if parsing fails.
+    // Receives each model as soon as it is converted. Returning false stops
+    // the parse after this model.
+    using ModelSink = std::function<bool(RobotDescription&& model)>;
+
+    // Parses the first model in the SDF file at the given path.
+    // Throws a std::runtime_error if parsing fails or the file has no model.
     static RobotDescription parse(const std::string& filepath);
+
+    // Walks every <model> and <include> of an SDF world (or a plain model
+    // file) in document order and hands each one to 'sink' with its world
+    // pose in base_origin_xyz/rpy. Included model files are read once, however
+    // often they are placed. Returns the number of models delivered.
+    // Throws a std::runtime_error if the file cannot be read or parsed.
+    static std::size_t parseWorld(const std::string& filepath, const ModelSink& sink);
 };
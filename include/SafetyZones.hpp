@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ConvexCollision.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+class CollisionWorld;
+
+/**
+ * @class SafetyZoneMonitor
+ * @brief Tests every armed SafetyZoneComponent against the robots' link
+ *        colliders each tick.
+ *
+ * Link shapes come from CollisionWorld, which must have been updated this
+ * tick (with or without its narrowphase). Per zone the links are found
+ * through the collision broadphase tree, then rejected four zone planes at a
+ * time against their boxes (SSE2 where available), then against their
+ * support points; only links that survive both reach GJK against the zone
+ * box. A half-space needs no GJK: the support test is exact for it.
+ *
+ * Changes are edge-triggered: the handler is called synchronously from
+ * update(), once per link entering or leaving a zone, before the tick's
+ * rendering and before any queued Qt event, and SafetyZoneViolationComponent
+ * on the zone lists the links currently inside.
+ */
+class SafetyZoneMonitor
+{
+public:
+    struct Event {
+        entt::entity zone;
+        entt::entity link;
+        entt::entity robot;
+        bool entered;                        ///< false when the link left
+    };
+    using Handler = std::function<void(const Event&)>;
+
+    struct Stats {
+        std::size_t zones = 0;
+        std::size_t candidates = 0;          ///< links past the broadphase, all zones
+        std::size_t narrowphaseTests = 0;    ///< of those, links that reached GJK
+        std::size_t violations = 0;          ///< links inside a zone, all zones
+        double microseconds = 0.0;           ///< duration of the last update()
+    };
+
+    explicit SafetyZoneMonitor(const CollisionWorld& world) : m_world(world) {}
+
+    void setHandler(Handler handler) { m_handler = std::move(handler); }
+
+    // Returns true if any zone's set of violating links changed.
+    bool update(entt::registry& registry);
+
+    const Stats& stats() const { return m_stats; }
+
+private:
+    // Zone planes n.x <= d as structure of arrays, padded to a multiple of 4
+    // with planes that never separate.
+    struct Zone {
+        static constexpr int kMaxPlanes = 8;
+        alignas(16) float nx[kMaxPlanes];
+        alignas(16) float ny[kMaxPlanes];
+        alignas(16) float nz[kMaxPlanes];
+        alignas(16) float d[kMaxPlanes];
+        int planes = 0;                      ///< real planes, the rest is padding
+        bool halfSpace = false;
+        glm::vec3 min{ 0.0f }, max{ 0.0f };  ///< world bounds, for the broadphase
+        ConvexCollision::Shape shape;        ///< the box, for GJK
+    };
+
+    static bool buildZone(const glm::mat4& world, bool halfSpace, Zone& zone);
+    static bool boxOutside(const Zone& zone, const glm::vec3& center, const glm::vec3& extent);
+    static bool shapeOutside(const Zone& zone, const ConvexCollision::Shape& shape);
+
+    const CollisionWorld& m_world;
+    Handler m_handler;
+    Stats m_stats;
+    std::vector<entt::entity> m_inside;      ///< update() scratch
+};
@@ -4,6 +4,9 @@
 #include <entt/entt.hpp>
 #include <glm/glm.hpp>
 
+#include "SceneIndex.hpp"
+#include "UndoStack.hpp"
+
 class Scene
 {
 public:
@@ -13,9 +16,19 @@ public:
     entt::registry& getRegistry() { return m_registry; }
     const entt::registry& getRegistry() const { return m_registry; }
 
+    // History of the edits made through the UI; see UndoStack.
+    UndoStack& undo() { return m_undo; }
+
+    // Spatial index over the meshes' world bounds, refreshed once per tick;
+    // see SceneIndex. Shared by picking, sections and whoever else queries.
+    SceneIndex& index() { return m_index; }
+    const SceneIndex& index() const { return m_index; }
+
     // REFACTOR: Removed the concept of a single "main camera" from the scene
     // to support multiple independent viewports and cameras.
 
 private:
     entt::registry m_registry;
+    UndoStack m_undo;
+    SceneIndex m_index;
 };
\ No newline at end of file
@@ -1,11 +1,26 @@
 // In SceneBuilder.hpp
 #include "RobotDescription.hpp"
 #include "Scene.hpp" // Needs to know about the scene
+#include "components.hpp"
+#include <cstddef>
+#include <memory>
 #include <vector>          
 #include <functional>
 
 struct RobotDescription;
 class Scene;
+class KinematicModel;
+
+// Everything spawnRobot() adds to the registry, built without touching it so
+// the expensive part can run on a worker thread and the registry is changed
+// in one step on the GUI thread.
+struct RobotSceneDelta
+{
+    RobotDescription description;
+    std::shared_ptr<const KinematicModel> model;
+    std::vector<RenderableMeshComponent> meshes;         ///< by description link; null mesh = none
+    std::vector<CollisionMeshComponent> collisionMeshes; ///< by description link; null mesh and hulls = none
+};
 
 // A static utility class for populating a Scene from a RobotDescription.
 // This decouples the scene creation logic from the UI and parsers.
@@ -16,10 +31,48 @@ public:
     // entities and components in the scene's registry.
     static void spawnRobot(Scene& scene, const RobotDescription& description);
 
+    // Called with (done, total) mesh files as they load, possibly from
+    // several threads at once. Returning false abandons the preparation.
+    using ImportProgress = std::function<bool(std::size_t done, std::size_t total)>;
+
+    // The registry-free half of spawnRobot(): compiles the kinematic model
+    // and loads every link's visual and collision mesh file in parallel on
+    // ThreadPool::shared(). Visual meshes that fail to load become the
+    // placeholder cube. Each distinct mesh a link collides with (its
+    // collision mesh, else its visual mesh) is then cut into convex hulls,
+    // also on the pool (MeshCache::decomposition, cached on disk), unless
+    // KR_CONVEX_DECOMPOSITION=0. Links and joints without a persistent_id get one
+    // derived from the robot and their names. Safe to call from any thread other than a pool worker. Returns false if cancelled through
+    // 'progress' or the description has no links.
+    static bool prepareRobot(RobotDescription description, RobotSceneDelta& out,
+        const ImportProgress& progress = {});
+
+    // Adds a prepared robot at its base origin. With 'replaceExisting' it
+    // takes the place of the current robots instead: links whose
+    // persistent_id is already in the scene are patched in place (entity,
+    // GPU range, collision shape, joint positions and root placement kept),
+    // the rest is created or destroyed. False for further models of a world.
+    // GUI thread only.
+    static void commitRobot(Scene& scene, RobotSceneDelta&& delta, bool replaceExisting = true);
+
+    // One VirtualSensorComponent entity per sensor mount of the robot at
+    // 'root', a child of its link placed at the mount, with a GPU-fed
+    // stream holding about two frames or turns. Mounts named like a camera
+    // ("camera", "depth", "rgbd") get a depth camera, the rest a LiDAR.
+    // Returns how many were added.
+    static std::size_t addVirtualSensors(entt::registry& registry, entt::entity root);
+
+    // The camera gizmo's mesh loads in the background: the gizmo holds a
+    // PendingMeshComponent until resolvePendingMeshes() sees it finished.
     static entt::entity createCamera(entt::registry&,
         const glm::vec3& position,
         const glm::vec3& colour = { 1,1,0 });
 
+    // Turns every finished PendingMeshComponent into a
+    // RenderableMeshComponent (dropping it if the load failed). Returns
+    // true if any did. GUI thread, once per tick.
+    static bool resolvePendingMeshes(entt::registry& registry);
+
     static entt::entity makeCR(entt::registry& r,
         const std::vector<glm::vec3>& cps,
         const glm::vec4& coreColour,      // Changed parameter name
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <entt/fwd.hpp>
+
+/**
+ * @brief Saving and loading whole scenes as .krscene (see SceneFileFormat).
+ *
+ * Loading is split like a robot import: read() maps the file and decodes
+ * its meshes, then its component chunks, in parallel on ThreadPool::shared()
+ * without touching the registry, so it can run on any thread other than a
+ * pool worker; commit() then creates every entity and inserts each
+ * component type in one batch on the GUI thread.
+ *
+ * Saved: every entity with a TransformComponent, except robot links and
+ * joints, cameras, point clouds, sensor streams and the reconstruction,
+ * which come from their own files or devices, WorldPartition proxies and
+ * prefab instances (their Prefab has no file form yet). Meshes are stored
+ * once per distinct MeshData; on load a mesh still alive in MeshCache with
+ * the saved content hash is shared instead of decoded again.
+ */
+namespace SceneFile
+{
+    // A read scene, ready for commit(). Opaque: one staged column per chunk.
+    struct Loaded
+    {
+        struct Column;
+        std::uint32_t entityCount = 0;
+        std::vector<std::unique_ptr<Column>> columns;
+
+        Loaded();
+        ~Loaded();
+        Loaded(Loaded&&) noexcept;
+        Loaded& operator=(Loaded&&) noexcept;
+    };
+
+    // The entities save() writes, in registry order.
+    std::vector<entt::entity> savedEntities(const entt::registry& registry);
+
+    // Writes the registry's scene to 'path'. False with 'error' set if it
+    // cannot be written.
+    bool save(const entt::registry& registry, const std::string& path, std::string* error = nullptr);
+
+    // Writes only 'entities' (each with a TransformComponent), e.g. one
+    // WorldPartition cell. Parents outside the set are dropped. Reads the
+    // registry only, so several subsets may be saved concurrently.
+    bool save(const entt::registry& registry, const std::vector<entt::entity>& entities, const std::string& path,
+        std::string* error = nullptr);
+
+    // Maps and decodes 'path'. False with 'error' set if it is not a
+    // readable .krscene of a supported version.
+    bool read(const std::string& path, Loaded& out, std::string* error = nullptr);
+
+    // Adds the read scene's entities to the registry and returns them, in
+    // file order. GUI thread only.
+    std::vector<entt::entity> commit(entt::registry& registry, Loaded&& loaded);
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Binary scene ("*.krscene"), little-endian, laid out like a .krobot:
+ *
+ *   FileHeader        magic, version, entity count, where the chunk table is
+ *   Chunk[]           type, byte range and row count of each chunk
+ *   Strings           UTF-8 bytes; every text field is a StringRef into it
+ *   Meshes            MeshRecord[], then the .kmesh blobs they point at
+ *                     (see MeshBinaryFormat), one per distinct mesh
+ *   component chunks  one per component type, see ChunkType
+ *
+ * Entities are numbered 0..entityCount-1 in the file and get new ids when
+ * loaded. A component chunk holds 'count' rows and is columnar: first the
+ * uint32 entity number of every row, then each of its columns in the order
+ * listed below, every column an array of 'count' values starting 8-byte
+ * aligned. Chunks and blobs start 8-byte aligned; unknown chunk types are
+ * skipped, so later versions can add component types without breaking
+ * readers.
+ */
+namespace SceneFileFormat
+{
+    constexpr std::uint32_t kMagic = 0x4E43534Bu;   // "KSCN"
+    constexpr std::uint32_t kVersion = 1;
+    constexpr std::uint32_t kNoEntity = 0xFFFFFFFFu;
+
+    enum ChunkType : std::uint32_t {
+        Strings = 1,
+        Meshes = 2,
+        // Component chunks and their columns after the entity column:
+        Tags = 16,                 ///< StringRef
+        Transforms = 17,           ///< float[3] translation, float[4] rotation (x, y, z, w), float[3] scale
+        Parents = 18,              ///< uint32 parent entity (kNoEntity if it was not saved)
+        RenderableMeshes = 19,     ///< uint32 index into Meshes
+        Materials = 20,            ///< MaterialRecord
+        PointLights = 21,          ///< float[3] colour, float intensity, float range
+        PulsingLights = 22,        ///< float[3] on colour, float[3] off colour, float speed
+        BoundingBoxes = 23,        ///< float[3] min, float[3] max
+        Splines = 24,              ///< SplineRecord; then float[3] points, SplineRecord::firstPoint into them
+        PointEffectors = 25,       ///< float strength, float radius, uint32 falloff
+        SplineEffectors = 26,      ///< float strength, float radius, uint32 direction
+        MeshEffectors = 27,        ///< float strength, float distance
+        DirectionalEffectors = 28, ///< float[3] direction, float strength
+        SafetyZones = 29,          ///< uint32 kind, uint32 armed
+        Grids = 30,                ///< GridRecord; then GridLevelRecord levels
+        FieldVisualizers = 31,     ///< VisualizerRecord; then ColorStopRecord gradients
+        FieldTemporal = 32,        ///< TemporalRecord, for rows that are in FieldVisualizers too
+        FieldSources = 48,         ///< tags: the entity column only
+        EnvironmentColliders = 49,
+        PulsingSplines = 50,
+    };
+
+    struct StringRef {
+        std::uint32_t offset = 0;     ///< into the Strings chunk
+        std::uint32_t length = 0;
+    };
+
+    struct FileHeader {
+        std::uint32_t magic = kMagic;
+        std::uint32_t version = kVersion;
+        std::uint32_t entityCount = 0;
+        std::uint32_t chunkCount = 0;
+        std::uint64_t chunkTableOffset = 0;
+    };
+
+    struct Chunk {
+        std::uint32_t type = 0;
+        std::uint32_t count = 0;      ///< rows (bytes for Strings)
+        std::uint64_t offset = 0;
+        std::uint64_t size = 0;       ///< bytes
+    };
+
+    struct MeshRecord {
+        std::uint64_t contentHash = 0;   ///< MeshData::contentHash when saved: a live mesh with it is reused
+        std::uint32_t vertexCount = 0;
+        std::uint32_t indexCount = 0;
+        std::uint64_t offset = 0;        ///< absolute, of the .kmesh blob
+        std::uint64_t size = 0;
+    };
+
+    struct MaterialRecord {
+        float albedo[3] = {};
+        float emissive[3] = {};
+        float metallic = 0.0f;
+        float roughness = 0.0f;
+        StringRef albedoMap;
+        StringRef metalRoughnessMap;
+    };
+
+    struct SplineRecord {
+        std::uint32_t type = 0;       ///< SplineType; parametric splines are saved as their sampled points, Linear
+        std::uint32_t firstPoint = 0;
+        std::uint32_t pointCount = 0;
+        float thickness = 0.0f;
+        float glowColour[4] = {};
+        float coreColour[4] = {};
+    };
+
+    enum GridFlags : std::uint32_t {
+        MasterVisible = 1u << 0,
+        ShowAxes = 1u << 1,
+        Metric = 1u << 2,
+        ShowIntersections = 1u << 3,
+        Dotted = 1u << 4,
+        Snapping = 1u << 5,
+        LevelVisible0 = 1u << 8,      ///< levelVisible[i] is LevelVisible0 << i
+    };
+
+    struct GridRecord {
+        std::uint32_t flags = 0;      ///< GridFlags
+        std::uint32_t firstLevel = 0;
+        std::uint32_t levelCount = 0;
+        float baseLineWidth = 0.0f;
+        float axisLineWidth = 0.0f;
+        float xAxisColor[3] = {};
+        float zAxisColor[3] = {};
+        std::uint32_t reserved = 0;
+    };
+
+    struct GridLevelRecord {
+        float spacing = 0.0f;
+        float color[3] = {};
+        float fadeEnd = 0.0f;
+        float fadeStart = 0.0f;
+    };
+
+    struct ColorStopRecord {
+        float position = 0.0f;
+        float color[4] = {};
+    };
+
+    struct GradientRef {
+        std::uint32_t first = 0;      ///< into the gradient column
+        std::uint32_t count = 0;
+    };
+
+    // FieldVisualizerComponent's settings; its GPU state is rebuilt on load.
+    struct VisualizerRecord {
+        std::uint32_t enabled = 1;
+        std::uint32_t displayMode = 0;
+        float boundsMin[3] = {};
+        float boundsMax[3] = {};
+        std::uint32_t useBakedField = 0;
+        std::int32_t bakeResolution[3] = {};
+
+        struct Arrows {
+            std::int32_t density[3] = {};
+            float vectorScale, headScale, intensityMultiplier, cullingThreshold;
+            std::uint32_t scaleByLength, scaleByThickness, adaptive, coloringMode;
+            float lengthScaleMultiplier, thicknessScaleMultiplier;
+            std::int32_t refineLevels;
+            float refineThreshold;
+            float axisColors[6][4];   ///< x+, x-, y+, y-, z+, z-
+            GradientRef intensityGradient;
+        } arrows{};
+
+        struct Flow {
+            std::int32_t particleCount;
+            float lifetime, baseSpeed, speedIntensityMultiplier, baseSize, headScale, peakSizeMultiplier, minSize;
+            float growthPercentage, shrinkPercentage, randomWalkStrength;
+            std::uint32_t scaleByLength, scaleByThickness, coloringMode;
+            float lengthScaleMultiplier, thicknessScaleMultiplier;
+        } flow{};
+
+        struct Particles {
+            std::uint32_t solid;
+            std::int32_t particleCount;
+            float lifetime, baseSpeed, speedIntensityMultiplier, baseSize, peakSizeMultiplier, minSize;
+            float baseGlowSize, peakGlowMultiplier, minGlowSize, randomWalkStrength, emissionRate;
+            std::uint32_t coloringMode;
+            float axisColors[6][4];
+            GradientRef intensityGradient;
+            GradientRef lifetimeGradient;
+        } particles{};
+
+        struct Streamlines {
+            std::int32_t seedDensity[3];
+            std::int32_t maxSteps;
+            float stepLength, minSpeed, thickness;
+            float glowColour[4];
+            float coreColour[4];
+        } streamlines{};
+    };
+
+    // FieldVisualizerComponent::TemporalSettings, in a chunk of its own so
+    // files without it load as before. A reader skips records of a newer
+    // version and keeps the defaults.
+    constexpr std::uint32_t kTemporalRecordVersion = 1;
+
+    struct TemporalRecord {
+        std::uint32_t version = kTemporalRecordVersion;
+        std::uint32_t enabled = 0;
+        float keyInterval = 0.0f;
+        std::int32_t slicesPerTick = 0;
+    };
+
+    /*
+     * World partition index ("*.krworld", see WorldPartition): WorldHeader,
+     * CellRecord[cellCount], then each cell's LOD proxy as a .kmesh blob,
+     * 8-byte aligned. The entities live in .krscene files in the directory
+     * <index name>_cells beside it: one <x>_<y>_<z>.krscene per cell and
+     * resident.krscene for everything that is never streamed.
+     */
+    constexpr std::uint32_t kWorldMagic = 0x444C574Bu;   // "KWLD"
+    constexpr std::uint32_t kWorldVersion = 1;
+
+    struct WorldHeader {
+        std::uint32_t magic = kWorldMagic;
+        std::uint32_t version = kWorldVersion;
+        std::uint32_t cellCount = 0;
+        float cellSize = 0.0f;          ///< metres along each axis
+    };
+
+    struct CellRecord {
+        std::int32_t coord[3] = {};     ///< cell = floor(bounds centre / cellSize)
+        std::uint32_t entityCount = 0;
+        float boundsMin[3] = {};        ///< union of the entities' world bounds
+        float boundsMax[3] = {};
+        std::uint64_t proxyOffset = 0;  ///< absolute; the proxy's vertices are relative to the bounds centre
+        std::uint64_t proxySize = 0;    ///< 0: no proxy
+    };
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "AabbTree.hpp"
+#include "CullingSystem.hpp"
+#include "MeshBvh.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <entt/entity/entity.hpp>
+#include <entt/fwd.hpp>
+
+/**
+ * @class SceneIndex
+ * @brief The scene's spatial index: one dynamic AABB tree over the
+ *        WorldBoundsComponent of every renderable mesh.
+ *
+ * update() runs once per tick after CullingSystem::updateWorldBounds() and
+ * moves only the leaves whose bounds changed; the tree's fat margin keeps
+ * most moves a containment test. Box, sphere, frustum, plane and ray
+ * queries test the tree's fat boxes and then each entity's tight bounds, so
+ * a visited entity's box really does overlap the query.
+ *
+ * Reads take a shared lock and may run on any thread, also during a tick;
+ * update() waits for them. Visitors run under the lock and must not call
+ * update(). Entities are as of the last update(): check them against the
+ * registry before use.
+ */
+class SceneIndex
+{
+public:
+    explicit SceneIndex(float margin = 0.05f) : m_tree(margin) {}
+
+    // Adds, moves and drops leaves to match the registry. Returns true if
+    // any leaf changed.
+    bool update(entt::registry& registry);
+    void clear();
+
+    std::size_t size() const;
+
+    // Calls visit(entity) for every entity whose bounds overlap [min, max].
+    template <class VisitFn>
+    void queryBox(const glm::vec3& min, const glm::vec3& max, VisitFn&& visit) const;
+    template <class VisitFn>
+    void querySphere(const glm::vec3& centre, float radius, VisitFn&& visit) const;
+    // Conservative, like CullingSystem::isVisible().
+    template <class VisitFn>
+    void queryFrustum(const Frustum& frustum, VisitFn&& visit) const;
+    // Entities whose bounds straddle the plane (ax + by + cz + d = 0).
+    template <class VisitFn>
+    void queryPlane(const glm::vec4& plane, VisitFn&& visit) const;
+
+    // Calls hit(entity, tMax) for every entity whose bounds the ray enters
+    // before tMax, in no particular order; 'hit' may lower tMax to prune
+    // the rest of the walk, as with BoundsBvh::raycast().
+    template <class HitFn>
+    void raycast(const glm::vec3& origin, const glm::vec3& dir, float& tMax, HitFn&& hit) const;
+
+private:
+    struct Item {
+        entt::entity entity = entt::null;    ///< null for a free slot
+        std::int32_t proxy = AabbTree::kNull;
+        glm::vec3 min{ 0.0f }, max{ 0.0f };  ///< tight bounds
+    };
+
+    static bool boxesOverlap(const glm::vec3& aMin, const glm::vec3& aMax, const glm::vec3& bMin, const glm::vec3& bMax)
+    {
+        return !(aMax.x < bMin.x || aMin.x > bMax.x || aMax.y < bMin.y || aMin.y > bMax.y
+              || aMax.z < bMin.z || aMin.z > bMax.z);
+    }
+    static bool sphereOverlaps(const glm::vec3& centre, float radius, const glm::vec3& min, const glm::vec3& max)
+    {
+        const glm::vec3 d = centre - glm::clamp(centre, min, max);
+        return glm::dot(d, d) <= radius * radius;
+    }
+    static bool planeStraddles(const glm::vec4& plane, const glm::vec3& min, const glm::vec3& max)
+    {
+        const glm::vec3 c = 0.5f * (min + max), e = 0.5f * (max - min);
+        const float r = std::abs(plane.x) * e.x + std::abs(plane.y) * e.y + std::abs(plane.z) * e.z;
+        return std::abs(glm::dot(glm::vec3(plane), c) + plane.w) <= r;
+    }
+
+    // Walks the tree with 'overlaps' on node and item boxes alike.
+    template <class OverlapFn, class VisitFn>
+    void walk(OverlapFn&& overlaps, VisitFn&& visit) const;
+    void removeItem(std::uint32_t slot);
+
+    mutable std::shared_mutex m_mutex;
+    AabbTree m_tree;
+    std::vector<Item> m_items;
+    std::vector<std::uint32_t> m_freeItems;
+    std::unordered_map<entt::entity, std::uint32_t> m_itemOf;
+    const entt::registry* m_registry = nullptr;
+};
+
+// --- Template implementation ---
+
+template <class OverlapFn, class VisitFn>
+void SceneIndex::walk(OverlapFn&& overlaps, VisitFn&& visit) const
+{
+    std::shared_lock lock(m_mutex);
+    m_tree.query(overlaps, [&](std::int32_t proxy) {
+        const Item& item = m_items[m_tree.userData(proxy)];
+        if (overlaps(item.min, item.max)) visit(item.entity);
+    });
+}
+
+template <class VisitFn>
+void SceneIndex::queryBox(const glm::vec3& min, const glm::vec3& max, VisitFn&& visit) const
+{
+    walk([&](const glm::vec3& mn, const glm::vec3& mx) { return boxesOverlap(mn, mx, min, max); }, visit);
+}
+
+template <class VisitFn>
+void SceneIndex::querySphere(const glm::vec3& centre, float radius, VisitFn&& visit) const
+{
+    walk([&](const glm::vec3& mn, const glm::vec3& mx) { return sphereOverlaps(centre, radius, mn, mx); }, visit);
+}
+
+template <class VisitFn>
+void SceneIndex::queryFrustum(const Frustum& frustum, VisitFn&& visit) const
+{
+    walk([&](const glm::vec3& mn, const glm::vec3& mx) { return CullingSystem::isVisible(frustum, mn, mx); }, visit);
+}
+
+template <class VisitFn>
+void SceneIndex::queryPlane(const glm::vec4& plane, VisitFn&& visit) const
+{
+    walk([&](const glm::vec3& mn, const glm::vec3& mx) { return planeStraddles(plane, mn, mx); }, visit);
+}
+
+template <class HitFn>
+void SceneIndex::raycast(const glm::vec3& origin, const glm::vec3& dir, float& tMax, HitFn&& hit) const
+{
+    const glm::vec3 invDir = 1.0f / dir;   // +-inf on zero components is what the slab test wants
+    auto enters = [&](const glm::vec3& mn, const glm::vec3& mx) {
+        return BvhDetail::rayBox(origin, invDir, mn, mx, tMax) >= 0.0f;
+    };
+    walk(enters, [&](entt::entity entity) { hit(entity, tMax); });
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QAbstractItemModel>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <entt/entity/registry.hpp>
+
+/**
+ * @class SceneOutlinerModel
+ * @brief The scene's TransformComponent entities as a tree, following
+ *        ParentComponent, loaded only as far as the view has expanded.
+ *
+ * Children are gathered when the view first asks for them and handed to
+ * it kFetchBatch rows at a time (canFetchMore()/fetchMore()), so a
+ * collapsed robot or a 100k-entity top level costs one entity id per row
+ * gathered and a node per row shown. Names are formatted in data(), for
+ * the rows being painted.
+ *
+ * TransformComponent, ParentComponent and TagComponent signals only queue
+ * the entity (from any thread); the queue is applied once per event-loop
+ * turn, as row inserts, moves, removes and name changes of the loaded
+ * rows. Past kResetThreshold changes in one turn (a scene load) the model
+ * resets instead. ParentComponent::parent edited in place without
+ * registry.patch() is not seen.
+ */
+class SceneOutlinerModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kFetchBatch = 512;
+    static constexpr std::size_t kResetThreshold = 4096;
+
+    explicit SceneOutlinerModel(entt::registry& registry, QObject* parent = nullptr);
+
+    entt::entity entityAt(const QModelIndex& index) const;
+    // The entity's row if it is loaded, otherwise an invalid index.
+    QModelIndex indexOf(entt::entity entity) const;
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& child) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    struct Node {
+        entt::entity parent = entt::null;    ///< null on the top level
+        int row = 0;
+        bool gathered = false;               ///< 'children' and 'unfetched' hold every child
+        std::vector<entt::entity> children;  ///< rows the view has
+        std::vector<entt::entity> unfetched; ///< gathered, not handed out yet
+    };
+
+    void onStructureChanged(entt::registry& registry, entt::entity entity);
+    void onRenamed(entt::registry& registry, entt::entity entity);
+    void queue(entt::entity entity, bool structural);
+    void sync();
+    void reset();
+
+    Node& nodeOf(const QModelIndex& index);
+    const Node* nodeOf(const QModelIndex& index) const;
+    // The entity's parent as the tree shows it: null for none or a dead one.
+    entt::entity parentOf(entt::entity entity) const;
+    bool shown(entt::entity entity) const;
+    void gather(entt::entity parent, Node& node);
+    void detach(entt::entity entity);
+    void attach(entt::entity entity, entt::entity parent);
+    void forget(entt::entity entity);   ///< drops the node and its loaded subtree
+    void refreshParents();
+
+    entt::registry& m_registry;
+    std::vector<entt::scoped_connection> m_connections;
+    Node m_root;
+    std::unordered_map<entt::entity, Node> m_nodes;   ///< loaded rows
+    std::unordered_set<entt::entity> m_parents;       ///< entities some ParentComponent points at
+    bool m_parentsStale = true;
+
+    std::mutex m_pendingMutex;
+    std::vector<entt::entity> m_pending;
+    bool m_structureChanged = false;                  ///< a ParentComponent or TransformComponent came or went
+    std::atomic<bool> m_syncQueued{ false };
+    std::vector<entt::entity> m_syncScratch;
+};
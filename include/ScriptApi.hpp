@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <entt/entity/entity.hpp>
+#include <entt/fwd.hpp>
+
+struct MeshData;
+
+/**
+ * @brief Whole-array scene operations for automation (see ScriptHost).
+ *
+ * Every call takes or fills flat arrays, so a script that sets a thousand
+ * joint vectors or spawns ten thousand entities crosses the binding once
+ * instead of once per item. Component storage is touched in batches
+ * (registry.insert per type), and the reads hand out the dense arrays the
+ * systems already keep: joint positions are the JointStateBuffer working
+ * set, world matrices are TransformSystem's contiguous array. Pointers
+ * into those stay valid until the next tick changes the scene's structure.
+ * GUI thread only, between ticks.
+ */
+namespace ScriptApi
+{
+    // Robot root links (JointStateComponent), in storage order.
+    std::vector<entt::entity> robots(const entt::registry& registry);
+
+    // The robot's joint positions by DOF, in place: writes show from the
+    // next tick on. Null with 'count' 0 if 'robot' has no joint state.
+    double* jointPositions(entt::registry& registry, entt::entity robot, std::size_t& count);
+
+    // Row r of 'q' ('stride' values) becomes the joint positions of
+    // robots[r]. Robots whose DOF count differs from 'stride' are skipped.
+    // Returns how many were set.
+    std::size_t setJointPositions(entt::registry& registry, const entt::entity* robots, std::size_t robotCount,
+        const double* q, std::size_t stride);
+
+    // 'count' new entities at 'positions' (xyz each), tagged 'tag', all
+    // showing 'mesh' (none if null). One batch per component type.
+    std::vector<entt::entity> spawn(entt::registry& registry, const std::shared_ptr<const MeshData>& mesh,
+        const float* positions, std::size_t count, const std::string& tag);
+
+    // Moves entities[i] to positions[i] (xyz each); invalid ones are skipped.
+    void setPositions(entt::registry& registry, const entt::entity* entities, const float* positions, std::size_t count);
+
+    // The field vector at each of 'count' points (xyz each) into 'out'
+    // (xyz each), against one snapshot of the scene's field sources.
+    void sampleField(entt::registry& registry, const float* points, std::size_t count, float* out);
+
+    // World matrices as of the last propagation: 'count' column-major 4x4
+    // float matrices, parallel to 'entities'.
+    const float* worldMatrices(entt::registry& registry, const entt::entity*& entities, std::size_t& count);
+
+    // A new TrajectoryGhostComponent entity showing 'q' ('count' values,
+    // one waypoint of the robot's DOF count per row) as 'ghosts' copies of
+    // 'robot' plus its end-effector path. Null if 'robot' has no kinematic
+    // model or 'count' is not a whole number of waypoints.
+    entt::entity showTrajectory(entt::registry& registry, entt::entity robot, const double* q, std::size_t count, int ghosts);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <entt/fwd.hpp>
+
+/**
+ * @class ScriptHost
+ * @brief Embedded Python with a `kr` module over ScriptApi.
+ *
+ * Built with KR_ENABLE_PYTHON. Scripts run to completion on the GUI
+ * thread between ticks, so they see one consistent scene and nothing
+ * moves under them. Each `kr` call takes whole arrays through the buffer
+ * protocol (numpy arrays, array.array, memoryviews) and reads the dense
+ * arrays without copying:
+ *
+ *   kr.robots()                         uint32 entity ids
+ *   kr.joint_positions(robot)           float64 view of its joint positions, writable
+ *   kr.set_joint_positions(robots, q)   q: float64, one row per robot
+ *   kr.spawn(uri, positions, tag="")    positions: float32 (n, 3); uri "" spawns without a mesh
+ *   kr.set_positions(entities, positions)
+ *   kr.sample_field(points, out=None)   float32 (n, 3) field vectors
+ *   kr.world_matrices()                 (entities, float32 (n, 4, 4) view), read-only
+ *   kr.show_trajectory(robot, q, ghosts=32)  q: float64, one waypoint per row; ghost entity id
+ *
+ * Views into scene arrays are released when the script returns; do not
+ * keep them (or numpy arrays over them) past that.
+ */
+class ScriptHost
+{
+public:
+    explicit ScriptHost(entt::registry& registry);
+    ~ScriptHost();
+    ScriptHost(const ScriptHost&) = delete;
+    ScriptHost& operator=(const ScriptHost&) = delete;
+
+    // Runs the file as __main__. False with 'error' set to the traceback if
+    // it raised.
+    bool runFile(const std::string& path, std::string* error = nullptr);
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <entt/fwd.hpp>
+#include <qopengl.h>
+#include <QOpenGLFunctions>
+#include "SensorStream.hpp"
+
+class QOpenGLContext;
+class QOpenGLFunctions_4_3_Core;
+
+/**
+ * @class SensorBuffers
+ * @brief GPU rings for every SensorStreamComponent, written by the readers.
+ *
+ * A stream gets its ring the first time update() sees it, then starts. With
+ * buffer storage (GL 4.4 or ARB_buffer_storage) the ring is one persistent,
+ * coherent mapping: readers decode into it and the draw reads it in place.
+ * Without it the ring is host memory and update() copies the new points
+ * since the last tick into a plain buffer, at most twice (the wrap), in the
+ * context that ran it; other contexts wait on a fence before drawing.
+ *
+ * head() is sampled once per tick, so every viewport draws the same window.
+ * Rings of streams that no longer exist are freed after their thread stops.
+ *
+ * A GPU-fed stream's ring is a plain buffer with no mapping or host copy;
+ * whoever writes it calls written() in the same context afterwards, and
+ * the points are drawn from the next tick on.
+ */
+class SensorBuffers
+{
+public:
+    struct Ranges {
+        GLuint buffer = 0;
+        GLint first[2] = {};
+        GLsizei count[2] = {};
+    };
+
+    void setFunctions(QOpenGLFunctions_4_3_Core* gl) { m_gl = gl; }
+
+    // Once per tick, before drawing.
+    void update(entt::registry& registry, std::uint64_t tick);
+    // The part of the stream's ring to draw this tick; false if it has none yet.
+    bool ranges(const SensorStream& stream, Ranges& out);
+    // Points from 'since' up to this tick's head that the ring still holds,
+    // as at most two runs; 'since' is advanced to the head.
+    bool fresh(const SensorStream& stream, std::uint64_t& since, Ranges& out);
+    // The stream's ring buffer, 0 if it has none yet.
+    GLuint buffer(const SensorStream& stream) const;
+    // GPU-fed rings were written this tick in the current context: other
+    // contexts wait for it before drawing.
+    void written();
+
+    void destroy();
+
+    bool persistent() const { return m_bufferStorage != nullptr; }
+
+private:
+    using BufferStorageFn = void (QOPENGLF_APIENTRYP)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+    struct Ring {
+        std::weak_ptr<SensorStream> stream;
+        GLuint buffer = 0;
+        SensorPoint* mapped = nullptr;        ///< persistent mapping, or null
+        std::vector<SensorPoint> host;        ///< the ring itself without buffer storage
+        std::uint64_t uploaded = 0;           ///< host points copied so far
+        std::uint64_t head = 0;               ///< sampled this tick
+    };
+
+    void resolveBufferStorage();
+    bool createRing(Ring& ring, SensorStream& stream);
+    void releaseRing(Ring& ring);
+    void upload(Ring& ring, std::size_t capacity);
+
+    QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+    BufferStorageFn m_bufferStorage = nullptr;
+    bool m_resolved = false;
+
+    std::unordered_map<const SensorStream*, Ring> m_rings;
+    std::uint64_t m_tick = ~0ull;
+    GLsync m_uploadFence = nullptr;
+    QOpenGLContext* m_uploadContext = nullptr;
+};
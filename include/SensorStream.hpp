@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+/// One sensor return, in the sensor's frame. This is also the GPU layout:
+/// readers decode straight into the buffer the point pass draws from.
+struct SensorPoint {
+    float x, y, z;
+    float time;            ///< SensorStream::clockSeconds() of arrival; set by the stream
+    std::uint32_t rgba;    ///< sRGB, R in the low byte
+};
+static_assert(sizeof(SensorPoint) == 20, "SensorPoint is read as a 20-byte std430 record");
+
+/**
+ * @class SensorReader
+ * @brief Driver interface for point streams (LiDAR, depth cameras).
+ *
+ * read() runs on the stream's own thread and may block on I/O, but should
+ * return within 'timeout' so the thread can notice when it is stopped. It
+ * decodes directly into 'out', which is GPU-visible memory: write each point
+ * once, never read it back.
+ */
+class SensorReader
+{
+public:
+    static constexpr std::size_t kMinRead = 1024;   ///< read() is never offered less room
+
+    virtual ~SensorReader() = default;
+
+    virtual bool open() = 0;
+    // Fills up to 'max' points; returns how many were written (0 on timeout).
+    virtual std::size_t read(SensorPoint* out, std::size_t max, std::chrono::milliseconds timeout) = 0;
+    virtual void close() {}
+};
+
+/**
+ * @class SensorStream
+ * @brief One sensor feeding a fixed ring of points, drawn in place.
+ *
+ * The ring is storage the renderer hands to start(): a persistently mapped
+ * GL buffer where the context has buffer storage, host memory
+ * otherwise. The reader thread writes into it and publishes head() with a
+ * release store; nothing on the GUI thread copies or allocates per frame.
+ * The oldest points are overwritten as the ring wraps, so a stalled GUI
+ * costs nothing and a stalled reader only lets the points fade out. The
+ * renderer draws all but the last guard() points behind the write
+ * position, which the reader cannot reach within a few frames at the rated
+ * rate.
+ *
+ * A stream made without a reader is GPU-fed: its ring is a plain GL buffer
+ * that compute passes write (VirtualSensors), and the GUI thread that
+ * issued them advances the head with publish().
+ */
+class SensorStream
+{
+public:
+    static constexpr std::size_t kDefaultCapacity = std::size_t(1) << 21;   ///< about 1 s at 2M points/s, 40 MiB
+
+    // 'capacity' is rounded up to a power of two (at least 8 reads).
+    SensorStream(std::string name, std::unique_ptr<SensorReader> reader,
+                 std::size_t capacity = kDefaultCapacity);
+    // GPU-fed: no reader, no thread.
+    explicit SensorStream(std::string name, std::size_t capacity = kDefaultCapacity);
+    ~SensorStream() { stop(); }
+
+    SensorStream(const SensorStream&) = delete;
+    SensorStream& operator=(const SensorStream&) = delete;
+
+    // Opens the reader and starts its thread writing into 'storage'
+    // (capacity() points), which must stay valid until stop() returns.
+    // A GPU-fed stream has no storage here and only marks itself running.
+    bool start(SensorPoint* storage);
+    void stop();
+    bool running() const { return m_running.load(std::memory_order_relaxed); }
+
+    bool gpuFed() const { return !m_reader; }
+    // GPU-fed only: 'count' more points were written after head(); returns
+    // the ring position of the first.
+    std::uint64_t publish(std::size_t count);
+
+    const std::string& name() const { return m_name; }
+    std::size_t capacity() const { return m_capacity; }
+    std::size_t guard() const { return m_reader ? m_capacity / 8 : 0; }   ///< GPU-fed: nothing is written past head()
+    /// Points written so far; those before it are complete (acquire).
+    std::uint64_t head() const { return m_head.load(std::memory_order_acquire); }
+
+    /// Seconds on the clock SensorPoint::time uses.
+    static float clockSeconds();
+
+private:
+    void run();
+
+    std::string m_name;
+    std::unique_ptr<SensorReader> m_reader;
+    std::size_t m_capacity;
+    SensorPoint* m_storage = nullptr;
+    std::atomic<std::uint64_t> m_head{ 0 };
+    std::atomic<bool> m_running{ false };
+    std::thread m_thread;
+};
+
+/**
+ * @class SimulatedLidarReader
+ * @brief A spinning multi-beam scanner over a floor and a ring of walls.
+ *
+ * Stands in for hardware when none is attached and paces itself to the
+ * rate a real unit would deliver.
+ */
+class SimulatedLidarReader : public SensorReader
+{
+public:
+    struct Settings {
+        int   beams = 32;
+        int   stepsPerTurn = 2048;
+        float turnsPerSecond = 10.0f;     ///< 32 x 2048 x 10 = 655k points/s
+        float mountHeight = 1.0f;         ///< above the floor
+        float wallRadius = 12.0f;
+        float verticalFovDegrees = 30.0f;
+    };
+
+    SimulatedLidarReader() = default;
+    explicit SimulatedLidarReader(const Settings& settings) : m_settings(settings) {}
+
+    bool open() override;
+    std::size_t read(SensorPoint* out, std::size_t max, std::chrono::milliseconds timeout) override;
+
+private:
+    Settings m_settings;
+    std::uint64_t m_step = 0;                         ///< columns emitted so far
+    std::chrono::steady_clock::time_point m_start;
+};
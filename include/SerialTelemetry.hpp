@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class TelemetryHub;
+
+/**
+ * @brief CommunicationProtocol::SERIAL_CUSTOM feedback: a COBS-framed binary
+ *        protocol over UART, every serial joint controller on one thread.
+ *
+ * A frame, before COBS encoding, is
+ *
+ *     u8   controller id (HardwareInterface::controller_id)
+ *     u8   quantity mask, bit i = JointSample::Quantity i
+ *     f32  one little-endian value per set bit, in bit order
+ *     u32  CRC32C of the bytes above, little-endian
+ *
+ * and goes on the wire COBS-encoded and followed by a 0x00 delimiter, so a
+ * receiver that starts mid-stream resynchronises at the next zero and a
+ * corrupt frame costs only itself.
+ *
+ * install() registers a TelemetryReader with the hub. It opens every port
+ * named by the joints' HardwareInterface::feedback_topic_name ("/dev/ttyUSB0",
+ * optionally "@<baud>"), raw and non-blocking, and waits on all of them in one
+ * poll(). Bytes are read straight into a per-port receive buffer and frames
+ * are COBS-decoded in place there, checked and turned into JointSamples
+ * without another copy; the hub's thread then pushes them into its SpscRing
+ * as for every other protocol. Linux only; elsewhere install() does nothing.
+ */
+namespace SerialTelemetry
+{
+    constexpr int kDefaultBaud = 2000000;
+    constexpr std::size_t kMaxPayload = 2 + 4 * 4 + 4;                 ///< all four quantities
+    constexpr std::size_t kMaxFrame = kMaxPayload + kMaxPayload / 254 + 2;   ///< encoded, with delimiter
+
+    struct Settings {
+        int baud = kDefaultBaud;        ///< for ports without an "@<baud>" suffix
+    };
+
+    void install(TelemetryHub& hub, const Settings& settings = {});
+
+    // Castagnoli CRC (iSCSI, ext4), with SSE4.2 or ARMv8 CRC instructions
+    // where the build targets them, a table otherwise.
+    std::uint32_t crc32c(const std::uint8_t* data, std::size_t size);
+
+    // COBS-encodes 'size' bytes into 'out' and appends the 0x00 delimiter.
+    // 'out' needs size + size / 254 + 2 bytes. Returns the bytes written.
+    std::size_t encode(const std::uint8_t* data, std::size_t size, std::uint8_t* out);
+    // Decodes one frame (without its delimiter) in place. Returns the
+    // decoded length, or 0 if 'size' bytes are not a valid COBS frame.
+    std::size_t decodeInPlace(std::uint8_t* data, std::size_t size);
+
+    // A complete wire frame with the values[i] whose bit is set in 'mask',
+    // for device firmware and simulators. 'out' needs kMaxFrame bytes.
+    std::size_t encodeFrame(std::uint8_t controller, std::uint8_t mask, const float values[4], std::uint8_t* out);
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class QFile;
+
+/**
+ * Session log file layout ("*.krec"), little-endian, every field 8-byte aligned:
+ *
+ *   FileHeader                      magic "KREC", version, wall-clock start
+ *   { RecordHeader, payload }*      appended in order, never rewritten
+ *
+ * Records are either ChannelRecord (channel id + name, written the first time
+ * a channel is used) or ChunkRecord, one column of timestamps followed by one
+ * column of values for a single channel. Chunks of one channel are appended
+ * in time order, so a reader can binary-search first the chunks and then the
+ * timestamps inside one. A crash loses at most the chunks still buffered;
+ * a truncated tail record is ignored on open.
+ */
+namespace SessionLogFormat
+{
+    constexpr std::uint32_t kMagic = 0x4345524Bu;        // "KREC"
+    constexpr std::uint32_t kVersion = 1;
+    constexpr std::uint32_t kChannelTag = 0x4E414843u;   // "CHAN"
+    constexpr std::uint32_t kChunkTag = 0x4B4E4843u;     // "CHNK"
+
+    struct FileHeader {
+        std::uint32_t magic = kMagic;
+        std::uint32_t version = kVersion;
+        std::int64_t  wallClockStartMs = 0;  ///< ms since the Unix epoch when recording started
+        std::int64_t  steadyStartNs = 0;     ///< steady-clock time matching wallClockStartMs
+        std::int64_t  reserved = 0;
+    };
+    struct RecordHeader {
+        std::uint32_t tag = 0;
+        std::uint32_t payloadBytes = 0;      ///< multiple of 8
+    };
+    struct ChannelRecord {                   ///< followed by the name, zero-padded to 8 bytes
+        std::uint32_t channel = 0;
+        std::uint32_t nameBytes = 0;
+    };
+    struct ChunkRecord {                     ///< followed by int64 t[count], then double v[count]
+        std::uint32_t channel = 0;
+        std::uint32_t count = 0;
+        std::int64_t  firstNs = 0;
+        std::int64_t  lastNs = 0;
+    };
+}
+
+/**
+ * @class SessionRecorder
+ * @brief Appends timestamped channel samples to a session log.
+ *
+ * Samples are buffered per channel and written as one chunk every
+ * kChunkSamples (and on flush/close), so the file only ever grows by whole
+ * chunks. Timestamps within a channel must not decrease; earlier ones are
+ * dropped. Not thread-safe: call from the thread that drains telemetry.
+ */
+class SessionRecorder
+{
+public:
+    static constexpr std::size_t kChunkSamples = 4096;
+
+    SessionRecorder();
+    ~SessionRecorder();
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    // Channel id for 'name', registering it on first use. Ids stay valid
+    // across close() and open(), which re-declares known channels.
+    int channel(const std::string& name);
+    void append(int channel, std::int64_t timestampNs, double value);
+    void flush();
+
+    std::uint64_t sampleCount() const { return m_samples; }
+
+private:
+    struct Buffer {
+        std::string name;
+        std::vector<std::int64_t> t;
+        std::vector<double> v;
+    };
+
+    void writeChannel(int channel);
+    void writeChunk(int channel);
+    bool write(const void* data, std::size_t bytes);
+
+    std::unique_ptr<QFile> m_file;
+    std::vector<Buffer> m_channels;
+    std::uint64_t m_samples = 0;
+};
+
+/**
+ * @class SessionLog
+ * @brief Read-only, memory-mapped view of a session log.
+ *
+ * open() maps the file and scans only the record headers to build a
+ * per-channel chunk index; sample columns are read in place from the
+ * mapping, so hours of data cost address space, not RAM. valueAt() is two
+ * binary searches.
+ */
+class SessionLog
+{
+public:
+    SessionLog();
+    ~SessionLog();
+
+    SessionLog(const SessionLog&) = delete;
+    SessionLog& operator=(const SessionLog&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    int channelCount() const { return int(m_channels.size()); }
+    const std::string& channelName(int channel) const { return m_channels[channel].name; }
+    int channelIndex(const std::string& name) const;   ///< -1 if not recorded
+
+    std::int64_t beginNs() const { return m_beginNs; }  ///< earliest sample of any channel
+    std::int64_t endNs() const { return m_endNs; }      ///< latest sample of any channel
+    const SessionLogFormat::FileHeader& header() const { return m_header; }
+
+    // Sample-and-hold: the newest value at or before 't'. False if the
+    // channel has no sample that early.
+    bool valueAt(int channel, std::int64_t t, double& value) const;
+    std::size_t sampleCount(int channel) const;
+
+private:
+    struct Chunk {
+        std::int64_t firstNs, lastNs;
+        std::uint32_t count;
+        const std::int64_t* t;
+        const double* v;
+    };
+    struct Channel {
+        std::string name;
+        std::vector<Chunk> chunks;           ///< in time order
+    };
+
+    std::unique_ptr<QFile> m_file;
+    const unsigned char* m_map = nullptr;
+    SessionLogFormat::FileHeader m_header;
+    std::vector<Channel> m_channels;
+    std::int64_t m_beginNs = 0, m_endNs = 0;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "SessionLog.hpp"
+#include "TelemetryHub.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @class SessionPlayback
+ * @brief Transport (play, pause, seek) over a recorded SessionLog.
+ *
+ * Playback goes through the live telemetry path: TelemetryHub::bindAll()
+ * with makeReaderFactory() starts a reader thread that emits, every
+ * millisecond, each bound joint's recorded value at the playback cursor.
+ * So everything downstream of TelemetryHub::drain() cannot tell a replay
+ * from a live rig. Samples are re-stamped with the current time so the
+ * hub's newest-wins rule also holds when seeking backwards.
+ *
+ * Transport calls are lock-free and may come from the GUI thread while the
+ * reader runs.
+ */
+class SessionPlayback : public std::enable_shared_from_this<SessionPlayback>
+{
+public:
+    explicit SessionPlayback(std::shared_ptr<const SessionLog> log);
+
+    const SessionLog& log() const { return *m_log; }
+
+    void play() { m_playing.store(true, std::memory_order_relaxed); }
+    void pause() { m_playing.store(false, std::memory_order_relaxed); }
+    bool playing() const { return m_playing.load(std::memory_order_relaxed); }
+
+    void setSpeed(double speed) { m_speed.store(speed, std::memory_order_relaxed); }
+    double speed() const { return m_speed.load(std::memory_order_relaxed); }
+
+    // Clamped to [log().beginNs(), log().endNs()].
+    void seek(std::int64_t t);
+    std::int64_t cursorNs() const { return m_cursor.load(std::memory_order_relaxed); }
+
+    TelemetryHub::ReaderFactory makeReaderFactory();
+
+private:
+    class Reader;
+
+    // Reader thread: moves the cursor by 'elapsedNs' of wall time while playing.
+    std::int64_t advance(std::int64_t elapsedNs);
+
+    std::shared_ptr<const SessionLog> m_log;
+    std::atomic<std::int64_t> m_cursor;
+    std::atomic<double> m_speed{ 1.0 };
+    std::atomic<bool> m_playing{ false };
+};
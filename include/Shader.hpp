@@ -1,11 +1,15 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <string>
-#include <vector>         
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <memory>
 #include <QtOpenGL/QOpenGLFunctions_4_3_Core>
 
 // Forward-declaration to avoid including heavy Qt headers here.
 class QOpenGLFunctions_4_3_Core;
+class ShaderBinaryCache;
 
 class Shader
 {
@@ -14,34 +18,56 @@ public:
     Shader(QOpenGLFunctions_4_3_Core* gl,
         const char* vs, const char* fs);
     // The constructor takes a pointer to the OpenGL function implementation.
+    // 'defines' ("#define NAME value" lines) go after each stage's #version.
     Shader(QOpenGLFunctions_4_3_Core* gl,
-        const std::vector<std::string>& paths);
+        const std::vector<std::string>& paths, const std::string& defines = {});
     static std::unique_ptr<Shader> buildTessellatedShader(
         QOpenGLFunctions_4_3_Core* gl,
         const char* vsPath,
         const char* tcsPath,
         const char* tesPath,
-        const char* fsPath);
+        const char* fsPath,
+        const char* gsPath = nullptr); // optional geometry stage after TES
     // The destructor is now declared to be implemented in the .cpp file.
     ~Shader();
 
     static std::unique_ptr<Shader> buildComputeShader(
         QOpenGLFunctions_4_3_Core* gl,
-        const char* computePath
+        const char* computePath,
+        const std::string& defines = {}
     );
 
+    // Process-wide program binary cache consulted before every compile; the
+    // caller keeps ownership. Pass nullptr to always compile from source.
+    static void setBinaryCache(ShaderBinaryCache* cache);
+
     void use();
     GLint  getLoc(const char* name) const;
 
+    // Location from the table reflected at link time; -1 if the uniform is
+    // not active. Never touches the driver.
+    GLint  uniformLocation(const std::string& name) const;
+
     // Uniform setter functions
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
+    void setUInt(const std::string& name, unsigned value) const;
     void setFloat(const std::string& name, float value) const;
     void setVec3(const std::string& name, const glm::vec3& value) const;
     void setMat4(const std::string& name, const glm::mat4& mat) const;
 	void setVec4(const std::string& name, const glm::vec4& value) const;
 	void setVec2(const std::string& name, const glm::vec2& value) const;
 
+    // Same setters by pre-resolved location (see uniformLocation()).
+    void setBool(GLint loc, bool value) const;
+    void setInt(GLint loc, int value) const;
+    void setUInt(GLint loc, unsigned value) const;
+    void setFloat(GLint loc, float value) const;
+    void setVec3(GLint loc, const glm::vec3& value) const;
+    void setMat4(GLint loc, const glm::mat4& mat) const;
+    void setVec4(GLint loc, const glm::vec4& value) const;
+    void setVec2(GLint loc, const glm::vec2& value) const;
+
     static std::unique_ptr<Shader> buildGeometryShader(
         QOpenGLFunctions_4_3_Core* gl,
         const std::string& vertexPath,
@@ -56,6 +82,15 @@ private:
     
 
     QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+    std::unordered_map<std::string, GLint> m_uniformLocations;
+    static ShaderBinaryCache* s_binaryCache;
+
+    // Creates ID from (stage type, source) pairs: loads the cached binary when
+    // one matches, otherwise compiles, links and stores the result.
+    void buildProgram(const std::vector<std::pair<GLenum, std::string>>& stages);
+
+    // Fills m_uniformLocations from the linked program's active uniforms.
+    void reflectUniforms();
     // Utility function for checking shader compilation linking errors.
     // The implementation is now memory-safe.
     bool checkCompileErrors(unsigned int shader, std::string type);
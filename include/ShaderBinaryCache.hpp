@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <string>
+#include <utility>
+#include <vector>
+#include <qopengl.h>
+
+class QOpenGLFunctions_4_3_Core;
+
+/**
+ * @class ShaderBinaryCache
+ * @brief Persists linked program binaries so warm starts skip GLSL compiles.
+ *
+ * Entries are keyed by a hash of every stage's type and source plus the GL
+ * vendor, renderer and version strings, so a shader edit or a driver update
+ * simply misses. Binaries live in <app cache>/shaders/<key>.bin. A binary
+ * the driver rejects is treated as a miss and overwritten after the compile.
+ */
+class ShaderBinaryCache
+{
+public:
+    using Stage = std::pair<GLenum, std::string>; ///< stage type, GLSL source
+
+    explicit ShaderBinaryCache(QOpenGLFunctions_4_3_Core* gl = nullptr) : m_gl(gl) {}
+    void setFunctions(QOpenGLFunctions_4_3_Core* gl);
+
+    QByteArray key(const std::vector<Stage>& stages) const;
+
+    // Loads the binary for 'key' into 'program'; false on a miss or when the
+    // driver refuses it, in which case 'program' must be compiled as usual.
+    bool load(const QByteArray& key, GLuint program);
+    // Must be called on a program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+    void store(const QByteArray& key, GLuint program);
+
+    bool enabled() const { return m_enabled; }
+    int  hits() const { return m_hits; }
+    int  misses() const { return m_misses; }
+
+private:
+    QString pathFor(const QByteArray& key) const;
+
+    QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+    QString    m_directory;
+    QByteArray m_driverId;   ///< vendor/renderer/version, folded into every key
+    bool m_enabled = false;  ///< false without binary formats or a writable cache dir
+    int  m_hits = 0;
+    int  m_misses = 0;
+};
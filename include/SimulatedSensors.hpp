@@ -0,0 +1,107 @@
+#pragma once
+
+#include "DynamicsSimulation.hpp"
+#include "TelemetryHub.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <entt/fwd.hpp>
+
+/**
+ * @class SimulatedSensors
+ * @brief TelemetryReader that turns DynamicsSimulation's joint states into
+ *        the readings the joints' sensors would give.
+ *
+ * Bound with TelemetryHub::bindAll(), it feeds the same SpscRing as a
+ * hardware driver. Everything after TelemetryHub::drain() (estimation,
+ * recording, the views) then runs on measured values at the sensor rates.
+ * While it is open, DynamicsSimulation::apply() steps aside (setMeasured()).
+ *
+ * Each joint is read through the first sensor in its description that
+ * gives a position:
+ *  - EncoderSensor: counts = floor((q - zero_offset) * gear_ratio_to_joint
+ *    * counts_per_revolution / 2pi + noise), one revolution being 1 m on a
+ *    prismatic joint. ABSOLUTE_SINGLE_TURN counts wrap at one revolution
+ *    and are unwrapped again like a drive does. INCREMENTAL counts are taken
+ *    as homed at open(), so they decode like ABSOLUTE_MULTI_TURN.
+ *  - PotentiometerSensor: min_voltage at the lower joint limit to
+ *    max_voltage at the upper, plus noise, through a Settings::adcBits ADC.
+ *    A joint without limits spans one sensor revolution around zero.
+ *  - Neither: the simulated position, exactly.
+ * Position is decoded back from the reading. Velocity is the difference of
+ * successive positions over the sample period, as drives estimate it, so
+ * quantization shows up in it. Effort is the simulated effort plus noise.
+ * The raw reading (counts or volts) goes out as the Sensor quantity.
+ *
+ * Joints are kept as arrays per sensor kind, and each sample period runs
+ * every joint of a kind through the same branch-free loops. Noise is
+ * Gaussian, approximated by a sum of four xorshift uniforms per lane.
+ * open() runs on the GUI thread, which also owns 'registry'; read() only
+ * touches DynamicsSimulation's sensor tap.
+ */
+class SimulatedSensors : public TelemetryReader
+{
+public:
+    struct Settings {
+        double encoderRate = 1000.0;        ///< Hz, also joints without a sensor
+        double potentiometerRate = 250.0;   ///< Hz
+        double encoderNoise = 0.3;          ///< counts rms
+        double potentiometerNoise = 0.002;  ///< volts rms
+        int    adcBits = 12;
+        double effortNoise = 0.02;          ///< N·m (N) rms
+        std::uint64_t seed = 1;
+    };
+
+    SimulatedSensors(entt::registry& registry, DynamicsSimulation& dynamics, const Settings& settings);
+    SimulatedSensors(entt::registry& registry, DynamicsSimulation& dynamics)
+        : SimulatedSensors(registry, dynamics, Settings{}) {}
+
+    bool open(const std::vector<Endpoint>& endpoints) override;
+    std::size_t read(JointSample* out, std::size_t max, std::chrono::milliseconds timeout) override;
+    void close() override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // One sensor kind, structure of arrays by lane.
+    struct Lanes {
+        std::vector<std::uint32_t> channel, dof;
+        std::vector<double> scale;          ///< reading units per joint unit
+        std::vector<double> offset;         ///< joint position where the reading is 'origin'
+        std::vector<double> modulus;        ///< counts per wrap, 0 if none (encoders)
+        std::vector<double> origin;         ///< volts at 'offset' (potentiometers)
+        std::vector<double> low, high;      ///< ADC input range, volts (potentiometers)
+        std::vector<std::uint64_t> random;  ///< xorshift state
+        std::vector<double> truth;          ///< simulated position, this sample
+        std::vector<double> reading;        ///< raw counts (wrapped) or volts
+        std::vector<double> count;          ///< unwrapped counts (encoders)
+        std::vector<double> position, lastPosition, effort;
+        bool primed = false;                ///< a sample went out before
+        std::int64_t lastNs = 0;
+        Clock::duration period{};
+        Clock::time_point deadline;
+
+        void add(std::uint32_t channel, std::uint32_t dof, double scale, double offset, double modulus,
+            double origin, double low, double high, std::uint64_t seed);
+        // Sizes the per-sample arrays once the lanes are added.
+        void resize();
+        std::size_t size() const { return channel.size(); }
+    };
+
+    // Reads position and effort (with effort noise) from 'state'; false if
+    // the simulation has fewer joints than bound.
+    bool gather(Lanes& lanes, const DynamicsSimulation::State& state);
+    void quantizeEncoders();
+    void quantizePotentiometers();
+    // Queues position, velocity, effort and, if 'raw', the reading.
+    void emit(Lanes& lanes, std::int64_t now, bool raw);
+
+    entt::registry& m_registry;
+    DynamicsSimulation& m_dynamics;
+    Settings m_settings;
+    Lanes m_encoders, m_potentiometers, m_exact;
+    std::vector<JointSample> m_pending;
+    std::size_t m_next = 0;                 ///< first of m_pending not yet returned
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <qopengl.h>
+
+class QOpenGLFunctions_4_3_Core;
+
+/**
+ * @class SplineArena
+ * @brief One buffer of vec4 points shared by every spline.
+ *
+ * Each spline (keyed by its entity) owns a [first, first + count) range that
+ * is rewritten only when the caller hands in a new revision. Points are
+ * stored as vec4 (w = 1) so the same buffer can be bound as a std430
+ * `vec4 points[]` SSBO or sourced as a 16-byte-stride vertex attribute.
+ * Like MeshArena the buffer lives in the share group; growing replaces the
+ * buffer name and bumps generation() so per-context VAOs can re-point.
+ */
+class SplineArena
+{
+public:
+    struct Range {
+        GLint   first = 0;
+        GLsizei count = 0;
+        GLsizei capacity = 0;        ///< elements reserved; count may shrink in place
+        std::uint32_t revision = ~0u;
+    };
+
+    explicit SplineArena(QOpenGLFunctions_4_3_Core* gl = nullptr) : m_gl(gl) {}
+    ~SplineArena() = default; // GL objects must be freed explicitly via destroy()
+
+    void setFunctions(QOpenGLFunctions_4_3_Core* gl) { m_gl = gl; }
+
+    const Range* find(std::uint32_t key) const;
+
+    // Writes 'points' for 'key' unless that revision is already resident.
+    // Reuses the existing range when it is large enough.
+    const Range& upload(std::uint32_t key, std::uint32_t revision,
+        const std::vector<glm::vec3>& points);
+
+    void release(std::uint32_t key);
+
+    // Releases every range whose key fails 'alive(key)'.
+    template<class Alive>
+    void prune(Alive&& alive)
+    {
+        m_pruneScratch.clear();
+        for (const auto& [key, range] : m_ranges)
+            if (!alive(key)) m_pruneScratch.push_back(key);
+        for (std::uint32_t key : m_pruneScratch) release(key);
+    }
+
+    // Deletes the buffer. A context of the share group must be current.
+    void destroy();
+
+    GLuint buffer() const { return m_buffer; }
+    std::uint32_t generation() const { return m_generation; }
+    std::size_t pointCountInUse() const { return m_used; }
+
+private:
+    struct Block { GLsizei offset; GLsizei size; };
+
+    GLsizei allocate(GLsizei count);
+    void    free(GLsizei offset, GLsizei count);
+    void    grow(GLsizei required);
+
+    QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+    GLuint  m_buffer = 0;
+    GLsizei m_capacity = 0; ///< in points
+    GLsizei m_top = 0;      ///< bump pointer, in points
+    std::vector<Block> m_freeList; ///< sorted by offset, adjacent blocks merged
+
+    std::unordered_map<std::uint32_t, Range> m_ranges;
+    std::vector<glm::vec4> m_staging;
+    std::vector<std::uint32_t> m_pruneScratch;
+    std::uint32_t m_generation = 0;
+    std::size_t m_used = 0;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+
+// CPU sampling of the spline types SplineComponent caches as line vertices.
+// Free of GL and registry state, so it can be timed and reused on its own.
+namespace SplineEvaluation
+{
+    // 'segmentsPerCurve' samples per 4-point window, through p1..p(n-2).
+    std::vector<glm::vec3> catmullRom(const std::vector<glm::vec3>& controlPoints, int segmentsPerCurve);
+
+    // One curve of degree controlPoints.size() - 1, 'numSegments' samples.
+    std::vector<glm::vec3> bezier(const std::vector<glm::vec3>& controlPoints, int numSegments);
+
+    // Cubic segments sharing anchors (anchor, control, control, anchor, ...).
+    std::vector<glm::vec3> piecewiseBezier(const std::vector<glm::vec3>& controlPoints, int segmentsPerCurve);
+
+    // 'func' at 'numSegments' evenly spaced t in [0, 1].
+    std::vector<glm::vec3> parametric(const std::function<glm::vec3(float)>& func, int numSegments);
+
+    /**
+     * @brief Distance along a sampled spline, for constant-speed motion.
+     *
+     * Built once per polyline (SplineComponent keeps one next to its cache):
+     * the running length at every vertex, and a rotation-minimising frame
+     * there. A query at distance s binary-searches the lengths, O(log n),
+     * and interpolates within the bracketing segment. Parameters are the
+     * samplers' own: vertex i of n sits at t = i / (n - 1).
+     */
+    struct ArcLengthTable {
+        std::vector<float> distance;      ///< from the first vertex, per vertex; non-decreasing
+        std::vector<glm::vec3> tangent;   ///< unit, per vertex
+        std::vector<glm::vec3> normal;    ///< unit, perpendicular to tangent, transported without twist
+
+        float length() const { return distance.empty() ? 0.0f : distance.back(); }
+        // The segment holding distance s, clamped to the polyline; the
+        // segment starting at vertex i, so i + 1 < size.
+        std::size_t segmentAt(float s) const;
+        float parameterAt(float s) const;
+    };
+
+    struct ArcSample {
+        glm::vec3 position{ 0.0f };
+        glm::vec3 tangent{ 0.0f, 0.0f, 1.0f };
+        glm::vec3 normal{ 1.0f, 0.0f, 0.0f };   ///< binormal is cross(tangent, normal)
+        float parameter = 0.0f;
+    };
+
+    ArcLengthTable arcLength(const std::vector<glm::vec3>& vertices);
+
+    // 'vertices' is the polyline the table was built from.
+    ArcSample sampleAt(const ArcLengthTable& table, const std::vector<glm::vec3>& vertices, float s);
+    // 'count' distances at once. Sorted runs, as items spaced along a
+    // conveyor are, walk the table once; anything else falls back to a
+    // search per query. Distances are clamped to [0, length()].
+    void sampleBatch(const ArcLengthTable& table, const std::vector<glm::vec3>& vertices,
+        const float* distances, std::size_t count, ArcSample* out);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+/**
+ * @class SpscRing
+ * @brief Bounded lock-free queue for exactly one producer and one consumer thread.
+ *
+ * Capacity must be a power of two. Each side owns one index and only reads the
+ * other's, so push() and pop() are wait-free: no locks, no CAS loops, and a
+ * full ring makes push() fail instead of blocking the producer. The indices
+ * sit on separate cache lines so the two threads do not false-share.
+ */
+template<class T, std::size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer thread only. Returns false (and drops 'value') when full.
+    bool push(const T& value)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_cachedTail == Capacity) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head - m_cachedTail == Capacity) return false;
+        }
+        m_slots[head & (Capacity - 1)] = value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only. Returns false when empty.
+    bool pop(T& out)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_cachedHead) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail == m_cachedHead) return false;
+        }
+        out = m_slots[tail & (Capacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called while the other side is active.
+    std::size_t size() const
+    {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+    static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+    static constexpr std::size_t kLine = 64;
+
+    alignas(kLine) std::atomic<std::size_t> m_head{ 0 };  ///< next slot to write
+    std::size_t m_cachedTail = 0;                          ///< producer's view of m_tail
+    alignas(kLine) std::atomic<std::size_t> m_tail{ 0 };  ///< next slot to read
+    std::size_t m_cachedHead = 0;                          ///< consumer's view of m_head
+    alignas(kLine) std::array<T, Capacity> m_slots{};
+};
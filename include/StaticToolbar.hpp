@@ -2,6 +2,8 @@
 
 #include <QWidget>
 
+class QMenu;
+
 // Forward declaration for the UI class generated by uic
 namespace Ui {
     class toolbarContainer;
@@ -15,9 +17,33 @@ public:
     explicit StaticToolbar(QWidget* parent = nullptr);
     ~StaticToolbar();
 
+    // Reflects a sync mode change made elsewhere (or cancelled) without re-emitting.
+    void setTwinSyncChecked(bool checked);
+
+    // The View button's popup: display and renderer settings, filled in by
+    // MainWindow, which owns what they switch.
+    QMenu* viewMenu() const { return m_viewMenu; }
+
 signals:
     void loadRobotClicked();
+    void showCollisionsToggled(bool enabled);
+    void showFramesToggled(bool enabled);
+    void annotationToggled(bool enabled);
+    void findReplaceClicked();
+    void undoClicked();
+    void redoClicked();
+    void importPointCloudClicked();
+    void showLidarToggled(bool enabled);
+    void liveReconstructionToggled(bool enabled);
+    void canBusToggled(bool enabled);
+    void eventLogToggled(bool enabled);
+    void remoteViewToggled(bool enabled);
+    void twinSyncToggled(bool enabled);
+    void addLaserGateClicked();
+    void emergencyStopPressed();
+    void exportClicked();
 
 private:
     Ui::toolbarContainer* ui; // Pointer to the generated UI class
+    QMenu* m_viewMenu = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <entt/entt.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @class SystemScheduler
+ * @brief Runs the per-tick systems in waves, concurrently where their declared access allows.
+ *
+ * Each system declares the components it reads and writes, plus any shared
+ * non-component state it touches (uses<>). A system waits for every earlier
+ * one it conflicts with: a write against a read or write of the same type.
+ * Systems added in program order therefore see the same data as if run one
+ * after another, and independent ones (animations next to the transform
+ * chain) share a wave and run on ThreadPool::shared().
+ *
+ * Systems in a shared wave may only emplace or remove the component types
+ * they write; their storages are created up front on the calling thread.
+ * Anything else (registry context, signals, other types) needs exclusive().
+ */
+class SystemScheduler
+{
+public:
+    // Returns whether the system changed anything visible this tick.
+    using Fn = std::function<bool(entt::registry&)>;
+
+    class Access
+    {
+    public:
+        template <class... C> Access& reads()  { (addComponent<C>(m_reads), ...); return *this; }
+        template <class... C> Access& writes() { (addComponent<C>(m_writes), ...); return *this; }
+        // Shared state outside the registry; always treated as written.
+        template <class... R> Access& uses()   { (m_writes.push_back(entt::type_hash<R>::value()), ...); return *this; }
+        // Runs alone, after everything added before it and before everything after.
+        Access& exclusive()  { m_exclusive = true; return *this; }
+        // Runs on the thread that calls run(), e.g. for GUI-thread-only state.
+        Access& mainThread() { m_mainThread = true; return *this; }
+
+    private:
+        friend class SystemScheduler;
+        template <class C> void addComponent(std::vector<entt::id_type>& set)
+        {
+            set.push_back(entt::type_hash<C>::value());
+            m_assure.push_back([](entt::registry& r) { r.storage<C>(); });
+        }
+
+        std::vector<entt::id_type> m_reads, m_writes;
+        std::vector<void (*)(entt::registry&)> m_assure;
+        bool m_exclusive = false;
+        bool m_mainThread = false;
+    };
+
+    // Systems run in waves that respect the order they were added in.
+    void add(std::string name, Access access, Fn fn);
+
+    // One tick. Returns true if any system reported a change.
+    bool run(entt::registry& registry);
+
+    // Wall time of each system during the last run(), in the order added.
+    // Systems of one wave overlap, so these do not add up to the tick.
+    std::size_t systemCount() const { return m_systems.size(); }
+    const std::string& systemName(std::size_t index) const { return m_systems[index].name; }
+    double systemMs(std::size_t index) const { return m_systems[index].lastMs; }
+    // Heap allocations the system made on its own thread during the last
+    // run(); always 0 unless built with KR_COUNT_ALLOCATIONS.
+    std::uint64_t systemAllocations(std::size_t index) const { return m_systems[index].lastAllocations; }
+
+private:
+    struct System {
+        std::string name;
+        Access access;
+        Fn fn;
+        std::size_t wave = 0;
+        double lastMs = 0.0;
+        const char* zoneName = nullptr;   ///< interned copy of 'name'
+        std::uint64_t lastAllocations = 0;
+        bool lastChanged = false;
+        bool allocationReported = false;
+    };
+    struct WaveSync;
+
+    /// Ticks before a system that changed nothing must also allocate nothing.
+    static constexpr std::uint64_t kAllocationWarmupTicks = 120;
+    std::uint64_t m_ticks = 0;
+
+    static bool conflicts(const Access& a, const Access& b);
+    static void runSystem(System& system, entt::registry& registry);
+
+    std::vector<System> m_systems;
+    std::vector<std::vector<std::size_t>> m_waves;   ///< system indices per wave
+};
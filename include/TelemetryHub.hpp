@@ -0,0 +1,142 @@
+#pragma once
+
+#include "RobotDescription.hpp"
+#include "SpscRing.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <entt/fwd.hpp>
+#include <entt/entity/entity.hpp>
+
+/// One joint reading. 'channel' indexes the endpoint list the reader was
+/// opened with. Position, Velocity and Effort samples go to the robot's
+/// JointStateBuffer; Sensor samples only reach the recorder.
+struct JointSample {
+    enum class Quantity : std::uint8_t { Position, Velocity, Effort, Sensor };
+    static constexpr int kQuantityCount = 4;
+
+    std::int64_t  timestampNs = 0;   ///< steady-clock time of acquisition
+    std::uint32_t channel = 0;
+    Quantity      quantity = Quantity::Position;
+    double        value = 0.0;       ///< SI units; radians or metres for Position
+};
+
+class SessionRecorder;
+class JointStateBuffer;
+
+/**
+ * @class TelemetryReader
+ * @brief Protocol driver interface for joint feedback (CANopen, EtherCAT, serial).
+ *
+ * read() runs on the reader's own thread and may block on I/O, but should
+ * return within 'timeout' so the thread can notice when it is stopped.
+ */
+class TelemetryReader
+{
+public:
+    struct Endpoint {
+        std::uint32_t controllerId = 0;   ///< HardwareInterface::controller_id
+        std::string   feedbackTopic;      ///< HardwareInterface::feedback_topic_name
+        std::string   jointName;          ///< JointDescription::name
+        entt::entity  joint = entt::null; ///< the joint's entity, for simulated sources
+    };
+
+    virtual ~TelemetryReader() = default;
+
+    virtual bool open(const std::vector<Endpoint>& endpoints) = 0;
+    // Fills up to 'max' samples; returns how many were written (0 on timeout).
+    virtual std::size_t read(JointSample* out, std::size_t max, std::chrono::milliseconds timeout) = 0;
+    virtual void close() {}
+};
+
+/**
+ * @class TelemetryHub
+ * @brief Feeds hardware joint feedback into each robot's JointStateBuffer.
+ *
+ * bind() groups every moving joint by HardwareInterface::protocol and
+ * starts one thread per protocol with a registered reader. Each thread pushes
+ * samples into its own SpscRing, so the GUI thread never takes a lock:
+ * drain() pops whatever has arrived, keeps the newest sample per joint and
+ * writes it. When the GUI falls behind, a full ring drops new samples (they
+ * are counted in droppedSamples()) rather than stalling the reader; the
+ * capacity covers well over 100 ms of a 1 kHz stream per joint.
+ */
+class TelemetryHub
+{
+public:
+    using ReaderFactory = std::function<std::unique_ptr<TelemetryReader>()>;
+
+    TelemetryHub() = default;
+    ~TelemetryHub() { stop(); }
+
+    TelemetryHub(const TelemetryHub&) = delete;
+    TelemetryHub& operator=(const TelemetryHub&) = delete;
+
+    // Drivers register per protocol; protocols without one are skipped in bind().
+    void registerReader(CommunicationProtocol protocol, ReaderFactory factory);
+
+    // Restarts the readers for the joints currently in 'registry'. Call
+    // after spawning or replacing a robot. Returns how many joints are bound.
+    std::size_t bind(entt::registry& registry);
+
+    // Like bind(), but every joint goes to one reader regardless of its
+    // protocol; used for session playback and simulated sources.
+    std::size_t bindAll(entt::registry& registry, const ReaderFactory& factory);
+
+    // Every drained sample (not only the newest) is also appended here.
+    // Channels are named "<joint>/<quantity>". Pass nullptr to stop.
+    void setRecorder(SessionRecorder* recorder);
+
+    // Stops and joins every reader thread.
+    void stop();
+    // True while reader threads are bound; samples may arrive at any time.
+    bool streaming() const { return !m_streams.empty(); }
+
+    // GUI thread: writes the newest pending sample of every bound joint and
+    // quantity into the working set of its JointStateBuffer. Never blocks.
+    // Returns how many joint positions changed.
+    std::size_t drain();
+
+    std::uint64_t droppedSamples() const;
+    std::int64_t  latestTimestampNs() const { return m_latestNs; }
+
+    static std::int64_t nowNs();
+
+private:
+    static constexpr std::size_t kRingCapacity = 16384;
+    static constexpr std::size_t kReadBatch = 64;
+
+    struct Stream {
+        CommunicationProtocol protocol = CommunicationProtocol::NONE;
+        std::unique_ptr<TelemetryReader> reader;
+        std::vector<TelemetryReader::Endpoint> endpoints;
+        struct Target {
+            std::shared_ptr<JointStateBuffer> buffer;
+            int dof = -1;
+        };
+        std::vector<Target> targets;                 ///< parallel to endpoints
+        std::vector<std::int64_t> lastApplied;       ///< timestamp last written, per (channel, quantity)
+        std::vector<int> recordChannel;              ///< recorder channel per (channel, quantity), -1 unknown
+        SpscRing<JointSample, kRingCapacity> ring;
+        std::atomic<std::uint64_t> dropped{ 0 };
+        std::atomic<bool> running{ false };
+        std::thread thread;
+    };
+
+    std::size_t bindStreams(entt::registry& registry, const ReaderFactory* shared);
+    void record(Stream& stream, const JointSample& sample);
+    static void run(Stream& stream);
+
+    std::unordered_map<CommunicationProtocol, ReaderFactory> m_factories;
+    std::vector<std::unique_ptr<Stream>> m_streams;
+    SessionRecorder* m_recorder = nullptr;
+    std::int64_t m_latestNs = 0;
+};
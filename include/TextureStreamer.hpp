@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <QImage>
+#include <qopengl.h>
+
+class QOpenGLFunctions_4_3_Core;
+
+/**
+ * @class TextureStreamer
+ * @brief Material maps as layers of two texture arrays, decoded on worker
+ *        threads and uploaded a few mips per frame through a PBO ring.
+ *
+ * residency() queues a file on first use. A ThreadPool worker decodes it
+ * (KTX2 with uncompressed RGBA8 levels, or anything QImage reads) into a
+ * full mip chain at the array's layer size; update() takes finished
+ * decodes and uploads levels coarsest first, at most kUploadBytesPerFrame
+ * per call, down to the finest level request() asked for from the map's
+ * screen footprint. A map has no layer until its 1x1 level lands; after
+ * that the shaders clamp sampling to its finest resident level. The
+ * decoded chain stays in memory until the finest level is up.
+ *
+ * Memory: every layer reserves a full chain, so the GPU budget is kept by
+ * the layer size rather than per map: trim() halves it, down to
+ * kMinLayerSize, copying each level one down. Block-compressed or
+ * supercompressed KTX2 (BC7, Basis) would need a transcoder the tree does
+ * not carry: such files warn once and draw as no map.
+ *
+ * GUI thread, except the decodes. The arrays and PBOs live in the share
+ * group, used by every viewport's context.
+ */
+class TextureStreamer
+{
+public:
+    enum class Kind : std::uint8_t { Color, Data, Count };   ///< sRGB albedo maps, linear metal/roughness maps
+
+    struct Residency {
+        GLint layer = -1;            ///< -1 while nothing is resident, or if the file failed
+        float level = 0.0f;          ///< finest resident mip
+    };
+
+    static constexpr GLsizei kLayerSize = 1024;              ///< until the budget shrinks it
+    static constexpr GLsizei kMinLayerSize = 128;
+    static constexpr std::size_t kUploadBytesPerFrame = std::size_t(8) << 20;
+    static constexpr int kMaxDecodes = 4;                    ///< files decoding at once
+    static constexpr int kPboCount = 3;
+
+    explicit TextureStreamer(QOpenGLFunctions_4_3_Core* gl = nullptr);
+    ~TextureStreamer() = default; // GL objects must be freed explicitly via destroy()
+
+    void setFunctions(QOpenGLFunctions_4_3_Core* gl) { m_gl = gl; }
+
+    Residency residency(Kind kind, const std::string& path);
+    // The map covers about 'pixels' on screen this frame: stream it down to
+    // the level that matches. The finest request since it was resident wins.
+    void request(Kind kind, const std::string& path, float pixels);
+    // Takes finished decodes and uploads within the frame's budget. True
+    // when a residency changed, i.e. material records need rebuilding.
+    bool update();
+    bool busy() const;
+    // Halves the layer size until 'bytes' are freed or it reaches
+    // kMinLayerSize. Returns the bytes freed; for a GpuMemory evictor.
+    std::size_t trim(std::size_t bytes);
+
+    GLuint texture(Kind kind) const { return m_arrays[std::size_t(kind)].texture; }
+    GLsizei layerSize() const { return m_layerSize; }
+
+    // Deletes the arrays and PBOs and forgets every map; decodes still
+    // running are dropped. A context of the share group must be current.
+    void destroy();
+
+private:
+    struct Decoded {
+        Kind kind;
+        std::string path;
+        std::vector<QImage> chain;   ///< RGBA8888, bottom row first; [0] is the size it was decoded at; empty: failed
+    };
+    struct Inbox {
+        std::mutex mutex;
+        std::vector<Decoded> done;
+    };
+    struct Map {
+        GLint layer = -1;
+        int resident = -1;           ///< finest uploaded level; -1 none
+        int wanted = 0;              ///< finest level requested
+        bool decoding = false;
+        bool failed = false;
+        std::vector<QImage> chain;
+    };
+    struct LayerArray {
+        GLuint texture = 0;
+        GLsizei capacity = 0;
+        GLsizei count = 0;
+        std::unordered_map<std::string, Map> maps;
+    };
+
+    int levels() const;
+    int levelFor(float pixels) const;
+    void startDecodes();
+    std::size_t arrayBytes(GLsizei layerSize, GLsizei layers) const;
+    void grow(Kind kind);
+    std::size_t shrink();
+
+    QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+    LayerArray m_arrays[std::size_t(Kind::Count)];
+    std::deque<std::pair<Kind, std::string>> m_queued;
+    int m_decoding = 0;
+    std::shared_ptr<Inbox> m_inbox;      ///< shared with the workers, which may outlive destroy()
+    GLsizei m_layerSize = kLayerSize;
+    GLuint m_pbos[kPboCount] = {};
+    int m_nextPbo = 0;
+    bool m_changed = false;              ///< a residency moved outside update()
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief Fixed set of worker threads with per-worker queues and work stealing.
+ *
+ * Each worker pops from the back of its own deque and, when that runs dry,
+ * steals from the front of the others, so uneven tasks (e.g. grid chunks near
+ * dense effectors) balance themselves. Tasks submitted from outside the pool
+ * are dealt round-robin; tasks submitted from a worker stay on that worker.
+ */
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // 0 picks std::thread::hardware_concurrency().
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool(); // drains remaining tasks, then joins
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Task task);
+
+    // Blocks until every submitted task has finished.
+    void waitIdle();
+
+    // Runs body(i) for i in [0, count) on the pool and the calling thread,
+    // returning once all of them are done. Unlike waitIdle() it does not wait
+    // for unrelated work, nor run it: the caller, pool worker or not, only
+    // takes indices of this loop, then waits for the ones already running.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& body);
+
+    unsigned size() const { return static_cast<unsigned>(m_queues.size()); } // complete before any worker starts
+
+    // Process-wide pool sized to the machine, created on first use.
+    static ThreadPool& shared();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(unsigned index);
+    bool runOne(unsigned index);   ///< pops or steals one task and runs it
+    bool tryPop(unsigned index, Task& out);
+    bool trySteal(unsigned thief, Task& out);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;   ///< workers sleep here when all queues are empty
+    std::condition_variable m_idle;   ///< waitIdle() sleeps here
+    std::atomic<std::size_t> m_pending{ 0 }; ///< submitted but not finished
+    std::atomic<std::size_t> m_queued{ 0 };  ///< sitting in a queue, not yet picked up
+    std::atomic<unsigned> m_nextQueue{ 0 };
+    bool m_stopping = false;
+};
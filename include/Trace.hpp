@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QDebug>
+#include <atomic>
+#include <cstdint>
+
+/*------------------------------------------------------------------
+ *  Trace – categorized debug output for the frame loop
+ *
+ *  KR_TRACE(Spline) << "text" << value;
+ *
+ *  Two switches:
+ *   - compile time: KR_TRACE_ENABLED=0 (CMake option KR_ENABLE_TRACE=OFF)
+ *     turns every KR_TRACE into dead code; arguments are still type
+ *     checked but never evaluated.
+ *   - run time: a category mask, loaded from the KR_TRACE environment
+ *     variable ("spline,glow", "all", ...). A disabled category costs
+ *     one relaxed atomic load; the stream operands are not evaluated.
+ *-----------------------------------------------------------------*/
+
+#ifndef KR_TRACE_ENABLED
+#  ifdef NDEBUG
+#    define KR_TRACE_ENABLED 0
+#  else
+#    define KR_TRACE_ENABLED 1
+#  endif
+#endif
+
+namespace Trace
+{
+    enum Category : std::uint32_t
+    {
+        Frame     = 1u << 0,  ///< per-viewport paint / renderView
+        Mesh      = 1u << 1,
+        Spline    = 1u << 2,
+        FieldViz  = 1u << 3,
+        Glow      = 1u << 4,
+        Lifecycle = 1u << 5,  ///< per-context resource creation
+        All       = 0xFFFFFFFFu
+    };
+
+    inline std::atomic<std::uint32_t>& maskStorage()
+    {
+        static std::atomic<std::uint32_t> mask{ 0 };
+        return mask;
+    }
+
+    inline bool enabled(Category c)
+    {
+        return (maskStorage().load(std::memory_order_relaxed) & c) != 0;
+    }
+
+    inline void setMask(std::uint32_t mask) { maskStorage().store(mask, std::memory_order_relaxed); }
+    inline std::uint32_t mask() { return maskStorage().load(std::memory_order_relaxed); }
+
+    // Parses a comma separated list of category names (case-insensitive).
+    std::uint32_t parseMask(const QByteArray& spec);
+
+    // Reads KR_TRACE from the environment; call once from main().
+    void initFromEnvironment();
+}
+
+// The if/else form keeps the macro a single statement and skips the stream
+// expression entirely when the category is off.
+#if KR_TRACE_ENABLED
+#  define KR_TRACE(category) \
+    if (!::Trace::enabled(::Trace::category)) {} else qDebug()
+#else
+#  define KR_TRACE(category) \
+    if (true) {} else qDebug()
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+class QJsonArray;
+class QString;
+
+/*------------------------------------------------------------------
+ *  TraceZones – timed scopes for whole-application traces
+ *
+ *  void TelemetryHub::drain() { KR_ZONE("telemetry drain"); ... }
+ *
+ *  While a capture runs, every zone that closes appends one complete
+ *  event (name, start, duration) to a fixed buffer owned by its
+ *  thread: no lock, no allocation after the thread's first event.
+ *  Outside a capture a zone costs one relaxed atomic load. A full
+ *  buffer drops further events of that thread and counts them.
+ *
+ *  Names must outlive the capture: string literals, or intern() for
+ *  names built at run time.
+ *
+ *  Captures are written as Chrome trace JSON, which Perfetto opens
+ *  directly and Tracy imports (import-chrome). RenderingSystem's F4
+ *  capture merges these tracks with its per-pass GPU times; both use
+ *  nowUs() as their clock.
+ *
+ *  Compile time: KR_ZONES_ENABLED=0 (CMake option KR_ENABLE_ZONES=OFF)
+ *  turns every KR_ZONE into nothing.
+ *-----------------------------------------------------------------*/
+
+#ifndef KR_ZONES_ENABLED
+#  define KR_ZONES_ENABLED 1
+#endif
+
+namespace TraceZones
+{
+    inline std::atomic<bool>& capturingFlag()
+    {
+        static std::atomic<bool> on{ false };
+        return on;
+    }
+
+    inline bool capturing() { return capturingFlag().load(std::memory_order_relaxed); }
+
+    // Starting discards the events of the previous capture.
+    void start();
+    void stop();
+
+    // Microseconds since the first call, on the steady clock.
+    double nowUs();
+
+    // Names the calling thread's track; call once when the thread starts.
+    void setThreadName(const std::string& name);
+    // A stable copy of 'name' for use as a zone name.
+    const char* intern(const std::string& name);
+
+    void record(const char* name, double beginUs, double endUs);
+
+    // Appends the captured events, one track per thread, with process id 1.
+    void appendChromeEvents(QJsonArray& events);
+    bool writeChromeTrace(const QString& path);
+    // Events lost to full buffers during the last capture.
+    std::uint64_t droppedEvents();
+
+    class Zone
+    {
+    public:
+        explicit Zone(const char* name) : m_name(capturing() ? name : nullptr)
+        {
+            if (m_name) m_beginUs = nowUs();
+        }
+        ~Zone()
+        {
+            if (m_name) record(m_name, m_beginUs, nowUs());
+        }
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        const char* m_name;
+        double m_beginUs = 0.0;
+    };
+}
+
+#define KR_ZONE_CONCAT_(a, b) a##b
+#define KR_ZONE_CONCAT(a, b) KR_ZONE_CONCAT_(a, b)
+
+#if KR_ZONES_ENABLED
+#  define KR_ZONE(name) ::TraceZones::Zone KR_ZONE_CONCAT(krZone_, __LINE__)(name)
+#else
+#  define KR_ZONE(name) static_cast<void>(0)
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class RigidBodyDynamics;
+
+/**
+ * @brief The fastest timing of a joint-space path within the joints'
+ *        velocity and effort limits (TOPP-RA).
+ *
+ * compute() takes a piecewise-linear path, e.g. one from MotionPlanner, and
+ * lays a grid over each segment at most Settings::gridStep apart. Segment s
+ * runs at path speed sd, with x = sd^2 and u = sdd. Along a segment the
+ * joint torques are affine in (u, x):
+ *
+ *     tau = a(s) u + b(s) x + c(s),   a = M q',  b = C(q, q') q',  c = g
+ *
+ * a, b and c come from three RigidBodyDynamics::inverseDynamics() calls
+ * per grid point. A joint's velocity limit bounds x by (v / |q'|)^2. Its
+ * effort limit bounds the torque to +-limit. A joint with no effort limit is
+ * bounded by Settings::defaultAcceleration instead.
+ *
+ * A backward pass finds, at every grid point, the interval of x from which
+ * the rest of the segment can still stop at its end (the controllable set).
+ * A forward pass then takes, at every point, the largest u that stays in the
+ * next point's set. Each step is a two-variable linear program. It is solved
+ * exactly by eliminating u, so the cost is linear in the number of grid
+ * points.
+ *
+ * The robot stops at every interior waypoint. The path's direction changes
+ * there, and passing a corner at speed needs unbounded acceleration.
+ * Velocity limits of 0 fall back to Settings::defaultVelocity.
+ */
+struct TrajectoryTiming
+{
+    struct Settings {
+        double gridStep = 0.01;               ///< largest joint move between grid points
+        double defaultVelocity = 1.0;         ///< rad/s (m/s) where a joint has no velocity limit
+        double defaultAcceleration = 5.0;     ///< rad/s^2 (m/s^2) where a joint has no effort limit
+        bool useDynamics = true;              ///< false: defaultAcceleration for every joint
+    };
+
+    std::size_t dofs = 0;
+    std::vector<double> q;                    ///< grid points x dofs, row-major
+    std::vector<double> time;                 ///< seconds from the start, per grid point
+    std::vector<double> speed;                ///< path speed sd per grid point
+    double duration = 0.0;
+    std::size_t velocityLimited = 0;          ///< grid points at their velocity bound
+    std::string error;                        ///< why compute() failed; empty on success
+
+    // 'path' holds waypoints of dynamics.dofCount() values each. Fails
+    // where the limits cannot hold the robot at all, e.g. an effort limit
+    // below the gravity load.
+    static TrajectoryTiming compute(RigidBodyDynamics& dynamics, const std::vector<double>& path,
+        const Settings& settings);
+
+    bool empty() const { return time.empty(); }
+    // The configuration 'seconds' into the trajectory, linear between grid
+    // points and clamped to its ends. The static form samples any timed
+    // waypoints, e.g. a TrajectoryPlaybackComponent's.
+    void sample(double seconds, double* out) const { sample(q, time, dofs, seconds, out); }
+    static void sample(const std::vector<double>& q, const std::vector<double>& time, std::size_t dofs,
+        double seconds, double* out);
+};
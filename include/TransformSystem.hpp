@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include <entt/fwd.hpp>
+
+namespace TransformSystem
+{
+    // Writes WorldTransformComponent for every entity reachable from a root
+    // (TransformComponent without ParentComponent) through ParentComponent
+    // links. Entities are kept in a cached depth-first order, so one linear
+    // pass suffices; only subtrees whose local transform changed since the
+    // last call are recomputed. Independent root subtrees (one robot, one
+    // camera rig) are spread over ThreadPool::shared() when the scene is
+    // large enough. Returns how many world matrices changed.
+    std::size_t propagate(entt::registry& registry);
+
+    // World matrices as of the last propagate(), contiguous and parallel to
+    // hierarchyOrder(). WorldTransformComponent mirrors the same values.
+    const std::vector<glm::mat4>& worldMatrices(entt::registry& registry);
+    const std::vector<entt::entity>& hierarchyOrder(entt::registry& registry);
+
+    // Forces the hierarchy order to be rebuilt on the next propagate(), e.g.
+    // after editing ParentComponent::parent in place.
+    void invalidateHierarchy(entt::registry& registry);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+struct TriangleGpu;
+struct BvhNodeGpu;
+
+// Flattened bounding volume hierarchy over mesh-effector triangles, built on
+// the CPU and traversed by the field compute shaders.
+namespace TriangleBvh
+{
+    // Triangles per leaf; small enough that leaves are cheap, large enough
+    // to keep the tree shallow.
+    constexpr int kLeafSize = 4;
+
+    // Deepest level below the root; nodes there are leaves whatever their
+    // count. The shaders size their traversal stack from it (kBvhMaxDepth in
+    // mesh_effector_field.glsl). Median splits reach it only past 2^32 leaves.
+    constexpr int kMaxDepth = 32;
+
+    // Builds the tree and reorders 'triangles' into leaf order. Node bounds
+    // are inflated by each triangle's influence radius (normal.w), so a
+    // sample only has to visit nodes whose box contains it. Children of an
+    // inner node are stored adjacently at leftOrFirst and leftOrFirst + 1.
+    void build(std::vector<TriangleGpu>& triangles, std::vector<BvhNodeGpu>& nodes);
+}
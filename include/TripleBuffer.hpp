@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class TripleBuffer
+ * @brief Wait-free latest-value handoff from one writer thread to one reader thread.
+ *
+ * Three copies of T: the writer fills its private back buffer and publish()
+ * swaps it with the shared middle slot; the reader's update() swaps the middle
+ * slot with its front buffer when something new was published. Neither side
+ * ever waits for the other, and the reader always sees a complete value. Only
+ * the newest value survives, which is what setpoints and statistics want.
+ *
+ * The back buffer holds whatever the reader last discarded, not the previous
+ * publish, so the writer must fill it completely before each publish().
+ */
+template<class T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T& initial) : m_slots{ initial, initial, initial } {}
+
+    // Writer side.
+    T& back() { return m_slots[m_back]; }
+    void publish()
+    {
+        const std::uint8_t old = m_middle.exchange(std::uint8_t(m_back | kFresh), std::memory_order_acq_rel);
+        m_back = old & kIndexMask;
+    }
+
+    // Reader side. Returns true if front() changed.
+    bool update()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & kFresh)) return false;
+        const std::uint8_t old = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = old & kIndexMask;
+        return true;
+    }
+    const T& front() const { return m_slots[m_front]; }
+
+    // Only while neither thread is using the buffer (e.g. before it starts).
+    T& slot(int i) { return m_slots[i]; }
+
+private:
+    static constexpr std::uint8_t kFresh = 0x4;
+    static constexpr std::uint8_t kIndexMask = 0x3;
+
+    T m_slots[3]{};
+    std::uint8_t m_back = 0;                 ///< writer only
+    std::uint8_t m_front = 1;                ///< reader only
+    std::atomic<std::uint8_t> m_middle{ 2 };  ///< index, plus kFresh once published
+};
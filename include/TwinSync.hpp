@@ -0,0 +1,248 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QObject>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class QByteArray;
+class QTimer;
+class QUdpSocket;
+
+/**
+ * Digital-twin replication over UDP, little-endian. Every datagram starts
+ * with a PacketHeader. A publisher sends State packets each tick; a mirror
+ * answers with Ack packets that also carry its interest region.
+ *
+ * A State packet is a list of records, one per entity:
+ *
+ *   varint netId, uint8 mask, then for each set bit in mask order:
+ *     kIdentity   uint8 length + key ("<tag>#<n>", see entityKeys())
+ *     kTransform  int32 translation[3] (kPositionStep), uint8 largest,
+ *                 int16 smallestThree[3] (kRotationScale)
+ *     kScale      float scale[3], only when not 1 (a transform without it is unscaled)
+ *     kJoints     uint8 count + int32 position[count] (kJointStep)
+ *
+ * Values are absolute, so a record can be applied on its own and in any
+ * order; the delta is in what is sent, not how. All packets of one tick
+ * together hold everything that changed after 'baseTick'.
+ */
+namespace TwinSyncFormat
+{
+    constexpr std::uint32_t kMagic = 0x5754524Bu;          // "KRTW"
+    constexpr std::uint16_t kVersion = 1;
+    constexpr quint16 kDefaultPort = 47800;
+    constexpr int kMaxPacketBytes = 1200;                  ///< below any plant network's MTU
+
+    enum PacketType : std::uint8_t { kState = 1, kAck = 2 };
+    enum PacketFlags : std::uint8_t { kPartial = 1 };      ///< the tick did not fit; more follows next tick
+
+    enum ComponentBits : std::uint8_t {
+        kIdentity = 1, kTransform = 2, kScale = 4, kJoints = 8,
+    };
+
+    constexpr float  kPositionStep = 1e-5f;                ///< 10 um, +-21 km range
+    constexpr float  kRotationScale = 32767.0f * 1.41421356f;
+    constexpr double kJointStep = 1e-6;                    ///< rad or m
+
+#pragma pack(push, 1)
+    struct PacketHeader {                                  ///< 24 bytes
+        std::uint32_t magic = kMagic;
+        std::uint16_t version = kVersion;
+        std::uint8_t  type = kState;
+        std::uint8_t  flags = 0;
+        std::uint32_t session = 0;                         ///< publisher run; a change resets mirrors
+        std::uint32_t tick = 0;                            ///< State: this tick. Ack: newest complete tick
+        std::uint32_t baseTick = 0;                        ///< State: the receiver's ack it was built against
+        std::uint16_t packetIndex = 0;
+        std::uint16_t packetCount = 1;
+    };
+    struct AckPayload {
+        float center[3] = {};
+        float radius = 0.0f;                               ///< 0 = everything
+    };
+#pragma pack(pop)
+
+    struct Transform {
+        std::int32_t  translation[3] = {};
+        std::uint8_t  largest = 0;
+        std::int16_t  smallest[3] = {};
+        float         scale[3] = { 1.0f, 1.0f, 1.0f };
+        bool operator==(const Transform& o) const;
+        bool operator!=(const Transform& o) const { return !(*this == o); }
+        bool scaled() const { return scale[0] != 1.0f || scale[1] != 1.0f || scale[2] != 1.0f; }
+    };
+
+    Transform quantize(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+    void dequantize(const Transform& q, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale);
+
+    // Stable cross-workstation names for the replicated entities: tagged
+    // entities with a TransformComponent, except cameras and robot links
+    // other than the root (the root carries the joints). Duplicate tags are
+    // numbered in entity order, so two workstations that built the scene the
+    // same way agree on every key. Creating and destroying entities is not
+    // replicated: both sides load the same scene.
+    std::vector<std::pair<std::string, entt::entity>> entityKeys(entt::registry& registry);
+}
+
+/**
+ * @class TwinPublisher
+ * @brief Sends this scene's live state to mirrors, each only what it lacks.
+ *
+ * Every tick the replicated entities are quantized and compared with the
+ * previous tick; a component whose quantized value moved is stamped with
+ * the tick. A mirror is sent, per tick, the components stamped after the
+ * last tick it acknowledged, for the entities in its interest region
+ * (robots always). Lost packets are therefore resent until acknowledged
+ * without a per-mirror copy of the scene, and an idle scene costs one empty
+ * packet per mirror per tick. Mirrors register by acknowledging and are
+ * forgotten after kPeerTimeoutMs of silence.
+ *
+ * GUI thread: reads the registry from its own timer.
+ */
+class TwinPublisher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kTickHz = 30;
+    static constexpr int kPeerTimeoutMs = 3000;
+    static constexpr int kKeyRefreshMs = 1000;             ///< picks up created and renamed entities
+    static constexpr int kMaxPacketsPerTick = 64;
+
+    TwinPublisher(entt::registry& registry, QObject* parent = nullptr);
+    ~TwinPublisher() override;
+
+    bool start(quint16 port = TwinSyncFormat::kDefaultPort);
+    void stop();
+    bool running() const;
+    int mirrorCount() const { return int(m_peers.size()); }
+
+signals:
+    void mirrorsChanged(int count);
+
+private:
+    struct Replica {
+        std::string key;
+        entt::entity entity = entt::null;
+        std::uint32_t identityTick = 0;
+        std::uint32_t transformTick = 0;
+        std::uint32_t jointsTick = 0;
+        bool alive = true;                                 ///< false once the key disappeared
+        TwinSyncFormat::Transform transform;
+        std::vector<std::int32_t> joints;
+        bool robot = false;
+        glm::vec3 position{ 0.0f };                        ///< world, for interest
+    };
+    struct Peer {
+        QHostAddress address;
+        quint16 port = 0;
+        std::uint32_t acked = 0;
+        glm::vec3 center{ 0.0f };
+        float radius = 0.0f;
+        qint64 lastSeenMs = 0;
+        std::vector<std::uint32_t> entered;                ///< by netId: tick it entered the region, 0 = outside
+    };
+
+    void tick();
+    void refreshKeys();
+    void sample();
+    void sendTo(Peer& peer);
+    void readAcks();
+
+    entt::registry& m_registry;
+    QUdpSocket* m_socket = nullptr;
+    QTimer* m_timer = nullptr;
+    QElapsedTimer m_clock;
+    qint64 m_keysRefreshedMs = -kKeyRefreshMs;
+    std::uint32_t m_session = 0;
+    std::uint32_t m_tick = 0;
+    std::vector<Replica> m_replicas;                       ///< index = netId
+    std::unordered_map<std::string, std::uint32_t> m_netIds;
+    std::vector<Peer> m_peers;
+};
+
+/**
+ * @class TwinMirror
+ * @brief Applies a publisher's stream to the local copy of the same scene.
+ *
+ * Records are applied as they arrive, newest tick wins per entity, by
+ * patching TransformComponent and writing the robot's JointStateBuffer;
+ * KinematicSystem then poses the links as for live telemetry. Keys resolve
+ * to local entities through TwinSyncFormat::entityKeys(), so the mirror
+ * must have loaded the same scene; unknown keys are skipped. The newest
+ * tick received completely is acknowledged at kAckHz together with the
+ * interest region from the provider (typically the camera position).
+ */
+class TwinMirror : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kAckHz = 10;
+    static constexpr int kResolveRetryMs = 1000;
+
+    struct Interest {
+        glm::vec3 center{ 0.0f };
+        float radius = 0.0f;                               ///< 0 = everything
+    };
+    using InterestProvider = std::function<Interest()>;
+
+    TwinMirror(entt::registry& registry, QObject* parent = nullptr);
+    ~TwinMirror() override;
+
+    bool start(const QHostAddress& publisher, quint16 port = TwinSyncFormat::kDefaultPort);
+    void stop();
+    bool running() const;
+    void setInterestProvider(InterestProvider provider) { m_interest = std::move(provider); }
+
+    std::uint32_t completeTick() const { return m_complete; }
+
+signals:
+    void sceneUpdated();                                   ///< something was applied
+    void connectedChanged(bool connected);
+
+private:
+    struct Incoming {
+        std::uint32_t baseTick = 0;
+        std::vector<bool> received;
+        int missing = 0;
+        bool partial = false;
+    };
+    struct Remote {
+        std::string key;
+        entt::entity entity = entt::null;
+        std::uint32_t appliedTick = 0;
+    };
+
+    void readState();
+    bool applyPacket(const QByteArray& datagram);
+    bool applyRecords(const char* data, int size, std::uint32_t tick);
+    entt::entity resolve(Remote& remote);
+    void sendAck();
+    void reset(std::uint32_t session);
+
+    entt::registry& m_registry;
+    QUdpSocket* m_socket = nullptr;
+    QTimer* m_ackTimer = nullptr;
+    QHostAddress m_publisher;
+    quint16 m_port = 0;
+    InterestProvider m_interest;
+    QElapsedTimer m_clock;
+    qint64 m_lastPacketMs = -1;
+    qint64 m_keysResolvedMs = -kResolveRetryMs;
+
+    std::uint32_t m_session = 0;
+    std::uint32_t m_complete = 0;
+    std::unordered_map<std::uint32_t, Incoming> m_incoming;   ///< by tick, newer than m_complete
+    std::vector<Remote> m_remotes;                            ///< index = netId
+    std::unordered_map<std::string, entt::entity> m_localKeys;
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <entt/entt.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/**
+ * @class UndoStack
+ * @brief Undo/redo for in-place component edits, stored as compact deltas.
+ *
+ * An edit opens a Scope, names the components it is about to change and then
+ * mutates them as before. Each tracked component is encoded on entry and
+ * again when the scope closes, covering only its user-editable fields (no
+ * caches or GPU state). The step keeps just the byte runs that differ,
+ * XOR-ed so one copy serves undo and redo, plus the tail of a field list
+ * that changed length. Steps live in a fixed-size ring arena and the oldest
+ * are dropped when it fills, so memory is bounded however long the session
+ * runs, and undo/redo costs the size of the touched components regardless
+ * of how big the scene is.
+ *
+ * Consecutive edits with the same label within a short window merge into
+ * one step, so a spin box or slider drag undoes as a whole. Creating and
+ * destroying entities is not recorded; steps naming an entity that no longer
+ * exists skip it. Changing a tracked field outside a Scope leaves the history
+ * unaware of it; undo only restores what was recorded. Supported components:
+ * Transform, FieldVisualizer, Grid, Material and Tag.
+ */
+class UndoStack
+{
+public:
+    /// Records everything tracked between construction and destruction as one
+    /// step. Scopes nest; the outermost one commits.
+    class Scope
+    {
+    public:
+        Scope(UndoStack& stack, entt::registry& registry, const char* label);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        // Call before changing the components.
+        template <class... C> Scope& track(entt::entity entity)
+        {
+            (m_stack.track(m_registry, entity, entt::type_hash<C>::value()), ...);
+            return *this;
+        }
+
+    private:
+        UndoStack& m_stack;
+        entt::registry& m_registry;
+    };
+
+    explicit UndoStack(std::size_t arenaBytes = std::size_t(1) << 20);
+
+    bool canUndo() const { return m_cursor > 0; }
+    bool canRedo() const { return m_cursor < m_steps.size(); }
+    std::string undoLabel() const { return canUndo() ? m_steps[m_cursor - 1].label : std::string(); }
+    std::string redoLabel() const { return canRedo() ? m_steps[m_cursor].label : std::string(); }
+
+    // Apply one step. Components are written with registry.replace(), so
+    // on_update observers see the change. False if there was nothing to do.
+    bool undo(entt::registry& registry);
+    bool redo(entt::registry& registry);
+    void clear();
+
+    std::size_t bytesUsed() const;
+    std::size_t capacity() const { return m_arena.size(); }
+
+private:
+    using Bytes = std::vector<std::byte>;
+    using Clock = std::chrono::steady_clock;
+
+    struct Pending {
+        entt::entity entity;
+        entt::id_type type;
+        Bytes before, after;
+        bool present = false;               ///< 'after' was taken: the component still exists
+    };
+    struct Step {
+        std::size_t offset = 0, size = 0;   ///< record bytes in the arena
+        std::string label;
+        Clock::time_point lastEdit;         ///< for merging
+    };
+
+    void begin(const char* label);
+    void end(entt::registry& registry);
+    void track(entt::registry& registry, entt::entity entity, entt::id_type type);
+    bool mergeIntoTop(Clock::time_point now);
+    void push(const Bytes& record, Clock::time_point now);
+    bool apply(entt::registry& registry, const Step& step, bool forward);
+
+    std::vector<std::byte> m_arena;
+    std::deque<Step> m_steps;               ///< oldest first, in arena order
+    std::size_t m_cursor = 0;               ///< steps before it are applied, the rest can be redone
+
+    int m_depth = 0;
+    std::string m_label;
+    std::vector<Pending> m_pending;
+    Bytes m_record, m_image, m_scratch;     ///< reused between edits
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+class QByteArray;
+class QImage;
+
+/**
+ * @class VideoEncoder
+ * @brief Pipes rendered frames into an ffmpeg process as raw video.
+ *
+ * Encoding runs out of process, so the codec is whatever the local ffmpeg
+ * build offers: h264_nvenc / hevc_nvenc, h264_qsv or h264_amf use the GPU's
+ * encoder block, libx264 is the software fallback. Pairs with
+ * OffscreenRenderer's frame sink; every frame must have the size given to
+ * open(). write() blocks once a few frames are buffered in the pipe, so a
+ * slow encoder throttles rendering instead of growing memory; a live source
+ * checks ready() first and skips the frame instead.
+ *
+ * With Settings::output set, ffmpeg writes to its stdout and the encoded
+ * bytes are handed to the callback on the GUI thread as they arrive; the
+ * container then has to be named in 'format' (e.g. fragmented "mp4").
+ */
+class VideoEncoder
+{
+public:
+    struct Settings {
+        QString path;                     ///< output file, container chosen by extension
+        int width = 0, height = 0;
+        int fps = 60;
+        QString codec = QStringLiteral("h264_nvenc");
+        QString program = QStringLiteral("ffmpeg");
+        QStringList extraArgs;            ///< e.g. { "-b:v", "20M" }, placed before the output
+        QString format;                   ///< forced container (-f); required with 'output'
+        std::function<void(const QByteArray&)> output;   ///< replaces 'path' with a stream
+    };
+
+    ~VideoEncoder();
+
+    bool open(const Settings& settings);
+    bool write(const QImage& frame);
+    // Ends the stream and waits for ffmpeg. True if it exited cleanly.
+    bool close();
+    // Kills ffmpeg without flushing, for a live stream that is being replaced.
+    void abort();
+
+    // True when write() would return without waiting for the encoder.
+    bool ready() const;
+
+    bool isOpen() const { return m_process.state() != QProcess::NotRunning; }
+    QString errorString() const;
+
+private:
+    static constexpr int kBufferedFrames = 2;
+
+    Settings m_settings;
+    QProcess m_process;
+    QMetaObject::Connection m_outputConnection;
+};
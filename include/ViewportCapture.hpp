@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <qopengl.h>
+
+#include <cstdint>
+#include <functional>
+
+class QImage;
+class QOpenGLFunctions_4_3_Core;
+
+/**
+ * @class ViewportCapture
+ * @brief Reads a live viewport's composite image back without stalling it.
+ *
+ * The viewport calls capture() at the end of its paint, with its context
+ * current. The read goes into a ring of fenced pixel-pack buffers and is
+ * mapped on a later paint (or collect()) once the GPU is done, so the frame
+ * loop never waits on it. Unlike OffscreenRenderer, which must not lose a
+ * frame, this is for live consumers: a paint that finds the ring full, or
+ * that comes sooner than setMaxRate() allows, is simply not captured, and
+ * when several reads have landed only the newest reaches the sink.
+ *
+ * Frames are RGBX8888, top row first, cropped to even dimensions for
+ * 4:2:0 video encoders.
+ */
+class ViewportCapture
+{
+public:
+    using FrameSink = std::function<void(const QImage& frame)>;
+
+    ViewportCapture() = default;
+    ViewportCapture(const ViewportCapture&) = delete;
+    ViewportCapture& operator=(const ViewportCapture&) = delete;
+
+    void setFrameSink(FrameSink sink) { m_sink = std::move(sink); }
+    void setMaxRate(int framesPerSecond) { m_minIntervalMs = framesPerSecond > 0 ? 1000 / framesPerSecond : 0; }
+
+    // GL thread, context current. Hands over whatever has landed, then
+    // queues a read of 'fbo' if a slot is free; leaves 'fbo' bound for reading.
+    void capture(QOpenGLFunctions_4_3_Core& gl, GLuint fbo, int width, int height);
+    // GL thread, context current. Hands over landed reads without queuing one.
+    void collect(QOpenGLFunctions_4_3_Core& gl);
+    bool pending() const { return m_pending > 0; }
+    // Deletes the buffers; the context they were created in must be current.
+    void release(QOpenGLFunctions_4_3_Core& gl);
+
+    std::uint64_t skipped() const { return m_skipped; }   ///< paints not captured because the ring was full
+
+private:
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        int width = 0, height = 0;
+        GLsizeiptr capacity = 0;
+    };
+    static constexpr int kSlots = 3;
+
+    FrameSink m_sink;
+    Slot m_slots[kSlots];
+    int m_head = 0;                   ///< slot that receives the next read
+    int m_pending = 0;                ///< queued slots, oldest at m_head - m_pending
+    int m_minIntervalMs = 0;
+    QElapsedTimer m_sinceCapture;
+    std::uint64_t m_skipped = 0;
+};
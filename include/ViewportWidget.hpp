@@ -1,8 +1,14 @@
 #pragma once
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions_4_3_Core>
+#include <QElapsedTimer>
 #include <memory>
+#include <vector>
+#include <glm/glm.hpp>
 #include <entt/fwd.hpp>
+#include "IntersectionSystem.hpp"
+
+class QTimer;
 
 class Scene;
 class Camera;
@@ -13,7 +19,10 @@ class QMouseEvent;
 class QWheelEvent;
 class QKeyEvent;
 class QCloseEvent;
+class QFocusEvent;
 class QPoint;
+class ViewportCapture;
+class PerfHud;
 
 class QOpenGLDebugLogger; // Forward declaration
 class QOpenGLDebugMessage; // Forward declaration
@@ -33,6 +42,21 @@ public:
     void setRenderingSystem(RenderingSystem* system);
     static void propagateTransforms(entt::registry& r);
 
+    // True when the camera moved or has navigation input waiting, the widget
+    // was resized or a redraw was requested since the last paintGL. The
+    // master loop uses this to skip viewports whose image would be identical
+    // to the previous frame.
+    bool needsRedraw();
+    void requestRedraw();
+
+    // Reads the composite image back into 'tap' at the end of every paint;
+    // nullptr stops and frees the previous tap's buffers.
+    void setFrameTap(ViewportCapture* tap);
+    // Hands over reads still in flight when no further paint is coming.
+    void pollFrameTap();
+    // Drawn over the image instead of the F3 overlay while visible (F6).
+    void setPerfHud(PerfHud* hud) { m_perfHud = hud; }
+
 protected:
     void initializeGL() override;
     void paintGL() override;
@@ -42,6 +66,8 @@ protected:
     void mouseMoveEvent(QMouseEvent* event) override;
     void wheelEvent(QWheelEvent* event) override;
     void keyPressEvent(QKeyEvent* event) override;
+    void keyReleaseEvent(QKeyEvent* event) override;
+    void focusOutEvent(QFocusEvent* event) override;
     void mouseReleaseEvent(QMouseEvent* ev) override;
     void mouseDoubleClickEvent(QMouseEvent* ev) override;
 
@@ -52,6 +78,9 @@ public slots:
     void handleLoggedMessage(const QOpenGLDebugMessage& debugMessage);
     void renderNow();
 private:
+    // The camera's matrices at the framebuffer's device-pixel aspect, the
+    // one renderView draws with.
+    glm::mat4 currentViewProj();
 
     Scene* m_scene;
     entt::entity m_cameraEntity;
@@ -65,11 +94,65 @@ private:
     int m_instanceId; // Add this
     static int s_instanceCounter; // Add this
 
-    static void updateAnimations(entt::registry& registry, float frameDt);
-
     bool m_hasSignaledReady = false;
 
+    /* --- frame pacing --- */
+    glm::mat4 m_lastViewProj{ 0.0f };   ///< camera matrices used by the last paint
+    bool      m_forceRedraw = true;
+    GLsync    m_frameFence = nullptr;   ///< fenced after each renderNow(); bounds CPU run-ahead to one frame
+    QTimer*   m_refineTimer = nullptr;  ///< redraws at full resolution once a scaled-down view is idle
+    ViewportCapture* m_frameTap = nullptr;
+    PerfHud*  m_perfHud = nullptr;      ///< shared with the other viewports, owned by MainWindow
+
+    /* --- navigation input --- */
+    // Mouse and key events only record what happened; paintGL applies it to
+    // the camera once, right before rendering, with the real time since the
+    // previous frame. Speed no longer follows the OS key-repeat or mouse
+    // event rate, and a burst of events costs one camera update, not one
+    // repaint request each.
+    enum NavKey : unsigned { KeyForward = 1, KeyBackward = 2, KeyLeft = 4, KeyRight = 8, KeyUp = 16, KeyDown = 32 };
+    static unsigned navKeyOf(int key);
+    bool hasPendingInput() const;
+    void applyInput();
+    unsigned      m_heldKeys = 0;       ///< NavKey bits
+    glm::vec2     m_lookDelta{ 0.0f };  ///< pixels since the last frame, per gesture
+    glm::vec2     m_orbitDelta{ 0.0f };
+    glm::vec2     m_panDelta{ 0.0f };
+    float         m_dollyDelta = 0.0f;  ///< wheel angle
+    QElapsedTimer m_inputClock;         ///< since the last applyInput() with keys held
+
+    /* --- ID-buffer picking --- */
+    bool m_pickPending = false;         ///< a click is waiting for its ID-buffer read
+    void applyPickResult();
+    void drawProfilerOverlay();          ///< F3: per-pass GPU/CPU timings of this viewport
+
+    /* --- end-effector drag --- */
+    // Ctrl + left drag on a robot moves its end effector: the tip follows
+    // the cursor across the plane through it facing the camera, and
+    // KinematicSystem::solveEndEffector() finds the joints, warm-started
+    // from the previous move's solution.
+    bool beginEndEffectorDrag(const QPoint& pos);
+    void dragEndEffector(const QPoint& pos);
+    entt::entity m_dragRobot = entt::null;     ///< null when not dragging
+    int       m_dragLink = -1;
+    glm::vec3 m_dragPlanePoint{ 0.0f };
+
+    /* --- measuring --- */
+    // M toggles it. Mouse moves only record the cursor; paintGL snaps it
+    // once per frame (and again when the camera moved), so a burst of moves
+    // over a big mesh costs one BVH query. Left clicks drop the snapped
+    // point, Esc clears the points.
+    void updateSnap();
+    void drawMeasureOverlay();
+    bool      m_measuring = false;
+    bool      m_snapPending = false;
+    QPoint    m_snapCursor;
+    glm::mat4 m_snapViewProj{ 0.0f };   ///< camera the current snap was found with
+    IntersectionSystem::Snap m_snap;
+    std::vector<glm::vec3> m_measurePoints;
+
 signals: // <<< ADD THIS SECTION
     void viewportReady();
     void glContextReady();
+    void sceneEdited();        ///< user input changed shared scene state (e.g. selection)
 };
\ No newline at end of file
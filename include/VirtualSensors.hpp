@@ -0,0 +1,146 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <entt/fwd.hpp>
+#include <glm/glm.hpp>
+#include <qopengl.h>
+
+#include "components.hpp"
+#include "SensorStream.hpp"
+
+class QOpenGLFunctions_4_3_Core;
+class GLStateCache;
+class SensorBuffers;
+class Shader;
+
+/**
+ * @class VirtualSensors
+ * @brief Depth cameras and spinning LiDARs (VirtualSensorComponent)
+ *        rendered from the scene's meshes into their GPU-fed streams.
+ *
+ * Once per tick, plan() works out which views are due: a camera renders a
+ * frame when its frame rate says so, a LiDAR the 90-degree faces of a cube
+ * around it that its beams swept since the last tick. Every due view of
+ * every sensor is a layer of one depth texture array. render() draws all
+ * casters once per kViewsPerPass views: a geometry shader instanced per
+ * view picks the layer and viewport and drops triangles outside that view,
+ * so eight sensors cost one submission of the scene, not eight.
+ *
+ * pack() then turns the layers into SensorPoints in each stream's ring with
+ * one compute dispatch per sensor: a pixel per camera point, and for a
+ * LiDAR each (column, beam) ray looked up in its face. Rays that hit
+ * nothing within range are written too, already expired, so the ring
+ * advances by a known count and nothing is read back to place the points;
+ * the sensor point pass and the reconstruction skip them like ring padding.
+ *
+ * Sensors with a sink get their points copied into fenced readback
+ * buffers, delivered in order by a later plan() without waiting.
+ *
+ * Back faces are culled, so a mount inside its link's mesh sees out of it.
+ */
+class VirtualSensors
+{
+public:
+    static constexpr int kViewsPerPass = 16;        ///< GL_MAX_VIEWPORTS is at least 16
+    static constexpr int kMaxViews = 64;            ///< per tick; sensors past it wait a tick
+    static constexpr int kMaxLayerSize = 2048;
+    static constexpr std::size_t kMaxReadbacks = 16; ///< in flight; sinks miss points beyond it
+
+    void setFunctions(QOpenGLFunctions_4_3_Core* gl) { m_gl = gl; }
+
+    // Once per tick: delivers finished readbacks and plans this tick's
+    // views. False if nothing renders this tick. 'buffers' must have been
+    // updated this tick.
+    bool plan(entt::registry& registry, SensorBuffers& buffers, std::uint64_t tick);
+    // Whether a box is within range of a sensor planned this tick.
+    bool reaches(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+    // Draws the planned views, kViewsPerPass per call of 'drawCasters',
+    // which issues every caster through the arena VAO with 'depthShader'
+    // bound. Standard depth; leaves its framebuffer and viewports bound.
+    void render(GLStateCache& state, Shader& depthShader, const std::function<void()>& drawCasters);
+    // Writes the planned views' points into the streams' rings and
+    // publishes them; they draw from the next tick on.
+    void pack(GLStateCache& state, Shader& packShader, SensorBuffers& buffers);
+
+    // Readbacks in flight.
+    bool busy() const { return !m_inFlight.empty(); }
+
+    void destroy();
+
+private:
+    struct View {
+        glm::mat4 viewProjection{ 1.0f };
+        int width = 0, height = 0;
+    };
+
+    // One planned sensor: its views are m_views[firstView, firstView + views).
+    struct Job {
+        entt::entity entity = entt::null;
+        std::shared_ptr<SensorStream> stream;
+        VirtualSensorComponent::Kind kind = VirtualSensorComponent::Kind::Lidar;
+        bool sink = false;
+        std::uint32_t count = 0;          ///< points written
+        int firstView = 0, views = 0;
+        float minRange = 0.0f, maxRange = 0.0f;
+        // Camera
+        int width = 0, height = 0;
+        glm::mat4 inverseProjection{ 1.0f };
+        // LiDAR
+        int beams = 0, steps = 0;
+        std::uint32_t firstColumn = 0;    ///< of the turn
+        float verticalFov = 0.0f;         ///< radians
+        int faceLayer[4] = { -1, -1, -1, -1 };
+        glm::mat4 faceRotation[4];        ///< sensor frame to each face's view space
+        glm::mat4 faceProjection{ 1.0f };
+        int faceWidth = 0, faceHeight = 0;
+        // Reach, for culling casters
+        glm::vec3 origin{ 0.0f };
+    };
+
+    struct Sensor {
+        std::weak_ptr<SensorStream> stream;
+        double start = 0.0;               ///< seconds since m_epoch
+        std::uint64_t emitted = 0;        ///< frames (camera) or columns (LiDAR) so far
+        std::uint64_t seen = 0;           ///< tick
+    };
+
+    struct Readback {
+        GLuint buffer = 0;
+        GLsizeiptr capacity = 0;
+        GLsync fence = nullptr;
+        entt::entity entity = entt::null;
+        std::uint32_t count = 0;
+    };
+
+    bool planCamera(const VirtualSensorComponent& sensor, Sensor& state, double now, const glm::mat4& worldToSensor, Job& job);
+    bool planLidar(const VirtualSensorComponent& sensor, Sensor& state, double now, const glm::mat4& worldToSensor, Job& job);
+    void ensureTarget(int width, int height, int layers);
+    void queueReadback(const Job& job, GLuint ring, std::uint64_t first);
+    void deliver(entt::registry& registry);
+
+    QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+    std::uint64_t m_tick = ~0ull;
+    std::chrono::steady_clock::time_point m_epoch = std::chrono::steady_clock::now();
+
+    std::unordered_map<entt::entity, Sensor> m_sensors;
+    std::vector<Job> m_jobs;          ///< planned this tick
+    std::vector<View> m_views;
+
+    GLuint m_depthTexture = 0;        ///< GL_TEXTURE_2D_ARRAY, DEPTH_COMPONENT32F
+    GLuint m_framebuffer = 0;
+    GLuint m_attached = 0;            ///< texture m_framebuffer holds
+    int m_targetSize[2] = { 0, 0 };
+    int m_targetLayers = 0;
+
+    std::vector<Readback> m_readbacks;
+    std::deque<std::size_t> m_inFlight;   ///< oldest first
+    std::vector<std::size_t> m_idle;
+    std::vector<SensorPoint> m_sinkScratch;
+    bool m_warnedReadbacks = false;
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm.hpp>
+#include <entt/entt.hpp>
+#include <qopengl.h>
+#include "SensorBuffers.hpp"
+
+class QOpenGLFunctions_4_3_Core;
+class GLStateCache;
+class GpuProfiler;
+class MeshArena;
+class SensorStream;
+class Shader;
+struct MeshData;
+
+/**
+ * @class VoxelReconstruction
+ * @brief Live TSDF fusion of the sensor streams into arena meshes.
+ *
+ * The volume is a hash of 8^3-voxel blocks on the GPU. Each tick, for every
+ * running SensorStreamComponent, a compute pass bins the points that arrived
+ * since the last tick into a spherical range image and allocates the blocks
+ * around each hit; a second pass, one work group per block touched, projects
+ * every voxel into that image and folds the truncated signed distance into
+ * its running average. Both passes read the points straight from the
+ * stream's ring (SensorBuffers), so fusion keeps up with the sensor.
+ *
+ * Touched blocks are also copied to a staging buffer and read back a few
+ * ticks later, in order, through fenced slots. The CPU keeps a mirror of
+ * every block and re-meshes the blocks whose voxels (or whose +x/+y/+z
+ * neighbours' voxels) changed with marching cubes, a bounded number per
+ * tick on the thread pool. Each block's surface is one MeshArena range,
+ * replaced when it changes, and the mesh passes draw them like any other
+ * arena mesh.
+ *
+ * With ReconstructionComponent::track, each scan is first registered
+ * against the surface fused so far (scan-to-map ICP): a compute pass per
+ * Gauss-Newton iteration interpolates the TSDF at every sampled point,
+ * taking the signed distance as the point-to-plane residual and its
+ * gradient as the normal, and reduces the 6x6 normal equations into one
+ * row per work group. The CPU adds the rows and solves; each iteration
+ * waits for its few kilobytes of partials, which the profiler shows as
+ * "icp N" passes. The pose found is kept per sensor as a correction of the
+ * entity's own pose, so drift carries over to the next scan, and is
+ * published as SensorTrackingComponent.
+ *
+ * One ReconstructionComponent drives it; removing the component or changing
+ * its voxel size or truncation starts an empty volume.
+ */
+class VoxelReconstruction
+{
+public:
+    static constexpr int kBlockSide = 8;
+    static constexpr int kBlockVoxels = kBlockSide * kBlockSide * kBlockSide;
+    static constexpr std::uint32_t kBucketCount = 1u << 14;   ///< block slots; 32 MiB of voxels
+    static constexpr std::uint32_t kActiveCapacity = 1024;    ///< blocks integrated per tick
+    static constexpr int kReadbackSlots = 3;
+    static constexpr std::size_t kMeshBlocksPerTick = 64;
+    static constexpr int kMaxTrackIterations = 16;
+    static constexpr GLuint kTrackGroups = 64;              ///< partial rows per iteration
+    static constexpr std::uint32_t kTrackMaxPoints = 1u << 16;   ///< sampled per scan
+    static constexpr int kTrackSums = 29;                   ///< J^T J upper triangle, J^T r, r^2, inliers
+    static constexpr int kTrackRowStride = 32;              ///< floats per partial row
+    static constexpr double kMinTrackInliers = 200.0;
+
+    struct BlockMesh {
+        std::shared_ptr<const MeshData> mesh;   ///< world space; contentHash is the arena key
+        glm::vec3 boundsMin{ 0.0f };
+        glm::vec3 boundsMax{ 0.0f };
+    };
+
+    void setFunctions(QOpenGLFunctions_4_3_Core* gl) { m_gl = gl; }
+
+    // Once per tick, in whichever viewport gets there first. Consumes
+    // finished readbacks, re-meshes dirty blocks into 'arena' and fuses the
+    // points that arrived since the last tick (updating 'sensors' first),
+    // registering them first if tracking. 'profiler' may be null.
+    void update(entt::registry& registry, SensorBuffers& sensors, MeshArena& arena,
+        GLStateCache& state, Shader& splatShader, Shader& integrateShader, Shader& trackShader,
+        std::uint64_t tick, GpuProfiler* profiler = nullptr);
+
+    entt::entity entity() const { return m_entity; }
+    const glm::vec3& albedo() const { return m_albedo; }
+    const std::unordered_map<std::uint32_t, BlockMesh>& meshes() const { return m_meshes; }
+
+    // Readbacks in flight or blocks waiting for a mesh.
+    bool busy() const;
+
+    void destroy(MeshArena& arena);
+
+private:
+    struct Settings {
+        float voxelSize = 0.0f;
+        float truncation = 0.0f;
+        bool operator!=(const Settings& o) const { return voxelSize != o.voxelSize || truncation != o.truncation; }
+    };
+
+    struct Readback {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+    };
+
+    struct Source {
+        std::weak_ptr<SensorStream> stream;
+        std::uint64_t integrated = 0;   ///< ring position fused so far
+        glm::mat4 correction{ 1.0f };   ///< tracked pose * inverse(entity pose)
+    };
+    struct TrackResult {
+        glm::mat4 pose{ 1.0f };
+        double rmsResidual = 0.0;
+        std::uint32_t inliers = 0;
+        int iterations = 0;
+        bool converged = false;
+    };
+
+    using Voxels = std::array<std::uint32_t, kBlockVoxels>;
+
+    void createVolume();
+    void releaseVolume(MeshArena& arena);
+    void drainReadbacks();
+    void remesh(MeshArena& arena);
+    bool integrate(entt::registry& registry, SensorBuffers& sensors, GLStateCache& state,
+        Shader& splatShader, Shader& integrateShader, Shader* trackShader, int trackIterations,
+        float maxRange, GpuProfiler* profiler);
+    // Gauss-Newton from 'guess'; false (and 'guess' untouched) if the scan
+    // found too little of the surface.
+    bool track(const SensorBuffers::Ranges& scan, const glm::mat4& guess, GLStateCache& state,
+        Shader& shader, int iterations, float maxRange, GpuProfiler* profiler, TrackResult& result);
+    BlockMesh meshBlock(std::uint32_t key) const;
+
+    QOpenGLFunctions_4_3_Core* m_gl = nullptr;
+    std::uint64_t m_tick = ~0ull;
+
+    entt::entity m_entity = entt::null;
+    Settings m_settings;
+    glm::vec3 m_albedo{ 0.8f };
+
+    GLuint m_hashBuffer = 0;      ///< Bucket[kBucketCount]
+    GLuint m_voxelBuffer = 0;     ///< uint[kBucketCount * kBlockVoxels]
+    GLuint m_activeBuffer = 0;    ///< uvec4 header + uvec4[kActiveCapacity]
+    GLuint m_stagingBuffer = 0;   ///< uint[kActiveCapacity * kBlockVoxels]
+    GLuint m_rangeImage = 0;      ///< uint[kImageWidth * kImageHeight]
+    GLuint m_trackPartials = 0;   ///< float[kTrackGroups * kTrackRowStride]
+    std::vector<float> m_trackScratch;
+    Readback m_readbacks[kReadbackSlots];
+    int m_readbackHead = 0;       ///< next slot to fill
+    int m_readbackTail = 0;       ///< oldest slot in flight
+    int m_readbacksInFlight = 0;
+    std::uint32_t m_stamp = 0;
+
+    std::unordered_map<const SensorStream*, Source> m_sources;
+    std::unordered_map<std::uint32_t, Voxels> m_blocks;       ///< CPU mirror, by packed block key
+    std::unordered_set<std::uint32_t> m_dirty;                ///< blocks to re-mesh
+    std::unordered_map<std::uint32_t, BlockMesh> m_meshes;    ///< non-empty block surfaces
+    std::vector<std::uint32_t> m_meshScratch;
+    bool m_warnedFull = false;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "KinematicModel.hpp"
+
+struct ScalarVolume;
+
+/**
+ * @brief Where a robot's end effector reaches, and how dexterously, binned
+ *        into a voxel grid.
+ *
+ * compute() draws joint configurations uniformly within the model's limits
+ * (unlimited revolute joints over one turn, unlimited prismatic ones over
+ * +-1 m) and poses kBatch of them at a time with
+ * KinematicModel::forwardBatch(). Drawing the samples and evaluating them
+ * are spread over ThreadPool::shared() as well. Each sample's tip position
+ * lands in a voxel. The voxel counts the sample and keeps the best
+ * manipulability seen there, which is Yoshikawa's sqrt(det(J J^T)) of the
+ * positional Jacobian. The Jacobian is built from the same batch's link
+ * poses, so no second kinematic pass is needed.
+ *
+ * The grid's box is taken from the first batch and padded by kPadding of
+ * its size on every side. Later samples outside it are counted in 'outside'.
+ * Everything is in the frame of the 'base' pose that was passed in.
+ */
+struct WorkspaceMap
+{
+    static constexpr std::size_t kBatch = 65536;
+    static constexpr float kPadding = 0.1f;
+
+    struct Settings {
+        std::uint64_t samples = std::uint64_t(1) << 22;
+        glm::ivec3 resolution{ 64 };
+        int tip = -1;                         ///< model link; -1 for the last end effector
+        std::uint64_t seed = 1;
+    };
+
+    enum class Quantity { Reachability, Manipulability };
+
+    glm::vec3 boundsMin{ 0.0f }, boundsMax{ 0.0f };
+    glm::ivec3 resolution{ 0 };
+    std::vector<std::uint32_t> hits;          ///< samples per voxel, x fastest
+    std::vector<float> manipulability;        ///< best per voxel, 0 where never reached
+    std::uint64_t samples = 0;                ///< binned
+    std::uint64_t outside = 0;                ///< drawn but outside the box
+    std::uint32_t maxHits = 0;
+    float maxManipulability = 0.0f;
+    int tip = -1;
+
+    // Blocks until done. Call from any thread but a pool worker. Empty
+    // (samples 0) if cancelled or the model has no moving joint.
+    static WorkspaceMap compute(const KinematicModel& model, const Settings& settings,
+        const KinematicModel::Pose& base = {}, const std::atomic<bool>* cancel = nullptr);
+
+    bool empty() const { return samples == 0; }
+    std::size_t reachedVoxels() const;
+    // The grid as 0..1 values for a field visualizer's Volume mode over
+    // [boundsMin, boundsMax]. Reachability is log(1 + hits) / log(1 + maxHits),
+    // so sparsely reached shells still show.
+    std::shared_ptr<const ScalarVolume> volume(Quantity quantity) const;
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "SceneFile.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include <entt/entity/entity.hpp>
+#include <entt/fwd.hpp>
+
+struct MeshData;
+
+/**
+ * @class WorldPartition
+ * @brief Streams a plant-scale scene in by spatial cells around the cameras.
+ *
+ * build() splits the registry's saved scene into cubic cells: every
+ * top-level mesh entity (no parent, no children) goes to the cell holding
+ * its world bounds' centre, each cell into its own .krscene, and the rest
+ * (lights, effectors, grids, hierarchies) into a resident .krscene. A
+ * .krworld index lists the cells with their bounds and a simplified merged
+ * mesh of each as a LOD proxy (see SceneFileFormat).
+ *
+ * open() shows every cell as its proxy and queues the resident part.
+ * update() then loads cells whose box comes within loadRadius of any
+ * camera, nearest first and within the entity budget, and drops them again
+ * beyond loadRadius + hysteresis. Cells are read one at a time on a loader
+ * thread (SceneFile::read() spreads each over ThreadPool::shared()), so a
+ * load never sits in the pool's queues ahead of tick work; only
+ * SceneFile::commit() and entity destruction run on the GUI thread.
+ * Streamed cells are read-only: edits to their entities are lost when the
+ * cell unloads.
+ */
+class WorldPartition
+{
+public:
+    struct Settings {
+        float loadRadius = 60.0f;                    ///< metres from the nearest camera to a cell's box
+        float hysteresis = 20.0f;                    ///< loaded cells stay until this much further out
+        std::size_t maxResidentEntities = 250000;    ///< streamed entities loaded or loading
+        int maxLoadsInFlight = 2;                    ///< queued or reading
+    };
+
+    struct Stats {
+        std::size_t cells = 0;
+        std::size_t loaded = 0;
+        std::size_t loading = 0;
+        std::size_t streamedEntities = 0;            ///< in loaded cells
+    };
+
+    WorldPartition();
+    ~WorldPartition();
+    WorldPartition(const WorldPartition&) = delete;
+    WorldPartition& operator=(const WorldPartition&) = delete;
+
+    // Writes 'path' (.krworld) and its cell directory from the registry's
+    // scene, in cells of 'cellSize' metres. Cells are written in parallel.
+    // False with 'error' set if anything could not be written. GUI thread.
+    static bool build(entt::registry& registry, const std::string& path, float cellSize, std::string* error = nullptr);
+
+    // Closes any open world, reads the index and adds one proxy entity per
+    // cell. The resident part arrives through update(). GUI thread.
+    bool open(entt::registry& registry, const std::string& path, std::string* error = nullptr);
+    // Destroys every proxy and streamed entity; loads in flight are dropped.
+    void close(entt::registry& registry);
+    bool isOpen() const { return !m_cells.empty() || m_resident; }
+
+    // Commits finished loads and starts or drops cells for these camera
+    // positions. Returns true if the registry changed. GUI thread, once per
+    // tick; cheap when no world is open.
+    bool update(entt::registry& registry, const std::vector<glm::dvec3>& viewers);
+
+    void setSettings(const Settings& settings) { m_settings = settings; }
+    const Settings& settings() const { return m_settings; }
+    Stats stats() const;
+
+private:
+    struct Load {
+        SceneFile::Loaded scene;
+        std::string error;
+        bool ok = false;
+        std::atomic<bool> done{ false };
+    };
+
+    enum class CellState { Proxy, Loading, Loaded };
+
+    struct Cell {
+        glm::ivec3 coord{ 0 };
+        glm::vec3 min{ 0.0f }, max{ 0.0f };
+        std::uint32_t entityCount = 0;
+        std::string path;
+        std::shared_ptr<const MeshData> proxyMesh;
+        CellState state = CellState::Proxy;
+        entt::entity proxy = entt::null;
+        std::vector<entt::entity> entities;          ///< while Loaded
+        std::shared_ptr<Load> load;                  ///< while Loading
+        bool failed = false;                         ///< its file could not be read; stays a proxy
+    };
+
+    std::shared_ptr<Load> startLoad(const std::string& path);
+    void loaderLoop();
+    double distance(const Cell& cell, const std::vector<glm::dvec3>& viewers) const;
+    void showProxy(entt::registry& registry, Cell& cell);
+    void unload(entt::registry& registry, Cell& cell);
+
+    Settings m_settings;
+    std::vector<Cell> m_cells;
+    std::shared_ptr<Load> m_resident;                ///< until the resident part is committed
+    std::vector<entt::entity> m_residentEntities;
+    std::string m_name;                              ///< for proxy tags
+
+    std::thread m_loader;
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCv;
+    std::deque<std::pair<std::string, std::shared_ptr<Load>>> m_queue;
+    bool m_stopping = false;
+};
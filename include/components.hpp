@@ -2,23 +2,32 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/packing.hpp>
 #include <string>
 #include <vector>
 #include <functional>
+#include <future>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <entt/entt.hpp>
-#include <QOpenGLContext>
 #include <qopengl.h>
 #include <unordered_map>
 
 #include "GridLevel.hpp"
+#include "RenderLayers.hpp"
 #include "Camera.hpp"
 #include "RobotDescription.hpp"
 #include "GpuResources.hpp" // <-- ADD THIS INCLUDE to get the GPU struct definitions
+#include "SplineEvaluation.hpp"
 
 // --- CORE COMPONENTS ---
 
 struct SelectedComponent {};
 struct CameraGizmoTag {};
+// Stands in for a WorldPartition cell that is not loaded; never saved.
+struct WorldCellProxyTag {};
 struct RecordLedTag {};
 struct PulsingSplineTag {};
 
@@ -30,6 +39,15 @@ struct PulsingLightComponent {
     float speed = 5.0f;
 };
 
+// A point light for the clustered forward pass. Beside a PulsingLightComponent
+// its colour is the material's current albedo, so an indicator lights its
+// surroundings in whatever colour it is glowing.
+struct PointLightComponent {
+    glm::vec3 color{ 1.0f, 1.0f, 1.0f };
+    float intensity = 1.0f;
+    float range = 5.0f;           ///< metres; the light falls to zero there
+};
+
 struct Texture {
     GLuint id = 0;
     std::string path;
@@ -38,8 +56,10 @@ struct Texture {
 struct MaterialComponent {
     glm::vec3 albedo = { 0.8f, 0.8f, 0.8f };
     std::shared_ptr<Texture> albedoMap;
+    std::shared_ptr<Texture> metalRoughnessMap;   ///< glTF channels: g = roughness, b = metallic
     float metallic = 0.1f;
     float roughness = 0.8f;
+    glm::vec3 emissive{ 0.0f };                   ///< scaled by intensity
 };
 
 // --- FIELD-SPECIFIC COMPONENTS ---
@@ -54,6 +74,21 @@ struct ColorStop {
     glm::vec4 color{ 1.0f, 1.0f, 1.0f, 1.0f };
 };
 
+// Particle buffer record, shared with the particle shaders (which get the
+// same KR_PACKED_PARTICLES define). Packed, it is 32 bytes instead of 64:
+// the update kernels read and write half the memory per step.
+#ifndef KR_PACKED_PARTICLES
+#    define KR_PACKED_PARTICLES 1   // CMake option KR_PACKED_PARTICLES
+#endif
+#if KR_PACKED_PARTICLES
+struct Particle {
+    glm::vec3 position;
+    std::uint32_t ageLifetime;      ///< low: unorm16 age / lifetime, high: half lifetime
+    std::uint32_t velocitySize[2];  ///< half4: velocity xyz, size
+    std::uint32_t color[2];         ///< half4
+};
+static_assert(sizeof(Particle) == 32, "must match ParticleStore in the particle shaders");
+#else
 struct Particle {
     glm::vec4 position;
     glm::vec4 velocity;
@@ -63,22 +98,42 @@ struct Particle {
     float size;
     float padding; // Ensures struct alignment matches std430 layout
 };
+static_assert(sizeof(Particle) == 64, "must match ParticleStore in the particle shaders");
+#endif
+
+inline Particle makeParticle(const glm::vec3& position, const glm::vec3& velocity, const glm::vec4& color,
+    float age, float lifetime, float size)
+{
+#if KR_PACKED_PARTICLES
+    Particle p;
+    p.position = position;
+    p.ageLifetime = (glm::packUnorm2x16(glm::vec2(age / std::max(lifetime, 1e-6f), 0.0f)) & 0xffffu)
+        | (glm::packHalf2x16(glm::vec2(0.0f, lifetime)) & 0xffff0000u);
+    p.velocitySize[0] = glm::packHalf2x16(glm::vec2(velocity.x, velocity.y));
+    p.velocitySize[1] = glm::packHalf2x16(glm::vec2(velocity.z, size));
+    p.color[0] = glm::packHalf2x16(glm::vec2(color.r, color.g));
+    p.color[1] = glm::packHalf2x16(glm::vec2(color.b, color.a));
+    return p;
+#else
+    return Particle{ glm::vec4(position, 1.0f), glm::vec4(velocity, 0.0f), color, age, lifetime, size, 0.0f };
+#endif
+}
 
 struct AABB {
     glm::vec3 min;
     glm::vec3 max;
 };
 
-struct InstanceData {
-    glm::mat4 modelMatrix;
-    glm::vec4 color;
-    glm::vec4 padding;
+// A scalar grid over a field visualizer's bounds, drawn by its Volume mode.
+// Values in [0, 1], x fastest, then y, then z.
+struct ScalarVolume {
+    glm::ivec3 resolution{ 0 };
+    std::vector<float> values;
 };
 
-
 struct FieldVisualizerComponent {
     // --- FIX: Define enums inside the component for clear scope ---
-    enum class DisplayMode { Arrows, Particles, Flow };
+    enum class DisplayMode { Arrows, Particles, Flow, Streamlines, Volume };
     enum class ColoringMode { Intensity, Lifetime, Directional };
 
     // --- General Settings (apply to all modes) ---
@@ -88,6 +143,22 @@ struct FieldVisualizerComponent {
         glm::vec3(-5.0f),
         glm::vec3(5.0f) 
     };
+    // Baked mode: the field is evaluated once into an RGBA16F 3D texture over
+    // 'bounds' and every mode samples it. Re-baked only when effectors, the
+    // visualizer transform, bounds or resolution change.
+    bool useBakedField = false;
+    glm::ivec3 bakeResolution = { 64, 64, 64 };
+
+    // Temporal mode, for effectors that move: the field is baked as a
+    // keyframe every keyInterval of simulation time, slicesPerTick z slices
+    // a tick, into a ring of textures, and every mode samples the blend of
+    // the two keyframes around 2 * keyInterval ago. Implies baking; with the
+    // effectors unchanged no keyframe is baked.
+    struct TemporalSettings {
+        bool enabled = false;
+        float keyInterval = 0.2f;     ///< simulation seconds between keyframes
+        int slicesPerTick = 16;       ///< bake budget per tick; a keyframe's slices may see different ticks
+    } temporalSettings;
 
     // --- FIX: Use nested structs for organization ---
     struct ArrowSettings {
@@ -100,6 +171,13 @@ struct FieldVisualizerComponent {
         float lengthScaleMultiplier = 1.0f;
         bool scaleByThickness = false;
         float thicknessScaleMultiplier = 1.0f;
+        // Adaptive: 'density' is the coarse grid. Cells whose corners see a
+        // field differing from their centre's by more than refineThreshold
+        // (relative to the strongest) split in eight, up to refineLevels
+        // times, on the GPU from the baked field (this mode always bakes).
+        bool adaptive = false;
+        int refineLevels = 2;
+        float refineThreshold = 0.25f;
         ColoringMode coloringMode = ColoringMode::Intensity;
         glm::vec4 xPosColor, xNegColor, yPosColor, yNegColor, zPosColor, zNegColor;
         std::vector<ColorStop> intensityGradient;
@@ -138,18 +216,48 @@ struct FieldVisualizerComponent {
         float peakGlowMultiplier = 2.0f;
         float minGlowSize = 0.02f;
         float randomWalkStrength = 0.1f;
+        // Particles per second taken from the dead list. 0: every particle
+        // respawns the step it dies, so all particleCount are always alive.
+        float emissionRate = 0.0f;
         ColoringMode coloringMode = ColoringMode::Intensity;
         glm::vec4 xPosColor, xNegColor, yPosColor, yNegColor, zPosColor, zNegColor;
         std::vector<ColorStop> intensityGradient;
         std::vector<ColorStop> lifetimeGradient;
     } particleSettings;
 
+    // One line per seed of a grid over the bounds, traced with RK4 through the
+    // baked field (this mode always bakes it) and drawn with the glow-line
+    // shaders. Traced again only when the field is re-baked or these change.
+    struct StreamlineSettings {
+        glm::ivec3 seedDensity = { 6, 6, 6 };
+        int maxSteps = 200;
+        float stepLength = 0.05f;     ///< world units per RK4 step
+        float minSpeed = 1e-3f;       ///< a line ends where the field gets weaker
+        float thickness = 3.0f;       ///< pixels, as for splines
+        glm::vec4 glowColour = { 0.2f, 0.6f, 1.0f, 0.5f };
+        glm::vec4 coreColour = { 0.9f, 0.95f, 1.0f, 1.0f };
+    } streamlineSettings;
+
+    // Ray-marched density over the bounds: 'volume' when set (uploaded again
+    // only when the pointer changes), otherwise the baked field's strength
+    // divided by 'range'. Values below 'threshold' are empty space.
+    struct VolumeSettings {
+        std::shared_ptr<const ScalarVolume> volume;
+        float range = 1.0f;
+        float densityScale = 4.0f;    ///< opacity per world unit at value 1
+        float threshold = 0.02f;
+        int maxSteps = 256;
+        std::vector<ColorStop> gradient;
+    } volumeSettings;
+
     // --- Internal GPU State ---
     bool isGpuDataDirty = true;
     FieldVisGpuData gpuData;
     GLuint particleBuffer[2] = { 0, 0 };
-    GLuint particleVAO = 0;
+    GLuint particleListBuffer = 0;     ///< Particles mode: ParticleListHeaderGpu + alive/dead index lists
+    float pendingEmission = 0.0f;      ///< fraction of a particle owed to the next step
     int currentReadBuffer = 0;
+    std::uint64_t simulatedStep = 0;   ///< RenderingSystem simulation step the particles are at
 };
 
 // --- Effector Components (Updated for GPU alignment) ---
@@ -175,6 +283,15 @@ struct MeshEffectorComponent {
     float distance = 2.0f;
 };
 
+// Makes the entity's PointCloudComponent scan a field source: within
+// 'distance' of the nearest scanned point, samples are pushed away from it,
+// fading linearly like MeshEffectorComponent. Queries go through a
+// PointCloudGrid, so the scan's size does not affect the cost per sample.
+struct PointCloudEffectorComponent {
+    float strength = 10.0f;
+    float distance = 0.5f;
+};
+
 struct DirectionalEffectorComponent {
     glm::vec3 direction = { 0.0f, -1.0f, 0.0f };
     float strength = 1.0f;
@@ -194,9 +311,47 @@ struct TransformComponent
     glm::quat rotation = { 1.0f, 0.0f, 0.0f, 0.0f };
     glm::vec3 scale = { 1.0f, 1.0f, 1.0f };
 
-    glm::mat4 getTransform() const {
-        glm::mat4 rot = glm::mat4_cast(rotation);
-        return glm::translate(glm::mat4(1.0f), translation) * rot * glm::scale(glm::mat4(1.0f), scale);
+    // Local matrix: the cached one while translation/rotation/scale still
+    // match the values it was built from, else composed afresh, so editing
+    // the members in place (with or without registry.patch) is always picked
+    // up. Only reads the cache, so any number of threads may call it.
+    glm::mat4 getTransform() const { return fresh() ? cache.matrix : compose(); }
+
+    // Changes whenever the local TRS changes. Values come from one global
+    // counter, so they stay unique across copies and replaced components and
+    // consumers can compare against a version they stored earlier.
+    // Rebuilds the cache when stale: a write, so during a tick only the
+    // "transforms" system (which declares it) calls this; outside the tick
+    // any GUI-thread code may.
+    std::uint64_t version() const { refresh(); return cache.version; }
+
+    struct Cache {
+        glm::vec3 translation{ 0.0f };
+        glm::quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+        glm::vec3 scale{ 1.0f };
+        glm::mat4 matrix{ 1.0f };
+        std::uint64_t version = 0;            ///< 0 = never built
+    };
+    mutable Cache cache;                      ///< internal, see getTransform()
+
+private:
+    static inline std::atomic<std::uint64_t> s_nextVersion{ 1 };
+
+    bool fresh() const {
+        return cache.version != 0 && cache.translation == translation
+            && cache.rotation == rotation && cache.scale == scale;
+    }
+    glm::mat4 compose() const {
+        return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation)
+            * glm::scale(glm::mat4(1.0f), scale);
+    }
+    void refresh() const {
+        if (fresh()) return;
+        cache.translation = translation;
+        cache.rotation = rotation;
+        cache.scale = scale;
+        cache.matrix = compose();
+        cache.version = s_nextVersion.fetch_add(1, std::memory_order_relaxed);
     }
 };
 
@@ -204,6 +359,27 @@ struct WorldTransformComponent {
     glm::mat4 matrix{ 1.0f };
 };
 
+// World-space AABB of a renderable mesh, maintained by CullingSystem.
+// Recomputed only when the world matrix it was built from changes.
+struct WorldBoundsComponent {
+    glm::vec3 min{ 0.0f };
+    glm::vec3 max{ 0.0f };
+    glm::vec3 localMin{ 0.0f };
+    glm::vec3 localMax{ 0.0f };
+    glm::mat4 sourceMatrix{ 1.0f };
+    std::size_t meshKey = 0;          ///< MeshCache::keyOf the mesh the local box was computed from
+    bool valid = false;
+};
+
+class MeshBvh;
+
+// Mesh-local picking BVH (BLAS), built lazily by IntersectionSystem and
+// shared between entities with equal mesh content.
+struct PickingBvhComponent {
+    std::shared_ptr<const MeshBvh> blas;
+    std::size_t meshKey = 0;          ///< MeshCache::keyOf the mesh it was built from
+};
+
 struct Vertex
 {
     glm::vec3 position{};
@@ -226,23 +402,150 @@ struct CameraComponent
 {
     Camera camera;
     bool isPrimary = true;
+    std::uint32_t layerMask = RenderLayers::DefaultView;   ///< what its viewport draws, see RenderLayers
+};
+
+// Which layers the entity's meshes are on (RenderLayers bits). Without one
+// a mesh is on RenderLayers::Visual.
+struct LayerComponent
+{
+    std::uint32_t mask = RenderLayers::Visual;
 };
 
 // --- RENDER-RELATED COMPONENTS ---
 
-struct RenderableMeshComponent {
+// A coarser triangle list over the same vertices (MeshOptimize::generateLods).
+struct MeshLod {
+    std::vector<unsigned> indices;
+    float error = 0.0f;               ///< object-space deviation from the full mesh
+};
+
+// A run of full-mesh triangles culled as one (MeshOptimize::buildClusters).
+struct MeshCluster {
+    glm::vec3 center{ 0.0f };         ///< bounding sphere, object space
+    float radius = 0.0f;
+    glm::vec3 coneAxis{ 0.0f, 0.0f, 1.0f };   ///< mean facing of its triangles
+    float coneCutoff = 2.0f;          ///< sine of the cone's half angle; > 1: no cone
+    std::uint32_t firstIndex = 0;     ///< into MeshData::indices
+    std::uint32_t indexCount = 0;
+};
+
+// Immutable geometry, shared by every entity and collider that shows it.
+// Created through MeshCache, which also fills 'contentHash'.
+struct MeshData {
     std::vector<Vertex> vertices;
     std::vector<unsigned> indices;
+    std::vector<MeshLod> lods;        ///< coarser levels for drawing only, finest first
+    std::vector<MeshCluster> clusters;   ///< 'indices' in culling units, large meshes only
+    std::size_t contentHash = 0;      ///< FNV-1a of vertices and indices, never 0 once cached
+
+    static const MeshData& empty() { static const MeshData e; return e; }
 };
 
+// A reference to shared geometry; entities spawned from the same file (or
+// with identical content) hold the same MeshData.
+struct RenderableMeshComponent {
+    std::shared_ptr<const MeshData> mesh;
+
+    const std::vector<Vertex>& vertices() const { return (mesh ? *mesh : MeshData::empty()).vertices; }
+    const std::vector<unsigned>& indices() const { return (mesh ? *mesh : MeshData::empty()).indices; }
+};
+
+// Every renderable mesh with its transform, as an owning group: EnTT keeps
+// these entities packed at the front of both pools in the same order, so
+// the per-tick mesh loops (world bounds, snapshot extract) walk two dense
+// arrays instead of probing a sparse set per entity. The group owns both
+// pools: no other group may own them and neither may be sorted. Adding or
+// removing either component moves entries in both, so it must not overlap
+// a tick system reading either. Scene's constructor creates the group; any
+// other registry must call this once on its own thread before a system on
+// the pool does.
+inline auto renderableMeshes(entt::registry& registry)
+{
+    return registry.group<RenderableMeshComponent, TransformComponent>();
+}
+
+// A RenderableMeshComponent still loading (MeshCache::loadAsync). Swapped
+// for one by SceneBuilder::resolvePendingMeshes() once the mesh is ready.
+struct PendingMeshComponent {
+    std::shared_future<std::shared_ptr<const MeshData>> mesh;
+};
+
+// GPU geometry lives in RenderingSystem's MeshArena; this only names the
+// arena range. Entities with equal keys share one range and one batch.
+// Set through MeshKeyRefs::assign(), which counts the range's users.
 struct RenderResourceComponent
 {
-    struct Buffers {
-        GLuint VAO = 0;
-        GLuint VBO = 0;
-        GLuint EBO = 0;
-    };
-    std::unordered_map<QOpenGLContext*, Buffers> perContext;
+    std::size_t meshKey = 0; // MeshCache::keyOf the mesh, 0 = not uploaded yet
+};
+
+class PointCloudOctree;
+
+// An out-of-core scan (see PointCloudOctree); drawn with the entity's
+// transform. Nodes stream into PointCloudRenderer as views ask for them.
+struct PointCloudComponent {
+    std::shared_ptr<const PointCloudOctree> octree;
+};
+
+class SensorStream;
+struct SensorPoint;
+
+// A live point stream (see SensorStream) in the entity's frame. Points fade
+// out over maxAge seconds of sensor clock.
+struct SensorStreamComponent {
+    std::shared_ptr<SensorStream> stream;
+    float maxAge = 1.0f;
+    float pointSize = 2.0f;   ///< pixels at full resolution
+};
+
+// A simulated depth camera or spinning LiDAR at one of a link's
+// sensor_mounts, rendered from the scene's meshes by VirtualSensors. The
+// entity is a child of the link placed at the mount, and its
+// SensorStreamComponent holds the GPU-fed stream the points land in, in the
+// mount's frame. 'sink', if set, also gets every return on the GUI thread
+// a few ticks later.
+struct VirtualSensorComponent {
+    enum class Kind { DepthCamera, Lidar };
+    Kind kind = Kind::Lidar;
+    std::string mount;
+    // Depth camera: looks down -Z, Y up.
+    int width = 320;
+    int height = 240;
+    float fovDegrees = 60.0f;          ///< vertical
+    float framesPerSecond = 30.0f;
+    // LiDAR: spins about +Y from +Z towards +X, as SimulatedLidarReader does.
+    int beams = 32;
+    int stepsPerTurn = 2048;
+    float turnsPerSecond = 10.0f;
+    float verticalFovDegrees = 30.0f;  ///< centred on the horizon
+    float minRange = 0.1f;
+    float maxRange = 30.0f;
+    std::function<void(const SensorPoint* points, std::size_t count)> sink;
+};
+
+// Fuses every running SensorStreamComponent into a surface (see
+// VoxelReconstruction). One per scene; changing voxelSize or truncation
+// starts over.
+struct ReconstructionComponent {
+    float voxelSize = 0.05f;
+    float truncation = 0.15f;   ///< half-width of the signed distance band
+    float maxRange = 30.0f;     ///< returns further away are ignored
+    bool integrate = true;      ///< false keeps the surface but stops fusing
+    bool track = false;         ///< register each scan against the surface before fusing it
+    int trackIterations = 8;    ///< Gauss-Newton iterations per scan, at most 16
+    glm::vec3 albedo{ 0.72f, 0.70f, 0.66f };
+};
+
+// Written to a sensor's entity while ReconstructionComponent::track is on:
+// where its last scan registered against the surface. 'correction' maps the
+// entity's own pose onto 'pose' and seeds the next scan.
+struct SensorTrackingComponent {
+    glm::mat4 pose{ 1.0f };
+    glm::mat4 correction{ 1.0f };
+    float rmsResidual = 0.0f;   ///< metres, over the last iteration's inliers
+    std::uint32_t inliers = 0;
+    int iterations = 0;
+    bool converged = false;
 };
 
 // --- ROBOTICS-SPECIFIC COMPONENTS ---
@@ -256,7 +559,7 @@ struct JointComponent
     JointDescription description;
     entt::entity parentLink = entt::null;
     entt::entity childLink = entt::null;
-    double currentPosition = 0.0;
+    int dof = -1;                     ///< index into the robot's JointStateBuffer, -1 if the joint does not move
 };
 
 struct ParentComponent {
@@ -267,6 +570,146 @@ struct RobotRootComponent {
     std::string name;
 };
 
+class KinematicModel;
+class JointStateBuffer;
+
+// Compiled kinematics of one spawned robot, on its root link entity.
+// 'links' is parallel to the model's link order; KinematicSystem writes each
+// link's TransformComponent from the robot's JointStateBuffer.
+struct KinematicModelComponent {
+    std::shared_ptr<const KinematicModel> model;
+    std::vector<entt::entity> links;
+    std::vector<double> q;            ///< joint coordinates last applied, by DOF
+};
+
+// The robot's joint state, one dense block by DOF, on its root link entity.
+// Shared so other threads can keep snapshotting it after a respawn.
+struct JointStateComponent {
+    std::shared_ptr<JointStateBuffer> buffer;
+};
+
+struct Prefab;
+
+// One placement of a Prefab (see Prefab.hpp): its TransformComponent places
+// the prefab root, and there are no part entities. Articulated prefabs also
+// get a JointStateComponent, the instance's only override; the rest is kept
+// by PrefabSystem::update().
+struct PrefabInstanceComponent {
+    std::shared_ptr<const Prefab> prefab;
+    std::vector<glm::mat4> linkMatrices;      ///< prefab space, by model link; empty for rigid prefabs and gpuPosed
+    std::vector<double> q;                    ///< joint coordinates 'linkMatrices' were computed from
+    glm::vec3 localMin{ 0.0f }, localMax{ 0.0f };   ///< every part at the current pose, prefab space
+    bool posed = false;                       ///< linkMatrices and the local box are current
+    bool gpuPosed = false;                    ///< links posed by the renderer; the box is Prefab::reachMin/Max
+};
+
+// A planned joint-space motion of one robot, shown as 'ghosts' translucent
+// copies of it spread evenly along the way, fading from startAlpha to
+// endAlpha, and the swept end-effector path as a SplineComponent on the same
+// entity. Every pose comes from one KinematicModel::forwardBatch() in
+// KinematicSystem::updateTrajectoryGhosts(); set isDirty after an edit.
+struct TrajectoryGhostComponent {
+    static constexpr int kMaxGhosts = 1024;
+    static constexpr std::size_t kMaxPathPoints = 2048;   ///< waypoints past it are subsampled
+
+    entt::entity robot = entt::null;          ///< root link, with a KinematicModelComponent
+    std::vector<double> q;                    ///< waypoints x dofCount, row-major
+    int ghosts = 32;
+    int endEffector = -1;                     ///< model link the path follows; -1 for the last end effector
+    glm::vec3 colour{ 0.35f, 0.75f, 1.0f };
+    float startAlpha = 0.08f, endAlpha = 0.45f;
+    bool showPath = true;
+    bool isDirty = true;
+
+    // Derived
+    std::shared_ptr<const std::vector<glm::mat4>> poses;   ///< ghosts x linkCount, relative to the root link
+    int linkCount = 0;
+    std::vector<glm::vec3> path;              ///< end-effector positions, relative to the root link
+    glm::mat4 pathRoot{ 0.0f };               ///< root world matrix the spline was placed with
+};
+
+// A timed joint-space trajectory being played on the robot root it sits
+// on, e.g. a MotionPlanner path timed by TrajectoryTiming. Each tick moves
+// 'elapsed' on by the frame time and stages the configuration there as
+// position commands (written in place where no joint is bound); removed
+// at the end.
+struct TrajectoryPlaybackComponent {
+    std::vector<double> q;                    ///< waypoints x dofCount, row-major
+    std::vector<double> time;                 ///< seconds from the start, per waypoint
+    double elapsed = 0.0;
+};
+
+struct ConvexHullSet;
+
+// Convex collision core fitted by CollisionWorld from the entity's
+// collision or render mesh: a capsule (two points) or up to 64 hull vertices, mesh-local, swept
+// by 'radius'. With a decomposition, 'points' is the hull of all its pieces,
+// for bounds and safety zones, and contacts come from the pieces. Robot links carry their robot root and model link index;
+// environment colliders have robot == entt::null.
+struct CollisionShapeComponent {
+    std::vector<glm::vec3> points;
+    float radius = 0.0f;
+    entt::entity robot = entt::null;
+    int link = -1;
+    std::size_t meshKey = 0;                ///< MeshCache::keyOf the mesh it was fitted from
+    std::shared_ptr<const ConvexHullSet> hulls;   ///< mesh-local pieces tested instead of 'points'; null for one core
+};
+
+// Opts a non-robot mesh into collision checking against robots.
+struct EnvironmentColliderTag {};
+
+// A link's collision_mesh_filepath, loaded at spawn. When present,
+// CollisionWorld fits the link's shape from it instead of the render mesh.
+// 'hulls' is the convex decomposition of whichever of the two it uses, made
+// at import; CollisionWorld then tests hull against hull.
+struct CollisionMeshComponent {
+    std::shared_ptr<const MeshData> mesh;
+    std::shared_ptr<const ConvexHullSet> hulls;
+};
+
+// Present while the entity touches or penetrates another collider.
+struct CollisionContactComponent {
+    std::vector<entt::entity> others;
+    float maxDepth = 0.0f;                  ///< deepest penetration, world units
+};
+
+// Nearest approach between a robot's links and the environment colliders,
+// kept on the robot root by ClearanceMonitor. 'distance' is the monitor's
+// band where nothing is nearer, negative where a link sphere penetrates.
+struct ClearanceComponent {
+    float distance = 0.0f;
+    entt::entity link = entt::null;         ///< link of the nearest sphere; null beyond the band
+    entt::entity obstacle = entt::null;
+    glm::vec3 linkPoint{ 0.0f };            ///< world, on the nearest sphere
+    glm::vec3 obstaclePoint{ 0.0f };        ///< world, on the obstacle's surface
+};
+
+// A laser gate, light curtain or keep-out volume checked against every robot
+// link each tick by SafetyZoneMonitor. Volume is the entity's unit box
+// [-0.5, 0.5]^3 under its world transform (a curtain is a thin box);
+// HalfSpace is everything below the entity's local z = 0 plane.
+struct SafetyZoneComponent {
+    enum class Kind : std::uint8_t { Volume, HalfSpace };
+    Kind kind = Kind::Volume;
+    bool armed = true;
+};
+
+// Present on a zone while robot links are inside it.
+struct SafetyZoneViolationComponent {
+    std::vector<entt::entity> links;
+};
+
+// Text drawn over the scene at the entity's origin plus 'offset' (entity
+// local), facing the screen at a fixed pixel height whatever its distance.
+// RenderingSystem lays each distinct string out once and rewrites only the
+// labels that changed; edit in place, nothing needs flagging.
+struct LabelComponent {
+    std::string text;
+    glm::vec3 offset{ 0.0f };
+    glm::vec4 colour{ 1.0f };
+    float pixelHeight = 14.0f;               ///< ascent plus descent on screen
+};
+
 // --- SCENE-WIDE & MISC COMPONENTS ---
 
 struct SceneProperties
@@ -278,9 +721,13 @@ struct SceneProperties
     float fogEndDistance = 75.0f;
 };
 
-enum class SplineType { Linear, CatmullRom, Bezier, Parametric };
+/// Bezier is one curve of degree controlPoints.size() - 1. PiecewiseBezier is
+/// a chain of cubics (anchor, control, control, anchor, ...) sharing anchors,
+/// the cheap choice for long planner trajectories that get edited live.
+enum class SplineType { Linear, CatmullRom, Bezier, Parametric, PiecewiseBezier };
 
-struct ParametricSpline { std::function<glm::vec3(float)> func; };
+// Shared, so copying or moving the component moves one pointer.
+struct ParametricSpline { std::shared_ptr<const std::function<glm::vec3(float)>> func; };
 
 struct SplineComponent
 {
@@ -292,7 +739,28 @@ struct SplineComponent
     float thickness = 8.0f;
 
     bool isDirty = true;
-    std::vector<glm::vec3> cachedVertices;
+    // The sampled polyline, replaced (never edited) on every rebuild and
+    // held by handle, so pool moves and copies stay small.
+    std::shared_ptr<const std::vector<glm::vec3>> cache;
+    std::shared_ptr<const SplineEvaluation::ArcLengthTable> arcLengths;   ///< over cache, rebuilt with it
+    std::uint32_t cacheRevision = 0; ///< bumped on every rebuild; GPU copies compare against it
+
+    const std::vector<glm::vec3>& cachedVertices() const
+    {
+        static const std::vector<glm::vec3> none;
+        return cache ? *cache : none;
+    }
+    const SplineEvaluation::ArcLengthTable& arcLengthTable() const
+    {
+        static const SplineEvaluation::ArcLengthTable none;
+        return arcLengths ? *arcLengths : none;
+    }
+    // Constant-speed placement: the point 'distance' along the cached
+    // polyline, with its tangent and frame.
+    SplineEvaluation::ArcSample sampleAtDistance(float distance) const
+    {
+        return SplineEvaluation::sampleAt(arcLengthTable(), cachedVertices(), distance);
+    }
 };
 
 struct GridComponent
@@ -31,6 +31,9 @@ public:
     explicit gridPropertiesWidget(Scene* scene, entt::entity entity, QWidget* parent = nullptr);
     ~gridPropertiesWidget();
 
+    // Re-reads the grid's components, e.g. after an undo.
+    void refresh();
+
 private slots:
     // Slots to handle UI changes
     void onEulerChanged();
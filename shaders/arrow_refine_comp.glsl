@@ -0,0 +1,96 @@
+#version 430 core
+
+// Adaptive arrow sampling (ArrowSettings::adaptive), from the baked field.
+// Cells are vec4(centre in visualizer space, level); a level-l cell spans
+// u_coarseHalfExtent / 2^l either side of its centre.
+//
+// Level 0 reads no list: its cells are the uniform grid (u_gridDensity),
+// derived from the invocation index.
+// u_pass 0, once per level: each cell of the input list compares the field
+// at its eight corners with the field at its centre. Where they differ by
+// more than u_refineThreshold of the strongest of them (and that is strong
+// enough to draw) and the cell is above u_maxLevel, its eight children go
+// to the output list; otherwise its centre becomes an arrow sample, sized
+// by its level. At u_maxLevel every cell becomes a sample.
+// u_pass 1, one invocation: writes the arrow kernel's indirect dispatches.
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+layout(std430, binding = 0) buffer SamplePointsBuffer {
+    uvec4 sampleHeader;       // x = sample count
+    vec4 samplePoints[];      // xyz, w = arrow size relative to the coarse grid
+};
+layout(std430, binding = 1) readonly buffer CellsIn { vec4 cellsIn[]; };
+layout(std430, binding = 2) writeonly buffer CellsOut { vec4 cellsOut[]; };
+
+// Must match AdaptiveArrowCountersGpu in GpuResources.hpp.
+layout(std430, binding = 25) buffer AdaptiveArrowCounters {
+    uint cellCount[4];        // coarse, ping, pong, unused
+    uint arrowGroups[12];     // (groups, 1, 1) per ComputeDispatch::kLocalSizes entry
+};
+
+uniform uint u_pass;
+uniform uint u_in;            // cellCount index of the input list, 0 = the grid
+uniform uint u_out;
+uniform uint u_maxLevel;
+uniform vec3 u_coarseHalfExtent;
+uniform float u_refineThreshold;
+uniform float u_cullingThreshold;
+uniform vec3 u_boundsMin;
+uniform vec3 u_boundsMax;
+uniform vec3 u_gridDensity;
+uniform sampler3D u_bakedField;
+
+vec3 fieldAt(vec3 localPos) {
+    vec3 uvw = (localPos - u_boundsMin) / max(u_boundsMax - u_boundsMin, vec3(1e-6));
+    return textureLod(u_bakedField, uvw, 0.0).xyz;
+}
+
+// Must match gridSample in field_visualizer_comp.glsl.
+vec3 gridSample(uint index) {
+    uvec3 d = uvec3(u_gridDensity);
+    uvec3 c = uvec3(index / (d.y * d.z), (index / d.z) % d.y, index % d.z);
+    vec3 t = mix(vec3(0.5), vec3(c) / vec3(max(d, uvec3(2u)) - 1u), greaterThan(d, uvec3(1u)));
+    return mix(u_boundsMin, u_boundsMax, t);
+}
+
+void main()
+{
+    if (u_pass == 1u) {
+        // Must match ComputeDispatch::kLocalSizes.
+        const uint localSizes[4] = uint[4](64u, 128u, 256u, 512u);
+        for (int i = 0; i < 4; ++i) {
+            arrowGroups[i * 3] = (sampleHeader.x + localSizes[i] - 1u) / localSizes[i];
+            arrowGroups[i * 3 + 1] = 1u;
+            arrowGroups[i * 3 + 2] = 1u;
+        }
+        return;
+    }
+
+    uint gid = gl_GlobalInvocationID.x;
+    if (gid >= cellCount[u_in]) return;
+
+    vec4 cell = u_in == 0u ? vec4(gridSample(gid), 0.0) : cellsIn[gid];
+    uint level = uint(cell.w);
+    vec3 halfExtent = u_coarseHalfExtent / float(1u << level);
+
+    if (level < u_maxLevel) {
+        vec3 centre = fieldAt(cell.xyz);
+        float strongest = length(centre);
+        float variation = 0.0;
+        for (int i = 0; i < 8; ++i) {
+            vec3 corner = vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+            vec3 f = fieldAt(cell.xyz + corner * halfExtent);
+            strongest = max(strongest, length(f));
+            variation = max(variation, length(f - centre));
+        }
+        if (strongest > u_cullingThreshold && variation > u_refineThreshold * strongest) {
+            uint first = atomicAdd(cellCount[u_out], 8u);
+            for (int i = 0; i < 8; ++i) {
+                vec3 corner = vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+                cellsOut[first + uint(i)] = vec4(cell.xyz + 0.5 * corner * halfExtent, float(level + 1u));
+            }
+            return;
+        }
+    }
+    samplePoints[atomicAdd(sampleHeader.x, 1u)] = vec4(cell.xyz, 1.0 / float(1u << level));
+}
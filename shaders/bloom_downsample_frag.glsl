@@ -0,0 +1,17 @@
+#version 430 core
+// One step down the bloom mip chain: four bilinear taps straddling the
+// destination texel average a 4x4 block of the source (twice the size).
+in vec2 vUV;
+out vec4 FragColor;
+
+uniform sampler2D u_source;
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(u_source, 0));
+    vec3 sum = texture(u_source, vUV + texel * vec2(-1.0, -1.0)).rgb
+             + texture(u_source, vUV + texel * vec2( 1.0, -1.0)).rgb
+             + texture(u_source, vUV + texel * vec2(-1.0,  1.0)).rgb
+             + texture(u_source, vUV + texel * vec2( 1.0,  1.0)).rgb;
+    FragColor = vec4(sum * 0.25, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 430 core
+// One step up the bloom mip chain: a 3x3 tent over the smaller level,
+// added (GL_ONE, GL_ONE) onto the next larger one.
+in vec2 vUV;
+out vec4 FragColor;
+
+uniform sampler2D u_source;
+uniform float u_radius = 1.0; // tent spacing in source texels
+
+void main()
+{
+    vec2 d = u_radius / vec2(textureSize(u_source, 0));
+    vec3 sum = texture(u_source, vUV).rgb * 4.0;
+    sum += (texture(u_source, vUV + vec2(-d.x, 0.0)).rgb + texture(u_source, vUV + vec2(d.x, 0.0)).rgb
+          + texture(u_source, vUV + vec2(0.0, -d.y)).rgb + texture(u_source, vUV + vec2(0.0, d.y)).rgb) * 2.0;
+    sum += texture(u_source, vUV + vec2(-d.x, -d.y)).rgb + texture(u_source, vUV + vec2(d.x, -d.y)).rgb
+         + texture(u_source, vUV + vec2(-d.x,  d.y)).rgb + texture(u_source, vUV + vec2(d.x,  d.y)).rgb;
+    FragColor = vec4(sum / 16.0, 1.0);
+}
@@ -3,8 +3,8 @@ out vec4 FragColor;
 
 in vec2 g_uv; // Interpolated UVs from the geometry shader (-1 to 1)
 
-uniform vec4 u_glowColour;
-uniform vec4 u_coreColour;
+flat in vec4 g_glowColour;
+flat in vec4 g_coreColour;
 
 void main()
 {
@@ -21,8 +21,8 @@ void main()
     falloff = pow(falloff, 1.0);
 
     float core_strength = smoothstep(0.5, 1.0, falloff);
-    vec4 core = vec4(u_coreColour.rgb, u_coreColour.a * core_strength);
-    vec4 halo = vec4(u_glowColour.rgb, u_glowColour.a * falloff);
+    vec4 core = vec4(g_coreColour.rgb, g_coreColour.a * core_strength);
+    vec4 halo = vec4(g_glowColour.rgb, g_glowColour.a * falloff);
 
     // Blend the core over the halo
     vec3 mixed_rgb = mix(halo.rgb, core.rgb, core.a);
@@ -0,0 +1,109 @@
+#version 430 core
+
+// Cluster culling of large batched meshes: one row of workgroups per mesh
+// instance, one thread per MeshArena cluster. A cluster survives unless it
+// is outside the frustum, faces away from the eye as a whole (its normal
+// cone, only present on closed meshes), or lies behind the Hi-Z pyramid
+// (u_hizLevels > 0). Survivors append a DrawElementsIndirectCommand;
+// the header counts them for glMultiDrawElementsIndirectCount, and the
+// cleared tail draws nothing without it.
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+struct Cluster {
+    vec4 sphere;              // object-space centre, radius
+    vec4 cone;                // axis, cutoff (> 1: none)
+    uint firstIndex;
+    uint indexCount;
+    uint padding[2];
+};
+
+struct ClusterInstance {
+    mat4 model;
+    vec4 eye;                 // camera in object space; w = largest axis scale
+    uint firstCluster;
+    uint clusterCount;
+    int  baseVertex;
+    uint baseInstance;
+};
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int  baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 30) readonly buffer ClusterInstances { ClusterInstance instances[]; };
+layout(std430, binding = 31) readonly buffer Clusters { Cluster clusters[]; };
+layout(std430, binding = 32) buffer ClusterDraws {
+    uvec4 drawHeader;         // x = draws appended
+    DrawCommand draws[];
+};
+
+#include "frame_uniforms.glsl"
+
+uniform vec4 u_frustum[6];    // world-space planes, inside where dot(n, p) + d >= 0
+uniform bool u_coneCulling;   // off for orthographic views: the eye is no point
+uniform sampler2D u_hiz;      // hiz_build_comp's pyramid, level 0 at half resolution
+uniform int  u_hizLevels;     // 0: no pyramid this frame
+uniform uint u_instanceCount;
+uniform vec2 u_viewSize;      // pixels this view drew, not the output size
+uniform bool u_reverseZ;      // ZERO_TO_ONE clip depth, far is 0
+
+// As occlusion_cull_comp's test, for the sphere's world box.
+bool visibleInPyramid(vec3 boundsMin, vec3 boundsMax)
+{
+    mat4 viewProjection = u_frameProjection * u_frameView;
+    vec3 ndcMin = vec3(1e30), ndcMax = vec3(-1e30);
+    for (int corner = 0; corner < 8; ++corner) {
+        vec3 p = mix(boundsMin, boundsMax, vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1));
+        vec4 clip = viewProjection * vec4(p, 1.0);
+        if (clip.w <= 1e-6) return true;
+        vec3 ndc = clip.xyz / clip.w;
+        ndcMin = min(ndcMin, ndc);
+        ndcMax = max(ndcMax, ndc);
+    }
+    float nearest = u_reverseZ ? ndcMax.z : ndcMin.z * 0.5 + 0.5;
+
+    ivec2 view = ivec2(u_viewSize);
+    ivec2 pixelMin = clamp(ivec2(floor((ndcMin.xy * 0.5 + 0.5) * u_viewSize)), ivec2(0), view - 1);
+    ivec2 pixelMax = clamp(ivec2(floor((ndcMax.xy * 0.5 + 0.5) * u_viewSize)), ivec2(0), view - 1);
+    ivec2 extent = pixelMax - pixelMin;
+    int level = clamp(findMSB(max(extent.x, extent.y)), 0, u_hizLevels - 1);
+    ivec2 size = max(ivec2(1), view >> (level + 1));
+    ivec2 first = min(pixelMin >> (level + 1), size - 1);
+    ivec2 last = min(pixelMax >> (level + 1), size - 1);
+
+    float farthest = u_reverseZ ? 1.0 : 0.0;
+    for (int y = first.y; y <= last.y; ++y)
+        for (int x = first.x; x <= last.x; ++x) {
+            float depth = texelFetch(u_hiz, ivec2(x, y), level).r;
+            farthest = u_reverseZ ? min(farthest, depth) : max(farthest, depth);
+        }
+    return u_reverseZ ? nearest >= farthest : nearest <= farthest;
+}
+
+void main()
+{
+    uint instanceIndex = gl_WorkGroupID.y;
+    if (instanceIndex >= u_instanceCount) return;
+    ClusterInstance instance = instances[instanceIndex];
+    uint c = gl_GlobalInvocationID.x;
+    if (c >= instance.clusterCount) return;
+    Cluster cluster = clusters[instance.firstCluster + c];
+
+    // Back-facing as a whole: tested in object space, where the cone was built.
+    vec3 toCluster = cluster.sphere.xyz - instance.eye.xyz;
+    if (u_coneCulling && dot(toCluster, cluster.cone.xyz) >= cluster.cone.w * length(toCluster) + cluster.sphere.w) return;
+
+    vec3 centre = (instance.model * vec4(cluster.sphere.xyz, 1.0)).xyz;
+    float radius = cluster.sphere.w * instance.eye.w;
+    for (int p = 0; p < 6; ++p)
+        if (dot(u_frustum[p].xyz, centre) + u_frustum[p].w < -radius) return;
+
+    if (u_hizLevels > 0 && !visibleInPyramid(centre - radius, centre + radius)) return;
+
+    uint slot = atomicAdd(drawHeader.x, 1u);
+    draws[slot] = DrawCommand(cluster.indexCount, 1u, cluster.firstIndex, instance.baseVertex, instance.baseInstance);
+}
@@ -1,13 +1,112 @@
 ﻿#version 430 core
 
+// The final full-screen pass, generated per effect combination: the C++
+// side (RenderingSystem::postShader) defines KR_POST_EFFECTS as a mask of
+// RenderingSystem::PostEffect bits, and every effect not in it compiles
+// away. Order: scene (anti-aliased, or upscaled if drawn smaller), fog,
+// glow, tonemap, saturation, vignette; one read of the scene, one write of
+// the output.
+#ifndef KR_POST_EFFECTS
+#define KR_POST_EFFECTS 7   // glow, tonemap, saturation: the default stack
+#endif
+#define KR_POST(bit) ((KR_POST_EFFECTS & (bit)) != 0)
+#define KR_POST_GLOW       1
+#define KR_POST_TONEMAP    2
+#define KR_POST_SATURATION 4
+#define KR_POST_FOG        8
+#define KR_POST_VIGNETTE   16
+#define KR_POST_BICUBIC    32   // set while the view was drawn below output resolution (dynamic resolution)
+#define KR_POST_FXAA       64   // RenderingSystem::AntiAliasing::Fxaa; takes the place of the bicubic upscale
+
 in  vec2 vUV;
 layout(location = 0) out vec4 fragColor;
 
 uniform sampler2D sceneTexture;
+uniform vec2      u_uvScale     = vec2(1.0); // shared with post_process_vert
+#if KR_POST(KR_POST_GLOW)
 uniform sampler2D glowTexture;
 uniform float     glowIntensity = 1.0;
+#endif
+#if KR_POST(KR_POST_TONEMAP)
 uniform float     exposure      = 1.0;
-uniform float     saturation    = 1.2; // NEW: Saturation control. 1.0 is normal, > 1.0 boosts saturation.
+#endif
+#if KR_POST(KR_POST_SATURATION)
+uniform float     saturation    = 1.2; // 1.0 is normal, > 1.0 boosts saturation
+#endif
+#if KR_POST(KR_POST_FOG)
+uniform sampler2D u_depth;
+uniform mat4      u_inverseProjection;
+uniform bool      u_reverseZ;
+uniform vec3      u_fogColor;          // linear
+uniform float     u_fogDensity;        // per metre of view distance
+#endif
+#if KR_POST(KR_POST_VIGNETTE)
+uniform float     u_vignette;          // darkening at the corners, 0..1
+#endif
+
+// Catmull-Rom upscale in five bilinear taps (the four corner taps carry
+// almost no weight and are dropped). Taps stay inside the drawn region.
+vec3 sampleCatmullRom(sampler2D tex, vec2 uv)
+{
+    vec2 size = vec2(textureSize(tex, 0));
+    vec2 lo = 0.5 / size;
+    vec2 hi = u_uvScale - 0.5 / size;
+
+    vec2 pos = uv * size;
+    vec2 p1 = floor(pos - 0.5) + 0.5;
+    vec2 f = pos - p1;
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+    vec2 w12 = w1 + w2;
+
+    vec2 uv0  = clamp((p1 - 1.0) / size, lo, hi);
+    vec2 uv3  = clamp((p1 + 2.0) / size, lo, hi);
+    vec2 uv12 = clamp((p1 + w2 / w12) / size, lo, hi);
+
+    vec3 sum = texture(tex, vec2(uv12.x, uv0.y)).rgb  * (w12.x * w0.y)
+             + texture(tex, vec2(uv0.x,  uv12.y)).rgb * (w0.x  * w12.y)
+             + texture(tex, uv12).rgb                 * (w12.x * w12.y)
+             + texture(tex, vec2(uv3.x,  uv12.y)).rgb * (w3.x  * w12.y)
+             + texture(tex, vec2(uv12.x, uv3.y)).rgb  * (w12.x * w3.y);
+    float weight = w12.x * w0.y + w0.x * w12.y + w12.x * w12.y + w3.x * w12.y + w12.x * w3.y;
+    return max(sum / weight, vec3(0.0));
+}
+
+#if KR_POST(KR_POST_FXAA)
+// FXAA in its compact form: the luma gradient of four diagonal taps gives the
+// edge direction, two or four taps along it blend across the edge, and the
+// wider blend is dropped where it leaves the local luma range. Luma comes
+// from the scene compressed towards [0, 1), since it is still HDR here.
+float fxaaLuma(vec3 c) { return dot(c / (1.0 + c), vec3(0.299, 0.587, 0.114)); }
+
+vec3 sampleFxaa(sampler2D tex, vec2 uv)
+{
+    vec2 texel = 1.0 / vec2(textureSize(tex, 0));
+    vec2 lo = 0.5 * texel, hi = u_uvScale - 0.5 * texel;
+    float nw = fxaaLuma(texture(tex, clamp(uv + vec2(-0.5, -0.5) * texel, lo, hi)).rgb);
+    float ne = fxaaLuma(texture(tex, clamp(uv + vec2( 0.5, -0.5) * texel, lo, hi)).rgb);
+    float sw = fxaaLuma(texture(tex, clamp(uv + vec2(-0.5,  0.5) * texel, lo, hi)).rgb);
+    float se = fxaaLuma(texture(tex, clamp(uv + vec2( 0.5,  0.5) * texel, lo, hi)).rgb);
+    vec3 centre = texture(tex, uv).rgb;
+    float m = fxaaLuma(centre);
+    float lumaMin = min(m, min(min(nw, ne), min(sw, se)));
+    float lumaMax = max(m, max(max(nw, ne), max(sw, se)));
+    if (lumaMax - lumaMin < max(0.0312, lumaMax * 0.125)) return centre;   // no edge worth the taps
+
+    vec2 dir = vec2(-((nw + ne) - (sw + se)), (nw + sw) - (ne + se));
+    float reduce = max((nw + ne + sw + se) * 0.25 * (1.0 / 8.0), 1.0 / 128.0);
+    dir = clamp(dir / (min(abs(dir.x), abs(dir.y)) + reduce), vec2(-8.0), vec2(8.0)) * texel;
+
+    vec3 a = 0.5 * (texture(tex, clamp(uv + dir * (1.0 / 3.0 - 0.5), lo, hi)).rgb
+                  + texture(tex, clamp(uv + dir * (2.0 / 3.0 - 0.5), lo, hi)).rgb);
+    vec3 b = a * 0.5 + 0.25 * (texture(tex, clamp(uv - dir * 0.5, lo, hi)).rgb
+                             + texture(tex, clamp(uv + dir * 0.5, lo, hi)).rgb);
+    float lumaB = fxaaLuma(b);
+    return (lumaB < lumaMin || lumaB > lumaMax) ? a : b;
+}
+#endif
 
 vec3 ACESFilmic(vec3 color)
 {
@@ -22,20 +121,43 @@ vec3 ACESFilmic(vec3 color)
 
 void main()
 {
-    vec3 scene = texture(sceneTexture, vUV).rgb;
-    vec3 glow  = texture(glowTexture , vUV).rgb * glowIntensity;
-    vec3 blended = 1.0 - (1.0 - scene) * (1.0 - glow);
-
-    // 1. Apply tone mapping
-    vec3 mapped = ACESFilmic(blended * exposure);
-
-    // 2. NEW: Apply saturation adjustment
-    // Calculate the grayscale (luminance) of the color
-    float luma = dot(mapped, vec3(0.2126, 0.7152, 0.0722));
-    vec3 grayscale = vec3(luma);
-    
-    // Linearly interpolate between the grayscale and original color
-    vec3 saturated = mix(grayscale, mapped, saturation);
-
-    fragColor = vec4(saturated, 1.0);
-}
\ No newline at end of file
+#if KR_POST(KR_POST_FXAA)
+    vec3 color = sampleFxaa(sceneTexture, vUV);
+#elif KR_POST(KR_POST_BICUBIC)
+    vec3 color = sampleCatmullRom(sceneTexture, vUV);
+#else
+    vec3 color = texture(sceneTexture, vUV).rgb;
+#endif
+
+#if KR_POST(KR_POST_FOG)
+    // View distance from the depth buffer; the reversed-Z far plane is at
+    // infinity (w = 0), which fogs fully.
+    float depth = texture(u_depth, vUV).r;
+    vec3 ndc = vec3(vUV / u_uvScale * 2.0 - 1.0, u_reverseZ ? depth : depth * 2.0 - 1.0);
+    vec4 view = u_inverseProjection * vec4(ndc, 1.0);
+    float distance = abs(view.w) > 1e-6 ? length(view.xyz / view.w) : 1e30;
+    color = mix(u_fogColor, color, exp(-u_fogDensity * distance));
+#endif
+
+#if KR_POST(KR_POST_GLOW)
+    vec3 glow = texture(glowTexture, vUV).rgb * glowIntensity;
+    color = 1.0 - (1.0 - color) * (1.0 - glow);
+#endif
+
+#if KR_POST(KR_POST_TONEMAP)
+    color = ACESFilmic(color * exposure);
+#endif
+
+#if KR_POST(KR_POST_SATURATION)
+    // Between the grey of the same luminance and the colour.
+    float luma = dot(color, vec3(0.2126, 0.7152, 0.0722));
+    color = mix(vec3(luma), color, saturation);
+#endif
+
+#if KR_POST(KR_POST_VIGNETTE)
+    vec2 fromCentre = vUV / u_uvScale - 0.5;
+    color *= 1.0 - u_vignette * smoothstep(0.3, 0.75, length(fromCentre) * 1.41421);
+#endif
+
+    fragColor = vec4(color, 1.0);
+}
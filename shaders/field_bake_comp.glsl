@@ -0,0 +1,156 @@
+#version 430 core
+
+// Evaluates the effector field once per texel into the visualizer's baked
+// RGBA16F 3D texture. Texel centres map to bounds.min + (ijk + 0.5) / size * extent
+// in visualizer space, matching hardware trilinear sampling.
+layout (local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+// --- GPU Data Structures (must match GpuResources.hpp) ---
+struct PointEffectorGpu {
+    vec4 position;
+    vec4 normal;
+    float strength;
+    float radius;
+    int falloffType;
+    float padding;
+};
+
+struct DirectionalEffectorGpu {
+    vec4 direction;
+    float strength;
+    float padding1, padding2, padding3;
+};
+
+// Effector streams: { uvec4 header; T items[]; }, item count in header.x.
+layout(std430, binding = 3) readonly buffer PointEffectorBuffer {
+    uvec4 pointHeader;
+    PointEffectorGpu pointEffectors[];
+};
+layout(std430, binding = 8) readonly buffer DirectionalEffectorBuffer {
+    uvec4 directionalHeader;
+    DirectionalEffectorGpu directionalEffectors[];
+};
+
+#include "mesh_effector_field.glsl"
+
+// Must match PointCloudEffectorGpu in GpuResources.hpp. Each cloud's grid
+// (see PointCloudGrid) sits in the shared bucket and point streams.
+struct PointCloudEffectorGpu {
+    mat4 worldToCloud;
+    float strength;
+    float radius;
+    float cellSize;
+    uint bucketMask;
+    uint firstBucket;
+    uint firstPoint;
+    uint padding0, padding1;
+};
+layout(std430, binding = 16) readonly buffer PointCloudEffectorBuffer {
+    uvec4 cloudHeader;
+    PointCloudEffectorGpu cloudEffectors[];
+};
+layout(std430, binding = 17) readonly buffer PointCloudBucketBuffer {
+    uvec4 cloudBucketHeader;
+    uint cloudBuckets[];
+};
+layout(std430, binding = 18) readonly buffer PointCloudPointBuffer {
+    uvec4 cloudPointHeader;
+    vec4 cloudPoints[];
+};
+
+layout(rgba16f, binding = 0) writeonly uniform image3D u_fieldImage;
+
+uniform mat4 u_visualizerModelMatrix;
+uniform vec3 u_boundsMin;
+uniform vec3 u_boundsMax;
+uniform int u_firstSlice;   // z slices [u_firstSlice, u_sliceEnd) of the texture; dispatched from z 0
+uniform int u_sliceEnd;
+
+uint hashCloudCell(ivec3 c, uint mask) {
+    return ((uint(c.x) * 73856093u) ^ (uint(c.y) * 19349663u) ^ (uint(c.z) * 83492791u)) & mask;
+}
+
+// Pushes p away from the nearest scanned point of each point-cloud effector.
+// Cells are half the radius: at most 5^3 hashed cells are searched, ring by
+// ring, stopping once the next ring cannot hold anything closer.
+vec3 pointCloudField(vec3 p) {
+    vec3 field = vec3(0.0);
+    for (uint c = 0u; c < cloudHeader.x; ++c) {
+        PointCloudEffectorGpu cloud = cloudEffectors[c];
+        vec3 q = (cloud.worldToCloud * vec4(p, 1.0)).xyz;
+        ivec3 home = ivec3(floor(q / cloud.cellSize));
+        float bestSq = cloud.radius * cloud.radius;
+        vec3 nearest = q;
+        bool found = false;
+        for (int ring = 0; ring <= 2; ++ring) {
+            for (int z = -ring; z <= ring; ++z)
+            for (int y = -ring; y <= ring; ++y)
+            for (int x = -ring; x <= ring; ++x) {
+                if (max(abs(x), max(abs(y), abs(z))) != ring) continue;
+                uint b = cloud.firstBucket + hashCloudCell(home + ivec3(x, y, z), cloud.bucketMask);
+                for (uint i = cloudBuckets[b]; i < cloudBuckets[b + 1u]; ++i) {
+                    vec3 s = cloudPoints[cloud.firstPoint + i].xyz;
+                    vec3 d = q - s;
+                    float dSq = dot(d, d);
+                    if (dSq < bestSq) { bestSq = dSq; nearest = s; found = true; }
+                }
+            }
+            float reach = float(ring) * cloud.cellSize;
+            if (found && bestSq <= reach * reach) break;
+        }
+        float dist = sqrt(bestSq);
+        if (found && dist > 1e-6) {
+            // Rotation and uniform scale only: the transpose maps the direction back to world space.
+            vec3 away = normalize(transpose(mat3(cloud.worldToCloud)) * (q - nearest));
+            field += away * cloud.strength * (1.0 - dist / cloud.radius);
+        }
+    }
+    return field;
+}
+
+// Field from every effector stream at worldPos.
+vec3 evaluateEffectors(vec3 worldPos) {
+    vec3 totalField = vec3(0.0);
+
+    // Point and Spline Proxy Effectors
+    for (int i = 0; i < int(pointHeader.x); ++i) {
+        vec3 diff = worldPos - pointEffectors[i].position.xyz;
+        float dist = length(diff);
+        if (dist < pointEffectors[i].radius && dist > 0.001) {
+            float strength = pointEffectors[i].strength;
+            vec3 forceDir;
+            if (pointEffectors[i].falloffType == 1) {
+                strength *= (1.0 - dist / pointEffectors[i].radius);
+            }
+            if (length(pointEffectors[i].normal.xyz) > 0.1) {
+                forceDir = normalize(pointEffectors[i].normal.xyz);
+            } else {
+                forceDir = normalize(diff);
+            }
+            totalField += forceDir * strength;
+        }
+    }
+
+    // Triangle Mesh Effectors
+    totalField += meshEffectorField(worldPos);
+    totalField += pointCloudField(worldPos);
+
+    // Directional Effectors
+    for (int i = 0; i < int(directionalHeader.x); ++i) {
+        totalField += directionalEffectors[i].direction.xyz * directionalEffectors[i].strength;
+    }
+    return totalField;
+}
+
+void main()
+{
+    ivec3 size = imageSize(u_fieldImage);
+    ivec3 texel = ivec3(gl_GlobalInvocationID) + ivec3(0, 0, u_firstSlice);
+    if (any(greaterThanEqual(texel, size)) || texel.z >= u_sliceEnd) return;
+
+    vec3 t = (vec3(texel) + 0.5) / vec3(size);
+    vec3 localPos = mix(u_boundsMin, u_boundsMax, t);
+    vec3 worldPos = (u_visualizerModelMatrix * vec4(localPos, 1.0)).xyz;
+
+    imageStore(u_fieldImage, texel, vec4(evaluateEffectors(worldPos), 0.0));
+}
@@ -0,0 +1,21 @@
+#version 430 core
+
+// Temporal field mode: the baked field a visualizer's modes sample, as the
+// blend of two keyframes from its ring (RenderingSystem::ensureTemporalField).
+// Same resolution throughout, so texel for texel.
+layout (local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+layout(rgba16f, binding = 0) writeonly uniform image3D u_fieldImage;
+layout(rgba16f, binding = 1) readonly uniform image3D u_keyA;   // the older keyframe
+layout(rgba16f, binding = 2) readonly uniform image3D u_keyB;
+
+uniform float u_blend;   // 0 shows u_keyA, 1 u_keyB
+
+void main()
+{
+    ivec3 size = imageSize(u_fieldImage);
+    ivec3 texel = ivec3(gl_GlobalInvocationID);
+    if (any(greaterThanEqual(texel, size))) return;
+
+    imageStore(u_fieldImage, texel, mix(imageLoad(u_keyA, texel), imageLoad(u_keyB, texel), u_blend));
+}
@@ -1,6 +1,10 @@
 #version 430 core
 
-layout (local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+// Built per workgroup size by ComputeDispatch; 256 when compiled plain.
+#ifndef KR_LOCAL_SIZE_X
+#define KR_LOCAL_SIZE_X 256
+#endif
+layout (local_size_x = KR_LOCAL_SIZE_X, local_size_y = 1, local_size_z = 1) in;
 
 // --- GPU Data Structures (must match GpuResources.hpp) ---
 struct PointEffectorGpu {
@@ -18,13 +22,6 @@ struct DirectionalEffectorGpu {
     float padding1, padding2, padding3;
 };
 
-struct TriangleGpu {
-    vec4 v0; // w component stores strength
-    vec4 v1;
-    vec4 v2;
-    vec4 normal; // w component stores radius
-};
-
 // --- Buffer Definitions ---
 struct InstanceData {
     mat4 modelMatrix;
@@ -32,23 +29,72 @@ struct InstanceData {
     vec4 padding;
 };
 
-layout(std430, binding = 0) readonly buffer SamplePointsBuffer { vec4 samplePoints[]; };
+// Adaptive arrows only (the uniform grid is derived from the invocation
+// index): header x = sample count; points: xyz in visualizer space,
+// w = arrow size, 1 / 2^level of the refined cell.
+layout(std430, binding = 0) readonly buffer SamplePointsBuffer {
+    uvec4 sampleHeader;
+    vec4 samplePoints[];
+};
 layout(std430, binding = 1) buffer InstanceOutputBuffer { InstanceData instanceData[]; };
-layout(std430, binding = 2) buffer DrawCommandUbo {
+struct DrawCommand {
     uint count;
     uint instanceCount;
     uint firstIndex;
     uint baseVertex;
     uint baseInstance;
-} drawCommand;
+};
+// One command; batched, one per entry of ArrowBatchBuffer.
+layout(std430, binding = 2) buffer DrawCommandUbo { DrawCommand drawCommands[]; };
 
-layout(std140, binding = 3) uniform EffectorDataUbo {
-    PointEffectorGpu pointEffectors[256];
-    DirectionalEffectorGpu directionalEffectors[16];
+// Must match ArrowBatchEntryGpu in GpuResources.hpp.
+struct ArrowBatchEntry {
+    mat4 model;
+    vec4 boundsMin;           // w = vector scale
+    vec4 boundsMax;           // w = head scale
+    vec4 density;             // w = culling threshold
+    uint firstSample;
+    uint firstInstance;
+    uint gradientRow;
+    uint padding0;
+};
+layout(std430, binding = 29) readonly buffer ArrowBatchBuffer { ArrowBatchEntry batchEntries[]; };
+
+// Effector streams: { uvec4 header; T items[]; }, item count in header.x.
+layout(std430, binding = 3) readonly buffer PointEffectorBuffer {
+    uvec4 pointHeader;
+    PointEffectorGpu pointEffectors[];
+};
+layout(std430, binding = 8) readonly buffer DirectionalEffectorBuffer {
+    uvec4 directionalHeader;
+    DirectionalEffectorGpu directionalEffectors[];
 };
 
-layout(std430, binding = 4) readonly buffer TriangleEffectorBuffer {
-    TriangleGpu triangleEffectors[];
+#include "mesh_effector_field.glsl"
+
+// Must match PointCloudEffectorGpu in GpuResources.hpp. Each cloud's grid
+// (see PointCloudGrid) sits in the shared bucket and point streams.
+struct PointCloudEffectorGpu {
+    mat4 worldToCloud;
+    float strength;
+    float radius;
+    float cellSize;
+    uint bucketMask;
+    uint firstBucket;
+    uint firstPoint;
+    uint padding0, padding1;
+};
+layout(std430, binding = 16) readonly buffer PointCloudEffectorBuffer {
+    uvec4 cloudHeader;
+    PointCloudEffectorGpu cloudEffectors[];
+};
+layout(std430, binding = 17) readonly buffer PointCloudBucketBuffer {
+    uvec4 cloudBucketHeader;
+    uint cloudBuckets[];
+};
+layout(std430, binding = 18) readonly buffer PointCloudPointBuffer {
+    uvec4 cloudPointHeader;
+    vec4 cloudPoints[];
 };
 
 // --- Uniforms ---
@@ -56,11 +102,40 @@ uniform mat4 u_visualizerModelMatrix;
 uniform float u_vectorScale;
 uniform float u_arrowHeadScale;
 uniform float u_cullingThreshold;
-uniform int u_pointEffectorCount;
-uniform int u_directionalEffectorCount;
-uniform int u_triangleEffectorCount;
+
+uniform bool u_gridSamples;          // sample the uniform grid, not SamplePointsBuffer
+uniform vec3 u_gridDensity;          // samples per axis
+uniform vec3 u_boundsMin;            // visualizer space
+uniform vec3 u_boundsMax;
+
+uniform uint u_batchCount;           // > 0: the uniform grids of ArrowBatchBuffer instead
+uniform uint u_batchSamples;         // their total sample count
+
+uniform bool u_useBakedField;
+uniform sampler3D u_bakedField;
+uniform mat4 u_worldToFieldUVW;      // world -> [0,1]^3 over the visualizer bounds
+
+uniform sampler2D u_gradientAtlas;   // one baked gradient per row
+uniform uint u_gradientRow;          // intensity gradient of the unbatched grid
+
+// Row 'row' of the gradient atlas (GradientLut texels, RenderingSystem::gradientRow)
+// at 'value' in [0, 1]; the ends fall on the first and last texel centres.
+vec4 sampleGradient(uint row, float value)
+{
+    vec2 size = vec2(textureSize(u_gradientAtlas, 0));
+    vec2 uv = vec2((0.5 + clamp(value, 0.0, 1.0) * (size.x - 1.0)) / size.x, (float(row) + 0.5) / size.y);
+    return textureLod(u_gradientAtlas, uv, 0.0);
+}
 
 // --- Helper Functions ---
+// Sample 'index' of the uniform grid: x slowest, z fastest; an axis with a
+// single sample puts it mid-bounds. Must match arrow_refine_comp.glsl.
+vec3 gridSample(uint index, uvec3 d, vec3 boundsMin, vec3 boundsMax) {
+    uvec3 c = uvec3(index / (d.y * d.z), (index / d.z) % d.y, index % d.z);
+    vec3 t = mix(vec3(0.5), vec3(c) / vec3(max(d, uvec3(2u)) - 1u), greaterThan(d, uvec3(1u)));
+    return mix(boundsMin, boundsMax, t);
+}
+
 mat4 rotationBetweenVectors(vec3 start, vec3 dest) {
     start = normalize(start);
     dest = normalize(dest);
@@ -86,59 +161,54 @@ mat4 rotationBetweenVectors(vec3 start, vec3 dest) {
     return mat4(R);
 }
 
-vec3 closestPointOnTriangle(vec3 p, vec3 a, vec3 b, vec3 c) {
-    vec3 ab = b - a;
-    vec3 ac = c - a;
-    vec3 ap = p - a;
-    float d1 = dot(ab, ap);
-    float d2 = dot(ac, ap);
-    if (d1 <= 0.0 && d2 <= 0.0) return a;
-
-    vec3 bp = p - b;
-    float d3 = dot(ab, bp);
-    float d4 = dot(ac, bp);
-    if (d3 >= 0.0 && d4 <= d3) return b;
-
-    float vc = d1 * d4 - d3 * d2;
-    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
-        float v = d1 / (d1 - d3);
-        return a + v * ab;
-    }
-
-    vec3 cp = p - c;
-    float d5 = dot(ab, cp);
-    float d6 = dot(ac, cp);
-    if (d6 >= 0.0 && d5 <= d6) return c;
-
-    float vb = d5 * d2 - d1 * d6;
-    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
-        float w = d2 / (d2 - d6);
-        return a + w * ac;
-    }
+uint hashCloudCell(ivec3 c, uint mask) {
+    return ((uint(c.x) * 73856093u) ^ (uint(c.y) * 19349663u) ^ (uint(c.z) * 83492791u)) & mask;
+}
 
-    float va = d3 * d6 - d5 * d4;
-    if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {
-        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
-        return b + w * (c - b);
+// Pushes p away from the nearest scanned point of each point-cloud effector.
+// Cells are half the radius: at most 5^3 hashed cells are searched, ring by
+// ring, stopping once the next ring cannot hold anything closer.
+vec3 pointCloudField(vec3 p) {
+    vec3 field = vec3(0.0);
+    for (uint c = 0u; c < cloudHeader.x; ++c) {
+        PointCloudEffectorGpu cloud = cloudEffectors[c];
+        vec3 q = (cloud.worldToCloud * vec4(p, 1.0)).xyz;
+        ivec3 home = ivec3(floor(q / cloud.cellSize));
+        float bestSq = cloud.radius * cloud.radius;
+        vec3 nearest = q;
+        bool found = false;
+        for (int ring = 0; ring <= 2; ++ring) {
+            for (int z = -ring; z <= ring; ++z)
+            for (int y = -ring; y <= ring; ++y)
+            for (int x = -ring; x <= ring; ++x) {
+                if (max(abs(x), max(abs(y), abs(z))) != ring) continue;
+                uint b = cloud.firstBucket + hashCloudCell(home + ivec3(x, y, z), cloud.bucketMask);
+                for (uint i = cloudBuckets[b]; i < cloudBuckets[b + 1u]; ++i) {
+                    vec3 s = cloudPoints[cloud.firstPoint + i].xyz;
+                    vec3 d = q - s;
+                    float dSq = dot(d, d);
+                    if (dSq < bestSq) { bestSq = dSq; nearest = s; found = true; }
+                }
+            }
+            float reach = float(ring) * cloud.cellSize;
+            if (found && bestSq <= reach * reach) break;
+        }
+        float dist = sqrt(bestSq);
+        if (found && dist > 1e-6) {
+            // Rotation and uniform scale only: the transpose maps the direction back to world space.
+            vec3 away = normalize(transpose(mat3(cloud.worldToCloud)) * (q - nearest));
+            field += away * cloud.strength * (1.0 - dist / cloud.radius);
+        }
     }
-
-    float denom = 1.0 / (va + vb + vc);
-    float v = vb * denom;
-    float w = vc * denom;
-    return a + ab * v + ac * w;
+    return field;
 }
 
-// --- Main Logic ---
-void main()
-{
-    uint gid = gl_GlobalInvocationID.x;
-    if (gid >= samplePoints.length()) return;
-
-    vec3 worldPos = (u_visualizerModelMatrix * samplePoints[gid]).xyz;
+// Field from every effector stream at worldPos.
+vec3 evaluateEffectors(vec3 worldPos) {
     vec3 totalField = vec3(0.0);
 
     // Point and Spline Proxy Effectors
-    for (int i = 0; i < u_pointEffectorCount; ++i) {
+    for (int i = 0; i < int(pointHeader.x); ++i) {
         vec3 diff = worldPos - pointEffectors[i].position.xyz;
         float dist = length(diff);
         if (dist < pointEffectors[i].radius && dist > 0.001) {
@@ -157,40 +227,79 @@ void main()
     }
 
     // Triangle Mesh Effectors
-    for (int i = 0; i < u_triangleEffectorCount; ++i) {
-        TriangleGpu tri = triangleEffectors[i];
-        vec3 closestPoint = closestPointOnTriangle(worldPos, tri.v0.xyz, tri.v1.xyz, tri.v2.xyz);
-        vec3 diff = worldPos - closestPoint;
-        float dist = length(diff);
-        float radius = tri.normal.w;
-        if (dist > 0.001 && dist < radius) {
-            float strength = tri.v0.w;
-            strength *= (1.0 - dist / radius);
-            totalField += normalize(diff) * strength;
-        }
-    }
+    totalField += meshEffectorField(worldPos);
+    totalField += pointCloudField(worldPos);
 
     // Directional Effectors
-    for (int i = 0; i < u_directionalEffectorCount; ++i) {
+    for (int i = 0; i < int(directionalHeader.x); ++i) {
         totalField += directionalEffectors[i].direction.xyz * directionalEffectors[i].strength;
     }
+    return totalField;
+}
+
+// Baked mode samples the RGBA16F field cache instead (trilinear, clamped to its edges).
+vec3 evaluateField(vec3 worldPos) {
+    if (u_useBakedField) {
+        vec3 uvw = (u_worldToFieldUVW * vec4(worldPos, 1.0)).xyz;
+        return texture(u_bakedField, uvw).xyz;
+    }
+    return evaluateEffectors(worldPos);
+}
+
+// --- Main Logic ---
+void main()
+{
+    uint gid = gl_GlobalInvocationID.x;
+    mat4 model = u_visualizerModelMatrix;
+    float vectorScale = u_vectorScale, headScale = u_arrowHeadScale, cullingThreshold = u_cullingThreshold;
+    uint command = 0u, firstInstance = 0u, gradientRow = u_gradientRow;
+    vec4 samplePoint;
+    if (u_batchCount > 0u) {
+        if (gid >= u_batchSamples) return;
+        // The last entry starting at or before gid.
+        uint lo = 0u, hi = u_batchCount - 1u;
+        while (lo < hi) {
+            uint mid = (lo + hi + 1u) / 2u;
+            if (batchEntries[mid].firstSample <= gid) lo = mid; else hi = mid - 1u;
+        }
+        ArrowBatchEntry entry = batchEntries[lo];
+        model = entry.model;
+        vectorScale = entry.boundsMin.w;
+        headScale = entry.boundsMax.w;
+        cullingThreshold = entry.density.w;
+        command = lo;
+        firstInstance = entry.firstInstance;
+        gradientRow = entry.gradientRow;
+        samplePoint = vec4(gridSample(gid - entry.firstSample, uvec3(entry.density.xyz),
+                                      entry.boundsMin.xyz, entry.boundsMax.xyz), 1.0);
+    } else if (u_gridSamples) {
+        uvec3 d = uvec3(u_gridDensity);
+        if (gid >= d.x * d.y * d.z) return;
+        samplePoint = vec4(gridSample(gid, d, u_boundsMin, u_boundsMax), 1.0);
+    } else {
+        if (gid >= sampleHeader.x) return;
+        samplePoint = samplePoints[gid];
+    }
+    vec3 worldPos = (model * vec4(samplePoint.xyz, 1.0)).xyz;
+
+    vec3 totalField = evaluateField(worldPos);
 
     // --- Build Arrow Instance ---
     float magnitude = length(totalField);
-    if (magnitude > u_cullingThreshold) {
-        uint instanceIndex = atomicAdd(drawCommand.instanceCount, 1);
+    if (magnitude > cullingThreshold) {
+        uint instanceIndex = firstInstance + atomicAdd(drawCommands[command].instanceCount, 1u);
         
         mat4 trans = mat4(1.0);
         trans[3] = vec4(worldPos, 1.0);
         mat4 rot = rotationBetweenVectors(vec3(0.0, 0.0, -1.0), normalize(-totalField));
         mat4 scale = mat4(1.0);
-        scale[0][0] = u_arrowHeadScale;
-        scale[1][1] = u_arrowHeadScale;
-        scale[2][2] = magnitude * u_vectorScale;
+        scale[0][0] = headScale * samplePoint.w;
+        scale[1][1] = headScale * samplePoint.w;
+        scale[2][2] = magnitude * vectorScale * samplePoint.w;
         
         instanceData[instanceIndex].modelMatrix = trans * rot * scale;
 
         float normMag = clamp(abs(magnitude) / 5.0, 0.0, 1.0);
-        instanceData[instanceIndex].color = vec4(mix(vec3(0.2, 0.5, 1.0), vec3(1.0, 0.3, 0.3), normMag), 1.0);
+        instanceData[instanceIndex].color = sampleGradient(gradientRow, normMag);
     }
 }
@@ -0,0 +1,72 @@
+/*
+================================================================================
+|                            field_volume_frag.glsl                            |
+================================================================================
+*/
+#version 430 core
+layout (location = 0) out vec4 FragColor;
+
+in vec3 LocalPos;
+
+uniform vec3 u_eyeLocal;      // the camera in visualizer-local space
+uniform vec3 u_boundsMin;
+uniform vec3 u_boundsMax;
+
+// Either a scalar volume (R16F) or the baked field (RGBA16F), whose
+// strength divided by u_range is the value.
+uniform sampler3D u_volume;
+uniform bool u_fromField;
+uniform float u_range;
+
+uniform float u_densityScale; // opacity per unit of the bounds at value 1
+uniform float u_threshold;
+uniform int u_maxSteps;
+
+uniform sampler2D u_gradientAtlas;   // one baked gradient per row
+uniform uint u_gradientRow;
+
+vec4 sampleGradient(uint row, float value)
+{
+    vec2 size = vec2(textureSize(u_gradientAtlas, 0));
+    vec2 uv = vec2((0.5 + clamp(value, 0.0, 1.0) * (size.x - 1.0)) / size.x, (float(row) + 0.5) / size.y);
+    return textureLod(u_gradientAtlas, uv, 0.0);
+}
+
+float sampleValue(vec3 uvw)
+{
+    vec4 texel = textureLod(u_volume, uvw, 0.0);
+    return u_fromField ? length(texel.rgb) / max(u_range, 1e-6) : texel.r;
+}
+
+void main()
+{
+    // Where the eye ray through this fragment enters and leaves the box.
+    vec3 dir = normalize(LocalPos - u_eyeLocal);
+    vec3 inv = 1.0 / dir;
+    vec3 t0 = (u_boundsMin - u_eyeLocal) * inv;
+    vec3 t1 = (u_boundsMax - u_eyeLocal) * inv;
+    vec3 tMin = min(t0, t1), tMax = max(t0, t1);
+    float tNear = max(max(max(tMin.x, tMin.y), tMin.z), 0.0);
+    float tFar = min(min(tMax.x, tMax.y), tMax.z);
+    if (tFar <= tNear) discard;
+
+    vec3 extent = max(u_boundsMax - u_boundsMin, vec3(1e-6));
+    float dt = length(extent) / float(max(u_maxSteps, 1));
+    // Jittered start, so the step count shows as noise rather than rings.
+    float jitter = fract(sin(dot(gl_FragCoord.xy, vec2(12.9898, 78.233))) * 43758.5453);
+
+    // Front to back, premultiplied.
+    vec4 sum = vec4(0.0);
+    for (float t = tNear + jitter * dt; t < tFar; t += dt) {
+        vec3 uvw = (u_eyeLocal + dir * t - u_boundsMin) / extent;
+        float value = clamp(sampleValue(uvw), 0.0, 1.0);
+        if (value < u_threshold) continue;
+
+        vec4 color = sampleGradient(u_gradientRow, value);
+        float alpha = 1.0 - exp(-u_densityScale * value * color.a * dt);
+        sum += (1.0 - sum.a) * vec4(color.rgb * alpha, alpha);
+        if (sum.a > 0.99) break;
+    }
+    if (sum.a <= 0.0) discard;
+    FragColor = sum;
+}
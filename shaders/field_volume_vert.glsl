@@ -0,0 +1,32 @@
+/*
+================================================================================
+|                            field_volume_vert.glsl                            |
+================================================================================
+*/
+#version 430 core
+
+// The visualizer's bounds as a box of 36 vertices from gl_VertexID; no
+// attributes. Faces wind counter-clockwise seen from outside.
+#include "frame_uniforms.glsl"
+
+uniform mat4 u_model;         // visualizer local -> eye-relative world
+uniform vec3 u_boundsMin;
+uniform vec3 u_boundsMax;
+
+out vec3 LocalPos;            // on the box, in visualizer-local space
+
+const int kCorners[36] = int[36](
+    0, 4, 6,  0, 6, 2,    // -x
+    1, 3, 7,  1, 7, 5,    // +x
+    0, 1, 5,  0, 5, 4,    // -y
+    2, 6, 7,  2, 7, 3,    // +y
+    0, 2, 3,  0, 3, 1,    // -z
+    4, 5, 7,  4, 7, 6);   // +z
+
+void main()
+{
+    int corner = kCorners[gl_VertexID];
+    vec3 unit = vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+    LocalPos = mix(u_boundsMin, u_boundsMax, unit);
+    gl_Position = u_frameProjection * u_frameEyeView * u_model * vec4(LocalPos, 1.0);
+}
@@ -0,0 +1,127 @@
+#version 430 core
+
+// Forward kinematics of GPU posed prefab fleets (RenderSnapshot::Fleet),
+// one fleet at a time, over the instances the view draws.
+//   u_stage 0  one level of the fleet's links: a thread per drawn instance
+//              and link of the level composes the parent's world pose, which
+//              the previous level's dispatch wrote, with the joint origin
+//              and its motion at q. Poses are rigid, a quaternion and a
+//              translation, as KinematicPose.
+//   u_stage 1  a thread per drawn instance and part writes the part's
+//              matrix, relative to the eye, into the batched mesh pass's
+//              instance buffer: part p's instances are the run of
+//              u_drawCount at u_firstOutput + p * u_drawCount.
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+const int kRevolute  = 1;   // KinematicModel::Motion
+const int kPrismatic = 2;
+
+struct Link {
+    vec4  rotation;         // joint origin, quaternion xyzw
+    vec4  translation;
+    vec4  axis;
+    ivec4 info;             // x model link, y parent, z DOF, w motion
+};
+
+struct Part {
+    mat4  offset;           // from its link's frame
+    vec4  color;
+    uvec4 info;             // x model link, y material
+};
+
+struct FleetInstance {
+    vec4  rows[3];          // root, first three rows
+    uvec4 info;             // x pick ID, y first joint coordinate
+};
+
+struct Instance {
+    mat4  modelMatrix;
+    vec4  color;
+    uvec4 padding;          // x = pick ID, y = material, as InstanceData
+};
+
+layout(std430, binding = 30) readonly buffer Links { Link links[]; };
+layout(std430, binding = 31) readonly buffer Parts { Part parts[]; };
+layout(std430, binding = 32) readonly buffer FleetInstances { FleetInstance fleetInstances[]; };
+layout(std430, binding = 33) readonly buffer Joints { float joints[]; };
+layout(std430, binding = 34) readonly buffer Drawn { uint drawn[]; };
+layout(std430, binding = 35) buffer Poses { vec4 poses[]; };   // rotation, translation
+layout(std430, binding = 36) writeonly buffer Instances { Instance instances[]; };
+
+uniform uint u_stage;
+uniform uint u_firstLink;     // the fleet's links and parts
+uniform uint u_linkCount;
+uniform uint u_firstPart;
+uniform uint u_partCount;
+uniform uint u_levelFirst;    // stage 0: this level's links, from u_firstLink
+uniform uint u_levelCount;
+uniform uint u_firstDrawn;    // the fleet's run of Drawn
+uniform uint u_drawCount;
+uniform uint u_firstPose;     // its poses, u_linkCount per drawn instance
+uniform uint u_firstOutput;
+uniform vec3 u_eye;           // from the fleet's origin
+
+vec4 quatMul(vec4 a, vec4 b)
+{
+    return vec4(a.w * b.xyz + b.w * a.xyz + cross(a.xyz, b.xyz), a.w * b.w - dot(a.xyz, b.xyz));
+}
+
+vec3 quatRotate(vec4 q, vec3 v)
+{
+    vec3 t = 2.0 * cross(q.xyz, v);
+    return v + q.w * t + cross(q.xyz, t);
+}
+
+void poseLevel(uint t)
+{
+    if (t >= u_drawCount * u_levelCount) return;
+    uint d = t / u_levelCount;
+    Link link = links[u_firstLink + u_levelFirst + t % u_levelCount];
+    FleetInstance fleetInstance = fleetInstances[drawn[u_firstDrawn + d]];
+
+    vec4 rotation = link.rotation;
+    vec3 translation = link.translation.xyz;
+    if (link.info.z >= 0) {
+        float q = joints[fleetInstance.info.y + uint(link.info.z)];
+        if (link.info.w == kRevolute) rotation = quatMul(rotation, vec4(link.axis.xyz * sin(0.5 * q), cos(0.5 * q)));
+        else if (link.info.w == kPrismatic) translation += quatRotate(rotation, link.axis.xyz * q);
+    }
+    uint base = u_firstPose + d * u_linkCount;
+    if (link.info.y >= 0) {
+        uint parent = 2u * (base + uint(link.info.y));
+        translation = poses[parent + 1u].xyz + quatRotate(poses[parent], translation);
+        rotation = quatMul(poses[parent], rotation);
+    }
+    uint pose = 2u * (base + uint(link.info.x));
+    poses[pose] = rotation;
+    poses[pose + 1u] = vec4(translation, 1.0);
+}
+
+void writePart(uint t)
+{
+    if (t >= u_drawCount * u_partCount) return;
+    uint p = t / u_drawCount, d = t % u_drawCount;
+    Part part = parts[u_firstPart + p];
+    FleetInstance fleetInstance = fleetInstances[drawn[u_firstDrawn + d]];
+
+    uint pose = 2u * (u_firstPose + d * u_linkCount + part.info.x);
+    vec4 rotation = poses[pose];
+    mat4 link = mat4(vec4(quatRotate(rotation, vec3(1.0, 0.0, 0.0)), 0.0),
+                     vec4(quatRotate(rotation, vec3(0.0, 1.0, 0.0)), 0.0),
+                     vec4(quatRotate(rotation, vec3(0.0, 0.0, 1.0)), 0.0),
+                     vec4(poses[pose + 1u].xyz, 1.0));
+    mat4 root = transpose(mat4(fleetInstance.rows[0], fleetInstance.rows[1], fleetInstance.rows[2], vec4(0.0, 0.0, 0.0, 1.0)));
+
+    Instance instance;
+    instance.modelMatrix = root * link * part.offset;
+    instance.modelMatrix[3].xyz -= u_eye;
+    instance.color = part.color;
+    instance.padding = uvec4(fleetInstance.info.x, part.info.y, 0u, 0u);
+    instances[u_firstOutput + t] = instance;
+}
+
+void main()
+{
+    if (u_stage == 0u) poseLevel(gl_GlobalInvocationID.x);
+    else writePart(gl_GlobalInvocationID.x);
+}
@@ -3,38 +3,173 @@
 // =================================================================
 //                      fragment_shader.glsl
 // =================================================================
-#version 330 core
-out vec4 FragColor;
+#version 430 core
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out uint PickId; // entity ID attachment; discarded when the FBO has none
 
 // Data received from the vertex shader (already in world space)
 in vec3 FragPos;
 in vec3 Normal;
+in vec2 TexCoord;
 
 // Uniforms from the C++ application
 uniform vec3 objectColor;
+uniform uint u_material;  // index into materials[]
 uniform vec3 lightColor;
-uniform vec3 lightPos;
-uniform vec3 viewPos; // Camera's position
+uniform vec3 lightDirection;   // towards the key light, which is directional
+uniform uint u_pickId;   // entity ID + 1, 0 = not pickable
+
+#include "frame_uniforms.glsl"
+
+// Clustered point lights (light_cull_comp): the fragment's froxel lists the
+// lights that can reach it. Off until the view has binned some.
+const uint kTilesX = 16u, kTilesY = 9u, kSlices = 24u;
+const float kSliceNear = 0.1, kSliceFar = 1000.0;
+struct Light {
+    vec4 positionRange;       // world position, range
+    vec4 color;               // rgb scaled by intensity
+};
+layout(std430, binding = 19) readonly buffer Lights { Light lights[]; };
+layout(std430, binding = 20) readonly buffer LightGrid { uvec2 lightGrid[]; };
+layout(std430, binding = 21) readonly buffer LightIndices {
+    uint lightIndexCount;
+    uint lightIndices[];
+};
+uniform bool u_clusteredLights;
+
+// Materials (MaterialTable, MaterialGpu in GpuResources.hpp). Albedo is the
+// colour above times the albedo map; the metal/roughness map scales the
+// factors (glTF channels). A layer of -1 is no map; u_materialMaps is off
+// when the mesh arena carries no texture coordinates.
+struct Material {
+    vec4 emissive;            // rgb scaled by intensity
+    float metallic;
+    float roughness;
+    int albedoLayer;
+    int metalRoughnessLayer;
+    float albedoLevel;        // finest mip resident (TextureStreamer)
+    float metalRoughnessLevel;
+    vec2 padding;
+};
+layout(std430, binding = 22) readonly buffer Materials { Material materials[]; };
+uniform bool u_materialMaps;
+uniform sampler2DArray u_albedoMaps;          // sRGB
+uniform sampler2DArray u_metalRoughnessMaps;
+
+struct Surface {
+    vec3 albedo;
+    float metallic;
+    float roughness;
+};
+
+Surface surfaceOf(Material material, vec3 color, vec2 uv)
+{
+    Surface s = Surface(color, material.metallic, material.roughness);
+    if (!u_materialMaps) return s;
+    // Sampled unconditionally: the layer varies per instance, and implicit
+    // derivatives are undefined under a branch that does. The level the
+    // hardware would pick is clamped to the finest one streamed in.
+    vec4 albedoMap = textureLod(u_albedoMaps, vec3(uv, float(max(material.albedoLayer, 0))),
+        max(textureQueryLod(u_albedoMaps, uv).y, material.albedoLevel));
+    vec4 metalRoughnessMap = textureLod(u_metalRoughnessMaps, vec3(uv, float(max(material.metalRoughnessLayer, 0))),
+        max(textureQueryLod(u_metalRoughnessMaps, uv).y, material.metalRoughnessLevel));
+    if (material.albedoLayer >= 0) s.albedo *= albedoMap.rgb;
+    if (material.metalRoughnessLayer >= 0) {
+        s.roughness *= metalRoughnessMap.g;
+        s.metallic *= metalRoughnessMap.b;
+    }
+    return s;
+}
+
+// Metal/roughness BRDF: GGX distribution, Schlick-Smith geometry, Schlick
+// Fresnel over a 4 % dielectric base, Lambert for the diffuse remainder.
+// Radiance is scaled by pi, so a white light on a rough dielectric lights
+// it as brightly as the Phong diffuse it replaces.
+const float PI = 3.14159265;
+vec3 shade(Surface s, vec3 norm, vec3 viewDir, vec3 lightDir)
+{
+    float nl = max(dot(norm, lightDir), 0.0);
+    if (nl <= 0.0) return vec3(0.0);
+    vec3 h = normalize(viewDir + lightDir);
+    float nv = max(dot(norm, viewDir), 1e-4);
+    float nh = max(dot(norm, h), 0.0);
+    float a = max(s.roughness * s.roughness, 2e-3);
+    float d = nh * nh * (a * a - 1.0) + 1.0;
+    float distribution = a * a / (PI * d * d);
+    float k = (s.roughness + 1.0) * (s.roughness + 1.0) / 8.0;
+    float geometry = nv / (nv * (1.0 - k) + k) * nl / (nl * (1.0 - k) + k);
+    vec3 f0 = mix(vec3(0.04), s.albedo, s.metallic);
+    vec3 fresnel = f0 + (1.0 - f0) * pow(1.0 - max(dot(h, viewDir), 0.0), 5.0);
+    vec3 specular = distribution * geometry * fresnel / (4.0 * nv * nl);
+    vec3 diffuse = (1.0 - fresnel) * (1.0 - s.metallic) * s.albedo / PI;
+    return (diffuse + specular) * nl * PI;
+}
+
+// Cascaded shadows of the key light (RenderingSystem::renderShadows): the
+// first cascade whose box holds the fragment, 3x3 taps of hardware PCF.
+uniform bool u_shadows;
+uniform sampler2DArrayShadow u_shadowMap;
+uniform mat4 u_shadowMatrices[4];    // world -> [0, 1] shadow map space, per cascade
+uniform float u_shadowTexels[4];     // world size of one shadow texel, per cascade
+
+float keyLightShadow(vec3 norm, vec3 lightDir)
+{
+    vec2 texel = 1.0 / vec2(textureSize(u_shadowMap, 0).xy);
+    float slope = 1.0 - max(dot(norm, lightDir), 0.0);
+    for (int c = 0; c < 4; ++c) {
+        // Pushed off the surface by a texel or two, more on slopes, against acne.
+        vec3 p = FragPos + norm * u_shadowTexels[c] * (0.5 + 1.5 * slope);
+        vec4 s = u_shadowMatrices[c] * vec4(p, 1.0);
+        if (any(lessThan(s.xy, 2.0 * texel)) || any(greaterThan(s.xy, 1.0 - 2.0 * texel)) || s.z > 1.0) continue;
+        float lit = 0.0;
+        for (int y = -1; y <= 1; ++y)
+            for (int x = -1; x <= 1; ++x)
+                lit += texture(u_shadowMap, vec4(s.xy + vec2(x, y) * texel, float(c), s.z));
+        return lit / 9.0;
+    }
+    return 1.0;
+}
+
+vec3 pointLights(Surface s, vec3 norm, vec3 viewDir)
+{
+    vec3 viewPos = (u_frameEyeView * vec4(FragPos, 1.0)).xyz;
+    vec4 clip = u_frameProjection * vec4(viewPos, 1.0);
+    vec2 ndc = clamp(clip.xy / clip.w, -1.0, 1.0);
+    uvec2 tile = min(uvec2((ndc * 0.5 + 0.5) * vec2(kTilesX, kTilesY)), uvec2(kTilesX - 1u, kTilesY - 1u));
+    float depth = max(-viewPos.z, kSliceNear);
+    uint slice = min(uint(log(depth / kSliceNear) / log(kSliceFar / kSliceNear) * float(kSlices)), kSlices - 1u);
+    uvec2 cell = lightGrid[(slice * kTilesY + tile.y) * kTilesX + tile.x];
+
+    vec3 sum = vec3(0.0);
+    for (uint i = 0u; i < cell.y; ++i) {
+        Light light = lights[lightIndices[cell.x + i]];
+        vec3 toLight = light.positionRange.xyz - FragPos;
+        float distance = length(toLight);
+        // Inverse square, windowed to reach zero at the range.
+        float window = clamp(1.0 - pow(distance / light.positionRange.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance * distance + 1.0);
+        vec3 lightDir = toLight / max(distance, 1e-4);
+        sum += shade(s, norm, viewDir, lightDir) * attenuation * light.color.rgb;
+    }
+    return sum;
+}
 
 void main()
 {
-    // Ambient lighting component
-    float ambientStrength = 0.3;
-    vec3 ambient = ambientStrength * lightColor;
-  	
-    // Diffuse lighting component
+    Material material = materials[u_material];
+    Surface s = surfaceOf(material, objectColor, TexCoord);
+
     vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
-    float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * lightColor;
-    
-    // Specular lighting component
-    float specularStrength = 0.5;
-    vec3 viewDir = normalize(viewPos - FragPos);
-    vec3 reflectDir = reflect(-lightDir, norm);  
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-    vec3 specular = specularStrength * spec * lightColor;
-        
-    vec3 result = (ambient + diffuse + specular) * objectColor;
+    vec3 lightDir = normalize(lightDirection);
+    vec3 viewDir = normalize(-FragPos);   // FragPos is eye-relative
+
+    // Flat ambient as before, then the key light, point lights and emission.
+    float ambientStrength = 0.3;
+    vec3 result = ambientStrength * lightColor * s.albedo;
+    float shadow = u_shadows ? keyLightShadow(norm, lightDir) : 1.0;
+    result += shadow * shade(s, norm, viewDir, lightDir) * lightColor;
+    if (u_clusteredLights) result += pointLights(s, norm, viewDir);
+    result += material.emissive.rgb;
     FragColor = vec4(result, 1.0);
+    PickId = u_pickId;
 }
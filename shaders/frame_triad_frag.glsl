@@ -0,0 +1,20 @@
+/*
+================================================================================
+|                            frame_triad_frag.glsl                             |
+================================================================================
+*/
+#version 430 core
+layout (location = 0) out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec3 AxisColor;
+
+uniform vec3 lightDirection;   // towards the key light
+
+void main()
+{
+    // Flat and mostly unlit: triads read as markers, not as geometry.
+    float diffuse = 0.7 + 0.3 * max(dot(normalize(Normal), normalize(lightDirection)), 0.0);
+    FragColor = vec4(AxisColor * diffuse, 1.0);
+}
@@ -0,0 +1,53 @@
+/*
+================================================================================
+|                            frame_triad_vert.glsl                             |
+================================================================================
+*/
+#version 430 core
+
+// The triad primitive (createTriadPrimitive): three arrows, X first.
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+#include "frame_uniforms.glsl"
+
+// FrameTriadGpu[] (binding 5): the rows of each frame's world matrix; xyz
+// rotation (and scale), w translation.
+struct FrameTriad {
+    vec4 row0;
+    vec4 row1;
+    vec4 row2;
+};
+layout (std430, binding = 5) readonly buffer FrameTriads {
+    FrameTriad frames[];
+};
+
+uniform int u_axisVertices;   // vertices per arrow
+uniform float u_triadPixels;  // arrow length on screen
+
+out vec3 FragPos;             // eye-relative, so the eye is the origin
+out vec3 Normal;
+out vec3 AxisColor;
+
+void main()
+{
+    FrameTriad f = frames[gl_InstanceID];
+    // Columns are the frame's axes; normalised, so scaled links still show unit triads.
+    mat3 axes = transpose(mat3(f.row0.xyz, f.row1.xyz, f.row2.xyz));
+    axes[0] = normalize(axes[0]);
+    axes[1] = normalize(axes[1]);
+    axes[2] = normalize(axes[2]);
+    vec3 origin = vec3(f.row0.w, f.row1.w, f.row2.w) - u_frameCameraPos.xyz;
+
+    // World units per pixel at the origin's depth: clip w grows with depth
+    // in perspective and is 1 in orthographic views.
+    vec4 clip = u_frameProjection * u_frameEyeView * vec4(origin, 1.0);
+    float unitsPerPixel = 2.0 * clip.w / (u_frameProjection[1][1] * u_frameViewportTime.y);
+
+    FragPos = origin + axes * (aPos * u_triadPixels * unitsPerPixel);
+    Normal = axes * aNormal;
+    int axis = min(gl_VertexID / u_axisVertices, 2);
+    AxisColor = axis == 0 ? vec3(0.90, 0.22, 0.20) : axis == 1 ? vec3(0.30, 0.80, 0.25) : vec3(0.25, 0.45, 0.95);
+
+    gl_Position = u_frameProjection * u_frameEyeView * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,11 @@
+// Per-frame camera block, filled once per renderView (FrameUniformsGpu, binding 0).
+// Every raster and culling shader includes this one copy, so the layout
+// cannot drift from the C++ struct in one of them.
+layout (std140, binding = 0) uniform FrameUniforms {
+    mat4 u_frameView;
+    mat4 u_frameProjection;
+    vec4 u_frameCameraPos;    // xyz = eye position
+    vec4 u_frameViewportTime; // xy = viewport size in pixels, z = elapsed time, w = delta time
+    mat4 u_frameEyeView;      // u_frameView with the eye at the origin, for eye-relative positions
+    mat4 u_frameStereoEyeViewProjection[2]; // stereo frames: each eye's projection * eye view, left then right
+};
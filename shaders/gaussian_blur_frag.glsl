@@ -2,7 +2,7 @@
 
 out vec4 FragColor;
 
-in vec2 TexCoords; // Texture coordinates from the fullscreen quad
+in vec2 vUV; // Texture coordinates from the fullscreen quad
 
 uniform sampler2D screenTexture; // The texture we want to blur
 uniform bool horizontal;         // Are we blurring horizontally or vertically?
@@ -11,22 +11,22 @@ uniform float weight[5] = float[] (0.227027, 0.1945946, 0.1216216, 0.05405405, 0
 void main()
 {
     vec2 tex_offset = 1.0 / textureSize(screenTexture, 0); // gets size of single texel
-    vec3 result = texture(screenTexture, TexCoords).rgb * weight[0]; // current fragment's contribution
+    vec3 result = texture(screenTexture, vUV).rgb * weight[0]; // current fragment's contribution
 
     if(horizontal)
     {
         for(int i = 1; i < 5; ++i)
         {
-            result += texture(screenTexture, TexCoords + vec2(tex_offset.x * i, 0.0)).rgb * weight[i];
-            result += texture(screenTexture, TexCoords - vec2(tex_offset.x * i, 0.0)).rgb * weight[i];
+            result += texture(screenTexture, vUV + vec2(tex_offset.x * i, 0.0)).rgb * weight[i];
+            result += texture(screenTexture, vUV - vec2(tex_offset.x * i, 0.0)).rgb * weight[i];
         }
     }
     else
     {
         for(int i = 1; i < 5; ++i)
         {
-            result += texture(screenTexture, TexCoords + vec2(0.0, tex_offset.y * i)).rgb * weight[i];
-            result += texture(screenTexture, TexCoords - vec2(0.0, tex_offset.y * i)).rgb * weight[i];
+            result += texture(screenTexture, vUV + vec2(0.0, tex_offset.y * i)).rgb * weight[i];
+            result += texture(screenTexture, vUV - vec2(0.0, tex_offset.y * i)).rgb * weight[i];
         }
     }
 
@@ -0,0 +1,26 @@
+/*
+================================================================================
+|                               ghost_frag.glsl                                |
+================================================================================
+*/
+#version 430 core
+layout (location = 0) out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec4 GhostColor;
+
+uniform vec3 lightDirection;   // towards the key light
+
+void main()
+{
+    vec3 n = normalize(Normal);
+    vec3 v = normalize(-FragPos);
+
+    // Flat key light plus a rim, so overlapping copies still read as outlines.
+    float diffuse = 0.45 + 0.55 * max(dot(n, normalize(lightDirection)), 0.0);
+    float rim = pow(1.0 - max(dot(n, v), 0.0), 3.0);
+
+    vec3 color = GhostColor.rgb * diffuse + rim * mix(GhostColor.rgb, vec3(1.0), 0.5);
+    FragColor = vec4(color, clamp(GhostColor.a * (1.0 + rim), 0.0, 1.0));
+}
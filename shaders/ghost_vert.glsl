@@ -0,0 +1,33 @@
+/*
+================================================================================
+|                               ghost_vert.glsl                                |
+================================================================================
+*/
+#version 430 core
+
+// The mesh arena's vertices and InstanceData, as in instanced_phong_vert.glsl;
+// the instance colour's alpha is the ghost's opacity.
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec4 aInstanceMatCol0;
+layout (location = 3) in vec4 aInstanceMatCol1;
+layout (location = 4) in vec4 aInstanceMatCol2;
+layout (location = 5) in vec4 aInstanceMatCol3;
+layout (location = 6) in vec4 aInstanceColor;
+
+#include "frame_uniforms.glsl"
+
+out vec3 FragPos;             // eye-relative, so the eye is the origin
+out vec3 Normal;
+out vec4 GhostColor;
+
+void main()
+{
+    mat4 model = mat4(aInstanceMatCol0, aInstanceMatCol1, aInstanceMatCol2, aInstanceMatCol3);
+
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(model) * aNormal;   // ghost poses are rigid
+    GhostColor = aInstanceColor;
+
+    gl_Position = u_frameProjection * u_frameEyeView * vec4(FragPos, 1.0);
+}
@@ -3,8 +3,8 @@ out vec4 FragColor;
 
 in float g_fade_coord; // The -1 to 1 fade coordinate from the geometry shader
 
-uniform vec4 u_glowColour;
-uniform vec4 u_coreColour;
+flat in vec4 g_glowColour;
+flat in vec4 g_coreColour;
 
 void main()
 {
@@ -13,12 +13,12 @@ void main()
     falloff = pow(falloff, 1.0); // You can tweak this power for different softness
 
     // 1. Calculate the halo color. This is our "background" layer.
-    vec4 halo = vec4(u_glowColour.rgb, u_glowColour.a * falloff);
+    vec4 halo = vec4(g_glowColour.rgb, g_glowColour.a * falloff);
 
     // 2. Calculate the core color. This is our "foreground" layer.
     // The core's alpha is calculated to be strong in the center and fade out.
     float core_alpha = smoothstep(0.5, 1.0, falloff);
-    vec4 core = vec4(u_coreColour.rgb, u_coreColour.a * core_alpha);
+    vec4 core = vec4(g_coreColour.rgb, g_coreColour.a * core_alpha);
 
     // 3. Alpha-blend the core ON TOP of the halo.
     // The `mix` function performs linear interpolation: (1-a)*x + a*y
@@ -3,10 +3,14 @@
 layout (lines) in;
 layout (triangle_strip, max_vertices = 4) out;
 
-uniform mat4 u_view;
-uniform mat4 u_proj;
-uniform float u_thickness = 8.0;
-uniform vec2 u_viewport_size; // NEW: The size of the viewport in pixels
+in vec4 v_glowColour[];
+in vec4 v_coreColour[];
+in float v_thickness[];
+
+flat out vec4 g_glowColour;
+flat out vec4 g_coreColour;
+
+#include "frame_uniforms.glsl"
 
 out float g_fade_coord;
 
@@ -14,8 +18,8 @@ void main() {
     vec3 p1_world = gl_in[0].gl_Position.xyz;
     vec3 p2_world = gl_in[1].gl_Position.xyz;
 
-    vec4 p1_clip = u_proj * u_view * vec4(p1_world, 1.0);
-    vec4 p2_clip = u_proj * u_view * vec4(p2_world, 1.0);
+    vec4 p1_clip = u_frameProjection * u_frameView * vec4(p1_world, 1.0);
+    vec4 p2_clip = u_frameProjection * u_frameView * vec4(p2_world, 1.0);
 
     // Convert from clip space to screen-space NDC (-1 to 1)
     vec2 p1_ndc = p1_clip.xy / p1_clip.w;
@@ -28,24 +32,28 @@ void main() {
     vec2 offset_dir = vec2(-line_dir_screen.y, line_dir_screen.x);
 
     // THE FIX: Calculate the offset in NDC space based on viewport size.
-    // This makes 'u_thickness' correspond to a number of pixels.
-    vec2 offset = offset_dir * u_thickness / u_viewport_size;
+    // This makes the spline's thickness correspond to a number of pixels.
+    vec2 offset = offset_dir * v_thickness[0] / u_frameViewportTime.xy;
 
     // Emit the four vertices of the quad
     g_fade_coord = 1.0;
     gl_Position = p1_clip + vec4(offset * p1_clip.w, 0.0, 0.0);
+    g_glowColour = v_glowColour[0]; g_coreColour = v_coreColour[0];
     EmitVertex();
 
     g_fade_coord = -1.0;
     gl_Position = p1_clip - vec4(offset * p1_clip.w, 0.0, 0.0);
+    g_glowColour = v_glowColour[0]; g_coreColour = v_coreColour[0];
     EmitVertex();
 
     g_fade_coord = 1.0;
     gl_Position = p2_clip + vec4(offset * p2_clip.w, 0.0, 0.0);
+    g_glowColour = v_glowColour[0]; g_coreColour = v_coreColour[0];
     EmitVertex();
 
     g_fade_coord = -1.0;
     gl_Position = p2_clip - vec4(offset * p2_clip.w, 0.0, 0.0);
+    g_glowColour = v_glowColour[0]; g_coreColour = v_coreColour[0];
     EmitVertex();
 
     EndPrimitive();
@@ -1,8 +1,18 @@
 #version 430 core
 layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aGlowColour; // per spline (divisor 1, SplineStyleGpu)
+layout (location = 2) in vec4 aCoreColour;
+layout (location = 3) in float aThickness;
+
+out vec4 v_glowColour;
+out vec4 v_coreColour;
+out float v_thickness;
 
 void main()
 {
     // Pass position through to the geometry shader
     gl_Position = vec4(aPos, 1.0);
+    v_glowColour = aGlowColour;
+    v_coreColour = aCoreColour;
+    v_thickness = aThickness;
 }
\ No newline at end of file
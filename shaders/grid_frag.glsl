@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 out vec4 FragColor;
 
 // Data from the Vertex Shader
@@ -6,35 +6,21 @@ in vec3 v_worldPos;
 in vec2 v_gridPlaneCoord;
 
 // --- UNIFORMS ---
-uniform vec3 u_cameraPos;
-uniform float u_distanceToGrid; // Use the camera's zoom distance for stable fading
-
-uniform int u_numLevels;
-struct GridLevelUniform {
-    float spacing;
-    vec3  color;
-    float fadeInCameraDistanceEnd;
-    float fadeInCameraDistanceStart;
+#include "frame_uniforms.glsl"
+// Per-grid block, rewritten when the grid's settings change (GridUniformsGpu, binding 1).
+struct GridLevel {
+    vec4 colorSpacing;        // xyz = colour, w = spacing (<= 0: hidden)
+    vec4 fade;                // x = fade-in start, y = fade-in end (camera distance)
+};
+layout (std140, binding = 1) uniform GridUniforms {
+    mat4 u_gridModel;
+    mat4 u_gridInverseModel;
+    GridLevel u_levels[5];
+    vec4 u_xAxisColor;        // w = axis line width (px)
+    vec4 u_zAxisColor;        // w = base line width (px)
+    vec4 u_fogColor;          // w = fog on
+    vec4 u_gridParams;        // x = fog start, y = fog end, z = dotted, w = show axes
 };
-uniform GridLevelUniform u_levels[5];
-
-// Feature Toggles
-uniform bool u_levelVisible[5];
-uniform bool u_isDotted;
-
-uniform float u_baseLineWidthPixels;
-
-// Axes
-uniform bool u_showAxes;
-uniform vec3 u_xAxisColor;
-uniform vec3 u_zAxisColor;
-uniform float u_axisLineWidthPixels;
-
-// Fog
-uniform bool u_useFog;
-uniform vec3 u_fogColor;
-uniform float u_fogStartDistance;
-uniform float u_fogEndDistance;
 
 const float DEFAULT_AA_EXTENSION_PIXELS = 0.65f;
 const float MIN_AA_EXTENSION_PIXELS = 0.0f;
@@ -47,8 +33,15 @@ float getLevelVisibilityFactor(float currentCamDist, float levelFadeInEnd, float
     return 1.0 - smoothstep(startDist, endDist, currentCamDist);
 }
 
+// Fades a level out as its cells shrink to a few pixels, wherever on screen
+// that happens (distance or grazing angle), before its lines alias.
+float getLevelPixelFactor(float spacing, vec2 planeUnitsPerPixel) {
+    float cellPixels = spacing / max(max(planeUnitsPerPixel.x, planeUnitsPerPixel.y), 1e-6);
+    return smoothstep(2.0, 6.0, cellPixels);
+}
+
 // This is the original, high-quality anti-aliasing line function, now corrected
-// to use the u_distanceToGrid uniform.
+// to use the camera's distance to the grid origin.
 float getLineStrength(
         float planeCoord,
         float spacing,
@@ -107,29 +100,33 @@ void main() {
     float finalLineAlpha = 0.0;
 
     vec2 planeUnitsPerPixel = fwidth(v_gridPlaneCoord);
+    float distanceToGrid = length(u_frameCameraPos.xyz - u_gridModel[3].xyz);
+    float baseLineWidthPixels = u_zAxisColor.w;
+    bool isDotted = u_gridParams.z > 0.5;
 
     // --- 1. Draw Grid Levels ---
-    for (int i = 0; i < u_numLevels; ++i) {
-        // Check if this level is toggled on in the UI
-        if (!u_levelVisible[i] || u_levels[i].spacing <= 0.0) {
+    for (int i = 0; i < 5; ++i) {
+        // Hidden or unused levels have no spacing
+        float spacing = u_levels[i].colorSpacing.w;
+        if (spacing <= 0.0) {
             continue;
         }
 
-        // Calculate visibility based on camera distance
+        // Calculate visibility based on camera distance and on-screen cell size
         float levelVisibilityFactor = getLevelVisibilityFactor(
-            u_distanceToGrid,
-            u_levels[i].fadeInCameraDistanceEnd,
-            u_levels[i].fadeInCameraDistanceStart
-        );
+            distanceToGrid,
+            u_levels[i].fade.y,
+            u_levels[i].fade.x
+        ) * getLevelPixelFactor(spacing, planeUnitsPerPixel);
 
         if (levelVisibilityFactor < 0.01) {
             continue;
         }
 
-        float lineStrengthX = getLineStrength(v_gridPlaneCoord.x, u_levels[i].spacing, planeUnitsPerPixel.x, u_baseLineWidthPixels, levelVisibilityFactor, u_distanceToGrid);
-        float lineStrengthZ = getLineStrength(v_gridPlaneCoord.y, u_levels[i].spacing, planeUnitsPerPixel.y, u_baseLineWidthPixels, levelVisibilityFactor, u_distanceToGrid);
+        float lineStrengthX = getLineStrength(v_gridPlaneCoord.x, spacing, planeUnitsPerPixel.x, baseLineWidthPixels, levelVisibilityFactor, distanceToGrid);
+        float lineStrengthZ = getLineStrength(v_gridPlaneCoord.y, spacing, planeUnitsPerPixel.y, baseLineWidthPixels, levelVisibilityFactor, distanceToGrid);
         
-        float currentLineHitStrength = u_isDotted ? (lineStrengthX * lineStrengthZ) : max(lineStrengthX, lineStrengthZ);
+        float currentLineHitStrength = isDotted ? (lineStrengthX * lineStrengthZ) : max(lineStrengthX, lineStrengthZ);
 
         if (currentLineHitStrength < 0.01) {
             continue;
@@ -138,7 +135,7 @@ void main() {
         float effectiveAlphaForThisLevel = currentLineHitStrength * levelVisibilityFactor;
 
         if (effectiveAlphaForThisLevel > 0.01) {
-            vec3 currentLevelColorRGB = u_levels[i].color;
+            vec3 currentLevelColorRGB = u_levels[i].colorSpacing.rgb;
             // Use standard "over" blending to composite layers correctly
             finalLineColorRGB = mix(finalLineColorRGB, currentLevelColorRGB, effectiveAlphaForThisLevel);
             finalLineAlpha    = effectiveAlphaForThisLevel + finalLineAlpha * (1.0 - effectiveAlphaForThisLevel);
@@ -146,25 +143,25 @@ void main() {
     }
 
     // --- 2. Draw Coordinate Axes ---
-    if (u_showAxes) {
-        float zAxisStrength = getAxisStrength(v_gridPlaneCoord.x, planeUnitsPerPixel.x, u_axisLineWidthPixels);
+    if (u_gridParams.w > 0.5) {
+        float zAxisStrength = getAxisStrength(v_gridPlaneCoord.x, planeUnitsPerPixel.x, u_xAxisColor.w);
         if (zAxisStrength > 0.01) {
-            finalLineColorRGB = mix(finalLineColorRGB, u_zAxisColor, zAxisStrength);
+            finalLineColorRGB = mix(finalLineColorRGB, u_zAxisColor.rgb, zAxisStrength);
             finalLineAlpha = max(finalLineAlpha, zAxisStrength);
         }
 
-        float xAxisStrength = getAxisStrength(v_gridPlaneCoord.y, planeUnitsPerPixel.y, u_axisLineWidthPixels);
+        float xAxisStrength = getAxisStrength(v_gridPlaneCoord.y, planeUnitsPerPixel.y, u_xAxisColor.w);
         if (xAxisStrength > 0.01) {
-            finalLineColorRGB = mix(finalLineColorRGB, u_xAxisColor, xAxisStrength);
+            finalLineColorRGB = mix(finalLineColorRGB, u_xAxisColor.rgb, xAxisStrength);
             finalLineAlpha = max(finalLineAlpha, xAxisStrength);
         }
     }
     
     // --- 3. Apply Fog ---
-    if (u_useFog) {
-        float distToCamFragment = length(v_worldPos - u_cameraPos);
-        float fogFactor = smoothstep(u_fogStartDistance, u_fogEndDistance, distToCamFragment);
-        finalLineColorRGB = mix(finalLineColorRGB, u_fogColor, fogFactor);
+    if (u_fogColor.w > 0.5) {
+        float distToCamFragment = length(v_worldPos - u_frameCameraPos.xyz);
+        float fogFactor = smoothstep(u_gridParams.x, u_gridParams.y, distToCamFragment);
+        finalLineColorRGB = mix(finalLineColorRGB, u_fogColor.rgb, fogFactor);
     }
 
     // --- Final Output ---
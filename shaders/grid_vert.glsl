@@ -1,10 +1,21 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 aPos; // Local quad vertex (e.g., on XY plane from -size to +size)
 
-// Uniforms
-uniform mat4 u_gridModelMatrix; // Grid's own transformation matrix (orientation and position)
-uniform mat4 u_viewMatrix;
-uniform mat4 u_projectionMatrix;
+#include "frame_uniforms.glsl"
+// Per-grid block, rewritten when the grid's settings change (GridUniformsGpu, binding 1).
+struct GridLevel {
+    vec4 colorSpacing;        // xyz = colour, w = spacing (<= 0: hidden)
+    vec4 fade;                // x = fade-in start, y = fade-in end (camera distance)
+};
+layout (std140, binding = 1) uniform GridUniforms {
+    mat4 u_gridModel;
+    mat4 u_gridInverseModel;
+    GridLevel u_levels[5];
+    vec4 u_xAxisColor;        // w = axis line width (px)
+    vec4 u_zAxisColor;        // w = base line width (px)
+    vec4 u_fogColor;          // w = fog on
+    vec4 u_gridParams;        // x = fog start, y = fog end, z = dotted, w = show axes
+};
 
 // Output to fragment shader
 out vec3 v_worldPos;        // World position of the fragment
@@ -15,12 +26,16 @@ void main()
     // aPos is a vertex of our local grid quad (e.g., a large square on XY plane, Y=0)
     // v_gridPlaneCoord will be used by the fragment shader to draw lines
     // relative to the grid's own local coordinate system.
-    v_gridPlaneCoord = aPos.xz; // If local quad is on XZ plane, use X and Z
-                                // If local quad is on XY plane, use X and Y: v_gridPlaneCoord = aPos.xy;
+    // The quad is centred under the camera, so the grid never runs out;
+    // the lines come from the plane coordinate, not the quad.
+    vec3 eyeOnPlane = (u_gridInverseModel * vec4(u_frameCameraPos.xyz, 1.0)).xyz;
+    vec3 localPos = aPos + vec3(eyeOnPlane.x, 0.0, eyeOnPlane.z);
+    v_gridPlaneCoord = localPos.xz; // If local quad is on XZ plane, use X and Z
+                                    // If local quad is on XY plane, use X and Y: v_gridPlaneCoord = aPos.xy;
 
     // Transform the local quad vertex to its world position
-    v_worldPos = vec3(u_gridModelMatrix * vec4(aPos, 1.0));
+    v_worldPos = vec3(u_gridModel * vec4(localPos, 1.0));
     
     // Standard MVP for screen position
-    gl_Position = u_projectionMatrix * u_viewMatrix * vec4(v_worldPos, 1.0);
+    gl_Position = u_frameProjection * u_frameView * vec4(v_worldPos, 1.0);
 }
@@ -0,0 +1,44 @@
+#version 430 core
+
+// One level of a target's Hi-Z pyramid: each texel holds the farthest depth
+// of the texels below it. Level 0 reduces the view's corner of the depth
+// attachment by 2x2, each later level the one before it. A level is
+// max(1, view >> (level + 1)) texels wide; on odd sizes the last texel also
+// takes the leftover row or column, so every pixel belongs to exactly one
+// texel per level (occlusion_cull_comp relies on that).
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+uniform sampler2D u_depth;                            // level 0: the depth attachment
+layout (r32f, binding = 0) readonly uniform image2D u_source;   // later levels: level - 1
+layout (r32f, binding = 1) writeonly uniform image2D u_dest;
+
+uniform int  u_level;
+uniform vec2 u_viewSize;    // pixels of the depth attachment this view drew
+uniform bool u_reverseZ;    // far is 0, not 1
+
+ivec2 levelSize(int level)
+{
+    return level < 0 ? ivec2(u_viewSize) : max(ivec2(1), ivec2(u_viewSize) >> (level + 1));
+}
+
+float farther(float a, float b) { return u_reverseZ ? min(a, b) : max(a, b); }
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = levelSize(u_level);
+    if (any(greaterThanEqual(texel, size))) return;
+
+    ivec2 sourceSize = levelSize(u_level - 1);
+    ivec2 first = min(texel * 2, sourceSize - 1);
+    ivec2 last = min(texel * 2 + 1, sourceSize - 1);
+    if (texel.x == size.x - 1) last.x = sourceSize.x - 1;
+    if (texel.y == size.y - 1) last.y = sourceSize.y - 1;
+
+    float depth = u_reverseZ ? 1.0 : 0.0;
+    for (int y = first.y; y <= last.y; ++y)
+        for (int x = first.x; x <= last.x; ++x)
+            depth = farther(depth, u_level == 0 ? texelFetch(u_depth, ivec2(x, y), 0).r
+                                                : imageLoad(u_source, ivec2(x, y)).r);
+    imageStore(u_dest, texel, vec4(depth));
+}
@@ -0,0 +1,162 @@
+/*
+================================================================================
+|                           instanced_phong_frag.glsl                          |
+================================================================================
+*/
+#version 430 core
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out uint PickId; // entity ID attachment; discarded when the FBO has none
+
+in VertexData {
+    vec3 FragPos;
+    vec3 Normal;
+    vec3 ObjectColor; // per-instance albedo from the instance buffer
+    flat uint InstancePickId;
+    flat uint InstanceMaterial;
+    vec2 TexCoord;
+};
+
+uniform vec3 lightColor;
+uniform vec3 lightDirection;   // towards the key light, which is directional
+
+#include "frame_uniforms.glsl"
+
+// Clustered point lights, as in fragment_shader.glsl.
+const uint kTilesX = 16u, kTilesY = 9u, kSlices = 24u;
+const float kSliceNear = 0.1, kSliceFar = 1000.0;
+struct Light {
+    vec4 positionRange;       // world position, range
+    vec4 color;               // rgb scaled by intensity
+};
+layout(std430, binding = 19) readonly buffer Lights { Light lights[]; };
+layout(std430, binding = 20) readonly buffer LightGrid { uvec2 lightGrid[]; };
+layout(std430, binding = 21) readonly buffer LightIndices {
+    uint lightIndexCount;
+    uint lightIndices[];
+};
+uniform bool u_clusteredLights;
+
+// Materials and the BRDF, as in fragment_shader.glsl.
+struct Material {
+    vec4 emissive;            // rgb scaled by intensity
+    float metallic;
+    float roughness;
+    int albedoLayer;
+    int metalRoughnessLayer;
+    float albedoLevel;        // finest mip resident (TextureStreamer)
+    float metalRoughnessLevel;
+    vec2 padding;
+};
+layout(std430, binding = 22) readonly buffer Materials { Material materials[]; };
+uniform bool u_materialMaps;
+uniform sampler2DArray u_albedoMaps;
+uniform sampler2DArray u_metalRoughnessMaps;
+
+struct Surface {
+    vec3 albedo;
+    float metallic;
+    float roughness;
+};
+
+Surface surfaceOf(Material material, vec3 color, vec2 uv)
+{
+    Surface s = Surface(color, material.metallic, material.roughness);
+    if (!u_materialMaps) return s;
+    vec4 albedoMap = textureLod(u_albedoMaps, vec3(uv, float(max(material.albedoLayer, 0))),
+        max(textureQueryLod(u_albedoMaps, uv).y, material.albedoLevel));
+    vec4 metalRoughnessMap = textureLod(u_metalRoughnessMaps, vec3(uv, float(max(material.metalRoughnessLayer, 0))),
+        max(textureQueryLod(u_metalRoughnessMaps, uv).y, material.metalRoughnessLevel));
+    if (material.albedoLayer >= 0) s.albedo *= albedoMap.rgb;
+    if (material.metalRoughnessLayer >= 0) {
+        s.roughness *= metalRoughnessMap.g;
+        s.metallic *= metalRoughnessMap.b;
+    }
+    return s;
+}
+
+const float PI = 3.14159265;
+vec3 shade(Surface s, vec3 norm, vec3 viewDir, vec3 lightDir)
+{
+    float nl = max(dot(norm, lightDir), 0.0);
+    if (nl <= 0.0) return vec3(0.0);
+    vec3 h = normalize(viewDir + lightDir);
+    float nv = max(dot(norm, viewDir), 1e-4);
+    float nh = max(dot(norm, h), 0.0);
+    float a = max(s.roughness * s.roughness, 2e-3);
+    float d = nh * nh * (a * a - 1.0) + 1.0;
+    float distribution = a * a / (PI * d * d);
+    float k = (s.roughness + 1.0) * (s.roughness + 1.0) / 8.0;
+    float geometry = nv / (nv * (1.0 - k) + k) * nl / (nl * (1.0 - k) + k);
+    vec3 f0 = mix(vec3(0.04), s.albedo, s.metallic);
+    vec3 fresnel = f0 + (1.0 - f0) * pow(1.0 - max(dot(h, viewDir), 0.0), 5.0);
+    vec3 specular = distribution * geometry * fresnel / (4.0 * nv * nl);
+    vec3 diffuse = (1.0 - fresnel) * (1.0 - s.metallic) * s.albedo / PI;
+    return (diffuse + specular) * nl * PI;
+}
+
+// Key light shadows, as in fragment_shader.glsl.
+uniform bool u_shadows;
+uniform sampler2DArrayShadow u_shadowMap;
+uniform mat4 u_shadowMatrices[4];
+uniform float u_shadowTexels[4];
+
+float keyLightShadow(vec3 norm, vec3 lightDir)
+{
+    vec2 texel = 1.0 / vec2(textureSize(u_shadowMap, 0).xy);
+    float slope = 1.0 - max(dot(norm, lightDir), 0.0);
+    for (int c = 0; c < 4; ++c) {
+        // Pushed off the surface by a texel or two, more on slopes, against acne.
+        vec3 p = FragPos + norm * u_shadowTexels[c] * (0.5 + 1.5 * slope);
+        vec4 s = u_shadowMatrices[c] * vec4(p, 1.0);
+        if (any(lessThan(s.xy, 2.0 * texel)) || any(greaterThan(s.xy, 1.0 - 2.0 * texel)) || s.z > 1.0) continue;
+        float lit = 0.0;
+        for (int y = -1; y <= 1; ++y)
+            for (int x = -1; x <= 1; ++x)
+                lit += texture(u_shadowMap, vec4(s.xy + vec2(x, y) * texel, float(c), s.z));
+        return lit / 9.0;
+    }
+    return 1.0;
+}
+
+vec3 pointLights(Surface s, vec3 norm, vec3 viewDir)
+{
+    vec3 viewPos = (u_frameEyeView * vec4(FragPos, 1.0)).xyz;
+    vec4 clip = u_frameProjection * vec4(viewPos, 1.0);
+    vec2 ndc = clamp(clip.xy / clip.w, -1.0, 1.0);
+    uvec2 tile = min(uvec2((ndc * 0.5 + 0.5) * vec2(kTilesX, kTilesY)), uvec2(kTilesX - 1u, kTilesY - 1u));
+    float depth = max(-viewPos.z, kSliceNear);
+    uint slice = min(uint(log(depth / kSliceNear) / log(kSliceFar / kSliceNear) * float(kSlices)), kSlices - 1u);
+    uvec2 cell = lightGrid[(slice * kTilesY + tile.y) * kTilesX + tile.x];
+
+    vec3 sum = vec3(0.0);
+    for (uint i = 0u; i < cell.y; ++i) {
+        Light light = lights[lightIndices[cell.x + i]];
+        vec3 toLight = light.positionRange.xyz - FragPos;
+        float distance = length(toLight);
+        float window = clamp(1.0 - pow(distance / light.positionRange.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance * distance + 1.0);
+        vec3 lightDir = toLight / max(distance, 1e-4);
+        sum += shade(s, norm, viewDir, lightDir) * attenuation * light.color.rgb;
+    }
+    return sum;
+}
+
+void main()
+{
+    // Same model as fragment_shader.glsl; colour and material come from the instance.
+    Material material = materials[InstanceMaterial];
+    Surface s = surfaceOf(material, ObjectColor, TexCoord);
+
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = normalize(lightDirection);
+    vec3 viewDir = normalize(-FragPos);   // FragPos is eye-relative
+
+    float ambientStrength = 0.3;
+    vec3 result = ambientStrength * lightColor * s.albedo;
+    float shadow = u_shadows ? keyLightShadow(norm, lightDir) : 1.0;
+    result += shadow * shade(s, norm, viewDir, lightDir) * lightColor;
+    if (u_clusteredLights) result += pointLights(s, norm, viewDir);
+    result += material.emissive.rgb;
+    FragColor = vec4(result, 1.0);
+    PickId = InstancePickId;
+}
@@ -0,0 +1,53 @@
+/*
+================================================================================
+|                           instanced_phong_vert.glsl                          |
+================================================================================
+*/
+#version 430 core
+
+// Per-vertex attributes (shared mesh geometry)
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 9) in vec2 aUv;        // full vertex layout only, else (0, 0)
+
+/*
+ * Per-instance attributes, laid out exactly like InstanceData on the C++ side
+ * (mat4 model + vec4 colour + vec4 padding, 96 bytes). The indirect command's
+ * baseInstance selects the first record of each mesh batch. padding.x holds
+ * the entity pick ID and padding.y the material index, as raw uint bits
+ * sourced as integer attributes.
+*/
+layout (location = 2) in vec4 aInstanceMatCol0;
+layout (location = 3) in vec4 aInstanceMatCol1;
+layout (location = 4) in vec4 aInstanceMatCol2;
+layout (location = 5) in vec4 aInstanceMatCol3;
+layout (location = 6) in vec4 aInstanceColor;
+layout (location = 7) in uint aInstancePickId;
+layout (location = 8) in uint aInstanceMaterial;
+
+#include "frame_uniforms.glsl"
+
+// A block, so stereo_layer_geom.glsl can sit between this stage and the
+// fragment stage and pass every member through by name.
+out VertexData {
+    vec3 FragPos;
+    vec3 Normal;
+    vec3 ObjectColor;
+    flat uint InstancePickId;
+    flat uint InstanceMaterial;
+    vec2 TexCoord;
+};
+
+void main()
+{
+    mat4 model = mat4(aInstanceMatCol0, aInstanceMatCol1, aInstanceMatCol2, aInstanceMatCol3);
+
+    FragPos = vec3(model * vec4(aPos, 1.0));   // eye-relative: the model matrices are
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+    ObjectColor = aInstanceColor.rgb;
+    InstancePickId = aInstancePickId;
+    InstanceMaterial = aInstanceMaterial;
+    TexCoord = aUv;
+
+    gl_Position = u_frameProjection * u_frameEyeView * vec4(FragPos, 1.0);   // per eye in stereo_layer_geom
+}
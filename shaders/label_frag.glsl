@@ -0,0 +1,31 @@
+/*
+================================================================================
+|                                label_frag.glsl                               |
+================================================================================
+*/
+#version 430 core
+
+in vec2 TexCoord;
+in vec4 Colour;
+
+// GlyphAtlas distances: 0.5 on the outline, u_spread atlas texels either
+// side of it across the rest of the range.
+uniform sampler2D u_glyphAtlas;
+uniform float u_spread;
+
+layout (location = 0) out vec4 FragColor;
+
+void main()
+{
+    float d = texture(u_glyphAtlas, TexCoord).r;
+    // One screen pixel of the field, for an edge a pixel wide at any size.
+    float w = max(fwidth(d), 1e-4) * 0.75;
+    float fill = smoothstep(0.5 - w, 0.5 + w, d);
+    // A dark halo a texel and a half out keeps the text legible on any background.
+    float halo = 0.5 - 0.75 / u_spread;
+    float outline = smoothstep(halo - w, halo + w, d);
+    vec3 rgb = mix(vec3(0.0), Colour.rgb, fill);
+    float alpha = Colour.a * max(fill, 0.6 * outline);
+    if (alpha < 0.004) discard;
+    FragColor = vec4(rgb, alpha);
+}
@@ -0,0 +1,50 @@
+/*
+================================================================================
+|                                label_vert.glsl                               |
+================================================================================
+*/
+#version 430 core
+
+#include "frame_uniforms.glsl"
+
+// LabelGlyphGpu[] (binding 6): one glyph quad per instance, in ems from its
+// label's anchor; LabelGpu[] (binding 7): where each label sits.
+struct LabelGlyph {
+    vec4 rect;                // x0, y0, x1, y1
+    vec4 uv;                  // u0, v0, u1, v1
+    uint label;
+    uint pad0, pad1, pad2;
+};
+layout (std430, binding = 6) readonly buffer LabelGlyphs {
+    LabelGlyph glyphs[];
+};
+struct Label {
+    vec4 anchor;              // xyz world, w = em height in pixels
+    vec4 colour;
+};
+layout (std430, binding = 7) readonly buffer Labels {
+    Label labels[];
+};
+
+out vec2 TexCoord;
+out vec4 Colour;
+
+void main()
+{
+    LabelGlyph g = glyphs[gl_InstanceID];
+    Label l = labels[g.label];
+
+    // Strip corners 0..3: (x0, y0), (x1, y0), (x0, y1), (x1, y1).
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 ems = mix(g.rect.xy, g.rect.zw, corner);
+    TexCoord = mix(g.uv.xy, g.uv.zw, corner);
+    Colour = l.colour;
+
+    // The anchor projected, then moved in whole pixels: the text faces the
+    // screen at the same size at any depth. Half an em above the anchor.
+    vec4 clip = u_frameProjection * u_frameEyeView * vec4(l.anchor.xyz - u_frameCameraPos.xyz, 1.0);
+    vec2 pixels = (ems + vec2(0.0, 0.5)) * l.anchor.w;
+    clip.xy += pixels * 2.0 / u_frameViewportTime.xy * clip.w;
+    // Behind the eye: collapse, so nothing wraps round the screen.
+    gl_Position = clip.w > 0.0 ? clip : vec4(0.0, 0.0, 2.0, 1.0);
+}
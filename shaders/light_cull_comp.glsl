@@ -0,0 +1,86 @@
+#version 430 core
+
+// Bins the view's point lights into the froxel grid the phong shaders read:
+// kTilesX x kTilesY screen tiles by kSlices depth slices, spaced exponentially
+// in view depth between kSliceNear and kSliceFar (slice 0 runs on to the eye).
+// One thread per froxel tests every light's sphere against the froxel's
+// view-space box, reserves room for the ones that touch it in the index list
+// and writes (offset, count) to the grid. A full list truncates: the froxels
+// that reserved last lose lights, nothing is written out of bounds.
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+const uint kTilesX = 16u, kTilesY = 9u, kSlices = 24u;   // kLightTiles*, kLightSlices in GpuResources.hpp
+const float kSliceNear = 0.1, kSliceFar = 1000.0;
+
+struct Light {
+    vec4 positionRange;       // world position, range
+    vec4 color;               // rgb scaled by intensity
+};
+
+layout(std430, binding = 19) readonly buffer Lights { Light lights[]; };
+layout(std430, binding = 20) writeonly buffer LightGrid { uvec2 lightGrid[]; };
+layout(std430, binding = 21) buffer LightIndices {
+    uint lightIndexCount;     // zeroed before the dispatch
+    uint lightIndices[];
+};
+
+#include "frame_uniforms.glsl"
+
+uniform mat4 u_inverseProjection;
+uniform uint u_lightCount;
+uniform uint u_indexCapacity;
+
+float sliceDepth(uint slice)
+{
+    return slice == 0u ? 0.0 : kSliceNear * pow(kSliceFar / kSliceNear, float(slice) / float(kSlices));
+}
+
+// The view-space point at view depth 'depth' on the ray through 'ndc'. Two
+// depths every convention keeps finite give the ray, perspective or not.
+vec3 pointOnRay(vec2 ndc, float depth)
+{
+    vec4 a = u_inverseProjection * vec4(ndc, 0.5, 1.0);
+    vec4 b = u_inverseProjection * vec4(ndc, 1.0, 1.0);
+    a.xyz /= a.w;
+    b.xyz /= b.w;
+    float t = (-depth - a.z) / (b.z - a.z);
+    return mix(a.xyz, b.xyz, t);
+}
+
+bool touches(Light light, vec3 boxMin, vec3 boxMax)
+{
+    vec3 centre = (u_frameEyeView * vec4(light.positionRange.xyz, 1.0)).xyz;
+    vec3 outside = max(boxMin - centre, 0.0) + max(centre - boxMax, 0.0);
+    return dot(outside, outside) <= light.positionRange.w * light.positionRange.w;
+}
+
+void main()
+{
+    uint froxel = gl_GlobalInvocationID.x;
+    if (froxel >= kTilesX * kTilesY * kSlices) return;
+    uint tileX = froxel % kTilesX;
+    uint tileY = (froxel / kTilesX) % kTilesY;
+    uint slice = froxel / (kTilesX * kTilesY);
+
+    vec2 ndcMin = vec2(tileX, tileY) / vec2(kTilesX, kTilesY) * 2.0 - 1.0;
+    vec2 ndcMax = vec2(tileX + 1u, tileY + 1u) / vec2(kTilesX, kTilesY) * 2.0 - 1.0;
+    float nearDepth = sliceDepth(slice), farDepth = sliceDepth(slice + 1u);
+    vec3 boxMin = vec3(1e30), boxMax = vec3(-1e30);
+    for (int corner = 0; corner < 8; ++corner) {
+        vec2 ndc = vec2((corner & 1) != 0 ? ndcMax.x : ndcMin.x, (corner & 2) != 0 ? ndcMax.y : ndcMin.y);
+        vec3 p = pointOnRay(ndc, (corner & 4) != 0 ? farDepth : nearDepth);
+        boxMin = min(boxMin, p);
+        boxMax = max(boxMax, p);
+    }
+
+    uint count = 0u;
+    for (uint i = 0u; i < u_lightCount; ++i)
+        if (touches(lights[i], boxMin, boxMax)) ++count;
+
+    uint offset = count > 0u ? atomicAdd(lightIndexCount, count) : 0u;
+    count = min(count, u_indexCapacity - min(offset, u_indexCapacity));
+    uint written = 0u;
+    for (uint i = 0u; i < u_lightCount && written < count; ++i)
+        if (touches(lights[i], boxMin, boxMax)) lightIndices[offset + written++] = i;
+    lightGrid[froxel] = uvec2(offset, count);
+}
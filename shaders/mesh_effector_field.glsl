@@ -0,0 +1,104 @@
+// Mesh effectors: the triangle stream, its BVH and the field they make.
+// Included by every kernel that samples the effector field.
+
+struct TriangleGpu {
+    vec4 v0; // w component stores strength
+    vec4 v1;
+    vec4 v2;
+    vec4 normal; // w component stores radius
+};
+
+layout(std430, binding = 4) readonly buffer TriangleEffectorBuffer {
+    uvec4 triangleHeader;
+    TriangleGpu triangleEffectors[];
+};
+
+// Must match BvhNodeGpu in GpuResources.hpp. Leaves: count > 0.
+struct BvhNodeGpu {
+    vec3 boundsMin;
+    int leftOrFirst;
+    vec3 boundsMax;
+    int count;
+};
+layout(std430, binding = 9) readonly buffer TriangleBvhBuffer {
+    uvec4 bvhHeader;
+    BvhNodeGpu bvhNodes[];
+};
+
+// Must match TriangleBvh::kMaxDepth. A depth-first walk that pushes both
+// children holds at most one pending node per level plus the one popped.
+const int kBvhMaxDepth = 32;
+
+vec3 closestPointOnTriangle(vec3 p, vec3 a, vec3 b, vec3 c) {
+    vec3 ab = b - a;
+    vec3 ac = c - a;
+    vec3 ap = p - a;
+    float d1 = dot(ab, ap);
+    float d2 = dot(ac, ap);
+    if (d1 <= 0.0 && d2 <= 0.0) return a;
+
+    vec3 bp = p - b;
+    float d3 = dot(ab, bp);
+    float d4 = dot(ac, bp);
+    if (d3 >= 0.0 && d4 <= d3) return b;
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+        float v = d1 / (d1 - d3);
+        return a + v * ab;
+    }
+
+    vec3 cp = p - c;
+    float d5 = dot(ab, cp);
+    float d6 = dot(ac, cp);
+    if (d6 >= 0.0 && d5 <= d6) return c;
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+        float w = d2 / (d2 - d6);
+        return a + w * ac;
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {
+        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        return b + w * (c - b);
+    }
+
+    float denom = 1.0 / (va + vb + vc);
+    float v = vb * denom;
+    float w = vc * denom;
+    return a + ab * v + ac * w;
+}
+
+// Sums the mesh-effector field at p by walking the triangle BVH. Node boxes
+// are inflated by the influence radius, so only nearby triangles are tested.
+// The build caps the depth, so the stack never overflows.
+vec3 meshEffectorField(vec3 p) {
+    vec3 field = vec3(0.0);
+    if (bvhHeader.x == 0u) return field;
+
+    int stack[kBvhMaxDepth + 1];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        BvhNodeGpu node = bvhNodes[stack[--sp]];
+        if (any(lessThan(p, node.boundsMin)) || any(greaterThan(p, node.boundsMax))) continue;
+
+        if (node.count > 0) {
+            for (int i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+                TriangleGpu tri = triangleEffectors[i];
+                vec3 diff = p - closestPointOnTriangle(p, tri.v0.xyz, tri.v1.xyz, tri.v2.xyz);
+                float dist = length(diff);
+                float radius = tri.normal.w;
+                if (dist > 0.001 && dist < radius) {
+                    field += normalize(diff) * tri.v0.w * (1.0 - dist / radius);
+                }
+            }
+        } else {
+            stack[sp++] = node.leftOrFirst;
+            stack[sp++] = node.leftOrFirst + 1;
+        }
+    }
+    return field;
+}
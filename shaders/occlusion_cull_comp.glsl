@@ -0,0 +1,120 @@
+#version 430 core
+
+// Two-phase occlusion culling of the batched mesh pass, one thread per
+// candidate instance. The draw commands come in two runs of u_commandCount,
+// instanceCount zeroed by the upload; emitting appends the instance to a
+// command's run of the instance buffer.
+//   u_phase 0  instances this target saw last frame (and those without
+//              bounds) go to the first run and are marked drawn;
+//   u_phase 1  after the first run is drawn and hiz_build_comp has reduced
+//              its depth, every bounded instance is tested against the
+//              pyramid. The result is next frame's visibility; instances
+//              that pass and were not drawn go to the second run.
+// Nothing visible is ever skipped: phase 1 judges against depth of this
+// frame's geometry only, so last frame's visibility just picks occluders.
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+const uint kBounded = 1u;   // kOcclusionBounded in GpuResources.hpp
+const uint kDrawn   = 2u;   // kOcclusionDrawn
+
+struct Instance {
+    mat4  modelMatrix;
+    vec4  color;
+    uvec4 padding;          // x = pick ID bits, copied untouched
+};
+
+struct Candidate {
+    Instance instance;
+    vec4 boundsMin;         // world AABB
+    vec4 boundsMax;
+    uint command;
+    uint slot;
+    uint flags;
+    uint padding;
+};
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    uint baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 30) buffer Candidates { Candidate candidates[]; };
+layout(std430, binding = 31) writeonly buffer Instances { Instance instances[]; };
+layout(std430, binding = 32) buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 33) buffer Visibility { uint visibility[]; };   // per entity index
+
+#include "frame_uniforms.glsl"
+
+uniform sampler2D u_hiz;      // hiz_build_comp's pyramid, level 0 at half resolution
+uniform uint u_phase;
+uniform uint u_count;
+uniform uint u_commandCount;
+uniform int  u_hizLevels;
+uniform vec2 u_viewSize;      // pixels this view drew, not the output size
+uniform bool u_reverseZ;      // ZERO_TO_ONE clip depth, far is 0
+
+void emit(uint command, Instance instance)
+{
+    uint index = atomicAdd(commands[command].instanceCount, 1u);
+    instances[commands[command].baseInstance + index] = instance;
+}
+
+bool visibleInPyramid(vec3 boundsMin, vec3 boundsMax)
+{
+    mat4 viewProjection = u_frameProjection * u_frameView;
+    vec3 ndcMin = vec3(1e30), ndcMax = vec3(-1e30);
+    for (int corner = 0; corner < 8; ++corner) {
+        vec3 p = mix(boundsMin, boundsMax, vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1));
+        vec4 clip = viewProjection * vec4(p, 1.0);
+        if (clip.w <= 1e-6) return true;    // reaches behind the eye
+        vec3 ndc = clip.xyz / clip.w;
+        ndcMin = min(ndcMin, ndc);
+        ndcMax = max(ndcMax, ndc);
+    }
+
+    // Window depth of the nearest corner.
+    float nearest = u_reverseZ ? ndcMax.z : ndcMin.z * 0.5 + 0.5;
+
+    ivec2 view = ivec2(u_viewSize);
+    ivec2 pixelMin = clamp(ivec2(floor((ndcMin.xy * 0.5 + 0.5) * u_viewSize)), ivec2(0), view - 1);
+    ivec2 pixelMax = clamp(ivec2(floor((ndcMax.xy * 0.5 + 0.5) * u_viewSize)), ivec2(0), view - 1);
+
+    // The level whose texels (2^(level + 1) pixels) make the rectangle span
+    // at most two per axis.
+    ivec2 extent = pixelMax - pixelMin;
+    int level = clamp(findMSB(max(extent.x, extent.y)), 0, u_hizLevels - 1);
+    ivec2 size = max(ivec2(1), view >> (level + 1));
+    ivec2 first = min(pixelMin >> (level + 1), size - 1);
+    ivec2 last = min(pixelMax >> (level + 1), size - 1);
+
+    float farthest = u_reverseZ ? 1.0 : 0.0;
+    for (int y = first.y; y <= last.y; ++y)
+        for (int x = first.x; x <= last.x; ++x) {
+            float depth = texelFetch(u_hiz, ivec2(x, y), level).r;
+            farthest = u_reverseZ ? min(farthest, depth) : max(farthest, depth);
+        }
+    return u_reverseZ ? nearest >= farthest : nearest <= farthest;
+}
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= u_count) return;
+    Candidate c = candidates[i];
+    bool bounded = (c.flags & kBounded) != 0u;
+
+    if (u_phase == 0u) {
+        if (bounded && visibility[c.slot] == 0u) return;
+        candidates[i].flags = c.flags | kDrawn;
+        emit(c.command, c.instance);
+        return;
+    }
+
+    if (!bounded) return;
+    bool visible = visibleInPyramid(c.boundsMin.xyz, c.boundsMax.xyz);
+    visibility[c.slot] = visible ? 1u : 0u;
+    if (visible && (c.flags & kDrawn) == 0u) emit(c.command + u_commandCount, c.instance);
+}
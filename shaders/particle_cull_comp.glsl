@@ -0,0 +1,116 @@
+#version 430 core
+
+// Per view: appends the alive particles that fall inside the frustum to the
+// context's particle draw buffer (ParticleVertexGpu records after a
+// DrawArraysIndirectCommand whose count the host zeroed), already
+// interpolated between the last two simulation steps. Dispatched indirectly
+// with the group count particle_emit_comp wrote for the alive count.
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// Working copy of a particle. The buffers hold ParticleStore records: this
+// struct itself, or with KR_PACKED_PARTICLES its 32-byte packing (must
+// match Particle in components.hpp). Ages are stored as a fraction of the
+// lifetime, so a stored age never exceeds it.
+struct Particle {
+    vec4 position;
+    vec4 velocity;
+    vec4 color;
+    float age;
+    float lifetime;
+    float size;
+    float padding;
+};
+
+#ifndef KR_PACKED_PARTICLES
+#define KR_PACKED_PARTICLES 0
+#endif
+#if KR_PACKED_PARTICLES
+struct ParticleStore {
+    vec3 position;
+    uint ageLifetime;         // low: unorm16 age / lifetime, high: half lifetime
+    uvec2 velocitySize;       // half4: velocity xyz, size
+    uvec2 color;              // half4
+};
+
+Particle unpackParticle(ParticleStore s) {
+    vec2 velocityZSize = unpackHalf2x16(s.velocitySize.y);
+    Particle p;
+    p.position = vec4(s.position, 1.0);
+    p.velocity = vec4(unpackHalf2x16(s.velocitySize.x), velocityZSize.x, 0.0);
+    p.color = vec4(unpackHalf2x16(s.color.x), unpackHalf2x16(s.color.y));
+    p.lifetime = unpackHalf2x16(s.ageLifetime).y;
+    p.age = unpackUnorm2x16(s.ageLifetime).x * p.lifetime;
+    p.size = velocityZSize.y;
+    p.padding = 0.0;
+    return p;
+}
+
+ParticleStore packParticle(Particle p) {
+    ParticleStore s;
+    s.position = p.position.xyz;
+    s.ageLifetime = (packUnorm2x16(vec2(p.age / max(p.lifetime, 1e-6), 0.0)) & 0xffffu)
+                  | (packHalf2x16(vec2(0.0, p.lifetime)) & 0xffff0000u);
+    s.velocitySize = uvec2(packHalf2x16(p.velocity.xy), packHalf2x16(vec2(p.velocity.z, p.size)));
+    s.color = uvec2(packHalf2x16(p.color.rg), packHalf2x16(p.color.ba));
+    return s;
+}
+#else
+#define ParticleStore Particle
+Particle unpackParticle(Particle s) { return s; }
+Particle packParticle(Particle p) { return p; }
+#endif
+
+struct ParticleVertex {
+    vec4 positionSize;
+    vec4 color;
+};
+
+layout(std430, binding = 5) readonly buffer CurrentParticles { ParticleStore particles[]; };
+layout(std430, binding = 6) readonly buffer PreviousParticles { ParticleStore previousParticles[]; };
+
+layout(std430, binding = 23) readonly buffer ParticleListBuffer {
+    uvec3 updateGroups;
+    uint deadCount;
+    uvec3 cullGroups;
+    uint listPadding0;
+    uint aliveCount[2];
+    uint listPadding1[2];
+    uint lists[];
+};
+
+layout(std430, binding = 24) buffer ParticleDrawBuffer {
+    uint vertexCount;
+    uint instanceCount;
+    uint first;
+    uint baseInstance;
+    ParticleVertex vertices[];
+};
+
+#include "frame_uniforms.glsl"
+
+uniform uint u_capacity;
+uniform uint u_readHalf;          // the half holding the latest step
+// Where this frame sits between the previous step (0) and the latest (1).
+uniform float u_interpolation;
+
+void main()
+{
+    uint t = gl_GlobalInvocationID.x;
+    if (t >= aliveCount[u_readHalf]) return;
+
+    uint index = lists[u_readHalf * u_capacity + t];
+    Particle p = unpackParticle(particles[index]);
+    Particle previous = unpackParticle(previousParticles[index]);
+
+    // A particle that spawned this step would streak across the bounds.
+    vec4 position = p.age >= previous.age ? mix(previous.position, p.position, u_interpolation) : p.position;
+    vec4 clip = u_frameProjection * u_frameView * position;
+
+    // Sprites are p.size pixels wide: keep those overlapping the edge.
+    vec2 margin = p.size / max(u_frameViewportTime.xy, vec2(1.0)) * clip.w;
+    if (clip.w <= 0.0 || any(greaterThan(abs(clip.xy), vec2(clip.w) + margin))) return;
+
+    uint slot = atomicAdd(vertexCount, 1u);
+    vertices[slot].positionSize = vec4(position.xyz, p.size);
+    vertices[slot].color = p.color;
+}
@@ -0,0 +1,145 @@
+#version 430 core
+
+// Once per Particles-mode simulation step, before particle_update_comp:
+// moves u_emitCount indices (at most the dead count) from the dead list to
+// the alive list of the read half, spawning them at random in the bounds,
+// then writes the indirect dispatch arguments for the update and the cull.
+// A single workgroup; the lists are laid out as in ParticleListHeaderGpu.
+layout (local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+// Working copy of a particle. The buffers hold ParticleStore records: this
+// struct itself, or with KR_PACKED_PARTICLES its 32-byte packing (must
+// match Particle in components.hpp). Ages are stored as a fraction of the
+// lifetime, so a stored age never exceeds it.
+struct Particle {
+    vec4 position;
+    vec4 velocity;
+    vec4 color;
+    float age;
+    float lifetime;
+    float size;
+    float padding;
+};
+
+#ifndef KR_PACKED_PARTICLES
+#define KR_PACKED_PARTICLES 0
+#endif
+#if KR_PACKED_PARTICLES
+struct ParticleStore {
+    vec3 position;
+    uint ageLifetime;         // low: unorm16 age / lifetime, high: half lifetime
+    uvec2 velocitySize;       // half4: velocity xyz, size
+    uvec2 color;              // half4
+};
+
+Particle unpackParticle(ParticleStore s) {
+    vec2 velocityZSize = unpackHalf2x16(s.velocitySize.y);
+    Particle p;
+    p.position = vec4(s.position, 1.0);
+    p.velocity = vec4(unpackHalf2x16(s.velocitySize.x), velocityZSize.x, 0.0);
+    p.color = vec4(unpackHalf2x16(s.color.x), unpackHalf2x16(s.color.y));
+    p.lifetime = unpackHalf2x16(s.ageLifetime).y;
+    p.age = unpackUnorm2x16(s.ageLifetime).x * p.lifetime;
+    p.size = velocityZSize.y;
+    p.padding = 0.0;
+    return p;
+}
+
+ParticleStore packParticle(Particle p) {
+    ParticleStore s;
+    s.position = p.position.xyz;
+    s.ageLifetime = (packUnorm2x16(vec2(p.age / max(p.lifetime, 1e-6), 0.0)) & 0xffffu)
+                  | (packHalf2x16(vec2(0.0, p.lifetime)) & 0xffff0000u);
+    s.velocitySize = uvec2(packHalf2x16(p.velocity.xy), packHalf2x16(vec2(p.velocity.z, p.size)));
+    s.color = uvec2(packHalf2x16(p.color.rg), packHalf2x16(p.color.ba));
+    return s;
+}
+#else
+#define ParticleStore Particle
+Particle unpackParticle(Particle s) { return s; }
+Particle packParticle(Particle p) { return p; }
+#endif
+
+layout(std430, binding = 5) buffer ParticleInputBuffer { ParticleStore particles[]; };
+
+layout(std430, binding = 23) buffer ParticleListBuffer {
+    uvec3 updateGroups;
+    uint deadCount;
+    uvec3 cullGroups;
+    uint listPadding0;
+    uint aliveCount[2];
+    uint listPadding1[2];
+    uint lists[];             // alive of half 0, alive of half 1, dead; u_capacity each
+};
+
+uniform uint u_capacity;
+uniform uint u_readHalf;        // the half the update reads
+uniform uint u_emitCount;
+uniform uint u_updateLocalSize; // workgroup size of the update variant in use
+uniform uint u_cullLocalSize;
+uniform mat4 u_visualizerModelMatrix;
+uniform vec3 u_boundsMin;
+uniform vec3 u_boundsMax;
+uniform uint u_rngSeed;      // RenderingSystem::randomSeed()
+uniform uint u_rngStep;      // simulation step, low 32 bits
+uniform float u_lifetime;
+uniform float u_size;
+
+shared uint s_dead;
+shared uint s_alive;
+shared uint s_emitted;
+
+// Counter-based random numbers (PCG hash): a pure function of the particle
+// index, the simulation step and u_rngSeed, so a seeded run repeats exactly
+// on any machine and consecutive steps do not correlate.
+uint pcgHash(uint v) {
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// Three uniform numbers in [0, 1) for 'index'; 'stream' keeps uses apart.
+vec3 random3(uint index, uint stream) {
+    uint h = pcgHash(index ^ pcgHash(u_rngStep ^ pcgHash(u_rngSeed ^ stream)));
+    uint a = pcgHash(h), b = pcgHash(a);
+    return vec3(uvec3(h, a, b) >> 8u) * (1.0 / 16777216.0);
+}
+
+void main()
+{
+    uint lid = gl_LocalInvocationID.x;
+    if (lid == 0u) {
+        s_dead = deadCount;
+        s_alive = aliveCount[u_readHalf];
+        s_emitted = min(u_emitCount, s_dead);
+    }
+    barrier();
+
+    // Pops from the top of the dead list.
+    uint aliveBase = u_readHalf * u_capacity;
+    uint deadTop = 2u * u_capacity + s_dead - 1u;
+    for (uint i = lid; i < s_emitted; i += gl_WorkGroupSize.x) {
+        uint index = lists[deadTop - i];
+        vec3 local = mix(u_boundsMin, u_boundsMax, random3(index, 0u));
+
+        Particle p;
+        p.position = u_visualizerModelMatrix * vec4(local, 1.0);
+        p.velocity = vec4(0.0);
+        p.color = vec4(1.0);
+        p.age = 0.0;
+        p.lifetime = u_lifetime;
+        p.size = u_size;
+        p.padding = 0.0;
+        particles[index] = packParticle(p);
+        lists[aliveBase + s_alive + i] = index;
+    }
+
+    if (lid == 0u) {
+        uint alive = s_alive + s_emitted;
+        deadCount = s_dead - s_emitted;
+        aliveCount[u_readHalf] = alive;
+        aliveCount[1u - u_readHalf] = 0u;   // the update appends the survivors here
+        updateGroups = uvec3((alive + u_updateLocalSize - 1u) / u_updateLocalSize, 1u, 1u);
+        cullGroups = uvec3((alive + u_cullLocalSize - 1u) / u_cullLocalSize, 1u, 1u);
+    }
+}
@@ -1,28 +1,17 @@
 #version 430 core
 
-// The particle struct must match the one in the compute shader
-struct Particle {
-    vec4 position;
-    vec4 velocity;
-    vec4 color;
-    float age;
-    float lifetime;
-    float size;
-    float padding;
-};
-
-layout (location = 0) in vec4 in_position;
+// ParticleVertexGpu records written by particle_cull_comp: the visible
+// particles, already interpolated between simulation steps.
+layout (location = 0) in vec4 in_positionSize;   // xyz = world position, w = point size
 layout (location = 1) in vec4 in_color;
-layout (location = 2) in float in_size;
 
-uniform mat4 u_view;
-uniform mat4 u_projection;
+#include "frame_uniforms.glsl"
 
 out vec4 fragColor;
 
 void main()
 {
-    gl_Position = u_projection * u_view * in_position;
-    gl_PointSize = in_size;
+    gl_Position = u_frameProjection * u_frameView * vec4(in_positionSize.xyz, 1.0);
+    gl_PointSize = in_positionSize.w;
     fragColor = in_color;
 }
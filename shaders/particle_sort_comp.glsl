@@ -0,0 +1,132 @@
+#version 430 core
+
+// Back-to-front sort of the particles particle_cull_comp appended for one
+// view: an LSD radix sort on a 16-bit depth key, two 8-bit digits, moving
+// whole ParticleVertex records between the draw buffer and a scratch
+// buffer of the same layout. Per digit (u_shift 0, then 8):
+//   u_pass 0  one group per tile: the tile's digit histogram, written
+//             bin-major to sortCounts (bin * tiles + tile);
+//   u_pass 1  one group: exclusive scan of the whole sortCounts array, so
+//             each entry becomes where that tile's run of that bin starts;
+//   u_pass 2  one group per tile: scatters the tile in order, 256 records
+//             at a time, ranking equal digits by thread index (stable).
+// Tiles past the visible count leave early; their zero counts scan away.
+layout (local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+const uint kTile = 4096u;      // records per workgroup, kParticleSortTile in GpuResources.hpp
+
+struct ParticleVertex {
+    vec4 positionSize;
+    vec4 color;
+};
+
+layout(std430, binding = 24) readonly buffer ParticleDrawBuffer {
+    uint vertexCount;          // written by the cull
+    uint instanceCount;
+    uint first;
+    uint baseInstance;
+};
+layout(std430, binding = 26) readonly buffer SortSource {
+    uvec4 sourceHeader;        // unused: mirrors the draw command
+    ParticleVertex sourceVertices[];
+};
+layout(std430, binding = 27) writeonly buffer SortDest {
+    uvec4 destHeader;
+    ParticleVertex destVertices[];
+};
+layout(std430, binding = 28) buffer SortCounts { uint sortCounts[]; };
+
+#include "frame_uniforms.glsl"
+
+uniform uint u_pass;
+uniform uint u_shift;
+uniform uint u_tiles;
+
+shared uint s_bins[256];
+shared uint s_masks[256 * 8];  // per digit, one bit per thread of the chunk
+
+// Far particles get small keys. Log view depth over 1 mm .. 100 km keeps
+// about 0.03 % relative resolution and needs no clip planes (the reversed-Z
+// projection has no far one).
+uint depthKey(vec3 position)
+{
+    const float kLogNear = log2(1e-3), kLogFar = log2(1e5);
+    float depth = max(-(u_frameView * vec4(position, 1.0)).z, 1e-3);
+    float t = (log2(depth) - kLogNear) / (kLogFar - kLogNear);
+    return 65535u - uint(clamp(t, 0.0, 1.0) * 65535.0);
+}
+
+uint digitOf(uint index)
+{
+    return (depthKey(sourceVertices[index].positionSize.xyz) >> u_shift) & 255u;
+}
+
+void main()
+{
+    uint t = gl_LocalInvocationID.x;
+
+    if (u_pass == 1u) {
+        // Each thread sums a run of entries, the runs' totals are scanned in
+        // shared memory, then each run is rewritten exclusively.
+        uint n = u_tiles * 256u;
+        uint run = (n + 255u) / 256u;
+        uint begin = min(t * run, n), end = min(begin + run, n);
+        uint sum = 0u;
+        for (uint i = begin; i < end; ++i) sum += sortCounts[i];
+        s_bins[t] = sum;
+        barrier();
+        for (uint offset = 1u; offset < 256u; offset <<= 1) {
+            uint add = t >= offset ? s_bins[t - offset] : 0u;
+            barrier();
+            s_bins[t] += add;
+            barrier();
+        }
+        uint running = s_bins[t] - sum;
+        for (uint i = begin; i < end; ++i) {
+            uint count = sortCounts[i];
+            sortCounts[i] = running;
+            running += count;
+        }
+        return;
+    }
+
+    uint tile = gl_WorkGroupID.x;
+    uint tileBegin = tile * kTile;
+    uint tileEnd = min(tileBegin + kTile, vertexCount);
+
+    if (u_pass == 0u) {
+        s_bins[t] = 0u;
+        barrier();
+        for (uint i = tileBegin + t; i < tileEnd; i += 256u)
+            atomicAdd(s_bins[digitOf(i)], 1u);
+        barrier();
+        sortCounts[t * u_tiles + tile] = s_bins[t];
+        return;
+    }
+
+    // u_pass 2: s_bins holds where each digit's next record of this tile goes.
+    s_bins[t] = sortCounts[t * u_tiles + tile];
+    barrier();
+    for (uint chunk = tileBegin; chunk < tileEnd; chunk += 256u) {
+        for (uint w = 0u; w < 8u; ++w) s_masks[t * 8u + w] = 0u;
+        barrier();
+
+        uint index = chunk + t;
+        bool valid = index < tileEnd;
+        uint digit = valid ? digitOf(index) : 0u;
+        if (valid) atomicOr(s_masks[digit * 8u + t / 32u], 1u << (t % 32u));
+        barrier();
+
+        if (valid) {
+            uint rank = bitCount(s_masks[digit * 8u + t / 32u] & ((1u << (t % 32u)) - 1u));
+            for (uint w = 0u; w < t / 32u; ++w) rank += bitCount(s_masks[digit * 8u + w]);
+            destVertices[s_bins[digit] + rank] = sourceVertices[index];
+        }
+        barrier();
+
+        uint total = 0u;
+        for (uint w = 0u; w < 8u; ++w) total += bitCount(s_masks[t * 8u + w]);
+        s_bins[t] += total;
+        barrier();
+    }
+}
@@ -1,6 +1,10 @@
 #version 430 core
 
-layout (local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+// Built per workgroup size by ComputeDispatch; 256 when compiled plain.
+#ifndef KR_LOCAL_SIZE_X
+#define KR_LOCAL_SIZE_X 256
+#endif
+layout (local_size_x = KR_LOCAL_SIZE_X, local_size_y = 1, local_size_z = 1) in;
 
 // --- GPU Data Structures ---
 struct PointEffectorGpu {
@@ -18,14 +22,10 @@ struct DirectionalEffectorGpu {
     float padding1, padding2, padding3;
 };
 
-struct TriangleGpu {
-    vec4 v0; // w component stores strength
-    vec4 v1;
-    vec4 v2;
-    vec4 normal; // w component stores radius
-};
-
-// NEW: Particle Data Structure
+// Working copy of a particle. The buffers hold ParticleStore records: this
+// struct itself, or with KR_PACKED_PARTICLES its 32-byte packing (must
+// match Particle in components.hpp). Ages are stored as a fraction of the
+// lifetime, so a stored age never exceeds it.
 struct Particle {
     vec4 position;
     vec4 velocity;
@@ -36,94 +36,194 @@ struct Particle {
     float padding;
 };
 
+#ifndef KR_PACKED_PARTICLES
+#define KR_PACKED_PARTICLES 0
+#endif
+#if KR_PACKED_PARTICLES
+struct ParticleStore {
+    vec3 position;
+    uint ageLifetime;         // low: unorm16 age / lifetime, high: half lifetime
+    uvec2 velocitySize;       // half4: velocity xyz, size
+    uvec2 color;              // half4
+};
+
+Particle unpackParticle(ParticleStore s) {
+    vec2 velocityZSize = unpackHalf2x16(s.velocitySize.y);
+    Particle p;
+    p.position = vec4(s.position, 1.0);
+    p.velocity = vec4(unpackHalf2x16(s.velocitySize.x), velocityZSize.x, 0.0);
+    p.color = vec4(unpackHalf2x16(s.color.x), unpackHalf2x16(s.color.y));
+    p.lifetime = unpackHalf2x16(s.ageLifetime).y;
+    p.age = unpackUnorm2x16(s.ageLifetime).x * p.lifetime;
+    p.size = velocityZSize.y;
+    p.padding = 0.0;
+    return p;
+}
+
+ParticleStore packParticle(Particle p) {
+    ParticleStore s;
+    s.position = p.position.xyz;
+    s.ageLifetime = (packUnorm2x16(vec2(p.age / max(p.lifetime, 1e-6), 0.0)) & 0xffffu)
+                  | (packHalf2x16(vec2(0.0, p.lifetime)) & 0xffff0000u);
+    s.velocitySize = uvec2(packHalf2x16(p.velocity.xy), packHalf2x16(vec2(p.velocity.z, p.size)));
+    s.color = uvec2(packHalf2x16(p.color.rg), packHalf2x16(p.color.ba));
+    return s;
+}
+#else
+#define ParticleStore Particle
+Particle unpackParticle(Particle s) { return s; }
+Particle packParticle(Particle p) { return p; }
+#endif
+
 // --- Buffer Definitions ---
-layout(std140, binding = 3) uniform EffectorDataUbo {
-    PointEffectorGpu pointEffectors[256];
-    DirectionalEffectorGpu directionalEffectors[16];
+// Effector streams: { uvec4 header; T items[]; }, item count in header.x.
+layout(std430, binding = 3) readonly buffer PointEffectorBuffer {
+    uvec4 pointHeader;
+    PointEffectorGpu pointEffectors[];
+};
+layout(std430, binding = 8) readonly buffer DirectionalEffectorBuffer {
+    uvec4 directionalHeader;
+    DirectionalEffectorGpu directionalEffectors[];
 };
 
-layout(std430, binding = 4) readonly buffer TriangleEffectorBuffer {
-    TriangleGpu triangleEffectors[];
+#include "mesh_effector_field.glsl"
+
+// Must match PointCloudEffectorGpu in GpuResources.hpp. Each cloud's grid
+// (see PointCloudGrid) sits in the shared bucket and point streams.
+struct PointCloudEffectorGpu {
+    mat4 worldToCloud;
+    float strength;
+    float radius;
+    float cellSize;
+    uint bucketMask;
+    uint firstBucket;
+    uint firstPoint;
+    uint padding0, padding1;
+};
+layout(std430, binding = 16) readonly buffer PointCloudEffectorBuffer {
+    uvec4 cloudHeader;
+    PointCloudEffectorGpu cloudEffectors[];
+};
+layout(std430, binding = 17) readonly buffer PointCloudBucketBuffer {
+    uvec4 cloudBucketHeader;
+    uint cloudBuckets[];
+};
+layout(std430, binding = 18) readonly buffer PointCloudPointBuffer {
+    uvec4 cloudPointHeader;
+    vec4 cloudPoints[];
 };
 
 // NEW: Particle Ping-Pong Buffers
-layout(std430, binding = 5) readonly buffer ParticleInputBuffer { Particle particlesIn[]; };
-layout(std430, binding = 6) buffer ParticleOutputBuffer { Particle particlesOut[]; };
+layout(std430, binding = 5) readonly buffer ParticleInputBuffer { ParticleStore particlesIn[]; };
+layout(std430, binding = 6) buffer ParticleOutputBuffer { ParticleStore particlesOut[]; };
+
+// Alive and dead index lists, as in ParticleListHeaderGpu. Dispatched
+// indirectly over the read half's alive list (particle_emit_comp).
+layout(std430, binding = 23) buffer ParticleListBuffer {
+    uvec3 updateGroups;
+    uint deadCount;
+    uvec3 cullGroups;
+    uint listPadding0;
+    uint aliveCount[2];
+    uint listPadding1[2];
+    uint lists[];             // alive of half 0, alive of half 1, dead; u_capacity each
+};
 
 // --- Uniforms ---
 uniform mat4 u_visualizerModelMatrix; // To transform spawn points
 uniform float u_deltaTime;
-uniform float u_time; // For random seed
+uniform uint u_rngSeed;      // RenderingSystem::randomSeed()
+uniform uint u_rngStep;      // simulation step, low 32 bits
 uniform vec3 u_boundsMin;
 uniform vec3 u_boundsMax;
+uniform uint u_capacity;
+uniform uint u_readHalf;
+uniform bool u_respawn;   // emission rate 0: respawn in place instead of dying
 
-uniform int u_pointEffectorCount;
-uniform int u_directionalEffectorCount;
-uniform int u_triangleEffectorCount;
 
-// --- Helper Functions ---
+uniform bool u_useBakedField;
+uniform sampler3D u_bakedField;
+uniform mat4 u_worldToFieldUVW;      // world -> [0,1]^3 over the visualizer bounds
 
-// Simple pseudo-random number generator
-float random(vec2 st) {
-    return fract(sin(dot(st.xy, vec2(12.9898, 78.233))) * 43758.5453123);
-}
-
-vec3 closestPointOnTriangle(vec3 p, vec3 a, vec3 b, vec3 c) {
-    vec3 ab = b - a;
-    vec3 ac = c - a;
-    vec3 ap = p - a;
-    float d1 = dot(ab, ap);
-    float d2 = dot(ac, ap);
-    if (d1 <= 0.0 && d2 <= 0.0) return a;
-
-    vec3 bp = p - b;
-    float d3 = dot(ab, bp);
-    float d4 = dot(ac, bp);
-    if (d3 >= 0.0 && d4 <= d3) return b;
-
-    float vc = d1 * d4 - d3 * d2;
-    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
-        float v = d1 / (d1 - d3);
-        return a + v * ab;
-    }
+uniform sampler2D u_gradientAtlas;   // one baked gradient per row
+uniform uint u_intensityGradientRow; // by field strength, as the arrows
+uniform uint u_lifetimeGradientRow;  // by age / lifetime
 
-    vec3 cp = p - c;
-    float d5 = dot(ab, cp);
-    float d6 = dot(ac, cp);
-    if (d6 >= 0.0 && d5 <= d6) return c;
+// Row 'row' of the gradient atlas (GradientLut texels, RenderingSystem::gradientRow)
+// at 'value' in [0, 1]; the ends fall on the first and last texel centres.
+vec4 sampleGradient(uint row, float value)
+{
+    vec2 size = vec2(textureSize(u_gradientAtlas, 0));
+    vec2 uv = vec2((0.5 + clamp(value, 0.0, 1.0) * (size.x - 1.0)) / size.x, (float(row) + 0.5) / size.y);
+    return textureLod(u_gradientAtlas, uv, 0.0);
+}
 
-    float vb = d5 * d2 - d1 * d6;
-    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
-        float w = d2 / (d2 - d6);
-        return a + w * ac;
-    }
+// --- Helper Functions ---
 
-    float va = d3 * d6 - d5 * d4;
-    if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {
-        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
-        return b + w * (c - b);
-    }
+// Counter-based random numbers (PCG hash): a pure function of the particle
+// index, the simulation step and u_rngSeed, so a seeded run repeats exactly
+// on any machine and consecutive steps do not correlate.
+uint pcgHash(uint v) {
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
 
-    float denom = 1.0 / (va + vb + vc);
-    float v = vb * denom;
-    float w = vc * denom;
-    return a + ab * v + ac * w;
+// Three uniform numbers in [0, 1) for 'index'; 'stream' keeps uses apart.
+vec3 random3(uint index, uint stream) {
+    uint h = pcgHash(index ^ pcgHash(u_rngStep ^ pcgHash(u_rngSeed ^ stream)));
+    uint a = pcgHash(h), b = pcgHash(a);
+    return vec3(uvec3(h, a, b) >> 8u) * (1.0 / 16777216.0);
 }
 
 
-// --- Main Logic ---
-void main()
-{
-    uint gid = gl_GlobalInvocationID.x;
-    if (gid >= particlesIn.length()) return;
+uint hashCloudCell(ivec3 c, uint mask) {
+    return ((uint(c.x) * 73856093u) ^ (uint(c.y) * 19349663u) ^ (uint(c.z) * 83492791u)) & mask;
+}
 
-    Particle p = particlesIn[gid]; // Get the current particle state
+// Pushes p away from the nearest scanned point of each point-cloud effector.
+// Cells are half the radius: at most 5^3 hashed cells are searched, ring by
+// ring, stopping once the next ring cannot hold anything closer.
+vec3 pointCloudField(vec3 p) {
+    vec3 field = vec3(0.0);
+    for (uint c = 0u; c < cloudHeader.x; ++c) {
+        PointCloudEffectorGpu cloud = cloudEffectors[c];
+        vec3 q = (cloud.worldToCloud * vec4(p, 1.0)).xyz;
+        ivec3 home = ivec3(floor(q / cloud.cellSize));
+        float bestSq = cloud.radius * cloud.radius;
+        vec3 nearest = q;
+        bool found = false;
+        for (int ring = 0; ring <= 2; ++ring) {
+            for (int z = -ring; z <= ring; ++z)
+            for (int y = -ring; y <= ring; ++y)
+            for (int x = -ring; x <= ring; ++x) {
+                if (max(abs(x), max(abs(y), abs(z))) != ring) continue;
+                uint b = cloud.firstBucket + hashCloudCell(home + ivec3(x, y, z), cloud.bucketMask);
+                for (uint i = cloudBuckets[b]; i < cloudBuckets[b + 1u]; ++i) {
+                    vec3 s = cloudPoints[cloud.firstPoint + i].xyz;
+                    vec3 d = q - s;
+                    float dSq = dot(d, d);
+                    if (dSq < bestSq) { bestSq = dSq; nearest = s; found = true; }
+                }
+            }
+            float reach = float(ring) * cloud.cellSize;
+            if (found && bestSq <= reach * reach) break;
+        }
+        float dist = sqrt(bestSq);
+        if (found && dist > 1e-6) {
+            // Rotation and uniform scale only: the transpose maps the direction back to world space.
+            vec3 away = normalize(transpose(mat3(cloud.worldToCloud)) * (q - nearest));
+            field += away * cloud.strength * (1.0 - dist / cloud.radius);
+        }
+    }
+    return field;
+}
 
-    // --- 1. FIELD CALCULATION (Your existing logic) ---
-    vec3 worldPos = p.position.xyz;
+// Field from every effector stream at worldPos.
+vec3 evaluateEffectors(vec3 worldPos) {
     vec3 totalField = vec3(0.0);
 
-    for (int i = 0; i < u_pointEffectorCount; ++i) {
+    for (int i = 0; i < int(pointHeader.x); ++i) {
         vec3 diff = worldPos - pointEffectors[i].position.xyz;
         float dist = length(diff);
         if (dist < pointEffectors[i].radius && dist > 0.001) {
@@ -133,21 +233,37 @@ void main()
         }
     }
 
-    for (int i = 0; i < u_triangleEffectorCount; ++i) {
-        TriangleGpu tri = triangleEffectors[i];
-        vec3 closestPoint = closestPointOnTriangle(worldPos, tri.v0.xyz, tri.v1.xyz, tri.v2.xyz);
-        vec3 diff = worldPos - closestPoint;
-        float dist = length(diff);
-        float radius = tri.normal.w;
-        if (dist > 0.001 && dist < radius) {
-            float strength = tri.v0.w * (1.0 - dist / radius);
-            totalField += normalize(diff) * strength;
-        }
-    }
+    totalField += meshEffectorField(worldPos);
+    totalField += pointCloudField(worldPos);
 
-    for (int i = 0; i < u_directionalEffectorCount; ++i) {
+    for (int i = 0; i < int(directionalHeader.x); ++i) {
         totalField += directionalEffectors[i].direction.xyz * directionalEffectors[i].strength;
     }
+    return totalField;
+}
+
+// Baked mode samples the RGBA16F field cache instead (trilinear, clamped to its edges).
+vec3 evaluateField(vec3 worldPos) {
+    if (u_useBakedField) {
+        vec3 uvw = (u_worldToFieldUVW * vec4(worldPos, 1.0)).xyz;
+        return texture(u_bakedField, uvw).xyz;
+    }
+    return evaluateEffectors(worldPos);
+}
+
+// --- Main Logic ---
+void main()
+{
+    uint slot = gl_GlobalInvocationID.x;
+    if (slot >= aliveCount[u_readHalf]) return;
+
+    uint gid = lists[u_readHalf * u_capacity + slot];
+    Particle p = unpackParticle(particlesIn[gid]); // Get the current particle state
+
+    // --- 1. FIELD CALCULATION (Your existing logic) ---
+    vec3 worldPos = p.position.xyz;
+
+    vec3 totalField = evaluateField(worldPos);
 
     // --- 2. PARTICLE INTEGRATION (Basic Physics) ---
     vec3 acceleration = totalField;
@@ -157,17 +273,23 @@ void main()
 
     // --- 3. LIFETIME MANAGEMENT ---
     p.age += u_deltaTime;
+    if (p.age > p.lifetime && !u_respawn) {
+        // Back to the dead list; particle_emit_comp spawns it again.
+        particlesOut[gid] = packParticle(p);
+        lists[2u * u_capacity + atomicAdd(deadCount, 1u)] = gid;
+        return;
+    }
     if (p.age > p.lifetime) {
         // Respawn the particle at a random location
-        vec2 seed = vec2(gid, u_time);
-        p.position.x = mix(u_boundsMin.x, u_boundsMax.x, random(seed * 1.1));
-        p.position.y = mix(u_boundsMin.y, u_boundsMax.y, random(seed * 2.2));
-        p.position.z = mix(u_boundsMin.z, u_boundsMax.z, random(seed * 3.3));
+        p.position.xyz = mix(u_boundsMin, u_boundsMax, random3(gid, 1u));
         p.position = u_visualizerModelMatrix * p.position; // Transform to world space
         p.velocity = vec4(0.0);
         p.age = 0.0;
     }
+    p.color = sampleGradient(u_intensityGradientRow, clamp(length(totalField) / 5.0, 0.0, 1.0))
+            * sampleGradient(u_lifetimeGradientRow, p.age / max(p.lifetime, 1e-6));
 
     // --- 4. WRITE TO OUTPUT ---
-    particlesOut[gid] = p;
+    particlesOut[gid] = packParticle(p);
+    lists[(1u - u_readHalf) * u_capacity + atomicAdd(aliveCount[1u - u_readHalf], 1u)] = gid;
 }
@@ -0,0 +1,13 @@
+#version 430 core
+
+in vec3 v_colour;
+out vec4 FragColor;
+
+void main()
+{
+    // Round points, hard-edged so they stay depth-correct without sorting.
+    if (length(gl_PointCoord - vec2(0.5)) > 0.5) {
+        discard;
+    }
+    FragColor = vec4(v_colour, 1.0);
+}
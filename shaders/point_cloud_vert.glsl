@@ -0,0 +1,29 @@
+#version 430 core
+layout (location = 0) in vec3 aPosition;   // 0..65535 across the node's cube (PackedPoint)
+layout (location = 1) in vec4 aColour;     // sRGB, normalized
+// Per node (divisor 1, PointCloudDrawGpu); baseInstance selects the record.
+layout (location = 2) in vec4 aOrigin;     // xyz = node min (world), w = world point spacing
+layout (location = 3) in vec4 aAxisX;
+layout (location = 4) in vec4 aAxisY;
+layout (location = 5) in vec4 aAxisZ;
+
+#include "frame_uniforms.glsl"
+
+// Framebuffer pixels per world unit at distance 1 (at any distance if orthographic).
+uniform float u_pixelScale;
+uniform float u_maxPointSize;
+
+out vec3 v_colour;
+
+void main()
+{
+    vec3 world = aOrigin.xyz + aAxisX.xyz * aPosition.x + aAxisY.xyz * aPosition.y + aAxisZ.xyz * aPosition.z;
+    gl_Position = u_frameProjection * u_frameEyeView * vec4(world, 1.0);
+
+    // One point covers its node's spacing on screen; w is 1 for orthographic views.
+    gl_PointSize = clamp(aOrigin.w * u_pixelScale / max(gl_Position.w, 1e-4), 1.0, u_maxPointSize);
+
+    // The scene is lit and blended in linear space.
+    vec3 c = aColour.rgb;
+    v_colour = mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), step(0.04045, c));
+}
@@ -0,0 +1,72 @@
+#version 430 core
+// Compute point rasterizer (PointCloudRenderer::splat): one invocation per
+// point of the selected nodes, one pixel per point. Every pixel of the
+// target holds (sRGB colour, linear depth bits); positive floats order like
+// their bit patterns, so atomicMin on the depth word keeps the nearest point.
+// Core 4.3 has no 64-bit atomics to move the colour with it, so the points
+// run twice: pass 0 settles the depth, pass 1 writes the colour of the point
+// that won. point_splat_int64_comp.glsl does both at once where it can.
+layout(local_size_x = 256) in;
+
+#include "frame_uniforms.glsl"
+
+layout(std430, binding = 19) coherent buffer SplatTarget {
+    uint u_target[];          // [2i] colour, [2i + 1] depth bits, 0xFFFFFFFF = empty
+};
+layout(std430, binding = 20) readonly buffer PointPool {
+    uint u_points[];          // PackedPoint: x | y << 16, z, rgba
+};
+struct NodeDraw {             // PointCloudDrawGpu
+    vec4 origin;
+    vec4 axisX;
+    vec4 axisY;
+    vec4 axisZ;
+};
+layout(std430, binding = 21) readonly buffer NodeDraws {
+    NodeDraw u_draws[];
+};
+struct NodeCommand {          // DrawArraysIndirectCommand
+    uint count;
+    uint instanceCount;
+    uint first;
+    uint baseInstance;
+};
+layout(std430, binding = 22) readonly buffer NodeCommands {
+    NodeCommand u_commands[];
+};
+
+uniform int u_pass;
+uniform uint u_nodeOffset;    // dispatches are limited to 65535 nodes each
+uniform ivec2 u_size;         // target pixels, the view drawn this frame
+
+void main()
+{
+    NodeCommand command = u_commands[gl_WorkGroupID.y + u_nodeOffset];
+    if (gl_GlobalInvocationID.x >= command.count) return;
+
+    uint p = (command.first + gl_GlobalInvocationID.x) * 3u;
+    uint xy = u_points[p];
+    vec3 q = vec3(float(xy & 0xFFFFu), float(xy >> 16), float(u_points[p + 1u] & 0xFFFFu));
+    NodeDraw node = u_draws[command.baseInstance];
+    vec3 world = node.origin.xyz + node.axisX.xyz * q.x + node.axisY.xyz * q.y + node.axisZ.xyz * q.z;
+
+    vec4 viewPos = u_frameEyeView * vec4(world, 1.0);
+    float depth = -viewPos.z;
+    if (depth <= 0.0) return;
+    vec4 clip = u_frameProjection * viewPos;
+    vec3 ndc = clip.xyz / clip.w;
+    // Outside the depth range for either convention ([-1, 1] or reversed [0, 1]).
+    if (abs(ndc.z) > 1.0) return;
+
+    ivec2 pixel = ivec2((ndc.xy * 0.5 + 0.5) * vec2(u_size));
+    if (any(lessThan(pixel, ivec2(0))) || any(greaterThanEqual(pixel, u_size))) return;
+    uint i = uint(pixel.y * u_size.x + pixel.x) * 2u;
+
+    uint key = floatBitsToUint(depth);
+    if (u_pass == 0) {
+        atomicMin(u_target[i + 1u], key);
+    }
+    else if (u_target[i + 1u] == key) {
+        u_target[i] = u_points[p + 2u];   // equal depths race harmlessly
+    }
+}
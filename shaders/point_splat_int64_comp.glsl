@@ -0,0 +1,63 @@
+#version 430 core
+// Single-pass twin of point_splat_comp.glsl for drivers with 64-bit atomics:
+// depth bits in the high word, colour in the low one, so one atomicMin keeps
+// the nearest point together with its colour. Same target layout (a
+// little-endian uint64 reads back as uvec2(colour, depth)).
+#extension GL_ARB_gpu_shader_int64 : require
+#extension GL_NV_shader_atomic_int64 : require
+layout(local_size_x = 256) in;
+
+#include "frame_uniforms.glsl"
+
+layout(std430, binding = 19) buffer SplatTarget {
+    uint64_t u_target[];      // depth bits << 32 | colour, all ones = empty
+};
+layout(std430, binding = 20) readonly buffer PointPool {
+    uint u_points[];          // PackedPoint: x | y << 16, z, rgba
+};
+struct NodeDraw {             // PointCloudDrawGpu
+    vec4 origin;
+    vec4 axisX;
+    vec4 axisY;
+    vec4 axisZ;
+};
+layout(std430, binding = 21) readonly buffer NodeDraws {
+    NodeDraw u_draws[];
+};
+struct NodeCommand {          // DrawArraysIndirectCommand
+    uint count;
+    uint instanceCount;
+    uint first;
+    uint baseInstance;
+};
+layout(std430, binding = 22) readonly buffer NodeCommands {
+    NodeCommand u_commands[];
+};
+
+uniform uint u_nodeOffset;    // dispatches are limited to 65535 nodes each
+uniform ivec2 u_size;         // target pixels, the view drawn this frame
+
+void main()
+{
+    NodeCommand command = u_commands[gl_WorkGroupID.y + u_nodeOffset];
+    if (gl_GlobalInvocationID.x >= command.count) return;
+
+    uint p = (command.first + gl_GlobalInvocationID.x) * 3u;
+    uint xy = u_points[p];
+    vec3 q = vec3(float(xy & 0xFFFFu), float(xy >> 16), float(u_points[p + 1u] & 0xFFFFu));
+    NodeDraw node = u_draws[command.baseInstance];
+    vec3 world = node.origin.xyz + node.axisX.xyz * q.x + node.axisY.xyz * q.y + node.axisZ.xyz * q.z;
+
+    vec4 viewPos = u_frameEyeView * vec4(world, 1.0);
+    float depth = -viewPos.z;
+    if (depth <= 0.0) return;
+    vec4 clip = u_frameProjection * viewPos;
+    vec3 ndc = clip.xyz / clip.w;
+    if (abs(ndc.z) > 1.0) return;
+
+    ivec2 pixel = ivec2((ndc.xy * 0.5 + 0.5) * vec2(u_size));
+    if (any(lessThan(pixel, ivec2(0))) || any(greaterThanEqual(pixel, u_size))) return;
+
+    uint64_t word = (uint64_t(floatBitsToUint(depth)) << 32) | uint64_t(u_points[p + 2u]);
+    atomicMin(u_target[pixel.y * u_size.x + pixel.x], word);
+}
@@ -0,0 +1,56 @@
+#version 430 core
+// Writes the splat target into the scene FBO: colour, plus the point's
+// depth so meshes and later passes occlude it as usual. Eye-dome lighting
+// darkens a point by how far its neighbours stand in front of it (in log
+// depth), which outlines shapes without normals.
+
+in vec2 vUV;
+out vec4 FragColor;
+
+#include "frame_uniforms.glsl"
+
+layout(std430, binding = 19) readonly buffer SplatTarget {
+    uvec2 u_target[];         // (sRGB colour, linear depth bits)
+};
+
+uniform ivec2 u_size;
+uniform bool u_zeroToOne;     // reverse-Z clip range
+uniform float u_edlStrength;  // 0 = plain colour
+uniform float u_edlRadius;    // pixels
+
+const uint kEmpty = 0xFFFFFFFFu;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    if (any(greaterThanEqual(pixel, u_size))) discard;
+    uvec2 texel = u_target[pixel.y * u_size.x + pixel.x];
+    if (texel.y == kEmpty) discard;
+    float depth = uintBitsToFloat(texel.y);
+
+    float shade = 1.0;
+    if (u_edlStrength > 0.0) {
+        const vec2 directions[8] = vec2[](
+            vec2(1.0, 0.0), vec2(0.7071, 0.7071), vec2(0.0, 1.0), vec2(-0.7071, 0.7071),
+            vec2(-1.0, 0.0), vec2(-0.7071, -0.7071), vec2(0.0, -1.0), vec2(0.7071, -0.7071));
+        float logDepth = log2(depth);
+        float response = 0.0;
+        for (int k = 0; k < 8; ++k) {
+            ivec2 q = pixel + ivec2(round(directions[k] * u_edlRadius));
+            if (any(lessThan(q, ivec2(0))) || any(greaterThanEqual(q, u_size))) continue;
+            uint neighbour = u_target[q.y * u_size.x + q.x].y;
+            if (neighbour == kEmpty) continue;   // background does not occlude
+            response += max(0.0, logDepth - log2(uintBitsToFloat(neighbour)));
+        }
+        shade = exp(-response / 8.0 * 300.0 * u_edlStrength);
+    }
+
+    // The scene is lit and blended in linear space.
+    vec3 c = unpackUnorm4x8(texel.x).rgb;
+    c = mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), step(0.04045, c));
+    FragColor = vec4(c * shade, 1.0);
+
+    vec4 clip = u_frameProjection * vec4(0.0, 0.0, -depth, 1.0);
+    float ndcZ = clip.z / clip.w;
+    gl_FragDepth = u_zeroToOne ? ndcZ : ndcZ * 0.5 + 0.5;
+}
@@ -4,13 +4,17 @@
 // -----------------------------------------------------------------------------
 out vec2 vUV;                // passed to the fragment shader
 
+// Render targets are larger than the view drawn into their corner; this is
+// the covered fraction, so the triangle samples only that region.
+uniform vec2 u_uvScale = vec2(1.0);
+
 void main()
 {
     // Vertex pattern:  (0,0) – (2,0) – (0,2)
     vec2 pos = vec2( (gl_VertexID << 1) & 2,
                      (gl_VertexID      ) & 2 );
 
-    vUV         = pos;              // 0 → 1 texture coords
+    vUV         = pos * u_uvScale;  // 0 → 1 texture coords, scaled
     gl_Position = vec4(pos * 2.0 - 1.0,   // 0/2 → −1/ 3 in NDC
                        0.0,
                        1.0);
@@ -0,0 +1,74 @@
+#version 430 core
+
+// Scene reconstruction, pass 2 of 2 for one sensor: one work group per active
+// block, one invocation per voxel. Each voxel projects into the sensor's
+// range image and folds the signed distance to the measured surface into its
+// running average; the result also goes to the staging copy read back for
+// meshing. Dispatched indirectly from the active list's header.
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+layout (std430, binding = 12) buffer VoxelPool {
+    uint voxels[];   // per bucket, 512 voxels x + 8y + 64z: low 16 bits snorm TSDF, high 16 bits weight
+};
+layout (std430, binding = 13) readonly buffer ActiveBlocks {
+    uvec4 header;
+    uvec4 active[];
+};
+layout (std430, binding = 14) writeonly buffer StagingVoxels {
+    uint staging[];  // 512 voxels per active-list entry
+};
+layout (std430, binding = 15) readonly buffer RangeImage {
+    uint rangeBits[];
+};
+
+uniform mat4  u_worldToSensor;
+uniform float u_voxelSize;
+uniform float u_truncation;
+uniform uint  u_maxWeight;
+uniform uint  u_activeCapacity;
+
+const float kPi = 3.14159265;
+const uvec2 kImageSize = uvec2(2048u, 256u);   // VoxelReconstruction's range image
+
+void main()
+{
+    uint entry = gl_WorkGroupID.x;
+    if (entry >= min(header.x, u_activeCapacity)) return;
+    uvec4 block = active[entry];
+    uint voxel = gl_LocalInvocationIndex;
+    uint index = block.w * 512u + voxel;
+    uint packed = voxels[index];
+
+    ivec3 cell = (ivec3(block.xyz) - 512) * 8 + ivec3(gl_LocalInvocationID);
+    vec3 local = (u_worldToSensor * vec4((vec3(cell) + 0.5) * u_voxelSize, 1.0)).xyz;
+    float range = length(local);
+    if (range > 1e-3) {
+        float azimuth = atan(local.x, local.z);
+        float elevation = asin(clamp(local.y / range, -1.0, 1.0));
+        ivec2 bin = ivec2(min(uvec2(vec2(azimuth / (2.0 * kPi) + 0.5, elevation / kPi + 0.5) * vec2(kImageSize)),
+                              kImageSize - 1u));
+
+        // Neighbouring elevation bins too: scan lines are sparser than the bins.
+        float measured = uintBitsToFloat(0x7F800000u);   // +inf: no return
+        for (int dy = -1; dy <= 1; ++dy) {
+            int y = bin.y + dy;
+            if (y < 0 || y >= int(kImageSize.y)) continue;
+            uint bits = rangeBits[uint(y) * kImageSize.x + uint(bin.x)];
+            if (bits == 0xFFFFFFFFu) continue;
+            float m = uintBitsToFloat(bits);
+            if (abs(m - range) < abs(measured - range)) measured = m;
+        }
+
+        float sdf = measured - range;
+        if (!isinf(measured) && sdf >= -u_truncation) {
+            float tsdf = min(sdf / u_truncation, 1.0);
+            uint weight = packed >> 16;
+            float previous = float(int(packed << 16) >> 16) / 32767.0;
+            float fused = (previous * float(weight) + tsdf) / float(weight + 1u);
+            weight = min(weight + 1u, u_maxWeight);
+            packed = (uint(int(round(clamp(fused, -1.0, 1.0) * 32767.0))) & 0xFFFFu) | (weight << 16);
+            voxels[index] = packed;
+        }
+    }
+    staging[entry * 512u + voxel] = packed;
+}
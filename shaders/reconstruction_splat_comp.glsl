@@ -0,0 +1,96 @@
+#version 430 core
+
+// Scene reconstruction, pass 1 of 2 for one sensor: bins its new points into
+// a spherical range image (nearest return per bin) and allocates the voxel
+// blocks around each hit in the block hash, appending every block touched
+// this tick to the active list once. See VoxelReconstruction.
+layout (local_size_x = 256) in;
+
+struct SensorPoint {
+    float x, y, z;
+    float time;
+    uint  rgba;
+};
+layout (std430, binding = 10) readonly buffer SensorPoints {
+    SensorPoint points[];
+};
+
+// Open addressing, linear probing; a block's voxels live at its bucket index.
+struct Bucket {
+    uint key;     // packed block coordinate, 0xFFFFFFFF = empty
+    uint stamp;   // last tick the block was appended to the active list
+};
+layout (std430, binding = 11) coherent buffer BlockHash {
+    Bucket buckets[];
+};
+// header.x counts appends (it may exceed the capacity); header.yz = 1 so the
+// buffer doubles as the integrate pass's indirect dispatch.
+layout (std430, binding = 13) buffer ActiveBlocks {
+    uvec4 header;
+    uvec4 active[];   // xyz = block coordinate + 512, w = bucket
+};
+layout (std430, binding = 15) buffer RangeImage {
+    uint rangeBits[];   // floatBitsToUint(range): ordered like the float for range >= 0
+};
+
+uniform uint  u_first;
+uniform uint  u_count;
+uniform mat4  u_sensorToWorld;
+uniform float u_blockSize;      // voxel size * 8
+uniform float u_truncation;
+uniform float u_maxRange;
+uniform uint  u_stamp;
+uniform uint  u_activeCapacity;
+
+const uint kEmpty = 0xFFFFFFFFu;
+const uint kMaxProbes = 64u;
+const float kPi = 3.14159265;
+const uvec2 kImageSize = uvec2(2048u, 256u);   // VoxelReconstruction's range image
+
+void touchBlock(ivec3 block)
+{
+    uvec3 biased = uvec3(block + 512);
+    if (any(greaterThanEqual(biased, uvec3(1024u)))) return;
+    uint key = biased.x | (biased.y << 10) | (biased.z << 20);
+
+    uint mask = uint(buckets.length()) - 1u;
+    uint h = (uint(block.x) * 73856093u ^ uint(block.y) * 19349663u ^ uint(block.z) * 83492791u) & mask;
+    for (uint probe = 0u; probe < kMaxProbes; ++probe, h = (h + 1u) & mask) {
+        uint prev = atomicCompSwap(buckets[h].key, kEmpty, key);
+        if (prev != kEmpty && prev != key) continue;
+        if (atomicExchange(buckets[h].stamp, u_stamp) != u_stamp) {
+            uint slot = atomicAdd(header.x, 1u);
+            if (slot < u_activeCapacity) active[slot] = uvec4(biased, h);
+        }
+        return;
+    }
+}
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= u_count) return;
+    SensorPoint p = points[u_first + id];
+    if (p.time < 0.0) return;   // ring padding
+
+    vec3 local = vec3(p.x, p.y, p.z);
+    float range = length(local);
+    if (range < 1e-3 || range > u_maxRange) return;
+
+    // Spherical bins in the sensor frame: azimuth around +Y, elevation from the XZ plane.
+    float azimuth = atan(local.x, local.z);
+    float elevation = asin(clamp(local.y / range, -1.0, 1.0));
+    uvec2 bin = min(uvec2(vec2(azimuth / (2.0 * kPi) + 0.5, elevation / kPi + 0.5) * vec2(kImageSize)),
+                    kImageSize - 1u);
+    atomicMin(rangeBits[bin.y * kImageSize.x + bin.x], floatBitsToUint(range));
+
+    // The truncation band around the hit spans at most three blocks along the ray.
+    vec3 hit = (u_sensorToWorld * vec4(local, 1.0)).xyz;
+    vec3 dir = normalize(hit - u_sensorToWorld[3].xyz);
+    ivec3 a = ivec3(floor((hit - dir * u_truncation) / u_blockSize));
+    ivec3 b = ivec3(floor(hit / u_blockSize));
+    ivec3 c = ivec3(floor((hit + dir * u_truncation) / u_blockSize));
+    touchBlock(b);
+    if (a != b) touchBlock(a);
+    if (c != b && c != a) touchBlock(c);
+}
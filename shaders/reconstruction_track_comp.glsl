@@ -0,0 +1,151 @@
+#version 430 core
+
+// Scan-to-map registration, one Gauss-Newton iteration for one sensor (see
+// VoxelReconstruction::track). Every sampled point of the new scan is moved
+// by the current pose estimate and the TSDF is interpolated there: the
+// signed distance is the point-to-surface residual and its gradient the
+// surface normal. Residual and Jacobian against a small twist about the
+// sensor origin go into the 6x6 normal equations; each work group strides
+// over the points, reduces its sums in shared memory and writes one row of
+// partials. The CPU adds the rows and solves.
+layout (local_size_x = 256) in;
+
+struct SensorPoint {
+    float x, y, z;
+    float time;
+    uint  rgba;
+};
+layout (std430, binding = 10) readonly buffer SensorPoints {
+    SensorPoint points[];
+};
+
+struct Bucket {
+    uint key;     // packed block coordinate, 0xFFFFFFFF = empty
+    uint stamp;
+};
+layout (std430, binding = 11) readonly buffer BlockHash {
+    Bucket buckets[];
+};
+layout (std430, binding = 12) readonly buffer VoxelPool {
+    uint voxels[];   // per bucket, 512 voxels x + 8y + 64z: low 16 bits snorm TSDF, high 16 bits weight
+};
+layout (std430, binding = 23) writeonly buffer TrackPartials {
+    float partials[];   // kRowStride per work group
+};
+
+uniform uint  u_first[2];       // the scan as at most two runs of the ring
+uniform uint  u_count[2];
+uniform uint  u_stride;         // every n-th point
+uniform mat4  u_sensorToWorld;  // current estimate
+uniform float u_voxelSize;
+uniform float u_truncation;
+uniform float u_maxRange;
+uniform float u_huber;          // residuals above this (m) are down-weighted
+
+const uint kEmpty = 0xFFFFFFFFu;
+const uint kMaxProbes = 64u;
+// 21 upper-triangle J^T J, 6 J^T r, sum r^2, inliers (VoxelReconstruction::kTrackSums).
+const int kSums = 29;
+const uint kRowStride = 32u;
+
+shared float s_reduce[256];
+
+uint findBucket(ivec3 block)
+{
+    uvec3 biased = uvec3(block + 512);
+    if (any(greaterThanEqual(biased, uvec3(1024u)))) return kEmpty;
+    uint key = biased.x | (biased.y << 10) | (biased.z << 20);
+
+    uint mask = uint(buckets.length()) - 1u;
+    uint h = (uint(block.x) * 73856093u ^ uint(block.y) * 19349663u ^ uint(block.z) * 83492791u) & mask;
+    for (uint probe = 0u; probe < kMaxProbes; ++probe, h = (h + 1u) & mask) {
+        uint k = buckets[h].key;
+        if (k == key) return h;
+        if (k == kEmpty) return kEmpty;
+    }
+    return kEmpty;
+}
+
+// False if the voxel was never observed or lies on the truncated edge of the
+// band, where the distance no longer says which way the surface is.
+bool sampleVoxel(ivec3 cell, out float tsdf)
+{
+    tsdf = 0.0;
+    uint bucket = findBucket(cell >> 3);
+    if (bucket == kEmpty) return false;
+    ivec3 local = cell & 7;
+    uint packed = voxels[bucket * 512u + uint(local.x + 8 * local.y + 64 * local.z)];
+    if ((packed >> 16) == 0u) return false;
+    tsdf = float(int(packed << 16) >> 16) / 32767.0;
+    return abs(tsdf) < 0.99;
+}
+
+void main()
+{
+    float sums[kSums];
+    for (int s = 0; s < kSums; ++s) sums[s] = 0.0;
+
+    vec3 centre = u_sensorToWorld[3].xyz;
+    uint total = u_count[0] + u_count[1];
+    uint advance = gl_NumWorkGroups.x * gl_WorkGroupSize.x * u_stride;
+    for (uint k = gl_GlobalInvocationID.x * u_stride; k < total; k += advance) {
+        SensorPoint p = points[k < u_count[0] ? u_first[0] + k : u_first[1] + (k - u_count[0])];
+        if (p.time < 0.0) continue;   // ring padding
+        vec3 local = vec3(p.x, p.y, p.z);
+        float range = length(local);
+        if (range < 1e-3 || range > u_maxRange) continue;
+
+        // Trilinear TSDF and its gradient between the eight surrounding voxel centres.
+        vec3 q = (u_sensorToWorld * vec4(local, 1.0)).xyz;
+        vec3 g = q / u_voxelSize - 0.5;
+        ivec3 c0 = ivec3(floor(g));
+        vec3 f = g - vec3(c0);
+        float v[8];
+        bool known = true;
+        for (int c = 0; c < 8 && known; ++c)
+            known = sampleVoxel(c0 + ivec3(c & 1, (c >> 1) & 1, c >> 2), v[c]);
+        if (!known) continue;
+
+        float x00 = mix(v[0], v[1], f.x), x10 = mix(v[2], v[3], f.x);
+        float x01 = mix(v[4], v[5], f.x), x11 = mix(v[6], v[7], f.x);
+        float y0 = mix(x00, x10, f.y), y1 = mix(x01, x11, f.y);
+        vec3 gradient = vec3(
+            mix(mix(v[1] - v[0], v[3] - v[2], f.y), mix(v[5] - v[4], v[7] - v[6], f.y), f.z),
+            mix(x10 - x00, x11 - x01, f.z),
+            y1 - y0);
+        float gradientLength = length(gradient);
+        if (gradientLength < 1e-4) continue;
+
+        // Point-to-plane: r = n . dq, with dq = omega x (q - centre) + v.
+        float r = mix(y0, y1, f.z) * u_truncation;
+        vec3 n = gradient / gradientLength;
+        float w = abs(r) <= u_huber ? 1.0 : u_huber / abs(r);
+        float J[6];
+        vec3 rotational = cross(q - centre, n);
+        J[0] = rotational.x; J[1] = rotational.y; J[2] = rotational.z;
+        J[3] = n.x; J[4] = n.y; J[5] = n.z;
+
+        int s = 0;
+        for (int i = 0; i < 6; ++i)
+            for (int j = i; j < 6; ++j)
+                sums[s++] += w * J[i] * J[j];
+        for (int i = 0; i < 6; ++i)
+            sums[21 + i] += w * J[i] * r;
+        sums[27] += w * r * r;
+        sums[28] += 1.0;
+    }
+
+    uint lane = gl_LocalInvocationIndex;
+    for (int s = 0; s < kSums; ++s) {
+        s_reduce[lane] = sums[s];
+        memoryBarrierShared();
+        barrier();
+        for (uint width = gl_WorkGroupSize.x / 2u; width > 0u; width >>= 1) {
+            if (lane < width) s_reduce[lane] += s_reduce[lane + width];
+            memoryBarrierShared();
+            barrier();
+        }
+        if (lane == 0u) partials[gl_WorkGroupID.x * kRowStride + uint(s)] = s_reduce[0];
+        barrier();
+    }
+}
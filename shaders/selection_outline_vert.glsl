@@ -0,0 +1,26 @@
+#version 430 core
+// Selection outline hull: the mesh pushed out along its screen-space normal
+// by u_outlineWidth pixels. With u_outlineWidth = 0 it is the plain
+// silhouette, used to mark the stencil before the hull is drawn.
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+uniform mat4 model;
+uniform float u_outlineWidth = 3.0; // pixels
+
+#include "frame_uniforms.glsl"
+
+void main()
+{
+    mat4 viewProj = u_frameProjection * u_frameEyeView;   // 'model' is eye-relative
+    vec4 clip = viewProj * model * vec4(aPos, 1.0);
+
+    vec3 worldNormal = mat3(transpose(inverse(model))) * aNormal;
+    vec2 screenNormal = (viewProj * vec4(worldNormal, 0.0)).xy;
+    if (dot(screenNormal, screenNormal) > 1e-12) {
+        // NDC spans 2 units per viewport, so one pixel is 2 / size.
+        vec2 offset = normalize(screenNormal) * u_outlineWidth * 2.0 / u_frameViewportTime.xy;
+        clip.xy += offset * clip.w;
+    }
+    gl_Position = clip;
+}
@@ -0,0 +1,12 @@
+#version 430 core
+
+in vec4 v_colour;
+out vec4 FragColor;
+
+void main()
+{
+    if (length(gl_PointCoord - vec2(0.5)) > 0.5) {
+        discard;
+    }
+    FragColor = v_colour;
+}
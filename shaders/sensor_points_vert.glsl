@@ -0,0 +1,40 @@
+#version 430 core
+
+// One sensor's ring, written in place by its reader (SensorPoint, 20 bytes).
+struct SensorPoint {
+    float x, y, z;
+    float time;
+    uint  rgba;   // sRGB, R in the low byte
+};
+layout (std430, binding = 10) readonly buffer SensorPoints {
+    SensorPoint points[];
+};
+
+#include "frame_uniforms.glsl"
+
+uniform mat4  u_model;        // sensor pose
+uniform float u_now;          // SensorStream::clockSeconds()
+uniform float u_maxAge;
+uniform float u_pointSize;
+
+out vec4 v_colour;
+
+void main()
+{
+    SensorPoint p = points[gl_VertexID];
+    float fade = 1.0 - (u_now - p.time) / u_maxAge;
+    if (fade <= 0.0) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);   // outside the clip volume: culled
+        gl_PointSize = 1.0;
+        v_colour = vec4(0.0);
+        return;
+    }
+
+    gl_Position = u_frameProjection * u_frameView * u_model * vec4(p.x, p.y, p.z, 1.0);
+    gl_PointSize = u_pointSize;
+
+    // The scene is lit and blended in linear space.
+    vec3 c = unpackUnorm4x8(p.rgba).rgb;
+    c = mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), step(0.04045, c));
+    v_colour = vec4(c, min(fade, 1.0));
+}
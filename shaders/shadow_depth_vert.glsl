@@ -0,0 +1,23 @@
+/*
+================================================================================
+|                            shadow_depth_vert.glsl                            |
+================================================================================
+*/
+#version 430 core
+
+// Shadow caster depth for one cascade. Reads the arena VAO like
+// instanced_phong_vert.glsl but only the position and the instance's model
+// columns; there is no fragment stage, the depth attachment is all it writes.
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec4 aInstanceMatCol0;
+layout (location = 3) in vec4 aInstanceMatCol1;
+layout (location = 4) in vec4 aInstanceMatCol2;
+layout (location = 5) in vec4 aInstanceMatCol3;
+
+uniform mat4 u_lightViewProjection;
+
+void main()
+{
+    mat4 model = mat4(aInstanceMatCol0, aInstanceMatCol1, aInstanceMatCol2, aInstanceMatCol3);
+    gl_Position = u_lightViewProjection * model * vec4(aPos, 1.0);
+}
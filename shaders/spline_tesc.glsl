@@ -1,9 +1,131 @@
 #version 430 core
+// Picks each segment's tessellation level from its projected length, so a
+// curve gets roughly one line per u_pixelsPerSegment pixels on screen.
 layout (vertices = 1) out;
 
+flat in int v_segment[];
+flat in ivec4 v_spline[];
+flat in vec4 v_glow[];
+flat in vec4 v_core[];
+flat in float v_width[];
+
+flat out int tc_segment[];
+flat out ivec4 tc_spline[];
+flat out vec4 tc_glow[];
+flat out vec4 tc_core[];
+flat out float tc_width[];
+
+uniform float u_pixelsPerSegment = 6.0;
+
+#include "frame_uniforms.glsl"
+
+// Control points of every spline (SplineArena, vec4 with w = 1).
+layout (std430, binding = 0) readonly buffer SplineControlPoints {
+    vec4 points[];
+};
+
+// s = (firstPoint, pointCount, type, segmentCount); type 0 = Linear,
+// 1 = Catmull-Rom, 2 = Bezier, 3 = piecewise cubic Bezier.
+vec3 cp(ivec4 s, int i)
+{
+    return points[s.x + clamp(i, 0, s.y - 1)].xyz;
+}
+
+// Bernstein sum over all control points, scaled so the powers never underflow.
+vec3 evalBezier(ivec4 s, float t)
+{
+    int n = s.y - 1;
+    bool flip = t > 0.5;
+    float a = flip ? 1.0 - t : t;
+    float b = 1.0 - a;
+    float r = a / b;
+    vec3 sum = cp(s, flip ? n : 0);
+    float coeff = 1.0;
+    float rj = 1.0;
+    float bn = 1.0;
+    for (int j = 1; j <= n; ++j) {
+        coeff *= float(n - j + 1) / float(j);
+        rj *= r;
+        bn *= b;
+        sum += coeff * rj * cp(s, flip ? n - j : j);
+    }
+    return sum * bn;
+}
+
+vec3 evalSegment(ivec4 s, int seg, float u)
+{
+    if (s.z == 1) {
+        vec3 p0 = cp(s, seg), p1 = cp(s, seg + 1), p2 = cp(s, seg + 2), p3 = cp(s, seg + 3);
+        float u2 = u * u, u3 = u2 * u;
+        return 0.5 * ((2.0 * p1) + (-p0 + p2) * u
+            + (2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3) * u2
+            + (-p0 + 3.0 * p1 - 3.0 * p2 + p3) * u3);
+    }
+    if (s.z == 2)
+        return evalBezier(s, (float(seg) + u) / float(s.w));
+    if (s.z == 3) {
+        vec3 p0 = cp(s, 3 * seg), p1 = cp(s, 3 * seg + 1), p2 = cp(s, 3 * seg + 2), p3 = cp(s, 3 * seg + 3);
+        float v = 1.0 - u;
+        return v * v * v * p0 + 3.0 * v * v * u * p1 + 3.0 * v * u * u * p2 + u * u * u * p3;
+    }
+    return mix(cp(s, seg), cp(s, seg + 1), u);
+}
+
+const int kProbes = 5;
+
 void main()
 {
-    /* one patch = the whole curve  let TE control t-subdivision */
-    gl_out[0].gl_Position = vec4(0.0);           // dummy
-    gl_TessLevelOuter[0]  = 32.0;                // 32 segments
-}
\ No newline at end of file
+    tc_segment[gl_InvocationID] = v_segment[0];
+    tc_spline[gl_InvocationID] = v_spline[0];
+    tc_glow[gl_InvocationID] = v_glow[0];
+    tc_core[gl_InvocationID] = v_core[0];
+    tc_width[gl_InvocationID] = v_width[0];
+    gl_out[gl_InvocationID].gl_Position = vec4(0.0);
+
+    ivec4 s = v_spline[0];
+    int seg = v_segment[0];
+    mat4 viewProj = u_frameProjection * u_frameView;
+    vec2 viewport = u_frameViewportTime.xy;
+
+    vec4 clip[kProbes];
+    for (int i = 0; i < kProbes; ++i)
+        clip[i] = viewProj * vec4(evalSegment(s, seg, float(i) / float(kProbes - 1)), 1.0);
+
+    // Drop the patch when every probe lies beyond the same clip plane,
+    // widened by the line's half-width so glow quads never pop at the edges.
+    vec2 margin = 1.0 + 2.0 * v_width[0] / viewport;
+    bvec4 allOut = bvec4(true);
+    bool allBehind = true;
+    for (int i = 0; i < kProbes; ++i) {
+        vec4 c = clip[i];
+        allOut = bvec4(allOut.x && c.x < -c.w * margin.x, allOut.y && c.x > c.w * margin.x,
+                       allOut.z && c.y < -c.w * margin.y, allOut.w && c.y > c.w * margin.y);
+        allBehind = allBehind && c.w <= 0.0;
+    }
+    if (any(allOut) || allBehind) {
+        gl_TessLevelOuter[0] = 0.0;
+        gl_TessLevelOuter[1] = 0.0;
+        return;
+    }
+
+    float level = float(gl_MaxTessGenLevel);
+    if (s.z == 0) {
+        level = 1.0;
+    }
+    else {
+        bool crossesEye = false;
+        float pixels = 0.0;
+        for (int i = 1; i < kProbes; ++i) {
+            if (clip[i - 1].w <= 0.0 || clip[i].w <= 0.0) { crossesEye = true; break; }
+            vec2 a = clip[i - 1].xy / clip[i - 1].w;
+            vec2 b = clip[i].xy / clip[i].w;
+            pixels += length((b - a) * 0.5 * viewport);
+        }
+        // Segments crossing the eye plane cannot be measured; keep full detail.
+        if (!crossesEye)
+            level = clamp(ceil(pixels / u_pixelsPerSegment), 1.0, float(gl_MaxTessGenLevel));
+    }
+
+    gl_TessLevelOuter[0] = 1.0;   // one isoline per patch
+    gl_TessLevelOuter[1] = level; // lines along it
+}
@@ -1,31 +1,75 @@
 #version 430 core
+// Evaluates the curve at the tessellated parameter; positions stay in world
+// space for glow_line_geom.glsl, which expands each line into a quad.
+layout (isolines, equal_spacing) in;
 
-layout (isoline, equal_spacing, cw) in;
+flat in int tc_segment[];
+flat in ivec4 tc_spline[];
+flat in vec4 tc_glow[];
+flat in vec4 tc_core[];
+flat in float tc_width[];
 
-uniform mat4 u_proj;
-uniform mat4 u_view;
+// Same interface glow_line_vert.glsl feeds the geometry stage.
+out vec4 v_glowColour;
+out vec4 v_coreColour;
+out float v_thickness;
 
-layout(std430, binding = 0) buffer ControlPointBuffer {
-    vec3 points[];
+// Control points of every spline (SplineArena, vec4 with w = 1).
+layout (std430, binding = 0) readonly buffer SplineControlPoints {
+    vec4 points[];
 };
 
-vec3 p(int i) {
-    return points[clamp(i, 0, int(points.length()) - 1)];
+// s = (firstPoint, pointCount, type, segmentCount); type 0 = Linear,
+// 1 = Catmull-Rom, 2 = Bezier, 3 = piecewise cubic Bezier.
+vec3 cp(ivec4 s, int i)
+{
+    return points[s.x + clamp(i, 0, s.y - 1)].xyz;
 }
 
-vec3 evalCatmullRom(float t) {
-    int numPoints = int(points.length());
-    if (numPoints < 4) return vec3(0.0);
-    float ft = t * (numPoints - 3);
-    int i = int(floor(ft)) + 1;
-    float u = fract(ft);
-    vec3 P0 = p(i - 1), P1 = p(i), P2 = p(i + 1), P3 = p(i + 2);
-    float u2 = u * u, u3 = u2 * u;
-    return 0.5 * ((2.0 * P1) + (-P0 + P2) * u + (2.0 * P0 - 5.0 * P1 + 4.0 * P2 - P3) * u2 + (-P0 + 3.0 * P1 - 3.0 * P2 + P3) * u3);
+// Bernstein sum over all control points, scaled so the powers never underflow.
+vec3 evalBezier(ivec4 s, float t)
+{
+    int n = s.y - 1;
+    bool flip = t > 0.5;
+    float a = flip ? 1.0 - t : t;
+    float b = 1.0 - a;
+    float r = a / b;
+    vec3 sum = cp(s, flip ? n : 0);
+    float coeff = 1.0;
+    float rj = 1.0;
+    float bn = 1.0;
+    for (int j = 1; j <= n; ++j) {
+        coeff *= float(n - j + 1) / float(j);
+        rj *= r;
+        bn *= b;
+        sum += coeff * rj * cp(s, flip ? n - j : j);
+    }
+    return sum * bn;
 }
 
-void main() {
-    float t = gl_TessCoord.x;
-    vec3 pos = evalCatmullRom(t);
-    gl_Position = u_proj * u_view * vec4(pos, 1.0);
-}
\ No newline at end of file
+vec3 evalSegment(ivec4 s, int seg, float u)
+{
+    if (s.z == 1) {
+        vec3 p0 = cp(s, seg), p1 = cp(s, seg + 1), p2 = cp(s, seg + 2), p3 = cp(s, seg + 3);
+        float u2 = u * u, u3 = u2 * u;
+        return 0.5 * ((2.0 * p1) + (-p0 + p2) * u
+            + (2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3) * u2
+            + (-p0 + 3.0 * p1 - 3.0 * p2 + p3) * u3);
+    }
+    if (s.z == 2)
+        return evalBezier(s, (float(seg) + u) / float(s.w));
+    if (s.z == 3) {
+        vec3 p0 = cp(s, 3 * seg), p1 = cp(s, 3 * seg + 1), p2 = cp(s, 3 * seg + 2), p3 = cp(s, 3 * seg + 3);
+        float v = 1.0 - u;
+        return v * v * v * p0 + 3.0 * v * v * u * p1 + 3.0 * v * u * u * p2 + u * u * u * p3;
+    }
+    return mix(cp(s, seg), cp(s, seg + 1), u);
+}
+
+void main()
+{
+    v_glowColour = tc_glow[0];
+    v_coreColour = tc_core[0];
+    v_thickness = tc_width[0];
+    gl_Position = vec4(evalSegment(tc_spline[0], tc_segment[0], gl_TessCoord.x), 1.0);
+}
@@ -1,2 +1,24 @@
 #version 430 core
-void main() { }
\ No newline at end of file
+// One patch vertex per curve segment; the control stages fetch the segment's
+// control points from the SSBO. Per-spline data arrives as divisor-1
+// attributes (SplineStyleGpu) selected by the indirect command's baseInstance.
+layout (location = 1) in vec4 aGlowColour;
+layout (location = 2) in vec4 aCoreColour;
+layout (location = 3) in float aThickness;
+layout (location = 4) in ivec4 aSpline; // firstPoint, pointCount, type, segmentCount
+
+flat out int v_segment;
+flat out ivec4 v_spline;
+flat out vec4 v_glow;
+flat out vec4 v_core;
+flat out float v_width;
+
+void main()
+{
+    v_segment = gl_VertexID;
+    v_spline = aSpline;
+    v_glow = aGlowColour;
+    v_core = aCoreColour;
+    v_width = aThickness;
+    gl_Position = vec4(0.0);
+}
@@ -0,0 +1,52 @@
+#version 430 core
+
+// Single-pass stereo for the batched mesh pass: one invocation per eye. The
+// triangle goes to the eye's layer of the target's stereo arrays through
+// that eye's matrix, unless it lies wholly outside one plane of the eye's
+// frustum. Everything else passes through to instanced_phong_frag.glsl, so
+// one indirect draw shades both eyes.
+layout (triangles, invocations = 2) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+#include "frame_uniforms.glsl"
+
+in VertexData {
+    vec3 FragPos;
+    vec3 Normal;
+    vec3 ObjectColor;
+    flat uint InstancePickId;
+    flat uint InstanceMaterial;
+    vec2 TexCoord;
+} vIn[];
+
+out VertexData {
+    vec3 FragPos;
+    vec3 Normal;
+    vec3 ObjectColor;
+    flat uint InstancePickId;
+    flat uint InstanceMaterial;
+    vec2 TexCoord;
+} vOut;
+
+void main()
+{
+    vec4 clip[3];
+    for (int i = 0; i < 3; ++i) clip[i] = u_frameStereoEyeViewProjection[gl_InvocationID] * vec4(vIn[i].FragPos, 1.0);
+    for (int axis = 0; axis < 3; ++axis) {
+        if (clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w) return;
+        if (clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w) return;
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        vOut.FragPos = vIn[i].FragPos;
+        vOut.Normal = vIn[i].Normal;
+        vOut.ObjectColor = vIn[i].ObjectColor;
+        vOut.InstancePickId = vIn[i].InstancePickId;
+        vOut.InstanceMaterial = vIn[i].InstanceMaterial;
+        vOut.TexCoord = vIn[i].TexCoord;
+        gl_Position = clip[i];
+        gl_Layer = gl_InvocationID;
+        EmitVertex();
+    }
+    EndPrimitive();
+}
@@ -0,0 +1,85 @@
+#version 430 core
+
+// Streamlines mode: traces one line per seed through the baked field with
+// classic RK4 on the normalised field, u_stepLength world units per step.
+// Seeds sit on a u_seedsX x u_seedsY x (u_lineCount / both) grid over the visualizer bounds (cell
+// centres). A line ends after u_maxPoints points, where the field drops
+// below u_minSpeed, or when it leaves the bounds. Each line owns
+// u_maxPoints slots of the point buffer and writes its DrawArraysIndirectCommand;
+// lines shorter than two points draw nothing.
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+struct DrawArraysCommand {
+    uint count;
+    uint instanceCount;
+    uint first;
+    uint baseInstance;
+};
+
+layout(std430, binding = 0) writeonly buffer StreamlinePoints { vec4 points[]; };   // xyz, w = speed
+layout(std430, binding = 1) writeonly buffer StreamlineCommands { DrawArraysCommand commands[]; };
+
+uniform sampler3D u_bakedField;
+uniform mat4 u_worldToFieldUVW;      // world -> [0,1]^3 over the visualizer bounds
+uniform mat4 u_visualizerModelMatrix;
+uniform vec3 u_boundsMin;
+uniform vec3 u_boundsMax;
+uniform uint u_seedsX;
+uniform uint u_seedsY;
+uniform uint u_lineCount;
+uniform uint u_maxPoints;
+uniform float u_stepLength;
+uniform float u_minSpeed;
+
+vec3 toUVW(vec3 worldPos) {
+    return (u_worldToFieldUVW * vec4(worldPos, 1.0)).xyz;
+}
+
+bool inside(vec3 uvw) {
+    return all(greaterThanEqual(uvw, vec3(0.0))) && all(lessThanEqual(uvw, vec3(1.0)));
+}
+
+vec3 fieldAt(vec3 worldPos) {
+    return textureLod(u_bakedField, toUVW(worldPos), 0.0).xyz;
+}
+
+// Unit direction of the field, zero where it is too weak to follow.
+vec3 directionAt(vec3 worldPos) {
+    vec3 v = fieldAt(worldPos);
+    float speed = length(v);
+    return speed >= u_minSpeed ? v / speed : vec3(0.0);
+}
+
+void main()
+{
+    uint line = gl_GlobalInvocationID.x;
+    if (line >= u_lineCount) return;
+
+    uvec3 seeds = uvec3(u_seedsX, u_seedsY, u_lineCount / (u_seedsX * u_seedsY));
+    uvec3 cell = uvec3(line % seeds.x, (line / seeds.x) % seeds.y, line / (seeds.x * seeds.y));
+    vec3 t = (vec3(cell) + 0.5) / vec3(seeds);
+    vec3 p = (u_visualizerModelMatrix * vec4(mix(u_boundsMin, u_boundsMax, t), 1.0)).xyz;
+
+    uint first = line * u_maxPoints;
+    uint count = 0u;
+    float h = u_stepLength;
+    while (count < u_maxPoints) {
+        float speed = length(fieldAt(p));
+        points[first + count] = vec4(p, speed);
+        ++count;
+        if (speed < u_minSpeed) break;
+
+        vec3 k1 = directionAt(p);
+        vec3 k2 = directionAt(p + 0.5 * h * k1);
+        vec3 k3 = directionAt(p + 0.5 * h * k2);
+        vec3 k4 = directionAt(p + h * k3);
+        vec3 next = p + h / 6.0 * (k1 + 2.0 * k2 + 2.0 * k3 + k4);
+        if (!inside(toUVW(next)) || next == p) break;
+        p = next;
+    }
+
+    commands[line].count = count >= 2u ? count : 0u;
+    commands[line].instanceCount = 1u;
+    commands[line].first = first;
+    commands[line].baseInstance = 0u;
+}
@@ -0,0 +1,55 @@
+﻿#version 430 core
+
+// Temporal anti-aliasing: this frame's scene, drawn with a sub-pixel jitter,
+// blended into the history of earlier frames. Each pixel finds where its
+// surface was last frame from the depth buffer (camera motion only; moving
+// objects are held back by the clamp instead) and the history sample is
+// clamped to the 3x3 neighbourhood here, so disocclusions and movers do not
+// smear for long.
+
+in  vec2 vUV;
+layout(location = 0) out vec4 fragColor;
+
+uniform sampler2D u_scene;
+uniform sampler2D u_depth;
+uniform sampler2D u_history;
+uniform vec2      u_uvScale = vec2(1.0);   // shared with post_process_vert
+uniform vec2      u_historyUvScale;        // region the history was drawn into
+uniform mat4      u_reprojection;          // this frame's NDC -> last frame's clip space
+uniform bool      u_reverseZ;
+uniform float     u_feedback;              // history weight; 0 restarts the accumulation
+
+// Weighs samples down by brightness, so a lone bright texel cannot flicker
+// the whole neighbourhood.
+vec3 compress(vec3 c)   { return c / (1.0 + max(c.r, max(c.g, c.b))); }
+vec3 uncompress(vec3 c) { return c / max(1.0 - max(c.r, max(c.g, c.b)), 1e-4); }
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(u_scene, 0));
+    vec2 lo = 0.5 * texel, hi = u_uvScale - 0.5 * texel;
+
+    vec3 current = compress(texture(u_scene, vUV).rgb);
+    vec3 nMin = current, nMax = current;
+    for (int y = -1; y <= 1; ++y)
+        for (int x = -1; x <= 1; ++x) {
+            if (x == 0 && y == 0) continue;
+            vec3 c = compress(texture(u_scene, clamp(vUV + vec2(x, y) * texel, lo, hi)).rgb);
+            nMin = min(nMin, c);
+            nMax = max(nMax, c);
+        }
+
+    float depth = texture(u_depth, vUV).r;
+    vec3 ndc = vec3(vUV / u_uvScale * 2.0 - 1.0, u_reverseZ ? depth : depth * 2.0 - 1.0);
+    vec4 previous = u_reprojection * vec4(ndc, 1.0);
+    vec2 historyUV = (previous.xy / previous.w * 0.5 + 0.5) * u_historyUvScale;
+
+    // A restarted history may be a recycled texture's garbage: never sample it.
+    if (u_feedback <= 0.0 || previous.w <= 0.0
+        || any(lessThan(historyUV, vec2(0.0))) || any(greaterThan(historyUV, u_historyUvScale))) {
+        fragColor = vec4(uncompress(current), 1.0);
+        return;
+    }
+    vec3 history = clamp(compress(texture(u_history, historyUV).rgb), nMin, nMax);
+    fragColor = vec4(uncompress(mix(current, history, u_feedback)), 1.0);
+}
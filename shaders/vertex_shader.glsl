@@ -1,30 +1,34 @@
 // =================================================================
 //                      vertex_shader.glsl
 // =================================================================
-#version 330 core
+#version 430 core
 
 // We explicitly define the inputs the shader expects from the C++ side.
 // Location 0: The vertex's position in model space.
 // Location 1: The vertex's normal vector in model space.
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+// Location 9: texture coordinates, full arena layout only (else (0, 0)).
+layout (location = 9) in vec2 aUv;
 
 // Uniforms set from the C++ application
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+#include "frame_uniforms.glsl"
 
 // Data to be passed to the fragment shader
-out vec3 FragPos;   // The vertex position transformed into world space
+out vec3 FragPos;   // The vertex position relative to the eye, in world orientation
 out vec3 Normal;    // The normal vector transformed into world space
+out vec2 TexCoord;
 
 void main()
 {
-    // Transform the vertex position and normal vector into world space.
+    // Transform the vertex position and normal vector; 'model' is eye-relative.
     FragPos = vec3(model * vec4(aPos, 1.0));
     // Use the normal matrix to correctly transform normals (handles non-uniform scaling).
     Normal = mat3(transpose(inverse(model))) * aNormal;
+    TexCoord = aUv;
 
     // Calculate the final clip-space position of the vertex.
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    gl_Position = u_frameProjection * u_frameEyeView * vec4(FragPos, 1.0);
 }
@@ -0,0 +1,32 @@
+#version 430 core
+
+// One invocation per view of the pass (VirtualSensors::kViewsPerPass): the
+// triangle goes to the view's layer of the depth array through the view's
+// viewport, unless it lies wholly outside one plane of the view's frustum.
+// There is no fragment stage; the depth attachment is all it writes.
+layout (triangles, invocations = 16) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+uniform mat4 u_viewProjection[16];
+uniform int  u_viewCount;
+uniform int  u_firstLayer;
+
+void main()
+{
+    if (gl_InvocationID >= u_viewCount) return;
+
+    vec4 clip[3];
+    for (int i = 0; i < 3; ++i) clip[i] = u_viewProjection[gl_InvocationID] * gl_in[i].gl_Position;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w) return;
+        if (clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w) return;
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        gl_Position = clip[i];
+        gl_Layer = u_firstLayer + gl_InvocationID;
+        gl_ViewportIndex = gl_InvocationID;
+        EmitVertex();
+    }
+    EndPrimitive();
+}
@@ -0,0 +1,16 @@
+#version 430 core
+
+// Virtual sensor depth (see VirtualSensors): casters in world space, for
+// virtual_sensor_depth_geom.glsl to project into every view of the pass.
+// Reads the arena VAO like shadow_depth_vert.glsl.
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec4 aInstanceMatCol0;
+layout (location = 3) in vec4 aInstanceMatCol1;
+layout (location = 4) in vec4 aInstanceMatCol2;
+layout (location = 5) in vec4 aInstanceMatCol3;
+
+void main()
+{
+    mat4 model = mat4(aInstanceMatCol0, aInstanceMatCol1, aInstanceMatCol2, aInstanceMatCol3);
+    gl_Position = model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,100 @@
+#version 430 core
+
+// Virtual sensors: one sensor's depth layers to SensorPoints in its ring
+// (see VirtualSensors). One invocation per point: a pixel of a depth
+// camera, or a (column, beam) ray of a LiDAR looked up in the cube face its
+// azimuth falls in. Rays without a return in range are written expired,
+// like ring padding, so every invocation writes exactly its own slot.
+layout (local_size_x = 256) in;
+
+struct SensorPoint {
+    float x, y, z;
+    float time;
+    uint  rgba;   // sRGB, R in the low byte
+};
+layout (std430, binding = 10) writeonly buffer SensorPoints {
+    SensorPoint points[];
+};
+
+uniform sampler2DArray u_depth;   // standard depth, 1 = nothing drawn
+
+uniform uint  u_base;       // ring index of the first point
+uniform uint  u_mask;       // ring capacity - 1
+uniform uint  u_count;
+uniform float u_now;        // SensorStream::clockSeconds()
+uniform float u_minRange;
+uniform float u_maxRange;
+uniform bool  u_lidar;
+
+// Depth camera: its one layer, looking down -Z.
+uniform ivec2 u_size;
+uniform int   u_layer;
+uniform mat4  u_inverseProjection;
+
+// LiDAR: columns of beams, spinning about +Y from +Z towards +X.
+uniform uint  u_beams;
+uniform uint  u_steps;        // columns per turn
+uniform uint  u_firstColumn;  // within the turn
+uniform float u_verticalFov;  // radians, centred on the horizon
+uniform int   u_faceLayer[4]; // -1 where the face was not rendered
+uniform mat4  u_faceRotation[4];
+uniform mat4  u_faceProjection;
+uniform ivec2 u_faceSize;
+
+const float kPi = 3.14159265;
+
+// SimulatedLidarReader's range colours.
+uint rangeColour(float range)
+{
+    float t = clamp(range / u_maxRange, 0.0, 1.0);
+    uvec3 c = uvec3(clamp(vec3(1.0 - t, 0.35 + 0.5 * t, t), 0.0, 1.0) * 255.0 + 0.5);
+    return c.r | (c.g << 8) | (c.b << 16) | (255u << 24);
+}
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= u_count) return;
+
+    vec3 point = vec3(0.0);
+    float range = -1.0;
+    if (!u_lidar) {
+        ivec2 pixel = ivec2(int(id % uint(u_size.x)), int(id / uint(u_size.x)));
+        float depth = texelFetch(u_depth, ivec3(pixel, u_layer), 0).r;
+        if (depth < 1.0) {
+            vec2 ndc = (vec2(pixel) + 0.5) / vec2(u_size) * 2.0 - 1.0;
+            vec4 p = u_inverseProjection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+            point = p.xyz / p.w;
+            range = length(point);
+        }
+    }
+    else {
+        uint column = id / u_beams, beam = id % u_beams;
+        float azimuth = 2.0 * kPi * float((u_firstColumn + column) % u_steps) / float(u_steps);
+        float elevation = u_beams > 1u ? u_verticalFov * (float(beam) / float(u_beams - 1u) - 0.5) : 0.0;
+        vec3 ray = vec3(cos(elevation) * sin(azimuth), sin(elevation), cos(elevation) * cos(azimuth));
+
+        int face = int(floor(azimuth / (0.5 * kPi) + 0.5)) & 3;
+        vec3 v = mat3(u_faceRotation[face]) * ray;
+        vec4 clip = u_faceProjection * vec4(v, 1.0);
+        vec2 ndc = clip.xy / clip.w;
+        if (u_faceLayer[face] >= 0 && v.z < 0.0 && all(lessThanEqual(abs(ndc), vec2(1.0)))) {
+            ivec2 texel = min(ivec2((ndc * 0.5 + 0.5) * vec2(u_faceSize)), u_faceSize - 1);
+            float depth = texelFetch(u_depth, ivec3(texel, u_faceLayer[face]), 0).r;
+            if (depth < 1.0) {
+                // View-space z of the depth, then along the ray to it.
+                float z = -u_faceProjection[3][2] / (depth * 2.0 - 1.0 + u_faceProjection[2][2]);
+                range = z / v.z;
+                point = ray * range;
+            }
+        }
+    }
+
+    bool hit = range >= u_minRange && range <= u_maxRange;
+    uint slot = (u_base + id) & u_mask;
+    points[slot].x = hit ? point.x : 0.0;
+    points[slot].y = hit ? point.y : 0.0;
+    points[slot].z = hit ? point.z : 0.0;
+    points[slot].time = hit ? u_now : -1e30;
+    points[slot].rgba = hit ? rangeColour(range) : 0u;
+}
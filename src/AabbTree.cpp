@@ -0,0 +1,204 @@
+#include "AabbTree.hpp"
+
+#include <algorithm>
+
+namespace {
+float surfaceArea(const glm::vec3& mn, const glm::vec3& mx)
+{
+    const glm::vec3 e = mx - mn;
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+}
+
+std::int32_t AabbTree::allocateNode()
+{
+    if (m_freeList == kNull) {
+        m_nodes.push_back({});
+        m_nodes.back().parent = kNull;
+        m_nodes.back().height = -1;
+        m_freeList = std::int32_t(m_nodes.size() - 1);
+    }
+    const std::int32_t id = m_freeList;
+    Node& node = m_nodes[id];
+    m_freeList = node.parent;
+    node.parent = node.child1 = node.child2 = kNull;
+    node.height = 0;
+    node.userData = 0;
+    return id;
+}
+
+void AabbTree::freeNode(std::int32_t node)
+{
+    m_nodes[node].parent = m_freeList;
+    m_nodes[node].height = -1;
+    m_freeList = node;
+}
+
+void AabbTree::clear()
+{
+    m_nodes.clear();
+    m_root = m_freeList = kNull;
+    m_proxyCount = 0;
+}
+
+std::int32_t AabbTree::createProxy(const glm::vec3& min, const glm::vec3& max, std::uint32_t userData)
+{
+    const std::int32_t id = allocateNode();
+    m_nodes[id].min = min - glm::vec3(m_margin);
+    m_nodes[id].max = max + glm::vec3(m_margin);
+    m_nodes[id].userData = userData;
+    insertLeaf(id);
+    ++m_proxyCount;
+    return id;
+}
+
+void AabbTree::destroyProxy(std::int32_t proxy)
+{
+    removeLeaf(proxy);
+    freeNode(proxy);
+    --m_proxyCount;
+}
+
+bool AabbTree::moveProxy(std::int32_t proxy, const glm::vec3& min, const glm::vec3& max)
+{
+    Node& node = m_nodes[proxy];
+    if (node.min.x <= min.x && node.min.y <= min.y && node.min.z <= min.z &&
+        node.max.x >= max.x && node.max.y >= max.y && node.max.z >= max.z) return false;
+
+    removeLeaf(proxy);
+    m_nodes[proxy].min = min - glm::vec3(m_margin);
+    m_nodes[proxy].max = max + glm::vec3(m_margin);
+    insertLeaf(proxy);
+    return true;
+}
+
+// --- Insertion and removal ---
+
+void AabbTree::refit(std::int32_t index)
+{
+    Node& node = m_nodes[index];
+    const Node& a = m_nodes[node.child1];
+    const Node& b = m_nodes[node.child2];
+    node.min = glm::min(a.min, b.min);
+    node.max = glm::max(a.max, b.max);
+    node.height = 1 + std::max(a.height, b.height);
+}
+
+void AabbTree::insertLeaf(std::int32_t leaf)
+{
+    if (m_root == kNull) {
+        m_root = leaf;
+        m_nodes[leaf].parent = kNull;
+        return;
+    }
+
+    // Descend towards the sibling with the lowest surface-area cost.
+    const glm::vec3 leafMin = m_nodes[leaf].min, leafMax = m_nodes[leaf].max;
+    std::int32_t index = m_root;
+    while (!m_nodes[index].isLeaf()) {
+        const Node& node = m_nodes[index];
+        const float area = surfaceArea(node.min, node.max);
+        const float combinedArea = surfaceArea(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+
+        // Cost of pairing the leaf with this node, and the cost pushed down to either child.
+        const float cost = 2.0f * combinedArea;
+        const float inheritance = 2.0f * (combinedArea - area);
+
+        auto childCost = [&](std::int32_t c) {
+            const Node& child = m_nodes[c];
+            const float grown = surfaceArea(glm::min(child.min, leafMin), glm::max(child.max, leafMax));
+            return (child.isLeaf() ? grown : grown - surfaceArea(child.min, child.max)) + inheritance;
+        };
+        const float cost1 = childCost(node.child1);
+        const float cost2 = childCost(node.child2);
+
+        if (cost < cost1 && cost < cost2) break;
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    const std::int32_t sibling = index;
+    const std::int32_t oldParent = m_nodes[sibling].parent;
+    const std::int32_t newParent = allocateNode();   // may reallocate m_nodes
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].child1 = sibling;
+    m_nodes[newParent].child2 = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+    refit(newParent);
+
+    if (oldParent == kNull) m_root = newParent;
+    else if (m_nodes[oldParent].child1 == sibling) m_nodes[oldParent].child1 = newParent;
+    else m_nodes[oldParent].child2 = newParent;
+
+    for (index = m_nodes[leaf].parent; index != kNull; index = m_nodes[index].parent) {
+        index = balance(index);
+        refit(index);
+    }
+}
+
+void AabbTree::removeLeaf(std::int32_t leaf)
+{
+    if (leaf == m_root) {
+        m_root = kNull;
+        return;
+    }
+
+    const std::int32_t parent = m_nodes[leaf].parent;
+    const std::int32_t grandParent = m_nodes[parent].parent;
+    const std::int32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    freeNode(parent);
+    if (grandParent == kNull) {
+        m_root = sibling;
+        m_nodes[sibling].parent = kNull;
+        return;
+    }
+
+    if (m_nodes[grandParent].child1 == parent) m_nodes[grandParent].child1 = sibling;
+    else m_nodes[grandParent].child2 = sibling;
+    m_nodes[sibling].parent = grandParent;
+
+    for (std::int32_t index = grandParent; index != kNull; index = m_nodes[index].parent) {
+        index = balance(index);
+        refit(index);
+    }
+}
+
+// Rotates the taller grandchild of 'iA' up if its children differ in height
+// by more than one. Returns the index now at iA's position.
+std::int32_t AabbTree::balance(std::int32_t iA)
+{
+    Node& A = m_nodes[iA];
+    if (A.isLeaf() || A.height < 2) return iA;
+
+    const std::int32_t iB = A.child1, iC = A.child2;
+    const int diff = m_nodes[iC].height - m_nodes[iB].height;
+    if (diff >= -1 && diff <= 1) return iA;
+
+    // Promote the taller child 'up'; 'keep' stays under A.
+    const bool rotateC = diff > 1;
+    const std::int32_t iUp = rotateC ? iC : iB;
+    Node& up = m_nodes[iUp];
+    const std::int32_t iF = up.child1, iG = up.child2;
+
+    up.child1 = iA;
+    up.parent = A.parent;
+    A.parent = iUp;
+    if (up.parent == kNull) m_root = iUp;
+    else if (m_nodes[up.parent].child1 == iA) m_nodes[up.parent].child1 = iUp;
+    else m_nodes[up.parent].child2 = iUp;
+
+    // The taller of up's children stays with it, the other moves under A
+    // in the slot 'up' vacated.
+    const bool fTaller = m_nodes[iF].height > m_nodes[iG].height;
+    const std::int32_t iStay = fTaller ? iF : iG;
+    const std::int32_t iMove = fTaller ? iG : iF;
+    up.child2 = iStay;
+    if (rotateC) A.child2 = iMove;
+    else A.child1 = iMove;
+    m_nodes[iMove].parent = iA;
+
+    refit(iA);
+    refit(iUp);
+    return iUp;
+}
@@ -0,0 +1,92 @@
+#include "AllocationCounter.hpp"
+
+#if KR_COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    thread_local std::uint64_t t_allocations = 0;   ///< trivially initialized: safe inside operator new
+    std::atomic<std::uint64_t> g_allocations{ 0 };
+
+    void* allocate(std::size_t bytes)
+    {
+        ++t_allocations;
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        return std::malloc(bytes ? bytes : 1);
+    }
+
+    void* allocateAligned(std::size_t bytes, std::size_t alignment)
+    {
+        ++t_allocations;
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+#ifdef _WIN32
+        return _aligned_malloc(bytes ? bytes : 1, alignment);
+#else
+        void* p = nullptr;
+        return posix_memalign(&p, alignment, bytes ? bytes : 1) == 0 ? p : nullptr;
+#endif
+    }
+
+    void releaseAligned(void* p)
+    {
+#ifdef _WIN32
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+}
+
+std::uint64_t AllocationCounter::threadCount() { return t_allocations; }
+std::uint64_t AllocationCounter::totalCount() { return g_allocations.load(std::memory_order_relaxed); }
+
+void* operator new(std::size_t bytes)
+{
+    if (void* p = allocate(bytes)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t bytes)
+{
+    if (void* p = allocate(bytes)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t bytes, const std::nothrow_t&) noexcept { return allocate(bytes); }
+void* operator new[](std::size_t bytes, const std::nothrow_t&) noexcept { return allocate(bytes); }
+
+void* operator new(std::size_t bytes, std::align_val_t alignment)
+{
+    if (void* p = allocateAligned(bytes, std::size_t(alignment))) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t bytes, std::align_val_t alignment)
+{
+    if (void* p = allocateAligned(bytes, std::size_t(alignment))) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(bytes, std::size_t(alignment));
+}
+void* operator new[](std::size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(bytes, std::size_t(alignment));
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(p); }
+
+#endif
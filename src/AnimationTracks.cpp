@@ -0,0 +1,170 @@
+#include "AnimationTracks.hpp"
+#include "ThreadPool.hpp"
+#include "components.hpp"
+
+#include <entt/entt.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define ANIMATION_TRACKS_SSE2 1
+#endif
+
+namespace {
+constexpr double kTwoPi = 6.283185307179586;
+constexpr float kPi = 3.14159265358979f;
+constexpr float kHalfPi = 1.57079632679490f;
+constexpr std::size_t kWriteChunk = 4096;     ///< bindings per pool task
+
+// The spline pulse RenderingSystem always had: 3 rad/s, glow alpha 0.1 to 1.
+constexpr float kSplinePulseSpeed = 3.0f;
+constexpr float kSplineMinGlow = 0.1f;
+
+void invalidateTracks(entt::registry& registry, entt::entity)
+{
+    if (auto* tracks = registry.ctx().find<AnimationTracks>()) tracks->invalidate();
+}
+
+// weight[i] = (1 - sin(angle[i])) / 2 for angles in [-pi, pi), which is
+// (1 + sin(angle + pi)) / 2: the angle was shifted by pi to centre it.
+// The angle is folded into [-pi/2, pi/2] and the sine is its Taylor
+// polynomial to x^9, off by at most 4e-6 there. 'count' is a multiple of 4.
+void pulseWeights(const float* angle, float* weight, std::size_t count)
+{
+#ifdef ANIMATION_TRACKS_SSE2
+    const __m128 pi = _mm_set1_ps(kPi), halfPi = _mm_set1_ps(kHalfPi);
+    const __m128 c3 = _mm_set1_ps(-1.0f / 6.0f), c5 = _mm_set1_ps(1.0f / 120.0f);
+    const __m128 c7 = _mm_set1_ps(-1.0f / 5040.0f), c9 = _mm_set1_ps(1.0f / 362880.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (std::size_t i = 0; i < count; i += 4) {
+        __m128 x = _mm_load_ps(angle + i);
+        // sin(x) = sin(pi - x) above pi/2 and sin(-pi - x) below -pi/2.
+        const __m128 above = _mm_cmpgt_ps(x, halfPi);
+        const __m128 below = _mm_cmplt_ps(x, _mm_sub_ps(_mm_setzero_ps(), halfPi));
+        x = _mm_or_ps(_mm_andnot_ps(above, x), _mm_and_ps(above, _mm_sub_ps(pi, x)));
+        x = _mm_or_ps(_mm_andnot_ps(below, x), _mm_and_ps(below, _mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), pi), x)));
+
+        const __m128 x2 = _mm_mul_ps(x, x);
+        __m128 p = _mm_add_ps(c7, _mm_mul_ps(x2, c9));
+        p = _mm_add_ps(c5, _mm_mul_ps(x2, p));
+        p = _mm_add_ps(c3, _mm_mul_ps(x2, p));
+        const __m128 s = _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(x, x2), p));
+        _mm_store_ps(weight + i, _mm_sub_ps(half, _mm_mul_ps(half, s)));
+    }
+#else
+    for (std::size_t i = 0; i < count; ++i) {
+        float x = angle[i];
+        if (x > kHalfPi) x = kPi - x;
+        else if (x < -kHalfPi) x = -kPi - x;
+        const float x2 = x * x;
+        const float s = x + x * x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f + x2 * (-1.0f / 5040.0f + x2 * (1.0f / 362880.0f))));
+        weight[i] = 0.5f - 0.5f * s;
+    }
+#endif
+}
+
+// 16-byte aligned storage for _mm_load_ps/_mm_store_ps: vector<float>
+// only promises alignof(float), so round the start up within the buffer.
+float* aligned4(std::vector<float>& v, std::size_t count)
+{
+    v.resize(count + 3);
+    const std::size_t misalign = (reinterpret_cast<std::uintptr_t>(v.data()) / sizeof(float)) & 3;
+    return v.data() + ((4 - misalign) & 3);
+}
+}
+
+AnimationTracks& AnimationTracks::of(entt::registry& registry)
+{
+    if (auto* tracks = registry.ctx().find<AnimationTracks>()) return *tracks;
+
+    registry.on_construct<PulsingLightComponent>().connect<&invalidateTracks>();
+    registry.on_update<PulsingLightComponent>().connect<&invalidateTracks>();
+    registry.on_destroy<PulsingLightComponent>().connect<&invalidateTracks>();
+    registry.on_construct<PulsingSplineTag>().connect<&invalidateTracks>();
+    registry.on_destroy<PulsingSplineTag>().connect<&invalidateTracks>();
+    // Targets: bindings point into their storage, which an insert or a
+    // removal may move.
+    registry.on_construct<MaterialComponent>().connect<&invalidateTracks>();
+    registry.on_destroy<MaterialComponent>().connect<&invalidateTracks>();
+    registry.on_construct<SplineComponent>().connect<&invalidateTracks>();
+    registry.on_destroy<SplineComponent>().connect<&invalidateTracks>();
+    return registry.ctx().emplace<AnimationTracks>(registry);
+}
+
+std::uint32_t AnimationTracks::trackFor(float speed)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &speed, sizeof(bits));
+    const auto [it, inserted] = m_trackOf.emplace(bits, std::uint32_t(m_trackCount));
+    if (inserted) {
+        m_speed.push_back(speed);
+        ++m_trackCount;
+    }
+    return it->second;
+}
+
+void AnimationTracks::rebuild()
+{
+    m_dirty = false;
+    m_speed.clear();
+    m_trackOf.clear();
+    m_trackCount = 0;
+    m_alphas.clear();
+    m_colors.clear();
+
+    for (auto [entity, spline] : m_registry.view<PulsingSplineTag, SplineComponent>().each())
+        m_alphas.push_back({ &spline.glowColour.a, trackFor(kSplinePulseSpeed), kSplineMinGlow, 1.0f });
+    for (auto [entity, pulse, material] : m_registry.view<PulsingLightComponent, MaterialComponent>().each())
+        m_colors.push_back({ &material.albedo, trackFor(pulse.speed), pulse.offColor, pulse.onColor });
+
+    // Whole lanes; the padding tracks stand still.
+    m_speed.resize((m_trackCount + 3) & ~std::size_t(3), 0.0f);
+}
+
+bool AnimationTracks::active()
+{
+    if (m_dirty) rebuild();
+    return bindingCount() > 0;
+}
+
+void AnimationTracks::writeBindings(const float* weight, std::size_t first, std::size_t last)
+{
+    const std::size_t alphas = m_alphas.size();
+    for (std::size_t i = first; i < std::min(last, alphas); ++i) {
+        const ScalarBinding& b = m_alphas[i];
+        *b.target = b.lo + (b.hi - b.lo) * weight[b.track];
+    }
+    for (std::size_t i = std::max(first, alphas); i < last; ++i) {
+        const ColorBinding& b = m_colors[i - alphas];
+        *b.target = b.lo + (b.hi - b.lo) * weight[b.track];
+    }
+}
+
+void AnimationTracks::evaluate(double time)
+{
+    if (m_dirty) rebuild();
+    const std::size_t lanes = m_speed.size();
+    if (lanes == 0) return;
+
+    // The phase in double, so it stays exact however long the clock ran,
+    // then shifted by pi into [-pi, pi) for the polynomial.
+    float* angle = aligned4(m_angle, lanes);
+    for (std::size_t i = 0; i < lanes; ++i) {
+        const double turns = double(m_speed[i]) * time / kTwoPi;
+        angle[i] = float(kTwoPi * (turns - std::floor(turns))) - kPi;
+    }
+    float* weight = aligned4(m_weight, lanes);
+    pulseWeights(angle, weight, lanes);
+
+    const std::size_t count = bindingCount();
+    if (count < kParallelBindings) {
+        writeBindings(weight, 0, count);
+        return;
+    }
+    const std::size_t chunks = (count + kWriteChunk - 1) / kWriteChunk;
+    ThreadPool::shared().parallelFor(chunks, [&](std::size_t c) {
+        writeBindings(weight, c * kWriteChunk, std::min(count, (c + 1) * kWriteChunk));
+    });
+}
@@ -0,0 +1,129 @@
+#include "AssetPaths.hpp"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    struct State {
+        std::mutex mutex;
+        std::vector<std::string> extraMounts;
+        std::unordered_map<std::string, std::string> resolved;   ///< by uri + '|' + baseDir
+    };
+
+    State& state()
+    {
+        static State s;
+        return s;
+    }
+
+    std::vector<std::string> defaultMounts()
+    {
+        std::vector<std::string> mounts;
+        const QString variable = QString::fromLocal8Bit(qgetenv("KR_ASSET_PATH"));
+        for (const QString& dir : variable.split(QDir::listSeparator(), Qt::SkipEmptyParts))
+            mounts.push_back(dir.toStdString());
+        if (QCoreApplication::instance())
+            mounts.push_back((QCoreApplication::applicationDirPath() + "/assets").toStdString());
+#ifdef KR_SOURCE_ASSET_DIR
+        mounts.push_back(KR_SOURCE_ASSET_DIR);
+#endif
+        return mounts;
+    }
+
+    std::vector<std::string> mountsLocked(const State& s)
+    {
+        std::vector<std::string> mounts = s.extraMounts;
+        for (std::string& dir : defaultMounts()) mounts.push_back(std::move(dir));
+        return mounts;
+    }
+
+    std::string findAsset(const std::vector<std::string>& mounts, const QString& name)
+    {
+        for (const std::string& mount : mounts) {
+            const QString candidate = QDir(QString::fromStdString(mount)).absoluteFilePath(name);
+            if (QFileInfo::exists(candidate)) return candidate.toStdString();
+        }
+        return mounts.empty() ? name.toStdString()
+                              : QDir(QString::fromStdString(mounts.front())).absoluteFilePath(name).toStdString();
+    }
+
+    // The package directory, or an empty string.
+    QString findPackage(const QString& package, const QString& baseDir)
+    {
+        const QString variable = QString::fromLocal8Bit(qgetenv("ROS_PACKAGE_PATH"));
+        for (const QString& root : variable.split(QDir::listSeparator(), Qt::SkipEmptyParts)) {
+            const QDir dir(root);
+            if (dir.dirName() == package) return dir.absolutePath();
+            if (QFileInfo(dir.absoluteFilePath(package)).isDir()) return dir.absoluteFilePath(package);
+        }
+        // A robot file usually sits in <pkg>/urdf/ or in a workspace next to it.
+        if (baseDir.isEmpty()) return {};
+        QDir dir(baseDir);
+        do {
+            if (dir.dirName() == package) return dir.absolutePath();
+            if (QFileInfo(dir.absoluteFilePath(package)).isDir()) return dir.absoluteFilePath(package);
+        } while (dir.cdUp());
+        return {};
+    }
+}
+
+std::string AssetPaths::resolve(const std::string& uri, const std::string& baseDir)
+{
+    static const std::string kAsset = "asset://", kPackage = "package://", kFile = "file://";
+    const QString base = QString::fromStdString(baseDir);
+
+    if (uri.compare(0, kFile.size(), kFile) == 0) return uri.substr(kFile.size());
+    const bool asset = uri.compare(0, kAsset.size(), kAsset) == 0;
+    const bool package = uri.compare(0, kPackage.size(), kPackage) == 0;
+    if (!asset && !package) {
+        const QString path = QString::fromStdString(uri);
+        return base.isEmpty() || QFileInfo(path).isAbsolute() ? uri : QDir(base).absoluteFilePath(path).toStdString();
+    }
+
+    State& s = state();
+    const std::string key = uri + '|' + baseDir;
+    std::vector<std::string> mounts;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        const auto it = s.resolved.find(key);
+        if (it != s.resolved.end()) return it->second;
+        mounts = mountsLocked(s);
+    }
+
+    std::string path;
+    if (asset) {
+        path = findAsset(mounts, QString::fromStdString(uri.substr(kAsset.size())));
+    }
+    else {
+        const QString rest = QString::fromStdString(uri.substr(kPackage.size()));
+        const int slash = rest.indexOf('/');
+        const QString name = slash < 0 ? rest : rest.left(slash);
+        const QString relative = slash < 0 ? QString() : rest.mid(slash + 1);
+        const QString root = findPackage(name, base);
+        path = root.isEmpty() ? QDir(base).absoluteFilePath(relative).toStdString()
+                              : QDir(root).absoluteFilePath(relative).toStdString();
+    }
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.resolved.emplace(key, path);
+    return path;
+}
+
+void AssetPaths::addMount(const std::string& directory)
+{
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.extraMounts.push_back(directory);
+    s.resolved.clear();
+}
+
+std::vector<std::string> AssetPaths::mounts()
+{
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return mountsLocked(s);
+}
@@ -0,0 +1,389 @@
+#include "BatchJobs.hpp"
+#include "CollisionWorld.hpp"
+#include "FieldGridSampler.hpp"
+#include "FieldSolver.hpp"
+#include "KRobotParser.hpp"
+#include "KinematicSystem.hpp"
+#include "MotorSimulation.hpp"
+#include "Scene.hpp"
+#include "SceneBuilder.hpp"
+#include "SceneFile.hpp"
+#include "SDFParser.hpp"
+#include "SessionLog.hpp"
+#include "ThreadPool.hpp"
+#include "TraceZones.hpp"
+#include "TransformSystem.hpp"
+#include "URDFParser.hpp"
+#include "components.hpp"
+
+#include <QSaveFile>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <charconv>
+#include <cstring>
+#include <random>
+#include <glm/gtc/constants.hpp>
+#include <entt/entt.hpp>
+
+namespace
+{
+    constexpr char kColumnarMagic[8] = { 'K', 'R', 'C', 'O', 'L', '\0', '\0', '\1' };
+
+    // Field points per written batch, rounded to whole z-layers.
+    constexpr std::size_t kFieldBatch = 64 * FieldGridSampler::kChunkSamples;
+    // Configurations per validateTrajectory() call and written batch.
+    constexpr std::size_t kSweepBatch = 16384;
+
+    bool hasExtension(const std::string& path, const char* extension)
+    {
+        const std::size_t length = std::char_traits<char>::length(extension);
+        if (path.size() < length) return false;
+        return std::equal(path.end() - length, path.end(), extension, [](char a, char b) {
+            return std::tolower(static_cast<unsigned char>(a)) == b;
+            });
+    }
+
+    std::size_t typeSize(BatchJobs::Column::Type type)
+    {
+        switch (type) {
+        case BatchJobs::Column::Type::Float64: return 8;
+        case BatchJobs::Column::Type::UInt8:   return 1;
+        default:                               return 4;
+        }
+    }
+
+    // Shortest text that reads back to the same value.
+    void appendValue(std::string& text, const void* column, BatchJobs::Column::Type type, std::size_t row)
+    {
+        char buffer[32];
+        std::to_chars_result r{};
+        switch (type) {
+        case BatchJobs::Column::Type::Float32:
+            r = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<const float*>(column)[row]);
+            break;
+        case BatchJobs::Column::Type::Float64:
+            r = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<const double*>(column)[row]);
+            break;
+        case BatchJobs::Column::Type::UInt8:
+            r = std::to_chars(buffer, buffer + sizeof(buffer), unsigned(static_cast<const std::uint8_t*>(column)[row]));
+            break;
+        }
+        text.append(buffer, r.ptr);
+    }
+
+    bool loadRobot(Scene& scene, const std::string& path, std::string* error)
+    {
+        std::vector<RobotDescription> descriptions;
+        try {
+            if (hasExtension(path, ".sdf"))
+                SDFParser::parseWorld(path, [&descriptions](RobotDescription&& model) {
+                    descriptions.push_back(std::move(model));
+                    return true;
+                    });
+            else if (hasExtension(path, ".urdf")) descriptions.push_back(URDFParser::parse(path));
+            else descriptions.push_back(KRobotParser::parse(path));
+        }
+        catch (const std::exception& e) {
+            if (error) *error = e.what();
+            return false;
+        }
+        std::size_t committed = 0;
+        for (RobotDescription& description : descriptions) {
+            RobotSceneDelta delta;
+            if (!SceneBuilder::prepareRobot(std::move(description), delta)) continue;
+            SceneBuilder::commitRobot(scene, std::move(delta), false);
+            ++committed;
+        }
+        if (committed == 0 && error) *error = path + " contains no robot with links.";
+        return committed > 0;
+    }
+}
+
+// --- TableWriter ---
+
+BatchJobs::TableWriter::TableWriter() = default;
+BatchJobs::TableWriter::~TableWriter() = default;   // an unclosed QSaveFile is discarded
+
+BatchJobs::TableWriter::Format BatchJobs::TableWriter::formatFor(const std::string& path)
+{
+    return hasExtension(path, ".krcol") ? Format::Columnar : Format::Csv;
+}
+
+bool BatchJobs::TableWriter::open(const std::string& path, std::vector<Column> columns, std::string* error)
+{
+    m_file = std::make_unique<QSaveFile>(QString::fromStdString(path));
+    if (!m_file->open(QIODevice::WriteOnly)) {
+        if (error) *error = "Could not write " + path;
+        m_file.reset();
+        return false;
+    }
+    m_format = formatFor(path);
+    m_columns = std::move(columns);
+    m_rows = 0;
+    m_failed = false;
+
+    if (m_format == Format::Csv) {
+        m_text.clear();
+        for (std::size_t c = 0; c < m_columns.size(); ++c) {
+            if (c) m_text += ',';
+            m_text += m_columns[c].name;
+        }
+        m_text += '\n';
+        return write(m_text.data(), m_text.size());
+    }
+    const auto columnCount = std::uint32_t(m_columns.size());
+    write(kColumnarMagic, sizeof(kColumnarMagic));
+    write(&columnCount, sizeof(columnCount));
+    for (const Column& column : m_columns) {
+        const auto type = std::uint8_t(column.type);
+        const auto length = std::uint16_t(std::min<std::size_t>(column.name.size(), 0xFFFF));
+        write(&type, sizeof(type));
+        write(&length, sizeof(length));
+        write(column.name.data(), length);
+    }
+    return !m_failed;
+}
+
+bool BatchJobs::TableWriter::append(const void* const* columns, std::size_t rows)
+{
+    if (!m_file || m_failed || rows == 0) return !m_failed && m_file;
+    if (m_format == Format::Columnar) {
+        const std::uint64_t count = rows;
+        write(&count, sizeof(count));
+        for (std::size_t c = 0; c < m_columns.size(); ++c) write(columns[c], rows * typeSize(m_columns[c].type));
+    }
+    else {
+        m_text.clear();
+        for (std::size_t row = 0; row < rows; ++row) {
+            for (std::size_t c = 0; c < m_columns.size(); ++c) {
+                if (c) m_text += ',';
+                appendValue(m_text, columns[c], m_columns[c].type, row);
+            }
+            m_text += '\n';
+        }
+        write(m_text.data(), m_text.size());
+    }
+    m_rows += rows;
+    return !m_failed;
+}
+
+bool BatchJobs::TableWriter::close(std::string* error)
+{
+    if (!m_file) return false;
+    if (m_format == Format::Columnar) {
+        const std::uint64_t end = 0;
+        write(&end, sizeof(end));
+    }
+    const bool ok = !m_failed && m_file->commit();
+    if (!ok && error) *error = "Could not write " + m_file->fileName().toStdString();
+    m_file.reset();
+    return ok;
+}
+
+bool BatchJobs::TableWriter::write(const void* data, std::size_t bytes)
+{
+    if (!m_failed && m_file->write(static_cast<const char*>(data), qint64(bytes)) != qint64(bytes)) m_failed = true;
+    return !m_failed;
+}
+
+// --- Jobs ---
+
+bool BatchJobs::load(Scene& scene, const std::string& path, std::string* error)
+{
+    KR_ZONE("batch load");
+    if (hasExtension(path, ".krscene")) {
+        SceneFile::Loaded loaded;
+        if (!SceneFile::read(path, loaded, error)) return false;
+        SceneFile::commit(scene.getRegistry(), std::move(loaded));
+    }
+    else if (!loadRobot(scene, path, error)) return false;
+
+    auto& registry = scene.getRegistry();
+    KinematicSystem::applyJointPositions(registry);
+    TransformSystem::propagate(registry);
+    return true;
+}
+
+bool BatchJobs::exportField(entt::registry& registry, const FieldExport& job, const std::string& path,
+    std::string* error)
+{
+    KR_ZONE("batch field export");
+    TableWriter out;
+    using Type = Column::Type;
+    if (!out.open(path, { { "x", Type::Float32 }, { "y", Type::Float32 }, { "z", Type::Float32 },
+            { "vx", Type::Float32 }, { "vy", Type::Float32 }, { "vz", Type::Float32 } }, error))
+        return false;
+
+    FieldGrid grid;
+    grid.boundsMin = job.min;
+    grid.boundsMax = job.max;
+    grid.resolution = glm::max(job.resolution, glm::ivec3(1));
+    const FieldSnapshot snapshot = FieldSolver::snapshot(registry);
+
+    // A slab is the grid's z-layers [z0, z1) as a grid of its own, bounded
+    // by its first and last layer, so it samples the same points the whole
+    // grid would (a one-layer slab samples that layer, as resolution 1 does).
+    const std::size_t layer = std::size_t(grid.resolution.x) * std::size_t(grid.resolution.y);
+    const int layersPerSlab = int(std::clamp<std::size_t>(kFieldBatch / layer, 1, std::size_t(grid.resolution.z)));
+    std::vector<glm::vec3> vectors;
+    std::vector<float> columns[6];
+    for (int z0 = 0; z0 < grid.resolution.z; z0 += layersPerSlab) {
+        const int z1 = std::min(grid.resolution.z, z0 + layersPerSlab);
+        FieldGrid slab = grid;
+        slab.boundsMin.z = grid.samplePosition(0, 0, z0).z;
+        slab.boundsMax.z = grid.samplePosition(0, 0, z1 - 1).z;
+        slab.resolution.z = z1 - z0;
+        const std::size_t count = slab.sampleCount();
+        vectors.resize(count);
+        FieldGridSampler::sample(snapshot, slab, vectors.data(), ThreadPool::shared());
+
+        // Interleaved xyz to one array per column, x fastest as sampled.
+        for (auto& column : columns) column.resize(count);
+        std::size_t i = 0;
+        for (int z = 0; z < slab.resolution.z; ++z)
+            for (int y = 0; y < slab.resolution.y; ++y)
+                for (int x = 0; x < slab.resolution.x; ++x, ++i) {
+                    const glm::vec3 p = slab.samplePosition(x, y, z);
+                    for (int axis = 0; axis < 3; ++axis) {
+                        columns[axis][i] = p[axis];
+                        columns[3 + axis][i] = vectors[i][axis];
+                    }
+                }
+        const void* data[6] = { columns[0].data(), columns[1].data(), columns[2].data(),
+                                columns[3].data(), columns[4].data(), columns[5].data() };
+        if (!out.append(data, count)) {
+            if (error) *error = "Could not write " + path;
+            return false;
+        }
+    }
+    return out.close(error);
+}
+
+bool BatchJobs::sweepJoints(entt::registry& registry, const JointSweep& job, const std::string& path,
+    std::string* error)
+{
+    KR_ZONE("batch joint sweep");
+    std::vector<entt::entity> robots;
+    for (auto [entity, kin] : registry.view<KinematicModelComponent>().each())
+        if (kin.model && kin.model->dofCount() > 0) robots.push_back(entity);
+    if (job.robot < 0 || std::size_t(job.robot) >= robots.size()) {
+        if (error) *error = "The scene has no robot " + std::to_string(job.robot) + " with moving joints.";
+        return false;
+    }
+    const entt::entity robot = robots[std::size_t(job.robot)];
+    const KinematicModel& model = *registry.get<KinematicModelComponent>(robot).model;
+    const std::size_t dofs = std::size_t(model.dofCount());
+    const std::size_t links = std::size_t(model.linkCount());
+    int tip = int(links) - 1;
+    for (int link = 0; link < int(links); ++link)
+        if (model.isEndEffector(link)) tip = link;
+
+    std::vector<Column> columns;
+    for (std::size_t d = 0; d < dofs; ++d) columns.push_back({ model.dofName(int(d)), Column::Type::Float64 });
+    for (const char* name : { "tip_x", "tip_y", "tip_z" }) columns.push_back({ name, Column::Type::Float32 });
+    columns.push_back({ "collides", Column::Type::UInt8 });
+    TableWriter out;
+    if (!out.open(path, std::move(columns), error)) return false;
+
+    // Fits the collision shapes and filters the pairs touching at rest,
+    // exactly as the editor does when the robot appears.
+    CollisionWorld collision;
+    collision.update(registry);
+
+    KinematicModel::Pose base;
+    if (const auto* xf = registry.try_get<TransformComponent>(robot)) {
+        base.translation = xf->translation;
+        base.rotation = xf->rotation;
+    }
+
+    std::mt19937 rng(job.seed);
+    std::vector<double> q, qColumns;
+    std::vector<KinematicModel::Pose> poses;
+    std::vector<float> tipColumns;
+    std::vector<std::uint8_t> collides;
+    std::vector<const void*> data(dofs + 4);
+    for (std::size_t first = 0; first < job.samples; first += kSweepBatch) {
+        const std::size_t count = std::min(kSweepBatch, job.samples - first);
+        q.resize(count * dofs);
+        for (std::size_t c = 0; c < count; ++c)
+            for (std::size_t d = 0; d < dofs; ++d) {
+                const bool limited = model.isLimited(int(d));
+                const double lo = limited ? model.lowerLimit(int(d)) : -glm::pi<double>();
+                const double hi = limited ? model.upperLimit(int(d)) : glm::pi<double>();
+                q[c * dofs + d] = std::uniform_real_distribution<double>(lo, hi)(rng);
+            }
+
+        poses.resize(count * links);
+        model.forwardBatch(q.data(), count, poses.data(), base);
+        collides.resize(count);
+        collision.validateTrajectory(registry, robot, q.data(), count, collides.data(), job.environment);
+
+        // Row-major configurations to one array per column.
+        qColumns.resize(count * dofs);
+        for (std::size_t c = 0; c < count; ++c)
+            for (std::size_t d = 0; d < dofs; ++d) qColumns[d * count + c] = q[c * dofs + d];
+        tipColumns.resize(count * 3);
+        for (std::size_t c = 0; c < count; ++c) {
+            const glm::vec3& p = poses[c * links + std::size_t(tip)].translation;
+            for (int axis = 0; axis < 3; ++axis) tipColumns[std::size_t(axis) * count + c] = p[axis];
+        }
+        for (std::size_t d = 0; d < dofs; ++d) data[d] = qColumns.data() + d * count;
+        for (std::size_t axis = 0; axis < 3; ++axis) data[dofs + axis] = tipColumns.data() + axis * count;
+        data[dofs + 3] = collides.data();
+        if (!out.append(data.data(), count)) {
+            if (error) *error = "Could not write " + path;
+            return false;
+        }
+    }
+    return out.close(error);
+}
+
+bool BatchJobs::stepResponse(MotorSimulation& simulation, const StepResponse& job, const std::string& path,
+    std::int64_t startNs, const std::atomic<bool>* cancel, std::string* error)
+{
+    KR_ZONE("batch step response");
+    if (job.joint >= int(simulation.jointCount())) {
+        if (error) *error = "The robot has no joint " + std::to_string(job.joint) + ".";
+        return false;
+    }
+    SessionRecorder recorder;
+    if (!recorder.open(path)) {
+        if (error) *error = "Could not write " + path;
+        return false;
+    }
+
+    simulation.setRate(job.rate);
+    simulation.holdPosition();
+    simulation.step(std::size_t(std::llround(std::max(job.settle, 0.0) * simulation.rate())));
+    for (std::size_t j = 0; j < simulation.jointCount(); ++j) {
+        if (job.joint >= 0 && std::size_t(job.joint) != j) continue;
+        JointCommand command;
+        command.mode = job.mode;
+        command.setpoint = job.mode == ControlMode::POSITION ? simulation.position()[j] + job.step : job.step;
+        simulation.setCommand(j, command);
+    }
+
+    // Stamped so the step lands on 'startNs'.
+    const std::int64_t origin = startNs - std::llround(simulation.time() * 1e9);
+    const bool finished = simulation.record(recorder, job.seconds, job.decimation, origin, cancel);
+    recorder.close();
+    if (!finished && error) *error = "Cancelled";
+    return finished;
+}
+
+bool BatchJobs::stepResponse(const entt::registry& registry, const StepResponse& job, const std::string& path,
+    std::string* error)
+{
+    std::vector<entt::entity> robots;
+    for (auto [entity, kin] : registry.view<const KinematicModelComponent>().each())
+        if (kin.model && kin.model->dofCount() > 0) robots.push_back(entity);
+    std::unique_ptr<MotorSimulation> simulation;
+    if (job.robot >= 0 && std::size_t(job.robot) < robots.size())
+        simulation = MotorSimulation::fromRobot(registry, robots[std::size_t(job.robot)]);
+    if (!simulation) {
+        if (error) *error = "The scene has no robot " + std::to_string(job.robot) + " with moving joints.";
+        return false;
+    }
+    return stepResponse(*simulation, job, path, 0, nullptr, error);
+}
@@ -0,0 +1,318 @@
+// krbatch: loads a .krscene (or a .krobot / .urdf / .sdf) and runs one
+// batch job on it, without widgets, for compute nodes:
+//
+//   krbatch scene.krscene --field out.krcol --min -2,-2,0 --max 2,2,2 --resolution 128,128,64
+//   krbatch arm.krobot --sweep out.csv --samples 1000000 --seed 7
+//   krbatch scene.krscene --video out.mp4 --frames 600 --size 1920x1080
+//   krbatch scene.krscene --poster out.png --size 16384x9216 --tile 2048 --jitter 4
+//   krbatch plant.krscene --gltf plant.glb --quantize
+//   krbatch arm.krobot --step-response out.krec --joint 2 --step 0.2 --duration 1
+//
+// Tables are CSV, or columnar .krcol (see BatchJobs.hpp) by extension. The
+// field and sweep jobs use every core through ThreadPool::shared(); the
+// video job renders through OffscreenRenderer on the offscreen platform
+// unless QT_QPA_PLATFORM says otherwise, and encodes with ffmpeg; the poster
+// job renders the first camera's view tile by tile (PosterRenderer). Step
+// responses are session logs the editor replays (Ctrl+Shift+O).
+//
+// Exits 0 on success, 1 if the input could not be loaded or the job failed.
+
+#include "BatchJobs.hpp"
+#include "CullingSystem.hpp"
+#include "FrameBenchmark.hpp"
+#include "GltfExport.hpp"
+#include "KinematicSystem.hpp"
+#include "OffscreenRenderer.hpp"
+#include "PosterRenderer.hpp"
+#include "RenderingSystem.hpp"
+#include "Scene.hpp"
+#include "TraceZones.hpp"
+#include "TransformSystem.hpp"
+#include "VideoEncoder.hpp"
+#include "components.hpp"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QImage>
+#include <QSurfaceFormat>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace {
+bool parseVec3(const QString& text, glm::vec3& out)
+{
+    const QStringList parts = text.split(',');
+    if (parts.size() != 3) return false;
+    bool ok = true;
+    for (int i = 0; i < 3 && ok; ++i) out[i] = parts[i].toFloat(&ok);
+    return ok;
+}
+
+bool parseResolution(const QString& text, glm::ivec3& out)
+{
+    const QStringList parts = text.split(',');
+    bool ok = true;
+    if (parts.size() == 1) out = glm::ivec3(parts[0].toInt(&ok));
+    else if (parts.size() == 3) for (int i = 0; i < 3 && ok; ++i) out[i] = parts[i].toInt(&ok);
+    else ok = false;
+    return ok && out.x > 0 && out.y > 0 && out.z > 0;
+}
+
+// The scene's first camera flies FrameBenchmark's path (or 'cameraPath'),
+// encoded frame by frame; frames come back in order from the readback ring.
+bool renderVideo(Scene& scene, const QString& path, const QString& cameraPath, int frames, int fps,
+    int width, int height, const QString& codec)
+{
+    auto& registry = scene.getRegistry();
+    std::vector<FrameBenchmark::CameraKey> keys = cameraPath.isEmpty()
+        ? FrameBenchmark::defaultCameraPath() : FrameBenchmark::loadCameraPath(cameraPath);
+    if (keys.empty()) {
+        qCritical() << "[krbatch] No usable camera path in" << cameraPath;
+        return false;
+    }
+    const float pathDuration = keys.back().time;
+
+    entt::entity cameraEntity = entt::null;
+    for (auto entity : registry.view<CameraComponent>()) {
+        cameraEntity = entity;
+        break;
+    }
+    if (cameraEntity == entt::null) {
+        cameraEntity = registry.create();
+        registry.emplace<CameraComponent>(cameraEntity);
+        registry.emplace<TransformComponent>(cameraEntity);
+    }
+
+    RenderingSystem renderer(nullptr);
+    renderer.setDynamicResolution(false);
+    OffscreenRenderer offscreen(renderer);
+    if (!offscreen.create(width, height)) {
+        qCritical() << "[krbatch] No OpenGL 4.3 context";
+        return false;
+    }
+
+    VideoEncoder encoder;
+    VideoEncoder::Settings settings;
+    settings.path = path;
+    settings.width = width;
+    settings.height = height;
+    settings.fps = fps;
+    settings.codec = codec;
+    if (!encoder.open(settings)) {
+        qCritical().noquote() << "[krbatch]" << encoder.errorString();
+        return false;
+    }
+    bool written = true;
+    offscreen.setFrameSink([&](const QImage& frame, std::uint64_t) { written = encoder.write(frame) && written; });
+
+    const float frameTime = 1.0f / float(fps);
+    for (int frame = 0; frame < frames && written; ++frame) {
+        const float time = float(frame) * frameTime;
+        KinematicSystem::applyJointPositions(registry);
+        renderer.updateAnimations(registry);
+        renderer.updateSceneLogic(registry, frameTime);
+
+        const auto key = FrameBenchmark::sampleCameraPath(keys, pathDuration > 0.0f ? std::fmod(time, pathDuration) : 0.0f);
+        registry.get<CameraComponent>(cameraEntity).camera.forceRecalculateView(key.position, key.target, 0.0f);
+        renderer.updateCameraTransforms(registry);
+        TransformSystem::propagate(registry);
+        CullingSystem::updateWorldBounds(registry);
+
+        offscreen.renderFrame(registry, cameraEntity, frameTime);
+    }
+    offscreen.finish();
+    if (!encoder.close() || !written) {
+        qCritical().noquote() << "[krbatch]" << encoder.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool renderPoster(Scene& scene, const PosterRenderer::Settings& settings)
+{
+    auto& registry = scene.getRegistry();
+    entt::entity cameraEntity = entt::null;
+    for (auto entity : registry.view<CameraComponent>()) {
+        cameraEntity = entity;
+        break;
+    }
+    if (cameraEntity == entt::null) {
+        qCritical() << "[krbatch] The scene has no camera";
+        return false;
+    }
+
+    RenderingSystem renderer(nullptr);
+    KinematicSystem::applyJointPositions(registry);
+    renderer.updateAnimations(registry);
+    renderer.updateSceneLogic(registry, 0.0f);
+    renderer.updateCameraTransforms(registry);
+    TransformSystem::propagate(registry);
+    CullingSystem::updateWorldBounds(registry);
+
+    PosterRenderer poster(renderer);
+    if (!poster.render(registry, cameraEntity, settings)) {
+        qCritical().noquote() << "[krbatch]" << poster.errorString();
+        return false;
+    }
+    return true;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    TraceZones::setThreadName("Main");
+    QStringList arguments;
+    for (int i = 0; i < argc; ++i) arguments << QString::fromLocal8Bit(argv[i]);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", ".krscene, .krobot, .urdf or .sdf to load.");
+    const QCommandLineOption field("field", "Sample the field on a grid, write the table to <file>.", "file");
+    const QCommandLineOption min("min", "Field grid corner.", "x,y,z", "-1,-1,-1");
+    const QCommandLineOption max("max", "Opposite field grid corner.", "x,y,z", "1,1,1");
+    const QCommandLineOption resolution("resolution", "Field samples per axis.", "n|nx,ny,nz", "64");
+    const QCommandLineOption sweep("sweep", "Sweep joint configurations, write the table to <file>.", "file");
+    const QCommandLineOption samples("samples", "Configurations to sweep.", "n", "100000");
+    const QCommandLineOption seed("seed", "Sweep seed.", "n", "1");
+    const QCommandLineOption robot("robot", "Robot to sweep, by index.", "n", "0");
+    const QCommandLineOption selfOnly("self-only", "Sweep: skip the environment colliders.");
+    const QCommandLineOption video("video", "Render a video to <file> (ffmpeg picks the container).", "file");
+    const QCommandLineOption frames("frames", "Video frames.", "n", "600");
+    const QCommandLineOption fps("fps", "Video frame rate.", "n", "60");
+    const QCommandLineOption size("size", "Video or poster size.", "WxH", "1920x1080");
+    const QCommandLineOption camera("camera", "Camera path JSON (default: FrameBenchmark's orbit).", "file");
+    const QCommandLineOption codec("codec", "ffmpeg video codec.", "name", "libx264");
+    const QCommandLineOption poster("poster", "Render a still, tiled, to <file> (.png or .exr).", "file");
+    const QCommandLineOption tile("tile", "Poster: tile size in pixels.", "n", "2048");
+    const QCommandLineOption jitter("jitter", "Poster: jittered samples per pixel.", "n", "4");
+    const QCommandLineOption gltf("gltf", "Export the scene as binary glTF to <file>.", "file");
+    const QCommandLineOption quantize("quantize", "glTF: 16-bit positions, 8-bit normals (KHR_mesh_quantization).");
+    const QCommandLineOption stepResponse("step-response", "Simulate the joint drives' step response, write the session log to <file>.", "file");
+    const QCommandLineOption joint("joint", "Step response: joint to step, by DOF index (-1 for all).", "n", "-1");
+    const QCommandLineOption mode("mode", "Step response: position, velocity, torque, current or duty.", "mode", "position");
+    const QCommandLineOption step("step", "Step response: step size in the mode's unit.", "x", "0.1");
+    const QCommandLineOption duration("duration", "Step response: seconds recorded after the step.", "s", "1");
+    const QCommandLineOption rate("rate", "Step response: simulation rate.", "hz", "20000");
+    const QCommandLineOption decimation("decimation", "Step response: simulation steps per recorded sample.", "n", "20");
+    parser.addOptions({ field, min, max, resolution, sweep, samples, seed, robot, selfOnly,
+        video, frames, fps, size, camera, codec, poster, tile, jitter, gltf, quantize, stepResponse, joint, mode, step, duration, rate, decimation });
+
+    // Only the video and poster jobs need a GUI application (for the GL
+    // context), and then on the offscreen platform so no display is required.
+    const bool rendering = arguments.contains(QStringLiteral("--video")) || arguments.contains(QStringLiteral("--poster"));
+    std::unique_ptr<QCoreApplication> app;
+    if (rendering) {
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+        QSurfaceFormat format;
+        format.setVersion(4, 3);
+        format.setProfile(QSurfaceFormat::CoreProfile);
+        format.setDepthBufferSize(24);
+        format.setStencilBufferSize(8);
+        QSurfaceFormat::setDefaultFormat(format);
+        app = std::make_unique<QGuiApplication>(argc, argv);
+    }
+    else app = std::make_unique<QCoreApplication>(argc, argv);
+    parser.process(arguments);
+    if (parser.positionalArguments().size() != 1
+        || !(parser.isSet(field) || parser.isSet(sweep) || parser.isSet(video) || parser.isSet(poster)
+            || parser.isSet(gltf) || parser.isSet(stepResponse)))
+        parser.showHelp(1);
+
+    const QString input = parser.positionalArguments().front();
+    Scene scene;
+    std::string error;
+    if (!BatchJobs::load(scene, input.toStdString(), &error)) {
+        qCritical().noquote() << "[krbatch] Cannot load" << input << ":" << QString::fromStdString(error);
+        return 1;
+    }
+    auto& registry = scene.getRegistry();
+
+    QElapsedTimer timer;
+    if (parser.isSet(field)) {
+        BatchJobs::FieldExport job;
+        if (!parseVec3(parser.value(min), job.min) || !parseVec3(parser.value(max), job.max)
+            || !parseResolution(parser.value(resolution), job.resolution))
+            parser.showHelp(1);
+        timer.start();
+        if (!BatchJobs::exportField(registry, job, parser.value(field).toStdString(), &error)) {
+            qCritical().noquote() << "[krbatch]" << QString::fromStdString(error);
+            return 1;
+        }
+        qInfo().noquote() << "[krbatch] Field written to" << parser.value(field) << "in" << timer.elapsed() << "ms";
+    }
+    if (parser.isSet(sweep)) {
+        BatchJobs::JointSweep job;
+        job.samples = parser.value(samples).toULongLong();
+        job.seed = parser.value(seed).toUInt();
+        job.robot = parser.value(robot).toInt();
+        job.environment = !parser.isSet(selfOnly);
+        timer.start();
+        if (!BatchJobs::sweepJoints(registry, job, parser.value(sweep).toStdString(), &error)) {
+            qCritical().noquote() << "[krbatch]" << QString::fromStdString(error);
+            return 1;
+        }
+        qInfo().noquote() << "[krbatch] Sweep written to" << parser.value(sweep) << "in" << timer.elapsed() << "ms";
+    }
+    if (parser.isSet(video)) {
+        const QStringList wh = parser.value(size).split('x');
+        const int width = wh.value(0).toInt(), height = wh.value(1).toInt();
+        if (width <= 0 || height <= 0) parser.showHelp(1);
+        timer.start();
+        if (!renderVideo(scene, parser.value(video), parser.value(camera), std::max(1, parser.value(frames).toInt()),
+                std::max(1, parser.value(fps).toInt()), width, height, parser.value(codec)))
+            return 1;
+        qInfo().noquote() << "[krbatch] Video written to" << parser.value(video) << "in" << timer.elapsed() << "ms";
+    }
+    if (parser.isSet(poster)) {
+        const QStringList wh = parser.value(size).split('x');
+        PosterRenderer::Settings settings;
+        settings.path = parser.value(poster);
+        settings.width = wh.value(0).toInt();
+        settings.height = wh.value(1).toInt();
+        settings.tile = parser.value(tile).toInt();
+        settings.samples = std::max(1, parser.value(jitter).toInt());
+        if (settings.width <= 0 || settings.height <= 0 || settings.tile <= 0) parser.showHelp(1);
+        timer.start();
+        if (!renderPoster(scene, settings)) return 1;
+        qInfo().noquote() << "[krbatch] Poster written to" << settings.path << "in" << timer.elapsed() << "ms";
+    }
+    if (parser.isSet(gltf)) {
+        GltfExport::Options options;
+        options.quantize = parser.isSet(quantize);
+        timer.start();
+        const auto plan = GltfExport::gather(registry, options);
+        if (!GltfExport::write(*plan, parser.value(gltf).toStdString(), &error)) {
+            qCritical().noquote() << "[krbatch]" << QString::fromStdString(error);
+            return 1;
+        }
+        qInfo().noquote() << "[krbatch] glTF written to" << parser.value(gltf) << "in" << timer.elapsed() << "ms";
+    }
+    if (parser.isSet(stepResponse)) {
+        BatchJobs::StepResponse job;
+        job.robot = parser.value(robot).toInt();
+        job.joint = parser.value(joint).toInt();
+        const QString modeName = parser.value(mode).toLower();
+        if (modeName == "position") job.mode = ControlMode::POSITION;
+        else if (modeName == "velocity") job.mode = ControlMode::VELOCITY;
+        else if (modeName == "torque") job.mode = ControlMode::TORQUE;
+        else if (modeName == "current") job.mode = ControlMode::CURRENT;
+        else if (modeName == "duty") job.mode = ControlMode::DUTY_CYCLE;
+        else parser.showHelp(1);
+        job.step = parser.value(step).toDouble();
+        job.seconds = parser.value(duration).toDouble();
+        job.rate = std::max(1.0, parser.value(rate).toDouble());
+        job.decimation = std::max(1, parser.value(decimation).toInt());
+        timer.start();
+        if (!BatchJobs::stepResponse(registry, job, parser.value(stepResponse).toStdString(), &error)) {
+            qCritical().noquote() << "[krbatch]" << QString::fromStdString(error);
+            return 1;
+        }
+        qInfo().noquote() << "[krbatch] Step response written to" << parser.value(stepResponse) << "in" << timer.elapsed() << "ms";
+    }
+    return 0;
+}
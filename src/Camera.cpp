@@ -5,6 +5,7 @@
 #include <iostream>
 #include <QDebug> // If you're using Qt's qDebug for logging
 #include <algorithm> // For std::clamp
+#include <cmath>
 
 // NO "class Camera { ... }" RE-DECLARATION HERE
 
@@ -31,18 +32,40 @@ Camera::Camera(glm::vec3 position)
 
 // Method Definitions
 glm::mat4 Camera::getViewMatrix() const {
-    return glm::lookAt(m_Position, m_FocalPoint, m_Up);
+    const glm::dmat4 eyeView(getEyeViewMatrix());
+    return glm::mat4(eyeView * glm::translate(glm::dmat4(1.0), -worldPosition()));
 }
 
-glm::mat4 Camera::getProjectionMatrix(float aspectRatio) const {
+glm::mat4 Camera::getEyeViewMatrix() const {
+    return glm::lookAt(glm::vec3(0.0f), m_FocalPoint - m_Position, m_Up);
+}
+
+glm::mat4 Camera::getProjectionMatrix(float aspectRatio, bool reverseZ) const {
     if (aspectRatio <= 0.0f) {
         aspectRatio = 1.0f;
     }
+    const float kFovY = glm::radians(45.0f);
+    constexpr float kNear = 0.001f;
     if (m_IsPerspective) {
-        return glm::perspective(glm::radians(45.0f), aspectRatio, 0.001f, 1000.0f);
+        if (!reverseZ)
+            return glm::perspective(kFovY, aspectRatio, kNear, 1000.0f);
+
+        // Infinite reverse-Z: z_ndc = near / -z_eye, 1 at the near plane and
+        // tending to 0 at infinity, where float depth is most precise.
+        const float f = 1.0f / std::tan(0.5f * kFovY);
+        glm::mat4 p(0.0f);
+        p[0][0] = f / aspectRatio;
+        p[1][1] = f;
+        p[2][3] = -1.0f;
+        p[3][2] = kNear;
+        return p;
     }
     else {
         float ortho_size = m_Distance * 0.5f;
+        if (reverseZ)
+            return glm::orthoRH_ZO(-ortho_size * aspectRatio, ortho_size * aspectRatio,
+                -ortho_size, ortho_size,
+                1000.0f, -1000.0f); // near/far swapped: near -> 1, far -> 0
         return glm::ortho(-ortho_size * aspectRatio, ortho_size * aspectRatio,
             -ortho_size, ortho_size,
             -1000.0f, 1000.0f);
@@ -82,10 +105,16 @@ void Camera::move(Camera_Movement direction, float deltaTime) {
 
     // If we move the camera, the focal point should move with it
     m_FocalPoint = m_Position + glm::normalize(m_FocalPoint - m_Position) * m_Distance;
+    recentre();
 }
 
 void Camera::focusOn(const glm::vec3& target, float distance) {
-    m_FocalPoint = target;
+    focusOn(glm::dvec3(target), distance);
+}
+
+void Camera::focusOn(const glm::dvec3& target, float distance) {
+    m_Origin = target;
+    m_FocalPoint = glm::vec3(0.0f);
     m_Distance = distance;
     updateCameraVectors();
 }
@@ -112,7 +141,8 @@ void Camera::logState(const std::string& contextMessage) const {
 void Camera::resetView(float aspectRatio, const glm::vec3& target, float objectVisibleSize) {
     // ... your implementation ...
     Q_UNUSED(aspectRatio);
-    m_FocalPoint = target;
+    m_Origin = glm::dvec3(target);
+    m_FocalPoint = glm::vec3(0.0f);
     m_IsPerspective = true;
     float verticalFoV_rad = glm::radians(45.0f);
     m_Distance = (objectVisibleSize * 0.5f) / tan(verticalFoV_rad * 0.5f);
@@ -128,6 +158,7 @@ void Camera::resetView(float aspectRatio, const glm::vec3& target, float objectV
 
 void Camera::defaultInitialView() {
     // ... your implementation ...
+    m_Origin = glm::dvec3(0.0);
     m_Position = glm::vec3(0.0f, 1.5f, 7.0f);
     m_FocalPoint = glm::vec3(0.0f, 1.0f, 0.0f);
     m_Up = glm::vec3(0.0f, 1.0f, 0.0f);
@@ -143,8 +174,9 @@ void Camera::defaultInitialView() {
 
 void Camera::forceRecalculateView(glm::vec3 newPosition, glm::vec3 newTarget, float newDistance) {
     // ... your implementation ...
-    m_Position = newPosition;
-    m_FocalPoint = newTarget;
+    m_Origin = glm::dvec3(newTarget);
+    m_Position = glm::vec3(glm::dvec3(newPosition) - m_Origin);
+    m_FocalPoint = glm::vec3(0.0f);
     if (newDistance > 0.0f) {
         m_Distance = newDistance;
     }
@@ -162,6 +194,7 @@ void Camera::forceRecalculateView(glm::vec3 newPosition, glm::vec3 newTarget, fl
 void Camera::setToKnownGoodView() {
     // ... your implementation ...
     ////qDebug() << "Camera::setToKnownGoodView - Setting to a predefined stable view.";
+    m_Origin = glm::dvec3(0.0);
     m_FocalPoint = glm::vec3(0.0f, 0.5f, 0.0f);
     m_IsPerspective = true;
     m_Distance = 7.0f;
@@ -184,6 +217,14 @@ void Camera::updateCameraVectors() {
     // Re-calculate the Right and Up vector
     m_Right = glm::normalize(glm::cross(front, m_WorldUp));
     m_Up = glm::normalize(glm::cross(m_Right, front));
+    recentre();
+}
+
+void Camera::recentre() {
+    if (glm::length(m_FocalPoint) < kRecentreDistance) return;
+    m_Origin += glm::dvec3(m_FocalPoint);
+    m_Position -= m_FocalPoint;
+    m_FocalPoint = glm::vec3(0.0f);
 }
 
 void Camera::pan(float dxPix, float dyPix, float vpW, float vpH)
@@ -232,4 +273,5 @@ void Camera::flyMove(Camera_Movement dir, float dt)
     if (dir == DOWN)     m_Position -= m_Up * v;
 
     m_FocalPoint = m_Position + fwd * m_Distance;
+    recentre();
 }
\ No newline at end of file
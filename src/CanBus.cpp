@@ -0,0 +1,453 @@
+#include "CanBus.hpp"
+#include "components.hpp"
+#include "TelemetryHub.hpp"
+
+#include <QDebug>
+#include <entt/entt.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr std::chrono::milliseconds kReadTimeout{ 20 };
+
+// CANopen function codes (bits 7-10 of the 11-bit COB-ID).
+constexpr std::uint32_t kNmt = 0x000, kSync = 0x080, kEmergency = 0x080;
+constexpr std::uint32_t kTpdo[4] = { 0x180, 0x280, 0x380, 0x480 };
+constexpr std::uint32_t kRpdo[4] = { 0x200, 0x300, 0x400, 0x500 };
+constexpr std::uint32_t kSdoTx = 0x580, kSdoRx = 0x600, kHeartbeat = 0x700;
+
+bool accepts(const std::vector<CanFilter>& filters, std::uint32_t id)
+{
+    if (filters.empty()) return true;
+    for (const CanFilter& f : filters)
+        if ((id & f.mask) == (f.id & f.mask)) return true;
+    return false;
+}
+
+const char* nmtStateName(std::uint8_t state)
+{
+    switch (state & 0x7F) {
+    case 0x00: return "boot-up";
+    case 0x04: return "stopped";
+    case 0x05: return "operational";
+    case 0x7F: return "pre-operational";
+    default:   return "unknown state";
+    }
+}
+
+const char* nmtCommandName(std::uint8_t command)
+{
+    switch (command) {
+    case 0x01: return "start";
+    case 0x02: return "stop";
+    case 0x80: return "enter pre-operational";
+    case 0x81: return "reset node";
+    case 0x82: return "reset communication";
+    default:   return "unknown command";
+    }
+}
+}
+
+// --- SocketCanReader ---
+
+#ifdef __linux__
+bool SocketCanReader::open(const std::vector<CanFilter>& filters)
+{
+    close();
+    m_socket = ::socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (m_socket < 0) return false;
+
+    ifreq ifr{};
+    std::strncpy(ifr.ifr_name, m_interface.c_str(), IFNAMSIZ - 1);
+    if (::ioctl(m_socket, SIOCGIFINDEX, &ifr) < 0) {
+        close();
+        return false;
+    }
+
+    if (!filters.empty()) {
+        std::vector<can_filter> raw;
+        raw.reserve(filters.size());
+        for (const CanFilter& f : filters) {
+            const bool extended = f.id > CAN_SFF_MASK;
+            raw.push_back({ f.id | (extended ? CAN_EFF_FLAG : 0u), f.mask | CAN_EFF_FLAG });
+        }
+        ::setsockopt(m_socket, SOL_CAN_RAW, CAN_RAW_FILTER, raw.data(), socklen_t(raw.size() * sizeof(can_filter)));
+    }
+
+    // A few hundred ms of a saturated 1 Mbit/s bus, and the kernel's drop counter.
+    const int receiveBuffer = 4 << 20;
+    ::setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    const int enable = 1;
+    ::setsockopt(m_socket, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+
+    sockaddr_can address{};
+    address.can_family = AF_CAN;
+    address.can_ifindex = ifr.ifr_ifindex;
+    if (::bind(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+std::size_t SocketCanReader::read(CanFrame* out, std::size_t max, std::chrono::milliseconds timeout)
+{
+    if (m_socket < 0) return 0;
+    pollfd fd{ m_socket, POLLIN, 0 };
+    if (::poll(&fd, 1, int(timeout.count())) <= 0) return 0;
+
+    constexpr std::size_t kBatch = 64;
+    constexpr std::size_t kControl = CMSG_SPACE(sizeof(std::uint32_t));
+    can_frame frames[kBatch];
+    iovec vectors[kBatch];
+    mmsghdr messages[kBatch];
+    alignas(cmsghdr) char control[kBatch][kControl];
+
+    const std::size_t batch = std::min(max, kBatch);
+    for (std::size_t i = 0; i < batch; ++i) {
+        vectors[i] = { &frames[i], sizeof(can_frame) };
+        messages[i] = {};
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_control = control[i];
+        messages[i].msg_hdr.msg_controllen = kControl;
+    }
+    const int received = ::recvmmsg(m_socket, messages, unsigned(batch), MSG_DONTWAIT, nullptr);
+    if (received <= 0) return 0;
+
+    // The kernel stamps frames too, but on the realtime clock; one steady
+    // stamp per batch keeps captures on TelemetryHub's clock.
+    const std::int64_t now = TelemetryHub::nowNs();
+    for (int i = 0; i < received; ++i) {
+        const can_frame& raw = frames[i];
+        CanFrame& frame = out[i];
+        frame = CanFrame{};
+        frame.timestampNs = now;
+        frame.flags = (raw.can_id & CAN_EFF_FLAG ? CanFrame::kExtended : 0)
+            | (raw.can_id & CAN_RTR_FLAG ? CanFrame::kRemote : 0)
+            | (raw.can_id & CAN_ERR_FLAG ? CanFrame::kError : 0);
+        frame.id = raw.can_id & (raw.can_id & CAN_EFF_FLAG ? CAN_EFF_MASK : CAN_SFF_MASK);
+        frame.dlc = std::min<std::uint8_t>(raw.can_dlc, 8);
+        std::memcpy(frame.data, raw.data, frame.dlc);
+
+        for (cmsghdr* c = CMSG_FIRSTHDR(&messages[i].msg_hdr); c; c = CMSG_NXTHDR(&messages[i].msg_hdr, c)) {
+            if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SO_RXQ_OVFL) continue;
+            std::uint32_t drops = 0;
+            std::memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+            m_overruns.fetch_add(drops - m_lastDropCount, std::memory_order_relaxed);
+            m_lastDropCount = drops;
+        }
+    }
+    return std::size_t(received);
+}
+
+void SocketCanReader::close()
+{
+    if (m_socket >= 0) ::close(m_socket);
+    m_socket = -1;
+}
+#endif
+
+// --- SimulatedCanReader ---
+
+bool SimulatedCanReader::open(const std::vector<CanFilter>& filters)
+{
+    if (m_nodes.empty() || m_rate <= 0.0) return false;
+    m_filters = filters;
+    m_sent = 0;
+    m_slot = 0;
+    m_heartbeats = 0;
+    m_start = std::chrono::steady_clock::now();
+    m_lastHeartbeatNs = TelemetryHub::nowNs();
+    return true;
+}
+
+CanFrame SimulatedCanReader::next(std::int64_t timestampNs)
+{
+    CanFrame frame;
+    frame.timestampNs = timestampNs;
+
+    if (m_heartbeats == 0 && timestampNs - m_lastHeartbeatNs >= 100'000'000) {
+        m_heartbeats = m_nodes.size();
+        m_lastHeartbeatNs = timestampNs;
+    }
+    if (m_heartbeats > 0) {
+        frame.id = kHeartbeat + m_nodes[m_nodes.size() - m_heartbeats--];
+        frame.dlc = 1;
+        frame.data[0] = 0x05;   // operational
+        return frame;
+    }
+
+    // Round: SYNC, then TPDO1..4 of every node.
+    const std::size_t roundLength = 1 + 4 * m_nodes.size();
+    const std::size_t slot = m_slot;
+    m_slot = (m_slot + 1) % roundLength;
+    if (slot == 0) {
+        frame.id = kSync;
+        return frame;
+    }
+
+    const std::uint8_t node = m_nodes[(slot - 1) / 4];
+    const int pdo = int((slot - 1) % 4);
+    const double t = double(timestampNs) * 1e-9;
+    const double phase = t * 0.5 + node * 0.7;
+    frame.id = kTpdo[pdo] + node;
+    frame.dlc = 8;
+    const std::int32_t a = std::int32_t(std::sin(phase + pdo) * 100000.0);
+    const std::int32_t b = std::int32_t(std::cos(phase * 3.0 + pdo) * 2000.0);
+    if (pdo == 0) {   // CiA 402 style: statusword, position actual value
+        const std::uint16_t status = 0x0637;
+        std::memcpy(frame.data, &status, 2);
+        std::memcpy(frame.data + 2, &a, 4);
+        frame.dlc = 6;
+    }
+    else {
+        std::memcpy(frame.data, &a, 4);
+        std::memcpy(frame.data + 4, &b, 4);
+    }
+    return frame;
+}
+
+std::size_t SimulatedCanReader::read(CanFrame* out, std::size_t max, std::chrono::milliseconds timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+        const std::uint64_t due = std::uint64_t(elapsed * m_rate);
+        std::size_t written = 0;
+        const std::int64_t startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(m_start.time_since_epoch()).count();
+        while (m_sent < due && written < max) {
+            const std::int64_t stamp = startNs + std::int64_t(double(m_sent) / m_rate * 1e9);
+            const CanFrame frame = next(stamp);
+            ++m_sent;
+            if (accepts(m_filters, frame.id)) out[written++] = frame;
+        }
+        if (written > 0) return written;
+        if (std::chrono::steady_clock::now() >= deadline) return 0;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// --- CanDecodeTable ---
+
+CanDecodeTable CanDecodeTable::compile(entt::registry& registry)
+{
+    CanDecodeTable table;
+    table.m_entries[kNmt] = { Object::Nmt, 0, 0, -1 };
+    table.m_entries[kSync] = { Object::Sync, 0, 0, -1 };
+
+    for (auto [entity, joint] : registry.view<JointComponent>().each()) {
+        const HardwareInterface& hw = joint.description.interface;
+        if (hw.protocol != CommunicationProtocol::CANOPEN || hw.controller_id < 1 || hw.controller_id > 127) continue;
+        const std::uint8_t node = std::uint8_t(hw.controller_id);
+        if (table.m_entries[kHeartbeat + node].object != Object::Unknown) continue;   // first joint on a node names it
+
+        const std::int32_t name = std::int32_t(table.m_jointNames.size());
+        table.m_jointNames.push_back(joint.description.name);
+        table.m_nodes.push_back(node);
+        table.m_entries[kEmergency + node] = { Object::Emergency, 0, node, name };
+        for (std::uint8_t i = 0; i < 4; ++i) {
+            table.m_entries[kTpdo[i] + node] = { Object::Tpdo, std::uint8_t(i + 1), node, name };
+            table.m_entries[kRpdo[i] + node] = { Object::Rpdo, std::uint8_t(i + 1), node, name };
+        }
+        table.m_entries[kSdoTx + node] = { Object::SdoTx, 0, node, name };
+        table.m_entries[kSdoRx + node] = { Object::SdoRx, 0, node, name };
+        table.m_entries[kHeartbeat + node] = { Object::Heartbeat, 0, node, name };
+    }
+    return table;
+}
+
+const CanDecodeTable::Entry& CanDecodeTable::lookup(const CanFrame& frame) const
+{
+    static const Entry unknown;
+    if (frame.flags & (CanFrame::kExtended | CanFrame::kError) || frame.id >= kStandardIds) return unknown;
+    return m_entries[frame.id];
+}
+
+const char* CanDecodeTable::objectName(Object object)
+{
+    switch (object) {
+    case Object::Nmt:       return "NMT";
+    case Object::Sync:      return "SYNC";
+    case Object::Emergency: return "EMCY";
+    case Object::Tpdo:      return "TPDO";
+    case Object::Rpdo:      return "RPDO";
+    case Object::SdoTx:     return "SDO tx";
+    case Object::SdoRx:     return "SDO rx";
+    case Object::Heartbeat: return "heartbeat";
+    default:                return "";
+    }
+}
+
+std::string CanDecodeTable::describe(const CanFrame& frame) const
+{
+    if (frame.flags & CanFrame::kError) return "error frame";
+    const Entry& entry = lookup(frame);
+    if (entry.object == Object::Unknown) return {};
+
+    char text[96];
+    switch (entry.object) {
+    case Object::Nmt:
+        if (frame.dlc < 2) return "NMT";
+        if (frame.data[1] == 0) std::snprintf(text, sizeof(text), "NMT: %s, all nodes", nmtCommandName(frame.data[0]));
+        else std::snprintf(text, sizeof(text), "NMT: %s, node %d", nmtCommandName(frame.data[0]), int(frame.data[1]));
+        return text;
+    case Object::Sync:
+        return "SYNC";
+    case Object::Emergency:
+        if (frame.dlc < 3) std::snprintf(text, sizeof(text), "EMCY: cleared");
+        else std::snprintf(text, sizeof(text), "EMCY: error 0x%04X, register 0x%02X",
+            unsigned(frame.data[0] | frame.data[1] << 8), unsigned(frame.data[2]));
+        break;
+    case Object::Tpdo:
+    case Object::Rpdo:
+        std::snprintf(text, sizeof(text), "%s%d", objectName(entry.object), int(entry.index));
+        break;
+    case Object::SdoTx:
+    case Object::SdoRx:
+        if (frame.dlc < 4) std::snprintf(text, sizeof(text), "%s", objectName(entry.object));
+        else std::snprintf(text, sizeof(text), "%s: 0x%04X:%02X", objectName(entry.object),
+            unsigned(frame.data[1] | frame.data[2] << 8), unsigned(frame.data[3]));
+        break;
+    case Object::Heartbeat:
+        std::snprintf(text, sizeof(text), "heartbeat: %s", frame.dlc ? nmtStateName(frame.data[0]) : "?");
+        break;
+    default:
+        return {};
+    }
+    return m_jointNames[entry.joint] + " - " + text;
+}
+
+std::vector<CanFilter> CanDecodeTable::filters() const
+{
+    std::vector<CanFilter> filters{ { kNmt, 0x7FFu }, { kSync, 0x7FFu } };
+    for (std::uint8_t node : m_nodes) filters.push_back({ node, 0x07Fu });   // any function code of the node
+    return filters;
+}
+
+// --- CanCapture ---
+
+bool CanCapture::start(std::unique_ptr<CanReader> reader, const std::vector<CanFilter>& filters)
+{
+    stop();
+    m_reader.reset();
+    if (!reader || !reader->open(filters)) {
+        qWarning() << "[CanCapture] could not open" << (reader ? QString::fromStdString(reader->name()) : QString("reader"));
+        return false;
+    }
+    m_reader = std::move(reader);
+    if (!m_ring) m_ring = std::make_unique<SpscRing<CanFrame, kRingCapacity>>();
+    m_running.store(true, std::memory_order_relaxed);
+    m_thread = std::thread(&CanCapture::run, this);
+    qDebug() << "[CanCapture] capturing" << QString::fromStdString(m_reader->name());
+    return true;
+}
+
+void CanCapture::stop()
+{
+    m_running.store(false, std::memory_order_relaxed);
+    if (m_thread.joinable()) m_thread.join();
+    if (m_reader) m_reader->close();
+}
+
+void CanCapture::run()
+{
+    CanFrame batch[kReadBatch];
+    while (m_running.load(std::memory_order_relaxed)) {
+        const std::size_t n = m_reader->read(batch, kReadBatch, kReadTimeout);
+        for (std::size_t i = 0; i < n; ++i)
+            if (!m_ring->push(batch[i]))
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::size_t CanCapture::drain()
+{
+    if (!m_ring) return 0;
+    std::size_t taken = 0;
+    CanFrame frame;
+    while (m_ring->pop(frame)) {
+        if (m_history.size() < kHistoryCapacity) m_history.push_back(frame);
+        else m_history[m_historyHead] = frame;
+        m_historyHead = (m_historyHead + 1) % kHistoryCapacity;
+
+        IdStats& stats = statsFor(frame);
+        ++stats.count;
+        stats.last = frame;
+        ++taken;
+    }
+    m_captured += taken;
+    return taken;
+}
+
+CanCapture::IdStats& CanCapture::statsFor(const CanFrame& frame)
+{
+    const bool extended = frame.flags & CanFrame::kExtended;
+    if (!extended && frame.id < m_standardIndex.size() && m_standardIndex[frame.id] >= 0)
+        return m_ids[m_standardIndex[frame.id]];
+    if (extended) {
+        auto it = m_extendedIndex.find(frame.id);
+        if (it != m_extendedIndex.end()) return m_ids[it->second];
+    }
+
+    // A new identifier: insert in order and renumber (rare after the first second).
+    IdStats stats;
+    stats.id = frame.id;
+    stats.extended = extended;
+    auto at = std::lower_bound(m_ids.begin(), m_ids.end(), stats, [](const IdStats& a, const IdStats& b) {
+        return a.extended != b.extended ? !a.extended : a.id < b.id;
+    });
+    at = m_ids.insert(at, stats);
+    std::fill(m_standardIndex.begin(), m_standardIndex.end(), -1);
+    m_extendedIndex.clear();
+    for (std::size_t i = 0; i < m_ids.size(); ++i) {
+        if (m_ids[i].extended) m_extendedIndex[m_ids[i].id] = std::int32_t(i);
+        else m_standardIndex[m_ids[i].id & 0x7FF] = std::int32_t(i);
+    }
+    return *at;
+}
+
+std::uint64_t CanCapture::dropped() const
+{
+    return m_dropped.load(std::memory_order_relaxed) + (m_reader ? m_reader->overruns() : 0);
+}
+
+bool CanCapture::saveLog(const std::string& path) const
+{
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+    const std::string bus = busName().empty() ? std::string("can0") : busName();
+    const std::size_t count = m_history.size();
+    const std::size_t first = count < kHistoryCapacity ? 0 : m_historyHead;
+    for (std::size_t i = 0; i < count; ++i) {
+        const CanFrame& f = m_history[(first + i) % count];
+        char data[17] = {};
+        for (int b = 0; b < f.dlc; ++b) std::snprintf(data + 2 * b, 3, "%02X", unsigned(f.data[b]));
+        std::fprintf(file, (f.flags & CanFrame::kExtended) ? "(%lld.%06lld) %s %08X#%s\n" : "(%lld.%06lld) %s %03X#%s\n",
+            (long long)(f.timestampNs / 1'000'000'000), (long long)(f.timestampNs % 1'000'000'000 / 1000),
+            bus.c_str(), unsigned(f.id), (f.flags & CanFrame::kRemote) ? "R" : data);
+    }
+    return std::fclose(file) == 0;
+}
+
+void CanCapture::clear()
+{
+    m_history.clear();
+    m_historyHead = 0;
+    m_captured = 0;
+    m_ids.clear();
+    std::fill(m_standardIndex.begin(), m_standardIndex.end(), -1);
+    m_extendedIndex.clear();
+}
@@ -0,0 +1,224 @@
+#include "CanMonitorPanel.hpp"
+
+#include <QAbstractTableModel>
+#include <QCheckBox>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTableView>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+// One row per captured identifier. Text is formatted in data(), i.e. only
+// for the rows the view paints; sync() only compares counts.
+class CanIdModel : public QAbstractTableModel
+{
+public:
+    enum Column { Id, Meaning, Count, Rate, Data, ColumnCount };
+
+    using QAbstractTableModel::QAbstractTableModel;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : int(m_rows.size()); }
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : ColumnCount; }
+
+    QVariant data(const QModelIndex& index, int role) const override
+    {
+        if (!index.isValid() || !m_capture) return {};
+        const Row& row = m_rows[index.row()];
+        const CanCapture::IdStats& stats = m_capture->ids()[row.stats];
+        if (role == Qt::TextAlignmentRole && (index.column() == Count || index.column() == Rate))
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        if (role != Qt::DisplayRole) return {};
+
+        char text[48];
+        switch (index.column()) {
+        case Id:
+            std::snprintf(text, sizeof(text), stats.extended ? "%08X" : "%03X", unsigned(stats.id));
+            return QString::fromLatin1(text);
+        case Meaning:
+            return QString::fromStdString(m_table->describe(stats.last));
+        case Count:
+            return QString::number(qulonglong(stats.count));
+        case Rate:
+            return QString::number(row.rate, 'f', 0);
+        case Data: {
+            if (stats.last.flags & CanFrame::kRemote) return QStringLiteral("RTR");
+            int n = 0;
+            for (int b = 0; b < stats.last.dlc; ++b)
+                n += std::snprintf(text + n, sizeof(text) - n, b ? " %02X" : "%02X", unsigned(stats.last.data[b]));
+            return QString::fromLatin1(text, n);
+        }
+        default:
+            return {};
+        }
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override
+    {
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return {};
+        static const char* names[ColumnCount] = { "ID", "Meaning", "Count", "Rate (Hz)", "Data" };
+        return QString::fromLatin1(names[section]);
+    }
+
+    // Picks up new identifiers, updates rates over 'seconds' and emits one
+    // dataChanged for the span of rows whose count moved.
+    void sync(const CanCapture& capture, const CanDecodeTable& table, bool knownOnly, double seconds)
+    {
+        m_capture = &capture;
+        m_table = &table;
+        const auto& ids = capture.ids();
+        if (ids.size() != m_seen || knownOnly != m_knownOnly) {
+            // Carry rates over by identifier; indices shift when one is inserted.
+            std::unordered_map<std::uint64_t, Row> previous;
+            for (const Row& row : m_rows) previous[row.key] = row;
+            beginResetModel();
+            m_rows.clear();
+            for (std::size_t i = 0; i < ids.size(); ++i) {
+                const CanFrame& last = ids[i].last;
+                if (knownOnly && table.lookup(last).object == CanDecodeTable::Object::Unknown) continue;
+                const std::uint64_t key = std::uint64_t(ids[i].extended) << 32 | ids[i].id;
+                auto it = previous.find(key);
+                Row row = it != previous.end() ? it->second : Row{ key, 0, ids[i].count, 0.0 };
+                row.stats = i;
+                m_rows.push_back(row);
+            }
+            endResetModel();
+            m_seen = ids.size();
+            m_knownOnly = knownOnly;
+        }
+
+        int first = std::numeric_limits<int>::max(), last = -1;
+        for (int r = 0; r < int(m_rows.size()); ++r) {
+            Row& row = m_rows[r];
+            const std::uint64_t count = ids[row.stats].count;
+            const double rate = seconds > 0.0 ? double(count - row.count) / seconds : row.rate;
+            row.rate += (rate - row.rate) * 0.5;   // light smoothing against refresh jitter
+            if (count == row.count && row.rate < 0.5) continue;
+            row.count = count;
+            first = std::min(first, r);
+            last = std::max(last, r);
+        }
+        if (last >= 0) emit dataChanged(index(first, 0), index(last, ColumnCount - 1), { Qt::DisplayRole });
+    }
+
+    void reset()
+    {
+        beginResetModel();
+        m_rows.clear();
+        m_seen = 0;
+        endResetModel();
+    }
+
+private:
+    struct Row {
+        std::uint64_t key = 0;      ///< extended << 32 | id
+        std::size_t stats = 0;      ///< into CanCapture::ids()
+        std::uint64_t count = 0;    ///< at the last sync
+        double rate = 0.0;
+    };
+    const CanCapture* m_capture = nullptr;
+    const CanDecodeTable* m_table = nullptr;
+    std::vector<Row> m_rows;
+    std::size_t m_seen = 0;
+    bool m_knownOnly = false;
+};
+
+CanMonitorPanel::CanMonitorPanel(QWidget* parent)
+    : QWidget(parent)
+{
+    m_status = new QLabel(this);
+    m_knownOnly = new QCheckBox("Robot nodes only", this);
+    m_knownOnly->setToolTip("Hide identifiers that are not in the decode table built from the robots' CANopen node IDs");
+    auto* clear = new QPushButton("Clear", this);
+    auto* save = new QPushButton("Save log...", this);
+
+    m_model = new CanIdModel(this);
+    m_view = new QTableView(this);
+    m_view->setModel(m_model);
+    m_view->setSelectionMode(QAbstractItemView::NoSelection);
+    m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_view->verticalHeader()->setVisible(false);
+    m_view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_view->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    m_view->horizontalHeader()->setSectionResizeMode(CanIdModel::Meaning, QHeaderView::Stretch);
+    m_view->setWordWrap(false);
+
+    auto* controls = new QHBoxLayout;
+    controls->addWidget(m_status, 1);
+    controls->addWidget(m_knownOnly);
+    controls->addWidget(clear);
+    controls->addWidget(save);
+    auto* layout = new QVBoxLayout(this);
+    layout->addLayout(controls);
+    layout->addWidget(m_view);
+
+    connect(clear, &QPushButton::clicked, this, [this]() {
+        m_capture.clear();
+        m_model->reset();
+        m_capturedAtRefresh = 0;
+    });
+    connect(save, &QPushButton::clicked, this, &CanMonitorPanel::saveLog);
+
+    // Drains even while hidden, so the ring never fills behind a closed panel.
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setInterval(1000 / kRefreshHz);
+    connect(m_refreshTimer, &QTimer::timeout, this, &CanMonitorPanel::refresh);
+}
+
+CanMonitorPanel::~CanMonitorPanel() = default;
+
+bool CanMonitorPanel::start(std::unique_ptr<CanReader> reader, CanDecodeTable table)
+{
+    stop();
+    m_table = std::move(table);
+    m_capture.clear();
+    m_model->reset();
+    m_capturedAtRefresh = 0;
+    if (!m_capture.start(std::move(reader))) {
+        m_status->setText("No CAN capture");
+        return false;
+    }
+    m_sinceRefresh.start();
+    m_refreshTimer->start();
+    return true;
+}
+
+void CanMonitorPanel::stop()
+{
+    m_capture.stop();
+    if (m_refreshTimer->isActive()) refresh();   // what arrived before the thread stopped
+    m_refreshTimer->stop();
+}
+
+void CanMonitorPanel::refresh()
+{
+    m_capture.drain();
+    m_unsyncedSeconds += m_sinceRefresh.restart() * 1e-3;
+    if (!isVisible()) return;
+    const double seconds = m_unsyncedSeconds;
+    m_unsyncedSeconds = 0.0;
+
+    m_model->sync(m_capture, m_table, m_knownOnly->isChecked(), seconds);
+    const double rate = seconds > 0.0 ? double(m_capture.captured() - m_capturedAtRefresh) / seconds : 0.0;
+    m_capturedAtRefresh = m_capture.captured();
+    m_status->setText(QString("%1: %2 frames/s, %3 captured, %4 dropped")
+        .arg(QString::fromStdString(m_capture.busName()))
+        .arg(rate, 0, 'f', 0)
+        .arg(qulonglong(m_capture.captured()))
+        .arg(qulonglong(m_capture.dropped())));
+}
+
+void CanMonitorPanel::saveLog()
+{
+    const QString path = QFileDialog::getSaveFileName(this, "Save CAN log", QString(), "candump log (*.log);;All files (*)");
+    if (path.isEmpty()) return;
+    if (!m_capture.saveLog(path.toStdString()))
+        m_status->setText(QString("Could not write %1").arg(path));
+}
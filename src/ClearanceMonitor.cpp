@@ -0,0 +1,147 @@
+#include "ClearanceMonitor.hpp"
+#include "DistanceField.hpp"
+#include "components.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <entt/entt.hpp>
+
+namespace
+{
+    constexpr int kMaxSpheres = 8;
+    constexpr float kReportedChange = 1e-3f;
+}
+
+ClearanceMonitor::ClearanceMonitor() = default;
+ClearanceMonitor::~ClearanceMonitor() = default;
+
+void ClearanceMonitor::fitSpheres(const CollisionShapeComponent& shape, std::vector<glm::vec4>& spheres)
+{
+    spheres.clear();
+    if (shape.points.empty()) return;
+
+    if (shape.points.size() == 2) {
+        // Capsule: centres at most 'radius' apart, each grown to cover the
+        // stretch of axis halfway to its neighbours.
+        const glm::vec3 a = shape.points[0], b = shape.points[1];
+        const float length = glm::length(b - a);
+        const int count = std::clamp(int(std::ceil(length / std::max(shape.radius, 1e-4f))) + 1, 2, kMaxSpheres);
+        const float half = 0.5f * length / float(count - 1);
+        const float radius = std::sqrt(shape.radius * shape.radius + half * half);
+        for (int i = 0; i < count; ++i)
+            spheres.emplace_back(a + (b - a) * (float(i) / float(count - 1)), radius);
+        return;
+    }
+
+    // Hull: slices of its box along the longest side, about as long as the
+    // box is wide, each wrapped in its circumscribed sphere.
+    glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+    for (const glm::vec3& p : shape.points) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    const glm::vec3 extent = hi - lo;
+    const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+    const float width = std::max({ extent[(axis + 1) % 3], extent[(axis + 2) % 3], 1e-4f });
+    const int count = std::clamp(int(std::round(extent[axis] / width)), 1, kMaxSpheres);
+    glm::vec3 slice = extent;
+    slice[axis] /= float(count);
+    const float radius = 0.5f * glm::length(slice) + shape.radius;
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 centre = lo + 0.5f * slice;
+        centre[axis] += slice[axis] * float(i);
+        spheres.emplace_back(centre, radius);
+    }
+}
+
+bool ClearanceMonitor::update(entt::registry& registry)
+{
+    const auto start = std::chrono::steady_clock::now();
+    m_stats = {};
+    const float band = m_settings.band;
+
+    m_obstacles.clear();
+    for (auto [e, mesh, world] : registry.view<EnvironmentColliderTag, RenderableMeshComponent, WorldTransformComponent>().each()) {
+        if (!mesh.mesh || registry.all_of<LinkComponent>(e)) continue;
+        const float scale = std::max(glm::length(glm::vec3(world.matrix[0])), 1e-6f);
+        auto field = DistanceField::shared(mesh.mesh, m_settings.voxelSize / scale, band / scale);
+        if (!field) {
+            ++m_stats.pendingFields;
+            continue;
+        }
+        Obstacle obstacle{ e, std::move(field), glm::inverse(world.matrix), glm::mat3(world.matrix), scale,
+            glm::vec3(-std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::max()) };
+        if (const auto* bounds = registry.try_get<WorldBoundsComponent>(e)) {
+            obstacle.min = bounds->min - glm::vec3(band);
+            obstacle.max = bounds->max + glm::vec3(band);
+        }
+        m_obstacles.push_back(std::move(obstacle));
+    }
+    m_stats.obstacles = m_obstacles.size();
+
+    for (auto it = m_spheres.begin(); it != m_spheres.end();) {
+        if (registry.valid(it->first) && registry.all_of<CollisionShapeComponent>(it->first)) ++it;
+        else it = m_spheres.erase(it);
+    }
+
+    bool changed = false;
+    for (auto [root, kin] : registry.view<KinematicModelComponent>().each()) {
+        ClearanceComponent nearest;
+        nearest.distance = band;
+        for (const entt::entity link : kin.links) {
+            if (!registry.valid(link)) continue;
+            const auto* shape = registry.try_get<CollisionShapeComponent>(link);
+            const auto* world = registry.try_get<WorldTransformComponent>(link);
+            if (!shape || !world) continue;
+
+            LinkSpheres& cached = m_spheres[link];
+            if (cached.meshKey != shape->meshKey || cached.points != shape->points.size() || cached.radius != shape->radius) {
+                cached.meshKey = shape->meshKey;
+                cached.points = shape->points.size();
+                cached.radius = shape->radius;
+                fitSpheres(*shape, cached.spheres);
+            }
+            const float linkScale = glm::length(glm::vec3(world->matrix[0]));
+            for (const glm::vec4& sphere : cached.spheres) {
+                ++m_stats.spheres;
+                const glm::vec3 centre(world->matrix * glm::vec4(glm::vec3(sphere), 1.0f));
+                const float radius = sphere.w * linkScale;
+                for (const Obstacle& obstacle : m_obstacles) {
+                    if (glm::any(glm::lessThan(centre, obstacle.min)) || glm::any(glm::greaterThan(centre, obstacle.max))) continue;
+                    ++m_stats.lookups;
+                    float d;
+                    glm::vec3 gradient;
+                    if (!obstacle.field->sample(glm::vec3(obstacle.worldToLocal * glm::vec4(centre, 1.0f)), d, gradient)) continue;
+                    d *= obstacle.scale;
+                    if (d - radius >= nearest.distance) continue;
+
+                    // The gradient in world space: inverse transpose of the
+                    // local-to-world linear part, which is a scaled rotation.
+                    glm::vec3 outward = obstacle.localToWorld * gradient;
+                    const float length = glm::length(outward);
+                    outward = length > 1e-6f ? outward / length : glm::vec3(0.0f);
+                    nearest.distance = d - radius;
+                    nearest.link = link;
+                    nearest.obstacle = obstacle.entity;
+                    nearest.linkPoint = centre - outward * radius;
+                    nearest.obstaclePoint = centre - outward * d;
+                }
+            }
+        }
+
+        if (auto* current = registry.try_get<ClearanceComponent>(root)) {
+            if (current->link != nearest.link || current->obstacle != nearest.obstacle
+                || std::abs(current->distance - nearest.distance) > kReportedChange) changed = true;
+            *current = nearest;
+        }
+        else {
+            registry.emplace<ClearanceComponent>(root, nearest);
+            changed = true;
+        }
+    }
+
+    m_stats.microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    return changed;
+}
@@ -0,0 +1,539 @@
+#include "CollisionWorld.hpp"
+#include "ConvexDecomposition.hpp"
+#include "FrameArena.hpp"
+#include "MeshCache.hpp"
+#include "ThreadPool.hpp"
+#include "components.hpp"
+
+#include <entt/entt.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr std::size_t kHullPoints = 64;
+// A capsule is used when it wastes at most this much volume over the link's box.
+constexpr float kCapsuleSlack = 1.2f;
+constexpr float kPi = 3.14159265358979f;
+
+bool overlaps(const glm::vec3& aMin, const glm::vec3& aMax, const glm::vec3& bMin, const glm::vec3& bMax)
+{
+    return aMin.x <= bMax.x && aMax.x >= bMin.x &&
+           aMin.y <= bMax.y && aMax.y >= bMin.y &&
+           aMin.z <= bMax.z && aMax.z >= bMin.z;
+}
+
+float maxColumnLength(const glm::mat3& m)
+{
+    return std::max({ glm::length(m[0]), glm::length(m[1]), glm::length(m[2]) });
+}
+
+CollisionShapeComponent fitShape(const std::vector<Vertex>& vertices, bool allowCapsule,
+    const std::shared_ptr<const ConvexHullSet>& hulls)
+{
+    if (hulls && hulls->hullCount() > 0) {
+        CollisionShapeComponent shape;
+        shape.points = ConvexCollision::hullSupportPoints(hulls->points, kHullPoints);
+        shape.hulls = hulls;
+        return shape;
+    }
+
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (const Vertex& v : vertices) positions.push_back(v.position);
+
+    CollisionShapeComponent shape;
+    shape.points = ConvexCollision::hullSupportPoints(positions, kHullPoints);
+    if (!allowCapsule) return shape;
+
+    glm::vec3 mn = shape.points[0], mx = shape.points[0];
+    for (const glm::vec3& p : shape.points) { mn = glm::min(mn, p); mx = glm::max(mx, p); }
+    const glm::vec3 extent = mx - mn;
+    const float boxVolume = extent.x * extent.y * extent.z;
+
+    const ConvexCollision::Capsule capsule = ConvexCollision::fitCapsule(shape.points);
+    const float r = capsule.radius;
+    const float capsuleVolume = kPi * r * r * glm::length(capsule.b - capsule.a) + (4.0f / 3.0f) * kPi * r * r * r;
+    if (capsuleVolume <= kCapsuleSlack * boxVolume) {
+        shape.points = { capsule.a, capsule.b };
+        shape.radius = capsule.radius;
+    }
+    return shape;
+}
+}
+
+// --- Bookkeeping ---
+
+std::uint64_t CollisionWorld::pairKey(std::uint32_t a, std::uint32_t b)
+{
+    if (a > b) std::swap(a, b);
+    return (std::uint64_t(a) << 32) | b;
+}
+
+std::uint64_t CollisionWorld::linkPairKey(entt::entity robot, int linkA, int linkB)
+{
+    if (linkA > linkB) std::swap(linkA, linkB);
+    return (std::uint64_t(entt::to_integral(robot)) << 32) | (std::uint64_t(linkA & 0xFFFF) << 16) | std::uint64_t(linkB & 0xFFFF);
+}
+
+void CollisionWorld::reset()
+{
+    ++m_environmentVersion;
+    m_tree.clear();
+    m_bodies.clear();
+    m_freeBodies.clear();
+    m_bodyOf.clear();
+    m_robots.clear();
+    m_disabledPairs.clear();
+    m_contacts.clear();
+}
+
+std::uint32_t CollisionWorld::addBody(entt::entity entity)
+{
+    std::uint32_t slot;
+    if (!m_freeBodies.empty()) {
+        slot = m_freeBodies.back();
+        m_freeBodies.pop_back();
+    }
+    else {
+        slot = std::uint32_t(m_bodies.size());
+        m_bodies.emplace_back();
+    }
+    Body& body = m_bodies[slot];
+    body = Body{};
+    body.alive = true;
+    body.entity = entity;
+    body.moved = true;
+    m_bodyOf[entity] = slot;
+    return slot;
+}
+
+void CollisionWorld::removeBody(std::uint32_t slot)
+{
+    Body& body = m_bodies[slot];
+    if (body.proxy != AabbTree::kNull) m_tree.destroyProxy(body.proxy);
+    m_bodyOf.erase(body.entity);
+    body.alive = false;
+    body.proxy = AabbTree::kNull;
+    m_freeBodies.push_back(slot);
+}
+
+void CollisionWorld::disableSelfCollision(entt::entity robot, int linkA, int linkB)
+{
+    if (m_disabledPairs.insert(linkPairKey(robot, linkA, linkB)).second)
+        for (Body& b : m_bodies) b.moved |= b.alive && b.robot == robot;   // re-test on next update
+}
+
+void CollisionWorld::enableSelfCollision(entt::entity robot, int linkA, int linkB)
+{
+    if (m_disabledPairs.erase(linkPairKey(robot, linkA, linkB)) > 0)
+        for (Body& b : m_bodies) b.moved |= b.alive && b.robot == robot;
+}
+
+bool CollisionWorld::isSelfCollisionEnabled(entt::entity robot, int linkA, int linkB) const
+{
+    return m_disabledPairs.count(linkPairKey(robot, linkA, linkB)) == 0;
+}
+
+ConvexCollision::Contact CollisionWorld::collideParts(const std::vector<Part>& a, const std::vector<Part>& b)
+{
+    if (a.size() == 1 && b.size() == 1) return ConvexCollision::collide(a[0].shape, b[0].shape);
+
+    ConvexCollision::Contact deepest;
+    for (const Part& pa : a)
+        for (const Part& pb : b) {
+            if (!overlaps(pa.min, pa.max, pb.min, pb.max)) continue;
+            const ConvexCollision::Contact c = ConvexCollision::collide(pa.shape, pb.shape);
+            if (c.hit && (!deepest.hit || c.distance < deepest.distance)) deepest = c;
+        }
+    return deepest;
+}
+
+bool CollisionWorld::intersectParts(const Part* a, std::size_t aCount, const Part* b, std::size_t bCount)
+{
+    for (std::size_t i = 0; i < aCount; ++i)
+        for (std::size_t j = 0; j < bCount; ++j)
+            if (overlaps(a[i].min, a[i].max, b[j].min, b[j].max) && ConvexCollision::intersects(a[i].shape, b[j].shape))
+                return true;
+    return false;
+}
+
+void CollisionWorld::placeParts(std::vector<Part>& parts, const ConvexCollision::Shape& shape)
+{
+    for (Part& p : parts) {
+        p.shape.linear = shape.linear;
+        p.shape.translation = shape.translation;
+        p.shape.radius = shape.radius;
+        ConvexCollision::bounds(p.shape, p.min, p.max);
+    }
+}
+
+bool CollisionWorld::pairEnabled(const Body& a, const Body& b) const
+{
+    if (a.robot != b.robot) return true;
+    if (a.robot == entt::null) return false;   // environment against environment
+
+    const auto it = m_robots.find(a.robot);
+    if (it != m_robots.end() && it->second.model) {
+        const KinematicModel& model = *it->second.model;
+        if (model.parentOf(a.link) == b.link || model.parentOf(b.link) == a.link) return false;
+    }
+    return isSelfCollisionEnabled(a.robot, a.link, b.link);
+}
+
+// --- Per-frame update ---
+
+void CollisionWorld::fitShapes(entt::registry& registry)
+{
+    // Refits when the content changes, not only the storage: keyed like the
+    // arena and picking caches. Returns whether the shape was (re)fitted.
+    auto fit = [&](entt::entity e, const MeshData& mesh, entt::entity robot, int link,
+                   const std::shared_ptr<const ConvexHullSet>& hulls = nullptr) {
+        const auto* existing = registry.try_get<CollisionShapeComponent>(e);
+        if (mesh.vertices.empty()) {
+            if (existing) registry.remove<CollisionShapeComponent>(e);
+            return false;
+        }
+        const std::size_t key = MeshCache::keyOf(mesh);
+        if (existing && existing->meshKey == key && existing->hulls == hulls) return false;
+
+        CollisionShapeComponent shape = fitShape(mesh.vertices, robot != entt::null, hulls);
+        shape.robot = robot;
+        shape.link = link;
+        shape.meshKey = key;
+        registry.emplace_or_replace<CollisionShapeComponent>(e, std::move(shape));
+
+        const auto body = m_bodyOf.find(e);
+        if (body != m_bodyOf.end()) m_bodies[body->second].moved = true;
+        return true;
+    };
+
+    for (auto [root, kin] : registry.view<KinematicModelComponent>().each()) {
+        if (!kin.model) continue;
+        RobotState& robot = m_robots[root];
+        if (robot.model != kin.model) robot = { kin.model, false };
+
+        for (int link = 0; link < int(kin.links.size()); ++link) {
+            const entt::entity e = kin.links[link];
+            if (!registry.valid(e)) continue;
+            const auto* collision = registry.try_get<CollisionMeshComponent>(e);
+            const std::shared_ptr<const ConvexHullSet> hulls = collision ? collision->hulls : nullptr;
+            bool refit = false;
+            if (collision && collision->mesh) refit = fit(e, *collision->mesh, root, link, hulls);
+            else if (const auto* mesh = registry.try_get<RenderableMeshComponent>(e); mesh && mesh->mesh)
+                refit = fit(e, *mesh->mesh, root, link, hulls);
+            if (refit) robot.primed = false;   // a late or changed mesh: filter its pairs too
+        }
+    }
+    for (auto it = m_robots.begin(); it != m_robots.end();) {
+        if (registry.valid(it->first) && registry.all_of<KinematicModelComponent>(it->first)) ++it;
+        else it = m_robots.erase(it);
+    }
+
+    for (auto [e, mesh] : registry.view<EnvironmentColliderTag, RenderableMeshComponent>().each())
+        if (!registry.all_of<LinkComponent>(e)) fit(e, mesh.mesh ? *mesh.mesh : MeshData::empty(), entt::null, -1);
+}
+
+bool CollisionWorld::syncBodies(entt::registry& registry)
+{
+    bool changed = false;
+
+    for (std::uint32_t slot = 0; slot < m_bodies.size(); ++slot) {
+        const Body& b = m_bodies[slot];
+        if (b.alive && (!registry.valid(b.entity) ||
+                        !registry.all_of<CollisionShapeComponent, WorldTransformComponent>(b.entity))) {
+            if (b.robot == entt::null) ++m_environmentVersion;
+            removeBody(slot);
+            changed = true;
+        }
+    }
+
+    for (auto [e, shape] : registry.view<CollisionShapeComponent>().each())
+        if (!m_bodyOf.count(e) && registry.all_of<WorldTransformComponent>(e)) addBody(e);
+
+    for (std::uint32_t slot = 0; slot < m_bodies.size(); ++slot) {
+        Body& b = m_bodies[slot];
+        if (!b.alive) continue;
+
+        // The component may have been replaced since the last frame.
+        const auto& shape = registry.get<CollisionShapeComponent>(b.entity);
+        b.shape.points = shape.points.data();
+        b.shape.count = shape.points.size();
+        if (shape.hulls) {
+            b.parts.resize(shape.hulls->hullCount());
+            for (std::size_t i = 0; i < b.parts.size(); ++i) {
+                b.parts[i].shape.points = shape.hulls->hull(i);
+                b.parts[i].shape.count = shape.hulls->hullSize(i);
+            }
+        }
+        else {
+            b.parts.resize(1);
+            b.parts[0].shape.points = b.shape.points;
+            b.parts[0].shape.count = b.shape.count;
+        }
+
+        const glm::mat4& m = registry.get<WorldTransformComponent>(b.entity).matrix;
+        if (!b.moved && m == b.sourceMatrix) continue;
+
+        b.sourceMatrix = m;
+        b.robot = shape.robot;
+        b.link = shape.link;
+        b.shape.linear = glm::mat3(m);
+        b.shape.translation = glm::vec3(m[3]);
+        b.shape.radius = shape.radius * maxColumnLength(b.shape.linear);
+        ConvexCollision::bounds(b.shape, b.min, b.max);
+        placeParts(b.parts, b.shape);
+
+        if (b.proxy == AabbTree::kNull) b.proxy = m_tree.createProxy(b.min, b.max, slot);
+        else m_tree.moveProxy(b.proxy, b.min, b.max);
+        if (b.robot == entt::null) ++m_environmentVersion;
+        b.moved = true;
+        changed = true;
+    }
+    return changed;
+}
+
+bool CollisionWorld::update(entt::registry& registry, bool narrowphase)
+{
+    if (&registry != m_registry) {
+        reset();
+        m_registry = &registry;
+    }
+
+    fitShapes(registry);
+    bool changed = syncBodies(registry);
+    changed |= filterSpawnContacts(registry);
+    m_stats.colliders = m_tree.proxyCount();
+    if (!changed || !narrowphase) return false;   // moved flags stay set until tested
+
+    std::unordered_map<std::uint64_t, float> contacts;
+    contacts.reserve(m_contacts.size());
+    FrameArena& arena = FrameArena::local();
+    m_stats.candidatePairs = m_stats.narrowphaseTests = 0;
+
+    for (std::uint32_t i = 0; i < m_bodies.size(); ++i) {
+        const Body& a = m_bodies[i];
+        if (!a.alive) continue;
+
+        m_tree.query(a.min, a.max, [&](std::int32_t proxy) {
+            const std::uint32_t j = m_tree.userData(proxy);
+            if (j <= i) return;   // each pair once
+            const Body& b = m_bodies[j];
+            if (!overlaps(a.min, a.max, b.min, b.max) || !pairEnabled(a, b)) return;
+            ++m_stats.candidatePairs;
+
+            // Neither moved: the answer from last time still holds.
+            const std::uint64_t key = pairKey(i, j);
+            if (!a.moved && !b.moved) {
+                const auto it = m_contacts.find(key);
+                if (it != m_contacts.end()) contacts.insert(*it);
+                return;
+            }
+
+            ++m_stats.narrowphaseTests;
+            const ConvexCollision::Contact c = collideParts(a.parts, b.parts);
+            if (c.hit) contacts.emplace(key, -c.distance);
+        });
+    }
+
+    for (Body& b : m_bodies) b.moved = false;
+
+    bool contactSetChanged = contacts.size() != m_contacts.size();
+    for (auto it = contacts.begin(); !contactSetChanged && it != contacts.end(); ++it)
+        contactSetChanged = m_contacts.count(it->first) == 0;
+    m_contacts.swap(contacts);
+    m_stats.contacts = m_contacts.size();
+
+    // --- Contact components: exactly the entities in some pair ---
+    std::pmr::unordered_map<entt::entity, CollisionContactComponent> touching(&arena);
+    for (const auto& [key, depth] : m_contacts) {
+        const entt::entity ea = m_bodies[std::uint32_t(key >> 32)].entity;
+        const entt::entity eb = m_bodies[std::uint32_t(key)].entity;
+        auto& ca = touching[ea];
+        ca.others.push_back(eb);
+        ca.maxDepth = std::max(ca.maxDepth, depth);
+        auto& cb = touching[eb];
+        cb.others.push_back(ea);
+        cb.maxDepth = std::max(cb.maxDepth, depth);
+    }
+
+    FrameVector<entt::entity> stale(&arena);
+    for (entt::entity e : registry.view<CollisionContactComponent>())
+        if (!touching.count(e)) stale.push_back(e);
+    registry.remove<CollisionContactComponent>(stale.begin(), stale.end());
+    for (auto& [e, contact] : touching)
+        registry.emplace_or_replace<CollisionContactComponent>(e, std::move(contact));
+
+    return contactSetChanged;
+}
+
+void CollisionWorld::clearContacts(entt::registry& registry)
+{
+    registry.clear<CollisionContactComponent>();
+    m_contacts.clear();
+    m_stats.contacts = 0;
+    // Everything is re-tested once checking resumes.
+    for (Body& b : m_bodies) b.moved = b.alive;
+}
+
+// Disables the self pairs of each new robot that touch with every joint at
+// zero (clamped into its limits): the pose the model is authored in, so
+// what touches there is placeholder or neighbouring geometry, not a fault.
+// Runs as soon as the robot's links have bodies, whatever pose it is in and
+// whether or not contacts are being checked. Returns whether any pair was
+// switched off, so the narrowphase drops their contacts.
+bool CollisionWorld::filterSpawnContacts(entt::registry& registry)
+{
+    bool anyFiltered = false;
+    for (auto& [root, robot] : m_robots) {
+        if (robot.primed || !robot.model) continue;
+        const auto* kin = registry.try_get<KinematicModelComponent>(root);
+        if (!kin) continue;
+        robot.primed = true;
+
+        const KinematicModel& model = *robot.model;
+        const int links = model.linkCount();
+        std::vector<std::int64_t> linkBody;
+        std::vector<std::size_t> partBegin;
+        linkBodies(*kin, links, linkBody, partBegin);
+
+        std::vector<double> q(std::size_t(model.dofCount()), 0.0);
+        for (int d = 0; d < model.dofCount(); ++d)
+            if (model.isLimited(d)) q[d] = std::clamp(0.0, model.lowerLimit(d), model.upperLimit(d));
+        std::vector<KinematicModel::Pose> world(std::size_t(links));
+        model.forward(q.data(), world.data());
+
+        std::vector<ConvexCollision::Shape> shapes(std::size_t(links));
+        std::vector<glm::vec3> mins(std::size_t(links)), maxs(std::size_t(links));
+        std::vector<Part> parts(partBegin[links]);
+        poseLinks(linkBody.data(), links, world.data(), partBegin.data(), shapes.data(), mins.data(), maxs.data(), parts.data());
+
+        bool filtered = false;
+        for (int a = 0; a < links; ++a)
+            for (int b = a + 1; b < links; ++b) {
+                if (linkBody[a] < 0 || linkBody[b] < 0 || !overlaps(mins[a], maxs[a], mins[b], maxs[b])) continue;
+                if (!pairEnabled(m_bodies[linkBody[a]], m_bodies[linkBody[b]])) continue;
+                if (!intersectParts(parts.data() + partBegin[a], partBegin[a + 1] - partBegin[a],
+                        parts.data() + partBegin[b], partBegin[b + 1] - partBegin[b]))
+                    continue;
+                m_disabledPairs.insert(linkPairKey(root, a, b));
+                filtered = true;
+            }
+        if (filtered)
+            for (Body& b : m_bodies) b.moved |= b.alive && b.robot == root;
+        anyFiltered |= filtered;
+    }
+    return anyFiltered;
+}
+
+// --- Trajectory validation ---
+
+void CollisionWorld::linkBodies(const KinematicModelComponent& kin, int links, std::vector<std::int64_t>& linkBody,
+    std::vector<std::size_t>& partBegin) const
+{
+    linkBody.assign(std::size_t(links), -1);
+    partBegin.assign(std::size_t(links) + 1, 0);
+    for (int link = 0; link < links && link < int(kin.links.size()); ++link) {
+        const auto it = m_bodyOf.find(kin.links[link]);
+        if (it != m_bodyOf.end() && m_bodies[it->second].alive) linkBody[link] = it->second;
+    }
+    for (int link = 0; link < links; ++link)
+        partBegin[link + 1] = partBegin[link] + (linkBody[link] < 0 ? 0 : m_bodies[linkBody[link]].parts.size());
+}
+
+void CollisionWorld::poseLinks(const std::int64_t* linkBody, int links, const KinematicModel::Pose* world,
+    const std::size_t* partBegin, ConvexCollision::Shape* shapes, glm::vec3* mins, glm::vec3* maxs, Part* parts) const
+{
+    // Each link's world scale is taken from where it is now; FK poses carry
+    // rotation and translation only.
+    for (int link = 0; link < links; ++link) {
+        if (linkBody[link] < 0) continue;
+        const ConvexCollision::Shape& now = m_bodies[linkBody[link]].shape;
+        const glm::mat3 r = glm::mat3_cast(world[link].rotation);
+        ConvexCollision::Shape& s = shapes[link];
+        s = now;
+        s.linear = glm::mat3(r[0] * glm::length(now.linear[0]),
+                             r[1] * glm::length(now.linear[1]),
+                             r[2] * glm::length(now.linear[2]));
+        s.translation = world[link].translation;
+        ConvexCollision::bounds(s, mins[link], maxs[link]);
+
+        const std::vector<Part>& nowParts = m_bodies[linkBody[link]].parts;
+        for (std::size_t i = 0; i < nowParts.size(); ++i) {
+            Part& p = parts[partBegin[link] + i];
+            p.shape = nowParts[i].shape;
+            p.shape.linear = s.linear;
+            p.shape.translation = s.translation;
+            ConvexCollision::bounds(p.shape, p.min, p.max);
+        }
+    }
+}
+
+std::size_t CollisionWorld::validateTrajectory(entt::registry& registry, entt::entity robot, const double* q,
+    std::size_t count, std::uint8_t* collides, bool includeEnvironment)
+{
+    std::fill(collides, collides + count, std::uint8_t(0));
+    const auto* kin = registry.try_get<KinematicModelComponent>(robot);
+    if (!kin || !kin->model || count == 0 || &registry != m_registry) return 0;
+    const KinematicModel& model = *kin->model;
+    const int links = model.linkCount();
+
+    // Collider slot per link, each link's parts back to back, and the self
+    // pairs worth testing.
+    std::vector<std::int64_t> linkBody;
+    std::vector<std::size_t> partBegin;
+    linkBodies(*kin, links, linkBody, partBegin);
+    std::vector<std::pair<int, int>> selfPairs;
+    for (int a = 0; a < links; ++a)
+        for (int b = a + 1; b < links; ++b)
+            if (linkBody[a] >= 0 && linkBody[b] >= 0 && pairEnabled(m_bodies[linkBody[a]], m_bodies[linkBody[b]]))
+                selfPairs.emplace_back(a, b);
+
+    KinematicModel::Pose base;
+    if (const auto* xf = registry.try_get<TransformComponent>(robot)) {
+        base.translation = xf->translation;
+        base.rotation = xf->rotation;
+    }
+    m_poses.resize(count * std::size_t(links));
+    model.forwardBatch(q, count, m_poses.data(), base);
+
+    ThreadPool::shared().parallelFor(count, [&](std::size_t c) {
+        thread_local std::vector<ConvexCollision::Shape> shapes;
+        thread_local std::vector<glm::vec3> mins, maxs;
+        thread_local std::vector<Part> parts;
+        shapes.resize(std::size_t(links));
+        mins.resize(std::size_t(links));
+        maxs.resize(std::size_t(links));
+        parts.resize(partBegin[links]);
+
+        // Each link's shape at this configuration.
+        poseLinks(linkBody.data(), links, &m_poses[c * std::size_t(links)], partBegin.data(),
+            shapes.data(), mins.data(), maxs.data(), parts.data());
+        auto partsOf = [&](int link) { return parts.data() + partBegin[link]; };
+        auto partCount = [&](int link) { return partBegin[link + 1] - partBegin[link]; };
+
+        bool hit = false;
+        for (const auto& [a, b] : selfPairs) {
+            if (overlaps(mins[a], maxs[a], mins[b], maxs[b]) &&
+                intersectParts(partsOf(a), partCount(a), partsOf(b), partCount(b))) {
+                hit = true;
+                break;
+            }
+        }
+
+        // Environment and other robots, where they are now.
+        for (int link = 0; includeEnvironment && !hit && link < links; ++link) {
+            if (linkBody[link] < 0) continue;
+            m_tree.query(mins[link], maxs[link], [&](std::int32_t proxy) {
+                if (hit) return;
+                const Body& other = m_bodies[m_tree.userData(proxy)];
+                if (other.robot == robot) return;
+                hit = overlaps(mins[link], maxs[link], other.min, other.max) &&
+                      intersectParts(partsOf(link), partCount(link), other.parts.data(), other.parts.size());
+            });
+        }
+        collides[c] = hit ? 1 : 0;
+    });
+
+    return std::size_t(std::count(collides, collides + count, std::uint8_t(1)));
+}
@@ -0,0 +1,294 @@
+#include "ComputeDispatch.hpp"
+#include "RenderStats.hpp"
+#include "Shader.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_3_Core>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <limits>
+
+#ifndef GL_COMPUTE_SHADER_INVOCATIONS_ARB
+#define GL_COMPUTE_SHADER_INVOCATIONS_ARB 0x82F5
+#endif
+
+namespace {
+constexpr double kSmoothing = 0.1;       // weight of the newest sample, as GpuProfiler
+constexpr int kTuneWarmup = 4;           // first dispatches per variant pay for the program switch
+constexpr std::size_t kMaxPending = 256; // never harvested (context gone idle): stop timing
+
+double median(std::vector<double> values)
+{
+    if (values.empty()) return 0.0;
+    const auto mid = values.begin() + std::ptrdiff_t(values.size() / 2);
+    std::nth_element(values.begin(), mid, values.end());
+    return *mid;
+}
+}
+
+const char* ComputeDispatch::kernelName(Kernel kernel)
+{
+    switch (kernel) {
+    case Kernel::FieldArrows:    return "fieldArrows";
+    case Kernel::ParticleUpdate: return "particleUpdate";
+    case Kernel::FlowUpdate:     return "flowUpdate";
+    case Kernel::Count:          break;
+    }
+    return "unknown";
+}
+
+const char* ComputeDispatch::kernelFile(Kernel kernel)
+{
+    switch (kernel) {
+    case Kernel::FieldArrows:    return "field_visualizer_comp.glsl";
+    case Kernel::ParticleUpdate: return "particle_update_comp.glsl";
+    case Kernel::FlowUpdate:     return "flow_vector_update_comp.glsl";
+    case Kernel::Count:          break;
+    }
+    return "";
+}
+
+ComputeDispatch::~ComputeDispatch() = default;
+
+int ComputeDispatch::variantOf(GLuint localSize)
+{
+    const auto it = std::find(kLocalSizes.begin(), kLocalSizes.end(), localSize);
+    return it == kLocalSizes.end() ? -1 : int(it - kLocalSizes.begin());
+}
+
+void ComputeDispatch::initialize(QOpenGLFunctions_4_3_Core* gl, const Builder& build)
+{
+    m_gl = gl;
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    m_pipelineStatistics = ctx && ctx->hasExtension("GL_ARB_pipeline_statistics_query");
+
+    auto str = [gl](GLenum name) {
+        const auto* s = reinterpret_cast<const char*>(gl->glGetString(name));
+        return QString::fromLatin1(s ? s : "");
+    };
+    m_driverId = str(GL_VENDOR) + " / " + str(GL_RENDERER) + " / " + str(GL_VERSION);
+    const QString cache = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    m_cachePath = cache.isEmpty() ? QString() : cache + QStringLiteral("/compute_tuning.json");
+
+    const QByteArray tune = qgetenv("KR_COMPUTE_TUNE");
+    for (KernelState& k : m_kernels) k.chosen = tune == "0" ? variantOf(kDefaultLocalSize) : -1;
+    if (tune.isEmpty()) loadChoices();
+
+    for (std::size_t i = 0; i < kKernelCount; ++i) {
+        KernelState& k = m_kernels[i];
+        for (std::size_t v = 0; v < kLocalSizes.size(); ++v)
+            k.variants[v] = k.chosen < 0 || int(v) == k.chosen ? build(Kernel(i), kLocalSizes[v]) : nullptr;
+        for (auto& samples : k.samples) samples.clear();
+        k.stats = KernelStats{};
+        k.stats.tuning = k.chosen < 0;
+        k.stats.localSize = k.chosen < 0 ? kDefaultLocalSize : kLocalSizes[std::size_t(k.chosen)];
+    }
+}
+
+void ComputeDispatch::rebuild(Kernel kernel, const Builder& build)
+{
+    KernelState& k = m_kernels[std::size_t(kernel)];
+    // Build every replacement first so a failed edit keeps the last good set.
+    std::array<std::unique_ptr<Shader>, kLocalSizes.size()> rebuilt;
+    for (std::size_t v = 0; v < kLocalSizes.size(); ++v)
+        if (k.variants[v]) rebuilt[v] = build(kernel, kLocalSizes[v]);
+    k.variants = std::move(rebuilt);
+}
+
+void ComputeDispatch::release()
+{
+    for (KernelState& k : m_kernels)
+        for (auto& variant : k.variants) variant.reset();
+}
+
+Shader* ComputeDispatch::select(Kernel kernel)
+{
+    KernelState& k = m_kernels[std::size_t(kernel)];
+    k.selected = k.chosen;
+    if (k.selected < 0) {
+        // Tuning: the next variant, in turn, that still needs samples.
+        const int count = int(kLocalSizes.size());
+        for (int n = 0; n < count && k.selected < 0; ++n) {
+            const int v = k.nextTuned++ % count;
+            if (k.variants[std::size_t(v)] && int(k.samples[std::size_t(v)].size()) < kTuneWarmup + kTuneSamples)
+                k.selected = v;
+        }
+        if (k.selected < 0) k.selected = variantOf(kDefaultLocalSize);   // all sampled, results in flight
+    }
+    return k.variants[std::size_t(k.selected)].get();
+}
+
+GLuint ComputeDispatch::localSize(Kernel kernel) const
+{
+    const KernelState& k = m_kernels[std::size_t(kernel)];
+    return k.selected < 0 ? 0 : kLocalSizes[std::size_t(k.selected)];
+}
+
+void ComputeDispatch::dispatch(ContextQueries& context, Kernel kernel, GLuint items)
+{
+    launch(context, kernel, items, -1);
+}
+
+void ComputeDispatch::dispatchIndirect(ContextQueries& context, Kernel kernel, GLintptr offset, GLuint maxItems)
+{
+    launch(context, kernel, maxItems, offset);
+}
+
+// indirectOffset < 0: a direct dispatch of 'items'.
+void ComputeDispatch::launch(ContextQueries& context, Kernel kernel, GLuint items, GLintptr indirectOffset)
+{
+    KernelState& k = m_kernels[std::size_t(kernel)];
+    if (items == 0 || k.selected < 0) return;
+    const GLuint localSize = kLocalSizes[std::size_t(k.selected)];
+    const GLuint groups = (items + localSize - 1) / localSize;
+
+    const bool timed = (m_recording || k.chosen < 0) && context.pending.size() < kMaxPending;
+    const auto run = [&] {
+        if (indirectOffset < 0) m_gl->glDispatchCompute(groups, 1, 1);
+        else m_gl->glDispatchComputeIndirect(indirectOffset);
+        RenderStats::dispatch();
+    };
+    if (!timed) {
+        run();
+        return;
+    }
+
+    ContextQueries::Pending p{ kernel, k.selected, items, groups, { 0, 0, 0 } };
+    const int queryCount = m_pipelineStatistics ? 3 : 2;
+    for (int q = 0; q < queryCount; ++q) {
+        if (context.freeQueries.empty()) {
+            GLuint name = 0;
+            m_gl->glGenQueries(1, &name);
+            context.freeQueries.push_back(name);
+        }
+        p.queries[q] = context.freeQueries.back();
+        context.freeQueries.pop_back();
+    }
+
+    m_gl->glQueryCounter(p.queries[0], GL_TIMESTAMP);
+    if (m_pipelineStatistics) m_gl->glBeginQuery(GL_COMPUTE_SHADER_INVOCATIONS_ARB, p.queries[2]);
+    run();
+    if (m_pipelineStatistics) m_gl->glEndQuery(GL_COMPUTE_SHADER_INVOCATIONS_ARB);
+    m_gl->glQueryCounter(p.queries[1], GL_TIMESTAMP);
+    context.pending.push_back(p);
+}
+
+void ComputeDispatch::harvest(ContextQueries& context)
+{
+    std::size_t done = 0;
+    for (; done < context.pending.size(); ++done) {
+        const ContextQueries::Pending& p = context.pending[done];
+        GLuint available = 0;
+        m_gl->glGetQueryObjectuiv(p.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;   // later ones finish later
+
+        GLuint64 begin = 0, end = 0, invocations = 0;
+        m_gl->glGetQueryObjectui64v(p.queries[0], GL_QUERY_RESULT, &begin);
+        m_gl->glGetQueryObjectui64v(p.queries[1], GL_QUERY_RESULT, &end);
+        if (p.queries[2]) m_gl->glGetQueryObjectui64v(p.queries[2], GL_QUERY_RESULT, &invocations);
+        for (GLuint q : p.queries)
+            if (q) context.freeQueries.push_back(q);
+
+        KernelState& k = m_kernels[std::size_t(p.kernel)];
+        const double ns = end > begin ? double(end - begin) : 0.0;
+        const double nsPerItem = ns / double(p.items);
+        KernelStats& s = k.stats;
+        const double w = s.dispatches ? kSmoothing : 1.0;
+        s.gpuUs += w * (ns * 1e-3 - s.gpuUs);
+        s.nsPerItem += w * (nsPerItem - s.nsPerItem);
+        s.items = p.items;
+        s.groups = p.groups;
+        s.invocations = invocations;
+        ++s.dispatches;
+
+        if (k.chosen < 0 && k.variants[std::size_t(p.variant)]) {
+            k.samples[std::size_t(p.variant)].push_back(nsPerItem);
+            const bool complete = std::all_of(k.samples.begin(), k.samples.end(), [&](const std::vector<double>& v) {
+                return !k.variants[std::size_t(&v - k.samples.data())] || int(v.size()) >= kTuneWarmup + kTuneSamples;
+            });
+            if (complete) finishTuning(p.kernel);
+        }
+    }
+    context.pending.erase(context.pending.begin(), context.pending.begin() + std::ptrdiff_t(done));
+}
+
+void ComputeDispatch::destroy(ContextQueries& context)
+{
+    for (const ContextQueries::Pending& p : context.pending)
+        for (GLuint q : p.queries)
+            if (q) context.freeQueries.push_back(q);
+    if (!context.freeQueries.empty())
+        m_gl->glDeleteQueries(GLsizei(context.freeQueries.size()), context.freeQueries.data());
+    context = ContextQueries{};
+}
+
+void ComputeDispatch::finishTuning(Kernel kernel)
+{
+    KernelState& k = m_kernels[std::size_t(kernel)];
+    double best = std::numeric_limits<double>::max();
+    QString summary;
+    for (std::size_t v = 0; v < kLocalSizes.size(); ++v) {
+        std::vector<double>& samples = k.samples[v];
+        if (!k.variants[v] || samples.empty()) continue;
+        samples.erase(samples.begin(), samples.begin() + std::min<std::ptrdiff_t>(kTuneWarmup, std::ptrdiff_t(samples.size())));
+        const double ns = median(samples);
+        k.stats.tunedNsPerItem[v] = ns;
+        summary += QStringLiteral(" %1: %2").arg(kLocalSizes[v]).arg(ns, 0, 'f', 3);
+        if (ns < best) {
+            best = ns;
+            k.chosen = int(v);
+        }
+        samples.clear();
+    }
+    if (k.chosen < 0) k.chosen = variantOf(kDefaultLocalSize);
+    for (std::size_t v = 0; v < kLocalSizes.size(); ++v)
+        if (int(v) != k.chosen) k.variants[v].reset();
+    k.stats.tuning = false;
+    k.stats.localSize = kLocalSizes[std::size_t(k.chosen)];
+
+    qInfo().noquote() << QStringLiteral("[ComputeDispatch] %1: local size %2 (ns per item by size:%3)")
+        .arg(QLatin1String(kernelName(kernel))).arg(k.stats.localSize).arg(summary);
+    storeChoices();
+}
+
+// {"<vendor / renderer / version>": {"<kernel>": localSize, ...}, ...}
+void ComputeDispatch::loadChoices()
+{
+    QFile file(m_cachePath);
+    if (m_cachePath.isEmpty() || !file.open(QIODevice::ReadOnly)) return;
+    const QJsonObject sizes = QJsonDocument::fromJson(file.readAll()).object().value(m_driverId).toObject();
+    for (std::size_t i = 0; i < kKernelCount; ++i)
+        m_kernels[i].chosen = variantOf(GLuint(sizes.value(QLatin1String(kernelName(Kernel(i)))).toInt()));
+}
+
+void ComputeDispatch::storeChoices() const
+{
+    if (m_cachePath.isEmpty()) return;
+    QJsonObject all;
+    {
+        QFile file(m_cachePath);
+        if (file.open(QIODevice::ReadOnly)) all = QJsonDocument::fromJson(file.readAll()).object();
+    }
+    QJsonObject sizes = all.value(m_driverId).toObject();
+    for (std::size_t i = 0; i < kKernelCount; ++i)
+        if (m_kernels[i].chosen >= 0)
+            sizes.insert(QLatin1String(kernelName(Kernel(i))), int(kLocalSizes[std::size_t(m_kernels[i].chosen)]));
+    all.insert(m_driverId, sizes);
+
+    QDir().mkpath(QFileInfo(m_cachePath).path());
+    QSaveFile file(m_cachePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "[ComputeDispatch] Cannot write" << m_cachePath;
+        return;
+    }
+    file.write(QJsonDocument(all).toJson());
+    file.commit();
+}
@@ -0,0 +1,458 @@
+#include "ConvexCollision.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace ConvexCollision
+{
+namespace {
+constexpr int   kGjkIterations = 64;
+constexpr int   kEpaIterations = 64;
+constexpr float kGjkRelTolerance = 1e-6f;
+constexpr float kEpaTolerance = 1e-4f;
+constexpr float kTiny = 1e-12f;
+
+// Minkowski-difference vertex with the support points it came from.
+struct Vert { glm::vec3 w, a, b; };
+
+struct Simplex {
+    Vert v[4];
+    float lambda[4];
+    int n = 0;
+};
+
+glm::vec3 safeNormalize(const glm::vec3& d)
+{
+    const float len2 = glm::dot(d, d);
+    return len2 > kTiny ? d / std::sqrt(len2) : glm::vec3(1.0f, 0.0f, 0.0f);
+}
+
+Vert supportCore(const Shape& a, const Shape& b, const glm::vec3& d)
+{
+    const glm::vec3 pa = a.supportCore(d), pb = b.supportCore(-d);
+    return { pa - pb, pa, pb };
+}
+
+Vert supportFull(const Shape& a, const Shape& b, const glm::vec3& d)
+{
+    const glm::vec3 n = safeNormalize(d);
+    const glm::vec3 pa = a.supportCore(n) + n * a.radius, pb = b.supportCore(-n) - n * b.radius;
+    return { pa - pb, pa, pb };
+}
+
+// --- Closest point on the simplex to the origin (Ericson, ch. 5) ---
+// Each reduces 's' to the smallest feature holding the closest point and
+// fills its barycentric weights.
+
+void keep(Simplex& s, std::initializer_list<std::pair<int, float>> feature)
+{
+    Vert v[4];
+    float l[4];
+    int n = 0;
+    for (auto [i, w] : feature) { v[n] = s.v[i]; l[n] = w; ++n; }
+    for (int i = 0; i < n; ++i) { s.v[i] = v[i]; s.lambda[i] = l[i]; }
+    s.n = n;
+}
+
+void solveSegment(Simplex& s)
+{
+    const glm::vec3 a = s.v[0].w, ab = s.v[1].w - a;
+    const float len2 = glm::dot(ab, ab);
+    const float t = len2 > kTiny ? -glm::dot(a, ab) / len2 : 0.0f;
+    if (t <= 0.0f) keep(s, { { 0, 1.0f } });
+    else if (t >= 1.0f) keep(s, { { 1, 1.0f } });
+    else keep(s, { { 0, 1.0f - t }, { 1, t } });
+}
+
+// Closest point of triangle (i, j, k) of 's'; returns it and writes the feature to 'out'.
+glm::vec3 closestOnTriangle(const Simplex& s, int i, int j, int k, Simplex& out)
+{
+    const glm::vec3 a = s.v[i].w, b = s.v[j].w, c = s.v[k].w;
+    const glm::vec3 ab = b - a, ac = c - a;
+    out.v[0] = s.v[i]; out.v[1] = s.v[j]; out.v[2] = s.v[k];
+
+    const float d1 = glm::dot(ab, -a), d2 = glm::dot(ac, -a);
+    if (d1 <= 0.0f && d2 <= 0.0f) { out.n = 1; out.lambda[0] = 1.0f; return a; }
+
+    const float d3 = glm::dot(ab, -b), d4 = glm::dot(ac, -b);
+    if (d3 >= 0.0f && d4 <= d3) { out.n = 1; out.v[0] = s.v[j]; out.lambda[0] = 1.0f; return b; }
+
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        const float t = d1 / (d1 - d3);
+        out.n = 2; out.lambda[0] = 1.0f - t; out.lambda[1] = t;
+        return a + t * ab;
+    }
+
+    const float d5 = glm::dot(ab, -c), d6 = glm::dot(ac, -c);
+    if (d6 >= 0.0f && d5 <= d6) { out.n = 1; out.v[0] = s.v[k]; out.lambda[0] = 1.0f; return c; }
+
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        const float t = d2 / (d2 - d6);
+        out.n = 2; out.v[1] = s.v[k]; out.lambda[0] = 1.0f - t; out.lambda[1] = t;
+        return a + t * ac;
+    }
+
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+        const float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        out.n = 2; out.v[0] = s.v[j]; out.v[1] = s.v[k]; out.lambda[0] = 1.0f - t; out.lambda[1] = t;
+        return b + t * (c - b);
+    }
+
+    const float denom = 1.0f / (va + vb + vc);
+    const float v = vb * denom, w = vc * denom;
+    out.n = 3; out.lambda[0] = 1.0f - v - w; out.lambda[1] = v; out.lambda[2] = w;
+    return a + ab * v + ac * w;
+}
+
+// True if the origin and vertex 'd' lie on opposite sides of plane (a, b, c),
+// or the tetrahedron is too flat to tell.
+bool originOutside(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d)
+{
+    const glm::vec3 n = glm::cross(b - a, c - a);
+    const float sideD = glm::dot(d - a, n);
+    if (sideD * sideD <= 1e-10f * glm::dot(n, n)) return true;
+    return glm::dot(-a, n) * sideD < 0.0f;
+}
+
+// Returns false if the origin is inside the tetrahedron.
+bool solveTetrahedron(Simplex& s)
+{
+    static constexpr int kFaces[4][4] = { { 0, 1, 2, 3 }, { 0, 2, 3, 1 }, { 0, 3, 1, 2 }, { 1, 3, 2, 0 } };
+    float best = std::numeric_limits<float>::max();
+    Simplex bestFeature;
+    bool outside = false;
+    for (const auto& f : kFaces) {
+        if (!originOutside(s.v[f[0]].w, s.v[f[1]].w, s.v[f[2]].w, s.v[f[3]].w)) continue;
+        outside = true;
+        Simplex feature;
+        const glm::vec3 p = closestOnTriangle(s, f[0], f[1], f[2], feature);
+        const float d2 = glm::dot(p, p);
+        if (d2 < best) { best = d2; bestFeature = feature; }
+    }
+    if (!outside) return false;
+    s = bestFeature;
+    return true;
+}
+
+glm::vec3 combine(const Simplex& s, glm::vec3 Vert::* member)
+{
+    glm::vec3 p(0.0f);
+    for (int i = 0; i < s.n; ++i) p += s.lambda[i] * (s.v[i].*member);
+    return p;
+}
+
+struct GjkResult {
+    bool overlap = false;
+    float distance = 0.0f;
+    glm::vec3 pointA{ 0.0f }, pointB{ 0.0f };
+    Simplex simplex;
+};
+
+// Core-to-core GJK. With 'separationMargin' >= 0 it returns as soon as the
+// cores are proven further apart than the margin (distance is then a lower bound).
+GjkResult gjk(const Shape& a, const Shape& b, float separationMargin = -1.0f)
+{
+    GjkResult r;
+    Simplex& s = r.simplex;
+    glm::vec3 v = a.center() - b.center();
+    if (glm::dot(v, v) < kTiny) v = glm::vec3(1.0f, 0.0f, 0.0f);
+
+    for (int iter = 0; iter < kGjkIterations; ++iter) {
+        const Vert w = supportCore(a, b, -v);
+        const float vv = glm::dot(v, v);
+        const float vw = glm::dot(v, w.w);
+
+        if (separationMargin >= 0.0f && vw > 0.0f && vw * vw > separationMargin * separationMargin * vv) {
+            r.distance = vw / std::sqrt(vv);
+            return r;  // plane through w along v separates the cores by more than the margin
+        }
+        if (s.n > 0 && vv - vw <= kGjkRelTolerance * vv) break;
+
+        bool duplicate = false;
+        for (int i = 0; i < s.n; ++i) duplicate |= s.v[i].w == w.w;
+        if (duplicate) break;
+
+        s.v[s.n] = w;
+        s.lambda[s.n] = 0.0f;
+        ++s.n;
+        switch (s.n) {
+        case 1: s.lambda[0] = 1.0f; break;
+        case 2: solveSegment(s); break;
+        case 3: { Simplex f; closestOnTriangle(s, 0, 1, 2, f); s = f; break; }
+        case 4: if (!solveTetrahedron(s)) { r.overlap = true; return r; } break;
+        }
+
+        v = combine(s, &Vert::w);
+        if (glm::dot(v, v) < kTiny) { r.overlap = true; return r; }
+    }
+
+    r.pointA = combine(s, &Vert::a);
+    r.pointB = combine(s, &Vert::b);
+    r.distance = glm::length(r.pointA - r.pointB);
+    return r;
+}
+
+// --- EPA ---
+
+struct Face {
+    int i[3];
+    glm::vec3 n;
+    float d;
+};
+
+// Orients the face away from 'interior', a point strictly inside the polytope.
+// The origin itself may lie on the starting polytope's boundary, so it cannot be used.
+bool makeFace(const std::vector<Vert>& verts, int a, int b, int c, const glm::vec3& interior, Face& f)
+{
+    glm::vec3 n = glm::cross(verts[b].w - verts[a].w, verts[c].w - verts[a].w);
+    const float len2 = glm::dot(n, n);
+    if (len2 < kTiny) return false;
+    n /= std::sqrt(len2);
+    if (glm::dot(n, verts[a].w - interior) < 0.0f) { std::swap(b, c); n = -n; }
+    f = { { a, b, c }, n, glm::dot(n, verts[a].w) };
+    return true;
+}
+
+// Grows GJK's terminal simplex into a tetrahedron that encloses the origin.
+bool blowUp(const Shape& a, const Shape& b, std::vector<Vert>& verts)
+{
+    static const glm::vec3 kAxes[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    auto distinct = [&](const Vert& w) {
+        for (const Vert& v : verts) if (glm::dot(v.w - w.w, v.w - w.w) < 1e-10f) return false;
+        return true;
+    };
+
+    if (verts.empty()) verts.push_back(supportFull(a, b, glm::vec3(1, 0, 0)));
+    for (int i = 0; verts.size() == 1 && i < 6; ++i) {
+        const Vert w = supportFull(a, b, kAxes[i]);
+        if (distinct(w)) verts.push_back(w);
+    }
+    if (verts.size() == 2) {
+        const glm::vec3 e = verts[1].w - verts[0].w;
+        const glm::vec3 ref = std::abs(e.x) < std::abs(e.y) ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+        const glm::vec3 p = glm::cross(e, ref);
+        const glm::vec3 q = glm::cross(e, p);
+        const glm::vec3 dirs[4] = { p, -p, q, -q };
+        for (int i = 0; verts.size() == 2 && i < 4; ++i) {
+            const Vert w = supportFull(a, b, dirs[i]);
+            if (distinct(w) && glm::dot(glm::cross(w.w - verts[0].w, e), glm::cross(w.w - verts[0].w, e)) > 1e-10f)
+                verts.push_back(w);
+        }
+    }
+    if (verts.size() == 3) {
+        const glm::vec3 n = glm::cross(verts[1].w - verts[0].w, verts[2].w - verts[0].w);
+        for (const glm::vec3& dir : { n, -n }) {
+            const Vert w = supportFull(a, b, dir);
+            if (std::abs(glm::dot(w.w - verts[0].w, n)) > 1e-7f) { verts.push_back(w); break; }
+        }
+    }
+    return verts.size() == 4;
+}
+
+Contact epa(const Shape& a, const Shape& b, const Simplex& start)
+{
+    Contact c;
+    c.hit = true;
+
+    std::vector<Vert> verts(start.v, start.v + start.n);
+    if (!blowUp(a, b, verts)) return c;   // degenerate: touching, depth ~0
+
+    const glm::vec3 interior = 0.25f * (verts[0].w + verts[1].w + verts[2].w + verts[3].w);
+    std::vector<Face> faces;
+    faces.reserve(64);
+    for (const auto& t : { std::array<int, 3>{ 0, 1, 2 }, std::array<int, 3>{ 0, 1, 3 },
+                           std::array<int, 3>{ 0, 2, 3 }, std::array<int, 3>{ 1, 2, 3 } }) {
+        Face f;
+        if (makeFace(verts, t[0], t[1], t[2], interior, f)) faces.push_back(f);
+    }
+
+    std::vector<std::pair<int, int>> horizon;
+    Face best{};
+    for (int iter = 0; iter < kEpaIterations && !faces.empty(); ++iter) {
+        best = *std::min_element(faces.begin(), faces.end(),
+            [](const Face& x, const Face& y) { return x.d < y.d; });
+
+        const Vert w = supportFull(a, b, best.n);
+        if (glm::dot(w.w, best.n) - best.d < kEpaTolerance) break;
+
+        const int wi = int(verts.size());
+        verts.push_back(w);
+
+        // Remove every face that sees w; their unshared edges form the horizon.
+        horizon.clear();
+        for (std::size_t f = 0; f < faces.size();) {
+            if (glm::dot(faces[f].n, w.w - verts[faces[f].i[0]].w) <= 0.0f) { ++f; continue; }
+            for (int e = 0; e < 3; ++e) {
+                const std::pair<int, int> edge{ faces[f].i[e], faces[f].i[(e + 1) % 3] };
+                auto twin = std::find(horizon.begin(), horizon.end(), std::make_pair(edge.second, edge.first));
+                if (twin != horizon.end()) horizon.erase(twin);
+                else horizon.push_back(edge);
+            }
+            faces[f] = faces.back();
+            faces.pop_back();
+        }
+        for (const auto& [e0, e1] : horizon) {
+            Face f;
+            if (makeFace(verts, e0, e1, wi, interior, f)) faces.push_back(f);
+        }
+    }
+
+    // Witness points: barycentric coordinates of the origin's projection on the face.
+    const glm::vec3 p = best.n * best.d;
+    const glm::vec3 v0 = verts[best.i[0]].w, v1 = verts[best.i[1]].w, v2 = verts[best.i[2]].w;
+    const glm::vec3 e0 = v1 - v0, e1 = v2 - v0, e2 = p - v0;
+    const float d00 = glm::dot(e0, e0), d01 = glm::dot(e0, e1), d11 = glm::dot(e1, e1);
+    const float d20 = glm::dot(e2, e0), d21 = glm::dot(e2, e1);
+    const float denom = d00 * d11 - d01 * d01;
+    float l1 = 0.0f, l2 = 0.0f;
+    if (std::abs(denom) > kTiny) {
+        l1 = (d11 * d20 - d01 * d21) / denom;
+        l2 = (d00 * d21 - d01 * d20) / denom;
+    }
+    const float l0 = 1.0f - l1 - l2;
+    c.pointA = l0 * verts[best.i[0]].a + l1 * verts[best.i[1]].a + l2 * verts[best.i[2]].a;
+    c.pointB = l0 * verts[best.i[0]].b + l1 * verts[best.i[1]].b + l2 * verts[best.i[2]].b;
+    c.normal = best.n;
+    c.distance = -best.d;
+    return c;
+}
+}
+
+glm::vec3 Shape::center() const
+{
+    glm::vec3 sum(0.0f);
+    for (std::size_t i = 0; i < count; ++i) sum += points[i];
+    return linear * (count ? sum / float(count) : sum) + translation;
+}
+
+glm::vec3 Shape::supportCore(const glm::vec3& dir) const
+{
+    // max over p of dir . (L p) = (L^T dir) . p
+    const glm::vec3 local = glm::transpose(linear) * dir;
+    std::size_t best = 0;
+    float bestDot = -std::numeric_limits<float>::max();
+    for (std::size_t i = 0; i < count; ++i) {
+        const float d = glm::dot(points[i], local);
+        if (d > bestDot) { bestDot = d; best = i; }
+    }
+    return linear * points[best] + translation;
+}
+
+Contact collide(const Shape& a, const Shape& b)
+{
+    const GjkResult g = gjk(a, b);
+    if (g.overlap) return epa(a, b, g.simplex);
+
+    Contact c;
+    c.normal = safeNormalize(g.pointB - g.pointA);
+    c.distance = g.distance - a.radius - b.radius;
+    c.pointA = g.pointA + c.normal * a.radius;
+    c.pointB = g.pointB - c.normal * b.radius;
+    c.hit = c.distance <= 0.0f;
+    return c;
+}
+
+bool intersects(const Shape& a, const Shape& b)
+{
+    const float margin = a.radius + b.radius;
+    const GjkResult g = gjk(a, b, margin);
+    return g.overlap || g.distance <= margin;
+}
+
+void bounds(const Shape& shape, glm::vec3& min, glm::vec3& max)
+{
+    min = glm::vec3(std::numeric_limits<float>::max());
+    max = -min;
+    for (std::size_t i = 0; i < shape.count; ++i) {
+        const glm::vec3 p = shape.linear * shape.points[i] + shape.translation;
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    min -= glm::vec3(shape.radius);
+    max += glm::vec3(shape.radius);
+}
+
+// --- Fitting ---
+
+Capsule fitCapsule(const std::vector<glm::vec3>& points)
+{
+    Capsule cap;
+    if (points.empty()) return cap;
+
+    glm::vec3 mean(0.0f);
+    for (const glm::vec3& p : points) mean += p;
+    mean /= float(points.size());
+
+    // Covariance, then its dominant eigenvector by power iteration.
+    float cxx = 0, cxy = 0, cxz = 0, cyy = 0, cyz = 0, czz = 0;
+    for (const glm::vec3& p : points) {
+        const glm::vec3 d = p - mean;
+        cxx += d.x * d.x; cxy += d.x * d.y; cxz += d.x * d.z;
+        cyy += d.y * d.y; cyz += d.y * d.z; czz += d.z * d.z;
+    }
+    glm::vec3 axis(1.0f, 1.0f, 1.0f);
+    for (int i = 0; i < 32; ++i) {
+        const glm::vec3 next(cxx * axis.x + cxy * axis.y + cxz * axis.z,
+                             cxy * axis.x + cyy * axis.y + cyz * axis.z,
+                             cxz * axis.x + cyz * axis.y + czz * axis.z);
+        const float len2 = glm::dot(next, next);
+        if (len2 < kTiny) break;
+        axis = next / std::sqrt(len2);
+    }
+    axis = safeNormalize(axis);
+
+    float tMin = std::numeric_limits<float>::max(), tMax = -tMin, radius = 0.0f;
+    for (const glm::vec3& p : points) {
+        const float t = glm::dot(p - mean, axis);
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+        const glm::vec3 perp = (p - mean) - axis * t;
+        radius = std::max(radius, glm::length(perp));
+    }
+
+    // Pull the ends in by the radius so the caps, not the cylinder, cover them,
+    // then widen just enough that every point is inside.
+    float a = tMin + radius, b = tMax - radius;
+    if (a > b) a = b = 0.5f * (tMin + tMax);
+    cap.a = mean + axis * a;
+    cap.b = mean + axis * b;
+    for (const glm::vec3& p : points) {
+        const float t = std::clamp(glm::dot(p - mean, axis), a, b);
+        radius = std::max(radius, glm::length(p - (mean + axis * t)));
+    }
+    cap.radius = radius;
+    return cap;
+}
+
+std::vector<glm::vec3> hullSupportPoints(const std::vector<glm::vec3>& points, std::size_t maxPoints)
+{
+    std::vector<glm::vec3> unique = points;
+    auto less = [](const glm::vec3& x, const glm::vec3& y) {
+        return x.x != y.x ? x.x < y.x : x.y != y.y ? x.y < y.y : x.z < y.z;
+    };
+    std::sort(unique.begin(), unique.end(), less);
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+    if (unique.size() <= maxPoints) return unique;
+
+    // Extremes along a Fibonacci sphere of directions; every one is a hull vertex.
+    std::vector<glm::vec3> out;
+    out.reserve(maxPoints);
+    const std::size_t directions = maxPoints * 2;
+    const float golden = 3.14159265f * (3.0f - std::sqrt(5.0f));
+    for (std::size_t i = 0; i < directions && out.size() < maxPoints; ++i) {
+        const float y = 1.0f - 2.0f * (float(i) + 0.5f) / float(directions);
+        const float r = std::sqrt(std::max(0.0f, 1.0f - y * y));
+        const glm::vec3 dir(r * std::cos(golden * float(i)), y, r * std::sin(golden * float(i)));
+        const glm::vec3* best = &unique[0];
+        for (const glm::vec3& p : unique)
+            if (glm::dot(p, dir) > glm::dot(*best, dir)) best = &p;
+        if (std::find(out.begin(), out.end(), *best) == out.end()) out.push_back(*best);
+    }
+    return out;
+}
+}
@@ -0,0 +1,224 @@
+#include "ConvexDecomposition.hpp"
+#include "ConvexCollision.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ConvexDecomposition
+{
+namespace {
+constexpr std::size_t kEvaluationHullPoints = 32;
+
+struct Triangle {
+    glm::vec3 centroid;
+    glm::vec3 normal;                       ///< unit, outward by winding
+    unsigned v[3];
+};
+
+struct Piece {
+    std::vector<std::uint32_t> triangles;
+    glm::vec3 min{ 0.0f }, max{ 0.0f };     ///< of the centroids
+    float concavity = 0.0f;
+    bool final = false;                     ///< no plane splits it
+};
+
+class Decomposer
+{
+public:
+    Decomposer(const std::vector<glm::vec3>& positions, const std::vector<Triangle>& triangles)
+        : m_positions(positions), m_triangles(triangles), m_seen(positions.size(), 0) {}
+
+    float concavity(const std::vector<std::uint32_t>& piece)
+    {
+        if (piece.empty()) return 0.0f;
+        const std::size_t stride = (piece.size() + kEvaluationTriangles - 1) / kEvaluationTriangles;
+        m_points.clear();
+        nextStamp();
+        for (std::size_t i = 0; i < piece.size(); i += stride)
+            for (unsigned v : m_triangles[piece[i]].v) addPoint(v);
+        const std::vector<glm::vec3> hull = ConvexCollision::hullSupportPoints(m_points, kEvaluationHullPoints);
+
+        float worst = 0.0f;
+        for (std::size_t i = 0; i < piece.size(); i += stride) {
+            const Triangle& t = m_triangles[piece[i]];
+            float support = -std::numeric_limits<float>::max();
+            for (const glm::vec3& p : hull) support = std::max(support, glm::dot(p, t.normal));
+            worst = std::max(worst, support - glm::dot(t.centroid, t.normal));
+        }
+        return worst;
+    }
+
+    std::vector<glm::vec3> hullOf(const std::vector<std::uint32_t>& piece, std::size_t maxPoints)
+    {
+        m_points.clear();
+        nextStamp();
+        for (std::uint32_t t : piece)
+            for (unsigned v : m_triangles[t].v) addPoint(v);
+        return ConvexCollision::hullSupportPoints(m_points, maxPoints);
+    }
+
+private:
+    void nextStamp()
+    {
+        if (++m_stamp == 0) {   // wrapped: forget every old stamp
+            std::fill(m_seen.begin(), m_seen.end(), 0u);
+            m_stamp = 1;
+        }
+    }
+    void addPoint(unsigned v)
+    {
+        if (m_seen[v] == m_stamp) return;
+        m_seen[v] = m_stamp;
+        m_points.push_back(m_positions[v]);
+    }
+
+    const std::vector<glm::vec3>& m_positions;
+    const std::vector<Triangle>& m_triangles;
+    std::vector<std::uint32_t> m_seen;      ///< m_stamp where a vertex is in m_points
+    std::uint32_t m_stamp = 0;
+    std::vector<glm::vec3> m_points;
+};
+
+void boundCentroids(Piece& piece, const std::vector<Triangle>& triangles)
+{
+    piece.min = glm::vec3(std::numeric_limits<float>::max());
+    piece.max = -piece.min;
+    for (std::uint32_t t : piece.triangles) {
+        piece.min = glm::min(piece.min, triangles[t].centroid);
+        piece.max = glm::max(piece.max, triangles[t].centroid);
+    }
+}
+}
+
+std::uint64_t Params::key() const
+{
+    // FNV-1a over the fields, so no padding bytes take part.
+    std::uint64_t h = 1469598103934665603ull;
+    auto mix = [&](const void* data, std::size_t size) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) { h ^= bytes[i]; h *= 1099511628211ull; }
+    };
+    const std::uint64_t hullPoints = maxHullPoints;
+    mix(&maxHulls, sizeof(maxHulls));
+    mix(&maxConcavity, sizeof(maxConcavity));
+    mix(&hullPoints, sizeof(hullPoints));
+    mix(&planesPerAxis, sizeof(planesPerAxis));
+    return h;
+}
+
+ConvexHullSet decompose(const std::vector<glm::vec3>& positions, const std::vector<unsigned>& indices,
+    const Params& params)
+{
+    ConvexHullSet out;
+    if (positions.empty()) return out;
+
+    // --- Triangles, degenerate ones dropped ---
+    std::vector<Triangle> triangles;
+    triangles.reserve(indices.size() / 3);
+    glm::vec3 min = positions[0], max = positions[0];
+    for (const glm::vec3& p : positions) { min = glm::min(min, p); max = glm::max(max, p); }
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const unsigned a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if (a >= positions.size() || b >= positions.size() || c >= positions.size()) continue;
+        const glm::vec3 n = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+        const float length = glm::length(n);
+        if (!(length > 0.0f)) continue;
+        triangles.push_back({ (positions[a] + positions[b] + positions[c]) / 3.0f, n / length, { a, b, c } });
+    }
+    if (triangles.empty()) {
+        out.points = ConvexCollision::hullSupportPoints(positions, params.maxHullPoints);
+        out.offsets = { 0u, std::uint32_t(out.points.size()) };
+        return out;
+    }
+
+    Decomposer decomposer(positions, triangles);
+    const float threshold = params.maxConcavity * glm::length(max - min);
+
+    std::vector<Piece> pieces(1);
+    pieces[0].triangles.resize(triangles.size());
+    for (std::uint32_t t = 0; t < triangles.size(); ++t) pieces[0].triangles[t] = t;
+    boundCentroids(pieces[0], triangles);
+    pieces[0].concavity = decomposer.concavity(pieces[0].triangles);
+
+    // --- Split the worst piece until all are good enough or the budget is spent ---
+    std::vector<std::uint32_t> left, right, bestLeft, bestRight;
+    while (int(pieces.size()) < params.maxHulls) {
+        std::size_t worst = pieces.size();
+        for (std::size_t p = 0; p < pieces.size(); ++p)
+            if (!pieces[p].final && pieces[p].concavity > threshold
+                && (worst == pieces.size() || pieces[p].concavity > pieces[worst].concavity))
+                worst = p;
+        if (worst == pieces.size()) break;
+
+        Piece& piece = pieces[worst];
+        float bestCost = std::numeric_limits<float>::max();
+        float bestLeftConcavity = 0.0f, bestRightConcavity = 0.0f;
+        for (int axis = 0; axis < 3; ++axis) {
+            const float extent = piece.max[axis] - piece.min[axis];
+            if (!(extent > 0.0f)) continue;
+            for (int k = 1; k <= params.planesPerAxis; ++k) {
+                const float plane = piece.min[axis] + extent * float(k) / float(params.planesPerAxis + 1);
+                left.clear();
+                right.clear();
+                for (std::uint32_t t : piece.triangles)
+                    (triangles[t].centroid[axis] < plane ? left : right).push_back(t);
+                if (left.empty() || right.empty()) continue;
+                const float leftConcavity = decomposer.concavity(left);
+                const float rightConcavity = decomposer.concavity(right);
+                const float cost = leftConcavity + rightConcavity;
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestLeftConcavity = leftConcavity;
+                    bestRightConcavity = rightConcavity;
+                    bestLeft.swap(left);
+                    bestRight.swap(right);
+                }
+            }
+        }
+        if (bestCost == std::numeric_limits<float>::max()) {
+            piece.final = true;
+            continue;
+        }
+
+        piece.triangles.swap(bestLeft);
+        piece.concavity = bestLeftConcavity;
+        boundCentroids(piece, triangles);
+        Piece other;
+        other.triangles.swap(bestRight);
+        other.concavity = bestRightConcavity;
+        boundCentroids(other, triangles);
+        pieces.push_back(std::move(other));
+    }
+
+    // --- Merge pieces whose union is still good enough: cuts through
+    //     coarse triangles leave slivers that belong to a neighbour ---
+    std::vector<std::uint32_t> merged;
+    while (pieces.size() > 1) {
+        float bestConcavity = threshold;
+        std::size_t bestA = 0, bestB = 0;
+        for (std::size_t a = 0; a < pieces.size(); ++a)
+            for (std::size_t b = a + 1; b < pieces.size(); ++b) {
+                merged = pieces[a].triangles;
+                merged.insert(merged.end(), pieces[b].triangles.begin(), pieces[b].triangles.end());
+                const float c = decomposer.concavity(merged);
+                if (c <= bestConcavity) { bestConcavity = c; bestA = a; bestB = b; }
+            }
+        if (bestA == bestB) break;
+        Piece& into = pieces[bestA];
+        into.triangles.insert(into.triangles.end(), pieces[bestB].triangles.begin(), pieces[bestB].triangles.end());
+        into.concavity = bestConcavity;
+        pieces.erase(pieces.begin() + std::ptrdiff_t(bestB));
+    }
+
+    // --- One hull per piece, from all of its vertices ---
+    out.offsets.reserve(pieces.size() + 1);
+    out.offsets.push_back(0);
+    for (const Piece& piece : pieces) {
+        const std::vector<glm::vec3> hull = decomposer.hullOf(piece.triangles, params.maxHullPoints);
+        out.points.insert(out.points.end(), hull.begin(), hull.end());
+        out.offsets.push_back(std::uint32_t(out.points.size()));
+    }
+    return out;
+}
+}
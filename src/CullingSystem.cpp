@@ -0,0 +1,111 @@
+#include "CullingSystem.hpp"
+#include "components.hpp"
+#include "MeshCache.hpp"
+
+#include <entt/entt.hpp>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // Local-space box of the mesh vertices.
+    void computeLocalBounds(const RenderableMeshComponent& mesh, WorldBoundsComponent& b)
+    {
+        if (mesh.vertices().empty()) {
+            b.localMin = b.localMax = glm::vec3(0.0f);
+            return;
+        }
+        b.localMin = b.localMax = mesh.vertices().front().position;
+        for (const auto& v : mesh.vertices()) {
+            b.localMin = glm::min(b.localMin, v.position);
+            b.localMax = glm::max(b.localMax, v.position);
+        }
+    }
+
+    void transformBounds(const glm::mat4& m, WorldBoundsComponent& b)
+    {
+        CullingSystem::transformBox(m, b.localMin, b.localMax, b.min, b.max);
+    }
+}
+
+// Arvo's method: transform the centre and the half-extent by |M|.
+void CullingSystem::transformBox(const glm::mat4& m, const glm::vec3& localMin, const glm::vec3& localMax,
+    glm::vec3& min, glm::vec3& max)
+{
+    const glm::vec3 c = 0.5f * (localMin + localMax);
+    const glm::vec3 e = 0.5f * (localMax - localMin);
+    const glm::vec3 wc = glm::vec3(m * glm::vec4(c, 1.0f));
+    glm::vec3 we;
+    for (int i = 0; i < 3; ++i)
+        we[i] = std::abs(m[0][i]) * e.x + std::abs(m[1][i]) * e.y + std::abs(m[2][i]) * e.z;
+    min = wc - we;
+    max = wc + we;
+}
+
+std::size_t CullingSystem::updateWorldBounds(entt::registry& registry)
+{
+    std::size_t changed = 0;
+    for (auto [entity, mesh, xf] : renderableMeshes(registry).each()) {
+        const auto* worldTransform = registry.try_get<WorldTransformComponent>(entity);
+        const glm::mat4 world = worldTransform ? worldTransform->matrix : xf.getTransform();
+
+        auto* bounds = registry.try_get<WorldBoundsComponent>(entity);
+        if (!bounds) bounds = &registry.emplace<WorldBoundsComponent>(entity);
+
+        // Keyed on content: a mesh swapped for another of the same size still refits.
+        const std::size_t meshKey = MeshCache::keyOf(mesh.mesh ? *mesh.mesh : MeshData::empty());
+        const bool localDirty = !bounds->valid || bounds->meshKey != meshKey;
+        if (localDirty) {
+            computeLocalBounds(mesh, *bounds);
+            bounds->meshKey = meshKey;
+        }
+
+        // Only re-transform when the world matrix actually moved.
+        if (localDirty || std::memcmp(&bounds->sourceMatrix, &world, sizeof(glm::mat4)) != 0) {
+            transformBounds(world, *bounds);
+            bounds->sourceMatrix = world;
+            bounds->valid = true;
+            ++changed;
+        }
+    }
+    return changed;
+}
+
+Frustum CullingSystem::extractFrustum(const glm::mat4& m)
+{
+    // Gribb/Hartmann: rows of the clip matrix (glm is column-major).
+    const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum f;
+    f.planes[0] = row3 + row0; // left
+    f.planes[1] = row3 - row0; // right
+    f.planes[2] = row3 + row1; // bottom
+    f.planes[3] = row3 - row1; // top
+    f.planes[4] = row3 + row2; // near
+    f.planes[5] = row3 - row2; // far
+    for (auto& p : f.planes) {
+        const float len = glm::length(glm::vec3(p));
+        if (len > 0.0f) p /= len;
+    }
+    return f;
+}
+
+bool CullingSystem::isVisible(const Frustum& frustum, const glm::vec3& min, const glm::vec3& max)
+{
+    for (const auto& p : frustum.planes) {
+        // The box corner furthest along the plane normal.
+        const glm::vec3 positive(p.x >= 0.0f ? max.x : min.x,
+                                 p.y >= 0.0f ? max.y : min.y,
+                                 p.z >= 0.0f ? max.z : min.z);
+        if (glm::dot(glm::vec3(p), positive) + p.w < 0.0f) return false;
+    }
+    return true;
+}
+
+bool CullingSystem::isVisible(const Frustum& frustum, const WorldBoundsComponent& bounds)
+{
+    return !bounds.valid || isVisible(frustum, bounds.min, bounds.max);
+}
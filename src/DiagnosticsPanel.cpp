@@ -1,47 +1,175 @@
 #include "DiagnosticsPanel.hpp"
 #include "Robot.hpp" // Include Robot to use its data
-#include <QVBoxLayout>
-#include <QLabel>
-#include <iomanip>
-#include <sstream>
+#include "components.hpp"
+#include "JointStateBuffer.hpp"
+#include "KinematicModel.hpp"
+
+#include <QAbstractTableModel>
+#include <QHeaderView>
+#include <QTableView>
+#include <QTimer>
+#include <entt/entt.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+// Name / value rows with the value text cached, so unchanged rows cost one
+// integer compare per refresh and no QString work.
+class JointStateModel : public QAbstractTableModel
+{
+public:
+    using QAbstractTableModel::QAbstractTableModel;
+
+    enum class Unit { Degrees, Millimetres };
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : int(m_rows.size()); }
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : 2; }
+
+    QVariant data(const QModelIndex& index, int role) const override
+    {
+        if (!index.isValid()) return {};
+        const Row& row = m_rows[index.row()];
+        if (role == Qt::DisplayRole) return index.column() == 0 ? row.name : row.text;
+        if (role == Qt::TextAlignmentRole && index.column() == 1) return int(Qt::AlignRight | Qt::AlignVCenter);
+        return {};
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override
+    {
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return {};
+        return section == 0 ? QStringLiteral("Joint") : QStringLiteral("Position");
+    }
+
+    void beginRows() { beginResetModel(); m_rows.clear(); }
+    void addRow(const QString& name, Unit unit) { m_rows.push_back({ name, unit }); }
+    void endRows() { endResetModel(); }
+
+    // 'value' in radians or metres. Marks the row dirty only if its text would change.
+    void setValue(int row, double value)
+    {
+        Row& r = m_rows[row];
+        const bool degrees = r.unit == Unit::Degrees;
+        const double shown = degrees ? value * (180.0 / 3.14159265358979323846) : value * 1000.0;
+        const long long quantized = std::llround(shown * (degrees ? 100.0 : 10.0));
+        if (quantized == r.quantized) return;
+        r.quantized = quantized;
+        char buffer[32];
+        const int n = std::snprintf(buffer, sizeof(buffer), degrees ? "%.2f deg" : "%.1f mm", shown);
+        r.text = QString::fromLatin1(buffer, n);
+        m_dirtyFirst = std::min(m_dirtyFirst, row);
+        m_dirtyLast = std::max(m_dirtyLast, row);
+    }
+
+    // One dataChanged for the span of rows touched since the last flush.
+    void flush()
+    {
+        if (m_dirtyFirst > m_dirtyLast) return;
+        emit dataChanged(index(m_dirtyFirst, 1), index(m_dirtyLast, 1), { Qt::DisplayRole });
+        m_dirtyFirst = std::numeric_limits<int>::max();
+        m_dirtyLast = -1;
+    }
+
+private:
+    struct Row {
+        QString name;
+        Unit unit = Unit::Degrees;
+        long long quantized = std::numeric_limits<long long>::min();
+        QString text;
+    };
+    std::vector<Row> m_rows;
+    int m_dirtyFirst = std::numeric_limits<int>::max();
+    int m_dirtyLast = -1;
+};
 
 DiagnosticsPanel::DiagnosticsPanel(QWidget* parent)
     : QDockWidget("Diagnostics", parent)
 {
     setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
 
-    m_mainWidget = new QWidget();
-    m_layout = new QVBoxLayout(m_mainWidget);
-    m_layout->setSpacing(5);
-    m_layout->setAlignment(Qt::AlignTop);
+    m_model = new JointStateModel(this);
+    m_view = new QTableView(this);
+    m_view->setModel(m_model);
+    m_view->setSelectionMode(QAbstractItemView::NoSelection);
+    m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_view->verticalHeader()->setVisible(false);
+    m_view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_view->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_view->horizontalHeader()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+    m_view->setWordWrap(false);
+    setWidget(m_view);
 
-    // Add a placeholder label. It will be updated once the robot is loaded.
-    m_layout->addWidget(new QLabel("Waiting for robot data..."));
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setInterval(1000 / kRefreshHz);
+    connect(m_refreshTimer, &QTimer::timeout, this, [this]() {
+        if (isVisible()) refreshFromRegistry();
+    });
+}
 
-    setWidget(m_mainWidget);
+DiagnosticsPanel::~DiagnosticsPanel() = default;
+
+void DiagnosticsPanel::setRegistry(entt::registry* registry)
+{
+    m_registry = registry;
+    if (m_registry) m_refreshTimer->start();
+    else m_refreshTimer->stop();
 }
 
-void DiagnosticsPanel::updateData(const Robot& robot)
+void DiagnosticsPanel::refreshFromRegistry()
 {
-    auto jointStates = robot.getJointStates();
-
-    // On first run, create labels for each joint
-    if (m_jointLabels.empty() && !jointStates.empty()) {
-        // Clear the placeholder label
-        delete m_layout->takeAt(0)->widget();
-        for (const auto& [name, angle] : jointStates) {
-            m_jointLabels[name] = new QLabel(m_mainWidget);
-            m_layout->addWidget(m_jointLabels[name]);
-        }
+    if (!m_registry) return;
+    auto robots = m_registry->view<KinematicModelComponent, JointStateComponent>();
+
+    auto source = [](const KinematicModelComponent& kin, const JointStateComponent& state) {
+        return kin.model ? state.buffer.get() : nullptr;
+    };
+    std::size_t robotCount = 0;
+    bool rebuild = false;
+    for (auto [root, kin, state] : robots.each()) {
+        rebuild |= robotCount >= m_rowBuffers.size() || m_rowBuffers[robotCount] != source(kin, state);
+        ++robotCount;
     }
+    rebuild |= robotCount != m_rowBuffers.size();
 
-    // Update the text of each label every frame
-    for (const auto& [name, angle] : jointStates) {
-        if (m_jointLabels.count(name)) {
-            std::stringstream stream;
-            stream << std::fixed << std::setprecision(2) << glm::degrees(angle);
-            std::string label_text = name + ": " + stream.str() + " deg";
-            m_jointLabels[name]->setText(QString::fromStdString(label_text));
+    if (rebuild) {
+        m_rowBuffers.clear();
+        m_model->beginRows();
+        for (auto [root, kin, state] : robots.each()) {
+            m_rowBuffers.push_back(source(kin, state));
+            if (!m_rowBuffers.back()) continue;
+            for (int dof = 0; dof < kin.model->dofCount(); ++dof)
+                m_model->addRow(QString::fromStdString(kin.model->dofName(dof)),
+                    kin.model->motionOf(kin.model->dofLink(dof)) == KinematicModel::Motion::Prismatic
+                    ? JointStateModel::Unit::Millimetres : JointStateModel::Unit::Degrees);
         }
+        m_model->endRows();
+    }
+
+    // Same thread as the writers, so the working set is read directly.
+    int row = 0;
+    for (const JointStateBuffer* buffer : m_rowBuffers) {
+        if (!buffer) continue;
+        for (std::size_t dof = 0; dof < buffer->size(); ++dof) m_model->setValue(row++, buffer->position()[dof]);
     }
-}
\ No newline at end of file
+    m_model->flush();
+}
+
+void DiagnosticsPanel::updateData(const Robot& robot)
+{
+    if (m_sinceRefresh.isValid() && m_sinceRefresh.elapsed() < 1000 / kRefreshHz) return;
+    m_sinceRefresh.restart();
+
+    if (!robot.isValid()) return;
+    const int joints = robot.jointCount();
+    if (m_model->rowCount() != joints) {
+        m_model->beginRows();
+        for (int j = 0; j < joints; ++j)
+            m_model->addRow(QString::fromStdString(robot.jointName(j)), robot.isPrismatic(j)
+                ? JointStateModel::Unit::Millimetres : JointStateModel::Unit::Degrees);
+        m_model->endRows();
+    }
+
+    for (int j = 0; j < joints; ++j) m_model->setValue(j, robot.jointPosition(j));
+    m_model->flush();
+}
@@ -0,0 +1,193 @@
+#include "DistanceField.hpp"
+#include "components.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+
+namespace
+{
+    constexpr int kSamples = DistanceField::kBrickSamples;
+    constexpr std::size_t kBrickValues = std::size_t(kSamples) * kSamples * kSamples;
+    constexpr float kQuantum = 32767.0f;
+
+    // Ericson, "Real-Time Collision Detection" 5.1.5.
+    glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        const glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+        const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f) return a;
+        const glm::vec3 bp = p - b;
+        const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3) return b;
+        const float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+        const glm::vec3 cp = p - c;
+        const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6) return c;
+        const float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+        const float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        const float denom = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denom) + ac * (vc * denom);
+    }
+}
+
+DistanceField::DistanceField(const MeshData& mesh, float voxelSize, float band)
+    : m_band(band)
+{
+    const std::size_t triangles = mesh.indices.size() / 3;
+    if (triangles == 0 || band <= 0.0f) return;
+
+    std::vector<glm::vec3> corners(triangles * 3);
+    glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+    for (std::size_t i = 0; i < corners.size(); ++i) {
+        corners[i] = mesh.vertices[mesh.indices[i]].position;
+        lo = glm::min(lo, corners[i]);
+        hi = glm::max(hi, corners[i]);
+    }
+    lo -= glm::vec3(band);
+    hi += glm::vec3(band);
+    const glm::vec3 extent = hi - lo;
+    m_voxelSize = std::max(voxelSize, std::max(extent.x, std::max(extent.y, extent.z)) / float(kMaxCells));
+    m_origin = lo;
+    m_cells = glm::max(glm::ivec3(glm::ceil(extent / m_voxelSize)), glm::ivec3(1));
+
+    // Bricks within the band of each triangle, as (brick, triangle) pairs
+    // grouped by brick. Candidates come from the triangle's grown bounds and
+    // are kept if their centre is near enough, so a large face does not
+    // fill the solid behind it.
+    const float brickSize = m_voxelSize * float(kBrickCells);
+    const float reach = band + brickSize * 0.8660254f;
+    const glm::ivec3 lastBrick = (m_cells - 1) / kBrickCells;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> touches;
+    std::vector<glm::ivec3> bricks;
+    for (std::uint32_t t = 0; t < triangles; ++t) {
+        const glm::vec3* c = &corners[std::size_t(t) * 3];
+        const glm::vec3 tmin = glm::min(c[0], glm::min(c[1], c[2])) - glm::vec3(band);
+        const glm::vec3 tmax = glm::max(c[0], glm::max(c[1], c[2])) + glm::vec3(band);
+        const glm::ivec3 b0 = glm::clamp(glm::ivec3(glm::floor((tmin - m_origin) / brickSize)), glm::ivec3(0), lastBrick);
+        const glm::ivec3 b1 = glm::clamp(glm::ivec3(glm::floor((tmax - m_origin) / brickSize)), glm::ivec3(0), lastBrick);
+        for (int z = b0.z; z <= b1.z; ++z)
+            for (int y = b0.y; y <= b1.y; ++y)
+                for (int x = b0.x; x <= b1.x; ++x) {
+                    const glm::ivec3 brick(x, y, z);
+                    const glm::vec3 centre = m_origin + (glm::vec3(brick) + glm::vec3(0.5f)) * brickSize;
+                    const glm::vec3 away = centre - closestPointOnTriangle(centre, c[0], c[1], c[2]);
+                    if (glm::dot(away, away) > reach * reach) continue;
+                    auto [it, added] = m_brickOf.emplace(brickKey(brick), std::uint32_t(bricks.size()));
+                    if (added) bricks.push_back(brick);
+                    touches.emplace_back(it->second, t);
+                }
+    }
+    std::sort(touches.begin(), touches.end());
+    std::vector<std::uint32_t> first(bricks.size() + 1, 0);
+    for (const auto& touch : touches) ++first[touch.first + 1];
+    for (std::size_t b = 0; b < bricks.size(); ++b) first[b + 1] += first[b];
+
+    m_values.resize(bricks.size() * kBrickValues);
+    ThreadPool::shared().parallelFor(bricks.size(), [&](std::size_t b) {
+        const glm::vec3 base = m_origin + glm::vec3(bricks[b] * kBrickCells) * m_voxelSize;
+        std::int16_t* out = m_values.data() + b * kBrickValues;
+        for (int z = 0; z < kSamples; ++z)
+            for (int y = 0; y < kSamples; ++y)
+                for (int x = 0; x < kSamples; ++x) {
+                    const glm::vec3 p = base + glm::vec3(x, y, z) * m_voxelSize;
+                    float bestSq = band * band;
+                    float bestFacing = -1.0f;
+                    float sign = 1.0f;
+                    for (std::uint32_t k = first[b]; k < first[b + 1]; ++k) {
+                        const glm::vec3* c = &corners[std::size_t(touches[k].second) * 3];
+                        const glm::vec3 d = p - closestPointOnTriangle(p, c[0], c[1], c[2]);
+                        const float dSq = glm::dot(d, d);
+                        if (dSq > bestSq * (1.0f + 1e-4f) + 1e-12f) continue;
+                        // Ties (edges, corners): the face seen most squarely decides the sign.
+                        const glm::vec3 n = glm::cross(c[1] - c[0], c[2] - c[0]);
+                        const float nLength = glm::length(n);
+                        const float facing = dSq > 0.0f && nLength > 0.0f ? glm::dot(d, n) / (nLength * std::sqrt(dSq)) : 0.0f;
+                        if (dSq < bestSq * (1.0f - 1e-4f) || std::abs(facing) > bestFacing) {
+                            bestSq = std::min(bestSq, dSq);
+                            bestFacing = std::abs(facing);
+                            sign = facing < 0.0f ? -1.0f : 1.0f;
+                        }
+                    }
+                    out[(z * kSamples + y) * kSamples + x] = std::int16_t(std::lround(sign * std::min(std::sqrt(bestSq) / band, 1.0f) * kQuantum));
+                }
+    });
+}
+
+std::shared_ptr<const DistanceField> DistanceField::shared(const std::shared_ptr<const MeshData>& mesh,
+    float voxelSize, float band)
+{
+    struct Entry {
+        std::weak_ptr<const MeshData> mesh;
+        float voxelSize = 0.0f, band = 0.0f;
+        std::shared_ptr<const DistanceField> field;   ///< null while building
+    };
+    static std::mutex mutex;
+    static std::vector<Entry> cache;
+
+    if (!mesh || band <= 0.0f) return nullptr;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Entry& entry : cache)
+        if (entry.voxelSize == voxelSize && entry.band == band && entry.mesh.lock() == mesh) return entry.field;
+
+    cache.erase(std::remove_if(cache.begin(), cache.end(), [](const Entry& e) { return e.mesh.expired(); }), cache.end());
+    cache.push_back({ mesh, voxelSize, band, nullptr });
+    ThreadPool::shared().submit([mesh, voxelSize, band] {
+        auto field = std::make_shared<const DistanceField>(*mesh, voxelSize, band);
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Entry& entry : cache)
+            if (entry.voxelSize == voxelSize && entry.band == band && entry.mesh.lock() == mesh) entry.field = std::move(field);
+    });
+    return nullptr;
+}
+
+bool DistanceField::locate(const glm::vec3& p, const std::int16_t*& corner, glm::vec3& fraction) const
+{
+    if (m_values.empty()) return false;
+    const glm::vec3 local = (p - m_origin) / m_voxelSize;
+    const glm::ivec3 cell(glm::floor(local));
+    if (glm::any(glm::lessThan(cell, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(cell, m_cells))) return false;
+    const auto it = m_brickOf.find(brickKey(cell / kBrickCells));
+    if (it == m_brickOf.end()) return false;
+    const glm::ivec3 inBrick = cell % kBrickCells;
+    corner = m_values.data() + it->second * kBrickValues + (inBrick.z * kSamples + inBrick.y) * kSamples + inBrick.x;
+    fraction = local - glm::vec3(cell);
+    return true;
+}
+
+float DistanceField::distance(const glm::vec3& p) const
+{
+    float d;
+    glm::vec3 gradient;
+    return sample(p, d, gradient) ? d : m_band;
+}
+
+bool DistanceField::sample(const glm::vec3& p, float& distance, glm::vec3& gradient) const
+{
+    const std::int16_t* c;
+    glm::vec3 f;
+    if (!locate(p, c, f)) return false;
+    constexpr int dy = kSamples, dz = kSamples * kSamples;
+    const float s = m_band / kQuantum;
+    const float c000 = c[0] * s, c100 = c[1] * s, c010 = c[dy] * s, c110 = c[dy + 1] * s;
+    const float c001 = c[dz] * s, c101 = c[dz + 1] * s, c011 = c[dz + dy] * s, c111 = c[dz + dy + 1] * s;
+
+    // Trilinear, and its derivative along each axis.
+    const float x00 = c000 + (c100 - c000) * f.x, x10 = c010 + (c110 - c010) * f.x;
+    const float x01 = c001 + (c101 - c001) * f.x, x11 = c011 + (c111 - c011) * f.x;
+    const float y0 = x00 + (x10 - x00) * f.y, y1 = x01 + (x11 - x01) * f.y;
+    distance = y0 + (y1 - y0) * f.z;
+
+    const float dx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * f.y;
+    const float dx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * f.y;
+    gradient = glm::vec3(dx0 + (dx1 - dx0) * f.z,
+                         (x10 - x00) + ((x11 - x01) - (x10 - x00)) * f.z,
+                         y1 - y0) / m_voxelSize;
+    return true;
+}
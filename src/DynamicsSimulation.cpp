@@ -0,0 +1,217 @@
+#include "DynamicsSimulation.hpp"
+#include "JointStateBuffer.hpp"
+#include "TraceZones.hpp"
+#include "components.hpp"
+
+#include <QDebug>
+#include <entt/entt.hpp>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Gains for joints whose description leaves the PID at zero.
+constexpr double kDefaultPositionP = 100.0;
+constexpr double kDefaultPositionD = 10.0;
+constexpr double kDefaultVelocityP = 10.0;
+
+// Publish statistics this often; the state goes out every step.
+constexpr std::uint64_t kStatsPublishSteps = 64;
+}
+
+std::size_t DynamicsSimulation::bind(entt::registry& registry)
+{
+    stop();
+    m_robots.clear();
+    m_slotOf.clear();
+    m_dofs = 0;
+
+    for (auto [root, kin, state] : registry.view<KinematicModelComponent, JointStateComponent>().each()) {
+        if (!kin.model || kin.model->dofCount() == 0 || !state.buffer
+            || state.buffer->size() != std::size_t(kin.model->dofCount()))
+            continue;
+        Robot robot;
+        robot.root = root;
+        robot.dynamics = RigidBodyDynamics::fromRobot(registry, root);
+        if (!robot.dynamics) continue;
+        const std::size_t dofs = robot.dynamics->dofCount();
+        robot.first = m_dofs;
+        robot.positionP.assign(dofs, kDefaultPositionP);
+        robot.positionD.assign(dofs, kDefaultPositionD);
+        robot.velocityP.assign(dofs, kDefaultVelocityP);
+        robot.gravity.resize(dofs);
+        robot.tau.resize(dofs);
+        for (std::size_t dof = 0; dof < dofs; ++dof) {
+            const entt::entity joint = kin.links[std::size_t(kin.model->dofLink(int(dof)))];
+            m_slotOf.emplace(joint, m_dofs + dof);
+            const auto* component = registry.try_get<JointComponent>(joint);
+            if (!component) continue;
+            const JointDescription& d = component->description;
+            if (d.position_pid.p > 0.0) robot.positionP[dof] = d.position_pid.p;
+            if (d.position_pid.d > 0.0) robot.positionD[dof] = d.position_pid.d;
+            if (d.velocity_pid.p > 0.0) robot.velocityP[dof] = d.velocity_pid.p;
+        }
+        m_dofs += dofs;
+        m_robots.push_back(std::move(robot));
+    }
+    if (m_robots.empty()) return 0;
+
+    // Start where the robots are, every joint holding that position.
+    m_working.position.assign(m_dofs, 0.0);
+    m_working.velocity.assign(m_dofs, 0.0);
+    m_working.effort.assign(m_dofs, 0.0);
+    m_staged.assign(m_dofs, JointCommand{});
+    for (const Robot& robot : m_robots) {
+        const JointStateBuffer& buffer = *registry.get<JointStateComponent>(robot.root).buffer;
+        const std::size_t dofs = robot.dynamics->dofCount();
+        std::copy(buffer.position(), buffer.position() + dofs, m_working.position.begin() + std::ptrdiff_t(robot.first));
+        for (std::size_t dof = 0; dof < dofs; ++dof) {
+            JointCommand& command = m_staged[robot.first + dof];
+            command.mode = ControlMode::POSITION;
+            command.setpoint = buffer.position()[dof];
+        }
+    }
+    for (int i = 0; i < 3; ++i) {
+        m_commands.slot(i) = m_staged;
+        m_state.slot(i) = m_working;
+        m_sensorState.slot(i) = m_working;
+        m_stats.slot(i) = Stats{};
+    }
+
+    m_running.store(true, std::memory_order_relaxed);
+    m_thread = std::thread(&DynamicsSimulation::run, this);
+    qDebug() << "[DynamicsSimulation] stepping" << int(m_robots.size()) << "robots," << int(m_dofs) << "joints at"
+             << m_rateHz << "Hz";
+    return m_robots.size();
+}
+
+void DynamicsSimulation::stop()
+{
+    m_running.store(false, std::memory_order_relaxed);
+    if (m_thread.joinable()) m_thread.join();
+}
+
+bool DynamicsSimulation::setCommand(entt::entity joint, const JointCommand& command)
+{
+    const auto it = m_slotOf.find(joint);
+    if (it == m_slotOf.end()) return false;
+    m_staged[it->second] = command;
+    return true;
+}
+
+void DynamicsSimulation::publish()
+{
+    if (!running()) return;
+    // Same size every time, so this copies without allocating.
+    std::copy(m_staged.begin(), m_staged.end(), m_commands.back().begin());
+    m_commands.publish();
+}
+
+bool DynamicsSimulation::apply(entt::registry& registry)
+{
+    if (!running() || !m_state.update() || m_measured) return false;
+    const State& state = m_state.front();
+    for (const Robot& robot : m_robots) {
+        auto* component = registry.try_get<JointStateComponent>(robot.root);
+        const std::size_t dofs = robot.dynamics->dofCount();
+        if (!component || !component->buffer || component->buffer->size() != dofs) continue;
+        JointStateBuffer& buffer = *component->buffer;
+        const auto first = std::ptrdiff_t(robot.first), last = first + std::ptrdiff_t(dofs);
+        std::copy(state.position.begin() + first, state.position.begin() + last, buffer.position());
+        std::copy(state.velocity.begin() + first, state.velocity.begin() + last, buffer.velocity());
+        std::copy(state.effort.begin() + first, state.effort.begin() + last, buffer.effort());
+    }
+    return true;
+}
+
+const DynamicsSimulation::Stats& DynamicsSimulation::stats()
+{
+    m_stats.update();
+    return m_stats.front();
+}
+
+int DynamicsSimulation::frameDof(entt::entity joint) const
+{
+    const auto it = m_slotOf.find(joint);
+    return it == m_slotOf.end() ? -1 : int(it->second);
+}
+
+void DynamicsSimulation::run()
+{
+    TraceZones::setThreadName("dynamics");
+    const double dt = 1.0 / std::clamp(m_rateHz, 1.0, 10000.0);
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(dt));
+
+    Stats stats;
+    double busyUs = 0.0;
+    Clock::time_point deadline = Clock::now() + period;
+    while (m_running.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_until(deadline);
+        const Clock::time_point start = Clock::now();
+        {
+            KR_ZONE("dynamics step");
+            m_commands.update();
+            const std::vector<JointCommand>& commands = m_commands.front();
+            for (Robot& robot : m_robots) {
+                RigidBodyDynamics& dynamics = *robot.dynamics;
+                const std::size_t dofs = dynamics.dofCount();
+                double* q = m_working.position.data() + robot.first;
+                double* qd = m_working.velocity.data() + robot.first;
+                const JointCommand* command = commands.data() + robot.first;
+
+                // Gravity compensation: RNEA at zero acceleration ('tau' is
+                // the zero vector until the loop below fills it).
+                std::fill(robot.tau.begin(), robot.tau.end(), 0.0);
+                dynamics.inverseDynamics(q, qd, robot.tau.data(), robot.gravity.data());
+                for (std::size_t d = 0; d < dofs; ++d) {
+                    double t = command[d].feedForward;
+                    switch (command[d].mode) {
+                    case ControlMode::POSITION:
+                        t += robot.gravity[d] + robot.positionP[d] * (command[d].setpoint - q[d]) - robot.positionD[d] * qd[d];
+                        break;
+                    case ControlMode::VELOCITY:
+                        t += robot.gravity[d] + robot.velocityP[d] * (command[d].setpoint - qd[d]);
+                        break;
+                    case ControlMode::TORQUE:
+                    case ControlMode::CURRENT:
+                    case ControlMode::DUTY_CYCLE:
+                        t += command[d].setpoint;
+                        break;
+                    case ControlMode::INACTIVE:
+                        t = 0.0;
+                        break;
+                    }
+                    robot.tau[d] = t;
+                }
+                dynamics.step(q, qd, robot.tau.data(), dt, m_working.effort.data() + robot.first);
+            }
+            State& out = m_state.back();
+            std::copy(m_working.position.begin(), m_working.position.end(), out.position.begin());
+            std::copy(m_working.velocity.begin(), m_working.velocity.end(), out.velocity.begin());
+            std::copy(m_working.effort.begin(), m_working.effort.end(), out.effort.begin());
+            m_state.publish();
+            State& tap = m_sensorState.back();
+            std::copy(m_working.position.begin(), m_working.position.end(), tap.position.begin());
+            std::copy(m_working.velocity.begin(), m_working.velocity.end(), tap.velocity.begin());
+            std::copy(m_working.effort.begin(), m_working.effort.end(), tap.effort.begin());
+            m_sensorState.publish();
+        }
+
+        ++stats.steps;
+        busyUs += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        // Keep the phase: a long step skips the deadlines it missed.
+        deadline += period;
+        const Clock::time_point end = Clock::now();
+        if (end >= deadline) {
+            const auto missed = (end - deadline) / period + 1;
+            stats.overruns += std::uint64_t(missed);
+            deadline += missed * period;
+        }
+        if (stats.steps % kStatsPublishSteps == 0) {
+            stats.stepUs = busyUs / double(stats.steps);
+            m_stats.back() = stats;
+            m_stats.publish();
+        }
+    }
+}
@@ -0,0 +1,208 @@
+#include "EStopService.hpp"
+#include "JointCommandLoop.hpp"
+#include "TraceZones.hpp"
+
+#include <QDebug>
+#include <algorithm>
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#  include <future>
+#else
+#  include <pthread.h>
+#  include <sched.h>
+#  include <unistd.h>
+#  ifdef __linux__
+#    include <cerrno>
+#    include <climits>
+#    include <ctime>
+#    include <dirent.h>
+#    include <fcntl.h>
+#    include <poll.h>
+#    include <sys/ioctl.h>
+#    include <linux/input.h>
+#  endif
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+void raisePriority(const EStopService::Settings& settings)
+{
+    if (!settings.realtime) return;
+#ifdef _WIN32
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+        qWarning() << "[EStopService] could not raise thread priority";
+#else
+    sched_param param{};
+    param.sched_priority = std::clamp(settings.realtimePriority,
+        sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+        qWarning() << "[EStopService] SCHED_FIFO not permitted; running at normal priority";
+#endif
+}
+
+#ifdef __linux__
+bool hasKey(int fd, int key)
+{
+    unsigned long bits[(KEY_MAX + 1 + CHAR_BIT * sizeof(long) - 1) / (CHAR_BIT * sizeof(long))] = {};
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(bits)), bits) < 0) return false;
+    return (bits[std::size_t(key) / (CHAR_BIT * sizeof(long))] >> (std::size_t(key) % (CHAR_BIT * sizeof(long)))) & 1UL;
+}
+#endif
+}
+
+void EStopService::trip(Clock::time_point at)
+{
+    m_loop.emergencyStop(at);
+}
+
+#ifdef __linux__
+
+bool EStopService::start(const Settings& settings)
+{
+    stop();
+    m_settings = settings;
+    if (settings.key < 0 || settings.key > KEY_MAX) return false;
+
+    auto open = [&](const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) return;
+        if (!hasKey(fd, settings.key)) {
+            ::close(fd);
+            return;
+        }
+        int clock = CLOCK_MONOTONIC;
+        m_inputs.push_back({ fd, ioctl(fd, EVIOCSCLOCKID, &clock) == 0 });
+    };
+    if (!settings.device.empty()) open(settings.device);
+    else if (DIR* dir = opendir("/dev/input")) {
+        while (const dirent* entry = readdir(dir))
+            if (std::string(entry->d_name).rfind("event", 0) == 0) open(std::string("/dev/input/") + entry->d_name);
+        closedir(dir);
+    }
+    if (m_inputs.empty()) {
+        qWarning() << "[EStopService] no readable input device has key" << settings.key << "; toolbar stop only";
+        return false;
+    }
+    if (pipe2(m_wakeFds, O_CLOEXEC) != 0) {
+        stop();
+        return false;
+    }
+
+    m_running.store(true, std::memory_order_relaxed);
+    m_thread = std::thread(&EStopService::run, this);
+    qDebug() << "[EStopService] watching key" << settings.key << "on" << int(m_inputs.size()) << "input device(s)";
+    return true;
+}
+
+void EStopService::stop()
+{
+    m_running.store(false, std::memory_order_relaxed);
+    if (m_wakeFds[1] >= 0) {
+        const char byte = 0;
+        (void)!write(m_wakeFds[1], &byte, 1);
+    }
+    if (m_thread.joinable()) m_thread.join();
+    for (const Input& input : m_inputs) ::close(input.fd);
+    m_inputs.clear();
+    for (int& fd : m_wakeFds) {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+}
+
+void EStopService::run()
+{
+    raisePriority(m_settings);
+    TraceZones::setThreadName("e-stop");
+
+    std::vector<pollfd> fds;
+    for (const Input& input : m_inputs) fds.push_back({ input.fd, POLLIN, 0 });
+    fds.push_back({ m_wakeFds[0], POLLIN, 0 });
+
+    input_event events[16];
+    while (m_running.load(std::memory_order_relaxed)) {
+        if (poll(fds.data(), nfds_t(fds.size()), -1) < 0) {
+            if (errno == EINTR) continue;
+            qWarning() << "[EStopService] poll failed; toolbar stop only";
+            return;
+        }
+        for (std::size_t i = 0; i < m_inputs.size(); ++i) {
+            if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) fds[i].fd = -1;   // unplugged: poll skips it
+            if (!(fds[i].revents & POLLIN)) continue;
+            ssize_t bytes;
+            while ((bytes = read(fds[i].fd, events, sizeof(events))) > 0) {
+                for (std::size_t e = 0; e < std::size_t(bytes) / sizeof(input_event); ++e) {
+                    const input_event& event = events[e];
+                    if (event.type != EV_KEY || int(event.code) != m_settings.key || event.value != 1) continue;
+                    trip(m_inputs[i].monotonic
+                        ? Clock::time_point(std::chrono::duration_cast<Clock::duration>(
+                            std::chrono::seconds(event.input_event_sec) + std::chrono::microseconds(event.input_event_usec)))
+                        : Clock::now());
+                }
+            }
+        }
+    }
+}
+
+#elif defined(_WIN32)
+
+bool EStopService::start(const Settings& settings)
+{
+    stop();
+    m_settings = settings;
+    std::promise<bool> registered;
+    std::future<bool> result = registered.get_future();
+    m_running.store(true, std::memory_order_relaxed);
+    m_thread = std::thread([this, &registered] {
+        m_threadId.store(GetCurrentThreadId(), std::memory_order_relaxed);
+        const bool ok = RegisterHotKey(nullptr, 1, MOD_NOREPEAT, UINT(m_settings.key)) != 0;
+        registered.set_value(ok);
+        if (!ok) return;
+        run();
+        UnregisterHotKey(nullptr, 1);
+        });
+    if (result.get()) {
+        qDebug() << "[EStopService] watching hotkey" << settings.key;
+        return true;
+    }
+    qWarning() << "[EStopService] could not register hotkey" << settings.key << "; toolbar stop only";
+    stop();
+    return false;
+}
+
+void EStopService::stop()
+{
+    m_running.store(false, std::memory_order_relaxed);
+    if (const DWORD id = DWORD(m_threadId.exchange(0))) PostThreadMessage(id, WM_QUIT, 0, 0);
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void EStopService::run()
+{
+    raisePriority(m_settings);
+    TraceZones::setThreadName("e-stop");
+
+    // This thread's own message queue; Qt's is never involved.
+    MSG message;
+    while (m_running.load(std::memory_order_relaxed) && GetMessage(&message, nullptr, 0, 0) > 0)
+        if (message.message == WM_HOTKEY) trip();
+}
+
+#else
+
+bool EStopService::start(const Settings& settings)
+{
+    m_settings = settings;
+    qWarning() << "[EStopService] no stop input on this platform; toolbar stop only";
+    return false;
+}
+
+void EStopService::stop() {}
+void EStopService::run() {}
+
+#endif
@@ -0,0 +1,287 @@
+#include "EffectorBuffers.hpp"
+#include "GpuMemory.hpp"
+#include "MeshCache.hpp"
+#include "components.hpp"
+#include "TriangleBvh.hpp"
+#include "PointCloudGrid.hpp"
+#include "RenderStats.hpp"
+
+#include <QOpenGLFunctions_4_3_Core>
+#include <entt/entt.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr GLsizeiptr kHeaderBytes = sizeof(glm::uvec4);
+
+template <typename T>
+bool sameContents(const std::vector<T>& a, const std::vector<T>& b)
+{
+    return a.size() == b.size()
+        && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+}
+
+bool EffectorBuffers::update(entt::registry& registry)
+{
+    if (!m_gl) return false;
+
+    // --- Point effectors and spline proxies ---
+    m_pointScratch.clear();
+    auto pointView = registry.view<PointEffectorComponent, TransformComponent>();
+    for (auto entity : pointView) {
+        auto& comp = pointView.get<PointEffectorComponent>(entity);
+        auto& xf = pointView.get<TransformComponent>(entity);
+        PointEffectorGpu effector{};
+        effector.position = glm::vec4(xf.translation, 1.0f);
+        effector.normal = glm::vec4(0.0f);
+        effector.strength = comp.strength;
+        effector.radius = comp.radius;
+        effector.falloffType = static_cast<int>(comp.falloff);
+        m_pointScratch.push_back(effector);
+    }
+    auto splineView = registry.view<SplineEffectorComponent, SplineComponent>();
+    for (auto entity : splineView) {
+        auto& comp = splineView.get<SplineEffectorComponent>(entity);
+        auto& spline = splineView.get<SplineComponent>(entity);
+        const std::vector<glm::vec3>& vertices = spline.cachedVertices();
+        if (vertices.empty()) continue;
+        for (size_t i = 0; i < vertices.size() - 1; ++i) {
+            glm::vec3 tangent = glm::normalize(vertices[i + 1] - vertices[i]);
+            glm::vec3 normal = glm::normalize(glm::cross(tangent, glm::vec3(0, 1, 0)));
+            if (comp.direction == SplineEffectorComponent::ForceDirection::Tangent) {
+                normal = tangent;
+            }
+            PointEffectorGpu effector{};
+            effector.position = glm::vec4(vertices[i], 1.0f);
+            effector.normal = glm::vec4(normal, 0.0f);
+            effector.strength = comp.strength;
+            effector.radius = comp.radius;
+            effector.falloffType = 1;
+            m_pointScratch.push_back(effector);
+        }
+    }
+
+    // --- Directional effectors ---
+    m_directionalScratch.clear();
+    auto dirView = registry.view<DirectionalEffectorComponent>();
+    for (auto entity : dirView) {
+        auto& comp = dirView.get<DirectionalEffectorComponent>(entity);
+        DirectionalEffectorGpu effector{};
+        effector.direction = glm::vec4(glm::normalize(comp.direction), 0.0f);
+        effector.strength = comp.strength;
+        m_directionalScratch.push_back(effector);
+    }
+
+    // --- Mesh effectors: re-triangulate only the ones that changed ---
+    bool trianglesDirty = false;
+    for (auto& [entity, cache] : m_meshCache) cache.seen = false;
+
+    auto meshView = registry.view<MeshEffectorComponent, RenderableMeshComponent, TransformComponent>();
+    for (auto entity : meshView) {
+        auto& comp = meshView.get<MeshEffectorComponent>(entity);
+        auto& mesh = meshView.get<RenderableMeshComponent>(entity);
+        const auto& xf = meshView.get<TransformComponent>(entity);
+
+        MeshEffectorCache& cache = m_meshCache[entity];
+        cache.seen = true;
+        const std::size_t meshKey = mesh.mesh ? MeshCache::keyOf(*mesh.mesh) : 0;
+        if (cache.transformVersion == xf.version() && cache.strength == comp.strength && cache.distance == comp.distance
+            && cache.meshKey == meshKey)
+            continue;
+
+        cache.transformVersion = xf.version();
+        const glm::mat4 model = xf.getTransform();
+        cache.strength = comp.strength;
+        cache.distance = comp.distance;
+        cache.meshKey = meshKey;
+        cache.triangles.clear();
+        cache.triangles.reserve(mesh.indices().size() / 3);
+        for (size_t i = 0; i + 2 < mesh.indices().size(); i += 3) {
+            TriangleGpu tri{};
+            tri.v0 = model * glm::vec4(mesh.vertices()[mesh.indices()[i]].position, 1.0f);
+            tri.v1 = model * glm::vec4(mesh.vertices()[mesh.indices()[i + 1]].position, 1.0f);
+            tri.v2 = model * glm::vec4(mesh.vertices()[mesh.indices()[i + 2]].position, 1.0f);
+            tri.v0.w = comp.strength;
+            tri.normal.w = comp.distance;
+            cache.triangles.push_back(tri);
+        }
+        trianglesDirty = true;
+    }
+    for (auto it = m_meshCache.begin(); it != m_meshCache.end();) {
+        if (!it->second.seen) { it = m_meshCache.erase(it); trianglesDirty = true; }
+        else ++it;
+    }
+
+    // --- Point-cloud effectors: grids are cached per octree and radius ---
+    m_cloudScratch.clear();
+    m_cloudGridScratch.clear();
+    std::uint32_t firstBucket = 0, firstPoint = 0;
+    auto cloudView = registry.view<PointCloudEffectorComponent, PointCloudComponent, TransformComponent>();
+    for (auto entity : cloudView) {
+        auto& comp = cloudView.get<PointCloudEffectorComponent>(entity);
+        auto& cloud = cloudView.get<PointCloudComponent>(entity);
+        if (!cloud.octree || comp.distance <= 0.0f) continue;
+        const glm::mat4 model = cloudView.get<TransformComponent>(entity).getTransform();
+        const float scale = glm::length(glm::vec3(model[0]));
+        auto grid = PointCloudGrid::shared(cloud.octree, comp.distance / std::max(scale, 1e-6f));
+        PointCloudEffectorGpu effector{};
+        effector.worldToCloud = glm::inverse(model);
+        effector.strength = comp.strength;
+        effector.radius = grid->radius();
+        effector.cellSize = grid->cellSize();
+        effector.bucketMask = grid->bucketMask();
+        effector.firstBucket = firstBucket;
+        effector.firstPoint = firstPoint;
+        firstBucket += static_cast<std::uint32_t>(grid->bucketStart().size());
+        firstPoint += static_cast<std::uint32_t>(grid->points().size());
+        m_cloudScratch.push_back(effector);
+        m_cloudGridScratch.push_back(std::move(grid));
+    }
+
+    // --- Upload what changed ---
+    const bool firstUpload = m_pointStream.current < 0;
+    bool changed = false;
+
+    if (firstUpload || !sameContents(m_pointScratch, m_points)) {
+        m_points.swap(m_pointScratch);
+        upload(m_pointStream, m_points.data(), m_points.size(), sizeof(PointEffectorGpu));
+        changed = true;
+    }
+    if (firstUpload || !sameContents(m_directionalScratch, m_directionals)) {
+        m_directionals.swap(m_directionalScratch);
+        upload(m_directionalStream, m_directionals.data(), m_directionals.size(), sizeof(DirectionalEffectorGpu));
+        changed = true;
+    }
+    if (firstUpload || trianglesDirty) {
+        m_triangles.clear();
+        for (auto& [entity, cache] : m_meshCache)
+            m_triangles.insert(m_triangles.end(), cache.triangles.begin(), cache.triangles.end());
+        TriangleBvh::build(m_triangles, m_bvhNodes);
+        upload(m_triangleStream, m_triangles.data(), m_triangles.size(), sizeof(TriangleGpu));
+        upload(m_bvhStream, m_bvhNodes.data(), m_bvhNodes.size(), sizeof(BvhNodeGpu));
+        changed = true;
+    }
+    if (firstUpload || m_cloudGridScratch != m_cloudGrids) {
+        m_cloudGrids.swap(m_cloudGridScratch);
+        m_cloudBuckets.clear();
+        m_cloudPoints.clear();
+        for (const auto& grid : m_cloudGrids) {
+            m_cloudBuckets.insert(m_cloudBuckets.end(), grid->bucketStart().begin(), grid->bucketStart().end());
+            m_cloudPoints.insert(m_cloudPoints.end(), grid->points().begin(), grid->points().end());
+        }
+        upload(m_cloudBucketStream, m_cloudBuckets.data(), m_cloudBuckets.size(), sizeof(std::uint32_t));
+        upload(m_cloudPointStream, m_cloudPoints.data(), m_cloudPoints.size(), sizeof(glm::vec4));
+        changed = true;
+    }
+    if (firstUpload || !sameContents(m_cloudScratch, m_clouds)) {
+        m_clouds.swap(m_cloudScratch);
+        upload(m_cloudStream, m_clouds.data(), m_clouds.size(), sizeof(PointCloudEffectorGpu));
+        changed = true;
+    }
+
+    if (changed) ++m_version;
+    return changed;
+}
+
+void EffectorBuffers::upload(Stream& stream, const void* items, std::size_t count, std::size_t itemSize)
+{
+    const int slot = (stream.current + 1) % kRingSize;
+    const GLsizeiptr bytes = kHeaderBytes + GLsizeiptr(count * itemSize);
+
+    // The slot was last read kRingSize-1 uploads ago, so its fence has
+    // normally passed. If not (several changes in one frame), the slot gets
+    // fresh storage below; the driver keeps the old one for the reads in flight.
+    bool busy = false;
+    if (GLsync fence = stream.fences[slot]) {
+        busy = m_gl->glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED;
+        m_gl->glDeleteSync(fence);
+        stream.fences[slot] = nullptr;
+    }
+
+    if (stream.buffers[slot] == 0) m_gl->glGenBuffers(1, &stream.buffers[slot]);
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, stream.buffers[slot]);
+    if (bytes > stream.capacity[slot] || busy) {
+        // Grow geometrically so a slowly growing effector set does not reallocate every change.
+        GLsizeiptr capacity = std::max<GLsizeiptr>(stream.capacity[slot], 4096);
+        while (capacity < bytes) capacity *= 2;
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, stream.buffers[slot], capacity, nullptr, GL_DYNAMIC_DRAW,
+            GpuMemory::Category::Effectors);
+        stream.capacity[slot] = capacity;
+    }
+
+    if (void* dst = m_gl->glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, bytes,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT)) {
+        const glm::uvec4 header(static_cast<GLuint>(count), 0u, 0u, 0u);
+        std::memcpy(dst, &header, sizeof(header));
+        if (count > 0)
+            std::memcpy(static_cast<char*>(dst) + kHeaderBytes, items, count * itemSize);
+        m_gl->glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        RenderStats::upload(std::uint64_t(bytes));
+    }
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    stream.current = slot;
+}
+
+void EffectorBuffers::bind() const
+{
+    if (!m_gl || m_pointStream.current < 0) return;
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPointEffectorBinding,
+        m_pointStream.buffers[m_pointStream.current]);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kDirectionalEffectorBinding,
+        m_directionalStream.buffers[m_directionalStream.current]);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kTriangleEffectorBinding,
+        m_triangleStream.buffers[m_triangleStream.current]);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kTriangleBvhBinding,
+        m_bvhStream.buffers[m_bvhStream.current]);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPointCloudEffectorBinding,
+        m_cloudStream.buffers[m_cloudStream.current]);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPointCloudBucketBinding,
+        m_cloudBucketStream.buffers[m_cloudBucketStream.current]);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPointCloudPointBinding,
+        m_cloudPointStream.buffers[m_cloudPointStream.current]);
+}
+
+void EffectorBuffers::fenceInFlight()
+{
+    if (!m_gl) return;
+    for (Stream* s : { &m_pointStream, &m_directionalStream, &m_triangleStream, &m_bvhStream,
+                       &m_cloudStream, &m_cloudBucketStream, &m_cloudPointStream }) {
+        if (s->current < 0) continue;
+        GLsync& fence = s->fences[s->current];
+        if (fence) m_gl->glDeleteSync(fence);
+        fence = m_gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+void EffectorBuffers::destroyStream(Stream& stream)
+{
+    for (int i = 0; i < kRingSize; ++i) {
+        if (stream.fences[i]) m_gl->glDeleteSync(stream.fences[i]);
+        if (stream.buffers[i]) GpuMemory::deleteBuffers(m_gl, 1, &stream.buffers[i]);
+    }
+    stream = Stream{};
+}
+
+void EffectorBuffers::destroy()
+{
+    if (m_gl) {
+        destroyStream(m_pointStream);
+        destroyStream(m_directionalStream);
+        destroyStream(m_triangleStream);
+        destroyStream(m_bvhStream);
+        destroyStream(m_cloudStream);
+        destroyStream(m_cloudBucketStream);
+        destroyStream(m_cloudPointStream);
+    }
+    m_points.clear();
+    m_directionals.clear();
+    m_triangles.clear();
+    m_bvhNodes.clear();
+    m_meshCache.clear();
+    m_clouds.clear();
+    m_cloudGrids.clear();
+    m_cloudBuckets.clear();
+    m_cloudPoints.clear();
+}
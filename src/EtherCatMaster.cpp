@@ -0,0 +1,294 @@
+#include "EtherCatMaster.hpp"
+
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+extern "C" {
+#include <ethercat.h>
+}
+
+namespace {
+constexpr std::size_t kImageBytes = 1 << 16;
+
+// CiA 402 modes of operation.
+constexpr std::int8_t kCyclicPosition = 8, kCyclicVelocity = 9, kCyclicTorque = 10;
+
+template<class T>
+T saturate(double value)
+{
+    return T(std::clamp(std::lround(value), long(std::numeric_limits<T>::min()), long(std::numeric_limits<T>::max())));
+}
+
+template<class T>
+bool sdo(std::uint16_t slave, std::uint16_t index, std::uint8_t sub, T value)
+{
+    return ec_SDOwrite(slave, index, sub, FALSE, int(sizeof(T)), &value, EC_TIMEOUTRXM) > 0;
+}
+
+// PRE-OP -> SAFE-OP hook: the fixed Rx/Tx mapping of EtherCatMaster.
+int mapDrive(std::uint16_t slave)
+{
+    static const std::uint32_t rx[] = { 0x60400010, 0x60600008, 0x607A0020, 0x60FF0020, 0x60710010 };
+    static const std::uint32_t tx[] = { 0x60410010, 0x60610008, 0x60640020, 0x606C0020, 0x60770010 };
+    bool ok = sdo<std::uint8_t>(slave, 0x1C12, 0, 0) && sdo<std::uint8_t>(slave, 0x1C13, 0, 0)
+        && sdo<std::uint8_t>(slave, 0x1600, 0, 0) && sdo<std::uint8_t>(slave, 0x1A00, 0, 0);
+    for (std::uint8_t i = 0; ok && i < 5; ++i)
+        ok = sdo(slave, 0x1600, std::uint8_t(i + 1), rx[i]) && sdo(slave, 0x1A00, std::uint8_t(i + 1), tx[i]);
+    ok = ok && sdo<std::uint8_t>(slave, 0x1600, 0, 5) && sdo<std::uint8_t>(slave, 0x1A00, 0, 5)
+        && sdo<std::uint16_t>(slave, 0x1C12, 1, 0x1600) && sdo<std::uint8_t>(slave, 0x1C12, 0, 1)
+        && sdo<std::uint16_t>(slave, 0x1C13, 1, 0x1A00) && sdo<std::uint8_t>(slave, 0x1C13, 0, 1);
+    if (!ok) qWarning() << "[EtherCatMaster] could not map the PDOs of slave" << slave;
+    return ok ? 1 : 0;
+}
+}
+
+// --- CommandWriter and TelemetryReader over one master ---
+
+class EtherCatMaster::Writer : public CommandWriter
+{
+public:
+    explicit Writer(std::shared_ptr<EtherCatMaster> master) : m_master(std::move(master)) {}
+
+    bool open(const std::vector<Endpoint>& endpoints) override
+    {
+        std::vector<int> slaves;
+        for (const Endpoint& endpoint : endpoints) slaves.push_back(int(endpoint.controllerId));
+        return m_master->open(slaves);
+    }
+    void write(const JointCommand* commands, std::size_t count) override { m_master->exchange(commands, count); }
+    void close() override { m_master->close(); }
+    std::chrono::nanoseconds deadlineCorrection() override { return m_master->dcCorrection(); }
+
+private:
+    std::shared_ptr<EtherCatMaster> m_master;
+};
+
+class EtherCatMaster::Reader : public TelemetryReader
+{
+public:
+    explicit Reader(std::shared_ptr<EtherCatMaster> master) : m_master(std::move(master)) {}
+
+    bool open(const std::vector<Endpoint>& endpoints) override
+    {
+        // Bus position -> this reader's channel.
+        for (std::size_t i = 0; i < endpoints.size(); ++i) {
+            const std::size_t slave = endpoints[i].controllerId;
+            if (slave >= m_channelOf.size()) m_channelOf.resize(slave + 1, -1);
+            m_channelOf[slave] = int(i);
+        }
+        m_master->m_readerAttached.store(true, std::memory_order_release);
+        return true;
+    }
+
+    std::size_t read(JointSample* out, std::size_t max, std::chrono::milliseconds timeout) override
+    {
+        const auto until = std::chrono::steady_clock::now() + timeout;
+        std::size_t n = 0;
+        for (;;) {
+            JointSample sample;
+            while (n < max && m_master->m_samples.pop(sample)) {
+                const std::size_t slave = sample.channel;
+                if (slave >= m_channelOf.size() || m_channelOf[slave] < 0) continue;
+                sample.channel = std::uint32_t(m_channelOf[slave]);
+                out[n++] = sample;
+            }
+            if (n || std::chrono::steady_clock::now() >= until) return n;
+            std::this_thread::sleep_for(std::chrono::microseconds(250));   // a few cycles at 4 kHz
+        }
+    }
+
+    void close() override { m_master->m_readerAttached.store(false, std::memory_order_release); }
+
+private:
+    std::shared_ptr<EtherCatMaster> m_master;
+    std::vector<int> m_channelOf;
+};
+
+std::shared_ptr<EtherCatMaster> EtherCatMaster::install(JointCommandLoop& loop, TelemetryHub& hub, const Settings& settings)
+{
+    auto master = std::make_shared<EtherCatMaster>(loop, settings);
+    loop.registerWriter(CommunicationProtocol::ETHERCAT, [master]() { return std::make_unique<Writer>(master); });
+    hub.registerReader(CommunicationProtocol::ETHERCAT, [master]() { return std::make_unique<Reader>(master); });
+    return master;
+}
+
+// --- Bus bring-up ---
+
+bool EtherCatMaster::open(const std::vector<int>& slaves)
+{
+    close();
+    if (!ec_init(m_settings.interfaceName.c_str())) {
+        qWarning() << "[EtherCatMaster] cannot open" << QString::fromStdString(m_settings.interfaceName)
+                   << "(raw sockets need CAP_NET_RAW)";
+        return false;
+    }
+    m_open = true;
+    if (ec_config_init(FALSE) <= 0) {
+        qWarning() << "[EtherCatMaster] no slaves on" << QString::fromStdString(m_settings.interfaceName);
+        close();
+        return false;
+    }
+    m_slaves.store(ec_slavecount, std::memory_order_relaxed);
+
+    m_drives.clear();
+    for (const int slave : slaves) {
+        if (slave < 1 || slave > ec_slavecount) {
+            qWarning() << "[EtherCatMaster] no slave at bus position" << slave << "of" << ec_slavecount;
+            close();
+            return false;
+        }
+        ec_slave[slave].PO2SOconfig = &mapDrive;
+        m_drives.push_back({ slave });
+    }
+
+    m_image.assign(kImageBytes, 0);
+    if (ec_config_map(m_image.data()) > int(kImageBytes)) {
+        qWarning() << "[EtherCatMaster] process image larger than" << int(kImageBytes) << "bytes";
+        close();
+        return false;
+    }
+    for (const Drive& drive : m_drives)
+        if (ec_slave[drive.slave].Obytes < sizeof(Rx) || ec_slave[drive.slave].Ibytes < sizeof(Tx)) {
+            qWarning() << "[EtherCatMaster] slave" << drive.slave << "did not take the CiA 402 mapping";
+            close();
+            return false;
+        }
+
+    m_cycleNs = std::int64_t(std::llround(1e9 / std::clamp(m_loop.settings().rateHz, 1.0, 10000.0)));
+    m_dcIntegral = 0;
+    m_correctionNs = 0;
+    if (m_settings.distributedClocks && ec_configdc())
+        for (const Drive& drive : m_drives)
+            ec_dcsync0(std::uint16_t(drive.slave), TRUE, std::uint32_t(m_cycleNs),
+                std::int32_t(std::chrono::nanoseconds(m_settings.syncShift).count()));
+    ec_statecheck(0, EC_STATE_SAFE_OP, EC_TIMEOUTSTATE * 4);
+    m_expectedWkc.store(ec_group[0].outputsWKC * 2 + ec_group[0].inputsWKC, std::memory_order_relaxed);
+
+    // Frames must flow while the slaves go to OP, or their watchdogs hold them in SAFE-OP.
+    ec_slave[0].state = EC_STATE_OPERATIONAL;
+    ec_send_processdata();
+    ec_receive_processdata(EC_TIMEOUTRET);
+    ec_writestate(0);
+    for (int attempt = 0; attempt < 200 && ec_slave[0].state != EC_STATE_OPERATIONAL; ++attempt) {
+        ec_send_processdata();
+        ec_receive_processdata(EC_TIMEOUTRET);
+        ec_statecheck(0, EC_STATE_OPERATIONAL, 10000);
+    }
+    if (ec_slave[0].state != EC_STATE_OPERATIONAL) {
+        ec_readstate();
+        for (int s = 1; s <= ec_slavecount; ++s)
+            if (ec_slave[s].state != EC_STATE_OPERATIONAL)
+                qWarning() << "[EtherCatMaster] slave" << s << "stuck in state" << Qt::hex << ec_slave[s].state
+                           << "AL status" << ec_ALstatuscode2string(ec_slave[s].ALstatuscode);
+        close();
+        return false;
+    }
+    m_operational.store(true, std::memory_order_release);
+    qDebug() << "[EtherCatMaster]" << ec_slavecount << "slaves in OP on" << QString::fromStdString(m_settings.interfaceName)
+             << "cycle" << m_cycleNs / 1000 << "us" << (ec_slave[0].hasdc ? "with DC" : "without DC");
+    return true;
+}
+
+void EtherCatMaster::close()
+{
+    if (!m_open) return;
+    m_operational.store(false, std::memory_order_release);
+    ec_slave[0].state = EC_STATE_INIT;
+    ec_writestate(0);
+    ec_close();
+    m_open = false;
+    m_drives.clear();
+}
+
+// --- Cyclic exchange: the command thread ---
+
+void EtherCatMaster::exchange(const JointCommand* commands, std::size_t count)
+{
+    if (!m_operational.load(std::memory_order_relaxed)) return;
+    count = std::min(count, m_drives.size());
+    const double scale = m_settings.countsPerUnit;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        Drive& drive = m_drives[i];
+        Tx in;
+        std::memcpy(&in, ec_slave[drive.slave].inputs, sizeof(in));   // last cycle's inputs
+
+        const JointCommand& command = commands[i];
+        const std::int8_t mode = command.mode == ControlMode::POSITION ? kCyclicPosition
+            : command.mode == ControlMode::VELOCITY ? kCyclicVelocity
+            : command.mode == ControlMode::TORQUE ? kCyclicTorque : 0;   // others: power stage off
+
+        // CiA 402 state machine, one transition per cycle.
+        const std::uint16_t state = in.statusword & 0x006F;
+        std::uint16_t controlword = 0x0006;                                  // shutdown: ready to switch on
+        if (in.statusword & 0x0008) controlword = drive.lastControlword & 0x0080 ? 0x0000 : 0x0080;   // fault reset edge
+        else if (mode && state == 0x0021) controlword = 0x0007;            // switch on
+        else if (mode && (state == 0x0023 || state == 0x0027)) controlword = 0x000F;   // enable operation
+        drive.lastControlword = controlword;
+
+        // Until enabled, hold where the drive is so enabling does not jump.
+        Rx out{ controlword, mode ? mode : in.mode, in.position, 0, 0 };
+        if (mode && state == 0x0027) {
+            if (mode == kCyclicPosition) out.targetPosition = saturate<std::int32_t>(command.setpoint * scale);
+            if (mode == kCyclicVelocity) out.targetVelocity = saturate<std::int32_t>(command.setpoint * scale);
+            if (mode == kCyclicTorque)
+                out.targetTorque = saturate<std::int16_t>((command.setpoint + command.feedForward) / m_settings.ratedTorqueNm * 1000.0);
+        }
+        std::memcpy(ec_slave[drive.slave].outputs, &out, sizeof(out));
+    }
+
+    ec_send_processdata();
+    const int wkc = ec_receive_processdata(EC_TIMEOUTRET);
+    m_cycles.fetch_add(1, std::memory_order_relaxed);
+    m_lastWkc.store(wkc, std::memory_order_relaxed);
+    const bool complete = wkc >= m_expectedWkc.load(std::memory_order_relaxed);
+    if (!complete) m_missed.fetch_add(1, std::memory_order_relaxed);
+
+    if (complete && m_readerAttached.load(std::memory_order_acquire)) {
+        const std::int64_t now = TelemetryHub::nowNs();
+        for (std::size_t i = 0; i < count; ++i) {
+            Tx in;
+            std::memcpy(&in, ec_slave[m_drives[i].slave].inputs, sizeof(in));
+            const std::uint32_t slave = std::uint32_t(m_drives[i].slave);
+            // A full ring drops samples; the reader is behind and only the newest matter.
+            m_samples.push({ now, slave, JointSample::Quantity::Position, double(in.position) / scale });
+            m_samples.push({ now, slave, JointSample::Quantity::Velocity, double(in.velocity) / scale });
+            m_samples.push({ now, slave, JointSample::Quantity::Effort, double(in.torque) * 0.001 * m_settings.ratedTorqueNm });
+        }
+    }
+
+    // Distributed clocks: nudge the next deadline so that cycles start a
+    // fixed 'syncShift' before SYNC0 (the PI loop of SOEM's examples).
+    if (m_settings.distributedClocks && ec_slave[0].hasdc) {
+        const std::int64_t shift = std::chrono::nanoseconds(m_settings.syncShift).count();
+        std::int64_t delta = (std::int64_t(ec_DCtime) - shift) % m_cycleNs;
+        if (delta > m_cycleNs / 2) delta -= m_cycleNs;
+        m_dcIntegral += delta > 0 ? 1 : delta < 0 ? -1 : 0;
+        m_correctionNs = -(delta / 100) - (m_dcIntegral / 20);
+        m_dcErrorNs.store(delta, std::memory_order_relaxed);
+    }
+}
+
+std::chrono::nanoseconds EtherCatMaster::dcCorrection()
+{
+    const std::int64_t correction = m_correctionNs;
+    m_correctionNs = 0;
+    return std::chrono::nanoseconds(correction);
+}
+
+EtherCatMaster::Stats EtherCatMaster::stats() const
+{
+    Stats s;
+    s.slaves = m_slaves.load(std::memory_order_relaxed);
+    s.operational = m_operational.load(std::memory_order_acquire);
+    s.cycles = m_cycles.load(std::memory_order_relaxed);
+    s.missedFrames = m_missed.load(std::memory_order_relaxed);
+    s.lastWkc = m_lastWkc.load(std::memory_order_relaxed);
+    s.expectedWkc = m_expectedWkc.load(std::memory_order_relaxed);
+    s.dcErrorUs = double(m_dcErrorNs.load(std::memory_order_relaxed)) * 1e-3;
+    return s;
+}
@@ -0,0 +1,381 @@
+#include "EventLog.hpp"
+#include "TraceZones.hpp"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QString>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    constexpr std::chrono::milliseconds kWriteInterval{ 100 };
+    constexpr std::uint32_t kPadding = 0;                   ///< a zero size: the rest of the ring is unused
+
+    std::size_t align8(std::size_t n) { return (n + 7) & ~std::size_t(7); }
+
+    // One producer (its thread) and one consumer (the writer). Records are
+    // 8-aligned and never wrap; one that would is preceded by kPadding.
+    struct ThreadRing {
+        std::unique_ptr<unsigned char[]> bytes = std::make_unique<unsigned char[]>(EventLog::kRingBytes);
+        std::atomic<std::uint64_t> head{ 0 };               ///< bytes ever written
+        std::atomic<std::uint64_t> tail{ 0 };               ///< bytes ever consumed
+        std::atomic<std::uint64_t> dropped{ 0 };
+        std::uint16_t thread = 0;
+
+        // Producer-only id caches, so only a first sighting takes the lock.
+        std::unordered_map<const char*, std::uint32_t> categories;
+        std::map<std::pair<const char*, int>, std::uint32_t> sites;
+    };
+
+    struct Definition {
+        EventLog::Defines what;
+        std::uint32_t id;
+        std::string text;
+    };
+
+    struct State {
+        std::mutex mutex;                                   ///< rings, definitions, ids
+        std::vector<std::shared_ptr<ThreadRing>> rings;     ///< outlive their threads
+        std::vector<Definition> definitions;
+        std::map<std::string, std::uint32_t> categoryIds, siteIds;
+
+        std::atomic<bool> running{ false };
+        bool stopping = false;                              ///< under wakeMutex
+        std::thread writer;
+        std::mutex wakeMutex;
+        std::condition_variable wake, flushed;
+        std::uint64_t flushRequested = 0, flushDone = 0;    ///< under wakeMutex
+
+        // Writer thread only, once started.
+        std::FILE* file = nullptr;
+        std::int64_t fileBytes = 0;
+        std::size_t definitionsWritten = 0;
+        QString directory;
+        bool echoAll = false;
+    };
+
+    State& state()
+    {
+        static State s;
+        return s;
+    }
+
+    std::int64_t nowNs()
+    {
+        using namespace std::chrono;
+        static const steady_clock::time_point epoch = steady_clock::now();
+        return duration_cast<nanoseconds>(steady_clock::now() - epoch).count();
+    }
+
+    ThreadRing& threadRing()
+    {
+        thread_local std::shared_ptr<ThreadRing> ring = [] {
+            auto r = std::make_shared<ThreadRing>();
+            State& s = state();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            r->thread = std::uint16_t(s.rings.size());
+            s.rings.push_back(r);
+            return r;
+        }();
+        return *ring;
+    }
+
+    std::uint32_t intern(std::map<std::string, std::uint32_t>& ids, EventLog::Defines what, std::string text)
+    {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto [it, added] = ids.emplace(std::move(text), std::uint32_t(ids.size()));
+        if (added) s.definitions.push_back({ what, it->second, it->first });
+        return it->second;
+    }
+
+    const char* levelName(int level)
+    {
+        switch (level) {
+        case QtDebugMsg:    return "Debug";
+        case QtInfoMsg:     return "Info";
+        case QtWarningMsg:  return "Warning";
+        case QtCriticalMsg: return "Critical";
+        default:            return "Fatal";
+        }
+    }
+
+    // The old synchronous path, for messages outside start() / stop().
+    void writeStderr(QtMsgType type, const QMessageLogContext& context, const QString& text)
+    {
+        const QByteArray local = text.toLocal8Bit();
+        std::fprintf(stderr, "%s: %s (%s:%u, %s)\n", levelName(type), local.constData(),
+            context.file ? context.file : "", context.line, context.function ? context.function : "");
+        if (type != QtDebugMsg && type != QtInfoMsg) std::fflush(stderr);
+    }
+
+    QString pathOf(const QString& directory, int generation)
+    {
+        return generation == 0 ? directory + '/' + QString::fromLatin1(EventLog::kFileName)
+                               : directory + QStringLiteral("/events.%1.krlog").arg(generation);
+    }
+
+    void writeBytes(State& s, const void* data, std::size_t size)
+    {
+        if (std::fwrite(data, 1, size, s.file) == size) s.fileBytes += std::int64_t(size);
+    }
+
+    void writeDefinition(State& s, const Definition& d)
+    {
+        EventLog::RecordHeader h{};
+        h.size = std::uint32_t(sizeof(h) + d.text.size());
+        h.kind = EventLog::Kind::Definition;
+        h.level = std::uint8_t(d.what);
+        h.category = d.id;
+        writeBytes(s, &h, sizeof(h));
+        writeBytes(s, d.text.data(), d.text.size());
+    }
+
+    // Shifts events.krlog to events.1.krlog and so on, and starts a new
+    // file that repeats the definitions written so far.
+    bool openFile(State& s, std::size_t definitions)
+    {
+        if (s.file) std::fclose(s.file);
+        s.file = nullptr;
+        QFile::remove(pathOf(s.directory, EventLog::kKeepFiles - 1));
+        for (int g = EventLog::kKeepFiles - 2; g >= 0; --g)
+            QFile::rename(pathOf(s.directory, g), pathOf(s.directory, g + 1));
+
+        s.file = std::fopen(QFile::encodeName(pathOf(s.directory, 0)).constData(), "wb");
+        if (!s.file) return false;
+        std::setvbuf(s.file, nullptr, _IOFBF, std::size_t(1) << 16);
+        s.fileBytes = 0;
+
+        EventLog::FileHeader header{};
+        std::memcpy(header.magic, EventLog::kMagic, sizeof(header.magic));
+        header.epochMs = QDateTime::currentMSecsSinceEpoch() - nowNs() / 1000000;
+        writeBytes(s, &header, sizeof(header));
+        std::lock_guard<std::mutex> lock(s.mutex);   // the vector may grow meanwhile
+        for (std::size_t i = 0; i < definitions; ++i) writeDefinition(s, s.definitions[i]);
+        s.definitionsWritten = definitions;
+        return true;
+    }
+
+    void echo(const EventLog::RecordHeader& h, const unsigned char* payload)
+    {
+        const QString text = QString::fromUtf16(reinterpret_cast<const char16_t*>(payload),
+            qsizetype((h.size - sizeof(h)) / 2));
+        std::fprintf(stderr, "%s: %s\n", levelName(h.level), text.toLocal8Bit().constData());
+    }
+
+    // One writer pass: records up to each ring's head as it was on entry,
+    // after every definition they can refer to.
+    void drain(State& s)
+    {
+        KR_ZONE("event log write");
+        std::vector<std::pair<std::shared_ptr<ThreadRing>, std::uint64_t>> rings;
+        std::size_t definitions;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            rings.reserve(s.rings.size());
+            for (const auto& ring : s.rings) rings.emplace_back(ring, ring->head.load(std::memory_order_acquire));
+            definitions = s.definitions.size();
+        }
+        if (s.file) {
+            std::lock_guard<std::mutex> lock(s.mutex);   // the vector may grow meanwhile
+            for (; s.definitionsWritten < definitions; ++s.definitionsWritten)
+                writeDefinition(s, s.definitions[s.definitionsWritten]);
+        }
+
+        bool echoed = false;
+        for (auto& [ring, head] : rings) {
+            std::uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+            while (tail != head) {
+                const std::size_t at = std::size_t(tail & (EventLog::kRingBytes - 1));
+                EventLog::RecordHeader h;
+                std::memcpy(&h.size, ring->bytes.get() + at, sizeof(h.size));
+                if (h.size == kPadding) {
+                    tail += EventLog::kRingBytes - at;
+                    continue;
+                }
+                std::memcpy(&h, ring->bytes.get() + at, sizeof(h));
+                if (s.fileBytes + h.size > EventLog::kMaxFileBytes) openFile(s, definitions);
+                if (s.file) writeBytes(s, ring->bytes.get() + at, h.size);
+                if (s.echoAll || (h.level != QtDebugMsg && h.level != QtInfoMsg)) {
+                    echo(h, ring->bytes.get() + at + sizeof(h));
+                    echoed = true;
+                }
+                tail += align8(h.size);
+            }
+            ring->tail.store(tail, std::memory_order_release);
+        }
+        if (s.file) std::fflush(s.file);
+        if (echoed) std::fflush(stderr);
+    }
+
+    void run()
+    {
+        TraceZones::setThreadName("event log");
+        State& s = state();
+        for (;;) {
+            std::uint64_t request;
+            bool last;
+            {
+                std::unique_lock<std::mutex> lock(s.wakeMutex);
+                s.wake.wait_for(lock, kWriteInterval, [&s]() { return s.stopping || s.flushRequested != s.flushDone; });
+                request = s.flushRequested;
+                last = s.stopping;
+            }
+            drain(s);
+            {
+                std::lock_guard<std::mutex> lock(s.wakeMutex);
+                s.flushDone = request;
+            }
+            s.flushed.notify_all();
+            if (last) return;
+        }
+    }
+}
+
+bool EventLog::start(const QString& directory, std::string* error)
+{
+    State& s = state();
+    if (s.running.load()) return true;
+    if (!QDir().mkpath(directory)) {
+        if (error) *error = "cannot create " + directory.toStdString();
+        return false;
+    }
+    s.directory = directory;
+    s.echoAll = qEnvironmentVariableIntValue("KR_LOG_STDERR") != 0;
+    std::size_t definitions;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        definitions = s.definitions.size();
+    }
+    if (!openFile(s, definitions)) {
+        if (error) *error = "cannot open " + pathOf(directory, 0).toStdString();
+        return false;
+    }
+    s.stopping = false;
+    s.running.store(true);
+    s.writer = std::thread(run);
+    return true;
+}
+
+void EventLog::stop()
+{
+    State& s = state();
+    if (!s.running.exchange(false)) return;
+    {
+        std::lock_guard<std::mutex> lock(s.wakeMutex);
+        s.stopping = true;
+    }
+    s.wake.notify_one();
+    s.writer.join();
+    std::fclose(s.file);
+    s.file = nullptr;
+}
+
+bool EventLog::running()
+{
+    return state().running.load(std::memory_order_relaxed);
+}
+
+void EventLog::flush()
+{
+    State& s = state();
+    if (!running()) return;
+    std::unique_lock<std::mutex> lock(s.wakeMutex);
+    const std::uint64_t request = ++s.flushRequested;
+    s.wake.notify_one();
+    s.flushed.wait(lock, [&s, request]() { return s.flushDone >= request || s.stopping; });
+}
+
+QString EventLog::currentPath()
+{
+    return pathOf(state().directory, 0);
+}
+
+std::uint64_t EventLog::droppedRecords()
+{
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    std::uint64_t dropped = 0;
+    for (const auto& ring : s.rings) dropped += ring->dropped.load(std::memory_order_relaxed);
+    return dropped;
+}
+
+void EventLog::message(QtMsgType type, const QMessageLogContext& context, const QString& text)
+{
+    if (!running()) {
+        writeStderr(type, context, text);
+        if (type == QtFatalMsg) std::abort();
+        return;
+    }
+
+    ThreadRing& ring = threadRing();
+    const char* category = context.category ? context.category : "default";
+    auto cat = ring.categories.find(category);
+    if (cat == ring.categories.end())
+        cat = ring.categories.emplace(category, intern(state().categoryIds, Defines::Category, category)).first;
+    const auto siteKey = std::make_pair(context.file, context.line);
+    auto site = ring.sites.find(siteKey);
+    if (site == ring.sites.end()) {
+        std::string where = context.function ? context.function : "";
+        if (context.file) where += " (" + std::string(context.file) + ':' + std::to_string(context.line) + ')';
+        site = ring.sites.emplace(siteKey, intern(state().siteIds, Defines::Site, std::move(where))).first;
+    }
+
+    const std::size_t chars = std::size_t(std::min<qsizetype>(text.size(), kMaxMessageChars));
+    RecordHeader h{};
+    h.size = std::uint32_t(sizeof(h) + chars * 2);
+    h.kind = Kind::Message;
+    h.level = std::uint8_t(type);
+    h.thread = ring.thread;
+    h.category = cat->second;
+    h.site = site->second;
+    h.timestampNs = nowNs();
+
+    const std::size_t need = align8(h.size);
+    std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+    const std::size_t at = std::size_t(head & (kRingBytes - 1));
+    const std::size_t pad = kRingBytes - at < need ? kRingBytes - at : 0;
+    const bool fits = head + pad + need - ring.tail.load(std::memory_order_acquire) <= kRingBytes;
+    if (!fits) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    else {
+        if (pad) {
+            std::memcpy(ring.bytes.get() + at, &kPadding, sizeof(kPadding));
+            head += pad;
+        }
+        unsigned char* out = ring.bytes.get() + (head & (kRingBytes - 1));
+        std::memcpy(out, &h, sizeof(h));
+        std::memcpy(out + sizeof(h), text.utf16(), chars * 2);
+        ring.head.store(head + need, std::memory_order_release);
+    }
+
+    // Worth a wake-up: a crash may follow. The writer echoes them to stderr.
+    if (type == QtCriticalMsg) {
+        State& s = state();
+        {
+            std::lock_guard<std::mutex> lock(s.wakeMutex);
+            ++s.flushRequested;
+        }
+        s.wake.notify_one();
+    }
+    else if (type == QtFatalMsg) {
+        flush();
+        if (!fits) writeStderr(type, context, text);
+        std::fflush(stderr);
+        std::abort();
+    }
+}
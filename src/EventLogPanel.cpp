@@ -0,0 +1,235 @@
+#include "EventLogPanel.hpp"
+#include "EventLog.hpp"
+
+#include <QAbstractTableModel>
+#include <QBrush>
+#include <QCheckBox>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QHash>
+#include <QHeaderView>
+#include <QLabel>
+#include <QScrollBar>
+#include <QTableView>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <cstring>
+#include <vector>
+
+// One row per message record of a mapped log file. Only record offsets are
+// kept; everything shown is decoded in data().
+class EventLogModel : public QAbstractTableModel
+{
+public:
+    enum Column { Time, Level, Thread, Category, Message, Site, ColumnCount };
+
+    using QAbstractTableModel::QAbstractTableModel;
+    ~EventLogModel() override { close(); }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : int(m_rows.size()); }
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : ColumnCount; }
+
+    QVariant data(const QModelIndex& index, int role) const override
+    {
+        if (!index.isValid() || !m_map) return {};
+        const uchar* record = m_map + m_rows[index.row()];
+        EventLog::RecordHeader h;
+        std::memcpy(&h, record, sizeof(h));
+
+        if (role == Qt::ForegroundRole) {
+            if (h.level == QtWarningMsg) return QBrush(QColor(230, 160, 40));
+            if (h.level == QtCriticalMsg || h.level == QtFatalMsg) return QBrush(QColor(230, 70, 60));
+            return {};
+        }
+        if (role != Qt::DisplayRole && role != Qt::ToolTipRole) return {};
+
+        switch (index.column()) {
+        case Time:
+            return QDateTime::fromMSecsSinceEpoch(m_epochMs + h.timestampNs / 1000000)
+                .toString(QStringLiteral("HH:mm:ss.zzz"));
+        case Level:
+            switch (h.level) {
+            case QtDebugMsg:    return QStringLiteral("debug");
+            case QtInfoMsg:     return QStringLiteral("info");
+            case QtWarningMsg:  return QStringLiteral("warning");
+            case QtCriticalMsg: return QStringLiteral("critical");
+            default:            return QStringLiteral("fatal");
+            }
+        case Thread:
+            return int(h.thread);
+        case Category:
+            return m_categories.value(h.category);
+        case Message: {
+            // Copied out: the payload is only 2-aligned by accident.
+            const qsizetype chars = qsizetype((h.size - sizeof(h)) / 2);
+            QString text(chars, Qt::Uninitialized);
+            std::memcpy(text.data(), record + sizeof(h), std::size_t(chars) * 2);
+            return text;
+        }
+        case Site:
+            return m_sites.value(h.site);
+        default:
+            return {};
+        }
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override
+    {
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return {};
+        static const char* names[ColumnCount] = { "Time", "Level", "Thread", "Category", "Message", "Source" };
+        return QString::fromLatin1(names[section]);
+    }
+
+    // Maps 'path' and appends the rows for records written since the last
+    // call; starts over when the file was rotated away. Returns false if
+    // there is no readable log.
+    bool refresh(const QString& path)
+    {
+        const qint64 size = QFileInfo(path).size();
+        if (m_file.isOpen() && (m_file.fileName() != path || m_file.size() != size)) {
+            // Our handle still reads the file it opened; a different size
+            // under the same name means a new file (or the old one grew
+            // between the two calls, which only costs a re-index).
+            beginResetModel();
+            close();
+            endResetModel();
+        }
+        if (!m_file.isOpen()) {
+            m_file.setFileName(path);
+            if (!m_file.open(QIODevice::ReadOnly)) return false;
+            m_indexed = 0;
+        }
+        if (size < qint64(sizeof(EventLog::FileHeader))) return true;
+
+        if (size > m_mapped) {
+            if (m_map) m_file.unmap(m_map);
+            m_map = m_file.map(0, size);
+            m_mapped = m_map ? size : 0;
+            if (!m_map) return false;
+        }
+        if (m_indexed == 0) {
+            EventLog::FileHeader header;
+            std::memcpy(&header, m_map, sizeof(header));
+            if (std::memcmp(header.magic, EventLog::kMagic, sizeof(header.magic)) != 0) return false;
+            m_epochMs = header.epochMs;
+            m_indexed = sizeof(header);
+        }
+
+        const std::size_t first = m_rows.size();
+        while (m_indexed + qint64(sizeof(EventLog::RecordHeader)) <= m_mapped) {
+            EventLog::RecordHeader h;
+            std::memcpy(&h, m_map + m_indexed, sizeof(h));
+            if (h.size < sizeof(h) || m_indexed + h.size > m_mapped) break;   // the rest is still being written
+            if (h.kind == EventLog::Kind::Definition) {
+                const QString text = QString::fromUtf8(reinterpret_cast<const char*>(m_map + m_indexed + sizeof(h)),
+                    qsizetype(h.size - sizeof(h)));
+                (h.level == std::uint8_t(EventLog::Defines::Category) ? m_categories : m_sites).insert(h.category, text);
+            }
+            else {
+                m_rows.push_back(quint64(m_indexed));
+            }
+            m_indexed += h.size;
+        }
+        if (m_rows.size() > first) {
+            // Rows arrive in order, so one insert covers them.
+            const std::size_t last = m_rows.size();
+            m_rows.resize(first);
+            beginInsertRows(QModelIndex(), int(first), int(last) - 1);
+            m_rows.resize(last);
+            endInsertRows();
+        }
+        return true;
+    }
+
+private:
+    void close()
+    {
+        if (m_map) m_file.unmap(m_map);
+        m_map = nullptr;
+        m_mapped = 0;
+        m_indexed = 0;
+        m_file.close();
+        m_rows.clear();
+        m_categories.clear();
+        m_sites.clear();
+    }
+
+    QFile m_file;
+    uchar* m_map = nullptr;
+    qint64 m_mapped = 0;
+    qint64 m_indexed = 0;              ///< file offset up to which records are indexed
+    qint64 m_epochMs = 0;
+    std::vector<quint64> m_rows;       ///< file offset of each message record
+    QHash<quint32, QString> m_categories, m_sites;
+};
+
+EventLogPanel::EventLogPanel(QWidget* parent)
+    : QWidget(parent)
+{
+    m_status = new QLabel(this);
+    m_follow = new QCheckBox("Follow", this);
+    m_follow->setToolTip("Keep the newest message in view");
+    m_follow->setChecked(true);
+
+    m_model = new EventLogModel(this);
+    m_view = new QTableView(this);
+    m_view->setModel(m_model);
+    m_view->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_view->verticalHeader()->setVisible(false);
+    m_view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);   // no per-row measuring
+    m_view->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    m_view->horizontalHeader()->setSectionResizeMode(EventLogModel::Message, QHeaderView::Stretch);
+    m_view->setWordWrap(false);
+
+    auto* controls = new QHBoxLayout;
+    controls->addWidget(m_status, 1);
+    controls->addWidget(m_follow);
+    auto* layout = new QVBoxLayout(this);
+    layout->addLayout(controls);
+    layout->addWidget(m_view);
+
+    // Scrolling up to read something stops following; back at the bottom resumes.
+    connect(m_view->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) {
+        m_follow->setChecked(value == m_view->verticalScrollBar()->maximum());
+    });
+
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setInterval(1000 / kRefreshHz);
+    connect(m_refreshTimer, &QTimer::timeout, this, &EventLogPanel::refresh);
+}
+
+EventLogPanel::~EventLogPanel() = default;
+
+void EventLogPanel::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    refresh();
+    m_refreshTimer->start();
+}
+
+void EventLogPanel::hideEvent(QHideEvent* event)
+{
+    QWidget::hideEvent(event);
+    m_refreshTimer->stop();
+}
+
+void EventLogPanel::refresh()
+{
+    if (!EventLog::running()) {
+        m_status->setText("Logging to stderr only");
+        return;
+    }
+    const QString path = EventLog::currentPath();
+    if (!m_model->refresh(path)) {
+        m_status->setText("Cannot read " + path);
+        return;
+    }
+    QString text = QStringLiteral("%1 messages in %2").arg(m_model->rowCount()).arg(path);
+    if (const std::uint64_t dropped = EventLog::droppedRecords())
+        text += QStringLiteral(", %1 dropped").arg(qulonglong(dropped));
+    m_status->setText(text);
+    if (m_follow->isChecked()) m_view->scrollToBottom();
+}
@@ -0,0 +1,82 @@
+#include "FieldGridSampler.hpp"
+#include "FieldSolver.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+glm::vec3 FieldGrid::samplePosition(int x, int y, int z) const
+{
+    const glm::ivec3 cell(x, y, z);
+    glm::vec3 t;
+    for (int a = 0; a < 3; ++a)
+        t[a] = resolution[a] > 1 ? float(cell[a]) / float(resolution[a] - 1) : 0.5f;
+    return boundsMin + t * (boundsMax - boundsMin);
+}
+
+namespace FieldGridSampler
+{
+bool sample(const FieldSnapshot& snapshot, const FieldGrid& grid, glm::vec3* out,
+    ThreadPool& pool, const ProgressFn& progress, const CancelFn& cancelled)
+{
+    const std::size_t total = grid.sampleCount();
+    if (total == 0) return true;
+
+    // Whole x-rows per chunk keep position generation simple.
+    const std::size_t rowLength = std::size_t(grid.resolution.x);
+    const std::size_t rowCount = total / rowLength;
+    const std::size_t rowsPerChunk = std::max<std::size_t>(1, kChunkSamples / rowLength);
+    const std::size_t chunkCount = (rowCount + rowsPerChunk - 1) / rowsPerChunk;
+
+    std::atomic<bool> stop{ false };
+    std::atomic<std::size_t> samplesDone{ 0 };
+    std::size_t chunksFinished = 0;
+    std::mutex doneMutex;
+    std::condition_variable doneCv;
+
+    for (std::size_t c = 0; c < chunkCount; ++c) {
+        pool.submit([&, c] {
+            if (!stop.load(std::memory_order_relaxed)) {
+                const std::size_t firstRow = c * rowsPerChunk;
+                const std::size_t lastRow = std::min(rowCount, firstRow + rowsPerChunk);
+                std::vector<glm::vec3> points(rowLength);
+
+                for (std::size_t row = firstRow; row < lastRow; ++row) {
+                    if (stop.load(std::memory_order_relaxed)) break;
+                    const int y = int(row % std::size_t(grid.resolution.y));
+                    const int z = int(row / std::size_t(grid.resolution.y));
+                    for (std::size_t x = 0; x < rowLength; ++x)
+                        points[x] = grid.samplePosition(int(x), y, z);
+                    FieldSolver::evaluateBatch(snapshot, points.data(), out + row * rowLength, rowLength);
+                    samplesDone.fetch_add(rowLength, std::memory_order_relaxed);
+                }
+            }
+            std::lock_guard<std::mutex> lock(doneMutex);
+            ++chunksFinished;
+            doneCv.notify_one();
+        });
+    }
+
+    // Report and poll for cancellation from this thread while the pool works.
+    // Every chunk must finish (or bail out) before the locals above go away.
+    std::unique_lock<std::mutex> lock(doneMutex);
+    while (chunksFinished < chunkCount) {
+        doneCv.wait_for(lock, std::chrono::milliseconds(50));
+        if (!stop && cancelled) {
+            lock.unlock();
+            if (cancelled()) stop = true;
+            lock.lock();
+        }
+        if (progress) {
+            lock.unlock();
+            progress(samplesDone.load(std::memory_order_relaxed), total);
+            lock.lock();
+        }
+    }
+    return !stop;
+}
+}
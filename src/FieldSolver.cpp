@@ -1,7 +1,12 @@
 #include "FieldSolver.hpp"
 #include "components.hpp"
+#include "PointCloudGrid.hpp"
+#include "DistanceField.hpp"
 #include <entt/entt.hpp>
 #include <glm/gtx/norm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 // --- Helper Functions for Geometric Calculations ---
 
@@ -64,11 +69,57 @@ static glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a,
     return a + ab * v + ac * w; // = u*a + v*b + w*c, u = 1-v-w
 }
 
+// Grid for a point-cloud effector, in cloud space (radius divided by the transform's scale).
+static std::shared_ptr<const PointCloudGrid> pointCloudGrid(const PointCloudEffectorComponent& effector,
+    const PointCloudComponent& cloud, const glm::mat4& model)
+{
+    if (!cloud.octree || effector.distance <= 0.0f) return nullptr;
+    const float scale = glm::length(glm::vec3(model[0]));
+    return PointCloudGrid::shared(cloud.octree, effector.distance / std::max(scale, 1e-6f));
+}
 
-// Calculates the total vector at a point by summing all effector influences.
-glm::vec3 FieldSolver::getVectorAt(entt::registry& registry, glm::vec3 worldPos, const std::vector<entt::entity>& sources)
+// Pushes worldPos away from the nearest point of the grid, fading linearly to
+// zero at the grid's radius. Assumes rotation and uniform scale only.
+static glm::vec3 pointCloudField(const PointCloudGrid& grid, const glm::mat4& worldToCloud, float strength, const glm::vec3& worldPos)
+{
+    const glm::vec3 q = glm::vec3(worldToCloud * glm::vec4(worldPos, 1.0f));
+    glm::vec3 nearest;
+    if (!grid.nearest(q, nearest)) return glm::vec3(0.0f);
+    const float distance = glm::length(q - nearest);
+    if (distance <= 1e-6f) return glm::vec3(0.0f);
+    const glm::vec3 away = glm::normalize(glm::transpose(glm::mat3(worldToCloud)) * (q - nearest));
+    return away * strength * (1.0f - distance / grid.radius());
+}
+
+// Field of a mesh effector, in mesh space (distance divided by the
+// transform's scale, a voxel an eighth of it); null until built.
+static std::shared_ptr<const DistanceField> meshDistanceField(const MeshEffectorComponent& effector,
+    const RenderableMeshComponent& mesh, float scale)
+{
+    if (effector.distance <= 0.0f) return nullptr;
+    const float band = effector.distance / std::max(scale, 1e-6f);
+    return DistanceField::shared(mesh.mesh, band * 0.125f, band);
+}
+
+// Pushes worldPos away from the mesh surface like the triangle walk does,
+// from the field's distance and gradient. Assumes rotation and uniform scale only.
+static glm::vec3 meshFieldForce(const DistanceField& field, const glm::mat4& worldToLocal, float scale,
+    float distance, float strength, const glm::vec3& worldPos)
+{
+    float d;
+    glm::vec3 gradient;
+    if (!field.sample(glm::vec3(worldToLocal * glm::vec4(worldPos, 1.0f)), d, gradient)) return glm::vec3(0.0f);
+    const float worldDistance = std::abs(d) * scale;
+    const glm::vec3 away = glm::transpose(glm::mat3(worldToLocal)) * (d < 0.0f ? -gradient : gradient);
+    if (worldDistance >= distance || worldDistance <= 1e-6f || glm::length2(away) <= 0.0f) return glm::vec3(0.0f);
+    return glm::normalize(away) * strength * (1.0f - worldDistance / distance);
+}
+
+// Sums every effector's influence at a point, plus the point-effector potential.
+FieldSample FieldSolver::evaluate(entt::registry& registry, glm::vec3 worldPos, const std::vector<entt::entity>& sources)
 {
-    glm::vec3 totalField(0.0f);
+    FieldSample sample;
+    glm::vec3& totalField = sample.vector;
 
     // Create a view of all potential field sources.
     auto sourceView = registry.view<const FieldSourceTag, const TransformComponent>();
@@ -94,6 +145,13 @@ glm::vec3 FieldSolver::getVectorAt(entt::registry& registry, glm::vec3 worldPos,
             glm::vec3 vectorToPoint = worldPos - entityPos;
             float distanceSq = glm::length2(vectorToPoint);
 
+            // Potential is -s/d^2 with no radius cut-off; its gradient is
+            // 2s * r / d^4, so the potential force is the negation of that.
+            if (distanceSq > 1e-6f) {
+                sample.potential += -point->strength / distanceSq;
+                sample.gradient -= vectorToPoint * (2.0f * point->strength / (distanceSq * distanceSq));
+            }
+
             if (distanceSq < (point->radius * point->radius) && distanceSq > 1e-6f) {
                 float distance = sqrt(distanceSq);
                 glm::vec3 direction = vectorToPoint / distance;
@@ -138,17 +196,23 @@ glm::vec3 FieldSolver::getVectorAt(entt::registry& registry, glm::vec3 worldPos,
         // --- 4. Mesh Effector ---
         // Repels from the surface of a mesh.
         if (auto* meshEffector = registry.try_get<MeshEffectorComponent>(entity)) {
-            if (auto* renderable = registry.try_get<RenderableMeshComponent>(entity)) {
+            auto* renderable = registry.try_get<RenderableMeshComponent>(entity);
+            const glm::mat4 modelMatrix = transform.getTransform();
+            const float scale = glm::length(glm::vec3(modelMatrix[0]));
+            if (auto field = renderable ? meshDistanceField(*meshEffector, *renderable, scale) : nullptr) {
+                totalField += meshFieldForce(*field, glm::inverse(modelMatrix), scale, meshEffector->distance,
+                    meshEffector->strength, worldPos);
+            }
+            else if (renderable) {
                 glm::vec3 closestPointOnMesh;
                 float minDistanceSq = std::numeric_limits<float>::max();
-                glm::mat4 modelMatrix = transform.getTransform();
 
                 // Iterate through all triangles in the mesh
-                for (size_t i = 0; i < renderable->indices.size(); i += 3) {
+                for (size_t i = 0; i < renderable->indices().size(); i += 3) {
                     // Get vertices of the triangle and transform them to world space
-                    glm::vec3 v0 = modelMatrix * glm::vec4(renderable->vertices[renderable->indices[i]].position, 1.0f);
-                    glm::vec3 v1 = modelMatrix * glm::vec4(renderable->vertices[renderable->indices[i + 1]].position, 1.0f);
-                    glm::vec3 v2 = modelMatrix * glm::vec4(renderable->vertices[renderable->indices[i + 2]].position, 1.0f);
+                    glm::vec3 v0 = modelMatrix * glm::vec4(renderable->vertices()[renderable->indices()[i]].position, 1.0f);
+                    glm::vec3 v1 = modelMatrix * glm::vec4(renderable->vertices()[renderable->indices()[i + 1]].position, 1.0f);
+                    glm::vec3 v2 = modelMatrix * glm::vec4(renderable->vertices()[renderable->indices()[i + 2]].position, 1.0f);
 
                     glm::vec3 p_on_triangle = closestPointOnTriangle(worldPos, v0, v1, v2);
                     float distSq = glm::length2(worldPos - p_on_triangle);
@@ -169,53 +233,415 @@ glm::vec3 FieldSolver::getVectorAt(entt::registry& registry, glm::vec3 worldPos,
                 }
             }
         }
+
+        // --- 5. Point Cloud Effector ---
+        // Repels from the nearest scanned point, via the cloud's grid.
+        if (auto* cloudEffector = registry.try_get<PointCloudEffectorComponent>(entity)) {
+            if (auto* cloud = registry.try_get<PointCloudComponent>(entity)) {
+                const glm::mat4 modelMatrix = transform.getTransform();
+                if (auto grid = pointCloudGrid(*cloudEffector, *cloud, modelMatrix))
+                    totalField += pointCloudField(*grid, glm::inverse(modelMatrix), cloudEffector->strength, worldPos);
+            }
+        }
     }
-    return totalField;
+    return sample;
 }
 
+glm::vec3 FieldSolver::getVectorAt(entt::registry& registry, glm::vec3 worldPos, const std::vector<entt::entity>& sources)
+{
+    return evaluate(registry, worldPos, sources).vector;
+}
 
-// Calculates the total scalar potential at a point from all sources.
-// This function remains unchanged but is included for completeness.
-float FieldSolver::getPotentialAt(entt::registry& registry, glm::vec3 worldPos, const std::vector<entt::entity>& sources) {
-    float totalPotential = 0.0f;
-    auto view = registry.view<const FieldSourceTag, const TransformComponent, const PointEffectorComponent>();
 
-    for (auto entity : view) {
-        if (!sources.empty() && std::find(sources.begin(), sources.end(), entity) == sources.end()) {
-            continue;
+// Only point effectors have a potential, so these walk just those sources
+// and skip the spline, mesh and cloud searches evaluate() does for the vector.
+static FieldSample pointPotential(entt::registry& registry, const glm::vec3& worldPos, const std::vector<entt::entity>& sources)
+{
+    FieldSample sample;
+    auto pointView = registry.view<const FieldSourceTag, const TransformComponent, const PointEffectorComponent>();
+    for (auto entity : pointView) {
+        if (!sources.empty() && std::find(sources.begin(), sources.end(), entity) == sources.end()) continue;
+        const auto& [transform, point] = pointView.get<const TransformComponent, const PointEffectorComponent>(entity);
+        const glm::vec3 vectorToPoint = worldPos - transform.translation;
+        const float distanceSq = glm::length2(vectorToPoint);
+        if (distanceSq > 1e-6f) {
+            sample.potential += -point.strength / distanceSq;
+            sample.gradient -= vectorToPoint * (2.0f * point.strength / (distanceSq * distanceSq));
         }
-        const auto& transform = view.get<const TransformComponent>(entity);
-        const auto& source = view.get<const PointEffectorComponent>(entity);
+    }
+    return sample;
+}
+
+float FieldSolver::getPotentialAt(entt::registry& registry, glm::vec3 worldPos, const std::vector<entt::entity>& sources)
+{
+    return pointPotential(registry, worldPos, sources).potential;
+}
+
+glm::vec3 FieldSolver::getPotentialGradientAt(entt::registry& registry, glm::vec3 worldPos, const std::vector<entt::entity>& sources)
+{
+    return pointPotential(registry, worldPos, sources).gradient;
+}
+
+// --- Batched evaluation ---
+
+namespace {
+using EffectorHash = FieldSnapshot::EffectorHash;
+
+// Below this many points + segments a linear scan beats the hash lookup.
+constexpr std::size_t kHashMinEffectors = 32;
+// An effector covering more cells than this goes to the unbounded list.
+constexpr std::int64_t kMaxCellsPerEffector = 512;
+// A batch whose lanes span more cells than this scans everything instead.
+constexpr std::int64_t kMaxQueryCells = 64;
+
+inline std::uint32_t hashCell(int x, int y, int z, std::uint32_t mask)
+{
+    return (std::uint32_t(x) * 73856093u ^ std::uint32_t(y) * 19349663u ^ std::uint32_t(z) * 83492791u) & mask;
+}
+
+inline glm::ivec3 cellOf(const glm::vec3& p, float invCell)
+{
+    return glm::ivec3(glm::floor(p * invCell));
+}
+
+inline std::int64_t cellSpan(const glm::ivec3& lo, const glm::ivec3& hi)
+{
+    return (std::int64_t(hi.x) - lo.x + 1) * (std::int64_t(hi.y) - lo.y + 1) * (std::int64_t(hi.z) - lo.z + 1);
+}
+
+void buildEffectorHash(FieldSnapshot& s)
+{
+    EffectorHash& h = s.hash;
+    h = EffectorHash{};
+
+    const std::size_t segCount = s.segAX.size();
+    if (s.pointCount() + segCount < kHashMinEffectors) return;
+
+    struct Volume { glm::vec3 lo, hi; std::uint32_t entry; };
+    std::vector<Volume> volumes;
+    volumes.reserve(s.pointCount() + segCount);
+
+    for (std::size_t j = 0; j < s.pointCount(); ++j) {
+        const glm::vec3 c(s.pointX[j], s.pointY[j], s.pointZ[j]);
+        const float r = std::sqrt(s.pointRadiusSq[j]);
+        volumes.push_back({ c - r, c + r, std::uint32_t(j) });
+    }
+    for (std::size_t g = 0; g < segCount; ++g) {
+        const glm::vec3 a(s.segAX[g], s.segAY[g], s.segAZ[g]);
+        const glm::vec3 b = a + glm::vec3(s.segDX[g], s.segDY[g], s.segDZ[g]);
+        const float r = std::sqrt(s.splineRadiusSq[s.segSpline[g]]);
+        volumes.push_back({ glm::min(a, b) - r, glm::max(a, b) + r, std::uint32_t(g) | EffectorHash::kSegmentBit });
+    }
+
+    // Cell edge ~ the median influence diameter: most volumes touch 1-8 cells.
+    std::vector<float> extents;
+    extents.reserve(volumes.size());
+    for (const Volume& v : volumes) {
+        const glm::vec3 e = v.hi - v.lo;
+        extents.push_back(std::max(e.x, std::max(e.y, e.z)));
+    }
+    std::nth_element(extents.begin(), extents.begin() + extents.size() / 2, extents.end());
+    h.cellSize = std::max(extents[extents.size() / 2], 1e-3f);
+    const float invCell = 1.0f / h.cellSize;
+
+    std::vector<std::pair<glm::ivec3, std::uint32_t>> binned;
+    for (const Volume& v : volumes) {
+        const glm::ivec3 lo = cellOf(v.lo, invCell), hi = cellOf(v.hi, invCell);
+        if (cellSpan(lo, hi) > kMaxCellsPerEffector) { h.unbounded.push_back(v.entry); continue; }
+        for (int z = lo.z; z <= hi.z; ++z)
+            for (int y = lo.y; y <= hi.y; ++y)
+                for (int x = lo.x; x <= hi.x; ++x)
+                    binned.push_back({ glm::ivec3(x, y, z), v.entry });
+    }
+
+    std::uint32_t buckets = 64;
+    while (buckets < binned.size() * 2) buckets *= 2;
+    h.bucketMask = buckets - 1;
+
+    h.bucketStart.assign(buckets + 1, 0);
+    for (const auto& b : binned) ++h.bucketStart[hashCell(b.first.x, b.first.y, b.first.z, h.bucketMask) + 1];
+    for (std::uint32_t i = 0; i < buckets; ++i) h.bucketStart[i + 1] += h.bucketStart[i];
+
+    h.entries.resize(binned.size());
+    std::vector<std::uint32_t> cursor(h.bucketStart.begin(), h.bucketStart.end() - 1);
+    for (const auto& b : binned) h.entries[cursor[hashCell(b.first.x, b.first.y, b.first.z, h.bucketMask)]++] = b.second;
+}
+
+// Collects the hashed effectors whose cells overlap the lanes' bounds into
+// 'out' (sorted, unique: points first, then segments). Returns false when the
+// lanes are too spread out and the caller should scan everything.
+bool gatherCandidates(const EffectorHash& h, const float* px, const float* py, const float* pz,
+    std::size_t lanes, std::vector<std::uint32_t>& out)
+{
+    glm::vec3 lo(px[0], py[0], pz[0]), hi = lo;
+    for (std::size_t l = 1; l < lanes; ++l) {
+        const glm::vec3 p(px[l], py[l], pz[l]);
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    const float invCell = 1.0f / h.cellSize;
+    const glm::ivec3 c0 = cellOf(lo, invCell), c1 = cellOf(hi, invCell);
+    if (cellSpan(c0, c1) > kMaxQueryCells) return false;
+
+    out.assign(h.unbounded.begin(), h.unbounded.end());
+    for (int z = c0.z; z <= c1.z; ++z)
+        for (int y = c0.y; y <= c1.y; ++y)
+            for (int x = c0.x; x <= c1.x; ++x) {
+                const std::uint32_t b = hashCell(x, y, z, h.bucketMask);
+                out.insert(out.end(), h.entries.begin() + h.bucketStart[b], h.entries.begin() + h.bucketStart[b + 1]);
+            }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return true;
+}
 
-        // We only calculate potential for point effectors for now
-        float distSq = glm::distance2(transform.translation, worldPos);
-        if (distSq > 1e-6) {
-            // Strengh < 0 is attractive, but potential should be negative
-            // Strengh > 0 is repulsive, but potential should be positive
-            totalPotential += -source.strength / distSq;
+struct Lanes {
+    alignas(32) float px[FieldSolver::kBatchLanes], py[FieldSolver::kBatchLanes], pz[FieldSolver::kBatchLanes];
+    alignas(32) float fx[FieldSolver::kBatchLanes], fy[FieldSolver::kBatchLanes], fz[FieldSolver::kBatchLanes];
+};
+
+struct SplineLanes {
+    alignas(32) float bestD2[FieldSolver::kBatchLanes], cx[FieldSolver::kBatchLanes], cy[FieldSolver::kBatchLanes], cz[FieldSolver::kBatchLanes];
+    void reset() { for (float& d : bestD2) d = std::numeric_limits<float>::max(); }
+};
+
+inline void pointLanes(const FieldSnapshot& s, std::size_t j, Lanes& v)
+{
+    const float ex = s.pointX[j], ey = s.pointY[j], ez = s.pointZ[j];
+    const float r2 = s.pointRadiusSq[j];
+    const float c0 = s.pointC0[j], c1 = s.pointC1[j], c2 = s.pointC2[j];
+    for (std::size_t l = 0; l < FieldSolver::kBatchLanes; ++l) {
+        const float dx = v.px[l] - ex, dy = v.py[l] - ey, dz = v.pz[l] - ez;
+        const float d2 = dx * dx + dy * dy + dz * dz;
+        const bool inside = d2 < r2 && d2 > 1e-6f;
+        const float d = std::sqrt(d2);
+        const float invD = inside ? 1.0f / d : 0.0f;
+        const float k = (c0 + c1 * d + c2 * invD) * invD;   // strength along the unit direction
+        v.fx[l] += dx * k; v.fy[l] += dy * k; v.fz[l] += dz * k;
+    }
+}
+
+inline void segmentLanes(const FieldSnapshot& s, std::size_t g, const Lanes& v, SplineLanes& sl)
+{
+    const float ax = s.segAX[g], ay = s.segAY[g], az = s.segAZ[g];
+    const float sx = s.segDX[g], sy = s.segDY[g], sz = s.segDZ[g];
+    const float inv = s.segInvLenSq[g];
+    for (std::size_t l = 0; l < FieldSolver::kBatchLanes; ++l) {
+        float t = ((v.px[l] - ax) * sx + (v.py[l] - ay) * sy + (v.pz[l] - az) * sz) * inv;
+        t = std::min(std::max(t, 0.0f), 1.0f);
+        const float qx = ax + t * sx, qy = ay + t * sy, qz = az + t * sz;
+        const float dx = v.px[l] - qx, dy = v.py[l] - qy, dz = v.pz[l] - qz;
+        const float d2 = dx * dx + dy * dy + dz * dz;
+        const bool closer = d2 < sl.bestD2[l];
+        sl.bestD2[l] = closer ? d2 : sl.bestD2[l];
+        sl.cx[l] = closer ? qx : sl.cx[l];
+        sl.cy[l] = closer ? qy : sl.cy[l];
+        sl.cz[l] = closer ? qz : sl.cz[l];
+    }
+}
+
+// Pulls each lane towards its nearest spline point if it lies within the radius.
+inline void splineFinish(const FieldSnapshot& s, std::size_t sp, const SplineLanes& sl, Lanes& v)
+{
+    const float r2 = s.splineRadiusSq[sp];
+    const float strength = s.splineStrength[sp];
+    for (std::size_t l = 0; l < FieldSolver::kBatchLanes; ++l) {
+        const bool inside = sl.bestD2[l] < r2 && sl.bestD2[l] > 1e-12f;
+        const float k = inside ? strength / std::sqrt(sl.bestD2[l]) : 0.0f;
+        v.fx[l] += (sl.cx[l] - v.px[l]) * k;
+        v.fy[l] += (sl.cy[l] - v.py[l]) * k;
+        v.fz[l] += (sl.cz[l] - v.pz[l]) * k;
+    }
+}
+}
+
+FieldSnapshot FieldSolver::snapshot(entt::registry& registry, const std::vector<entt::entity>& sources)
+{
+    FieldSnapshot s;
+
+    std::vector<entt::entity> filter = sources;
+    std::sort(filter.begin(), filter.end());
+
+    auto sourceView = registry.view<const FieldSourceTag, const TransformComponent>();
+    for (auto entity : sourceView) {
+        if (!filter.empty() && !std::binary_search(filter.begin(), filter.end(), entity)) continue;
+
+        const auto& transform = sourceView.get<const TransformComponent>(entity);
+
+        if (auto* directional = registry.try_get<DirectionalEffectorComponent>(entity)) {
+            s.directional += glm::normalize(directional->direction) * directional->strength;
+        }
+
+        if (auto* point = registry.try_get<PointEffectorComponent>(entity)) {
+            float c0 = point->strength, c1 = 0.0f, c2 = 0.0f;
+            if (point->falloff == PointEffectorComponent::FalloffType::Linear) {
+                c1 = -point->strength / point->radius;
+            }
+            else if (point->falloff == PointEffectorComponent::FalloffType::InverseSquare) {
+                c0 = 0.0f;
+                c2 = point->strength;
+            }
+            s.pointX.push_back(transform.translation.x);
+            s.pointY.push_back(transform.translation.y);
+            s.pointZ.push_back(transform.translation.z);
+            s.pointRadiusSq.push_back(point->radius * point->radius);
+            s.pointC0.push_back(c0);
+            s.pointC1.push_back(c1);
+            s.pointC2.push_back(c2);
+        }
+
+        if (auto* splineEffector = registry.try_get<SplineEffectorComponent>(entity)) {
+            auto* spline = registry.try_get<SplineComponent>(entity);
+            if (spline && spline->controlPoints.size() >= 2) {
+                s.splineSegFirst.push_back(static_cast<std::uint32_t>(s.segAX.size()));
+                s.splineSegCount.push_back(static_cast<std::uint32_t>(spline->controlPoints.size() - 1));
+                s.splineRadiusSq.push_back(splineEffector->radius * splineEffector->radius);
+                s.splineStrength.push_back(splineEffector->strength);
+                for (size_t i = 0; i + 1 < spline->controlPoints.size(); ++i) {
+                    const glm::vec3 a = spline->controlPoints[i];
+                    const glm::vec3 d = spline->controlPoints[i + 1] - a;
+                    const float lenSq = glm::dot(d, d);
+                    s.segAX.push_back(a.x);  s.segAY.push_back(a.y);  s.segAZ.push_back(a.z);
+                    s.segDX.push_back(d.x);  s.segDY.push_back(d.y);  s.segDZ.push_back(d.z);
+                    s.segInvLenSq.push_back(lenSq > 0.0f ? 1.0f / lenSq : 0.0f);
+                    s.segSpline.push_back(static_cast<std::uint32_t>(s.splineStrength.size() - 1));
+                }
+            }
+        }
+
+        if (auto* meshEffector = registry.try_get<MeshEffectorComponent>(entity)) {
+            auto* renderable = registry.try_get<RenderableMeshComponent>(entity);
+            const glm::mat4 modelMatrix = transform.getTransform();
+            const float scale = glm::length(glm::vec3(modelMatrix[0]));
+            if (auto field = renderable ? meshDistanceField(*meshEffector, *renderable, scale) : nullptr) {
+                s.meshFields.push_back(std::move(field));
+                s.meshFieldWorldToLocal.push_back(glm::inverse(modelMatrix));
+                s.meshFieldScale.push_back(scale);
+                s.meshFieldDistance.push_back(meshEffector->distance);
+                s.meshFieldStrength.push_back(meshEffector->strength);
+            }
+            else if (renderable) {
+                s.meshTriFirst.push_back(static_cast<std::uint32_t>(s.triangles.size() / 3));
+                s.meshDistance.push_back(meshEffector->distance);
+                s.meshStrength.push_back(meshEffector->strength);
+                for (size_t i = 0; i + 2 < renderable->indices().size(); i += 3) {
+                    for (int k = 0; k < 3; ++k) {
+                        s.triangles.push_back(glm::vec3(modelMatrix * glm::vec4(renderable->vertices()[renderable->indices()[i + k]].position, 1.0f)));
+                    }
+                }
+                s.meshTriCount.push_back(static_cast<std::uint32_t>(s.triangles.size() / 3) - s.meshTriFirst.back());
+            }
+        }
+
+        if (auto* cloudEffector = registry.try_get<PointCloudEffectorComponent>(entity)) {
+            if (auto* cloud = registry.try_get<PointCloudComponent>(entity)) {
+                const glm::mat4 modelMatrix = transform.getTransform();
+                if (auto grid = pointCloudGrid(*cloudEffector, *cloud, modelMatrix)) {
+                    s.cloudGrids.push_back(std::move(grid));
+                    s.cloudWorldToLocal.push_back(glm::inverse(modelMatrix));
+                    s.cloudStrength.push_back(cloudEffector->strength);
+                }
+            }
         }
     }
-    return totalPotential;
+
+    buildEffectorHash(s);
+    return s;
 }
 
-// Calculates the gradient of the potential field at a point using finite differences.
-// This function remains unchanged but is included for completeness.
-glm::vec3 FieldSolver::getPotentialGradientAt(entt::registry& registry, glm::vec3 worldPos, const std::vector<entt::entity>& sources) {
-    float epsilon = 0.01f;
+void FieldSolver::evaluateBatch(const FieldSnapshot& s, const glm::vec3* points, glm::vec3* out, std::size_t count)
+{
+    constexpr std::size_t L = kBatchLanes;
+    std::vector<std::uint32_t> candidates;
+
+    for (std::size_t base = 0; base < count; base += L) {
+        const std::size_t n = std::min(L, count - base);
+
+        // Lanes past the end repeat the last point so the loops stay branch free.
+        Lanes v;
+        for (std::size_t l = 0; l < L; ++l) {
+            const glm::vec3& p = points[base + std::min(l, n - 1)];
+            v.px[l] = p.x; v.py[l] = p.y; v.pz[l] = p.z;
+            v.fx[l] = s.directional.x; v.fy[l] = s.directional.y; v.fz[l] = s.directional.z;
+        }
 
-    float pot_x1 = getPotentialAt(registry, worldPos + glm::vec3(epsilon, 0, 0), sources);
-    float pot_x0 = getPotentialAt(registry, worldPos - glm::vec3(epsilon, 0, 0), sources);
+        SplineLanes sl;
+        if (s.hash.enabled() && gatherCandidates(s.hash, v.px, v.py, v.pz, n, candidates)) {
+            // --- Point and spline effectors near this batch only ---
+            auto it = candidates.begin();
+            for (; it != candidates.end() && !(*it & EffectorHash::kSegmentBit); ++it)
+                pointLanes(s, *it, v);
+
+            // Segments are numbered spline by spline, so after sorting each
+            // spline's candidates are contiguous.
+            while (it != candidates.end()) {
+                const std::uint32_t sp = s.segSpline[*it & ~EffectorHash::kSegmentBit];
+                sl.reset();
+                for (; it != candidates.end() && s.segSpline[*it & ~EffectorHash::kSegmentBit] == sp; ++it)
+                    segmentLanes(s, *it & ~EffectorHash::kSegmentBit, v, sl);
+                splineFinish(s, sp, sl, v);
+            }
+        }
+        else {
+            // --- Point effectors ---
+            for (std::size_t j = 0; j < s.pointCount(); ++j) pointLanes(s, j, v);
+
+            // --- Spline effectors: nearest segment per spline, then one pull ---
+            for (std::size_t sp = 0; sp < s.splineCount(); ++sp) {
+                sl.reset();
+                const std::uint32_t first = s.splineSegFirst[sp];
+                const std::uint32_t last = first + s.splineSegCount[sp];
+                for (std::uint32_t g = first; g < last; ++g) segmentLanes(s, g, v, sl);
+                splineFinish(s, sp, sl, v);
+            }
+        }
 
-    float pot_y1 = getPotentialAt(registry, worldPos + glm::vec3(0, epsilon, 0), sources);
-    float pot_y0 = getPotentialAt(registry, worldPos - glm::vec3(0, epsilon, 0), sources);
+        // --- Mesh effectors: closest-point queries are branchy, run per lane ---
+        for (std::size_t m = 0; m < s.meshCount(); ++m) {
+            const std::uint32_t first = s.meshTriFirst[m];
+            const std::uint32_t last = first + s.meshTriCount[m];
+            const float dist = s.meshDistance[m];
+            for (std::size_t l = 0; l < n; ++l) {
+                const glm::vec3 p(v.px[l], v.py[l], v.pz[l]);
+                glm::vec3 closest(0.0f);
+                float minD2 = std::numeric_limits<float>::max();
+                for (std::uint32_t t = first; t < last; ++t) {
+                    const glm::vec3 q = closestPointOnTriangle(p, s.triangles[3 * t], s.triangles[3 * t + 1], s.triangles[3 * t + 2]);
+                    const float d2 = glm::length2(p - q);
+                    if (d2 < minD2) { minD2 = d2; closest = q; }
+                }
+                if (minD2 < dist * dist) {
+                    const glm::vec3 away = p - closest;
+                    const float d = glm::length(away);
+                    if (d > 1e-6f) {
+                        const float strength = s.meshStrength[m] * (1.0f - d / dist);
+                        v.fx[l] += away.x / d * strength;
+                        v.fy[l] += away.y / d * strength;
+                        v.fz[l] += away.z / d * strength;
+                    }
+                }
+            }
+        }
 
-    float pot_z1 = getPotentialAt(registry, worldPos + glm::vec3(0, 0, epsilon), sources);
-    float pot_z0 = getPotentialAt(registry, worldPos - glm::vec3(0, 0, epsilon), sources);
+        // --- Mesh effectors with a distance field: one lookup per lane ---
+        for (std::size_t m = 0; m < s.meshFieldCount(); ++m) {
+            for (std::size_t l = 0; l < n; ++l) {
+                const glm::vec3 f = meshFieldForce(*s.meshFields[m], s.meshFieldWorldToLocal[m], s.meshFieldScale[m],
+                    s.meshFieldDistance[m], s.meshFieldStrength[m], glm::vec3(v.px[l], v.py[l], v.pz[l]));
+                v.fx[l] += f.x; v.fy[l] += f.y; v.fz[l] += f.z;
+            }
+        }
 
-    float dx = (pot_x1 - pot_x0) / (2.0f * epsilon);
-    float dy = (pot_y1 - pot_y0) / (2.0f * epsilon);
-    float dz = (pot_z1 - pot_z0) / (2.0f * epsilon);
+        // --- Point-cloud effectors: grid lookups, per lane ---
+        for (std::size_t c = 0; c < s.cloudCount(); ++c) {
+            for (std::size_t l = 0; l < n; ++l) {
+                const glm::vec3 f = pointCloudField(*s.cloudGrids[c], s.cloudWorldToLocal[c], s.cloudStrength[c],
+                    glm::vec3(v.px[l], v.py[l], v.pz[l]));
+                v.fx[l] += f.x; v.fy[l] += f.y; v.fz[l] += f.z;
+            }
+        }
 
-    // The vector field is the negative gradient of the potential field
-    return -glm::vec3(dx, dy, dz);
+        for (std::size_t l = 0; l < n; ++l)
+            out[base + l] = glm::vec3(v.fx[l], v.fy[l], v.fz[l]);
+    }
 }
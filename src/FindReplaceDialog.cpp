@@ -0,0 +1,98 @@
+#include "FindReplaceDialog.hpp"
+#include "Scene.hpp"
+#include "components.hpp"
+
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <limits>
+
+FindReplaceDialog::FindReplaceDialog(Scene* scene, QWidget* parent)
+    : QDialog(parent), m_scene(scene)
+{
+    setWindowTitle("Find and Replace");
+    setModal(false);
+
+    m_find = new QLineEdit(this);
+    m_find->setPlaceholderText("Part of a name, any case");
+    m_find->setClearButtonEnabled(true);
+    m_replace = new QLineEdit(this);
+    auto* fields = new QFormLayout;
+    fields->addRow("Find", m_find);
+    fields->addRow("Replace with", m_replace);
+
+    m_results = new QListWidget(this);
+    m_results->setUniformItemSizes(true);   // keeps long result lists cheap to lay out
+    m_status = new QLabel(this);
+    m_more = new QPushButton("Show more", this);
+    m_replaceAll = new QPushButton("Replace All", this);
+    auto* buttons = new QHBoxLayout;
+    buttons->addWidget(m_status, 1);
+    buttons->addWidget(m_more);
+    buttons->addWidget(m_replaceAll);
+
+    auto* layout = new QVBoxLayout(this);
+    layout->addLayout(fields);
+    layout->addWidget(m_results, 1);
+    layout->addLayout(buttons);
+    resize(420, 480);
+
+    connect(m_find, &QLineEdit::textChanged, this, &FindReplaceDialog::search);
+    connect(m_more, &QPushButton::clicked, this, &FindReplaceDialog::showMore);
+    connect(m_replaceAll, &QPushButton::clicked, this, &FindReplaceDialog::replaceAll);
+    connect(m_results, &QListWidget::itemActivated, this, [this](QListWidgetItem* item) {
+        emit entityActivated(entt::entity(item->data(Qt::UserRole).toUInt()));
+        });
+    search();
+}
+
+void FindReplaceDialog::search()
+{
+    m_results->clear();
+    m_cursor = NameIndex::Cursor{ m_find->text().toStdString() };
+    if (m_cursor.query.empty()) m_cursor.done = true;
+    showMore();
+}
+
+void FindReplaceDialog::showMore()
+{
+    entt::registry& registry = m_scene->getRegistry();
+    m_page.clear();
+    NameIndex::of(registry).find(m_cursor, kPageSize, m_page);
+    for (const entt::entity entity : m_page) {
+        const auto* tag = registry.try_get<TagComponent>(entity);
+        if (!tag) continue;
+        auto* item = new QListWidgetItem(QString::fromStdString(tag->tag), m_results);
+        item->setData(Qt::UserRole, uint(entt::to_integral(entity)));
+    }
+    const int shown = m_results->count();
+    m_more->setEnabled(!m_cursor.done);
+    m_replaceAll->setEnabled(shown > 0);
+    if (m_cursor.query.empty()) m_status->clear();
+    else m_status->setText(m_cursor.done ? QString("%1 found").arg(shown) : QString("First %1 shown").arg(shown));
+}
+
+void FindReplaceDialog::replaceAll()
+{
+    const std::string query = m_find->text().toStdString();
+    if (query.empty()) return;
+    entt::registry& registry = m_scene->getRegistry();
+    NameIndex& index = NameIndex::of(registry);
+
+    NameIndex::Cursor all{ query };
+    m_page.clear();
+    index.find(all, std::numeric_limits<std::size_t>::max(), m_page);
+    std::size_t changed = 0;
+    {
+        UndoStack::Scope edit(m_scene->undo(), registry, "Replace in names");
+        for (const entt::entity entity : m_page) edit.track<TagComponent>(entity);
+        changed = index.replace(m_page, query, m_replace->text().toStdString());
+    }
+    search();
+    m_status->setText(QString("%1 renamed").arg(qulonglong(changed)));
+    if (changed) emit namesChanged();
+}
@@ -2,8 +2,10 @@
 #include "ui_flowVisualizerMenu.h"
 #include "PreviewViewport.hpp" // Include the preview viewport header here
 #include "QtHelpers.hpp"
+#include "GradientLut.hpp"
 
 #include <QColorDialog>
+#include <QImage>
 #include <QPainter>
 #include <QLabel>
 #include <QPushButton>
@@ -156,6 +158,7 @@ void FlowVisualizerMenu::setupConnections()
 {
     // --- Global / Top-Level Connections ---
     connect(ui->masterVisibilityCheck, &QCheckBox::toggled, this, &FlowVisualizerMenu::onMasterVisibilityChanged);
+    connect(ui->temporalCheck, &QCheckBox::toggled, this, &FlowVisualizerMenu::onSettingChanged);
     connect(ui->resetVisualizerButton, &QToolButton::clicked, this, &FlowVisualizerMenu::onResetVisualizerClicked);
     connect(ui->visualizationTypeInput, &QComboBox::currentIndexChanged, this, &FlowVisualizerMenu::onVisualizationTypeChanged);
     // connect(ui->boundaryTypeComboBox, &QComboBox::currentIndexChanged, this, &FlowVisualizerMenu::onBoundaryTypeChanged); // Assuming you add this combo box
@@ -438,17 +441,14 @@ void FlowVisualizerMenu::updateGradientPreviewFromTable(QLabel* previewLabel, QT
 {
     if (!previewLabel || !table || previewLabel->width() <= 0) return;
 
-    QLinearGradient gradient(0, 0, previewLabel->width(), 0);
-
-    // TODO: Iterate through the table rows, get the position from the spinbox in column 0
-    // and the color from the button in column 1. Add them to the QLinearGradient
-    // using gradient.setColorAt(position, color).
-
-    QPixmap pixmap(previewLabel->size());
-    pixmap.fill(Qt::transparent);
-    QPainter painter(&pixmap);
-    painter.fillRect(pixmap.rect(), gradient);
-    previewLabel->setPixmap(pixmap);
+    // The table the renderer samples, stretched over the label.
+    const GradientLut lut = GradientLut::bake(getGradientFromTable(table));
+    QImage strip(GradientLut::kSize, 1, QImage::Format_RGBA8888);
+    for (int i = 0; i < GradientLut::kSize; ++i) {
+        const glm::vec4 c = glm::clamp(lut.texels[i], 0.0f, 1.0f);
+        strip.setPixelColor(i, 0, QColor::fromRgbF(c.r, c.g, c.b, c.a));
+    }
+    previewLabel->setPixmap(QPixmap::fromImage(strip.scaled(previewLabel->size())));
 }
 
 
@@ -483,6 +483,7 @@ std::vector<ColorStop> FlowVisualizerMenu::getGradientFromTable(QTableWidget* ta
 // --- PUBLIC GETTER IMPLEMENTATIONS (Fixed) ---
 
 bool FlowVisualizerMenu::isMasterVisible() const { return ui->masterVisibilityCheck->isChecked(); }
+bool FlowVisualizerMenu::isTemporal() const { return ui->temporalCheck->isChecked(); }
 glm::vec3 FlowVisualizerMenu::getFieldPosition() const { return { static_cast<float>(ui->originInputX->value()), static_cast<float>(ui->originInputY->value()), static_cast<float>(ui->originInputZ->value()) }; }
 glm::vec3 FlowVisualizerMenu::getFieldOrientation() const { return { static_cast<float>(ui->angleInputEulerX->value()), static_cast<float>(ui->angleInputEulerY->value()), static_cast<float>(ui->angleInputEulerZ->value()) }; }
 AABB FlowVisualizerMenu::getBounds() const
@@ -595,6 +596,7 @@ void FlowVisualizerMenu::updateControlsFromComponent(const FieldVisualizerCompon
 
     // Update General controls
     ui->masterVisibilityCheck->setChecked(component.isEnabled);
+    ui->temporalCheck->setChecked(component.temporalSettings.enabled);
     ui->visualizationTypeInput->setCurrentIndex(static_cast<int>(component.displayMode));
 	// Update Boundary Type (Box or Sphere)
 
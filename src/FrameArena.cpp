@@ -0,0 +1,67 @@
+#include "FrameArena.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+    std::atomic<std::uint64_t>& frameCounter()
+    {
+        static std::atomic<std::uint64_t> frame{ 1 };
+        return frame;
+    }
+
+    std::size_t alignUp(std::size_t value, std::size_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+FrameArena& FrameArena::local()
+{
+    thread_local FrameArena arena;
+    const std::uint64_t frame = frameCounter().load(std::memory_order_relaxed);
+    if (arena.m_frame != frame) {
+        arena.rewind();
+        arena.m_frame = frame;
+    }
+    return arena;
+}
+
+void FrameArena::nextFrame()
+{
+    frameCounter().fetch_add(1, std::memory_order_relaxed);
+}
+
+void FrameArena::rewind()
+{
+    // Grow to what the last tick needed in total; the spill goes back to the heap.
+    if (!m_overflow.empty()) {
+        m_capacity = std::max(m_capacity * 2, alignUp(m_capacity + m_overflowBytes, kInitialBytes));
+        m_block = std::make_unique<std::byte[]>(m_capacity);
+        m_overflow.clear();
+        m_overflowBytes = 0;
+    }
+    m_used = 0;
+}
+
+void* FrameArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    if (!m_block) {
+        m_capacity = kInitialBytes;
+        m_block = std::make_unique<std::byte[]>(m_capacity);
+    }
+
+    const auto base = reinterpret_cast<std::uintptr_t>(m_block.get());
+    const std::size_t offset = alignUp(base + m_used, alignment) - base;
+    if (offset + bytes <= m_capacity) {
+        m_used = offset + bytes;
+        return m_block.get() + offset;
+    }
+
+    // Out of block for this tick: one heap block per request, padded for alignment.
+    m_overflow.push_back(std::make_unique<std::byte[]>(bytes + alignment));
+    m_overflowBytes += bytes + alignment;
+    const auto spill = reinterpret_cast<std::uintptr_t>(m_overflow.back().get());
+    return m_overflow.back().get() + (alignUp(spill, alignment) - spill);
+}
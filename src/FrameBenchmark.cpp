@@ -0,0 +1,633 @@
+#include "FrameBenchmark.hpp"
+#include "CullingSystem.hpp"
+#include "GpuProfiler.hpp"
+#include "JointStateBuffer.hpp"
+#include "KinematicSystem.hpp"
+#include "MeshCache.hpp"
+#include "OffscreenRenderer.hpp"
+#include "PerfGate.hpp"
+#include "PrimitiveBuilders.hpp"
+#include "RenderingSystem.hpp"
+#include "Scene.hpp"
+#include "SceneBuilder.hpp"
+#include "TransformSystem.hpp"
+#include "URDFParser.hpp"
+#include "components.hpp"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+
+namespace {
+constexpr float kFrameTime = 1.0f / 60.0f;
+constexpr float kRobotSpacing = 2.5f;
+constexpr float kTwoPi = 6.28318530718f;
+
+// std::mt19937's sequence is fixed by the standard, its distributions are
+// not: map the raw bits ourselves so the scene is the same on every library.
+float uniform(std::mt19937& rng, float lo, float hi)
+{
+    return lo + (hi - lo) * float(rng() >> 8) * (1.0f / 16777216.0f);
+}
+
+struct Summary {
+    double p50 = 0.0, p95 = 0.0, p99 = 0.0, mean = 0.0, max = 0.0;
+    int samples = 0;
+};
+
+// Nearest-rank percentiles.
+Summary summarize(std::vector<double> values)
+{
+    Summary s;
+    if (values.empty()) return s;
+    std::sort(values.begin(), values.end());
+    auto rank = [&values](double p) {
+        const std::size_t index = std::size_t(std::ceil(p * double(values.size())));
+        return values[std::clamp<std::size_t>(index, 1, values.size()) - 1];
+    };
+    s.p50 = rank(0.50);
+    s.p95 = rank(0.95);
+    s.p99 = rank(0.99);
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    s.mean = sum / double(values.size());
+    s.max = values.back();
+    s.samples = int(values.size());
+    return s;
+}
+
+QJsonObject toJson(const Summary& s)
+{
+    return QJsonObject{ { "p50", s.p50 }, { "p95", s.p95 }, { "p99", s.p99 },
+        { "mean", s.mean }, { "max", s.max }, { "samples", s.samples } };
+}
+
+bool readVec3(const QJsonValue& value, glm::vec3& out)
+{
+    const QJsonArray a = value.toArray();
+    if (a.size() != 3) return false;
+    out = glm::vec3(float(a[0].toDouble()), float(a[1].toDouble()), float(a[2].toDouble()));
+    return true;
+}
+
+// Raw samples for PerfGate, rounded to the microsecond to keep reports small.
+QJsonArray toJsonSamples(const std::vector<double>& values)
+{
+    QJsonArray array;
+    for (double v : values) array.append(std::round(v * 1000.0) / 1000.0);
+    return array;
+}
+
+glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float u)
+{
+    const float u2 = u * u, u3 = u2 * u;
+    return 0.5f * (2.0f * p1 + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2
+        + (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+}
+
+void addRobots(Scene& scene, const RobotDescription& description, int count)
+{
+    const int side = int(std::ceil(std::sqrt(float(count))));
+    const float origin = -0.5f * kRobotSpacing * float(side - 1);
+    for (int i = 0; i < count; ++i) {
+        RobotDescription placed = description;
+        placed.name += "_" + std::to_string(i);
+        placed.base_origin_xyz = glm::vec3(origin + kRobotSpacing * float(i % side), 0.0f,
+            origin + kRobotSpacing * float(i / side));
+        RobotSceneDelta delta;
+        if (SceneBuilder::prepareRobot(std::move(placed), delta))
+            SceneBuilder::commitRobot(scene, std::move(delta), false);
+    }
+}
+
+// Extra field sources cycling through the effector types, scattered over
+// the middle visualizer pair. Point clouds need a scan file and are left out.
+void addEffectors(entt::registry& registry, std::mt19937& rng, int count)
+{
+    MeshCache::Handle sphere;
+    if (count > 2) {
+        std::vector<Vertex> vertices;
+        std::vector<std::uint32_t> indices;
+        buildIcoSphere(vertices, indices, 2);
+        sphere = MeshCache::shared().intern(std::move(vertices), std::vector<unsigned>(indices.begin(), indices.end()));
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const glm::vec3 at(uniform(rng, -5.0f, 5.0f), uniform(rng, 0.0f, 2.5f), uniform(rng, -5.0f, 5.0f));
+        const float sign = i % 8 < 4 ? 1.0f : -1.0f;   // alternate repulsors and attractors per cycle
+        // Splines come with their own entity from makeCR.
+        entt::entity entity = entt::null;
+        if (i % 4 == 1) {
+            std::vector<glm::vec3> points;
+            for (int k = 0; k < 5; ++k)
+                points.push_back(at + glm::vec3(uniform(rng, -1.5f, 1.5f), uniform(rng, -0.5f, 0.5f), uniform(rng, -1.5f, 1.5f)));
+            entity = SceneBuilder::makeCR(registry, points, { 0.9f, 0.9f, 0.9f, 1.0f }, { 0.3f, 0.9f, 0.9f, 1.0f }, 8.0f);
+        }
+        else {
+            entity = registry.create();
+        }
+        registry.emplace<FieldSourceTag>(entity);
+
+        switch (i % 4) {
+        case 0: {
+            registry.emplace<TagComponent>(entity, "Stress Point " + std::to_string(i));
+            registry.emplace<TransformComponent>(entity).translation = at;
+            auto& point = registry.emplace<PointEffectorComponent>(entity);
+            point.strength = sign * uniform(rng, 2.0f, 10.0f);
+            point.radius = uniform(rng, 1.0f, 4.0f);
+            point.falloff = PointEffectorComponent::FalloffType::Linear;
+            break;
+        }
+        case 1: {
+            registry.emplace<TagComponent>(entity, "Stress Spline " + std::to_string(i));
+            auto& spline = registry.emplace<SplineEffectorComponent>(entity);
+            spline.strength = sign * uniform(rng, 0.5f, 2.0f);
+            spline.radius = uniform(rng, 1.0f, 3.0f);
+            spline.direction = i % 8 == 1 ? SplineEffectorComponent::ForceDirection::Tangent
+                                          : SplineEffectorComponent::ForceDirection::Perpendicular;
+            break;
+        }
+        case 2: {
+            registry.emplace<TagComponent>(entity, "Stress Mesh " + std::to_string(i));
+            auto& xf = registry.emplace<TransformComponent>(entity);
+            xf.translation = at;
+            xf.scale = glm::vec3(uniform(rng, 0.3f, 1.2f));
+            registry.emplace<RenderableMeshComponent>(entity, sphere);
+            auto& mesh = registry.emplace<MeshEffectorComponent>(entity);
+            mesh.strength = sign * uniform(rng, 2.0f, 10.0f);
+            mesh.distance = uniform(rng, 0.5f, 2.0f);
+            break;
+        }
+        default: {
+            registry.emplace<TagComponent>(entity, "Stress Wind " + std::to_string(i));
+            registry.emplace<TransformComponent>(entity);
+            auto& directional = registry.emplace<DirectionalEffectorComponent>(entity);
+            directional.direction = glm::normalize(glm::vec3(uniform(rng, -1.0f, 1.0f), uniform(rng, -0.2f, 0.2f),
+                uniform(rng, -1.0f, 1.0f)) + glm::vec3(1e-3f, 0.0f, 0.0f));
+            directional.strength = uniform(rng, 0.05f, 0.3f);
+            break;
+        }
+        }
+    }
+}
+
+// Fixed sinusoids per DOF, phase-shifted per robot.
+void poseRobots(entt::registry& registry, float time)
+{
+    float phase = 0.0f;
+    for (auto [entity, state] : registry.view<JointStateComponent>().each()) {
+        if (!state.buffer) continue;
+        double* q = state.buffer->position();
+        for (std::size_t i = 0; i < state.buffer->size(); ++i)
+            q[i] = 0.6 * std::sin(0.8 * time * (1.0 + 0.15 * double(i)) + phase);
+        phase += 0.7f;
+    }
+}
+}
+
+bool FrameBenchmark::buildScene(Scene& scene, const Config& config)
+{
+    auto& registry = scene.getRegistry();
+    auto& sceneProps = registry.ctx().emplace<SceneProperties>();
+    sceneProps.fogEnabled = true;
+    sceneProps.fogColor = glm::vec3(0.1f, 0.1f, 0.15f);
+    sceneProps.fogStartDistance = 15.0f;
+    sceneProps.fogEndDistance = 100.0f;
+
+    {
+        auto gridEntity = registry.create();
+        registry.emplace<TagComponent>(gridEntity, "Primary Grid");
+        registry.emplace<TransformComponent>(gridEntity);
+        auto& gridComp = registry.emplace<GridComponent>(gridEntity);
+        gridComp.levels.emplace_back(0.1f, glm::vec3(0.35f, 0.35f, 0.35f), 0.0f, 25.0f);
+        gridComp.levels.emplace_back(1.0f, glm::vec3(1.0f, 0.6f, 0.0f), 5.0f, 50.0f);
+        gridComp.levels.emplace_back(10.0f, glm::vec3(0.28f, 0.56f, 0.86f), 25.0f, 200.0f);
+    }
+    return populateScene(scene, config);
+}
+
+bool FrameBenchmark::populateScene(Scene& scene, const Config& config)
+{
+    auto& registry = scene.getRegistry();
+    std::mt19937 rng(config.seed);
+
+    // --- Robots ---
+    if (config.robots > 0) {
+        RobotDescription description;
+        try {
+            description = URDFParser::parse(config.robotFile.toStdString());
+        }
+        catch (const std::exception& e) {
+            qCritical() << "[FrameBenchmark] Cannot load robot:" << e.what();
+            return false;
+        }
+        addRobots(scene, description, config.robots);
+    }
+
+    // --- Splines: closed loops scattered over the field ---
+    for (int i = 0; i < config.splines; ++i) {
+        const glm::vec3 center(uniform(rng, -6.0f, 6.0f), uniform(rng, 0.2f, 3.0f), uniform(rng, -6.0f, 6.0f));
+        const float radius = uniform(rng, 0.5f, 2.0f);
+        constexpr int kLoopPoints = 8;
+        glm::vec3 ring[kLoopPoints];
+        for (int k = 0; k < kLoopPoints; ++k) {
+            const float a = kTwoPi * float(k) / float(kLoopPoints);
+            ring[k] = center + glm::vec3(radius * std::cos(a), uniform(rng, -0.3f, 0.3f), radius * std::sin(a));
+        }
+        // Three points of overlap close the curve, which runs through p1..p(n-2).
+        std::vector<glm::vec3> points;
+        for (int k = 0; k < kLoopPoints + 3; ++k) points.push_back(ring[k % kLoopPoints]);
+        const glm::vec4 glow(uniform(rng, 0.2f, 1.0f), uniform(rng, 0.2f, 1.0f), uniform(rng, 0.2f, 1.0f), 1.0f);
+        auto spline = SceneBuilder::makeCR(registry, points, { 0.9f, 0.9f, 0.9f, 1.0f }, glow, 14.0f);
+        if (i % 2 == 0) registry.emplace<PulsingSplineTag>(spline);
+    }
+
+    // --- Field: arrow and flow visualizer pairs over the same effectors ---
+    const AABB bounds = { glm::vec3(-6.0f, -1.0f, -6.0f), glm::vec3(6.0f, 3.0f, 6.0f) };
+    for (int v = 0; v < config.visualizers; ++v) {
+        // 0, +13, -13, +26, ... along x: pairs do not overlap.
+        const glm::vec3 offset(13.0f * float((v + 1) / 2) * (v % 2 ? 1.0f : -1.0f), 0.0f, 0.0f);
+        const std::string suffix = v ? " " + std::to_string(v) : std::string();
+
+        auto arrows = registry.create();
+        registry.emplace<TagComponent>(arrows, "Benchmark Arrows" + suffix);
+        registry.emplace<TransformComponent>(arrows).translation = offset;
+        auto& arrowVis = registry.emplace<FieldVisualizerComponent>(arrows);
+        arrowVis.displayMode = FieldVisualizerComponent::DisplayMode::Arrows;
+        arrowVis.bounds = bounds;
+        arrowVis.arrowSettings.density = glm::ivec3(std::max(1, config.arrowDensity));
+        arrowVis.arrowSettings.vectorScale = 0.5f;
+        arrowVis.arrowSettings.headScale = 0.4f;
+        arrowVis.arrowSettings.coloringMode = FieldVisualizerComponent::ColoringMode::Intensity;
+        arrowVis.isEnabled = config.arrowDensity > 0;
+
+        auto flow = registry.create();
+        registry.emplace<TagComponent>(flow, "Benchmark Flow" + suffix);
+        registry.emplace<TransformComponent>(flow).translation = offset;
+        auto& flowVis = registry.emplace<FieldVisualizerComponent>(flow);
+        flowVis.displayMode = FieldVisualizerComponent::DisplayMode::Flow;
+        flowVis.bounds = bounds;
+        flowVis.flowSettings.particleCount = std::max(1, config.particles);
+        flowVis.flowSettings.baseSpeed = 0.15f;
+        flowVis.flowSettings.baseSize = 0.30f;
+        flowVis.flowSettings.randomWalkStrength = 0.1f;
+        flowVis.flowSettings.lifetime = 7.0f;
+        flowVis.isEnabled = config.particles > 0;
+    }
+    {
+        auto wind = registry.create();
+        registry.emplace<TagComponent>(wind, "Wind Source");
+        registry.emplace<TransformComponent>(wind);
+        registry.emplace<FieldSourceTag>(wind);
+        auto& directional = registry.emplace<DirectionalEffectorComponent>(wind);
+        directional.direction = { 1.0f, 0.0f, 0.5f };
+        directional.strength = 0.6f;
+
+        for (const glm::vec3& at : { glm::vec3(4.0f, 1.0f, 0.0f), glm::vec3(-3.0f, 1.0f, 3.0f) }) {
+            auto repulsor = registry.create();
+            registry.emplace<TagComponent>(repulsor, "Repulsor");
+            registry.emplace<TransformComponent>(repulsor).translation = at;
+            registry.emplace<FieldSourceTag>(repulsor);
+            auto& point = registry.emplace<PointEffectorComponent>(repulsor);
+            point.strength = 10.0f;
+            point.radius = 4.0f;
+            point.falloff = PointEffectorComponent::FalloffType::Linear;
+        }
+    }
+    addEffectors(registry, rng, config.effectors);
+    return true;
+}
+
+FrameBenchmark::SceneStats FrameBenchmark::sceneStats(const entt::registry& registry)
+{
+    SceneStats stats;
+    stats.entities = registry.storage<entt::entity>()->free_list();
+    for (auto [entity, mesh] : registry.view<RenderableMeshComponent>().each())
+        stats.triangles += mesh.indices().size() / 3;
+    stats.effectors = registry.view<FieldSourceTag>().size();
+    return stats;
+}
+
+bool FrameBenchmark::setParameter(Config& config, const QString& key, int value)
+{
+    if (key == "robots") config.robots = value;
+    else if (key == "splines") config.splines = value;
+    else if (key == "arrows") config.arrowDensity = value;
+    else if (key == "particles") config.particles = value;
+    else if (key == "visualizers") config.visualizers = value;
+    else if (key == "effectors") config.effectors = value;
+    else if (key == "seed") config.seed = std::uint32_t(value);
+    else return false;
+    return true;
+}
+
+bool FrameBenchmark::parseParameters(Config& config, const QString& list)
+{
+    for (const QString& item : list.split(',', Qt::SkipEmptyParts)) {
+        const QStringList kv = item.split('=');
+        bool ok = kv.size() == 2;
+        const int value = ok ? kv[1].trimmed().toInt(&ok) : 0;
+        if (!ok || !setParameter(config, kv[0].trimmed(), value)) {
+            qWarning() << "[FrameBenchmark] Bad scene parameter" << item;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<FrameBenchmark::CameraKey> FrameBenchmark::loadCameraPath(const QString& path)
+{
+    const QJsonArray array = PerfGate::readJson(path).value("keys").toArray();
+    std::vector<CameraKey> keys;
+    for (const QJsonValue& value : array) {
+        const QJsonObject object = value.toObject();
+        CameraKey key;
+        key.time = float(object.value("time").toDouble());
+        if (!readVec3(object.value("position"), key.position) || !readVec3(object.value("target"), key.target)) {
+            qWarning() << "[FrameBenchmark] Malformed camera key in" << path;
+            return {};
+        }
+        keys.push_back(key);
+    }
+    std::stable_sort(keys.begin(), keys.end(), [](const CameraKey& a, const CameraKey& b) { return a.time < b.time; });
+    return keys;
+}
+
+std::vector<FrameBenchmark::CameraKey> FrameBenchmark::defaultCameraPath()
+{
+    constexpr int kKeys = 21;
+    constexpr float kDuration = 20.0f;
+    std::vector<CameraKey> keys;
+    for (int i = 0; i < kKeys; ++i) {
+        const float t = kDuration * float(i) / float(kKeys - 1);
+        const float angle = 2.0f * kTwoPi * t / kDuration;
+        const float radius = 9.0f + 3.0f * std::sin(0.5f * angle);
+        keys.push_back({ t, glm::vec3(radius * std::cos(angle), 3.0f + 2.0f * std::sin(angle), radius * std::sin(angle)),
+            glm::vec3(0.0f, 1.0f, 0.0f) });
+    }
+    return keys;
+}
+
+FrameBenchmark::CameraKey FrameBenchmark::sampleCameraPath(const std::vector<CameraKey>& keys, float time)
+{
+    if (keys.empty()) return { time, glm::vec3(0.0f, 3.0f, 10.0f), glm::vec3(0.0f) };
+    if (keys.size() == 1 || time <= keys.front().time) return { time, keys.front().position, keys.front().target };
+    if (time >= keys.back().time) return { time, keys.back().position, keys.back().target };
+
+    std::size_t i = 0;
+    while (keys[i + 1].time <= time) ++i;
+    const CameraKey& k0 = keys[i > 0 ? i - 1 : 0];
+    const CameraKey& k1 = keys[i];
+    const CameraKey& k2 = keys[i + 1];
+    const CameraKey& k3 = keys[std::min(i + 2, keys.size() - 1)];
+    const float span = k2.time - k1.time;
+    const float u = span > 0.0f ? (time - k1.time) / span : 0.0f;
+    return { time, catmullRom(k0.position, k1.position, k2.position, k3.position, u),
+        catmullRom(k0.target, k1.target, k2.target, k3.target, u) };
+}
+
+QJsonObject FrameBenchmark::measure(const Config& config)
+{
+    Scene scene;
+    if (!buildScene(scene, config)) return {};
+    auto& registry = scene.getRegistry();
+    const SceneStats stats = sceneStats(registry);
+
+    std::vector<CameraKey> path = config.cameraPath.isEmpty() ? defaultCameraPath() : loadCameraPath(config.cameraPath);
+    if (path.empty()) {
+        qCritical() << "[FrameBenchmark] No usable camera path in" << config.cameraPath;
+        return {};
+    }
+    const float pathDuration = path.back().time;
+
+    const entt::entity cameraEntity = registry.create();
+    registry.emplace<CameraComponent>(cameraEntity);
+    registry.emplace<TransformComponent>(cameraEntity);
+
+    RenderingSystem renderer(nullptr);
+    renderer.setDynamicResolution(false);
+    renderer.setRandomSeed(config.seed);
+    renderer.setProfilingEnabled(true);
+    renderer.setProfileCapture(true);
+
+    OffscreenRenderer offscreen(renderer);
+    if (!offscreen.create(config.width, config.height)) return {};
+    offscreen.setReadbackEnabled(false);
+
+    QJsonObject gl;
+    if (QOpenGLContext* context = QOpenGLContext::currentContext()) {
+        QOpenGLFunctions* f = context->functions();
+        auto str = [f](GLenum name) { return QString::fromLatin1(reinterpret_cast<const char*>(f->glGetString(name))); };
+        gl = QJsonObject{ { "vendor", str(GL_VENDOR) }, { "renderer", str(GL_RENDERER) }, { "version", str(GL_VERSION) } };
+    }
+
+    const int warmup = std::max(0, config.warmupFrames);
+    const int measured = std::max(1, config.frames);
+    // The profiler's results arrive up to kSlots frames late.
+    const int total = warmup + measured + GpuProfiler::kSlots + 1;
+
+    std::vector<double> wallMs;
+    wallMs.reserve(std::size_t(measured));
+    auto frameStart = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < total; ++frame) {
+        const float time = float(frame) * kFrameTime;
+
+        poseRobots(registry, time);
+        KinematicSystem::applyJointPositions(registry);
+        renderer.updateAnimations(registry);
+        renderer.updateSceneLogic(registry, kFrameTime);
+
+        const CameraKey key = sampleCameraPath(path, pathDuration > 0.0f ? std::fmod(time, pathDuration) : 0.0f);
+        registry.get<CameraComponent>(cameraEntity).camera.forceRecalculateView(key.position, key.target, 0.0f);
+        renderer.updateCameraTransforms(registry);
+        TransformSystem::propagate(registry);
+        CullingSystem::updateWorldBounds(registry);
+
+        offscreen.renderFrame(registry, cameraEntity, kFrameTime);
+
+        const auto now = std::chrono::steady_clock::now();
+        if (frame >= warmup && frame < warmup + measured)
+            wallMs.push_back(std::chrono::duration<double, std::milli>(now - frameStart).count());
+        frameStart = now;
+    }
+    offscreen.finish();
+
+    // --- Per-frame sums and per-pass samples of the measured frames ---
+    const GpuProfiler* profiler = renderer.profiler(&offscreen);
+    if (!profiler) {
+        qCritical() << "[FrameBenchmark] The renderer recorded no timings.";
+        return {};
+    }
+    std::map<std::uint64_t, std::pair<double, double>> frames;   // frame -> gpu, cpu ms
+    std::map<std::string, std::pair<std::vector<double>, std::vector<double>>> passes;
+    for (const GpuProfiler::TraceEvent& e : profiler->capturedEvents()) {
+        if (e.frame < std::uint64_t(warmup) || e.frame >= std::uint64_t(warmup + measured)) continue;
+        auto& sums = frames[e.frame];
+        sums.first += e.gpuDurUs * 1e-3;
+        sums.second += e.cpuDurUs * 1e-3;
+        auto& samples = passes[e.name];
+        samples.first.push_back(e.gpuDurUs * 1e-3);
+        samples.second.push_back(e.cpuDurUs * 1e-3);
+    }
+    std::vector<double> gpuMs, cpuMs;
+    for (const auto& [frame, sums] : frames) {
+        gpuMs.push_back(sums.first);
+        cpuMs.push_back(sums.second);
+    }
+    if (int(frames.size()) < measured)
+        qWarning() << "[FrameBenchmark]" << measured - int(frames.size()) << "of" << measured
+                   << "frames have no GPU timings (queries still in flight when their slot was reused).";
+
+    QJsonObject passJson, sampleJson{ { "frame.gpuMs", toJsonSamples(gpuMs) }, { "frame.cpuMs", toJsonSamples(cpuMs) },
+        { "frame.wallMs", toJsonSamples(wallMs) } };
+    for (const auto& [name, samples] : passes) {
+        const QString pass = QString::fromStdString(name);
+        passJson.insert(pass, QJsonObject{
+            { "gpuMs", toJson(summarize(samples.first)) }, { "cpuMs", toJson(summarize(samples.second)) } });
+        sampleJson.insert(pass + ".gpuMs", toJsonSamples(samples.first));
+        sampleJson.insert(pass + ".cpuMs", toJsonSamples(samples.second));
+    }
+
+    const QJsonObject configJson{
+        { "robots", config.robots }, { "splines", config.splines }, { "arrowDensity", config.arrowDensity },
+        { "particles", config.particles }, { "visualizers", config.visualizers }, { "effectors", config.effectors },
+        { "frames", measured }, { "warmupFrames", warmup },
+        { "width", offscreen.width() }, { "height", offscreen.height() }, { "seed", qint64(config.seed) },
+        { "robotFile", config.robotFile }, { "cameraPath", config.cameraPath } };
+
+    const Summary gpu = summarize(gpuMs), cpu = summarize(cpuMs), wall = summarize(wallMs);
+    const QJsonObject report{
+        { "gl", gl },
+        { "config", configJson },
+        { "scene", QJsonObject{ { "entities", qint64(stats.entities) }, { "triangles", qint64(stats.triangles) },
+            { "effectors", qint64(stats.effectors) } } },
+        { "frame", QJsonObject{ { "gpuMs", toJson(gpu) }, { "cpuMs", toJson(cpu) }, { "wallMs", toJson(wall) } } },
+        { "passes", passJson },
+        { "samples", sampleJson } };
+
+    qInfo().noquote() << QStringLiteral("[FrameBenchmark] %1 frames: GPU p50 %2 / p95 %3 / p99 %4 ms, wall p50 %5 / p95 %6 / p99 %7 ms")
+        .arg(measured).arg(gpu.p50, 0, 'f', 3).arg(gpu.p95, 0, 'f', 3).arg(gpu.p99, 0, 'f', 3)
+        .arg(wall.p50, 0, 'f', 3).arg(wall.p95, 0, 'f', 3).arg(wall.p99, 0, 'f', 3);
+    return report;
+}
+
+bool FrameBenchmark::run(const Config& config, const QString& reportPath)
+{
+    const QJsonObject report = measure(config);
+    return !report.isEmpty() && PerfGate::writeJson(reportPath, report);
+}
+
+bool FrameBenchmark::runSweep(const Config& config, const QString& parameter, const std::vector<int>& values,
+    const QString& reportPath)
+{
+    Config probe = config;
+    if (values.empty() || !setParameter(probe, parameter, values.front())) {
+        qCritical() << "[FrameBenchmark] Cannot sweep" << parameter;
+        return false;
+    }
+
+    QJsonObject gl;
+    QJsonArray runs;
+    for (int value : values) {
+        Config point = config;
+        setParameter(point, parameter, value);
+        qInfo().noquote() << QStringLiteral("[FrameBenchmark] sweep %1 = %2").arg(parameter).arg(value);
+        QJsonObject report = measure(point);
+        if (report.isEmpty()) return false;
+        gl = report.take("gl").toObject();
+        report.insert("value", value);
+        runs.append(report);
+    }
+
+    // p95 growth against parameter growth, first run to last: 1 is linear.
+    QJsonObject scaling;
+    const double valueRatio = values.front() > 0 ? double(values.back()) / double(values.front()) : 0.0;
+    if (valueRatio > 1.0) {
+        const QJsonObject first = runs.first().toObject(), last = runs.last().toObject();
+        auto exponent = [valueRatio](const QJsonValue& a, const QJsonValue& b) -> QJsonValue {
+            const double before = a.toObject().value("p95").toDouble(), after = b.toObject().value("p95").toDouble();
+            if (before <= 0.0 || after <= 0.0) return QJsonValue();
+            return std::log(after / before) / std::log(valueRatio);
+        };
+        const QJsonObject frameA = first.value("frame").toObject(), frameB = last.value("frame").toObject();
+        for (const char* metric : { "gpuMs", "cpuMs", "wallMs" })
+            scaling.insert(QStringLiteral("frame.") + metric, exponent(frameA.value(metric), frameB.value(metric)));
+        const QJsonObject passesA = first.value("passes").toObject(), passesB = last.value("passes").toObject();
+        for (auto it = passesB.begin(); it != passesB.end(); ++it)
+            if (passesA.contains(it.key()))
+                scaling.insert(it.key(), exponent(passesA.value(it.key()).toObject().value("gpuMs"),
+                    it.value().toObject().value("gpuMs")));
+    }
+    else {
+        qWarning() << "[FrameBenchmark] Sweep values must start above 0 and grow for scaling exponents.";
+    }
+
+    for (const QJsonValue& value : runs) {
+        const QJsonObject run = value.toObject();
+        const QJsonObject counts = run.value("scene").toObject(), frame = run.value("frame").toObject();
+        qInfo().noquote() << QStringLiteral("[FrameBenchmark] %1 %2: %3 entities, %4 triangles, %5 effectors, GPU p95 %6 ms, CPU p95 %7 ms")
+            .arg(parameter).arg(run.value("value").toInt(), 6)
+            .arg(counts.value("entities").toInteger()).arg(counts.value("triangles").toInteger())
+            .arg(counts.value("effectors").toInteger())
+            .arg(frame.value("gpuMs").toObject().value("p95").toDouble(), 0, 'f', 3)
+            .arg(frame.value("cpuMs").toObject().value("p95").toDouble(), 0, 'f', 3);
+    }
+    for (auto it = scaling.begin(); it != scaling.end(); ++it)
+        if (it.value().isDouble())
+            qInfo().noquote() << QStringLiteral("[FrameBenchmark]   %1 scales with exponent %2%3").arg(it.key())
+                .arg(it.value().toDouble(), 0, 'f', 2).arg(it.value().toDouble() > 1.2 ? "  SUPERLINEAR" : "");
+
+    return PerfGate::writeJson(reportPath, QJsonObject{ { "gl", gl }, { "sweep", parameter }, { "runs", runs },
+        { "scaling", scaling } });
+}
+
+bool FrameBenchmark::compareWithBaseline(const QString& reportPath, const QString& baselinePath,
+    const PerfGate::Thresholds& thresholds, const QString& verdictPath)
+{
+    const QJsonObject report = PerfGate::readJson(reportPath), baseline = PerfGate::readJson(baselinePath);
+    if (report.isEmpty() || baseline.isEmpty()) {
+        qCritical() << "[FrameBenchmark] Cannot read" << (report.isEmpty() ? reportPath : baselinePath);
+        return false;
+    }
+    if (report.value("config") != baseline.value("config"))
+        qWarning() << "[FrameBenchmark] The baseline was run with a different configuration.";
+    if (report.value("gl") != baseline.value("gl"))
+        qWarning() << "[FrameBenchmark] The baseline was run on" << baseline.value("gl").toObject().value("renderer").toString();
+
+    auto samples = [](const QJsonValue& value) {
+        std::vector<double> out;
+        for (const QJsonValue& v : value.toArray()) out.push_back(v.toDouble());
+        return out;
+    };
+    const QJsonObject now = report.value("samples").toObject(), before = baseline.value("samples").toObject();
+    if (before.isEmpty()) {
+        qCritical() << "[FrameBenchmark]" << baselinePath << "has no samples; record it again.";
+        return false;
+    }
+    std::vector<PerfGate::Comparison> comparisons;
+    for (auto it = before.begin(); it != before.end(); ++it)
+        comparisons.push_back(PerfGate::compare(it.key(), samples(it.value()), samples(now.value(it.key())), thresholds));
+    for (auto it = now.begin(); it != now.end(); ++it)
+        if (!before.contains(it.key())) comparisons.push_back(PerfGate::compare(it.key(), {}, samples(it.value()), thresholds));
+
+    const QJsonObject verdict = PerfGate::verdictReport(std::move(comparisons), thresholds,
+        machineKey(report));
+    if (!verdictPath.isEmpty() && !PerfGate::writeJson(verdictPath, verdict)) return false;
+    return PerfGate::passed(verdict);
+}
+
+QString FrameBenchmark::machineKey(const QJsonObject& report)
+{
+    return PerfGate::machineKey(report.value("gl").toObject().value("renderer").toString());
+}
@@ -0,0 +1,72 @@
+#include "GLStateCache.hpp"
+#include "Shader.hpp"
+
+#include <QOpenGLFunctions_4_3_Core>
+
+void GLStateCache::toggle(std::int8_t& cached, bool on, GLenum cap)
+{
+    if (cached == std::int8_t(on)) return;
+    if (on) m_gl->glEnable(cap);
+    else    m_gl->glDisable(cap);
+    cached = std::int8_t(on);
+}
+
+void GLStateCache::setBlend(bool on)       { toggle(m_state.blend, on, GL_BLEND); }
+void GLStateCache::setDepthTest(bool on)   { toggle(m_state.depthTest, on, GL_DEPTH_TEST); }
+void GLStateCache::setCullFace(bool on)    { toggle(m_state.cullFace, on, GL_CULL_FACE); }
+void GLStateCache::setStencilTest(bool on) { toggle(m_state.stencilTest, on, GL_STENCIL_TEST); }
+
+void GLStateCache::setDepthMask(bool on)
+{
+    if (m_state.depthMask == std::int8_t(on)) return;
+    m_gl->glDepthMask(on ? GL_TRUE : GL_FALSE);
+    m_state.depthMask = std::int8_t(on);
+}
+
+void GLStateCache::setBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha)
+{
+    if (m_state.blendSrcRGB == srcRGB && m_state.blendDstRGB == dstRGB
+        && m_state.blendSrcAlpha == srcAlpha && m_state.blendDstAlpha == dstAlpha) return;
+    m_gl->glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+    m_state.blendSrcRGB = srcRGB;
+    m_state.blendDstRGB = dstRGB;
+    m_state.blendSrcAlpha = srcAlpha;
+    m_state.blendDstAlpha = dstAlpha;
+}
+
+void GLStateCache::use(const Shader& shader) { useProgram(shader.ID); }
+
+void GLStateCache::useProgram(GLuint program)
+{
+    if (m_state.program == program) return;
+    m_gl->glUseProgram(program);
+    m_state.program = program;
+}
+
+void GLStateCache::bindVertexArray(GLuint vao)
+{
+    if (m_state.vertexArray == vao) return;
+    m_gl->glBindVertexArray(vao);
+    m_state.vertexArray = vao;
+}
+
+void GLStateCache::bindFramebuffer(GLuint fbo)
+{
+    if (m_state.drawFramebuffer == fbo) return;
+    m_gl->glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    m_state.drawFramebuffer = fbo;
+}
+
+void GLStateCache::restore(const State& saved)
+{
+    if (saved.blend >= 0)       setBlend(saved.blend != 0);
+    if (saved.depthTest >= 0)   setDepthTest(saved.depthTest != 0);
+    if (saved.depthMask >= 0)   setDepthMask(saved.depthMask != 0);
+    if (saved.cullFace >= 0)    setCullFace(saved.cullFace != 0);
+    if (saved.stencilTest >= 0) setStencilTest(saved.stencilTest != 0);
+    if (saved.blendSrcRGB != kUnknownEnum)
+        setBlendFuncSeparate(saved.blendSrcRGB, saved.blendDstRGB, saved.blendSrcAlpha, saved.blendDstAlpha);
+    if (saved.program != kUnknownName)         useProgram(saved.program);
+    if (saved.vertexArray != kUnknownName)     bindVertexArray(saved.vertexArray);
+    if (saved.drawFramebuffer != kUnknownName) bindFramebuffer(saved.drawFramebuffer);
+}
@@ -0,0 +1,499 @@
+#include "GltfExport.hpp"
+#include "RenderLayers.hpp"
+#include "ThreadPool.hpp"
+#include "TraceZones.hpp"
+#include "components.hpp"
+
+#include <QSaveFile>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <map>
+#include <unordered_map>
+#include <entt/entt.hpp>
+
+namespace
+{
+    constexpr std::uint32_t kGlbMagic = 0x46546C67;   ///< "glTF"
+    constexpr std::uint32_t kJsonChunk = 0x4E4F534A;  ///< "JSON"
+    constexpr std::uint32_t kBinChunk = 0x004E4942;   ///< "BIN\0"
+    constexpr std::uint32_t kFloat = 5126, kShort = 5122, kByte = 5120, kUShort = 5123, kUInt = 5125;
+
+    static_assert(sizeof(Vertex) == 32, "Vertex is written as the unquantized glTF vertex");
+
+    std::uint64_t align4(std::uint64_t offset) { return (offset + 3) & ~std::uint64_t(3); }
+
+    struct Bounds {
+        glm::vec3 min{ 0.0f }, max{ 0.0f };
+        glm::vec3 centre() const { return 0.5f * (min + max); }
+        // One scale for all three axes, so the decoding node keeps normals upright.
+        float halfExtent() const { return std::max(1e-12f, 0.5f * std::max({ max.x - min.x, max.y - min.y, max.z - min.z })); }
+    };
+
+    std::int16_t quantizePosition(float p, float centre, float halfExtent)
+    {
+        return std::int16_t(std::lround(std::clamp((p - centre) / halfExtent, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    std::int8_t quantizeNormal(float n)
+    {
+        return std::int8_t(std::lround(std::clamp(n, -1.0f, 1.0f) * 127.0f));
+    }
+
+    // Where one MeshData's two buffer views sit in the binary chunk.
+    struct Layout {
+        std::uint64_t vertexOffset = 0, vertexBytes = 0;
+        std::uint64_t indexOffset = 0, indexBytes = 0;   ///< padded to 4
+        bool shortIndices = false;
+    };
+
+    // Minimal JSON text builder: values are appended as written, commas
+    // between siblings are handled by open()/key()/value().
+    class Json
+    {
+    public:
+        void open(char bracket) { separate(); m_text += bracket; m_first = true; }
+        void close(char bracket) { m_text += bracket; m_first = false; }
+        void key(const char* name) { separate(); string(name); m_text += ':'; m_first = true; }
+        void value(double v)
+        {
+            separate();
+            char buffer[32];
+            std::snprintf(buffer, sizeof buffer, "%.9g", v);
+            m_text += buffer;
+        }
+        void value(std::uint64_t v) { separate(); m_text += std::to_string(v); }
+        void value(int v) { separate(); m_text += std::to_string(v); }
+        void value(bool v) { separate(); m_text += v ? "true" : "false"; }
+        void value(const std::string& s) { separate(); string(s.c_str()); }
+        void value(const char* s) { separate(); string(s); }
+        template<int N>
+        void array(const glm::vec<N, float>& v)
+        {
+            open('[');
+            for (int i = 0; i < N; ++i) value(double(v[i]));
+            close(']');
+        }
+        std::string& text() { return m_text; }
+
+    private:
+        void separate()
+        {
+            if (!m_first) m_text += ',';
+            m_first = false;
+        }
+        void string(const char* s)
+        {
+            m_text += '"';
+            for (; *s; ++s) {
+                const unsigned char c = static_cast<unsigned char>(*s);
+                if (c == '"' || c == '\\') (m_text += '\\') += char(c);
+                else if (c < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof buffer, "\\u%04x", c);
+                    m_text += buffer;
+                }
+                else m_text += char(c);
+            }
+            m_text += '"';
+        }
+
+        std::string m_text;
+        bool m_first = true;
+    };
+
+    void putLe32(unsigned char* out, std::uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i) out[i] = static_cast<unsigned char>(v >> (8 * i));
+    }
+}
+
+struct GltfExport::Plan
+{
+    struct Node {
+        std::string name;
+        glm::vec3 translation{ 0.0f };
+        glm::quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+        glm::vec3 scale{ 1.0f };
+        int parent = -1;
+        int mesh = -1;                                  ///< into 'primitives'
+        std::vector<int> children;
+    };
+    // A glTF mesh: one MeshData drawn with one material.
+    struct Primitive {
+        int data = 0;                                   ///< into 'meshes'
+        int material = -1;
+    };
+    struct Material {
+        glm::vec3 albedo{ 0.8f };
+        float metallic = 0.0f, roughness = 1.0f;
+        glm::vec3 emissive{ 0.0f };
+    };
+
+    Options options;
+    std::vector<Node> nodes;
+    std::vector<std::shared_ptr<const MeshData>> meshes;
+    std::vector<Primitive> primitives;
+    std::vector<Material> materials;
+};
+
+std::size_t GltfExport::meshCount(const Plan& plan) { return plan.meshes.size(); }
+std::size_t GltfExport::nodeCount(const Plan& plan) { return plan.nodes.size(); }
+
+std::shared_ptr<const GltfExport::Plan> GltfExport::gather(const entt::registry& registry, const Options& options)
+{
+    KR_ZONE("GltfExport::gather");
+    auto plan = std::make_shared<Plan>();
+    plan->options = options;
+
+    std::unordered_map<entt::entity, int> nodeOf;
+    std::unordered_map<const MeshData*, int> meshOf;
+    std::map<std::pair<int, int>, int> primitiveOf;
+    std::map<std::array<float, 8>, int> materialOf;
+
+    const auto transforms = registry.view<const TransformComponent>();
+    nodeOf.reserve(transforms.size());
+    for (const entt::entity entity : transforms) {
+        const auto& transform = transforms.get<const TransformComponent>(entity);
+        nodeOf.emplace(entity, int(plan->nodes.size()));
+        Plan::Node& node = plan->nodes.emplace_back();
+        node.translation = transform.translation;
+        node.rotation = transform.rotation;
+        node.scale = transform.scale;
+        if (const auto* tag = registry.try_get<TagComponent>(entity)) node.name = tag->tag;
+
+        const auto* renderable = registry.try_get<RenderableMeshComponent>(entity);
+        const auto* layer = registry.try_get<LayerComponent>(entity);
+        if (!renderable || !renderable->mesh || renderable->mesh->indices.empty()
+            || !((layer ? layer->mask : RenderLayers::Visual) & RenderLayers::Visual))
+            continue;
+
+        const auto [data, newMesh] = meshOf.emplace(renderable->mesh.get(), int(plan->meshes.size()));
+        if (newMesh) plan->meshes.push_back(renderable->mesh);
+        int material = -1;
+        if (const auto* m = registry.try_get<MaterialComponent>(entity)) {
+            const std::array<float, 8> key = { m->albedo.x, m->albedo.y, m->albedo.z, m->metallic, m->roughness,
+                m->emissive.x, m->emissive.y, m->emissive.z };
+            const auto [it, inserted] = materialOf.emplace(key, int(plan->materials.size()));
+            if (inserted) plan->materials.push_back({ m->albedo, m->metallic, m->roughness, m->emissive });
+            material = it->second;
+        }
+        const auto [primitive, newPrimitive] = primitiveOf.emplace(std::make_pair(data->second, material), int(plan->primitives.size()));
+        if (newPrimitive) plan->primitives.push_back({ data->second, material });
+        node.mesh = primitive->second;
+    }
+
+    for (const entt::entity entity : transforms) {
+        const auto* parent = registry.try_get<ParentComponent>(entity);
+        if (!parent) continue;
+        const auto it = nodeOf.find(parent->parent);
+        if (it == nodeOf.end()) continue;
+        const int child = nodeOf[entity];
+        plan->nodes[std::size_t(child)].parent = it->second;
+        plan->nodes[std::size_t(it->second)].children.push_back(child);
+    }
+    return plan;
+}
+
+bool GltfExport::write(const Plan& plan, const std::string& path, std::string* error)
+{
+    KR_ZONE("GltfExport::write");
+    const bool quantize = plan.options.quantize;
+    const std::uint64_t stride = quantize ? 20 : sizeof(Vertex);
+
+    // --- 1. Bounds (the accessors need them, quantization too) ---
+    std::vector<Bounds> bounds(plan.meshes.size());
+    ThreadPool::shared().parallelFor(plan.meshes.size(), [&](std::size_t i) {
+        const auto& vertices = plan.meshes[i]->vertices;
+        Bounds& b = bounds[i];
+        if (vertices.empty()) return;
+        b.min = b.max = vertices.front().position;
+        for (const Vertex& v : vertices) {
+            b.min = glm::min(b.min, v.position);
+            b.max = glm::max(b.max, v.position);
+        }
+    });
+
+    // --- 2. Layout, from the counts alone ---
+    std::vector<Layout> layouts(plan.meshes.size());
+    std::uint64_t binBytes = 0;
+    for (std::size_t i = 0; i < plan.meshes.size(); ++i) {
+        const MeshData& mesh = *plan.meshes[i];
+        Layout& l = layouts[i];
+        // 65535 is reserved as a restart value, so short indices need one vertex fewer.
+        l.shortIndices = mesh.vertices.size() < 65535;
+        l.vertexOffset = binBytes;
+        l.vertexBytes = mesh.vertices.size() * stride;
+        l.indexOffset = l.vertexOffset + l.vertexBytes;
+        l.indexBytes = align4(mesh.indices.size() * (l.shortIndices ? 2 : 4));
+        binBytes = l.indexOffset + l.indexBytes;
+    }
+
+    // --- 3. JSON ---
+    Json json;
+    json.open('{');
+    json.key("asset");
+    json.open('{');
+    json.key("version"); json.value("2.0");
+    json.key("generator"); json.value("RoboticsSoftware");
+    json.close('}');
+    if (quantize) {
+        for (const char* list : { "extensionsUsed", "extensionsRequired" }) {
+            json.key(list);
+            json.open('[');
+            json.value("KHR_mesh_quantization");
+            json.close(']');
+        }
+    }
+    json.key("scene"); json.value(0);
+    json.key("scenes");
+    json.open('[');
+    json.open('{');
+    json.key("nodes");
+    json.open('[');
+    for (std::size_t i = 0; i < plan.nodes.size(); ++i)
+        if (plan.nodes[i].parent < 0) json.value(int(i));
+    json.close(']');
+    json.close('}');
+    json.close(']');
+
+    // With quantization each instance's mesh hangs off a child node that
+    // decodes it; those follow the scene's nodes.
+    json.key("nodes");
+    json.open('[');
+    int decodeNode = int(plan.nodes.size());
+    for (const Plan::Node& node : plan.nodes) {
+        json.open('{');
+        if (!node.name.empty()) { json.key("name"); json.value(node.name); }
+        if (node.translation != glm::vec3(0.0f)) { json.key("translation"); json.array(node.translation); }
+        if (node.rotation != glm::quat(1.0f, 0.0f, 0.0f, 0.0f)) {
+            json.key("rotation");
+            json.array(glm::vec4(node.rotation.x, node.rotation.y, node.rotation.z, node.rotation.w));
+        }
+        if (node.scale != glm::vec3(1.0f)) { json.key("scale"); json.array(node.scale); }
+        if (node.mesh >= 0 && !quantize) { json.key("mesh"); json.value(node.mesh); }
+        if (!node.children.empty() || (node.mesh >= 0 && quantize)) {
+            json.key("children");
+            json.open('[');
+            for (const int child : node.children) json.value(child);
+            if (node.mesh >= 0 && quantize) json.value(decodeNode++);
+            json.close(']');
+        }
+        json.close('}');
+    }
+    if (quantize) {
+        for (const Plan::Node& node : plan.nodes) {
+            if (node.mesh < 0) continue;
+            const Bounds& b = bounds[std::size_t(plan.primitives[std::size_t(node.mesh)].data)];
+            json.open('{');
+            json.key("mesh"); json.value(node.mesh);
+            json.key("translation"); json.array(b.centre());
+            json.key("scale"); json.array(glm::vec3(b.halfExtent()));
+            json.close('}');
+        }
+    }
+    json.close(']');
+
+    json.key("meshes");
+    json.open('[');
+    for (const Plan::Primitive& primitive : plan.primitives) {
+        const int accessor = primitive.data * 4;
+        json.open('{');
+        json.key("primitives");
+        json.open('[');
+        json.open('{');
+        json.key("attributes");
+        json.open('{');
+        json.key("POSITION"); json.value(accessor);
+        json.key("NORMAL"); json.value(accessor + 1);
+        json.key("TEXCOORD_0"); json.value(accessor + 2);
+        json.close('}');
+        json.key("indices"); json.value(accessor + 3);
+        if (primitive.material >= 0) { json.key("material"); json.value(primitive.material); }
+        json.close('}');
+        json.close(']');
+        json.close('}');
+    }
+    json.close(']');
+
+    if (!plan.materials.empty()) {
+        json.key("materials");
+        json.open('[');
+        for (const Plan::Material& m : plan.materials) {
+            json.open('{');
+            json.key("pbrMetallicRoughness");
+            json.open('{');
+            json.key("baseColorFactor"); json.array(glm::vec4(glm::clamp(m.albedo, 0.0f, 1.0f), 1.0f));
+            json.key("metallicFactor"); json.value(double(std::clamp(m.metallic, 0.0f, 1.0f)));
+            json.key("roughnessFactor"); json.value(double(std::clamp(m.roughness, 0.0f, 1.0f)));
+            json.close('}');
+            if (m.emissive != glm::vec3(0.0f)) { json.key("emissiveFactor"); json.array(glm::clamp(m.emissive, 0.0f, 1.0f)); }
+            json.close('}');
+        }
+        json.close(']');
+    }
+
+    json.key("accessors");
+    json.open('[');
+    for (std::size_t i = 0; i < plan.meshes.size(); ++i) {
+        const MeshData& mesh = *plan.meshes[i];
+        const Bounds& b = bounds[i];
+        const int view = int(i) * 2;
+        const std::uint64_t count = mesh.vertices.size();
+        // POSITION; bounds in the stored values, as the spec asks.
+        json.open('{');
+        json.key("bufferView"); json.value(view);
+        json.key("componentType"); json.value(std::uint64_t(quantize ? kShort : kFloat));
+        if (quantize) { json.key("normalized"); json.value(true); }
+        json.key("count"); json.value(count);
+        json.key("type"); json.value("VEC3");
+        glm::vec3 lo = b.min, hi = b.max;
+        if (quantize) {
+            const glm::vec3 c = b.centre();
+            const float h = b.halfExtent();
+            for (int a = 0; a < 3; ++a) {
+                lo[a] = float(quantizePosition(b.min[a], c[a], h));
+                hi[a] = float(quantizePosition(b.max[a], c[a], h));
+            }
+        }
+        json.key("min"); json.array(lo);
+        json.key("max"); json.array(hi);
+        json.close('}');
+        // NORMAL, TEXCOORD_0
+        json.open('{');
+        json.key("bufferView"); json.value(view);
+        json.key("byteOffset"); json.value(quantize ? 8 : 12);
+        json.key("componentType"); json.value(std::uint64_t(quantize ? kByte : kFloat));
+        if (quantize) { json.key("normalized"); json.value(true); }
+        json.key("count"); json.value(count);
+        json.key("type"); json.value("VEC3");
+        json.close('}');
+        json.open('{');
+        json.key("bufferView"); json.value(view);
+        json.key("byteOffset"); json.value(quantize ? 12 : 24);
+        json.key("componentType"); json.value(std::uint64_t(kFloat));
+        json.key("count"); json.value(count);
+        json.key("type"); json.value("VEC2");
+        json.close('}');
+        // Indices
+        json.open('{');
+        json.key("bufferView"); json.value(view + 1);
+        json.key("componentType"); json.value(std::uint64_t(layouts[i].shortIndices ? kUShort : kUInt));
+        json.key("count"); json.value(std::uint64_t(mesh.indices.size()));
+        json.key("type"); json.value("SCALAR");
+        json.close('}');
+    }
+    json.close(']');
+
+    json.key("bufferViews");
+    json.open('[');
+    for (const Layout& l : layouts) {
+        json.open('{');
+        json.key("buffer"); json.value(0);
+        json.key("byteOffset"); json.value(l.vertexOffset);
+        json.key("byteLength"); json.value(l.vertexBytes);
+        json.key("byteStride"); json.value(stride);
+        json.key("target"); json.value(34962);   // ARRAY_BUFFER
+        json.close('}');
+        json.open('{');
+        json.key("buffer"); json.value(0);
+        json.key("byteOffset"); json.value(l.indexOffset);
+        json.key("byteLength"); json.value(l.indexBytes);
+        json.key("target"); json.value(34963);   // ELEMENT_ARRAY_BUFFER
+        json.close('}');
+    }
+    json.close(']');
+    if (binBytes > 0) {
+        json.key("buffers");
+        json.open('[');
+        json.open('{');
+        json.key("byteLength"); json.value(binBytes);
+        json.close('}');
+        json.close(']');
+    }
+    json.close('}');
+    std::string& text = json.text();
+    text.resize(std::size_t(align4(text.size())), ' ');
+
+    // --- 4. Header and JSON chunk, then the meshes, encoded ahead on the pool ---
+    const std::uint64_t total = 12 + 8 + text.size() + (binBytes > 0 ? 8 + binBytes : 0);
+    if (total > 0xFFFFFFFFull) {
+        if (error) *error = "The scene is too large for one .glb (4 GiB)";
+        return false;
+    }
+
+    QSaveFile file(QString::fromStdString(path));
+    auto put = [&file](const void* data, std::uint64_t bytes) {
+        return file.write(static_cast<const char*>(data), qint64(bytes)) == qint64(bytes);
+    };
+    unsigned char header[20];
+    putLe32(header, kGlbMagic);
+    putLe32(header + 4, 2);
+    putLe32(header + 8, std::uint32_t(total));
+    putLe32(header + 12, std::uint32_t(text.size()));
+    putLe32(header + 16, kJsonChunk);
+    bool ok = file.open(QIODevice::WriteOnly) && put(header, 20) && put(text.data(), text.size());
+    if (ok && binBytes > 0) {
+        putLe32(header, std::uint32_t(binBytes));
+        putLe32(header + 4, kBinChunk);
+        ok = put(header, 8);
+    }
+    std::string().swap(text);
+
+    auto encode = [&](std::size_t i) {
+        const MeshData& mesh = *plan.meshes[i];
+        const Layout& l = layouts[i];
+        std::vector<unsigned char> out(std::size_t(l.vertexBytes + l.indexBytes), 0);
+        if (quantize) {
+            const glm::vec3 c = bounds[i].centre();
+            const float h = bounds[i].halfExtent();
+            unsigned char* p = out.data();
+            for (const Vertex& v : mesh.vertices) {
+                const std::int16_t q[4] = { quantizePosition(v.position.x, c.x, h), quantizePosition(v.position.y, c.y, h),
+                    quantizePosition(v.position.z, c.z, h), 0 };
+                const std::int8_t n[4] = { quantizeNormal(v.normal.x), quantizeNormal(v.normal.y), quantizeNormal(v.normal.z), 0 };
+                std::memcpy(p, q, 8);
+                std::memcpy(p + 8, n, 4);
+                std::memcpy(p + 12, &v.uv, 8);
+                p += stride;
+            }
+        }
+        else std::memcpy(out.data(), mesh.vertices.data(), std::size_t(l.vertexBytes));   // Vertex is the glTF layout already
+        unsigned char* indices = out.data() + l.vertexBytes;
+        if (l.shortIndices) {
+            for (std::size_t k = 0; k < mesh.indices.size(); ++k) {
+                const std::uint16_t index = std::uint16_t(mesh.indices[k]);
+                std::memcpy(indices + 2 * k, &index, 2);
+            }
+        }
+        else std::memcpy(indices, mesh.indices.data(), mesh.indices.size() * 4);
+        return out;
+    };
+
+    // Encoding runs a bounded distance ahead of the write, in order.
+    const std::size_t ahead = std::size_t(ThreadPool::shared().size()) * 2;
+    std::deque<std::future<std::vector<unsigned char>>> queued;
+    std::size_t next = 0;
+    for (std::size_t i = 0; i < plan.meshes.size() && ok; ++i) {
+        for (; next < plan.meshes.size() && next < i + ahead; ++next) {
+            auto task = std::make_shared<std::packaged_task<std::vector<unsigned char>()>>([&encode, next] { return encode(next); });
+            queued.push_back(task->get_future());
+            ThreadPool::shared().submit([task] { (*task)(); });
+        }
+        const std::vector<unsigned char> bytes = queued.front().get();
+        queued.pop_front();
+        ok = put(bytes.data(), bytes.size());
+    }
+    // Tasks still queued reference this frame.
+    for (auto& future : queued) future.wait();
+
+    if (!ok || !file.commit()) {
+        if (error) *error = "Could not write " + path;
+        return false;
+    }
+    return true;
+}
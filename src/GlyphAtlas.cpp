@@ -0,0 +1,194 @@
+#include "GlyphAtlas.hpp"
+
+#include <QFont>
+#include <QFontMetricsF>
+#include <QGuiApplication>
+#include <QImage>
+#include <QPainter>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr int kAtlasWidth = 512;                     ///< texels; rows are added as the glyphs need
+    constexpr std::size_t kMaxCachedLayouts = 4096;      ///< past it the cache starts over
+    constexpr float kFar = 1e20f;
+
+    // Squared distance transform of one row or column (Felzenszwalb and
+    // Huttenlocher): f holds 0 at the sites and kFar elsewhere, d the result.
+    void transform1d(const float* f, float* d, int n, std::vector<int>& v, std::vector<float>& z)
+    {
+        v.resize(std::size_t(n));
+        z.resize(std::size_t(n) + 1);
+        // Where the parabolas of sites q and p intersect.
+        auto meet = [f](int q, int p) {
+            return ((f[q] + float(q) * float(q)) - (f[p] + float(p) * float(p))) / float(2 * (q - p));
+        };
+        int k = 0;
+        v[0] = 0;
+        z[0] = -kFar;
+        z[1] = kFar;
+        for (int q = 1; q < n; ++q) {
+            float s = meet(q, v[std::size_t(k)]);
+            while (s <= z[std::size_t(k)]) {
+                --k;
+                s = meet(q, v[std::size_t(k)]);
+            }
+            ++k;
+            v[std::size_t(k)] = q;
+            z[std::size_t(k)] = s;
+            z[std::size_t(k) + 1] = kFar;
+        }
+        k = 0;
+        for (int q = 0; q < n; ++q) {
+            while (z[std::size_t(k) + 1] < float(q)) ++k;
+            const int p = v[std::size_t(k)];
+            d[q] = float(q - p) * float(q - p) + f[p];
+        }
+    }
+
+    // In place over a w x h grid: columns, then rows.
+    void transform2d(std::vector<float>& grid, int w, int h)
+    {
+        std::vector<float> f(std::size_t(std::max(w, h))), d(f.size());
+        std::vector<int> v;
+        std::vector<float> z;
+        for (int x = 0; x < w; ++x) {
+            for (int y = 0; y < h; ++y) f[std::size_t(y)] = grid[std::size_t(y) * std::size_t(w) + std::size_t(x)];
+            transform1d(f.data(), d.data(), h, v, z);
+            for (int y = 0; y < h; ++y) grid[std::size_t(y) * std::size_t(w) + std::size_t(x)] = d[std::size_t(y)];
+        }
+        for (int y = 0; y < h; ++y) {
+            float* row = grid.data() + std::size_t(y) * std::size_t(w);
+            std::copy(row, row + w, f.begin());
+            transform1d(f.data(), row, w, v, z);
+        }
+    }
+}
+
+GlyphAtlas& GlyphAtlas::instance()
+{
+    static GlyphAtlas atlas;
+    return atlas;
+}
+
+GlyphAtlas::GlyphAtlas()
+{
+    constexpr int S = kSupersample;
+    constexpr int margin = kSpread * S;
+
+    // Sized so that ascent + descent is kEmTexels atlas texels.
+    QFont font = QGuiApplication::font();
+    font.setPixelSize(kEmTexels * S);
+    font.setHintingPreference(QFont::PreferNoHinting);
+    {
+        const QFontMetricsF probe(font);
+        font.setPixelSize(std::max(1, int(std::lround(kEmTexels * S * kEmTexels * S / (probe.ascent() + probe.descent())))));
+    }
+    const QFontMetricsF metrics(font);
+    const float em = float(metrics.ascent() + metrics.descent());
+
+    struct Cell {
+        QImage image;
+        int x = 0, y = 0, w = 0, h = 0;                  ///< atlas texels
+    };
+    std::vector<Cell> cells(kCharCount);
+
+    // --- 1. Rasterize each glyph into its own cell, with kSpread texels of margin ---
+    int penX = 0, penY = 0, rowHeight = 0;
+    for (int i = 0; i < kCharCount; ++i) {
+        const QChar ch(kFirstChar + i);
+        const QRectF bounds = metrics.boundingRect(ch);
+        const int left = int(std::floor(bounds.left())) - 1;
+        const int top = int(std::floor(bounds.top())) - 1;
+        Cell& cell = cells[std::size_t(i)];
+        cell.w = (int(std::ceil(bounds.right())) + 1 - left + S - 1) / S + 2 * kSpread;
+        cell.h = (int(std::ceil(bounds.bottom())) + 1 - top + S - 1) / S + 2 * kSpread;
+        if (penX + cell.w > kAtlasWidth) {
+            penX = 0;
+            penY += rowHeight;
+            rowHeight = 0;
+        }
+        cell.x = penX;
+        cell.y = penY;
+        penX += cell.w;
+        rowHeight = std::max(rowHeight, cell.h);
+
+        // The pen in the supersampled cell; image rows run downwards.
+        const int originX = margin - left, originY = margin - top;
+        cell.image = QImage(cell.w * S, cell.h * S, QImage::Format_Grayscale8);
+        cell.image.fill(0);
+        if (!ch.isSpace()) {
+            QPainter painter(&cell.image);
+            painter.setRenderHint(QPainter::TextAntialiasing, false);
+            painter.setFont(font);
+            painter.setPen(Qt::white);
+            painter.drawText(QPointF(originX, originY), QString(ch));
+        }
+
+        Glyph& glyph = m_glyphs[i];
+        glyph.rect = glm::vec4(float(-originX), float(originY - cell.h * S), float(cell.w * S - originX), float(originY)) / em;
+        glyph.advance = float(metrics.horizontalAdvance(ch)) / em;
+    }
+    m_width = kAtlasWidth;
+    m_height = penY + rowHeight;
+    m_texels.assign(std::size_t(m_width) * std::size_t(m_height), 0);
+
+    // --- 2. Distance to the outline from both sides, sampled at each texel's centre ---
+    std::vector<float> outside, inside;
+    for (int i = 0; i < kCharCount; ++i) {
+        Cell& cell = cells[std::size_t(i)];
+        Glyph& glyph = m_glyphs[i];
+        glyph.uv = glm::vec4(float(cell.x) / float(m_width), float(cell.y + cell.h) / float(m_height),
+                             float(cell.x + cell.w) / float(m_width), float(cell.y) / float(m_height));
+
+        const int w = cell.image.width(), h = cell.image.height();
+        outside.assign(std::size_t(w) * std::size_t(h), kFar);
+        inside.assign(outside.size(), kFar);
+        for (int y = 0; y < h; ++y) {
+            const uchar* row = cell.image.constScanLine(y);
+            for (int x = 0; x < w; ++x) {
+                const bool in = row[x] >= 128;
+                (in ? outside : inside)[std::size_t(y) * std::size_t(w) + std::size_t(x)] = 0.0f;
+            }
+        }
+        transform2d(outside, w, h);
+        transform2d(inside, w, h);
+
+        for (int ty = 0; ty < cell.h; ++ty)
+            for (int tx = 0; tx < cell.w; ++tx) {
+                const std::size_t p = std::size_t(ty * S + S / 2) * std::size_t(w) + std::size_t(tx * S + S / 2);
+                // Positive inside, in atlas texels; the pixel centres sit half a pixel off the edge.
+                const float distance = (outside[p] > 0.0f ? 0.5f - std::sqrt(outside[p]) : std::sqrt(inside[p]) - 0.5f) / float(S);
+                const float value = std::clamp(0.5f + 0.5f * distance / float(kSpread), 0.0f, 1.0f);
+                m_texels[std::size_t(cell.y + ty) * std::size_t(m_width) + std::size_t(cell.x + tx)] =
+                    std::uint8_t(std::lround(value * 255.0f));
+            }
+    }
+}
+
+const GlyphAtlas::Glyph& GlyphAtlas::glyph(char c) const
+{
+    const int i = int(static_cast<unsigned char>(c)) - kFirstChar;
+    return m_glyphs[i >= 0 && i < kCharCount ? i : '?' - kFirstChar];
+}
+
+std::shared_ptr<const GlyphAtlas::Layout> GlyphAtlas::layout(const std::string& text)
+{
+    auto it = m_layouts.find(text);
+    if (it != m_layouts.end()) return it->second;
+    if (m_layouts.size() >= kMaxCachedLayouts) m_layouts.clear();   // drawn layouts live on in their holders
+
+    auto layout = std::make_shared<Layout>();
+    float pen = 0.0f;
+    for (const char c : text) {
+        const Glyph& g = glyph(c);
+        if (c != ' ') layout->quads.push_back({ g.rect + glm::vec4(pen, 0.0f, pen, 0.0f), g.uv });
+        pen += g.advance;
+    }
+    layout->width = pen;
+    const glm::vec4 centre(-0.5f * pen, 0.0f, -0.5f * pen, 0.0f);
+    for (Quad& quad : layout->quads) quad.rect += centre;
+    return m_layouts.emplace(text, std::move(layout)).first->second;
+}
@@ -0,0 +1,191 @@
+#include "GpuMemory.hpp"
+
+#include <QDebug>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_3_Core>
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    struct Key {
+        const void* group;
+        GLuint name;
+        bool texture;
+        bool operator==(const Key& other) const
+        {
+            return group == other.group && name == other.name && texture == other.texture;
+        }
+    };
+    struct KeyHash {
+        std::size_t operator()(const Key& k) const
+        {
+            return std::hash<const void*>()(k.group) ^ (std::size_t(k.name) << 1 | std::size_t(k.texture));
+        }
+    };
+    struct Entry {
+        std::size_t bytes;
+        GpuMemory::Category category;
+    };
+
+    struct State {
+        std::unordered_map<Key, Entry, KeyHash> objects;
+        GpuMemory::Usage usage;
+        std::size_t budget = 0;
+        std::vector<std::pair<int, GpuMemory::Evictor>> evictors;
+        int nextEvictor = 1;
+        bool enforcing = false;
+        bool warned = false;       ///< over budget with nothing left to evict
+    };
+
+    State& state()
+    {
+        static State s;
+        return s;
+    }
+
+    const void* currentGroup()
+    {
+        QOpenGLContext* ctx = QOpenGLContext::currentContext();
+        return ctx ? static_cast<const void*>(ctx->shareGroup()) : nullptr;
+    }
+
+    void track(GLuint name, bool texture, std::size_t bytes, GpuMemory::Category category)
+    {
+        if (name == 0) return;
+        State& s = state();
+        auto [it, inserted] = s.objects.try_emplace({ currentGroup(), name, texture }, Entry{ 0, category });
+        Entry& e = it->second;
+        s.usage.bytes[std::size_t(e.category)] -= e.bytes;
+        s.usage.total -= e.bytes;
+        if (inserted) ++s.usage.objects;
+
+        e = { bytes, category };
+        s.usage.bytes[std::size_t(category)] += bytes;
+        s.usage.total += bytes;
+        s.usage.peak = std::max(s.usage.peak, s.usage.total);
+    }
+
+    void untrack(GLsizei count, const GLuint* names, bool texture)
+    {
+        State& s = state();
+        const void* group = currentGroup();
+        for (GLsizei i = 0; i < count; ++i) {
+            const auto it = s.objects.find({ group, names[i], texture });
+            if (it == s.objects.end()) continue;
+            s.usage.bytes[std::size_t(it->second.category)] -= it->second.bytes;
+            s.usage.total -= it->second.bytes;
+            --s.usage.objects;
+            s.objects.erase(it);
+        }
+    }
+}
+
+const char* GpuMemory::categoryName(Category category)
+{
+    switch (category) {
+    case Category::Meshes:           return "meshes";
+    case Category::Materials:        return "materials";
+    case Category::Splines:          return "splines";
+    case Category::Instances:        return "instances";
+    case Category::Particles:        return "particles";
+    case Category::FieldVisualizers: return "field visualizers";
+    case Category::Effectors:        return "effectors";
+    case Category::PointClouds:      return "point clouds";
+    case Category::Sensors:          return "sensors";
+    case Category::Reconstruction:   return "reconstruction";
+    case Category::RenderTargets:    return "render targets";
+    case Category::Readback:         return "readback";
+    case Category::Other:
+    case Category::Count:            break;
+    }
+    return "other";
+}
+
+void GpuMemory::bufferData(QOpenGLFunctions_4_3_Core* gl, GLenum target, GLuint buffer, GLsizeiptr bytes,
+    const void* data, GLenum usage, Category category)
+{
+    gl->glBufferData(target, bytes, data, usage);
+    track(buffer, false, std::size_t(bytes), category);
+}
+
+void GpuMemory::trackBuffer(GLuint buffer, std::size_t bytes, Category category)
+{
+    track(buffer, false, bytes, category);
+}
+
+void GpuMemory::trackTexture(GLuint texture, std::size_t bytes, Category category)
+{
+    track(texture, true, bytes, category);
+}
+
+void GpuMemory::deleteBuffers(QOpenGLFunctions_4_3_Core* gl, GLsizei count, const GLuint* buffers)
+{
+    untrack(count, buffers, false);
+    gl->glDeleteBuffers(count, buffers);
+}
+
+void GpuMemory::deleteTextures(QOpenGLFunctions_4_3_Core* gl, GLsizei count, const GLuint* textures)
+{
+    untrack(count, textures, true);
+    gl->glDeleteTextures(count, textures);
+}
+
+GpuMemory::Usage GpuMemory::usage()
+{
+    return state().usage;
+}
+
+void GpuMemory::setBudget(std::size_t bytes)
+{
+    state().budget = bytes;
+}
+
+std::size_t GpuMemory::budget()
+{
+    return state().budget;
+}
+
+int GpuMemory::addEvictor(Evictor evictor)
+{
+    State& s = state();
+    s.evictors.emplace_back(s.nextEvictor, std::move(evictor));
+    return s.nextEvictor++;
+}
+
+void GpuMemory::removeEvictor(int id)
+{
+    auto& evictors = state().evictors;
+    evictors.erase(std::remove_if(evictors.begin(), evictors.end(),
+        [id](const auto& entry) { return entry.first == id; }), evictors.end());
+}
+
+std::size_t GpuMemory::enforceBudget()
+{
+    State& s = state();
+    if (s.budget == 0 || s.usage.total <= s.budget) {
+        s.warned = false;
+        return 0;
+    }
+    if (s.enforcing) return 0;
+
+    // Evictors delete through deleteBuffers()/deleteTextures(), so the
+    // tracked total is the truth, whatever they return.
+    s.enforcing = true;
+    const std::size_t before = s.usage.total;
+    for (std::size_t i = 0; i < s.evictors.size() && s.usage.total > s.budget; ++i)
+        s.evictors[i].second(s.usage.total - s.budget);
+    s.enforcing = false;
+
+    const std::size_t freed = before > s.usage.total ? before - s.usage.total : 0;
+    s.usage.evicted += freed;
+    if (s.usage.total > s.budget && !s.warned) {
+        s.warned = true;
+        qWarning() << "[GpuMemory]" << (s.usage.total >> 20) << "MiB in use, over the"
+                   << (s.budget >> 20) << "MiB budget after evicting" << (freed >> 20) << "MiB";
+    }
+    return freed;
+}
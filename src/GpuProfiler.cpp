@@ -0,0 +1,154 @@
+#include "GpuProfiler.hpp"
+#include "RenderStats.hpp"
+
+#include <QOpenGLFunctions_4_3_Core>
+#include <cstring>
+
+namespace {
+constexpr double kSmoothing = 0.1; // weight of the newest sample
+}
+
+double GpuProfiler::nowUs()
+{
+    return TraceZones::nowUs();
+}
+
+void GpuProfiler::beginFrame(QOpenGLFunctions_4_3_Core* gl)
+{
+    if (m_open >= 0) end(gl); // unbalanced begin() from the previous frame
+    if (m_primitivesOpen) endFrame(gl);
+
+    // Harvest in submission order, oldest first.
+    for (int i = 1; i <= kSlots; ++i) {
+        Slot& s = m_slots[(m_head + i + kSlots) % kSlots];
+        if (s.pending) harvest(gl, s);
+    }
+
+    m_head = (m_head + 1) % kSlots;
+    Slot& slot = m_slots[m_head];
+    slot.pending = false; // still in flight after kSlots frames: drop it
+    slot.passes.clear();
+    slot.frame = m_frameCount++;
+
+    if (!slot.primitivesQuery) gl->glGenQueries(1, &slot.primitivesQuery);
+    slot.primitivesEnded = false;
+    gl->glBeginQuery(GL_PRIMITIVES_GENERATED, slot.primitivesQuery);
+    m_primitivesOpen = true;
+}
+
+void GpuProfiler::endFrame(QOpenGLFunctions_4_3_Core* gl)
+{
+    if (!m_primitivesOpen) return;
+    gl->glEndQuery(GL_PRIMITIVES_GENERATED);
+    m_slots[m_head].primitivesEnded = true;
+    m_primitivesOpen = false;
+}
+
+void GpuProfiler::begin(QOpenGLFunctions_4_3_Core* gl, const char* name)
+{
+    if (m_head < 0 || m_open >= 0) return;
+    Slot& slot = m_slots[m_head];
+
+    const std::size_t index = slot.passes.size();
+    if (index == slot.queryPool.size()) {
+        GLuint q = 0;
+        gl->glGenQueries(1, &q);
+        slot.queryPool.push_back(q);
+    }
+
+    Pass pass;
+    pass.name = name;
+    pass.query = slot.queryPool[index];
+    pass.cpuBeginUs = nowUs();
+    slot.passes.push_back(pass);
+    m_open = int(index);
+    if (m_debugGroups) gl->glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+    m_groupOpen = m_debugGroups;
+    gl->glBeginQuery(GL_TIME_ELAPSED, pass.query);
+}
+
+void GpuProfiler::end(QOpenGLFunctions_4_3_Core* gl)
+{
+    if (m_head < 0 || m_open < 0) return;
+    gl->glEndQuery(GL_TIME_ELAPSED);
+    if (m_groupOpen) gl->glPopDebugGroup();
+    m_groupOpen = false;
+    Slot& slot = m_slots[m_head];
+    Pass& pass = slot.passes[std::size_t(m_open)];
+    pass.cpuDurUs = nowUs() - pass.cpuBeginUs;
+    slot.pending = true;
+    m_open = -1;
+}
+
+void GpuProfiler::harvest(QOpenGLFunctions_4_3_Core* gl, Slot& slot)
+{
+    // Queries finish in order, so the last one being ready means all are.
+    GLint available = GL_FALSE;
+    gl->glGetQueryObjectiv(slot.passes.back().query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return;
+
+    if (slot.primitivesEnded) {
+        gl->glGetQueryObjectiv(slot.primitivesQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+        GLuint64 primitives = 0;
+        gl->glGetQueryObjectui64v(slot.primitivesQuery, GL_QUERY_RESULT, &primitives);
+        RenderStats::totals().primitives += primitives;
+    }
+
+    m_lastGpuFrameMs = 0.0;
+    for (const Pass& pass : slot.passes) {
+        GLuint64 ns = 0;
+        gl->glGetQueryObjectui64v(pass.query, GL_QUERY_RESULT, &ns);
+        const double gpuMs = double(ns) * 1e-6;
+        const double cpuMs = pass.cpuDurUs * 1e-3;
+        m_lastGpuFrameMs += gpuMs;
+
+        PassTiming& t = timingFor(pass.name);
+        const bool first = t.gpuMs == 0.0 && t.cpuMs == 0.0;
+        t.gpuMs = first ? gpuMs : t.gpuMs + kSmoothing * (gpuMs - t.gpuMs);
+        t.cpuMs = first ? cpuMs : t.cpuMs + kSmoothing * (cpuMs - t.cpuMs);
+
+        if (m_capturing)
+            m_captured.push_back({ pass.name, pass.cpuBeginUs, pass.cpuDurUs, double(ns) * 1e-3, slot.frame });
+    }
+    slot.pending = false;
+}
+
+GpuProfiler::PassTiming& GpuProfiler::timingFor(const char* name)
+{
+    for (PassTiming& t : m_timings)
+        if (std::strcmp(t.name.c_str(), name) == 0) return t;
+    m_timings.push_back(PassTiming{ name });
+    return m_timings.back();
+}
+
+double GpuProfiler::gpuFrameMs() const
+{
+    double sum = 0.0;
+    for (const PassTiming& t : m_timings) sum += t.gpuMs;
+    return sum;
+}
+
+double GpuProfiler::cpuFrameMs() const
+{
+    double sum = 0.0;
+    for (const PassTiming& t : m_timings) sum += t.cpuMs;
+    return sum;
+}
+
+void GpuProfiler::destroy(QOpenGLFunctions_4_3_Core* gl)
+{
+    for (Slot& s : m_slots) {
+        if (!s.queryPool.empty())
+            gl->glDeleteQueries(GLsizei(s.queryPool.size()), s.queryPool.data());
+        if (s.primitivesQuery) gl->glDeleteQueries(1, &s.primitivesQuery);
+        s = Slot{};
+    }
+    m_head = m_open = -1;
+    m_primitivesOpen = false;
+    m_frameCount = 0;
+    m_lastGpuFrameMs = 0.0;
+    m_timings.clear();
+    m_captured.clear();
+    m_capturing = false;
+}
@@ -0,0 +1,88 @@
+#include "GpuReadbackRing.hpp"
+#include "GpuMemory.hpp"
+
+#include <QOpenGLFunctions_4_3_Core>
+#include <cstring>
+
+void GpuReadbackRing::ensure(QOpenGLFunctions_4_3_Core* gl, GLsizeiptr bytes)
+{
+    if (bytes <= m_capacity) return;
+
+    destroy(gl);
+    for (Slot& s : m_slots) {
+        gl->glGenBuffers(1, &s.buffer);
+        gl->glBindBuffer(GL_COPY_WRITE_BUFFER, s.buffer);
+        GpuMemory::bufferData(gl, GL_COPY_WRITE_BUFFER, s.buffer, bytes, nullptr, GL_STREAM_READ, GpuMemory::Category::Readback);
+    }
+    gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    m_capacity = bytes;
+}
+
+void GpuReadbackRing::destroy(QOpenGLFunctions_4_3_Core* gl)
+{
+    for (Slot& s : m_slots) {
+        if (s.fence) gl->glDeleteSync(s.fence);
+        if (s.buffer) GpuMemory::deleteBuffers(gl, 1, &s.buffer);
+        s = Slot{};
+    }
+    m_capacity = 0;
+    m_head = 0;
+}
+
+void GpuReadbackRing::copy(QOpenGLFunctions_4_3_Core* gl, GLuint src,
+    GLintptr srcOffset, GLintptr dstOffset, GLsizeiptr bytes)
+{
+    Slot& s = m_slots[m_head];
+    if (!s.buffer || dstOffset + bytes > m_capacity) return;
+
+    gl->glBindBuffer(GL_COPY_READ_BUFFER, src);
+    gl->glBindBuffer(GL_COPY_WRITE_BUFFER, s.buffer);
+    gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, srcOffset, dstOffset, bytes);
+    gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GpuReadbackRing::submit(QOpenGLFunctions_4_3_Core* gl)
+{
+    Slot& s = m_slots[m_head];
+    if (!s.buffer) return;
+
+    if (s.fence) gl->glDeleteSync(s.fence);
+    s.fence = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_head = (m_head + 1) % kSlots;
+}
+
+bool GpuReadbackRing::tryRead(QOpenGLFunctions_4_3_Core* gl, void* dst, GLsizeiptr bytes)
+{
+    if (bytes > m_capacity) return false;
+
+    // Walk backwards from the most recently submitted slot.
+    for (int i = 1; i <= kSlots; ++i) {
+        Slot& s = m_slots[(m_head - i + kSlots) % kSlots];
+        if (!s.fence) continue;
+
+        const GLenum r = gl->glClientWaitSync(s.fence, 0, 0);
+        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) continue;
+
+        gl->glBindBuffer(GL_COPY_READ_BUFFER, s.buffer);
+        if (void* p = gl->glMapBufferRange(GL_COPY_READ_BUFFER, 0, bytes, GL_MAP_READ_BIT)) {
+            std::memcpy(dst, p, static_cast<size_t>(bytes));
+            gl->glUnmapBuffer(GL_COPY_READ_BUFFER);
+        }
+        gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        gl->glDeleteSync(s.fence);
+        s.fence = nullptr;
+
+        // Slots submitted before this one hold older data; retire them.
+        for (int j = i + 1; j <= kSlots; ++j) {
+            Slot& older = m_slots[(m_head - j + kSlots) % kSlots];
+            if (older.fence) {
+                gl->glDeleteSync(older.fence);
+                older.fence = nullptr;
+            }
+        }
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,47 @@
+#include "GradientLut.hpp"
+#include "components.hpp"
+
+#include <algorithm>
+
+GradientLut GradientLut::bake(const std::vector<ColorStop>& stops)
+{
+    GradientLut lut;
+    if (stops.empty()) {
+        lut.texels.fill(glm::vec4(1.0f));
+        return lut;
+    }
+
+    std::vector<ColorStop> sorted = stops;
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [](const ColorStop& a, const ColorStop& b) { return a.position < b.position; });
+
+    // One pass: texel positions only grow, so the bracketing stop only moves forward.
+    std::size_t next = 0;
+    for (int i = 0; i < kSize; ++i) {
+        const float value = float(i) / float(kSize - 1);
+        while (next < sorted.size() && sorted[next].position < value) ++next;
+        if (next == 0) lut.texels[i] = sorted.front().color;
+        else if (next == sorted.size()) lut.texels[i] = sorted.back().color;
+        else {
+            const ColorStop& a = sorted[next - 1];
+            const ColorStop& b = sorted[next];
+            const float span = b.position - a.position;
+            lut.texels[i] = span > 0.0f ? glm::mix(a.color, b.color, (value - a.position) / span) : b.color;
+        }
+    }
+    return lut;
+}
+
+glm::vec4 GradientLut::sample(float value) const
+{
+    const float x = std::clamp(value, 0.0f, 1.0f) * float(kSize - 1);
+    const int i = std::min(int(x), kSize - 2);
+    return glm::mix(texels[i], texels[i + 1], x - float(i));
+}
+
+bool GradientLut::sameStops(const std::vector<ColorStop>& a, const std::vector<ColorStop>& b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const ColorStop& l, const ColorStop& r) {
+        return l.position == r.position && l.color == r.color;
+    });
+}
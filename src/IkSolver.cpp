@@ -0,0 +1,143 @@
+#include "IkSolver.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Solves A x = b in place for a symmetric positive definite m x m 'a'
+// (row-major, m <= 6). A is J J^T + lambda^2 I with lambda > 0, so the
+// factorisation cannot break down.
+void choleskySolve(double* a, double* b, int m)
+{
+    for (int j = 0; j < m; ++j) {
+        double d = a[j * m + j];
+        for (int k = 0; k < j; ++k) d -= a[j * m + k] * a[j * m + k];
+        d = std::sqrt(std::max(d, 1e-300));
+        a[j * m + j] = d;
+        for (int i = j + 1; i < m; ++i) {
+            double s = a[i * m + j];
+            for (int k = 0; k < j; ++k) s -= a[i * m + k] * a[j * m + k];
+            a[i * m + j] = s / d;
+        }
+    }
+    for (int i = 0; i < m; ++i) {
+        double s = b[i];
+        for (int k = 0; k < i; ++k) s -= a[i * m + k] * b[k];
+        b[i] = s / a[i * m + i];
+    }
+    for (int i = m - 1; i >= 0; --i) {
+        double s = b[i];
+        for (int k = i + 1; k < m; ++k) s -= a[k * m + i] * b[k];
+        b[i] = s / a[i * m + i];
+    }
+}
+}
+
+void IkSolver::setModel(const KinematicModel& model)
+{
+    m_model = &model;
+    m_world.resize(std::size_t(model.linkCount()));
+    m_jacobian.resize(6 * std::size_t(model.dofCount()));
+    m_previous.resize(std::size_t(model.dofCount()));
+}
+
+double IkSolver::error(const Pose& target, const Pose& current, bool matchOrientation,
+    double& positionError, double& orientationError)
+{
+    const glm::vec3 dp = target.translation - current.translation;
+    m_error[0] = dp.x; m_error[1] = dp.y; m_error[2] = dp.z;
+    double sq = double(dp.x) * dp.x + double(dp.y) * dp.y + double(dp.z) * dp.z;
+    positionError = std::sqrt(sq);
+    orientationError = 0.0;
+    if (!matchOrientation) return sq;
+
+    // Rotation still to go, as a world-space rotation vector (axis * angle).
+    glm::quat dq = target.rotation * glm::conjugate(current.rotation);
+    if (dq.w < 0.0f) dq = -dq;
+    const double vx = dq.x, vy = dq.y, vz = dq.z;
+    const double s = std::sqrt(vx * vx + vy * vy + vz * vz);
+    const double angle = 2.0 * std::atan2(s, double(dq.w));
+    const double k = s > 1e-12 ? angle / s : 2.0;
+    const double w = m_settings.orientationWeight;
+    m_error[3] = w * k * vx; m_error[4] = w * k * vy; m_error[5] = w * k * vz;
+    orientationError = angle;
+    return sq + w * w * angle * angle;
+}
+
+void IkSolver::clampToLimits(double* q) const
+{
+    for (int d = 0; d < m_model->dofCount(); ++d)
+        if (m_model->isLimited(d)) q[d] = std::clamp(q[d], m_model->lowerLimit(d), m_model->upperLimit(d));
+}
+
+IkSolver::Result IkSolver::solve(int tip, const Pose& target, double* q, bool matchOrientation, const Pose& base)
+{
+    Result result;
+    if (!m_model || tip < 0 || tip >= m_model->linkCount()) return result;
+
+    const KinematicModel& model = *m_model;
+    const int dofs = model.dofCount();
+    const int m = matchOrientation ? 6 : 3;
+    const double rowWeight[6] = { 1.0, 1.0, 1.0, m_settings.orientationWeight,
+                                  m_settings.orientationWeight, m_settings.orientationWeight };
+    auto converged = [&] {
+        return result.positionError <= m_settings.positionTolerance
+            && (!matchOrientation || result.orientationError <= m_settings.orientationTolerance);
+    };
+    auto evaluate = [&] {
+        model.forward(q, m_world.data(), tip, m_jacobian.data(), base);
+        return error(target, m_world[tip], matchOrientation, result.positionError, result.orientationError);
+    };
+
+    clampToLimits(q);
+    double cost = evaluate();
+    double lambda = m_settings.damping;
+
+    while (!converged() && result.iterations < m_settings.maxIterations) {
+        ++result.iterations;
+
+        // y = (W J J^T W + lambda^2 I)^-1 e, then dq = J^T W y.
+        double a[36], y[6];
+        for (int r = 0; r < m; ++r) {
+            for (int c = 0; c <= r; ++c) {
+                double sum = 0.0;
+                for (int d = 0; d < dofs; ++d)
+                    sum += m_jacobian[6 * d + r] * m_jacobian[6 * d + c];
+                a[r * m + c] = a[c * m + r] = sum * rowWeight[r] * rowWeight[c];
+            }
+            a[r * m + r] += lambda * lambda;
+            y[r] = m_error[r];
+        }
+        choleskySolve(a, y, m);
+
+        double largest = 0.0;
+        for (int d = 0; d < dofs; ++d) {
+            double step = 0.0;
+            for (int r = 0; r < m; ++r) step += m_jacobian[6 * d + r] * rowWeight[r] * y[r];
+            m_previous[d] = step;
+            largest = std::max(largest, std::abs(step));
+        }
+        const double scale = largest > m_settings.maxStep ? m_settings.maxStep / largest : 1.0;
+        for (int d = 0; d < dofs; ++d) {
+            const double step = m_previous[d] * scale;
+            m_previous[d] = q[d];
+            q[d] += step;
+        }
+        clampToLimits(q);
+
+        const double trial = evaluate();
+        if (trial < cost) {
+            cost = trial;
+            lambda = std::max(lambda * 0.5, m_settings.minDamping);
+        }
+        else {
+            // Overshot (or a limit blocked the step): back off toward gradient descent.
+            std::copy(m_previous.begin(), m_previous.end(), q);
+            cost = evaluate();
+            lambda = std::min(lambda * 4.0, m_settings.maxDamping);
+        }
+    }
+
+    result.converged = converged();
+    return result;
+}
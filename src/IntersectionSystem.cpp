@@ -1,262 +1,414 @@
 #include "IntersectionSystem.hpp"
 #include "components.hpp"
 #include "Scene.hpp"
-#include "ViewportWidget.hpp"
 #include "Camera.hpp"
+#include "CullingSystem.hpp"
+#include "MeshBvh.hpp"
+#include "MeshCache.hpp"
+#include "Prefab.hpp"
 
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
 #include <vector>
-#include <QDebug>
+#include <unordered_map>
 
 namespace IntersectionSystem
 {
     // ========================================================================
-    // --- Outline Calculation Logic ---
+    // --- Ray Picking (TLAS over world bounds, BLAS per mesh) ---
     // ========================================================================
 
-    bool lineSegmentPlaneIntersection(const glm::vec3& p1, const glm::vec3& p2, const glm::vec4& plane, glm::vec3& outIntersectionPoint)
+    namespace
     {
-        glm::vec3 lineDir = p2 - p1;
-        float dotLineNormal = glm::dot(glm::vec3(plane), lineDir);
-        if (std::abs(dotLineNormal) < 1e-6) return false;
-        float t = (-plane.w - glm::dot(glm::vec3(plane), p1)) / dotLineNormal;
-        if (t >= 0.0f && t <= 1.0f) {
-            outIntersectionPoint = p1 + t * lineDir;
-            return true;
+        glm::mat4 worldMatrixOf(entt::registry& reg, entt::entity e)
+        {
+            if (auto* world = reg.try_get<WorldTransformComponent>(e)) return world->matrix;
+            return reg.get<TransformComponent>(e).getTransform();
         }
-        return false;
-    }
 
-    std::vector<glm::vec2> calculateConvexHull(std::vector<glm::vec2>& points)
-    {
-        if (points.size() <= 3) return points;
-        std::sort(points.begin(), points.end(), [](const glm::vec2& a, const glm::vec2& b) {
-            return a.x < b.x || (a.x == b.x && a.y < b.y);
-            });
+        // BLASes by mesh key, for entities that share geometry. Weak: a
+        // BLAS goes with the last entity holding it, and its entry is swept
+        // once the map has doubled since the last sweep.
+        struct BlasCache
+        {
+            std::unordered_map<std::size_t, std::weak_ptr<const MeshBvh>> byMeshKey;
+            std::size_t sweepAt = 64;
 
-        std::vector<glm::vec2> hull;
-        auto cross_product = [](const glm::vec2& O, const glm::vec2& A, const glm::vec2& B) {
-            return (A.x - O.x) * (B.y - O.y) - (A.y - O.y) * (B.x - O.x);
-            };
+            void insert(std::size_t key, const std::shared_ptr<const MeshBvh>& blas)
+            {
+                byMeshKey[key] = blas;
+                if (byMeshKey.size() < sweepAt) return;
+                for (auto it = byMeshKey.begin(); it != byMeshKey.end();)
+                    it = it->second.expired() ? byMeshKey.erase(it) : std::next(it);
+                sweepAt = std::max<std::size_t>(64, 2 * byMeshKey.size());
+            }
+        };
 
-        for (const auto& p : points) {
-            while (hull.size() >= 2 && cross_product(hull[hull.size() - 2], hull.back(), p) <= 0) {
-                hull.pop_back();
+        // Returns the entity's BLAS, building it (or borrowing one for the
+        // same mesh content) when the mesh storage changed.
+        const MeshBvh& ensureBlas(entt::registry& reg, entt::entity e, const RenderableMeshComponent& mesh)
+        {
+            auto* cache = reg.ctx().find<BlasCache>();
+            if (!cache) cache = &reg.ctx().emplace<BlasCache>();
+
+            // Keyed on the content itself: RenderResourceComponent::meshKey
+            // only follows a swapped mesh at the next snapshot extract.
+            auto& pick = reg.get_or_emplace<PickingBvhComponent>(e);
+            const std::size_t key = MeshCache::keyOf(mesh.mesh ? *mesh.mesh : MeshData::empty());
+            if (pick.blas && pick.meshKey == key) return *pick.blas;
+
+            pick.blas.reset();
+            if (auto it = cache->byMeshKey.find(key); it != cache->byMeshKey.end()) pick.blas = it->second.lock();
+            if (!pick.blas) {
+                pick.blas = MeshBvh::build(mesh);
+                cache->insert(key, pick.blas);
             }
-            hull.push_back(p);
+            pick.meshKey = key;
+            return *pick.blas;
         }
 
-        size_t lower_hull_size = hull.size();
-        for (int i = int(points.size()) - 2; i >= 0; --i) {
-            const auto& p = points[i];
-            while (hull.size() > lower_hull_size && cross_product(hull[hull.size() - 2], hull.back(), p) <= 0) {
-                hull.pop_back();
-            }
-            hull.push_back(p);
+        // Closest mesh hit along the ray: the scene index narrows the
+        // entities, each candidate is tested in object space against its BLAS.
+        entt::entity raycastScene(Scene& scene, const Ray& ray, float& tHit)
+        {
+            // A click can land between ticks: bring the index up to date first.
+            entt::registry& reg = scene.getRegistry();
+            CullingSystem::updateWorldBounds(reg);
+            scene.index().update(reg);
+
+            entt::entity hitEntity = entt::null;
+            tHit = std::numeric_limits<float>::max();
+
+            scene.index().raycast(ray.origin, ray.dir, tHit, [&](entt::entity e, float& tMax) {
+                if (!reg.valid(e)) return;
+                // A prefab instance is hit through its parts' shared BLAS.
+                if (const auto* instance = reg.try_get<PrefabInstanceComponent>(e); instance && instance->prefab) {
+                    const glm::mat4 world = worldMatrixOf(reg, e);
+                    // The renderer poses GPU fleets; pose the candidate here.
+                    thread_local std::vector<glm::mat4> posed;
+                    const std::vector<glm::mat4>* links = &instance->linkMatrices;
+                    if (instance->gpuPosed && instance->prefab->model) {
+                        PrefabSystem::poseLinks(*instance->prefab, instance->q.data(), posed);
+                        links = &posed;
+                    }
+                    for (std::size_t i = 0; i < instance->prefab->parts.size(); ++i) {
+                        const Prefab::Part& part = instance->prefab->parts[i];
+                        if (!part.blas) continue;
+                        const glm::mat4 toLocal = glm::inverse(world * PrefabSystem::partMatrix(*instance->prefab, *links, i));
+                        const glm::vec3 o = glm::vec3(toLocal * glm::vec4(ray.origin, 1.0f));
+                        const glm::vec3 d = glm::vec3(toLocal * glm::vec4(ray.dir, 0.0f));
+                        float t = tMax;
+                        if (part.blas->raycast(o, d, t) && t < tMax) {
+                            tMax = t;
+                            hitEntity = e;
+                        }
+                    }
+                    return;
+                }
+                if (!reg.all_of<RenderableMeshComponent, TransformComponent>(e)) return;
+                const auto& mesh = reg.get<RenderableMeshComponent>(e);
+                if (mesh.indices().empty()) return;
+
+                // Unnormalised object-space direction keeps t in world units.
+                const glm::mat4 toLocal = glm::inverse(worldMatrixOf(reg, e));
+                const glm::vec3 o = glm::vec3(toLocal * glm::vec4(ray.origin, 1.0f));
+                const glm::vec3 d = glm::vec3(toLocal * glm::vec4(ray.dir, 0.0f));
+
+                float t = tMax;
+                if (ensureBlas(reg, e, mesh).raycast(o, d, t) && t < tMax) {
+                    tMax = t;
+                    hitEntity = e;
+                }
+            });
+            return hitEntity;
         }
-        hull.pop_back();
-        return hull;
     }
 
-    // THE FIX: This function now RETURNS the calculated outlines directly.
-    std::vector<std::vector<glm::vec3>> update(Scene* scene)
+    Ray cameraRay(const Camera& camera, int width, int height, int mouseX, int mouseY)
     {
-        std::vector<std::vector<glm::vec3>> allOutlines;
-        auto& registry = scene->getRegistry();
+        float nx = (2.0f * mouseX) / width - 1.0f;
+        float ny = 1.0f - (2.0f * mouseY) / height;
+        glm::vec4 rayClip(nx, ny, -1.0f, 1.0f);
 
-        auto sliceableView = registry.view<TransformComponent, RenderableMeshComponent, TagComponent>();
-        auto gridView = registry.view<TransformComponent, GridComponent>();
+        glm::vec4 rayEye = glm::inverse(camera.getProjectionMatrix(width / float(height))) * rayClip;
+        rayEye.z = -1.0f;  rayEye.w = 0.0f;
 
-        for (auto gridEntity : gridView)
-        {
-            auto& grid = gridView.get<GridComponent>(gridEntity);
-            if (!grid.showIntersections) continue;
+        return { camera.getPosition(), glm::normalize(glm::vec3(glm::inverse(camera.getViewMatrix()) * rayEye)) };
+    }
 
-            glm::mat4 gridModelMatrix = gridView.get<TransformComponent>(gridEntity).getTransform();
-            glm::vec3 worldPlaneNormal = glm::normalize(glm::vec3(gridModelMatrix * glm::vec4(0.0f, 1.0f, 0.0f, 0.0f)));
-            glm::vec3 worldPlanePoint = glm::vec3(gridModelMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
-            glm::vec4 worldPlane(worldPlaneNormal, -glm::dot(worldPlaneNormal, worldPlanePoint));
-            glm::mat4 worldToGrid = glm::inverse(gridModelMatrix);
+    entt::entity pickEntity(Scene& scene, const Ray& ray)
+    {
+        float t;
+        return raycastScene(scene, ray, t);
+    }
 
-            for (auto meshEntity : sliceableView)
-            {
-                if (registry.get<TagComponent>(meshEntity).tag != "Test Cube") continue;
-
-                glm::mat4 meshModelMatrix = sliceableView.get<TransformComponent>(meshEntity).getTransform();
-                glm::vec3 p[8] = {
-                    glm::vec3(-0.5f,-0.5f,-0.5f), glm::vec3(0.5f,-0.5f,-0.5f), glm::vec3(0.5f,0.5f,-0.5f), glm::vec3(-0.5f,0.5f,-0.5f),
-                    glm::vec3(-0.5f,-0.5f, 0.5f), glm::vec3(0.5f,-0.5f, 0.5f), glm::vec3(0.5f,0.5f, 0.5f), glm::vec3(-0.5f,0.5f, 0.5f)
-                };
-                int edges[12][2] = { {0,1},{1,2},{2,3},{3,0}, {4,5},{5,6},{6,7},{7,4}, {0,4},{1,5},{2,6},{3,7} };
-
-                std::vector<glm::vec3> intersectionPoints3D;
-                for (int i = 0; i < 12; ++i) {
-                    glm::vec3 p1 = glm::vec3(meshModelMatrix * glm::vec4(p[edges[i][0]], 1.0f));
-                    glm::vec3 p2 = glm::vec3(meshModelMatrix * glm::vec4(p[edges[i][1]], 1.0f));
-                    glm::vec3 intersectionPoint;
-                    if (lineSegmentPlaneIntersection(p1, p2, worldPlane, intersectionPoint)) {
-                        intersectionPoints3D.push_back(intersectionPoint);
-                    }
-                }
+    void selectObjectAt(Scene& scene, const Ray& ray)
+    {
+        auto& registry = scene.getRegistry();
+        entt::entity selectedEntity = pickEntity(scene, ray);
 
-                if (intersectionPoints3D.size() > 2) {
-                    std::vector<glm::vec2> points2D;
-                    for (const auto& p3d : intersectionPoints3D) {
-                        glm::vec4 localPoint = worldToGrid * glm::vec4(p3d, 1.0f);
-                        points2D.push_back(glm::vec2(localPoint.x, localPoint.z));
-                    }
-                    std::vector<glm::vec2> hullPoints2D = calculateConvexHull(points2D);
-                    std::vector<glm::vec3> finalOutlinePoints3D;
-                    for (const auto& p2d : hullPoints2D) {
-                        finalOutlinePoints3D.push_back(glm::vec3(gridModelMatrix * glm::vec4(p2d.x, 0.0f, p2d.y, 1.0f)));
-                    }
-                    allOutlines.push_back(finalOutlinePoints3D);
-                }
-            }
+        registry.clear<SelectedComponent>();
+        if (registry.valid(selectedEntity))
+        {
+            registry.emplace<SelectedComponent>(selectedEntity);
         }
-        return allOutlines;
     }
 
+    std::optional<glm::vec3> pickPoint(Scene& scene, const Ray& ray)
+    {
+        float t;
+        if (raycastScene(scene, ray, t) != entt::null)
+            return ray.origin + ray.dir * t;      // hit found
+        return std::nullopt;                      // nothing under cursor
+    }
 
     // ========================================================================
-    // --- Object Selection Logic (Unchanged) ---
+    // --- Snapping (BLAS closest-feature queries) ---
     // ========================================================================
 
-    inline bool rayTriangleIntersect(const glm::vec3& rayOrigin,
-        glm::vec3       rayDir,
-        const glm::vec3& v0,
-        const glm::vec3& v1,
-        const glm::vec3& v2,
-        float& tHit,
-        glm::vec3& pHit)
+    namespace
     {
-        rayDir = glm::normalize(rayDir);               // 1) length-independent t
-
-        constexpr float kEps = 1e-6f;
-        glm::vec3  edge1 = v1 - v0;
-        glm::vec3  edge2 = v2 - v0;
-        glm::vec3  pvec = glm::cross(rayDir, edge2);
-        float det = glm::dot(edge1, pvec);
-
-        if (std::abs(det) < kEps) return false;        // ray parallel to tri
-        float invDet = 1.0f / det;
-
-        glm::vec3 tvec = rayOrigin - v0;
-        float u = glm::dot(tvec, pvec) * invDet;
-        if (u < 0.0f || u > 1.0f) return false;
-
-        glm::vec3 qvec = glm::cross(tvec, edge1);
-        float v = glm::dot(rayDir, qvec) * invDet;
-        if (v < 0.0f || u + v > 1.0f) return false;
-
-        float t = glm::dot(edge2, qvec) * invDet;
-        if (t < kEps) return false;                    // hit behind origin
-
-        tHit = t;
-        pHit = rayOrigin + rayDir * t;
-        return true;
+        // Nearest crossing of the finest visible level of a snapping grid
+        // along the ray. The grid lies in its local XZ plane.
+        Snap snapToGrids(entt::registry& reg, const Ray& ray)
+        {
+            Snap best;
+            float bestT = std::numeric_limits<float>::max();
+            for (auto [e, grid] : reg.view<GridComponent>().each()) {
+                if (!grid.snappingEnabled || !grid.masterVisible || !reg.all_of<TransformComponent>(e)) continue;
+                float spacing = 0.0f;
+                for (std::size_t i = 0; i < grid.levels.size(); ++i)
+                    if ((i >= 5 || grid.levelVisible[i]) && grid.levels[i].spacing > 0.0f
+                        && (spacing == 0.0f || grid.levels[i].spacing < spacing))
+                        spacing = grid.levels[i].spacing;
+                if (spacing == 0.0f) continue;
+
+                const glm::mat4 world = worldMatrixOf(reg, e);
+                const glm::mat4 toLocal = glm::inverse(world);
+                const glm::vec3 o = glm::vec3(toLocal * glm::vec4(ray.origin, 1.0f));
+                const glm::vec3 d = glm::vec3(toLocal * glm::vec4(ray.dir, 0.0f));
+                if (std::abs(d.y) < 1e-9f) continue;
+                const float t = -o.y / d.y;   // in units of ray.dir, as for the BLAS
+                if (t <= 0.0f || t >= bestT) continue;
+
+                const glm::vec3 local = o + t * d;
+                const glm::vec3 snapped(std::round(local.x / spacing) * spacing, 0.0f, std::round(local.z / spacing) * spacing);
+                best = { SnapKind::Grid, glm::vec3(world * glm::vec4(snapped, 1.0f)), entt::null };
+                bestT = t;
+            }
+            return best;
+        }
     }
 
-    // thin wrapper so existing code compiles unchanged
-    inline bool rayTriangleIntersect(const glm::vec3& rayOrigin,
-        const glm::vec3& rayDir,
-        const glm::vec3& v0,
-        const glm::vec3& v1,
-        const glm::vec3& v2,
-        float& tHit)
+    Snap snapPoint(Scene& scene, const Camera& camera, int width, int height, int mouseX, int mouseY, float pixelRadius)
     {
-        glm::vec3 dummy;
-        return rayTriangleIntersect(rayOrigin, rayDir, v0, v1, v2, tHit, dummy);
+        entt::registry& reg = scene.getRegistry();
+        const Ray ray = cameraRay(camera, width, height, mouseX, mouseY);
+        float t;
+        const entt::entity hitEntity = raycastScene(scene, ray, t);
+        if (hitEntity == entt::null) return snapToGrids(reg, ray);
+
+        const glm::vec3 hit = ray.origin + ray.dir * t;
+        Snap best{ SnapKind::Face, hit, hitEntity };
+
+        // 'pixelRadius' in world units at the hit's depth.
+        const glm::mat4 proj = camera.getProjectionMatrix(width / float(std::max(height, 1)));
+        const glm::vec3 forward = -glm::vec3(glm::inverse(camera.getViewMatrix())[2]);
+        const float depth = proj[3][3] == 1.0f ? 1.0f : glm::dot(hit - ray.origin, forward);   // orthographic: 1
+        const float radius = pixelRadius * 2.0f * std::abs(depth) / (proj[1][1] * float(std::max(height, 1)));
+
+        float bestDistance = radius;
+        scene.index().querySphere(hit, radius, [&](entt::entity e) {
+            if (!reg.valid(e) || reg.all_of<PrefabInstanceComponent>(e)) return;
+            if (!reg.all_of<RenderableMeshComponent, TransformComponent>(e)) return;
+            const auto& mesh = reg.get<RenderableMeshComponent>(e);
+            if (mesh.indices().empty()) return;
+
+            // The sphere in object space: the largest stretch of the inverse
+            // keeps it covering the world sphere under any scale.
+            const glm::mat4 world = worldMatrixOf(reg, e);
+            const glm::mat4 toLocal = glm::inverse(world);
+            const glm::mat3 inv(toLocal);
+            const float localRadius = radius * std::max({ glm::length(inv[0]), glm::length(inv[1]), glm::length(inv[2]) });
+            const MeshBvh::Snap s = ensureBlas(reg, e, mesh).snap(glm::vec3(toLocal * glm::vec4(hit, 1.0f)), localRadius);
+            if (s.kind == MeshBvh::Feature::None || s.kind == MeshBvh::Feature::Face) return;
+
+            const SnapKind kind = s.kind == MeshBvh::Feature::Vertex ? SnapKind::Vertex : SnapKind::Edge;
+            const glm::vec3 point = glm::vec3(world * glm::vec4(s.point, 1.0f));
+            const float d = glm::length(point - hit);
+            if (d > radius) return;   // inside the object-space sphere only
+            const bool outranks = best.kind == SnapKind::Face || (kind == SnapKind::Vertex && best.kind == SnapKind::Edge);
+            if (outranks || (kind == best.kind && d < bestDistance)) {
+                best = { kind, point, e };
+                bestDistance = d;
+            }
+        });
+        return best;
     }
+    // ========================================================================
+    // --- Grid-plane Sections ---
+    // ========================================================================
 
-    void selectObjectAt(Scene& scene, ViewportWidget& viewport, int mouseX, int mouseY)
+    namespace
     {
-        auto& registry = scene.getRegistry();
-        auto& camera = viewport.getCamera();
-        float x = (2.0f * mouseX) / viewport.width() - 1.0f;
-        float y = 1.0f - (2.0f * mouseY) / viewport.height();
-        float z = 1.0f;
-        glm::vec3 ray_nds = glm::vec3(x, y, z);
-        glm::vec4 ray_clip(ray_nds.x, ray_nds.y, -1.0f, 1.0f);
-        glm::vec4 ray_eye = glm::inverse(camera.getProjectionMatrix(viewport.width() / static_cast<float>(viewport.height()))) * ray_clip;
-        ray_eye = glm::vec4(ray_eye.x, ray_eye.y, -1.0f, 0.0f);
-        glm::vec3 ray_wor = glm::normalize(glm::vec3(glm::inverse(camera.getViewMatrix()) * ray_eye));
-
-        entt::entity selectedEntity = entt::null;
-        float closest_distance = std::numeric_limits<float>::max();
-        auto view = registry.view<RenderableMeshComponent, TransformComponent>();
-        for (auto entity : view)
+        struct Vec3Hash {
+            std::size_t operator()(const glm::vec3& p) const {
+                // -0 and +0 compare equal, so they must hash equal too.
+                const glm::vec3 q(p.x == 0.0f ? 0.0f : p.x, p.y == 0.0f ? 0.0f : p.y, p.z == 0.0f ? 0.0f : p.z);
+                std::uint32_t b[3];
+                std::memcpy(b, &q.x, sizeof(b));
+                return (std::size_t(b[0]) * 73856093u) ^ (std::size_t(b[1]) * 19349663u) ^ (std::size_t(b[2]) * 83492791u);
+            }
+        };
+
+        // Joins unordered segments (pairs of points) into polylines by exact
+        // endpoint match; MeshBvh::slice emits bit-identical points on shared
+        // edges. Closed loops end with a copy of their first point.
+        std::vector<std::vector<glm::vec3>> chainSegments(const std::vector<glm::vec3>& pts)
         {
-            auto [mesh, transform] = view.get<RenderableMeshComponent, TransformComponent>(entity);
-            glm::mat4 modelMatrix = transform.getTransform();
-            for (size_t i = 0; i < mesh.indices.size(); i += 3)
-            {
-                const glm::vec3& p0 = mesh.vertices[mesh.indices[i]].position;
-                const glm::vec3& p1 = mesh.vertices[mesh.indices[i + 1]].position;
-                const glm::vec3& p2 = mesh.vertices[mesh.indices[i + 2]].position;
-                glm::vec3 v0 = glm::vec3(modelMatrix * glm::vec4(p0, 1.0f));
-                glm::vec3 v1 = glm::vec3(modelMatrix * glm::vec4(p1, 1.0f));
-                glm::vec3 v2 = glm::vec3(modelMatrix * glm::vec4(p2, 1.0f));
-                float distance;
-                if (rayTriangleIntersect(camera.getPosition(), ray_wor, v0, v1, v2, distance))
-                {
-                    if (distance < closest_distance)
-                    {
-                        closest_distance = distance;
-                        selectedEntity = entity;
-                    }
+            const std::size_t segCount = pts.size() / 2;
+            std::unordered_map<glm::vec3, std::vector<std::uint32_t>, Vec3Hash> atPoint;
+            for (std::uint32_t i = 0; i < pts.size(); ++i) atPoint[pts[i]].push_back(i);
+
+            std::vector<char> used(segCount, 0);
+            std::vector<std::vector<glm::vec3>> lines;
+
+            auto walk = [&](std::uint32_t startEnd) {
+                std::vector<glm::vec3> line{ pts[startEnd] };
+                std::uint32_t end = startEnd;
+                for (;;) {
+                    used[end / 2] = 1;
+                    const std::uint32_t other = end ^ 1u;   // the segment's opposite endpoint
+                    line.push_back(pts[other]);
+                    std::uint32_t next = ~0u;
+                    for (std::uint32_t cand : atPoint[pts[other]])
+                        if (!used[cand / 2]) { next = cand; break; }
+                    if (next == ~0u) break;
+                    end = next;
                 }
-            }
+                lines.push_back(std::move(line));
+            };
+
+            // Open chains first (start at an endpoint nothing else touches), then loops.
+            for (std::uint32_t i = 0; i < pts.size(); ++i)
+                if (!used[i / 2] && atPoint[pts[i]].size() == 1) walk(i);
+            for (std::uint32_t i = 0; i < pts.size(); i += 2)
+                if (!used[i / 2]) walk(i);
+            return lines;
         }
-        registry.clear<SelectedComponent>();
-        if (registry.valid(selectedEntity))
+
+        // World-space section polylines per (mesh, grid) pair, reused until
+        // either world matrix (or the mesh's BLAS) changes.
+        struct SectionCache
         {
-            registry.emplace<SelectedComponent>(selectedEntity);
-        }
+            struct Entry {
+                glm::mat4 meshWorld{ 0.0f };
+                glm::mat4 gridWorld{ 0.0f };
+                const MeshBvh* blas = nullptr;
+                std::vector<std::vector<glm::vec3>> outlines;
+                bool seen = false;
+            };
+            struct PairHash {
+                std::size_t operator()(const std::pair<entt::entity, entt::entity>& k) const {
+                    return std::hash<std::uint64_t>()((std::uint64_t(entt::to_integral(k.first)) << 32) | entt::to_integral(k.second));
+                }
+            };
+            std::unordered_map<std::pair<entt::entity, entt::entity>, Entry, PairHash> entries;
+            std::vector<const Entry*> visited;   ///< per update(), in visiting order
+            std::vector<std::vector<glm::vec3>> outlines;   ///< of every visited entry, as of 'generation'
+            std::uint64_t generation = 0;
+            std::uint64_t order = 0;    ///< hash of the pairs in the order the last update() visited them
+        };
     }
-    std::optional<glm::vec3> pickPoint(Scene& scene, ViewportWidget& vp, int mouseX, int mouseY)
+
+    void update(Scene* scene)
     {
-        auto& reg = scene.getRegistry();
-        Camera& cam = vp.getCamera();
+        auto& registry = scene->getRegistry();
 
-        // ----- build world-space ray ------------------------------------------------
-        float nx = (2.0f * mouseX) / vp.width() - 1.0f;
-        float ny = -(2.0f * mouseY) / vp.height() + 1.0f;
-        glm::vec4 rayClip(nx, ny, -1.0f, 1.0f);
+        auto* cache = registry.ctx().find<SectionCache>();
+        if (!cache) cache = &registry.ctx().emplace<SectionCache>();
+        for (auto& [key, entry] : cache->entries) entry.seen = false;
+        cache->visited.clear();
+        bool changed = false;
+        std::uint64_t order = 0;
 
-        glm::mat4 invProj = glm::inverse(
-            cam.getProjectionMatrix(vp.width() / float(vp.height())));
-        glm::vec4 rayEye = invProj * rayClip;
-        rayEye.z = -1.0f;  rayEye.w = 0.0f;
+        auto gridView = registry.view<TransformComponent, GridComponent>();
+
+        for (auto gridEntity : gridView)
+        {
+            auto& grid = gridView.get<GridComponent>(gridEntity);
+            if (!grid.showIntersections) continue;
+
+            // The grid lies in its local XZ plane.
+            const glm::mat4 gridWorld = worldMatrixOf(registry, gridEntity);
+            const glm::vec3 worldNormal = glm::normalize(glm::vec3(gridWorld * glm::vec4(0.0f, 1.0f, 0.0f, 0.0f)));
+            const glm::vec3 worldPoint = glm::vec3(gridWorld[3]);
+            const glm::vec4 worldPlane(worldNormal, -glm::dot(worldNormal, worldPoint));
 
-        glm::vec3 rayDir = glm::normalize(glm::vec3(
-            glm::inverse(cam.getViewMatrix()) * rayEye));
-
-        // ----- traverse scene ------------------------------------------------------
-        float bestT = std::numeric_limits<float>::max();
-        glm::vec3 bestPt;
-
-        auto view = reg.view<RenderableMeshComponent, TransformComponent>();
-        for (auto e : view) {
-            auto [mesh, xf] = view.get<RenderableMeshComponent, TransformComponent>(e);
-            glm::mat4 M = reg.all_of<WorldTransformComponent>(e)
-                ? reg.get<WorldTransformComponent>(e).matrix
-                : xf.getTransform();
-            for (size_t i = 0; i < mesh.indices.size(); i += 3) {
-                glm::vec3 v0 = glm::vec3(M * glm::vec4(mesh.vertices[mesh.indices[i]].position, 1));
-                glm::vec3 v1 = glm::vec3(M * glm::vec4(mesh.vertices[mesh.indices[i + 1]].position, 1));
-                glm::vec3 v2 = glm::vec3(M * glm::vec4(mesh.vertices[mesh.indices[i + 2]].position, 1));
-                float t; glm::vec3 p;
-                if (rayTriangleIntersect(cam.getPosition(), rayDir, v0, v1, v2, t, p)
-                    && t < bestT) {
-                    bestT = t; bestPt = p;
+            // Only meshes whose bounds cross the plane can have a section.
+            scene->index().queryPlane(worldPlane, [&](entt::entity meshEntity)
+            {
+                if (meshEntity == gridEntity || !registry.valid(meshEntity)) return;
+                const auto* meshPtr = registry.try_get<RenderableMeshComponent>(meshEntity);
+                if (!meshPtr || meshPtr->indices().empty() || !registry.all_of<TransformComponent>(meshEntity)) return;
+                const auto& mesh = *meshPtr;
+
+                const glm::mat4 meshWorld = worldMatrixOf(registry, meshEntity);
+                const MeshBvh& blas = ensureBlas(registry, meshEntity, mesh);
+
+                auto& entry = cache->entries[{ meshEntity, gridEntity }];
+                entry.seen = true;
+                order = order * 0x100000001B3ull ^ SectionCache::PairHash()({ meshEntity, gridEntity });
+                if (entry.blas != &blas || entry.meshWorld != meshWorld || entry.gridWorld != gridWorld) {
+                    changed = true;
+                    // A plane is a covector: take it into mesh space with the transpose.
+                    const glm::vec4 localPlane = glm::transpose(meshWorld) * worldPlane;
+                    std::vector<glm::vec3> segments;
+                    blas.slice(localPlane, segments);
+
+                    entry.outlines = chainSegments(segments);
+                    for (auto& line : entry.outlines)
+                        for (auto& p : line) p = glm::vec3(meshWorld * glm::vec4(p, 1.0f));
+                    entry.meshWorld = meshWorld;
+                    entry.gridWorld = gridWorld;
+                    entry.blas = &blas;
                 }
-            }
+                cache->visited.push_back(&entry);
+            });
         }
-        if (bestT < std::numeric_limits<float>::max())
-            return bestPt;                        // hit found
-        return std::nullopt;                      // nothing under cursor
+
+        // Forget pairs whose mesh or grid disappeared (or stopped slicing).
+        for (auto it = cache->entries.begin(); it != cache->entries.end();) {
+            if (it->second.seen) { ++it; continue; }
+            it = cache->entries.erase(it);
+            changed = true;
+        }
+        const bool same = !changed && order == cache->order && cache->generation != 0;
+        cache->order = order;
+        if (same) return;
+
+        // Only a changed set is gathered again, so an idle tick copies nothing.
+        ++cache->generation;
+        cache->outlines.clear();
+        for (const SectionCache::Entry* entry : cache->visited)
+            cache->outlines.insert(cache->outlines.end(), entry->outlines.begin(), entry->outlines.end());
+    }
+
+    const std::vector<std::vector<glm::vec3>>& outlines(const entt::registry& registry)
+    {
+        static const std::vector<std::vector<glm::vec3>> none;
+        const auto* cache = registry.ctx().find<SectionCache>();
+        return cache ? cache->outlines : none;
+    }
+
+    std::uint64_t generation(const entt::registry& registry)
+    {
+        const auto* cache = registry.ctx().find<SectionCache>();
+        return cache ? cache->generation : 0;
     }
 }
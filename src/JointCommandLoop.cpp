@@ -0,0 +1,242 @@
+#include "JointCommandLoop.hpp"
+#include "components.hpp"
+#include "TraceZones.hpp"
+
+#include <QDebug>
+#include <entt/entt.hpp>
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#  include <sched.h>
+#endif
+
+namespace {
+using Clock = JointCommandLoop::Clock;
+
+// Publish statistics this often; keeps the GUI-facing copy cheap at 4 kHz.
+constexpr std::uint64_t kJitterPublishCycles = 64;
+
+void configureCurrentThread(const JointCommandLoop::Settings& settings)
+{
+#ifdef _WIN32
+    if (settings.cpu >= 0 && settings.cpu < 64
+        && !SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << settings.cpu))
+        qWarning() << "[JointCommandLoop] could not pin to CPU" << settings.cpu;
+    if (settings.realtime && !SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+        qWarning() << "[JointCommandLoop] could not raise thread priority";
+#else
+#  ifdef __linux__
+    if (settings.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(settings.cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            qWarning() << "[JointCommandLoop] could not pin to CPU" << settings.cpu;
+    }
+#  endif
+    if (settings.realtime) {
+        sched_param param{};
+        param.sched_priority = std::clamp(settings.realtimePriority,
+            sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+        // Usually needs CAP_SYS_NICE or an rtprio limit; fall back to normal scheduling.
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+            qWarning() << "[JointCommandLoop] SCHED_FIFO not permitted; running at normal priority";
+    }
+#endif
+}
+}
+
+void JointCommandLoop::registerWriter(CommunicationProtocol protocol, WriterFactory factory)
+{
+    m_factories[protocol] = std::move(factory);
+}
+
+std::size_t JointCommandLoop::bind(entt::registry& registry)
+{
+    stop();
+    m_streams.clear();
+    m_slotOf.clear();
+
+    // Group joints by protocol; each protocol gets a contiguous slice of the frame.
+    std::unordered_map<CommunicationProtocol, std::vector<entt::entity>> byProtocol;
+    for (auto [e, joint] : registry.view<JointComponent>().each()) {
+        const CommunicationProtocol protocol = joint.description.interface.protocol;
+        if (protocol != CommunicationProtocol::NONE && m_factories.count(protocol))
+            byProtocol[protocol].push_back(e);
+    }
+
+    std::size_t slots = 0;
+    for (auto& [protocol, joints] : byProtocol) {
+        std::vector<CommandWriter::Endpoint> endpoints;
+        endpoints.reserve(joints.size());
+        for (entt::entity e : joints) {
+            const JointDescription& d = registry.get<JointComponent>(e).description;
+            endpoints.push_back({ d.interface.controller_id, d.interface.command_topic_name,
+                                  d.default_control_mode, d.position_pid, d.velocity_pid, d.torque_pid });
+        }
+
+        Stream stream;
+        stream.writer = m_factories[protocol]();
+        if (!stream.writer || !stream.writer->open(endpoints)) {
+            qWarning() << "[JointCommandLoop] could not open a command writer for" << int(joints.size()) << "joints";
+            continue;
+        }
+        stream.first = slots;
+        stream.count = joints.size();
+        for (entt::entity e : joints) m_slotOf.emplace(e, slots++);
+        m_streams.push_back(std::move(stream));
+    }
+
+    m_staged.assign(slots, JointCommand{});
+    m_stopFrame.assign(slots, JointCommand{ ControlMode::INACTIVE });
+    for (int i = 0; i < 3; ++i) m_commands.slot(i) = m_staged;
+    resetJitter();
+
+    if (!m_streams.empty()) {
+        m_running.store(true, std::memory_order_relaxed);
+        m_thread = std::thread(&JointCommandLoop::run, this);
+        qDebug() << "[JointCommandLoop] commanding" << int(slots) << "joints at" << m_settings.rateHz << "Hz";
+    }
+    return slots;
+}
+
+void JointCommandLoop::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_running.store(false, std::memory_order_relaxed);
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) m_thread.join();
+    for (auto& stream : m_streams) stream.writer->close();
+    m_streams.clear();
+}
+
+bool JointCommandLoop::setCommand(entt::entity joint, const JointCommand& command)
+{
+    auto it = m_slotOf.find(joint);
+    if (it == m_slotOf.end()) return false;
+    m_staged[it->second] = command;
+    return true;
+}
+
+void JointCommandLoop::publish()
+{
+    if (m_streams.empty()) return;
+    // Same size every time, so this copies without allocating.
+    std::copy(m_staged.begin(), m_staged.end(), m_commands.back().begin());
+    m_commands.publish();
+}
+
+const JointCommandLoop::Jitter& JointCommandLoop::jitter()
+{
+    m_jitter.update();
+    return m_jitter.front();
+}
+
+void JointCommandLoop::emergencyStop(Clock::time_point trippedAt)
+{
+    m_trippedAtTicks.store(std::int64_t(trippedAt.time_since_epoch().count()), std::memory_order_relaxed);
+    m_stopped.store(true, std::memory_order_release);
+    {
+        // Taken only to not slip between the command thread's check and its wait.
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_trips.fetch_add(1, std::memory_order_release);
+    }
+    m_wake.notify_one();
+}
+
+void JointCommandLoop::clearEmergencyStop()
+{
+    m_stopped.store(false, std::memory_order_release);
+}
+
+void JointCommandLoop::resetJitter()
+{
+    for (int i = 0; i < 3; ++i) m_jitter.slot(i) = Jitter{};
+}
+
+void JointCommandLoop::run()
+{
+    configureCurrentThread(m_settings);
+    TraceZones::setThreadName("joint command loop");
+
+    const auto period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / std::clamp(m_settings.rateHz, 1.0, 10000.0)));
+    const auto spin = std::chrono::duration_cast<Clock::duration>(m_settings.spinWindow);
+
+    // Welford running mean / variance of the wake-up lateness.
+    Jitter stats;
+    double m2 = 0.0;
+
+    // Trips already answered; a new one is written at once, off schedule.
+    // Rebound while latched: stop the new writers at once too, unmeasured.
+    bool rebound = m_stopped.load(std::memory_order_acquire);
+    std::uint64_t answered = m_trips.load(std::memory_order_acquire) - (rebound ? 1 : 0);
+    auto tripped = [&] { return m_trips.load(std::memory_order_acquire) != answered; };
+
+    Clock::time_point deadline = Clock::now() + period;
+    while (m_running.load(std::memory_order_relaxed)) {
+        if (deadline - Clock::now() > spin) {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wake.wait_until(lock, deadline - spin,
+                [&] { return tripped() || !m_running.load(std::memory_order_relaxed); });
+        }
+        Clock::time_point now = Clock::now();
+        while (now < deadline && !tripped()) now = Clock::now();
+
+        if (tripped()) {
+            KR_ZONE("emergency stop");
+            answered = m_trips.load(std::memory_order_acquire);
+            for (auto& stream : m_streams) stream.writer->write(m_stopFrame.data() + stream.first, stream.count);
+            if (!rebound) {
+                const Clock::time_point at{ Clock::duration(m_trippedAtTicks.load(std::memory_order_relaxed)) };
+                stats.stopLatencyUs = std::chrono::duration<double, std::micro>(Clock::now() - at).count();
+                stats.stopTrip = answered;
+                m_jitter.back() = stats;
+                m_jitter.publish();
+            }
+            rebound = false;
+            if (now < deadline) continue;   // the scheduled write still happens at its deadline
+        }
+
+        {
+            KR_ZONE("command write");
+            m_commands.update();
+            const std::vector<JointCommand>& frame = m_stopped.load(std::memory_order_acquire) ? m_stopFrame : m_commands.front();
+            for (auto& stream : m_streams) stream.writer->write(frame.data() + stream.first, stream.count);
+        }
+
+        const double lateUs = std::chrono::duration<double, std::micro>(now - deadline).count();
+        ++stats.cycles;
+        const double delta = lateUs - stats.meanUs;
+        stats.meanUs += delta / double(stats.cycles);
+        m2 += delta * (lateUs - stats.meanUs);
+        stats.lastUs = lateUs;
+        stats.maxUs = std::max(stats.maxUs, lateUs);
+
+        // Keep the phase: a long cycle skips the deadlines it missed instead of bursting.
+        deadline += period;
+        for (auto& stream : m_streams)
+            deadline += std::chrono::duration_cast<Clock::duration>(stream.writer->deadlineCorrection());
+        const Clock::time_point end = Clock::now();
+        if (end >= deadline) {
+            const auto missed = (end - deadline) / period + 1;
+            stats.overruns += std::uint64_t(missed);
+            deadline += missed * period;
+        }
+
+        if (stats.cycles % kJitterPublishCycles == 0) {
+            stats.stddevUs = stats.cycles > 1 ? std::sqrt(m2 / double(stats.cycles - 1)) : 0.0;
+            m_jitter.back() = stats;
+            m_jitter.publish();
+        }
+    }
+}
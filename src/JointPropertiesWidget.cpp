@@ -1,27 +1,305 @@
 #include "JointPropertiesWidget.hpp"
+
+#include <QAbstractItemModel>
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QHeaderView>
+#include <QStyledItemDelegate>
+#include <QTimer>
+#include <QTreeView>
 #include <QVBoxLayout>
-#include <QLabel>
 
-// This is the correct, minimal implementation for the placeholder widget.
-// It defines the constructor and setData function that the rest of the code expects.
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+// One editable value of a JointDescription. 'choices' names the values of
+// an enum field, in declaration order; a field without 'set' is read-only.
+struct JointField {
+    QString name;
+    std::function<QVariant(const JointDescription&)> get;
+    std::function<void(JointDescription&, const QVariant&)> set;
+    QStringList choices;
+};
+
+struct JointFieldGroup {
+    QString name;
+    std::vector<JointField> fields;
+};
+
+template <typename T>
+QVariant toVariant(const T& value)
+{
+    if constexpr (std::is_same_v<T, std::string>) return QString::fromStdString(value);
+    else if constexpr (std::is_enum_v<T>) return int(value);
+    else if constexpr (std::is_same_v<T, float>) return double(value);
+    else return QVariant::fromValue(value);
+}
+
+template <typename T>
+void fromVariant(const QVariant& variant, T& value)
+{
+    if constexpr (std::is_same_v<T, std::string>) value = variant.toString().toStdString();
+    else if constexpr (std::is_enum_v<T>) value = T(variant.toInt());
+    else value = variant.value<T>();
+}
+
+// 'access' is a generic lambda returning a reference to the member, so one
+// accessor serves reads of const and writes of mutable descriptions.
+template <typename Access>
+JointField field(const QString& name, Access access, QStringList choices = {})
+{
+    return { name,
+        [access](const JointDescription& joint) { return toVariant(access(joint)); },
+        [access](JointDescription& joint, const QVariant& value) { fromVariant(value, access(joint)); },
+        std::move(choices) };
+}
+
+template <typename Access>
+void addVec3(std::vector<JointField>& fields, const QString& name, const QString& unit, Access access)
+{
+    fields.push_back(field(name + " X" + unit, [access](auto& j) -> auto& { return access(j).x; }));
+    fields.push_back(field(name + " Y" + unit, [access](auto& j) -> auto& { return access(j).y; }));
+    fields.push_back(field(name + " Z" + unit, [access](auto& j) -> auto& { return access(j).z; }));
+}
+
+template <typename Access>
+JointFieldGroup pidGroup(const QString& name, Access access)
+{
+    return { name, {
+        field("P", [access](auto& j) -> auto& { return access(j).p; }),
+        field("I", [access](auto& j) -> auto& { return access(j).i; }),
+        field("D", [access](auto& j) -> auto& { return access(j).d; }),
+        field("I max", [access](auto& j) -> auto& { return access(j).i_max; }),
+        field("I min", [access](auto& j) -> auto& { return access(j).i_min; }),
+        field("Feed forward", [access](auto& j) -> auto& { return access(j).feed_forward; }) } };
+}
+
+const std::vector<JointFieldGroup>& jointFieldGroups()
+{
+    static const std::vector<JointFieldGroup> groups = [] {
+        std::vector<JointFieldGroup> g;
+
+        JointFieldGroup general{ "General", {
+            field("Name", [](auto& j) -> auto& { return j.name; }),
+            field("Type", [](auto& j) -> auto& { return j.type; },
+                { "Fixed", "Revolute", "Continuous", "Prismatic", "Planar", "Floating" }),
+            field("Parent link", [](auto& j) -> auto& { return j.parent_link_name; }),
+            field("Child link", [](auto& j) -> auto& { return j.child_link_name; }) } };
+        general.fields.push_back({ "Persistent ID",
+            [](const JointDescription& j) { return QVariant::fromValue(qulonglong(j.persistent_id)); }, {}, {} });
+        g.push_back(std::move(general));
+
+        JointFieldGroup origin{ "Origin", {} };
+        addVec3(origin.fields, "Position", " (m)", [](auto& j) -> auto& { return j.origin_xyz; });
+        addVec3(origin.fields, "Rotation", " (rad)", [](auto& j) -> auto& { return j.origin_rpy; });
+        addVec3(origin.fields, "Axis", "", [](auto& j) -> auto& { return j.axis; });
+        g.push_back(std::move(origin));
+
+        g.push_back({ "Limits", {
+            field("Lower", [](auto& j) -> auto& { return j.limits.lower; }),
+            field("Upper", [](auto& j) -> auto& { return j.limits.upper; }),
+            field("Velocity", [](auto& j) -> auto& { return j.limits.velocity_limit; }),
+            field("Effort", [](auto& j) -> auto& { return j.limits.effort_limit; }) } });
+
+        g.push_back({ "Transmission", {
+            field("Gear reduction", [](auto& j) -> auto& { return j.gear_reduction; }),
+            field("Efficiency", [](auto& j) -> auto& { return j.transmission_efficiency; }),
+            field("Static friction", [](auto& j) -> auto& { return j.static_friction; }),
+            field("Dynamic friction", [](auto& j) -> auto& { return j.dynamic_friction; }) } });
+
+        g.push_back({ "Motor", {
+            field("Model", [](auto& j) -> auto& { return j.motor.model_name; }),
+            field("Type", [](auto& j) -> auto& { return j.motor.type; },
+                { "None", "DC", "BLDC", "PMSM", "Stepper" }),
+            field("Commutation", [](auto& j) -> auto& { return j.motor.commutation; },
+                { "None", "Trapezoidal", "Sinusoidal", "Microstep" }),
+            field("Pole pairs", [](auto& j) -> auto& { return j.motor.pole_pairs; }),
+            field("Phases", [](auto& j) -> auto& { return j.motor.phases; }),
+            field("Steps per revolution", [](auto& j) -> auto& { return j.motor.steps_per_revolution; }),
+            field("Kt (Nm/A)", [](auto& j) -> auto& { return j.motor.torque_constant_Kt; }),
+            field("Ke (V s/rad)", [](auto& j) -> auto& { return j.motor.back_emf_constant_Ke; }),
+            field("Resistance (Ohm)", [](auto& j) -> auto& { return j.motor.terminal_resistance; }),
+            field("Inductance (H)", [](auto& j) -> auto& { return j.motor.terminal_inductance; }),
+            field("Continuous current (A)", [](auto& j) -> auto& { return j.motor.max_continuous_current; }),
+            field("Peak current (A)", [](auto& j) -> auto& { return j.motor.peak_current; }),
+            field("Max voltage (V)", [](auto& j) -> auto& { return j.motor.max_voltage; }) } });
+
+        g.push_back({ "Control", {
+            field("Default mode", [](auto& j) -> auto& { return j.default_control_mode; },
+                { "Position", "Velocity", "Torque", "Current", "Duty cycle", "Inactive" }),
+            { "Sensors", [](const JointDescription& j) { return QVariant::fromValue(int(j.sensors.size())); }, {}, {} } } });
+        g.push_back(pidGroup("Position PID", [](auto& j) -> auto& { return j.position_pid; }));
+        g.push_back(pidGroup("Velocity PID", [](auto& j) -> auto& { return j.velocity_pid; }));
+        g.push_back(pidGroup("Torque PID", [](auto& j) -> auto& { return j.torque_pid; }));
+
+        g.push_back({ "Interface", {
+            field("Controller ID", [](auto& j) -> auto& { return j.interface.controller_id; }),
+            field("Protocol", [](auto& j) -> auto& { return j.interface.protocol; },
+                { "None", "Serial", "CANopen", "EtherCAT" }),
+            field("Command topic", [](auto& j) -> auto& { return j.interface.command_topic_name; }),
+            field("Feedback topic", [](auto& j) -> auto& { return j.interface.feedback_topic_name; }) } });
+        return g;
+    }();
+    return groups;
+}
+
+// Editors for enum fields: a combo box of the field's choices.
+class JointFieldDelegate : public QStyledItemDelegate
+{
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+
+    static constexpr int ChoicesRole = Qt::UserRole;
+
+    QWidget* createEditor(QWidget* parent, const QStyleOptionViewItem& option, const QModelIndex& index) const override
+    {
+        const QStringList choices = index.data(ChoicesRole).toStringList();
+        if (choices.isEmpty()) {
+            QWidget* editor = QStyledItemDelegate::createEditor(parent, option, index);
+            if (auto* spin = qobject_cast<QDoubleSpinBox*>(editor)) spin->setDecimals(6);   // gains, inductances
+            return editor;
+        }
+        auto* combo = new QComboBox(parent);
+        combo->addItems(choices);
+        return combo;
+    }
+
+    void setEditorData(QWidget* editor, const QModelIndex& index) const override
+    {
+        if (auto* combo = qobject_cast<QComboBox*>(editor)) combo->setCurrentIndex(index.data(Qt::EditRole).toInt());
+        else QStyledItemDelegate::setEditorData(editor, index);
+    }
+
+    void setModelData(QWidget* editor, QAbstractItemModel* model, const QModelIndex& index) const override
+    {
+        if (auto* combo = qobject_cast<QComboBox*>(editor)) model->setData(index, combo->currentIndex(), Qt::EditRole);
+        else QStyledItemDelegate::setModelData(editor, model, index);
+    }
+};
+}
+
+// Groups at the top level, their fields below; a field index's internal id
+// is its group row + 1, a group's is 0.
+class JointPropertyModel : public QAbstractItemModel
+{
+public:
+    using QAbstractItemModel::QAbstractItemModel;
+
+    std::function<void()> onEdited;   ///< after each accepted edit
+
+    void setJoint(JointDescription* joint)
+    {
+        m_joint = joint;
+        const auto& groups = jointFieldGroups();
+        for (int g = 0; g < int(groups.size()); ++g) {
+            const QModelIndex parent = index(g, 0);
+            emit dataChanged(index(0, 1, parent), index(int(groups[g].fields.size()) - 1, 1, parent));
+        }
+    }
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override
+    {
+        if (!hasIndex(row, column, parent)) return {};
+        return createIndex(row, column, parent.isValid() ? quintptr(parent.row() + 1) : quintptr(0));
+    }
+
+    QModelIndex parent(const QModelIndex& child) const override
+    {
+        if (!child.isValid() || child.internalId() == 0) return {};
+        return createIndex(int(child.internalId() - 1), 0, quintptr(0));
+    }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override
+    {
+        const auto& groups = jointFieldGroups();
+        if (!parent.isValid()) return int(groups.size());
+        if (parent.internalId() != 0 || parent.column() != 0) return 0;
+        return int(groups[parent.row()].fields.size());
+    }
+
+    int columnCount(const QModelIndex& = QModelIndex()) const override { return 2; }
+
+    QVariant data(const QModelIndex& index, int role) const override
+    {
+        if (!index.isValid()) return {};
+        if (index.internalId() == 0)
+            return role == Qt::DisplayRole && index.column() == 0 ? jointFieldGroups()[index.row()].name : QVariant();
+
+        const JointField& f = fieldAt(index);
+        if (index.column() == 0) return role == Qt::DisplayRole ? f.name : QVariant();
+        if (role == JointFieldDelegate::ChoicesRole) return f.choices;
+        if (!m_joint || (role != Qt::DisplayRole && role != Qt::EditRole)) return {};
+        const QVariant value = f.get(*m_joint);
+        if (role == Qt::DisplayRole && !f.choices.isEmpty()) return f.choices.value(value.toInt());
+        return value;
+    }
+
+    bool setData(const QModelIndex& index, const QVariant& value, int role) override
+    {
+        if (!m_joint || role != Qt::EditRole || !(flags(index) & Qt::ItemIsEditable)) return false;
+        fieldAt(index).set(*m_joint, value);
+        emit dataChanged(index, index, { Qt::DisplayRole, Qt::EditRole });
+        if (onEdited) onEdited();
+        return true;
+    }
+
+    Qt::ItemFlags flags(const QModelIndex& index) const override
+    {
+        if (!index.isValid()) return Qt::NoItemFlags;
+        Qt::ItemFlags result = Qt::ItemIsEnabled;
+        if (index.internalId() != 0 && index.column() == 1 && m_joint && fieldAt(index).set)
+            result |= Qt::ItemIsEditable | Qt::ItemIsSelectable;
+        return result;
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override
+    {
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return {};
+        return section == 0 ? QStringLiteral("Property") : QStringLiteral("Value");
+    }
+
+private:
+    const JointField& fieldAt(const QModelIndex& index) const
+    {
+        return jointFieldGroups()[index.internalId() - 1].fields[index.row()];
+    }
+
+    JointDescription* m_joint = nullptr;
+};
 
 JointPropertiesWidget::JointPropertiesWidget(QWidget* parent)
     : QWidget(parent)
 {
-    // It should have its own layout...
     auto* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(15, 15, 15, 15);
+
+    m_model = new JointPropertyModel(this);
+    m_view = new QTreeView(this);
+    m_view->setModel(m_model);
+    m_view->setItemDelegate(new JointFieldDelegate(m_view));
+    m_view->setUniformRowHeights(true);
+    m_view->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::SelectedClicked
+        | QAbstractItemView::EditKeyPressed);
+    m_view->header()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+    m_view->header()->setStretchLastSection(true);
+    m_view->expandAll();
+    layout->addWidget(m_view);
 
-    // ...and its own placeholder label.
-    auto* placeholderLabel = new QLabel("Joint Properties Editor (Work In Progress)", this);
-    placeholderLabel->setAlignment(Qt::AlignCenter);
-    layout->addWidget(placeholderLabel);
+    // Several edits in one event loop turn (e.g. a paste) refresh the preview once.
+    m_notifyTimer = new QTimer(this);
+    m_notifyTimer->setSingleShot(true);
+    m_notifyTimer->setInterval(0);
+    connect(m_notifyTimer, &QTimer::timeout, this, &JointPropertiesWidget::propertiesChanged);
+    m_model->onEdited = [this]() { m_notifyTimer->start(); };
 
-    setLayout(layout);
+    setJoint(nullptr);
 }
 
-// The setData function is defined but currently empty. The linker just needs to know it exists.
-void JointPropertiesWidget::setData(const JointDescription& jointDesc)
+void JointPropertiesWidget::setJoint(JointDescription* jointDesc)
 {
-    // TODO: In the future, use the data from jointDesc to populate the real editor fields.
-    // This function intentionally left blank for now to satisfy the linker.
+    m_model->setJoint(jointDesc);
+    setEnabled(jointDesc != nullptr);
 }
@@ -0,0 +1,54 @@
+#include "JointStateBuffer.hpp"
+
+JointStateBuffer::JointStateBuffer(std::size_t dofs)
+    : m_dofs(dofs), m_working(3 * dofs, 0.0)
+{
+    for (Slot& slot : m_slots) {
+        slot.values = std::make_unique<std::atomic<double>[]>(3 * dofs);
+        for (std::size_t i = 0; i < 3 * dofs; ++i) slot.values[i].store(0.0, std::memory_order_relaxed);
+    }
+}
+
+void JointStateBuffer::publish()
+{
+    // Frame f goes to slot f & 1; its sequence reads 2f - 1 while being
+    // written and 2f once complete, so a reader can tell which frame it saw.
+    const std::uint64_t frame = m_frame.load(std::memory_order_relaxed) + 1;
+    Slot& slot = m_slots[frame & 1];
+
+    slot.sequence.store(2 * frame - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < m_working.size(); ++i)
+        slot.values[i].store(m_working[i], std::memory_order_relaxed);
+    slot.sequence.store(2 * frame, std::memory_order_release);
+
+    m_frame.store(frame, std::memory_order_release);
+}
+
+bool JointStateBuffer::snapshot(Snapshot& out) const
+{
+    out.position.resize(m_dofs);
+    out.velocity.resize(m_dofs);
+    out.effort.resize(m_dofs);
+
+    for (;;) {
+        const std::uint64_t frame = m_frame.load(std::memory_order_acquire);
+        if (frame == 0 || frame == out.frame) return false;
+
+        const Slot& slot = m_slots[frame & 1];
+        const std::uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before != 2 * frame) continue;   // overwritten by a newer frame already
+
+        for (std::size_t i = 0; i < m_dofs; ++i) {
+            out.position[i] = slot.values[i].load(std::memory_order_relaxed);
+            out.velocity[i] = slot.values[m_dofs + i].load(std::memory_order_relaxed);
+            out.effort[i] = slot.values[2 * m_dofs + i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == before) {
+            out.frame = frame;
+            return true;
+        }
+    }
+}
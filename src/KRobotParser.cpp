@@ -1,28 +1,263 @@
 #include "KRobotParser.hpp"
+#include "KRobotFormat.hpp"
+#include "MeshBinary.hpp"
 #include "pugixml.hpp"
+#include "TraceZones.hpp"
+
+#include <QFile>
+#include <cstring>
 #include <stdexcept>
 
-// This is a stub implementation. You will expand this to read
-// every single attribute from your custom .krobot XML file.
-RobotDescription KRobotParser::parse(const std::string& filepath)
+using namespace KRobotFormat;
+
+namespace
 {
-    pugi::xml_document doc;
-    pugi::xml_parse_result result = doc.load_file(filepath.c_str());
+    // Bounds-checked view of a mapped .krobot. Records are copied out one
+    // at a time, so the mapping needs no particular alignment.
+    class Reader
+    {
+    public:
+        Reader(const unsigned char* data, std::size_t size) : m_data(data), m_size(size) {}
+
+        bool fits(std::uint64_t offset, std::uint64_t bytes) const { return offset <= m_size && bytes <= m_size - offset; }
+
+        template <typename T>
+        T read(std::uint64_t offset) const
+        {
+            if (!fits(offset, sizeof(T))) throw std::runtime_error(".krobot is truncated.");
+            T value;
+            std::memcpy(&value, m_data + offset, sizeof(T));
+            return value;
+        }
+
+        // Record 'index' of a section holding T.
+        template <typename T>
+        T record(const Section& section, std::uint64_t index) const
+        {
+            if (index >= section.count || (index + 1) * sizeof(T) > section.size)
+                throw std::runtime_error(".krobot refers to a missing record.");
+            return read<T>(section.offset + index * sizeof(T));
+        }
+
+        std::string string(const Section& strings, const StringRef& ref) const
+        {
+            if (ref.length == 0) return {};
+            if (std::uint64_t(ref.offset) + ref.length > strings.size || !fits(strings.offset + ref.offset, ref.length))
+                throw std::runtime_error(".krobot string is out of range.");
+            return std::string(reinterpret_cast<const char*>(m_data + strings.offset + ref.offset), ref.length);
+        }
+
+        const unsigned char* at(std::uint64_t offset) const { return m_data + offset; }
 
-    if (!result) {
-        throw std::runtime_error("Failed to load or parse .krobot file: " + std::string(result.description()));
+    private:
+        const unsigned char* m_data;
+        std::size_t m_size;
+    };
+
+    glm::vec3 vec3(const float v[3]) { return glm::vec3(v[0], v[1], v[2]); }
+
+    PIDParameters fromRecord(const PidRecord& r)
+    {
+        PIDParameters pid;
+        pid.p = r.p; pid.i = r.i; pid.d = r.d;
+        pid.i_max = r.iMax; pid.i_min = r.iMin; pid.feed_forward = r.feedForward;
+        return pid;
     }
 
-    pugi::xml_node robotNode = doc.child("krobot");
-    if (!robotNode) {
-        throw std::runtime_error(".krobot does not contain a <krobot> element.");
+    RobotDescription parseBinary(const Reader& in)
+    {
+        const FileHeader header = in.read<FileHeader>(0);
+        if (header.version != kVersion)
+            throw std::runtime_error(".krobot version " + std::to_string(header.version) + " is not supported.");
+
+        Section strings, links, mounts, joints, sensors, meshes;
+        for (std::uint32_t i = 0; i < header.sectionCount; ++i) {
+            const Section s = in.read<Section>(header.sectionTableOffset + i * sizeof(Section));
+            if (!in.fits(s.offset, s.size)) throw std::runtime_error(".krobot section is out of range.");
+            switch (s.type) {
+            case Strings: strings = s; break;
+            case Links:   links = s; break;
+            case Mounts:  mounts = s; break;
+            case Joints:  joints = s; break;
+            case Sensors: sensors = s; break;
+            case Meshes:  meshes = s; break;
+            default: break;   // written by a newer version; not ours to read
+            }
+        }
+
+        RobotDescription robotDesc;
+        robotDesc.name = in.string(strings, header.robotName);
+        if (robotDesc.name.empty()) robotDesc.name = "Unnamed KRobot";
+
+        // --- Links ---
+        robotDesc.links.reserve(links.count);
+        for (std::uint32_t i = 0; i < links.count; ++i) {
+            const LinkRecord r = in.record<LinkRecord>(links, i);
+            LinkDescription link;
+            link.name = in.string(strings, r.name);
+            link.persistent_id = r.persistentId;
+            link.visual_origin_xyz = vec3(r.visualXyz);
+            link.visual_origin_rpy = vec3(r.visualRpy);
+            link.mesh_filepath = in.string(strings, r.mesh);
+            link.casts_shadow = (r.flags & CastsShadow) != 0;
+            link.is_visible = (r.flags & Visible) != 0;
+            link.mass = r.mass;
+            std::memcpy(&link.inertia[0][0], r.inertia, sizeof(r.inertia));
+            link.center_of_mass_offset = vec3(r.centerOfMass);
+            link.collision_mesh_filepath = in.string(strings, r.collisionMesh);
+            link.friction = r.friction;
+            link.restitution = r.restitution;
+            link.is_static = (r.flags & Static) != 0;
+            link.is_end_effector = (r.flags & EndEffector) != 0;
+            link.editor_layer = in.string(strings, r.editorLayer);
+
+            MaterialDescription& m = link.material;
+            m.albedo_color = glm::vec4(r.material.albedo[0], r.material.albedo[1], r.material.albedo[2], r.material.albedo[3]);
+            m.albedo_texture_path = in.string(strings, r.material.albedoTexture);
+            m.metalness = r.material.metalness;
+            m.roughness = r.material.roughness;
+            m.metal_roughness_texture_path = in.string(strings, r.material.metalRoughnessTexture);
+            m.emissive_color = vec3(r.material.emissive);
+            m.emissive_intensity = r.material.emissiveIntensity;
+
+            link.sensor_mounts.reserve(r.mountCount);
+            for (std::uint32_t k = 0; k < r.mountCount; ++k) {
+                const MountRecord mount = in.record<MountRecord>(mounts, std::uint64_t(r.firstMount) + k);
+                link.sensor_mounts.push_back({ in.string(strings, mount.name), vec3(mount.position), vec3(mount.rpy) });
+            }
+            robotDesc.links.push_back(std::move(link));
+        }
+
+        // --- Joints ---
+        robotDesc.joints.reserve(joints.count);
+        for (std::uint32_t i = 0; i < joints.count; ++i) {
+            const JointRecord r = in.record<JointRecord>(joints, i);
+            JointDescription joint;
+            joint.name = in.string(strings, r.name);
+            joint.persistent_id = r.persistentId;
+            joint.type = static_cast<JointType>(r.type);
+            joint.parent_link_name = in.string(strings, r.parentLink);
+            joint.child_link_name = in.string(strings, r.childLink);
+            joint.origin_xyz = vec3(r.originXyz);
+            joint.origin_rpy = vec3(r.originRpy);
+            joint.axis = vec3(r.axis);
+
+            joint.limits.lower = r.limits[0];
+            joint.limits.upper = r.limits[1];
+            joint.limits.velocity_limit = r.limits[2];
+            joint.limits.effort_limit = r.limits[3];
+            joint.gear_reduction = r.gearReduction;
+            joint.transmission_efficiency = r.transmissionEfficiency;
+            joint.static_friction = r.staticFriction;
+            joint.dynamic_friction = r.dynamicFriction;
+
+            MotorProperties& motor = joint.motor;
+            motor.model_name = in.string(strings, r.motorModel);
+            motor.type = static_cast<MotorType>(r.motorType);
+            motor.commutation = static_cast<CommutationType>(r.commutation);
+            motor.pole_pairs = r.polePairs;
+            motor.phases = r.phases;
+            motor.steps_per_revolution = r.stepsPerRevolution;
+            motor.torque_constant_Kt = r.torqueConstant;
+            motor.back_emf_constant_Ke = r.backEmfConstant;
+            motor.terminal_resistance = r.terminalResistance;
+            motor.terminal_inductance = r.terminalInductance;
+            motor.max_continuous_current = r.maxContinuousCurrent;
+            motor.peak_current = r.peakCurrent;
+            motor.max_voltage = r.maxVoltage;
+
+            joint.default_control_mode = static_cast<ControlMode>(r.controlMode);
+            joint.position_pid = fromRecord(r.positionPid);
+            joint.velocity_pid = fromRecord(r.velocityPid);
+            joint.torque_pid = fromRecord(r.torquePid);
+
+            joint.sensors.reserve(r.sensorCount);
+            for (std::uint32_t k = 0; k < r.sensorCount; ++k) {
+                const SensorRecord s = in.record<SensorRecord>(sensors, std::uint64_t(r.firstSensor) + k);
+                switch (s.kind) {
+                case Encoder: {
+                    EncoderSensor enc;
+                    enc.model_name = in.string(strings, s.model);
+                    enc.type = static_cast<EncoderType>(s.encoderType);
+                    enc.counts_per_revolution = s.values[0];
+                    enc.gear_ratio_to_joint = s.values[1];
+                    enc.zero_offset = s.values[2];
+                    joint.sensors.emplace_back(std::move(enc));
+                    break;
+                }
+                case Potentiometer: {
+                    PotentiometerSensor pot;
+                    pot.model_name = in.string(strings, s.model);
+                    pot.min_voltage = s.values[0];
+                    pot.max_voltage = s.values[1];
+                    pot.gear_ratio_to_joint = s.values[2];
+                    joint.sensors.emplace_back(std::move(pot));
+                    break;
+                }
+                case HallEffect: {
+                    HallEffectSensor hall;
+                    hall.model_name = in.string(strings, s.model);
+                    hall.phase_A_pin = s.pins[0];
+                    hall.phase_B_pin = s.pins[1];
+                    hall.phase_C_pin = s.pins[2];
+                    joint.sensors.emplace_back(std::move(hall));
+                    break;
+                }
+                default: break;
+                }
+            }
+
+            joint.interface.controller_id = r.controllerId;
+            joint.interface.protocol = static_cast<CommunicationProtocol>(r.protocol);
+            joint.interface.command_topic_name = in.string(strings, r.commandTopic);
+            joint.interface.feedback_topic_name = in.string(strings, r.feedbackTopic);
+            robotDesc.joints.push_back(std::move(joint));
+        }
+
+        // --- Embedded meshes: hand them to the mesh cache before anything loads ---
+        for (std::uint32_t i = 0; i < meshes.count; ++i) {
+            const MeshRecord r = in.record<MeshRecord>(meshes, i);
+            if (!in.fits(r.offset, r.size)) throw std::runtime_error(".krobot mesh is out of range.");
+            MeshBinary::install(in.string(strings, r.path), in.at(r.offset), std::size_t(r.size));
+        }
+        return robotDesc;
     }
 
-    RobotDescription robotDesc;
-    robotDesc.name = robotNode.attribute("name").as_string("Unnamed KRobot");
+    // Files saved before the binary format: only the name survives.
+    RobotDescription parseXml(const std::string& filepath)
+    {
+        pugi::xml_document doc;
+        pugi::xml_parse_result result = doc.load_file(filepath.c_str());
+
+        if (!result) {
+            throw std::runtime_error("Failed to load or parse .krobot file: " + std::string(result.description()));
+        }
+
+        pugi::xml_node robotNode = doc.child("krobot");
+        if (!robotNode) {
+            throw std::runtime_error(".krobot does not contain a <krobot> element.");
+        }
+
+        RobotDescription robotDesc;
+        robotDesc.name = robotNode.attribute("name").as_string("Unnamed KRobot");
+        return robotDesc;
+    }
+}
+
+RobotDescription KRobotParser::parse(const std::string& filepath)
+{
+    KR_ZONE("parse krobot");
+    // Read-only mapping; closing 'file' on return unmaps it.
+    QFile file(QString::fromStdString(filepath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("Failed to open .krobot file: " + filepath);
+    }
+    const qint64 size = file.size();
+    const unsigned char* map = size >= qint64(sizeof(FileHeader)) ? file.map(0, size) : nullptr;
 
-    // TODO: Add comprehensive parsing logic here for links, joints, materials,
-    // sensors, PID values, etc., reading from the rich XML structure.
+    std::uint32_t magic = 0;
+    if (map) std::memcpy(&magic, map, sizeof(magic));
+    if (magic != kMagic) return parseXml(filepath);
 
-    return robotDesc;
+    return parseBinary(Reader(map, std::size_t(size)));
 }
@@ -1,11 +1,272 @@
 #include "KRobotWriter.hpp"
+#include "KRobotFormat.hpp"
+#include "MeshBinary.hpp"
+#include "MeshCache.hpp"
 #include "pugixml.hpp"
 
-// This is a placeholder implementation. A full implementation would be very large,
-// serializing every single field from your structs into XML attributes and nodes.
-// This demonstrates the basic structure.
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <cstring>
+#include <unordered_map>
 
-bool KRobotWriter::save(const RobotDescription& description, const std::string& filepath)
+using namespace KRobotFormat;
+
+namespace
+{
+    std::uint64_t align8(std::uint64_t offset) { return (offset + 7) & ~std::uint64_t(7); }
+
+    // Strings section under construction; equal strings are stored once.
+    class StringTable
+    {
+    public:
+        StringRef add(const std::string& s)
+        {
+            if (s.empty()) return {};
+            const auto [it, inserted] = m_offsets.emplace(s, std::uint32_t(m_bytes.size()));
+            if (inserted) m_bytes.insert(m_bytes.end(), s.begin(), s.end());
+            return { it->second, std::uint32_t(s.size()) };
+        }
+        const std::vector<char>& bytes() const { return m_bytes; }
+
+    private:
+        std::vector<char> m_bytes;
+        std::unordered_map<std::string, std::uint32_t> m_offsets;
+    };
+
+    void copy3(float out[3], const glm::vec3& v) { out[0] = v.x; out[1] = v.y; out[2] = v.z; }
+
+    PidRecord toRecord(const PIDParameters& pid)
+    {
+        return { pid.p, pid.i, pid.d, pid.i_max, pid.i_min, pid.feed_forward };
+    }
+
+    // The preprocessed copy MeshCache reads, as bytes. Creates it if needed.
+    bool readPreprocessed(const std::string& sourcePath, std::vector<unsigned char>& out)
+    {
+        try {
+            MeshData mesh;
+            MeshBinary::load(sourcePath, MeshCache::Default, mesh);
+        }
+        catch (const std::exception& e) {
+            qWarning() << "[KRobotWriter] Not embedding" << QString::fromStdString(sourcePath) << "-" << e.what();
+            return false;
+        }
+        QFile file(QString::fromStdString(MeshBinary::cachePathFor(sourcePath, MeshCache::Default)));
+        if (!file.open(QIODevice::ReadOnly)) return false;
+        const QByteArray bytes = file.readAll();
+        out.assign(bytes.begin(), bytes.end());
+        return !out.empty();
+    }
+}
+
+bool KRobotWriter::save(const RobotDescription& description, const std::string& filepath, bool embedMeshes)
+{
+    StringTable strings;
+    const StringRef robotName = strings.add(description.name);
+    std::vector<LinkRecord> links;
+    std::vector<MountRecord> mounts;
+    std::vector<JointRecord> joints;
+    std::vector<SensorRecord> sensors;
+    links.reserve(description.links.size());
+    joints.reserve(description.joints.size());
+
+    // --- Links ---
+    for (const LinkDescription& link : description.links) {
+        LinkRecord r;
+        r.persistentId = link.persistent_id;
+        r.name = strings.add(link.name);
+        r.mesh = strings.add(link.mesh_filepath);
+        r.collisionMesh = strings.add(link.collision_mesh_filepath);
+        r.editorLayer = strings.add(link.editor_layer);
+        copy3(r.visualXyz, link.visual_origin_xyz);
+        copy3(r.visualRpy, link.visual_origin_rpy);
+        r.mass = link.mass;
+        std::memcpy(r.inertia, &link.inertia[0][0], sizeof(r.inertia));
+        copy3(r.centerOfMass, link.center_of_mass_offset);
+        r.friction = link.friction;
+        r.restitution = link.restitution;
+        r.flags = (link.casts_shadow ? CastsShadow : 0u) | (link.is_visible ? Visible : 0u) |
+            (link.is_static ? Static : 0u) | (link.is_end_effector ? EndEffector : 0u);
+
+        const MaterialDescription& m = link.material;
+        std::memcpy(r.material.albedo, &m.albedo_color[0], sizeof(r.material.albedo));
+        copy3(r.material.emissive, m.emissive_color);
+        r.material.emissiveIntensity = m.emissive_intensity;
+        r.material.metalness = m.metalness;
+        r.material.roughness = m.roughness;
+        r.material.albedoTexture = strings.add(m.albedo_texture_path);
+        r.material.metalRoughnessTexture = strings.add(m.metal_roughness_texture_path);
+
+        r.firstMount = std::uint32_t(mounts.size());
+        r.mountCount = std::uint32_t(link.sensor_mounts.size());
+        for (const NamedTransform& t : link.sensor_mounts) {
+            MountRecord mount;
+            mount.name = strings.add(t.name);
+            copy3(mount.position, t.position);
+            copy3(mount.rpy, t.rpy);
+            mounts.push_back(mount);
+        }
+        links.push_back(r);
+    }
+
+    // --- Joints ---
+    for (const JointDescription& joint : description.joints) {
+        JointRecord r;
+        r.persistentId = joint.persistent_id;
+        r.limits[0] = joint.limits.lower;
+        r.limits[1] = joint.limits.upper;
+        r.limits[2] = joint.limits.velocity_limit;
+        r.limits[3] = joint.limits.effort_limit;
+        r.gearReduction = joint.gear_reduction;
+        r.transmissionEfficiency = joint.transmission_efficiency;
+        r.staticFriction = joint.static_friction;
+        r.dynamicFriction = joint.dynamic_friction;
+
+        const MotorProperties& motor = joint.motor;
+        r.stepsPerRevolution = motor.steps_per_revolution;
+        r.torqueConstant = motor.torque_constant_Kt;
+        r.backEmfConstant = motor.back_emf_constant_Ke;
+        r.terminalResistance = motor.terminal_resistance;
+        r.terminalInductance = motor.terminal_inductance;
+        r.maxContinuousCurrent = motor.max_continuous_current;
+        r.peakCurrent = motor.peak_current;
+        r.maxVoltage = motor.max_voltage;
+        r.motorModel = strings.add(motor.model_name);
+        r.motorType = std::uint32_t(motor.type);
+        r.commutation = std::uint32_t(motor.commutation);
+        r.polePairs = motor.pole_pairs;
+        r.phases = motor.phases;
+
+        r.positionPid = toRecord(joint.position_pid);
+        r.velocityPid = toRecord(joint.velocity_pid);
+        r.torquePid = toRecord(joint.torque_pid);
+        r.controlMode = std::uint32_t(joint.default_control_mode);
+
+        r.name = strings.add(joint.name);
+        r.parentLink = strings.add(joint.parent_link_name);
+        r.childLink = strings.add(joint.child_link_name);
+        copy3(r.originXyz, joint.origin_xyz);
+        copy3(r.originRpy, joint.origin_rpy);
+        copy3(r.axis, joint.axis);
+        r.type = std::uint32_t(joint.type);
+
+        r.controllerId = joint.interface.controller_id;
+        r.protocol = std::uint32_t(joint.interface.protocol);
+        r.commandTopic = strings.add(joint.interface.command_topic_name);
+        r.feedbackTopic = strings.add(joint.interface.feedback_topic_name);
+
+        r.firstSensor = std::uint32_t(sensors.size());
+        r.sensorCount = std::uint32_t(joint.sensors.size());
+        for (const SensorVariant& sensor : joint.sensors) {
+            SensorRecord s;
+            s.kind = std::uint32_t(sensor.index());
+            if (const auto* enc = std::get_if<EncoderSensor>(&sensor)) {
+                s.model = strings.add(enc->model_name);
+                s.encoderType = std::uint32_t(enc->type);
+                s.values[0] = enc->counts_per_revolution;
+                s.values[1] = enc->gear_ratio_to_joint;
+                s.values[2] = enc->zero_offset;
+            }
+            else if (const auto* pot = std::get_if<PotentiometerSensor>(&sensor)) {
+                s.model = strings.add(pot->model_name);
+                s.values[0] = pot->min_voltage;
+                s.values[1] = pot->max_voltage;
+                s.values[2] = pot->gear_ratio_to_joint;
+            }
+            else if (const auto* hall = std::get_if<HallEffectSensor>(&sensor)) {
+                s.model = strings.add(hall->model_name);
+                s.pins[0] = hall->phase_A_pin;
+                s.pins[1] = hall->phase_B_pin;
+                s.pins[2] = hall->phase_C_pin;
+            }
+            sensors.push_back(s);
+        }
+        joints.push_back(r);
+    }
+
+    // --- Embedded meshes: the .kmesh copies MeshCache would read ---
+    std::vector<MeshRecord> meshes;
+    std::vector<std::vector<unsigned char>> blobs;
+    if (embedMeshes) {
+        std::unordered_map<std::string, bool> seen;
+        for (const LinkDescription& link : description.links)
+            for (const std::string* path : { &link.mesh_filepath, &link.collision_mesh_filepath }) {
+                if (path->empty() || !seen.emplace(*path, true).second) continue;
+                std::vector<unsigned char> blob;
+                if (!readPreprocessed(*path, blob)) continue;
+                MeshRecord r;
+                r.path = strings.add(*path);
+                r.size = blob.size();
+                meshes.push_back(r);
+                blobs.push_back(std::move(blob));
+            }
+    }
+
+    // --- Layout: header, section table, then the sections ---
+    struct Pending { SectionType type; std::uint32_t count; const void* data; std::uint64_t size; };
+    std::vector<Pending> pending = {
+        { Strings, std::uint32_t(strings.bytes().size()), strings.bytes().data(), strings.bytes().size() },
+        { Links, std::uint32_t(links.size()), links.data(), links.size() * sizeof(LinkRecord) },
+        { Mounts, std::uint32_t(mounts.size()), mounts.data(), mounts.size() * sizeof(MountRecord) },
+        { Joints, std::uint32_t(joints.size()), joints.data(), joints.size() * sizeof(JointRecord) },
+        { Sensors, std::uint32_t(sensors.size()), sensors.data(), sensors.size() * sizeof(SensorRecord) },
+    };
+
+    FileHeader header;
+    header.robotName = robotName;
+    header.sectionTableOffset = align8(sizeof(FileHeader));
+    header.sectionCount = std::uint32_t(pending.size() + (meshes.empty() ? 0 : 1));
+    std::uint64_t offset = align8(header.sectionTableOffset + header.sectionCount * sizeof(Section));
+
+    std::vector<Section> table;
+    for (const Pending& p : pending) {
+        Section s;
+        s.type = p.type;
+        s.count = p.count;
+        s.offset = offset;
+        s.size = p.size;
+        table.push_back(s);
+        offset = align8(offset + p.size);
+    }
+    if (!meshes.empty()) {
+        Section s;
+        s.type = Meshes;
+        s.count = std::uint32_t(meshes.size());
+        s.offset = offset;
+        offset = align8(offset + meshes.size() * sizeof(MeshRecord));
+        for (MeshRecord& r : meshes) {
+            r.offset = offset;
+            offset = align8(offset + r.size);
+        }
+        s.size = offset - s.offset;
+        table.push_back(s);
+    }
+
+    std::vector<unsigned char> bytes(offset, 0);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + header.sectionTableOffset, table.data(), table.size() * sizeof(Section));
+    for (std::size_t i = 0; i < pending.size(); ++i)
+        if (pending[i].size) std::memcpy(bytes.data() + table[i].offset, pending[i].data, pending[i].size);
+    if (!meshes.empty()) {
+        std::memcpy(bytes.data() + table.back().offset, meshes.data(), meshes.size() * sizeof(MeshRecord));
+        for (std::size_t i = 0; i < meshes.size(); ++i)
+            std::memcpy(bytes.data() + meshes[i].offset, blobs[i].data(), blobs[i].size());
+    }
+
+    QSaveFile file(QString::fromStdString(filepath));
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(reinterpret_cast<const char*>(bytes.data()), qint64(bytes.size())) != qint64(bytes.size()) ||
+        !file.commit()) {
+        qWarning() << "[KRobotWriter] Could not write" << QString::fromStdString(filepath);
+        return false;
+    }
+    return true;
+}
+
+// Names and mesh paths only, for reading and diffing by eye; save() is the
+// complete record.
+bool KRobotWriter::exportXml(const RobotDescription& description, const std::string& filepath)
 {
     pugi::xml_document doc;
     pugi::xml_node robotNode = doc.append_child("krobot");
@@ -19,8 +280,6 @@ bool KRobotWriter::save(const RobotDescription& description, const std::string&
         pugi::xml_node linkNode = linksNode.append_child("link");
         linkNode.append_attribute("name") = link.name.c_str();
         linkNode.append_attribute("mesh") = link.mesh_filepath.c_str();
-        // ... here you would serialize ALL other link properties ...
-        // e.g., linkNode.append_attribute("mass") = link.mass;
     }
 
     // --- Serialize Joints ---
@@ -29,7 +288,6 @@ bool KRobotWriter::save(const RobotDescription& description, const std::string&
     {
         pugi::xml_node jointNode = jointsNode.append_child("joint");
         jointNode.append_attribute("name") = joint.name.c_str();
-        // ... here you would serialize ALL other joint properties ...
     }
 
     return doc.save_file(filepath.c_str());
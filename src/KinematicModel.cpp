@@ -0,0 +1,313 @@
+#include "KinematicModel.hpp"
+#include "RobotDescription.hpp"
+#include "ThreadPool.hpp"
+
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+// URDF rpy: fixed-axis roll about X, then pitch about Y, then yaw about Z.
+glm::quat quatFromRpy(const glm::vec3& rpy)
+{
+    return glm::angleAxis(rpy.z, glm::vec3(0, 0, 1))
+         * glm::angleAxis(rpy.y, glm::vec3(0, 1, 0))
+         * glm::angleAxis(rpy.x, glm::vec3(1, 0, 0));
+}
+
+KinematicModel::Motion motionFor(JointType type)
+{
+    switch (type) {
+    case JointType::REVOLUTE:
+    case JointType::CONTINUOUS: return KinematicModel::Motion::Revolute;
+    case JointType::PRISMATIC:  return KinematicModel::Motion::Prismatic;
+    default:                    return KinematicModel::Motion::Fixed;
+    }
+}
+}
+
+glm::mat4 KinematicPose::matrix() const
+{
+    glm::mat4 m = glm::mat4_cast(rotation);
+    m[3] = glm::vec4(translation, 1.0f);
+    return m;
+}
+
+KinematicModel KinematicModel::fromDescription(const RobotDescription& description)
+{
+    KinematicModel model;
+
+    std::unordered_map<std::string, int> linkByName;
+    for (int i = 0; i < int(description.links.size()); ++i)
+        linkByName.emplace(description.links[i].name, i);
+
+    // Parent joint of every description link, and the children of each link.
+    std::vector<int> parentJoint(description.links.size(), -1);
+    std::vector<std::vector<int>> childJoints(description.links.size());
+    for (int j = 0; j < int(description.joints.size()); ++j) {
+        const auto& joint = description.joints[j];
+        auto parent = linkByName.find(joint.parent_link_name);
+        auto child = linkByName.find(joint.child_link_name);
+        if (parent == linkByName.end() || child == linkByName.end()) {
+            qWarning() << "[KinematicModel] joint" << joint.name.c_str() << "references an unknown link; ignored";
+            continue;
+        }
+        if (parentJoint[child->second] >= 0) {
+            qWarning() << "[KinematicModel] link" << joint.child_link_name.c_str() << "has several parent joints; keeping the first";
+            continue;
+        }
+        parentJoint[child->second] = j;
+        childJoints[parent->second].push_back(j);
+    }
+
+    // Breadth-first from every root, so parents always come first.
+    std::vector<int> order;
+    std::vector<int> compiledIndex(description.links.size(), -1);
+    order.reserve(description.links.size());
+    for (int i = 0; i < int(description.links.size()); ++i)
+        if (parentJoint[i] < 0) order.push_back(i);
+    for (std::size_t head = 0; head < order.size(); ++head) {
+        compiledIndex[order[head]] = int(head);
+        for (int j : childJoints[order[head]])
+            order.push_back(linkByName.at(description.joints[j].child_link_name));
+    }
+    if (order.size() != description.links.size())
+        qWarning() << "[KinematicModel]" << int(description.links.size() - order.size())
+                   << "links are part of a cycle and were left out";
+
+    const std::size_t n = order.size();
+    model.m_parent.reserve(n);
+    model.m_dof.reserve(n);
+    model.m_motion.reserve(n);
+    model.m_axis.reserve(n);
+    model.m_origin.reserve(n);
+    model.m_linkName.reserve(n);
+    model.m_sourceLink.reserve(n);
+    model.m_sourceJoint.reserve(n);
+    model.m_endEffector.reserve(n);
+
+    for (int src : order) {
+        const auto& link = description.links[src];
+        const int j = parentJoint[src];
+
+        Pose origin;
+        Motion motion = Motion::Fixed;
+        glm::vec3 axis(0.0f, 0.0f, 1.0f);
+        int parent = -1, dof = -1;
+
+        if (j >= 0) {
+            const auto& joint = description.joints[j];
+            parent = compiledIndex[linkByName.at(joint.parent_link_name)];
+            origin.translation = joint.origin_xyz;
+            origin.rotation = quatFromRpy(joint.origin_rpy);
+            motion = motionFor(joint.type);
+            if (joint.type == JointType::PLANAR || joint.type == JointType::FLOATING)
+                qWarning() << "[KinematicModel] joint" << joint.name.c_str() << "is multi-DOF; compiled as fixed";
+
+            const float len = glm::length(joint.axis);
+            if (len > 1e-6f) axis = joint.axis / len;
+            else if (motion != Motion::Fixed) {
+                qWarning() << "[KinematicModel] joint" << joint.name.c_str() << "has a zero axis; compiled as fixed";
+                motion = Motion::Fixed;
+            }
+
+            if (motion != Motion::Fixed) {
+                dof = int(model.m_dofLink.size());
+                model.m_dofLink.push_back(int(model.m_parent.size()));
+                model.m_dofName.push_back(joint.name);
+                const bool unlimited = joint.type == JointType::CONTINUOUS;
+                model.m_lower.push_back(unlimited ? 0.0 : joint.limits.lower);
+                model.m_upper.push_back(unlimited ? 0.0 : joint.limits.upper);
+            }
+        }
+
+        model.m_parent.push_back(parent);
+        model.m_dof.push_back(dof);
+        model.m_motion.push_back(motion);
+        model.m_axis.push_back(axis);
+        model.m_origin.push_back(origin);
+        model.m_linkName.push_back(link.name);
+        model.m_sourceLink.push_back(src);
+        model.m_sourceJoint.push_back(j);
+        model.m_endEffector.push_back(link.is_end_effector ? 1 : 0);
+    }
+    return model;
+}
+
+int KinematicModel::linkIndex(const std::string& name) const
+{
+    for (int i = 0; i < linkCount(); ++i)
+        if (m_linkName[i] == name) return i;
+    return -1;
+}
+
+int KinematicModel::dofIndex(const std::string& jointName) const
+{
+    for (int i = 0; i < dofCount(); ++i)
+        if (m_dofName[i] == jointName) return i;
+    return -1;
+}
+
+KinematicModel::Pose KinematicModel::localPose(int link, double q) const
+{
+    Pose local = m_origin[link];
+    switch (m_motion[link]) {
+    case Motion::Revolute:
+        local.rotation = local.rotation * glm::angleAxis(float(q), m_axis[link]);
+        break;
+    case Motion::Prismatic:
+        local.translation += local.rotation * (m_axis[link] * float(q));
+        break;
+    case Motion::Fixed:
+        break;
+    }
+    return local;
+}
+
+void KinematicModel::forward(const double* q, Pose* world, const Pose& base) const
+{
+    const int n = linkCount();
+    for (int i = 0; i < n; ++i) {
+        const int dof = m_dof[i];
+        const Pose local = localPose(i, dof >= 0 ? q[dof] : 0.0);
+        const int parent = m_parent[i];
+        world[i] = (parent >= 0 ? world[parent] : base) * local;
+    }
+}
+
+void KinematicModel::forward(const double* q, Pose* world, int tip, double* jacobian, const Pose& base) const
+{
+    forward(q, world, base);
+    std::fill(jacobian, jacobian + 6 * std::size_t(dofCount()), 0.0);
+
+    // The joint axis of link i, in world space, is world[i].rotation * axis
+    // for both kinds of motion, and a revolute joint pivots about world[i]'s
+    // origin; so each column only needs the poses the pass just produced.
+    const glm::vec3 p = world[tip].translation;
+    for (int i = tip; i >= 0; i = m_parent[i]) {
+        const int dof = m_dof[i];
+        if (dof < 0) continue;
+        const glm::vec3 z = world[i].rotation * m_axis[i];
+        double* col = jacobian + 6 * std::size_t(dof);
+        if (m_motion[i] == Motion::Revolute) {
+            const glm::vec3 v = glm::cross(z, p - world[i].translation);
+            col[0] = v.x; col[1] = v.y; col[2] = v.z;
+            col[3] = z.x; col[4] = z.y; col[5] = z.z;
+        }
+        else {
+            col[0] = z.x; col[1] = z.y; col[2] = z.z;
+        }
+    }
+}
+
+// --- Batched FK ---
+
+struct KinematicModel::PoseLanes {
+    alignas(32) float qw[kBatchLanes], qx[kBatchLanes], qy[kBatchLanes], qz[kBatchLanes];
+    alignas(32) float tx[kBatchLanes], ty[kBatchLanes], tz[kBatchLanes];
+};
+
+namespace {
+// Configurations per pool task; a multiple of kBatchLanes.
+constexpr std::size_t kBatchChunk = 16 * KinematicModel::kBatchLanes;
+}
+
+void KinematicModel::forwardLanes(const double* q, std::size_t lanes, Pose* world, const Pose& base,
+    std::vector<PoseLanes>& scratch) const
+{
+    constexpr std::size_t L = kBatchLanes;
+    const int n = linkCount();
+    const int dofs = dofCount();
+    scratch.resize(std::size_t(n));
+
+    for (int i = 0; i < n; ++i) {
+        const Pose& o = m_origin[i];
+        const int dof = m_dof[i];
+
+        // Local pose per lane. Lanes past 'lanes' repeat the last configuration.
+        alignas(32) float lw[L], lx[L], ly[L], lz[L], ltx[L], lty[L], ltz[L];
+        alignas(32) float a[L];
+        for (std::size_t l = 0; l < L; ++l)
+            a[l] = dof >= 0 ? float(q[std::min(l, lanes - 1) * std::size_t(dofs) + std::size_t(dof)]) : 0.0f;
+
+        if (m_motion[i] == Motion::Revolute) {
+            const glm::vec3 ax = m_axis[i];
+            for (std::size_t l = 0; l < L; ++l) {
+                const float s = std::sin(0.5f * a[l]), c = std::cos(0.5f * a[l]);
+                const float mw = c, mx = ax.x * s, my = ax.y * s, mz = ax.z * s;
+                lw[l] = o.rotation.w * mw - o.rotation.x * mx - o.rotation.y * my - o.rotation.z * mz;
+                lx[l] = o.rotation.w * mx + o.rotation.x * mw + o.rotation.y * mz - o.rotation.z * my;
+                ly[l] = o.rotation.w * my - o.rotation.x * mz + o.rotation.y * mw + o.rotation.z * mx;
+                lz[l] = o.rotation.w * mz + o.rotation.x * my - o.rotation.y * mx + o.rotation.z * mw;
+                ltx[l] = o.translation.x; lty[l] = o.translation.y; ltz[l] = o.translation.z;
+            }
+        }
+        else {
+            // Prismatic slides along the axis expressed in the parent frame.
+            const glm::vec3 dir = m_motion[i] == Motion::Prismatic ? o.rotation * m_axis[i] : glm::vec3(0.0f);
+            for (std::size_t l = 0; l < L; ++l) {
+                lw[l] = o.rotation.w; lx[l] = o.rotation.x; ly[l] = o.rotation.y; lz[l] = o.rotation.z;
+                ltx[l] = o.translation.x + dir.x * a[l];
+                lty[l] = o.translation.y + dir.y * a[l];
+                ltz[l] = o.translation.z + dir.z * a[l];
+            }
+        }
+
+        // Compose with the parent: R = Rp * Rl, t = tp + Rp * tl.
+        PoseLanes& w = scratch[std::size_t(i)];
+        const int parent = m_parent[i];
+        PoseLanes rootLanes;
+        if (parent < 0) {
+            std::fill(std::begin(rootLanes.qw), std::end(rootLanes.qw), base.rotation.w);
+            std::fill(std::begin(rootLanes.qx), std::end(rootLanes.qx), base.rotation.x);
+            std::fill(std::begin(rootLanes.qy), std::end(rootLanes.qy), base.rotation.y);
+            std::fill(std::begin(rootLanes.qz), std::end(rootLanes.qz), base.rotation.z);
+            std::fill(std::begin(rootLanes.tx), std::end(rootLanes.tx), base.translation.x);
+            std::fill(std::begin(rootLanes.ty), std::end(rootLanes.ty), base.translation.y);
+            std::fill(std::begin(rootLanes.tz), std::end(rootLanes.tz), base.translation.z);
+        }
+        const PoseLanes& p = parent < 0 ? rootLanes : scratch[std::size_t(parent)];
+
+        for (std::size_t l = 0; l < L; ++l) {
+            const float pw = p.qw[l], px = p.qx[l], py = p.qy[l], pz = p.qz[l];
+            w.qw[l] = pw * lw[l] - px * lx[l] - py * ly[l] - pz * lz[l];
+            w.qx[l] = pw * lx[l] + px * lw[l] + py * lz[l] - pz * ly[l];
+            w.qy[l] = pw * ly[l] - px * lz[l] + py * lw[l] + pz * lx[l];
+            w.qz[l] = pw * lz[l] + px * ly[l] - py * lx[l] + pz * lw[l];
+
+            // v' = v + w * t + cross(q, t), t = 2 * cross(q, v)
+            const float cx = 2.0f * (py * ltz[l] - pz * lty[l]);
+            const float cy = 2.0f * (pz * ltx[l] - px * ltz[l]);
+            const float cz = 2.0f * (px * lty[l] - py * ltx[l]);
+            w.tx[l] = p.tx[l] + ltx[l] + pw * cx + (py * cz - pz * cy);
+            w.ty[l] = p.ty[l] + lty[l] + pw * cy + (pz * cx - px * cz);
+            w.tz[l] = p.tz[l] + ltz[l] + pw * cz + (px * cy - py * cx);
+        }
+
+        for (std::size_t l = 0; l < lanes; ++l) {
+            Pose& out = world[l * std::size_t(n) + std::size_t(i)];
+            out.rotation = glm::quat(w.qw[l], w.qx[l], w.qy[l], w.qz[l]);
+            out.translation = glm::vec3(w.tx[l], w.ty[l], w.tz[l]);
+        }
+    }
+}
+
+void KinematicModel::forwardBatch(const double* q, std::size_t count, Pose* world, const Pose& base) const
+{
+    if (count == 0 || linkCount() == 0) return;
+    const std::size_t dofs = std::size_t(dofCount());
+    const std::size_t links = std::size_t(linkCount());
+
+    auto runChunk = [&](std::size_t chunk) {
+        thread_local std::vector<PoseLanes> scratch;
+        const std::size_t begin = chunk * kBatchChunk;
+        const std::size_t end = std::min(count, begin + kBatchChunk);
+        for (std::size_t c = begin; c < end; c += kBatchLanes)
+            forwardLanes(q + c * dofs, std::min(kBatchLanes, end - c), world + c * links, base, scratch);
+    };
+
+    const std::size_t chunks = (count + kBatchChunk - 1) / kBatchChunk;
+    if (chunks > 1) ThreadPool::shared().parallelFor(chunks, runChunk);
+    else runChunk(0);
+}
@@ -0,0 +1,158 @@
+#include "KinematicSystem.hpp"
+#include "KinematicModel.hpp"
+#include "JointStateBuffer.hpp"
+#include "components.hpp"
+
+#include <entt/entt.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace KinematicSystem
+{
+    std::size_t applyJointPositions(entt::registry& registry)
+    {
+        std::size_t written = 0;
+        for (auto [root, kin, state] : registry.view<KinematicModelComponent, JointStateComponent>().each()) {
+            if (!kin.model || !state.buffer) continue;
+            const KinematicModel& model = *kin.model;
+            const double* position = state.buffer->position();
+
+            for (int dof = 0; dof < model.dofCount(); ++dof) {
+                if (position[dof] == kin.q[dof]) continue;
+                const int link = model.dofLink(dof);
+                auto* xf = registry.try_get<TransformComponent>(kin.links[link]);
+                if (!xf) continue;
+
+                kin.q[dof] = position[dof];
+                const KinematicModel::Pose local = model.localPose(link, kin.q[dof]);
+                xf->translation = local.translation;
+                xf->rotation = local.rotation;
+                ++written;
+            }
+            // This tick's joint state is final now; hand it to other threads.
+            state.buffer->publish();
+        }
+        return written;
+    }
+
+    IkSolver::Result solveEndEffector(entt::registry& registry, entt::entity robot, int link,
+        const KinematicModel::Pose& target, bool matchOrientation)
+    {
+        auto* kin = registry.try_get<KinematicModelComponent>(robot);
+        auto* state = registry.try_get<JointStateComponent>(robot);
+        if (!kin || !kin->model || !state || !state->buffer || link < 0 || link >= kin->model->linkCount()) return {};
+        const KinematicModel& model = *kin->model;
+
+        // Scratch only grows, so drag updates after the first do not allocate.
+        thread_local IkSolver solver;
+        solver.setModel(model);
+
+        KinematicModel::Pose base;
+        if (const auto* xf = registry.try_get<TransformComponent>(robot)) {
+            base.translation = xf->translation;
+            base.rotation = xf->rotation;
+        }
+
+        // Solved in place, warm-started from what the joints hold now (the previous solution).
+        return solver.solve(link, target, state->buffer->position(), matchOrientation, base);
+    }
+
+    namespace
+    {
+        // Joint coordinates at 't' waypoints along 'q' (waypoints x dofs),
+        // linear between neighbours.
+        void sampleTrajectory(const std::vector<double>& q, std::size_t dofs, std::size_t waypoints, double t, double* out)
+        {
+            const std::size_t i = std::min(std::size_t(t), waypoints - 1);
+            const std::size_t j = std::min(i + 1, waypoints - 1);
+            const double f = t - double(i);
+            const double* a = q.data() + i * dofs;
+            const double* b = q.data() + j * dofs;
+            for (std::size_t d = 0; d < dofs; ++d) out[d] = a[d] + (b[d] - a[d]) * f;
+        }
+    }
+
+    int endEffectorLink(const KinematicModel& model, int requested)
+    {
+        if (requested >= 0 && requested < model.linkCount()) return requested;
+        for (int link = model.linkCount() - 1; link > 0; --link)
+            if (model.isEndEffector(link)) return link;
+        return model.linkCount() - 1;
+    }
+
+    bool updateTrajectoryGhosts(entt::registry& registry)
+    {
+        thread_local std::vector<double> configurations;
+        thread_local std::vector<KinematicModel::Pose> world;
+
+        bool changed = false;
+        for (auto [entity, ghost] : registry.view<TrajectoryGhostComponent>().each()) {
+            const auto* kin = registry.try_get<KinematicModelComponent>(ghost.robot);
+            if (!kin || !kin->model) continue;
+            const KinematicModel& model = *kin->model;
+
+            if (ghost.isDirty) {
+                ghost.isDirty = false;
+                ghost.poses.reset();
+                ghost.path.clear();
+                ghost.linkCount = model.linkCount();
+                ghost.pathRoot = glm::mat4(0.0f);
+                changed = true;
+
+                const std::size_t dofs = std::size_t(model.dofCount());
+                const std::size_t links = std::size_t(model.linkCount());
+                const std::size_t waypoints = dofs ? ghost.q.size() / dofs : 0;
+                if (waypoints > 0 && links > 0) {
+                    const std::size_t ghosts = waypoints == 1 ? 1
+                        : std::size_t(std::clamp(ghost.ghosts, 1, TrajectoryGhostComponent::kMaxGhosts));
+                    const std::size_t pathPoints = std::min(waypoints, TrajectoryGhostComponent::kMaxPathPoints);
+                    const double last = double(waypoints - 1);
+
+                    // Ghosts first, then the path samples, through one batch.
+                    configurations.resize((ghosts + pathPoints) * dofs);
+                    double* out = configurations.data();
+                    for (std::size_t k = 0; k < ghosts; ++k, out += dofs)
+                        sampleTrajectory(ghost.q, dofs, waypoints, ghosts > 1 ? last * double(k) / double(ghosts - 1) : last, out);
+                    for (std::size_t p = 0; p < pathPoints; ++p, out += dofs)
+                        sampleTrajectory(ghost.q, dofs, waypoints, pathPoints > 1 ? last * double(p) / double(pathPoints - 1) : last, out);
+                    world.resize((ghosts + pathPoints) * links);
+                    model.forwardBatch(configurations.data(), ghosts + pathPoints, world.data());
+
+                    auto poses = std::make_shared<std::vector<glm::mat4>>(ghosts * links);
+                    for (std::size_t i = 0; i < ghosts * links; ++i) (*poses)[i] = world[i].matrix();
+                    ghost.poses = std::move(poses);
+
+                    const std::size_t tip = std::size_t(endEffectorLink(model, ghost.endEffector));
+                    ghost.path.reserve(pathPoints);
+                    for (std::size_t p = 0; p < pathPoints; ++p)
+                        ghost.path.push_back(world[(ghosts + p) * links + tip].translation);
+                }
+            }
+
+            // The path is a spline in world space: re-placed when the robot moves.
+            if (!ghost.showPath || ghost.path.size() < 2) {
+                changed |= registry.remove<SplineComponent>(entity) > 0;
+                continue;
+            }
+            const auto* rootWorld = registry.try_get<WorldTransformComponent>(ghost.robot);
+            const auto* rootLocal = registry.try_get<TransformComponent>(ghost.robot);
+            const glm::mat4 root = rootWorld ? rootWorld->matrix : rootLocal ? rootLocal->getTransform() : glm::mat4(1.0f);
+            if (root == ghost.pathRoot && registry.all_of<SplineComponent>(entity)) continue;
+
+            auto& spline = registry.get_or_emplace<SplineComponent>(entity);
+            spline.type = SplineType::CatmullRom;
+            spline.glowColour = glm::vec4(ghost.colour, 0.6f);
+            spline.coreColour = glm::vec4(glm::mix(ghost.colour, glm::vec3(1.0f), 0.6f), 1.0f);
+            spline.thickness = 4.0f;
+            // Catmull-Rom skips its end points; repeating them runs the curve through every waypoint.
+            spline.controlPoints.clear();
+            spline.controlPoints.push_back(glm::vec3(root * glm::vec4(ghost.path.front(), 1.0f)));
+            for (const glm::vec3& p : ghost.path) spline.controlPoints.push_back(glm::vec3(root * glm::vec4(p, 1.0f)));
+            spline.controlPoints.push_back(spline.controlPoints.back());
+            spline.isDirty = true;
+            ghost.pathRoot = root;
+            changed = true;
+        }
+        return changed;
+    }
+}
@@ -0,0 +1,127 @@
+#include "LinkThumbnails.hpp"
+#include "MeshCache.hpp"
+#include "ThreadPool.hpp"
+#include "components.hpp"
+
+#include <QCoreApplication>
+#include <QPointer>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+// Three-quarter view: turned 35 degrees about y, then tipped 25 degrees
+// towards the viewer about x.
+constexpr float kYaw = 0.610865f;
+constexpr float kPitch = 0.436332f;
+
+std::uint32_t packColour(const glm::vec4& colour)
+{
+    const glm::vec3 c = glm::clamp(glm::vec3(colour), glm::vec3(0.0f), glm::vec3(1.0f));
+    return qRgb(int(c.r * 255.0f + 0.5f), int(c.g * 255.0f + 0.5f), int(c.b * 255.0f + 0.5f));
+}
+}
+
+void LinkThumbnails::request(const QString& id, const std::string& meshPath, const glm::vec4& colour)
+{
+    if (meshPath.empty()) return;
+    const std::uint32_t rgb = packColour(colour);
+    if (const auto content = m_contentOf.find(meshPath); content != m_contentOf.end()) {
+        if (const auto it = m_images.find({ content->second, rgb }); it != m_images.end()) {
+            emit ready(id, it->second);
+            return;
+        }
+    }
+
+    // The pool task never touches 'this'; the reply runs on the GUI thread,
+    // where the QPointer can be checked safely.
+    QPointer<LinkThumbnails> self(this);
+    ThreadPool::shared().submit([self, id, meshPath, colour, rgb] {
+        MeshCache::Handle mesh;
+        try {
+            mesh = MeshCache::shared().load(meshPath);
+        }
+        catch (const std::exception& e) {
+            qWarning() << "[LinkThumbnails]" << e.what();
+            return;
+        }
+        const std::size_t content = MeshCache::keyOf(*mesh);
+        const QImage image = render(*mesh, colour);
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, id, meshPath, content, rgb, image] {
+            if (!self) return;
+            self->m_contentOf[meshPath] = content;
+            self->m_images[{ content, rgb }] = image;
+            emit self->ready(id, image);
+            }, Qt::QueuedConnection);
+        });
+}
+
+QImage LinkThumbnails::render(const MeshData& mesh, const glm::vec4& colour, int size)
+{
+    QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    const std::vector<Vertex>& vertices = mesh.vertices;
+    if (vertices.empty()) return image;
+
+    glm::vec3 lo(vertices[0].position), hi(lo);
+    for (const Vertex& v : vertices) {
+        lo = glm::min(lo, v.position);
+        hi = glm::max(hi, v.position);
+    }
+    const glm::vec3 centre = 0.5f * (lo + hi);
+    const float radius = std::max(0.5f * glm::length(hi - lo), 1e-6f);
+
+    // Columns of the view rotation, pitch after yaw; view space looks down -z.
+    const float cy = std::cos(kYaw), sy = std::sin(kYaw), cp = std::cos(kPitch), sp = std::sin(kPitch);
+    const glm::mat3 view(glm::vec3(cy, sy * sp, -sy * cp), glm::vec3(0.0f, cp, sp), glm::vec3(sy, -cy * sp, cy * cp));
+
+    // Screen x and y in pixels, z towards the viewer; the bounding sphere fills 90%.
+    const float half = 0.5f * float(size);
+    std::vector<glm::vec3> screen(vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+        const glm::vec3 p = view * (vertices[i].position - centre) / radius;
+        screen[i] = glm::vec3(half + 0.9f * half * p.x, half - 0.9f * half * p.y, p.z);
+    }
+
+    std::vector<float> depth(std::size_t(size) * size, -std::numeric_limits<float>::max());
+    const glm::vec3 albedo = glm::clamp(glm::vec3(colour), glm::vec3(0.0f), glm::vec3(1.0f));
+    const std::size_t triangles = mesh.indices.empty() ? vertices.size() / 3 : mesh.indices.size() / 3;
+    auto index = [&](std::size_t k) -> std::size_t { return mesh.indices.empty() ? k : mesh.indices[k]; };
+
+    for (std::size_t t = 0; t < triangles; ++t) {
+        const std::size_t ia = index(3 * t), ib = index(3 * t + 1), ic = index(3 * t + 2);
+        if (ia >= screen.size() || ib >= screen.size() || ic >= screen.size()) continue;
+        const glm::vec3 a = screen[ia], b = screen[ib], c = screen[ic];
+        const float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (std::abs(area) < 1e-8f) continue;
+
+        // Flat, two-sided: lit from the viewer, so a face turned away is dark.
+        const glm::vec3 n = glm::normalize(glm::cross(view * (vertices[ib].position - vertices[ia].position),
+                                                      view * (vertices[ic].position - vertices[ia].position)));
+        const glm::vec3 shaded = albedo * (0.25f + 0.75f * std::abs(n.z));
+        const QRgb pixel = qRgb(int(shaded.r * 255.0f + 0.5f), int(shaded.g * 255.0f + 0.5f), int(shaded.b * 255.0f + 0.5f));
+
+        const int x0 = std::max(0, int(std::floor(std::min({ a.x, b.x, c.x }))));
+        const int x1 = std::min(size - 1, int(std::ceil(std::max({ a.x, b.x, c.x }))));
+        const int y0 = std::max(0, int(std::floor(std::min({ a.y, b.y, c.y }))));
+        const int y1 = std::min(size - 1, int(std::ceil(std::max({ a.y, b.y, c.y }))));
+        for (int y = y0; y <= y1; ++y) {
+            QRgb* row = reinterpret_cast<QRgb*>(image.scanLine(y));
+            for (int x = x0; x <= x1; ++x) {
+                const float px = float(x) + 0.5f, py = float(y) + 0.5f;
+                const float wa = ((b.x - px) * (c.y - py) - (b.y - py) * (c.x - px)) / area;
+                const float wb = ((c.x - px) * (a.y - py) - (c.y - py) * (a.x - px)) / area;
+                const float wc = 1.0f - wa - wb;
+                if (wa < 0.0f || wb < 0.0f || wc < 0.0f) continue;
+                const float z = wa * a.z + wb * b.z + wc * c.z;
+                float& nearest = depth[std::size_t(y) * size + x];
+                if (z <= nearest) continue;
+                nearest = z;
+                row[x] = pixel;
+            }
+        }
+    }
+    return image;
+}
@@ -2,36 +2,106 @@
 #include "StaticToolbar.hpp"
 #include "PropertiesPanel.hpp"
 #include "Scene.hpp"
+#include "AnimationTracks.hpp"
 #include "ViewportWidget.hpp"
 #include "components.hpp" 
 #include "Camera.hpp"
 #include "SceneBuilder.hpp"
 #include "GridLevel.hpp"
+#include "FrameArena.hpp"
+#include "FrameBenchmark.hpp"
 #include "KRobotParser.hpp"
 #include "KRobotWriter.hpp"
+#include "SceneFile.hpp"
+#include "WorldPartition.hpp"
+#include "Prefab.hpp"
+#if KR_PYTHON_ENABLED
+#include "ScriptHost.hpp"
+#endif
+#include "TransformSystem.hpp"
 #include "URDFParser.hpp"
 #include "SDFParser.hpp"
 #include "RobotEnrichmentDialog.hpp"
 #include "Mesh.hpp" // Required for the test cube's mesh data.
+#include "MeshCache.hpp"
 #include "IntersectionSystem.hpp" 
+#include "CullingSystem.hpp"
+#include "KinematicSystem.hpp"
+#include "KinematicModel.hpp"
+#include "ScriptApi.hpp"
+#include "WorkspaceMap.hpp"
+#include "CollisionWorld.hpp"
+#include "MotionPlanner.hpp"
+#include "TrajectoryTiming.hpp"
+#include "RigidBodyDynamics.hpp"
+#include "SafetyZones.hpp"
+#include "ClearanceMonitor.hpp"
+#include "TelemetryHub.hpp"
+#include "SerialTelemetry.hpp"
+#include "JointCommandLoop.hpp"
+#include "EStopService.hpp"
+#if KR_ETHERCAT_ENABLED
+#include "EtherCatMaster.hpp"
+#endif
+#include "DynamicsSimulation.hpp"
+#include "SimulatedSensors.hpp"
+#include "MotorSimulation.hpp"
+#include "BatchJobs.hpp"
+#include "SessionLog.hpp"
+#include "SessionPlayback.hpp"
+#include "RobotImportJob.hpp"
+#include "PointCloudOctree.hpp"
+#include "SensorStream.hpp"
+#include "CanMonitorPanel.hpp"
+#include "EventLogPanel.hpp"
+#include "FindReplaceDialog.hpp"
+#include "SceneOutlinerModel.hpp"
+#include "GltfExport.hpp"
+#include "ProjectSync.hpp"
+#include "RemoteViewServer.hpp"
+#include "TwinSync.hpp"
+#include "SystemScheduler.hpp"
+#include "PerfHud.hpp"
 #include "RenderingSystem.hpp"
 #include "FlowVisualizerMenu.hpp"
 #include "Helpers.hpp"   
+#include "Trace.hpp"
+#include "TraceZones.hpp"
 
 #include <QVBoxLayout>
 #include <QFileDialog>
+#include <QHostInfo>
+#include <QInputDialog>
 #include <QMessageBox>
 #include <QWidget>
 #include <QMenuBar>
 #include <QStatusBar>
+#include <QProgressBar>
+#include <QLabel>
+#include <QToolButton>
+#include <QActionGroup>
+#include <QMenu>
 #include <QTimer>
+#include <QEvent>
+#include <QMouseEvent>
 #include <QDebug>
 #include <DockManager.h>
 #include <DockWidget.h>
 #include <DockAreaWidget.h>
+#include <DockSplitter.h>
+#include <FloatingDragPreview.h>
 #include <QApplication>
 #include <QButtonGroup>
 #include <QSplitter>
+#include <QShortcut>
+#include <QStandardPaths>
+#include <QDir>
+#include <QDateTime>
+#include <QTreeView>
+#include <QItemSelectionModel>
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
 #include "DockSplitter.h" 
 
 const QString sidePanelStyle = R"(
@@ -131,6 +201,125 @@ const QString sidePanelStyle = R"(
     }
 )";
 
+namespace {
+// The lit unit cube [-0.5, 0.5]^3, shared by every entity that uses it.
+MeshCache::Handle litCubeMesh()
+{
+    const std::vector<float>& raw = Mesh::getLitCubeVertices();
+    constexpr std::size_t stride = 6;
+    std::vector<Vertex> vertices;
+    vertices.reserve(raw.size() / stride);
+    for (std::size_t i = 0; i < raw.size(); i += stride)
+    {
+        glm::vec3 pos{ raw[i],     raw[i + 1], raw[i + 2] };
+        glm::vec3 normal{ raw[i + 3],   raw[i + 4], raw[i + 5] };
+        vertices.emplace_back(pos, normal);
+    }
+    return MeshCache::shared().intern(std::move(vertices), Mesh::getLitCubeIndices());
+}
+
+// The visualizer settings the renderer sizes or seeds GPU buffers from:
+// changing any of them reallocates. Everything else reaches the shaders
+// as uniforms each tick.
+struct FieldBufferInputs {
+    FieldVisualizerComponent::DisplayMode displayMode;
+    glm::ivec3 arrowDensity;
+    int particleCount;
+    float particleLifetime, particleBaseSize;
+    int flowCount;
+    float flowLifetime, flowBaseSize;
+
+    explicit FieldBufferInputs(const FieldVisualizerComponent& v)
+        : displayMode(v.displayMode), arrowDensity(v.arrowSettings.density),
+          particleCount(v.particleSettings.particleCount), particleLifetime(v.particleSettings.lifetime),
+          particleBaseSize(v.particleSettings.baseSize), flowCount(v.flowSettings.particleCount),
+          flowLifetime(v.flowSettings.lifetime), flowBaseSize(v.flowSettings.baseSize) {}
+
+    void applyTo(FieldVisualizerComponent& v) const
+    {
+        v.displayMode = displayMode;
+        v.arrowSettings.density = arrowDensity;
+        v.particleSettings.particleCount = particleCount;
+        v.particleSettings.lifetime = particleLifetime;
+        v.particleSettings.baseSize = particleBaseSize;
+        v.flowSettings.particleCount = flowCount;
+        v.flowSettings.lifetime = flowLifetime;
+        v.flowSettings.baseSize = flowBaseSize;
+    }
+
+    bool operator==(const FieldBufferInputs& o) const
+    {
+        return displayMode == o.displayMode && arrowDensity == o.arrowDensity && particleCount == o.particleCount
+            && particleLifetime == o.particleLifetime && particleBaseSize == o.particleBaseSize
+            && flowCount == o.flowCount && flowLifetime == o.flowLifetime && flowBaseSize == o.flowBaseSize;
+    }
+    bool operator!=(const FieldBufferInputs& o) const { return !(*this == o); }
+};
+
+// ADS has no signals for a splitter drag or a dock drag preview, so this
+// application-wide filter reports them: changed(true) when the first
+// starts, changed(false) when the last ends.
+class DockInteractionFilter : public QObject
+{
+public:
+    DockInteractionFilter(std::function<void(bool)> changed, QObject* parent)
+        : QObject(parent), m_changed(std::move(changed)) {}
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override
+    {
+        switch (event->type()) {
+        case QEvent::MouseButtonPress:
+            if (isDockSplitterHandle(watched)) begin(watched);
+            break;
+        case QEvent::MouseButtonRelease:
+            if (isDockSplitterHandle(watched)) end(watched);
+            break;
+        case QEvent::Show:
+            if (qobject_cast<ads::CFloatingDragPreview*>(watched)) {
+                begin(watched);
+                // Dropped previews are deleted; they may not hide first.
+                connect(watched, &QObject::destroyed, this, [this, watched]() { end(watched); });
+            }
+            break;
+        case QEvent::Hide:
+            if (qobject_cast<ads::CFloatingDragPreview*>(watched)) end(watched);
+            break;
+        default:
+            break;
+        }
+        return false;
+    }
+
+private:
+    static bool isDockSplitterHandle(QObject* object)
+    {
+        const auto* handle = qobject_cast<QSplitterHandle*>(object);
+        return handle && qobject_cast<ads::CDockSplitter*>(handle->splitter());
+    }
+    void begin(QObject* source)
+    {
+        if (m_active.insert(source).second && m_active.size() == 1) m_changed(true);
+    }
+    void end(QObject* source)
+    {
+        if (m_active.erase(source) && m_active.empty()) m_changed(false);
+    }
+
+    std::function<void(bool)> m_changed;
+    std::unordered_set<QObject*> m_active;
+};
+}
+
+// Every construct/update/destroy of these types marks the scene dirty; see onRegistryChanged().
+template <class... C>
+void MainWindow::watchComponents(entt::registry& registry)
+{
+    ((m_registryWatch.emplace_back(registry.on_construct<C>().template connect<&MainWindow::onRegistryChanged>(this)),
+      m_registryWatch.emplace_back(registry.on_update<C>().template connect<&MainWindow::onRegistryChanged>(this)),
+      m_registryWatch.emplace_back(registry.on_destroy<C>().template connect<&MainWindow::onRegistryChanged>(this))), ...);
+}
+
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent)
 {
@@ -170,17 +359,7 @@ MainWindow::MainWindow(QWidget* parent)
         pointEffector.strength = -1.0f;
         pointEffector.distance = 3.0f;
 
-        auto& mesh = registry.emplace<RenderableMeshComponent>(cubeEntity);
-        const std::vector<float>& raw = Mesh::getLitCubeVertices();
-        constexpr std::size_t stride = 6;
-        mesh.vertices.reserve(raw.size() / stride);
-        for (std::size_t i = 0; i < raw.size(); i += stride)
-        {
-            glm::vec3 pos{ raw[i],     raw[i + 1], raw[i + 2] };
-            glm::vec3 normal{ raw[i + 3],   raw[i + 4], raw[i + 5] };
-            mesh.vertices.emplace_back(pos, normal);
-        }
-        mesh.indices = Mesh::getLitCubeIndices();
+        registry.emplace<RenderableMeshComponent>(cubeEntity, litCubeMesh());
     }
 
     // --- Create Splines ---
@@ -212,7 +391,7 @@ MainWindow::MainWindow(QWidget* parent)
         auto& registry = m_scene->getRegistry();
         QTimer::singleShot(0, this, [this, &registry] {
             auto view = registry.view<FieldVisualizerComponent>();
-            if (!view.empty())
+            if (!view.empty() && m_flowVisualizerMenu)
                 m_flowVisualizerMenu->updateControlsFromComponent(
                     firstComponent<FieldVisualizerComponent>(registry));
             });
@@ -258,6 +437,41 @@ MainWindow::MainWindow(QWidget* parent)
 
     // --- 2. Create the SINGLE Shared Rendering System ---
     m_renderingSystem = std::make_unique<RenderingSystem>(nullptr);
+    m_telemetry = std::make_unique<TelemetryHub>();
+    {
+        SerialTelemetry::Settings serial;
+        if (const int baud = qEnvironmentVariableIntValue("KR_SERIAL_BAUD"); baud > 0) serial.baud = baud;
+        SerialTelemetry::install(*m_telemetry, serial);
+    }
+    m_commandLoop = std::make_unique<JointCommandLoop>();
+    m_estop = std::make_unique<EStopService>(*m_commandLoop);
+    m_estop->start();
+#if KR_ETHERCAT_ENABLED
+    {
+        EtherCatMaster::Settings ethercat;
+        if (const QString nic = qEnvironmentVariable("KR_ETHERCAT_IFNAME"); !nic.isEmpty())
+            ethercat.interfaceName = nic.toStdString();
+        m_ethercat = EtherCatMaster::install(*m_commandLoop, *m_telemetry, ethercat);
+    }
+#endif
+    m_dynamics = std::make_unique<DynamicsSimulation>();
+    m_collision = std::make_unique<CollisionWorld>();
+    m_planner = std::make_unique<MotionPlanner>();
+    m_safetyZones = std::make_unique<SafetyZoneMonitor>(*m_collision);
+    m_safetyZones->setHandler([this](const SafetyZoneMonitor::Event& event) {
+        onSafetyZoneEvent(event.zone, event.link, event.entered);
+        });
+    m_clearance = std::make_unique<ClearanceMonitor>();
+    m_robotImport = std::make_unique<RobotImportJob>();
+    m_world = std::make_unique<WorldPartition>();
+    setupTickSystems();
+    m_perfHud = std::make_unique<PerfHud>();
+    // What the viewports draw; edits from dialogs and panels wake an idle loop.
+    watchComponents<TransformComponent, MaterialComponent, RenderableMeshComponent, SelectedComponent,
+        SplineComponent, FieldVisualizerComponent, GridComponent, CameraComponent,
+        PulsingLightComponent, PointLightComponent, PulsingSplineTag>(registry);
+    // Connected here, before the "animations" system first runs on the pool.
+    AnimationTracks::of(registry);
 
     // --- 3. Setup the Core UI Layout (No changes here) ---
     m_centralContainer = new QWidget(this);
@@ -272,6 +486,7 @@ MainWindow::MainWindow(QWidget* parent)
 
     ViewportWidget* viewport1 = new ViewportWidget(m_scene.get(), m_renderingSystem.get(), cameraEntity1, this); // Creates the first viewport widget.
     m_viewports.push_back(viewport1); // Adds the viewport to a list for management.
+    viewport1->setPerfHud(m_perfHud.get());
     m_renderingSystem->setViewportWidget(viewport1); // Associates the renderer with its primary viewport.
     ads::CDockWidget* viewportDock1 = new ads::CDockWidget("3D Viewport 1 (Camera 1)"); // Creates the first dockable viewport.
     viewportDock1->setWidget(viewport1); // Sets the viewport as the content of the dock widget.
@@ -280,15 +495,21 @@ MainWindow::MainWindow(QWidget* parent)
     // Create the SECONDARY viewport and dock it to the RIGHT of the FIRST one.
     ViewportWidget* viewport2 = new ViewportWidget(m_scene.get(), m_renderingSystem.get(), cameraEntity2, this); // Creates the second viewport widget.
     m_viewports.push_back(viewport2); // Adds the viewport to the list.
+    viewport2->setPerfHud(m_perfHud.get());
     ads::CDockWidget* viewportDock2 = new ads::CDockWidget("3D Viewport 2 (Camera 2)"); // Creates the second dockable viewport.
     viewportDock2->setWidget(viewport2); // Sets the viewport as the content of the dock widget.
     ads::CDockAreaWidget* viewportArea2 = m_dockManager->addDockWidget(ads::RightDockWidgetArea, viewportDock2, viewportArea1); // This is key: docks viewport 2 to the right OF viewport 1, creating a horizontal split.
 
-    // Create the properties panel and dock it to the RIGHT of the SECOND viewport.
-    PropertiesPanel* propertiesPanel = new PropertiesPanel(m_scene.get(), this); // Creates the properties panel widget.
-    propertiesPanel->setMinimumWidth(700); // Sets the minimum width of the properties panel. The dock widget will respect this.
+    // Create the properties panel dock to the RIGHT of the SECOND viewport; the
+    // panel itself is built the first time its tab is shown.
     ads::CDockWidget* propertiesDock = new ads::CDockWidget("Grid(s)"); // Creates the properties dock widget.
-    propertiesDock->setWidget(propertiesPanel); // Sets the properties panel as the content of the dock widget.
+    propertiesDock->setMinimumWidth(700); // Sets the minimum width of the properties column, with or without its content.
+    setLazyDockContent(propertiesDock, [this]() -> QWidget* {
+        m_propertiesPanel = new PropertiesPanel(m_scene.get(), this); // Creates the properties panel widget.
+        m_propertiesPanel->setMinimumWidth(700); // Sets the minimum width of the properties panel. The dock widget will respect this.
+        m_propertiesPanel->installEventFilter(this);
+        return m_propertiesPanel;
+        });
     propertiesDock->setStyleSheet(sidePanelStyle); // Applies your custom style.
     ads::CDockAreaWidget* propertiesArea = m_dockManager->addDockWidget(ads::RightDockWidgetArea, propertiesDock, viewportArea2); // Docks the properties panel to the right OF viewport 2, creating our third column.
 
@@ -301,26 +522,85 @@ MainWindow::MainWindow(QWidget* parent)
         mainSplitter->setSizes({ 1, 2, 1 });
     }
 
-    // Create the flow visualizer menu and add it as a TAB to the properties area.
-    m_flowVisualizerMenu = new FlowVisualizerMenu(this); // Creates the flow visualizer menu widget.
+    // Add the flow visualizer menu as a TAB to the properties area, built on first show.
     ads::CDockWidget* flowMenuDock = new ads::CDockWidget("Field Visualizer"); // Creates the flow visualizer dock widget.
-    m_flowVisualizerMenu->setMinimumWidth(650); // Sets the minimum width for this widget as well.
-    flowMenuDock->setWidget(m_flowVisualizerMenu); // Sets the menu as the content of the dock widget.
+    setLazyDockContent(flowMenuDock, [this]() -> QWidget* {
+        m_flowVisualizerMenu = new FlowVisualizerMenu(this); // Creates the flow visualizer menu widget.
+        m_flowVisualizerMenu->setMinimumWidth(650); // Sets the minimum width for this widget as well.
+        m_flowVisualizerMenu->installEventFilter(this);
+        connect(m_flowVisualizerMenu, &FlowVisualizerMenu::settingsChanged,
+            this, &MainWindow::onFlowVisualizerSettingsChanged);
+        connect(m_flowVisualizerMenu, &FlowVisualizerMenu::transformChanged,
+            this, &MainWindow::onFlowVisualizerTransformChanged);
+        updateVisualizerUI();   // the component is the source of truth until the menu exists
+        return m_flowVisualizerMenu;
+        });
     flowMenuDock->setStyleSheet(sidePanelStyle); // Applies your custom style.
     m_dockManager->addDockWidget(ads::CenterDockWidgetArea, flowMenuDock, propertiesArea); // Adds the flow menu as a tab in the properties dock area.
-    
-    connect(m_flowVisualizerMenu, &FlowVisualizerMenu::settingsChanged,
-        this, &MainWindow::onFlowVisualizerSettingsChanged);
 
-    connect(m_flowVisualizerMenu, &FlowVisualizerMenu::transformChanged,
-        this, &MainWindow::onFlowVisualizerTransformChanged);
+    // CAN bus monitor, another tab there; shown and capturing while the toolbar's CAN Bus button is down.
+    m_canMonitorDock = new ads::CDockWidget("CAN Bus");
+    setLazyDockContent(m_canMonitorDock, [this]() -> QWidget* {
+        m_canMonitor = new CanMonitorPanel(this);
+        return m_canMonitor;
+        });
+    m_canMonitorDock->setStyleSheet(sidePanelStyle);
+    m_dockManager->addDockWidget(ads::CenterDockWidgetArea, m_canMonitorDock, propertiesArea);
+    m_canMonitorDock->toggleView(false);
+
+    // Event log, another tab there; shown while the toolbar's Fault Log button is down.
+    m_eventLogDock = new ads::CDockWidget("Event Log");
+    setLazyDockContent(m_eventLogDock, [this]() -> QWidget* {
+        m_eventLog = new EventLogPanel(this);
+        return m_eventLog;
+        });
+    m_eventLogDock->setStyleSheet(sidePanelStyle);
+    m_dockManager->addDockWidget(ads::CenterDockWidgetArea, m_eventLogDock, propertiesArea);
+    m_eventLogDock->toggleView(false);
+
+    // Scene outliner tab: the entity tree, loaded as it is expanded; picking a row selects the entity.
+    ads::CDockWidget* outlinerDock = new ads::CDockWidget("Outliner");
+    setLazyDockContent(outlinerDock, [this]() -> QWidget* {
+        auto* tree = new QTreeView(this);
+        tree->setUniformRowHeights(true);   // lets the view skip measuring rows it does not paint
+        tree->setHeaderHidden(true);
+        m_outlinerModel = new SceneOutlinerModel(m_scene->getRegistry(), tree);
+        tree->setModel(m_outlinerModel);
+        connect(tree->selectionModel(), &QItemSelectionModel::currentChanged, this, [this](const QModelIndex& current) {
+            auto& registry = m_scene->getRegistry();
+            const entt::entity entity = m_outlinerModel->entityAt(current);
+            if (!registry.valid(entity)) return;
+            registry.clear<SelectedComponent>();
+            registry.emplace<SelectedComponent>(entity);
+            markSceneDirty();
+            });
+        return tree;
+        });
+    outlinerDock->setStyleSheet(sidePanelStyle);
+    m_dockManager->addDockWidget(ads::CenterDockWidgetArea, outlinerDock, propertiesArea);
+
+    m_fieldRebuildTimer = new QTimer(this);
+    m_fieldRebuildTimer->setSingleShot(true);
+    m_fieldRebuildTimer->setInterval(kFieldRebuildDelayMs);
+    connect(m_fieldRebuildTimer, &QTimer::timeout, this, [this]() {
+        m_applyingFieldRebuild = true;
+        onFlowVisualizerSettingsChanged();
+        m_applyingFieldRebuild = false;
+        });
 
     // --- 5. FINAL, ROBUST INITIALIZATION AND RENDER LOOP START ---
 
     // 1. Create the timer, but DO NOT START IT YET.
     m_masterRenderTimer = new QTimer(this);
+    m_masterRenderTimer->setTimerType(Qt::PreciseTimer); // CoarseTimer may drift by ~5% per tick
     connect(m_masterRenderTimer, &QTimer::timeout, this, &MainWindow::onMasterRender);
 
+    for (ViewportWidget* vp : m_viewports) {
+        connect(vp, &QOpenGLWidget::frameSwapped, this, &MainWindow::onViewportFrameSwapped);
+        connect(vp, &ViewportWidget::sceneEdited, this, [this]() { markSceneDirty(); });
+        vp->installEventFilter(this);
+    }
+
     // Connect to the primary viewport's signal. When its GL context is ready,
     // we will initialize our shared RenderingSystem.
     connect(viewport1, &ViewportWidget::glContextReady, this, [this, viewport1]() {
@@ -333,20 +613,98 @@ MainWindow::MainWindow(QWidget* parent)
             m_renderingSystem->initialize(viewport1->width(), viewport1->height());
             viewport1->doneCurrent();
 
+            // KR_GL_CAPTURE=<frames>: F8's capture from the first frame on,
+            // for problems that only show while the scene loads.
+            if (const int frames = qEnvironmentVariableIntValue("KR_GL_CAPTURE"); frames > 0) {
+                const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QStringLiteral("/traces");
+                QDir().mkpath(dir);
+                m_renderingSystem->startGlCapture(frames, dir + QStringLiteral("/gl-capture-%1.json")
+                    .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss"))));
+            }
+            // KR_GPU_FK=1: large prefab fleets posed by the renderer.
+            if (qEnvironmentVariableIntValue("KR_GPU_FK") && m_renderingSystem->gpuKinematicsSupported())
+                PrefabSystem::setGpuPosing(true);
+
             // Now that the renderer is ready, we can safely start the main render loop.
             qDebug() << "[LIFECYCLE] RenderingSystem is initialized. Starting master render timer.";
-            m_masterRenderTimer->start(16); // Target ~60 FPS
+            m_sceneDirty = true;
+            startMasterLoop();
         }
         });
 
     // --- 6. Other Signal/Slot Connections ---
     connect(m_fixedTopToolbar, &StaticToolbar::loadRobotClicked, this, &MainWindow::onLoadRobotClicked);
+    connect(m_fixedTopToolbar, &StaticToolbar::importPointCloudClicked, this, &MainWindow::onImportPointCloudClicked);
+    connect(m_fixedTopToolbar, &StaticToolbar::showLidarToggled, this, &MainWindow::setSimulatedLidar);
+    connect(m_fixedTopToolbar, &StaticToolbar::liveReconstructionToggled, this, &MainWindow::setLiveReconstruction);
+    connect(m_fixedTopToolbar, &StaticToolbar::canBusToggled, this, &MainWindow::setCanMonitor);
+    connect(m_fixedTopToolbar, &StaticToolbar::eventLogToggled, m_eventLogDock, &ads::CDockWidget::toggleView);
+    connect(m_fixedTopToolbar, &StaticToolbar::remoteViewToggled, this, &MainWindow::setRemoteView);
+    connect(m_fixedTopToolbar, &StaticToolbar::twinSyncToggled, this, &MainWindow::setTwinSync);
+    connect(m_fixedTopToolbar, &StaticToolbar::addLaserGateClicked, this, &MainWindow::addLaserGate);
+    connect(m_fixedTopToolbar, &StaticToolbar::emergencyStopPressed, this, &MainWindow::onEmergencyStopPressed);
+    connect(m_fixedTopToolbar, &StaticToolbar::exportClicked, this, &MainWindow::exportGltf);
+    connect(m_fixedTopToolbar, &StaticToolbar::showFramesToggled, this, [this](bool enabled) {
+        m_renderingSystem->setFramesShown(enabled);
+        markSceneDirty();
+        });
+    connect(m_fixedTopToolbar, &StaticToolbar::annotationToggled, this, &MainWindow::setJointLabels);
+    connect(m_fixedTopToolbar, &StaticToolbar::findReplaceClicked, this, &MainWindow::showFindReplace);
+    connect(m_fixedTopToolbar, &StaticToolbar::showCollisionsToggled, this, [this](bool enabled) {
+        m_collisionChecking = enabled;
+        if (!enabled) m_collision->clearContacts(m_scene->getRegistry());
+        markSceneDirty();
+        });
+    buildViewMenu(m_fixedTopToolbar->viewMenu());
+    connect(m_fixedTopToolbar, &StaticToolbar::undoClicked, this, [this]() { stepHistory(false); });
+    connect(m_fixedTopToolbar, &StaticToolbar::redoClicked, this, [this]() { stepHistory(true); });
+    // Window-wide, but a focused text field keeps Ctrl+Z for its own undo.
+    connect(new QShortcut(QKeySequence::Undo, this), &QShortcut::activated, this, [this]() { stepHistory(false); });
+    connect(new QShortcut(QKeySequence::Redo, this), &QShortcut::activated, this, [this]() { stepHistory(true); });
+    connect(new QShortcut(QKeySequence::Save, this), &QShortcut::activated, this, [this]() { saveScene(); });
+    connect(new QShortcut(QKeySequence::Open, this), &QShortcut::activated, this, [this]() { openScene(); });
+    connect(new QShortcut(QKeySequence(QStringLiteral("Ctrl+Shift+S")), this), &QShortcut::activated, this,
+        [this]() { saveWorld(); });
+    connect(new QShortcut(QKeySequence(QStringLiteral("Ctrl+D")), this), &QShortcut::activated, this,
+        [this]() { instanceSelection(); });
+    connect(new QShortcut(QKeySequence(QStringLiteral("Ctrl+Shift+Y")), this), &QShortcut::activated, this,
+        [this]() { setDynamicsSimulation(!m_dynamics->running()); });
+    connect(new QShortcut(QKeySequence(QStringLiteral("Ctrl+Shift+N")), this), &QShortcut::activated, this,
+        [this]() { toggleSimulatedSensors(); });
+    connect(new QShortcut(QKeySequence(QStringLiteral("Ctrl+Shift+M")), this), &QShortcut::activated, this,
+        [this]() { runStepResponse(); });
+    connect(new QShortcut(QKeySequence(QStringLiteral("Ctrl+Shift+V")), this), &QShortcut::activated, this,
+        [this]() { toggleVirtualSensors(); });
+    connect(new QShortcut(QKeySequence(QStringLiteral("Ctrl+Shift+G")), this), &QShortcut::activated, this,
+        [this]() { toggleTrajectoryGhosts(); });
+    connect(new QShortcut(QKeySequence(QStringLiteral("Ctrl+Shift+E")), this), &QShortcut::activated, this,
+        [this]() { executePlannedPath(); });
+    connect(new QShortcut(QKeySequence(QStringLiteral("Ctrl+Shift+W")), this), &QShortcut::activated, this,
+        [this]() { toggleWorkspaceMap(); });
+    connect(new QShortcut(QKeySequence(QStringLiteral("Ctrl+Shift+U")), this), &QShortcut::activated, this,
+        [this]() { syncProject(true); });
+    connect(new QShortcut(QKeySequence(QStringLiteral("Ctrl+Shift+J")), this), &QShortcut::activated, this,
+        [this]() { syncProject(false); });
+#if KR_PYTHON_ENABLED
+    connect(new QShortcut(QKeySequence(QStringLiteral("Ctrl+Shift+P")), this), &QShortcut::activated, this,
+        [this]() { runScript(); });
+#endif
+    // Dock drags and splitter resizes render at reduced resolution into the
+    // FBOs already allocated; the first frame after draws at full quality.
+    qApp->installEventFilter(new DockInteractionFilter([this](bool active) {
+        m_renderingSystem->setLayoutInteraction(active);
+        if (!active)
+            for (ViewportWidget* vp : m_viewports) m_renderingSystem->requestFullResolution(vp);
+        markSceneDirty();
+        }, this));
     connect(viewportDock1, &ads::CDockWidget::topLevelChanged, this, [viewport1](bool isFloating) { /* ... */ });
     connect(viewportDock2, &ads::CDockWidget::topLevelChanged, this, [viewport2](bool isFloating) { /* ... */ });
-    connect(m_flowVisualizerMenu, &FlowVisualizerMenu::settingsChanged, this, &MainWindow::onFlowVisualizerSettingsChanged);
+    setupSessionShortcuts();
+    setupImportStatus();
 
     updateVisualizerUI();
-    onFlowVisualizerSettingsChanged();
+    onFlowVisualizerSettingsChanged();   // both no-ops while the menu's tab has not been shown
+    m_scene->undo().clear();   // the initial sync is not an edit
 
     // --- 7. Final Window Setup ---
     if (menuBar()) {
@@ -358,34 +716,477 @@ MainWindow::MainWindow(QWidget* parent)
     statusBar()->showMessage("Ready.");
 }
 
+void MainWindow::buildViewMenu(QMenu* menu)
+{
+    // Frame pacing: one of three, checked to match the current mode.
+    QMenu* pacing = menu->addMenu("Frame pacing");
+    auto* pacingGroup = new QActionGroup(pacing);
+    const auto addPacing = [&](const QString& text, FramePacing mode) {
+        QAction* action = pacing->addAction(text);
+        action->setCheckable(true);
+        action->setChecked(m_framePacing == mode);
+        pacingGroup->addAction(action);
+        connect(action, &QAction::triggered, this, [this, mode]() { setFramePacing(mode, m_targetFps); });
+    };
+    addPacing(QString("Fixed %1 Hz").arg(m_targetFps), FramePacing::FixedInterval);
+    addPacing("Display refresh (VSync)", FramePacing::VSync);
+    addPacing("Uncapped", FramePacing::Uncapped);
+    menu->addSeparator();
+
+    // Clicks select through the mesh pass's ID attachment instead of a ray
+    // against the BLASes; costs an R32UI target per viewport.
+    QAction* idPicking = menu->addAction("GPU picking (ID buffer)");
+    idPicking->setCheckable(true);
+    idPicking->setChecked(m_renderingSystem->idBufferPicking());
+    connect(idPicking, &QAction::toggled, this, [this](bool on) {
+        m_renderingSystem->setIdBufferPicking(on);
+        markSceneDirty();
+    });
+
+    // Both eyes in one pass on a stereo surface; mono on any other.
+    QAction* stereo = menu->addAction("Stereo (on stereo displays)");
+    stereo->setCheckable(true);
+    stereo->setChecked(m_renderingSystem->stereo());
+    connect(stereo, &QAction::toggled, this, [this](bool on) {
+        m_renderingSystem->setStereo(on);
+        markSceneDirty();
+    });
+
+    // Selection drawn as a stencil outline in the scene pass rather than
+    // the blurred glow; no blur passes while something is selected.
+    QAction* outline = menu->addAction("Outline selection");
+    outline->setCheckable(true);
+    outline->setChecked(m_renderingSystem->selectionStyle() == RenderingSystem::SelectionStyle::StencilOutline);
+    connect(outline, &QAction::toggled, this, [this](bool on) {
+        m_renderingSystem->setSelectionStyle(on ? RenderingSystem::SelectionStyle::StencilOutline
+                                                : RenderingSystem::SelectionStyle::Glow);
+        markSceneDirty();
+    });
+
+    // Half the vertex memory per mesh; toggling re-uploads every mesh once.
+    QAction* compact = menu->addAction("Compact vertices (16 bytes)");
+    compact->setCheckable(true);
+    compact->setChecked(m_renderingSystem->compactVertices());
+    connect(compact, &QAction::toggled, this, [this](bool on) {
+        m_renderingSystem->setCompactVertices(on);
+        markSceneDirty();
+    });
+}
+
+void MainWindow::setFramePacing(FramePacing mode, int targetFps)
+{
+    m_framePacing = mode;
+    m_targetFps = std::max(1, targetFps);
+    if (m_renderingSystem && m_renderingSystem->isInitialized()) {
+        m_sceneDirty = true;
+        startMasterLoop();
+    }
+}
+
+void MainWindow::setSimulationRate(int hz)
+{
+    m_simulationRate = std::clamp(hz, 1, 1000);
+}
+
+void MainWindow::advanceSimulation(float deltaTime)
+{
+    // Bounded per tick so a slow frame cannot snowball into ever more steps;
+    // the backlog beyond that is dropped and the simulation runs slow instead.
+    constexpr int kMaxStepsPerTick = 5;
+    const float step = 1.0f / static_cast<float>(m_simulationRate);
+
+    m_simAccumulator += deltaTime;
+    int steps = 0;
+    while (m_simAccumulator >= step && steps < kMaxStepsPerTick) {
+        m_renderingSystem->stepSimulation(step);
+        m_simAccumulator -= step;
+        ++steps;
+    }
+    if (m_simAccumulator >= step) m_simAccumulator = std::fmod(m_simAccumulator, step);
+    m_renderingSystem->setSimulationAlpha(m_simAccumulator / step);
+}
+
+// --- Session recording / playback ---
+
+bool MainWindow::startSessionRecording(const QString& path)
+{
+    if (!m_recorder) m_recorder = std::make_unique<SessionRecorder>();
+    if (!m_recorder->open(path.toStdString())) return false;
+    m_telemetry->setRecorder(m_recorder.get());
+    statusBar()->showMessage(QString("Recording session to %1").arg(path));
+    return true;
+}
+
+void MainWindow::stopSessionRecording()
+{
+    if (!m_recorder || !m_recorder->isOpen()) return;
+    m_telemetry->setRecorder(nullptr);
+    m_recorder->close();
+    statusBar()->showMessage(QString("Session recorded (%1 samples)").arg(m_recorder->sampleCount()));
+}
+
+bool MainWindow::openSessionPlayback(const QString& path)
+{
+    auto log = std::make_shared<SessionLog>();
+    if (!log->open(path.toStdString())) return false;
+
+    m_playback = std::make_shared<SessionPlayback>(std::move(log));
+    m_telemetry->bindAll(m_scene->getRegistry(), m_playback->makeReaderFactory());
+    statusBar()->showMessage(QString("Playing back %1").arg(QFileInfo(path).fileName()));
+    return true;
+}
+
+void MainWindow::returnToLive()
+{
+    if (!m_playback) return;
+    m_telemetry->bind(m_scene->getRegistry());
+    m_playback.reset();
+    statusBar()->showMessage("Live telemetry");
+}
+
+void MainWindow::setupSessionShortcuts()
+{
+    // Ctrl+Shift+R record on/off, Ctrl+Shift+O open a recording, Ctrl+Shift+L back to live,
+    // Ctrl+Shift+Space play/pause, Ctrl+Shift+Left/Right scrub by one second.
+    auto bindKey = [this](const QKeySequence& keys, auto&& slot) {
+        auto* shortcut = new QShortcut(keys, this);
+        shortcut->setContext(Qt::ApplicationShortcut);
+        connect(shortcut, &QShortcut::activated, this, slot);
+    };
+    bindKey(QKeySequence(QStringLiteral("Ctrl+Shift+R")), [this] {
+        if (m_recorder && m_recorder->isOpen()) { stopSessionRecording(); return; }
+        const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QStringLiteral("/sessions");
+        QDir().mkpath(dir);
+        startSessionRecording(dir + QStringLiteral("/session-%1.krec")
+            .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss"))));
+    });
+    bindKey(QKeySequence(QStringLiteral("Ctrl+Shift+O")), [this] {
+        const QString path = QFileDialog::getOpenFileName(this, "Open Session Recording",
+            QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QStringLiteral("/sessions"),
+            "Session Recordings (*.krec)");
+        if (!path.isEmpty() && !openSessionPlayback(path))
+            QMessageBox::critical(this, "Playback Error", "Could not open the selected session recording.");
+    });
+    bindKey(QKeySequence(QStringLiteral("Ctrl+Shift+L")), [this] { returnToLive(); });
+    bindKey(QKeySequence(QStringLiteral("Ctrl+Shift+Space")), [this] {
+        if (!m_playback) return;
+        if (m_playback->playing()) m_playback->pause();
+        else m_playback->play();
+    });
+    constexpr std::int64_t kScrubNs = 1000000000;
+    bindKey(QKeySequence(QStringLiteral("Ctrl+Shift+Left")), [this] {
+        if (m_playback) m_playback->seek(m_playback->cursorNs() - kScrubNs);
+    });
+    bindKey(QKeySequence(QStringLiteral("Ctrl+Shift+Right")), [this] {
+        if (m_playback) m_playback->seek(m_playback->cursorNs() + kScrubNs);
+    });
+}
+
+void MainWindow::startMasterLoop()
+{
+    m_frameClock.start();
+    m_tickPending = false;
+    m_quietTicks = 0;
+    m_idle = false;
+
+    switch (m_framePacing) {
+    case FramePacing::FixedInterval:
+        m_masterRenderTimer->start(1000 / m_targetFps);
+        break;
+    case FramePacing::VSync:
+        // Ticks are chained off frameSwapped. The slow heartbeat keeps
+        // polling for scene changes while every viewport is idle.
+        m_masterRenderTimer->start(100);
+        break;
+    case FramePacing::Uncapped:
+        m_masterRenderTimer->start(0);
+        break;
+    }
+}
+
+void MainWindow::markSceneDirty()
+{
+    m_sceneDirty = true;
+    wakeMasterLoop();
+}
+
+void MainWindow::wakeMasterLoop()
+{
+    m_quietTicks = 0;
+    if (!m_idle) return;
+    KR_TRACE(Frame) << "Master loop waking from idle";
+    startMasterLoop();
+}
+
+bool MainWindow::hasLiveSources() const
+{
+    return m_telemetry->streaming() || m_commandLoop->running() || m_dynamics->running() || m_robotImport->busy()
+        || m_world->stats().loading > 0 || m_clearance->stats().pendingFields > 0;
+}
+
+void MainWindow::onRegistryChanged(entt::registry&, entt::entity)
+{
+    // Tick systems emit these from pool workers: only raise the flag there.
+    // While idle nothing ticks, so the change came from the GUI thread.
+    m_registryDirty.store(true, std::memory_order_relaxed);
+    if (m_idle.load(std::memory_order_relaxed))
+        QMetaObject::invokeMethod(this, &MainWindow::wakeMasterLoop, Qt::QueuedConnection);
+}
+
+void MainWindow::onViewportFrameSwapped()
+{
+    if (m_framePacing != FramePacing::VSync || m_tickPending) return;
+    m_tickPending = true;
+    QTimer::singleShot(0, this, &MainWindow::onMasterRender);
+}
+
+bool MainWindow::eventFilter(QObject* watched, QEvent* event)
+{
+    switch (event->type()) {
+    case QEvent::MouseMove:
+        // Hovering over a viewport changes nothing.
+        if (qobject_cast<ViewportWidget*>(watched) && static_cast<QMouseEvent*>(event)->buttons() == Qt::NoButton)
+            break;
+        [[fallthrough]];
+    case QEvent::MouseButtonRelease:
+    case QEvent::KeyRelease:
+    case QEvent::Wheel:
+        // Viewports apply camera input at their next paint; they only need the loop awake.
+        if (qobject_cast<ViewportWidget*>(watched)) wakeMasterLoop();
+        else markSceneDirty();
+        break;
+    case QEvent::MouseButtonPress:
+    case QEvent::KeyPress:
+        wakeMasterLoop();
+        break;
+    default:
+        break;
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::setupTickSystems()
+{
+    // Added in the order they used to run serially; the scheduler only
+    // overlaps systems whose declared access does not conflict.
+    using Access = SystemScheduler::Access;
+    m_tickSystems = std::make_unique<SystemScheduler>();
+
+    m_tickSystems->add("animations", Access{}.reads<PulsingSplineTag, PulsingLightComponent>()
+        .writes<SplineComponent, MaterialComponent>(), [this](entt::registry& r) {
+            m_renderingSystem->updateAnimations(r);
+            return false;   // reported through hasContinuousAnimation()
+        });
+    m_tickSystems->add("splineCaches", Access{}.writes<SplineComponent>(), [this](entt::registry& r) {
+        m_renderingSystem->updateSceneLogic(r, m_renderingSystem->frameDelta());
+        return false;
+        });
+    m_tickSystems->add("cameraRigs", Access{}.reads<CameraComponent>().writes<TransformComponent>(),
+        [this](entt::registry& r) {
+            m_renderingSystem->updateCameraTransforms(r);
+            return false;
+        });
+    // Joint state working sets belong to the GUI thread (see JointStateBuffer).
+    m_tickSystems->add("telemetry", Access{}.uses<JointStateBuffer, TelemetryHub>().mainThread(),
+        [this](entt::registry&) { return m_telemetry->drain() > 0; });
+    // Playing paths stage their next setpoints before they are published.
+    m_tickSystems->add("trajectoryPlayback", Access{}.reads<KinematicModelComponent, JointComponent>()
+        .writes<TrajectoryPlaybackComponent, JointStateComponent>()
+        .uses<JointStateBuffer, JointCommandLoop, DynamicsSimulation>().mainThread(),
+        [this](entt::registry& r) {
+            thread_local std::vector<double> q;
+            std::vector<entt::entity> finished;
+            bool playing = false;
+            for (auto [root, playback, kin] : r.view<TrajectoryPlaybackComponent, KinematicModelComponent>().each()) {
+                if (!kin.model) continue;
+                const KinematicModel& model = *kin.model;
+                const std::size_t dofs = std::size_t(model.dofCount());
+                if (dofs == 0 || playback.time.empty() || playback.q.size() != playback.time.size() * dofs) {
+                    finished.push_back(root);
+                    continue;
+                }
+                playback.elapsed += m_renderingSystem->frameDelta();
+                q.resize(dofs);
+                TrajectoryTiming::sample(playback.q, playback.time, dofs, playback.elapsed, q.data());
+
+                bool bound = false;
+                for (std::size_t d = 0; d < dofs; ++d) {
+                    const entt::entity joint = kin.links[std::size_t(model.dofLink(int(d)))];
+                    const JointCommand command{ ControlMode::POSITION, q[d] };
+                    bound |= m_commandLoop->setCommand(joint, command);
+                    if (m_dynamics->running()) bound |= m_dynamics->setCommand(joint, command);
+                }
+                std::size_t count = 0;
+                if (!bound)
+                    if (double* positions = ScriptApi::jointPositions(r, root, count))
+                        std::copy_n(q.data(), std::min(count, dofs), positions);
+                if (playback.elapsed >= playback.time.back()) finished.push_back(root);
+                playing = true;
+            }
+            for (entt::entity root : finished) r.remove<TrajectoryPlaybackComponent>(root);
+            return playing;
+        });
+    m_tickSystems->add("jointCommands", Access{}.uses<JointCommandLoop>().mainThread(),
+        [this](entt::registry&) {
+            m_commandLoop->publish();
+            // Tripped from any input: say so once, with how long the stop frames took.
+            const std::uint64_t trip = m_commandLoop->trips();
+            if (m_commandLoop->emergencyStopped() && trip != m_estopReported) {
+                const JointCommandLoop::Jitter& jitter = m_commandLoop->jitter();
+                if (jitter.stopTrip == trip) {
+                    statusBar()->showMessage(QString("EMERGENCY STOP: stop frames out %1 us after the trip")
+                        .arg(jitter.stopLatencyUs, 0, 'f', 1));
+                    m_estopReported = trip;
+                }
+                else if (!m_commandLoop->running()) {
+                    statusBar()->showMessage("EMERGENCY STOP (no joint command writers bound)");
+                    m_estopReported = trip;
+                }
+            }
+            return false;
+        });
+    m_tickSystems->add("dynamics", Access{}.reads<JointStateComponent>().uses<JointStateBuffer, DynamicsSimulation>()
+        .mainThread(), [this](entt::registry& r) {
+            m_dynamics->publish();
+            return m_dynamics->apply(r);
+        });
+    m_tickSystems->add("joints", Access{}.writes<KinematicModelComponent, JointStateComponent, TransformComponent>()
+        .uses<JointStateBuffer>().mainThread(),
+        [](entt::registry& r) { KinematicSystem::applyJointPositions(r); return false; });
+    // Cells of an open .krworld come and go around the cameras. Creates and
+    // destroys entities, so it runs alone.
+    m_tickSystems->add("worldStreaming", Access{}.exclusive().mainThread(),
+        [this, viewers = std::vector<glm::dvec3>()](entt::registry& r) mutable {
+            if (!m_world->isOpen()) return false;
+            viewers.clear();
+            for (auto [entity, camera] : r.view<CameraComponent>().each())
+                viewers.push_back(camera.camera.worldPosition());
+            return m_world->update(r, viewers);
+        });
+    // Meshes loaded in the background (camera gizmos) join the scene here.
+    // Adding a RenderableMeshComponent reorders the owning mesh group.
+    m_tickSystems->add("pendingMeshes", Access{}.writes<PendingMeshComponent, RenderableMeshComponent, TransformComponent>()
+        .mainThread(), [](entt::registry& r) { return SceneBuilder::resolvePendingMeshes(r); });
+    // Also rebuilds each TransformComponent's matrix cache (version()), hence
+    // the write: later readers only read it through getTransform().
+    m_tickSystems->add("transforms", Access{}.reads<ParentComponent>()
+        .writes<TransformComponent, WorldTransformComponent>(),
+        [](entt::registry& r) { ViewportWidget::propagateTransforms(r); return false; });
+    // Ghost poses for edited trajectories; their path splines follow the robot.
+    m_tickSystems->add("trajectoryGhosts", Access{}.reads<KinematicModelComponent, TransformComponent, WorldTransformComponent>()
+        .writes<TrajectoryGhostComponent, SplineComponent>().mainThread(),
+        [](entt::registry& r) { return KinematicSystem::updateTrajectoryGhosts(r); });
+    m_tickSystems->add("worldBounds", Access{}.reads<RenderableMeshComponent, TransformComponent, WorldTransformComponent>()
+        .writes<WorldBoundsComponent>(),
+        [](entt::registry& r) { return CullingSystem::updateWorldBounds(r) > 0; });
+    // Poses articulated prefab instances and keeps every instance's bounds.
+    m_tickSystems->add("prefabs", Access{}.reads<TransformComponent, WorldTransformComponent, JointStateComponent,
+            SelectedComponent, CollisionContactComponent>()
+        .writes<PrefabInstanceComponent, WorldBoundsComponent>().uses<JointStateBuffer>().mainThread(),
+        [](entt::registry& r) { return PrefabSystem::update(r) > 0; });
+    // Moves only the leaves whose bounds changed; readers take a shared lock.
+    m_tickSystems->add("sceneIndex", Access{}.reads<WorldBoundsComponent>().uses<SceneIndex>(),
+        [this](entt::registry& r) { m_scene->index().update(r); return false; });
+    // Adds and removes contact tags and bodies: needs the registry to itself.
+    // Shapes are kept current while checking is off too, for the safety zones.
+    m_tickSystems->add("collision", Access{}.exclusive().mainThread(), [this](entt::registry& r) {
+        return m_collision->update(r, m_collisionChecking) && m_collisionChecking;
+        });
+    // Tags zones and reports links crossing them within the tick.
+    m_tickSystems->add("safetyZones", Access{}.exclusive().mainThread(),
+        [this](entt::registry& r) { return m_safetyZones->update(r); });
+    // Reads the link shapes fitted by "collision". Nothing in the viewports
+    // shows the readout, so it never asks for a redraw.
+    m_tickSystems->add("clearance", Access{}.reads<KinematicModelComponent, CollisionShapeComponent,
+        WorldTransformComponent, RenderableMeshComponent, WorldBoundsComponent, EnvironmentColliderTag, LinkComponent>()
+        .writes<ClearanceComponent>().uses<ClearanceMonitor>().mainThread(), [this](entt::registry& r) {
+            m_clearance->update(r);
+            showClearance();
+            return false;
+        });
+}
+
 void MainWindow::onMasterRender()
 {
+    KR_ZONE("master tick");
+    m_tickPending = false;
+    bool sceneChanged = m_sceneDirty || m_registryDirty.exchange(false, std::memory_order_relaxed);
+    m_sceneDirty = false;
+
+    m_perfHud->beginTick();
+    if (pollRobotImport())
+        sceneChanged = true;
+    m_perfHud->mark("robot import");
+
     // --- 1. LOGIC UPDATES ---
-    // This section should run at a fixed rate to ensure smooth and
-    // predictable animation and physics, regardless of frame rate.
     if (m_renderingSystem && m_renderingSystem->isInitialized())
     {
-        // Use the timer's interval to get a consistent delta time.
-        const float deltaTime = static_cast<float>(m_masterRenderTimer->interval()) / 1000.0f;
+        // Real elapsed time since the previous tick. Timer intervals are only
+        // a lower bound, so using them made animation speed depend on load.
+        // Clamped so a stall (breakpoint, modal dialog) does not cause a jump.
+        float deltaTime = m_frameClock.isValid()
+            ? static_cast<float>(m_frameClock.nsecsElapsed()) * 1e-9f
+            : 1.0f / 60.0f;
+        deltaTime = std::clamp(deltaTime, 0.0f, 0.1f);
+        m_frameClock.restart();
 
-        // Update all time-based systems
-        m_renderingSystem->updateAnimations(m_scene->getRegistry(), deltaTime);
-        m_renderingSystem->updateSceneLogic(m_scene->getRegistry(), deltaTime); // Pass deltaTime here
-
-        // Update transforms based on camera state
-        m_renderingSystem->updateCameraTransforms(m_scene->getRegistry());
-        ViewportWidget::propagateTransforms(m_scene->getRegistry());
+        auto& registry = m_scene->getRegistry();
+        m_renderingSystem->advanceFrameTime(deltaTime);
+        advanceSimulation(deltaTime);
+        m_perfHud->mark("simulation");
+
+        FrameArena::nextFrame();
+        if (m_tickSystems->run(registry))
+            sceneChanged = true;
+        m_perfHud->mark("tick systems");
+        if (m_renderingSystem->hasContinuousAnimation(registry))
+            sceneChanged = true;
+
+        // Grid sections; renderView draws the latest, re-uploading on change.
+        const std::uint64_t sections = IntersectionSystem::generation(registry);
+        IntersectionSystem::update(m_scene.get());
+        if (IntersectionSystem::generation(registry) != sections)
+            sceneChanged = true;
+        m_perfHud->mark("intersections");
+
+        // Viewports paint from this copy, so a paint between ticks (layout,
+        // dock drag) redraws the finished frame instead of a half-updated one.
+        m_renderingSystem->extractSnapshot(registry);
+        m_perfHud->mark("snapshot");
+        if (m_perfHud->visible() && m_commandLoop->running()) {
+            const JointCommandLoop::Jitter& jitter = m_commandLoop->jitter();
+            PerfHud::Cyclic loops[2] = { { "joint commands", jitter.cycles, jitter.meanUs, jitter.maxUs, jitter.overruns, 0 } };
+            std::size_t count = 1;
+#if KR_ETHERCAT_ENABLED
+            if (const EtherCatMaster::Stats bus = m_ethercat->stats(); bus.operational)
+                loops[count++] = { "ethercat", bus.cycles, std::abs(bus.dcErrorUs), 0.0, 0, bus.missedFrames };
+#endif
+            m_perfHud->setCyclic(loops, count);
+        }
+        m_perfHud->endTick(registry, *m_tickSystems);
     }
 
     // --- 2. SCHEDULE REPAINT ---
-    // Asynchronously schedule a repaint for each viewport. Qt will handle
-    // calling paintGL efficiently without blocking the main thread.
+    // Only viewports whose image can differ from the last frame are
+    // repainted; an idle scene with still cameras costs no GPU time.
+    bool repainted = false;
     for (ViewportWidget* vp : m_viewports)
     {
-        if (vp) {
+        if (vp && (sceneChanged || vp->needsRedraw())) {
             vp->update();
+            repainted = true;
         }
     }
+
+    // --- 3. IDLE ---
+    // Nothing moved for a while and nothing can change on its own: stop
+    // ticking until input or an edit wakes the loop.
+    if (repainted || hasLiveSources()) wakeMasterLoop();   // e.g. a tick chained off a swap while idle
+    else if (++m_quietTicks >= kQuietTicksBeforeIdle && !m_idle) {
+        KR_TRACE(Frame) << "Master loop idle";
+        m_masterRenderTimer->stop();
+        m_idle = true;
+    }
 }
 
 // The destructor orchestrates a clean shutdown.
@@ -393,6 +1194,23 @@ MainWindow::~MainWindow()
 {
     // Stop the timer to prevent any more render calls during shutdown.
     m_masterRenderTimer->stop();
+    stopSessionRecording();
+    m_telemetry->stop();
+    m_estop->stop();
+    m_commandLoop->stop();
+    m_dynamics->stop();
+    if (m_canMonitor) m_canMonitor->stop();
+    if (m_remoteView) m_remoteView->stop();
+    if (m_twinPublisher) m_twinPublisher->stop();
+    if (m_twinMirror) m_twinMirror->stop();
+    if (m_pointCloudImport.joinable()) m_pointCloudImport.join();
+    if (m_sceneLoad.joinable()) m_sceneLoad.join();
+    if (m_gltfExport.joinable()) m_gltfExport.join();
+    if (m_projectSync.joinable()) m_projectSync.join();
+    m_stepResponseCancel = true;
+    if (m_stepResponse.joinable()) m_stepResponse.join();
+    m_workspaceMapCancel = true;
+    if (m_workspaceMap.joinable()) m_workspaceMap.join();
 
     if (!m_viewports.empty() && m_viewports[0]) {
         m_viewports[0]->makeCurrent();
@@ -415,56 +1233,998 @@ void MainWindow::onLoadRobotClicked()
         "SDF Robot (*.sdf);;"
         "All Files (*)";
 
+    if (m_robotImport->busy()) {
+        statusBar()->showMessage(QString("Still importing '%1'").arg(m_importName));
+        return;
+    }
+
     QString filePath = QFileDialog::getOpenFileName(this, "Load Robot Model", "", fileFilter);
     if (filePath.isEmpty()) {
         return;
     }
 
-    RobotDescription description;
-    bool loadSuccess = false;
+    // Parsing and mesh decoding run on the import thread; pollRobotImport()
+    // picks the result up on a later tick.
+    m_importName = QFileInfo(filePath).fileName();
+    m_importCommitted = 0;
+    m_robotImport->start(filePath.toStdString());
+    m_importProgress->setRange(0, 0);
+    m_importProgress->show();
+    m_importCancel->show();
+    statusBar()->showMessage(QString("Parsing '%1'...").arg(m_importName));
+}
+
+// --- Point clouds ---
 
-    if (filePath.endsWith(".urdf", Qt::CaseInsensitive)) {
-        description = URDFParser::parse(filePath.toStdString());
-        loadSuccess = true;
-    }
-    else if (filePath.endsWith(".sdf", Qt::CaseInsensitive)) {
-        description = SDFParser::parse(filePath.toStdString());
-        loadSuccess = true;
+void MainWindow::onImportPointCloudClicked()
+{
+    const char* fileFilter =
+        "All Supported Point Clouds (*.kpc *.xyz *.txt *.pts);;"
+        "Point Cloud Octree (*.kpc);;"
+        "ASCII Points (*.xyz *.txt *.pts);;"
+        "All Files (*)";
+
+    if (m_pointCloudImport.joinable()) {
+        statusBar()->showMessage("Still converting the previous point cloud");
+        return;
     }
-    else if (filePath.endsWith(".krobot", Qt::CaseInsensitive)) {
-        description = KRobotParser::parse(filePath.toStdString());
-        loadSuccess = true;
+
+    const QString filePath = QFileDialog::getOpenFileName(this, "Import Point Cloud", "", fileFilter);
+    if (filePath.isEmpty()) return;
+    const QString name = QFileInfo(filePath).fileName();
+
+    if (filePath.endsWith(".kpc", Qt::CaseInsensitive)) {
+        addPointCloud(filePath, name);
+        return;
     }
 
-    if (!loadSuccess) {
-        QMessageBox::critical(this, "File Load Error", "Could not parse the selected robot file.");
+    // Converted once; later imports of the same file reuse the cached octree
+    // unless the source is newer.
+    const QString cachePath = QString::fromStdString(PointCloudOctree::cachePathFor(filePath.toStdString()));
+    const QFileInfo cached(cachePath);
+    if (cached.exists() && cached.lastModified() >= QFileInfo(filePath).lastModified()) {
+        addPointCloud(cachePath, name);
         return;
     }
 
-    if (description.needsEnrichment) {
-        RobotEnrichmentDialog dialog(description, this);
-        if (dialog.exec() == QDialog::Accepted) {
-            const RobotDescription& finalDescription = dialog.getFinalDescription();
-            QString krobotSavePath = QFileDialog::getSaveFileName(this, "Save Enriched KRobot File", "", "KRobot Files (*.krobot)");
-            if (krobotSavePath.isEmpty()) return;
+    statusBar()->showMessage(QString("Converting '%1'...").arg(name));
+    m_pointCloudImport = std::thread([this, filePath, cachePath, name] {
+        TraceZones::setThreadName("point cloud import");
+        KR_ZONE("build octree");
+        std::string error;
+        const bool ok = PointCloudOctree::build(filePath.toStdString(), cachePath.toStdString(), &error,
+            [this, name](float progress) {
+                QMetaObject::invokeMethod(this, [this, name, progress] {
+                    statusBar()->showMessage(QString("Converting '%1': %2%").arg(name).arg(int(progress * 100.0f)));
+                    }, Qt::QueuedConnection);
+            });
+        QMetaObject::invokeMethod(this, [this, ok, error, cachePath, name] {
+            if (m_pointCloudImport.joinable()) m_pointCloudImport.join();
+            if (ok) addPointCloud(cachePath, name);
+            else statusBar()->showMessage(QString("Point cloud import failed: %1").arg(QString::fromStdString(error)));
+            }, Qt::QueuedConnection);
+        });
+}
+
+// --- Scene files ---
 
-            if (KRobotWriter::save(finalDescription, krobotSavePath.toStdString())) {
-                statusBar()->showMessage(QString("Successfully imported and enriched '%1'").arg(QFileInfo(filePath).fileName()));
-                SceneBuilder::spawnRobot(*m_scene, finalDescription);
+void MainWindow::saveScene()
+{
+    const QString filePath = QFileDialog::getSaveFileName(this, "Save Scene", "", "KR Scenes (*.krscene)");
+    if (filePath.isEmpty()) return;
+
+    std::string error;
+    if (SceneFile::save(m_scene->getRegistry(), filePath.toStdString(), &error))
+        statusBar()->showMessage(QString("Saved scene '%1'").arg(QFileInfo(filePath).fileName()));
+    else
+        statusBar()->showMessage(QString("Scene save failed: %1").arg(QString::fromStdString(error)));
+}
+
+void MainWindow::exportGltf()
+{
+    if (m_gltfExport.joinable()) {
+        statusBar()->showMessage("Still exporting the previous glTF");
+        return;
+    }
+    const QString plain = "glTF Binary (*.glb)", quantized = "glTF Binary, quantized (*.glb)";
+    QString filter;
+    QString filePath = QFileDialog::getSaveFileName(this, "Export glTF", "", plain + ";;" + quantized, &filter);
+    if (filePath.isEmpty()) return;
+    if (!filePath.endsWith(".glb", Qt::CaseInsensitive)) filePath += ".glb";
+    const QString name = QFileInfo(filePath).fileName();
+
+    // The walk is on this thread, so the file shows one consistent scene;
+    // encoding and writing are not.
+    GltfExport::Options options;
+    options.quantize = filter == quantized;
+    auto plan = GltfExport::gather(m_scene->getRegistry(), options);
+    statusBar()->showMessage(QString("Exporting '%1' (%2 meshes)...").arg(name).arg(qulonglong(GltfExport::meshCount(*plan))));
+    m_gltfExport = std::thread([this, plan, filePath, name] {
+        TraceZones::setThreadName("glTF export");
+        std::string error;
+        const bool ok = GltfExport::write(*plan, filePath.toStdString(), &error);
+        QMetaObject::invokeMethod(this, [this, ok, error, name] {
+            if (m_gltfExport.joinable()) m_gltfExport.join();
+            if (ok) statusBar()->showMessage(QString("Exported '%1'").arg(name));
+            else statusBar()->showMessage(QString("glTF export failed: %1").arg(QString::fromStdString(error)));
+            }, Qt::QueuedConnection);
+        });
+}
+
+void MainWindow::syncProject(bool upload)
+{
+    if (m_projectSync.joinable()) {
+        statusBar()->showMessage("Still syncing the project");
+        return;
+    }
+    const QString store = qEnvironmentVariable("KR_SYNC_STORE");
+    if (store.isEmpty()) {
+        statusBar()->showMessage("Project sync needs KR_SYNC_STORE (the sync store's folder)");
+        return;
+    }
+    if (m_syncFolder.isEmpty())
+        m_syncFolder = QFileDialog::getExistingDirectory(this, upload ? "Project to Upload" : "Project to Download Into");
+    if (m_syncFolder.isEmpty()) return;
+
+    // Published under the folder's name, so every workstation pulls the same snapshot.
+    const QString name = QFileInfo(m_syncFolder).fileName();
+    statusBar()->showMessage(QString("%1 '%2'...").arg(QString(upload ? "Uploading" : "Downloading"), name));
+    m_projectSync = std::thread([this, upload, store, name, folder = m_syncFolder] {
+        TraceZones::setThreadName("project sync");
+        ProjectSync::DirectoryStore chunks(store.toStdString());
+        ProjectSync::Stats stats;
+        std::string error;
+        const bool ok = upload ? ProjectSync::push(folder.toStdString(), chunks, name.toStdString(), &stats, &error)
+                               : ProjectSync::pull(chunks, name.toStdString(), folder.toStdString(), &stats, &error);
+        QMetaObject::invokeMethod(this, [this, ok, upload, stats, error, name] {
+            if (m_projectSync.joinable()) m_projectSync.join();
+            if (!ok) {
+                statusBar()->showMessage(QString("Project sync failed: %1").arg(QString::fromStdString(error)));
+                return;
             }
-            else {
-                QMessageBox::critical(this, "File Save Error", "Could not save the new .krobot file.");
+            statusBar()->showMessage(QString("%1 '%2': %3 of %4 files changed, %5 KiB %6")
+                .arg(QString(upload ? "Uploaded" : "Downloaded"), name).arg(qulonglong(stats.filesChanged)).arg(qulonglong(stats.files))
+                .arg(qulonglong(stats.bytesTransferred / 1024)).arg(upload ? "sent" : "fetched"));
+            }, Qt::QueuedConnection);
+        });
+}
+
+void MainWindow::openScene()
+{
+    if (m_sceneLoad.joinable()) {
+        statusBar()->showMessage("Still opening the previous scene");
+        return;
+    }
+
+    const QString filePath = QFileDialog::getOpenFileName(this, "Open Scene", "",
+        "KR Scenes (*.krscene);;KR Worlds (*.krworld);;All Files (*)");
+    if (filePath.isEmpty()) return;
+    const QString name = QFileInfo(filePath).fileName();
+
+    // A world replaces the previous one; its cells arrive as the cameras move.
+    if (filePath.endsWith(".krworld", Qt::CaseInsensitive)) {
+        std::string error;
+        if (!m_world->open(m_scene->getRegistry(), filePath.toStdString(), &error)) {
+            statusBar()->showMessage(QString("World open failed: %1").arg(QString::fromStdString(error)));
+            return;
+        }
+        markSceneDirty();
+        statusBar()->showMessage(QString("Opened world '%1' (%2 cells)").arg(name).arg(qulonglong(m_world->stats().cells)));
+        return;
+    }
+
+    // The file's entities are added to the current scene.
+    statusBar()->showMessage(QString("Opening '%1'...").arg(name));
+    m_sceneLoad = std::thread([this, filePath, name] {
+        TraceZones::setThreadName("scene load");
+        auto loaded = std::make_shared<SceneFile::Loaded>();
+        std::string error;
+        const bool ok = SceneFile::read(filePath.toStdString(), *loaded, &error);
+        QMetaObject::invokeMethod(this, [this, ok, loaded, error, name] {
+            if (m_sceneLoad.joinable()) m_sceneLoad.join();
+            if (!ok) {
+                statusBar()->showMessage(QString("Scene open failed: %1").arg(QString::fromStdString(error)));
+                return;
             }
+            const auto entities = SceneFile::commit(m_scene->getRegistry(), std::move(*loaded));
+            markSceneDirty();
+            statusBar()->showMessage(QString("Opened scene '%1' (%2 entities)").arg(name).arg(qulonglong(entities.size())));
+            }, Qt::QueuedConnection);
+        });
+}
+
+void MainWindow::saveWorld()
+{
+    bool ok = false;
+    const double cellSize = QInputDialog::getDouble(this, "Save World", "Cell size (m):", 25.0, 1.0, 10000.0, 1, &ok);
+    if (!ok) return;
+    const QString filePath = QFileDialog::getSaveFileName(this, "Save World", "", "KR Worlds (*.krworld)");
+    if (filePath.isEmpty()) return;
+
+    std::string error;
+    if (WorldPartition::build(m_scene->getRegistry(), filePath.toStdString(), float(cellSize), &error))
+        statusBar()->showMessage(QString("Saved world '%1'").arg(QFileInfo(filePath).fileName()));
+    else
+        statusBar()->showMessage(QString("World save failed: %1").arg(QString::fromStdString(error)));
+}
+
+// --- Dynamics ---
+
+void MainWindow::setDynamicsSimulation(bool enabled)
+{
+    // Simulated sensors read the simulation's frame; release them before
+    // it stops or is rebuilt.
+    if (m_dynamics->measured()) m_telemetry->bind(m_scene->getRegistry());
+    if (!enabled) {
+        m_dynamics->stop();
+        statusBar()->showMessage("Dynamics simulation stopped");
+        return;
+    }
+    const std::size_t robots = m_dynamics->bind(m_scene->getRegistry());
+    if (robots == 0) {
+        statusBar()->showMessage("No robot with moving joints to simulate");
+        return;
+    }
+    wakeMasterLoop();
+    statusBar()->showMessage(QString("Simulating dynamics of %1 robot(s) at %2 Hz")
+        .arg(qulonglong(robots)).arg(m_dynamics->rate()));
+}
+
+void MainWindow::toggleSimulatedSensors()
+{
+    auto& registry = m_scene->getRegistry();
+    if (m_dynamics->measured()) {
+        m_telemetry->bind(registry);
+        statusBar()->showMessage("Simulated sensors off");
+        return;
+    }
+    if (!m_dynamics->running()) setDynamicsSimulation(true);
+    if (!m_dynamics->running()) return;
+
+    m_playback.reset();
+    const std::size_t joints = m_telemetry->bindAll(registry, [this, &registry]() {
+        return std::make_unique<SimulatedSensors>(registry, *m_dynamics);
+    });
+    if (!m_dynamics->measured()) {
+        m_telemetry->bind(registry);
+        statusBar()->showMessage("No simulated joint to read sensors from");
+        return;
+    }
+    wakeMasterLoop();
+    statusBar()->showMessage(QString("Reading %1 simulated joints through their sensors").arg(qulonglong(joints)));
+}
+
+entt::entity MainWindow::selectedRobot()
+{
+    // The selection's robot, else the first one.
+    auto& registry = m_scene->getRegistry();
+    entt::entity root = entt::null;
+    for (auto entity : registry.view<SelectedComponent>()) {
+        for (entt::entity e = entity; e != entt::null && root == entt::null;) {
+            if (registry.all_of<RobotRootComponent>(e)) root = e;
+            const auto* parent = registry.try_get<ParentComponent>(e);
+            e = parent ? parent->parent : entt::null;
+        }
+    }
+    if (root == entt::null) {
+        for (auto entity : registry.view<RobotRootComponent, KinematicModelComponent>()) {
+            root = entity;
+            break;
         }
     }
+    return root;
+}
+
+void MainWindow::toggleVirtualSensors()
+{
+    auto& registry = m_scene->getRegistry();
+    const entt::entity root = selectedRobot();
+    const auto* kin = root == entt::null ? nullptr : registry.try_get<KinematicModelComponent>(root);
+    if (!kin) {
+        statusBar()->showMessage("No robot to mount sensors on");
+        return;
+    }
+
+    // Remove the robot's sensors if it has any; their rings go with the streams.
+    std::vector<entt::entity> existing;
+    for (auto [entity, sensor, parent] : registry.view<VirtualSensorComponent, ParentComponent>().each()) {
+        if (std::find(kin->links.begin(), kin->links.end(), parent.parent) != kin->links.end()) existing.push_back(entity);
+    }
+    if (!existing.empty()) {
+        registry.destroy(existing.begin(), existing.end());
+        statusBar()->showMessage(QString("Removed %1 virtual sensors").arg(qulonglong(existing.size())));
+    }
+    else if (const std::size_t added = SceneBuilder::addVirtualSensors(registry, root)) {
+        statusBar()->showMessage(QString("Added %1 virtual sensors").arg(qulonglong(added)));
+    }
+    else {
+        statusBar()->showMessage("The robot has no sensor mounts");
+    }
+    markSceneDirty();
+}
+
+void MainWindow::toggleTrajectoryGhosts()
+{
+    auto& registry = m_scene->getRegistry();
+    const entt::entity root = selectedRobot();
+    const auto* kin = root == entt::null ? nullptr : registry.try_get<KinematicModelComponent>(root);
+    if (!kin || !kin->model || kin->model->dofCount() == 0) {
+        statusBar()->showMessage("No robot with moving joints to preview");
+        return;
+    }
+
+    std::vector<entt::entity> existing;
+    for (auto [entity, ghost] : registry.view<TrajectoryGhostComponent>().each())
+        if (ghost.robot == root) existing.push_back(entity);
+    if (!existing.empty()) {
+        registry.destroy(existing.begin(), existing.end());
+        statusBar()->showMessage("Trajectory preview removed");
+        markSceneDirty();
+        return;
+    }
+
+    // A collision-free move from the current pose home (zero, within the limits).
+    const KinematicModel& model = *kin->model;
+    const std::size_t dofs = std::size_t(model.dofCount());
+    std::vector<double> home(dofs);
+    for (std::size_t d = 0; d < dofs; ++d) {
+        const int dof = int(d);
+        home[d] = model.isLimited(dof) ? std::clamp(0.0, model.lowerLimit(dof), model.upperLimit(dof)) : 0.0;
+    }
+    const MotionPlanner::Result result = m_planner->plan(registry, *m_collision, root, kin->q.data(), home.data());
+    if (!result.success) {
+        statusBar()->showMessage(QString("No path home: %1").arg(QString::fromStdString(result.error)));
+        return;
+    }
+
+    // The fastest timing within the velocity and effort limits. Ghosts are
+    // spread by waypoint, so the trajectory is resampled evenly in time
+    // first: they bunch up where the robot is slow. An untimed path is
+    // shown evenly along its length and cannot be played.
+    auto dynamics = RigidBodyDynamics::fromRobot(registry, root);
+    const TrajectoryTiming timing = dynamics
+        ? TrajectoryTiming::compute(*dynamics, result.path, TrajectoryTiming::Settings{}) : TrajectoryTiming{};
+    constexpr std::size_t kWaypoints = 64;
+    const double length = MotionPlanner::pathLength(result.path, dofs);
+    std::vector<double> q(kWaypoints * dofs);
+    for (std::size_t w = 0; w < kWaypoints; ++w) {
+        const double f = double(w) / double(kWaypoints - 1);
+        if (timing.empty()) MotionPlanner::samplePath(result.path, dofs, length * f, q.data() + w * dofs);
+        else timing.sample(timing.duration * f, q.data() + w * dofs);
+    }
+    ScriptApi::showTrajectory(registry, root, q.data(), q.size(), 32);
+
+    static const char* const kMethods[] = { "none", "direct", "roadmap", "RRT-Connect" };
+    const QString planned = QString("%1, %2 waypoints, %3 ms").arg(kMethods[int(result.method)])
+        .arg(result.waypoints).arg(result.milliseconds, 0, 'f', 1);
+    if (timing.empty()) {
+        m_plannedPath.clear();
+        m_plannedTimes.clear();
+        statusBar()->showMessage(QString("Previewing the move home (%1); not timed: %2").arg(planned,
+            dynamics ? QString::fromStdString(timing.error) : QString("no dynamics model")));
+    }
+    else {
+        m_plannedPath = timing.q;
+        m_plannedTimes = timing.time;
+        m_plannedRobot = root;
+        statusBar()->showMessage(QString("Previewing the move home (%1): %2 s, %3% at a velocity limit; Ctrl+Shift+E plays it")
+            .arg(planned).arg(timing.duration, 0, 'f', 2)
+            .arg(100.0 * double(timing.velocityLimited) / double(timing.time.size()), 0, 'f', 0));
+    }
+    markSceneDirty();
+}
+
+void MainWindow::executePlannedPath()
+{
+    auto& registry = m_scene->getRegistry();
+    const auto* kin = registry.valid(m_plannedRobot) ? registry.try_get<KinematicModelComponent>(m_plannedRobot) : nullptr;
+    const std::size_t dofs = kin && kin->model ? std::size_t(kin->model->dofCount()) : 0;
+    if (dofs == 0 || m_plannedPath.size() < dofs) {
+        statusBar()->showMessage("No timed path; preview one with Ctrl+Shift+G");
+        return;
+    }
+    // It starts where the robot stood when planned; a moved robot would jump.
+    for (std::size_t d = 0; d < dofs; ++d)
+        if (std::abs(kin->q[d] - m_plannedPath[d]) > m_planner->settings().edgeResolution) {
+            statusBar()->showMessage("The robot has moved since the path was planned; preview it again");
+            return;
+        }
+    registry.emplace_or_replace<TrajectoryPlaybackComponent>(m_plannedRobot,
+        TrajectoryPlaybackComponent{ std::move(m_plannedPath), std::move(m_plannedTimes) });
+    m_plannedPath.clear();
+    m_plannedTimes.clear();
+    statusBar()->showMessage(QString("Playing the planned path (%1 s)").arg(
+        registry.get<TrajectoryPlaybackComponent>(m_plannedRobot).time.back(), 0, 'f', 2));
+    markSceneDirty();
+}
+
+void MainWindow::toggleWorkspaceMap()
+{
+    if (m_workspaceMap.joinable()) {
+        m_workspaceMapCancel = true;
+        statusBar()->showMessage("Cancelling the workspace map...");
+        return;
+    }
+    auto& registry = m_scene->getRegistry();
+    if (registry.valid(m_workspaceMapEntity)) {
+        registry.destroy(m_workspaceMapEntity);
+        m_workspaceMapEntity = entt::null;
+        statusBar()->showMessage("Workspace map removed");
+        markSceneDirty();
+        return;
+    }
+
+    const entt::entity root = selectedRobot();
+    const auto* kin = root == entt::null ? nullptr : registry.try_get<KinematicModelComponent>(root);
+    if (!kin || !kin->model || kin->model->dofCount() == 0) {
+        statusBar()->showMessage("No robot with moving joints to map");
+        return;
+    }
+    const QStringList quantities = { "Manipulability", "Reachability" };
+    bool ok = false;
+    const QString shown = QInputDialog::getItem(this, "Workspace Map", "Shade voxels by:", quantities, 0, false, &ok);
+    if (!ok) return;
+    const auto quantity = shown == quantities[0] ? WorkspaceMap::Quantity::Manipulability : WorkspaceMap::Quantity::Reachability;
+
+    // Sampled in the base frame; the visualizer carries the base's pose.
+    const auto& xf = registry.get<TransformComponent>(root);
+    const glm::vec3 translation = xf.translation;
+    const glm::quat rotation = xf.rotation;
+    const auto* tag = registry.try_get<TagComponent>(root);
+    const QString name = tag ? QString::fromStdString(tag->tag) : QStringLiteral("robot");
+
+    statusBar()->showMessage(QString("Mapping the workspace of '%1'...").arg(name));
+    m_workspaceMapCancel = false;
+    m_workspaceMap = std::thread([this, model = kin->model, quantity, translation, rotation, name] {
+        TraceZones::setThreadName("workspace map");
+        QElapsedTimer timer;
+        timer.start();
+        auto map = std::make_shared<WorkspaceMap>(WorkspaceMap::compute(*model, WorkspaceMap::Settings{}, {}, &m_workspaceMapCancel));
+        const qint64 ms = timer.elapsed();
+        QMetaObject::invokeMethod(this, [this, map, ms, quantity, translation, rotation, name] {
+            if (m_workspaceMap.joinable()) m_workspaceMap.join();
+            if (map->empty()) {
+                statusBar()->showMessage("Workspace map cancelled");
+                return;
+            }
+            auto& registry = m_scene->getRegistry();
+            m_workspaceMapEntity = registry.create();
+            registry.emplace<TagComponent>(m_workspaceMapEntity, "Workspace Map");
+            auto& xf = registry.emplace<TransformComponent>(m_workspaceMapEntity);
+            xf.translation = translation;
+            xf.rotation = rotation;
+            auto& vis = registry.emplace<FieldVisualizerComponent>(m_workspaceMapEntity);
+            vis.displayMode = FieldVisualizerComponent::DisplayMode::Volume;
+            vis.bounds = { map->boundsMin, map->boundsMax };
+            vis.volumeSettings.volume = map->volume(quantity);
+            vis.volumeSettings.densityScale = 4.0f / glm::length(map->boundsMax - map->boundsMin);
+            vis.volumeSettings.gradient = {
+                { 0.0f, glm::vec4(0.2f, 0.3f, 1.0f, 0.3f) },
+                { 0.5f, glm::vec4(0.2f, 1.0f, 0.4f, 0.7f) },
+                { 1.0f, glm::vec4(1.0f, 0.3f, 0.2f, 1.0f) } };
+            markSceneDirty();
+            statusBar()->showMessage(QString("Workspace of '%1': %2 voxels reached by %3 samples in %4 ms")
+                .arg(name).arg(qulonglong(map->reachedVoxels())).arg(qulonglong(map->samples)).arg(ms));
+            }, Qt::QueuedConnection);
+        });
+}
+
+void MainWindow::runStepResponse()
+{
+    if (m_stepResponse.joinable()) {
+        statusBar()->showMessage("Still simulating the previous step response");
+        return;
+    }
+
+    auto& registry = m_scene->getRegistry();
+    const entt::entity root = selectedRobot();
+    std::unique_ptr<MotorSimulation> simulation = root == entt::null ? nullptr : MotorSimulation::fromRobot(registry, root);
+    if (!simulation) {
+        statusBar()->showMessage("No robot with moving joints to simulate");
+        return;
+    }
+
+    bool ok = false;
+    const double step = QInputDialog::getDouble(this, "Step Response", "Position step of every joint (rad or m):",
+        0.1, -10.0, 10.0, 3, &ok);
+    if (!ok) return;
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QStringLiteral("/sessions");
+    QDir().mkpath(dir);
+    const QString path = dir + QStringLiteral("/step-%1.krec")
+        .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss")));
+
+    statusBar()->showMessage(QString("Simulating the step response of %1 joint(s)...").arg(qulonglong(simulation->jointCount())));
+    m_stepResponseCancel = false;
+    m_stepResponse = std::thread([this, simulation = std::move(simulation), step, path] {
+        TraceZones::setThreadName("step response");
+        BatchJobs::StepResponse job;
+        job.step = step;
+        std::string error;
+        const bool ok = BatchJobs::stepResponse(*simulation, job, path.toStdString(), TelemetryHub::nowNs(),
+            &m_stepResponseCancel, &error);
+        QMetaObject::invokeMethod(this, [this, ok, error, path] {
+            if (m_stepResponse.joinable()) m_stepResponse.join();
+            if (!ok || !openSessionPlayback(path))
+                statusBar()->showMessage(QString("Step response failed: %1").arg(QString::fromStdString(error)));
+            }, Qt::QueuedConnection);
+        });
+}
+
+// --- Prefab instances ---
+
+void MainWindow::instanceSelection()
+{
+    auto& registry = m_scene->getRegistry();
+    auto selected = registry.view<SelectedComponent>();
+    if (selected.begin() == selected.end()) {
+        statusBar()->showMessage("Select something to instance");
+        return;
+    }
+    // A link or a part instances the whole hierarchy it belongs to.
+    entt::entity root = *selected.begin();
+    for (const ParentComponent* parent; (parent = registry.try_get<ParentComponent>(root)) && registry.valid(parent->parent);)
+        root = parent->parent;
+
+    std::shared_ptr<const Prefab> prefab;
+    if (const auto* instance = registry.try_get<PrefabInstanceComponent>(root)) prefab = instance->prefab;
     else {
-        statusBar()->showMessage(QString("Successfully loaded robot '%1'").arg(QString::fromStdString(description.name)));
-        SceneBuilder::spawnRobot(*m_scene, description);
+        TransformSystem::propagate(registry);
+        prefab = PrefabSystem::capture(registry, root);
+    }
+    if (!prefab) {
+        statusBar()->showMessage("Nothing to instance: the selection has no meshes");
+        return;
+    }
+
+    // Next to the original along x, selected so Ctrl+D again continues the row.
+    const auto& xf = registry.get<TransformComponent>(root);
+    const entt::entity copy = PrefabSystem::instantiate(registry, prefab, xf.translation, xf.rotation);
+    registry.get<TransformComponent>(copy).scale = xf.scale;
+    PrefabSystem::update(registry);
+    const auto& instance = registry.get<PrefabInstanceComponent>(copy);
+    registry.get<TransformComponent>(copy).translation.x += std::max(1.0f, instance.localMax.x - instance.localMin.x);
+    registry.clear<SelectedComponent>();
+    registry.emplace<SelectedComponent>(copy);
+    markSceneDirty();
+    statusBar()->showMessage(QString("Instanced '%1' (%2 parts)").arg(QString::fromStdString(prefab->name))
+        .arg(qulonglong(prefab->parts.size())));
+}
+
+#if KR_PYTHON_ENABLED
+// --- Scripting ---
+
+void MainWindow::runScript()
+{
+    const QString filePath = QFileDialog::getOpenFileName(this, "Run Script", "", "Python Scripts (*.py)");
+    if (filePath.isEmpty()) return;
+    if (!m_scripts) m_scripts = std::make_unique<ScriptHost>(m_scene->getRegistry());
+
+    QElapsedTimer timer;
+    timer.start();
+    std::string error;
+    const bool ok = m_scripts->runFile(filePath.toStdString(), &error);
+    // Whatever ran before the error has already changed the scene.
+    markSceneDirty();
+    const QString name = QFileInfo(filePath).fileName();
+    if (ok)
+        statusBar()->showMessage(QString("Ran '%1' in %2 ms").arg(name).arg(timer.elapsed()));
+    else
+        QMessageBox::warning(this, "Script Error", QString::fromStdString(error));
+}
+#endif
+
+void MainWindow::addPointCloud(const QString& octreePath, const QString& name)
+{
+    std::string error;
+    std::shared_ptr<PointCloudOctree> octree = PointCloudOctree::open(octreePath.toStdString(), &error);
+    if (!octree) {
+        statusBar()->showMessage(QString("Point cloud import failed: %1").arg(QString::fromStdString(error)));
+        return;
+    }
+
+    auto& registry = m_scene->getRegistry();
+    const entt::entity entity = registry.create();
+    registry.emplace<TagComponent>(entity, name.toStdString());
+    registry.emplace<TransformComponent>(entity);
+    registry.emplace<PointCloudComponent>(entity, std::move(octree));
+    // Scans repel the flow visualizers, so clearance around obstacles shows up.
+    registry.emplace<PointCloudEffectorComponent>(entity);
+    registry.emplace<FieldSourceTag>(entity);
+    markSceneDirty();
+    statusBar()->showMessage(QString("Loaded point cloud '%1' (%2 points)")
+        .arg(name).arg(qulonglong(registry.get<PointCloudComponent>(entity).octree->header().pointCount)));
+}
+
+bool MainWindow::addStressScene(const QString& parameters)
+{
+    FrameBenchmark::Config config;
+    if (!FrameBenchmark::parseParameters(config, parameters.startsWith("--") ? QString() : parameters)) return false;
+    if (!FrameBenchmark::populateScene(*m_scene, config)) return false;
+    const FrameBenchmark::SceneStats stats = FrameBenchmark::sceneStats(m_scene->getRegistry());
+    statusBar()->showMessage(QString("Stress scene: %1 entities, %2 triangles, %3 effectors")
+        .arg(stats.entities).arg(stats.triangles).arg(stats.effectors));
+    markSceneDirty();
+    return true;
+}
+
+void MainWindow::addLaserGate()
+{
+    // A 2 m x 2 m curtain standing on the floor in front of the origin; the
+    // safety zone is the entity's unit box, so move and scale it to fit.
+    auto& registry = m_scene->getRegistry();
+    const entt::entity entity = registry.create();
+    registry.emplace<TagComponent>(entity, "Laser Gate");
+    auto& transform = registry.emplace<TransformComponent>(entity);
+    transform.translation = { 0.0f, 1.0f, 1.0f };
+    transform.scale = { 2.0f, 2.0f, 0.01f };
+    registry.emplace<RenderableMeshComponent>(entity, litCubeMesh());
+    registry.emplace<MaterialComponent>(entity).albedo = { 0.9f, 0.1f, 0.1f };
+    registry.emplace<SafetyZoneComponent>(entity);
+    markSceneDirty();
+}
+
+void MainWindow::onSafetyZoneEvent(entt::entity zone, entt::entity link, bool entered)
+{
+    const auto& registry = m_scene->getRegistry();
+    auto name = [&registry](entt::entity e) {
+        const auto* tag = registry.valid(e) ? registry.try_get<TagComponent>(e) : nullptr;
+        return tag ? QString::fromStdString(tag->tag) : QString("entity %1").arg(entt::to_integral(e));
+    };
+    if (entered)
+        statusBar()->showMessage(QString("Safety zone '%1' violated by '%2'").arg(name(zone), name(link)));
+    else if (!registry.valid(zone) || !registry.all_of<SafetyZoneViolationComponent>(zone))
+        statusBar()->showMessage(QString("Safety zone '%1' clear").arg(name(zone)));
+}
+
+void MainWindow::showClearance()
+{
+    const auto& registry = m_scene->getRegistry();
+    const entt::entity robot = selectedRobot();
+    const auto* clearance = robot == entt::null ? nullptr : registry.try_get<ClearanceComponent>(robot);
+    const ClearanceMonitor::Stats& stats = m_clearance->stats();
+    if (!clearance || (stats.obstacles == 0 && stats.pendingFields == 0)) {
+        m_clearanceLabel->hide();
+        return;
+    }
+    auto name = [&registry](entt::entity e) {
+        const auto* tag = registry.valid(e) ? registry.try_get<TagComponent>(e) : nullptr;
+        return tag ? QString::fromStdString(tag->tag) : QString("entity %1").arg(entt::to_integral(e));
+    };
+    QString text;
+    if (clearance->link != entt::null)
+        text = QString("Clearance %1 mm: '%2' to '%3'").arg(double(clearance->distance) * 1000.0, 0, 'f', 0)
+            .arg(name(clearance->link), name(clearance->obstacle));
+    else
+        text = QString("Clearance > %1 mm").arg(double(m_clearance->settings().band) * 1000.0, 0, 'f', 0);
+    if (stats.pendingFields > 0) text += QString(" (%1 distance fields building)").arg(stats.pendingFields);
+    if (m_clearanceLabel->text() != text) m_clearanceLabel->setText(text);
+    m_clearanceLabel->show();
+}
+
+void MainWindow::setSimulatedLidar(bool enabled)
+{
+    auto& registry = m_scene->getRegistry();
+    if (!enabled) {
+        // The renderer frees the ring once the stream's reader has stopped.
+        if (registry.valid(m_simulatedLidar)) registry.destroy(m_simulatedLidar);
+        m_simulatedLidar = entt::null;
+    }
+    else if (!registry.valid(m_simulatedLidar)) {
+        m_simulatedLidar = registry.create();
+        registry.emplace<TagComponent>(m_simulatedLidar, "Simulated LiDAR");
+        registry.emplace<TransformComponent>(m_simulatedLidar).translation = { 0.0f, 1.0f, 0.0f };
+        auto& sensor = registry.emplace<SensorStreamComponent>(m_simulatedLidar);
+        sensor.stream = std::make_shared<SensorStream>("Simulated LiDAR", std::make_unique<SimulatedLidarReader>());
+    }
+    markSceneDirty();
+}
+
+void MainWindow::setLiveReconstruction(bool enabled)
+{
+    auto& registry = m_scene->getRegistry();
+    auto reconstructions = registry.view<ReconstructionComponent>();
+    if (reconstructions.begin() == reconstructions.end()) {
+        if (!enabled) return;
+        const entt::entity entity = registry.create();
+        registry.emplace<TagComponent>(entity, "Scene Reconstruction");
+        registry.emplace<ReconstructionComponent>(entity);
+    }
+    for (auto [entity, reconstruction] : reconstructions.each()) reconstruction.integrate = enabled;
+    markSceneDirty();
+}
+
+void MainWindow::setLazyDockContent(ads::CDockWidget* dock, std::function<QWidget*()> create)
+{
+    m_lazyDocks[dock] = std::move(create);
+    connect(dock, &ads::CDockWidget::visibilityChanged, this, [this, dock](bool visible) {
+        if (visible) ensureDockContent(dock);
+        });
+}
+
+void MainWindow::ensureDockContent(ads::CDockWidget* dock)
+{
+    const auto it = m_lazyDocks.find(dock);
+    if (it == m_lazyDocks.end()) return;
+    const std::function<QWidget*()> create = std::move(it->second);
+    m_lazyDocks.erase(it);
+    dock->setWidget(create());
+}
+
+void MainWindow::setCanMonitor(bool enabled)
+{
+    m_canMonitorDock->toggleView(enabled);
+    if (!enabled) {
+        if (m_canMonitor) m_canMonitor->stop();
+        return;
+    }
+    ensureDockContent(m_canMonitorDock);   // the Show event may not have arrived yet
+
+    // Decode against the robots in the scene now; re-toggle after loading another.
+    CanDecodeTable table = CanDecodeTable::compile(m_scene->getRegistry());
+#ifdef __linux__
+    for (const char* bus : { "can0", "vcan0" })
+        if (m_canMonitor->start(std::make_unique<SocketCanReader>(bus), table)) return;
+#endif
+    std::vector<std::uint8_t> nodes = table.nodes();
+    if (nodes.empty()) nodes = { 1, 2, 3, 4, 5, 6 };
+    m_canMonitor->start(std::make_unique<SimulatedCanReader>(std::move(nodes)), std::move(table));
+    statusBar()->showMessage("No CAN interface found; the CAN monitor is showing simulated CANopen traffic.");
+}
+
+void MainWindow::onEmergencyStopPressed()
+{
+    if (!m_commandLoop->emergencyStopped()) {
+        m_estop->trip();
+        return;
+    }
+    // Latched: pressing again is the only way to release it, and only on purpose.
+    if (QMessageBox::question(this, "Emergency stop", "Release the emergency stop? Staged joint commands are sent again.")
+        != QMessageBox::Yes) return;
+    m_commandLoop->clearEmergencyStop();
+    statusBar()->showMessage("Emergency stop released");
+}
+
+void MainWindow::showFindReplace()
+{
+    if (!m_findReplace) {
+        m_findReplace = new FindReplaceDialog(m_scene.get(), this);
+        connect(m_findReplace, &FindReplaceDialog::entityActivated, this, [this](entt::entity entity) {
+            auto& registry = m_scene->getRegistry();
+            if (!registry.valid(entity)) return;
+            registry.clear<SelectedComponent>();
+            registry.emplace<SelectedComponent>(entity);
+            markSceneDirty();
+            });
+        connect(m_findReplace, &FindReplaceDialog::namesChanged, this, &MainWindow::markSceneDirty);
+    }
+    m_findReplace->show();
+    m_findReplace->raise();
+    m_findReplace->activateWindow();
+}
+
+void MainWindow::setJointLabels(bool enabled)
+{
+    entt::registry& registry = m_scene->getRegistry();
+    for (auto [entity, joint] : registry.view<JointComponent>().each()) {
+        if (!enabled) {
+            registry.remove<LabelComponent>(entity);
+            continue;
+        }
+        LabelComponent label;
+        label.text = joint.description.name;
+        label.colour = glm::vec4(1.0f, 0.92f, 0.55f, 1.0f);
+        registry.emplace_or_replace<LabelComponent>(entity, std::move(label));
+    }
+    markSceneDirty();
+}
+
+void MainWindow::setRemoteView(bool enabled)
+{
+    if (!enabled) {
+        if (m_remoteView) m_remoteView->stop();
+        statusBar()->showMessage("Remote view stopped.");
+        return;
+    }
+    if (m_viewports.empty()) return;
+    if (!m_remoteView) {
+        m_remoteView = new RemoteViewServer(this);
+        connect(m_remoteView, &RemoteViewServer::viewersChanged, this, [this](int viewers) {
+            statusBar()->showMessage(QString("Remote view at %1 - %2 viewer(s)").arg(m_remoteView->url()).arg(viewers));
+            });
+    }
+    if (m_remoteView->start(m_viewports.front()))
+        statusBar()->showMessage(QString("Remote view at %1").arg(m_remoteView->url()));
+    else
+        statusBar()->showMessage("Remote view could not start: the port is in use.");
+}
+
+void MainWindow::setTwinSync(bool enabled)
+{
+    if (!enabled) {
+        if (m_twinPublisher) m_twinPublisher->stop();
+        if (m_twinMirror) m_twinMirror->stop();
+        statusBar()->showMessage("Digital twin sync stopped.");
+        return;
+    }
+
+    QMessageBox choice(QMessageBox::Question, "Digital twin sync",
+        "Publish this scene's live state to other workstations, or mirror a publisher onto the scene loaded here?",
+        QMessageBox::Cancel, this);
+    QAbstractButton* publish = choice.addButton("Publish", QMessageBox::AcceptRole);
+    QAbstractButton* mirror = choice.addButton("Mirror...", QMessageBox::ActionRole);
+    choice.exec();
+
+    auto& registry = m_scene->getRegistry();
+    if (choice.clickedButton() == publish) {
+        if (!m_twinPublisher) {
+            m_twinPublisher = new TwinPublisher(registry, this);
+            connect(m_twinPublisher, &TwinPublisher::mirrorsChanged, this, [this](int mirrors) {
+                statusBar()->showMessage(QString("Publishing the digital twin on UDP port %1 - %2 mirror(s)")
+                    .arg(TwinSyncFormat::kDefaultPort).arg(mirrors));
+                });
+        }
+        if (m_twinPublisher->start()) {
+            statusBar()->showMessage(QString("Publishing the digital twin on UDP port %1").arg(TwinSyncFormat::kDefaultPort));
+            return;
+        }
+        statusBar()->showMessage("Digital twin sync could not start: the port is in use.");
+    } else if (choice.clickedButton() == mirror) {
+        bool ok = false;
+        const QString text = QInputDialog::getText(this, "Mirror a digital twin", "Publisher (host or host:port):",
+            QLineEdit::Normal, m_twinPublisherAddress, &ok).trimmed();
+        if (ok && !text.isEmpty()) {
+            m_twinPublisherAddress = text;
+            const QStringList parts = text.split(':');
+            const quint16 port = parts.size() > 1 ? quint16(parts[1].toUInt()) : TwinSyncFormat::kDefaultPort;
+            QHostAddress address(parts[0]);
+            if (address.isNull()) {
+                for (const QHostAddress& candidate : QHostInfo::fromName(parts[0]).addresses())
+                    if (candidate.protocol() == QAbstractSocket::IPv4Protocol) { address = candidate; break; }
+            }
+            if (address.isNull()) {
+                statusBar()->showMessage(QString("Cannot resolve %1.").arg(parts[0]));
+            } else {
+                if (!m_twinMirror) {
+                    m_twinMirror = new TwinMirror(registry, this);
+                    // Only what the camera can reasonably see, robots always.
+                    m_twinMirror->setInterestProvider([this]() {
+                        TwinMirror::Interest interest;
+                        if (!m_viewports.empty()) interest.center = m_viewports.front()->getCamera().getPosition();
+                        interest.radius = 50.0f;
+                        return interest;
+                        });
+                    connect(m_twinMirror, &TwinMirror::sceneUpdated, this, &MainWindow::markSceneDirty);
+                    connect(m_twinMirror, &TwinMirror::connectedChanged, this, [this](bool connected) {
+                        statusBar()->showMessage(connected ? QString("Mirroring the digital twin from %1").arg(m_twinPublisherAddress)
+                                                           : QString("Waiting for the digital twin publisher at %1...").arg(m_twinPublisherAddress));
+                        });
+                }
+                if (m_twinMirror->start(address, port ? port : TwinSyncFormat::kDefaultPort)) {
+                    statusBar()->showMessage(QString("Waiting for the digital twin publisher at %1...").arg(text));
+                    return;
+                }
+                statusBar()->showMessage("Digital twin sync could not open a UDP socket.");
+            }
+        }
+    }
+    m_fixedTopToolbar->setTwinSyncChecked(false);   // cancelled or failed
+}
+
+// --- Robot import ---
+
+void MainWindow::setupImportStatus()
+{
+    m_importProgress = new QProgressBar(this);
+    m_importProgress->setMaximumWidth(200);
+    m_importProgress->setTextVisible(false);
+    m_importProgress->hide();
+
+    m_importCancel = new QToolButton(this);
+    m_importCancel->setText("Cancel");
+    m_importCancel->hide();
+    connect(m_importCancel, &QToolButton::clicked, this, [this] { m_robotImport->cancel(); });
+
+    statusBar()->addPermanentWidget(m_importProgress);
+    statusBar()->addPermanentWidget(m_importCancel);
+
+    m_clearanceLabel = new QLabel(this);
+    m_clearanceLabel->hide();
+    statusBar()->addPermanentWidget(m_clearanceLabel);
+}
+
+bool MainWindow::pollRobotImport()
+{
+    if (!m_robotImport->busy()) return false;
+    // Read first: once finished, the queue below holds every model left.
+    const bool finished = m_robotImport->finished();
+
+    // World models arrive one by one; the first replaces the current robots,
+    // the rest join it. Rebinding once per batch keeps hundreds of models cheap.
+    std::vector<RobotSceneDelta> models = m_robotImport->takeModels();
+    for (RobotSceneDelta& model : models)
+        SceneBuilder::commitRobot(*m_scene, std::move(model), m_importCommitted++ == 0);
+    if (!models.empty()) {
+        m_playback.reset();
+        m_telemetry->bind(m_scene->getRegistry());
+        m_commandLoop->bind(m_scene->getRegistry());
+    }
+    const bool committed = !models.empty();
+
+    if (!finished) {
+        const RobotImportJob::Progress progress = m_robotImport->progress();
+        if (progress.stage == RobotImportJob::Stage::Decoding && progress.models > 0) {
+            statusBar()->showMessage(QString("Importing '%1': %2 models placed")
+                .arg(m_importName).arg(m_importCommitted));
+        }
+        else if (progress.stage == RobotImportJob::Stage::Decoding && progress.total > 0) {
+            m_importProgress->setRange(0, int(progress.total));
+            m_importProgress->setValue(int(progress.done));
+            statusBar()->showMessage(QString("Importing '%1': %2 / %3 meshes")
+                .arg(m_importName).arg(progress.done).arg(progress.total));
+        }
+        return committed;
+    }
+
+    RobotImportJob::Result result = m_robotImport->take();
+    m_importProgress->hide();
+    m_importCancel->hide();
+
+    switch (result.stage) {
+    case RobotImportJob::Stage::Ready: {
+        if (!result.delta.model) {   // a world; its models are in already
+            statusBar()->showMessage(QString("Successfully loaded %1 models from '%2'").arg(m_importCommitted).arg(m_importName));
+            return committed;
+        }
+        const QString name = QString::fromStdString(result.delta.description.name);
+        SceneBuilder::commitRobot(*m_scene, std::move(result.delta));
+        m_playback.reset();
+        m_telemetry->bind(m_scene->getRegistry());
+        m_commandLoop->bind(m_scene->getRegistry());
+        statusBar()->showMessage(QString("Successfully loaded robot '%1'").arg(name));
+        return true;
+    }
+
+    case RobotImportJob::Stage::NeedsEnrichment: {
+        // The dialog runs a nested event loop; ticks keep coming, but the job is idle until restarted below.
+        RobotEnrichmentDialog dialog(result.delta.description, this);
+        if (dialog.exec() != QDialog::Accepted) {
+            statusBar()->showMessage("Import cancelled.");
+            return false;
+        }
+        const RobotDescription& finalDescription = dialog.getFinalDescription();
+        QString krobotSavePath = QFileDialog::getSaveFileName(this, "Save Enriched KRobot File", "", "KRobot Files (*.krobot)");
+        if (krobotSavePath.isEmpty()) return false;
+
+        if (!KRobotWriter::save(finalDescription, krobotSavePath.toStdString())) {
+            QMessageBox::critical(this, "File Save Error", "Could not save the new .krobot file.");
+            return false;
+        }
+        m_importCommitted = 0;
+        m_robotImport->start(finalDescription);
+        m_importProgress->setRange(0, 0);
+        m_importProgress->show();
+        m_importCancel->show();
+        statusBar()->showMessage(QString("Successfully imported and enriched '%1'").arg(m_importName));
+        return false;
+    }
+
+    case RobotImportJob::Stage::Cancelled:
+        statusBar()->showMessage("Import cancelled.");
+        return committed;
+
+    default:
+        qWarning() << "[MainWindow] Robot import failed:" << QString::fromStdString(result.error);
+        statusBar()->showMessage("Import failed.");
+        QMessageBox::critical(this, "File Load Error",
+            QString("Could not parse the selected robot file.\n%1").arg(QString::fromStdString(result.error)));
+        return committed;
     }
 }
 
 void MainWindow::onFlowVisualizerSettingsChanged()
 {
+    if (!m_flowVisualizerMenu) return;   // nothing edited yet: the component keeps its settings
+    markSceneDirty();
     auto& registry = m_scene->getRegistry();
     auto view = registry.view<FieldVisualizerComponent, TransformComponent>();
 
@@ -475,13 +2235,17 @@ void MainWindow::onFlowVisualizerSettingsChanged()
     }
 
     auto visualizerEntity = view.front();
+    UndoStack::Scope edit(m_scene->undo(), registry, "Field visualizer settings");
+    edit.track<FieldVisualizerComponent, TransformComponent>(visualizerEntity);
     auto& visualizer = view.get<FieldVisualizerComponent>(visualizerEntity);
     auto& transform = view.get<TransformComponent>(visualizerEntity);
+    const FieldBufferInputs applied(visualizer);
 
     // --- Update Transform and General Settings ---
     transform.translation = m_flowVisualizerMenu->getFieldPosition();
     transform.rotation = glm::quat(glm::radians(m_flowVisualizerMenu->getFieldOrientation()));
     visualizer.isEnabled = m_flowVisualizerMenu->isMasterVisible();
+    visualizer.temporalSettings.enabled = m_flowVisualizerMenu->isTemporal();
     visualizer.displayMode = m_flowVisualizerMenu->getDisplayMode();
     visualizer.bounds = m_flowVisualizerMenu->getBounds();
 
@@ -557,6 +2321,12 @@ void MainWindow::onFlowVisualizerSettingsChanged()
         // ... etc for flow direction colors and gradients
         break;
     }
+    case FieldVisualizerComponent::DisplayMode::Streamlines:
+        // The menu's streamline page has no controls yet: StreamlineSettings keeps its values.
+        break;
+    case FieldVisualizerComponent::DisplayMode::Volume:
+        // Likewise VolumeSettings; its source comes from Ctrl+Shift+W or scripts.
+        break;
     }
 
     if (visualizer.displayMode == FieldVisualizerComponent::DisplayMode::Arrows) {
@@ -566,8 +2336,17 @@ void MainWindow::onFlowVisualizerSettingsChanged()
             << "Scale:" << settings.vectorScale;
     }
 
-    // Mark the component as dirty so the rendering system knows to update its GPU buffers.
-    visualizer.isGpuDataDirty = true;
+    // Buffer-sized changes wait for the menu to settle (the timer restarts
+    // on every edit) and then rebuild once; the old buffers draw meanwhile.
+    if (FieldBufferInputs(visualizer) != applied) {
+        if (m_applyingFieldRebuild) {
+            visualizer.isGpuDataDirty = true;
+        }
+        else {
+            applied.applyTo(visualizer);
+            m_fieldRebuildTimer->start();
+        }
+    }
     qDebug() << "Flow visualizer settings successfully applied to component.";
 }
 
@@ -581,16 +2360,33 @@ void MainWindow::updateVisualizerUI()
     const auto& visualizer = view.get<const FieldVisualizerComponent>(view.front());
 
     // Pass the component to the menu's new public setter function
-    m_flowVisualizerMenu->updateControlsFromComponent(visualizer);
+    if (m_flowVisualizerMenu) m_flowVisualizerMenu->updateControlsFromComponent(visualizer);
+}
+
+void MainWindow::stepHistory(bool redo)
+{
+    UndoStack& history = m_scene->undo();
+    const QString label = QString::fromStdString(redo ? history.redoLabel() : history.undoLabel());
+    auto& registry = m_scene->getRegistry();
+    if (!(redo ? history.redo(registry) : history.undo(registry))) return;
+
+    // The panels write back whatever they show; bring them in line first.
+    updateVisualizerUI();
+    if (m_propertiesPanel) m_propertiesPanel->refresh();
+    markSceneDirty();
+    statusBar()->showMessage(QString("%1: %2").arg(redo ? "Redo" : "Undo", label), 2000);
 }
 
 void MainWindow::onFlowVisualizerTransformChanged()
 {
+    markSceneDirty();
     auto& reg = m_scene->getRegistry();
     auto view = reg.view<TransformComponent, FieldVisualizerComponent>();
     if (view.size_hint() == 0) return;
 
     auto e = view.front();
+    UndoStack::Scope edit(m_scene->undo(), reg, "Move field visualizer");
+    edit.track<TransformComponent>(e);
     auto [xf, viz] = view.get<TransformComponent, FieldVisualizerComponent>(e);
 
     xf.translation = m_flowVisualizerMenu->getCentre();
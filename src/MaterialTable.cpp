@@ -0,0 +1,93 @@
+#include "MaterialTable.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
+
+#include <QOpenGLFunctions_4_3_Core>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+std::uint64_t hashRecord(const MaterialGpu& record)
+{
+    unsigned char bytes[sizeof(MaterialGpu)];
+    std::memcpy(bytes, &record, sizeof(record));
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char b : bytes) { h ^= b; h *= 0x100000001b3ull; }
+    return h;
+}
+
+bool sameRecord(const MaterialGpu& a, const MaterialGpu& b)
+{
+    return std::memcmp(&a, &b, sizeof(MaterialGpu)) == 0;
+}
+}
+
+void MaterialTable::clear()
+{
+    m_records.clear();
+    m_recordIndex.clear();
+
+    // Record 0: what a mesh without a MaterialComponent draws with.
+    add({}, {}, 0.1f, 0.8f, glm::vec3(0.0f));
+}
+
+GLuint MaterialTable::add(const std::string& albedoMap, const std::string& metalRoughnessMap,
+    float metallic, float roughness, const glm::vec3& emissive)
+{
+    MaterialGpu record{};   // zeroed, so padding hashes alike
+    record.emissive = glm::vec4(emissive, 0.0f);
+    record.metallic = std::clamp(metallic, 0.0f, 1.0f);
+    record.roughness = std::clamp(roughness, 0.0f, 1.0f);
+    record.albedoLayer = -1;
+    record.metalRoughnessLayer = -1;
+    if (!albedoMap.empty()) {
+        const auto residency = m_streamer.residency(Map::Color, albedoMap);
+        record.albedoLayer = residency.layer;
+        record.albedoLevel = residency.level;
+    }
+    if (!metalRoughnessMap.empty()) {
+        const auto residency = m_streamer.residency(Map::Data, metalRoughnessMap);
+        record.metalRoughnessLayer = residency.layer;
+        record.metalRoughnessLevel = residency.level;
+    }
+
+    const std::uint64_t hash = hashRecord(record);
+    if (const auto it = m_recordIndex.find(hash); it != m_recordIndex.end() && sameRecord(m_records[it->second], record))
+        return it->second;
+
+    const GLuint index = static_cast<GLuint>(m_records.size());
+    m_records.push_back(record);
+    m_recordIndex.emplace(hash, index);   // a colliding record just goes unshared
+    return index;
+}
+
+void MaterialTable::upload()
+{
+    const GLsizeiptr bytes = GLsizeiptr(m_records.size() * sizeof(MaterialGpu));
+    if (m_buffer == 0) m_gl->glGenBuffers(1, &m_buffer);
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+    if (bytes > m_capacity) {
+        m_capacity = std::max<GLsizeiptr>(bytes, m_capacity * 2);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, m_buffer, m_capacity, nullptr, GL_DYNAMIC_DRAW,
+            GpuMemory::Category::Materials);
+    }
+    m_gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, m_records.data());
+    RenderStats::upload(std::uint64_t(bytes));
+}
+
+void MaterialTable::request(const std::string& albedoMap, const std::string& metalRoughnessMap, float pixels)
+{
+    if (!albedoMap.empty()) m_streamer.request(Map::Color, albedoMap, pixels);
+    if (!metalRoughnessMap.empty()) m_streamer.request(Map::Data, metalRoughnessMap, pixels);
+}
+
+void MaterialTable::destroy()
+{
+    if (!m_gl) return;
+    if (m_buffer != 0) GpuMemory::deleteBuffers(m_gl, 1, &m_buffer);
+    m_buffer = 0;
+    m_capacity = 0;
+    m_streamer.destroy();
+    m_records.clear();
+    m_recordIndex.clear();
+}
@@ -0,0 +1,223 @@
+#include "MeshArena.hpp"
+#include "GpuMemory.hpp"
+#include "components.hpp"
+#include "RenderStats.hpp"
+
+#include <QOpenGLFunctions_4_3_Core>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr GLsizei kInitialVertexCapacity = 64 * 1024;
+constexpr GLsizei kInitialIndexCapacity = 192 * 1024;
+constexpr GLsizei kInitialClusterCapacity = 4 * 1024;
+
+// Signed 10-bit normalized x/y/z, w = 0, as GL_INT_2_10_10_10_REV expects.
+std::uint32_t packNormal(const glm::vec3& n)
+{
+    auto snorm10 = [](float v) {
+        const int q = int(std::lround(std::clamp(v, -1.0f, 1.0f) * 511.0f));
+        return std::uint32_t(q) & 0x3FFu;
+    };
+    return snorm10(n.x) | (snorm10(n.y) << 10) | (snorm10(n.z) << 20);
+}
+}
+
+GLsizei MeshArena::vertexStride() const
+{
+    if (m_vertices.elementSize != 0) return m_vertices.elementSize;   // layout of what is stored
+    return m_layout == VertexLayout::Compact ? GLsizei(sizeof(PackedVertex)) : GLsizei(sizeof(Vertex));
+}
+
+const MeshArena::Range* MeshArena::find(std::size_t key) const
+{
+    auto it = m_ranges.find(key);
+    return it == m_ranges.end() ? nullptr : &it->second;
+}
+
+const MeshArena::Range& MeshArena::acquire(std::size_t key, const MeshData& mesh)
+{
+    const std::vector<Vertex>& vertices = mesh.vertices;
+
+    if (auto it = m_ranges.find(key); it != m_ranges.end())
+        return it->second;
+
+    if (m_vertices.target == 0) {
+        m_vertices.target = GL_ARRAY_BUFFER;
+        m_vertices.elementSize = vertexStride();
+        m_indices.target = GL_ELEMENT_ARRAY_BUFFER;
+        m_indices.elementSize = sizeof(unsigned);
+        m_clusters.target = GL_SHADER_STORAGE_BUFFER;
+        m_clusters.elementSize = sizeof(ClusterGpu);
+    }
+
+    Range r;
+    r.vertexCount = static_cast<GLsizei>(vertices.size());
+    r.indexCount = static_cast<GLsizei>(mesh.indices.size());
+    r.lodCount = 1 + static_cast<int>(std::min<std::size_t>(mesh.lods.size(), kMaxLods - 1));
+    r.indexSpan = r.indexCount;
+    for (int l = 1; l < r.lodCount; ++l) r.indexSpan += static_cast<GLsizei>(mesh.lods[l - 1].indices.size());
+    r.clusterCount = static_cast<GLsizei>(mesh.clusters.size());
+    r.baseVertex = allocate(m_vertices, r.vertexCount);
+    r.firstIndex = static_cast<GLuint>(allocate(m_indices, r.indexSpan));
+    if (r.clusterCount > 0) r.firstCluster = static_cast<GLuint>(allocate(m_clusters, r.clusterCount));
+
+    // Indices stay mesh-local; baseVertex rebases them at draw time.
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertices.buffer);
+    if (m_vertices.elementSize == GLsizei(sizeof(PackedVertex))) {
+        m_packScratch.resize(vertices.size());
+        for (std::size_t i = 0; i < vertices.size(); ++i) {
+            PackedVertex& p = m_packScratch[i];
+            p.position[0] = vertices[i].position.x;
+            p.position[1] = vertices[i].position.y;
+            p.position[2] = vertices[i].position.z;
+            p.normal = packNormal(vertices[i].normal);
+        }
+        m_gl->glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(r.baseVertex) * sizeof(PackedVertex),
+            m_packScratch.size() * sizeof(PackedVertex), m_packScratch.data());
+        RenderStats::upload(m_packScratch.size() * sizeof(PackedVertex));
+    }
+    else {
+        m_gl->glBufferSubData(GL_COPY_WRITE_BUFFER,
+            GLintptr(r.baseVertex) * sizeof(Vertex), vertices.size() * sizeof(Vertex), vertices.data());
+        RenderStats::upload(vertices.size() * sizeof(Vertex));
+    }
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, m_indices.buffer);
+    GLuint next = r.firstIndex;
+    for (int l = 0; l < r.lodCount; ++l) {
+        const std::vector<unsigned>& indices = l == 0 ? mesh.indices : mesh.lods[l - 1].indices;
+        r.lods[l].firstIndex = next;
+        r.lods[l].indexCount = static_cast<GLsizei>(indices.size());
+        r.lods[l].error = l == 0 ? 0.0f : mesh.lods[l - 1].error;
+        m_gl->glBufferSubData(GL_COPY_WRITE_BUFFER,
+            GLintptr(next) * sizeof(unsigned), indices.size() * sizeof(unsigned), indices.data());
+        RenderStats::upload(indices.size() * sizeof(unsigned));
+        next += static_cast<GLuint>(indices.size());
+    }
+    if (r.clusterCount > 0) {
+        m_clusterScratch.resize(mesh.clusters.size());
+        for (std::size_t c = 0; c < mesh.clusters.size(); ++c) {
+            const MeshCluster& from = mesh.clusters[c];
+            ClusterGpu& to = m_clusterScratch[c];
+            to = ClusterGpu{ { from.center.x, from.center.y, from.center.z, from.radius },
+                { from.coneAxis.x, from.coneAxis.y, from.coneAxis.z, from.coneCutoff },
+                r.firstIndex + from.firstIndex, from.indexCount, { 0, 0 } };
+        }
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, m_clusters.buffer);
+        m_gl->glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(r.firstCluster) * sizeof(ClusterGpu),
+            m_clusterScratch.size() * sizeof(ClusterGpu), m_clusterScratch.data());
+        RenderStats::upload(m_clusterScratch.size() * sizeof(ClusterGpu));
+    }
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_vertexUsed += r.vertexCount;
+    m_indexUsed += r.indexSpan;
+    return m_ranges.emplace(key, r).first->second;
+}
+
+void MeshArena::release(std::size_t key)
+{
+    auto it = m_ranges.find(key);
+    if (it == m_ranges.end()) return;
+
+    const Range& r = it->second;
+    free(m_vertices, r.baseVertex, r.vertexCount);
+    free(m_indices, static_cast<GLsizei>(r.firstIndex), r.indexSpan);
+    free(m_clusters, static_cast<GLsizei>(r.firstCluster), r.clusterCount);
+    m_vertexUsed -= r.vertexCount;
+    m_indexUsed -= r.indexSpan;
+    m_ranges.erase(it);
+}
+
+void MeshArena::destroy()
+{
+    if (m_gl) {
+        if (m_vertices.buffer) GpuMemory::deleteBuffers(m_gl, 1, &m_vertices.buffer);
+        if (m_indices.buffer) GpuMemory::deleteBuffers(m_gl, 1, &m_indices.buffer);
+        if (m_clusters.buffer) GpuMemory::deleteBuffers(m_gl, 1, &m_clusters.buffer);
+    }
+    m_vertices = Pool{};
+    m_indices = Pool{};
+    m_clusters = Pool{};
+    m_ranges.clear();
+    m_vertexUsed = m_indexUsed = 0;
+    ++m_generation;
+}
+
+GLsizei MeshArena::allocate(Pool& pool, GLsizei count)
+{
+    // First fit from the free list before touching the bump pointer.
+    for (auto it = pool.freeList.begin(); it != pool.freeList.end(); ++it) {
+        if (it->size < count) continue;
+        const GLsizei offset = it->offset;
+        it->offset += count;
+        it->size -= count;
+        if (it->size == 0) pool.freeList.erase(it);
+        return offset;
+    }
+
+    if (pool.top + count > pool.capacity) grow(pool, pool.top + count);
+    const GLsizei offset = pool.top;
+    pool.top += count;
+    return offset;
+}
+
+void MeshArena::free(Pool& pool, GLsizei offset, GLsizei count)
+{
+    if (count == 0) return;
+
+    auto it = std::lower_bound(pool.freeList.begin(), pool.freeList.end(), offset,
+        [](const Block& b, GLsizei off) { return b.offset < off; });
+    it = pool.freeList.insert(it, Block{ offset, count });
+
+    // Merge with the following and preceding neighbours.
+    if (auto next = it + 1; next != pool.freeList.end() && it->offset + it->size == next->offset) {
+        it->size += next->size;
+        pool.freeList.erase(next);
+    }
+    if (it != pool.freeList.begin()) {
+        auto prev = it - 1;
+        if (prev->offset + prev->size == it->offset) {
+            prev->size += it->size;
+            it = pool.freeList.erase(it) - 1;
+        }
+    }
+
+    // A free block touching the top just lowers the bump pointer.
+    if (it->offset + it->size == pool.top) {
+        pool.top = it->offset;
+        pool.freeList.erase(it);
+    }
+}
+
+void MeshArena::grow(Pool& pool, GLsizei required)
+{
+    const GLsizei initialCapacity = pool.target == GL_ARRAY_BUFFER ? kInitialVertexCapacity
+        : pool.target == GL_ELEMENT_ARRAY_BUFFER ? kInitialIndexCapacity : kInitialClusterCapacity;
+    GLsizei newCapacity = std::max(pool.capacity * 2, initialCapacity);
+    while (newCapacity < required) newCapacity *= 2;
+
+    GLuint newBuffer = 0;
+    m_gl->glGenBuffers(1, &newBuffer);
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    GpuMemory::bufferData(m_gl, GL_COPY_WRITE_BUFFER, newBuffer, GLsizeiptr(newCapacity) * pool.elementSize, nullptr,
+        GL_STATIC_DRAW, GpuMemory::Category::Meshes);
+
+    if (pool.buffer != 0) {
+        // Offsets are preserved, so ranges handed out so far remain valid.
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, pool.buffer);
+        m_gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+            GLsizeiptr(pool.top) * pool.elementSize);
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        GpuMemory::deleteBuffers(m_gl, 1, &pool.buffer);
+    }
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    qDebug() << "[MeshArena] grew" << (pool.target == GL_ARRAY_BUFFER ? "vertex"
+        : pool.target == GL_ELEMENT_ARRAY_BUFFER ? "index" : "cluster") << "buffer to" << newCapacity << "elements";
+
+    pool.buffer = newBuffer;
+    pool.capacity = newCapacity;
+    ++m_generation;
+}
@@ -0,0 +1,447 @@
+#include "MeshBinary.hpp"
+#include "ConvexDecomposition.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimize.hpp"
+#include "MeshUtils.hpp"
+#include "TraceZones.hpp"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace MeshBinaryFormat;
+
+namespace
+{
+    constexpr float kPositionSteps = 65535.0f;
+    constexpr float kNormalSteps = 32767.0f;
+
+    std::uint64_t align8(std::uint64_t offset) { return (offset + 7) & ~std::uint64_t(7); }
+
+    float signNotZero(float v) { return v >= 0.0f ? 1.0f : -1.0f; }
+
+    // Octahedral mapping of a unit vector onto [-1, 1]^2.
+    void octEncode(const glm::vec3& n, std::int16_t out[2])
+    {
+        const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        float x = l1 > 0.0f ? n.x / l1 : 0.0f;
+        float y = l1 > 0.0f ? n.y / l1 : 0.0f;
+        if (n.z < 0.0f) {
+            const float fx = (1.0f - std::abs(y)) * signNotZero(x);
+            const float fy = (1.0f - std::abs(x)) * signNotZero(y);
+            x = fx; y = fy;
+        }
+        out[0] = static_cast<std::int16_t>(std::lround(std::clamp(x, -1.0f, 1.0f) * kNormalSteps));
+        out[1] = static_cast<std::int16_t>(std::lround(std::clamp(y, -1.0f, 1.0f) * kNormalSteps));
+    }
+
+    glm::vec3 octDecode(const std::int16_t in[2])
+    {
+        glm::vec3 v(in[0] / kNormalSteps, in[1] / kNormalSteps, 0.0f);
+        v.z = 1.0f - std::abs(v.x) - std::abs(v.y);
+        const float t = std::max(-v.z, 0.0f);
+        v.x += v.x >= 0.0f ? -t : t;
+        v.y += v.y >= 0.0f ? -t : t;
+        const float len = glm::length(v);
+        return len > 0.0f ? v / len : glm::vec3(0.0f, 0.0f, 1.0f);
+    }
+
+    template <typename T>
+    void put(std::vector<unsigned char>& bytes, std::uint64_t offset, const T& value)
+    {
+        std::memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+}
+
+bool MeshBinaryFormat::readHeader(const unsigned char* data, std::size_t size, FileHeader& header)
+{
+    header = FileHeader{};
+    if (!data || size < kHeaderSizeV1) return false;
+    std::memcpy(&header, data, std::min(size, sizeof(FileHeader)));
+    if (header.magic != kMagic || header.version < kMinVersion || header.version > kVersion) return false;
+    if (header.version < 2) {
+        // Those bytes already belong to the positions.
+        header.clusterCount = header.reserved = 0;
+        header.clustersOffset = 0;
+    }
+    return true;
+}
+
+namespace MeshBinary
+{
+    SourceStamp stampOf(const std::string& sourcePath)
+    {
+        const QFileInfo info(QString::fromStdString(sourcePath));
+        SourceStamp stamp;
+        if (!info.exists()) return stamp;
+        stamp.bytes = info.size();
+        stamp.modifiedMs = info.lastModified().toMSecsSinceEpoch();
+        return stamp;
+    }
+
+    std::vector<unsigned char> encode(const MeshData& mesh, const SourceStamp& stamp, std::uint32_t importFlags)
+    {
+        const std::size_t vertexCount = mesh.vertices.size();
+        std::size_t indexCount = mesh.indices.size();
+        for (const MeshLod& lod : mesh.lods) indexCount += lod.indices.size();
+
+        FileHeader header;
+        header.vertexCount = std::uint32_t(vertexCount);
+        header.indexCount = std::uint32_t(indexCount);
+        header.indexSize = vertexCount <= 0x10000 ? 2 : 4;
+        header.importFlags = importFlags;
+        header.lodCount = std::uint32_t(1 + mesh.lods.size());
+        header.sourceBytes = stamp.bytes;
+        header.sourceModifiedMs = stamp.modifiedMs;
+
+        glm::vec3 mn(std::numeric_limits<float>::max()), mx(-std::numeric_limits<float>::max());
+        bool hasUv = false;
+        for (const Vertex& v : mesh.vertices) {
+            mn = glm::min(mn, v.position);
+            mx = glm::max(mx, v.position);
+            hasUv = hasUv || v.uv != glm::vec2(0.0f);
+        }
+        if (vertexCount == 0) mn = mx = glm::vec3(0.0f);
+        for (int k = 0; k < 3; ++k) { header.boundsMin[k] = mn[k]; header.boundsMax[k] = mx[k]; }
+        if (hasUv) header.attributes |= kHasUv;
+
+        std::uint64_t offset = align8(sizeof(FileHeader));
+        header.positionsOffset = offset;  offset = align8(offset + vertexCount * 3 * sizeof(std::uint16_t));
+        header.normalsOffset = offset;    offset = align8(offset + vertexCount * 2 * sizeof(std::int16_t));
+        if (hasUv) { header.uvsOffset = offset; offset = align8(offset + vertexCount * 2 * sizeof(float)); }
+        header.indicesOffset = offset;    offset = align8(offset + indexCount * header.indexSize);
+        header.lodsOffset = offset;       offset = align8(offset + header.lodCount * sizeof(Lod));
+
+        // Clusters bound what decode() will return, so they are built from
+        // the quantized positions, dequantized exactly as decode() does.
+        MeshData drawn;
+        const bool clustered = mesh.indices.size() / 3 >= MeshOptimize::kMinClusteredTriangles;
+        if (clustered) {
+            drawn.vertices.resize(vertexCount);
+            drawn.indices = mesh.indices;
+        }
+
+        const glm::vec3 extent = mx - mn;
+        const glm::vec3 scale = extent / kPositionSteps;
+        std::vector<std::uint16_t> quantized(vertexCount * 3);
+        for (std::size_t i = 0; i < vertexCount; ++i) {
+            std::uint16_t* q = &quantized[i * 3];
+            for (int k = 0; k < 3; ++k) {
+                const float t = extent[k] > 0.0f ? (mesh.vertices[i].position[k] - mn[k]) / extent[k] : 0.0f;
+                q[k] = static_cast<std::uint16_t>(std::lround(std::clamp(t, 0.0f, 1.0f) * kPositionSteps));
+            }
+            if (clustered) drawn.vertices[i].position = mn + glm::vec3(q[0], q[1], q[2]) * scale;
+        }
+        if (clustered) MeshOptimize::buildClusters(drawn);
+        header.clusterCount = std::uint32_t(drawn.clusters.size());
+        header.clustersOffset = offset;   offset += header.clusterCount * sizeof(Cluster);
+
+        std::vector<unsigned char> bytes(offset, 0);
+        put(bytes, 0, header);
+
+        for (std::size_t i = 0; i < vertexCount; ++i) {
+            const Vertex& v = mesh.vertices[i];
+            std::memcpy(bytes.data() + header.positionsOffset + i * 3 * sizeof(std::uint16_t), &quantized[i * 3],
+                3 * sizeof(std::uint16_t));
+
+            std::int16_t n[2];
+            octEncode(v.normal, n);
+            std::memcpy(bytes.data() + header.normalsOffset + i * sizeof(n), n, sizeof(n));
+
+            if (hasUv) std::memcpy(bytes.data() + header.uvsOffset + i * sizeof(glm::vec2), &v.uv, sizeof(glm::vec2));
+        }
+
+        // Every level's indices back to back; the lod table names the ranges.
+        std::size_t written = 0;
+        auto writeLevel = [&](const std::vector<unsigned>& indices, float error, std::uint32_t level) {
+            Lod lod;
+            lod.firstIndex = std::uint32_t(written);
+            lod.indexCount = std::uint32_t(indices.size());
+            lod.error = error;
+            put(bytes, header.lodsOffset + level * sizeof(Lod), lod);
+            if (header.indexSize == 2) {
+                for (std::size_t i = 0; i < indices.size(); ++i)
+                    put(bytes, header.indicesOffset + (written + i) * 2, static_cast<std::uint16_t>(indices[i]));
+            }
+            else {
+                std::memcpy(bytes.data() + header.indicesOffset + written * 4, indices.data(), indices.size() * sizeof(std::uint32_t));
+            }
+            written += indices.size();
+        };
+        writeLevel(mesh.indices, 0.0f, 0);
+        for (std::size_t l = 0; l < mesh.lods.size(); ++l)
+            writeLevel(mesh.lods[l].indices, mesh.lods[l].error, std::uint32_t(l + 1));
+
+        for (std::size_t c = 0; c < drawn.clusters.size(); ++c) {
+            const MeshCluster& from = drawn.clusters[c];
+            Cluster cluster;
+            std::memcpy(cluster.center, &from.center, sizeof(cluster.center));
+            cluster.radius = from.radius;
+            std::memcpy(cluster.coneAxis, &from.coneAxis, sizeof(cluster.coneAxis));
+            cluster.coneCutoff = from.coneCutoff;
+            cluster.firstIndex = from.firstIndex;
+            cluster.indexCount = from.indexCount;
+            put(bytes, header.clustersOffset + c * sizeof(Cluster), cluster);
+        }
+        return bytes;
+    }
+
+    bool decode(const unsigned char* data, std::size_t size, MeshData& out)
+    {
+        FileHeader header;
+        if (!readHeader(data, size, header)) return false;
+        if (header.indexSize != 2 && header.indexSize != 4) return false;
+        if (header.lodCount == 0) return false;
+
+        const std::uint64_t vc = header.vertexCount, ic = header.indexCount;
+        auto fits = [size](std::uint64_t offset, std::uint64_t bytes) { return offset <= size && bytes <= size - offset; };
+        if (!fits(header.positionsOffset, vc * 6) || !fits(header.normalsOffset, vc * 4) ||
+            !fits(header.indicesOffset, ic * header.indexSize) ||
+            !fits(header.lodsOffset, std::uint64_t(header.lodCount) * sizeof(Lod)) ||
+            !fits(header.clustersOffset, std::uint64_t(header.clusterCount) * sizeof(Cluster)) ||
+            ((header.attributes & kHasUv) && !fits(header.uvsOffset, vc * 8)))
+            return false;
+
+        const glm::vec3 mn(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        const glm::vec3 mx(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+        const glm::vec3 scale = (mx - mn) / kPositionSteps;
+
+        out.vertices.resize(vc);
+        const unsigned char* positions = data + header.positionsOffset;
+        const unsigned char* normals = data + header.normalsOffset;
+        for (std::size_t i = 0; i < vc; ++i) {
+            std::uint16_t q[3];
+            std::int16_t n[2];
+            std::memcpy(q, positions + i * sizeof(q), sizeof(q));
+            std::memcpy(n, normals + i * sizeof(n), sizeof(n));
+            Vertex& v = out.vertices[i];
+            v.position = mn + glm::vec3(q[0], q[1], q[2]) * scale;
+            v.normal = octDecode(n);
+            v.uv = glm::vec2(0.0f);
+        }
+        if (header.attributes & kHasUv)
+            for (std::size_t i = 0; i < vc; ++i)
+                std::memcpy(&out.vertices[i].uv, data + header.uvsOffset + i * sizeof(glm::vec2), sizeof(glm::vec2));
+
+        auto readLevel = [&](const Lod& lod, std::vector<unsigned>& indices) {
+            if (lod.firstIndex > ic || lod.indexCount > ic - lod.firstIndex) return false;
+            indices.resize(lod.indexCount);
+            const unsigned char* src = data + header.indicesOffset + std::size_t(lod.firstIndex) * header.indexSize;
+            if (header.indexSize == 4) {
+                std::memcpy(indices.data(), src, indices.size() * sizeof(std::uint32_t));
+            }
+            else {
+                for (std::size_t i = 0; i < indices.size(); ++i) {
+                    std::uint16_t index;
+                    std::memcpy(&index, src + i * 2, 2);
+                    indices[i] = index;
+                }
+            }
+            for (unsigned index : indices)
+                if (index >= vc) return false;
+            return true;
+        };
+
+        const unsigned char* lods = data + header.lodsOffset;
+        Lod lod;
+        std::memcpy(&lod, lods, sizeof(lod));
+        if (!readLevel(lod, out.indices)) return false;
+        out.lods.resize(header.lodCount - 1);
+        for (std::uint32_t l = 1; l < header.lodCount; ++l) {
+            std::memcpy(&lod, lods + l * sizeof(Lod), sizeof(lod));
+            out.lods[l - 1].error = lod.error;
+            if (!readLevel(lod, out.lods[l - 1].indices)) return false;
+        }
+
+        out.clusters.resize(header.clusterCount);
+        for (std::uint32_t c = 0; c < header.clusterCount; ++c) {
+            Cluster cluster;
+            std::memcpy(&cluster, data + header.clustersOffset + c * sizeof(Cluster), sizeof(cluster));
+            if (cluster.firstIndex > out.indices.size() || cluster.indexCount > out.indices.size() - cluster.firstIndex)
+                return false;
+            MeshCluster& to = out.clusters[c];
+            to.center = glm::vec3(cluster.center[0], cluster.center[1], cluster.center[2]);
+            to.radius = cluster.radius;
+            to.coneAxis = glm::vec3(cluster.coneAxis[0], cluster.coneAxis[1], cluster.coneAxis[2]);
+            to.coneCutoff = cluster.coneCutoff;
+            to.firstIndex = cluster.firstIndex;
+            to.indexCount = cluster.indexCount;
+        }
+        return true;
+    }
+
+    std::string cachePathFor(const std::string& sourcePath, std::uint32_t importFlags)
+    {
+        static const QString dir = [] {
+            const QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/meshes";
+            QDir().mkpath(path);
+            return path;
+        }();
+
+        const QString absolute = QFileInfo(QString::fromStdString(sourcePath)).absoluteFilePath();
+        std::uint64_t h = 1469598103934665603ull;
+        for (const char c : absolute.toUtf8()) { h ^= static_cast<unsigned char>(c); h *= 1099511628211ull; }
+        return QString("%1/%2-%3.kmesh").arg(dir).arg(h, 16, 16, QChar('0')).arg(importFlags).toStdString();
+    }
+
+    void load(const std::string& sourcePath, std::uint32_t importFlags, MeshData& out)
+    {
+        KR_ZONE("load mesh");
+        const SourceStamp stamp = stampOf(sourcePath);
+        const QString cachePath = QString::fromStdString(cachePathFor(sourcePath, importFlags));
+
+        // --- Current preprocessed copy: map it and expand in place ---
+        // Without the source (a project moved to another machine with its
+        // meshes embedded in the .krobot) the copy is all there is.
+        QFile cached(cachePath);
+        if (cached.open(QIODevice::ReadOnly) && cached.size() >= qint64(kHeaderSizeV1)) {
+            const qint64 size = cached.size();
+            if (const unsigned char* map = cached.map(0, size)) {
+                FileHeader header;
+                // An older version is rebuilt when the source is there to rebuild it from.
+                const bool current = readHeader(map, std::size_t(size), header) && header.importFlags == importFlags &&
+                    (stamp.bytes < 0 || (header.version == kVersion &&
+                        header.sourceBytes == stamp.bytes && header.sourceModifiedMs == stamp.modifiedMs));
+                const bool ok = current && decode(map, std::size_t(size), out);
+                cached.unmap(const_cast<unsigned char*>(map));
+                if (ok) return;
+            }
+        }
+        cached.close();
+
+        // --- Import with Assimp, then write the copy for next time ---
+        MeshData imported;
+        loadMeshFile(sourcePath, imported, (importFlags & MeshCache::RecalcNormals) != 0);
+        if (importFlags & MeshCache::Optimize) MeshOptimize::optimize(imported);
+        if (importFlags & MeshCache::GenerateLods) MeshOptimize::generateLods(imported);
+        const std::vector<unsigned char> bytes = encode(imported, stamp, importFlags);
+
+        QSaveFile file(cachePath);
+        if (!file.open(QIODevice::WriteOnly) ||
+            file.write(reinterpret_cast<const char*>(bytes.data()), qint64(bytes.size())) != qint64(bytes.size()) ||
+            !file.commit())
+            qWarning() << "[MeshBinary] Could not write" << cachePath;
+
+        // Return the quantized mesh, so this load and later cached ones agree.
+        if (!decode(bytes.data(), bytes.size(), out)) out = std::move(imported);
+    }
+
+    bool install(const std::string& sourcePath, const unsigned char* data, std::size_t size)
+    {
+        FileHeader blob;
+        if (!readHeader(data, size, blob)) return false;
+
+        // A source edited since the blob was made wins; load() re-imports it.
+        const SourceStamp stamp = stampOf(sourcePath);
+        if (stamp.bytes >= 0 && (blob.sourceBytes != stamp.bytes || blob.sourceModifiedMs != stamp.modifiedMs))
+            return false;
+
+        const QString cachePath = QString::fromStdString(cachePathFor(sourcePath, blob.importFlags));
+        QFile existing(cachePath);
+        if (existing.open(QIODevice::ReadOnly)) {
+            const QByteArray head = existing.read(sizeof(FileHeader));
+            FileHeader header;
+            if (readHeader(reinterpret_cast<const unsigned char*>(head.constData()), std::size_t(head.size()), header) &&
+                header.version >= blob.version &&
+                header.sourceBytes == blob.sourceBytes && header.sourceModifiedMs == blob.sourceModifiedMs)
+                return true;   // already there
+            existing.close();
+        }
+
+        QSaveFile file(cachePath);
+        if (!file.open(QIODevice::WriteOnly) ||
+            file.write(reinterpret_cast<const char*>(data), qint64(size)) != qint64(size) ||
+            !file.commit()) {
+            qWarning() << "[MeshBinary] Could not write" << cachePath;
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<unsigned char> encodeHulls(const ConvexHullSet& hulls, std::uint64_t contentHash, std::uint64_t paramsKey)
+    {
+        HullHeader header;
+        header.hullCount = std::uint32_t(hulls.hullCount());
+        header.pointCount = std::uint32_t(hulls.points.size());
+        header.contentHash = contentHash;
+        header.paramsKey = paramsKey;
+        const std::uint64_t offsetsOffset = align8(sizeof(HullHeader));
+        const std::uint64_t pointsOffset = align8(offsetsOffset + (std::uint64_t(header.hullCount) + 1) * 4);
+
+        std::vector<unsigned char> bytes(std::size_t(pointsOffset + std::uint64_t(header.pointCount) * 12), 0);
+        put(bytes, 0, header);
+        for (std::uint32_t i = 0; i <= header.hullCount; ++i)
+            put(bytes, offsetsOffset + i * 4, hulls.offsets.empty() ? std::uint32_t(0) : hulls.offsets[i]);
+        for (std::uint32_t i = 0; i < header.pointCount; ++i) {
+            const float xyz[3] = { hulls.points[i].x, hulls.points[i].y, hulls.points[i].z };
+            put(bytes, pointsOffset + std::uint64_t(i) * 12, xyz);
+        }
+        return bytes;
+    }
+
+    bool decodeHulls(const unsigned char* data, std::size_t size, std::uint64_t contentHash, std::uint64_t paramsKey,
+        ConvexHullSet& out)
+    {
+        HullHeader header;
+        if (size < sizeof(header)) return false;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic != kHullMagic || header.version != kHullVersion
+            || header.contentHash != contentHash || header.paramsKey != paramsKey) return false;
+        const std::uint64_t offsetsOffset = align8(sizeof(HullHeader));
+        const std::uint64_t pointsOffset = align8(offsetsOffset + (std::uint64_t(header.hullCount) + 1) * 4);
+        if (pointsOffset + std::uint64_t(header.pointCount) * 12 > size) return false;
+
+        out.offsets.resize(std::size_t(header.hullCount) + 1);
+        std::memcpy(out.offsets.data(), data + offsetsOffset, out.offsets.size() * 4);
+        if (out.offsets.front() != 0 || out.offsets.back() != header.pointCount
+            || !std::is_sorted(out.offsets.begin(), out.offsets.end())) return false;
+        out.points.resize(header.pointCount);
+        for (std::uint32_t i = 0; i < header.pointCount; ++i) {
+            float xyz[3];
+            std::memcpy(xyz, data + pointsOffset + std::uint64_t(i) * 12, sizeof(xyz));
+            out.points[i] = glm::vec3(xyz[0], xyz[1], xyz[2]);
+        }
+        return true;
+    }
+
+    namespace
+    {
+        QString hullCachePath(std::uint64_t contentHash, std::uint64_t paramsKey)
+        {
+            static const QString dir = [] {
+                const QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/hulls";
+                QDir().mkpath(path);
+                return path;
+            }();
+            return QString("%1/%2-%3.khull").arg(dir).arg(contentHash, 16, 16, QChar('0')).arg(paramsKey, 16, 16, QChar('0'));
+        }
+    }
+
+    bool loadHulls(std::uint64_t contentHash, std::uint64_t paramsKey, ConvexHullSet& out)
+    {
+        QFile file(hullCachePath(contentHash, paramsKey));
+        if (!file.open(QIODevice::ReadOnly)) return false;
+        const QByteArray bytes = file.readAll();
+        return decodeHulls(reinterpret_cast<const unsigned char*>(bytes.constData()), std::size_t(bytes.size()),
+            contentHash, paramsKey, out);
+    }
+
+    void storeHulls(std::uint64_t contentHash, std::uint64_t paramsKey, const ConvexHullSet& hulls)
+    {
+        const std::vector<unsigned char> bytes = encodeHulls(hulls, contentHash, paramsKey);
+        const QString path = hullCachePath(contentHash, paramsKey);
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) ||
+            file.write(reinterpret_cast<const char*>(bytes.data()), qint64(bytes.size())) != qint64(bytes.size()) ||
+            !file.commit())
+            qWarning() << "[MeshBinary] Could not write" << path;
+    }
+}
@@ -0,0 +1,303 @@
+#include "MeshBvh.hpp"
+#include "components.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+constexpr int kSahBins = 12;
+
+struct BuildState {
+    const std::vector<glm::vec3>& mins;
+    const std::vector<glm::vec3>& maxs;
+    std::vector<glm::vec3> centroids;
+    std::vector<BoundsBvh::Node>& nodes;
+    std::vector<std::uint32_t>& prims;
+    std::uint32_t depth = 0;   ///< deepest level reached
+};
+
+float halfArea(const glm::vec3& mn, const glm::vec3& mx)
+{
+    const glm::vec3 e = glm::max(mx - mn, glm::vec3(0.0f));
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+void fitNode(BuildState& s, BoundsBvh::Node& node, std::uint32_t first, std::uint32_t count)
+{
+    node.min = glm::vec3(std::numeric_limits<float>::max());
+    node.max = glm::vec3(-std::numeric_limits<float>::max());
+    for (std::uint32_t i = first; i < first + count; ++i) {
+        node.min = glm::min(node.min, s.mins[s.prims[i]]);
+        node.max = glm::max(node.max, s.maxs[s.prims[i]]);
+    }
+}
+
+void subdivide(BuildState& s, std::uint32_t nodeIndex, std::uint32_t first, std::uint32_t count, std::uint32_t level)
+{
+    s.depth = std::max(s.depth, level);
+    fitNode(s, s.nodes[nodeIndex], first, count);
+    s.nodes[nodeIndex].leftOrFirst = first;
+    s.nodes[nodeIndex].count = count;
+    if (count <= BoundsBvh::kLeafSize) return;
+
+    glm::vec3 cMin(std::numeric_limits<float>::max()), cMax(-std::numeric_limits<float>::max());
+    for (std::uint32_t i = first; i < first + count; ++i) {
+        cMin = glm::min(cMin, s.centroids[s.prims[i]]);
+        cMax = glm::max(cMax, s.centroids[s.prims[i]]);
+    }
+
+    // Binned SAH: pick the axis/bin boundary with the cheapest child areas.
+    int bestAxis = -1, bestSplit = 0;
+    float bestCost = halfArea(s.nodes[nodeIndex].min, s.nodes[nodeIndex].max) * float(count);
+    for (int axis = 0; axis < 3; ++axis) {
+        const float extent = cMax[axis] - cMin[axis];
+        if (extent <= 0.0f) continue;
+        const float scale = float(kSahBins) / extent;
+
+        struct Bin { glm::vec3 mn{ std::numeric_limits<float>::max() }, mx{ -std::numeric_limits<float>::max() }; std::uint32_t n = 0; };
+        Bin bins[kSahBins];
+        for (std::uint32_t i = first; i < first + count; ++i) {
+            const std::uint32_t p = s.prims[i];
+            const int b = std::min(kSahBins - 1, int((s.centroids[p][axis] - cMin[axis]) * scale));
+            bins[b].mn = glm::min(bins[b].mn, s.mins[p]);
+            bins[b].mx = glm::max(bins[b].mx, s.maxs[p]);
+            ++bins[b].n;
+        }
+
+        float leftArea[kSahBins - 1];
+        std::uint32_t leftCount[kSahBins - 1];
+        Bin acc;
+        for (int b = 0; b < kSahBins - 1; ++b) {
+            acc.mn = glm::min(acc.mn, bins[b].mn); acc.mx = glm::max(acc.mx, bins[b].mx); acc.n += bins[b].n;
+            leftArea[b] = acc.n ? halfArea(acc.mn, acc.mx) : 0.0f;
+            leftCount[b] = acc.n;
+        }
+        acc = Bin{};
+        for (int b = kSahBins - 1; b > 0; --b) {
+            acc.mn = glm::min(acc.mn, bins[b].mn); acc.mx = glm::max(acc.mx, bins[b].mx); acc.n += bins[b].n;
+            const float cost = leftArea[b - 1] * float(leftCount[b - 1])
+                + (acc.n ? halfArea(acc.mn, acc.mx) : 0.0f) * float(acc.n);
+            if (leftCount[b - 1] > 0 && acc.n > 0 && cost < bestCost) {
+                bestCost = cost; bestAxis = axis; bestSplit = b;
+            }
+        }
+    }
+
+    std::uint32_t* begin = s.prims.data() + first;
+    std::uint32_t* mid;
+    if (bestAxis >= 0) {
+        const float scale = float(kSahBins) / (cMax[bestAxis] - cMin[bestAxis]);
+        mid = std::partition(begin, begin + count, [&](std::uint32_t p) {
+            return std::min(kSahBins - 1, int((s.centroids[p][bestAxis] - cMin[bestAxis]) * scale)) < bestSplit;
+        });
+    }
+    else {
+        // No split beats a leaf by SAH, but keep leaves small for the walk:
+        // fall back to a median split on the widest centroid axis.
+        const glm::vec3 e = cMax - cMin;
+        const int axis = (e.x > e.y && e.x > e.z) ? 0 : (e.y > e.z ? 1 : 2);
+        mid = begin + count / 2;
+        std::nth_element(begin, mid, begin + count,
+            [&](std::uint32_t a, std::uint32_t b) { return s.centroids[a][axis] < s.centroids[b][axis]; });
+    }
+
+    const std::uint32_t leftCount = std::uint32_t(mid - begin);
+    const std::uint32_t left = std::uint32_t(s.nodes.size());
+    s.nodes.emplace_back();
+    s.nodes.emplace_back();
+    s.nodes[nodeIndex].leftOrFirst = left;
+    s.nodes[nodeIndex].count = 0;
+    subdivide(s, left, first, leftCount, level + 1);
+    subdivide(s, left + 1, first + leftCount, count - leftCount, level + 1);
+}
+
+// Möller-Trumbore without normalising 'dir', so t stays in the caller's units.
+bool rayTriangle(const glm::vec3& o, const glm::vec3& dir,
+    const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& t)
+{
+    const glm::vec3 e1 = v1 - v0, e2 = v2 - v0;
+    const glm::vec3 pvec = glm::cross(dir, e2);
+    const float det = glm::dot(e1, pvec);
+    if (std::abs(det) < 1e-12f) return false;
+    const float invDet = 1.0f / det;
+
+    const glm::vec3 tvec = o - v0;
+    const float u = glm::dot(tvec, pvec) * invDet;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    const glm::vec3 qvec = glm::cross(tvec, e1);
+    const float v = glm::dot(dir, qvec) * invDet;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    t = glm::dot(e2, qvec) * invDet;
+    return t > 1e-6f;
+}
+
+glm::vec3 closestOnSegment(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b)
+{
+    const glm::vec3 ab = b - a;
+    const float len2 = glm::dot(ab, ab);
+    const float t = len2 > 0.0f ? glm::clamp(glm::dot(p - a, ab) / len2, 0.0f, 1.0f) : 0.0f;
+    return a + t * ab;
+}
+
+// Ericson, Real-Time Collision Detection 5.1.5: Voronoi regions of the
+// triangle, no square roots.
+glm::vec3 closestOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    const glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+    const glm::vec3 bp = p - b;
+    const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) return b;
+
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + (d1 / (d1 - d3)) * ab;
+
+    const glm::vec3 cp = p - c;
+    const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) return c;
+
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + (d2 / (d2 - d6)) * ac;
+
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        return b + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (c - b);
+
+    const float denom = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
+}
+
+void BoundsBvh::build(const std::vector<glm::vec3>& mins, const std::vector<glm::vec3>& maxs)
+{
+    m_nodes.clear();
+    m_depth = 0;
+    m_prims.resize(mins.size());
+    for (std::uint32_t i = 0; i < m_prims.size(); ++i) m_prims[i] = i;
+    if (mins.empty()) return;
+
+    BuildState s{ mins, maxs, {}, m_nodes, m_prims };
+    s.centroids.resize(mins.size());
+    for (std::size_t i = 0; i < mins.size(); ++i) s.centroids[i] = 0.5f * (mins[i] + maxs[i]);
+
+    m_nodes.reserve(2 * (mins.size() / kLeafSize + 1));
+    m_nodes.emplace_back();
+    subdivide(s, 0, 0, std::uint32_t(mins.size()), 0);
+    m_depth = s.depth;
+}
+
+std::shared_ptr<const MeshBvh> MeshBvh::build(const RenderableMeshComponent& mesh)
+{
+    auto bvh = std::make_shared<MeshBvh>();
+
+    const std::size_t triCount = mesh.indices().size() / 3;
+    std::vector<glm::vec3> mins(triCount), maxs(triCount);
+    for (std::size_t t = 0; t < triCount; ++t) {
+        const glm::vec3& a = mesh.vertices()[mesh.indices()[3 * t]].position;
+        const glm::vec3& b = mesh.vertices()[mesh.indices()[3 * t + 1]].position;
+        const glm::vec3& c = mesh.vertices()[mesh.indices()[3 * t + 2]].position;
+        mins[t] = glm::min(a, glm::min(b, c));
+        maxs[t] = glm::max(a, glm::max(b, c));
+    }
+    bvh->m_tree.build(mins, maxs);
+
+    // Copy the corners in leaf order for a cache-friendly walk.
+    const auto& order = bvh->m_tree.primitives();
+    bvh->m_corners.resize(triCount * 3);
+    for (std::size_t slot = 0; slot < triCount; ++slot) {
+        const std::size_t t = order[slot];
+        for (int k = 0; k < 3; ++k)
+            bvh->m_corners[slot * 3 + k] = mesh.vertices()[mesh.indices()[3 * t + k]].position;
+    }
+    return bvh;
+}
+
+bool MeshBvh::raycast(const glm::vec3& origin, const glm::vec3& dir, float& tHit) const
+{
+    bool found = false;
+    m_tree.raycast(origin, dir, tHit, [&](std::uint32_t slot, float& tMax) {
+        float t;
+        if (rayTriangle(origin, dir, m_corners[slot * 3], m_corners[slot * 3 + 1], m_corners[slot * 3 + 2], t) && t < tMax) {
+            tMax = t;
+            found = true;
+        }
+    });
+    return found;
+}
+
+void MeshBvh::slice(const glm::vec4& plane, std::vector<glm::vec3>& segmentPoints) const
+{
+    const glm::vec3 n(plane);
+
+    auto straddles = [&](const glm::vec3& mn, const glm::vec3& mx) {
+        // Signed distance range of the box: centre +- projected half extent.
+        const glm::vec3 c = 0.5f * (mn + mx), e = 0.5f * (mx - mn);
+        const float d = glm::dot(n, c) + plane.w;
+        const float r = glm::dot(e, glm::abs(n));
+        return d - r <= 0.0f && d + r >= 0.0f;
+    };
+
+    m_tree.query(straddles, [&](std::uint32_t slot) {
+        const glm::vec3* v = &m_corners[slot * 3];
+        float d[3];
+        for (int k = 0; k < 3; ++k) d[k] = glm::dot(n, v[k]) + plane.w;
+
+        // Vertices exactly on the plane count as positive, so a shared edge
+        // lying in the plane is not emitted by both neighbours.
+        glm::vec3 hits[2];
+        int count = 0;
+        for (int k = 0; k < 3 && count < 2; ++k) {
+            const int j = (k + 1) % 3;
+            if ((d[k] < 0.0f) != (d[j] < 0.0f)) {
+                // Interpolate in a canonical vertex order so both triangles
+                // sharing the edge produce the bit-identical point.
+                int a = k, b = j;
+                if (std::lexicographical_compare(&v[b].x, &v[b].x + 3, &v[a].x, &v[a].x + 3)) std::swap(a, b);
+                const float t = d[a] / (d[a] - d[b]);
+                hits[count++] = v[a] + t * (v[b] - v[a]);
+            }
+        }
+        if (count == 2) {
+            segmentPoints.push_back(hits[0]);
+            segmentPoints.push_back(hits[1]);
+        }
+    });
+}
+
+MeshBvh::Snap MeshBvh::snap(const glm::vec3& p, float radius) const
+{
+    Snap best[4];   // by Feature; the best of each rank seen so far
+    for (Snap& s : best) s.distance = radius;
+    float reach = radius;
+
+    auto touches = [&](const glm::vec3& mn, const glm::vec3& mx) {
+        const glm::vec3 d = p - glm::clamp(p, mn, mx);
+        return glm::dot(d, d) <= reach * reach;
+    };
+    auto offer = [&](Feature kind, const glm::vec3& q) {
+        const float d = glm::length(q - p);
+        Snap& s = best[int(kind)];
+        if (d > s.distance || (s.kind != Feature::None && d == s.distance)) return;
+        s = { kind, q, d };
+        if (kind == Feature::Vertex) reach = d;   // nothing else can outrank it now
+    };
+
+    m_tree.query(touches, [&](std::uint32_t slot) {
+        const glm::vec3* v = &m_corners[slot * 3];
+        const glm::vec3 onFace = closestOnTriangle(p, v[0], v[1], v[2]);
+        if (glm::length(onFace - p) > reach) return;   // so are its edges and corners
+        offer(Feature::Face, onFace);
+        for (int k = 0; k < 3; ++k) {
+            offer(Feature::Vertex, v[k]);
+            offer(Feature::Edge, closestOnSegment(p, v[k], v[(k + 1) % 3]));
+        }
+    });
+
+    for (Feature kind : { Feature::Vertex, Feature::Edge, Feature::Face })
+        if (best[int(kind)].kind != Feature::None) return best[int(kind)];
+    return {};
+}
@@ -0,0 +1,188 @@
+#include "MeshCache.hpp"
+#include "MeshBinary.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+    constexpr std::size_t kPruneInterval = 128;   // inserts between sweeps of expired entries
+
+    bool sameContent(const MeshData& a, const MeshData& b)
+    {
+        // 'a' must have at least b's levels and clusters, so a file mesh
+        // never collapses onto a code-built twin without them.
+        return a.vertices.size() == b.vertices.size() && a.indices == b.indices &&
+            a.lods.size() >= b.lods.size() && a.clusters.size() >= b.clusters.size() &&
+            std::memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(Vertex)) == 0;
+    }
+}
+
+MeshCache& MeshCache::shared()
+{
+    static MeshCache cache;
+    return cache;
+}
+
+std::size_t MeshCache::hashContent(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices)
+{
+    std::uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](const void* data, std::size_t bytes) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < bytes; ++i) { h ^= p[i]; h *= 1099511628211ull; }
+        };
+    const std::uint64_t counts[2] = { vertices.size(), indices.size() };
+    mix(counts, sizeof(counts));
+    mix(vertices.data(), vertices.size() * sizeof(Vertex));
+    mix(indices.data(), indices.size() * sizeof(unsigned));
+    return h == 0 ? 1 : static_cast<std::size_t>(h); // 0 is reserved for "not hashed yet"
+}
+
+MeshCache::Handle MeshCache::load(const std::string& path, unsigned flags)
+{
+    const std::string key = path + '|' + std::to_string(flags);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_byFile.find(key);
+        if (it != m_byFile.end())
+            if (Handle existing = it->second.lock()) {
+                ++m_stats.fileHits;
+                return existing;
+            }
+    }
+
+    // Decoded unlocked so different files load in parallel. Two threads
+    // racing on one file both decode it; the content check below merges them.
+    MeshData data;
+    MeshBinary::load(path, flags, data);
+    Handle handle = adopt(std::move(data));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.fileLoads;
+    m_byFile[key] = handle;
+    return handle;
+}
+
+std::shared_future<MeshCache::Handle> MeshCache::loadAsync(const std::string& path, unsigned flags)
+{
+    auto promise = std::make_shared<std::promise<Handle>>();
+    std::shared_future<Handle> future = promise->get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_byFile.find(path + '|' + std::to_string(flags));
+        if (it != m_byFile.end())
+            if (Handle existing = it->second.lock()) {
+                ++m_stats.fileHits;
+                promise->set_value(std::move(existing));
+                return future;
+            }
+    }
+    ThreadPool::shared().submit([this, path, flags, promise] {
+        try {
+            promise->set_value(load(path, flags));
+        }
+        catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return future;
+}
+
+MeshCache::Handle MeshCache::intern(std::vector<Vertex> vertices, std::vector<unsigned> indices)
+{
+    MeshData data;
+    data.vertices = std::move(vertices);
+    data.indices = std::move(indices);
+    return adopt(std::move(data));
+}
+
+MeshCache::Handle MeshCache::adopt(MeshData&& data)
+{
+    data.contentHash = hashContent(data.vertices, data.indices);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_contentDedup) {
+        const auto [first, last] = m_byContent.equal_range(data.contentHash);
+        for (auto it = first; it != last; ++it)
+            if (Handle existing = it->second.lock())
+                if (sameContent(*existing, data)) {
+                    ++m_stats.contentHits;
+                    return existing;
+                }
+    }
+
+    Handle handle = std::make_shared<MeshData>(std::move(data));
+    m_byContent.emplace(handle->contentHash, handle);
+    if (++m_insertsSincePrune >= kPruneInterval) pruneLocked();
+    return handle;
+}
+
+MeshCache::Handle MeshCache::findContent(std::size_t contentHash, std::size_t vertexCount, std::size_t indexCount) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto [first, last] = m_byContent.equal_range(contentHash);
+    for (auto it = first; it != last; ++it)
+        if (Handle existing = it->second.lock())
+            if (existing->vertices.size() == vertexCount && existing->indices.size() == indexCount) return existing;
+    return nullptr;
+}
+
+void MeshCache::pruneLocked()
+{
+    m_insertsSincePrune = 0;
+    for (auto it = m_byFile.begin(); it != m_byFile.end();)
+        it = it->second.expired() ? m_byFile.erase(it) : std::next(it);
+    for (auto it = m_byContent.begin(); it != m_byContent.end();)
+        it = it->second.expired() ? m_byContent.erase(it) : std::next(it);
+    for (auto it = m_hulls.begin(); it != m_hulls.end();)
+        it = it->second.expired() ? m_hulls.erase(it) : std::next(it);
+}
+
+std::shared_ptr<const ConvexHullSet> MeshCache::decomposition(const Handle& mesh, const ConvexDecomposition::Params& params)
+{
+    if (!mesh || mesh->vertices.empty()) return nullptr;
+    const std::uint64_t contentHash = mesh->contentHash ? mesh->contentHash : hashContent(mesh->vertices, mesh->indices);
+    const std::uint64_t paramsKey = params.key();
+    const std::uint64_t key = contentHash ^ (paramsKey * 0x9E3779B97F4A7C15ull);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (auto live = m_hulls[key].lock()) return live;
+    }
+
+    // Outside the lock: a decomposition takes a while.
+    auto hulls = std::make_shared<ConvexHullSet>();
+    if (!MeshBinary::loadHulls(contentHash, paramsKey, *hulls)) {
+        std::vector<glm::vec3> positions;
+        positions.reserve(mesh->vertices.size());
+        for (const Vertex& v : mesh->vertices) positions.push_back(v.position);
+        *hulls = ConvexDecomposition::decompose(positions, mesh->indices, params);
+        MeshBinary::storeHulls(contentHash, paramsKey, *hulls);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.hullsComputed;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::weak_ptr<const ConvexHullSet>& slot = m_hulls[key];
+    if (auto raced = slot.lock()) return raced;
+    std::shared_ptr<const ConvexHullSet> shared = std::move(hulls);
+    slot = shared;
+    return shared;
+}
+
+void MeshCache::setContentDedup(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_contentDedup = enabled;
+}
+
+MeshCache::Stats MeshCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats s = m_stats;
+    s.live = 0;
+    for (const auto& [hash, weak] : m_byContent)
+        if (!weak.expired()) ++s.live;
+    return s;
+}
@@ -0,0 +1,604 @@
+#include "MeshOptimize.hpp"
+#include "components.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <unordered_map>
+
+namespace
+{
+    // --- Forsyth scoring ---
+    constexpr int kCacheSize = 32;            // modelled LRU cache
+    constexpr int kMaxValence = 32;           // valence boost is flat past this
+    constexpr float kLastTriScore = 0.75f;
+    constexpr float kCacheDecayPower = 1.5f;
+    constexpr float kValenceBoostScale = 2.0f;
+    constexpr float kValenceBoostPower = 0.5f;
+
+    struct ScoreTables {
+        float cache[kCacheSize];
+        float valence[kMaxValence + 1];
+        ScoreTables()
+        {
+            for (int i = 0; i < kCacheSize; ++i)
+                cache[i] = i < 3 ? kLastTriScore
+                    : std::pow(1.0f - float(i - 3) / float(kCacheSize - 3), kCacheDecayPower);
+            valence[0] = 0.0f;
+            for (int v = 1; v <= kMaxValence; ++v)
+                valence[v] = kValenceBoostScale * std::pow(float(v), -kValenceBoostPower);
+        }
+    };
+
+    float vertexScore(const ScoreTables& t, int cachePosition, unsigned remaining)
+    {
+        if (remaining == 0) return -1.0f;   // nothing left to draw with this vertex
+        const float cache = cachePosition >= 0 ? t.cache[cachePosition] : 0.0f;
+        return cache + t.valence[std::min<unsigned>(remaining, kMaxValence)];
+    }
+
+    // FIFO cache simulation, as on the hardware the overdraw pass reasons about.
+    struct FifoCache {
+        std::vector<std::uint32_t> stamp;     // per vertex: time it entered the cache
+        std::uint32_t time;
+        unsigned size;
+
+        FifoCache(std::size_t vertexCount, unsigned cacheSize) : stamp(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+        void reset() { time += size + 1; }
+        unsigned triangle(const unsigned* tri)
+        {
+            unsigned misses = 0;
+            for (int k = 0; k < 3; ++k)
+                if (time - stamp[tri[k]] > size) { stamp[tri[k]] = time++; ++misses; }
+            return misses;
+        }
+    };
+
+    // --- Quadric error simplification ---
+    constexpr float kBoundaryWeight = 10.0f;          // keeps open borders in place
+    constexpr std::size_t kMinLodTriangles = 32;      // coarser levels stop here
+    constexpr float kMinLodReduction = 0.8f;          // a level must drop at least 20%
+
+    // Sum of squared distances to a set of weighted planes (Garland-Heckbert).
+    struct Quadric {
+        double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+        double weight = 0;
+
+        void addPlane(double a, double b, double c, double d, double w)
+        {
+            a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+            b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+            c2 += w * c * c; cd += w * c * d; d2 += w * d * d;
+            weight += w;
+        }
+        Quadric& operator+=(const Quadric& q)
+        {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2; bc += q.bc;
+            bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2; weight += q.weight;
+            return *this;
+        }
+        double eval(const glm::vec3& p) const
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                + c2 * z * z + 2 * cd * z + d2;
+        }
+    };
+
+    struct Collapse {
+        float cost;
+        unsigned from, to;
+        unsigned fromStamp, toStamp;
+        bool operator>(const Collapse& o) const { return cost > o.cost; }
+    };
+
+    struct PositionKey {
+        std::size_t operator()(const glm::vec3& p) const
+        {
+            std::uint32_t bits[3];
+            std::memcpy(bits, &p, sizeof(bits));
+            return (std::size_t(bits[0]) * 73856093u) ^ (std::size_t(bits[1]) * 19349663u) ^ (std::size_t(bits[2]) * 83492791u);
+        }
+    };
+    struct PositionEqual {
+        bool operator()(const glm::vec3& a, const glm::vec3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+    };
+
+    // --- Clusters ---
+    constexpr float kMinConeDot = 0.1f;   // wider normal cones never face away as a whole
+
+    // Welded, every edge used once in each direction, and enclosing positive
+    // volume: the back of every triangle is hidden by the front of another.
+    bool isClosedOutward(const MeshData& mesh)
+    {
+        const std::vector<unsigned>& indices = mesh.indices;
+        std::unordered_map<glm::vec3, unsigned, PositionKey, PositionEqual> ids;
+        ids.reserve(mesh.vertices.size());
+        std::vector<unsigned> weld(mesh.vertices.size());
+        for (std::size_t v = 0; v < mesh.vertices.size(); ++v)
+            weld[v] = ids.emplace(mesh.vertices[v].position, unsigned(ids.size())).first->second;
+
+        std::unordered_map<std::uint64_t, unsigned> edgeUse;
+        edgeUse.reserve(indices.size());
+        double volume = 0.0;
+        for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+            for (int k = 0; k < 3; ++k) {
+                const unsigned a = weld[indices[t + k]], b = weld[indices[t + (k + 1) % 3]];
+                if (a == b) return false;
+                ++edgeUse[(std::uint64_t(a) << 32) | b];
+            }
+            const glm::dvec3 p0(mesh.vertices[indices[t]].position), p1(mesh.vertices[indices[t + 1]].position),
+                p2(mesh.vertices[indices[t + 2]].position);
+            volume += glm::dot(p0, glm::cross(p1, p2));
+        }
+        for (const auto& [edge, uses] : edgeUse) {
+            const auto reverse = edgeUse.find((edge << 32) | (edge >> 32));
+            if (uses != 1 || reverse == edgeUse.end() || reverse->second != 1) return false;
+        }
+        return volume > 0.0;
+    }
+
+    MeshCluster clusterOf(const MeshData& mesh, std::size_t begin, std::size_t end, bool cones)
+    {
+        MeshCluster cluster;
+        cluster.firstIndex = std::uint32_t(begin);
+        cluster.indexCount = std::uint32_t(end - begin);
+
+        glm::vec3 mn(std::numeric_limits<float>::max()), mx(-std::numeric_limits<float>::max());
+        for (std::size_t i = begin; i < end; ++i) {
+            mn = glm::min(mn, mesh.vertices[mesh.indices[i]].position);
+            mx = glm::max(mx, mesh.vertices[mesh.indices[i]].position);
+        }
+        cluster.center = (mn + mx) * 0.5f;
+        for (std::size_t i = begin; i < end; ++i)
+            cluster.radius = std::max(cluster.radius, glm::length(mesh.vertices[mesh.indices[i]].position - cluster.center));
+        if (!cones) return cluster;
+
+        auto faceNormal = [&](std::size_t t) {
+            const glm::vec3& p0 = mesh.vertices[mesh.indices[t]].position;
+            const glm::vec3 n = glm::cross(mesh.vertices[mesh.indices[t + 1]].position - p0,
+                mesh.vertices[mesh.indices[t + 2]].position - p0);
+            const float len = glm::length(n);
+            return len > 0.0f ? n / len : glm::vec3(0.0f);
+        };
+        glm::vec3 sum(0.0f);
+        for (std::size_t t = begin; t < end; t += 3) sum += faceNormal(t);
+        if (glm::length(sum) <= 0.0f) return cluster;
+        const glm::vec3 axis = glm::normalize(sum);
+        float minDot = 1.0f;
+        for (std::size_t t = begin; t < end; t += 3) {
+            const glm::vec3 n = faceNormal(t);
+            if (n != glm::vec3(0.0f)) minDot = std::min(minDot, glm::dot(n, axis));
+        }
+        if (minDot <= kMinConeDot) return cluster;
+
+        // The normal cone widened by 90 degrees each side: the directions
+        // from which every triangle shows its back (meshoptimizer's bounds).
+        cluster.coneAxis = axis;
+        cluster.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        return cluster;
+    }
+}
+
+namespace MeshOptimize
+{
+    void optimizeVertexCache(std::vector<unsigned>& indices, std::size_t vertexCount)
+    {
+        const std::size_t triCount = indices.size() / 3;
+        if (triCount < 2 || vertexCount == 0) return;
+        static const ScoreTables tables;
+
+        // Triangles around each vertex (CSR); live[v] shrinks as they are emitted.
+        std::vector<unsigned> live(vertexCount, 0);
+        for (std::size_t i = 0; i < triCount * 3; ++i) ++live[indices[i]];
+        std::vector<std::size_t> first(vertexCount + 1, 0);
+        for (std::size_t v = 0; v < vertexCount; ++v) first[v + 1] = first[v] + live[v];
+        std::vector<unsigned> adjacency(first[vertexCount]);
+        {
+            std::vector<std::size_t> fill(first.begin(), first.end() - 1);
+            for (std::size_t t = 0; t < triCount; ++t)
+                for (int k = 0; k < 3; ++k) adjacency[fill[indices[3 * t + k]]++] = unsigned(t);
+        }
+
+        std::vector<float> vScore(vertexCount), tScore(triCount, 0.0f);
+        std::vector<int> cachePos(vertexCount, -1);
+        for (std::size_t v = 0; v < vertexCount; ++v) vScore[v] = vertexScore(tables, -1, live[v]);
+        for (std::size_t t = 0; t < triCount; ++t)
+            for (int k = 0; k < 3; ++k) tScore[t] += vScore[indices[3 * t + k]];
+
+        std::vector<char> emitted(triCount, 0);
+        std::vector<unsigned> out;
+        out.reserve(triCount * 3);
+
+        unsigned cache[kCacheSize + 3];
+        int cacheCount = 0;
+        std::size_t cursor = 0;   // fallback scan position
+        std::size_t best = std::size_t(std::max_element(tScore.begin(), tScore.end()) - tScore.begin());
+
+        for (std::size_t n = 0; n < triCount; ++n) {
+            const unsigned* tri = &indices[3 * best];
+            emitted[best] = 1;
+            out.insert(out.end(), tri, tri + 3);
+
+            // Emitted triangle leaves its vertices' lists.
+            for (int k = 0; k < 3; ++k) {
+                const unsigned v = tri[k];
+                unsigned* list = &adjacency[first[v]];
+                for (unsigned i = 0; i < live[v]; ++i)
+                    if (list[i] == best) { std::swap(list[i], list[live[v] - 1]); break; }
+                --live[v];
+            }
+
+            // Its vertices move to the front of the LRU cache.
+            unsigned next[kCacheSize + 3];
+            int nextCount = 0;
+            for (int k = 0; k < 3; ++k) next[nextCount++] = tri[k];
+            for (int i = 0; i < cacheCount; ++i) {
+                const unsigned v = cache[i];
+                if (v != tri[0] && v != tri[1] && v != tri[2]) next[nextCount++] = v;
+            }
+
+            // Rescore the cache (entries past kCacheSize fall out) and pick the best candidate.
+            float bestScore = -1.0f;
+            best = triCount;
+            for (int i = 0; i < nextCount; ++i) {
+                const unsigned v = next[i];
+                cachePos[v] = i < kCacheSize ? i : -1;
+                const float score = vertexScore(tables, cachePos[v], live[v]);
+                const float delta = score - vScore[v];
+                vScore[v] = score;
+                for (unsigned a = 0; a < live[v]; ++a) {
+                    const unsigned t = adjacency[first[v] + a];
+                    tScore[t] += delta;
+                    if (tScore[t] > bestScore) { bestScore = tScore[t]; best = t; }
+                }
+            }
+            cacheCount = std::min(nextCount, kCacheSize);
+            for (int i = 0; i < cacheCount; ++i) cache[i] = next[i];
+
+            if (best == triCount) {
+                // Cache exhausted: continue from the next triangle not drawn yet.
+                while (cursor < triCount && emitted[cursor]) ++cursor;
+                if (cursor == triCount) break;
+                best = cursor;
+            }
+        }
+        std::copy(out.begin(), out.end(), indices.begin());
+    }
+
+    void optimizeOverdraw(std::vector<unsigned>& indices, const std::vector<Vertex>& vertices, float threshold)
+    {
+        const std::size_t triCount = indices.size() / 3;
+        if (triCount < 2) return;
+        constexpr unsigned kFifo = 16;
+
+        // --- Clusters: hard boundaries where the cache starts cold, soft ones
+        // wherever the running miss ratio is already within 'threshold' ---
+        std::vector<std::size_t> hard;
+        {
+            FifoCache fifo(vertices.size(), kFifo);
+            for (std::size_t t = 0; t < triCount; ++t)
+                if (fifo.triangle(&indices[3 * t]) == 3) hard.push_back(t);
+            if (hard.empty() || hard.front() != 0) hard.insert(hard.begin(), 0);
+        }
+        hard.push_back(triCount);
+
+        std::vector<std::size_t> clusters;
+        {
+            FifoCache fifo(vertices.size(), kFifo);
+            for (std::size_t h = 0; h + 1 < hard.size(); ++h) {
+                const std::size_t begin = hard[h], end = hard[h + 1];
+
+                // Miss ratio of the whole hard cluster is the budget for its pieces.
+                fifo.reset();
+                unsigned total = 0;
+                for (std::size_t t = begin; t < end; ++t) total += fifo.triangle(&indices[3 * t]);
+                const float budget = threshold * float(total) / float(end - begin);
+
+                fifo.reset();
+                clusters.push_back(begin);
+                unsigned misses = 0;
+                std::size_t start = begin;
+                for (std::size_t t = begin; t < end; ++t) {
+                    misses += fifo.triangle(&indices[3 * t]);
+                    if (t + 1 < end && float(misses) <= budget * float(t + 1 - start)) {
+                        clusters.push_back(t + 1);
+                        fifo.reset();
+                        misses = 0;
+                        start = t + 1;
+                    }
+                }
+            }
+        }
+        clusters.push_back(triCount);
+        const std::size_t clusterCount = clusters.size() - 1;
+
+        // --- Sort key: how far the cluster faces away from the mesh centre ---
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        std::vector<glm::vec3> centroid(clusterCount, glm::vec3(0.0f)), normal(clusterCount, glm::vec3(0.0f));
+        std::vector<float> area(clusterCount, 0.0f);
+        for (std::size_t c = 0; c < clusterCount; ++c)
+            for (std::size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+                const glm::vec3& a = vertices[indices[3 * t]].position;
+                const glm::vec3& b = vertices[indices[3 * t + 1]].position;
+                const glm::vec3& d = vertices[indices[3 * t + 2]].position;
+                const glm::vec3 n = glm::cross(b - a, d - a);   // length = 2 * area
+                const float triArea = glm::length(n);
+                const glm::vec3 mid = (a + b + d) * (1.0f / 3.0f);
+                centroid[c] += mid * triArea;
+                normal[c] += n;
+                area[c] += triArea;
+                meshCentroid += mid * triArea;
+                meshArea += triArea;
+            }
+        if (meshArea > 0.0f) meshCentroid = meshCentroid / meshArea;
+
+        std::vector<float> key(clusterCount, 0.0f);
+        for (std::size_t c = 0; c < clusterCount; ++c) {
+            const float len = glm::length(normal[c]);
+            if (area[c] <= 0.0f || len <= 0.0f) continue;
+            key[c] = glm::dot(centroid[c] / area[c] - meshCentroid, normal[c] / len);
+        }
+
+        std::vector<std::size_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), std::size_t(0));
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return key[a] > key[b]; });
+
+        std::vector<unsigned> out;
+        out.reserve(indices.size());
+        for (std::size_t c : order)
+            out.insert(out.end(), indices.begin() + 3 * clusters[c], indices.begin() + 3 * clusters[c + 1]);
+        out.insert(out.end(), indices.begin() + 3 * triCount, indices.end());   // stray non-triangle tail
+        indices.swap(out);
+    }
+
+    void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned>& indices)
+    {
+        constexpr unsigned kUnused = ~0u;
+        std::vector<unsigned> remap(vertices.size(), kUnused);
+        std::vector<Vertex> out;
+        out.reserve(vertices.size());
+
+        for (unsigned& index : indices) {
+            if (remap[index] == kUnused) {
+                remap[index] = unsigned(out.size());
+                out.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(out);
+    }
+
+    void optimize(MeshData& mesh)
+    {
+        optimizeVertexCache(mesh.indices, mesh.vertices.size());
+        optimizeOverdraw(mesh.indices, mesh.vertices);
+        optimizeVertexFetch(mesh.vertices, mesh.indices);
+        mesh.contentHash = 0;   // content changed; MeshCache rehashes
+    }
+
+    std::vector<unsigned> simplify(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices,
+        std::size_t targetIndexCount, float* error)
+    {
+        if (error) *error = 0.0f;
+        const std::size_t triCount = indices.size() / 3;
+        if (indices.size() <= targetIndexCount || triCount == 0) return indices;
+
+        // --- Weld by position, so seams of split normals or uvs collapse as one ---
+        std::vector<unsigned> weld(vertices.size());
+        std::vector<glm::vec3> position;
+        {
+            std::unordered_map<glm::vec3, unsigned, PositionKey, PositionEqual> ids;
+            ids.reserve(vertices.size());
+            for (std::size_t v = 0; v < vertices.size(); ++v) {
+                const auto [it, inserted] = ids.emplace(vertices[v].position, unsigned(position.size()));
+                if (inserted) position.push_back(vertices[v].position);
+                weld[v] = it->second;
+            }
+        }
+        const std::size_t pointCount = position.size();
+
+        std::vector<unsigned> tri(triCount * 3);
+        for (std::size_t i = 0; i < tri.size(); ++i) tri[i] = weld[indices[i]];
+        std::vector<char> alive(triCount, 1);
+        std::size_t liveTris = 0;
+        for (std::size_t t = 0; t < triCount; ++t) {
+            const unsigned* c = &tri[3 * t];
+            alive[t] = c[0] != c[1] && c[1] != c[2] && c[0] != c[2];
+            liveTris += alive[t];
+        }
+
+        // --- Quadrics: face planes by area, plus perpendicular planes on border edges ---
+        std::vector<Quadric> quadric(pointCount);
+        std::vector<std::vector<unsigned>> around(pointCount);
+        std::unordered_map<std::uint64_t, unsigned> edgeUse;
+        auto edgeKey = [](unsigned a, unsigned b) { return (std::uint64_t(std::min(a, b)) << 32) | std::max(a, b); };
+        for (std::size_t t = 0; t < triCount; ++t) {
+            if (!alive[t]) continue;
+            const unsigned* c = &tri[3 * t];
+            const glm::vec3 n = glm::cross(position[c[1]] - position[c[0]], position[c[2]] - position[c[0]]);
+            const float len = glm::length(n);
+            for (int k = 0; k < 3; ++k) {
+                around[c[k]].push_back(unsigned(t));
+                ++edgeUse[edgeKey(c[k], c[(k + 1) % 3])];
+            }
+            if (len <= 0.0f) continue;
+            const glm::vec3 u = n / len;
+            const double d = -double(glm::dot(u, position[c[0]]));
+            for (int k = 0; k < 3; ++k) quadric[c[k]].addPlane(u.x, u.y, u.z, d, 0.5 * len);
+        }
+        for (std::size_t t = 0; t < triCount; ++t) {
+            if (!alive[t]) continue;
+            const unsigned* c = &tri[3 * t];
+            const glm::vec3 n = glm::cross(position[c[1]] - position[c[0]], position[c[2]] - position[c[0]]);
+            for (int k = 0; k < 3; ++k) {
+                const unsigned a = c[k], b = c[(k + 1) % 3];
+                if (edgeUse[edgeKey(a, b)] != 1) continue;
+                const glm::vec3 e = position[b] - position[a];
+                const glm::vec3 p = glm::cross(e, n);
+                const float len = glm::length(p);
+                if (len <= 0.0f) continue;
+                const glm::vec3 u = p / len;
+                const double d = -double(glm::dot(u, position[a]));
+                const double w = kBoundaryWeight * double(glm::dot(e, e));
+                quadric[a].addPlane(u.x, u.y, u.z, d, w);
+                quadric[b].addPlane(u.x, u.y, u.z, d, w);
+            }
+        }
+
+        // --- Greedy edge collapses onto an endpoint, cheapest first ---
+        std::vector<unsigned> stamp(pointCount, 0);
+        std::vector<char> dead(pointCount, 0);
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+        auto push = [&](unsigned a, unsigned b) {
+            Quadric q = quadric[a];
+            q += quadric[b];
+            const double toB = q.eval(position[b]), toA = q.eval(position[a]);
+            const bool keepB = toB <= toA;
+            const double cost = std::max(keepB ? toB : toA, 0.0) / std::max(q.weight, 1e-12);
+            heap.push({ float(cost), keepB ? a : b, keepB ? b : a, stamp[keepB ? a : b], stamp[keepB ? b : a] });
+        };
+        for (const auto& [key, uses] : edgeUse) push(unsigned(key >> 32), unsigned(key & 0xFFFFFFFFu));
+
+        const std::size_t targetTris = targetIndexCount / 3;
+        float maxCost = 0.0f;
+        while (liveTris > targetTris && !heap.empty()) {
+            const Collapse top = heap.top();
+            heap.pop();
+            const unsigned from = top.from, to = top.to;
+            if (dead[from] || dead[to] || stamp[from] != top.fromStamp || stamp[to] != top.toStamp) continue;
+
+            // Reject collapses that would turn a surviving triangle over.
+            bool flips = false;
+            for (unsigned t : around[from]) {
+                if (!alive[t]) continue;
+                const unsigned* c = &tri[3 * t];
+                if (c[0] == to || c[1] == to || c[2] == to) continue;
+                glm::vec3 p[3] = { position[c[0]], position[c[1]], position[c[2]] };
+                const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for (int k = 0; k < 3; ++k) if (c[k] == from) p[k] = position[to];
+                if (glm::dot(before, glm::cross(p[1] - p[0], p[2] - p[0])) <= 0.0f) { flips = true; break; }
+            }
+            if (flips) continue;
+
+            maxCost = std::max(maxCost, top.cost);
+            quadric[to] += quadric[from];
+            for (unsigned t : around[from]) {
+                if (!alive[t]) continue;
+                unsigned* c = &tri[3 * t];
+                if (c[0] == to || c[1] == to || c[2] == to) { alive[t] = 0; --liveTris; continue; }
+                for (int k = 0; k < 3; ++k) if (c[k] == from) c[k] = to;
+                around[to].push_back(t);
+            }
+            dead[from] = 1;
+            ++stamp[from];
+            ++stamp[to];
+            std::vector<unsigned>().swap(around[from]);
+
+            auto& list = around[to];
+            list.erase(std::remove_if(list.begin(), list.end(), [&](unsigned t) { return !alive[t]; }), list.end());
+            for (unsigned t : list)
+                for (int k = 0; k < 3; ++k)
+                    if (tri[3 * t + k] != to) push(to, tri[3 * t + k]);
+        }
+        if (error) *error = std::sqrt(maxCost);
+
+        // --- Back to original vertices: per corner, the twin whose normal fits the face ---
+        std::vector<unsigned> twinStart(pointCount + 1, 0), twins(vertices.size());
+        for (unsigned w : weld) ++twinStart[w + 1];
+        for (std::size_t p = 0; p < pointCount; ++p) twinStart[p + 1] += twinStart[p];
+        {
+            std::vector<unsigned> fill(twinStart.begin(), twinStart.end() - 1);
+            for (std::size_t v = 0; v < vertices.size(); ++v) twins[fill[weld[v]]++] = unsigned(v);
+        }
+
+        std::vector<unsigned> out;
+        out.reserve(liveTris * 3);
+        for (std::size_t t = 0; t < triCount; ++t) {
+            if (!alive[t]) continue;
+            const unsigned* c = &tri[3 * t];
+            const glm::vec3 n = glm::cross(position[c[1]] - position[c[0]], position[c[2]] - position[c[0]]);
+            for (int k = 0; k < 3; ++k) {
+                const unsigned first = twinStart[c[k]], last = twinStart[c[k] + 1];
+                unsigned best = twins[first];
+                float bestDot = glm::dot(vertices[best].normal, n);
+                for (unsigned i = first + 1; i < last; ++i) {
+                    const float d = glm::dot(vertices[twins[i]].normal, n);
+                    if (d > bestDot) { bestDot = d; best = twins[i]; }
+                }
+                out.push_back(best);
+            }
+        }
+        return out;
+    }
+
+    void generateLods(MeshData& mesh, std::size_t maxLevels)
+    {
+        mesh.lods.clear();
+        if (maxLevels < 2) return;
+        mesh.lods.reserve(maxLevels - 1);   // 'source' points into it
+
+        const std::vector<unsigned>* source = &mesh.indices;
+        float error = 0.0f;
+        while (mesh.lods.size() + 1 < maxLevels) {
+            const std::size_t target = source->size() / 6 * 3;   // half the triangles
+            if (target < kMinLodTriangles * 3) break;
+
+            float step = 0.0f;
+            std::vector<unsigned> coarser = simplify(mesh.vertices, *source, target, &step);
+            if (float(coarser.size()) > kMinLodReduction * float(source->size())) break;   // borders or flips block it
+
+            optimizeVertexCache(coarser, mesh.vertices.size());
+            error += step;   // deviations add up along the chain
+            mesh.lods.push_back({ std::move(coarser), error });
+            source = &mesh.lods.back().indices;
+        }
+    }
+
+    void buildClusters(MeshData& mesh, std::size_t maxVertices, std::size_t maxTriangles)
+    {
+        mesh.clusters.clear();
+        const std::vector<unsigned>& indices = mesh.indices;
+        const std::size_t triCount = indices.size() / 3;
+        if (triCount < kMinClusteredTriangles) return;
+
+        // Runs of the existing order: after optimize() it is already local,
+        // and cutting it leaves the index buffer (and the levels) untouched.
+        const bool cones = isClosedOutward(mesh);
+        std::vector<unsigned> stamp(mesh.vertices.size(), ~0u);   // cluster that last counted each vertex
+        std::size_t first = 0, vertexCount = 0;
+        for (std::size_t t = 0; t < triCount; ++t) {
+            const unsigned* c = &indices[3 * t];
+            auto fresh = [&] {
+                const unsigned id = unsigned(mesh.clusters.size());
+                return std::size_t(stamp[c[0]] != id)
+                    + std::size_t(stamp[c[1]] != id && c[1] != c[0])
+                    + std::size_t(stamp[c[2]] != id && c[2] != c[0] && c[2] != c[1]);
+            };
+            if (vertexCount + fresh() > maxVertices || 3 * t - first == 3 * maxTriangles) {
+                mesh.clusters.push_back(clusterOf(mesh, first, 3 * t, cones));
+                first = 3 * t;
+                vertexCount = 0;
+            }
+            vertexCount += fresh();
+            for (int k = 0; k < 3; ++k) stamp[c[k]] = unsigned(mesh.clusters.size());
+        }
+        if (first < 3 * triCount) mesh.clusters.push_back(clusterOf(mesh, first, 3 * triCount, cones));
+    }
+
+    float acmr(const std::vector<unsigned>& indices, std::size_t vertexCount, unsigned cacheSize)
+    {
+        const std::size_t triCount = indices.size() / 3;
+        if (triCount == 0) return 0.0f;
+        FifoCache fifo(vertexCount, cacheSize);
+        std::size_t misses = 0;
+        for (std::size_t t = 0; t < triCount; ++t) misses += fifo.triangle(&indices[3 * t]);
+        return float(misses) / float(triCount);
+    }
+}
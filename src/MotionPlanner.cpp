@@ -0,0 +1,507 @@
+#include "MotionPlanner.hpp"
+#include "CollisionWorld.hpp"
+#include "components.hpp"
+
+#include <entt/entt.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <glm/gtc/constants.hpp>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr std::uint32_t kNone = MotionPlanner::ConfigurationIndex::kNone;
+
+    double distance(const double* a, const double* b, std::size_t dofs)
+    {
+        double sum = 0.0;
+        for (std::size_t k = 0; k < dofs; ++k) sum += (b[k] - a[k]) * (b[k] - a[k]);
+        return std::sqrt(sum);
+    }
+
+    // The largest single joint move; paths are played back by it.
+    double segmentLength(const double* a, const double* b, std::size_t dofs)
+    {
+        double length = 0.0;
+        for (std::size_t k = 0; k < dofs; ++k) length = std::max(length, std::abs(b[k] - a[k]));
+        return length;
+    }
+
+    // Appends the configurations after 'a' up to and including 'b', at most
+    // 'resolution' apart. Returns how many.
+    std::size_t appendSegment(const double* a, const double* b, std::size_t dofs, double resolution, std::vector<double>& out)
+    {
+        const std::size_t steps = std::max<std::size_t>(1, std::size_t(std::ceil(distance(a, b, dofs) / resolution)));
+        for (std::size_t i = 1; i <= steps; ++i) {
+            const double t = double(i) / double(steps);
+            for (std::size_t k = 0; k < dofs; ++k) out.push_back(a[k] + (b[k] - a[k]) * t);
+        }
+        return steps;
+    }
+}
+
+// --- ConfigurationIndex ---
+
+std::uint32_t MotionPlanner::ConfigurationIndex::add(const double* q)
+{
+    const std::uint32_t index = std::uint32_t(m_nodes.size());
+    Node node;
+    for (std::uint32_t current = 0; index > 0;) {
+        Node& parent = m_nodes[current];
+        std::uint32_t& child = q[parent.axis] < at(current)[parent.axis] ? parent.left : parent.right;
+        if (child == kNone) {
+            child = index;
+            node.axis = std::uint32_t((parent.axis + 1) % m_dims);
+            break;
+        }
+        current = child;
+    }
+    m_points.insert(m_points.end(), q, q + m_dims);
+    m_nodes.push_back(node);
+    return index;
+}
+
+double MotionPlanner::ConfigurationIndex::distanceSquared(const double* q, std::uint32_t i) const
+{
+    const double* p = at(i);
+    double sum = 0.0;
+    for (std::size_t k = 0; k < m_dims; ++k) sum += (p[k] - q[k]) * (p[k] - q[k]);
+    return sum;
+}
+
+std::uint32_t MotionPlanner::ConfigurationIndex::nearest(const double* q) const
+{
+    std::vector<std::uint32_t> out;
+    nearest(q, 1, out);
+    return out.empty() ? kNone : out.front();
+}
+
+void MotionPlanner::ConfigurationIndex::nearest(const double* q, std::size_t k, std::vector<std::uint32_t>& out,
+    std::uint32_t skip) const
+{
+    out.clear();
+    if (m_nodes.empty() || k == 0) return;
+
+    // Max-heap of the best k so far; the stack holds subtrees with a lower
+    // bound on their squared distance, near sides popped first.
+    std::vector<std::pair<double, std::uint32_t>> best;
+    std::vector<std::pair<std::uint32_t, double>> stack{ { 0u, 0.0 } };
+    while (!stack.empty()) {
+        const auto [node, bound] = stack.back();
+        stack.pop_back();
+        if (best.size() == k && bound >= best.front().first) continue;
+
+        if (node != skip) {
+            const double d = distanceSquared(q, node);
+            if (best.size() < k) {
+                best.emplace_back(d, node);
+                std::push_heap(best.begin(), best.end());
+            }
+            else if (d < best.front().first) {
+                std::pop_heap(best.begin(), best.end());
+                best.back() = { d, node };
+                std::push_heap(best.begin(), best.end());
+            }
+        }
+        const Node& n = m_nodes[node];
+        const double delta = q[n.axis] - at(node)[n.axis];
+        const std::uint32_t nearSide = delta < 0.0 ? n.left : n.right;
+        const std::uint32_t farSide = delta < 0.0 ? n.right : n.left;
+        if (farSide != kNone) stack.emplace_back(farSide, std::max(bound, delta * delta));
+        if (nearSide != kNone) stack.emplace_back(nearSide, bound);
+    }
+    std::sort_heap(best.begin(), best.end());
+    for (const auto& entry : best) out.push_back(entry.second);
+}
+
+// --- Queries ---
+
+struct MotionPlanner::Query {
+    entt::registry& registry;
+    CollisionWorld& collision;
+    entt::entity robot;
+    std::shared_ptr<const KinematicModel> model;
+    std::size_t dofs = 0;
+    KinematicModel::Pose base;
+    std::uint64_t environmentVersion = 0;
+    double resolution = 0.03;
+    Clock::time_point deadline;
+    std::vector<double> lower, range;
+    std::size_t checked = 0;
+
+    std::vector<double> batch;                ///< configurations for the next check()
+    std::vector<std::uint8_t> collides;
+
+    bool expired() const { return Clock::now() >= deadline; }
+
+    // Tests every configuration in 'batch' in one call; returns how many collide.
+    std::size_t check()
+    {
+        const std::size_t count = batch.size() / dofs;
+        collides.resize(count);
+        checked += count;
+        return collision.validateTrajectory(registry, robot, batch.data(), count, collides.data());
+    }
+
+    void sample(std::mt19937_64& random, double* q) const
+    {
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        for (std::size_t d = 0; d < dofs; ++d) q[d] = lower[d] + range[d] * unit(random);
+    }
+};
+
+MotionPlanner::MotionPlanner() : m_random(m_settings.seed) {}
+MotionPlanner::~MotionPlanner() = default;
+
+void MotionPlanner::clear()
+{
+    m_roadmaps.clear();
+}
+
+MotionPlanner::Result MotionPlanner::plan(entt::registry& registry, CollisionWorld& collision, entt::entity robot,
+    const double* start, const double* goal)
+{
+    const Clock::time_point began = Clock::now();
+    Result result;
+    const auto* kin = registry.try_get<KinematicModelComponent>(robot);
+    if (!kin || !kin->model || kin->model->dofCount() == 0) {
+        result.error = "The robot has no moving joints";
+        return result;
+    }
+
+    Query query{ registry, collision, robot, kin->model };
+    const KinematicModel& model = *kin->model;
+    const std::size_t dofs = query.dofs = std::size_t(model.dofCount());
+    if (const auto* xf = registry.try_get<TransformComponent>(robot)) {
+        query.base.translation = xf->translation;
+        query.base.rotation = xf->rotation;
+    }
+    query.environmentVersion = collision.environmentVersion();
+    query.resolution = std::max(m_settings.edgeResolution, 1e-4);
+    query.deadline = began + m_settings.timeLimit;
+    query.lower.resize(dofs);
+    query.range.resize(dofs);
+    for (std::size_t d = 0; d < dofs; ++d) {
+        const int dof = int(d);
+        const bool revolute = model.motionOf(model.dofLink(dof)) == KinematicModel::Motion::Revolute;
+        query.lower[d] = model.isLimited(dof) ? model.lowerLimit(dof) : revolute ? -glm::pi<double>() : -1.0;
+        query.range[d] = model.isLimited(dof) ? model.upperLimit(dof) - model.lowerLimit(dof) : revolute ? 2.0 * glm::pi<double>() : 2.0;
+    }
+
+    auto finish = [&]() {
+        result.checked = query.checked;
+        const auto roadmap = m_roadmaps.find(robot);
+        result.roadmapNodes = roadmap == m_roadmaps.end() ? 0 : roadmap->second.nodes.size();
+        result.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - began).count();
+        return result;
+    };
+
+    // Nothing else is worth trying if either end collides.
+    query.batch.assign(start, start + dofs);
+    query.batch.insert(query.batch.end(), goal, goal + dofs);
+    query.check();
+    if (query.collides[0] || query.collides[1]) {
+        result.error = query.collides[0] ? "The start is in collision" : "The goal is in collision";
+        return finish();
+    }
+
+    std::vector<double> path;
+    for (int attempt = 0; attempt < 2 && !result.success; ++attempt) {
+        Method method = Method::None;
+        path.assign(start, start + dofs);
+        path.insert(path.end(), goal, goal + dofs);
+
+        query.batch.clear();
+        appendSegment(start, goal, dofs, query.resolution, query.batch);
+        if (query.check() == 0) method = Method::Direct;
+
+        if (method == Method::None) {
+            Roadmap& roadmap = m_roadmaps[robot];
+            if (!roadmapValid(roadmap, query)) buildRoadmap(roadmap, query);
+            const std::uint32_t from = addRoadmapNode(roadmap, start);
+            const std::uint32_t to = addRoadmapNode(roadmap, goal);
+
+            std::vector<std::uint32_t> nodes;
+            if (searchRoadmap(roadmap, query, from, to, nodes)) {
+                path.clear();
+                for (std::uint32_t node : nodes) path.insert(path.end(), roadmap.nodes.at(node), roadmap.nodes.at(node) + dofs);
+                method = Method::Roadmap;
+            }
+            else if (rrtConnect(query, path)) {
+                // The solution joins the roadmap, its edges known to be free.
+                std::uint32_t previous = from;
+                for (std::size_t i = dofs; i + dofs < path.size(); i += dofs) {
+                    const std::uint32_t node = addRoadmapNode(roadmap, &path[i]);
+                    setEdgeState(roadmap, previous, node, EdgeState::Free);
+                    previous = node;
+                }
+                setEdgeState(roadmap, previous, to, EdgeState::Free);
+                method = Method::RrtConnect;
+            }
+        }
+        if (method == Method::None) break;
+        shortcut(query, path);
+
+        // End to end once more: other robots are not part of the roadmap's
+        // key, and may block edges it still remembers as free.
+        query.batch.clear();
+        for (std::size_t i = dofs; i < path.size(); i += dofs)
+            appendSegment(&path[i - dofs], &path[i], dofs, query.resolution, query.batch);
+        if (query.check() == 0) {
+            result.success = true;
+            result.method = method;
+        }
+        else if (auto it = m_roadmaps.find(robot); it != m_roadmaps.end()) {
+            for (auto& edges : it->second.edges)
+                for (Edge& edge : edges) edge.state = EdgeState::Unknown;
+        }
+    }
+
+    if (result.success) {
+        result.path = std::move(path);
+        result.waypoints = result.path.size() / dofs;
+    }
+    else {
+        result.error = query.expired() ? "No path found within the time limit" : "No collision-free path found";
+    }
+    return finish();
+}
+
+// --- Roadmap ---
+
+bool MotionPlanner::roadmapValid(const Roadmap& roadmap, const Query& query) const
+{
+    return roadmap.model == query.model
+        && roadmap.environmentVersion == query.environmentVersion
+        && roadmap.base.translation == query.base.translation
+        && roadmap.base.rotation == query.base.rotation;
+}
+
+void MotionPlanner::buildRoadmap(Roadmap& roadmap, Query& query)
+{
+    roadmap = Roadmap{};
+    roadmap.model = query.model;
+    roadmap.environmentVersion = query.environmentVersion;
+    roadmap.base = query.base;
+    roadmap.nodes = ConfigurationIndex(query.dofs);
+
+    // The samples are checked in one batch; their edges only when a path uses them.
+    const std::size_t count = std::size_t(std::max(m_settings.roadmapNodes, 0));
+    query.batch.resize(count * query.dofs);
+    for (std::size_t i = 0; i < count; ++i) query.sample(m_random, &query.batch[i * query.dofs]);
+    query.check();
+    for (std::size_t i = 0; i < count; ++i)
+        if (!query.collides[i]) addRoadmapNode(roadmap, &query.batch[i * query.dofs]);
+}
+
+std::uint32_t MotionPlanner::addRoadmapNode(Roadmap& roadmap, const double* q)
+{
+    const std::uint32_t node = roadmap.nodes.add(q);
+    roadmap.edges.emplace_back();
+
+    std::vector<std::uint32_t> near;
+    roadmap.nodes.nearest(q, std::size_t(std::max(m_settings.neighbours, 1)), near, node);
+    for (std::uint32_t other : near) setEdgeState(roadmap, node, other, EdgeState::Unknown);
+    return node;
+}
+
+void MotionPlanner::setEdgeState(Roadmap& roadmap, std::uint32_t a, std::uint32_t b, EdgeState state)
+{
+    if (a == b) return;
+    auto set = [&](std::uint32_t from, std::uint32_t to) {
+        for (Edge& edge : roadmap.edges[from]) {
+            if (edge.to != to) continue;
+            edge.state = state;
+            return;
+        }
+        const float length = float(distance(roadmap.nodes.at(from), roadmap.nodes.at(to), roadmap.nodes.dims()));
+        roadmap.edges[from].push_back({ to, length, state });
+    };
+    set(a, b);
+    set(b, a);
+}
+
+bool MotionPlanner::searchRoadmap(Roadmap& roadmap, Query& query, std::uint32_t start, std::uint32_t goal,
+    std::vector<std::uint32_t>& nodes)
+{
+    const std::size_t count = roadmap.nodes.size();
+    const std::size_t dofs = query.dofs;
+    const double* target = roadmap.nodes.at(goal);
+    std::vector<float> cost(count);
+    std::vector<std::uint32_t> previous(count);
+    std::vector<std::uint8_t> closed(count);
+    using Entry = std::pair<float, std::uint32_t>;
+
+    struct Span { std::uint32_t a, b; std::size_t first, count; };
+    std::vector<Span> spans;
+
+    while (!query.expired()) {
+        // A* over every edge not known to be blocked.
+        std::fill(cost.begin(), cost.end(), std::numeric_limits<float>::infinity());
+        std::fill(previous.begin(), previous.end(), kNone);
+        std::fill(closed.begin(), closed.end(), std::uint8_t(0));
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+        cost[start] = 0.0f;
+        open.emplace(float(distance(roadmap.nodes.at(start), target, dofs)), start);
+        bool found = false;
+        while (!open.empty()) {
+            const std::uint32_t node = open.top().second;
+            open.pop();
+            if (node == goal) {
+                found = true;
+                break;
+            }
+            if (closed[node]) continue;
+            closed[node] = 1;
+            for (const Edge& edge : roadmap.edges[node]) {
+                if (edge.state == EdgeState::Blocked) continue;
+                const float g = cost[node] + edge.length;
+                if (g >= cost[edge.to]) continue;
+                cost[edge.to] = g;
+                previous[edge.to] = node;
+                open.emplace(g + float(distance(roadmap.nodes.at(edge.to), target, dofs)), edge.to);
+            }
+        }
+        if (!found) return false;
+
+        nodes.clear();
+        for (std::uint32_t node = goal; node != kNone; node = previous[node]) nodes.push_back(node);
+        std::reverse(nodes.begin(), nodes.end());
+
+        // The path's unchecked edges, all in one batch.
+        query.batch.clear();
+        spans.clear();
+        for (std::size_t i = 1; i < nodes.size(); ++i) {
+            const auto& edges = roadmap.edges[nodes[i - 1]];
+            const auto edge = std::find_if(edges.begin(), edges.end(), [&](const Edge& e) { return e.to == nodes[i]; });
+            if (edge->state != EdgeState::Unknown) continue;
+            const std::size_t first = query.batch.size() / dofs;
+            const std::size_t steps = appendSegment(roadmap.nodes.at(nodes[i - 1]), roadmap.nodes.at(nodes[i]), dofs,
+                query.resolution, query.batch);
+            spans.push_back({ nodes[i - 1], nodes[i], first, steps });
+        }
+        if (spans.empty()) return true;
+
+        bool blocked = false;
+        if (query.check() > 0) {
+            for (const Span& span : spans) {
+                const auto begin = query.collides.begin() + std::ptrdiff_t(span.first);
+                const bool hit = std::find(begin, begin + std::ptrdiff_t(span.count), std::uint8_t(1)) != begin + std::ptrdiff_t(span.count);
+                setEdgeState(roadmap, span.a, span.b, hit ? EdgeState::Blocked : EdgeState::Free);
+                blocked |= hit;
+            }
+        }
+        else {
+            for (const Span& span : spans) setEdgeState(roadmap, span.a, span.b, EdgeState::Free);
+        }
+        if (!blocked) return true;
+    }
+    return false;
+}
+
+// --- RRT-Connect ---
+
+bool MotionPlanner::rrtConnect(Query& query, std::vector<double>& path)
+{
+    const std::size_t dofs = query.dofs;
+    struct Tree {
+        ConfigurationIndex nodes;
+        std::vector<std::uint32_t> parent;
+    };
+    Tree trees[2] = { { ConfigurationIndex(dofs), { kNone } }, { ConfigurationIndex(dofs), { kNone } } };
+    trees[0].nodes.add(path.data());            // start
+    trees[1].nodes.add(path.data() + dofs);     // goal
+
+    // Grows 'tree' from its node nearest 'target' towards it, at most
+    // 'maxLength'; the new node is the end of the segment's free prefix.
+    std::vector<double> end(dofs);
+    auto grow = [&](Tree& tree, const double* target, double maxLength, bool& reached) {
+        const std::uint32_t from = tree.nodes.nearest(target);
+        const double* q = tree.nodes.at(from);
+        const double d = distance(q, target, dofs);
+        const double t = d > maxLength ? maxLength / d : 1.0;
+        for (std::size_t k = 0; k < dofs; ++k) end[k] = q[k] + (target[k] - q[k]) * t;
+
+        query.batch.clear();
+        const std::size_t steps = appendSegment(q, end.data(), dofs, query.resolution, query.batch);
+        std::size_t free = steps;
+        if (query.check() > 0) free = std::size_t(std::find(query.collides.begin(), query.collides.end(), std::uint8_t(1)) - query.collides.begin());
+        reached = free == steps && t == 1.0;
+        if (free == 0) return kNone;
+        const std::uint32_t node = tree.nodes.add(&query.batch[(free - 1) * dofs]);
+        tree.parent.push_back(from);
+        return node;
+    };
+
+    std::vector<double> sample(dofs);
+    for (int grown = 0; !query.expired(); grown = 1 - grown) {
+        query.sample(m_random, sample.data());
+        bool reached = false;
+        const std::uint32_t added = grow(trees[grown], sample.data(), m_settings.stepSize, reached);
+        if (added == kNone) continue;
+        const std::uint32_t joined = grow(trees[1 - grown], trees[grown].nodes.at(added),
+            std::numeric_limits<double>::infinity(), reached);
+        if (joined == kNone || !reached) continue;
+
+        // Start tree from its root to the meeting point, then the goal tree
+        // back to its root; both trees hold the meeting configuration.
+        const std::uint32_t meet[2] = { grown == 0 ? added : joined, grown == 0 ? joined : added };
+        std::vector<std::uint32_t> chain;
+        for (std::uint32_t node = meet[0]; node != kNone; node = trees[0].parent[node]) chain.push_back(node);
+        path.clear();
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+            path.insert(path.end(), trees[0].nodes.at(*it), trees[0].nodes.at(*it) + dofs);
+        for (std::uint32_t node = trees[1].parent[meet[1]]; node != kNone; node = trees[1].parent[node])
+            path.insert(path.end(), trees[1].nodes.at(node), trees[1].nodes.at(node) + dofs);
+        return true;
+    }
+    return false;
+}
+
+void MotionPlanner::shortcut(Query& query, std::vector<double>& path)
+{
+    const std::size_t dofs = query.dofs;
+    for (int attempt = 0; attempt < m_settings.shortcutAttempts && !query.expired(); ++attempt) {
+        const std::size_t count = path.size() / dofs;
+        if (count < 3) return;
+        std::uniform_int_distribution<std::size_t> pick(0, count - 1);
+        std::size_t i = pick(m_random), j = pick(m_random);
+        if (i > j) std::swap(i, j);
+        if (j - i < 2) continue;
+
+        query.batch.clear();
+        appendSegment(&path[i * dofs], &path[j * dofs], dofs, query.resolution, query.batch);
+        if (query.check() == 0)
+            path.erase(path.begin() + std::ptrdiff_t((i + 1) * dofs), path.begin() + std::ptrdiff_t(j * dofs));
+    }
+}
+
+// --- Playback ---
+
+double MotionPlanner::pathLength(const std::vector<double>& path, std::size_t dofs)
+{
+    double length = 0.0;
+    for (std::size_t i = dofs; dofs > 0 && i + dofs <= path.size(); i += dofs)
+        length += segmentLength(&path[i - dofs], &path[i], dofs);
+    return length;
+}
+
+void MotionPlanner::samplePath(const std::vector<double>& path, std::size_t dofs, double along, double* q)
+{
+    if (dofs == 0 || path.size() < dofs) return;
+    for (std::size_t i = dofs; i + dofs <= path.size(); i += dofs) {
+        const double* a = &path[i - dofs];
+        const double* b = &path[i];
+        const double length = segmentLength(a, b, dofs);
+        if (along < length) {
+            const double t = std::max(along, 0.0) / length;
+            for (std::size_t k = 0; k < dofs; ++k) q[k] = a[k] + (b[k] - a[k]) * t;
+            return;
+        }
+        along -= length;
+    }
+    std::copy(path.end() - std::ptrdiff_t(dofs), path.end(), q);
+}
@@ -0,0 +1,324 @@
+#include "MotorSimulation.hpp"
+#include "JointStateBuffer.hpp"
+#include "RigidBodyDynamics.hpp"
+#include "SessionLog.hpp"
+#include "TraceZones.hpp"
+#include "components.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <entt/entt.hpp>
+
+namespace {
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+// Coulomb friction is smoothed over this speed, and a joint slower than it
+// whose drive cannot beat static friction stays put.
+constexpr double kFrictionSpeed = 1e-3;
+
+// Command modes as the step loop compares them.
+constexpr double kPosition = 0.0, kVelocity = 1.0, kTorque = 2.0, kCurrent = 3.0, kDuty = 4.0, kOff = 5.0;
+
+constexpr const char* kChannelSuffix[] = { "/position", "/velocity", "/effort", "/current", "/voltage", "/setpoint" };
+constexpr std::size_t kChannelsPerJoint = std::size(kChannelSuffix);
+
+double modeValue(ControlMode mode)
+{
+    switch (mode) {
+    case ControlMode::POSITION:   return kPosition;
+    case ControlMode::VELOCITY:   return kVelocity;
+    case ControlMode::TORQUE:     return kTorque;
+    case ControlMode::CURRENT:    return kCurrent;
+    case ControlMode::DUTY_CYCLE: return kDuty;
+    default:                      return kOff;
+    }
+}
+}
+
+MotorSimulation::MotorSimulation(std::vector<Joint> joints)
+    : m_joints(std::move(joints))
+{
+    const std::size_t n = m_joints.size();
+    for (Loop* loop : { &m_position, &m_velocity, &m_torque })
+        for (auto* column : { &loop->p, &loop->i, &loop->d, &loop->feedForward, &loop->low, &loop->high,
+                 &loop->active, &loop->integral })
+            column->assign(n, 0.0);
+    for (auto* column : { &m_resistance, &m_maxVoltage, &m_peakCurrent, &m_effortLimit, &m_torquePerAmp,
+             &m_efficiency, &m_emfPerSpeed, &m_inverseInertia, &m_gravity, &m_staticFriction, &m_dynamicFriction,
+             &m_lower, &m_upper, &m_ideal, &m_decay, &m_admittance, &m_mode, &m_setpoint, &m_feedForward,
+             &m_q, &m_qd, &m_i, &m_v, &m_effort, &m_qdd, &m_di })
+        column->assign(n, 0.0);
+
+    for (std::size_t j = 0; j < n; ++j) {
+        const Joint& joint = m_joints[j];
+        const std::pair<Loop*, const PIDParameters*> loops[] = {
+            { &m_position, &joint.positionPid }, { &m_velocity, &joint.velocityPid }, { &m_torque, &joint.torquePid } };
+        for (const auto& [loop, pid] : loops) {
+            loop->p[j] = pid->p;
+            loop->i[j] = pid->i;
+            loop->d[j] = pid->d;
+            loop->feedForward[j] = pid->feed_forward;
+            const bool bounded = pid->i_max > pid->i_min;
+            loop->low[j] = bounded ? pid->i_min : -kInfinity;
+            loop->high[j] = bounded ? pid->i_max : kInfinity;
+            loop->active[j] = (pid->p != 0.0 || pid->i != 0.0 || pid->d != 0.0 || pid->feed_forward != 0.0) ? 1.0 : 0.0;
+        }
+
+        // A joint without a torque constant is driven as an ideal torque
+        // actuator: its "current" is then the joint torque itself.
+        const MotorProperties& motor = joint.motor;
+        const bool motorModel = motor.torque_constant_Kt > 0.0;
+        const double gear = joint.gearReduction > 0.0 ? joint.gearReduction : 1.0;
+        const double eta = std::clamp(joint.efficiency, 0.05, 1.0);
+        const double ke = motor.back_emf_constant_Ke > 0.0 ? motor.back_emf_constant_Ke : motor.torque_constant_Kt;
+        m_efficiency[j] = motorModel ? eta : 1.0;
+        m_torquePerAmp[j] = motorModel ? eta * gear * motor.torque_constant_Kt : 1.0;
+        m_emfPerSpeed[j] = motorModel ? gear * ke : 0.0;
+        m_resistance[j] = motorModel ? std::max(motor.terminal_resistance, 0.0) : 0.0;
+        m_maxVoltage[j] = motor.max_voltage > 0.0 ? motor.max_voltage : kInfinity;
+        m_peakCurrent[j] = motorModel && motor.peak_current > 0.0 ? motor.peak_current : kInfinity;
+        m_effortLimit[j] = joint.limits.effort_limit > 0.0 ? joint.limits.effort_limit : kInfinity;
+        m_inverseInertia[j] = joint.inertia > 0.0 ? 1.0 / joint.inertia : 0.0;
+        m_gravity[j] = joint.gravity;
+        m_staticFriction[j] = std::max(joint.staticFriction, joint.dynamicFriction);
+        m_dynamicFriction[j] = joint.dynamicFriction;
+        m_lower[j] = joint.limits.lower;
+        m_upper[j] = joint.limits.upper > joint.limits.lower ? joint.limits.upper : joint.limits.lower;
+    }
+    updateElectrical();
+    reset();
+}
+
+std::unique_ptr<MotorSimulation> MotorSimulation::fromRobot(const entt::registry& registry, entt::entity root)
+{
+    const auto* kin = registry.try_get<KinematicModelComponent>(root);
+    std::unique_ptr<RigidBodyDynamics> dynamics = RigidBodyDynamics::fromRobot(registry, root);
+    if (!kin || !dynamics || dynamics->dofCount() == 0) return nullptr;
+    const KinematicModel& model = *kin->model;
+    const std::size_t dofs = dynamics->dofCount();
+
+    std::vector<double> q(dofs, 0.0);
+    if (const auto* state = registry.try_get<JointStateComponent>(root); state && state->buffer && state->buffer->size() == dofs)
+        std::copy(state->buffer->position(), state->buffer->position() + dofs, q.begin());
+
+    // Gravity torque at rest, and the mass matrix diagonal column by column
+    // from unit accelerations on top of it.
+    std::vector<double> zero(dofs, 0.0), gravity(dofs), qdd(dofs, 0.0), tau(dofs);
+    dynamics->inverseDynamics(q.data(), zero.data(), zero.data(), gravity.data());
+
+    std::vector<Joint> joints(dofs);
+    for (std::size_t dof = 0; dof < dofs; ++dof) {
+        qdd[dof] = 1.0;
+        dynamics->inverseDynamics(q.data(), zero.data(), qdd.data(), tau.data());
+        qdd[dof] = 0.0;
+
+        Joint& joint = joints[dof];
+        joint.name = model.dofName(int(dof));
+        joint.inertia = tau[dof] - gravity[dof];
+        joint.gravity = gravity[dof];
+        const auto* component = registry.try_get<JointComponent>(kin->links[std::size_t(model.dofLink(int(dof)))]);
+        if (!component) continue;
+        const JointDescription& d = component->description;
+        joint.motor = d.motor;
+        joint.positionPid = d.position_pid;
+        joint.velocityPid = d.velocity_pid;
+        joint.torquePid = d.torque_pid;
+        joint.limits = d.limits;
+        joint.gearReduction = d.gear_reduction;
+        joint.efficiency = d.transmission_efficiency;
+        joint.staticFriction = d.static_friction;
+        joint.dynamicFriction = d.dynamic_friction;
+    }
+
+    auto simulation = std::make_unique<MotorSimulation>(std::move(joints));
+    simulation->reset(q.data());
+    return simulation;
+}
+
+void MotorSimulation::setRate(double hz)
+{
+    m_rateHz = std::max(hz, 1.0);
+    updateElectrical();
+}
+
+void MotorSimulation::updateElectrical()
+{
+    // L di/dt = V - emf - R i over one step of constant V: exact for R, L > 0,
+    // forward Euler without R, the resistive steady state without L.
+    const double dt = 1.0 / m_rateHz;
+    for (std::size_t j = 0; j < m_joints.size(); ++j) {
+        const MotorProperties& motor = m_joints[j].motor;
+        const double r = m_resistance[j];
+        const double l = motor.torque_constant_Kt > 0.0 ? std::max(motor.terminal_inductance, 0.0) : 0.0;
+        m_ideal[j] = (r == 0.0 && l == 0.0) ? 1.0 : 0.0;
+        if (l > 0.0 && r > 0.0) {
+            m_decay[j] = std::exp(-r * dt / l);
+            m_admittance[j] = (1.0 - m_decay[j]) / r;
+        }
+        else if (l > 0.0) {
+            m_decay[j] = 1.0;
+            m_admittance[j] = dt / l;
+        }
+        else {
+            m_decay[j] = 0.0;
+            m_admittance[j] = r > 0.0 ? 1.0 / r : 0.0;
+        }
+    }
+}
+
+void MotorSimulation::reset(const double* q)
+{
+    m_time = 0.0;
+    for (std::size_t j = 0; j < m_joints.size(); ++j)
+        m_q[j] = q ? q[j] : 0.5 * (m_lower[j] + m_upper[j]);
+    for (auto* column : { &m_qd, &m_i, &m_v, &m_effort, &m_qdd, &m_di, &m_setpoint, &m_feedForward,
+             &m_position.integral, &m_velocity.integral, &m_torque.integral })
+        std::fill(column->begin(), column->end(), 0.0);
+    std::fill(m_mode.begin(), m_mode.end(), kOff);
+}
+
+void MotorSimulation::setCommand(std::size_t joint, const JointCommand& command)
+{
+    if (joint >= m_joints.size()) return;
+    const double mode = modeValue(command.mode);
+    if (mode != m_mode[joint]) {
+        m_position.integral[joint] = 0.0;
+        m_velocity.integral[joint] = 0.0;
+        m_torque.integral[joint] = 0.0;
+    }
+    m_mode[joint] = mode;
+    m_setpoint[joint] = command.setpoint;
+    m_feedForward[joint] = command.feedForward;
+}
+
+void MotorSimulation::holdPosition()
+{
+    for (std::size_t j = 0; j < m_joints.size(); ++j) {
+        JointCommand command;
+        command.mode = ControlMode::POSITION;
+        command.setpoint = m_q[j];
+        setCommand(j, command);
+    }
+}
+
+void MotorSimulation::step(std::size_t steps)
+{
+    const std::size_t n = m_joints.size();
+    const double dt = 1.0 / m_rateHz;
+    const double rate = m_rateHz;
+
+    for (std::size_t s = 0; s < steps; ++s) {
+        // One pass per step over all joints; every mode and model variant is
+        // a select, not a branch, so the pass vectorizes across joints.
+        for (std::size_t j = 0; j < n; ++j) {
+            const double mode = m_mode[j], setpoint = m_setpoint[j];
+            const double q = m_q[j], qd = m_qd[j], i = m_i[j];
+
+            // Position loop.
+            const double inPosition = mode == kPosition ? 1.0 : 0.0;
+            const double positionError = setpoint - q;
+            const double positionIntegral = std::clamp(m_position.integral[j] + inPosition * m_position.i[j] * positionError * dt,
+                m_position.low[j], m_position.high[j]);
+            const double positionOut = m_position.p[j] * positionError + positionIntegral - m_position.d[j] * qd
+                + m_position.feedForward[j] * setpoint;
+
+            // Velocity loop, fed by the position loop when it has gains.
+            const double cascade = inPosition * m_velocity.active[j];
+            const double inVelocity = mode == kVelocity ? 1.0 : cascade;
+            const double velocityTarget = mode == kVelocity ? setpoint : positionOut;
+            const double velocityError = velocityTarget - qd;
+            const double velocityIntegral = std::clamp(m_velocity.integral[j] + inVelocity * m_velocity.i[j] * velocityError * dt,
+                m_velocity.low[j], m_velocity.high[j]);
+            const double velocityOut = m_velocity.p[j] * velocityError + velocityIntegral - m_velocity.d[j] * m_qdd[j]
+                + m_velocity.feedForward[j] * velocityTarget;
+
+            // Joint torque, then motor current.
+            double torque = mode == kTorque ? setpoint
+                : mode == kCurrent ? setpoint * m_torquePerAmp[j]
+                : inVelocity > 0.0 ? velocityOut : positionOut;
+            torque = std::clamp(torque + m_feedForward[j], -m_effortLimit[j], m_effortLimit[j]);
+            const double currentTarget = std::clamp(torque / m_torquePerAmp[j], -m_peakCurrent[j], m_peakCurrent[j]);
+
+            // Torque (current) loop, or the inverse model without gains.
+            const double driven = mode <= kCurrent ? 1.0 : 0.0;
+            const double emf = m_emfPerSpeed[j] * qd;
+            const double currentError = currentTarget - i;
+            const double torqueIntegral = std::clamp(m_torque.integral[j] + driven * m_torque.i[j] * currentError * dt,
+                m_torque.low[j], m_torque.high[j]);
+            const double pidVoltage = m_torque.p[j] * currentError + torqueIntegral - m_torque.d[j] * m_di[j]
+                + m_torque.feedForward[j] * currentTarget;
+            const double modelVoltage = m_resistance[j] * currentTarget + emf;
+            double voltage = mode == kDuty ? setpoint * m_maxVoltage[j]
+                : m_torque.active[j] > 0.0 ? pidVoltage : modelVoltage;
+            voltage = mode == kOff ? 0.0 : std::clamp(voltage, -m_maxVoltage[j], m_maxVoltage[j]);
+
+            // Winding current; an ideal source follows its target, and a
+            // disabled drive leaves the winding open.
+            double current = m_decay[j] * i + m_admittance[j] * (voltage - emf);
+            current = m_ideal[j] > 0.0 ? driven * currentTarget : current;
+            current = mode == kOff ? 0.0 : std::clamp(current, -m_peakCurrent[j], m_peakCurrent[j]);
+
+            // Gearbox and load. Back-driven, the transmission loses the
+            // other way, so the joint sees the motor torque over eta twice.
+            const double motorTorque = m_torquePerAmp[j] * current;
+            const double eta = m_efficiency[j];
+            const double effort = motorTorque * qd >= 0.0 ? motorTorque : motorTorque / (eta * eta);
+            const double drive = effort - m_gravity[j];
+            const double load = drive - m_dynamicFriction[j] * qd / (std::abs(qd) + kFrictionSpeed);
+            const bool stuck = std::abs(qd) < kFrictionSpeed && std::abs(drive) <= m_staticFriction[j];
+            const double qdd = stuck ? -qd * rate : load * m_inverseInertia[j];
+
+            double qdNext = qd + qdd * dt;
+            double qNext = q + qdNext * dt;
+            const bool limited = m_lower[j] < m_upper[j];
+            const double bounded = std::clamp(qNext, m_lower[j], m_upper[j]);
+            qdNext = limited && bounded != qNext ? 0.0 : qdNext;
+            qNext = limited ? bounded : qNext;
+
+            m_position.integral[j] = positionIntegral;
+            m_velocity.integral[j] = velocityIntegral;
+            m_torque.integral[j] = torqueIntegral;
+            m_qdd[j] = (qdNext - qd) * rate;
+            m_di[j] = (current - i) * rate;
+            m_q[j] = qNext;
+            m_qd[j] = qdNext;
+            m_i[j] = current;
+            m_v[j] = voltage;
+            m_effort[j] = effort;
+        }
+        m_time += dt;
+    }
+}
+
+bool MotorSimulation::record(SessionRecorder& recorder, double seconds, std::size_t decimation, std::int64_t startNs,
+    const std::atomic<bool>* cancel)
+{
+    KR_ZONE("motor simulation");
+    const std::size_t n = m_joints.size();
+    std::vector<int> channels(n * kChannelsPerJoint);
+    for (std::size_t j = 0; j < n; ++j)
+        for (std::size_t c = 0; c < kChannelsPerJoint; ++c)
+            channels[j * kChannelsPerJoint + c] = recorder.channel(m_joints[j].name + kChannelSuffix[c]);
+
+    auto append = [&] {
+        const std::int64_t t = startNs + std::llround(m_time * 1e9);
+        for (std::size_t j = 0; j < n; ++j) {
+            const double values[kChannelsPerJoint] = { m_q[j], m_qd[j], m_effort[j], m_i[j], m_v[j], m_setpoint[j] };
+            for (std::size_t c = 0; c < kChannelsPerJoint; ++c) recorder.append(channels[j * kChannelsPerJoint + c], t, values[c]);
+        }
+    };
+
+    decimation = std::max<std::size_t>(decimation, 1);
+    const std::size_t total = std::size_t(std::llround(std::max(seconds, 0.0) * m_rateHz));
+    append();
+    for (std::size_t done = 0; done < total;) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) return false;
+        const std::size_t steps = std::min(decimation, total - done);
+        step(steps);
+        done += steps;
+        append();
+    }
+    return true;
+}
@@ -0,0 +1,172 @@
+#include "NameIndex.hpp"
+#include "components.hpp"
+
+#include <entt/entt.hpp>
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+    std::string lowered(const std::string& text)
+    {
+        std::string out(text);
+        for (char& c : out) c = char(std::tolower(static_cast<unsigned char>(c)));
+        return out;
+    }
+
+    void touchTag(entt::registry& registry, entt::entity entity)
+    {
+        if (auto* index = registry.ctx().find<NameIndex>()) index->touch(entity);
+    }
+}
+
+NameIndex& NameIndex::of(entt::registry& registry)
+{
+    if (auto* index = registry.ctx().find<NameIndex>()) return *index;
+
+    registry.on_construct<TagComponent>().connect<&touchTag>();
+    registry.on_update<TagComponent>().connect<&touchTag>();
+    registry.on_destroy<TagComponent>().connect<&touchTag>();
+    NameIndex& index = registry.ctx().emplace<NameIndex>(registry);
+    for (const entt::entity entity : registry.view<TagComponent>()) index.touch(entity);
+    return index;
+}
+
+void NameIndex::flush()
+{
+    if (m_pending.empty()) return;
+    // Each entity once, however often it was touched.
+    std::sort(m_pending.begin(), m_pending.end());
+    m_pending.erase(std::unique(m_pending.begin(), m_pending.end()), m_pending.end());
+    for (const entt::entity entity : m_pending) {
+        remove(entity);
+        // on_destroy fires before the component goes, so check it is still there.
+        const auto* tag = m_registry.valid(entity) ? m_registry.try_get<TagComponent>(entity) : nullptr;
+        if (tag) add(entity, tag->tag);
+    }
+    m_pending.clear();
+}
+
+void NameIndex::add(entt::entity entity, const std::string& tag)
+{
+    std::uint32_t slot;
+    if (!m_free.empty()) {
+        slot = m_free.back();
+        m_free.pop_back();
+    }
+    else {
+        slot = std::uint32_t(m_entities.size());
+        m_entities.push_back(entt::null);
+        m_names.emplace_back();
+    }
+    m_entities[slot] = entity;
+    m_names[slot] = lowered(tag);
+    m_slotOf[entity] = slot;
+
+    const std::string& name = m_names[slot];
+    for (std::size_t i = 0; i + 3 <= name.size(); ++i) {
+        std::vector<std::uint32_t>& list = m_postings[trigram(name.data() + i)];
+        // New slots go at the end; a reused one is placed, and a repeated
+        // trigram of the same name is skipped.
+        if (list.empty() || list.back() < slot) list.push_back(slot);
+        else if (const auto at = std::lower_bound(list.begin(), list.end(), slot); at == list.end() || *at != slot)
+            list.insert(at, slot);
+    }
+}
+
+void NameIndex::remove(entt::entity entity)
+{
+    const auto it = m_slotOf.find(entity);
+    if (it == m_slotOf.end()) return;
+    const std::uint32_t slot = it->second;
+    m_slotOf.erase(it);
+
+    const std::string& name = m_names[slot];
+    for (std::size_t i = 0; i + 3 <= name.size(); ++i) {
+        const auto posting = m_postings.find(trigram(name.data() + i));
+        if (posting == m_postings.end()) continue;
+        std::vector<std::uint32_t>& list = posting->second;
+        const auto at = std::lower_bound(list.begin(), list.end(), slot);
+        if (at != list.end() && *at == slot) list.erase(at);
+        if (list.empty()) m_postings.erase(posting);
+    }
+    m_entities[slot] = entt::null;
+    m_names[slot].clear();
+    m_free.push_back(slot);
+}
+
+bool NameIndex::matches(std::uint32_t slot, const std::string& query) const
+{
+    return m_entities[slot] != entt::null && m_names[slot].find(query) != std::string::npos;
+}
+
+std::size_t NameIndex::find(Cursor& cursor, std::size_t cap, std::vector<entt::entity>& out)
+{
+    flush();
+    if (cursor.done) return 0;
+    const std::string query = lowered(cursor.query);
+    const std::uint32_t slots = std::uint32_t(m_entities.size());
+    std::size_t found = 0;
+
+    // The rarest trigram's slots, or every slot for a short query.
+    const std::vector<std::uint32_t>* candidates = nullptr;
+    if (query.size() >= 3) {
+        for (std::size_t i = 0; i + 3 <= query.size(); ++i) {
+            const auto posting = m_postings.find(trigram(query.data() + i));
+            if (posting == m_postings.end()) {
+                cursor.done = true;   // a trigram nobody has: no matches at all
+                return 0;
+            }
+            if (!candidates || posting->second.size() < candidates->size()) candidates = &posting->second;
+        }
+    }
+
+    if (candidates) {
+        auto it = std::lower_bound(candidates->begin(), candidates->end(), cursor.next);
+        for (; it != candidates->end() && found < cap; ++it) {
+            if (!matches(*it, query)) continue;
+            out.push_back(m_entities[*it]);
+            ++found;
+        }
+        cursor.next = it == candidates->end() ? slots : *it;
+    }
+    else {
+        std::uint32_t slot = cursor.next;
+        for (; slot < slots && found < cap; ++slot) {
+            if (!matches(slot, query)) continue;
+            out.push_back(m_entities[slot]);
+            ++found;
+        }
+        cursor.next = slot;
+    }
+    cursor.done = cursor.next >= slots;
+    return found;
+}
+
+std::size_t NameIndex::replace(const std::vector<entt::entity>& entities, const std::string& query,
+    const std::string& replacement)
+{
+    if (query.empty()) return 0;
+    const std::string needle = lowered(query);
+    std::size_t changed = 0;
+    for (const entt::entity entity : entities) {
+        auto* tag = m_registry.valid(entity) ? m_registry.try_get<TagComponent>(entity) : nullptr;
+        if (!tag) continue;
+        const std::string low = lowered(tag->tag);
+        std::size_t at = low.find(needle);
+        if (at == std::string::npos) continue;
+
+        // Positions come from the lower-cased copy; ASCII lower-casing keeps them.
+        std::string text;
+        text.reserve(tag->tag.size());
+        std::size_t from = 0;
+        for (; at != std::string::npos; at = low.find(needle, from)) {
+            text.append(tag->tag, from, at - from).append(replacement);
+            from = at + needle.size();
+        }
+        text.append(tag->tag, from, std::string::npos);
+        m_registry.patch<TagComponent>(entity, [&](TagComponent& t) { t.tag = std::move(text); });
+        ++changed;
+    }
+    return changed;
+}
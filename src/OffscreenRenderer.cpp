@@ -0,0 +1,190 @@
+#include "OffscreenRenderer.hpp"
+#include "GpuMemory.hpp"
+#include "RenderingSystem.hpp"
+#include "Trace.hpp"
+
+#include <QImage>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_3_Core>
+#include <QOpenGLVersionFunctionsFactory>
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+
+OffscreenRenderer::OffscreenRenderer(RenderingSystem& renderer)
+    : m_renderer(renderer)
+{
+}
+
+OffscreenRenderer::~OffscreenRenderer()
+{
+    if (m_context && makeCurrent()) {
+        finish();
+        m_renderer.releaseTarget(this);
+        destroy();
+        m_context->doneCurrent();
+    }
+}
+
+bool OffscreenRenderer::create(int width, int height)
+{
+    m_width = std::max(1, width);
+    m_height = std::max(1, height);
+
+    m_context = std::make_unique<QOpenGLContext>();
+    m_context->setFormat(QSurfaceFormat::defaultFormat());
+    // Shares mesh and shader objects with the viewports when there are any.
+    m_context->setShareContext(QOpenGLContext::globalShareContext());
+    if (!m_context->create()) {
+        qCritical() << "[OffscreenRenderer] Failed to create an OpenGL context.";
+        m_context.reset();
+        return false;
+    }
+
+    m_surface = std::make_unique<QOffscreenSurface>();
+    m_surface->setFormat(m_context->format());
+    m_surface->create();
+    if (!makeCurrent()) return false;
+
+    m_gl = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_4_3_Core>(m_context.get());
+    if (!m_gl) {
+        qCritical() << "[OffscreenRenderer] OpenGL 4.3 core functions are unavailable.";
+        return false;
+    }
+    m_gl->initializeOpenGLFunctions();
+
+    m_gl->glGenTextures(1, &m_outputTexture);
+    m_gl->glBindTexture(GL_TEXTURE_2D, m_outputTexture);
+    m_gl->glTexStorage2D(GL_TEXTURE_2D, 1, GL_SRGB8_ALPHA8, m_width, m_height);
+    GpuMemory::trackTexture(m_outputTexture, std::size_t(m_width) * m_height * 4, GpuMemory::Category::RenderTargets);
+    m_gl->glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_gl->glGenFramebuffers(1, &m_outputFBO);
+    m_gl->glBindFramebuffer(GL_FRAMEBUFFER, m_outputFBO);
+    m_gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_outputTexture, 0);
+    const GLenum status = m_gl->glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    m_gl->glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        qCritical() << "[OffscreenRenderer] Output framebuffer incomplete:" << Qt::hex << status;
+        return false;
+    }
+
+    const GLsizeiptr bytes = GLsizeiptr(m_width) * m_height * 4;
+    for (Slot& s : m_slots) {
+        m_gl->glGenBuffers(1, &s.pbo);
+        m_gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        GpuMemory::bufferData(m_gl, GL_PIXEL_PACK_BUFFER, s.pbo, bytes, nullptr, GL_STREAM_READ, GpuMemory::Category::Readback);
+    }
+    m_gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // A batch run has no viewport to initialise the renderer.
+    if (!m_renderer.isInitialized())
+        m_renderer.initialize(m_width, m_height);
+
+    KR_TRACE(Lifecycle) << "[OffscreenRenderer] Created" << m_width << "x" << m_height
+        << "shared:" << (m_context->shareContext() != nullptr);
+    return true;
+}
+
+bool OffscreenRenderer::makeCurrent()
+{
+    if (!m_context->makeCurrent(m_surface.get())) {
+        qCritical() << "[OffscreenRenderer] makeCurrent failed.";
+        return false;
+    }
+    return true;
+}
+
+void OffscreenRenderer::renderFrame(entt::registry& registry, entt::entity cameraEntity, float frameTime)
+{
+    if (!m_outputFBO || !makeCurrent()) return;
+
+    m_renderer.advanceFrameTime(frameTime);
+    m_renderer.stepSimulation(frameTime);
+    m_renderer.setSimulationAlpha(1.0f);   // one step per frame: show the latest state
+    m_renderer.extractSnapshot(registry);
+
+    m_renderer.renderView(this, m_outputFBO, registry, cameraEntity, m_width, m_height);
+    queueReadback();
+
+    // Hand over whatever has landed since; never waits.
+    while (m_pending > 0 && deliverOldest(false)) {}
+}
+
+void OffscreenRenderer::queueReadback()
+{
+    // Ring full: the oldest frame has to reach the sink before its slot is reused.
+    if (m_pending == kSlots) deliverOldest(true);
+
+    Slot& slot = m_slots[m_head];
+    if (m_readback) {
+        m_gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, m_outputFBO);
+        m_gl->glReadBuffer(GL_COLOR_ATTACHMENT0);
+        m_gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        m_gl->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        m_gl->glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        m_gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        m_gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    }
+
+    slot.fence = m_gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = m_nextFrame++;
+    m_gl->glFlush();   // no swap to do it for us
+
+    m_head = (m_head + 1) % kSlots;
+    ++m_pending;
+}
+
+bool OffscreenRenderer::deliverOldest(bool block)
+{
+    Slot& slot = m_slots[(m_head - m_pending + kSlots) % kSlots];
+    const GLuint64 timeout = block ? GL_TIMEOUT_IGNORED : 0;
+    const GLenum result = m_gl->glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    if (result == GL_TIMEOUT_EXPIRED) return false;
+    m_gl->glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    --m_pending;
+
+    if (result == GL_WAIT_FAILED) {
+        qWarning() << "[OffscreenRenderer] Readback of frame" << slot.frame << "failed.";
+        return true;
+    }
+    if (!m_readback) return true;
+
+    const std::size_t rowBytes = std::size_t(m_width) * 4;
+    m_gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (const auto* pixels = static_cast<const uchar*>(m_gl->glMapBufferRange(
+            GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(rowBytes * m_height), GL_MAP_READ_BIT))) {
+        // GL rows start at the bottom.
+        QImage frame(m_width, m_height, QImage::Format_RGBX8888);
+        for (int y = 0; y < m_height; ++y)
+            std::memcpy(frame.scanLine(m_height - 1 - y), pixels + rowBytes * y, rowBytes);
+        m_gl->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        if (m_sink) m_sink(frame, slot.frame);
+    }
+    m_gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void OffscreenRenderer::finish()
+{
+    if (!m_gl || !makeCurrent()) return;
+    while (m_pending > 0) deliverOldest(true);
+}
+
+void OffscreenRenderer::destroy()
+{
+    if (!m_gl) return;
+    for (Slot& s : m_slots) {
+        if (s.fence) m_gl->glDeleteSync(s.fence);
+        if (s.pbo) GpuMemory::deleteBuffers(m_gl, 1, &s.pbo);
+        s = Slot{};
+    }
+    m_gl->glDeleteFramebuffers(1, &m_outputFBO);
+    GpuMemory::deleteTextures(m_gl, 1, &m_outputTexture);
+    m_outputFBO = m_outputTexture = 0;
+    m_pending = m_head = 0;
+    m_gl = nullptr;
+}
@@ -0,0 +1,172 @@
+#include "PerfGate.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QSysInfo>
+
+#include <algorithm>
+#include <cmath>
+
+const char* PerfGate::verdictName(Verdict verdict)
+{
+    switch (verdict) {
+    case Verdict::Unchanged: return "unchanged";
+    case Verdict::Regressed: return "regressed";
+    case Verdict::Improved:  return "improved";
+    case Verdict::Missing:   return "missing";
+    case Verdict::Added:     return "added";
+    }
+    return "unknown";
+}
+
+double PerfGate::median(std::vector<double> values)
+{
+    if (values.empty()) return 0.0;
+    const std::size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    if (values.size() % 2) return values[mid];
+    const double upper = values[mid];
+    return 0.5 * (upper + *std::max_element(values.begin(), values.begin() + mid));
+}
+
+double PerfGate::mannWhitneyGreater(const std::vector<double>& a, const std::vector<double>& b)
+{
+    const std::size_t na = a.size(), nb = b.size(), n = na + nb;
+    if (na == 0 || nb == 0) return 1.0;
+
+    // Pool and rank, ties sharing their mean rank.
+    std::vector<std::pair<double, bool>> pooled;   // value, from b
+    pooled.reserve(n);
+    for (double v : a) pooled.emplace_back(v, false);
+    for (double v : b) pooled.emplace_back(v, true);
+    std::sort(pooled.begin(), pooled.end(), [](const auto& l, const auto& r) { return l.first < r.first; });
+
+    double rankSumB = 0.0, tieTerm = 0.0;
+    for (std::size_t i = 0; i < n;) {
+        std::size_t j = i + 1;
+        while (j < n && pooled[j].first == pooled[i].first) ++j;
+        const double rank = 0.5 * double(i + 1 + j);   // mean of ranks i+1 .. j
+        for (std::size_t k = i; k < j; ++k)
+            if (pooled[k].second) rankSumB += rank;
+        const double t = double(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+
+    const double uB = rankSumB - 0.5 * double(nb) * double(nb + 1);
+    const double mean = 0.5 * double(na) * double(nb);
+    const double variance = double(na) * double(nb) / 12.0
+        * (double(n + 1) - tieTerm / (double(n) * double(n - 1)));
+    if (variance <= 0.0) return 1.0;   // every sample equal
+    const double z = (uB - mean - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+PerfGate::Comparison PerfGate::compare(const QString& name, const std::vector<double>& baseline,
+    const std::vector<double>& current, const Thresholds& thresholds)
+{
+    Comparison c;
+    c.name = name;
+    c.baselineSamples = int(baseline.size());
+    c.currentSamples = int(current.size());
+    if (current.empty()) { c.verdict = Verdict::Missing; return c; }
+    if (baseline.empty()) { c.verdict = Verdict::Added; return c; }
+
+    c.baselineMedian = median(baseline);
+    c.currentMedian = median(current);
+    c.change = c.baselineMedian > 0.0 ? c.currentMedian / c.baselineMedian - 1.0 : 0.0;
+
+    const bool tested = c.baselineSamples >= thresholds.minSamples && c.currentSamples >= thresholds.minSamples;
+    if (tested)
+        c.pValue = c.change >= 0.0 ? mannWhitneyGreater(baseline, current) : mannWhitneyGreater(current, baseline);
+    const bool significant = !tested || c.pValue < thresholds.alpha;
+    if (significant && c.change > thresholds.tolerance) c.verdict = Verdict::Regressed;
+    else if (significant && c.change < -thresholds.tolerance) c.verdict = Verdict::Improved;
+    return c;
+}
+
+QJsonObject PerfGate::verdictReport(std::vector<Comparison> comparisons, const Thresholds& thresholds,
+    const QString& machine)
+{
+    std::stable_sort(comparisons.begin(), comparisons.end(), [](const Comparison& l, const Comparison& r) {
+        const bool lr = l.verdict == Verdict::Regressed, rr = r.verdict == Verdict::Regressed;
+        return lr != rr ? lr : l.change > r.change;
+    });
+
+    int counts[5] = {};
+    QJsonArray results;
+    for (const Comparison& c : comparisons) {
+        ++counts[int(c.verdict)];
+        QJsonObject result{ { "name", c.name }, { "verdict", verdictName(c.verdict) },
+            { "baselineMedian", c.baselineMedian }, { "currentMedian", c.currentMedian }, { "change", c.change },
+            { "baselineSamples", c.baselineSamples }, { "currentSamples", c.currentSamples } };
+        if (c.pValue >= 0.0) result.insert("p", c.pValue);
+        results.append(result);
+
+        qInfo().noquote() << QStringLiteral("[PerfGate] %1 %2 -> %3 (%4%)%5  %6")
+            .arg(c.name, -40).arg(c.baselineMedian, 10, 'f', 4).arg(c.currentMedian, 10, 'f', 4)
+            .arg(100.0 * c.change, 6, 'f', 1)
+            .arg(c.pValue >= 0.0 ? QStringLiteral(" p=%1").arg(c.pValue, 0, 'g', 2) : QString())
+            .arg(c.verdict == Verdict::Unchanged ? "" : verdictName(c.verdict));
+    }
+
+    const int regressions = counts[int(Verdict::Regressed)];
+    if (counts[int(Verdict::Missing)])
+        qWarning() << "[PerfGate]" << counts[int(Verdict::Missing)] << "baseline timings have no current samples.";
+    qInfo().noquote() << QStringLiteral("[PerfGate] %1: %2 regressed, %3 improved, %4 compared on %5")
+        .arg(regressions ? "FAIL" : "pass").arg(regressions).arg(counts[int(Verdict::Improved)])
+        .arg(comparisons.size()).arg(machine);
+
+    return QJsonObject{
+        { "verdict", regressions ? "fail" : "pass" },
+        { "machine", machine },
+        { "thresholds", QJsonObject{ { "tolerance", thresholds.tolerance }, { "alpha", thresholds.alpha },
+            { "minSamples", thresholds.minSamples } } },
+        { "regressed", regressions },
+        { "improved", counts[int(Verdict::Improved)] },
+        { "missing", counts[int(Verdict::Missing)] },
+        { "added", counts[int(Verdict::Added)] },
+        { "results", results } };
+}
+
+bool PerfGate::passed(const QJsonObject& verdictReport)
+{
+    return verdictReport.value("verdict").toString() == QLatin1String("pass");
+}
+
+QString PerfGate::machineKey(const QString& hardware)
+{
+    QString key = QSysInfo::machineHostName() + '-' + hardware;
+    for (QChar& c : key)
+        if (c.unicode() > 127 || (!c.isLetterOrNumber() && c != '-' && c != '_')) c = '_';
+    return key.left(96);
+}
+
+QString PerfGate::baselinePath(const QString& dir, const QString& machine, const QString& name)
+{
+    QDir root(dir);
+    root.mkpath(machine);
+    return root.filePath(machine + '/' + name);
+}
+
+bool PerfGate::writeJson(const QString& path, const QJsonObject& object)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCritical() << "[PerfGate] Cannot write" << path;
+        return false;
+    }
+    file.write(QJsonDocument(object).toJson());
+    return file.commit();
+}
+
+QJsonObject PerfGate::readJson(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return {};
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
@@ -0,0 +1,234 @@
+#include "PerfHud.hpp"
+#include "ComputeDispatch.hpp"
+#include "GpuMemory.hpp"
+#include "GpuProfiler.hpp"
+#include "RenderStats.hpp"
+#include "SystemScheduler.hpp"
+
+#include <QFont>
+#include <QPainter>
+#include <QPolygonF>
+#include <QRect>
+
+#include <algorithm>
+#include <iterator>
+#include <entt/entt.hpp>
+
+namespace
+{
+    constexpr int kPanelWidth = 380;
+    constexpr int kGraphHeight = 34;
+    constexpr int kMargin = 8;
+
+    double elapsedMs(const QElapsedTimer& clock)
+    {
+        return clock.isValid() ? static_cast<double>(clock.nsecsElapsed()) * 1e-6 : 0.0;
+    }
+
+    // "struct TransformComponent" -> "TransformComponent" (MSVC spells the kind).
+    QString componentName(std::string_view name)
+    {
+        for (std::string_view prefix : { std::string_view("struct "), std::string_view("class ") })
+            if (name.substr(0, prefix.size()) == prefix) name.remove_prefix(prefix.size());
+        return QString::fromUtf8(name.data(), static_cast<qsizetype>(name.size()));
+    }
+}
+
+void PerfHud::setVisible(bool on)
+{
+    if (on == m_visible) return;
+    m_visible = on;
+    if (!on) return;
+
+    // Start from an empty history; the counters kept running while hidden.
+    *this = PerfHud();
+    m_visible = true;
+    const RenderStats::Totals& totals = RenderStats::totals();
+    m_lastDraws = totals.drawCalls;
+    m_lastPrimitives = totals.primitives;
+    m_lastDispatches = totals.dispatches;
+    m_lastUploadBytes = totals.uploadBytes;
+}
+
+void PerfHud::beginTick()
+{
+    if (!m_visible) return;
+
+    // Everything drawn since the previous beginTick() belongs to that tick.
+    const RenderStats::Totals& totals = RenderStats::totals();
+    m_draws[m_head] = static_cast<float>(totals.drawCalls - m_lastDraws);
+    m_primitives[m_head] = static_cast<float>(totals.primitives - m_lastPrimitives) * 1e-3f;
+    m_dispatches[m_head] = static_cast<float>(totals.dispatches - m_lastDispatches);
+    m_uploadKb[m_head] = static_cast<float>(totals.uploadBytes - m_lastUploadBytes) / 1024.0f;
+    m_lastDraws = totals.drawCalls;
+    m_lastPrimitives = totals.primitives;
+    m_lastDispatches = totals.dispatches;
+    m_lastUploadBytes = totals.uploadBytes;
+
+    m_head = (m_head + 1) % kHistory;
+    m_frameMs[m_head] = static_cast<float>(elapsedMs(m_frameClock));
+    m_tickMs[m_head] = 0.0f;
+    m_draws[m_head] = m_primitives[m_head] = m_dispatches[m_head] = m_uploadKb[m_head] = 0.0f;
+    for (auto& [viewport, series] : m_gpuMs) series[m_head] = 0.0f;
+    for (Step& s : m_steps) s.ms[m_head] = 0.0f;
+
+    m_frameClock.restart();
+    m_tickClock.restart();
+    m_stepClock.restart();
+}
+
+void PerfHud::mark(const char* step)
+{
+    if (!m_visible) return;
+    record(step, elapsedMs(m_stepClock));
+    m_stepClock.restart();
+}
+
+void PerfHud::endTick(const entt::registry& registry, const SystemScheduler& systems)
+{
+    if (!m_visible) return;
+
+    for (std::size_t i = 0; i < systems.systemCount(); ++i)
+        record(systems.systemName(i), systems.systemMs(i));
+    m_tickMs[m_head] = static_cast<float>(elapsedMs(m_tickClock));
+    m_stepClock.restart();
+
+    if (m_ticks++ % kCountRefreshTicks != 0) return;
+    m_components.clear();
+    for (auto [id, pool] : registry.storage())
+        if (!pool.empty()) m_components.emplace_back(componentName(pool.info().name()), pool.size());
+    std::sort(m_components.begin(), m_components.end(),
+        [](const auto& a, const auto& b) { return a.second > b.second; });
+    if (m_components.size() > kComponentRows) m_components.resize(kComponentRows);
+    m_entities = registry.storage<entt::entity>()->free_list();
+}
+
+void PerfHud::recordGpu(const void* viewport, double gpuMs)
+{
+    if (!m_visible) return;
+    m_gpuMs[viewport][m_head] = static_cast<float>(gpuMs);
+}
+
+void PerfHud::record(const std::string& name, double ms)
+{
+    auto it = std::find_if(m_steps.begin(), m_steps.end(), [&](const Step& s) { return s.name == name; });
+    if (it == m_steps.end()) {
+        m_steps.push_back({ name, {} });
+        it = std::prev(m_steps.end());
+    }
+    it->ms[m_head] += static_cast<float>(ms);
+}
+
+void PerfHud::paintGraph(QPainter& painter, const QRect& box, const QString& label, const Series& series,
+    int lag, const char* unit) const
+{
+    const int newest = (m_head - lag + kHistory) % kHistory;
+    const float peak = std::max(*std::max_element(series.begin(), series.end()), 1e-3f);
+
+    // Oldest on the left, newest on the right.
+    QPolygonF line;
+    line.reserve(kHistory);
+    const double dx = static_cast<double>(box.width()) / (kHistory - 1);
+    for (int i = 0; i < kHistory; ++i) {
+        const float value = series[(newest + 1 + i) % kHistory];
+        line << QPointF(box.left() + i * dx, box.bottom() - value / peak * (box.height() - 12));
+    }
+
+    painter.setPen(QColor(255, 255, 255, 40));
+    painter.drawLine(box.bottomLeft(), box.bottomRight());
+    painter.setPen(QColor(120, 220, 120));
+    painter.drawPolyline(line);
+    painter.setPen(Qt::white);
+    painter.drawText(box, Qt::AlignLeft | Qt::AlignTop,
+        QStringLiteral("%1 %2 %3 (max %4)").arg(label).arg(series[newest], 0, 'f', 2).arg(QLatin1String(unit))
+            .arg(peak, 0, 'f', 2));
+}
+
+void PerfHud::paint(QPainter& painter, const QRect& area, const void* viewport, const GpuProfiler* profiler,
+    const ComputeDispatch* compute) const
+{
+    if (!m_visible) return;
+
+    QFont font(QStringLiteral("Consolas"));
+    font.setStyleHint(QFont::Monospace);
+    font.setPointSize(8);
+    painter.setFont(font);
+
+    // Text below the graphs: tick steps and systems, GPU passes, components.
+    QString text = QStringLiteral("%1   last ms   max ms\n").arg(QStringLiteral("cpu"), -22);
+    for (const Step& s : m_steps)
+        text += QStringLiteral("%1%2 %3\n").arg(QString::fromStdString(s.name), -22)
+            .arg(s.ms[m_head], 8, 'f', 3).arg(*std::max_element(s.ms.begin(), s.ms.end()), 8, 'f', 3);
+    if (!m_cyclic.empty()) {
+        text += QStringLiteral("\n%1    cycles  jit us  max us  overrun  missed\n").arg(QStringLiteral("real-time"), -22);
+        for (const Cyclic& c : m_cyclic)
+            text += QStringLiteral("%1%2 %3 %4 %5 %6\n").arg(QLatin1String(c.name), -22).arg(c.cycles, 9)
+                .arg(c.meanUs, 7, 'f', 1).arg(c.maxUs, 7, 'f', 1).arg(c.overruns, 8).arg(c.missed, 7);
+    }
+    if (profiler && !profiler->timings().empty()) {
+        text += QStringLiteral("\n%1    GPU ms   CPU ms\n").arg(QStringLiteral("pass"), -22);
+        for (const auto& t : profiler->timings())
+            text += QStringLiteral("%1%2 %3\n").arg(QString::fromStdString(t.name), -22)
+                .arg(t.gpuMs, 8, 'f', 3).arg(t.cpuMs, 8, 'f', 3);
+    }
+    if (compute) {
+        // Lanes: items asked for / invocations run; below 100 % the last group idles.
+        // Indirect dispatches only know an upper bound of their items: no figure.
+        text += QStringLiteral("\n%1  size   us/disp ns/item  lanes\n").arg(QStringLiteral("compute"), -22);
+        for (std::size_t k = 0; k < ComputeDispatch::kKernelCount; ++k) {
+            const auto kernel = ComputeDispatch::Kernel(k);
+            const ComputeDispatch::KernelStats& s = compute->stats(kernel);
+            if (!s.dispatches) continue;
+            const QString lanes = s.invocations && s.items <= s.invocations
+                ? QStringLiteral("%1%").arg(100.0 * s.items / double(s.invocations), 5, 'f', 1)
+                : QStringLiteral("    -");
+            text += QStringLiteral("%1%2%3 %4 %5 %6\n").arg(QLatin1String(ComputeDispatch::kernelName(kernel)), -22)
+                .arg(s.localSize, 4).arg(s.tuning ? '*' : ' ').arg(s.gpuUs, 9, 'f', 1).arg(s.nsPerItem, 7, 'f', 3).arg(lanes);
+        }
+    }
+    const GpuMemory::Usage memory = GpuMemory::usage();
+    auto mib = [](std::size_t bytes) { return static_cast<double>(bytes) / double(1 << 20); };
+    text += QStringLiteral("\n%1   VRAM MiB\n").arg(QStringLiteral("gpu memory"), -22);
+    for (std::size_t c = 0; c < GpuMemory::kCategoryCount; ++c)
+        if (memory.bytes[c])
+            text += QStringLiteral("%1%2\n").arg(QLatin1String(GpuMemory::categoryName(GpuMemory::Category(c))), -22)
+                .arg(mib(memory.bytes[c]), 8, 'f', 1);
+    text += QStringLiteral("%1%2 (peak %3)\n").arg(QStringLiteral("total"), -22)
+        .arg(mib(memory.total), 8, 'f', 1).arg(mib(memory.peak), 0, 'f', 1);
+    if (GpuMemory::budget())
+        text += QStringLiteral("%1%2 (evicted %3)\n").arg(QStringLiteral("budget"), -22)
+            .arg(mib(GpuMemory::budget()), 8, 'f', 1).arg(mib(memory.evicted), 0, 'f', 1);
+    text += QStringLiteral("\n%1%2\n").arg(QStringLiteral("entities"), -22).arg(m_entities, 8);
+    for (const auto& [name, count] : m_components)
+        text += QStringLiteral("%1%2\n").arg(name.left(21), -22).arg(count, 8);
+    text.chop(1);
+
+    static const Series kNone{};
+    const auto gpu = m_gpuMs.find(viewport);
+    struct Graph { QString label; const Series* series; int lag; const char* unit; };
+    const Graph graphs[] = {
+        { QStringLiteral("frame"), &m_frameMs, 0, "ms" },
+        { QStringLiteral("tick cpu"), &m_tickMs, 0, "ms" },
+        { QStringLiteral("gpu"), gpu != m_gpuMs.end() ? &gpu->second : &kNone, 0, "ms" },
+        { QStringLiteral("draws"), &m_draws, 1, "" },
+        { QStringLiteral("primitives"), &m_primitives, 1, "k" },
+        { QStringLiteral("dispatches"), &m_dispatches, 1, "" },
+        { QStringLiteral("uploads"), &m_uploadKb, 1, "KiB" },
+    };
+    const int kGraphs = static_cast<int>(std::size(graphs));
+
+    const QRect textRect = painter.boundingRect(QRect(0, 0, kPanelWidth, area.height()),
+        Qt::AlignLeft | Qt::AlignTop, text);
+    const QRect panel(area.right() - kPanelWidth - kMargin, area.top() + kMargin,
+        kPanelWidth, kGraphs * (kGraphHeight + 4) + textRect.height() + 12);
+    painter.fillRect(panel, QColor(0, 0, 0, 170));
+
+    const QRect inner = panel.adjusted(6, 4, -6, -4);
+    int y = inner.top();
+    for (const Graph& g : graphs) {
+        paintGraph(painter, QRect(inner.left(), y, inner.width(), kGraphHeight), g.label, *g.series, g.lag, g.unit);
+        y += kGraphHeight + 4;
+    }
+    painter.setPen(Qt::white);
+    painter.drawText(QRect(inner.left(), y + 4, inner.width(), inner.bottom() - y), Qt::AlignLeft | Qt::AlignTop, text);
+}
@@ -0,0 +1,102 @@
+#include "PointCloudGrid.hpp"
+#include "PointCloudOctree.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+
+PointCloudGrid::PointCloudGrid(const std::vector<glm::vec3>& points, float radius)
+    : m_radius(std::max(radius, 1e-4f))
+    , m_cellSize(m_radius / float(kSearchRings))
+{
+    // About two buckets per occupied cell on a surface scan; collisions only add candidates.
+    std::uint32_t buckets = 64;
+    while (buckets < points.size() / 2 && buckets < (1u << 24)) buckets *= 2;
+    m_bucketMask = buckets - 1;
+
+    const float invCell = 1.0f / m_cellSize;
+    std::vector<std::uint32_t> bucketOf(points.size());
+    m_bucketStart.assign(std::size_t(buckets) + 1, 0);
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        bucketOf[i] = hashCell(glm::ivec3(glm::floor(points[i] * invCell)), m_bucketMask);
+        ++m_bucketStart[bucketOf[i] + 1];
+    }
+    for (std::uint32_t b = 0; b < buckets; ++b) m_bucketStart[b + 1] += m_bucketStart[b];
+
+    m_points.resize(points.size());
+    std::vector<std::uint32_t> cursor(m_bucketStart.begin(), m_bucketStart.end() - 1);
+    for (std::size_t i = 0; i < points.size(); ++i)
+        m_points[cursor[bucketOf[i]]++] = glm::vec4(points[i], 0.0f);
+}
+
+std::shared_ptr<const PointCloudGrid> PointCloudGrid::fromOctree(const PointCloudOctree& octree, float radius)
+{
+    // Levels are additive, so every node whose parent is still coarser than
+    // the target spacing contributes; nodes are breadth-first, coarsest first.
+    const float spacing = radius * 0.25f;
+    std::vector<glm::vec3> points;
+    for (std::uint32_t n = 0; n < octree.nodes().size() && points.size() < kMaxPoints; ++n) {
+        const PointCloudOctree::Node& node = octree.nodes()[n];
+        if (node.depth > 0 && 2.0f * node.size / float(PointCloudFormat::kGridCells) <= spacing) continue;
+        const glm::vec3 origin(node.min[0], node.min[1], node.min[2]);
+        const float step = node.size / 65535.0f;
+        const PointCloudOctree::PackedPoint* packed = octree.points(n);
+        for (std::uint32_t i = 0; i < node.pointCount; ++i)
+            points.push_back(origin + glm::vec3(packed[i].x, packed[i].y, packed[i].z) * step);
+    }
+    return std::make_shared<const PointCloudGrid>(points, radius);
+}
+
+std::shared_ptr<const PointCloudGrid> PointCloudGrid::shared(const std::shared_ptr<const PointCloudOctree>& octree, float radius)
+{
+    struct Entry {
+        std::weak_ptr<const PointCloudOctree> octree;
+        float radius = 0.0f;
+        std::shared_ptr<const PointCloudGrid> grid;
+    };
+    static std::mutex mutex;
+    static std::unordered_map<std::uint64_t, Entry> cache;
+
+    if (!octree) return nullptr;
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = cache[octree->id()];
+    if (entry.grid && entry.radius == radius && entry.octree.lock() == octree) return entry.grid;
+
+    entry.octree = octree;
+    entry.radius = radius;
+    entry.grid = fromOctree(*octree, radius);
+    for (auto it = cache.begin(); it != cache.end();) {
+        if (it->second.octree.expired()) it = cache.erase(it);
+        else ++it;
+    }
+    return entry.grid;
+}
+
+bool PointCloudGrid::nearest(const glm::vec3& p, glm::vec3& out) const
+{
+    if (m_points.empty()) return false;
+
+    const glm::ivec3 home(glm::floor(p / m_cellSize));
+    float bestSq = m_radius * m_radius;
+    bool found = false;
+    for (int ring = 0; ring <= kSearchRings; ++ring) {
+        for (int z = -ring; z <= ring; ++z)
+            for (int y = -ring; y <= ring; ++y)
+                for (int x = -ring; x <= ring; ++x) {
+                    if (std::max({ std::abs(x), std::abs(y), std::abs(z) }) != ring) continue;
+                    const std::uint32_t b = hashCell(home + glm::ivec3(x, y, z), m_bucketMask);
+                    for (std::uint32_t i = m_bucketStart[b]; i < m_bucketStart[b + 1]; ++i) {
+                        const glm::vec3 q(m_points[i]);
+                        const glm::vec3 d = p - q;
+                        const float dSq = glm::dot(d, d);
+                        if (dSq < bestSq) { bestSq = dSq; out = q; found = true; }
+                    }
+                }
+        // Anything in the next ring is at least this far away.
+        const float reach = float(ring) * m_cellSize;
+        if (found && bestSq <= reach * reach) break;
+    }
+    return found;
+}
@@ -0,0 +1,349 @@
+#include "PointCloudOctree.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace PointCloudFormat;
+
+namespace
+{
+    // Beyond this the remaining points are (near-)duplicates; a leaf keeps
+    // kMaxNodePoints of them so every node fits one GPU slot.
+    constexpr std::uint32_t kMaxDepth = 24;
+
+    struct InputPoint {
+        float p[3];
+        std::uint8_t rgba[4];
+    };
+
+    struct BuildNode {
+        float min[3];
+        float size;
+        std::size_t begin, end;       ///< this subtree's points in 'order'
+        std::uint32_t kept = 0;       ///< the first 'kept' of them stay in this node
+        std::uint32_t depth = 0;
+        std::int32_t children[8] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+    };
+
+    std::atomic<std::uint64_t> s_nextId{ 1 };
+
+    int bitCount(std::uint32_t v)
+    {
+        int n = 0;
+        for (; v; v &= v - 1) ++n;
+        return n;
+    }
+
+    // Same rules as the URDF/SDF readers: no locale, no allocation.
+    bool parseNumber(const char*& str, const char* end, double& out)
+    {
+        while (str < end && (*str == ' ' || *str == '\t' || *str == ',' || *str == ';')) ++str;
+        if (str < end && *str == '+') ++str; // from_chars rejects a leading '+'
+        const auto [next, ec] = std::from_chars(str, end, out);
+        if (ec != std::errc()) return false;
+        str = next;
+        return true;
+    }
+
+    std::uint8_t colourByte(double v, bool unitRange)
+    {
+        return std::uint8_t(std::clamp(unitRange ? v * 255.0 : v, 0.0, 255.0) + 0.5);
+    }
+
+    // Reads "x y z", "x y z i", "x y z r g b" or "x y z i r g b" lines.
+    // Anything else (the .pts count line, headers, comments) is skipped.
+    bool readTextPoints(const std::string& path, std::vector<InputPoint>& out, float bounds[6],
+                        std::string* error, const std::function<void(float)>& progress)
+    {
+        QFile file(QString::fromStdString(path));
+        if (!file.open(QIODevice::ReadOnly)) {
+            if (error) *error = "Cannot open " + path;
+            return false;
+        }
+        const qint64 size = file.size();
+        const char* text = size > 0 ? reinterpret_cast<const char*>(file.map(0, size)) : nullptr;
+        if (!text) {
+            if (error) *error = "Cannot map " + path;
+            return false;
+        }
+
+        // Colours given as 0..1 floats rather than bytes are detected per line.
+        bounds[0] = bounds[1] = bounds[2] = std::numeric_limits<float>::max();
+        bounds[3] = bounds[4] = bounds[5] = std::numeric_limits<float>::lowest();
+        const char* const end = text + size;
+        std::size_t lines = 0;
+        for (const char* line = text; line < end;) {
+            const char* eol = static_cast<const char*>(std::memchr(line, '\n', std::size_t(end - line)));
+            if (!eol) eol = end;
+
+            double v[8];
+            int n = 0;
+            for (const char* p = line; n < 8 && parseNumber(p, eol, v[n]);) ++n;
+            if (n == 3 || n == 4 || n == 6 || n == 7) {
+                InputPoint point;
+                for (int k = 0; k < 3; ++k) {
+                    point.p[k] = float(v[k]);
+                    bounds[k] = std::min(bounds[k], point.p[k]);
+                    bounds[3 + k] = std::max(bounds[3 + k], point.p[k]);
+                }
+                if (n >= 6) {
+                    const double* rgb = v + (n == 7 ? 4 : 3);
+                    const bool unit = rgb[0] <= 1.0 && rgb[1] <= 1.0 && rgb[2] <= 1.0;
+                    for (int k = 0; k < 3; ++k) point.rgba[k] = colourByte(rgb[k], unit);
+                }
+                else {
+                    // Intensity alone (or nothing): grey. .pts intensity is -2048..2047.
+                    const double i = n == 4 ? (v[3] < 0.0 ? (v[3] + 2048.0) / 4095.0 : std::min(v[3], 1.0)) : 0.8;
+                    point.rgba[0] = point.rgba[1] = point.rgba[2] = colourByte(i, true);
+                }
+                point.rgba[3] = 255;
+                out.push_back(point);
+            }
+            line = eol + 1;
+            if (progress && (++lines & 0xFFFFF) == 0) progress(0.5f * float(line - text) / float(size));
+        }
+        if (out.empty()) {
+            if (error) *error = "No points found in " + path;
+            return false;
+        }
+        return true;
+    }
+
+    // Splits the tree under 'rootIndex' until every node holds at most
+    // kMaxNodePoints. Points are only reordered through 'order'.
+    void buildTree(const std::vector<InputPoint>& points, std::vector<std::uint32_t>& order,
+                   std::vector<BuildNode>& tree)
+    {
+        std::vector<std::uint32_t> occupied(kMaxNodePoints / 32);
+        std::vector<std::size_t> stack{ 0 };
+        while (!stack.empty()) {
+            const std::size_t index = stack.back();
+            stack.pop_back();
+            const BuildNode node = tree[index];   // copied: the push_backs below may reallocate
+            const std::size_t count = node.end - node.begin;
+
+            if (count <= kMaxNodePoints || node.depth >= kMaxDepth) {
+                tree[index].kept = std::uint32_t(std::min<std::size_t>(count, kMaxNodePoints));
+                continue;
+            }
+
+            // Subsample: the first point to land in each grid cell stays here.
+            std::fill(occupied.begin(), occupied.end(), 0u);
+            const float toCell = float(kGridCells) / node.size;
+            std::size_t keep = node.begin;
+            for (std::size_t i = node.begin; i < node.end; ++i) {
+                const float* p = points[order[i]].p;
+                std::uint32_t cell = 0;
+                for (int k = 2; k >= 0; --k) {
+                    const int c = std::clamp(int((p[k] - node.min[k]) * toCell), 0, kGridCells - 1);
+                    cell = cell * kGridCells + std::uint32_t(c);
+                }
+                std::uint32_t& word = occupied[cell >> 5];
+                const std::uint32_t bit = 1u << (cell & 31);
+                if (word & bit) continue;
+                word |= bit;
+                std::swap(order[keep++], order[i]);
+            }
+            tree[index].kept = std::uint32_t(keep - node.begin);
+
+            // The rest go to the octants, sorted by x, then y, then z halves.
+            const float half = 0.5f * node.size;
+            auto first = order.begin() + std::ptrdiff_t(keep);
+            auto last = order.begin() + std::ptrdiff_t(node.end);
+            auto splitAt = [&](auto b, auto e, int axis) {
+                const float mid = node.min[axis] + half;
+                return std::partition(b, e, [&](std::uint32_t i) { return points[i].p[axis] < mid; });
+            };
+            decltype(first) bounds[9];
+            bounds[0] = first;
+            bounds[8] = last;
+            bounds[4] = splitAt(first, last, 2);
+            bounds[2] = splitAt(bounds[0], bounds[4], 1);
+            bounds[6] = splitAt(bounds[4], bounds[8], 1);
+            for (int k = 0; k < 8; k += 2) bounds[k + 1] = splitAt(bounds[k], bounds[k + 2], 0);
+
+            for (int octant = 0; octant < 8; ++octant) {
+                if (bounds[octant] == bounds[octant + 1]) continue;
+                BuildNode child;
+                for (int k = 0; k < 3; ++k) child.min[k] = node.min[k] + ((octant >> k) & 1 ? half : 0.0f);
+                child.size = half;
+                child.begin = std::size_t(bounds[octant] - order.begin());
+                child.end = std::size_t(bounds[octant + 1] - order.begin());
+                child.depth = node.depth + 1;
+                tree[index].children[octant] = std::int32_t(tree.size());
+                stack.push_back(tree.size());
+                tree.push_back(child);
+            }
+        }
+    }
+}
+
+bool PointCloudOctree::build(const std::string& sourcePath, const std::string& outputPath,
+                             std::string* error, const std::function<void(float)>& progress)
+{
+    std::vector<InputPoint> points;
+    float bounds[6];
+    if (!readTextPoints(sourcePath, points, bounds, error, progress)) return false;
+
+    std::vector<std::uint32_t> order(points.size());
+    for (std::size_t i = 0; i < order.size(); ++i) order[i] = std::uint32_t(i);
+
+    std::vector<BuildNode> tree(1);
+    BuildNode& root = tree[0];
+    const float extent = std::max({ bounds[3] - bounds[0], bounds[4] - bounds[1], bounds[5] - bounds[2] });
+    root.size = extent > 0.0f ? extent * 1.0001f : 1.0f;   // the far faces stay inside
+    for (int k = 0; k < 3; ++k) root.min[k] = bounds[k];
+    root.begin = 0;
+    root.end = points.size();
+    buildTree(points, order, tree);
+    if (progress) progress(0.75f);
+
+    // Breadth-first, so each node's children are consecutive.
+    std::vector<std::uint32_t> bfs{ 0 };
+    for (std::size_t i = 0; i < bfs.size(); ++i)
+        for (std::int32_t c : tree[bfs[i]].children)
+            if (c >= 0) bfs.push_back(std::uint32_t(c));
+    std::vector<std::uint32_t> fileIndex(tree.size());
+    for (std::size_t i = 0; i < bfs.size(); ++i) fileIndex[bfs[i]] = std::uint32_t(i);
+
+    FileHeader header;
+    header.nodeCount = std::uint32_t(bfs.size());
+    std::copy(root.min, root.min + 3, header.rootMin);
+    header.rootSize = root.size;
+    header.nodesOffset = sizeof(FileHeader);
+    header.pointsOffset = header.nodesOffset + sizeof(Node) * bfs.size();
+
+    std::vector<Node> nodes(bfs.size());
+    for (std::size_t i = 0; i < bfs.size(); ++i) {
+        const BuildNode& b = tree[bfs[i]];
+        Node& n = nodes[i];
+        std::copy(b.min, b.min + 3, n.min);
+        n.size = b.size;
+        n.firstPoint = header.pointCount;
+        n.pointCount = b.kept;
+        n.depth = b.depth;
+        for (int octant = 0; octant < 8; ++octant) {
+            if (b.children[octant] < 0) continue;
+            if (!n.childMask) n.firstChild = fileIndex[std::size_t(b.children[octant])];
+            n.childMask |= 1u << octant;
+        }
+        header.pointCount += b.kept;
+    }
+
+    QSaveFile file(QString::fromStdString(outputPath));
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = "Cannot write " + outputPath;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(nodes.data()), qint64(sizeof(Node) * nodes.size()));
+
+    std::vector<PackedPoint> packed;
+    packed.reserve(kMaxNodePoints);
+    for (std::size_t i = 0; i < bfs.size(); ++i) {
+        const BuildNode& b = tree[bfs[i]];
+        const float toUnit = 65535.0f / b.size;
+        packed.clear();
+        for (std::size_t k = b.begin; k < b.begin + b.kept; ++k) {
+            const InputPoint& in = points[order[k]];
+            PackedPoint out{};
+            std::uint16_t* q[3] = { &out.x, &out.y, &out.z };
+            for (int a = 0; a < 3; ++a)
+                *q[a] = std::uint16_t(std::clamp((in.p[a] - b.min[a]) * toUnit + 0.5f, 0.0f, 65535.0f));
+            std::copy(in.rgba, in.rgba + 4, out.rgba);
+            packed.push_back(out);
+        }
+        file.write(reinterpret_cast<const char*>(packed.data()), qint64(sizeof(PackedPoint) * packed.size()));
+        if (progress && (i & 255) == 0) progress(0.75f + 0.25f * float(i) / float(bfs.size()));
+    }
+    if (!file.commit()) {
+        if (error) *error = "Cannot write " + outputPath + ": " + file.errorString().toStdString();
+        return false;
+    }
+    return true;
+}
+
+std::string PointCloudOctree::cachePathFor(const std::string& sourcePath)
+{
+    static const QString dir = [] {
+        const QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/pointclouds";
+        QDir().mkpath(path);
+        return path;
+    }();
+
+    const QString absolute = QFileInfo(QString::fromStdString(sourcePath)).absoluteFilePath();
+    std::uint64_t h = 1469598103934665603ull;
+    for (const char c : absolute.toUtf8()) { h ^= static_cast<unsigned char>(c); h *= 1099511628211ull; }
+    return QString("%1/%2.kpc").arg(dir).arg(h, 16, 16, QChar('0')).toStdString();
+}
+
+std::shared_ptr<PointCloudOctree> PointCloudOctree::open(const std::string& path, std::string* error)
+{
+    auto fail = [&](const std::string& why) {
+        if (error) *error = why;
+        return std::shared_ptr<PointCloudOctree>();
+    };
+
+    std::shared_ptr<PointCloudOctree> cloud(new PointCloudOctree);
+    cloud->m_path = path;
+    cloud->m_file = std::make_unique<QFile>(QString::fromStdString(path));
+    QFile& file = *cloud->m_file;
+    if (!file.open(QIODevice::ReadOnly)) return fail("Cannot open " + path);
+
+    FileHeader& header = cloud->m_header;
+    if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) != qint64(sizeof(header))
+        || header.magic != kMagic || header.version != kVersion || header.nodeCount == 0)
+        return fail(path + " is not a point cloud octree");
+
+    // Sizes are checked against the file before anything is allocated or
+    // mapped, in forms that cannot overflow.
+    const std::uint64_t fileSize = std::uint64_t(file.size());
+    if (header.pointsOffset > fileSize || header.pointCount > (fileSize - header.pointsOffset) / sizeof(PackedPoint)
+        || header.nodesOffset > fileSize || header.nodeCount > (fileSize - header.nodesOffset) / sizeof(Node))
+        return fail(path + " is truncated");
+    const std::uint64_t pointBytes = header.pointCount * sizeof(PackedPoint);
+
+    cloud->m_nodes.resize(header.nodeCount);
+    const qint64 nodeBytes = qint64(sizeof(Node)) * header.nodeCount;
+    if (!file.seek(qint64(header.nodesOffset))
+        || file.read(reinterpret_cast<char*>(cloud->m_nodes.data()), nodeBytes) != nodeBytes)
+        return fail(path + " is truncated");
+
+    // Every node's points lie in the point block, and its children are later
+    // nodes (the file is breadth-first), so traversals stay in range and end.
+    for (std::uint32_t i = 0; i < header.nodeCount; ++i) {
+        const Node& n = cloud->m_nodes[i];
+        if (n.firstPoint > header.pointCount || n.pointCount > header.pointCount - n.firstPoint)
+            return fail(path + " has a node outside its points");
+        if (n.childMask > 0xFFu || (n.childMask && (n.firstChild <= i
+                || std::uint64_t(n.firstChild) + bitCount(n.childMask) > header.nodeCount)))
+            return fail(path + " has a node with bad children");
+    }
+
+    // Mapped, not read: pages come in as nodes are first touched.
+    if (pointBytes > 0) {
+        cloud->m_points = reinterpret_cast<const PackedPoint*>(file.map(qint64(header.pointsOffset), qint64(pointBytes)));
+        if (!cloud->m_points) return fail("Cannot map " + path);
+    }
+    cloud->m_id = s_nextId.fetch_add(1, std::memory_order_relaxed);
+    return cloud;
+}
+
+PointCloudOctree::~PointCloudOctree() = default;   // closing the file unmaps it
+
+std::uint32_t PointCloudOctree::child(std::uint32_t node, int octant) const
+{
+    const Node& n = m_nodes[node];
+    if (!(n.childMask & (1u << octant))) return 0;
+    return n.firstChild + std::uint32_t(bitCount(n.childMask & ((1u << octant) - 1u)));
+}
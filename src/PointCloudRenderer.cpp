@@ -0,0 +1,441 @@
+#include "PointCloudRenderer.hpp"
+#include "GpuMemory.hpp"
+#include "GLStateCache.hpp"
+#include "RenderStats.hpp"
+#include "Shader.hpp"
+#include "components.hpp"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_3_Core>
+#include <entt/entt.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+PointCloudRenderer::~PointCloudRenderer()
+{
+    if (m_loader.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        m_loader.join();
+    }
+}
+
+std::size_t PointCloudRenderer::prepare(entt::registry& registry, const View& view)
+{
+    m_draws.clear();
+    m_commands.clear();
+    m_wanted.clear();
+    m_pointsSelected = 0;
+    if (!m_gl) return 0;
+
+    uploadLoaded(view.tick);
+
+    m_cloudScratch.clear();
+    for (auto [entity, cloud, xf] : registry.view<PointCloudComponent, TransformComponent>().each()) {
+        if (!cloud.octree) continue;
+        const auto* world = registry.try_get<WorldTransformComponent>(entity);
+        const glm::mat4 model = world ? world->matrix : xf.getTransform();
+        const float scale = std::max({ glm::length(glm::vec3(model[0])),
+            glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+        m_cloudScratch.push_back({ cloud.octree, model, scale });
+    }
+    if (m_cloudScratch.empty()) return 0;
+
+    // One queue across all clouds, so the budget goes where the error is largest.
+    using Node = PointCloudFormat::Node;
+    auto consider = [&](std::uint32_t cloudIndex, std::uint32_t nodeIndex) {
+        const CloudView& cloud = m_cloudScratch[cloudIndex];
+        const Node& node = cloud.octree->nodes()[nodeIndex];
+        const float half = 0.5f * node.size;
+        const glm::vec3 centre = glm::vec3(cloud.model * glm::vec4(glm::vec3(node.min[0], node.min[1], node.min[2]) + half, 1.0f));
+        const glm::vec3 extent = (glm::abs(glm::vec3(cloud.model[0])) + glm::abs(glm::vec3(cloud.model[1]))
+            + glm::abs(glm::vec3(cloud.model[2]))) * half;
+        if (!CullingSystem::isVisible(view.frustum, centre - extent, centre + extent)) return;
+
+        const float spacing = node.size / float(PointCloudFormat::kGridCells) * cloud.scale;
+        float error = spacing * view.pixelScale;
+        if (!view.orthographic) {
+            const float distance = glm::length(centre - view.camPos) - glm::length(extent);
+            error /= std::max(distance, 1e-3f);
+        }
+        m_candidates.push_back({ error, cloudIndex, nodeIndex });
+        std::push_heap(m_candidates.begin(), m_candidates.end());
+    };
+
+    m_candidates.clear();
+    for (std::uint32_t i = 0; i < m_cloudScratch.size(); ++i) consider(i, 0);
+
+    // Nodes beyond the slot count could never be resident together.
+    const std::size_t maxNodes = std::max<std::size_t>(1, m_vramBudget / std::size_t(kSlotBytes));
+    std::size_t budgetUsed = 0, nodesUsed = 0;
+    while (!m_candidates.empty() && budgetUsed < m_pointBudget && nodesUsed < maxNodes) {
+        std::pop_heap(m_candidates.begin(), m_candidates.end());
+        const Candidate candidate = m_candidates.back();
+        m_candidates.pop_back();
+
+        const CloudView& cloud = m_cloudScratch[candidate.cloud];
+        const PointCloudOctree& octree = *cloud.octree;
+        const Node& node = octree.nodes()[candidate.node];
+        budgetUsed += node.pointCount;
+        ++nodesUsed;
+
+        if (auto it = m_resident.find(keyOf(octree, candidate.node)); it != m_resident.end()) {
+            Slot& slot = m_slots[std::size_t(it->second)];
+            slot.lastUsed = view.tick;
+
+            const float size = node.size / 65535.0f;
+            PointCloudDrawGpu draw;
+            const glm::dvec3 origin(glm::dmat4(cloud.model) * glm::dvec4(node.min[0], node.min[1], node.min[2], 1.0));
+            draw.origin = glm::vec4(glm::vec3(origin - view.eye),
+                node.size / float(PointCloudFormat::kGridCells) * cloud.scale);
+            draw.axisX = glm::vec4(glm::vec3(cloud.model[0]) * size, 0.0f);
+            draw.axisY = glm::vec4(glm::vec3(cloud.model[1]) * size, 0.0f);
+            draw.axisZ = glm::vec4(glm::vec3(cloud.model[2]) * size, 0.0f);
+            m_draws.push_back(draw);
+
+            DrawArraysIndirectCommand command{};
+            command.count = node.pointCount;
+            command.instanceCount = 1;
+            command.first = GLuint(it->second) * PointCloudFormat::kMaxNodePoints;
+            command.baseInstance = GLuint(m_commands.size());
+            m_commands.push_back(command);
+            m_pointsSelected += node.pointCount;
+        }
+        else if (node.pointCount > 0) {
+            m_wanted.push_back({ cloud.octree, candidate.node, candidate.error });
+        }
+
+        // Levels are additive: children refine the parent whether or not it is loaded yet.
+        if (candidate.error > m_pixelError && node.childMask) {
+            for (int octant = 0; octant < 8; ++octant)
+                if (const std::uint32_t child = octree.child(candidate.node, octant))
+                    consider(candidate.cloud, child);
+        }
+    }
+
+    // Hand the loader this view's misses. The queue is rebuilt once per tick,
+    // so nodes the camera has moved away from stop being loaded.
+    if (!m_wanted.empty() || m_queueTick != view.tick) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_queueTick != view.tick) {
+                for (const Request& request : m_queue) m_requested.erase(keyOf(*request.octree, request.node));
+                m_queue.clear();
+                m_queueTick = view.tick;
+            }
+            for (Request& request : m_wanted) {
+                if (!m_requested.insert(keyOf(*request.octree, request.node)).second) continue;
+                m_queue.push_back(std::move(request));
+                std::push_heap(m_queue.begin(), m_queue.end());
+            }
+        }
+        m_wake.notify_one();
+        if (!m_loader.joinable() && !m_queue.empty()) m_loader = std::thread(&PointCloudRenderer::loaderMain, this);
+    }
+    return m_commands.size();
+}
+
+void PointCloudRenderer::uploadLoaded(std::uint64_t tick)
+{
+    std::vector<Loaded> loaded;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const std::size_t count = std::min<std::size_t>(m_loaded.size(), kUploadsPerView);
+        loaded.assign(std::make_move_iterator(m_loaded.begin()), std::make_move_iterator(m_loaded.begin() + std::ptrdiff_t(count)));
+        m_loaded.erase(m_loaded.begin(), m_loaded.begin() + std::ptrdiff_t(count));
+    }
+    if (loaded.empty()) return;
+    m_wake.notify_one();   // the loader may be waiting for room
+
+    int uploads = 0;
+    for (Loaded& node : loaded) {
+        m_requested.erase(node.key);
+        const int slot = acquireSlot(tick);
+        if (slot < 0) continue;   // everything resident is on screen: asked for again next view
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, m_pool);
+        m_gl->glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(slot) * kSlotBytes,
+            GLsizeiptr(node.points.size() * sizeof(PointCloudFormat::PackedPoint)), node.points.data());
+        RenderStats::upload(node.points.size() * sizeof(PointCloudFormat::PackedPoint));
+        m_slots[std::size_t(slot)] = { node.key, tick, true };
+        m_resident[node.key] = slot;
+        ++uploads;
+    }
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (!uploads) return;
+
+    // Other contexts of the group wait for these writes on the GPU before drawing.
+    if (m_uploadFence) m_gl->glDeleteSync(m_uploadFence);
+    m_uploadFence = m_gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_uploadContext = QOpenGLContext::currentContext();
+}
+
+int PointCloudRenderer::acquireSlot(std::uint64_t tick)
+{
+    for (std::size_t i = 0; i < m_slots.size(); ++i)
+        if (!m_slots[i].used) return int(i);
+    const std::size_t grownFrom = m_slots.size();
+    if (growPool()) return int(grownFrom);
+
+    // Least recently drawn, and not by any view of this tick or the last.
+    int victim = -1;
+    for (std::size_t i = 0; i < m_slots.size(); ++i) {
+        const Slot& slot = m_slots[i];
+        if (slot.lastUsed + 1 >= tick) continue;
+        if (victim < 0 || slot.lastUsed < m_slots[std::size_t(victim)].lastUsed) victim = int(i);
+    }
+    if (victim >= 0) {
+        m_resident.erase(m_slots[std::size_t(victim)].key);
+        m_slots[std::size_t(victim)].used = false;
+    }
+    return victim;
+}
+
+bool PointCloudRenderer::growPool()
+{
+    const std::size_t maxSlots = m_vramBudget / std::size_t(kSlotBytes);
+    const std::size_t oldSlots = m_slots.size();
+    const std::size_t newSlots = std::min(maxSlots, oldSlots ? oldSlots * 2 : kInitialSlots);
+    if (newSlots <= oldSlots) return false;
+
+    GLuint pool = 0;
+    m_gl->glGenBuffers(1, &pool);
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, pool);
+    GpuMemory::bufferData(m_gl, GL_COPY_WRITE_BUFFER, pool, GLsizeiptr(newSlots) * kSlotBytes, nullptr, GL_STATIC_DRAW,
+        GpuMemory::Category::PointClouds);
+    if (m_pool) {
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, m_pool);
+        m_gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(oldSlots) * kSlotBytes);
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        GpuMemory::deleteBuffers(m_gl, 1, &m_pool);   // other contexts' VAOs keep it alive until they re-point
+    }
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    m_pool = pool;
+    ++m_poolGeneration;
+    m_slots.resize(newSlots);
+    return true;
+}
+
+std::size_t PointCloudRenderer::trimPool(std::size_t bytes, std::uint64_t tick)
+{
+    if (!m_gl || !m_pool || bytes == 0) return 0;
+
+    std::vector<int> kept;
+    std::size_t pinned = 0;
+    for (std::size_t i = 0; i < m_slots.size(); ++i) {
+        if (!m_slots[i].used) continue;
+        kept.push_back(int(i));
+        if (m_slots[i].lastUsed + 1 >= tick) ++pinned;
+    }
+    const std::size_t oldSlots = m_slots.size();
+    const std::size_t cut = (bytes + std::size_t(kSlotBytes) - 1) / std::size_t(kSlotBytes);
+    const std::size_t newSlots = std::max({ oldSlots > cut ? oldSlots - cut : 0, pinned, kInitialSlots });
+    if (newSlots >= oldSlots) return 0;
+
+    std::sort(kept.begin(), kept.end(), [&](int a, int b) {
+        return m_slots[std::size_t(a)].lastUsed > m_slots[std::size_t(b)].lastUsed;
+    });
+    if (kept.size() > newSlots) kept.resize(newSlots);
+
+    waitForUploads();
+    GLuint pool = 0;
+    m_gl->glGenBuffers(1, &pool);
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, pool);
+    GpuMemory::bufferData(m_gl, GL_COPY_WRITE_BUFFER, pool, GLsizeiptr(newSlots) * kSlotBytes, nullptr, GL_STATIC_DRAW,
+        GpuMemory::Category::PointClouds);
+    m_gl->glBindBuffer(GL_COPY_READ_BUFFER, m_pool);
+
+    std::vector<Slot> slots(newSlots);
+    m_resident.clear();
+    for (std::size_t j = 0; j < kept.size(); ++j) {
+        const Slot& slot = m_slots[std::size_t(kept[j])];
+        m_gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            GLintptr(kept[j]) * kSlotBytes, GLintptr(j) * kSlotBytes, kSlotBytes);
+        slots[j] = slot;
+        m_resident[slot.key] = int(j);
+    }
+    m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    GpuMemory::deleteBuffers(m_gl, 1, &m_pool);
+    m_pool = pool;
+    ++m_poolGeneration;
+    m_slots = std::move(slots);
+    m_vramBudget = newSlots * std::size_t(kSlotBytes);
+
+    // Other contexts of the group wait for the copies, as for uploads.
+    if (m_uploadFence) m_gl->glDeleteSync(m_uploadFence);
+    m_uploadFence = m_gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_uploadContext = QOpenGLContext::currentContext();
+    return (oldSlots - newSlots) * std::size_t(kSlotBytes);
+}
+
+void PointCloudRenderer::waitForUploads()
+{
+    if (m_uploadFence && m_uploadContext != QOpenGLContext::currentContext())
+        m_gl->glWaitSync(m_uploadFence, 0, GL_TIMEOUT_IGNORED);
+}
+
+void PointCloudRenderer::uploadSelection(ContextState& context)
+{
+    if (context.drawBuffer == 0) {
+        m_gl->glGenBuffers(1, &context.drawBuffer);
+        m_gl->glGenBuffers(1, &context.indirectBuffer);
+    }
+    auto upload = [&](GLenum target, GLuint buffer, GLsizeiptr& capacity, const void* data, GLsizeiptr bytes) {
+        m_gl->glBindBuffer(target, buffer);
+        if (bytes > capacity) {
+            capacity = std::max(bytes, capacity * 2);
+            GpuMemory::bufferData(m_gl, target, buffer, capacity, nullptr, GL_DYNAMIC_DRAW, GpuMemory::Category::PointClouds);
+        }
+        m_gl->glBufferSubData(target, 0, bytes, data);
+        RenderStats::upload(std::uint64_t(bytes));
+    };
+    upload(GL_ARRAY_BUFFER, context.drawBuffer, context.drawCapacity,
+        m_draws.data(), GLsizeiptr(m_draws.size() * sizeof(PointCloudDrawGpu)));
+    upload(GL_DRAW_INDIRECT_BUFFER, context.indirectBuffer, context.indirectCapacity,
+        m_commands.data(), GLsizeiptr(m_commands.size() * sizeof(DrawArraysIndirectCommand)));
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);   // the indirect buffer stays bound for draw()
+}
+
+void PointCloudRenderer::draw(ContextState& context, GLStateCache& state)
+{
+    if (m_commands.empty() || !m_gl) return;
+
+    waitForUploads();
+    uploadSelection(context);
+
+    if (context.vao == 0) {
+        m_gl->glGenVertexArrays(1, &context.vao);
+
+        // Per-node records (locations 2-5); baseInstance selects a node's.
+        state.bindVertexArray(context.vao);
+        m_gl->glBindBuffer(GL_ARRAY_BUFFER, context.drawBuffer);
+        for (GLuint i = 0; i < 4; ++i) {
+            m_gl->glEnableVertexAttribArray(2 + i);
+            m_gl->glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, sizeof(PointCloudDrawGpu),
+                reinterpret_cast<const void*>(i * sizeof(glm::vec4)));
+            m_gl->glVertexAttribDivisor(2 + i, 1);
+        }
+    }
+    state.bindVertexArray(context.vao);
+    if (context.poolGeneration != m_poolGeneration) {
+        m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_pool);
+        const GLsizei stride = sizeof(PointCloudFormat::PackedPoint);
+        m_gl->glEnableVertexAttribArray(0);
+        m_gl->glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_FALSE, stride,
+            reinterpret_cast<const void*>(offsetof(PointCloudFormat::PackedPoint, x)));
+        m_gl->glEnableVertexAttribArray(1);
+        m_gl->glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+            reinterpret_cast<const void*>(offsetof(PointCloudFormat::PackedPoint, rgba)));
+        context.poolGeneration = m_poolGeneration;
+    }
+
+    m_gl->glMultiDrawArraysIndirect(GL_POINTS, nullptr, GLsizei(m_commands.size()), 0);
+    RenderStats::draw(m_commands.size());
+
+    m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    state.bindVertexArray(0);
+}
+
+bool PointCloudRenderer::splat(ContextState& context, GLStateCache& state, Shader& program, int passes, int width, int height)
+{
+    if (m_commands.empty() || !m_gl || width <= 0 || height <= 0) return false;
+
+    waitForUploads();
+    uploadSelection(context);
+    m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    // The indirect commands are the dispatch's node table: one row of
+    // workgroups per node, as wide as the fullest node.
+    std::uint32_t widest = 0;
+    for (const DrawArraysIndirectCommand& command : m_commands) widest = std::max(widest, command.count);
+    const GLuint groupsX = (widest + kSplatGroupSize - 1) / kSplatGroupSize;
+
+    if (context.splatTarget == 0) m_gl->glGenBuffers(1, &context.splatTarget);
+    const GLsizeiptr targetBytes = GLsizeiptr(width) * GLsizeiptr(height) * GLsizeiptr(2 * sizeof(GLuint));
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, context.splatTarget);
+    if (targetBytes > context.splatCapacity) {
+        context.splatCapacity = targetBytes;
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, context.splatTarget, targetBytes, nullptr, GL_DYNAMIC_COPY,
+            GpuMemory::Category::PointClouds);
+    }
+    const GLuint empty = 0xFFFFFFFFu;
+    m_gl->glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, targetBytes, GL_RED_INTEGER, GL_UNSIGNED_INT, &empty);
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPointSplatTargetBinding, context.splatTarget);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPointSplatPointsBinding, m_pool);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPointSplatDrawsBinding, context.drawBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPointSplatCommandsBinding, context.indirectBuffer);
+    state.use(program);
+    m_gl->glUniform2i(program.uniformLocation("u_size"), width, height);
+
+    const GLuint nodes = GLuint(m_commands.size());
+    for (int pass = 0; pass < passes; ++pass) {
+        program.setInt("u_pass", pass);
+        for (GLuint offset = 0; offset < nodes; offset += kMaxSplatNodesPerDispatch) {
+            program.setUInt("u_nodeOffset", offset);
+            m_gl->glDispatchCompute(groupsX, std::min(nodes - offset, kMaxSplatNodesPerDispatch), 1);
+            RenderStats::dispatch();
+        }
+        m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    for (GLuint binding : { kPointSplatTargetBinding, kPointSplatPointsBinding, kPointSplatDrawsBinding, kPointSplatCommandsBinding })
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+    return true;
+}
+
+void PointCloudRenderer::destroyContext(ContextState& context)
+{
+    if (!m_gl) return;
+    if (context.vao) m_gl->glDeleteVertexArrays(1, &context.vao);
+    if (context.drawBuffer) GpuMemory::deleteBuffers(m_gl, 1, &context.drawBuffer);
+    if (context.indirectBuffer) GpuMemory::deleteBuffers(m_gl, 1, &context.indirectBuffer);
+    if (context.splatTarget) GpuMemory::deleteBuffers(m_gl, 1, &context.splatTarget);
+    context = ContextState{};
+}
+
+void PointCloudRenderer::destroy()
+{
+    if (!m_gl) return;
+    if (m_pool) GpuMemory::deleteBuffers(m_gl, 1, &m_pool);
+    m_pool = 0;
+    ++m_poolGeneration;
+    if (m_uploadFence) m_gl->glDeleteSync(m_uploadFence);
+    m_uploadFence = nullptr;
+    m_uploadContext = nullptr;
+    m_slots.clear();
+    m_resident.clear();
+    m_draws.clear();
+    m_commands.clear();
+}
+
+void PointCloudRenderer::loaderMain()
+{
+    for (;;) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || (!m_queue.empty() && m_loaded.size() < kMaxLoaded); });
+            if (m_stop) return;
+            std::pop_heap(m_queue.begin(), m_queue.end());
+            request = std::move(m_queue.back());
+            m_queue.pop_back();
+        }
+
+        // Touching the mapping is the disk read; keep it outside the lock.
+        const std::uint32_t count = request.octree->nodes()[request.node].pointCount;
+        const PointCloudFormat::PackedPoint* points = request.octree->points(request.node);
+        Loaded loaded{ keyOf(*request.octree, request.node),
+            std::vector<PointCloudFormat::PackedPoint>(points, points + count) };
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loaded.push_back(std::move(loaded));
+    }
+}
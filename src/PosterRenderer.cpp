@@ -0,0 +1,112 @@
+#include "PosterRenderer.hpp"
+#include "OffscreenRenderer.hpp"
+#include "PosterWriter.hpp"
+#include "RenderingSystem.hpp"
+
+#include <QImage>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    float halton(int index, int base)
+    {
+        float f = 1.0f, r = 0.0f;
+        for (; index > 0; index /= base) {
+            f /= float(base);
+            r += f * float(index % base);
+        }
+        return r;
+    }
+
+    const std::array<float, 256>& srgbToLinear()
+    {
+        static const std::array<float, 256> table = [] {
+            std::array<float, 256> t{};
+            for (int i = 0; i < 256; ++i) {
+                const float s = float(i) / 255.0f;
+                t[std::size_t(i)] = s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+            }
+            return t;
+        }();
+        return table;
+    }
+}
+
+bool PosterRenderer::render(entt::registry& registry, entt::entity cameraEntity, const Settings& settings)
+{
+    m_error.clear();
+    const int tile = std::max(16, settings.tile);
+    const int samples = std::max(1, settings.samples);
+    const int frameSize = tile + 2 * kGutter;
+
+    PosterWriter writer;
+    if (!writer.open(settings.path, settings.width, settings.height, tile)) {
+        m_error = writer.errorString();
+        return false;
+    }
+    OffscreenRenderer offscreen(m_renderer);
+    if (!offscreen.create(frameSize, frameSize)) {
+        m_error = QStringLiteral("No OpenGL 4.3 context");
+        return false;
+    }
+
+    const auto antiAliasing = m_renderer.antiAliasing();
+    const int msaaSamples = m_renderer.msaaSamples();
+    const std::uint32_t postEffects = m_renderer.postEffects();
+    const bool dynamicResolution = m_renderer.dynamicResolution();
+    m_renderer.setAntiAliasing(RenderingSystem::AntiAliasing::None);
+    m_renderer.setPostEffects(postEffects & ~std::uint32_t(RenderingSystem::PostVignette));
+    m_renderer.setDynamicResolution(false);
+
+    // Frames come back in order, a few behind; frame f is sample f % samples
+    // of tile f / samples, counted from 'first'.
+    const int tilesX = writer.tilesX(), tilesY = writer.tilesY();
+    const std::uint64_t first = offscreen.framesRendered();
+    std::vector<float> sum(std::size_t(tile) * std::size_t(tile) * 3);
+    bool written = true;
+    offscreen.setFrameSink([&](const QImage& frame, std::uint64_t frameIndex) {
+        const std::uint64_t n = frameIndex - first;
+        const int sample = int(n % std::uint64_t(samples)), index = int(n / std::uint64_t(samples));
+        const int tx = index % tilesX, ty = index / tilesX;
+        const int w = std::min(tile, settings.width - tx * tile), h = std::min(tile, settings.height - ty * tile);
+        const auto& linear = srgbToLinear();
+        if (sample == 0) std::fill(sum.begin(), sum.end(), 0.0f);
+        for (int y = 0; y < h; ++y) {
+            const uchar* src = frame.constScanLine(kGutter + y) + std::size_t(kGutter) * 4;
+            float* dst = sum.data() + std::size_t(y) * std::size_t(w) * 3;
+            for (int x = 0; x < w; ++x)
+                for (int c = 0; c < 3; ++c) dst[x * 3 + c] += linear[src[x * 4 + c]];
+        }
+        if (sample + 1 < samples) return;
+        const float scale = 1.0f / float(samples);
+        for (std::size_t i = 0; i < std::size_t(w) * std::size_t(h) * 3; ++i) sum[i] *= scale;
+        written = writer.write(tx, ty, sum.data(), std::size_t(w) * 3) && written;
+    });
+
+    for (int ty = 0; ty < tilesY && written; ++ty)
+        for (int tx = 0; tx < tilesX && written; ++tx)
+            for (int s = 0; s < samples; ++s) {
+                // Halton (2, 3) sub-pixel offsets; the first sample is centred.
+                const glm::vec2 jitter = s == 0 ? glm::vec2(0.0f) : glm::vec2(halton(s, 2), halton(s, 3)) - 0.5f;
+                m_renderer.setProjectionWindow(glm::ivec2(settings.width, settings.height),
+                    glm::ivec4(tx * tile - kGutter, ty * tile - kGutter, frameSize, frameSize), jitter);
+                offscreen.renderFrame(registry, cameraEntity, 0.0f);
+            }
+    offscreen.finish();
+
+    m_renderer.setProjectionWindow(glm::ivec2(0), glm::ivec4(0));
+    m_renderer.setAntiAliasing(antiAliasing, msaaSamples);
+    m_renderer.setPostEffects(postEffects);
+    m_renderer.setDynamicResolution(dynamicResolution);
+
+    if (!written || !writer.close()) {
+        m_error = writer.errorString();
+        writer.abort();
+        return false;
+    }
+    return true;
+}
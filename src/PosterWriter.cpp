@@ -0,0 +1,400 @@
+#include "PosterWriter.hpp"
+#include "ThreadPool.hpp"
+
+#include <QSaveFile>
+#include <glm/gtc/packing.hpp>
+#include <zlib.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    constexpr int kSrgbLutSize = 16384;
+
+    // Linear [0, 1] to 8-bit sRGB, sampled finely enough for the darks.
+    const std::array<std::uint8_t, kSrgbLutSize>& srgbLut()
+    {
+        static const std::array<std::uint8_t, kSrgbLutSize> lut = [] {
+            std::array<std::uint8_t, kSrgbLutSize> t{};
+            for (int i = 0; i < kSrgbLutSize; ++i) {
+                const double c = double(i) / double(kSrgbLutSize - 1);
+                const double s = c <= 0.0031308 ? 12.92 * c : 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+                t[std::size_t(i)] = std::uint8_t(std::lround(s * 255.0));
+            }
+            return t;
+        }();
+        return lut;
+    }
+
+    std::uint8_t toSrgb(float linear)
+    {
+        const float c = std::clamp(linear, 0.0f, 1.0f);
+        return srgbLut()[std::size_t(c * float(kSrgbLutSize - 1) + 0.5f)];
+    }
+
+    void putBe32(std::uint8_t* p, std::uint32_t v)
+    {
+        p[0] = std::uint8_t(v >> 24); p[1] = std::uint8_t(v >> 16); p[2] = std::uint8_t(v >> 8); p[3] = std::uint8_t(v);
+    }
+
+    template<class T>
+    void putLe(std::vector<std::uint8_t>& out, T v)
+    {
+        for (std::size_t i = 0; i < sizeof(T); ++i) out.push_back(std::uint8_t(std::uint64_t(v) >> (8 * i)));
+    }
+
+    void putString(std::vector<std::uint8_t>& out, const char* s)
+    {
+        out.insert(out.end(), s, s + std::strlen(s) + 1);
+    }
+
+    // name, type, then the value's byte count and the value (OpenEXR header attribute).
+    void putAttribute(std::vector<std::uint8_t>& out, const char* name, const char* type, const std::vector<std::uint8_t>& value)
+    {
+        putString(out, name);
+        putString(out, type);
+        putLe(out, std::int32_t(value.size()));
+        out.insert(out.end(), value.begin(), value.end());
+    }
+
+    int paeth(int a, int b, int c)
+    {
+        const int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+    }
+
+    // One PNG row (3 bytes a pixel) filtered into out[1..], out[0] the filter
+    // type: whichever of the five gives the smallest sum of magnitudes.
+    void filterRow(const std::uint8_t* row, const std::uint8_t* above, std::size_t bytes, std::uint8_t* out,
+        std::vector<std::uint8_t>& scratch)
+    {
+        scratch.resize(bytes);
+        long best = -1;
+        for (int type = 0; type < 5; ++type) {
+            long cost = 0;
+            for (std::size_t i = 0; i < bytes; ++i) {
+                const int a = i >= 3 ? row[i - 3] : 0, b = above ? above[i] : 0, c = i >= 3 && above ? above[i - 3] : 0;
+                const int predicted = type == 0 ? 0 : type == 1 ? a : type == 2 ? b : type == 3 ? (a + b) / 2 : paeth(a, b, c);
+                const std::uint8_t v = std::uint8_t(row[i] - predicted);
+                scratch[i] = v;
+                cost += v < 128 ? v : 256 - v;
+            }
+            if (best < 0 || cost < best) {
+                best = cost;
+                out[0] = std::uint8_t(type);
+                std::memcpy(out + 1, scratch.data(), bytes);
+            }
+        }
+    }
+}
+
+struct PosterWriter::Band {
+    int row = 0;
+    int height = 0;
+    int tiles = 0;                                ///< written so far
+    std::vector<std::uint8_t> pixels;             ///< RGB8, width x height
+};
+
+PosterWriter::PosterWriter() = default;
+
+PosterWriter::~PosterWriter()
+{
+    abort();
+}
+
+QString PosterWriter::errorString() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_error;
+}
+
+void PosterWriter::fail(const QString& error)
+{
+    if (m_error.isEmpty()) m_error = error;
+}
+
+bool PosterWriter::open(const QString& path, int width, int height, int tileSize)
+{
+    abort();
+    m_error.clear();
+    if (width <= 0 || height <= 0 || tileSize <= 0) {
+        m_error = QStringLiteral("Empty poster");
+        return false;
+    }
+    m_width = width;
+    m_height = height;
+    m_tile = tileSize;
+    m_exr = path.endsWith(QLatin1String(".exr"), Qt::CaseInsensitive);
+    m_inFlight = 0;
+    m_adler = adler32(0, nullptr, 0);
+    m_nextBand = 0;
+    m_deflated.clear();
+    m_lastRow.clear();
+    m_band.reset();
+
+    m_file = std::make_unique<QSaveFile>(path);
+    if (!m_file->open(QIODevice::WriteOnly)) {
+        m_error = m_file->errorString();
+        m_file.reset();
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return writeHeader();
+}
+
+bool PosterWriter::writeRaw(const void* data, std::size_t bytes)
+{
+    if (!m_error.isEmpty()) return false;
+    if (m_file->write(static_cast<const char*>(data), qint64(bytes)) != qint64(bytes)) {
+        fail(m_file->errorString());
+        return false;
+    }
+    return true;
+}
+
+bool PosterWriter::writePngChunk(const char type[4], const std::uint8_t* data, std::size_t bytes)
+{
+    // Chunks hold at most 2^31 - 1 bytes; split long runs.
+    constexpr std::size_t kMaxChunk = std::size_t(1) << 30;
+    do {
+        const std::size_t n = std::min(bytes, kMaxChunk);
+        std::uint8_t head[8];
+        putBe32(head, std::uint32_t(n));
+        std::memcpy(head + 4, type, 4);
+        uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+        if (n > 0) crc = crc32(crc, data, uInt(n));   // a null buffer would restart it
+        std::uint8_t tail[4];
+        putBe32(tail, std::uint32_t(crc));
+        if (!writeRaw(head, 8) || !writeRaw(data, n) || !writeRaw(tail, 4)) return false;
+        data += n;
+        bytes -= n;
+    } while (bytes > 0);
+    return true;
+}
+
+bool PosterWriter::writeHeader()
+{
+    if (!m_exr) {
+        static const std::uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        std::uint8_t ihdr[13] = {};
+        putBe32(ihdr, std::uint32_t(m_width));
+        putBe32(ihdr + 4, std::uint32_t(m_height));
+        ihdr[8] = 8;       // bits per channel
+        ihdr[9] = 2;       // RGB
+        static const std::uint8_t srgb[1] = { 0 };   // perceptual
+        static const std::uint8_t zlibHeader[2] = { 0x78, 0x9C };
+        return writeRaw(signature, 8) && writePngChunk("IHDR", ihdr, 13) && writePngChunk("sRGB", srgb, 1)
+            && writePngChunk("IDAT", zlibHeader, 2);
+    }
+
+    std::vector<std::uint8_t> header = { 0x76, 0x2F, 0x31, 0x01 };
+    putLe(header, std::int32_t(2 | 0x200));   // version 2, single-part tiled
+
+    std::vector<std::uint8_t> value;
+    for (const char* channel : { "B", "G", "R" }) {   // sorted by name
+        putString(value, channel);
+        putLe(value, std::int32_t(1));                // HALF
+        putLe(value, std::uint32_t(0));               // pLinear, reserved
+        putLe(value, std::int32_t(1));
+        putLe(value, std::int32_t(1));
+    }
+    value.push_back(0);
+    putAttribute(header, "channels", "chlist", value);
+    putAttribute(header, "compression", "compression", { 3 });   // ZIP
+    value.clear();
+    for (const std::int32_t v : { 0, 0, m_width - 1, m_height - 1 }) putLe(value, v);
+    putAttribute(header, "dataWindow", "box2i", value);
+    putAttribute(header, "displayWindow", "box2i", value);
+    putAttribute(header, "lineOrder", "lineOrder", { 2 });       // RANDOM_Y: tiles land as they finish
+    value.clear();
+    putLe(value, std::uint32_t(0x3F800000));                     // 1.0f
+    putAttribute(header, "pixelAspectRatio", "float", value);
+    putAttribute(header, "screenWindowWidth", "float", value);
+    putAttribute(header, "screenWindowCenter", "v2f", std::vector<std::uint8_t>(8, 0));
+    value.clear();
+    putLe(value, std::uint32_t(m_tile));
+    putLe(value, std::uint32_t(m_tile));
+    value.push_back(0);                                          // ONE_LEVEL, round down
+    putAttribute(header, "tiles", "tiledesc", value);
+    header.push_back(0);
+
+    m_tableAt = std::int64_t(header.size());
+    m_offsets.assign(std::size_t(tilesX()) * std::size_t(tilesY()), 0);
+    header.resize(header.size() + m_offsets.size() * 8, 0);      // filled in by close()
+    return writeRaw(header.data(), header.size());
+}
+
+void PosterWriter::waitBelow(int inFlight)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return m_inFlight < inFlight; });
+}
+
+bool PosterWriter::write(int tileX, int tileY, const float* rgb, std::size_t stride)
+{
+    if (!m_file || tileX < 0 || tileY < 0 || tileX >= tilesX() || tileY >= tilesY()) return false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error.isEmpty()) return false;
+    }
+    const int x0 = tileX * m_tile, y0 = tileY * m_tile;
+    const int w = std::min(m_tile, m_width - x0), h = std::min(m_tile, m_height - y0);
+
+    if (m_exr) {
+        // Converted here so the caller can reuse its tile; the rest on a worker.
+        auto halves = std::make_shared<std::vector<std::uint16_t>>(std::size_t(w) * std::size_t(h) * 3);
+        for (int y = 0; y < h; ++y) {
+            const float* src = rgb + std::size_t(y) * stride;
+            std::uint16_t* line = halves->data() + std::size_t(y) * std::size_t(w) * 3;
+            for (int x = 0; x < w; ++x)
+                for (int c = 0; c < 3; ++c)   // B, G, R planes per scanline
+                    line[std::size_t(2 - c) * std::size_t(w) + std::size_t(x)] = glm::packHalf1x16(src[std::size_t(x) * 3 + std::size_t(c)]);
+        }
+        waitBelow(int(std::max(2u, ThreadPool::shared().size())));
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_inFlight;
+        }
+        ThreadPool::shared().submit([this, tileX, tileY, halves]() {
+            // OpenEXR's ZIP: bytes split into even and odd halves, delta coded, zlib.
+            const std::size_t n = halves->size() * 2;
+            const auto* raw = reinterpret_cast<const std::uint8_t*>(halves->data());
+            std::vector<std::uint8_t> split(n);
+            for (std::size_t i = 0; i < n; ++i) split[(i & 1) ? (n + 1) / 2 + i / 2 : i / 2] = raw[i];
+            for (std::size_t i = n; i-- > 1;) split[i] = std::uint8_t(int(split[i]) - int(split[i - 1]) + 128);
+            uLongf packedBytes = compressBound(uLong(n));
+            std::vector<std::uint8_t> chunk(20 + packedBytes);
+            const bool packed = compress(chunk.data() + 20, &packedBytes, split.data(), uLong(n)) == Z_OK && packedBytes < n;
+            if (!packed) std::memcpy(chunk.data() + 20, raw, n);   // stored as is when that is smaller
+            const std::uint32_t dataBytes = std::uint32_t(packed ? packedBytes : n);
+            chunk.resize(20 + dataBytes);
+            const std::int32_t fields[5] = { tileX, tileY, 0, 0, std::int32_t(dataBytes) };
+            for (int f = 0; f < 5; ++f)
+                for (int b = 0; b < 4; ++b) chunk[std::size_t(f * 4 + b)] = std::uint8_t(std::uint32_t(fields[f]) >> (8 * b));
+            tileDone(tileX, tileY, chunk);
+            });
+        return true;
+    }
+
+    if (!m_band || m_band->row != tileY) {
+        if (m_band) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            fail(QStringLiteral("PNG tiles must arrive a row at a time"));
+            return false;
+        }
+        m_band = std::make_unique<Band>();
+        m_band->row = tileY;
+        m_band->height = h;
+        m_band->pixels.resize(std::size_t(m_width) * std::size_t(h) * 3);
+    }
+    for (int y = 0; y < h; ++y) {
+        const float* src = rgb + std::size_t(y) * stride;
+        std::uint8_t* dst = m_band->pixels.data() + (std::size_t(y) * std::size_t(m_width) + std::size_t(x0)) * 3;
+        for (std::size_t i = 0; i < std::size_t(w) * 3; ++i) dst[i] = toSrgb(src[i]);
+    }
+    if (++m_band->tiles == tilesX()) submitBand();
+    return true;
+}
+
+void PosterWriter::submitBand()
+{
+    std::shared_ptr<Band> band(std::move(m_band));
+    const std::size_t rowBytes = std::size_t(m_width) * 3;
+    auto above = std::make_shared<std::vector<std::uint8_t>>(std::move(m_lastRow));
+    m_lastRow.assign(band->pixels.end() - std::ptrdiff_t(rowBytes), band->pixels.end());
+    const bool last = band->row == tilesY() - 1;
+
+    waitBelow(kBandsInFlight);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_inFlight;
+    }
+    ThreadPool::shared().submit([this, band, above, rowBytes, last]() {
+        std::vector<std::uint8_t> filtered((rowBytes + 1) * std::size_t(band->height)), scratch;
+        for (int y = 0; y < band->height; ++y) {
+            const std::uint8_t* row = band->pixels.data() + std::size_t(y) * rowBytes;
+            const std::uint8_t* up = y > 0 ? row - rowBytes : above->empty() ? nullptr : above->data();
+            filterRow(row, up, rowBytes, filtered.data() + std::size_t(y) * (rowBytes + 1), scratch);
+        }
+        band->pixels = {};
+
+        Deflated out;
+        out.rawBytes = filtered.size();
+        out.adler = std::uint32_t(adler32(adler32(0, nullptr, 0), filtered.data(), uInt(filtered.size())));
+        z_stream z{};
+        bool ok = deflateInit2(&z, 6, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK;   // raw: no zlib header
+        out.bytes.resize(deflateBound(&z, uLong(filtered.size())) + 16);
+        z.next_in = filtered.data();
+        z.avail_in = uInt(filtered.size());
+        z.next_out = out.bytes.data();
+        z.avail_out = uInt(out.bytes.size());
+        // A sync flush ends on a byte boundary without closing the stream, so the next band's run follows on.
+        ok = ok && deflate(&z, last ? Z_FINISH : Z_SYNC_FLUSH) == (last ? Z_STREAM_END : Z_OK);
+        out.bytes.resize(out.bytes.size() - z.avail_out);
+        deflateEnd(&z);
+        if (!ok) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            fail(QStringLiteral("Deflate failed"));
+        }
+        bandDone(band->row, std::move(out));
+        });
+}
+
+void PosterWriter::bandDone(int row, Deflated deflated)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_deflated.emplace(row, std::move(deflated));
+    for (auto it = m_deflated.find(m_nextBand); it != m_deflated.end(); it = m_deflated.find(m_nextBand)) {
+        writePngChunk("IDAT", it->second.bytes.data(), it->second.bytes.size());
+        m_adler = std::uint32_t(adler32_combine(m_adler, it->second.adler, z_off_t(it->second.rawBytes)));
+        m_deflated.erase(it);
+        ++m_nextBand;
+    }
+    --m_inFlight;
+    m_done.notify_all();
+}
+
+void PosterWriter::tileDone(int tileX, int tileY, const std::vector<std::uint8_t>& chunk)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_offsets[std::size_t(tileY) * std::size_t(tilesX()) + std::size_t(tileX)] = std::uint64_t(m_file->pos());
+    writeRaw(chunk.data(), chunk.size());
+    --m_inFlight;
+    m_done.notify_all();
+}
+
+bool PosterWriter::close()
+{
+    if (!m_file) return false;
+    waitBelow(1);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_exr) {
+        if (std::find(m_offsets.begin(), m_offsets.end(), 0) != m_offsets.end()) fail(QStringLiteral("Poster has missing tiles"));
+        std::vector<std::uint8_t> table;
+        for (const std::uint64_t offset : m_offsets) putLe(table, offset);
+        if (m_error.isEmpty() && m_file->seek(m_tableAt)) writeRaw(table.data(), table.size());
+    }
+    else {
+        if (m_nextBand != tilesY()) fail(QStringLiteral("Poster has missing tiles"));
+        std::uint8_t adler[4];
+        putBe32(adler, m_adler);
+        if (m_error.isEmpty()) writePngChunk("IDAT", adler, 4) && writePngChunk("IEND", nullptr, 0);
+    }
+    const bool ok = m_error.isEmpty() && m_file->commit();
+    if (!ok) fail(m_file->errorString());
+    m_file.reset();
+    return ok;
+}
+
+void PosterWriter::abort()
+{
+    if (!m_file) return;
+    waitBelow(1);
+    m_file->cancelWriting();
+    m_file.reset();
+    m_band.reset();
+}
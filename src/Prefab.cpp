@@ -0,0 +1,318 @@
+#include "Prefab.hpp"
+#include "CullingSystem.hpp"
+#include "JointStateBuffer.hpp"
+#include "KinematicModel.hpp"
+#include "MeshBvh.hpp"
+#include "MeshCache.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <entt/entt.hpp>
+
+namespace
+{
+    bool s_gpuPosing = false;
+
+    glm::mat4 worldMatrixOf(const entt::registry& registry, entt::entity e)
+    {
+        if (const auto* world = registry.try_get<WorldTransformComponent>(e)) return world->matrix;
+        const auto* xf = registry.try_get<TransformComponent>(e);
+        return xf ? xf->getTransform() : glm::mat4(1.0f);
+    }
+
+    // Articulated instances of one prefab whose joint state moved this tick.
+    struct PoseGroup {
+        const Prefab* prefab = nullptr;
+        std::vector<PrefabInstanceComponent*> instances;
+        std::vector<double> q;                        ///< instances x dofs, row-major
+    };
+
+    // Link poses of every instance in 'group', in prefab space: the model's
+    // root link sits at prefab.modelBase whatever its own origin. One
+    // forwardBatch() for the whole group, so a fleet of identical arms costs
+    // one SoA pass rather than a pass per arm.
+    void poseGroup(const PoseGroup& group)
+    {
+        thread_local std::vector<KinematicModel::Pose> poses;   // scratch, only grows
+        const Prefab& prefab = *group.prefab;
+        const KinematicModel& model = *prefab.model;
+        const std::size_t links = std::size_t(model.linkCount());
+        const std::size_t count = group.instances.size();
+        if (links == 0) return;
+        poses.resize(count * links);
+        model.forwardBatch(group.q.data(), count, poses.data());
+        // The root link has no joint, so its pose is the same in every instance.
+        const glm::mat4 toPrefab = prefab.modelBase * glm::inverse(poses[0].matrix());
+        for (std::size_t k = 0; k < count; ++k) {
+            std::vector<glm::mat4>& out = group.instances[k]->linkMatrices;
+            const KinematicModel::Pose* pose = poses.data() + k * links;
+            out.resize(links);
+            for (std::size_t i = 0; i < links; ++i) out[i] = toPrefab * pose[i].matrix();
+        }
+    }
+
+    // Prefab::reachMin/Max: a sphere about the model's root link as far as
+    // the chain reaches, out to each part's farthest corner, around the
+    // rigid parts' own boxes. 'linkRest' are the link matrices at capture.
+    void computeReach(Prefab& prefab, const std::vector<glm::mat4>& linkRest)
+    {
+        prefab.reachMin = glm::vec3(FLT_MAX);
+        prefab.reachMax = glm::vec3(-FLT_MAX);
+        prefab.reachBounded = true;
+        std::vector<float> reach;   // link origin to the root link's, at most, model units
+        if (prefab.model) {
+            const KinematicModel& model = *prefab.model;
+            reach.resize(std::size_t(model.linkCount()), 0.0f);
+            for (int i = 0; i < model.linkCount(); ++i) {
+                const int parent = model.parentOf(i);
+                if (parent < 0) {
+                    reach[i] = glm::length(model.originOf(i).translation - model.originOf(0).translation);
+                    continue;
+                }
+                float r = reach[parent] + glm::length(model.originOf(i).translation);
+                if (model.motionOf(i) == KinematicModel::Motion::Prismatic) {
+                    const int dof = model.dofOf(i);
+                    if (!model.isLimited(dof)) prefab.reachBounded = false;
+                    r += float(std::max(std::abs(model.lowerLimit(dof)), std::abs(model.upperLimit(dof))));
+                }
+                reach[i] = r;
+            }
+        }
+        const glm::vec3 centre = linkRest.empty() ? glm::vec3(0.0f) : glm::vec3(linkRest[0][3]);
+        const float scale = linkRest.empty() ? 1.0f : std::max({ glm::length(glm::vec3(linkRest[0][0])),
+            glm::length(glm::vec3(linkRest[0][1])), glm::length(glm::vec3(linkRest[0][2])) });
+        for (const Prefab::Part& part : prefab.parts) {
+            if (part.link < 0) {
+                glm::vec3 min, max;
+                CullingSystem::transformBox(part.offset, part.localMin, part.localMax, min, max);
+                prefab.reachMin = glm::min(prefab.reachMin, min);
+                prefab.reachMax = glm::max(prefab.reachMax, max);
+                continue;
+            }
+            float corner = 0.0f;
+            for (int c = 0; c < 8; ++c) {
+                const glm::vec3 p = glm::mix(part.localMin, part.localMax, glm::vec3(c & 1, (c >> 1) & 1, (c >> 2) & 1));
+                corner = std::max(corner, glm::length(glm::vec3(part.offset * glm::vec4(p, 1.0f))));
+            }
+            const float radius = (reach[std::size_t(part.link)] + corner) * scale;
+            prefab.reachMin = glm::min(prefab.reachMin, centre - glm::vec3(radius));
+            prefab.reachMax = glm::max(prefab.reachMax, centre + glm::vec3(radius));
+        }
+    }
+}
+
+void PrefabSystem::setGpuPosing(bool on)
+{
+    s_gpuPosing = on;
+}
+
+bool PrefabSystem::gpuPosing()
+{
+    return s_gpuPosing;
+}
+
+void PrefabSystem::poseLinks(const Prefab& prefab, const double* q, std::vector<glm::mat4>& out)
+{
+    thread_local std::vector<KinematicModel::Pose> poses;   // scratch, only grows
+    const KinematicModel& model = *prefab.model;
+    poses.resize(std::size_t(model.linkCount()));
+    out.resize(poses.size());
+    if (poses.empty()) return;
+    model.forward(q, poses.data());
+    const glm::mat4 toPrefab = prefab.modelBase * glm::inverse(poses[0].matrix());
+    for (std::size_t i = 0; i < poses.size(); ++i) out[i] = toPrefab * poses[i].matrix();
+}
+
+std::shared_ptr<const Prefab> PrefabSystem::capture(const entt::registry& registry, entt::entity root)
+{
+    if (!registry.valid(root)) return nullptr;
+
+    std::unordered_map<entt::entity, std::vector<entt::entity>> children;
+    for (auto [e, parent] : registry.view<ParentComponent>().each()) children[parent.parent].push_back(e);
+
+    // The subtree, parents first.
+    std::vector<entt::entity> subtree{ root };
+    for (std::size_t i = 0; i < subtree.size(); ++i) {
+        const auto it = children.find(subtree[i]);
+        if (it != children.end()) subtree.insert(subtree.end(), it->second.begin(), it->second.end());
+    }
+
+    auto prefab = std::make_shared<Prefab>();
+    if (const auto* tag = registry.try_get<TagComponent>(root)) prefab->name = tag->tag;
+    const glm::mat4 toPrefab = glm::inverse(worldMatrixOf(registry, root));
+
+    // The first robot keeps its joints; its links' rest poses anchor the parts.
+    std::unordered_map<entt::entity, int> linkOf;
+    std::vector<glm::mat4> linkRest;
+    for (entt::entity e : subtree) {
+        const auto* kin = registry.try_get<KinematicModelComponent>(e);
+        if (!kin || !kin->model || kin->links.empty()) continue;
+        prefab->model = kin->model;
+        prefab->modelBase = toPrefab * worldMatrixOf(registry, e);
+        prefab->restQ = kin->q;
+        prefab->restQ.resize(std::size_t(kin->model->dofCount()), 0.0);
+        PrefabSystem::poseLinks(*prefab, prefab->restQ.data(), linkRest);
+        for (std::size_t link = 0; link < kin->links.size(); ++link) linkOf.emplace(kin->links[link], int(link));
+        break;
+    }
+
+    // Nearest link at or above each entity, carried down the subtree.
+    std::unordered_map<entt::entity, int> ridesOn;
+    std::unordered_map<std::size_t, std::shared_ptr<const MeshBvh>> blasByKey;
+    for (entt::entity e : subtree) {
+        int link = -1;
+        if (const auto it = linkOf.find(e); it != linkOf.end()) link = it->second;
+        else if (const auto* parent = registry.try_get<ParentComponent>(e))
+            if (const auto up = ridesOn.find(parent->parent); up != ridesOn.end()) link = up->second;
+        ridesOn.emplace(e, link);
+
+        const auto* mesh = registry.try_get<RenderableMeshComponent>(e);
+        if (!mesh || mesh->indices().empty()) continue;
+
+        Prefab::Part& part = prefab->parts.emplace_back();
+        part.mesh = mesh->mesh;
+        const MeshData& data = *mesh->mesh;
+        part.meshKey = MeshCache::keyOf(data);
+        auto& blas = blasByKey[part.meshKey];
+        if (!blas) blas = MeshBvh::build(*mesh);
+        part.blas = blas;
+        if (const auto* material = registry.try_get<MaterialComponent>(e)) part.material = *material;
+        const glm::mat4 rel = toPrefab * worldMatrixOf(registry, e);
+        part.link = link;
+        part.offset = link >= 0 ? glm::inverse(linkRest[std::size_t(link)]) * rel : rel;
+        part.localMin = glm::vec3(FLT_MAX);
+        part.localMax = glm::vec3(-FLT_MAX);
+        for (const Vertex& v : data.vertices) {
+            part.localMin = glm::min(part.localMin, v.position);
+            part.localMax = glm::max(part.localMax, v.position);
+        }
+        const auto* linkComponent = registry.try_get<LinkComponent>(e);
+        part.castsShadow = !linkComponent || linkComponent->description.casts_shadow;
+    }
+    if (prefab->parts.empty()) return nullptr;
+    computeReach(*prefab, linkRest);
+    return prefab;
+}
+
+entt::entity PrefabSystem::instantiate(entt::registry& registry, std::shared_ptr<const Prefab> prefab,
+    const glm::vec3& translation, const glm::quat& rotation)
+{
+    const entt::entity entity = registry.create();
+    registry.emplace<TagComponent>(entity, prefab->name.empty() ? std::string("Prefab") : prefab->name);
+    auto& xf = registry.emplace<TransformComponent>(entity);
+    xf.translation = translation;
+    xf.rotation = rotation;
+    if (prefab->model) {
+        auto buffer = std::make_shared<JointStateBuffer>(prefab->restQ.size());
+        std::copy(prefab->restQ.begin(), prefab->restQ.end(), buffer->position());
+        registry.emplace<JointStateComponent>(entity, std::move(buffer));
+    }
+    registry.emplace<PrefabInstanceComponent>(entity, std::move(prefab));
+    return entity;
+}
+
+std::size_t PrefabSystem::update(entt::registry& registry)
+{
+    // Prefabs with enough instances for the renderer to pose, if it may.
+    thread_local std::vector<std::pair<const Prefab*, std::size_t>> fleets;   // scratch
+    fleets.clear();
+    if (s_gpuPosing) {
+        for (auto [entity, instance] : registry.view<PrefabInstanceComponent>().each()) {
+            if (!instance.prefab || !instance.prefab->model || !instance.prefab->reachBounded) continue;
+            auto it = std::find_if(fleets.begin(), fleets.end(), [&](const auto& f) { return f.first == instance.prefab.get(); });
+            if (it == fleets.end()) fleets.emplace_back(instance.prefab.get(), 1);
+            else ++it->second;
+        }
+    }
+    auto onGpu = [&](entt::entity entity, const Prefab& prefab) {
+        if (registry.any_of<SelectedComponent, CollisionContactComponent>(entity)) return false;
+        for (const auto& [fleet, count] : fleets)
+            if (fleet == &prefab) return count >= kGpuPosingMinInstances;
+        return false;
+    };
+
+    // Gather the instances to re-pose, by prefab, from their joint state buffers.
+    thread_local std::vector<PoseGroup> groups;   // scratch, capacity kept across ticks
+    std::size_t used = 0;
+    for (auto [entity, instance] : registry.view<PrefabInstanceComponent>().each()) {
+        if (!instance.prefab || !instance.prefab->model) continue;
+        const Prefab& prefab = *instance.prefab;
+        const std::size_t dofs = prefab.restQ.size();
+        auto* state = registry.try_get<JointStateComponent>(entity);
+        const bool live = state && state->buffer && state->buffer->size() == dofs;
+        const double* q = live ? state->buffer->position() : prefab.restQ.data();
+        if (const bool gpu = onGpu(entity, prefab); gpu != instance.gpuPosed) {
+            instance.gpuPosed = gpu;
+            instance.posed = false;
+            if (gpu) instance.linkMatrices = {};
+        }
+        if (instance.gpuPosed) {
+            // The renderer poses from q; the box holds every pose.
+            if (!instance.posed || !std::equal(q, q + dofs, instance.q.begin())) instance.q.assign(q, q + dofs);
+        }
+        else if (!instance.posed || !std::equal(q, q + dofs, instance.q.begin())) {
+            instance.q.assign(q, q + dofs);
+            instance.posed = false;
+            std::size_t g = 0;
+            while (g < used && groups[g].prefab != &prefab) ++g;
+            if (g == used) {
+                if (used == groups.size()) groups.emplace_back();
+                groups[used].prefab = &prefab;
+                groups[used].instances.clear();
+                groups[used].q.clear();
+                ++used;
+            }
+            groups[g].instances.push_back(&instance);
+            groups[g].q.insert(groups[g].q.end(), q, q + dofs);
+        }
+        // This tick's joint state is final now; hand it to other threads.
+        if (live) state->buffer->publish();
+    }
+    for (std::size_t g = 0; g < used; ++g) {
+        poseGroup(groups[g]);
+        groups[g].prefab = nullptr;   // the prefab may be gone by the next tick
+    }
+
+    std::size_t changed = 0;
+    for (auto [entity, instance, xf] : registry.view<PrefabInstanceComponent, TransformComponent>().each()) {
+        if (!instance.prefab) continue;
+        const Prefab& prefab = *instance.prefab;
+        const bool localDirty = !instance.posed;
+
+        if (localDirty && instance.gpuPosed) {
+            instance.localMin = prefab.reachMin;
+            instance.localMax = prefab.reachMax;
+            instance.posed = true;
+        }
+        else if (localDirty) {
+            instance.localMin = glm::vec3(FLT_MAX);
+            instance.localMax = glm::vec3(-FLT_MAX);
+            for (std::size_t i = 0; i < prefab.parts.size(); ++i) {
+                glm::vec3 min, max;
+                CullingSystem::transformBox(partMatrix(prefab, instance, i), prefab.parts[i].localMin,
+                    prefab.parts[i].localMax, min, max);
+                instance.localMin = glm::min(instance.localMin, min);
+                instance.localMax = glm::max(instance.localMax, max);
+            }
+            instance.posed = true;
+        }
+
+        // Only re-transform when the pose or the world matrix moved.
+        const glm::mat4 world = worldMatrixOf(registry, entity);
+        auto* bounds = registry.try_get<WorldBoundsComponent>(entity);
+        if (!bounds) bounds = &registry.emplace<WorldBoundsComponent>(entity);
+        if (localDirty || !bounds->valid || std::memcmp(&bounds->sourceMatrix, &world, sizeof(glm::mat4)) != 0) {
+            bounds->localMin = instance.localMin;
+            bounds->localMax = instance.localMax;
+            CullingSystem::transformBox(world, bounds->localMin, bounds->localMax, bounds->min, bounds->max);
+            bounds->sourceMatrix = world;
+            bounds->valid = true;
+            ++changed;
+        }
+    }
+    return changed;
+}
@@ -16,7 +16,7 @@ PreviewViewport::PreviewViewport(QWidget* parent)
     format.setStencilBufferSize(8);
     format.setVersion(4, 3);
     format.setProfile(QSurfaceFormat::CoreProfile);
-    format.setOption(QSurfaceFormat::DebugContext);
+    format.setOption(QSurfaceFormat::DebugContext, QSurfaceFormat::defaultFormat().testOption(QSurfaceFormat::DebugContext));
     setFormat(format);
     setFocusPolicy(Qt::StrongFocus);
 }
@@ -35,14 +35,20 @@ void PreviewViewport::setRenderingSystem(RenderingSystem* system, Scene* scene,
     m_cameraEntity = camera;
 }
 
+// The enrichment dialog calls these on every property edit; warn once, not
+// per edit, and leave the view alone: nothing it draws depends on them.
 void PreviewViewport::updateRobot(const RobotDescription& description)
 {
-    qWarning() << "PreviewViewport::updateRobot is deprecated and has no effect.";
+    static bool warned = false;
+    if (!warned) qWarning() << "PreviewViewport::updateRobot is deprecated and has no effect.";
+    warned = true;
 }
 
 void PreviewViewport::setAnimationSpeed(int sliderValue)
 {
-    qWarning() << "PreviewViewport::setAnimationSpeed is deprecated and has no effect.";
+    static bool warned = false;
+    if (!warned) qWarning() << "PreviewViewport::setAnimationSpeed is deprecated and has no effect.";
+    warned = true;
 }
 
 void PreviewViewport::initializeGL()
@@ -0,0 +1,664 @@
+#include "ProjectSync.hpp"
+#include "ThreadPool.hpp"
+#include "TraceZones.hpp"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+using namespace ProjectSync;
+
+namespace
+{
+    constexpr char kSnapshotMagic[8] = { 'K', 'R', 'S', 'Y', 'N', 'C', '1', 0 };
+    constexpr char kRefMagic[8] = { 'K', 'R', 'S', 'R', 'E', 'F', '1', 0 };
+    const QString kStateDir = QStringLiteral(".krsync");
+    const QString kPartSuffix = QStringLiteral(".krsync-part");
+
+    struct HashKey {
+        std::size_t operator()(const ChunkHash& h) const
+        {
+            std::size_t k;
+            std::memcpy(&k, h.data(), sizeof k);
+            return k;
+        }
+    };
+
+    // --- FastCDC ---
+
+    // Byte to random 64-bit value, fixed so every machine cuts alike.
+    const std::array<std::uint64_t, 256>& gear()
+    {
+        static const std::array<std::uint64_t, 256> table = [] {
+            std::array<std::uint64_t, 256> t{};
+            std::uint64_t x = 0x4B52594E43434443ull;   // splitmix64
+            for (auto& g : t) {
+                std::uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                g = z ^ (z >> 31);
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    // 'bits' ones spread over the high 48 bits, which the shifted gear hash
+    // fills from the last 48 bytes.
+    constexpr std::uint64_t spreadMask(int bits)
+    {
+        std::uint64_t mask = 0;
+        for (int i = 0; i < bits; ++i) mask |= std::uint64_t(1) << (63 - i * 48 / bits);
+        return mask;
+    }
+
+    int log2(std::uint32_t v)
+    {
+        int n = 0;
+        while (v >>= 1) ++n;
+        return n;
+    }
+
+    // Length of the chunk at the start of 'data': a harder mask before the
+    // average size and an easier one after (normalized chunking), which
+    // keeps sizes close to the average.
+    std::size_t cutOne(const unsigned char* data, std::size_t size)
+    {
+        static const std::uint64_t maskHard = spreadMask(log2(kAvgChunk) + 2);
+        static const std::uint64_t maskEasy = spreadMask(log2(kAvgChunk) - 2);
+        const auto& g = gear();
+        const std::size_t n = std::min<std::size_t>(size, kMaxChunk);
+        if (n <= kMinChunk) return n;
+        const std::size_t normal = std::min<std::size_t>(n, kAvgChunk);
+        std::uint64_t fp = 0;
+        std::size_t i = kMinChunk;
+        for (; i < normal; ++i) {
+            fp = (fp << 1) + g[data[i]];
+            if (!(fp & maskHard)) return i + 1;
+        }
+        for (; i < n; ++i) {
+            fp = (fp << 1) + g[data[i]];
+            if (!(fp & maskEasy)) return i + 1;
+        }
+        return n;
+    }
+
+    // --- Byte streams ---
+
+    template<class T>
+    void put(std::vector<unsigned char>& out, T v)
+    {
+        const auto* p = reinterpret_cast<const unsigned char*>(&v);
+        out.insert(out.end(), p, p + sizeof v);
+    }
+
+    class Reader
+    {
+    public:
+        Reader(const unsigned char* data, std::size_t size) : m_p(data), m_end(data + size) {}
+        template<class T>
+        bool get(T& v)
+        {
+            if (std::size_t(m_end - m_p) < sizeof v) return false;
+            std::memcpy(&v, m_p, sizeof v);
+            m_p += sizeof v;
+            return true;
+        }
+        bool bytes(void* out, std::size_t n)
+        {
+            if (std::size_t(m_end - m_p) < n) return false;
+            std::memcpy(out, m_p, n);
+            m_p += n;
+            return true;
+        }
+        bool done() const { return m_p == m_end; }
+        std::size_t remaining() const { return std::size_t(m_end - m_p); }
+
+    private:
+        const unsigned char* m_p;
+        const unsigned char* m_end;
+    };
+
+    void putChunks(std::vector<unsigned char>& out, const std::vector<Chunk>& chunks)
+    {
+        put(out, std::uint32_t(chunks.size()));
+        for (const Chunk& c : chunks) {
+            out.insert(out.end(), c.hash.begin(), c.hash.end());
+            put(out, c.size);
+        }
+    }
+
+    // Listings come from the store, so nothing is sized by a count the bytes
+    // left cannot hold, and every chunk is one cut() could have made.
+    constexpr std::size_t kChunkRecordBytes = sizeof(ChunkHash) + sizeof(std::uint32_t);
+
+    bool getChunks(Reader& in, std::vector<Chunk>& chunks)
+    {
+        std::uint32_t count = 0;
+        if (!in.get(count) || count > in.remaining() / kChunkRecordBytes) return false;
+        chunks.resize(count);
+        for (Chunk& c : chunks)
+            if (!in.bytes(c.hash.data(), c.hash.size()) || !in.get(c.size) || c.size == 0 || c.size > kMaxChunk)
+                return false;
+        return true;
+    }
+
+    std::vector<unsigned char> encodeSnapshot(const std::vector<FileEntry>& files)
+    {
+        std::vector<unsigned char> out(kSnapshotMagic, kSnapshotMagic + 8);
+        put(out, std::uint32_t(files.size()));
+        for (const FileEntry& f : files) {
+            put(out, std::uint16_t(f.path.size()));
+            out.insert(out.end(), f.path.begin(), f.path.end());
+            put(out, f.size);
+            put(out, f.modifiedMs);
+            putChunks(out, f.chunks);
+        }
+        return out;
+    }
+
+    bool decodeSnapshot(const std::vector<unsigned char>& bytes, std::vector<FileEntry>& files)
+    {
+        Reader in(bytes.data(), bytes.size());
+        char magic[8];
+        std::uint32_t count = 0;
+        // An entry is at least its path length, size, time and chunk count.
+        constexpr std::size_t kMinEntryBytes = sizeof(std::uint16_t) + sizeof(std::uint64_t) + sizeof(std::int64_t) + sizeof(std::uint32_t);
+        if (!in.bytes(magic, 8) || std::memcmp(magic, kSnapshotMagic, 8) != 0 || !in.get(count)
+            || count > in.remaining() / kMinEntryBytes)
+            return false;
+        files.resize(count);
+        for (FileEntry& f : files) {
+            std::uint16_t length = 0;
+            if (!in.get(length)) return false;
+            f.path.resize(length);
+            if (!in.bytes(f.path.data(), length) || !in.get(f.size) || !in.get(f.modifiedMs) || !getChunks(in, f.chunks))
+                return false;
+            // The chunks are the file: pull() writes them end to end into
+            // exactly f.size bytes.
+            std::uint64_t total = 0;
+            for (const Chunk& c : f.chunks) total += c.size;
+            if (total != f.size) return false;
+        }
+        return in.done();
+    }
+
+    // A snapshot's own path is chosen by its sender: nothing absolute, and
+    // nothing that climbs out of the folder.
+    bool safePath(const std::string& path)
+    {
+        if (path.empty() || path.front() == '/' || path.find('\\') != std::string::npos || path.find(':') != std::string::npos)
+            return false;
+        const QStringList parts = QString::fromStdString(path).split('/');
+        return std::none_of(parts.begin(), parts.end(), [](const QString& p) { return p.isEmpty() || p == "." || p == ".."; });
+    }
+
+    void setError(std::string* error, std::mutex& mutex, const std::string& message)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error && error->empty()) *error = message;
+    }
+
+    // A read-only mapping of a whole file; empty files map to nothing.
+    struct Mapped {
+        QFile file;
+        const unsigned char* data = nullptr;
+        std::size_t size = 0;
+
+        bool open(const QString& path)
+        {
+            file.setFileName(path);
+            if (!file.open(QIODevice::ReadOnly)) return false;
+            size = std::size_t(file.size());
+            data = size ? file.map(0, qint64(size)) : nullptr;
+            return size == 0 || data;
+        }
+        // Unmapped before the file is replaced: Windows keeps mapped files open.
+        void close()
+        {
+            if (data) file.unmap(const_cast<unsigned char*>(data));
+            data = nullptr;
+            file.close();
+        }
+        ~Mapped() { close(); }
+    };
+
+    // Cuts and hashes one file: boundaries in one pass, hashes in parallel.
+    bool chunkFile(const QString& path, FileEntry& entry)
+    {
+        Mapped map;
+        if (!map.open(path)) return false;
+        entry.size = map.size;
+        entry.chunks.clear();
+        std::vector<std::size_t> offsets;
+        for (std::size_t at = 0; at < map.size;) {
+            const std::size_t n = cutOne(map.data + at, map.size - at);
+            offsets.push_back(at);
+            entry.chunks.push_back({ {}, std::uint32_t(n) });
+            at += n;
+        }
+        ThreadPool::shared().parallelFor(entry.chunks.size(), [&](std::size_t i) {
+            entry.chunks[i].hash = hashOf(map.data + offsets[i], entry.chunks[i].size);
+        });
+        return true;
+    }
+
+    std::vector<FileEntry> readState(const QDir& root)
+    {
+        std::vector<FileEntry> files;
+        QFile file(root.filePath(kStateDir + "/state"));
+        if (!file.open(QIODevice::ReadOnly)) return files;
+        const QByteArray bytes = file.readAll();
+        if (!decodeSnapshot(std::vector<unsigned char>(bytes.begin(), bytes.end()), files)) files.clear();
+        return files;
+    }
+
+    void writeState(const QDir& root, const std::vector<FileEntry>& files)
+    {
+        root.mkpath(kStateDir);
+        const std::vector<unsigned char> bytes = encodeSnapshot(files);
+        QSaveFile file(root.filePath(kStateDir + "/state"));
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(reinterpret_cast<const char*>(bytes.data()), qint64(bytes.size()));
+            file.commit();
+        }
+    }
+
+    std::int64_t modifiedMs(const QFileInfo& info) { return info.lastModified().toMSecsSinceEpoch(); }
+}
+
+// ============================================================================
+// --- Chunking ---
+// ============================================================================
+
+std::vector<std::uint32_t> ProjectSync::cut(const unsigned char* data, std::size_t size)
+{
+    std::vector<std::uint32_t> sizes;
+    for (std::size_t at = 0; at < size;) {
+        const std::size_t n = cutOne(data + at, size - at);
+        sizes.push_back(std::uint32_t(n));
+        at += n;
+    }
+    return sizes;
+}
+
+ChunkHash ProjectSync::hashOf(const unsigned char* data, std::size_t size)
+{
+    QCryptographicHash hash(QCryptographicHash::Blake2b_256);
+    hash.addData(QByteArrayView(reinterpret_cast<const char*>(data), qsizetype(size)));
+    const QByteArray result = hash.result();
+    ChunkHash out;
+    std::memcpy(out.data(), result.constData(), out.size());
+    return out;
+}
+
+// ============================================================================
+// --- DirectoryStore ---
+// ============================================================================
+
+std::string ProjectSync::DirectoryStore::chunkPath(const ChunkHash& hash) const
+{
+    const QByteArray hex = QByteArray(reinterpret_cast<const char*>(hash.data()), int(hash.size())).toHex();
+    return m_root + "/chunks/" + hex.left(2).toStdString() + "/" + hex.toStdString();
+}
+
+std::vector<bool> ProjectSync::DirectoryStore::has(const std::vector<ChunkHash>& hashes)
+{
+    std::vector<bool> out(hashes.size());
+    for (std::size_t i = 0; i < hashes.size(); ++i) out[i] = QFileInfo::exists(QString::fromStdString(chunkPath(hashes[i])));
+    return out;
+}
+
+bool ProjectSync::DirectoryStore::put(const ChunkHash& hash, const unsigned char* data, std::size_t size, std::string* error)
+{
+    const QString path = QString::fromStdString(chunkPath(hash));
+    QDir().mkpath(QFileInfo(path).path());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(reinterpret_cast<const char*>(data), qint64(size)) != qint64(size)
+        || !file.commit()) {
+        if (error) *error = "Could not write " + path.toStdString();
+        return false;
+    }
+    return true;
+}
+
+bool ProjectSync::DirectoryStore::get(const ChunkHash& hash, std::vector<unsigned char>& out, std::string* error)
+{
+    QFile file(QString::fromStdString(chunkPath(hash)));
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = "Missing chunk " + file.fileName().toStdString();
+        return false;
+    }
+    out.resize(std::size_t(file.size()));
+    if (file.read(reinterpret_cast<char*>(out.data()), qint64(out.size())) != qint64(out.size())) {
+        if (error) *error = "Could not read " + file.fileName().toStdString();
+        return false;
+    }
+    return true;
+}
+
+bool ProjectSync::DirectoryStore::putRef(const std::string& name, const std::vector<unsigned char>& bytes, std::string* error)
+{
+    QDir().mkpath(QString::fromStdString(m_root + "/refs"));
+    QSaveFile file(QString::fromStdString(m_root + "/refs/" + name));
+    if (!file.open(QIODevice::WriteOnly) || file.write(reinterpret_cast<const char*>(bytes.data()), qint64(bytes.size())) != qint64(bytes.size())
+        || !file.commit()) {
+        if (error) *error = "Could not publish " + name;
+        return false;
+    }
+    return true;
+}
+
+bool ProjectSync::DirectoryStore::getRef(const std::string& name, std::vector<unsigned char>& out, std::string* error)
+{
+    QFile file(QString::fromStdString(m_root + "/refs/" + name));
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = "No snapshot named " + name;
+        return false;
+    }
+    const QByteArray bytes = file.readAll();
+    out.assign(bytes.begin(), bytes.end());
+    return true;
+}
+
+// ============================================================================
+// --- push / pull ---
+// ============================================================================
+
+bool ProjectSync::push(const std::string& folder, ChunkStore& store, const std::string& name, Stats* stats, std::string* error)
+{
+    KR_ZONE("ProjectSync::push");
+    const QDir root(QString::fromStdString(folder));
+    if (!root.exists()) {
+        if (error) *error = "No folder " + folder;
+        return false;
+    }
+    Stats s;
+
+    // --- 1. Describe the folder, re-chunking only what changed ---
+    const std::vector<FileEntry> previous = readState(root);
+    std::unordered_map<std::string, const FileEntry*> before;
+    for (const FileEntry& f : previous) before.emplace(f.path, &f);
+
+    std::vector<FileEntry> files;
+    QDirIterator it(root.path(), QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString path = it.next();
+        const QString relative = root.relativeFilePath(path);
+        if (relative.startsWith(kStateDir + "/") || relative.endsWith(kPartSuffix)) continue;
+        const QFileInfo info = it.fileInfo();
+        FileEntry& f = files.emplace_back();
+        f.path = relative.toStdString();
+        f.size = std::uint64_t(info.size());
+        f.modifiedMs = modifiedMs(info);
+    }
+    std::sort(files.begin(), files.end(), [](const FileEntry& a, const FileEntry& b) { return a.path < b.path; });
+    for (FileEntry& f : files) {
+        const auto old = before.find(f.path);
+        if (old != before.end() && old->second->size == f.size && old->second->modifiedMs == f.modifiedMs) {
+            f.chunks = old->second->chunks;
+            continue;
+        }
+        if (!chunkFile(root.filePath(QString::fromStdString(f.path)), f)) {
+            if (error) *error = "Could not read " + f.path;
+            return false;
+        }
+        ++s.filesChanged;
+    }
+    s.files = files.size();
+
+    // --- 2. Upload the chunks the store lacks, a file at a time in parallel ---
+    struct Source { std::size_t file; std::uint64_t offset; std::uint32_t size; };
+    std::unordered_map<ChunkHash, Source, HashKey> sources;
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        std::uint64_t offset = 0;
+        for (const Chunk& c : files[i].chunks) {
+            sources.emplace(c.hash, Source{ i, offset, c.size });
+            offset += c.size;
+        }
+    }
+    std::vector<ChunkHash> hashes;
+    hashes.reserve(sources.size());
+    for (const auto& entry : sources) hashes.push_back(entry.first);
+    const std::vector<bool> present = store.has(hashes);
+    std::map<std::size_t, std::vector<std::pair<ChunkHash, Source>>> missing;
+    for (std::size_t i = 0; i < hashes.size(); ++i)
+        if (!present[i]) {
+            const Source& source = sources[hashes[i]];
+            missing[source.file].emplace_back(hashes[i], source);
+        }
+    std::vector<const std::vector<std::pair<ChunkHash, Source>>*> groups;
+    for (const auto& group : missing) groups.push_back(&group.second);
+
+    std::mutex errorMutex;
+    std::atomic<bool> failed{ false };
+    std::atomic<std::size_t> sent{ 0 };
+    std::atomic<std::uint64_t> sentBytes{ 0 };
+    ThreadPool::shared().parallelFor(groups.size(), [&](std::size_t g) {
+        if (failed) return;
+        const auto& chunks = *groups[g];
+        const FileEntry& file = files[chunks.front().second.file];
+        Mapped map;
+        if (!map.open(root.filePath(QString::fromStdString(file.path))) || map.size != file.size) {
+            failed = true;
+            setError(error, errorMutex, file.path + " changed during the sync");
+            return;
+        }
+        ThreadPool::shared().parallelFor(chunks.size(), [&](std::size_t k) {
+            if (failed) return;
+            const auto& [hash, source] = chunks[k];
+            const unsigned char* data = map.data + source.offset;
+            // Hashed again: the file may have been written since it was chunked.
+            std::string message;
+            if (hashOf(data, source.size) != hash) message = file.path + " changed during the sync";
+            else if (store.put(hash, data, source.size, &message)) {
+                ++sent;
+                sentBytes += source.size;
+                return;
+            }
+            failed = true;
+            setError(error, errorMutex, message);
+        });
+    });
+    if (failed) return false;
+    s.chunksTransferred = sent;
+    s.bytesTransferred = sentBytes;
+
+    // --- 3. Publish the snapshot, itself as chunks, under 'name' ---
+    const std::vector<unsigned char> snapshot = encodeSnapshot(files);
+    std::vector<Chunk> listing;
+    std::vector<std::size_t> offsets;
+    std::size_t at = 0;
+    for (const std::uint32_t n : cut(snapshot.data(), snapshot.size())) {
+        listing.push_back({ hashOf(snapshot.data() + at, n), n });
+        offsets.push_back(at);
+        at += n;
+    }
+    std::vector<ChunkHash> listingHashes;
+    for (const Chunk& c : listing) listingHashes.push_back(c.hash);
+    const std::vector<bool> listed = store.has(listingHashes);
+    for (std::size_t i = 0; i < listing.size(); ++i) {
+        if (listed[i]) continue;
+        if (!store.put(listing[i].hash, snapshot.data() + offsets[i], listing[i].size, error)) return false;
+        ++s.chunksTransferred;
+        s.bytesTransferred += listing[i].size;
+    }
+    std::vector<unsigned char> ref(kRefMagic, kRefMagic + 8);
+    put(ref, std::uint64_t(snapshot.size()));
+    putChunks(ref, listing);
+    if (!store.putRef(name, ref, error)) return false;
+
+    writeState(root, files);
+    if (stats) *stats = s;
+    return true;
+}
+
+bool ProjectSync::pull(ChunkStore& store, const std::string& name, const std::string& folder, Stats* stats, std::string* error)
+{
+    KR_ZONE("ProjectSync::pull");
+    const QDir root(QString::fromStdString(folder));
+    if (!root.exists() && !QDir().mkpath(root.path())) {
+        if (error) *error = "Could not create " + folder;
+        return false;
+    }
+    Stats s;
+    std::mutex errorMutex;
+    std::atomic<bool> failed{ false };
+    std::atomic<std::size_t> fetched{ 0 };
+    std::atomic<std::uint64_t> fetchedBytes{ 0 }, reusedBytes{ 0 };
+
+    // Fetches 'chunk' into 'out' and checks it is what was asked for.
+    auto fetch = [&](const Chunk& chunk, unsigned char* out) {
+        std::vector<unsigned char> bytes;
+        std::string message;
+        if (!store.get(chunk.hash, bytes, &message)) {
+            failed = true;
+            setError(error, errorMutex, message);
+            return;
+        }
+        if (bytes.size() != chunk.size || hashOf(bytes.data(), bytes.size()) != chunk.hash)
+            message = "A stored chunk is corrupt";
+        else {
+            std::memcpy(out, bytes.data(), bytes.size());
+            ++fetched;
+            fetchedBytes += chunk.size;
+            return;
+        }
+        failed = true;
+        setError(error, errorMutex, message);
+    };
+
+    // --- 1. The snapshot, from its listing ---
+    std::vector<unsigned char> ref;
+    if (!store.getRef(name, ref, error)) return false;
+    Reader refReader(ref.data(), ref.size());
+    char magic[8];
+    std::uint64_t snapshotBytes = 0;
+    std::vector<Chunk> listing;
+    if (!refReader.bytes(magic, 8) || std::memcmp(magic, kRefMagic, 8) != 0 || !refReader.get(snapshotBytes)
+        || !getChunks(refReader, listing)) {
+        if (error) *error = "Snapshot " + name + " is not readable";
+        return false;
+    }
+    std::vector<std::size_t> listingOffsets;
+    std::uint64_t total = 0;
+    for (const Chunk& c : listing) {
+        listingOffsets.push_back(std::size_t(total));
+        total += c.size;
+    }
+    if (total != snapshotBytes) {
+        if (error) *error = "Snapshot " + name + " is not readable";
+        return false;
+    }
+    std::vector<unsigned char> snapshot(std::size_t(snapshotBytes));
+    ThreadPool::shared().parallelFor(listing.size(), [&](std::size_t i) {
+        if (!failed) fetch(listing[i], snapshot.data() + listingOffsets[i]);
+    });
+    std::vector<FileEntry> files;
+    if (failed) return false;
+    if (!decodeSnapshot(snapshot, files)
+        || !std::all_of(files.begin(), files.end(), [](const FileEntry& f) { return safePath(f.path); })) {
+        if (error) *error = "Snapshot " + name + " is not readable";
+        return false;
+    }
+
+    // --- 2. Rebuild each file whose chunks differ from the local copy ---
+    const std::vector<FileEntry> previous = readState(root);
+    std::unordered_map<std::string, const FileEntry*> before;
+    for (const FileEntry& f : previous) before.emplace(f.path, &f);
+
+    for (FileEntry& remote : files) {
+        const QString path = root.filePath(QString::fromStdString(remote.path));
+        const QFileInfo info(path);
+        FileEntry local;
+        if (info.exists()) {
+            const auto old = before.find(remote.path);
+            if (old != before.end() && old->second->size == std::uint64_t(info.size()) && old->second->modifiedMs == modifiedMs(info))
+                local = *old->second;
+            else if (!chunkFile(path, local)) {
+                if (error) *error = "Could not read " + remote.path;
+                return false;
+            }
+            const bool same = local.size == remote.size && local.chunks.size() == remote.chunks.size()
+                && std::equal(local.chunks.begin(), local.chunks.end(), remote.chunks.begin(),
+                    [](const Chunk& a, const Chunk& b) { return a.hash == b.hash && a.size == b.size; });
+            if (same) {
+                remote.modifiedMs = modifiedMs(info);
+                continue;
+            }
+        }
+        ++s.filesChanged;
+
+        // Where each chunk of the local copy sits.
+        std::unordered_map<ChunkHash, std::uint64_t, HashKey> localAt;
+        std::uint64_t offset = 0;
+        for (const Chunk& c : local.chunks) {
+            localAt.emplace(c.hash, offset);
+            offset += c.size;
+        }
+        Mapped source;
+        if (!localAt.empty() && !source.open(path)) localAt.clear();
+
+        // Built in a mapped temporary, then swapped in.
+        root.mkpath(QFileInfo(path).path());
+        QFile part(path + kPartSuffix);
+        unsigned char* out = nullptr;
+        if (!part.open(QIODevice::ReadWrite | QIODevice::Truncate) || !part.resize(qint64(remote.size))
+            || (remote.size && !(out = part.map(0, qint64(remote.size))))) {
+            if (error) *error = "Could not write " + remote.path;
+            return false;
+        }
+        std::vector<std::uint64_t> offsets;
+        offset = 0;
+        for (const Chunk& c : remote.chunks) {
+            offsets.push_back(offset);
+            offset += c.size;
+        }
+        ThreadPool::shared().parallelFor(remote.chunks.size(), [&](std::size_t i) {
+            if (failed) return;
+            const Chunk& c = remote.chunks[i];
+            if (offsets[i] > remote.size || c.size > remote.size - offsets[i]) {
+                failed = true;
+                setError(error, errorMutex, "Snapshot " + name + " lists chunks outside " + remote.path);
+                return;
+            }
+            const auto have = localAt.find(c.hash);
+            if (have != localAt.end() && have->second + c.size <= source.size) {
+                std::memcpy(out + offsets[i], source.data + have->second, c.size);
+                reusedBytes += c.size;
+            }
+            else fetch(c, out + offsets[i]);
+        });
+        if (out) part.unmap(out);
+        part.close();
+        source.close();
+        if (failed) {
+            part.remove();
+            return false;
+        }
+        if ((QFile::exists(path) && !QFile::remove(path)) || !part.rename(path)) {
+            if (error) *error = "Could not replace " + remote.path;
+            return false;
+        }
+        remote.modifiedMs = modifiedMs(QFileInfo(path));
+    }
+    s.files = files.size();
+    s.chunksTransferred = fetched;
+    s.bytesTransferred = fetchedBytes;
+    s.bytesReused = reusedBytes;
+
+    writeState(root, files);
+    if (stats) *stats = s;
+    return true;
+}
@@ -34,6 +34,13 @@ PropertiesPanel::PropertiesPanel(Scene* scene, QWidget* parent) :
 
 PropertiesPanel::~PropertiesPanel() = default;
 
+void PropertiesPanel::refresh()
+{
+    for (auto& [entity, widget] : m_entityWidgetMap) {
+        if (auto* grid = qobject_cast<gridPropertiesWidget*>(widget)) grid->refresh();
+    }
+}
+
 void PropertiesPanel::onGridRemoved(entt::registry& registry, entt::entity entity)
 {
     if (m_entityWidgetMap.count(entity)) {
@@ -0,0 +1,593 @@
+#include "RemoteViewServer.hpp"
+#include "ViewportWidget.hpp"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QNetworkInterface>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QWheelEvent>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+constexpr quint8 kOpContinuation = 0x0, kOpText = 0x1, kOpBinary = 0x2, kOpClose = 0x8, kOpPing = 0x9, kOpPong = 0xA;
+constexpr int kMaxRequestBytes = 16 * 1024;
+constexpr qint64 kMinBacklogBytes = 64 * 1024;   ///< a single keyframe may be this large
+
+quint32 be32(const QByteArray& bytes, int at)
+{
+    const auto* p = reinterpret_cast<const uchar*>(bytes.constData()) + at;
+    return quint32(p[0]) << 24 | quint32(p[1]) << 16 | quint32(p[2]) << 8 | p[3];
+}
+
+quint64 be64(const QByteArray& bytes, int at)
+{
+    return quint64(be32(bytes, at)) << 32 | be32(bytes, at + 4);
+}
+
+// Whether a fragment's first sample is a sync sample: the
+// sample_is_non_sync_sample bit of its flags (ISO/IEC 14496-12 8.8.3.1),
+// taken from trun's first_sample_flags, its per-sample flags or tfhd's
+// default, in that order. Unknown counts as a keyframe.
+bool startsWithKeyframe(const QByteArray& moof)
+{
+    for (int at = 8; at + 8 <= moof.size();) {
+        const int size = int(be32(moof, at));
+        if (size < 8 || at + size > moof.size()) break;
+        if (moof.mid(at + 4, 4) == "traf") {
+            bool haveDefault = false;
+            quint32 defaultFlags = 0;
+            for (int box = at + 8; box + 16 <= at + size;) {
+                const int boxSize = int(be32(moof, box));
+                if (boxSize < 16 || box + boxSize > at + size) break;
+                const QByteArray type = moof.mid(box + 4, 4);
+                const quint32 flags = be32(moof, box + 8) & 0xFFFFFF;
+                int field = box + 16;   // past version/flags and track_ID or sample_count
+                if (type == "tfhd") {
+                    if (flags & 0x01) field += 8;
+                    if (flags & 0x02) field += 4;
+                    if (flags & 0x08) field += 4;
+                    if (flags & 0x10) field += 4;
+                    if ((flags & 0x20) && field + 4 <= box + boxSize) {
+                        defaultFlags = be32(moof, field);
+                        haveDefault = true;
+                    }
+                } else if (type == "trun") {
+                    if (flags & 0x01) field += 4;
+                    if (!(flags & 0x04) && (flags & 0x400)) {
+                        if (flags & 0x100) field += 4;
+                        if (flags & 0x200) field += 4;
+                    }
+                    quint32 sampleFlags = defaultFlags;
+                    if ((flags & (0x04 | 0x400)) && field + 4 <= box + boxSize) sampleFlags = be32(moof, field);
+                    else if (!haveDefault) return true;
+                    return !(sampleFlags & 0x10000);
+                }
+                box += boxSize;
+            }
+        }
+        at += size;
+    }
+    return true;
+}
+
+// Codec string for MediaSource, from the avcC profile/level bytes when present.
+QString mimeFor(const QByteArray& init)
+{
+    const int avcC = init.indexOf("avcC");
+    if (avcC >= 0 && avcC + 8 <= init.size())
+        return QString::asprintf("video/mp4; codecs=\"avc1.%02X%02X%02X\"",
+            unsigned(uchar(init[avcC + 5])), unsigned(uchar(init[avcC + 6])), unsigned(uchar(init[avcC + 7])));
+    if (init.contains("hvcC")) return QStringLiteral("video/mp4; codecs=\"hvc1.1.6.L120.90\"");
+    return QStringLiteral("video/mp4; codecs=\"avc1.42E01F\"");
+}
+
+Qt::KeyboardModifiers modifiersFrom(int mods)
+{
+    Qt::KeyboardModifiers m;
+    if (mods & 1) m |= Qt::ShiftModifier;
+    if (mods & 2) m |= Qt::ControlModifier;
+    if (mods & 4) m |= Qt::AltModifier;
+    return m;
+}
+
+// DOM MouseEvent.button (0 left, 1 middle, 2 right) and .buttons (1 left, 2 right, 4 middle).
+Qt::MouseButton buttonFrom(int button)
+{
+    switch (button) {
+    case 0: return Qt::LeftButton;
+    case 1: return Qt::MiddleButton;
+    case 2: return Qt::RightButton;
+    default: return Qt::NoButton;
+    }
+}
+
+Qt::MouseButtons buttonsFrom(int buttons)
+{
+    Qt::MouseButtons b;
+    if (buttons & 1) b |= Qt::LeftButton;
+    if (buttons & 2) b |= Qt::RightButton;
+    if (buttons & 4) b |= Qt::MiddleButton;
+    return b;
+}
+
+// DOM KeyboardEvent.key -> Qt::Key. Printable keys map through their
+// character; Qt's codes for ASCII are the upper-case characters.
+int keyFrom(const QString& key)
+{
+    static const QHash<QString, int> named = {
+        { "Escape", Qt::Key_Escape }, { "Tab", Qt::Key_Tab }, { "Backspace", Qt::Key_Backspace },
+        { "Enter", Qt::Key_Return }, { "Delete", Qt::Key_Delete }, { "Insert", Qt::Key_Insert },
+        { "Home", Qt::Key_Home }, { "End", Qt::Key_End }, { "PageUp", Qt::Key_PageUp }, { "PageDown", Qt::Key_PageDown },
+        { "ArrowLeft", Qt::Key_Left }, { "ArrowRight", Qt::Key_Right }, { "ArrowUp", Qt::Key_Up }, { "ArrowDown", Qt::Key_Down },
+        { "Shift", Qt::Key_Shift }, { "Control", Qt::Key_Control }, { "Alt", Qt::Key_Alt }, { " ", Qt::Key_Space },
+    };
+    if (auto it = named.find(key); it != named.end()) return it.value();
+    if (key.size() >= 2 && key[0] == 'F') {
+        bool ok = false;
+        const int n = key.mid(1).toInt(&ok);
+        if (ok && n >= 1 && n <= 12) return Qt::Key_F1 + n - 1;
+    }
+    if (key.size() == 1) return key[0].toUpper().unicode();
+    return Qt::Key_unknown;
+}
+
+} // namespace
+
+RemoteViewServer::RemoteViewServer(QObject* parent)
+    : QObject(parent)
+{
+    m_frameTimer = new QTimer(this);
+    m_frameTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_frameTimer, &QTimer::timeout, this, &RemoteViewServer::pushFrame);
+    m_bitrateTimer = new QTimer(this);
+    m_bitrateTimer->setInterval(1000);
+    connect(m_bitrateTimer, &QTimer::timeout, this, &RemoteViewServer::adaptBitrate);
+}
+
+RemoteViewServer::~RemoteViewServer()
+{
+    stop();
+}
+
+bool RemoteViewServer::start(ViewportWidget* viewport, const Settings& settings)
+{
+    stop();
+    if (!viewport) return false;
+    m_settings = settings;
+    m_settings.fps = std::clamp(settings.fps, 1, 120);
+    m_rung = 0;
+    m_calmSeconds = 0;
+    m_encoderFailed = false;
+
+    m_server = new QTcpServer(this);
+    if (!m_server->listen(QHostAddress::Any, settings.port)) {
+        qWarning() << "[RemoteView] Cannot listen on port" << settings.port << ":" << m_server->errorString();
+        delete m_server;
+        m_server = nullptr;
+        return false;
+    }
+    connect(m_server, &QTcpServer::newConnection, this, &RemoteViewServer::acceptConnections);
+
+    m_viewport = viewport;
+    m_capture.setMaxRate(m_settings.fps);
+    m_capture.setFrameSink([this](const QImage& frame) { m_latest = frame; });
+    viewport->setFrameTap(&m_capture);
+
+    m_frameTimer->start(1000 / m_settings.fps);
+    m_bitrateTimer->start();
+    return true;
+}
+
+void RemoteViewServer::stop()
+{
+    m_frameTimer->stop();
+    m_bitrateTimer->stop();
+    if (m_viewport) m_viewport->setFrameTap(nullptr);
+    m_viewport = nullptr;
+    stopEncoder();
+    m_latest = QImage();
+
+    const bool hadViewers = viewerCount() > 0;
+    std::vector<Client> clients = std::move(m_clients);
+    m_clients.clear();
+    for (Client& client : clients) {
+        client.socket->disconnect(this);
+        client.socket->abort();
+        client.socket->deleteLater();
+    }
+    if (m_server) {
+        m_server->close();
+        m_server->deleteLater();
+        m_server = nullptr;
+    }
+    if (hadViewers) emit viewersChanged(0);
+}
+
+bool RemoteViewServer::running() const
+{
+    return m_server && m_server->isListening();
+}
+
+QString RemoteViewServer::url() const
+{
+    QString host = QStringLiteral("localhost");
+    for (const QHostAddress& address : QNetworkInterface::allAddresses()) {
+        if (address.protocol() == QAbstractSocket::IPv4Protocol && !address.isLoopback()) {
+            host = address.toString();
+            break;
+        }
+    }
+    return QStringLiteral("http://%1:%2/").arg(host).arg(m_settings.port);
+}
+
+int RemoteViewServer::viewerCount() const
+{
+    return int(std::count_if(m_clients.begin(), m_clients.end(), [](const Client& c) { return c.websocket; }));
+}
+
+// --- Connections ---
+
+void RemoteViewServer::acceptConnections()
+{
+    while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        Client client;
+        client.socket = socket;
+        m_clients.push_back(client);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { readClient(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { dropClient(socket); });
+    }
+}
+
+RemoteViewServer::Client* RemoteViewServer::findClient(QTcpSocket* socket)
+{
+    auto it = std::find_if(m_clients.begin(), m_clients.end(), [socket](const Client& c) { return c.socket == socket; });
+    return it != m_clients.end() ? &*it : nullptr;
+}
+
+void RemoteViewServer::readClient(QTcpSocket* socket)
+{
+    Client* client = findClient(socket);
+    if (!client) return;
+    client->incoming += socket->readAll();
+    const bool open = client->websocket ? handleFrames(*client) : handleRequest(*client);
+    if (!open) {
+        client->incoming.clear();
+        socket->disconnectFromHost();   // flushes what is queued; 'disconnected' drops the client
+    }
+}
+
+void RemoteViewServer::dropClient(QTcpSocket* socket)
+{
+    auto it = std::find_if(m_clients.begin(), m_clients.end(), [socket](const Client& c) { return c.socket == socket; });
+    if (it == m_clients.end()) return;
+    const bool viewer = it->websocket;
+    m_clients.erase(it);
+    socket->deleteLater();
+    if (!viewer) return;
+    emit viewersChanged(viewerCount());
+    if (viewerCount() == 0) stopEncoder();   // nobody to encode for
+}
+
+void RemoteViewServer::respond(QTcpSocket* socket, const char* status, const char* contentType, const QByteArray& body)
+{
+    socket->write(QByteArray("HTTP/1.1 ") + status + "\r\nContent-Type: " + contentType
+        + "\r\nContent-Length: " + QByteArray::number(body.size())
+        + "\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n");
+    socket->write(body);
+}
+
+bool RemoteViewServer::handleRequest(Client& client)
+{
+    const int end = client.incoming.indexOf("\r\n\r\n");
+    if (end < 0) return client.incoming.size() < kMaxRequestBytes;
+
+    const QList<QByteArray> lines = client.incoming.left(end).split('\n');
+    client.incoming.remove(0, end + 4);
+    const QList<QByteArray> request = lines.first().trimmed().split(' ');
+    QHash<QByteArray, QByteArray> headers;
+    for (int i = 1; i < lines.size(); ++i) {
+        const int colon = lines[i].indexOf(':');
+        if (colon > 0) headers.insert(lines[i].left(colon).trimmed().toLower(), lines[i].mid(colon + 1).trimmed());
+    }
+
+    if (request.size() < 2 || request[0] != "GET") {
+        respond(client.socket, "405 Method Not Allowed", "text/plain", "GET only\n");
+        return false;
+    }
+    const QByteArray path = request[1];
+    if (path == "/" || path == "/index.html") {
+        QFile page(QStringLiteral(":/web/remote_view.html"));
+        page.open(QIODevice::ReadOnly);
+        respond(client.socket, "200 OK", "text/html; charset=utf-8", page.readAll());
+        return false;
+    }
+    if (path != "/stream" || !headers.value("upgrade").toLower().contains("websocket")) {
+        respond(client.socket, "404 Not Found", "text/plain", "Not found\n");
+        return false;
+    }
+
+    // RFC 6455 4.2.2: accept = base64(SHA-1(key + GUID)).
+    const QByteArray key = headers.value("sec-websocket-key");
+    if (key.isEmpty()) {
+        respond(client.socket, "400 Bad Request", "text/plain", "Missing Sec-WebSocket-Key\n");
+        return false;
+    }
+    const QByteArray accept = QCryptographicHash::hash(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11",
+        QCryptographicHash::Sha1).toBase64();
+    client.socket->write("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: " + accept + "\r\n\r\n");
+    client.websocket = true;
+    sendInit(client);
+    if (m_viewport) m_viewport->requestRedraw();   // a fresh frame for the newcomer
+    emit viewersChanged(viewerCount());
+    return handleFrames(client);
+}
+
+bool RemoteViewServer::handleFrames(Client& client)
+{
+    QByteArray& in = client.incoming;
+    for (;;) {
+        if (in.size() < 2) return true;
+        const quint8 b0 = quint8(in[0]), b1 = quint8(in[1]);
+        const bool fin = b0 & 0x80;
+        const quint8 opcode = b0 & 0x0F;
+        quint64 length = b1 & 0x7F;
+        int at = 2;
+        if (length == 126) {
+            if (in.size() < 4) return true;
+            length = be32(in, 0) & 0xFFFF;
+            at = 4;
+        } else if (length == 127) {
+            if (in.size() < 10) return true;
+            length = be64(in, 2);
+            at = 10;
+        }
+        // Clients must mask (RFC 6455 5.1); nothing a viewer sends is large.
+        if (!(b1 & 0x80) || length > quint64(kMaxMessageBytes)) return false;
+        if (quint64(in.size()) < quint64(at) + 4 + length) return true;
+
+        const QByteArray mask = in.mid(at, 4);
+        QByteArray payload = in.mid(at + 4, int(length));
+        for (int i = 0; i < payload.size(); ++i) payload[i] = char(payload[i] ^ mask[i & 3]);
+        in.remove(0, at + 4 + int(length));
+
+        switch (opcode) {
+        case kOpClose:
+            sendFrame(client.socket, kOpClose, payload.left(2));
+            return false;
+        case kOpPing:
+            sendFrame(client.socket, kOpPong, payload);
+            continue;
+        case kOpText:
+            client.message = payload;
+            break;
+        case kOpContinuation:
+            client.message += payload;
+            if (client.message.size() > kMaxMessageBytes) return false;
+            break;
+        default:   // pong, binary: nothing to do
+            continue;
+        }
+        if (fin) {
+            if (m_settings.allowInput) handleInput(client.message);
+            client.message.clear();
+        }
+    }
+}
+
+void RemoteViewServer::sendFrame(QTcpSocket* socket, quint8 opcode, const QByteArray& payload)
+{
+    // Server frames are never masked.
+    QByteArray header;
+    header.append(char(0x80 | opcode));
+    const quint64 n = quint64(payload.size());
+    if (n < 126) {
+        header.append(char(n));
+    } else if (n < 65536) {
+        header.append(char(126));
+        header.append(char(n >> 8)).append(char(n));
+    } else {
+        header.append(char(127));
+        for (int shift = 56; shift >= 0; shift -= 8) header.append(char(n >> shift));
+    }
+    socket->write(header);
+    socket->write(payload);
+}
+
+// --- Input ---
+
+void RemoteViewServer::handleInput(const QByteArray& json)
+{
+    ViewportWidget* viewport = m_viewport;
+    if (!viewport) return;
+    const QJsonObject event = QJsonDocument::fromJson(json).object();
+    const QString type = event.value("type").toString();
+    const QString action = event.value("action").toString();
+    const Qt::KeyboardModifiers mods = modifiersFrom(event.value("mods").toInt());
+
+    // Positions arrive normalised to the picture.
+    const QPointF pos(event.value("x").toDouble() * viewport->width(), event.value("y").toDouble() * viewport->height());
+    const QPointF global = viewport->mapToGlobal(pos);
+    const Qt::MouseButtons buttons = buttonsFrom(event.value("buttons").toInt());
+
+    if (type == "mouse") {
+        QEvent::Type qtType = QEvent::MouseMove;
+        if (action == "down") qtType = QEvent::MouseButtonPress;
+        else if (action == "up") qtType = QEvent::MouseButtonRelease;
+        else if (action == "dblclick") qtType = QEvent::MouseButtonDblClick;
+        const Qt::MouseButton button = qtType == QEvent::MouseMove ? Qt::NoButton : buttonFrom(event.value("button").toInt());
+        QMouseEvent qtEvent(qtType, pos, global, button, buttons, mods);
+        QCoreApplication::sendEvent(viewport, &qtEvent);
+    } else if (type == "wheel") {
+        // DOM deltaY is pixels, positive towards the user; a notch is ~100 px vs 120 eighths of a degree.
+        const int angle = int(-event.value("dy").toDouble() * 1.2);
+        QWheelEvent qtEvent(pos, global, QPoint(), QPoint(0, angle), buttons, mods, Qt::NoScrollPhase, false);
+        QCoreApplication::sendEvent(viewport, &qtEvent);
+    } else if (type == "key") {
+        const QString key = event.value("key").toString();
+        QKeyEvent qtEvent(action == "up" ? QEvent::KeyRelease : QEvent::KeyPress, keyFrom(key), mods,
+            key.size() == 1 ? key : QString());
+        QCoreApplication::sendEvent(viewport, &qtEvent);
+    }
+}
+
+// --- Encoding ---
+
+void RemoteViewServer::pushFrame()
+{
+    if (m_viewport) m_viewport->pollFrameTap();
+    if (viewerCount() == 0 || m_latest.isNull() || m_encoderFailed) return;
+    if (!m_encoder || m_latest.size() != m_encodedSize) {
+        if (!restartEncoder()) return;
+    }
+    if (m_encoder->ready()) m_encoder->write(m_latest);   // else the encoder is behind: skip a tick
+}
+
+bool RemoteViewServer::restartEncoder()
+{
+    stopEncoder();
+    const int fps = m_settings.fps;
+    const QString kbps = QString::number(kBitrateLadder[m_rung]) + 'k';
+    const QString bufsize = QString::number(kBitrateLadder[m_rung] / 2) + 'k';
+
+    VideoEncoder::Settings settings;
+    settings.width = m_latest.width();
+    settings.height = m_latest.height();
+    settings.fps = fps;
+    settings.codec = m_settings.codec;
+    settings.program = m_settings.program;
+    // A keyframe every second bounds how long a newcomer waits; no B-frames
+    // and a half-second VBV keep the encoder from holding frames back.
+    settings.extraArgs = { "-b:v", kbps, "-maxrate", kbps, "-bufsize", bufsize, "-g", QString::number(fps), "-bf", "0" };
+    if (m_settings.codec.contains("nvenc"))
+        settings.extraArgs << "-preset" << "p1" << "-tune" << "ll" << "-zerolatency" << "1";
+    else if (m_settings.codec.startsWith("libx26"))
+        settings.extraArgs << "-preset" << "ultrafast" << "-tune" << "zerolatency";
+    if (m_settings.codec.contains("hevc") || m_settings.codec.contains("265"))
+        settings.extraArgs << "-tag:v" << "hvc1";   // the sample entry browsers accept
+    // Fragmented MP4 with a fragment per frame: moov up front, then moof/mdat pairs.
+    settings.extraArgs << "-movflags" << "empty_moov+default_base_moof+frag_keyframe"
+        << "-frag_duration" << QString::number(1000000 / fps) << "-flush_packets" << "1";
+    settings.format = QStringLiteral("mp4");
+    settings.output = [this](const QByteArray& bytes) { encoded(bytes); };
+
+    m_encoder = std::make_unique<VideoEncoder>();
+    if (!m_encoder->open(settings)) {
+        qWarning() << "[RemoteView] Encoder" << m_settings.codec << "did not start; streaming is off.";
+        m_encoder.reset();
+        m_encoderFailed = true;
+        return false;
+    }
+    m_encodedSize = m_latest.size();
+    for (Client& client : m_clients) client.synced = false;
+    return true;
+}
+
+void RemoteViewServer::stopEncoder()
+{
+    if (m_encoder) m_encoder->abort();
+    m_encoder.reset();
+    m_encoded.clear();
+    m_init.clear();
+    m_mime.clear();
+    m_fragment.clear();
+}
+
+void RemoteViewServer::encoded(const QByteArray& bytes)
+{
+    // Split the stream into top-level boxes: ftyp + moov is the init
+    // segment, every moof + mdat pair one fragment.
+    m_encoded += bytes;
+    int at = 0;
+    while (m_encoded.size() - at >= 8) {
+        quint64 size = be32(m_encoded, at);
+        if (size == 1) {
+            if (m_encoded.size() - at < 16) break;
+            size = be64(m_encoded, at + 8);
+        }
+        if (size < 8 || size > quint64(m_encoded.size() - at)) break;
+        const QByteArray type = m_encoded.mid(at + 4, 4);
+        const QByteArray box = m_encoded.mid(at, int(size));
+        at += int(size);
+
+        if (type == "ftyp") {
+            m_init = box;
+            m_mime.clear();   // incomplete until moov
+        } else if (type == "moov") {
+            m_init += box;
+            m_mime = mimeFor(m_init);
+            for (Client& client : m_clients)
+                if (client.websocket) sendInit(client);
+        } else if (type == "moof") {
+            m_fragment = box;
+        } else if (type == "mdat" && !m_fragment.isEmpty()) {
+            const bool keyframe = startsWithKeyframe(m_fragment);
+            m_fragment += box;
+            sendFragment(m_fragment, keyframe);
+            m_fragment.clear();
+        }
+    }
+    m_encoded.remove(0, at);
+}
+
+void RemoteViewServer::sendInit(Client& client)
+{
+    client.synced = false;
+    if (m_mime.isEmpty()) return;   // sent to everyone once the encoder writes moov
+    const QJsonObject message{ { "type", "init" }, { "mime", m_mime }, { "kbps", bitrateKbps() } };
+    sendFrame(client.socket, kOpText, QJsonDocument(message).toJson(QJsonDocument::Compact));
+    sendFrame(client.socket, kOpBinary, m_init);
+}
+
+void RemoteViewServer::sendFragment(const QByteArray& fragment, bool keyframe)
+{
+    const qint64 limit = std::max(qint64(kMaxBacklogSeconds * bitrateKbps() * 1000 / 8), kMinBacklogBytes);
+    for (Client& client : m_clients) {
+        if (!client.websocket) continue;
+        if (!client.synced) {
+            if (!keyframe) continue;
+            client.synced = true;
+        }
+        // Behind: skip to the next keyframe rather than queue more latency.
+        if (client.socket->bytesToWrite() > limit) {
+            client.congested = true;
+            client.synced = false;
+            continue;
+        }
+        sendFrame(client.socket, kOpBinary, fragment);
+    }
+}
+
+void RemoteViewServer::adaptBitrate()
+{
+    bool congested = false;
+    for (Client& client : m_clients) {
+        congested |= client.congested;
+        client.congested = false;
+    }
+    constexpr int kRungs = int(std::size(kBitrateLadder));
+    int rung = m_rung;
+    if (congested) {
+        rung = std::min(m_rung + 1, kRungs - 1);
+        m_calmSeconds = -kStepUpSeconds;   // wait longer before probing upwards again
+    } else if (++m_calmSeconds >= kStepUpSeconds && m_rung > 0) {
+        rung = m_rung - 1;
+        m_calmSeconds = 0;
+    }
+    if (rung == m_rung) return;
+    m_rung = rung;
+    qDebug() << "[RemoteView] Bitrate" << bitrateKbps() << "kbit/s";
+    if (m_encoder) restartEncoder();
+}
@@ -0,0 +1,21 @@
+#include "RenderLayers.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+std::uint32_t RenderLayers::fromName(const std::string& name)
+{
+    if (name.empty() || name == "Default" || name == "Visual") return Visual;
+    if (name == "Collision") return Collision;
+    if (name == "Helpers") return Helpers;
+
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::uint32_t> bits;
+    static int next = kFirstNamed;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (const auto it = bits.find(name); it != bits.end()) return it->second;
+    if (next >= 32) return Visual;
+    const std::uint32_t bit = 1u << next++;
+    bits.emplace(name, bit);
+    return bit;
+}
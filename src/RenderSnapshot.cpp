@@ -0,0 +1,327 @@
+#include "RenderSnapshot.hpp"
+#include "components.hpp"
+#include "MeshCache.hpp"
+#include "Prefab.hpp"
+#include "CullingSystem.hpp"
+#include "TransformSystem.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+#include <utility>
+
+namespace
+{
+    // The entity's mesh, or its whole resource, is going: its key loses a user.
+    void dropMeshKey(entt::registry& registry, entt::entity e)
+    {
+        if (auto* res = registry.try_get<RenderResourceComponent>(e))
+            if (auto* refs = registry.ctx().find<MeshKeyRefs>()) refs->assign(*res, 0);
+    }
+
+    // The camera 'e' is or hangs under, so a view can skip its own gizmo.
+    entt::entity owningCamera(const entt::registry& registry, entt::entity e)
+    {
+        for (int depth = 0; depth < 64 && registry.valid(e); ++depth) {
+            if (registry.all_of<CameraComponent>(e)) return e;
+            const auto* parent = registry.try_get<ParentComponent>(e);
+            if (!parent) break;
+            e = parent->parent;
+        }
+        return entt::null;
+    }
+}
+
+void RenderSnapshotBuffer::extract(entt::registry& registry)
+{
+    std::shared_ptr<RenderSnapshot> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_spare && m_spare.use_count() == 1) snapshot = std::move(m_spare);
+    }
+    if (!snapshot) snapshot = std::make_shared<RenderSnapshot>();
+
+    RenderSnapshot& out = *snapshot;
+    out.meshes.clear();   // keeps capacity: steady state allocates nothing but the mesh handles' refcounts
+    out.lights.clear();
+    out.ghosts.clear();
+    out.frames.clear();
+    out.labels.clear();
+    out.fleets.clear();
+    out.fleetInstances.clear();
+    out.fleetJoints.clear();
+    out.selectedCount = 0;
+    out.contactCount = 0;
+
+    MeshKeyRefs& refs = MeshKeyRefs::of(registry);
+    for (auto [entity, mesh, xf] : renderableMeshes(registry).each()) {
+        if (mesh.indices().empty()) continue;
+
+        RenderSnapshot::Mesh& item = out.meshes.emplace_back();
+        item.entity = entity;
+        item.camera = owningCamera(registry, entity);
+        item.data = mesh.mesh;
+
+        // Keyed by content, so every handle to equal geometry (ten spawns of
+        // one robot, every placeholder cube) shares one upload and one batch.
+        const MeshData& data = *mesh.mesh;
+        auto& res = registry.get_or_emplace<RenderResourceComponent>(entity);
+        refs.assign(res, MeshCache::keyOf(data));
+        item.meshKey = res.meshKey;
+
+        const auto* world = registry.try_get<WorldTransformComponent>(entity);
+        item.model = world ? world->matrix : xf.getTransform();
+        const auto* material = registry.try_get<MaterialComponent>(entity);
+        item.albedo = material ? material->albedo : glm::vec3(0.8f);
+        if (material) {
+            item.metallic = material->metallic;
+            item.roughness = material->roughness;
+            item.emissive = material->emissive;
+            item.albedoMap = material->albedoMap;
+            item.metalRoughnessMap = material->metalRoughnessMap;
+        }
+        if (const auto* bounds = registry.try_get<WorldBoundsComponent>(entity); bounds && bounds->valid) {
+            item.boundsMin = bounds->min;
+            item.boundsMax = bounds->max;
+            item.boundsValid = true;
+        }
+        item.selected = registry.all_of<SelectedComponent>(entity);
+        item.contact = registry.all_of<CollisionContactComponent>(entity);
+        const auto* link = registry.try_get<LinkComponent>(entity);
+        item.castsShadow = !link || link->description.casts_shadow;
+        const auto* layer = registry.try_get<LayerComponent>(entity);
+        item.layers = link && !link->description.is_visible ? 0u : layer ? layer->mask : RenderLayers::Visual;
+        out.selectedCount += item.selected;
+        out.contactCount += item.contact;
+    }
+
+    // Collision meshes are entries of their own on the Collision layer, made
+    // only while some camera shows that layer.
+    std::uint32_t shown = 0;
+    for (auto [entity, camera] : registry.view<CameraComponent>().each()) shown |= camera.layerMask;
+    if (shown & RenderLayers::Collision) {
+        for (auto [entity, collision, xf] : registry.view<CollisionMeshComponent, TransformComponent>().each()) {
+            if (!collision.mesh || collision.mesh->indices.empty()) continue;
+            RenderSnapshot::Mesh& item = out.meshes.emplace_back();
+            item.entity = entity;
+            item.camera = owningCamera(registry, entity);
+            item.data = collision.mesh;
+            const MeshData& data = *collision.mesh;
+            item.meshKey = MeshCache::keyOf(data);
+            const auto* world = registry.try_get<WorldTransformComponent>(entity);
+            item.model = world ? world->matrix : xf.getTransform();
+            item.albedo = glm::vec3(0.9f, 0.35f, 0.2f);
+            item.selected = registry.all_of<SelectedComponent>(entity);
+            item.castsShadow = false;
+            item.layers = RenderLayers::Collision;
+            out.selectedCount += item.selected;
+        }
+    }
+
+    // Prefab instances are one entity each; their parts are expanded here.
+    for (auto [entity, instance, xf] : registry.view<PrefabInstanceComponent, TransformComponent>().each()) {
+        if (!instance.prefab || !instance.posed || instance.gpuPosed) continue;
+        const Prefab& prefab = *instance.prefab;
+        const auto* layer = registry.try_get<LayerComponent>(entity);
+        const std::uint32_t layers = layer ? layer->mask : RenderLayers::Visual;
+        const auto* world = registry.try_get<WorldTransformComponent>(entity);
+        const glm::mat4 root = world ? world->matrix : xf.getTransform();
+        const entt::entity camera = owningCamera(registry, entity);
+        const bool selected = registry.all_of<SelectedComponent>(entity);
+        const bool contact = registry.all_of<CollisionContactComponent>(entity);
+
+        for (std::size_t i = 0; i < prefab.parts.size(); ++i) {
+            const Prefab::Part& part = prefab.parts[i];
+            RenderSnapshot::Mesh& item = out.meshes.emplace_back();
+            item.entity = entity;
+            item.camera = camera;
+            item.data = part.mesh;
+            item.meshKey = part.meshKey;
+            item.model = root * PrefabSystem::partMatrix(prefab, instance, i);
+            item.albedo = part.material.albedo;
+            item.metallic = part.material.metallic;
+            item.roughness = part.material.roughness;
+            item.emissive = part.material.emissive;
+            item.albedoMap = part.material.albedoMap;
+            item.metalRoughnessMap = part.material.metalRoughnessMap;
+            CullingSystem::transformBox(item.model, part.localMin, part.localMax, item.boundsMin, item.boundsMax);
+            item.boundsValid = true;
+            item.selected = selected;
+            item.contact = contact;
+            item.castsShadow = part.castsShadow;
+            item.layers = layers;
+            out.selectedCount += selected;
+            out.contactCount += contact;
+        }
+    }
+
+    // GPU posed instances: a root and the joint coordinates each, with the
+    // instances of one prefab contiguous, so counted before they are copied.
+    auto fleetOf = [&](const Prefab* prefab) -> RenderSnapshot::Fleet* {
+        for (RenderSnapshot::Fleet& fleet : out.fleets)
+            if (fleet.prefab.get() == prefab) return &fleet;
+        return nullptr;
+    };
+    for (auto [entity, instance, xf] : registry.view<PrefabInstanceComponent, TransformComponent>().each()) {
+        if (!instance.prefab || !instance.posed || !instance.gpuPosed) continue;
+        RenderSnapshot::Fleet* fleet = fleetOf(instance.prefab.get());
+        if (!fleet) fleet = &out.fleets.emplace_back(RenderSnapshot::Fleet{ instance.prefab });
+        ++fleet->instanceCount;
+    }
+    if (!out.fleets.empty()) {
+        std::uint32_t first = 0;
+        for (RenderSnapshot::Fleet& fleet : out.fleets) {
+            fleet.firstInstance = first;
+            first += fleet.instanceCount;
+            fleet.instanceCount = 0;   // counts up again as they are copied
+        }
+        out.fleetInstances.resize(first);
+        for (auto [entity, instance, xf] : registry.view<PrefabInstanceComponent, TransformComponent>().each()) {
+            if (!instance.prefab || !instance.posed || !instance.gpuPosed) continue;
+            RenderSnapshot::Fleet* fleet = fleetOf(instance.prefab.get());
+            RenderSnapshot::FleetInstance& item = out.fleetInstances[fleet->firstInstance + fleet->instanceCount++];
+            item.entity = entity;
+            const auto* world = registry.try_get<WorldTransformComponent>(entity);
+            item.root = world ? world->matrix : xf.getTransform();
+            CullingSystem::transformBox(item.root, instance.localMin, instance.localMax, item.boundsMin, item.boundsMax);
+            const auto* layer = registry.try_get<LayerComponent>(entity);
+            item.layers = layer ? layer->mask : RenderLayers::Visual;
+            item.firstJoint = std::uint32_t(out.fleetJoints.size());
+            out.fleetJoints.insert(out.fleetJoints.end(), instance.q.begin(), instance.q.end());
+        }
+    }
+
+    // Trajectory ghosts share their robot's link meshes; the poses are shared
+    // with the component, not copied.
+    for (auto [entity, ghost] : registry.view<TrajectoryGhostComponent>().each()) {
+        const auto* kin = registry.try_get<KinematicModelComponent>(ghost.robot);
+        if (!ghost.poses || !kin || std::size_t(ghost.linkCount) != kin->links.size()) continue;
+        const auto* world = registry.try_get<WorldTransformComponent>(ghost.robot);
+        const auto* xf = registry.try_get<TransformComponent>(ghost.robot);
+        const glm::mat4 root = world ? world->matrix : xf ? xf->getTransform() : glm::mat4(1.0f);
+
+        for (int i = 0; i < ghost.linkCount; ++i) {
+            const entt::entity link = kin->links[i];
+            if (!registry.valid(link)) continue;
+            const auto* mesh = registry.try_get<RenderableMeshComponent>(link);
+            const auto* res = registry.try_get<RenderResourceComponent>(link);
+            if (!mesh || !mesh->mesh || mesh->indices().empty() || !res) continue;
+            if (const auto* info = registry.try_get<LinkComponent>(link); info && !info->description.is_visible)
+                continue;
+
+            RenderSnapshot::Ghost& item = out.ghosts.emplace_back();
+            item.data = mesh->mesh;
+            item.meshKey = res->meshKey;
+            item.root = root;
+            item.poses = ghost.poses;
+            item.link = i;
+            item.linkCount = ghost.linkCount;
+            item.colour = ghost.colour;
+            item.startAlpha = ghost.startAlpha;
+            item.endAlpha = ghost.endAlpha;
+        }
+    }
+
+    for (auto [entity, light, xf] : registry.view<PointLightComponent, TransformComponent>().each()) {
+        if (light.range <= 0.0f || light.intensity <= 0.0f) continue;
+        RenderSnapshot::Light& item = out.lights.emplace_back();
+        item.camera = owningCamera(registry, entity);
+        const auto* world = registry.try_get<WorldTransformComponent>(entity);
+        item.position = glm::vec3((world ? world->matrix : xf.getTransform())[3]);
+        item.range = light.range;
+        const auto* material = registry.try_get<MaterialComponent>(entity);
+        const bool pulsing = material && registry.all_of<PulsingLightComponent>(entity);
+        item.color = (pulsing ? material->albedo : light.color) * light.intensity;
+    }
+
+    for (auto [entity, label, xf] : registry.view<LabelComponent, TransformComponent>().each()) {
+        if (label.text.empty()) continue;
+        const auto* world = registry.try_get<WorldTransformComponent>(entity);
+        RenderSnapshot::Label& item = out.labels.emplace_back();
+        item.entity = entity;
+        item.anchor = glm::vec3((world ? world->matrix : xf.getTransform()) * glm::vec4(label.offset, 1.0f));
+        item.text = label.text;
+        item.colour = label.colour;
+        item.pixelHeight = label.pixelHeight;
+    }
+
+    if (m_extractFrames) {
+        // Links straight from the propagated world matrices, in hierarchy order.
+        const std::vector<entt::entity>& order = TransformSystem::hierarchyOrder(registry);
+        const std::vector<glm::mat4>& world = TransformSystem::worldMatrices(registry);
+        for (std::size_t i = 0; i < order.size() && i < world.size(); ++i) {
+            const auto* link = registry.try_get<LinkComponent>(order[i]);
+            if (!link) continue;
+            out.frames.push_back(world[i]);
+            for (const NamedTransform& mount : link->description.sensor_mounts) {
+                const glm::quat rotation = glm::angleAxis(mount.rpy.z, glm::vec3(0, 0, 1))
+                                         * glm::angleAxis(mount.rpy.y, glm::vec3(0, 1, 0))
+                                         * glm::angleAxis(mount.rpy.x, glm::vec3(1, 0, 0));
+                glm::mat4 local = glm::mat4_cast(rotation);
+                local[3] = glm::vec4(mount.position, 1.0f);
+                out.frames.push_back(world[i] * local);
+            }
+        }
+        for (auto [entity, instance, xf] : registry.view<PrefabInstanceComponent, TransformComponent>().each()) {
+            if (!instance.posed || instance.linkMatrices.empty()) continue;
+            const auto* rootWorld = registry.try_get<WorldTransformComponent>(entity);
+            const glm::mat4 root = rootWorld ? rootWorld->matrix : xf.getTransform();
+            for (const glm::mat4& link : instance.linkMatrices) out.frames.push_back(root * link);
+        }
+    }
+
+    // Draw lists, one dense pass over the meshes per camera; the views then
+    // only walk what they show.
+    std::size_t viewCount = 0;
+    for (auto [cameraEntity, camera] : registry.view<CameraComponent>().each()) {
+        if (viewCount == out.views.size()) out.views.emplace_back();
+        RenderSnapshot::View& view = out.views[viewCount++];
+        view.camera = cameraEntity;
+        view.mask = camera.layerMask;
+        view.meshes.clear();
+        for (std::size_t i = 0; i < out.meshes.size(); ++i) {
+            const RenderSnapshot::Mesh& mesh = out.meshes[i];
+            if ((mesh.layers & view.mask) && mesh.camera != cameraEntity) view.meshes.push_back(std::uint32_t(i));
+        }
+    }
+    out.views.resize(viewCount);
+    out.frame = ++m_frame;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_spare = std::exchange(m_front, std::move(snapshot));
+}
+
+MeshKeyRefs& MeshKeyRefs::of(entt::registry& registry)
+{
+    if (auto* refs = registry.ctx().find<MeshKeyRefs>()) return *refs;
+    registry.on_destroy<RenderableMeshComponent>().connect<&dropMeshKey>();
+    registry.on_destroy<RenderResourceComponent>().connect<&dropMeshKey>();
+    return registry.ctx().emplace<MeshKeyRefs>();
+}
+
+void MeshKeyRefs::assign(RenderResourceComponent& res, std::size_t key)
+{
+    if (res.meshKey == key) return;
+    if (res.meshKey != 0) {
+        const auto it = m_count.find(res.meshKey);
+        if (it != m_count.end() && --it->second == 0) {
+            m_count.erase(it);
+            m_unused.push_back(res.meshKey);
+        }
+    }
+    if (key != 0) ++m_count[key];
+    res.meshKey = key;
+}
+
+std::vector<std::size_t> MeshKeyRefs::takeUnused()
+{
+    std::vector<std::size_t> unused;
+    for (std::size_t key : m_unused)
+        if (m_count.find(key) == m_count.end()) unused.push_back(key);
+    m_unused.clear();
+    return unused;
+}
+
+std::shared_ptr<const RenderSnapshot> RenderSnapshotBuffer::latest() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_front;
+}
@@ -1,15 +1,28 @@
 ﻿#include "RenderingSystem.hpp"
+#include "GpuMemory.hpp"
+#include "Trace.hpp"
 #include "Scene.hpp"
 #include "components.hpp"
 #include "Shader.hpp"
 #include "Camera.hpp"
 #include "PrimitiveBuilders.hpp"
+#include "MeshCache.hpp"
+#include "RenderStats.hpp"
+#include "TraceZones.hpp"
+#include "SplineEvaluation.hpp"
+#include "AnimationTracks.hpp"
 #include "FieldSolver.hpp" // Included for the new FieldSolver integration
+#include "GradientLut.hpp"
+#include "KinematicModel.hpp"
+#include "Prefab.hpp"
+#include "IntersectionSystem.hpp"
 
 #include <QOpenGLFunctions_4_3_Core>
 #include <QOpenGLContext> // Required for per-context resource management
+#include <QOpenGLDebugLogger>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <QDebug>
 #include <stdexcept>
@@ -18,7 +31,30 @@
 #include <QSurface>
 #include <QOpenGLWidget>
 #include <QOpenGLVersionFunctionsFactory>
+#include <QElapsedTimer>
+#include <QSurfaceFormat>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#ifndef GL_ZERO_TO_ONE               // GL 4.5 / ARB_clip_control
+#define GL_NEGATIVE_ONE_TO_ONE 0x935E
+#define GL_ZERO_TO_ONE         0x935F
+#endif
+#if KR_SHADER_HOT_RELOAD
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QStringList>
+#endif
 #include <random>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <cstdint>
+#include <array>
+#include <cmath>
+#include <cstring>
 
 #define CHECK_GL_ERROR()                                                       \
     do {                                                                       \
@@ -29,41 +65,49 @@
         }                                                                      \
     } while (0)
 
-struct GLStateSnapshot {
-    GLboolean blendEnabled;
-    GLboolean depthMask;
-    GLboolean cullFaceEnabled;
-    GLint blendSrcRGB;
-    GLint blendDstRGB;
-    GLint blendSrcAlpha;
-    GLint blendDstAlpha;
-    GLint blendEquationRGB;
-    GLint blendEquationAlpha;
-};
-
-void restoreGLState(QOpenGLFunctions_4_3_Core* gl, const GLStateSnapshot& snapshot) {
-    if (snapshot.blendEnabled) gl->glEnable(GL_BLEND);
-    else gl->glDisable(GL_BLEND);
-
-    gl->glDepthMask(snapshot.depthMask);
-
-    if (snapshot.cullFaceEnabled) gl->glEnable(GL_CULL_FACE);
-    else gl->glDisable(GL_CULL_FACE);
+namespace {
+#if KR_SHADER_HOT_RELOAD
+// Shader files only ever #included by others (see Shader's source loader).
+constexpr const char* kShaderIncludes[] = { "frame_uniforms.glsl", "mesh_effector_field.glsl" };
+#endif
+
+// Value written to the ID attachment; 0 means "no entity".
+inline std::uint32_t pickIdOf(entt::entity e) { return std::uint32_t(entt::to_integral(e)) + 1u; }
+
+// Render targets are allocated in steps and drawn into their bottom-left
+// corner, so dragging a dock splitter reuses one allocation for many sizes.
+constexpr int kTargetBucket = 256;
+inline int targetBucket(int size) { return (std::max(1, size) + kTargetBucket - 1) / kTargetBucket * kTargetBucket; }
+// An allocation is kept while it covers 'needed' and is not over twice its bucket.
+inline bool targetFits(int allocated, int needed) { return needed <= allocated && allocated <= 2 * targetBucket(needed); }
+// Fraction of a target's textures the current view covers; post_process_vert's u_uvScale.
+inline glm::vec2 targetUvScale(const RenderingSystem::TargetFBOs& t)
+{
+    return { float(t.viewW) / float(t.w), float(t.viewH) / float(t.h) };
+}
 
-    gl->glBlendFuncSeparate(snapshot.blendSrcRGB, snapshot.blendDstRGB, snapshot.blendSrcAlpha, snapshot.blendDstAlpha);
-    gl->glBlendEquationSeparate(snapshot.blendEquationRGB, snapshot.blendEquationAlpha);
+// Halton(2, 3) sub-pixel offsets for the temporal jitter, in pixels.
+constexpr int kTemporalJitterPhases = 8;
+inline float halton(int index, int base)
+{
+    float f = 1.0f, r = 0.0f;
+    for (; index > 0; index /= base) {
+        f /= float(base);
+        r += f * float(index % base);
+    }
+    return r;
 }
 
-void saveGLState(QOpenGLFunctions_4_3_Core* gl, GLStateSnapshot& snapshot) {
-    gl->glGetBooleanv(GL_BLEND, &snapshot.blendEnabled);
-    gl->glGetBooleanv(GL_DEPTH_WRITEMASK, &snapshot.depthMask);
-    gl->glGetBooleanv(GL_CULL_FACE, &snapshot.cullFaceEnabled);
-    gl->glGetIntegerv(GL_BLEND_SRC_RGB, &snapshot.blendSrcRGB);
-    gl->glGetIntegerv(GL_BLEND_DST_RGB, &snapshot.blendDstRGB);
-    gl->glGetIntegerv(GL_BLEND_SRC_ALPHA, &snapshot.blendSrcAlpha);
-    gl->glGetIntegerv(GL_BLEND_DST_ALPHA, &snapshot.blendDstAlpha);
-    gl->glGetIntegerv(GL_BLEND_EQUATION_RGB, &snapshot.blendEquationRGB);
-    gl->glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &snapshot.blendEquationAlpha);
+// Towards the phong shaders' key light. Directional, so its shadows cascade.
+const glm::vec3 kKeyLightDirection = glm::normalize(glm::vec3(5.0f, 10.0f, 5.0f));
+// Arrow length of a frame triad on screen, pixels.
+constexpr float kFrameTriadPixels = 36.0f;
+// View depths the shadow cascades cover, split between log and uniform spacing.
+constexpr float kShadowNear = 0.05f, kShadowDistance = 60.0f, kShadowSplitLambda = 0.8f;
+// How far towards the light a cascade keeps casters; depth clamping flattens the rest.
+constexpr float kShadowCasterReach = 100.0f;
+// Snapshot frames a caster must stay put before it is cached with the static ones.
+constexpr std::uint64_t kShadowSettleFrames = 30;
 }
 
 static const char* fbStatusStr(GLenum s)
@@ -126,92 +170,44 @@ static void debugTexturePixel(QOpenGLFunctions_4_3_Core* gl,
 
 //---------- HELPER FUNCTIONS (Formatted for Clarity) ------------------
 
-// Evaluates a Catmull-Rom spline on the CPU.
-static std::vector<glm::vec3> evaluateCatmullRomCPU(const std::vector<glm::vec3>& controlPoints, int segmentsPerCurve)
+// A grid's GridUniforms block; hidden and missing levels get no spacing.
+static GridUniformsGpu packGridUniforms(const GridComponent& grid, const glm::mat4& model, const SceneProperties& props)
 {
-    std::vector<glm::vec3> lineVertices;
-    if (controlPoints.size() < 4) { // A segment requires at least 4 control points.
-        return lineVertices;
-    }
-
-    lineVertices.reserve(static_cast<size_t>(controlPoints.size() - 3) * segmentsPerCurve); // Pre-allocate memory for efficiency.
-
-    // Iterate through each 4-point segment of the spline.
-    for (size_t i = 0; i < controlPoints.size() - 3; ++i) {
-        const glm::vec3& p0 = controlPoints[i];
-        const glm::vec3& p1 = controlPoints[i + 1];
-        const glm::vec3& p2 = controlPoints[i + 2];
-        const glm::vec3& p3 = controlPoints[i + 3];
-
-        // Generate the points for the current segment.
-        for (int j = 0; j < segmentsPerCurve; ++j) {
-            float t = static_cast<float>(j) / (segmentsPerCurve - 1); // Parameter t from 0 to 1.
-            float t2 = t * t;
-            float t3 = t2 * t;
-
-            // Catmull-Rom interpolation formula.
-            glm::vec3 point = 0.5f * (
-                (2.0f * p1) +
-                (-p0 + p2) * t +
-                (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
-                (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3
-                );
-            lineVertices.push_back(point);
-        }
-    }
-    return lineVertices;
-}
-
-// For linear "splines", the vertices are just the control points themselves.
-static std::vector<glm::vec3> evaluateLinearCPU(const std::vector<glm::vec3>& controlPoints) {
-    return controlPoints;
-}
-
-// Evaluates a Bezier curve on the CPU.
-static std::vector<glm::vec3> evaluateBezierCPU(const std::vector<glm::vec3>& controlPoints, int numSegments) {
-    std::vector<glm::vec3> lineVertices;
-    if (controlPoints.empty()) {
-        return lineVertices;
-    }
-    lineVertices.reserve(numSegments); // Pre-allocate memory.
-
-    // Lambda to calculate binomial coefficients (nCk).
-    auto binomialCoeff = [](int n, int k) {
-        long long res = 1;
-        if (k > n - k) k = n - k;
-        for (int i = 0; i < k; ++i) {
-            res = res * (n - i);
-            res = res / (i + 1);
-        }
-        return static_cast<float>(res);
-        };
-
-    int n = static_cast<int>(controlPoints.size()) - 1; // Degree of the curve.
-    for (int i = 0; i < numSegments; ++i) {
-        float t = static_cast<float>(i) / (numSegments - 1); // Parameter t from 0 to 1.
-        glm::vec3 point(0.0f);
-        // Sum up the control points weighted by the Bernstein polynomials.
-        for (int j = 0; j <= n; ++j) {
-            float bernstein = binomialCoeff(n, j) * pow(t, j) * pow(1 - t, n - j);
-            point += controlPoints[j] * bernstein;
-        }
-        lineVertices.push_back(point);
+    GridUniformsGpu u{};
+    u.model = model;
+    u.inverseModel = glm::inverse(model);
+    for (std::size_t i = 0; i < grid.levels.size() && i < std::size_t(kMaxGridLevels); ++i) {
+        const GridLevel& level = grid.levels[i];
+        u.levels[i].colorSpacing = glm::vec4(level.color, grid.levelVisible[i] ? level.spacing : 0.0f);
+        u.levels[i].fade = glm::vec4(level.fadeInCameraDistanceStart, level.fadeInCameraDistanceEnd, 0.0f, 0.0f);
     }
-    return lineVertices;
+    u.xAxisColor = glm::vec4(grid.xAxisColor, grid.axisLineWidthPixels);
+    u.zAxisColor = glm::vec4(grid.zAxisColor, grid.baseLineWidthPixels);
+    u.fogColor = glm::vec4(props.fogColor, props.fogEnabled ? 1.0f : 0.0f);
+    u.params = glm::vec4(props.fogStartDistance, props.fogEndDistance, grid.isDotted ? 1.0f : 0.0f, grid.showAxes ? 1.0f : 0.0f);
+    return u;
 }
 
-// Evaluates a user-defined parametric function on the CPU.
-static std::vector<glm::vec3> evaluateParametricCPU(const std::function<glm::vec3(float)>& func, int numSegments) {
-    std::vector<glm::vec3> lineVertices;
-    if (!func) { // Ensure the function object is valid.
-        return lineVertices;
-    }
-    lineVertices.reserve(numSegments);
-    for (int i = 0; i < numSegments; ++i) {
-        float t = static_cast<float>(i) / (numSegments - 1); // Parameter t from 0 to 1.
-        lineVertices.push_back(func(t)); // Evaluate the function at t.
+// Re-samples a dirty spline, with its arc-length table, and bumps its
+// revision so GPU copies re-upload.
+static void rebuildSplineCache(SplineComponent& sp)
+{
+    std::vector<glm::vec3> vertices;
+    switch (sp.type) {
+    // Linear "splines" are just their control points.
+    case SplineType::Linear:     vertices = sp.controlPoints; break;
+    case SplineType::CatmullRom: vertices = SplineEvaluation::catmullRom(sp.controlPoints, 64); break;
+    case SplineType::Bezier:     vertices = SplineEvaluation::bezier(sp.controlPoints, 64); break;
+    case SplineType::PiecewiseBezier: vertices = SplineEvaluation::piecewiseBezier(sp.controlPoints, 64); break;
+    case SplineType::Parametric:
+        if (sp.parametric.func) vertices = SplineEvaluation::parametric(*sp.parametric.func, 128);
+        break;
     }
-    return lineVertices;
+    sp.arcLengths = std::make_shared<const SplineEvaluation::ArcLengthTable>(SplineEvaluation::arcLength(vertices));
+    sp.cache = std::make_shared<const std::vector<glm::vec3>>(std::move(vertices));
+    ++sp.cacheRevision;
+    // Mark the spline as clean until its control points are modified again.
+    sp.isDirty = false;
 }
 
 // Calculates the shortest rotation quaternion between two vectors.
@@ -239,22 +235,14 @@ static glm::quat rotationBetweenVectors(glm::vec3 from, glm::vec3 to) {
     return glm::quat(s * 0.5f, rotationAxis.x * invs, rotationAxis.y * invs, rotationAxis.z * invs);
 }
 
-// Linearly interpolates a color from a gradient based on a normalized value.
-static glm::vec4 getColorFromGradient(float value, const std::vector<ColorStop>& gradient) {
-    if (gradient.empty()) return glm::vec4(1.0f); // Default to white if gradient is undefined.
-    if (value <= gradient.front().position) return gradient.front().color; // Clamp to start color.
-    if (value >= gradient.back().position) return gradient.back().color; // Clamp to end color.
-
-    // Find the two color stops the value lies between.
-    for (size_t i = 0; i < gradient.size() - 1; ++i) {
-        if (value >= gradient[i].position && value <= gradient[i + 1].position) {
-            // Normalize the value within the range of the two stops.
-            float t = (value - gradient[i].position) / (gradient[i + 1].position - gradient[i].position);
-            // Interpolate the colors.
-            return glm::mix(gradient[i].color, gradient[i + 1].color, t);
-        }
-    }
-    return gradient.back().color; // Fallback.
+// The arrows' intensity gradient; blue to red (their colours before the
+// gradients were wired up) while the visualizer has none or colours otherwise.
+static const std::vector<ColorStop>& arrowGradient(const FieldVisualizerComponent::ArrowSettings& settings)
+{
+    static const std::vector<ColorStop> fallback = {
+        { 0.0f, glm::vec4(0.2f, 0.5f, 1.0f, 1.0f) }, { 1.0f, glm::vec4(1.0f, 0.3f, 0.3f, 1.0f) } };
+    const bool intensity = settings.coloringMode == FieldVisualizerComponent::ColoringMode::Intensity;
+    return intensity && !settings.intensityGradient.empty() ? settings.intensityGradient : fallback;
 }
 
 static QOpenGLFunctions_4_3_Core* resolveGl41(QOpenGLContext* ctx)
@@ -281,7 +269,7 @@ void RenderingSystem::ensureGlResolved()
     if (ctx == m_lastContext && m_gl)
         return;
 
-    qDebug() << "OpenGL context changed. Re-resolving function pointers for"
+    KR_TRACE(Frame) << "OpenGL context changed. Re-resolving function pointers for"
         << ctx;
 
     // 2 — Lost the context → clear cache and bail
@@ -300,6 +288,12 @@ void RenderingSystem::ensureGlResolved()
     }
     m_gl->initializeOpenGLFunctions();
 
+    // Shaders, meshes and the shared primitives live in the first context's
+    // share group; a context outside it would see none of them.
+    if (m_ownerCtx && !m_contextPrimitives.contains(ctx) && !isRenderCtx(ctx))
+        qCritical() << "[RenderingSystem] Context" << ctx << "does not share with the renderer's context;"
+                    << "set Qt::AA_ShareOpenGLContexts before creating any widget.";
+
     // 4 — Auto-invalidate the cache when this context is about to die
     //     (DirectConnection: slot runs *inside* the context-shutdown thread)
     QObject::connect(ctx, &QOpenGLContext::aboutToBeDestroyed,
@@ -329,9 +323,22 @@ RenderingSystem::RenderingSystem(QOpenGLWidget* w, QOpenGLFunctions_4_3_Core* gl
     :m_viewportWidget(w), m_gl(gl)
 {
     m_fieldSolver = std::make_unique<FieldSolver>();
+    // KR_RANDOM_SEED pins the particle randomness; otherwise every run differs.
+    bool pinned = false;
+    const int seed = qEnvironmentVariableIntValue("KR_RANDOM_SEED", &pinned);
+    m_randomSeed = pinned ? std::uint32_t(seed) : std::random_device{}();
+    // KR_ANTIALIASING=none|fxaa|taa|msaa<N>, per deployment; fxaa otherwise.
+    const QString aa = qEnvironmentVariable("KR_ANTIALIASING").toLower();
+    if (aa == QLatin1String("none")) m_antiAliasing = AntiAliasing::None;
+    else if (aa == QLatin1String("taa")) m_antiAliasing = AntiAliasing::Taa;
+    else if (aa.startsWith(QLatin1String("msaa"))) setAntiAliasing(AntiAliasing::Msaa, aa.mid(4).toInt() > 0 ? aa.mid(4).toInt() : 4);
+    else if (!aa.isEmpty() && aa != QLatin1String("fxaa")) qWarning() << "[RenderingSystem] unknown KR_ANTIALIASING" << aa << "- using fxaa";
 }
 
-RenderingSystem::~RenderingSystem() {}
+RenderingSystem::~RenderingSystem()
+{
+    for (int id : m_gpuEvictors) GpuMemory::removeEvictor(id);
+}
 
 //---------- PUBLIC: RENDER LOOP & LIFECYCLE MANAGEMENT ------------------
 
@@ -341,6 +348,12 @@ void RenderingSystem::initialize(int w, int h)
     if (!m_gl) {
         qFatal("RenderingSystem::initialize – no current context was provided.");
     }
+    m_state.setFunctions(m_gl);
+    m_state.invalidate();
+
+    m_ownerCtx = QOpenGLContext::currentContext();
+    QObject::connect(m_ownerCtx, &QOpenGLContext::aboutToBeDestroyed, m_ownerCtx,
+        [this] { m_ownerCtx = nullptr; }, Qt::DirectConnection);
 
     // +++ ADD THIS DIAGNOSTIC CODE +++
     const GLubyte* glVersion = m_gl->glGetString(GL_VERSION);
@@ -353,92 +366,187 @@ void RenderingSystem::initialize(int w, int h)
 
 
     initShaders();
-
-    m_gl->glEnable(GL_DEPTH_TEST);
-    m_gl->glEnable(GL_BLEND);
-    m_gl->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    m_gl->glGenBuffers(1, &m_debugBuffer);
-    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_debugBuffer);
-    m_gl->glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * 4096 * 16, nullptr, GL_DYNAMIC_COPY);
-
-    // Create a buffer for the atomic counter, initialized to 0
-    m_gl->glGenBuffers(1, &m_debugAtomicCounter);
-    m_gl->glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_debugAtomicCounter);
-    m_gl->glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
-    GLuint zero = 0;
-    m_gl->glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &zero);
-
+    resolveClipControl();
+    m_gl->glGetIntegerv(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &m_storageBindings);
+    GLint colorSamples = 0, depthSamples = 0, integerSamples = 0;
+    m_gl->glGetIntegerv(GL_MAX_COLOR_TEXTURE_SAMPLES, &colorSamples);
+    m_gl->glGetIntegerv(GL_MAX_DEPTH_TEXTURE_SAMPLES, &depthSamples);
+    m_gl->glGetIntegerv(GL_MAX_INTEGER_SAMPLES, &integerSamples);
+    m_maxMsaaSamples = std::min({ colorSamples, depthSamples, integerSamples });
+
+    m_state.setDepthTest(true);
+    m_state.setBlend(true);
+    m_state.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    registerGpuEvictors();
     m_isInitialized = true;
 }
 
+void RenderingSystem::registerGpuEvictors()
+{
+    for (int id : m_gpuEvictors) GpuMemory::removeEvictor(id);
+    m_gpuEvictors.clear();
+
+    // Budgets are process wide; only touch this system's objects from its own group.
+    auto ownGroup = [this] {
+        QOpenGLContext* ctx = QOpenGLContext::currentContext();
+        return ctx && m_ownerCtx && ctx->shareGroup() == m_ownerCtx->shareGroup();
+    };
+    m_gpuEvictors.push_back(GpuMemory::addEvictor([this, ownGroup](std::size_t) {
+        if (!ownGroup()) return;
+        for (const PooledTexture& texture : m_texturePool) GpuMemory::deleteTextures(m_gl, 1, &texture.id);
+        m_texturePool.clear();
+    }));
+    m_gpuEvictors.push_back(GpuMemory::addEvictor([this, ownGroup](std::size_t over) {
+        if (!ownGroup()) return;
+        m_pointClouds.setFunctions(m_gl);
+        m_pointClouds.trimPool(over, m_tick);
+    }));
+    m_gpuEvictors.push_back(GpuMemory::addEvictor([this, ownGroup](std::size_t over) {
+        if (!ownGroup()) return;
+        m_materials.setFunctions(m_gl);
+        m_materials.trim(over);
+    }));
+}
+
 void RenderingSystem::shutdown(entt::registry& registry) {
     if (!m_gl) return;
+    m_state.setFunctions(m_gl);
+    Shader::setBinaryCache(nullptr);
+    for (int id : m_gpuEvictors) GpuMemory::removeEvictor(id);
+    m_gpuEvictors.clear();
 
     qDebug() << "[LIFECYCLE] Shutting down per-context GPU resources.";
 
     // Per-context primitives (VAOs for grid, lines, etc.)
     for (auto const& primitives : m_contextPrimitives) {
         if (primitives.gridVAO) m_gl->glDeleteVertexArrays(1, &primitives.gridVAO);
-        if (primitives.gridVBO) m_gl->glDeleteBuffers(1, &primitives.gridVBO);
-        if (primitives.lineVAO) m_gl->glDeleteVertexArrays(1, &primitives.lineVAO);
-        if (primitives.lineVBO) m_gl->glDeleteBuffers(1, &primitives.lineVBO);
-        if (primitives.capVAO) m_gl->glDeleteVertexArrays(1, &primitives.capVAO);
-        if (primitives.capVBO) m_gl->glDeleteBuffers(1, &primitives.capVBO);
+        if (primitives.splineVAO) m_gl->glDeleteVertexArrays(1, &primitives.splineVAO);
+        if (primitives.splinePatchVAO) m_gl->glDeleteVertexArrays(1, &primitives.splinePatchVAO);
+        if (primitives.splineCapVAO) m_gl->glDeleteVertexArrays(1, &primitives.splineCapVAO);
+        if (primitives.splineStyleBuffer) GpuMemory::deleteBuffers(m_gl, 1, &primitives.splineStyleBuffer);
+        if (primitives.splineIndirectBuffer) GpuMemory::deleteBuffers(m_gl, 1, &primitives.splineIndirectBuffer);
         if (primitives.compositeVAO) m_gl->glDeleteVertexArrays(1, &primitives.compositeVAO);
         if (primitives.arrowVAO) m_gl->glDeleteVertexArrays(1, &primitives.arrowVAO);
-        if (primitives.arrowVBO) m_gl->glDeleteBuffers(1, &primitives.arrowVBO);
-        if (primitives.arrowEBO) m_gl->glDeleteBuffers(1, &primitives.arrowEBO);
-        if (primitives.instanceVBO) m_gl->glDeleteBuffers(1, &primitives.instanceVBO);
+        if (primitives.triadVAO) m_gl->glDeleteVertexArrays(1, &primitives.triadVAO);
+        if (primitives.frameBuffer) GpuMemory::deleteBuffers(m_gl, 1, &primitives.frameBuffer);
+        if (primitives.intersectionVAO) m_gl->glDeleteVertexArrays(1, &primitives.intersectionVAO);
+        if (primitives.labelVAO) m_gl->glDeleteVertexArrays(1, &primitives.labelVAO);
+        if (primitives.labelGlyphBuffer) GpuMemory::deleteBuffers(m_gl, 1, &primitives.labelGlyphBuffer);
+        if (primitives.labelBuffer) GpuMemory::deleteBuffers(m_gl, 1, &primitives.labelBuffer);
+        if (primitives.particleVAO) m_gl->glDeleteVertexArrays(1, &primitives.particleVAO);
+        if (primitives.particleDrawBuffer) GpuMemory::deleteBuffers(m_gl, 1, &primitives.particleDrawBuffer);
+        if (primitives.particleSortBuffer) GpuMemory::deleteBuffers(m_gl, 1, &primitives.particleSortBuffer);
+        if (primitives.particleSortCounts) GpuMemory::deleteBuffers(m_gl, 1, &primitives.particleSortCounts);
+        if (primitives.streamlineVAO) m_gl->glDeleteVertexArrays(1, &primitives.streamlineVAO);
+        PointCloudRenderer::ContextState pointClouds = primitives.pointClouds;
+        m_pointClouds.destroyContext(pointClouds);
+        ComputeDispatch::ContextQueries computeQueries = primitives.computeQueries;
+        m_compute.destroy(computeQueries);
+    }
+    m_contextPrimitives.clear();
+
+    // Shared buffers, once for the whole context group.
+    if (m_sharedPrimitives.gridVBO) GpuMemory::deleteBuffers(m_gl, 1, &m_sharedPrimitives.gridVBO);
+    if (m_sharedPrimitives.arrowVBO) GpuMemory::deleteBuffers(m_gl, 1, &m_sharedPrimitives.arrowVBO);
+    if (m_sharedPrimitives.arrowEBO) GpuMemory::deleteBuffers(m_gl, 1, &m_sharedPrimitives.arrowEBO);
+    if (m_sharedPrimitives.triadVBO) GpuMemory::deleteBuffers(m_gl, 1, &m_sharedPrimitives.triadVBO);
+    if (m_sharedPrimitives.triadEBO) GpuMemory::deleteBuffers(m_gl, 1, &m_sharedPrimitives.triadEBO);
+    if (m_sharedPrimitives.glyphAtlas) GpuMemory::deleteTextures(m_gl, 1, &m_sharedPrimitives.glyphAtlas);
+    m_sharedPrimitives = SharedPrimitives{};
+    if (m_lightBuffer) GpuMemory::deleteBuffers(m_gl, 1, &m_lightBuffer);
+    if (m_lightGridBuffer) GpuMemory::deleteBuffers(m_gl, 1, &m_lightGridBuffer);
+    if (m_lightIndexBuffer) GpuMemory::deleteBuffers(m_gl, 1, &m_lightIndexBuffer);
+    m_lightBuffer = m_lightGridBuffer = m_lightIndexBuffer = 0;
+    m_lightCapacity = 0;
+
+    for (auto const& batch : m_meshBatches) {
+        if (batch.arenaVAO) m_gl->glDeleteVertexArrays(1, &batch.arenaVAO);
+        if (batch.instanceBuffer) GpuMemory::deleteBuffers(m_gl, 1, &batch.instanceBuffer);
+        if (batch.indirectBuffer) GpuMemory::deleteBuffers(m_gl, 1, &batch.indirectBuffer);
+        if (batch.candidateBuffer) GpuMemory::deleteBuffers(m_gl, 1, &batch.candidateBuffer);
+        if (batch.clusterJobBuffer) GpuMemory::deleteBuffers(m_gl, 1, &batch.clusterJobBuffer);
+        if (batch.clusterDrawBuffer) GpuMemory::deleteBuffers(m_gl, 1, &batch.clusterDrawBuffer);
+        if (batch.shadowVAO) m_gl->glDeleteVertexArrays(1, &batch.shadowVAO);
+        if (batch.shadowInstanceBuffer) GpuMemory::deleteBuffers(m_gl, 1, &batch.shadowInstanceBuffer);
+        if (batch.shadowIndirectBuffer) GpuMemory::deleteBuffers(m_gl, 1, &batch.shadowIndirectBuffer);
+        if (batch.ghostVAO) m_gl->glDeleteVertexArrays(1, &batch.ghostVAO);
+        if (batch.ghostInstanceBuffer) GpuMemory::deleteBuffers(m_gl, 1, &batch.ghostInstanceBuffer);
+        if (batch.ghostIndirectBuffer) GpuMemory::deleteBuffers(m_gl, 1, &batch.ghostIndirectBuffer);
+        for (GLuint buffer : { batch.fleetLinkBuffer, batch.fleetPartBuffer, batch.fleetInstanceBuffer,
+                 batch.fleetJointBuffer, batch.fleetDrawnBuffer, batch.fleetPoseBuffer })
+            if (buffer) GpuMemory::deleteBuffers(m_gl, 1, &buffer);
     }
+    m_meshBatches.clear();
+    m_meshBatchScratch.clear();
+    m_snapshots.clear();   // drops the scene mesh handles the snapshots still hold
 
-    if (m_debugBuffer) m_gl->glDeleteBuffers(1, &m_debugBuffer);
-    if (m_debugAtomicCounter) m_gl->glDeleteBuffers(1, &m_debugAtomicCounter);
+    if (m_frameUBO) GpuMemory::deleteBuffers(m_gl, 1, &m_frameUBO);
+    m_frameUBO = 0;
+    if (m_gridUBO) GpuMemory::deleteBuffers(m_gl, 1, &m_gridUBO);
+    m_gridUBO = 0;
+    m_gridUniforms.clear();
+    m_gridUniformsValid.clear();
 
     m_contextPrimitives.clear();
 
     // Per-viewport FBOs
-    for (auto const& [widget, target] : m_targets) {
-        m_gl->glDeleteFramebuffers(1, &target.mainFBO);
-        m_gl->glDeleteTextures(1, &target.mainColorTexture);
-        m_gl->glDeleteTextures(1, &target.mainDepthTexture);
-        m_gl->glDeleteFramebuffers(1, &target.glowFBO);
-        m_gl->glDeleteTextures(1, &target.glowTexture);
-        m_gl->glDeleteFramebuffers(2, target.pingpongFBO);
-        m_gl->glDeleteTextures(2, target.pingpongTexture);
-    }
+    for (auto& [id, target] : m_targets) destroyTarget(target);
     m_targets.clear();
+    for (const PooledTexture& texture : m_texturePool) GpuMemory::deleteTextures(m_gl, 1, &texture.id);
+    m_texturePool.clear();
 
     qDebug() << "[LIFECYCLE] Shutting down per-entity GPU resources.";
-    auto view = registry.view<RenderResourceComponent>();
-    for (auto entity : view)
-    {
-        auto& res = view.get<RenderResourceComponent>(entity);
-        for (auto const& [context, buffers] : res.perContext) {
-            if (buffers.VAO) m_gl->glDeleteVertexArrays(1, &buffers.VAO);
-            if (buffers.VBO) m_gl->glDeleteBuffers(1, &buffers.VBO);
-            if (buffers.EBO) m_gl->glDeleteBuffers(1, &buffers.EBO);
-        }
-        res.perContext.clear();
-    }
+    m_meshArena.setFunctions(m_gl);
+    m_meshArena.destroy();
+    m_splineArena.setFunctions(m_gl);
+    m_splineArena.destroy();
+    m_materials.setFunctions(m_gl);
+    m_materials.destroy();
+    m_materialSnapshot = nullptr;
+    m_splineVertexArena.setFunctions(m_gl);
+    m_splineVertexArena.destroy();
+    m_effectorBuffers.destroy();
+    m_pointClouds.setFunctions(m_gl);
+    m_pointClouds.destroy();
+    m_reconstruction.setFunctions(m_gl);
+    m_reconstruction.destroy(m_meshArena);
+    m_virtualSensors.setFunctions(m_gl);
+    m_virtualSensors.destroy();
+    m_sensorBuffers.setFunctions(m_gl);
+    m_sensorBuffers.destroy();
+    if (m_fieldSimFence) m_gl->glDeleteSync(m_fieldSimFence);
+    m_fieldSimFence = nullptr;
+    m_fieldSimRegistry = nullptr;
 
     auto visualizerView = registry.view<FieldVisualizerComponent>();
     for (auto entity : visualizerView) {
         auto& vis = visualizerView.get<FieldVisualizerComponent>(entity);
         // Cleanup particle buffers
-        if (vis.particleVAO) m_gl->glDeleteVertexArrays(1, &vis.particleVAO);
-        if (vis.particleBuffer[0]) m_gl->glDeleteBuffers(2, vis.particleBuffer);
-        vis.particleVAO = 0;
+        if (vis.particleBuffer[0]) GpuMemory::deleteBuffers(m_gl, 2, vis.particleBuffer);
         vis.particleBuffer[0] = 0;
         vis.particleBuffer[1] = 0;
+        if (vis.particleListBuffer) GpuMemory::deleteBuffers(m_gl, 1, &vis.particleListBuffer);
+        vis.particleListBuffer = 0;
+        releaseStreamlines(vis.gpuData);
 
         // Cleanup arrow buffers
-        if (vis.gpuData.samplePointsSSBO) m_gl->glDeleteBuffers(1, &vis.gpuData.samplePointsSSBO);
-        if (vis.gpuData.instanceDataSSBO) m_gl->glDeleteBuffers(1, &vis.gpuData.instanceDataSSBO);
-        if (vis.gpuData.commandUBO) m_gl->glDeleteBuffers(1, &vis.gpuData.commandUBO);
+        if (vis.gpuData.samplePointsSSBO) GpuMemory::deleteBuffers(m_gl, 1, &vis.gpuData.samplePointsSSBO);
+        if (vis.gpuData.instanceDataSSBO) GpuMemory::deleteBuffers(m_gl, 1, &vis.gpuData.instanceDataSSBO);
+        if (vis.gpuData.commandUBO) GpuMemory::deleteBuffers(m_gl, 1, &vis.gpuData.commandUBO);
+        releaseAdaptiveArrows(vis.gpuData);
+        vis.gpuData.debugReadback.destroy(m_gl);
+        if (vis.gpuData.bakedFieldTexture) GpuMemory::deleteTextures(m_gl, 1, &vis.gpuData.bakedFieldTexture);
+        vis.gpuData.bakedFieldTexture = 0;
+        releaseTemporalField(vis.gpuData);
+        if (vis.gpuData.volumeTexture) GpuMemory::deleteTextures(m_gl, 1, &vis.gpuData.volumeTexture);
+        vis.gpuData.volumeTexture = 0;
+        vis.gpuData.volumeUploaded.reset();
     }
     // Reset all shader pointers
     m_phongShader.reset();
+    m_instancedPhongShader.reset();
+    m_instancedPhongStereoShader.reset();
     m_gridShader.reset();
     m_outlineShader.reset();
     m_splineShader.reset();
@@ -448,12 +556,36 @@ void RenderingSystem::shutdown(entt::registry& registry) {
     m_instancedArrowShader.reset();
     m_emissiveSolidShader.reset();
     m_blurShader.reset();
+    m_bloomDownShader.reset();
+    m_selectionOutlineShader.reset();
+    m_bloomUpShader.reset();
     m_compositeShader.reset();
+    m_postShaders.clear();
+    m_taaResolveShader.reset();
+    m_pointCloudShader.reset();
+    m_pointSplatShader.reset();
+    m_pointSplat64Shader.reset();
+    m_pointSplatResolveShader.reset();
+    m_sensorPointShader.reset();
+    m_reconstructionSplatShader.reset();
+    m_reconstructionIntegrateShader.reset();
+    m_reconstructionTrackShader.reset();
+    m_virtualSensorDepthShader.reset();
+    m_virtualSensorPackShader.reset();
+    m_ghostShader.reset();
+    m_frameTriadShader.reset();
+    m_labelShader.reset();
+    m_fieldVolumeShader.reset();
+    releaseArrowBatch();
+    releaseGradientAtlas();
+    m_compute.release();
 
     // Delete remaining globally shared resources
-    m_gl->glDeleteVertexArrays(1, &m_intersectionVAO);
-    m_gl->glDeleteBuffers(1, &m_intersectionVBO);
+    if (m_intersectionVBO) GpuMemory::deleteBuffers(m_gl, 1, &m_intersectionVBO);
+    m_intersectionCapacity = 0;
+    m_intersectionGeneration = 0;
 
+    m_state.invalidate(); // deleted VAOs/programs may have been bound
     m_isInitialized = false;
     m_gl = nullptr;
     m_lastContext = nullptr;
@@ -516,617 +648,2360 @@ void RenderingSystem::compositeToScreen(int vpW, int vpH)
 }
 //---------- RENDER PASS IMPLEMENTATIONS ------------------
 
-void RenderingSystem::renderMeshes(entt::registry& registry, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& camPos) {
-    if (!m_phongShader) return;
-
-    m_phongShader->use();
-    m_phongShader->setMat4("view", view);
-    m_phongShader->setMat4("projection", projection);
-    m_phongShader->setVec3("lightColor", glm::vec3(1.0f));
-    m_phongShader->setVec3("lightPos", glm::vec3(5.0f, 10.0f, 5.0f));
-    m_phongShader->setVec3("viewPos", camPos);
-
+void RenderingSystem::renderMeshes(const RenderSnapshot& snapshot, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& camPos, TargetFBOs& target) {
     QOpenGLContext* ctx = QOpenGLContext::currentContext();
     if (!ctx) return;
-    auto viewRM = registry.view<RenderableMeshComponent, TransformComponent>();
 
-    for (auto entity : viewRM) {
-        if (entity == m_currentCamera || isDescendantOf(registry, entity, m_currentCamera)) {
-            continue;
-        }
+    // A layout change invalidates every stored range; drop them before this
+    // pass acquires any, they re-upload in the new layout as they are drawn.
+    const auto layout = m_compactVertices ? MeshArena::VertexLayout::Compact : MeshArena::VertexLayout::Full;
+    if (layout != m_meshArena.vertexLayout()) {
+        m_meshArena.setFunctions(m_gl);
+        m_meshArena.destroy();
+        m_meshArena.setVertexLayout(layout);
+    }
+    updateMaterials(snapshot, camPos);
+
+    // A stereo frame needs the batched pass: its one draw covers both eyes.
+    if ((m_meshPassMode == MeshPassMode::Batched || m_stereoFrame) && m_instancedPhongShader)
+        renderMeshesBatched(snapshot, ctx, view, projection, camPos, target);
+    else
+        renderMeshesPerEntity(snapshot, ctx, view, projection, camPos);
+}
 
-        auto& mesh = viewRM.get<RenderableMeshComponent>(entity);
-        auto& xf = viewRM.get<TransformComponent>(entity);
+glm::mat4 RenderingSystem::eyeRelative(const glm::mat4& model) const
+{
+    glm::mat4 relative = model;
+    relative[3] = glm::vec4(glm::vec3(glm::dvec3(model[3]) - m_eye), 1.0f);
+    return relative;
+}
 
-        auto* mat = registry.try_get<MaterialComponent>(entity);
-        m_phongShader->setVec3("objectColor", mat ? mat->albedo : glm::vec3(0.8f));
+void RenderingSystem::renderMeshesPerEntity(const RenderSnapshot& snapshot, QOpenGLContext* ctx, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& camPos) {
+    if (!m_phongShader) return;
 
-        auto& res = registry.get_or_emplace<RenderResourceComponent>(entity);
-        auto& buf = res.perContext[ctx];
+    // view / projection / eye come from the FrameUniforms block.
+    m_state.use(*m_phongShader);
+    setSceneShading(*m_phongShader);
 
-        if (buf.VAO == 0) {
-            m_gl->glGenVertexArrays(1, &buf.VAO);
-            m_gl->glGenBuffers(1, &buf.VBO);
-            m_gl->glGenBuffers(1, &buf.EBO);
-            m_gl->glBindVertexArray(buf.VAO);
-            m_gl->glBindBuffer(GL_ARRAY_BUFFER, buf.VBO);
-            m_gl->glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(Vertex), mesh.vertices.data(), GL_STATIC_DRAW);
-            m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buf.EBO);
-            m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned), mesh.indices.data(), GL_STATIC_DRAW);
-            m_gl->glEnableVertexAttribArray(0);
-            m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-            m_gl->glEnableVertexAttribArray(1);
-            m_gl->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-            m_gl->glBindVertexArray(0);
-        }
+    for (const std::uint32_t i : *m_viewMeshes) {
+        const auto& mesh = snapshot.meshes[i];
+        if (isCulled(mesh)) continue;
 
-        glm::mat4 modelMatrix = registry.all_of<WorldTransformComponent>(entity)
-            ? registry.get<WorldTransformComponent>(entity).matrix
-            : xf.getTransform();
+        m_phongShader->setVec3("objectColor", mesh.albedo);
+        m_phongShader->setUInt("u_material", m_meshMaterials[i]);
 
-        m_phongShader->setMat4("model", modelMatrix);
-        m_gl->glBindVertexArray(buf.VAO);
-        m_gl->glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indices.size()), GL_UNSIGNED_INT, nullptr);
+        const auto& range = acquireMeshRange(mesh);
+        const auto& lod = range.lods[selectLod(mesh, range, camPos)];
+
+        m_phongShader->setMat4("model", eyeRelative(mesh.model));
+        m_phongShader->setUInt("u_pickId", pickIdOf(mesh.entity));
+        bindArenaVAO(ctx); // after acquire: an upload may have grown the arena
+        m_gl->glDrawElementsBaseVertex(GL_TRIANGLES, lod.indexCount, GL_UNSIGNED_INT,
+            (void*)(std::size_t(lod.firstIndex) * sizeof(unsigned)), range.baseVertex);
+        RenderStats::draw();
+    }
+
+    // Reconstructed surface blocks are already in world space.
+    if (!m_reconstruction.meshes().empty()) {
+        m_phongShader->setVec3("objectColor", m_reconstruction.albedo());
+        m_phongShader->setUInt("u_material", 0);
+        m_phongShader->setMat4("model", eyeRelative(glm::mat4(1.0f)));
+        m_phongShader->setUInt("u_pickId", pickIdOf(m_reconstruction.entity()));
+        for (const auto& [key, block] : m_reconstruction.meshes()) {
+            if (m_frustumCulling && !inFrustum(block.boundsMin, block.boundsMax)) continue;
+            const auto& range = acquireMeshRange(block.mesh->contentHash, *block.mesh);
+            bindArenaVAO(ctx);
+            m_gl->glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+                (void*)(std::size_t(range.firstIndex) * sizeof(unsigned)), range.baseVertex);
+            RenderStats::draw();
+        }
     }
-    m_gl->glBindVertexArray(0);
+    m_state.bindVertexArray(0);
 }
 
-void RenderingSystem::renderGrid(entt::registry& registry, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& camPos)
+const MeshArena::Range& RenderingSystem::acquireMeshRange(const RenderSnapshot::Mesh& mesh)
 {
-    if (!m_gridShader) return;
+    return acquireMeshRange(mesh.meshKey, *mesh.data);
+}
 
-    QOpenGLContext* ctx = QOpenGLContext::currentContext();
-    if (!ctx) return;
-    auto& primitives = m_contextPrimitives[ctx];
+const MeshArena::Range& RenderingSystem::acquireMeshRange(std::size_t key, const MeshData& data)
+{
+    if (const auto* range = m_meshArena.find(key)) return *range;
 
-    if (primitives.gridVAO == 0) {
-        qDebug() << "Creating grid primitives for context" << ctx;
-        float gridPlaneVertices[] = { -2000.f,0,-2000.f, 2000.f,0,-2000.f, 2000.f,0,2000.f, -2000.f,0,-2000.f, 2000.f,0,2000.f, -2000.f,0,2000.f };
-        m_gl->glGenVertexArrays(1, &primitives.gridVAO);
-        m_gl->glGenBuffers(1, &primitives.gridVBO);
-        m_gl->glBindVertexArray(primitives.gridVAO);
-        m_gl->glBindBuffer(GL_ARRAY_BUFFER, primitives.gridVBO);
-        m_gl->glBufferData(GL_ARRAY_BUFFER, sizeof(gridPlaneVertices), gridPlaneVertices, GL_STATIC_DRAW);
-        m_gl->glEnableVertexAttribArray(0);
-        m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    m_meshArena.setFunctions(m_gl);
+    return m_meshArena.acquire(key, data);
+}
 
-        // Connect this context's destruction signal to our cleanup slot.
-         
+int RenderingSystem::selectLod(const RenderSnapshot::Mesh& mesh, const MeshArena::Range& range, const glm::vec3& camPos) const
+{
+    if (range.lodCount < 2 || m_lodPixelError <= 0.0f || m_lodPixelScale <= 0.0f) return 0;
+
+    // Object-space error scales with the largest axis of the model matrix.
+    const glm::mat4& model = mesh.model;
+    const float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])),
+        glm::length(glm::vec3(model[2])) });
+    float pixelsPerUnit = m_lodPixelScale * scale;
+    if (!m_lodOrthographic) {
+        const glm::vec3 centre = mesh.boundsValid ? (mesh.boundsMin + mesh.boundsMax) * 0.5f : glm::vec3(model[3]);
+        const float radius = mesh.boundsValid ? glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f : 0.0f;
+        const float distance = glm::length(centre - camPos) - radius;   // nearest point of the bounds
+        if (distance <= 0.0f) return 0;
+        pixelsPerUnit /= distance;
     }
 
-    const auto drawQuad = [&] {
-        m_gl->glBindVertexArray(primitives.gridVAO);
-        m_gl->glDrawArrays(GL_TRIANGLES, 0, 6);
-        };
-
-    auto viewG = registry.view<GridComponent, TransformComponent>();
-    if (viewG.begin() == viewG.end()) return;
+    int lod = 0;
+    while (lod + 1 < range.lodCount && range.lods[lod + 1].error * pixelsPerUnit <= m_lodPixelError) ++lod;
+    return lod;
+}
 
-    m_gridShader->use();
-    m_gl->glEnable(GL_POLYGON_OFFSET_FILL);
+GLuint RenderingSystem::bindArenaVAO(QOpenGLContext* ctx)
+{
+    auto& batch = m_meshBatches[ctx];
+    if (batch.instanceBuffer == 0) m_gl->glGenBuffers(1, &batch.instanceBuffer);
+    if (batch.arenaVAO == 0) m_gl->glGenVertexArrays(1, &batch.arenaVAO);
+    m_state.bindVertexArray(batch.arenaVAO);
 
-    for (auto entity : viewG) {
-        auto& grid = viewG.get<GridComponent>(entity);
-        if (!grid.masterVisible) continue;
+    if (batch.arenaGeneration == m_meshArena.generation()) return batch.arenaVAO;
 
-        auto& xf = viewG.get<TransformComponent>(entity);
-        const float camDist = glm::length(camPos - xf.translation);
-
-        // Send all grid uniforms to the shader.
-        m_gridShader->setMat4("u_viewMatrix", view);
-        m_gridShader->setMat4("u_projectionMatrix", projection);
-        m_gridShader->setMat4("u_gridModelMatrix", xf.getTransform());
-        m_gridShader->setVec3("u_cameraPos", camPos);
-        m_gridShader->setFloat("u_distanceToGrid", camDist);
-        m_gridShader->setBool("u_isDotted", grid.isDotted);
-        m_gridShader->setFloat("u_baseLineWidthPixels", grid.baseLineWidthPixels);
-        m_gridShader->setBool("u_showAxes", grid.showAxes);
-        m_gridShader->setVec3("u_xAxisColor", grid.xAxisColor);
-        m_gridShader->setVec3("u_zAxisColor", grid.zAxisColor);
-
-        // Send grid level data.
-        m_gridShader->setInt("u_numLevels", int(grid.levels.size()));
-        for (std::size_t i = 0; i < grid.levels.size() && i < 5; ++i) { // Shader supports max 5 levels.
-            const std::string b = "u_levels[" + std::to_string(i) + "].";
-            m_gridShader->setFloat(b + "spacing", grid.levels[i].spacing);
-            m_gridShader->setVec3(b + "color", grid.levels[i].color);
-            m_gridShader->setFloat(b + "fadeInCameraDistanceStart", grid.levels[i].fadeInCameraDistanceStart);
-            m_gridShader->setFloat(b + "fadeInCameraDistanceEnd", grid.levels[i].fadeInCameraDistanceEnd);
-            m_gridShader->setBool("u_levelVisible[" + std::to_string(i) + "]", grid.levelVisible[i]);
-        }
-
-        // Use scene-wide fog properties.
-        const auto& props = registry.ctx().get<SceneProperties>();
-        m_gridShader->setBool("u_useFog", props.fogEnabled);
-        m_gridShader->setVec3("u_fogColor", props.fogColor);
-        m_gridShader->setFloat("u_fogStartDistance", props.fogStartDistance);
-        m_gridShader->setFloat("u_fogEndDistance", props.fogEndDistance);
-
-        // Z-fighting mitigation: First pass writes to depth buffer only.
-        m_gl->glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-        m_gl->glDepthMask(GL_TRUE);
-        m_gl->glPolygonOffset(1.0f, 1.0f);
-        drawQuad();
-
-        // Second pass writes color, but not depth, using the depth from the first pass.
-        m_gl->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-        m_gl->glDepthMask(GL_FALSE);
-        m_gl->glPolygonOffset(-1.0f, -1.0f); // Bias back to draw lines on top.
-        drawQuad();
-    }
-    m_gl->glDisable(GL_POLYGON_OFFSET_FILL);
-    m_gl->glDepthMask(GL_TRUE); // Reset depth mask.
+    // The arena's buffers were (re)created: re-point this context's VAO at them.
+    pointArenaVAO(batch.instanceBuffer);
+    batch.arenaGeneration = m_meshArena.generation();
+    return batch.arenaVAO;
 }
 
-void RenderingSystem::renderSplines(entt::registry& registry, const glm::mat4& view, const glm::mat4& proj, const glm::vec3& eye, int viewportWidth, int viewportHeight)
+GLuint RenderingSystem::bindShadowVAO(QOpenGLContext* ctx)
 {
-    qDebug() << "[DEBUG] SplinePass: Starting...";
-
-    if (!m_glowShader || !m_capShader) return;
+    // The arena VAO over the shadow pass's own instances, so the two passes
+    // never wait on each other's instance uploads.
+    auto& batch = m_meshBatches[ctx];
+    if (batch.shadowInstanceBuffer == 0) m_gl->glGenBuffers(1, &batch.shadowInstanceBuffer);
+    if (batch.shadowVAO == 0) m_gl->glGenVertexArrays(1, &batch.shadowVAO);
+    m_state.bindVertexArray(batch.shadowVAO);
+
+    if (batch.shadowGeneration == m_meshArena.generation()) return batch.shadowVAO;
+    pointArenaVAO(batch.shadowInstanceBuffer);
+    batch.shadowGeneration = m_meshArena.generation();
+    return batch.shadowVAO;
+}
 
-    // Save the current OpenGL state to ensure this pass is isolated.
-    GLStateSnapshot stateBeforeSplines;
-    saveGLState(m_gl, stateBeforeSplines);
+GLuint RenderingSystem::bindGhostVAO(QOpenGLContext* ctx)
+{
+    auto& batch = m_meshBatches[ctx];
+    if (batch.ghostInstanceBuffer == 0) m_gl->glGenBuffers(1, &batch.ghostInstanceBuffer);
+    if (batch.ghostVAO == 0) m_gl->glGenVertexArrays(1, &batch.ghostVAO);
+    m_state.bindVertexArray(batch.ghostVAO);
+
+    if (batch.ghostGeneration == m_meshArena.generation()) return batch.ghostVAO;
+    pointArenaVAO(batch.ghostInstanceBuffer);
+    batch.ghostGeneration = m_meshArena.generation();
+    return batch.ghostVAO;
+}
 
-    QOpenGLContext* ctx = QOpenGLContext::currentContext();
-    if (!ctx) {
-        restoreGLState(m_gl, stateBeforeSplines); // Always restore state on early exit
-        return;
+void RenderingSystem::pointArenaVAO(GLuint instanceBuffer)
+{
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_meshArena.vertexBuffer());
+    m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_meshArena.indexBuffer());
+    m_gl->glEnableVertexAttribArray(0);
+    m_gl->glEnableVertexAttribArray(1);
+    if (m_meshArena.vertexStride() == GLsizei(sizeof(MeshArena::PackedVertex))) {
+        // Normal arrives as a normalized vec4 (w = 0); the shaders' vec3 input drops w.
+        const GLsizei packed = sizeof(MeshArena::PackedVertex);
+        m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, packed, (void*)offsetof(MeshArena::PackedVertex, position));
+        m_gl->glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, packed, (void*)offsetof(MeshArena::PackedVertex, normal));
     }
-    auto& primitives = m_contextPrimitives[ctx];
-
-    // --- On-Demand Creation for Primitives (remains the same) ---
-    if (primitives.lineVAO == 0)
-    {
-        qDebug() << "Creating spline LINE primitives for context" << ctx;
-        m_gl->glGenVertexArrays(1, &primitives.lineVAO);
-        m_gl->glGenBuffers(1, &primitives.lineVBO);
-        m_gl->glBindVertexArray(primitives.lineVAO);
-        m_gl->glBindBuffer(GL_ARRAY_BUFFER, primitives.lineVBO);
-        m_gl->glEnableVertexAttribArray(0);
-        m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    else {
+        m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+        m_gl->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
     }
-    if (primitives.capVAO == 0)
-    {
-        qDebug() << "Creating spline CAP primitives for context" << ctx;
-        m_gl->glGenVertexArrays(1, &primitives.capVAO);
-        m_gl->glGenBuffers(1, &primitives.capVBO);
-        m_gl->glBindVertexArray(primitives.capVAO);
-        m_gl->glBindBuffer(GL_ARRAY_BUFFER, primitives.capVBO);
-        m_gl->glEnableVertexAttribArray(0);
-        m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    // Texture coordinates exist only in the full layout; u_materialMaps says so.
+    if (m_meshArena.vertexStride() == GLsizei(sizeof(Vertex))) {
+        m_gl->glEnableVertexAttribArray(9);
+        m_gl->glVertexAttribPointer(9, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+    }
+    else {
+        m_gl->glDisableVertexAttribArray(9);
     }
 
-    // --- Set Specific State for Spline Rendering ---
-    m_gl->glEnable(GL_BLEND);
-    m_gl->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    m_gl->glDepthMask(GL_FALSE);
-    m_gl->glDisable(GL_CULL_FACE);
+    // Per-instance attributes come from the context's instance buffer; the
+    // indirect command's baseInstance offsets into it for each batch.
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    const GLsizei vec4Size = sizeof(glm::vec4);
+    for (GLuint col = 0; col < 4; ++col) {
+        m_gl->glEnableVertexAttribArray(2 + col);
+        m_gl->glVertexAttribPointer(2 + col, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceData, modelMatrix) + col * vec4Size));
+        m_gl->glVertexAttribDivisor(2 + col, 1);
+    }
+    m_gl->glEnableVertexAttribArray(6);
+    m_gl->glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(InstanceData, color));
+    m_gl->glVertexAttribDivisor(6, 1);
+    m_gl->glEnableVertexAttribArray(7);
+    m_gl->glVertexAttribIPointer(7, 1, GL_UNSIGNED_INT, stride, (void*)offsetof(InstanceData, padding));
+    m_gl->glVertexAttribDivisor(7, 1);
+    m_gl->glEnableVertexAttribArray(8);
+    m_gl->glVertexAttribIPointer(8, 1, GL_UNSIGNED_INT, stride, (void*)(offsetof(InstanceData, padding) + sizeof(float)));
+    m_gl->glVertexAttribDivisor(8, 1);
+}
 
-    // --- Iterate and Draw Splines ---
-    auto splineView = registry.view<SplineComponent>();
-    for (auto e : splineView)
-    {
-        auto& sp = splineView.get<const SplineComponent>(e);
+void RenderingSystem::renderMeshesBatched(const RenderSnapshot& snapshot, QOpenGLContext* ctx, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& camPos, TargetFBOs& target)
+{
+    const bool occlusion = occlusionCullingActive();
+    const bool clustered = clusterCullingActive();
+    m_clusterJobScratch.clear();
+    m_clusterInstanceScratch.clear();
+    GLuint maxClusters = 0;
+
+    // --- 1. Bucket visible entities by mesh content ---
+    for (auto& [key, b] : m_meshBatchScratch) {
+        for (auto& level : b.instances) level.clear();
+        for (auto& level : b.bounds) level.clear();
+    }
 
-        if (sp.cachedVertices.size() < 2) {
+    for (const std::uint32_t i : *m_viewMeshes) {
+        const auto& mesh = snapshot.meshes[i];
+        if (isCulled(mesh)) continue;
+
+        const auto& range = acquireMeshRange(mesh);
+
+        InstanceData inst;
+        inst.modelMatrix = eyeRelative(mesh.model);
+        const int lod = selectLod(mesh, range, camPos);
+        inst.color = glm::vec4(mesh.albedo, 1.0f);
+        inst.padding = glm::vec4(0.0f);
+        const std::uint32_t pickId = pickIdOf(mesh.entity);
+        std::memcpy(&inst.padding.x, &pickId, sizeof(pickId));
+        std::memcpy(&inst.padding.y, &m_meshMaterials[i], sizeof(GLuint));
+
+        // Full detail of a clustered mesh: drawn by the cluster pass instead
+        // (one workgroup row per instance, within the GL minimum of rows).
+        if (clustered && lod == 0 && range.clusterCount > 0 && m_clusterJobScratch.size() < 65535) {
+            ClusterInstanceGpu job;
+            job.model = mesh.model;
+            const float scale = std::max({ glm::length(glm::vec3(mesh.model[0])),
+                glm::length(glm::vec3(mesh.model[1])), glm::length(glm::vec3(mesh.model[2])) });
+            job.eye = glm::vec4(glm::vec3(glm::inverse(glm::dmat4(mesh.model)) * glm::dvec4(m_eye, 1.0)), scale);
+            job.firstCluster = range.firstCluster;
+            job.clusterCount = range.clusterCount;
+            job.baseVertex = static_cast<GLint>(range.baseVertex);
+            job.baseInstance = 0;   // once the instance buffer is laid out
+            m_clusterJobScratch.push_back(job);
+            m_clusterInstanceScratch.push_back(inst);
+            maxClusters = std::max(maxClusters, range.clusterCount);
             continue;
         }
 
-        // --- Caching Logic ---
-        // Only perform the expensive CPU calculation if the spline has changed.
-        if (sp.isDirty) {
-            qDebug() << "[Spline Cache] Recalculating vertices for dirty spline entity:" << (int)e;
+        auto& bucket = m_meshBatchScratch[mesh.meshKey];
+        bucket.range = &range;
+        bucket.instances[lod].push_back(inst);
+        if (occlusion)
+            bucket.bounds[lod].push_back({ mesh.boundsMin, mesh.boundsMax,
+                std::uint32_t(entt::to_entity(mesh.entity)), mesh.boundsValid });
+    }
 
-            // Perform the expensive, one-time calculation and store it.
-            switch (sp.type) {
-            case SplineType::Linear:     sp.cachedVertices = evaluateLinearCPU(sp.controlPoints); break;
-            case SplineType::CatmullRom: sp.cachedVertices = evaluateCatmullRomCPU(sp.controlPoints, 64); break;
-            case SplineType::Bezier:     sp.cachedVertices = evaluateBezierCPU(sp.controlPoints, 64); break;
-            case SplineType::Parametric: sp.cachedVertices = evaluateParametricCPU(sp.parametric.func, 128); break;
+    // --- 2. Flatten into one instance array and one command per unique mesh and level ---
+    m_instanceScratch.clear();
+    m_indirectScratch.clear();
+    m_occlusionScratch.clear();
+    std::uint32_t slotCount = 0;
+    GLuint meshInstances = 0;
+
+    for (auto& [key, b] : m_meshBatchScratch) {
+        for (int l = 0; l < MeshArena::kMaxLods; ++l) {
+            const auto& instances = b.instances[l];
+            if (instances.empty()) continue;
+
+            DrawElementsIndirectCommand cmd;
+            cmd.count = static_cast<GLuint>(b.range->lods[l].indexCount);
+            cmd.instanceCount = static_cast<GLuint>(instances.size());
+            cmd.firstIndex = b.range->lods[l].firstIndex;
+            cmd.baseVertex = static_cast<GLuint>(b.range->baseVertex);
+            cmd.baseInstance = meshInstances;
+            meshInstances += static_cast<GLuint>(instances.size());
+            if (occlusion) {
+                // The GPU picks the instances; it counts them up from zero.
+                cmd.instanceCount = 0;
+                for (std::size_t i = 0; i < instances.size(); ++i) {
+                    const MeshBounds& bounds = b.bounds[l][i];
+                    OcclusionCandidateGpu candidate;
+                    candidate.instance = instances[i];
+                    candidate.boundsMin = glm::vec4(bounds.min, 0.0f);
+                    candidate.boundsMax = glm::vec4(bounds.max, 0.0f);
+                    candidate.command = static_cast<GLuint>(m_indirectScratch.size());
+                    candidate.slot = bounds.slot;
+                    candidate.flags = bounds.valid ? kOcclusionBounded : 0u;
+                    candidate.padding = 0;
+                    m_occlusionScratch.push_back(candidate);
+                    slotCount = std::max(slotCount, bounds.slot + 1);
+                }
+            }
+            else {
+                m_instanceScratch.insert(m_instanceScratch.end(), instances.begin(), instances.end());
             }
-            // Mark the spline as clean until its control points are modified again.
-            sp.isDirty = false;
+            m_indirectScratch.push_back(cmd);
         }
+    }
 
-        // On every frame, we now use the fast, cached data.
-        if (sp.cachedVertices.size() < 2) {
-            continue;
+    // With occlusion culling the instance buffer holds the two phases' runs,
+    // written by the GPU, and the commands repeat for the second phase.
+    const std::size_t meshCommands = m_indirectScratch.size();
+    GLsizeiptr instanceOffset = 0;
+    if (occlusion) {
+        for (std::size_t c = 0; c < meshCommands; ++c) {
+            DrawElementsIndirectCommand cmd = m_indirectScratch[c];
+            cmd.baseInstance += meshInstances;
+            m_indirectScratch.push_back(cmd);
         }
+        instanceOffset = GLsizeiptr(2) * meshInstances * GLsizeiptr(sizeof(InstanceData));
+    }
 
-        // --- Draw Glow (using cached vertices) ---
-        m_glowShader->use();
-        m_glowShader->setMat4("u_view", view);
-        m_glowShader->setMat4("u_proj", proj);
-        m_glowShader->setFloat("u_thickness", sp.thickness);
-        m_glowShader->setVec2("u_viewport_size", glm::vec2(viewportWidth, viewportHeight));
-        m_glowShader->setVec4("u_glowColour", sp.glowColour);
-        m_glowShader->setVec4("u_coreColour", sp.coreColour);
-
-        // Convert cached line strip to line segments for GL_LINES topology.
-        std::vector<glm::vec3> lineSegments;
-        lineSegments.reserve((sp.cachedVertices.size() - 1) * 2);
-        for (size_t i = 0; i < sp.cachedVertices.size() - 1; ++i) {
-            lineSegments.push_back(sp.cachedVertices[i]);
-            lineSegments.push_back(sp.cachedVertices[i + 1]);
-        }
-
-        m_gl->glBindVertexArray(primitives.lineVAO);
-        m_gl->glBindBuffer(GL_ARRAY_BUFFER, primitives.lineVBO);
-        m_gl->glBufferData(GL_ARRAY_BUFFER, lineSegments.size() * sizeof(glm::vec3), lineSegments.data(), GL_DYNAMIC_DRAW);
-        m_gl->glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(lineSegments.size()));
-
-        // --- Draw Caps (using cached vertices) ---
-        m_capShader->use();
-        m_capShader->setMat4("u_view", view);
-        m_capShader->setMat4("u_proj", proj);
-        m_capShader->setVec2("u_viewport_size", glm::vec2(viewportWidth, viewportHeight));
-        m_capShader->setFloat("u_thickness", sp.thickness);
-        m_capShader->setVec4("u_glowColour", sp.glowColour);
-        m_capShader->setVec4("u_coreColour", sp.coreColour);
-
-        // Decide which points need a cap.
-        std::vector<glm::vec3> capPoints;
-        if (sp.type == SplineType::Linear) {
-            // For linear splines, cap every control point to round the corners.
-            capPoints = sp.controlPoints;
+    // Reconstructed surface: one command per visible block, all sharing one
+    // world-space instance. Its blocks are not occlusion tested.
+    const std::size_t reconstructionCommands = m_indirectScratch.size();
+    if (!m_reconstruction.meshes().empty()) {
+        const GLuint baseInstance = static_cast<GLuint>(instanceOffset / GLsizeiptr(sizeof(InstanceData)) + m_instanceScratch.size());
+        const std::size_t firstCommand = m_indirectScratch.size();
+        for (const auto& [key, block] : m_reconstruction.meshes()) {
+            if (m_frustumCulling && !inFrustum(block.boundsMin, block.boundsMax)) continue;
+            const auto& range = acquireMeshRange(block.mesh->contentHash, *block.mesh);
+            DrawElementsIndirectCommand cmd;
+            cmd.count = static_cast<GLuint>(range.indexCount);
+            cmd.instanceCount = 1;
+            cmd.firstIndex = range.firstIndex;
+            cmd.baseVertex = static_cast<GLuint>(range.baseVertex);
+            cmd.baseInstance = baseInstance;
+            m_indirectScratch.push_back(cmd);
         }
-        else {
-            // For smooth splines, only cap the absolute start and end points.
-            capPoints = { sp.cachedVertices.front(), sp.cachedVertices.back() };
+        if (m_indirectScratch.size() > firstCommand) {
+            InstanceData inst;
+            inst.modelMatrix = eyeRelative(glm::mat4(1.0f));
+            inst.color = glm::vec4(m_reconstruction.albedo(), 1.0f);
+            inst.padding = glm::vec4(0.0f);
+            const std::uint32_t pickId = pickIdOf(m_reconstruction.entity());
+            std::memcpy(&inst.padding.x, &pickId, sizeof(pickId));
+            m_instanceScratch.push_back(inst);
         }
+    }
+
+    // Clustered instances go last; their draws come from the cluster pass.
+    const GLuint clusterBaseInstance = static_cast<GLuint>(instanceOffset / GLsizeiptr(sizeof(InstanceData)) + m_instanceScratch.size());
+    GLuint clusterDraws = 0;
+    for (std::size_t j = 0; j < m_clusterJobScratch.size(); ++j) {
+        m_clusterJobScratch[j].baseInstance = clusterBaseInstance + static_cast<GLuint>(j);
+        clusterDraws += m_clusterJobScratch[j].clusterCount;
+    }
+    m_instanceScratch.insert(m_instanceScratch.end(), m_clusterInstanceScratch.begin(), m_clusterInstanceScratch.end());
+
+    // GPU posed fleets after those: their commands now, their instances
+    // written by poseFleets() once the buffer has room for them.
+    const GLuint fleetBaseInstance = static_cast<GLuint>(instanceOffset / GLsizeiptr(sizeof(InstanceData)) + m_instanceScratch.size());
+    const GLuint fleetInstances = appendFleetDraws(snapshot, fleetBaseInstance);
+    if (m_indirectScratch.empty() && m_clusterJobScratch.empty()) return;
+
+    // --- 3. Upload (grow-only, so steady state is a single sub-data per buffer) ---
+    bindArenaVAO(ctx);
+    auto& batch = m_meshBatches[ctx];
+    if (batch.indirectBuffer == 0) m_gl->glGenBuffers(1, &batch.indirectBuffer);
+
+    const GLsizeiptr instanceBytes = m_instanceScratch.size() * sizeof(InstanceData);
+    const GLsizeiptr instanceEnd = instanceOffset + instanceBytes + GLsizeiptr(fleetInstances) * GLsizeiptr(sizeof(InstanceData));
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, batch.instanceBuffer);
+    if (instanceEnd > batch.instanceCapacity) {
+        batch.instanceCapacity = std::max<GLsizeiptr>(instanceEnd, batch.instanceCapacity * 2);
+        GpuMemory::bufferData(m_gl, GL_ARRAY_BUFFER, batch.instanceBuffer, batch.instanceCapacity, nullptr, GL_DYNAMIC_DRAW,
+            GpuMemory::Category::Instances);
+    }
+    if (instanceBytes > 0) {
+        m_gl->glBufferSubData(GL_ARRAY_BUFFER, instanceOffset, instanceBytes, m_instanceScratch.data());
+        RenderStats::upload(std::uint64_t(instanceBytes));
+    }
 
-        if (!capPoints.empty()) {
-            m_gl->glBindVertexArray(primitives.capVAO);
-            m_gl->glBindBuffer(GL_ARRAY_BUFFER, primitives.capVBO);
-            m_gl->glBufferData(GL_ARRAY_BUFFER, capPoints.size() * sizeof(glm::vec3), capPoints.data(), GL_DYNAMIC_DRAW);
-            m_gl->glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(capPoints.size()));
+    const GLsizeiptr commandBytes = m_indirectScratch.size() * sizeof(DrawElementsIndirectCommand);
+    m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch.indirectBuffer);
+    if (commandBytes > batch.indirectCapacity) {
+        batch.indirectCapacity = std::max<GLsizeiptr>(commandBytes, batch.indirectCapacity * 2);
+        GpuMemory::bufferData(m_gl, GL_DRAW_INDIRECT_BUFFER, batch.indirectBuffer, batch.indirectCapacity, nullptr, GL_DYNAMIC_DRAW,
+            GpuMemory::Category::Instances);
+    }
+    if (commandBytes > 0) {
+        m_gl->glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandBytes, m_indirectScratch.data());
+        RenderStats::upload(std::uint64_t(commandBytes));
+    }
+    if (fleetInstances > 0) poseFleets(ctx, snapshot);
+
+    // --- 4. Draw: every mesh lives in the arena, so one call covers the scene ---
+    Shader& meshShader = m_stereoFrame ? *m_instancedPhongStereoShader : *m_instancedPhongShader;
+    m_state.use(meshShader);
+    setSceneShading(meshShader);
+
+    if (!occlusion) {
+        if (!m_indirectScratch.empty()) {
+            m_gl->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+                static_cast<GLsizei>(m_indirectScratch.size()), 0);
+            RenderStats::draw(m_indirectScratch.size());
         }
+        renderClusters(ctx, target, clusterDraws, maxClusters, false);
+        m_state.bindVertexArray(0);
+        m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        return;
     }
 
-    // --- Restore State ---
-    qDebug() << "[DEBUG] SplinePass: Finished. Resetting state...";
-    restoreGLState(m_gl, stateBeforeSplines);
-    m_gl->glBindVertexArray(0);
-    qDebug() << "[DEBUG] SplinePass: State perfectly restored.";
+    // --- 5. Occlusion culled: last frame's visible set, Hi-Z, then the rest ---
+    const GLsizeiptr candidateBytes = m_occlusionScratch.size() * sizeof(OcclusionCandidateGpu);
+    if (batch.candidateBuffer == 0) m_gl->glGenBuffers(1, &batch.candidateBuffer);
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, batch.candidateBuffer);
+    if (candidateBytes > batch.candidateCapacity) {
+        batch.candidateCapacity = std::max<GLsizeiptr>(candidateBytes, batch.candidateCapacity * 2);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, batch.candidateBuffer, batch.candidateCapacity, nullptr,
+            GL_DYNAMIC_DRAW, GpuMemory::Category::Instances);
+    }
+    if (candidateBytes > 0) {
+        m_gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, candidateBytes, m_occlusionScratch.data());
+        RenderStats::upload(std::uint64_t(candidateBytes));
+    }
+
+    // Indexed by entity; a grown buffer starts with nothing visible, which
+    // only costs one frame drawn entirely in the second phase.
+    const GLsizeiptr visibilityBytes = GLsizeiptr(std::max<std::uint32_t>(slotCount, 1)) * sizeof(GLuint);
+    if (visibilityBytes > target.visibilityCapacity) {
+        if (target.visibilityBuffer == 0) m_gl->glGenBuffers(1, &target.visibilityBuffer);
+        target.visibilityCapacity = std::max<GLsizeiptr>(visibilityBytes, target.visibilityCapacity * 2);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, target.visibilityBuffer);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, target.visibilityBuffer, target.visibilityCapacity, nullptr,
+            GL_DYNAMIC_COPY, GpuMemory::Category::Instances);
+        const GLuint zero = 0;
+        m_gl->glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    }
+
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kOcclusionCandidateBinding, batch.candidateBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kOcclusionInstanceBinding, batch.instanceBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kOcclusionCommandBinding, batch.indirectBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kOcclusionVisibilityBinding, target.visibilityBuffer);
+
+    const bool reverseZ = reverseZActive();
+    const GLuint candidates = static_cast<GLuint>(m_occlusionScratch.size());
+    auto cull = [&](GLuint phase) {
+        m_state.use(*m_occlusionCullShader);
+        m_occlusionCullShader->setUInt("u_phase", phase);
+        m_occlusionCullShader->setUInt("u_count", candidates);
+        m_occlusionCullShader->setUInt("u_commandCount", static_cast<GLuint>(meshCommands));
+        m_occlusionCullShader->setInt("u_hizLevels", target.hizLevels);
+        m_occlusionCullShader->setVec2("u_viewSize", glm::vec2(target.viewW, target.viewH));
+        m_occlusionCullShader->setBool("u_reverseZ", reverseZ);
+        m_occlusionCullShader->setInt("u_hiz", int(kHiZTextureUnit));
+        m_gl->glDispatchCompute((candidates + 63) / 64, 1, 1);
+        RenderStats::dispatch();
+        m_gl->glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    };
+    auto draw = [&](std::size_t first, std::size_t count) {
+        if (count == 0) return;
+        m_state.use(*m_instancedPhongShader);
+        setSceneShading(*m_instancedPhongShader);
+        bindArenaVAO(ctx);
+        m_gl->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+            (void*)(first * sizeof(DrawElementsIndirectCommand)), static_cast<GLsizei>(count), 0);
+        RenderStats::draw(count);
+    };
+
+    if (candidates > 0) cull(0);
+    draw(0, meshCommands);
+    draw(reconstructionCommands, m_indirectScratch.size() - reconstructionCommands);
+    if (candidates > 0) {
+        buildHiZ(target);
+        m_gl->glActiveTexture(GL_TEXTURE0 + kHiZTextureUnit);
+        m_gl->glBindTexture(GL_TEXTURE_2D, target.hizTexture);
+        m_gl->glActiveTexture(GL_TEXTURE0);
+        cull(1);
+        draw(meshCommands, meshCommands);
+    }
+    renderClusters(ctx, target, clusterDraws, maxClusters, candidates > 0);
+
+    m_state.bindVertexArray(0);
+    m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void RenderingSystem::renderClusters(QOpenGLContext* ctx, TargetFBOs& target, GLuint drawSlots, GLuint maxClusters, bool hizBuilt)
+{
+    if (m_clusterJobScratch.empty()) return;
+    KR_ZONE("renderClusters");
+    auto& batch = m_meshBatches[ctx];
+
+    const GLsizeiptr jobBytes = m_clusterJobScratch.size() * sizeof(ClusterInstanceGpu);
+    if (batch.clusterJobBuffer == 0) m_gl->glGenBuffers(1, &batch.clusterJobBuffer);
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, batch.clusterJobBuffer);
+    if (jobBytes > batch.clusterJobCapacity) {
+        batch.clusterJobCapacity = std::max<GLsizeiptr>(jobBytes, batch.clusterJobCapacity * 2);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, batch.clusterJobBuffer, batch.clusterJobCapacity, nullptr,
+            GL_DYNAMIC_DRAW, GpuMemory::Category::Instances);
+    }
+    m_gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, jobBytes, m_clusterJobScratch.data());
+    RenderStats::upload(std::uint64_t(jobBytes));
+
+    // A slot per cluster of every instance; the count and unused slots start at zero.
+    const GLsizeiptr drawBytes = GLsizeiptr(sizeof(glm::uvec4)) + GLsizeiptr(drawSlots) * GLsizeiptr(sizeof(DrawElementsIndirectCommand));
+    if (batch.clusterDrawBuffer == 0) m_gl->glGenBuffers(1, &batch.clusterDrawBuffer);
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, batch.clusterDrawBuffer);
+    if (drawBytes > batch.clusterDrawCapacity) {
+        batch.clusterDrawCapacity = std::max<GLsizeiptr>(drawBytes, batch.clusterDrawCapacity * 2);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, batch.clusterDrawBuffer, batch.clusterDrawCapacity, nullptr,
+            GL_DYNAMIC_COPY, GpuMemory::Category::Instances);
+    }
+    const GLuint zero = 0;
+    m_gl->glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, drawBytes, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kClusterInstanceBinding, batch.clusterJobBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kClusterBinding, m_meshArena.clusterBuffer());
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kClusterDrawBinding, batch.clusterDrawBuffer);
+
+    m_state.use(*m_clusterCullShader);
+    for (int p = 0; p < 6; ++p) {
+        // Disabled frustum culling: planes every sphere is inside.
+        const glm::vec4 plane = m_frustumCulling ? m_frustum.planes[p] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        m_clusterCullShader->setVec4("u_frustum[" + std::to_string(p) + "]", plane);
+    }
+    m_clusterCullShader->setBool("u_coneCulling", !m_lodOrthographic);
+    m_clusterCullShader->setUInt("u_instanceCount", static_cast<GLuint>(m_clusterJobScratch.size()));
+    m_clusterCullShader->setInt("u_hizLevels", hizBuilt ? target.hizLevels : 0);
+    m_clusterCullShader->setVec2("u_viewSize", glm::vec2(target.viewW, target.viewH));
+    m_clusterCullShader->setBool("u_reverseZ", reverseZActive());
+    m_clusterCullShader->setInt("u_hiz", int(kHiZTextureUnit));
+    m_gl->glDispatchCompute((maxClusters + 63) / 64, static_cast<GLuint>(m_clusterJobScratch.size()), 1);
+    RenderStats::dispatch();
+    m_gl->glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+    m_state.use(*m_instancedPhongShader);
+    setSceneShading(*m_instancedPhongShader);
+    bindArenaVAO(ctx);
+    m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch.clusterDrawBuffer);
+    const void* firstDraw = reinterpret_cast<const void*>(sizeof(glm::uvec4));
+    if (m_multiDrawIndirectCount) {
+        constexpr GLenum kParameterBuffer = 0x80EE;   // GL_PARAMETER_BUFFER(_ARB)
+        m_gl->glBindBuffer(kParameterBuffer, batch.clusterDrawBuffer);
+        m_multiDrawIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, firstDraw, 0, static_cast<GLsizei>(drawSlots), 0);
+        m_gl->glBindBuffer(kParameterBuffer, 0);
+    }
+    else {
+        m_gl->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, firstDraw, static_cast<GLsizei>(drawSlots), 0);
+    }
+    RenderStats::draw(drawSlots);
 }
 
+bool RenderingSystem::clusterCullingActive() const
+{
+    // Stereo frames draw both eyes in one pass; these culls see one view.
+    return !m_stereoFrame && m_clusterCulling && m_clusterCullShader && m_storageBindings > GLint(kClusterDrawBinding);
+}
 
-void RenderingSystem::updateAnimations(entt::registry& registry, float frameDt)
+bool RenderingSystem::gpuKinematicsSupported() const
 {
-    // A persistent timer to drive all animations
-    static float timer = 0.f;
-    timer += frameDt;
+    return m_fleetKinematicsShader && m_storageBindings > GLint(kFleetOutputBinding);
+}
 
-    // --- Pulsing Spline Logic ---
-    auto splineView = registry.view<PulsingSplineTag, SplineComponent>();
+void RenderingSystem::layoutFleets(const RenderSnapshot& snapshot)
+{
+    static const std::string kNoMap;
+    m_fleetLayouts.clear();
+    m_fleetLevelScratch.clear();
+    m_fleetLinkScratch.clear();
+    m_fleetPartScratch.clear();
+    m_fleetInstanceScratch.clear();
+    std::vector<int> level;   // per model link
+    for (const RenderSnapshot::Fleet& fleet : snapshot.fleets) {
+        const Prefab& prefab = *fleet.prefab;
+        const KinematicModel& model = *prefab.model;
+        FleetLayout& layout = m_fleetLayouts.emplace_back();
+
+        // Links by depth; parents come first in the model, so one pass finds it.
+        const int links = model.linkCount();
+        level.assign(std::size_t(links), 0);
+        int levels = 0;
+        for (int i = 0; i < links; ++i) {
+            if (model.parentOf(i) >= 0) level[i] = level[model.parentOf(i)] + 1;
+            levels = std::max(levels, level[i] + 1);
+        }
+        layout.firstLink = static_cast<GLuint>(m_fleetLinkScratch.size());
+        layout.linkCount = static_cast<GLuint>(links);
+        layout.firstLevel = static_cast<std::uint32_t>(m_fleetLevelScratch.size());
+        layout.levelCount = static_cast<std::uint32_t>(levels);
+        for (int l = 0; l < levels; ++l) {
+            const GLuint first = static_cast<GLuint>(m_fleetLinkScratch.size()) - layout.firstLink;
+            for (int i = 0; i < links; ++i) {
+                if (level[i] != l) continue;
+                const KinematicModel::Pose& origin = model.originOf(i);
+                FleetLinkGpu& link = m_fleetLinkScratch.emplace_back();
+                link.rotation = glm::vec4(origin.rotation.x, origin.rotation.y, origin.rotation.z, origin.rotation.w);
+                link.translation = glm::vec4(origin.translation, 0.0f);
+                link.axis = glm::vec4(model.axisOf(i), 0.0f);
+                link.info = glm::ivec4(i, model.parentOf(i), model.dofOf(i), int(model.motionOf(i)));
+            }
+            m_fleetLevelScratch.emplace_back(first, static_cast<GLuint>(m_fleetLinkScratch.size()) - layout.firstLink - first);
+        }
 
-    //! CORRECTED: Use size_hint() to check if the view has any entities.
-    if (splineView.size_hint() > 0) {
-        float pulseSpeed = 3.0f;
-        float brightness = (sin(timer * pulseSpeed) + 1.0f) / 2.0f; // Varies between 0.0 and 1.0
-        float minBrightness = 0.1f;
-        float finalBrightness = minBrightness + (1.0f - minBrightness) * brightness;
+        layout.firstPart = static_cast<GLuint>(m_fleetPartScratch.size());
+        layout.partCount = static_cast<GLuint>(prefab.parts.size());
+        for (const Prefab::Part& part : prefab.parts) {
+            FleetPartGpu& gpu = m_fleetPartScratch.emplace_back();
+            // Rigid parts hang off the prefab root: the root link's pose, undone below.
+            gpu.offset = part.link >= 0 ? part.offset : glm::inverse(prefab.modelBase) * part.offset;
+            gpu.color = glm::vec4(part.material.albedo, 1.0f);
+            const GLuint material = m_materials.add(part.material.albedoMap ? part.material.albedoMap->path : kNoMap,
+                part.material.metalRoughnessMap ? part.material.metalRoughnessMap->path : kNoMap,
+                part.material.metallic, part.material.roughness, part.material.emissive);
+            gpu.info = glm::uvec4(GLuint(std::max(part.link, 0)), material, 0u, 0u);
+        }
 
-        for (auto entity : splineView) {
-            auto& spline = splineView.get<SplineComponent>(entity);
-            spline.glowColour.a = 1.0f * finalBrightness;
+        // Each root carries the model-to-prefab matrix PrefabSystem applies
+        // to every link; translations are from the first instance's, in double.
+        const glm::mat4 toPrefab = prefab.modelBase * glm::inverse(model.originOf(0).matrix());
+        const std::uint32_t count = fleet.instanceCount;
+        if (count > 0) layout.origin = glm::dvec3(snapshot.fleetInstances[fleet.firstInstance].root[3]);
+        for (std::uint32_t k = 0; k < count; ++k) {
+            const RenderSnapshot::FleetInstance& instance = snapshot.fleetInstances[fleet.firstInstance + k];
+            glm::mat4 root = instance.root * toPrefab;
+            root[3] = glm::vec4(glm::vec3(glm::dvec3(root[3]) - layout.origin), 1.0f);
+            FleetInstanceGpu& gpu = m_fleetInstanceScratch.emplace_back();
+            for (int r = 0; r < 3; ++r) gpu.rows[r] = glm::vec4(root[0][r], root[1][r], root[2][r], root[3][r]);
+            gpu.info = glm::uvec4(pickIdOf(instance.entity), instance.firstJoint, 0u, 0u);
         }
     }
+}
 
-    // --- Pulsing Light Logic ---
-    auto lightView = registry.view<PulsingLightComponent, MaterialComponent>();
-    for (auto entity : lightView) {
-        auto& pulse = lightView.get<PulsingLightComponent>(entity);
-        auto& material = lightView.get<MaterialComponent>(entity);
+GLuint RenderingSystem::appendFleetDraws(const RenderSnapshot& snapshot, GLuint firstInstance)
+{
+    m_fleetDraws.clear();
+    m_fleetDrawnScratch.clear();
+    if (snapshot.fleets.empty() || !gpuKinematicsSupported() || m_fleetLayouts.size() != snapshot.fleets.size()) return 0;
+
+    GLuint instances = 0, poses = 0;
+    for (std::size_t f = 0; f < snapshot.fleets.size(); ++f) {
+        const RenderSnapshot::Fleet& fleet = snapshot.fleets[f];
+        const FleetLayout& layout = m_fleetLayouts[f];
+        FleetDraw& draw = m_fleetDraws.emplace_back();
+        draw.firstDrawn = static_cast<GLuint>(m_fleetDrawnScratch.size());
+        for (std::uint32_t k = fleet.firstInstance; k < fleet.firstInstance + fleet.instanceCount; ++k) {
+            const RenderSnapshot::FleetInstance& instance = snapshot.fleetInstances[k];
+            if (!(instance.layers & m_viewLayers)) continue;
+            if (m_frustumCulling && !inFrustum(instance.boundsMin, instance.boundsMax)) continue;
+            m_fleetDrawnScratch.push_back(k);
+        }
+        draw.drawCount = static_cast<GLuint>(m_fleetDrawnScratch.size()) - draw.firstDrawn;
+        draw.firstPose = poses;
+        draw.firstOutput = firstInstance + instances;
+        if (draw.drawCount == 0) continue;
+
+        // A command per part, its instances a run of drawCount. Full detail:
+        // the CPU never sees where a fleet's parts end up.
+        const Prefab& prefab = *fleet.prefab;
+        for (std::size_t p = 0; p < prefab.parts.size(); ++p) {
+            const Prefab::Part& part = prefab.parts[p];
+            const MeshArena::Range& range = acquireMeshRange(part.meshKey, *part.mesh);
+            DrawElementsIndirectCommand cmd;
+            cmd.count = static_cast<GLuint>(range.lods[0].indexCount);
+            cmd.instanceCount = draw.drawCount;
+            cmd.firstIndex = range.lods[0].firstIndex;
+            cmd.baseVertex = static_cast<GLuint>(range.baseVertex);
+            cmd.baseInstance = draw.firstOutput + static_cast<GLuint>(p) * draw.drawCount;
+            m_indirectScratch.push_back(cmd);
+        }
+        instances += draw.drawCount * layout.partCount;
+        poses += draw.drawCount * layout.linkCount;
+    }
+    return instances;
+}
 
-        // A sine wave gives a smooth pulse between 0.0 and 1.0
-        float blendFactor = (sin(timer * pulse.speed) + 1.0f) / 2.0f;
+void RenderingSystem::poseFleets(QOpenGLContext* ctx, const RenderSnapshot& snapshot)
+{
+    KR_ZONE("poseFleets");
+    auto& batch = m_meshBatches[ctx];
+    auto upload = [&](GLuint& buffer, GLsizeiptr& capacity, const void* data, GLsizeiptr bytes, GLenum usage) {
+        if (buffer == 0) m_gl->glGenBuffers(1, &buffer);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        if (bytes > capacity) {
+            capacity = std::max<GLsizeiptr>(bytes, capacity * 2);
+            GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, buffer, capacity, nullptr, usage, GpuMemory::Category::Instances);
+        }
+        if (data && bytes > 0) {
+            m_gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, data);
+            RenderStats::upload(std::uint64_t(bytes));
+        }
+    };
+
+    // --- 1. The snapshot's records, once per snapshot in this context: per
+    //     instance a root and its joint coordinates, nothing per link ---
+    if (batch.fleetSnapshot != snapshot.frame) {
+        upload(batch.fleetLinkBuffer, batch.fleetLinkCapacity, m_fleetLinkScratch.data(),
+            GLsizeiptr(m_fleetLinkScratch.size() * sizeof(FleetLinkGpu)), GL_DYNAMIC_DRAW);
+        upload(batch.fleetPartBuffer, batch.fleetPartCapacity, m_fleetPartScratch.data(),
+            GLsizeiptr(m_fleetPartScratch.size() * sizeof(FleetPartGpu)), GL_DYNAMIC_DRAW);
+        upload(batch.fleetInstanceBuffer, batch.fleetInstanceCapacity, m_fleetInstanceScratch.data(),
+            GLsizeiptr(m_fleetInstanceScratch.size() * sizeof(FleetInstanceGpu)), GL_DYNAMIC_DRAW);
+        upload(batch.fleetJointBuffer, batch.fleetJointCapacity, snapshot.fleetJoints.data(),
+            GLsizeiptr(std::max<std::size_t>(snapshot.fleetJoints.size(), 1) * sizeof(float)), GL_DYNAMIC_DRAW);
+        batch.fleetSnapshot = snapshot.frame;
+    }
 
-        // Interpolate the material's color between the on and off colors
-        material.albedo = glm::mix(pulse.offColor, pulse.onColor, blendFactor);
+    // --- 2. This view's instances, and room for their link poses ---
+    GLuint poses = 0;
+    for (std::size_t f = 0; f < m_fleetDraws.size(); ++f)
+        poses = std::max(poses, m_fleetDraws[f].firstPose + m_fleetDraws[f].drawCount * m_fleetLayouts[f].linkCount);
+    upload(batch.fleetDrawnBuffer, batch.fleetDrawnCapacity, m_fleetDrawnScratch.data(),
+        GLsizeiptr(m_fleetDrawnScratch.size() * sizeof(GLuint)), GL_DYNAMIC_DRAW);
+    upload(batch.fleetPoseBuffer, batch.fleetPoseCapacity, nullptr,
+        GLsizeiptr(poses) * GLsizeiptr(2 * sizeof(glm::vec4)), GL_DYNAMIC_COPY);
+
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kFleetLinkBinding, batch.fleetLinkBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kFleetPartBinding, batch.fleetPartBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kFleetInstanceBinding, batch.fleetInstanceBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kFleetJointBinding, batch.fleetJointBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kFleetVisibleBinding, batch.fleetDrawnBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kFleetPoseBinding, batch.fleetPoseBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kFleetOutputBinding, batch.instanceBuffer);
+
+    // --- 3. Per fleet: its levels root first, each reading the one above,
+    //     then every part instance from the finished poses ---
+    Shader& shader = *m_fleetKinematicsShader;
+    m_state.use(shader);
+    for (std::size_t f = 0; f < m_fleetDraws.size(); ++f) {
+        const FleetDraw& draw = m_fleetDraws[f];
+        const FleetLayout& layout = m_fleetLayouts[f];
+        if (draw.drawCount == 0) continue;
+        shader.setUInt("u_firstLink", layout.firstLink);
+        shader.setUInt("u_linkCount", layout.linkCount);
+        shader.setUInt("u_firstPart", layout.firstPart);
+        shader.setUInt("u_partCount", layout.partCount);
+        shader.setUInt("u_firstDrawn", draw.firstDrawn);
+        shader.setUInt("u_drawCount", draw.drawCount);
+        shader.setUInt("u_firstPose", draw.firstPose);
+        shader.setUInt("u_firstOutput", draw.firstOutput);
+        shader.setVec3("u_eye", glm::vec3(m_eye - layout.origin));
+
+        shader.setUInt("u_stage", 0u);
+        for (std::uint32_t l = 0; l < layout.levelCount; ++l) {
+            const glm::uvec2 level = m_fleetLevelScratch[layout.firstLevel + l];
+            shader.setUInt("u_levelFirst", level.x);
+            shader.setUInt("u_levelCount", level.y);
+            m_gl->glDispatchCompute((draw.drawCount * level.y + 63) / 64, 1, 1);
+            RenderStats::dispatch();
+            m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+        shader.setUInt("u_stage", 1u);
+        m_gl->glDispatchCompute((draw.drawCount * layout.partCount + 63) / 64, 1, 1);
+        RenderStats::dispatch();
     }
+    m_gl->glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
-void RenderingSystem::resetGLState()
+void RenderingSystem::cullLights(const RenderSnapshot& snapshot, const glm::mat4& projection)
 {
-    if (!m_gl) return;
-    m_gl->glDisable(GL_FRAMEBUFFER_SRGB);
-    m_gl->glEnable(GL_DEPTH_TEST);
-    m_gl->glDepthMask(GL_TRUE);
+    m_viewLights = 0;
+    if (!m_clusteredLighting || !m_lightCullShader) return;
 
-    m_gl->glDisable(GL_BLEND);
-    m_gl->glDisable(GL_STENCIL_TEST);
-    m_gl->glUseProgram(0);
+    m_lightScratch.clear();
+    for (const auto& light : snapshot.lights) {
+        if (light.camera == m_currentCamera) continue;   // the view's own record LED
+        if (m_frustumCulling && !inFrustum(light.position - light.range, light.position + light.range))
+            continue;
+        const glm::vec3 position(glm::dvec3(light.position) - m_eye);   // eye-relative, like the fragments it lights
+        m_lightScratch.push_back({ glm::vec4(position, light.range), glm::vec4(light.color, 0.0f) });
+    }
+    if (m_lightScratch.empty()) return;
+    KR_ZONE("cullLights");
+
+    const GLsizeiptr lightBytes = m_lightScratch.size() * sizeof(LightGpu);
+    if (m_lightBuffer == 0) {
+        m_gl->glGenBuffers(1, &m_lightBuffer);
+        m_gl->glGenBuffers(1, &m_lightGridBuffer);
+        m_gl->glGenBuffers(1, &m_lightIndexBuffer);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightGridBuffer);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, m_lightGridBuffer, GLsizeiptr(kLightFroxels) * 2 * sizeof(GLuint),
+            nullptr, GL_DYNAMIC_COPY, GpuMemory::Category::Instances);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexBuffer);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, m_lightIndexBuffer, GLsizeiptr(1 + kLightIndexCapacity) * sizeof(GLuint),
+            nullptr, GL_DYNAMIC_COPY, GpuMemory::Category::Instances);
+    }
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightBuffer);
+    if (lightBytes > m_lightCapacity) {
+        m_lightCapacity = std::max<GLsizeiptr>(lightBytes, m_lightCapacity * 2);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, m_lightBuffer, m_lightCapacity, nullptr, GL_DYNAMIC_DRAW,
+            GpuMemory::Category::Instances);
+    }
+    m_gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lightBytes, m_lightScratch.data());
+    RenderStats::upload(std::uint64_t(lightBytes));
+
+    const GLuint zero = 0;
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexBuffer);
+    m_gl->glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kLightBinding, m_lightBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kLightGridBinding, m_lightGridBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kLightIndexBinding, m_lightIndexBuffer);
+
+    m_state.use(*m_lightCullShader);
+    m_lightCullShader->setMat4("u_inverseProjection", glm::inverse(projection));
+    m_lightCullShader->setUInt("u_lightCount", static_cast<GLuint>(m_lightScratch.size()));
+    m_lightCullShader->setUInt("u_indexCapacity", kLightIndexCapacity);
+    m_gl->glDispatchCompute((kLightFroxels + 63) / 64, 1, 1);
+    RenderStats::dispatch();
+    m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_viewLights = static_cast<GLuint>(m_lightScratch.size());
 }
 
-void RenderingSystem::renderFieldVisualizers(entt::registry& registry, const glm::mat4& view, const glm::mat4& projection, float deltaTime)
+void RenderingSystem::updateMaterials(const RenderSnapshot& snapshot, const glm::vec3& camPos)
 {
-    if (!m_gl) {
-        qWarning() << "[FieldViz] Render call skipped: m_gl is null.";
-        return;
+    static const std::string kNoMap;
+    m_materials.setFunctions(m_gl);
+    const bool streamed = m_materials.update();
+    if (m_materialSnapshot != &snapshot || m_materialFrame != snapshot.frame || streamed) {
+        m_materialSnapshot = &snapshot;
+        m_materialFrame = snapshot.frame;
+        m_materials.clear();
+        m_meshMaterials.resize(snapshot.meshes.size());
+        for (std::size_t i = 0; i < snapshot.meshes.size(); ++i) {
+            const auto& mesh = snapshot.meshes[i];
+            m_meshMaterials[i] = m_materials.add(mesh.albedoMap ? mesh.albedoMap->path : kNoMap,
+                mesh.metalRoughnessMap ? mesh.metalRoughnessMap->path : kNoMap,
+                mesh.metallic, mesh.roughness, mesh.emissive);
+        }
+        layoutFleets(snapshot);
+        m_materials.upload();
     }
 
-    QOpenGLContext* ctx = QOpenGLContext::currentContext();
-    if (!ctx) {
-        qWarning() << "[FieldViz] Render call skipped: No active OpenGL context.";
-        return;
+    // Screen footprint of every textured mesh, as selectLod() measures it;
+    // the maps are assumed to span their mesh once.
+    for (const auto& mesh : snapshot.meshes) {
+        if (!mesh.albedoMap && !mesh.metalRoughnessMap) continue;
+        if (!inView(mesh) || !mesh.boundsValid) continue;
+        float pixels = float(TextureStreamer::kLayerSize);   // full detail when there is no scale, or inside the bounds
+        if (m_lodPixelScale > 0.0f) {
+            const float diameter = glm::length(mesh.boundsMax - mesh.boundsMin);
+            const float distance = glm::length((mesh.boundsMin + mesh.boundsMax) * 0.5f - camPos) - diameter * 0.5f;
+            if (m_lodOrthographic) pixels = diameter * m_lodPixelScale;
+            else if (distance > 0.0f) pixels = diameter * m_lodPixelScale / distance;
+        }
+        m_materials.request(mesh.albedoMap ? mesh.albedoMap->path : kNoMap,
+            mesh.metalRoughnessMap ? mesh.metalRoughnessMap->path : kNoMap, pixels);
+    }
+
+    // Every view: the point splat pass rebinds kMaterialBinding.
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kMaterialBinding, m_materials.buffer());
+    m_gl->glActiveTexture(GL_TEXTURE0 + kAlbedoArrayTextureUnit);
+    m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, m_materials.texture(MaterialTable::Map::Color));
+    m_gl->glActiveTexture(GL_TEXTURE0 + kMetalRoughnessArrayTextureUnit);
+    m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, m_materials.texture(MaterialTable::Map::Data));
+    m_gl->glActiveTexture(GL_TEXTURE0);
+}
+
+void RenderingSystem::setSceneShading(Shader& shader) const
+{
+    shader.setVec3("lightColor", glm::vec3(1.0f));
+    shader.setBool("u_materialMaps", m_meshArena.vertexLayout() == MeshArena::VertexLayout::Full);
+    shader.setInt("u_albedoMaps", int(kAlbedoArrayTextureUnit));
+    shader.setInt("u_metalRoughnessMaps", int(kMetalRoughnessArrayTextureUnit));
+    shader.setVec3("lightDirection", kKeyLightDirection);
+    shader.setBool("u_clusteredLights", m_viewLights > 0);
+    shader.setBool("u_shadows", m_viewShadows);
+    shader.setInt("u_shadowMap", int(kShadowTextureUnit));
+    if (!m_viewShadows) return;
+    for (int c = 0; c < kShadowCascades; ++c) {
+        const std::string index = "[" + std::to_string(c) + "]";
+        // The cascades are fitted in world space; the fragments are eye-relative.
+        shader.setMat4("u_shadowMatrices" + index,
+            glm::mat4(glm::dmat4(m_shadowMatrices[c]) * glm::translate(glm::dmat4(1.0), m_eye)));
+        shader.setFloat("u_shadowTexels" + index, m_shadowTexels[c]);
     }
+}
 
-    // --- 1. GATHER ALL EFFECTOR DATA (CPU Side) ---
-    std::vector<PointEffectorGpu> pointEffectors;
-    std::vector<TriangleGpu> triangleEffectors;
-    std::vector<DirectionalEffectorGpu> directionalEffectors;
-    // ... (Effector gathering logic is correct and remains the same) ...
-    auto pointView = registry.view<PointEffectorComponent, TransformComponent>();
-    for (auto entity : pointView) {
-        auto& comp = pointView.get<PointEffectorComponent>(entity);
-        auto& xf = pointView.get<TransformComponent>(entity);
-        PointEffectorGpu effector;
-        effector.position = glm::vec4(xf.translation, 1.0f);
-        effector.normal = glm::vec4(0.0f);
-        effector.strength = comp.strength;
-        effector.radius = comp.radius;
-        effector.falloffType = static_cast<int>(comp.falloff);
-        pointEffectors.push_back(effector);
-    }
-    auto splineView = registry.view<SplineEffectorComponent, SplineComponent>();
-    for (auto entity : splineView) {
-        auto& comp = splineView.get<SplineEffectorComponent>(entity);
-        auto& spline = splineView.get<SplineComponent>(entity);
-        if (spline.cachedVertices.empty()) continue;
-        for (size_t i = 0; i < spline.cachedVertices.size() - 1; ++i) {
-            glm::vec3 tangent = glm::normalize(spline.cachedVertices[i + 1] - spline.cachedVertices[i]);
-            glm::vec3 normal = glm::normalize(glm::cross(tangent, glm::vec3(0, 1, 0)));
-            if (comp.direction == SplineEffectorComponent::ForceDirection::Tangent) {
-                normal = tangent;
+void RenderingSystem::renderShadows(const entt::registry& registry, const RenderSnapshot& snapshot,
+    const glm::mat4& view, const glm::mat4& projection, const glm::vec3& camPos, TargetFBOs& target)
+{
+    m_viewShadows = false;
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!m_shadows || !m_shadowDepthShader || !ctx) return;
+    KR_ZONE("renderShadows");
+
+    // --- 1. Which casters have settled: unmoved for kShadowSettleFrames ---
+    auto& casters = m_shadowCasters[&registry];
+    if (casters.frame != snapshot.frame) {
+        casters.frame = snapshot.frame;
+        for (const auto& mesh : snapshot.meshes) {
+            if (!mesh.castsShadow) continue;
+            auto [it, inserted] = casters.states.try_emplace(mesh.entity);
+            ShadowCasterState& state = it->second;
+            if (inserted || state.model != mesh.model || state.meshKey != mesh.meshKey) {
+                state.model = mesh.model;
+                state.meshKey = mesh.meshKey;
+                state.movedFrame = snapshot.frame;
             }
-            PointEffectorGpu effector;
-            effector.position = glm::vec4(spline.cachedVertices[i], 1.0f);
-            effector.normal = glm::vec4(normal, 0.0f);
-            effector.strength = comp.strength;
-            effector.radius = comp.radius;
-            effector.falloffType = 1;
-            pointEffectors.push_back(effector);
-        }
-    }
-    auto meshView = registry.view<MeshEffectorComponent, RenderableMeshComponent, TransformComponent>();
-    for (auto entity : meshView) {
-        auto& comp = meshView.get<MeshEffectorComponent>(entity);
-        auto& mesh = meshView.get<RenderableMeshComponent>(entity);
-        auto& xf = meshView.get<TransformComponent>(entity);
-        glm::mat4 model = xf.getTransform();
-        for (size_t i = 0; i < mesh.indices.size(); i += 3) {
-            TriangleGpu tri;
-            tri.v0 = model * glm::vec4(mesh.vertices[mesh.indices[i]].position, 1.0f);
-            tri.v1 = model * glm::vec4(mesh.vertices[mesh.indices[i + 1]].position, 1.0f);
-            tri.v2 = model * glm::vec4(mesh.vertices[mesh.indices[i + 2]].position, 1.0f);
-            tri.v0.w = comp.strength;
-            tri.normal.w = comp.distance;
-            triangleEffectors.push_back(tri);
-        }
-    }
-    auto dirView = registry.view<DirectionalEffectorComponent>();
-    for (auto entity : dirView) {
-        auto& comp = dirView.get<DirectionalEffectorComponent>(entity);
-        DirectionalEffectorGpu effector;
-        effector.direction = glm::vec4(glm::normalize(comp.direction), 0.0f);
-        effector.strength = comp.strength;
-        directionalEffectors.push_back(effector);
-    }
-
-    // --- 2. UPLOAD ALL EFFECTOR DATA TO GPU ---
-    if (m_effectorDataUBO == 0) m_gl->glGenBuffers(1, &m_effectorDataUBO);
-    m_gl->glBindBuffer(GL_UNIFORM_BUFFER, m_effectorDataUBO);
-    m_gl->glBufferData(GL_UNIFORM_BUFFER, 256 * sizeof(PointEffectorGpu) + 16 * sizeof(DirectionalEffectorGpu), nullptr, GL_DYNAMIC_DRAW);
-    if (!pointEffectors.empty()) {
-        m_gl->glBufferSubData(GL_UNIFORM_BUFFER, 0, std::min(size_t(256), pointEffectors.size()) * sizeof(PointEffectorGpu), pointEffectors.data());
-    }
-    if (!directionalEffectors.empty()) {
-        size_t directionalOffset = 256 * sizeof(PointEffectorGpu);
-        m_gl->glBufferSubData(GL_UNIFORM_BUFFER, directionalOffset, std::min(size_t(16), directionalEffectors.size()) * sizeof(DirectionalEffectorGpu), directionalEffectors.data());
+            state.seenFrame = snapshot.frame;
+        }
+        for (auto it = casters.states.begin(); it != casters.states.end();) {
+            if (it->second.seenFrame != snapshot.frame) it = casters.states.erase(it);
+            else ++it;
+        }
     }
-    m_gl->glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    if (m_triangleDataSSBO == 0) m_gl->glGenBuffers(1, &m_triangleDataSSBO);
-    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_triangleDataSSBO);
-    m_gl->glBufferData(GL_SHADER_STORAGE_BUFFER, triangleEffectors.size() * sizeof(TriangleGpu), triangleEffectors.empty() ? nullptr : triangleEffectors.data(), GL_DYNAMIC_DRAW);
-    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-    auto& arrowPrimitives = m_contextPrimitives[ctx];
-    if (arrowPrimitives.arrowVAO == 0) {
-        std::vector<Vertex> arrowVertices;
-        std::vector<unsigned int> arrowIndices;
-        createArrowPrimitive(arrowVertices, arrowIndices);
-        arrowPrimitives.arrowIndexCount = arrowIndices.size();
-        m_gl->glGenVertexArrays(1, &arrowPrimitives.arrowVAO);
-        m_gl->glGenBuffers(1, &arrowPrimitives.arrowVBO);
-        m_gl->glGenBuffers(1, &arrowPrimitives.arrowEBO);
-        m_gl->glBindVertexArray(arrowPrimitives.arrowVAO);
-        m_gl->glBindBuffer(GL_ARRAY_BUFFER, arrowPrimitives.arrowVBO);
-        m_gl->glBufferData(GL_ARRAY_BUFFER, arrowVertices.size() * sizeof(Vertex), arrowVertices.data(), GL_STATIC_DRAW);
-        m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arrowPrimitives.arrowEBO);
-        m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER, arrowIndices.size() * sizeof(unsigned int), arrowIndices.data(), GL_STATIC_DRAW);
-        m_gl->glEnableVertexAttribArray(0);
-        m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-        m_gl->glEnableVertexAttribArray(1);
-        m_gl->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-        m_gl->glBindVertexArray(0);
+    // --- 2. Cascades: a sphere around each slice of the view, in a light
+    //     space snapped to a quarter of the cascade, so a cascade (and the
+    //     static casters cached in it) only moves once the camera has ---
+    const glm::vec3 up = std::abs(kKeyLightDirection.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), -kKeyLightDirection, up);
+    const glm::mat4 inverseProjection = glm::inverse(projection);
+    const glm::mat4 inverseView = glm::inverse(view);
+    // World point at view depth 'depth' on the ray through 'ndc'; two depths
+    // every projection here keeps finite give the ray, perspective or not.
+    auto pointOnRay = [&](float x, float y, float depth) {
+        glm::vec4 a = inverseProjection * glm::vec4(x, y, 0.5f, 1.0f);
+        glm::vec4 b = inverseProjection * glm::vec4(x, y, 1.0f, 1.0f);
+        const glm::vec3 pa = glm::vec3(a) / a.w, pb = glm::vec3(b) / b.w;
+        const float t = (-depth - pa.z) / (pb.z - pa.z);
+        return glm::vec3(inverseView * glm::vec4(glm::mix(pa, pb, t), 1.0f));
+    };
+
+    struct CascadeBox { glm::vec3 centre; float halfWidth; glm::mat4 matrix; bool rebake; };
+    CascadeBox boxes[kShadowCascades];
+    std::uint64_t staticKey = 0;
+    for (const auto& mesh : snapshot.meshes) {
+        const auto it = casters.states.find(mesh.entity);
+        if (!mesh.castsShadow || !inView(mesh) || it == casters.states.end()) continue;
+        if (snapshot.frame - it->second.movedFrame < kShadowSettleFrames) continue;
+        // Order independent: the snapshot walks the registry in storage order.
+        std::uint64_t h = (std::uint64_t(entt::to_integral(mesh.entity)) << 32) ^ mesh.meshKey;
+        h = (h ^ (h >> 31)) * 0x9E3779B97F4A7C15ull;
+        staticKey += h ^ (h >> 29);
     }
 
+    float splitNear = kShadowNear;
+    for (int c = 0; c < kShadowCascades; ++c) {
+        const float t = float(c + 1) / float(kShadowCascades);
+        const float logSplit = kShadowNear * std::pow(kShadowDistance / kShadowNear, t);
+        const float splitFar = glm::mix(kShadowNear + (kShadowDistance - kShadowNear) * t, logSplit, kShadowSplitLambda);
+
+        glm::vec3 corners[8];
+        glm::vec3 centre(0.0f);
+        for (int k = 0; k < 8; ++k) {
+            corners[k] = pointOnRay((k & 1) ? 1.0f : -1.0f, (k & 2) ? 1.0f : -1.0f, (k & 4) ? splitFar : splitNear);
+            centre += corners[k] / 8.0f;
+        }
+        float radius = 0.0f;
+        for (const auto& corner : corners) radius = std::max(radius, glm::length(corner - centre));
+        radius = std::ceil(radius * 16.0f) / 16.0f;   // steady while the camera turns
+
+        // Snapping moves the centre up to a step, so the box is a third wider
+        // than the sphere; a step is then kShadowMapSize / 8 whole texels.
+        CascadeBox& box = boxes[c];
+        box.halfWidth = radius * 4.0f / 3.0f;
+        const float step = box.halfWidth / 4.0f;
+        box.centre = glm::floor(glm::vec3(lightView * glm::vec4(centre, 1.0f)) / step) * step;
+        box.matrix = glm::ortho(box.centre.x - box.halfWidth, box.centre.x + box.halfWidth,
+                                box.centre.y - box.halfWidth, box.centre.y + box.halfWidth,
+                                -(box.centre.z + box.halfWidth + kShadowCasterReach), -(box.centre.z - box.halfWidth))
+            * lightView;
+        const ShadowCascade& cascade = target.shadowCascades[c];
+        box.rebake = !cascade.staticValid || cascade.staticKey != staticKey || cascade.lightViewProjection != box.matrix;
+
+        // Sampled in [0, 1]: the same matrix, biased.
+        m_shadowMatrices[c] = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.5f)) * box.matrix;
+        m_shadowTexels[c] = 2.0f * box.halfWidth / float(kShadowMapSize);
+        splitNear = splitFar;
+    }
 
-    GLuint zero = 0;
-    m_gl->glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_debugAtomicCounter);
-    m_gl->glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &zero);
+    // --- 3. Casters per cascade: the static ones only when it is rebaked,
+    //     bucketed by mesh and level like the batched pass ---
+    struct Run { std::size_t first = 0, count = 0; };
+    Run staticRuns[kShadowCascades], dynamicRuns[kShadowCascades];
+    m_shadowInstanceScratch.clear();
+    m_shadowCommandScratch.clear();
+    auto flatten = [&](Run& run) {
+        run.first = m_shadowCommandScratch.size();
+        run.count = flattenShadowBatches();
+    };
+    for (int c = 0; c < kShadowCascades; ++c) {
+        const CascadeBox& box = boxes[c];
+        for (int pass = 0; pass < 2; ++pass) {
+            const bool statics = pass == 0;
+            if (statics && !box.rebake) continue;
+            for (const auto& mesh : snapshot.meshes) {
+                if (!mesh.castsShadow || !inView(mesh)) continue;
+                const auto it = casters.states.find(mesh.entity);
+                const bool settled = it != casters.states.end() && snapshot.frame - it->second.movedFrame >= kShadowSettleFrames;
+                if (settled != statics) continue;
+                if (mesh.boundsValid) {
+                    // Light-space box of the world box: in the cascade's square,
+                    // and not wholly behind it (nearer the light is depth clamped).
+                    const glm::vec3 centre = glm::vec3(lightView * glm::vec4((mesh.boundsMin + mesh.boundsMax) * 0.5f, 1.0f));
+                    const glm::vec3 half = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+                    const glm::mat3 rotation(lightView);
+                    const glm::vec3 extent = glm::abs(rotation[0]) * half.x + glm::abs(rotation[1]) * half.y + glm::abs(rotation[2]) * half.z;
+                    if (centre.x + extent.x < box.centre.x - box.halfWidth || centre.x - extent.x > box.centre.x + box.halfWidth
+                        || centre.y + extent.y < box.centre.y - box.halfWidth || centre.y - extent.y > box.centre.y + box.halfWidth
+                        || centre.z + extent.z < box.centre.z - box.halfWidth)
+                        continue;
+                }
+                const auto& range = acquireMeshRange(mesh);
+                InstanceData inst;
+                inst.modelMatrix = mesh.model;
+                inst.color = glm::vec4(0.0f);
+                inst.padding = glm::vec4(0.0f);
+                auto& bucket = m_shadowBatchScratch[mesh.meshKey];
+                bucket.range = &range;
+                bucket.instances[selectLod(mesh, range, camPos)].push_back(inst);
+            }
+            flatten(statics ? staticRuns[c] : dynamicRuns[c]);
+        }
+    }
 
-    // Bind the debug buffers to the binding points we used in the shaders
-    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, m_debugBuffer);
-    m_gl->glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 11, m_debugAtomicCounter);
+    // --- 4. Upload, then draw each cascade: static layer when rebaked, its
+    //     copy under the dynamic casters when either changed ---
+    if (target.shadowTexture == 0) {
+        m_gl->glGenTextures(1, &target.shadowTexture);
+        m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, target.shadowTexture);
+        m_gl->glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, kShadowMapSize, kShadowMapSize, 2 * kShadowCascades);
+        GpuMemory::trackTexture(target.shadowTexture, std::size_t(kShadowMapSize) * kShadowMapSize * 4 * 2 * kShadowCascades,
+            GpuMemory::Category::RenderTargets);
+        m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        m_gl->glGenFramebuffers(1, &target.shadowFBO);
+        m_state.bindFramebuffer(target.shadowFBO);
+        m_gl->glDrawBuffer(GL_NONE);
+        m_gl->glReadBuffer(GL_NONE);
+        for (auto& cascade : target.shadowCascades) cascade = ShadowCascade{};
+    }
 
+    bindShadowVAO(ctx);
+    uploadShadowDraws(m_meshBatches[ctx]);
+
+    // Standard depth for the maps, whatever the scene uses; casters in front
+    // of a cascade clamp to its near plane instead of vanishing.
+    const bool reverseZ = reverseZActive();
+    restoreDepthConvention(reverseZ);
+    m_state.bindFramebuffer(target.shadowFBO);
+    m_gl->glViewport(0, 0, kShadowMapSize, kShadowMapSize);
+    m_state.setDepthTest(true);
+    m_state.setDepthMask(true);
+    m_gl->glEnable(GL_DEPTH_CLAMP);
+    m_gl->glEnable(GL_POLYGON_OFFSET_FILL);
+    m_gl->glPolygonOffset(1.5f, 2.0f);
+    m_state.use(*m_shadowDepthShader);
+    auto attach = [&](int layer) {
+        m_gl->glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target.shadowTexture, 0, layer);
+    };
+    auto drawRun = [&](const Run& run, const glm::mat4& matrix) {
+        if (run.count == 0) return;
+        m_shadowDepthShader->setMat4("u_lightViewProjection", matrix);
+        m_gl->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+            (void*)(run.first * sizeof(DrawElementsIndirectCommand)), static_cast<GLsizei>(run.count), 0);
+        RenderStats::draw(run.count);
+    };
+    for (int c = 0; c < kShadowCascades; ++c) {
+        ShadowCascade& cascade = target.shadowCascades[c];
+        const CascadeBox& box = boxes[c];
+        if (box.rebake) {
+            attach(kShadowCascades + c);
+            m_gl->glClear(GL_DEPTH_BUFFER_BIT);
+            drawRun(staticRuns[c], box.matrix);
+            cascade.lightViewProjection = box.matrix;
+            cascade.staticKey = staticKey;
+            cascade.staticValid = true;
+        }
+        const bool dynamic = dynamicRuns[c].count > 0;
+        if (!box.rebake && !dynamic && !cascade.dynamicDrawn) continue;   // still the static layer
+        m_gl->glCopyImageSubData(target.shadowTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, kShadowCascades + c,
+                                 target.shadowTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, c,
+                                 kShadowMapSize, kShadowMapSize, 1);
+        attach(c);
+        drawRun(dynamicRuns[c], box.matrix);
+        cascade.dynamicDrawn = dynamic;
+    }
+    m_gl->glDisable(GL_POLYGON_OFFSET_FILL);
+    m_gl->glDisable(GL_DEPTH_CLAMP);
+    m_state.bindVertexArray(0);
+    m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    m_state.bindFramebuffer(target.sceneFBO());
+    m_gl->glViewport(0, 0, target.viewW, target.viewH);
+    applyDepthConvention(reverseZ);
+    m_gl->glActiveTexture(GL_TEXTURE0 + kShadowTextureUnit);
+    m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, target.shadowTexture);
+    m_gl->glActiveTexture(GL_TEXTURE0);
+    m_viewShadows = true;
+}
 
-    // --- 3. MAIN LOOP FOR EACH VISUALIZER ---
-    auto visualizerView = registry.view<FieldVisualizerComponent, TransformComponent>();
-    for (auto entity : visualizerView)
-    {
-        auto& vis = visualizerView.get<FieldVisualizerComponent>(entity);
-        if (!vis.isEnabled) continue;
-        const auto& xf = visualizerView.get<const TransformComponent>(entity);
+std::size_t RenderingSystem::flattenShadowBatches()
+{
+    const std::size_t first = m_shadowCommandScratch.size();
+    for (auto& [key, b] : m_shadowBatchScratch) {
+        for (int l = 0; l < MeshArena::kMaxLods; ++l) {
+            auto& instances = b.instances[l];
+            if (instances.empty()) continue;
+            DrawElementsIndirectCommand cmd;
+            cmd.count = static_cast<GLuint>(b.range->lods[l].indexCount);
+            cmd.instanceCount = static_cast<GLuint>(instances.size());
+            cmd.firstIndex = b.range->lods[l].firstIndex;
+            cmd.baseVertex = static_cast<GLuint>(b.range->baseVertex);
+            cmd.baseInstance = static_cast<GLuint>(m_shadowInstanceScratch.size());
+            m_shadowInstanceScratch.insert(m_shadowInstanceScratch.end(), instances.begin(), instances.end());
+            m_shadowCommandScratch.push_back(cmd);
+            instances.clear();
+        }
+    }
+    return m_shadowCommandScratch.size() - first;
+}
 
-        if (vis.displayMode == FieldVisualizerComponent::DisplayMode::Particles)
-        {
-            if (!m_particleUpdateComputeShader || !m_particleRenderShader) continue;
+void RenderingSystem::uploadShadowDraws(MeshBatchBuffers& batch)
+{
+    if (m_shadowCommandScratch.empty()) return;
+    const GLsizeiptr instanceBytes = m_shadowInstanceScratch.size() * sizeof(InstanceData);
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, batch.shadowInstanceBuffer);
+    if (instanceBytes > batch.shadowInstanceCapacity) {
+        batch.shadowInstanceCapacity = std::max<GLsizeiptr>(instanceBytes, batch.shadowInstanceCapacity * 2);
+        GpuMemory::bufferData(m_gl, GL_ARRAY_BUFFER, batch.shadowInstanceBuffer, batch.shadowInstanceCapacity, nullptr,
+            GL_DYNAMIC_DRAW, GpuMemory::Category::Instances);
+    }
+    m_gl->glBufferSubData(GL_ARRAY_BUFFER, 0, instanceBytes, m_shadowInstanceScratch.data());
+
+    const GLsizeiptr commandBytes = m_shadowCommandScratch.size() * sizeof(DrawElementsIndirectCommand);
+    if (batch.shadowIndirectBuffer == 0) m_gl->glGenBuffers(1, &batch.shadowIndirectBuffer);
+    m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch.shadowIndirectBuffer);
+    if (commandBytes > batch.shadowIndirectCapacity) {
+        batch.shadowIndirectCapacity = std::max<GLsizeiptr>(commandBytes, batch.shadowIndirectCapacity * 2);
+        GpuMemory::bufferData(m_gl, GL_DRAW_INDIRECT_BUFFER, batch.shadowIndirectBuffer, batch.shadowIndirectCapacity, nullptr,
+            GL_DYNAMIC_DRAW, GpuMemory::Category::Instances);
+    }
+    m_gl->glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandBytes, m_shadowCommandScratch.data());
+    RenderStats::upload(std::uint64_t(instanceBytes + commandBytes));
+}
 
-            auto& settings = vis.particleSettings;
+void RenderingSystem::destroyShadows(TargetFBOs& target)
+{
+    if (target.shadowTexture) GpuMemory::deleteTextures(m_gl, 1, &target.shadowTexture);
+    if (target.shadowFBO) m_gl->glDeleteFramebuffers(1, &target.shadowFBO);
+    target.shadowTexture = target.shadowFBO = 0;
+    for (auto& cascade : target.shadowCascades) cascade = ShadowCascade{};
+}
 
-            if (vis.particleBuffer[0] == 0 || vis.isGpuDataDirty) {
-                if (vis.particleBuffer[0] != 0) {
-                    m_gl->glDeleteBuffers(2, vis.particleBuffer);
-                    m_gl->glDeleteVertexArrays(1, &vis.particleVAO);
+bool RenderingSystem::occlusionCullingActive() const
+{
+    // The Hi-Z pyramid is of one view; a stereo frame's pass draws two.
+    return !m_stereoFrame && m_occlusionCulling && m_occlusionCullShader && m_hizBuildShader
+        && m_storageBindings > GLint(kOcclusionVisibilityBinding);
+}
+
+void RenderingSystem::buildHiZ(TargetFBOs& target)
+{
+    KR_ZONE("buildHiZ");
+    const int w = std::max(1, target.w / 2), h = std::max(1, target.h / 2);
+    if (target.hizTexture == 0) {
+        target.hizLevels = 1;
+        while ((std::max(w, h) >> target.hizLevels) > 0) ++target.hizLevels;
+        m_gl->glGenTextures(1, &target.hizTexture);
+        m_gl->glBindTexture(GL_TEXTURE_2D, target.hizTexture);
+        m_gl->glTexStorage2D(GL_TEXTURE_2D, target.hizLevels, GL_R32F, w, h);
+        GpuMemory::trackTexture(target.hizTexture, std::size_t(w) * h * 4 * 4 / 3, GpuMemory::Category::RenderTargets);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+
+    // Reads the depth attachment while it stays bound: compute draws nothing.
+    // Multisampled depth is resolved into it first.
+    if (target.msaaSamples) resolveMsaa(target, GL_DEPTH_BUFFER_BIT);
+    m_state.use(*m_hizBuildShader);
+    m_hizBuildShader->setVec2("u_viewSize", glm::vec2(target.viewW, target.viewH));
+    m_hizBuildShader->setBool("u_reverseZ", reverseZActive());
+    m_hizBuildShader->setInt("u_depth", int(kHiZTextureUnit));
+    m_gl->glActiveTexture(GL_TEXTURE0 + kHiZTextureUnit);
+    m_gl->glBindTexture(GL_TEXTURE_2D, target.mainDepthTexture);
+    m_gl->glActiveTexture(GL_TEXTURE0);
+    for (int level = 0; level < target.hizLevels; ++level) {
+        const int levelW = std::max(1, target.viewW >> (level + 1));
+        const int levelH = std::max(1, target.viewH >> (level + 1));
+        m_hizBuildShader->setInt("u_level", level);
+        m_gl->glBindImageTexture(0, target.hizTexture, std::max(level - 1, 0), GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        m_gl->glBindImageTexture(1, target.hizTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        m_gl->glDispatchCompute((levelW + 7) / 8, (levelH + 7) / 8, 1);
+        RenderStats::dispatch();
+        m_gl->glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+    m_gl->glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    m_gl->glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+    m_gl->glBindImageTexture(1, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    if (target.msaaSamples) m_state.bindFramebuffer(target.msaaFBO);
+}
+
+void RenderingSystem::destroyOcclusion(TargetFBOs& target)
+{
+    if (target.hizTexture) GpuMemory::deleteTextures(m_gl, 1, &target.hizTexture);
+    target.hizTexture = 0;
+    target.hizLevels = 0;
+}
+
+void RenderingSystem::renderPointClouds(entt::registry& registry, const glm::vec3& camPos,
+    const glm::mat4& projection, TargetFBOs& target)
+{
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!m_pointCloudShader || !ctx) return;
+
+    Shader* splatShader = m_pointSplat64Shader ? m_pointSplat64Shader.get() : m_pointSplatShader.get();
+    const bool splat = m_pointCloudMode == PointCloudMode::Splat && splatShader && m_pointSplatResolveShader;
+
+    m_pointClouds.setFunctions(m_gl);
+    // A splatted point covers one pixel, so refine until the spacing does too.
+    m_pointClouds.setPixelError(splat ? 1.0f : 2.0f);
+    PointCloudRenderer::View view;
+    view.frustum = m_frustum;
+    view.camPos = camPos;
+    view.eye = m_eye;
+    view.pixelScale = m_lodPixelScale;
+    view.orthographic = m_lodOrthographic;
+    view.tick = m_tick;
+    if (m_pointClouds.prepare(registry, view) == 0) return;
+
+    auto& primitives = m_contextPrimitives[ctx];
+    if (splat) {
+        if (!m_pointClouds.splat(primitives.pointClouds, m_state, *splatShader,
+                m_pointSplat64Shader ? 1 : 2, target.viewW, target.viewH)) return;
+        if (primitives.compositeVAO == 0) m_gl->glGenVertexArrays(1, &primitives.compositeVAO);
+
+        // One full-view triangle; empty pixels discard, the rest write depth
+        // so meshes and later passes occlude the points as usual.
+        const GLStateCache::State stateBefore = m_state.snapshot();
+        m_state.setBlend(false);
+        m_state.setDepthTest(true);
+        m_state.setDepthMask(true);
+        m_state.use(*m_pointSplatResolveShader);
+        m_state.bindVertexArray(primitives.compositeVAO);
+        m_gl->glUniform2i(m_pointSplatResolveShader->uniformLocation("u_size"), target.viewW, target.viewH);
+        m_pointSplatResolveShader->setBool("u_zeroToOne", reverseZActive());
+        m_pointSplatResolveShader->setFloat("u_edlStrength", m_edlStrength);
+        m_pointSplatResolveShader->setFloat("u_edlRadius", m_edlRadius * target.drawnScale);
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPointSplatTargetBinding, primitives.pointClouds.splatTarget);
+        m_gl->glDrawArrays(GL_TRIANGLES, 0, 3);
+        RenderStats::draw();
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPointSplatTargetBinding, 0);
+        m_state.restore(stateBefore);
+        return;
+    }
+
+    // Opaque, depth-tested and written like the meshes.
+    const GLStateCache::State stateBefore = m_state.snapshot();
+    m_state.setBlend(false);
+    m_state.setDepthTest(true);
+    m_state.setDepthMask(true);
+    m_gl->glEnable(GL_PROGRAM_POINT_SIZE);
+    m_state.use(*m_pointCloudShader);
+    m_pointCloudShader->setFloat("u_pixelScale", projection[1][1] * 0.5f * float(target.viewH));
+    m_pointCloudShader->setFloat("u_maxPointSize", 16.0f);
+    m_pointClouds.draw(primitives.pointClouds, m_state);
+    m_gl->glDisable(GL_PROGRAM_POINT_SIZE);
+    m_state.restore(stateBefore);
+}
+
+void RenderingSystem::updateReconstruction(entt::registry& registry, GpuProfiler* profiler)
+{
+    if (!m_reconstructionSplatShader || !m_reconstructionIntegrateShader || !m_reconstructionTrackShader) return;
+
+    m_meshArena.setFunctions(m_gl);
+    m_reconstruction.setFunctions(m_gl);
+    m_reconstruction.update(registry, m_sensorBuffers, m_meshArena, m_state, *m_reconstructionSplatShader,
+        *m_reconstructionIntegrateShader, *m_reconstructionTrackShader, m_tick, profiler);
+}
+
+void RenderingSystem::simulateVirtualSensors(entt::registry& registry, const RenderSnapshot& snapshot, TargetFBOs& target)
+{
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!m_virtualSensorDepthShader || !m_virtualSensorPackShader || !ctx) return;
+    auto sensors = registry.view<VirtualSensorComponent>();
+    if (sensors.begin() == sensors.end()) return;
+    KR_ZONE("simulateVirtualSensors");
+
+    m_sensorBuffers.setFunctions(m_gl);
+    m_sensorBuffers.update(registry, m_tick);
+    m_virtualSensors.setFunctions(m_gl);
+    if (!m_virtualSensors.plan(registry, m_sensorBuffers, m_tick)) return;
+
+    // Every mesh in reach of a planned sensor, once, at its finest level;
+    // the geometry shader sorts the triangles into the views.
+    m_shadowInstanceScratch.clear();
+    m_shadowCommandScratch.clear();
+    for (const auto& mesh : snapshot.meshes) {
+        if (mesh.boundsValid && !m_virtualSensors.reaches(mesh.boundsMin, mesh.boundsMax)) continue;
+        const auto& range = acquireMeshRange(mesh);
+        InstanceData inst;
+        inst.modelMatrix = mesh.model;
+        inst.color = glm::vec4(0.0f);
+        inst.padding = glm::vec4(0.0f);
+        auto& bucket = m_shadowBatchScratch[mesh.meshKey];
+        bucket.range = &range;
+        bucket.instances[0].push_back(inst);
+    }
+    const std::size_t commands = flattenShadowBatches();
+    bindShadowVAO(ctx);
+    uploadShadowDraws(m_meshBatches[ctx]);
+
+    const bool reverseZ = reverseZActive();
+    restoreDepthConvention(reverseZ);
+    m_virtualSensors.render(m_state, *m_virtualSensorDepthShader, [&] {
+        if (commands == 0) return;
+        m_gl->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(commands), 0);
+        RenderStats::draw(commands);
+    });
+    m_state.bindVertexArray(0);
+    m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    m_virtualSensors.pack(m_state, *m_virtualSensorPackShader, m_sensorBuffers);
+
+    m_state.bindFramebuffer(target.sceneFBO());
+    m_gl->glViewport(0, 0, target.viewW, target.viewH);   // every viewport index
+    applyDepthConvention(reverseZ);
+}
+
+void RenderingSystem::renderSensorStreams(entt::registry& registry, float renderScale)
+{
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!m_sensorPointShader || !ctx) return;
+    auto sensors = registry.view<SensorStreamComponent>();
+    if (sensors.begin() == sensors.end()) return;
+
+    m_sensorBuffers.setFunctions(m_gl);
+    m_sensorBuffers.update(registry, m_tick);
+
+    auto& primitives = m_contextPrimitives[ctx];
+    if (primitives.compositeVAO == 0) {
+        m_gl->glGenVertexArrays(1, &primitives.compositeVAO);   // attribute-less: points come from the SSBO
+    }
+
+    // Fading points blend over the scene but don't occlude each other.
+    const GLStateCache::State stateBefore = m_state.snapshot();
+    m_state.setBlend(true);
+    m_state.setDepthTest(true);
+    m_state.setDepthMask(false);
+    m_gl->glEnable(GL_PROGRAM_POINT_SIZE);
+    m_state.use(*m_sensorPointShader);
+    m_state.bindVertexArray(primitives.compositeVAO);
+    m_sensorPointShader->setFloat("u_now", SensorStream::clockSeconds());
+
+    for (auto [entity, sensor] : sensors.each()) {
+        SensorBuffers::Ranges ranges;
+        if (!sensor.stream || !m_sensorBuffers.ranges(*sensor.stream, ranges)) continue;
+        const glm::mat4 model = registry.all_of<WorldTransformComponent>(entity)
+            ? registry.get<WorldTransformComponent>(entity).matrix
+            : registry.all_of<TransformComponent>(entity)
+                ? registry.get<TransformComponent>(entity).getTransform()
+                : glm::mat4(1.0f);
+        m_sensorPointShader->setMat4("u_model", model);
+        m_sensorPointShader->setFloat("u_maxAge", std::max(sensor.maxAge, 1e-3f));
+        m_sensorPointShader->setFloat("u_pointSize", std::max(sensor.pointSize * renderScale, 1.0f));
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kSensorPointsBinding, ranges.buffer);
+        for (int i = 0; i < 2; ++i) {
+            if (ranges.count[i] <= 0) continue;
+            m_gl->glDrawArrays(GL_POINTS, ranges.first[i], ranges.count[i]);
+            RenderStats::draw();
+        }
+    }
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kSensorPointsBinding, 0);
+    m_gl->glDisable(GL_PROGRAM_POINT_SIZE);
+    m_state.restore(stateBefore);
+}
+
+void RenderingSystem::renderGhosts(const RenderSnapshot& snapshot)
+{
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!m_ghostShader || !ctx || snapshot.ghosts.empty() || !(m_viewLayers & RenderLayers::Visual)) return;
+    KR_ZONE("renderGhosts");
+
+    // --- 1. One command per link mesh; its instances are the ghosts ---
+    m_ghostInstanceScratch.clear();
+    m_ghostCommandScratch.clear();
+    for (const RenderSnapshot::Ghost& ghost : snapshot.ghosts) {
+        const std::size_t count = ghost.poses->size() / std::size_t(ghost.linkCount);
+        if (count == 0) continue;
+        const MeshArena::Range& range = acquireMeshRange(ghost.meshKey, *ghost.data);
+
+        DrawElementsIndirectCommand cmd;
+        cmd.count = static_cast<GLuint>(range.lods[0].indexCount);
+        cmd.instanceCount = static_cast<GLuint>(count);
+        cmd.firstIndex = range.lods[0].firstIndex;
+        cmd.baseVertex = static_cast<GLuint>(range.baseVertex);
+        cmd.baseInstance = static_cast<GLuint>(m_ghostInstanceScratch.size());
+        m_ghostCommandScratch.push_back(cmd);
+
+        for (std::size_t k = 0; k < count; ++k) {
+            InstanceData& inst = m_ghostInstanceScratch.emplace_back();
+            inst.modelMatrix = eyeRelative(ghost.root * (*ghost.poses)[k * std::size_t(ghost.linkCount) + std::size_t(ghost.link)]);
+            const float t = count > 1 ? float(k) / float(count - 1) : 1.0f;
+            inst.color = glm::vec4(ghost.colour, glm::mix(ghost.startAlpha, ghost.endAlpha, t));
+            inst.padding = glm::vec4(0.0f);
+        }
+        // Back to front, so copies of one link blend in order; the matrices
+        // are eye-relative, so distance is the translation's length.
+        std::sort(m_ghostInstanceScratch.begin() + cmd.baseInstance, m_ghostInstanceScratch.end(),
+            [](const InstanceData& a, const InstanceData& b) {
+                return glm::dot(glm::vec3(a.modelMatrix[3]), glm::vec3(a.modelMatrix[3]))
+                     > glm::dot(glm::vec3(b.modelMatrix[3]), glm::vec3(b.modelMatrix[3]));
+            });
+    }
+    if (m_ghostCommandScratch.empty()) return;
+
+    // --- 2. Upload into this context's ghost buffers ---
+    auto& batch = m_meshBatches[ctx];
+    bindGhostVAO(ctx);   // after acquire: an upload may have grown the arena
+    const GLsizeiptr instanceBytes = m_ghostInstanceScratch.size() * sizeof(InstanceData);
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, batch.ghostInstanceBuffer);
+    if (instanceBytes > batch.ghostInstanceCapacity) {
+        batch.ghostInstanceCapacity = std::max<GLsizeiptr>(instanceBytes, batch.ghostInstanceCapacity * 2);
+        GpuMemory::bufferData(m_gl, GL_ARRAY_BUFFER, batch.ghostInstanceBuffer, batch.ghostInstanceCapacity, nullptr,
+            GL_DYNAMIC_DRAW, GpuMemory::Category::Instances);
+    }
+    m_gl->glBufferSubData(GL_ARRAY_BUFFER, 0, instanceBytes, m_ghostInstanceScratch.data());
+
+    const GLsizeiptr commandBytes = m_ghostCommandScratch.size() * sizeof(DrawElementsIndirectCommand);
+    if (batch.ghostIndirectBuffer == 0) m_gl->glGenBuffers(1, &batch.ghostIndirectBuffer);
+    m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch.ghostIndirectBuffer);
+    if (commandBytes > batch.ghostIndirectCapacity) {
+        batch.ghostIndirectCapacity = std::max<GLsizeiptr>(commandBytes, batch.ghostIndirectCapacity * 2);
+        GpuMemory::bufferData(m_gl, GL_DRAW_INDIRECT_BUFFER, batch.ghostIndirectBuffer, batch.ghostIndirectCapacity, nullptr,
+            GL_DYNAMIC_DRAW, GpuMemory::Category::Instances);
+    }
+    m_gl->glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandBytes, m_ghostCommandScratch.data());
+    RenderStats::upload(std::uint64_t(instanceBytes + commandBytes));
+
+    // --- 3. Blended over the scene, occluded by it but not by each other ---
+    const GLStateCache::State stateBefore = m_state.snapshot();
+    m_state.setBlend(true);
+    m_state.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    m_state.setDepthTest(true);
+    m_state.setDepthMask(false);
+    m_state.setCullFace(true);   // a ghost's far side would double its opacity
+    m_state.use(*m_ghostShader);
+    m_ghostShader->setVec3("lightDirection", kKeyLightDirection);
+    m_gl->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+        static_cast<GLsizei>(m_ghostCommandScratch.size()), 0);
+    RenderStats::draw(m_ghostCommandScratch.size());
+
+    m_state.bindVertexArray(0);
+    m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    m_state.restore(stateBefore);
+}
+
+void RenderingSystem::renderFrames(const RenderSnapshot& snapshot)
+{
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!m_frameTriadShader || !ctx || snapshot.frames.empty() || !(m_viewLayers & RenderLayers::Visual)) return;
+    KR_ZONE("renderFrames");
+
+    // --- 1. The frames, packed to three rows each, once per snapshot in this context ---
+    const GLuint vao = ensureTriadPrimitive(ctx);
+    auto& primitives = m_contextPrimitives[ctx];
+    if (primitives.frameSnapshot != snapshot.frame) {
+        m_frameScratch.resize(snapshot.frames.size());
+        for (std::size_t i = 0; i < snapshot.frames.size(); ++i) {
+            const glm::mat4& m = snapshot.frames[i];
+            for (int r = 0; r < 3; ++r) m_frameScratch[i].rows[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+        }
+        const GLsizeiptr bytes = GLsizeiptr(m_frameScratch.size() * sizeof(FrameTriadGpu));
+        if (primitives.frameBuffer == 0) m_gl->glGenBuffers(1, &primitives.frameBuffer);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, primitives.frameBuffer);
+        if (bytes > primitives.frameCapacity) {
+            primitives.frameCapacity = std::max<GLsizeiptr>(bytes, primitives.frameCapacity * 2);
+            GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, primitives.frameBuffer, primitives.frameCapacity, nullptr,
+                GL_DYNAMIC_DRAW, GpuMemory::Category::Instances);
+        }
+        m_gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, m_frameScratch.data());
+        RenderStats::upload(std::uint64_t(bytes));
+        primitives.frameSnapshot = snapshot.frame;
+    }
+
+    // --- 2. One instanced draw, sized on screen by the vertex shader ---
+    const GLStateCache::State stateBefore = m_state.snapshot();
+    m_state.setBlend(false);
+    m_state.setDepthTest(true);
+    m_state.setDepthMask(true);
+    m_state.setCullFace(false);   // the arrow primitive's winding is not relied on
+    m_state.use(*m_frameTriadShader);
+    m_frameTriadShader->setInt("u_axisVertices", m_sharedPrimitives.triadAxisVertices);
+    m_frameTriadShader->setFloat("u_triadPixels", kFrameTriadPixels);
+    m_frameTriadShader->setVec3("lightDirection", kKeyLightDirection);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kFrameTriadBinding, primitives.frameBuffer);
+    m_state.bindVertexArray(vao);
+    m_gl->glDrawElementsInstanced(GL_TRIANGLES, GLsizei(m_sharedPrimitives.triadIndexCount), GL_UNSIGNED_INT, nullptr,
+        GLsizei(snapshot.frames.size()));
+    RenderStats::draw();
+
+    m_state.bindVertexArray(0);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kFrameTriadBinding, 0);
+    m_state.restore(stateBefore);
+}
+
+void RenderingSystem::renderLabels(const RenderSnapshot& snapshot)
+{
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!m_labelShader || !ctx || snapshot.labels.empty() || !(m_viewLayers & RenderLayers::Visual)) return;
+    KR_ZONE("renderLabels");
+
+    GlyphAtlas& atlas = GlyphAtlas::instance();
+    if (m_sharedPrimitives.glyphAtlas == 0) {
+        m_gl->glGenTextures(1, &m_sharedPrimitives.glyphAtlas);
+        m_gl->glActiveTexture(GL_TEXTURE0 + kGlyphAtlasTextureUnit);
+        m_gl->glBindTexture(GL_TEXTURE_2D, m_sharedPrimitives.glyphAtlas);
+        m_gl->glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8, atlas.width(), atlas.height());
+        m_gl->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        m_gl->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, atlas.width(), atlas.height(), GL_RED, GL_UNSIGNED_BYTE, atlas.texels().data());
+        m_gl->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        GpuMemory::trackTexture(m_sharedPrimitives.glyphAtlas, atlas.texels().size(), GpuMemory::Category::Other);
+        RenderStats::upload(atlas.texels().size());
+        m_gl->glActiveTexture(GL_TEXTURE0);
+    }
+
+    auto& primitives = m_contextPrimitives[ctx];
+    if (primitives.labelVAO == 0) m_gl->glGenVertexArrays(1, &primitives.labelVAO);
+    if (primitives.labelSnapshot != snapshot.frame) {
+        const std::size_t labels = snapshot.labels.size();
+        std::vector<std::shared_ptr<const GlyphAtlas::Layout>>& layouts = m_labelLayoutScratch;
+        layouts.resize(labels);
+        std::size_t glyphs = 0;
+        for (std::size_t i = 0; i < labels; ++i) {
+            layouts[i] = atlas.layout(snapshot.labels[i].text);
+            glyphs += layouts[i]->quads.size();
+        }
+
+        // --- 1. Glyph quads, rewritten only for runs of labels that changed ---
+        // A label is unchanged if it holds the same layout at the same place;
+        // one whose glyph count changed moves every label after it.
+        std::vector<ContextPrimitives::LabelRange>& ranges = primitives.labelRanges;
+        const GLsizeiptr glyphBytes = GLsizeiptr(std::max<std::size_t>(glyphs, 1) * sizeof(LabelGlyphGpu));
+        if (primitives.labelGlyphBuffer == 0) m_gl->glGenBuffers(1, &primitives.labelGlyphBuffer);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, primitives.labelGlyphBuffer);
+        if (glyphBytes > primitives.labelGlyphCapacity) {
+            primitives.labelGlyphCapacity = std::max<GLsizeiptr>(glyphBytes, primitives.labelGlyphCapacity * 2);
+            GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, primitives.labelGlyphBuffer, primitives.labelGlyphCapacity,
+                nullptr, GL_DYNAMIC_DRAW, GpuMemory::Category::Instances);
+            ranges.clear();   // the contents went with the old storage
+        }
+        std::uint32_t first = 0, runFirst = 0;
+        auto flushRun = [&]() {
+            if (m_labelGlyphScratch.empty()) return;
+            const GLsizeiptr bytes = GLsizeiptr(m_labelGlyphScratch.size() * sizeof(LabelGlyphGpu));
+            m_gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, GLintptr(runFirst) * GLintptr(sizeof(LabelGlyphGpu)), bytes,
+                m_labelGlyphScratch.data());
+            RenderStats::upload(std::uint64_t(bytes));
+            m_labelGlyphScratch.clear();
+        };
+        m_labelGlyphScratch.clear();
+        for (std::size_t i = 0; i < labels; ++i) {
+            const GlyphAtlas::Layout& layout = *layouts[i];
+            const bool unchanged = i < ranges.size() && ranges[i].layout == layouts[i] && ranges[i].first == first;
+            if (unchanged) flushRun();
+            else {
+                if (m_labelGlyphScratch.empty()) runFirst = first;
+                for (const GlyphAtlas::Quad& quad : layout.quads)
+                    m_labelGlyphScratch.push_back({ quad.rect, quad.uv, std::uint32_t(i), { 0, 0, 0 } });
+            }
+            if (i < ranges.size()) ranges[i] = { layouts[i], first };
+            else ranges.push_back({ layouts[i], first });
+            first += std::uint32_t(layout.quads.size());
+        }
+        flushRun();
+        ranges.resize(labels);
+        primitives.labelGlyphCount = GLsizei(glyphs);
+
+        // --- 2. Anchors and colours: one record per label, every snapshot ---
+        m_labelScratch.resize(labels);
+        for (std::size_t i = 0; i < labels; ++i) {
+            const RenderSnapshot::Label& label = snapshot.labels[i];
+            m_labelScratch[i] = { glm::vec4(label.anchor, label.pixelHeight), label.colour };
+        }
+        const GLsizeiptr labelBytes = GLsizeiptr(labels * sizeof(LabelGpu));
+        if (primitives.labelBuffer == 0) m_gl->glGenBuffers(1, &primitives.labelBuffer);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, primitives.labelBuffer);
+        if (labelBytes > primitives.labelCapacity) {
+            primitives.labelCapacity = std::max<GLsizeiptr>(labelBytes, primitives.labelCapacity * 2);
+            GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, primitives.labelBuffer, primitives.labelCapacity, nullptr,
+                GL_DYNAMIC_DRAW, GpuMemory::Category::Instances);
+        }
+        m_gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, labelBytes, m_labelScratch.data());
+        RenderStats::upload(std::uint64_t(labelBytes));
+        primitives.labelSnapshot = snapshot.frame;
+    }
+    if (primitives.labelGlyphCount == 0) return;
+
+    // --- 3. One instanced draw of four-vertex strips, blended over the scene ---
+    const GLStateCache::State stateBefore = m_state.snapshot();
+    m_state.setBlend(true);
+    m_state.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    m_state.setDepthTest(false);
+    m_state.setDepthMask(false);
+    m_state.setCullFace(false);
+    m_state.use(*m_labelShader);
+    m_labelShader->setInt("u_glyphAtlas", int(kGlyphAtlasTextureUnit));
+    m_labelShader->setFloat("u_spread", float(GlyphAtlas::kSpread));
+    m_gl->glActiveTexture(GL_TEXTURE0 + kGlyphAtlasTextureUnit);
+    m_gl->glBindTexture(GL_TEXTURE_2D, m_sharedPrimitives.glyphAtlas);
+    m_gl->glActiveTexture(GL_TEXTURE0);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kLabelGlyphBinding, primitives.labelGlyphBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kLabelBinding, primitives.labelBuffer);
+    m_state.bindVertexArray(primitives.labelVAO);
+    m_gl->glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, primitives.labelGlyphCount);
+    RenderStats::draw();
+
+    m_state.bindVertexArray(0);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kLabelGlyphBinding, 0);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kLabelBinding, 0);
+    m_state.restore(stateBefore);
+}
+
+void RenderingSystem::renderGrid(entt::registry& registry, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& camPos)
+{
+    if (!m_gridShader) return;
+
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!ctx) return;
+    auto& primitives = m_contextPrimitives[ctx];
+
+    if (primitives.gridVAO == 0) {
+        KR_TRACE(Lifecycle) << "Creating grid VAO for context" << ctx;
+        if (m_sharedPrimitives.gridVBO == 0) {
+            float gridPlaneVertices[] = { -2000.f,0,-2000.f, 2000.f,0,-2000.f, 2000.f,0,2000.f, -2000.f,0,-2000.f, 2000.f,0,2000.f, -2000.f,0,2000.f };
+            m_gl->glGenBuffers(1, &m_sharedPrimitives.gridVBO);
+            m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_sharedPrimitives.gridVBO);
+            GpuMemory::bufferData(m_gl, GL_ARRAY_BUFFER, m_sharedPrimitives.gridVBO, sizeof(gridPlaneVertices), gridPlaneVertices,
+                GL_STATIC_DRAW, GpuMemory::Category::Other);
+        }
+        m_gl->glGenVertexArrays(1, &primitives.gridVAO);
+        m_state.bindVertexArray(primitives.gridVAO);
+        m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_sharedPrimitives.gridVBO);
+        m_gl->glEnableVertexAttribArray(0);
+        m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    }
+
+    auto viewG = registry.view<GridComponent, TransformComponent>();
+    if (viewG.begin() == viewG.end()) return;
+
+    // One GridUniforms slot per grid, rewritten only when its packed block
+    // changed; the shader derives distances and level fades itself.
+    if (m_gridUniformStride == 0) {
+        GLint alignment = 256;
+        m_gl->glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        m_gridUniformStride = (GLsizeiptr(sizeof(GridUniformsGpu)) + alignment - 1) / alignment * alignment;
+    }
+    const auto& props = registry.ctx().get<SceneProperties>();
+
+    m_state.use(*m_gridShader);
+    m_state.bindVertexArray(primitives.gridVAO);
+    m_gl->glEnable(GL_POLYGON_OFFSET_FILL);
+    // Lines win against coplanar geometry and write their depth in the same pass.
+    m_gl->glPolygonOffset(-1.0f, -1.0f);
+    m_state.setDepthMask(true);
+
+    std::size_t slot = 0;
+    for (auto entity : viewG) {
+        auto& grid = viewG.get<GridComponent>(entity);
+        if (!grid.masterVisible) continue;
+
+        const GridUniformsGpu packed = packGridUniforms(grid, viewG.get<TransformComponent>(entity).getTransform(), props);
+        if (slot >= m_gridUniforms.size()) {
+            // Regrown for more grids: every slot is uploaded again.
+            const std::size_t capacity = std::max<std::size_t>(4, m_gridUniforms.size() * 2);
+            if (m_gridUBO == 0) m_gl->glGenBuffers(1, &m_gridUBO);
+            m_gl->glBindBuffer(GL_UNIFORM_BUFFER, m_gridUBO);
+            GpuMemory::bufferData(m_gl, GL_UNIFORM_BUFFER, m_gridUBO, GLsizeiptr(capacity) * m_gridUniformStride, nullptr,
+                GL_DYNAMIC_DRAW, GpuMemory::Category::Other);
+            m_gridUniforms.assign(capacity, GridUniformsGpu{});
+            m_gridUniformsValid.assign(capacity, false);
+        }
+        if (!m_gridUniformsValid[slot] || std::memcmp(&packed, &m_gridUniforms[slot], sizeof(packed)) != 0) {
+            m_gl->glBindBuffer(GL_UNIFORM_BUFFER, m_gridUBO);
+            m_gl->glBufferSubData(GL_UNIFORM_BUFFER, GLintptr(slot) * m_gridUniformStride, sizeof(packed), &packed);
+            RenderStats::upload(sizeof(packed));
+            m_gridUniforms[slot] = packed;
+            m_gridUniformsValid[slot] = true;
+        }
+
+        m_gl->glBindBufferRange(GL_UNIFORM_BUFFER, kGridUniformsBinding, m_gridUBO,
+            GLintptr(slot) * m_gridUniformStride, sizeof(GridUniformsGpu));
+        m_gl->glDrawArrays(GL_TRIANGLES, 0, 6);
+        RenderStats::draw();
+        ++slot;
+    }
+    m_gl->glDisable(GL_POLYGON_OFFSET_FILL);
+}
+
+void RenderingSystem::renderSplines(entt::registry& registry, const glm::mat4& view, const glm::mat4& proj, const glm::vec3& eye, int viewportWidth, int viewportHeight)
+{
+    KR_TRACE(Spline) << "[SplinePass] Starting...";
+
+    if (!m_glowShader || !m_capShader) return;
+
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!ctx) return;
+    auto& primitives = m_contextPrimitives[ctx];
+
+    const bool tessellate = m_splineRenderMode == SplineRenderMode::GpuTessellated && m_splineShader;
+
+    // Ranges of destroyed splines go back to the arenas' free lists.
+    auto alive = [&](std::uint32_t key) {
+        const auto e = entt::entity(key);
+        return registry.valid(e) && registry.all_of<SplineComponent>(e);
+        };
+    m_splineArena.setFunctions(m_gl);
+    m_splineArena.prune(alive);
+    m_splineVertexArena.setFunctions(m_gl);
+    m_splineVertexArena.prune(alive);
+
+    // --- 1. One style record and a few draw commands per spline ---
+    m_splineStyleScratch.clear();
+    for (auto* list : { &m_splineGlowCommands, &m_splineCapCommands, &m_splinePatchCommands, &m_splinePatchCapCommands })
+        list->clear();
+
+    auto splineView = registry.view<SplineComponent>();
+    for (auto e : splineView)
+    {
+        auto& sp = splineView.get<SplineComponent>(e);
+
+        // --- Caching Logic ---
+        // Only perform the expensive CPU calculation if the spline has changed.
+        if (sp.isDirty) {
+            KR_TRACE(Spline) << "[Spline Cache] Recalculating vertices for dirty spline entity:" << (int)e;
+            rebuildSplineCache(sp);
+        }
+
+        SplineStyleGpu style{};
+        style.glowColour = sp.glowColour;
+        style.coreColour = sp.coreColour;
+        style.thickness = sp.thickness;
+        const GLuint base = static_cast<GLuint>(m_splineStyleScratch.size());
+        const std::uint32_t key = std::uint32_t(entt::to_integral(e));
+
+        GLsizei segments = 0;
+        if (tessellate) {
+            const GLsizei n = static_cast<GLsizei>(sp.controlPoints.size());
+            switch (sp.type) {
+            case SplineType::Linear:     segments = n - 1; style.splineType = 0; break;
+            case SplineType::CatmullRom: segments = n - 3; style.splineType = 1; break;
+            // One patch per control-point span keeps high-degree curves within the tessellator's level limit.
+            case SplineType::Bezier:     segments = n - 1; style.splineType = 2; break;
+            case SplineType::PiecewiseBezier: segments = (n - 1) / 3; style.splineType = 3; break;
+            case SplineType::Parametric: break; // arbitrary function: CPU samples only
+            }
+        }
+
+        // A spline lives in one arena at a time; whatever it held in the
+        // other (before a mode switch or a type edit) goes back now.
+        if (segments >= 1) {
+            // --- Tessellated: only control points live on the GPU ---
+            m_splineVertexArena.release(key);
+            const auto& range = m_splineArena.upload(key, sp.cacheRevision, sp.controlPoints);
+            style.firstPoint = range.first;
+            style.pointCount = range.count;
+            style.segmentCount = segments;
+            m_splinePatchCommands.push_back({ GLuint(segments), 1, 0, base });
+
+            if (sp.type == SplineType::Linear) {
+                // For linear splines, cap every control point to round the corners.
+                m_splinePatchCapCommands.push_back({ GLuint(range.count), 1, GLuint(range.first), base });
+            }
+            else {
+                // Catmull-Rom passes through p1..p(n-2), a cubic chain ends on
+                // its last full anchor, Bezier runs from p0 to p(n-1).
+                GLuint head = 0, tail = GLuint(range.count - 1);
+                if (sp.type == SplineType::CatmullRom) { head = 1; tail -= 1; }
+                if (sp.type == SplineType::PiecewiseBezier) tail = GLuint(3 * segments);
+                m_splinePatchCapCommands.push_back({ 1, 1, GLuint(range.first) + head, base });
+                m_splinePatchCapCommands.push_back({ 1, 1, GLuint(range.first) + tail, base });
+            }
+        }
+        else {
+            // --- CPU-evaluated: the cached polyline, rewritten only on a new revision ---
+            m_splineArena.release(key);
+            if (sp.cachedVertices().size() < 2) {
+                m_splineVertexArena.release(key);
+                continue;
+            }
+
+            const auto& range = m_splineVertexArena.upload(key, sp.cacheRevision, sp.cachedVertices());
+            m_splineGlowCommands.push_back({ GLuint(range.count), 1, GLuint(range.first), base });
+
+            if (sp.type == SplineType::Linear) {
+                // Linear splines sample exactly their control points; cap every corner.
+                m_splineCapCommands.push_back({ GLuint(range.count), 1, GLuint(range.first), base });
+            }
+            else {
+                // For smooth splines, only cap the absolute start and end points.
+                m_splineCapCommands.push_back({ 1, 1, GLuint(range.first), base });
+                m_splineCapCommands.push_back({ 1, 1, GLuint(range.first + range.count - 1), base });
+            }
+        }
+        m_splineStyleScratch.push_back(style);
+    }
+    if (m_splineStyleScratch.empty()) return;
+
+    // --- 2. Upload styles and commands (grow-only, one sub-data per buffer) ---
+    prepareSplineVAOs(primitives);
+
+    const GLsizeiptr styleBytes = m_splineStyleScratch.size() * sizeof(SplineStyleGpu);
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, primitives.splineStyleBuffer);
+    if (styleBytes > primitives.splineStyleCapacity) {
+        primitives.splineStyleCapacity = std::max<GLsizeiptr>(styleBytes, primitives.splineStyleCapacity * 2);
+        GpuMemory::bufferData(m_gl, GL_ARRAY_BUFFER, primitives.splineStyleBuffer, primitives.splineStyleCapacity, nullptr,
+            GL_DYNAMIC_DRAW, GpuMemory::Category::Splines);
+    }
+    m_gl->glBufferSubData(GL_ARRAY_BUFFER, 0, styleBytes, m_splineStyleScratch.data());
+    RenderStats::upload(std::uint64_t(styleBytes));
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_splineCommandScratch.clear();
+    std::array<GLintptr, 4> offsets{};
+    const std::array<const std::vector<DrawArraysIndirectCommand>*, 4> lists = {
+        &m_splineGlowCommands, &m_splineCapCommands, &m_splinePatchCommands, &m_splinePatchCapCommands };
+    for (std::size_t i = 0; i < lists.size(); ++i) {
+        offsets[i] = GLintptr(m_splineCommandScratch.size() * sizeof(DrawArraysIndirectCommand));
+        m_splineCommandScratch.insert(m_splineCommandScratch.end(), lists[i]->begin(), lists[i]->end());
+    }
+
+    const GLsizeiptr commandBytes = m_splineCommandScratch.size() * sizeof(DrawArraysIndirectCommand);
+    m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, primitives.splineIndirectBuffer);
+    if (commandBytes > primitives.splineIndirectCapacity) {
+        primitives.splineIndirectCapacity = std::max<GLsizeiptr>(commandBytes, primitives.splineIndirectCapacity * 2);
+        GpuMemory::bufferData(m_gl, GL_DRAW_INDIRECT_BUFFER, primitives.splineIndirectBuffer, primitives.splineIndirectCapacity,
+            nullptr, GL_DYNAMIC_DRAW, GpuMemory::Category::Splines);
+    }
+    m_gl->glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandBytes, m_splineCommandScratch.data());
+    RenderStats::upload(std::uint64_t(commandBytes));
+
+    // Save the current OpenGL state to ensure this pass is isolated.
+    const GLStateCache::State stateBeforeSplines = m_state.snapshot();
+
+    // --- Set Specific State for Spline Rendering ---
+    m_state.setBlend(true);
+    m_state.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    m_state.setDepthMask(false);
+    m_state.setCullFace(false);
+
+    // --- 3. Draw: glow then caps, one multi-draw per path ---
+    auto multiDraw = [&](GLenum mode, std::size_t list) {
+        m_gl->glMultiDrawArraysIndirect(mode, reinterpret_cast<const void*>(offsets[list]),
+            static_cast<GLsizei>(lists[list]->size()), 0);
+        RenderStats::draw(lists[list]->size());
+        };
+
+    if (!m_splineGlowCommands.empty()) {
+        m_state.bindVertexArray(primitives.splineVAO);
+        m_state.use(*m_glowShader);
+        multiDraw(GL_LINE_STRIP, 0);
+        m_state.use(*m_capShader);
+        multiDraw(GL_POINTS, 1);
+    }
+    if (!m_splinePatchCommands.empty()) {
+        m_state.use(*m_splineShader);
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_splineArena.buffer());
+        m_state.bindVertexArray(primitives.splinePatchVAO);
+        m_gl->glPatchParameteri(GL_PATCH_VERTICES, 1);
+        multiDraw(GL_PATCHES, 2);
+
+        m_state.bindVertexArray(primitives.splineCapVAO);
+        m_state.use(*m_capShader);
+        multiDraw(GL_POINTS, 3);
+    }
+
+    // --- Restore State ---
+    KR_TRACE(Spline) << "[SplinePass] Finished. Resetting state...";
+    m_state.restore(stateBeforeSplines);
+    m_state.bindVertexArray(0);
+    m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    KR_TRACE(Spline) << "[SplinePass] State restored.";
+}
+
+void RenderingSystem::prepareSplineVAOs(ContextPrimitives& primitives)
+{
+    if (primitives.splineStyleBuffer == 0) {
+        KR_TRACE(Lifecycle) << "Creating spline batch primitives for context" << QOpenGLContext::currentContext();
+        m_gl->glGenBuffers(1, &primitives.splineStyleBuffer);
+        m_gl->glGenBuffers(1, &primitives.splineIndirectBuffer);
+        m_gl->glGenVertexArrays(1, &primitives.splineVAO);
+        m_gl->glGenVertexArrays(1, &primitives.splinePatchVAO);
+        m_gl->glGenVertexArrays(1, &primitives.splineCapVAO);
+
+        // Per-spline attributes (locations 1-4) come from the style buffer;
+        // each indirect command's baseInstance selects the spline's record.
+        for (GLuint vao : { primitives.splineVAO, primitives.splinePatchVAO, primitives.splineCapVAO }) {
+            m_state.bindVertexArray(vao);
+            m_gl->glBindBuffer(GL_ARRAY_BUFFER, primitives.splineStyleBuffer);
+            const GLsizei styleStride = sizeof(SplineStyleGpu);
+            m_gl->glEnableVertexAttribArray(1);
+            m_gl->glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, styleStride, (void*)offsetof(SplineStyleGpu, glowColour));
+            m_gl->glVertexAttribDivisor(1, 1);
+            m_gl->glEnableVertexAttribArray(2);
+            m_gl->glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, styleStride, (void*)offsetof(SplineStyleGpu, coreColour));
+            m_gl->glVertexAttribDivisor(2, 1);
+            m_gl->glEnableVertexAttribArray(3);
+            m_gl->glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, styleStride, (void*)offsetof(SplineStyleGpu, thickness));
+            m_gl->glVertexAttribDivisor(3, 1);
+            m_gl->glEnableVertexAttribArray(4);
+            m_gl->glVertexAttribIPointer(4, 4, GL_INT, styleStride, (void*)offsetof(SplineStyleGpu, firstPoint));
+            m_gl->glVertexAttribDivisor(4, 1);
+        }
+    }
+
+    // Re-point the position stream whenever an arena buffer was (re)created.
+    auto pointAt = [&](GLuint vao, const SplineArena& arena, std::uint32_t& generation) {
+        if (generation == arena.generation() || arena.buffer() == 0) return;
+        m_state.bindVertexArray(vao);
+        m_gl->glBindBuffer(GL_ARRAY_BUFFER, arena.buffer());
+        m_gl->glEnableVertexAttribArray(0);
+        m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+        generation = arena.generation();
+        };
+    pointAt(primitives.splineVAO, m_splineVertexArena, primitives.splineVertexGeneration);
+    pointAt(primitives.splineCapVAO, m_splineArena, primitives.splineCapGeneration);
+
+    m_state.bindVertexArray(0);
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void RenderingSystem::updateAnimations(entt::registry& registry)
+{
+    KR_ZONE("animations");
+    // m_elapsedTime in double: the same clock, without its float rounding.
+    AnimationTracks::of(registry).evaluate(m_simTime - double(1.0f - m_simAlpha) * m_simStepSize);
+}
+
+void RenderingSystem::advanceFrameTime(float deltaTime)
+{
+    m_frameDelta = deltaTime;
+    ++m_tick;
+    if (m_glCaptureFrames > 0 && --m_glCaptureFrames == 0) finishGlCapture();
+}
+
+void RenderingSystem::stepSimulation(float step)
+{
+    m_simTime += step;
+    m_simStepSize = step;
+    ++m_simStep;
+}
+
+void RenderingSystem::setSimulationAlpha(float alpha)
+{
+    // The frame shows the state between the previous step and the latest.
+    m_simAlpha = std::clamp(alpha, 0.0f, 1.0f);
+    m_elapsedTime = static_cast<float>(m_simTime - double(1.0f - m_simAlpha) * m_simStepSize);
+}
+
+int RenderingSystem::pendingSimSteps(FieldVisualizerComponent& vis) const
+{
+    // A visualizer not drawn for a while (hidden viewport, disabled) resumes
+    // from now rather than fast-forwarding through everything it missed.
+    if (m_simStep - vis.simulatedStep > kMaxCatchUpSteps) vis.simulatedStep = m_simStep - kMaxCatchUpSteps;
+    const int steps = static_cast<int>(m_simStep - vis.simulatedStep);
+    vis.simulatedStep = m_simStep;
+    return steps;
+}
+
+bool RenderingSystem::hasContinuousAnimation(entt::registry& registry) const
+{
+    if (AnimationTracks::of(registry).active()) return true;
+
+    // Point cloud nodes land over several frames after the view settles.
+    if (m_pointClouds.streaming()) return true;
+    // Block surfaces arrive a few ticks after the points that shaped them.
+    if (m_reconstruction.busy()) return true;
+    // Live sensors deliver new points continuously.
+    for (auto [entity, sensor] : registry.view<SensorStreamComponent>().each()) {
+        if (sensor.stream && sensor.stream->running()) return true;
+    }
+
+    // Arrow fields and volumes are static between edits; particles and flow advect every frame.
+    for (auto [entity, vis] : registry.view<FieldVisualizerComponent>().each()) {
+        if (vis.isEnabled && vis.displayMode != FieldVisualizerComponent::DisplayMode::Arrows
+            && vis.displayMode != FieldVisualizerComponent::DisplayMode::Volume)
+            return true;
+    }
+    return false;
+}
+
+void RenderingSystem::resetGLState()
+{
+    if (!m_gl) return;
+    m_gl->glDisable(GL_FRAMEBUFFER_SRGB);
+    m_state.setDepthTest(true);
+    m_state.setDepthMask(true);
+
+    m_state.setBlend(false);
+    m_state.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    m_state.setCullFace(false);
+    m_state.setStencilTest(false);
+    m_state.useProgram(0);
+}
+
+void RenderingSystem::resolveClipControl()
+{
+    // Not part of the 4.3 core function table; resolve it from the context.
+    m_clipControl = nullptr;
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!ctx) return;
+    const QSurfaceFormat fmt = ctx->format();
+    const bool core45 = fmt.majorVersion() > 4 || (fmt.majorVersion() == 4 && fmt.minorVersion() >= 5);
+    if (core45 || ctx->hasExtension("GL_ARB_clip_control"))
+        m_clipControl = reinterpret_cast<ClipControlFn>(ctx->getProcAddress("glClipControl"));
+    if (!m_clipControl && m_depthMode == DepthMode::ReverseZ)
+        qWarning() << "[RenderingSystem] glClipControl unavailable; reverse-Z depth disabled";
+
+    // Likewise the GPU-counted multi-draw of the cluster pass; without it
+    // the pass draws every slot and the unwritten ones are empty.
+    m_multiDrawIndirectCount = nullptr;
+    const bool core46 = fmt.majorVersion() > 4 || (fmt.majorVersion() == 4 && fmt.minorVersion() >= 6);
+    if (core46)
+        m_multiDrawIndirectCount = reinterpret_cast<MultiDrawIndirectCountFn>(ctx->getProcAddress("glMultiDrawElementsIndirectCount"));
+    else if (ctx->hasExtension("GL_ARB_indirect_parameters"))
+        m_multiDrawIndirectCount = reinterpret_cast<MultiDrawIndirectCountFn>(ctx->getProcAddress("glMultiDrawElementsIndirectCountARB"));
+}
+
+void RenderingSystem::applyDepthConvention(bool reverseZ)
+{
+    if (!reverseZ) return; // GL defaults
+    m_clipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+    m_gl->glClearDepth(0.0);
+    m_gl->glDepthFunc(GL_GREATER);
+}
+
+void RenderingSystem::restoreDepthConvention(bool reverseZ)
+{
+    if (!reverseZ) return;
+    m_clipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+    m_gl->glClearDepth(1.0);
+    m_gl->glDepthFunc(GL_LESS);
+}
+
+GLuint RenderingSystem::ensureArrowPrimitive(QOpenGLContext* ctx)
+{
+    auto& primitives = m_contextPrimitives[ctx];
+    if (primitives.arrowVAO != 0) return primitives.arrowVAO;
+
+    if (m_sharedPrimitives.arrowVBO == 0) {
+        std::vector<Vertex> arrowVertices;
+        std::vector<unsigned int> arrowIndices;
+        createArrowPrimitive(arrowVertices, arrowIndices);
+        m_sharedPrimitives.arrowIndexCount = arrowIndices.size();
+        m_gl->glGenBuffers(1, &m_sharedPrimitives.arrowVBO);
+        m_gl->glGenBuffers(1, &m_sharedPrimitives.arrowEBO);
+        m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_sharedPrimitives.arrowVBO);
+        GpuMemory::bufferData(m_gl, GL_ARRAY_BUFFER, m_sharedPrimitives.arrowVBO, arrowVertices.size() * sizeof(Vertex),
+            arrowVertices.data(), GL_STATIC_DRAW, GpuMemory::Category::Other);
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, m_sharedPrimitives.arrowEBO);
+        GpuMemory::bufferData(m_gl, GL_COPY_WRITE_BUFFER, m_sharedPrimitives.arrowEBO, arrowIndices.size() * sizeof(unsigned int),
+            arrowIndices.data(), GL_STATIC_DRAW, GpuMemory::Category::Other);
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    m_gl->glGenVertexArrays(1, &primitives.arrowVAO);
+    m_state.bindVertexArray(primitives.arrowVAO);
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_sharedPrimitives.arrowVBO);
+    m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_sharedPrimitives.arrowEBO);
+    m_gl->glEnableVertexAttribArray(0);
+    m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    m_gl->glEnableVertexAttribArray(1);
+    m_gl->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    m_state.bindVertexArray(0);
+    return primitives.arrowVAO;
+}
+
+GLuint RenderingSystem::ensureTriadPrimitive(QOpenGLContext* ctx)
+{
+    auto& primitives = m_contextPrimitives[ctx];
+    if (primitives.triadVAO != 0) return primitives.triadVAO;
+
+    if (m_sharedPrimitives.triadVBO == 0) {
+        std::vector<Vertex> triadVertices;
+        std::vector<unsigned int> triadIndices;
+        createTriadPrimitive(triadVertices, triadIndices);
+        m_sharedPrimitives.triadIndexCount = triadIndices.size();
+        m_sharedPrimitives.triadAxisVertices = GLint(triadVertices.size() / 3);
+        m_gl->glGenBuffers(1, &m_sharedPrimitives.triadVBO);
+        m_gl->glGenBuffers(1, &m_sharedPrimitives.triadEBO);
+        m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_sharedPrimitives.triadVBO);
+        GpuMemory::bufferData(m_gl, GL_ARRAY_BUFFER, m_sharedPrimitives.triadVBO, triadVertices.size() * sizeof(Vertex),
+            triadVertices.data(), GL_STATIC_DRAW, GpuMemory::Category::Other);
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, m_sharedPrimitives.triadEBO);
+        GpuMemory::bufferData(m_gl, GL_COPY_WRITE_BUFFER, m_sharedPrimitives.triadEBO, triadIndices.size() * sizeof(unsigned int),
+            triadIndices.data(), GL_STATIC_DRAW, GpuMemory::Category::Other);
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    m_gl->glGenVertexArrays(1, &primitives.triadVAO);
+    m_state.bindVertexArray(primitives.triadVAO);
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_sharedPrimitives.triadVBO);
+    m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_sharedPrimitives.triadEBO);
+    m_gl->glEnableVertexAttribArray(0);
+    m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    m_gl->glEnableVertexAttribArray(1);
+    m_gl->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    m_state.bindVertexArray(0);
+    return primitives.triadVAO;
+}
+
+void RenderingSystem::simulateFieldVisualizers(entt::registry& registry)
+{
+    if (!m_gl) return;
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!ctx) return;
+
+    // Once per tick and registry, in whichever viewport draws first.
+    if (m_fieldSimTick == m_tick && m_fieldSimRegistry == &registry) {
+        // The buffers were written in another (shared) context: wait for them on the GPU.
+        if (m_fieldSimFence && m_fieldSimContext != ctx)
+            m_gl->glWaitSync(m_fieldSimFence, 0, GL_TIMEOUT_IGNORED);
+        return;
+    }
+    m_fieldSimTick = m_tick;
+    m_fieldSimRegistry = &registry;
+
+    // --- 1. EFFECTORS: gathered once per tick, uploaded only when they changed ---
+    m_effectorBuffers.setFunctions(m_gl);
+    m_effectorBuffers.update(registry);
+    m_effectorBuffers.bind();
+
+    ensureArrowPrimitive(ctx);   // the indirect commands need the arrow's index count
+
+    using Kernel = ComputeDispatch::Kernel;
+    ComputeDispatch::ContextQueries& computeQueries = m_contextPrimitives[ctx].computeQueries;
+    m_compute.setRecording(m_profiling);
+    m_compute.harvest(computeQueries);
+
+    m_gradientAtlas.used = 0;
+
+    // --- 2. COMPUTE FOR EACH VISUALIZER, into buffers every viewport draws from ---
+    auto visualizerView = registry.view<FieldVisualizerComponent, TransformComponent>();
+    for (auto entity : visualizerView)
+    {
+        auto& vis = visualizerView.get<FieldVisualizerComponent>(entity);
+        if (!vis.isEnabled) continue;
+        const auto& xf = visualizerView.get<const TransformComponent>(entity);
+        const bool streamlines = vis.displayMode == FieldVisualizerComponent::DisplayMode::Streamlines;
+        const bool adaptiveArrows = vis.displayMode == FieldVisualizerComponent::DisplayMode::Arrows && vis.arrowSettings.adaptive;
+        const bool volume = vis.displayMode == FieldVisualizerComponent::DisplayMode::Volume;
+        const bool volumeFromField = volume && !vis.volumeSettings.volume;
+        const bool temporal = vis.temporalSettings.enabled;
+        const bool baked = (vis.useBakedField || streamlines || adaptiveArrows || volumeFromField || temporal)
+            && (temporal ? ensureTemporalField(vis, xf.getTransform()) : ensureBakedField(vis, xf.getTransform()));
+        if (!streamlines && vis.gpuData.streamlinePointBuffer) releaseStreamlines(vis.gpuData);
+        if (!temporal && vis.gpuData.temporalTextures[0]) releaseTemporalField(vis.gpuData);
+
+        if (vis.displayMode == FieldVisualizerComponent::DisplayMode::Particles)
+        {
+            Shader* update = m_compute.select(Kernel::ParticleUpdate);
+            if (!update || !m_particleRenderShader || !m_particleEmitShader || !m_particleCullShader) continue;
+
+            auto& settings = vis.particleSettings;
+            const GLuint capacity = GLuint(std::max(settings.particleCount, 0));
+            const bool respawn = settings.emissionRate <= 0.0f;
+
+            if (vis.particleBuffer[0] == 0 || vis.isGpuDataDirty) {
+                if (vis.particleBuffer[0] != 0) {
+                    GpuMemory::deleteBuffers(m_gl, 2, vis.particleBuffer);
+                    m_state.invalidateBindings();
                 }
+                if (vis.particleListBuffer) GpuMemory::deleteBuffers(m_gl, 1, &vis.particleListBuffer);
                 std::vector<Particle> particles(settings.particleCount);
-                std::mt19937 rng(std::random_device{}());
+                std::mt19937 rng(m_randomSeed ^ std::uint32_t(entt::to_integral(entity)));
                 std::uniform_real_distribution<float> distrib(0.0f, 1.0f);
                 glm::vec3 boundsSize = vis.bounds.max - vis.bounds.min;
                 for (int i = 0; i < settings.particleCount; ++i) {
-                    particles[i].position = glm::vec4(vis.bounds.min + distrib(rng) * boundsSize, 1.0f);
-                    particles[i].velocity = glm::vec4(0.0f);
-                    particles[i].color = glm::vec4(1.0f); // Will be set by shader
-                    particles[i].age = distrib(rng) * settings.lifetime;
-                    particles[i].lifetime = settings.lifetime;
-                    particles[i].size = settings.baseSize;
+                    const glm::vec3 position = vis.bounds.min + distrib(rng) * boundsSize;
+                    particles[i] = makeParticle(position, glm::vec3(0.0f), glm::vec4(1.0f),   // colour set by shader
+                        distrib(rng) * settings.lifetime, settings.lifetime, settings.baseSize);
                 }
+                // Both halves start equal: the first frame interpolates between identical states.
                 m_gl->glGenBuffers(2, vis.particleBuffer);
-                m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, vis.particleBuffer[0]);
-                m_gl->glBufferData(GL_SHADER_STORAGE_BUFFER, particles.size() * sizeof(Particle), particles.data(), GL_DYNAMIC_DRAW);
-                m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, vis.particleBuffer[1]);
-                m_gl->glBufferData(GL_SHADER_STORAGE_BUFFER, particles.size() * sizeof(Particle), nullptr, GL_DYNAMIC_DRAW);
-                m_gl->glGenVertexArrays(1, &vis.particleVAO);
-            }
+                for (GLuint buffer : vis.particleBuffer) {
+                    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+                    GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, buffer, particles.size() * sizeof(Particle),
+                        particles.data(), GL_DYNAMIC_DRAW, GpuMemory::Category::Particles);
+                    RenderStats::upload(particles.size() * sizeof(Particle));
+                }
 
-            m_particleUpdateComputeShader->use();
-            m_gl->glBindBufferBase(GL_UNIFORM_BUFFER, 3, m_effectorDataUBO);
-            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_triangleDataSSBO);
-            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, vis.particleBuffer[vis.currentReadBuffer]);
-            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, vis.particleBuffer[1 - vis.currentReadBuffer]);
-            m_particleUpdateComputeShader->setMat4("u_visualizerModelMatrix", xf.getTransform());
-            m_particleUpdateComputeShader->setFloat("u_deltaTime", deltaTime);
-            m_particleUpdateComputeShader->setFloat("u_time", m_elapsedTime);
-            m_particleUpdateComputeShader->setVec3("u_boundsMin", vis.bounds.min);
-            m_particleUpdateComputeShader->setVec3("u_boundsMax", vis.bounds.max);
-            m_particleUpdateComputeShader->setInt("u_pointEffectorCount", static_cast<int>(pointEffectors.size()));
-            m_particleUpdateComputeShader->setInt("u_directionalEffectorCount", static_cast<int>(directionalEffectors.size()));
-            m_particleUpdateComputeShader->setInt("u_triangleEffectorCount", static_cast<int>(triangleEffectors.size()));
-
-            m_gl->glDispatchCompute(settings.particleCount / 256 + 1, 1, 1);
-            m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                // Respawning, every particle starts in the read half's alive list;
+                // emitting, all start dead and the emission rate brings them in.
+                ParticleListHeaderGpu header{};
+                const GLuint alive = respawn ? capacity : 0;
+                header.deadCount = capacity - alive;
+                header.aliveCount[vis.currentReadBuffer] = alive;
+                header.cullGroups[0] = (alive + kParticleCullGroupSize - 1) / kParticleCullGroupSize;
+                header.cullGroups[1] = header.cullGroups[2] = 1;
+                std::vector<GLuint> indices(capacity);
+                std::iota(indices.begin(), indices.end(), 0u);
+                const GLintptr listBytes = GLintptr(capacity * sizeof(GLuint));
+                const GLintptr firstList = sizeof(header) + (respawn ? GLintptr(vis.currentReadBuffer) * listBytes : 2 * listBytes);
+                m_gl->glGenBuffers(1, &vis.particleListBuffer);
+                m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, vis.particleListBuffer);
+                GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, vis.particleListBuffer, sizeof(header) + 3 * listBytes,
+                    nullptr, GL_DYNAMIC_DRAW, GpuMemory::Category::Particles);
+                m_gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), &header);
+                m_gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, firstList, listBytes, indices.data());
+                RenderStats::upload(sizeof(header) + std::uint64_t(listBytes));
+                vis.pendingEmission = 0.0f;
+                vis.simulatedStep = m_simStep;
+            }
 
-            m_gl->glEnable(GL_PROGRAM_POINT_SIZE);
-            m_gl->glEnable(GL_BLEND);
-            m_gl->glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-            m_gl->glDepthMask(GL_FALSE);
-            m_particleRenderShader->use();
-            m_particleRenderShader->setMat4("u_view", view);
-            m_particleRenderShader->setMat4("u_projection", projection);
-            m_gl->glBindVertexArray(vis.particleVAO);
-            m_gl->glBindBuffer(GL_ARRAY_BUFFER, vis.particleBuffer[1 - vis.currentReadBuffer]);
-            m_gl->glEnableVertexAttribArray(0);
-            m_gl->glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, position));
-            m_gl->glEnableVertexAttribArray(1);
-            m_gl->glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, color));
-            m_gl->glEnableVertexAttribArray(2);
-            m_gl->glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, size));
-            m_gl->glDrawArrays(GL_POINTS, 0, settings.particleCount);
-            m_gl->glBindVertexArray(0);
-            m_gl->glDepthMask(GL_TRUE);
-            m_gl->glDisable(GL_BLEND);
-            m_gl->glDisable(GL_PROGRAM_POINT_SIZE);
-            vis.currentReadBuffer = 1 - vis.currentReadBuffer;
+            // Per simulation step since the last tick: the emit pass refills the
+            // alive list and sizes the update, which then runs over the alive
+            // particles only and sorts them into the next alive list or the dead one.
+            const int steps = pendingSimSteps(vis);
+            if (steps > 0) {
+                m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kParticleListBinding, vis.particleListBuffer);
+                m_gl->glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, vis.particleListBuffer);
+
+                m_state.use(*m_particleEmitShader);
+                m_particleEmitShader->setUInt("u_capacity", capacity);
+                m_particleEmitShader->setUInt("u_updateLocalSize", m_compute.localSize(Kernel::ParticleUpdate));
+                m_particleEmitShader->setUInt("u_cullLocalSize", kParticleCullGroupSize);
+                m_particleEmitShader->setMat4("u_visualizerModelMatrix", xf.getTransform());
+                m_particleEmitShader->setVec3("u_boundsMin", vis.bounds.min);
+                m_particleEmitShader->setVec3("u_boundsMax", vis.bounds.max);
+                m_particleEmitShader->setFloat("u_lifetime", settings.lifetime);
+                m_particleEmitShader->setFloat("u_size", settings.baseSize);
+                m_particleEmitShader->setUInt("u_rngSeed", m_randomSeed);
+
+                m_state.use(*update);
+                bindFieldSource(*update, vis, xf.getTransform(), baked);
+                update->setMat4("u_visualizerModelMatrix", xf.getTransform());
+                update->setFloat("u_deltaTime", m_simStepSize);
+                update->setVec3("u_boundsMin", vis.bounds.min);
+                update->setVec3("u_boundsMax", vis.bounds.max);
+                update->setUInt("u_capacity", capacity);
+                update->setBool("u_respawn", respawn);
+                update->setUInt("u_rngSeed", m_randomSeed);
+                // Empty gradients bake white: colours stay as emitted.
+                const bool intensity = settings.coloringMode == FieldVisualizerComponent::ColoringMode::Intensity;
+                update->setUInt("u_intensityGradientRow", gradientRow(intensity ? settings.intensityGradient : std::vector<ColorStop>()));
+                update->setUInt("u_lifetimeGradientRow", gradientRow(settings.lifetimeGradient));
+                bindGradientAtlas(*update);
+            }
+            for (int s = steps - 1; s >= 0; --s) {
+                const GLuint step = GLuint(m_simStep - std::uint64_t(s));
+                // Respawning, anything left dead (an emission rate just set to 0) comes back at once.
+                GLuint emitCount = capacity;
+                if (!respawn) {
+                    vis.pendingEmission = std::min(vis.pendingEmission + settings.emissionRate * m_simStepSize, float(capacity));
+                    emitCount = GLuint(vis.pendingEmission);
+                    vis.pendingEmission -= float(emitCount);
+                }
+                m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, vis.particleBuffer[vis.currentReadBuffer]);
+                m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, vis.particleBuffer[1 - vis.currentReadBuffer]);
+
+                m_state.use(*m_particleEmitShader);
+                m_particleEmitShader->setUInt("u_readHalf", GLuint(vis.currentReadBuffer));
+                m_particleEmitShader->setUInt("u_emitCount", emitCount);
+                m_particleEmitShader->setUInt("u_rngStep", step);
+                m_gl->glDispatchCompute(1, 1, 1);
+                RenderStats::dispatch();
+                m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+                m_state.use(*update);
+                update->setUInt("u_readHalf", GLuint(vis.currentReadBuffer));
+                update->setUInt("u_rngStep", step);
+                m_compute.dispatchIndirect(computeQueries, Kernel::ParticleUpdate,
+                    offsetof(ParticleListHeaderGpu, updateGroups), capacity);
+                m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                vis.currentReadBuffer = 1 - vis.currentReadBuffer;
+            }
         }
         else if (vis.displayMode == FieldVisualizerComponent::DisplayMode::Flow)
         {
-            if (!m_flowVectorComputeShader || !m_instancedArrowShader) continue;
+            Shader* flow = m_compute.select(Kernel::FlowUpdate);
+            if (!flow || !m_instancedArrowShader) continue;
 
             auto& settings = vis.flowSettings;
 
             if (vis.particleBuffer[0] == 0 || vis.isGpuDataDirty) {
                 if (vis.particleBuffer[0] != 0) {
-                    m_gl->glDeleteBuffers(2, vis.particleBuffer);
-                    if (vis.gpuData.instanceDataSSBO) m_gl->glDeleteBuffers(1, &vis.gpuData.instanceDataSSBO);
+                    GpuMemory::deleteBuffers(m_gl, 2, vis.particleBuffer);
+                    if (vis.gpuData.instanceDataSSBO) GpuMemory::deleteBuffers(m_gl, 1, &vis.gpuData.instanceDataSSBO);
+                    vis.gpuData.instanceDataSSBO = 0;
+                    vis.gpuData.instanceCapacity = 0;
                 }
+                if (vis.particleListBuffer) GpuMemory::deleteBuffers(m_gl, 1, &vis.particleListBuffer);
+                vis.particleListBuffer = 0;
+                if (vis.gpuData.commandUBO) GpuMemory::deleteBuffers(m_gl, 1, &vis.gpuData.commandUBO);
                 std::vector<Particle> particles(settings.particleCount);
-                std::mt19937 rng(std::random_device{}());
+                std::mt19937 rng(m_randomSeed ^ std::uint32_t(entt::to_integral(entity)));
                 std::uniform_real_distribution<float> distrib(0.0f, 1.0f);
                 glm::vec3 boundsCenter = (vis.bounds.min + vis.bounds.max) / 2.0f;
                 glm::vec3 boundsHalfSize = (vis.bounds.max - vis.bounds.min) / 2.0f;
 
                 for (int i = 0; i < settings.particleCount; ++i) {
                     // TODO: Implement different spawn distributions
-                    particles[i].position = glm::vec4(vis.bounds.min + distrib(rng) * boundsHalfSize * 2.0f, 1.0f);
-                    particles[i].velocity = glm::vec4(0.0f);
-                    particles[i].color = glm::vec4(1.0f); // Default color
-                    particles[i].age = distrib(rng) * settings.lifetime;
-                    particles[i].lifetime = settings.lifetime;
-                    particles[i].size = settings.baseSize;
+                    const glm::vec3 position = vis.bounds.min + distrib(rng) * boundsHalfSize * 2.0f;
+                    particles[i] = makeParticle(position, glm::vec3(0.0f), glm::vec4(1.0f),
+                        distrib(rng) * settings.lifetime, settings.lifetime, settings.baseSize);
                 }
                 m_gl->glGenBuffers(2, vis.particleBuffer);
                 m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, vis.particleBuffer[0]);
-                m_gl->glBufferData(GL_SHADER_STORAGE_BUFFER, particles.size() * sizeof(Particle), particles.data(), GL_DYNAMIC_DRAW);
+                GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, vis.particleBuffer[0], particles.size() * sizeof(Particle),
+                    particles.data(), GL_DYNAMIC_DRAW, GpuMemory::Category::Particles);
+                RenderStats::upload(particles.size() * sizeof(Particle));
                 m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, vis.particleBuffer[1]);
-                m_gl->glBufferData(GL_SHADER_STORAGE_BUFFER, particles.size() * sizeof(Particle), nullptr, GL_DYNAMIC_DRAW);
+                GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, vis.particleBuffer[1], particles.size() * sizeof(Particle),
+                    nullptr, GL_DYNAMIC_DRAW, GpuMemory::Category::Particles);
 
                 if (vis.gpuData.instanceDataSSBO == 0) m_gl->glGenBuffers(1, &vis.gpuData.instanceDataSSBO);
                 m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, vis.gpuData.instanceDataSSBO);
-                m_gl->glBufferData(GL_SHADER_STORAGE_BUFFER, settings.particleCount * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+                GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, vis.gpuData.instanceDataSSBO, settings.particleCount * sizeof(InstanceData),
+                    nullptr, GL_DYNAMIC_DRAW, GpuMemory::Category::Particles);
+                vis.gpuData.instanceCapacity = std::size_t(settings.particleCount);
+
+                // Only the arrows the step leaves visible are appended and drawn.
+                const DrawElementsIndirectCommand cmd = { GLuint(m_sharedPrimitives.arrowIndexCount), 0, 0, 0, 0 };
+                m_gl->glGenBuffers(1, &vis.gpuData.commandUBO);
+                m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, vis.gpuData.commandUBO);
+                GpuMemory::bufferData(m_gl, GL_DRAW_INDIRECT_BUFFER, vis.gpuData.commandUBO, sizeof(cmd), &cmd, GL_DYNAMIC_DRAW,
+                    GpuMemory::Category::Particles);
+                vis.simulatedStep = m_simStep - 1;   // one step fills the instance buffer
             }
 
-            m_flowVectorComputeShader->use();
-            m_gl->glBindBufferBase(GL_UNIFORM_BUFFER, 3, m_effectorDataUBO);
-            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_triangleDataSSBO);
-            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, vis.particleBuffer[vis.currentReadBuffer]);
-            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, vis.particleBuffer[1 - vis.currentReadBuffer]);
-            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, vis.gpuData.instanceDataSSBO);
-
-            m_flowVectorComputeShader->setMat4("u_visualizerModelMatrix", xf.getTransform());
-            m_flowVectorComputeShader->setFloat("u_deltaTime", deltaTime);
-            m_flowVectorComputeShader->setFloat("u_time", m_elapsedTime);
-            m_flowVectorComputeShader->setVec3("u_boundsMin", vis.bounds.min);
-            m_flowVectorComputeShader->setVec3("u_boundsMax", vis.bounds.max);
-            m_flowVectorComputeShader->setFloat("u_baseSpeed", settings.baseSpeed);
-            m_flowVectorComputeShader->setFloat("u_velocityMultiplier", settings.speedIntensityMultiplier);
-            m_flowVectorComputeShader->setFloat("u_flowScale", settings.baseSize);
-            m_flowVectorComputeShader->setFloat("u_fadeInPercent", settings.growthPercentage);
-            m_flowVectorComputeShader->setFloat("u_fadeOutPercent", settings.shrinkPercentage);
-            // TODO: Pass gradient data to shader
-            m_flowVectorComputeShader->setInt("u_pointEffectorCount", static_cast<int>(pointEffectors.size()));
-            m_flowVectorComputeShader->setInt("u_directionalEffectorCount", static_cast<int>(directionalEffectors.size()));
-            m_flowVectorComputeShader->setInt("u_triangleEffectorCount", static_cast<int>(triangleEffectors.size()));
-            m_flowVectorComputeShader->setFloat("u_seedOffset", static_cast<float>(rand()) / RAND_MAX);
-
-            m_gl->glDispatchCompute(settings.particleCount / 256 + 1, 1, 1);
-            m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-
-            m_instancedArrowShader->use();
-            m_instancedArrowShader->setMat4("view", view);
-            m_instancedArrowShader->setMat4("projection", projection);
-
-            m_gl->glBindVertexArray(arrowPrimitives.arrowVAO);
-            m_gl->glBindBuffer(GL_ARRAY_BUFFER, vis.gpuData.instanceDataSSBO);
-
-            GLsizei vec4Size = sizeof(glm::vec4);
-            m_gl->glEnableVertexAttribArray(2); m_gl->glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(InstanceData, modelMatrix));
-            m_gl->glEnableVertexAttribArray(3); m_gl->glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceData, modelMatrix) + vec4Size));
-            m_gl->glEnableVertexAttribArray(4); m_gl->glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceData, modelMatrix) + 2 * vec4Size));
-            m_gl->glEnableVertexAttribArray(5); m_gl->glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceData, modelMatrix) + 3 * vec4Size));
-            m_gl->glEnableVertexAttribArray(6); m_gl->glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceData, color)));
-            m_gl->glVertexAttribDivisor(2, 1); m_gl->glVertexAttribDivisor(3, 1); m_gl->glVertexAttribDivisor(4, 1); m_gl->glVertexAttribDivisor(5, 1); m_gl->glVertexAttribDivisor(6, 1);
-
-            m_gl->glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(arrowPrimitives.arrowIndexCount), GL_UNSIGNED_INT, 0, settings.particleCount);
-
-            m_gl->glBindVertexArray(0);
-            vis.currentReadBuffer = 1 - vis.currentReadBuffer;
+            // Advected like the particles: per simulation step, not per viewport.
+            // The instance buffer holds the latest step's arrows.
+            const int steps = pendingSimSteps(vis);
+            if (steps > 0) {
+                m_state.use(*flow);
+                bindFieldSource(*flow, vis, xf.getTransform(), baked);
+                m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, vis.gpuData.instanceDataSSBO);
+                m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, vis.gpuData.commandUBO);
+                m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, vis.gpuData.commandUBO);
+
+                flow->setMat4("u_visualizerModelMatrix", xf.getTransform());
+                flow->setFloat("u_deltaTime", m_simStepSize);
+                flow->setVec3("u_boundsMin", vis.bounds.min);
+                flow->setVec3("u_boundsMax", vis.bounds.max);
+                flow->setFloat("u_baseSpeed", settings.baseSpeed);
+                flow->setFloat("u_velocityMultiplier", settings.speedIntensityMultiplier);
+                flow->setFloat("u_flowScale", settings.baseSize);
+                flow->setFloat("u_fadeInPercent", settings.growthPercentage);
+                flow->setFloat("u_fadeOutPercent", settings.shrinkPercentage);
+                flow->setUInt("u_rngSeed", m_randomSeed);
+                // TODO: Pass gradient data to shader
+            }
+            for (int s = steps - 1; s >= 0; --s) {
+                const std::uint64_t step = m_simStep - std::uint64_t(s);
+                m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, vis.particleBuffer[vis.currentReadBuffer]);
+                m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, vis.particleBuffer[1 - vis.currentReadBuffer]);
+                // Keyed on the step, so a replay respawns the same arrows.
+                flow->setUInt("u_rngStep", GLuint(step));
+                const GLuint zero = 0;
+                m_gl->glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offsetof(DrawElementsIndirectCommand, instanceCount),
+                    sizeof(GLuint), &zero);
+                RenderStats::upload(sizeof(GLuint));
+                m_compute.dispatch(computeQueries, Kernel::FlowUpdate, GLuint(settings.particleCount));
+                m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+                    | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+                vis.currentReadBuffer = 1 - vis.currentReadBuffer;
+            }
         }
-        if (vis.displayMode == FieldVisualizerComponent::DisplayMode::Arrows)
+        else if (vis.displayMode == FieldVisualizerComponent::DisplayMode::Arrows)
         {
-            if (!m_arrowFieldComputeShader || !m_instancedArrowShader) {
+            Shader* arrows = m_compute.select(Kernel::FieldArrows);
+            if (!arrows || !m_instancedArrowShader) {
                 qWarning() << "[FieldViz] Arrow render skipped: Shaders not loaded.";
                 continue;
             }
@@ -1135,16 +3010,21 @@ void RenderingSystem::renderFieldVisualizers(entt::registry& registry, const glm
             auto& settings = vis.arrowSettings;
 
             if (vis.isGpuDataDirty) {
-                qDebug() << "[FieldViz] isGpuDataDirty is true. Recreating arrow buffers with density:" << settings.density.x << "x" << settings.density.y << "x" << settings.density.z;
+                KR_TRACE(FieldViz) << "[FieldViz] isGpuDataDirty is true. Recreating arrow buffers with density:" << settings.density.x << "x" << settings.density.y << "x" << settings.density.z;
+
+                if (vis.gpuData.samplePointsSSBO) GpuMemory::deleteBuffers(m_gl, 1, &vis.gpuData.samplePointsSSBO);
+                vis.gpuData.samplePointsSSBO = 0;
+                releaseAdaptiveArrows(vis.gpuData);
 
-                if (vis.gpuData.samplePointsSSBO) m_gl->glDeleteBuffers(1, &vis.gpuData.samplePointsSSBO);
-                if (vis.gpuData.instanceDataSSBO) m_gl->glDeleteBuffers(1, &vis.gpuData.instanceDataSSBO);
-                if (vis.gpuData.commandUBO) m_gl->glDeleteBuffers(1, &vis.gpuData.commandUBO);
+                // Adaptive sampling refines from the baked field; without one the grid stays uniform.
+                const bool adaptive = settings.adaptive && baked;
+                const int coarseCount = settings.density.x * settings.density.y * settings.density.z;
+                int levels = adaptive ? std::clamp(settings.refineLevels, 0, 6) : 0;
+                while (levels > 0 && (std::size_t(coarseCount) << (3 * levels)) > kMaxAdaptiveArrowSamples) --levels;
 
-                std::vector<glm::vec4> samplePoints;
-                vis.gpuData.numSamplePoints = settings.density.x * settings.density.y * settings.density.z;
+                vis.gpuData.numSamplePoints = coarseCount << (3 * levels);
 
-                qDebug() << "[FieldViz] Calculated numSamplePoints:" << vis.gpuData.numSamplePoints;
+                KR_TRACE(FieldViz) << "[FieldViz] Calculated numSamplePoints:" << vis.gpuData.numSamplePoints;
                 /*
                 if (glm::length2(vis.bounds.max - vis.bounds.min) < 1e-6f) {
                     vis.bounds.min = glm::vec3(-5.0f);
@@ -1156,115 +3036,237 @@ void RenderingSystem::renderFieldVisualizers(entt::registry& registry, const glm
                     qWarning() << "[FieldViz] Arrow density is zero, skipping buffer creation.";
                 }
                 else {
-                    samplePoints.reserve(vis.gpuData.numSamplePoints);
-                    glm::vec3 boundsSize = vis.bounds.max - vis.bounds.min;
-                    for (int x = 0; x < settings.density.x; ++x) {
-                        for (int y = 0; y < settings.density.y; ++y) {
-                            for (int z = 0; z < settings.density.z; ++z) {
-                                glm::vec3 t = {
-                                    (settings.density.x > 1) ? static_cast<float>(x) / (settings.density.x - 1) : 0.5f,
-                                    (settings.density.y > 1) ? static_cast<float>(y) / (settings.density.y - 1) : 0.5f,
-                                    (settings.density.z > 1) ? static_cast<float>(z) / (settings.density.z - 1) : 0.5f,
-                                };
-                                samplePoints.emplace_back(glm::vec4(vis.bounds.min + t * boundsSize, 1.0f));
-                            }
-                        }
+                    // Uniform: the kernel derives each grid position from its
+                    // invocation index, no sample list. Adaptive: the refinement
+                    // derives the coarse cells the same way and fills one.
+                    if (adaptive) {
+                        const glm::uvec4 header(0u);
+                        m_gl->glGenBuffers(1, &vis.gpuData.samplePointsSSBO);
+                        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, vis.gpuData.samplePointsSSBO);
+                        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, vis.gpuData.samplePointsSSBO,
+                            sizeof(header) + std::size_t(vis.gpuData.numSamplePoints) * sizeof(glm::vec4), nullptr,
+                            GL_DYNAMIC_DRAW, GpuMemory::Category::FieldVisualizers);
+                        m_gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), &header);
+                        RenderStats::upload(sizeof(header));
+                        createAdaptiveArrows(vis, coarseCount, levels);
                     }
-                    m_gl->glGenBuffers(1, &vis.gpuData.samplePointsSSBO);
-                    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, vis.gpuData.samplePointsSSBO);
-                    m_gl->glBufferData(GL_SHADER_STORAGE_BUFFER, samplePoints.size() * sizeof(glm::vec4), samplePoints.data(), GL_STATIC_DRAW);
-
-                    m_gl->glGenBuffers(1, &vis.gpuData.instanceDataSSBO);
-                    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, vis.gpuData.instanceDataSSBO);
-                    m_gl->glBufferData(GL_SHADER_STORAGE_BUFFER, vis.gpuData.numSamplePoints * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
-
-                    struct DrawElementsIndirectCommand { GLuint count; GLuint instanceCount; GLuint firstIndex; GLuint baseVertex; GLuint baseInstance; };
-                    DrawElementsIndirectCommand cmd = { (GLuint)arrowPrimitives.arrowIndexCount, 0, 0, 0, 0 };
-                    m_gl->glGenBuffers(1, &vis.gpuData.commandUBO);
-                    m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, vis.gpuData.commandUBO);
-                    m_gl->glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(cmd), &cmd, GL_DYNAMIC_DRAW);
                 }
             }
 
+            vis.gpuData.arrowBatched = false;
             if (vis.gpuData.numSamplePoints == 0) continue;
 
-            qDebug() << "[FieldViz] Dispatching compute shader for arrows. Scale:" << settings.vectorScale
-                << "Head Scale:" << settings.headScale << "Cull Thresh:" << settings.cullingThreshold;
+            const bool adaptive = vis.gpuData.adaptiveCounterBuffer != 0;
+            if (!adaptive && !baked && !m_fieldReadbackDebug) {
+                // Joins the batch dispatched after the loop; baked textures and
+                // sample lists are per visualizer and keep their own dispatch.
+                ArrowBatchEntryGpu entry{};
+                entry.model = xf.getTransform();
+                entry.boundsMin = glm::vec4(vis.bounds.min, settings.vectorScale);
+                entry.boundsMax = glm::vec4(vis.bounds.max, settings.headScale);
+                entry.density = glm::vec4(glm::vec3(settings.density), settings.cullingThreshold);
+                entry.firstSample = m_arrowBatch.sampleCount;
+                entry.firstInstance = m_arrowBatch.sampleCount;
+                entry.gradientRow = gradientRow(arrowGradient(settings));
+                m_arrowBatch.entries.push_back(entry);
+                m_arrowBatch.commands.push_back({ GLuint(m_sharedPrimitives.arrowIndexCount), 0, 0, 0, entry.firstInstance });
+                m_arrowBatch.sampleCount += GLuint(vis.gpuData.numSamplePoints);
+                vis.gpuData.arrowBatched = true;
+                vis.isGpuDataDirty = false;
+                continue;
+            }
+            ensureArrowBuffers(vis.gpuData);
+            if (adaptive && baked) refineArrowSamples(vis);
+
+            KR_TRACE(FieldViz) << "[FieldViz] Dispatching compute shader for arrows. Scale:" << settings.vectorScale
+                << "Head Scale:" << settings.headScale << "Cull Thresh:" << settings.cullingThreshold;
+
+            m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, vis.gpuData.commandUBO);
+            GLuint zero = 0;
+            // The instanceCount is the second integer in the struct, so its offset is sizeof(GLuint).
+            m_gl->glBufferSubData(GL_DRAW_INDIRECT_BUFFER, sizeof(GLuint), sizeof(GLuint), &zero);
+            RenderStats::upload(sizeof(GLuint));
+
+            m_state.use(*arrows);
+            bindFieldSource(*arrows, vis, xf.getTransform(), baked);
+            if (adaptive) m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, vis.gpuData.samplePointsSSBO);
+            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, vis.gpuData.instanceDataSSBO);
+            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, vis.gpuData.commandUBO);
+            arrows->setBool("u_gridSamples", !adaptive);
+            arrows->setVec3("u_gridDensity", glm::vec3(settings.density));
+            arrows->setVec3("u_boundsMin", vis.bounds.min);
+            arrows->setVec3("u_boundsMax", vis.bounds.max);
+            arrows->setMat4("u_visualizerModelMatrix", xf.getTransform());
+            arrows->setFloat("u_vectorScale", settings.vectorScale);
+            arrows->setFloat("u_arrowHeadScale", settings.headScale);
+            arrows->setFloat("u_cullingThreshold", settings.cullingThreshold);
+            arrows->setUInt("u_gradientRow", gradientRow(arrowGradient(settings)));
+            bindGradientAtlas(*arrows);
+
+            if (adaptive) {
+                // The refinement wrote one dispatch per workgroup size: take the selected variant's.
+                const auto& sizes = ComputeDispatch::kLocalSizes;
+                const std::size_t variant = std::size_t(std::find(sizes.begin(), sizes.end(),
+                    m_compute.localSize(Kernel::FieldArrows)) - sizes.begin());
+                m_gl->glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, vis.gpuData.adaptiveCounterBuffer);
+                m_compute.dispatchIndirect(computeQueries, Kernel::FieldArrows,
+                    GLintptr(offsetof(AdaptiveArrowCountersGpu, arrowGroups) + variant * sizeof(GLuint[3])),
+                    GLuint(vis.gpuData.numSamplePoints));
+            }
+            else {
+                m_compute.dispatch(computeQueries, Kernel::FieldArrows, GLuint(vis.gpuData.numSamplePoints));
+            }
+            m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+            if (m_fieldReadbackDebug)
+                readBackArrowField(vis.gpuData);
+        }
+        else if (streamlines)
+        {
+            // Traced through the baked field only: without one there is nothing to follow.
+            if (baked) traceStreamlines(vis, xf.getTransform());
+        }
+        else if (volume)
+        {
+            ensureScalarVolume(vis);
+            vis.gpuData.volumeGradientRow = int(gradientRow(vis.volumeSettings.gradient));
+        }
+        vis.isGpuDataDirty = false; // Reset dirty flag after processing
+    }
+    dispatchArrowBatch(computeQueries);
+    m_effectorBuffers.fenceInFlight();
+
+    // Other viewports' contexts wait on this before drawing the results.
+    if (m_fieldSimFence) m_gl->glDeleteSync(m_fieldSimFence);
+    m_fieldSimFence = m_gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_fieldSimContext = ctx;
+    m_gl->glFlush();
+}
+
+void RenderingSystem::renderFieldVisualizers(entt::registry& registry, const glm::mat4& view, const glm::mat4& projection)
+{
+    if (!m_gl) {
+        qWarning() << "[FieldViz] Render call skipped: m_gl is null.";
+        return;
+    }
+
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!ctx) {
+        qWarning() << "[FieldViz] Render call skipped: No active OpenGL context.";
+        return;
+    }
+
+    // Draw only: simulateFieldVisualizers() filled the buffers for this tick.
+    const GLuint arrowVAO = ensureArrowPrimitive(ctx);
+    auto& primitives = m_contextPrimitives[ctx];   // the same entry, already present
+
+    auto visualizerView = registry.view<FieldVisualizerComponent>();
+    for (auto entity : visualizerView)
+    {
+        auto& vis = visualizerView.get<FieldVisualizerComponent>(entity);
+        if (!vis.isEnabled) continue;
+
+        if (vis.displayMode == FieldVisualizerComponent::DisplayMode::Particles)
+        {
+            if (!m_particleRenderShader || !m_particleCullShader || vis.particleBuffer[0] == 0 || vis.particleListBuffer == 0)
+                continue;
+            const GLuint capacity = GLuint(std::max(vis.particleSettings.particleCount, 0));
+
+            // This view's alive, in-frustum particles, appended by the cull behind a zeroed draw command.
+            const GLsizeiptr drawBytes = GLsizeiptr(sizeof(DrawArraysIndirectCommand) + capacity * sizeof(ParticleVertexGpu));
+            if (primitives.particleDrawBuffer == 0) m_gl->glGenBuffers(1, &primitives.particleDrawBuffer);
+            m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, primitives.particleDrawBuffer);
+            if (drawBytes > primitives.particleDrawCapacity) {
+                primitives.particleDrawCapacity = std::max<GLsizeiptr>(drawBytes, primitives.particleDrawCapacity * 2);
+                GpuMemory::bufferData(m_gl, GL_DRAW_INDIRECT_BUFFER, primitives.particleDrawBuffer, primitives.particleDrawCapacity,
+                    nullptr, GL_DYNAMIC_DRAW, GpuMemory::Category::Particles);
+                if (primitives.particleSortBuffer) GpuMemory::deleteBuffers(m_gl, 1, &primitives.particleSortBuffer);
+                primitives.particleSortBuffer = 0;   // regrown with the draw buffer on the next sort
+            }
+            const DrawArraysIndirectCommand reset = { 0, 1, 0, 0 };
+            m_gl->glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(reset), &reset);
+            RenderStats::upload(sizeof(reset));
+
+            // Latest state in the read buffer, the step before it in the other.
+            m_state.use(*m_particleCullShader);
+            m_particleCullShader->setUInt("u_capacity", capacity);
+            m_particleCullShader->setUInt("u_readHalf", GLuint(vis.currentReadBuffer));
+            m_particleCullShader->setFloat("u_interpolation", m_simAlpha);
+            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, vis.particleBuffer[vis.currentReadBuffer]);
+            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, vis.particleBuffer[1 - vis.currentReadBuffer]);
+            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kParticleListBinding, vis.particleListBuffer);
+            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kParticleDrawBinding, primitives.particleDrawBuffer);
+            m_gl->glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, vis.particleListBuffer);
+            m_gl->glDispatchComputeIndirect(offsetof(ParticleListHeaderGpu, cullGroups));
+            RenderStats::dispatch();
+            m_gl->glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+            // Solid particles blend over each other and need back-to-front
+            // order; glow particles add up, in any order.
+            const bool solid = vis.particleSettings.isSolid;
+            if (solid) sortParticlesByDepth(primitives, capacity);
+
+            if (primitives.particleVAO == 0) m_gl->glGenVertexArrays(1, &primitives.particleVAO);
+            m_state.bindVertexArray(primitives.particleVAO);
+            m_gl->glBindBuffer(GL_ARRAY_BUFFER, primitives.particleDrawBuffer);
+            m_gl->glEnableVertexAttribArray(0);
+            m_gl->glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleVertexGpu),
+                (void*)(sizeof(DrawArraysIndirectCommand) + offsetof(ParticleVertexGpu, positionSize)));
+            m_gl->glEnableVertexAttribArray(1);
+            m_gl->glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleVertexGpu),
+                (void*)(sizeof(DrawArraysIndirectCommand) + offsetof(ParticleVertexGpu, color)));
+
+            m_gl->glEnable(GL_PROGRAM_POINT_SIZE);
+            m_state.setBlend(true);
+            m_state.setBlendFunc(GL_SRC_ALPHA, solid ? GL_ONE_MINUS_SRC_ALPHA : GL_ONE);
+            m_state.setDepthMask(false);
+            m_state.use(*m_particleRenderShader);
+            m_gl->glDrawArraysIndirect(GL_POINTS, nullptr);
+            RenderStats::draw();
+            // The next visualizer or view rezeroes the command with glBufferSubData.
+            m_gl->glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+            m_state.bindVertexArray(0);
+            m_state.setDepthMask(true);
+            m_state.setBlend(false);
+            m_gl->glDisable(GL_PROGRAM_POINT_SIZE);
+        }
+        else if (vis.displayMode == FieldVisualizerComponent::DisplayMode::Flow)
+        {
+            if (!m_instancedArrowShader || vis.gpuData.instanceDataSSBO == 0 || vis.gpuData.commandUBO == 0) continue;
+
+            m_state.use(*m_instancedArrowShader);
+            m_instancedArrowShader->setMat4("view", view);
+            m_instancedArrowShader->setMat4("projection", projection);
 
-            m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, vis.gpuData.commandUBO);
-            GLuint zero = 0;
-            // The instanceCount is the second integer in the struct, so its offset is sizeof(GLuint).
-            m_gl->glBufferSubData(GL_DRAW_INDIRECT_BUFFER, sizeof(GLuint), sizeof(GLuint), &zero);
+            m_state.bindVertexArray(arrowVAO);
+            m_gl->glBindBuffer(GL_ARRAY_BUFFER, vis.gpuData.instanceDataSSBO);
 
-            m_arrowFieldComputeShader->use();
-            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, vis.gpuData.samplePointsSSBO);
-            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, vis.gpuData.instanceDataSSBO);
-            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, vis.gpuData.commandUBO);
-            m_gl->glBindBufferBase(GL_UNIFORM_BUFFER, 3, m_effectorDataUBO);
-            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_triangleDataSSBO);
-            m_arrowFieldComputeShader->setMat4("u_visualizerModelMatrix", xf.getTransform());
-            m_arrowFieldComputeShader->setFloat("u_vectorScale", settings.vectorScale);
-            m_arrowFieldComputeShader->setFloat("u_arrowHeadScale", settings.headScale);
-            m_arrowFieldComputeShader->setFloat("u_cullingThreshold", settings.cullingThreshold);
-            m_arrowFieldComputeShader->setInt("u_pointEffectorCount", static_cast<int>(pointEffectors.size()));
-            m_arrowFieldComputeShader->setInt("u_directionalEffectorCount", static_cast<int>(directionalEffectors.size()));
-            m_arrowFieldComputeShader->setInt("u_triangleEffectorCount", static_cast<int>(triangleEffectors.size()));
-
-            m_gl->glDispatchCompute((GLuint)vis.gpuData.numSamplePoints / 256 + 1, 1, 1);
-            m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+            GLsizei vec4Size = sizeof(glm::vec4);
+            m_gl->glEnableVertexAttribArray(2); m_gl->glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(InstanceData, modelMatrix));
+            m_gl->glEnableVertexAttribArray(3); m_gl->glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceData, modelMatrix) + vec4Size));
+            m_gl->glEnableVertexAttribArray(4); m_gl->glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceData, modelMatrix) + 2 * vec4Size));
+            m_gl->glEnableVertexAttribArray(5); m_gl->glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceData, modelMatrix) + 3 * vec4Size));
+            m_gl->glEnableVertexAttribArray(6); m_gl->glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceData, color)));
+            m_gl->glVertexAttribDivisor(2, 1); m_gl->glVertexAttribDivisor(3, 1); m_gl->glVertexAttribDivisor(4, 1); m_gl->glVertexAttribDivisor(5, 1); m_gl->glVertexAttribDivisor(6, 1);
 
-            struct DrawElementsIndirectCommand {
-                GLuint count;
-                GLuint instanceCount;
-                GLuint firstIndex;
-                GLuint baseVertex;
-                GLuint baseInstance;
-            };
-            DrawElementsIndirectCommand cmd;
+            // Only the visible arrows the last step appended.
             m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, vis.gpuData.commandUBO);
-            m_gl->glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(DrawElementsIndirectCommand), &cmd);
-            m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
-
-            qDebug() << "[INDIRECT_DRAW_DEBUG] Instance Count:" << cmd.instanceCount
-                << " | Index Count:" << cmd.count;
-            // --- END DEBUG ---
-
-
-            /* ---------- DEBUG: dump first few InstanceData records ---------- */
-            {
-                constexpr GLuint kDumpCount = 4;                    // how many structs to print
-                InstanceData dump[kDumpCount]{};                    // CPU-side mirror
-
-                // 1) read back the SSBO that the compute shader just filled
-            m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, vis.gpuData.instanceDataSSBO);
-            m_gl->glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
-                    sizeof(dump),    // bytes to copy
-                    dump);           // destination
-
-                // 2) spit them out in a human-readable way
-                qDebug().nospace() << "[INSTANCE_DUMP] sizeof(InstanceData) = "
-                    << sizeof(InstanceData) << "  (expect 96)";
-                for (GLuint i = 0; i < kDumpCount; ++i) {
-                    const auto& d = dump[i];
-                    qDebug().nospace()
-                        << "  [" << i << "] pos=("
-                        << d.modelMatrix[3].x << ", "
-                        << d.modelMatrix[3].y << ", "
-                        << d.modelMatrix[3].z << ")  "
-                        << "scaleZ=" << d.modelMatrix[2][2] << "  "
-                        << "colour=(" << d.color.r << ", "
-                        << d.color.g << ", "
-                        << d.color.b << ")";
-                }
-            }
-            /* ---------------------------------------------------------------- */
+            m_gl->glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0);
+            RenderStats::draw();
+            m_gl->glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
 
+            m_state.bindVertexArray(0);
+        }
+        else if (vis.displayMode == FieldVisualizerComponent::DisplayMode::Arrows)
+        {
+            if (!m_instancedArrowShader || vis.gpuData.arrowBatched || vis.gpuData.numSamplePoints == 0
+                || vis.gpuData.commandUBO == 0) continue;
 
-            m_instancedArrowShader->use();
+            m_state.use(*m_instancedArrowShader);
             m_instancedArrowShader->setMat4("view", view);
             m_instancedArrowShader->setMat4("projection", projection);
 
-            m_gl->glBindVertexArray(arrowPrimitives.arrowVAO);
+            m_state.bindVertexArray(arrowVAO);
             m_gl->glBindBuffer(GL_ARRAY_BUFFER, vis.gpuData.instanceDataSSBO);
             GLsizei vec4Size = sizeof(glm::vec4);
             m_gl->glEnableVertexAttribArray(2);
@@ -1287,31 +3289,705 @@ void RenderingSystem::renderFieldVisualizers(entt::registry& registry, const glm
 
             m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, vis.gpuData.commandUBO);
             m_gl->glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0);
+            RenderStats::draw();
 
            // m_gl->glFrontFace(GL_CCW);
 
+            // The next tick's compute resets instanceCount with glBufferSubData
+            // after these draws; the barrier orders the two without a stall.
             m_gl->glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
 
-            struct InstanceData {
-                glm::mat4 modelMatrix;
-                glm::vec4 color;
-                glm::vec4 _padding;
-            };
+            m_state.bindVertexArray(0);
+        }
+        else if (vis.displayMode == FieldVisualizerComponent::DisplayMode::Streamlines)
+        {
+            const FieldVisGpuData& gpu = vis.gpuData;
+            if (!m_glowShader || gpu.streamlineCount == 0 || gpu.streamlineBakeGeneration == ~0ull) continue;
+            const auto& settings = vis.streamlineSettings;
+            if (primitives.streamlineVAO == 0) m_gl->glGenVertexArrays(1, &primitives.streamlineVAO);
+
+            // Glow lines as in the spline pass, one command per line; the
+            // style attributes are constants shared by every line.
+            const GLStateCache::State stateBeforeStreamlines = m_state.snapshot();
+            m_state.setBlend(true);
+            m_state.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            m_state.setDepthMask(false);
+            m_state.setCullFace(false);
+            m_state.use(*m_glowShader);
+            m_state.bindVertexArray(primitives.streamlineVAO);
+            m_gl->glBindBuffer(GL_ARRAY_BUFFER, gpu.streamlinePointBuffer);
+            m_gl->glEnableVertexAttribArray(0);
+            m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), nullptr);
+            m_gl->glVertexAttrib4fv(1, glm::value_ptr(settings.glowColour));
+            m_gl->glVertexAttrib4fv(2, glm::value_ptr(settings.coreColour));
+            m_gl->glVertexAttrib1f(3, settings.thickness);
+            m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gpu.streamlineCommandBuffer);
+            m_gl->glMultiDrawArraysIndirect(GL_LINE_STRIP, nullptr, GLsizei(gpu.streamlineCount), 0);
+            RenderStats::draw(gpu.streamlineCount);
+            m_state.restore(stateBeforeStreamlines);
+            m_state.bindVertexArray(0);
+        }
+        else if (vis.displayMode == FieldVisualizerComponent::DisplayMode::Volume)
+        {
+            const FieldVisGpuData& gpu = vis.gpuData;
+            const auto* xf = registry.try_get<TransformComponent>(entity);
+            const bool fromField = !vis.volumeSettings.volume;
+            const GLuint texture = fromField ? gpu.bakedFieldTexture : gpu.volumeTexture;
+            if (!m_fieldVolumeShader || !xf || texture == 0) continue;
+            const auto& settings = vis.volumeSettings;
+            if (primitives.compositeVAO == 0) m_gl->glGenVertexArrays(1, &primitives.compositeVAO);
+
+            // The box of the bounds, ray-marched per fragment. From inside it
+            // only the far faces are left to draw.
+            const glm::mat4 model = xf->getTransform();
+            const glm::vec3 eyeLocal(glm::inverse(glm::dmat4(model)) * glm::dvec4(m_eye, 1.0));
+            const bool inside = glm::all(glm::greaterThanEqual(eyeLocal, vis.bounds.min))
+                && glm::all(glm::lessThanEqual(eyeLocal, vis.bounds.max));
+
+            const GLStateCache::State stateBeforeVolume = m_state.snapshot();
+            m_state.setBlend(true);
+            m_state.setBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            m_state.setDepthMask(false);
+            m_state.setCullFace(true);
+            m_gl->glCullFace(inside ? GL_FRONT : GL_BACK);
+            m_state.use(*m_fieldVolumeShader);
+            m_fieldVolumeShader->setMat4("u_model", eyeRelative(model));
+            m_fieldVolumeShader->setVec3("u_eyeLocal", eyeLocal);
+            m_fieldVolumeShader->setVec3("u_boundsMin", vis.bounds.min);
+            m_fieldVolumeShader->setVec3("u_boundsMax", vis.bounds.max);
+            m_fieldVolumeShader->setBool("u_fromField", fromField);
+            m_fieldVolumeShader->setFloat("u_range", settings.range);
+            m_fieldVolumeShader->setFloat("u_densityScale", settings.densityScale);
+            m_fieldVolumeShader->setFloat("u_threshold", settings.threshold);
+            m_fieldVolumeShader->setInt("u_maxSteps", std::clamp(settings.maxSteps, 1, 2048));
+            m_fieldVolumeShader->setUInt("u_gradientRow", GLuint(gpu.volumeGradientRow));
+            m_fieldVolumeShader->setInt("u_volume", static_cast<int>(kBakedFieldTextureUnit));
+            bindGradientAtlas(*m_fieldVolumeShader);
+            m_gl->glActiveTexture(GL_TEXTURE0 + kBakedFieldTextureUnit);
+            m_gl->glBindTexture(GL_TEXTURE_3D, texture);
+            m_gl->glActiveTexture(GL_TEXTURE0);
+            m_state.bindVertexArray(primitives.compositeVAO);
+            m_gl->glDrawArrays(GL_TRIANGLES, 0, 36);
+            RenderStats::draw();
+            m_gl->glCullFace(GL_BACK);
+            m_state.restore(stateBeforeVolume);
+            m_state.bindVertexArray(0);
+        }
+    }
+
+    // Every batched arrow grid in one draw call, a command each.
+    if (m_instancedArrowShader && m_arrowBatch.drawCount > 0) {
+        m_state.use(*m_instancedArrowShader);
+        m_instancedArrowShader->setMat4("view", view);
+        m_instancedArrowShader->setMat4("projection", projection);
+
+        m_state.bindVertexArray(arrowVAO);
+        m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_arrowBatch.instanceBuffer);
+        const GLsizei vec4Size = sizeof(glm::vec4);
+        for (GLuint col = 0; col < 4; ++col) {
+            m_gl->glEnableVertexAttribArray(2 + col);
+            m_gl->glVertexAttribPointer(2 + col, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceData, modelMatrix) + col * vec4Size));
+            m_gl->glVertexAttribDivisor(2 + col, 1);
+        }
+        m_gl->glEnableVertexAttribArray(6);
+        m_gl->glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(InstanceData, color));
+        m_gl->glVertexAttribDivisor(6, 1);
+
+        // Each command's baseInstance points at its grid's run of the instance buffer.
+        m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_arrowBatch.commandBuffer);
+        m_gl->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, m_arrowBatch.drawCount, 0);
+        RenderStats::draw(m_arrowBatch.drawCount);
+        // The next tick rewrites the commands with glBufferSubData.
+        m_gl->glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        m_state.bindVertexArray(0);
+    }
+}
+
+bool RenderingSystem::ensureBakedField(FieldVisualizerComponent& vis, const glm::mat4& model)
+{
+    if (!m_fieldBakeComputeShader) return false;
+
+    FieldVisGpuData& gpu = vis.gpuData;
+    const glm::ivec3 res = glm::clamp(vis.bakeResolution, glm::ivec3(2), glm::ivec3(256));
+
+    const bool upToDate = gpu.bakedFieldTexture != 0
+        && gpu.bakedResolution == res
+        && gpu.bakedEffectorVersion == m_effectorBuffers.version()
+        && gpu.bakedModel == model
+        && gpu.bakedMin == vis.bounds.min
+        && gpu.bakedMax == vis.bounds.max;
+    if (upToDate) return true;
+
+    if (gpu.bakedFieldTexture == 0 || gpu.bakedResolution != res) {
+        if (gpu.bakedFieldTexture) GpuMemory::deleteTextures(m_gl, 1, &gpu.bakedFieldTexture);
+        gpu.bakedFieldTexture = createFieldTexture(res);
+        gpu.bakedResolution = res;
+    }
 
+    KR_TRACE(FieldViz) << "[FieldViz] Baking field texture" << res.x << "x" << res.y << "x" << res.z;
+    KR_ZONE("bakeField");
+    bakeFieldSlices(gpu.bakedFieldTexture, vis, model, res, 0, res.z);
 
+    gpu.bakedEffectorVersion = m_effectorBuffers.version();
+    gpu.bakedModel = model;
+    gpu.bakedMin = vis.bounds.min;
+    gpu.bakedMax = vis.bounds.max;
+    ++gpu.bakeGeneration;
+    return true;
+}
 
-            InstanceData firstInstance;
-            m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, vis.gpuData.instanceDataSSBO);
-            m_gl->glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(InstanceData), &firstInstance);
+GLuint RenderingSystem::createFieldTexture(const glm::ivec3& res)
+{
+    GLuint texture = 0;
+    m_gl->glGenTextures(1, &texture);
+    m_gl->glBindTexture(GL_TEXTURE_3D, texture);
+    m_gl->glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA16F, res.x, res.y, res.z);
+    GpuMemory::trackTexture(texture, std::size_t(res.x) * res.y * res.z * 8, GpuMemory::Category::FieldVisualizers);
+    m_gl->glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    m_gl->glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Edge clamping keeps directional fields alive just outside the bounds.
+    m_gl->glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    m_gl->glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    m_gl->glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    m_gl->glBindTexture(GL_TEXTURE_3D, 0);
+    return texture;
+}
 
-            qDebug() << "========================================================";
-            qDebug() << "[CANARY_TEST] Color of first instance: " << glm::to_string(firstInstance.color).c_str();
-            qDebug() << "========================================================";
+void RenderingSystem::bakeFieldSlices(GLuint texture, const FieldVisualizerComponent& vis, const glm::mat4& model,
+    const glm::ivec3& res, int firstSlice, int sliceEnd)
+{
+    m_state.use(*m_fieldBakeComputeShader);
+    m_gl->glBindImageTexture(0, texture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    m_fieldBakeComputeShader->setMat4("u_visualizerModelMatrix", model);
+    m_fieldBakeComputeShader->setVec3("u_boundsMin", vis.bounds.min);
+    m_fieldBakeComputeShader->setVec3("u_boundsMax", vis.bounds.max);
+    m_fieldBakeComputeShader->setInt("u_firstSlice", firstSlice);
+    m_fieldBakeComputeShader->setInt("u_sliceEnd", sliceEnd);
+    m_gl->glDispatchCompute((res.x + 3) / 4, (res.y + 3) / 4, (sliceEnd - firstSlice + 3) / 4);
+    RenderStats::dispatch();
+    m_gl->glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    m_gl->glBindImageTexture(0, 0, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+}
 
-            m_gl->glBindVertexArray(0);
+bool RenderingSystem::ensureTemporalField(FieldVisualizerComponent& vis, const glm::mat4& model)
+{
+    if (!m_fieldBakeComputeShader || !m_fieldTemporalBlendShader) return false;
+
+    FieldVisGpuData& gpu = vis.gpuData;
+    const auto& settings = vis.temporalSettings;
+    const glm::ivec3 res = glm::clamp(vis.bakeResolution, glm::ivec3(2), glm::ivec3(256));
+    constexpr int kFrames = FieldVisGpuData::kTemporalFrames;
+
+    // Keyframes only hold over the bounds they were baked for; anything
+    // else starts the ring over.
+    const bool sameSpace = gpu.temporalTextures[0] != 0 && gpu.bakedFieldTexture != 0
+        && gpu.bakedResolution == res && gpu.bakedModel == model
+        && gpu.bakedMin == vis.bounds.min && gpu.bakedMax == vis.bounds.max;
+    if (!sameSpace) {
+        releaseTemporalField(gpu);
+        if (gpu.bakedFieldTexture == 0 || gpu.bakedResolution != res) {
+            if (gpu.bakedFieldTexture) GpuMemory::deleteTextures(m_gl, 1, &gpu.bakedFieldTexture);
+            gpu.bakedFieldTexture = createFieldTexture(res);
+            gpu.bakedResolution = res;
+        }
+        for (GLuint& texture : gpu.temporalTextures) texture = createFieldTexture(res);
+        gpu.bakedModel = model;
+        gpu.bakedMin = vis.bounds.min;
+        gpu.bakedMax = vis.bounds.max;
+    }
+
+    // --- 1. Keyframes: one due and the effectors moved since the last one
+    //     started. The first is baked whole so there is something to show. ---
+    const double interval = std::max(double(settings.keyInterval), 1e-3);
+    if (gpu.temporalSlice < 0 && (gpu.temporalComplete == 0 || m_simTime >= gpu.temporalNextKey)
+        && (gpu.temporalComplete == 0 || gpu.bakedEffectorVersion != m_effectorBuffers.version())) {
+        const int slot = (gpu.temporalNewest + 1) % kFrames;
+        gpu.temporalSlice = 0;
+        gpu.temporalTime[slot] = m_simTime;
+        gpu.temporalNextKey = m_simTime + interval;
+        gpu.bakedEffectorVersion = m_effectorBuffers.version();
+    }
+    if (gpu.temporalSlice >= 0) {
+        KR_ZONE("bakeFieldKeyframe");
+        const int slot = (gpu.temporalNewest + 1) % kFrames;
+        const int budget = gpu.temporalComplete == 0 ? res.z : std::max(settings.slicesPerTick, 1);
+        const int end = std::min(gpu.temporalSlice + budget, res.z);
+        bakeFieldSlices(gpu.temporalTextures[slot], vis, model, res, gpu.temporalSlice, end);
+        gpu.temporalSlice = end < res.z ? end : -1;
+        if (gpu.temporalSlice < 0) {
+            gpu.temporalNewest = slot;
+            gpu.temporalComplete = std::min(gpu.temporalComplete + 1, 2);
+            KR_TRACE(FieldViz) << "[FieldViz] Keyframe at" << gpu.temporalTime[slot] << "s baked";
+        }
+    }
+    if (gpu.temporalComplete == 0) return false;
+
+    // --- 2. The shown field, between the two newest keyframes. Running two
+    //     intervals behind, the keyframe after it is normally complete. ---
+    const int newest = gpu.temporalNewest;
+    const int older = gpu.temporalComplete > 1 ? (newest + kFrames - 1) % kFrames : newest;
+    const double span = gpu.temporalTime[newest] - gpu.temporalTime[older];
+    const double shown = double(m_elapsedTime) - 2.0 * interval;
+    const float blend = span > 0.0 ? float(std::clamp((shown - gpu.temporalTime[older]) / span, 0.0, 1.0)) : 1.0f;
+    if (gpu.temporalShownNewest == newest && gpu.temporalShownBlend == blend) return true;
+
+    const glm::ivec3 groups = (res + 3) / 4;
+    m_state.use(*m_fieldTemporalBlendShader);
+    m_gl->glBindImageTexture(0, gpu.bakedFieldTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    m_gl->glBindImageTexture(1, gpu.temporalTextures[older], 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA16F);
+    m_gl->glBindImageTexture(2, gpu.temporalTextures[newest], 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA16F);
+    m_fieldTemporalBlendShader->setFloat("u_blend", blend);
+    m_gl->glDispatchCompute(groups.x, groups.y, groups.z);
+    RenderStats::dispatch();
+    m_gl->glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    for (GLuint unit = 0; unit < 3; ++unit)
+        m_gl->glBindImageTexture(unit, 0, 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA16F);
+
+    gpu.temporalShownNewest = newest;
+    gpu.temporalShownBlend = blend;
+    ++gpu.bakeGeneration;
+    return true;
+}
+
+void RenderingSystem::releaseTemporalField(FieldVisGpuData& gpu)
+{
+    for (GLuint& texture : gpu.temporalTextures) {
+        if (texture) GpuMemory::deleteTextures(m_gl, 1, &texture);
+        texture = 0;
+    }
+    gpu.temporalNewest = 0;
+    gpu.temporalComplete = 0;
+    gpu.temporalSlice = -1;
+    gpu.temporalNextKey = 0.0;
+    gpu.temporalShownNewest = -1;
+    gpu.temporalShownBlend = -1.0f;
+    // The baked field holds a blend now: the static mode must bake again.
+    gpu.bakedEffectorVersion = ~0ull;
+}
+
+void RenderingSystem::traceStreamlines(FieldVisualizerComponent& vis, const glm::mat4& model)
+{
+    if (!m_streamlineShader) return;
+
+    FieldVisGpuData& gpu = vis.gpuData;
+    const auto& settings = vis.streamlineSettings;
+    const glm::ivec3 seeds = glm::clamp(settings.seedDensity, glm::ivec3(1), glm::ivec3(64));
+    const GLuint lineCount = GLuint(seeds.x * seeds.y * seeds.z);
+    const GLuint pointsPerLine = GLuint(std::clamp(settings.maxSteps, 1, 4096)) + 1;
+
+    if (gpu.streamlinePointBuffer == 0 || gpu.streamlineCount != lineCount || gpu.streamlinePointsPerLine != pointsPerLine) {
+        releaseStreamlines(gpu);
+        m_gl->glGenBuffers(1, &gpu.streamlinePointBuffer);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, gpu.streamlinePointBuffer);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, gpu.streamlinePointBuffer,
+            GLsizeiptr(lineCount) * pointsPerLine * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW,
+            GpuMemory::Category::FieldVisualizers);
+        m_gl->glGenBuffers(1, &gpu.streamlineCommandBuffer);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, gpu.streamlineCommandBuffer);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, gpu.streamlineCommandBuffer,
+            GLsizeiptr(lineCount) * sizeof(DrawArraysIndirectCommand), nullptr, GL_DYNAMIC_DRAW,
+            GpuMemory::Category::FieldVisualizers);
+        gpu.streamlineCount = lineCount;
+        gpu.streamlinePointsPerLine = pointsPerLine;
+    }
+    // The lines only change with the field they follow, or their settings.
+    if (vis.isGpuDataDirty) gpu.streamlineBakeGeneration = ~0ull;
+    if (gpu.streamlineBakeGeneration == gpu.bakeGeneration) return;
+
+    KR_TRACE(FieldViz) << "[FieldViz] Tracing" << lineCount << "streamlines of up to" << pointsPerLine << "points";
+    KR_ZONE("traceStreamlines");
+
+    m_state.use(*m_streamlineShader);
+    bindFieldSource(*m_streamlineShader, vis, model, true);
+    m_streamlineShader->setMat4("u_visualizerModelMatrix", model);
+    m_streamlineShader->setVec3("u_boundsMin", vis.bounds.min);
+    m_streamlineShader->setVec3("u_boundsMax", vis.bounds.max);
+    m_streamlineShader->setUInt("u_seedsX", GLuint(seeds.x));
+    m_streamlineShader->setUInt("u_seedsY", GLuint(seeds.y));
+    m_streamlineShader->setUInt("u_lineCount", lineCount);
+    m_streamlineShader->setUInt("u_maxPoints", pointsPerLine);
+    m_streamlineShader->setFloat("u_stepLength", std::max(settings.stepLength, 1e-4f));
+    m_streamlineShader->setFloat("u_minSpeed", settings.minSpeed);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, gpu.streamlinePointBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, gpu.streamlineCommandBuffer);
+    m_gl->glDispatchCompute((lineCount + 63) / 64, 1, 1);
+    RenderStats::dispatch();
+    m_gl->glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    gpu.streamlineBakeGeneration = gpu.bakeGeneration;
+}
+
+void RenderingSystem::createAdaptiveArrows(FieldVisualizerComponent& vis, int coarseCount, int levels)
+{
+    FieldVisGpuData& gpu = vis.gpuData;
+    const glm::ivec3 density = vis.arrowSettings.density;
+    const glm::vec3 size = vis.bounds.max - vis.bounds.min;
+    // Half the grid spacing: neighbouring coarse cells touch. A single sample spans the axis.
+    gpu.adaptiveHalfExtent = 0.5f * size / glm::vec3(glm::max(density - 1, glm::ivec3(1)));
+    gpu.adaptiveCoarseCount = coarseCount;
+    gpu.adaptiveLevels = levels;
+    gpu.adaptiveBakeGeneration = ~0ull;
+
+    // The coarse cells are the uniform grid, derived in the shader; only the
+    // ping-pong lists are stored. A level writes at most eight cells per
+    // input cell, so the deepest list is the largest.
+    m_gl->glGenBuffers(2, gpu.adaptiveCellBuffers);
+    const std::size_t listBytes = levels > 0 ? std::size_t(gpu.numSamplePoints) * sizeof(glm::vec4) : sizeof(glm::vec4);
+    for (int list = 0; list < 2; ++list) {
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, gpu.adaptiveCellBuffers[list]);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, gpu.adaptiveCellBuffers[list], listBytes,
+            nullptr, GL_DYNAMIC_DRAW, GpuMemory::Category::FieldVisualizers);
+    }
+
+    AdaptiveArrowCountersGpu counters{};
+    counters.cellCount[0] = GLuint(coarseCount);
+    m_gl->glGenBuffers(1, &gpu.adaptiveCounterBuffer);
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, gpu.adaptiveCounterBuffer);
+    GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, gpu.adaptiveCounterBuffer, sizeof(counters), &counters,
+        GL_DYNAMIC_DRAW, GpuMemory::Category::FieldVisualizers);
+}
+
+void RenderingSystem::refineArrowSamples(FieldVisualizerComponent& vis)
+{
+    FieldVisGpuData& gpu = vis.gpuData;
+    if (!m_arrowRefineShader || gpu.adaptiveBakeGeneration == gpu.bakeGeneration) return;
+
+    KR_TRACE(FieldViz) << "[FieldViz] Refining" << gpu.adaptiveCoarseCount << "arrow cells," << gpu.adaptiveLevels << "levels";
+    KR_ZONE("refineArrows");
+
+    // Counters are reset through the copy-write target: glBindBufferBase
+    // below moves the generic shader storage binding.
+    const GLuint zero = 0;
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, gpu.samplePointsSSBO);
+    m_gl->glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(GLuint), &zero);
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, gpu.adaptiveCounterBuffer);
+
+    const auto& settings = vis.arrowSettings;
+    m_state.use(*m_arrowRefineShader);
+    bindFieldSource(*m_arrowRefineShader, vis, gpu.bakedModel, true);
+    m_arrowRefineShader->setUInt("u_maxLevel", GLuint(gpu.adaptiveLevels));
+    m_arrowRefineShader->setVec3("u_coarseHalfExtent", gpu.adaptiveHalfExtent);
+    m_arrowRefineShader->setFloat("u_refineThreshold", settings.refineThreshold);
+    m_arrowRefineShader->setFloat("u_cullingThreshold", settings.cullingThreshold);
+    m_arrowRefineShader->setVec3("u_boundsMin", vis.bounds.min);
+    m_arrowRefineShader->setVec3("u_boundsMax", vis.bounds.max);
+    m_arrowRefineShader->setVec3("u_gridDensity", glm::vec3(settings.density));
+    m_arrowRefineShader->setUInt("u_pass", 0);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, gpu.samplePointsSSBO);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kAdaptiveArrowCountersBinding, gpu.adaptiveCounterBuffer);
+
+    // Level 0 reads the grid; every level writes the list the next reads.
+    // List n (1 or 2) lives in adaptiveCellBuffers[n - 1].
+    for (int level = 0; level <= gpu.adaptiveLevels; ++level) {
+        const GLuint in = level == 0 ? 0 : GLuint(1 + (level - 1) % 2);
+        const GLuint out = GLuint(1 + level % 2);
+        m_gl->glBufferSubData(GL_COPY_WRITE_BUFFER, offsetof(AdaptiveArrowCountersGpu, cellCount) + out * sizeof(GLuint),
+            sizeof(GLuint), &zero);
+        RenderStats::upload(sizeof(GLuint));
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, gpu.adaptiveCellBuffers[in == 0 ? 2 - out : in - 1]);
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, gpu.adaptiveCellBuffers[out - 1]);
+        m_arrowRefineShader->setUInt("u_in", in);
+        m_arrowRefineShader->setUInt("u_out", out);
+        // Sized for the worst case; the shader stops at the list's actual count.
+        const std::size_t maxCells = std::size_t(gpu.adaptiveCoarseCount) << (3 * level);
+        m_gl->glDispatchCompute(GLuint((maxCells + 63) / 64), 1, 1);
+        RenderStats::dispatch();
+        m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    }
+
+    m_arrowRefineShader->setUInt("u_pass", 1);
+    m_gl->glDispatchCompute(1, 1, 1);
+    RenderStats::dispatch();
+    m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    gpu.adaptiveBakeGeneration = gpu.bakeGeneration;
+}
+
+void RenderingSystem::releaseAdaptiveArrows(FieldVisGpuData& gpu)
+{
+    if (gpu.adaptiveCellBuffers[0]) GpuMemory::deleteBuffers(m_gl, 2, gpu.adaptiveCellBuffers);
+    if (gpu.adaptiveCounterBuffer) GpuMemory::deleteBuffers(m_gl, 1, &gpu.adaptiveCounterBuffer);
+    gpu.adaptiveCellBuffers[0] = gpu.adaptiveCellBuffers[1] = 0;
+    gpu.adaptiveCounterBuffer = 0;
+    gpu.adaptiveCoarseCount = gpu.adaptiveLevels = 0;
+    gpu.adaptiveBakeGeneration = ~0ull;
+}
+
+void RenderingSystem::ensureArrowBuffers(FieldVisGpuData& gpu)
+{
+    // Grown in power-of-two buckets and never shrunk here, so density
+    // edits only reallocate when they cross the next bucket.
+    const std::size_t needed = std::size_t(gpu.numSamplePoints);
+    if (gpu.instanceDataSSBO == 0 || gpu.instanceCapacity < needed) {
+        std::size_t capacity = 256;
+        while (capacity < needed) capacity *= 2;
+        if (gpu.instanceDataSSBO == 0) m_gl->glGenBuffers(1, &gpu.instanceDataSSBO);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, gpu.instanceDataSSBO);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, gpu.instanceDataSSBO,
+            capacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW, GpuMemory::Category::FieldVisualizers);
+        gpu.instanceCapacity = capacity;
+    }
+
+    if (gpu.commandUBO == 0) {
+        const DrawElementsIndirectCommand cmd = { GLuint(m_sharedPrimitives.arrowIndexCount), 0, 0, 0, 0 };
+        m_gl->glGenBuffers(1, &gpu.commandUBO);
+        m_gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gpu.commandUBO);
+        GpuMemory::bufferData(m_gl, GL_DRAW_INDIRECT_BUFFER, gpu.commandUBO, sizeof(cmd), &cmd,
+            GL_DYNAMIC_DRAW, GpuMemory::Category::FieldVisualizers);
+    }
+}
+
+void RenderingSystem::dispatchArrowBatch(ComputeDispatch::ContextQueries& queries)
+{
+    using Kernel = ComputeDispatch::Kernel;
+    ArrowBatch& batch = m_arrowBatch;
+    batch.drawCount = GLsizei(batch.commands.size());
+    Shader* arrows = batch.sampleCount ? m_compute.select(Kernel::FieldArrows) : nullptr;
+    if (!arrows) {
+        batch.drawCount = 0;
+    }
+    else {
+        KR_ZONE("arrowBatch");
+        const auto grow = [this](GLuint& buffer, std::size_t& capacity, std::size_t needed, std::size_t bytesEach) {
+            if (buffer != 0 && capacity >= needed) return;
+            capacity = std::max<std::size_t>(capacity, 16);
+            while (capacity < needed) capacity *= 2;
+            if (buffer == 0) m_gl->glGenBuffers(1, &buffer);
+            m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            GpuMemory::bufferData(m_gl, GL_COPY_WRITE_BUFFER, buffer, capacity * bytesEach, nullptr, GL_DYNAMIC_DRAW,
+                GpuMemory::Category::FieldVisualizers);
+        };
+        grow(batch.entryBuffer, batch.entryCapacity, batch.entries.size(), sizeof(ArrowBatchEntryGpu));
+        grow(batch.commandBuffer, batch.commandCapacity, batch.commands.size(), sizeof(DrawElementsIndirectCommand));
+        grow(batch.instanceBuffer, batch.instanceCapacity, batch.sampleCount, sizeof(InstanceData));
+
+        // Fresh commands each tick: their instance counts start at zero.
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, batch.entryBuffer);
+        m_gl->glBufferSubData(GL_COPY_WRITE_BUFFER, 0, batch.entries.size() * sizeof(ArrowBatchEntryGpu), batch.entries.data());
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, batch.commandBuffer);
+        m_gl->glBufferSubData(GL_COPY_WRITE_BUFFER, 0, batch.commands.size() * sizeof(DrawElementsIndirectCommand),
+            batch.commands.data());
+        RenderStats::upload(batch.entries.size() * sizeof(ArrowBatchEntryGpu)
+            + batch.commands.size() * sizeof(DrawElementsIndirectCommand));
+
+        m_state.use(*arrows);
+        arrows->setBool("u_useBakedField", false);
+        arrows->setBool("u_gridSamples", false);
+        arrows->setUInt("u_batchCount", GLuint(batch.entries.size()));
+        arrows->setUInt("u_batchSamples", batch.sampleCount);
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, batch.instanceBuffer);
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, batch.commandBuffer);
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kArrowBatchBinding, batch.entryBuffer);
+        bindGradientAtlas(*arrows);
+        m_compute.dispatch(queries, Kernel::FieldArrows, batch.sampleCount);
+        arrows->setUInt("u_batchCount", 0);   // the per-visualizer dispatches leave it unset
+        m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    }
+    batch.entries.clear();
+    batch.commands.clear();
+    batch.sampleCount = 0;
+}
+
+void RenderingSystem::releaseArrowBatch()
+{
+    ArrowBatch& batch = m_arrowBatch;
+    if (batch.entryBuffer) GpuMemory::deleteBuffers(m_gl, 1, &batch.entryBuffer);
+    if (batch.commandBuffer) GpuMemory::deleteBuffers(m_gl, 1, &batch.commandBuffer);
+    if (batch.instanceBuffer) GpuMemory::deleteBuffers(m_gl, 1, &batch.instanceBuffer);
+    batch = ArrowBatch{};
+}
+
+GLuint RenderingSystem::gradientRow(const std::vector<ColorStop>& stops)
+{
+    GradientAtlas& atlas = m_gradientAtlas;
+    const int row = atlas.used++;
+    m_gl->glActiveTexture(GL_TEXTURE0 + kGradientAtlasTextureUnit);
+    if (row >= atlas.capacity) {
+        // The rows handed out earlier this tick move to the new texture; later
+        // ones are baked as they are handed out.
+        int capacity = std::max(atlas.capacity, 8);
+        while (capacity <= row) capacity *= 2;
+        if (atlas.texture) GpuMemory::deleteTextures(m_gl, 1, &atlas.texture);
+        m_gl->glGenTextures(1, &atlas.texture);
+        m_gl->glBindTexture(GL_TEXTURE_2D, atlas.texture);
+        m_gl->glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, GradientLut::kSize, capacity);
+        GpuMemory::trackTexture(atlas.texture, std::size_t(GradientLut::kSize) * std::size_t(capacity) * 8,
+            GpuMemory::Category::FieldVisualizers);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        atlas.capacity = capacity;
+        atlas.rowStops.resize(std::size_t(capacity));
+        atlas.rowValid.assign(std::size_t(capacity), false);
+        for (int r = 0; r < row; ++r) {
+            const GradientLut lut = GradientLut::bake(atlas.rowStops[r]);
+            m_gl->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, r, GradientLut::kSize, 1, GL_RGBA, GL_FLOAT, lut.texels.data());
+            RenderStats::upload(sizeof(lut.texels));
+            atlas.rowValid[r] = true;
+        }
+    }
+    if (!atlas.rowValid[row] || !GradientLut::sameStops(atlas.rowStops[row], stops)) {
+        const GradientLut lut = GradientLut::bake(stops);
+        m_gl->glBindTexture(GL_TEXTURE_2D, atlas.texture);
+        m_gl->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, GradientLut::kSize, 1, GL_RGBA, GL_FLOAT, lut.texels.data());
+        RenderStats::upload(sizeof(lut.texels));
+        atlas.rowStops[row] = stops;
+        atlas.rowValid[row] = true;
+    }
+    m_gl->glActiveTexture(GL_TEXTURE0);
+    return GLuint(row);
+}
+
+void RenderingSystem::bindGradientAtlas(const Shader& shader)
+{
+    shader.setInt("u_gradientAtlas", static_cast<int>(kGradientAtlasTextureUnit));
+    m_gl->glActiveTexture(GL_TEXTURE0 + kGradientAtlasTextureUnit);
+    m_gl->glBindTexture(GL_TEXTURE_2D, m_gradientAtlas.texture);
+    m_gl->glActiveTexture(GL_TEXTURE0);
+}
+
+void RenderingSystem::releaseGradientAtlas()
+{
+    if (m_gradientAtlas.texture) GpuMemory::deleteTextures(m_gl, 1, &m_gradientAtlas.texture);
+    m_gradientAtlas = GradientAtlas{};
+}
+
+void RenderingSystem::sortParticlesByDepth(ContextPrimitives& primitives, GLuint capacity)
+{
+    if (!m_particleSortShader || capacity == 0) return;
+    KR_ZONE("sortParticles");
+
+    // Sized for the whole capacity: only the GPU knows how many the cull kept.
+    const GLuint tiles = (capacity + kParticleSortTile - 1) / kParticleSortTile;
+    if (primitives.particleSortBuffer == 0) {
+        m_gl->glGenBuffers(1, &primitives.particleSortBuffer);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, primitives.particleSortBuffer);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, primitives.particleSortBuffer, primitives.particleDrawCapacity,
+            nullptr, GL_DYNAMIC_COPY, GpuMemory::Category::Particles);
+    }
+    const GLsizeiptr countBytes = GLsizeiptr(tiles) * 256 * sizeof(GLuint);
+    if (countBytes > primitives.particleSortCountsCapacity) {
+        if (primitives.particleSortCounts == 0) m_gl->glGenBuffers(1, &primitives.particleSortCounts);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, primitives.particleSortCounts);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, primitives.particleSortCounts, countBytes,
+            nullptr, GL_DYNAMIC_COPY, GpuMemory::Category::Particles);
+        primitives.particleSortCountsCapacity = countBytes;
+    }
+
+    m_state.use(*m_particleSortShader);
+    m_particleSortShader->setUInt("u_tiles", tiles);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kParticleDrawBinding, primitives.particleDrawBuffer);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kParticleSortCountsBinding, primitives.particleSortCounts);
+    // Low digit: draw buffer -> scratch; high digit: back, in depth order.
+    const GLuint halves[2] = { primitives.particleDrawBuffer, primitives.particleSortBuffer };
+    for (GLuint digit = 0; digit < 2; ++digit) {
+        m_particleSortShader->setUInt("u_shift", digit * 8);
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kParticleSortSourceBinding, halves[digit]);
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kParticleSortDestBinding, halves[1 - digit]);
+        const GLuint groups[3] = { tiles, 1, tiles };
+        for (GLuint pass = 0; pass < 3; ++pass) {
+            m_particleSortShader->setUInt("u_pass", pass);
+            m_gl->glDispatchCompute(groups[pass], 1, 1);
+            RenderStats::dispatch();
+            m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
         }
-        vis.isGpuDataDirty = false; // Reset dirty flag after processing
     }
+    m_gl->glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+void RenderingSystem::releaseStreamlines(FieldVisGpuData& gpu)
+{
+    if (gpu.streamlinePointBuffer) GpuMemory::deleteBuffers(m_gl, 1, &gpu.streamlinePointBuffer);
+    if (gpu.streamlineCommandBuffer) GpuMemory::deleteBuffers(m_gl, 1, &gpu.streamlineCommandBuffer);
+    gpu.streamlinePointBuffer = gpu.streamlineCommandBuffer = 0;
+    gpu.streamlineCount = gpu.streamlinePointsPerLine = 0;
+    gpu.streamlineBakeGeneration = ~0ull;
+}
+
+void RenderingSystem::bindFieldSource(const Shader& shader, const FieldVisualizerComponent& vis,
+    const glm::mat4& model, bool baked)
+{
+    shader.setBool("u_useBakedField", baked);
+    shader.setInt("u_bakedField", static_cast<int>(kBakedFieldTextureUnit));
+    if (!baked) return;
+
+    // world -> visualizer local -> [0,1]^3 across the bounds
+    const glm::vec3 extent = glm::max(vis.bounds.max - vis.bounds.min, glm::vec3(1e-6f));
+    const glm::mat4 worldToUVW = glm::scale(glm::mat4(1.0f), 1.0f / extent)
+        * glm::translate(glm::mat4(1.0f), -vis.bounds.min)
+        * glm::inverse(model);
+    shader.setMat4("u_worldToFieldUVW", worldToUVW);
+
+    m_gl->glActiveTexture(GL_TEXTURE0 + kBakedFieldTextureUnit);
+    m_gl->glBindTexture(GL_TEXTURE_3D, vis.gpuData.bakedFieldTexture);
+    m_gl->glActiveTexture(GL_TEXTURE0);
+}
+
+void RenderingSystem::ensureScalarVolume(FieldVisualizerComponent& vis)
+{
+    FieldVisGpuData& gpu = vis.gpuData;
+    const std::shared_ptr<const ScalarVolume>& source = vis.volumeSettings.volume;
+    if (source == gpu.volumeUploaded) return;
+
+    const glm::ivec3 res = source ? source->resolution : glm::ivec3(0);
+    const bool valid = source && glm::all(glm::greaterThan(res, glm::ivec3(0)))
+        && source->values.size() == std::size_t(res.x) * res.y * res.z;
+    if (gpu.volumeTexture) GpuMemory::deleteTextures(m_gl, 1, &gpu.volumeTexture);
+    gpu.volumeTexture = 0;
+    gpu.volumeUploaded = source;
+    if (!valid) return;
+
+    KR_TRACE(FieldViz) << "[FieldViz] Uploading volume" << res.x << "x" << res.y << "x" << res.z;
+    m_gl->glGenTextures(1, &gpu.volumeTexture);
+    m_gl->glBindTexture(GL_TEXTURE_3D, gpu.volumeTexture);
+    m_gl->glTexStorage3D(GL_TEXTURE_3D, 1, GL_R16F, res.x, res.y, res.z);
+    GpuMemory::trackTexture(gpu.volumeTexture, source->values.size() * 2, GpuMemory::Category::FieldVisualizers);
+    m_gl->glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, res.x, res.y, res.z, GL_RED, GL_FLOAT, source->values.data());
+    RenderStats::upload(source->values.size() * sizeof(float));
+    m_gl->glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    m_gl->glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    m_gl->glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    m_gl->glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    m_gl->glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    m_gl->glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+void RenderingSystem::readBackArrowField(FieldVisGpuData& gpu)
+{
+    // Layout of one staging slot: the indirect command, then the first few instances.
+    constexpr GLuint kDumpCount = 4;
+    struct Snapshot {
+        DrawElementsIndirectCommand cmd;
+        InstanceData instances[kDumpCount];
+    };
+    const GLuint dumpCount = std::min<GLuint>(kDumpCount, GLuint(gpu.numSamplePoints));
+
+    GpuReadbackRing& ring = gpu.debugReadback;
+    ring.ensure(m_gl, sizeof(Snapshot));
+
+    // Print whatever finished a frame or two ago, then queue this frame's copy.
+    Snapshot snap{};
+    if (ring.tryRead(m_gl, &snap, sizeof(Snapshot))) {
+        KR_TRACE(FieldViz) << "[INDIRECT_DRAW_DEBUG] Instance Count:" << snap.cmd.instanceCount
+            << " | Index Count:" << snap.cmd.count;
+        for (GLuint i = 0; i < dumpCount; ++i) {
+            const auto& d = snap.instances[i];
+            KR_TRACE(FieldViz).nospace()
+                << "[INSTANCE_DUMP] [" << i << "] pos=("
+                << d.modelMatrix[3].x << ", "
+                << d.modelMatrix[3].y << ", "
+                << d.modelMatrix[3].z << ")  "
+                << "scaleZ=" << d.modelMatrix[2][2] << "  "
+                << "colour=(" << d.color.r << ", "
+                << d.color.g << ", "
+                << d.color.b << ")";
+        }
+    }
+
+    ring.copy(m_gl, gpu.commandUBO, 0, offsetof(Snapshot, cmd), sizeof(DrawElementsIndirectCommand));
+    if (dumpCount > 0)
+        ring.copy(m_gl, gpu.instanceDataSSBO, 0, offsetof(Snapshot, instances), dumpCount * sizeof(InstanceData));
+    ring.submit(m_gl);
 }
 
 void RenderingSystem::updateSceneLogic(entt::registry& registry, float deltaTime)
@@ -1324,97 +4000,127 @@ void RenderingSystem::updateSceneLogic(entt::registry& registry, float deltaTime
     {
         auto& sp = splineView.get<SplineComponent>(e);
         if (sp.isDirty) {
-            qDebug() << "[Scene Logic] Recalculating vertices for dirty spline entity:" << (int)e;
-            switch (sp.type) {
-            case SplineType::Linear:     sp.cachedVertices = evaluateLinearCPU(sp.controlPoints); break;
-            case SplineType::CatmullRom: sp.cachedVertices = evaluateCatmullRomCPU(sp.controlPoints, 64); break;
-            case SplineType::Bezier:     sp.cachedVertices = evaluateBezierCPU(sp.controlPoints, 64); break;
-            case SplineType::Parametric: sp.cachedVertices = evaluateParametricCPU(sp.parametric.func, 128); break;
-            }
-            sp.isDirty = false;
+            KR_TRACE(Spline) << "[Scene Logic] Recalculating vertices for dirty spline entity:" << (int)e;
+            rebuildSplineCache(sp);
         }
     }
 }
 
-void RenderingSystem::drawIntersections(const std::vector<std::vector<glm::vec3>>& allOutlines, const glm::mat4& view, const glm::mat4& proj)
+void RenderingSystem::drawIntersections(const std::vector<std::vector<glm::vec3>>& allOutlines, std::uint64_t generation)
 {
-    if (!m_outlineShader || m_intersectionVAO == 0 || allOutlines.empty()) return;
-
-    m_gl->glDisable(GL_DEPTH_TEST); // Draw on top of everything.
-    m_outlineShader->use();
-    m_outlineShader->setMat4("u_view", view);
-    m_outlineShader->setMat4("u_projection", proj);
-    m_outlineShader->setVec3("u_outlineColor", glm::vec3(1.0f, 0.5f, 0.0f)); // Orange color for outlines.
-
-    m_gl->glBindVertexArray(m_intersectionVAO);
-    for (const auto& outlinePoints : allOutlines) {
-        if (outlinePoints.size() > 1) {
-            m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_intersectionVBO);
-            m_gl->glBufferData(GL_ARRAY_BUFFER, outlinePoints.size() * sizeof(glm::vec3), outlinePoints.data(), GL_DYNAMIC_DRAW);
-            m_gl->glDrawArrays(GL_LINE_LOOP, 0, static_cast<GLsizei>(outlinePoints.size()));
+    KR_ZONE("drawIntersections");
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!m_outlineShader || !ctx || allOutlines.empty()) return;
+
+    // --- 1. Every outline into the one buffer, only when the sections changed ---
+    if (m_intersectionVBO == 0) m_gl->glGenBuffers(1, &m_intersectionVBO);
+    if (generation != m_intersectionGeneration) {
+        m_intersectionScratch.clear();
+        m_intersectionFirsts.clear();
+        m_intersectionCounts.clear();
+        for (const auto& outlinePoints : allOutlines) {
+            if (outlinePoints.size() < 2) continue;
+            m_intersectionFirsts.push_back(GLint(m_intersectionScratch.size()));
+            m_intersectionCounts.push_back(GLsizei(outlinePoints.size()));
+            m_intersectionScratch.insert(m_intersectionScratch.end(), outlinePoints.begin(), outlinePoints.end());
         }
+        const GLsizeiptr bytes = GLsizeiptr(m_intersectionScratch.size() * sizeof(glm::vec3));
+        m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_intersectionVBO);
+        if (bytes > m_intersectionCapacity) {
+            m_intersectionCapacity = std::max<GLsizeiptr>(bytes, m_intersectionCapacity * 2);
+            GpuMemory::bufferData(m_gl, GL_ARRAY_BUFFER, m_intersectionVBO, m_intersectionCapacity, nullptr,
+                GL_DYNAMIC_DRAW, GpuMemory::Category::Other);
+        }
+        if (bytes > 0) m_gl->glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, m_intersectionScratch.data());
+        RenderStats::upload(std::uint64_t(bytes));
+        m_intersectionGeneration = generation;
+    }
+    if (m_intersectionFirsts.empty()) return;
+
+    auto& primitives = m_contextPrimitives[ctx];
+    if (primitives.intersectionVAO == 0) {
+        m_gl->glGenVertexArrays(1, &primitives.intersectionVAO);
+        m_state.bindVertexArray(primitives.intersectionVAO);
+        m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_intersectionVBO);
+        m_gl->glEnableVertexAttribArray(0);
+        m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
     }
-    m_gl->glBindVertexArray(0);
-    m_gl->glEnable(GL_DEPTH_TEST); // Re-enable depth testing for subsequent passes.
+
+    // --- 2. One draw for all of them; the polylines close themselves ---
+    m_state.setDepthTest(false); // Draw on top of everything.
+    m_state.use(*m_outlineShader);
+    m_outlineShader->setVec3("u_outlineColor", glm::vec3(1.0f, 0.5f, 0.0f)); // Orange color for outlines.
+    m_state.bindVertexArray(primitives.intersectionVAO);
+    m_gl->glMultiDrawArrays(GL_LINE_STRIP, m_intersectionFirsts.data(), m_intersectionCounts.data(),
+        GLsizei(m_intersectionFirsts.size()));
+    RenderStats::draw();
+    m_state.bindVertexArray(0);
+    m_state.setDepthTest(true); // Re-enable depth testing for subsequent passes.
 }
 
-void RenderingSystem::renderSelectionGlow(QOpenGLWidget* viewport, entt::registry& registry, const glm::mat4& view, const glm::mat4& projection, TargetFBOs& target) {
+GLuint RenderingSystem::renderSelectionGlow(RenderTargetId targetId, const RenderSnapshot& snapshot, const glm::mat4& view, const glm::mat4& projection, TargetFBOs& target) {
     
-    auto viewSelected = registry.view<SelectedComponent, RenderableMeshComponent, TransformComponent>();
+    if (snapshot.selectedCount == 0) {
+        return 0; // Nothing selected: skip the emissive and blur passes entirely.
+    }
+
+    KR_TRACE(Glow) << "[GLOW PASS] Starting for target:" << targetId;
 
-    qDebug() << "[GLOW PASS] Starting for ViewportWidget:" << viewport;
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!ctx) return 0;
 
     //! Bind the dedicated glow FBO for this viewport.
-    m_gl->glBindFramebuffer(GL_FRAMEBUFFER, target.glowFBO);
-    m_gl->glViewport(0, 0, target.w, target.h);
+    m_state.bindFramebuffer(target.glowFBO);
+    m_gl->glViewport(0, 0, target.viewW, target.viewH);
     m_gl->glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     m_gl->glClear(GL_COLOR_BUFFER_BIT);
 
-    if (viewSelected.size_hint() == 0) {
-        return; // Early exit if nothing is selected
-    }
-
     // --- PASS 1: Render solid emissive color to the glow FBO ---
-    m_emissiveSolidShader->use();
-    m_emissiveSolidShader->setMat4("view", view);
-    m_emissiveSolidShader->setMat4("projection", projection);
+    m_state.use(*m_emissiveSolidShader);
     m_emissiveSolidShader->setVec3("emissiveColor", glm::vec3(1.0f, 0.75f, 0.1f));
 
-    QOpenGLContext* ctx = QOpenGLContext::currentContext();
-    if (!ctx) return;
+    for (const std::uint32_t i : *m_viewMeshes) {
+        const auto& mesh = snapshot.meshes[i];
+        if (!mesh.selected || isCulled(mesh)) continue;
+        m_emissiveSolidShader->setMat4("model", eyeRelative(mesh.model));
 
-    for (auto entity : viewSelected) {
-        auto [mesh, transform] = viewSelected.get<RenderableMeshComponent, TransformComponent>(entity);
-        m_emissiveSolidShader->setMat4("model", transform.getTransform());
+        const auto& range = acquireMeshRange(mesh);
+        bindArenaVAO(ctx);
+        m_gl->glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+            (void*)(std::size_t(range.firstIndex) * sizeof(unsigned)), range.baseVertex);
+        RenderStats::draw();
+    }
 
-        auto& res = registry.get_or_emplace<RenderResourceComponent>(entity);
-        auto& buf = res.perContext[ctx];
-        if (buf.VAO != 0) {
-            m_gl->glBindVertexArray(buf.VAO);
-            m_gl->glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indices.size()), GL_UNSIGNED_INT, nullptr);
-        }
+    // --- PASS 2: Blur ---
+    auto& primitives = m_contextPrimitives[ctx];
+    if (primitives.compositeVAO == 0) {
+        m_gl->glGenVertexArrays(1, &primitives.compositeVAO);
     }
 
-    // --- PASS 2: Apply Gaussian blur ---
+    m_gl->glActiveTexture(GL_TEXTURE0);
+    m_state.setDepthTest(false);
+    const GLuint blurred = (m_glowMode == GlowMode::MipChain && m_bloomDownShader && m_bloomUpShader)
+        ? blurGlowMipChain(target, primitives.compositeVAO)
+        : blurGlowGaussian(target, primitives.compositeVAO);
+    m_state.setDepthTest(true);
+    return blurred;
+}
+
+GLuint RenderingSystem::blurGlowGaussian(TargetFBOs& target, GLuint compositeVAO)
+{
     bool horizontal = true, first_iteration = true;
     unsigned int amount = 9;
-    m_blurShader->use();
+    m_state.use(*m_blurShader);
     m_blurShader->setInt("screenTexture", 0);
-    m_gl->glActiveTexture(GL_TEXTURE0);
-    m_gl->glDisable(GL_DEPTH_TEST);
-
-    auto& primitives = m_contextPrimitives[QOpenGLContext::currentContext()];
-    if (primitives.compositeVAO == 0) {
-        m_gl->glGenVertexArrays(1, &primitives.compositeVAO);
-    }
+    m_blurShader->setVec2("u_uvScale", targetUvScale(target));
 
     for (unsigned int i = 0; i < amount; i++) {
         //! Bind the correct ping-pong FBO for this target.
-        m_gl->glBindFramebuffer(GL_FRAMEBUFFER, target.pingpongFBO[horizontal]);
-        m_gl->glViewport(0, 0, target.w, target.h);
+        m_state.bindFramebuffer(target.pingpongFBO[horizontal]);
+        m_gl->glViewport(0, 0, target.viewW, target.viewH);
 
         //! DEBUG: Log the clear call to be 100% sure it's happening.
-        qDebug() << "[GLOW PASS] Clearing pingpongFBO[" << horizontal << "] (" << target.pingpongFBO[horizontal] << ")";
+        KR_TRACE(Glow) << "[GLOW PASS] Clearing pingpongFBO[" << horizontal << "] (" << target.pingpongFBO[horizontal] << ")";
 
 
         m_gl->glClear(GL_COLOR_BUFFER_BIT); // Clear is essential to prevent accumulation.
@@ -1425,19 +4131,169 @@ void RenderingSystem::renderSelectionGlow(QOpenGLWidget* viewport, entt::registr
         GLuint textureToBlur = first_iteration ? target.glowTexture : target.pingpongTexture[!horizontal];
         m_gl->glBindTexture(GL_TEXTURE_2D, textureToBlur);
 
-        m_gl->glBindVertexArray(primitives.compositeVAO);
+        m_state.bindVertexArray(compositeVAO);
         m_gl->glDrawArrays(GL_TRIANGLES, 0, 3);
+        RenderStats::draw();
 
         horizontal = !horizontal;
         if (first_iteration) first_iteration = false;
     }
+    return target.pingpongTexture[0];
+}
+
+GLuint RenderingSystem::blurGlowMipChain(TargetFBOs& target, GLuint compositeVAO)
+{
+    constexpr int kLevels = TargetFBOs::kBloomLevels;
+    auto levelSize = [&](int level, int full) { return std::max(1, full >> (level + 1)); };
+
+    if (target.bloomFBO[0] == 0) {
+        m_gl->glGenFramebuffers(kLevels, target.bloomFBO);
+        m_gl->glGenTextures(kLevels, target.bloomTexture);
+        for (int i = 0; i < kLevels; ++i) {
+            m_state.bindFramebuffer(target.bloomFBO[i]);
+            m_gl->glBindTexture(GL_TEXTURE_2D, target.bloomTexture[i]);
+            m_gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, levelSize(i, target.w), levelSize(i, target.h), 0, GL_RGBA, GL_FLOAT, NULL);
+            GpuMemory::trackTexture(target.bloomTexture[i], std::size_t(levelSize(i, target.w)) * levelSize(i, target.h) * 8,
+                GpuMemory::Category::RenderTargets);
+            m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            m_gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.bloomTexture[i], 0);
+            if (m_gl->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                qWarning() << "Bloom FBO " << i << " not complete!";
+        }
+    }
+
+    m_state.bindVertexArray(compositeVAO);
+
+    // --- Down: glow -> 1/2 -> 1/4 -> 1/8. Only the view's corner is drawn;
+    //     the clear keeps the taps along its edge from reading a larger frame. ---
+    const glm::vec2 uvScale = targetUvScale(target);
+    m_gl->glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    m_state.use(*m_bloomDownShader);
+    m_bloomDownShader->setInt("u_source", 0);
+    m_bloomDownShader->setVec2("u_uvScale", uvScale);
+    GLuint source = target.glowTexture;
+    for (int i = 0; i < kLevels; ++i) {
+        m_state.bindFramebuffer(target.bloomFBO[i]);
+        m_gl->glClear(GL_COLOR_BUFFER_BIT);
+        m_gl->glViewport(0, 0, levelSize(i, target.viewW), levelSize(i, target.viewH));
+        m_gl->glBindTexture(GL_TEXTURE_2D, source);
+        m_gl->glDrawArrays(GL_TRIANGLES, 0, 3);
+        RenderStats::draw();
+        source = target.bloomTexture[i];
+    }
+
+    // --- Up: add each level's tent-filtered image onto the next larger one ---
+    m_state.use(*m_bloomUpShader);
+    m_bloomUpShader->setInt("u_source", 0);
+    m_bloomUpShader->setVec2("u_uvScale", uvScale);
+    m_state.setBlend(true);
+    m_state.setBlendFunc(GL_ONE, GL_ONE);
+    for (int i = kLevels - 1; i > 0; --i) {
+        m_state.bindFramebuffer(target.bloomFBO[i - 1]);
+        m_gl->glViewport(0, 0, levelSize(i - 1, target.viewW), levelSize(i - 1, target.viewH));
+        m_gl->glBindTexture(GL_TEXTURE_2D, target.bloomTexture[i]);
+        m_gl->glDrawArrays(GL_TRIANGLES, 0, 3);
+        RenderStats::draw();
+    }
+    m_state.setBlend(false);
+
+    // Half resolution, magnified bilinearly by the composite.
+    return target.bloomTexture[0];
+}
+
+void RenderingSystem::renderSelectionOutline(const RenderSnapshot& snapshot, TargetFBOs& target)
+{
+    if (snapshot.selectedCount == 0) return;
+    renderStencilOutline(snapshot, &RenderSnapshot::Mesh::selected, target, glm::vec3(1.0f, 0.75f, 0.1f));
+}
+
+void RenderingSystem::renderContactOutline(const RenderSnapshot& snapshot, TargetFBOs& target)
+{
+    if (snapshot.contactCount == 0) return;
+    renderStencilOutline(snapshot, &RenderSnapshot::Mesh::contact, target, glm::vec3(1.0f, 0.1f, 0.1f));
+}
+
+void RenderingSystem::renderStencilOutline(const RenderSnapshot& snapshot, bool RenderSnapshot::Mesh::* flag,
+    TargetFBOs& target, const glm::vec3& colour)
+{
+
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!ctx) return;
+
+    // Straight into the scene (a stereo frame's eye layer). The stencil is
+    // cleared per pass, since the selection and contact outlines both mark it.
+    m_state.bindFramebuffer(target.stereoDrawFBO ? target.stereoDrawFBO : target.mainFBO);
+    m_gl->glViewport(0, 0, target.viewW, target.viewH);
+    m_state.setDepthTest(false); // outline the whole silhouette, occluded parts included
+    m_state.setDepthMask(false);
+    m_state.setStencilTest(true);
+    m_gl->glStencilMask(0xFF);
+    m_gl->glClear(GL_STENCIL_BUFFER_BIT);
+
+    m_state.use(*m_selectionOutlineShader);
+    m_selectionOutlineShader->setVec3("u_outlineColor", colour);
+
+    auto drawTagged = [&](float width) {
+        m_selectionOutlineShader->setFloat("u_outlineWidth", width);
+        for (const std::uint32_t i : *m_viewMeshes) {
+            const auto& mesh = snapshot.meshes[i];
+            if (!(mesh.*flag) || isCulled(mesh)) continue;
+            m_selectionOutlineShader->setMat4("model", eyeRelative(mesh.model));
+
+            const auto& range = acquireMeshRange(mesh);
+            bindArenaVAO(ctx);
+            m_gl->glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+                (void*)(std::size_t(range.firstIndex) * sizeof(unsigned)), range.baseVertex);
+            RenderStats::draw();
+        }
+        };
 
-    m_gl->glEnable(GL_DEPTH_TEST);
+    // --- 1. Mark every tagged silhouette with stencil 1, colour untouched ---
+    m_gl->glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    m_gl->glStencilFunc(GL_ALWAYS, 1, 0xFF);
+    m_gl->glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    drawTagged(0.0f);
+
+    // --- 2. Extruded hulls, kept only outside the marked silhouettes ---
+    m_gl->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    m_gl->glStencilMask(0x00);
+    m_gl->glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
+    drawTagged(m_selectionOutlineWidth);
+
+    m_gl->glStencilMask(0xFF);
+    m_state.setStencilTest(false);
+    m_state.setDepthMask(true);
+    m_state.setDepthTest(true);
+    m_state.bindVertexArray(0);
+}
+
+void RenderingSystem::destroyBloomChain(TargetFBOs& target)
+{
+    if (target.bloomFBO[0] == 0) return;
+    m_gl->glDeleteFramebuffers(TargetFBOs::kBloomLevels, target.bloomFBO);
+    GpuMemory::deleteTextures(m_gl, TargetFBOs::kBloomLevels, target.bloomTexture);
+    for (int i = 0; i < TargetFBOs::kBloomLevels; ++i) target.bloomFBO[i] = target.bloomTexture[i] = 0;
 }
 
 
 //---------- UTILITY & HELPER IMPLEMENTATIONS ------------------
 
+bool RenderingSystem::inFrustum(const glm::vec3& min, const glm::vec3& max) const
+{
+    // A stereo frame's shared passes keep what either eye sees.
+    return CullingSystem::isVisible(m_frustum, min, max)
+        || (m_stereoFrame && CullingSystem::isVisible(m_stereoFrustum, min, max));
+}
+
+bool RenderingSystem::isCulled(const RenderSnapshot::Mesh& mesh) const
+{
+    if (!m_frustumCulling || !mesh.boundsValid) return false;
+    return !inFrustum(mesh.boundsMin, mesh.boundsMax);
+}
+
 bool RenderingSystem::isDescendantOf(entt::registry& r, entt::entity e, entt::entity ancestor) {
     // Traverse up the entity hierarchy to check for an ancestor-descendant relationship.
     while (r.any_of<ParentComponent>(e)) {
@@ -1462,74 +4318,140 @@ void RenderingSystem::updateCameraTransforms(entt::registry& r)
     }
 }
 
+const std::vector<RenderingSystem::ShaderProgramSource>& RenderingSystem::shaderProgramSources()
+{
+    static const std::vector<ShaderProgramSource> sources = {
+        { &RenderingSystem::m_phongShader,            { "vertex_shader.glsl", "fragment_shader.glsl" } },
+        { &RenderingSystem::m_instancedPhongShader,   { "instanced_phong_vert.glsl", "instanced_phong_frag.glsl" } },
+        // Both eyes of a stereo frame in one draw, each into its layer.
+        { &RenderingSystem::m_instancedPhongStereoShader, { "instanced_phong_vert.glsl", "stereo_layer_geom.glsl",
+                                                            "instanced_phong_frag.glsl" } },
+        { &RenderingSystem::m_gridShader,             { "grid_vert.glsl", "grid_frag.glsl" } },
+        { &RenderingSystem::m_instancedArrowShader,   { "instanced_arrow_vert.glsl", "instanced_arrow_frag.glsl" } },
+        { &RenderingSystem::m_outlineShader,          { "outline_vert.glsl", "outline_frag.glsl" } },
+        { &RenderingSystem::m_emissiveSolidShader,    { "vertex_shader.glsl", "emissive_solid_frag.glsl" } },
+        { &RenderingSystem::m_blurShader,             { "post_process_vert.glsl", "gaussian_blur_frag.glsl" } },
+        { &RenderingSystem::m_compositeShader,        { "post_process_vert.glsl", "composite_frag.glsl" } },
+        { &RenderingSystem::m_taaResolveShader,       { "post_process_vert.glsl", "taa_resolve_frag.glsl" } },
+        { &RenderingSystem::m_selectionOutlineShader, { "selection_outline_vert.glsl", "outline_frag.glsl" } },
+        { &RenderingSystem::m_bloomDownShader,        { "post_process_vert.glsl", "bloom_downsample_frag.glsl" } },
+        { &RenderingSystem::m_bloomUpShader,          { "post_process_vert.glsl", "bloom_upsample_frag.glsl" } },
+        { &RenderingSystem::m_glowShader,             { "glow_line_vert.glsl", "glow_line_geom.glsl", "glow_line_frag.glsl" } },
+        { &RenderingSystem::m_capShader,              { "cap_vert.glsl", "cap_geom.glsl", "cap_frag.glsl" } },
+        // Tessellated splines reuse the glow line's quad expansion and shading.
+        { &RenderingSystem::m_splineShader,           { "spline_vert.glsl", "spline_tesc.glsl", "spline_tese.glsl",
+                                                        "glow_line_geom.glsl", "glow_line_frag.glsl" } },
+        { &RenderingSystem::m_particleRenderShader,   { "particle_render_vert.glsl", "particle_render_frag.glsl" } },
+        { &RenderingSystem::m_particleEmitShader,     { "particle_emit_comp.glsl" } },
+        { &RenderingSystem::m_particleCullShader,     { "particle_cull_comp.glsl" } },
+        { &RenderingSystem::m_particleSortShader,     { "particle_sort_comp.glsl" } },
+        { &RenderingSystem::m_hizBuildShader,         { "hiz_build_comp.glsl" } },
+        { &RenderingSystem::m_occlusionCullShader,    { "occlusion_cull_comp.glsl" } },
+        { &RenderingSystem::m_clusterCullShader,      { "cluster_cull_comp.glsl" } },
+        { &RenderingSystem::m_fleetKinematicsShader,  { "fleet_kinematics_comp.glsl" } },
+        { &RenderingSystem::m_lightCullShader,        { "light_cull_comp.glsl" } },
+        { &RenderingSystem::m_shadowDepthShader,      { "shadow_depth_vert.glsl" } },
+        { &RenderingSystem::m_streamlineShader,       { "streamline_integrate_comp.glsl" } },
+        { &RenderingSystem::m_arrowRefineShader,      { "arrow_refine_comp.glsl" } },
+        { &RenderingSystem::m_fieldBakeComputeShader,      { "field_bake_comp.glsl" } },
+        { &RenderingSystem::m_fieldTemporalBlendShader,    { "field_temporal_blend_comp.glsl" } },
+        { &RenderingSystem::m_reconstructionSplatShader,   { "reconstruction_splat_comp.glsl" } },
+        { &RenderingSystem::m_reconstructionIntegrateShader, { "reconstruction_integrate_comp.glsl" } },
+        { &RenderingSystem::m_reconstructionTrackShader,     { "reconstruction_track_comp.glsl" } },
+        { &RenderingSystem::m_virtualSensorDepthShader,      { "virtual_sensor_depth_vert.glsl", "virtual_sensor_depth_geom.glsl" } },
+        { &RenderingSystem::m_virtualSensorPackShader,       { "virtual_sensor_pack_comp.glsl" } },
+        { &RenderingSystem::m_ghostShader,            { "ghost_vert.glsl", "ghost_frag.glsl" } },
+        { &RenderingSystem::m_frameTriadShader,       { "frame_triad_vert.glsl", "frame_triad_frag.glsl" } },
+        { &RenderingSystem::m_labelShader,            { "label_vert.glsl", "label_frag.glsl" } },
+        { &RenderingSystem::m_fieldVolumeShader,      { "field_volume_vert.glsl", "field_volume_frag.glsl" } },
+        { &RenderingSystem::m_pointCloudShader,       { "point_cloud_vert.glsl", "point_cloud_frag.glsl" } },
+        { &RenderingSystem::m_pointSplatShader,       { "point_splat_comp.glsl" } },
+        { &RenderingSystem::m_pointSplatResolveShader, { "post_process_vert.glsl", "point_splat_resolve_frag.glsl" } },
+        { &RenderingSystem::m_sensorPointShader,      { "sensor_points_vert.glsl", "sensor_points_frag.glsl" } },
+    };
+    return sources;
+}
+
+std::string RenderingSystem::shaderPath(const std::string& file)
+{
+#if KR_SHADER_HOT_RELOAD
+    return std::string(KR_SHADER_SOURCE_DIR) + "/" + file;
+#else
+    return ":/shaders/" + file; // embedded via resources.qrc
+#endif
+}
+
+// Programs see the particle buffer layout the C++ side was built with.
+static const std::string kParticleLayoutDefine = "#define KR_PACKED_PARTICLES " + std::to_string(KR_PACKED_PARTICLES);
+
+std::unique_ptr<Shader> RenderingSystem::buildShaderProgram(const ShaderProgramSource& source)
+{
+    if (source.files.size() == 2)
+        return std::make_unique<Shader>(m_gl,
+            shaderPath(source.files[0]).c_str(), shaderPath(source.files[1]).c_str());
+
+    std::vector<std::string> paths;
+    paths.reserve(source.files.size());
+    for (const auto& file : source.files) paths.push_back(shaderPath(file));
+    return std::make_unique<Shader>(m_gl, paths, kParticleLayoutDefine);
+}
+
+Shader* RenderingSystem::postShader(std::uint32_t effects)
+{
+    if (effects == kPostDefaultEffects) return m_compositeShader.get();
+    auto [it, inserted] = m_postShaders.try_emplace(effects);
+    if (inserted) {
+        try {
+            it->second = std::make_unique<Shader>(m_gl,
+                std::vector<std::string>{ shaderPath("post_process_vert.glsl"), shaderPath("composite_frag.glsl") },
+                "#define KR_POST_EFFECTS " + std::to_string(effects));
+        }
+        catch (const std::runtime_error& e) {
+            qWarning() << "[RenderingSystem] post stack" << effects << "failed to build, using the default:\n" << e.what();
+        }
+    }
+    return it->second ? it->second.get() : m_compositeShader.get();
+}
+
+std::unique_ptr<Shader> RenderingSystem::buildComputeKernel(ComputeDispatch::Kernel kernel, GLuint localSize)
+{
+    return Shader::buildComputeShader(m_gl, shaderPath(ComputeDispatch::kernelFile(kernel)).c_str(),
+        "#define KR_LOCAL_SIZE_X " + std::to_string(localSize) + "\n" + kParticleLayoutDefine);
+}
+
 void RenderingSystem::initShaders() {
+    QElapsedTimer timer;
+    timer.start();
+    m_shaderBinaryCache.setFunctions(m_gl);
+    Shader::setBinaryCache(&m_shaderBinaryCache);
+
     try {
-        // --- Use the (const char*, const char*) constructor for simple shaders ---
-        // This is the most direct and clear way for simple vertex/fragment pairs.
-        m_phongShader = std::make_unique<Shader>(m_gl,
-            "D:/RoboticsSoftware/shaders/vertex_shader.glsl",
-            "D:/RoboticsSoftware/shaders/fragment_shader.glsl"
-        );
-        m_gridShader = std::make_unique<Shader>(m_gl,
-            "D:/RoboticsSoftware/shaders/grid_vert.glsl",
-            "D:/RoboticsSoftware/shaders/grid_frag.glsl"
-        );
-        m_instancedArrowShader = std::make_unique<Shader>(m_gl,
-            "D:/RoboticsSoftware/shaders/instanced_arrow_vert.glsl",
-            "D:/RoboticsSoftware/shaders/instanced_arrow_frag.glsl"
-        );
-        m_outlineShader = std::make_unique<Shader>(m_gl,
-            "D:/RoboticsSoftware/shaders/outline_vert.glsl",
-            "D:/RoboticsSoftware/shaders/outline_frag.glsl"
-        );
-        m_emissiveSolidShader = std::make_unique<Shader>(m_gl,
-            "D:/RoboticsSoftware/shaders/vertex_shader.glsl",
-            "D:/RoboticsSoftware/shaders/emissive_solid_frag.glsl"
-        );
-        m_blurShader = std::make_unique<Shader>(m_gl,
-            "D:/RoboticsSoftware/shaders/post_process_vert.glsl",
-            "D:/RoboticsSoftware/shaders/gaussian_blur_frag.glsl"
-        );
-        m_compositeShader = std::make_unique<Shader>(m_gl,
-            "D:/RoboticsSoftware/shaders/post_process_vert.glsl",
-            "D:/RoboticsSoftware/shaders/composite_frag.glsl"
-        );
-
-        // --- Use the static factory methods for complex shaders ---
-        // This is the correct pattern for shaders with more than two stages or special types.
-        m_glowShader = Shader::buildGeometryShader(m_gl,
-            "D:/RoboticsSoftware/shaders/glow_line_vert.glsl",
-            "D:/RoboticsSoftware/shaders/glow_line_geom.glsl",
-            "D:/RoboticsSoftware/shaders/glow_line_frag.glsl"
-        );
-        m_capShader = Shader::buildGeometryShader(m_gl,
-            "D:/RoboticsSoftware/shaders/cap_vert.glsl",
-            "D:/RoboticsSoftware/shaders/cap_geom.glsl",
-            "D:/RoboticsSoftware/shaders/cap_frag.glsl"
-        );
-
-        // This was the line causing the error. It should use a factory method,
-        // not a constructor call via make_unique.
-        m_arrowFieldComputeShader = Shader::buildComputeShader(m_gl,
-            "D:/RoboticsSoftware/shaders/field_visualizer_comp.glsl"
-        );
-
-        m_particleUpdateComputeShader = Shader::buildComputeShader(m_gl,
-            "D:/RoboticsSoftware/shaders/particle_update_comp.glsl"
-        );
-
-        m_particleRenderShader = std::make_unique<Shader>(m_gl,
-            "D:/RoboticsSoftware/shaders/particle_render_vert.glsl",
-            "D:/RoboticsSoftware/shaders/particle_render_frag.glsl"
-        );
-
-        m_flowVectorComputeShader = Shader::buildComputeShader(m_gl,
-            "D:/RoboticsSoftware/shaders/flow_vector_update_comp.glsl"
-        );
+        for (const auto& source : shaderProgramSources())
+            this->*source.slot = buildShaderProgram(source);
+        m_compute.initialize(m_gl, [this](ComputeDispatch::Kernel kernel, GLuint localSize) {
+            return buildComputeKernel(kernel, localSize);
+        });
     }
     catch (const std::runtime_error& e) {
         qFatal("[RenderingSystem] FATAL: Shader initialization failed: %s", e.what());
     }
+
+    // 64-bit atomics are extensions; without them splatting takes two passes.
+    m_pointSplat64Shader.reset();
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (ctx && ctx->hasExtension("GL_ARB_gpu_shader_int64") && ctx->hasExtension("GL_NV_shader_atomic_int64")) {
+        try {
+            m_pointSplat64Shader = Shader::buildComputeShader(m_gl, shaderPath("point_splat_int64_comp.glsl").c_str());
+        }
+        catch (const std::runtime_error& e) {
+            qWarning() << "[RenderingSystem] 64-bit point splatting unavailable:" << e.what();
+        }
+    }
+#if KR_SHADER_HOT_RELOAD
+    watchShaderSources();
+#endif
+    qDebug() << "[RenderingSystem] shaders ready in" << timer.elapsed() << "ms;"
+             << m_shaderBinaryCache.hits() << "cached," << m_shaderBinaryCache.misses() << "compiled";
     {
         GLint ok = 0, len = 0;
         m_gl->glGetProgramiv(m_compositeShader->ID, GL_LINK_STATUS, &ok);
@@ -1546,6 +4468,69 @@ void RenderingSystem::initShaders() {
     }
 }
 
+#if KR_SHADER_HOT_RELOAD
+void RenderingSystem::watchShaderSources()
+{
+    m_shaderWatcher = std::make_unique<QFileSystemWatcher>();
+    QSet<QString> files;
+    for (const auto& source : shaderProgramSources())
+        for (const auto& file : source.files) files.insert(QString::fromStdString(shaderPath(file)));
+    for (std::size_t k = 0; k < ComputeDispatch::kKernelCount; ++k)
+        files.insert(QString::fromStdString(shaderPath(ComputeDispatch::kernelFile(ComputeDispatch::Kernel(k)))));
+    for (const char* include : kShaderIncludes) files.insert(QString::fromStdString(shaderPath(include)));
+    m_shaderWatcher->addPaths(QStringList(files.begin(), files.end()));
+
+    QFileSystemWatcher* watcher = m_shaderWatcher.get();
+    QObject::connect(watcher, &QFileSystemWatcher::fileChanged, watcher, [this, watcher](const QString& path) {
+        m_changedShaderFiles.insert(QFileInfo(path).fileName());
+        // Editors that save by rename drop the watch; put it back.
+        if (!watcher->files().contains(path) && QFileInfo::exists(path)) watcher->addPath(path);
+        if (m_viewportWidget) m_viewportWidget->update();
+        });
+    qDebug() << "[RenderingSystem] watching" << files.size() << "shader files in" << KR_SHADER_SOURCE_DIR;
+}
+
+void RenderingSystem::reloadChangedShaders()
+{
+    if (m_changedShaderFiles.isEmpty()) return;
+    const QSet<QString> changed = std::exchange(m_changedShaderFiles, {});
+    // Which programs include a file is not tracked; a changed include rebuilds them all.
+    const bool all = std::any_of(std::begin(kShaderIncludes), std::end(kShaderIncludes),
+        [&](const char* f) { return changed.contains(QLatin1String(f)); });
+
+    for (const auto& source : shaderProgramSources()) {
+        const bool affected = all || std::any_of(source.files.begin(), source.files.end(),
+            [&](const std::string& f) { return changed.contains(QString::fromStdString(f)); });
+        if (!affected) continue;
+
+        // Build the replacement first so a typo keeps the last good program bound.
+        try {
+            this->*source.slot = buildShaderProgram(source);
+            qDebug() << "[RenderingSystem] reloaded" << source.files.back().c_str();
+        }
+        catch (const std::runtime_error& e) {
+            qWarning() << "[RenderingSystem] shader reload failed, keeping previous program:\n" << e.what();
+        }
+    }
+    // Post stack variants rebuild on their next use.
+    if (all || changed.contains(QStringLiteral("composite_frag.glsl")) || changed.contains(QStringLiteral("post_process_vert.glsl")))
+        m_postShaders.clear();
+    for (std::size_t k = 0; k < ComputeDispatch::kKernelCount; ++k) {
+        const auto kernel = ComputeDispatch::Kernel(k);
+        if (!all && !changed.contains(QLatin1String(ComputeDispatch::kernelFile(kernel)))) continue;
+        try {
+            m_compute.rebuild(kernel, [this](ComputeDispatch::Kernel kernel, GLuint localSize) {
+                return buildComputeKernel(kernel, localSize);
+            });
+            qDebug() << "[RenderingSystem] reloaded" << ComputeDispatch::kernelFile(kernel);
+        }
+        catch (const std::runtime_error& e) {
+            qWarning() << "[RenderingSystem] shader reload failed, keeping previous program:\n" << e.what();
+        }
+    }
+}
+#endif
+
 void RenderingSystem::dumpRenderTargets() const
 {
     // This function now finds the viewport widget for the current OpenGL context
@@ -1581,57 +4566,295 @@ void RenderingSystem::initFramebuffers(int width, int height) {
     //
 }
 
-void RenderingSystem::renderView(QOpenGLWidget* viewport, entt::registry& registry, entt::entity cameraEntity, int vpW, int vpH)
+void RenderingSystem::extractSnapshot(entt::registry& registry)
+{
+    KR_ZONE("extractSnapshot");
+    RenderSnapshotBuffer& buffer = m_snapshots[&registry];
+    buffer.setExtractFrames(m_showFrames);
+    buffer.extract(registry);
+
+    // Ranges no entity shows any more. Only free lists change, no GL call;
+    // a prefab part or collider with the same content re-uploads on use.
+    for (std::size_t key : MeshKeyRefs::of(registry).takeUnused()) m_meshArena.release(key);
+}
+
+void RenderingSystem::renderView(QOpenGLWidget* viewport, entt::registry& registry, entt::entity cameraEntity, int vpW, int vpH)
+{
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!ctx) return;
+    m_targets[viewport].widget = viewport;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    // Qt paints a stereo widget once per buffer. Both eyes are drawn on the
+    // left buffer's call; the right buffer's call finds its image done.
+    if (stereoActive(viewport)) {
+        if (viewport->currentTargetBuffer() == QOpenGLWidget::RightBuffer) return;
+        drawView(viewport, viewport->defaultFramebufferObject(QOpenGLWidget::LeftBuffer),
+            viewport->defaultFramebufferObject(QOpenGLWidget::RightBuffer), true, registry, cameraEntity, vpW, vpH);
+        return;
+    }
+#endif
+    drawView(viewport, ctx->defaultFramebufferObject(), 0, false, registry, cameraEntity, vpW, vpH);
+}
+
+void RenderingSystem::renderView(RenderTargetId targetId, GLuint outputFBO, entt::registry& registry, entt::entity cameraEntity, int vpW, int vpH)
+{
+    drawView(targetId, outputFBO, 0, false, registry, cameraEntity, vpW, vpH);
+}
+
+void RenderingSystem::renderStereoView(RenderTargetId targetId, GLuint leftFBO, GLuint rightFBO, entt::registry& registry,
+    entt::entity cameraEntity, int vpW, int vpH)
+{
+    const bool stereo = m_stereo && m_instancedPhongStereoShader;
+    drawView(targetId, leftFBO, rightFBO, stereo, registry, cameraEntity, vpW, vpH);
+}
+
+bool RenderingSystem::stereoActive(const QOpenGLWidget* viewport) const
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    return m_stereo && m_instancedPhongStereoShader && viewport && viewport->context()
+        && viewport->context()->format().stereo();
+#else
+    Q_UNUSED(viewport);
+    return false;   // QOpenGLWidget paints one buffer only before Qt 6.5
+#endif
+}
+
+void RenderingSystem::drawView(RenderTargetId targetId, GLuint outputFBO, GLuint rightOutputFBO, bool stereo,
+    entt::registry& registry, entt::entity cameraEntity, int vpW, int vpH)
 {
+    KR_ZONE("renderView");
     ensureGlResolved();
     if (!m_gl) return;
 
+#if KR_SHADER_HOT_RELOAD
+    reloadChangedShaders();
+#endif
+
+    // Qt and the widget issue their own GL calls between frames, and each
+    // viewport has its own context: start every view from unknown state.
+    m_state.setFunctions(m_gl);
+    m_state.invalidate();
+    GpuMemory::enforceBudget();
+
     m_currentCamera = cameraEntity;
     const auto& camera = registry.get<CameraComponent>(cameraEntity).camera;
 
-    // CORRECTED: Calculate deltaTime once per frame or get from a timer.
-    // For now, we'll assume a steady 60 FPS.
-    const float deltaTime = 1.0f / 60.0f;
-    m_elapsedTime += deltaTime;
+    // The main scene is extracted once per tick; anything else (the import
+    // preview) is small and has no tick of its own, so it extracts here.
+    if (auto it = m_snapshots.find(&registry); it != m_snapshots.end() && it->second.latest()) {
+        m_viewSnapshot = it->second.latest();
+    }
+    else {
+        m_paintSnapshot.extract(registry);
+        m_viewSnapshot = m_paintSnapshot.latest();
+    }
+    const RenderSnapshot& snapshot = *m_viewSnapshot;
+
+    // The extract built this camera's draw list; if its layers changed since
+    // (or it had none), filter here for this frame.
+    m_viewLayers = registry.get<CameraComponent>(cameraEntity).layerMask;
+    if (const RenderSnapshot::View* view = snapshot.viewOf(cameraEntity); view && view->mask == m_viewLayers) {
+        m_viewMeshes = &view->meshes;
+    }
+    else {
+        m_viewMeshScratch.clear();
+        for (std::size_t i = 0; i < snapshot.meshes.size(); ++i)
+            if (inView(snapshot.meshes[i])) m_viewMeshScratch.push_back(std::uint32_t(i));
+        m_viewMeshes = &m_viewMeshScratch;
+    }
+
+    // Measured once per master tick by MainWindow; both viewports see the same clock.
+    const float deltaTime = m_frameDelta;
 
 
     //! Get or create the dedicated framebuffer set for the currently rendering viewport.
-    TargetFBOs& target = m_targets[viewport];
+    TargetFBOs& target = m_targets[targetId];
+
+    // The dynamic resolution controller reads the timings harvested here.
+    GpuProfiler* prof = (m_profiling || m_dynamicResolution) ? &target.profiler : nullptr;
+    if (prof) {
+        if (m_profileCapture && !prof->capturing()) prof->setCapturing(true); // viewport added mid-capture
+        prof->beginFrame(m_gl);
+    }
+    if (m_glCaptureFrames > 0 || target.debugLogger) updateGlCapture(target, targetId);
 
     //! Check if FBOs need to be created or resized for this viewport.
-    if (target.mainFBO == 0 || vpW > target.w || vpH > target.h) {
-        initOrResizeFBOsForTarget(target, vpW, vpH);
+    //! Sized for the full output, so a render scale change never reallocates.
+    const bool reverseZ = reverseZActive();
+    const GLenum depthFormat = reverseZ ? GL_DEPTH32F_STENCIL8 : GL_DEPTH24_STENCIL8;
+    vpW = std::max(1, vpW);
+    vpH = std::max(1, vpH);
+    // A dock drag or resize only needs the reduced view to fit, not the full one.
+    const bool interacting = !stereo && m_layoutInteraction && target.widget && target.mainFBO != 0;
+    const float interactionScale = std::min(target.renderScale, m_minRenderScale);
+    const bool sizeFits = interacting
+        ? target.w >= std::max(1, int(std::lround(vpW * interactionScale)))
+            && target.h >= std::max(1, int(std::lround(vpH * interactionScale)))
+        : targetFits(target.w, vpW) && targetFits(target.h, vpH);
+    if (target.mainFBO == 0 || !sizeFits
+        || target.depthFormat != depthFormat || (target.idTexture != 0) != m_idBufferPicking
+        || target.msaaSamples != activeMsaaSamples()) {
+        initOrResizeFBOsForTarget(target, targetBucket(vpW), targetBucket(vpH));
+    }
+
+    // Headless targets are output, not interaction: always full resolution.
+    if (interacting) {
+        // Timings of these frames say nothing about the controller's scale.
+        target.scaleHoldFrames = std::max(target.scaleHoldFrames, 2 * GpuProfiler::kSlots);
+        target.drawnScale = interactionScale;
+    }
+    else {
+        if (m_dynamicResolution && target.widget && !stereo) updateRenderScale(target);
+        else target.renderScale = 1.0f;
+        target.drawnScale = target.fullResolutionOnce ? 1.0f : target.renderScale;
+        target.fullResolutionOnce = false;
+    }
+    target.viewW = std::max(1, int(std::lround(vpW * target.drawnScale)));
+    target.viewH = std::max(1, int(std::lround(vpH * target.drawnScale)));
+
+    if (stereo) {
+        renderStereo(target, outputFBO, rightOutputFBO, registry, camera, vpW, vpH, deltaTime, prof);
+        return;
     }
 
     // --- 1. Bind and Clear this Viewport's Framebuffer ---
-    m_gl->glBindFramebuffer(GL_FRAMEBUFFER, target.mainFBO);
-    m_gl->glViewport(0, 0, target.w, target.h); // Use the FBO's allocated size
+    m_state.bindFramebuffer(target.sceneFBO());
+    m_gl->glViewport(0, 0, target.viewW, target.viewH); // Only the corner this view covers
 
     resetGLState();
+    applyDepthConvention(reverseZ);
 
     const auto& props = registry.ctx().get<SceneProperties>();
     m_gl->glClearColor(props.backgroundColor.r, props.backgroundColor.g, props.backgroundColor.b, props.backgroundColor.a);
     m_gl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
     // --- 2. Main Scene Pass ---
-    m_gl->glEnable(GL_DEPTH_TEST);
-    m_gl->glDepthMask(GL_TRUE);
+    m_state.setDepthTest(true);
+    m_state.setDepthMask(true);
 
-    float aspect = (vpH > 0) ? static_cast<float>(vpW) / vpH : 1.0f;
+    const bool windowed = m_window.z > 0 && m_window.w > 0 && m_windowFull.x > 0 && m_windowFull.y > 0;
+    float aspect = windowed ? float(m_windowFull.x) / float(m_windowFull.y) : (vpH > 0) ? static_cast<float>(vpW) / vpH : 1.0f;
     glm::mat4 view = camera.getViewMatrix();
-    glm::mat4 projection = camera.getProjectionMatrix(aspect);
+    glm::mat4 projection = camera.getProjectionMatrix(aspect, reverseZ);
+    if (windowed) {
+        // Scale and shift the window's part of NDC onto the whole of it.
+        const glm::vec2 full(m_windowFull), size(m_window.z, m_window.w);
+        const glm::vec2 lo(2.0f * float(m_window.x) / full.x - 1.0f, 1.0f - 2.0f * float(m_window.y + m_window.w) / full.y);
+        const glm::vec2 hi = lo + 2.0f * size / full;
+        glm::mat4 crop(1.0f);
+        crop[0][0] = 2.0f / (hi.x - lo.x);
+        crop[1][1] = 2.0f / (hi.y - lo.y);
+        crop[3][0] = -(hi.x + lo.x) / (hi.x - lo.x) + 2.0f * m_windowJitter.x / size.x;
+        crop[3][1] = -(hi.y + lo.y) / (hi.y - lo.y) - 2.0f * m_windowJitter.y / size.y;
+        projection = crop * projection;
+    }
     glm::vec3 camPos = camera.getPosition();
+    m_eye = camera.worldPosition();
+    const glm::mat4 viewProjection = projection * view;
+    const bool temporal = m_antiAliasing == AntiAliasing::Taa && m_taaResolveShader;
+    if (temporal) projection = temporalJitter(target) * projection;
+    else target.taaValid = false;
+
+    // Pixel sizes (line widths, outline widths, tessellation density) are
+    // meant on screen, so the uniforms carry the output size, not viewW/viewH.
+    uploadFrameUniforms(view, camera.getEyeViewMatrix(), projection, camPos, vpW, vpH, deltaTime);
+    m_frustum = CullingSystem::extractFrustum(projection * view);
+    m_lodPixelScale = projection[1][1] * 0.5f * float(vpH);
+    m_lodOrthographic = projection[3][3] != 0.0f;
+
+    // Perform all render passes into the dedicated FBO. Only the mesh pass
+    // writes the ID attachment; the other passes would leave it undefined.
+    if (target.idTexture) {
+        const GLenum both[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        const GLuint noEntity[4] = { 0, 0, 0, 0 };
+        m_gl->glDrawBuffers(2, both);
+        m_gl->glClearBufferuiv(GL_COLOR, 1, noEntity);
+    }
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "virtual sensors");
+        simulateVirtualSensors(registry, snapshot, target);
+    }
+    updateReconstruction(registry, prof);   // scopes its own passes, one per ICP iteration
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "lights");
+        cullLights(snapshot, projection);
+    }
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "shadows");
+        renderShadows(registry, snapshot, view, projection, camPos, target);
+    }
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "meshes");
+        renderMeshes(snapshot, view, projection, camPos, target);
+    }
+    if (target.idTexture) {
+        const GLenum colorOnly = GL_COLOR_ATTACHMENT0;
+        m_gl->glDrawBuffers(1, &colorOnly);
+        issuePickRead(target);
+    }
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "pointClouds");
+        renderPointClouds(registry, camPos, projection, target);
+    }
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "sensors");
+        renderSensorStreams(registry, target.drawnScale);
+    }
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "grid");
+        renderGrid(registry, view, projection, camPos);
+    }
+    {
+        // Sections of the meshes with grids that show them, from the tick.
+        GpuProfiler::Scope scope(prof, m_gl, "intersections");
+        drawIntersections(IntersectionSystem::outlines(registry), IntersectionSystem::generation(registry));
+    }
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "splines");
+        renderSplines(registry, view, projection, camPos, vpW, vpH);
+    }
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "frames");
+        renderFrames(snapshot);
+    }
+    {
+        // Last of the scene passes: nothing drawn after it would show behind a ghost.
+        GpuProfiler::Scope scope(prof, m_gl, "ghosts");
+        renderGhosts(snapshot);
+    }
+    {
+        // Compute once per tick, in whichever viewport gets here first.
+        GpuProfiler::Scope scope(prof, m_gl, "fieldSimulation");
+        simulateFieldVisualizers(registry);
+    }
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "fieldVisualizers");
+        renderFieldVisualizers(registry, view, projection);
+    }
+    {
+        // Over everything in the scene, so a label is never hidden behind its robot.
+        GpuProfiler::Scope scope(prof, m_gl, "labels");
+        renderLabels(snapshot);
+    }
 
-    // Perform all render passes into the dedicated FBO
-    renderMeshes(registry, view, projection, camPos);
-    renderGrid(registry, view, projection, camPos);
-    renderSplines(registry, view, projection, camPos, target.w, target.h);
-
-    // Pass deltaTime to the visualizer
-    renderFieldVisualizers(registry, view, projection, deltaTime);
+    if (target.msaaSamples) {
+        GpuProfiler::Scope scope(prof, m_gl, "msaaResolve");
+        resolveMsaa(target, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    }
 
     //! The glow pass now needs to know which FBO set to use.
-    renderSelectionGlow(viewport, registry, view, projection, target);
+    GLuint glowTexture = 0;
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "selection");
+        if (m_selectionStyle == SelectionStyle::StencilOutline && m_selectionOutlineShader)
+            renderSelectionOutline(snapshot, target);
+        else
+            glowTexture = renderSelectionGlow(targetId, snapshot, view, projection, target);
+    }
+    if (m_selectionOutlineShader) {
+        GpuProfiler::Scope scope(prof, m_gl, "contacts");
+        renderContactOutline(snapshot, target);
+    }
 
     // --- 3. Final Composite to Screen ---
     QOpenGLContext* ctx = QOpenGLContext::currentContext();
@@ -1642,98 +4865,841 @@ void RenderingSystem::renderView(QOpenGLWidget* viewport, entt::registry& regist
         m_gl->glGenVertexArrays(1, &primitives.compositeVAO);
     }
 
-    m_gl->glBindFramebuffer(GL_FRAMEBUFFER, ctx->defaultFramebufferObject());
-    m_gl->glViewport(0, 0, vpW, vpH); // Set viewport to the actual window size
+    GLuint sceneTexture = target.mainColorTexture;
+    if (temporal) {
+        GpuProfiler::Scope scope(prof, m_gl, "taaResolve");
+        sceneTexture = resolveTemporal(target, viewProjection, projection * view, primitives.compositeVAO);
+    }
+    GpuProfiler::Scope compositeScope(prof, m_gl, "composite");
+
+    m_state.bindFramebuffer(outputFBO);
+    m_gl->glViewport(0, 0, vpW, vpH); // Set viewport to the actual output size
 
-    m_gl->glDisable(GL_DEPTH_TEST);
-    m_gl->glDepthMask(GL_FALSE);
-    m_gl->glDisable(GL_BLEND);
+    m_state.setDepthTest(false);
+    m_state.setDepthMask(false);
+    m_state.setBlend(false);
     m_gl->glEnable(GL_FRAMEBUFFER_SRGB);
 
-    m_compositeShader->use();
-    m_compositeShader->setInt("sceneTexture", 0);
-    m_compositeShader->setInt("glowTexture", 1);
-
+    std::uint32_t effects = m_postEffects;
+    if (glowTexture == 0) effects &= ~std::uint32_t(PostGlow);
+    if (target.drawnScale < 1.0f) effects |= kPostBicubic;
+    if (m_antiAliasing == AntiAliasing::Fxaa) effects |= kPostFxaa;
+    Shader& post = *postShader(effects);
+    m_state.use(post);
+    post.setVec2("u_uvScale", targetUvScale(target));
+    post.setInt("sceneTexture", 0);
     m_gl->glActiveTexture(GL_TEXTURE0);
-    //! Use the color texture from this viewport's dedicated FBO
-    m_gl->glBindTexture(GL_TEXTURE_2D, target.mainColorTexture);
-
-    m_gl->glActiveTexture(GL_TEXTURE1);
-    //! Use the blurred glow texture from this viewport's dedicated FBO
-    m_gl->glBindTexture(GL_TEXTURE_2D, target.pingpongTexture[0]);
+    m_gl->glBindTexture(GL_TEXTURE_2D, sceneTexture);
+
+    if (effects & PostGlow) {
+        // The mip chain sums all three levels back into the half-resolution one.
+        post.setInt("glowTexture", 1);
+        post.setFloat("glowIntensity", glowTexture == target.bloomTexture[0] ? 1.0f / TargetFBOs::kBloomLevels : 1.0f);
+        m_gl->glActiveTexture(GL_TEXTURE1);
+        m_gl->glBindTexture(GL_TEXTURE_2D, glowTexture);
+    }
+    if (effects & PostFog) {
+        post.setInt("u_depth", 2);
+        post.setMat4("u_inverseProjection", glm::inverse(projection));
+        post.setBool("u_reverseZ", reverseZ);
+        post.setVec3("u_fogColor", m_fogColor);
+        post.setFloat("u_fogDensity", m_fogDensity);
+        m_gl->glActiveTexture(GL_TEXTURE2);
+        m_gl->glBindTexture(GL_TEXTURE_2D, target.mainDepthTexture);
+    }
+    if (effects & PostVignette) post.setFloat("u_vignette", m_vignette);
 
-    m_gl->glBindVertexArray(primitives.compositeVAO);
+    m_state.bindVertexArray(primitives.compositeVAO);
     m_gl->glDrawArrays(GL_TRIANGLES, 0, 3);
+    RenderStats::draw();
+    if (prof) prof->endFrame(m_gl);
 
     // --- 4. Restore State for Next Viewport ---
-    m_gl->glBindVertexArray(0);
+    m_viewSnapshot.reset();
+    restoreDepthConvention(reverseZ);
+    m_state.bindVertexArray(0);
+    m_gl->glDisable(GL_FRAMEBUFFER_SRGB);
+    m_state.setDepthTest(true);
+    m_state.setDepthMask(true);
+    m_gl->glActiveTexture(GL_TEXTURE0);
+}
+
+void RenderingSystem::renderStereo(TargetFBOs& target, GLuint leftFBO, GLuint rightFBO, entt::registry& registry,
+    const Camera& camera, int vpW, int vpH, float deltaTime, GpuProfiler* prof)
+{
+    const RenderSnapshot& snapshot = *m_viewSnapshot;
+    const bool reverseZ = reverseZActive();
+    ensureStereoTarget(target);
+    target.taaValid = false;
+
+    // --- 1. The eyes: the camera moved half the separation along its right
+    //        axis either way, the frusta sheared to meet at the convergence
+    //        distance. Eye-relative positions stay relative to the centre. ---
+    struct Eye { glm::mat4 view, eyeView, projection; Frustum frustum; };
+    const float aspect = float(vpW) / float(vpH);
+    const glm::mat4 view = camera.getViewMatrix();
+    const glm::mat4 eyeView = camera.getEyeViewMatrix();
+    const glm::mat4 projection = camera.getProjectionMatrix(aspect, reverseZ);
+    const glm::vec3 camPos = camera.getPosition();
+    m_eye = camera.worldPosition();
+    Eye eyes[2];
+    for (int e = 0; e < 2; ++e) {
+        const float shift = (e == 0 ? -0.5f : 0.5f) * m_eyeSeparation;
+        const glm::mat4 offset = glm::translate(glm::mat4(1.0f), glm::vec3(-shift, 0.0f, 0.0f));
+        eyes[e].view = offset * view;
+        eyes[e].eyeView = offset * eyeView;
+        eyes[e].projection = projection;
+        if (projection[3][3] == 0.0f)   // orthographic eyes see no parallax to converge
+            eyes[e].projection[2][0] -= projection[0][0] * shift / m_stereoConvergence;
+        eyes[e].frustum = CullingSystem::extractFrustum(eyes[e].projection * eyes[e].view);
+        m_stereoEyeViewProjection[e] = eyes[e].projection * eyes[e].eyeView;
+    }
+
+    // --- 2. Shared: the centre camera's uniforms, culling that keeps what
+    //        either eye sees, and one submission drawn into both layers ---
+    m_stereoFrame = true;
+    uploadFrameUniforms(view, eyeView, projection, camPos, vpW, vpH, deltaTime);
+    m_frustum = eyes[0].frustum;
+    m_stereoFrustum = eyes[1].frustum;
+    m_lodPixelScale = projection[1][1] * 0.5f * float(vpH);
+    m_lodOrthographic = projection[3][3] != 0.0f;
+
+    target.stereoDrawFBO = target.stereoFBO;
+    m_state.bindFramebuffer(target.stereoFBO);
+    m_gl->glViewport(0, 0, target.viewW, target.viewH);
+    resetGLState();
+    applyDepthConvention(reverseZ);
+    const auto& props = registry.ctx().get<SceneProperties>();
+    m_gl->glClearColor(props.backgroundColor.r, props.backgroundColor.g, props.backgroundColor.b, props.backgroundColor.a);
+    m_gl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);   // both layers
+    m_state.setDepthTest(true);
+    m_state.setDepthMask(true);
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "virtual sensors");
+        simulateVirtualSensors(registry, snapshot, target);
+    }
+    updateReconstruction(registry, prof);
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "lights");
+        cullLights(snapshot, projection);
+    }
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "shadows");
+        renderShadows(registry, snapshot, view, projection, camPos, target);
+    }
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "meshes");
+        renderMeshes(snapshot, view, projection, camPos, target);
+    }
+    {
+        GpuProfiler::Scope scope(prof, m_gl, "fieldSimulation");
+        simulateFieldVisualizers(registry);
+    }
+
+    // --- 3. Per eye: the overlays, with that eye's uniforms and frustum ---
+    for (int e = 0; e < 2; ++e) {
+        const Eye& eye = eyes[e];
+        GpuProfiler::Scope scope(prof, m_gl, e == 0 ? "overlays (left)" : "overlays (right)");
+        target.stereoDrawFBO = target.stereoEyeFBO[e];
+        m_state.bindFramebuffer(target.stereoDrawFBO);
+        m_gl->glViewport(0, 0, target.viewW, target.viewH);
+        uploadFrameUniforms(eye.view, eye.eyeView, eye.projection, camPos, vpW, vpH, deltaTime);
+        m_frustum = m_stereoFrustum = eye.frustum;
+
+        renderPointClouds(registry, camPos, eye.projection, target);
+        renderSensorStreams(registry, target.drawnScale);
+        renderGrid(registry, eye.view, eye.projection, camPos);
+        drawIntersections(IntersectionSystem::outlines(registry), IntersectionSystem::generation(registry));
+        renderSplines(registry, eye.view, eye.projection, camPos, vpW, vpH);
+        renderFrames(snapshot);
+        renderGhosts(snapshot);
+        renderFieldVisualizers(registry, eye.view, eye.projection);
+        renderLabels(snapshot);
+        // Glow would blur each eye on its own; the outline stays crisp in both.
+        if (m_selectionOutlineShader) {
+            renderSelectionOutline(snapshot, target);
+            renderContactOutline(snapshot, target);
+        }
+    }
+    target.stereoDrawFBO = 0;
+    m_stereoFrame = false;
+
+    // --- 4. Composite each eye to its buffer ---
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!ctx) return;
+    auto& primitives = m_contextPrimitives[ctx];
+    if (primitives.compositeVAO == 0) {
+        m_gl->glGenVertexArrays(1, &primitives.compositeVAO);
+    }
+    GpuProfiler::Scope compositeScope(prof, m_gl, "composite");
+
+    m_state.setDepthTest(false);
+    m_state.setDepthMask(false);
+    m_state.setBlend(false);
+    m_gl->glEnable(GL_FRAMEBUFFER_SRGB);
+
+    std::uint32_t effects = m_postEffects & ~std::uint32_t(PostGlow);
+    if (m_antiAliasing == AntiAliasing::Fxaa) effects |= kPostFxaa;
+    Shader& post = *postShader(effects);
+    m_state.use(post);
+    post.setVec2("u_uvScale", targetUvScale(target));
+    post.setInt("sceneTexture", 0);
+    if (effects & PostFog) {
+        post.setInt("u_depth", 2);
+        post.setBool("u_reverseZ", reverseZ);
+        post.setVec3("u_fogColor", m_fogColor);
+        post.setFloat("u_fogDensity", m_fogDensity);
+    }
+    if (effects & PostVignette) post.setFloat("u_vignette", m_vignette);
+    m_state.bindVertexArray(primitives.compositeVAO);
+
+    // A native stereo window has one default framebuffer with two back buffers.
+    const bool backBuffers = leftFBO == 0 && rightFBO == 0;
+    for (int e = 0; e < 2; ++e) {
+        m_state.bindFramebuffer(e == 0 ? leftFBO : rightFBO);
+        if (backBuffers) m_gl->glDrawBuffer(e == 0 ? GL_BACK_LEFT : GL_BACK_RIGHT);
+        m_gl->glViewport(0, 0, vpW, vpH);
+        m_gl->glActiveTexture(GL_TEXTURE0);
+        m_gl->glBindTexture(GL_TEXTURE_2D, target.stereoEyeColor[e]);
+        if (effects & PostFog) {
+            post.setMat4("u_inverseProjection", glm::inverse(eyes[e].projection));
+            m_gl->glActiveTexture(GL_TEXTURE2);
+            m_gl->glBindTexture(GL_TEXTURE_2D, target.stereoEyeDepth[e]);
+        }
+        m_gl->glDrawArrays(GL_TRIANGLES, 0, 3);
+        RenderStats::draw();
+    }
+    if (backBuffers) m_gl->glDrawBuffer(GL_BACK);
+    if (prof) prof->endFrame(m_gl);
+
+    // --- 5. Restore State for Next Viewport, as renderView ---
+    m_viewSnapshot.reset();
+    restoreDepthConvention(reverseZ);
+    m_state.bindVertexArray(0);
     m_gl->glDisable(GL_FRAMEBUFFER_SRGB);
-    m_gl->glEnable(GL_DEPTH_TEST);
-    m_gl->glDepthMask(GL_TRUE);
+    m_state.setDepthTest(true);
+    m_state.setDepthMask(true);
     m_gl->glActiveTexture(GL_TEXTURE0);
 }
 
+void RenderingSystem::uploadFrameUniforms(const glm::mat4& view, const glm::mat4& eyeView, const glm::mat4& projection, const glm::vec3& camPos, int viewportWidth, int viewportHeight, float deltaTime)
+{
+    FrameUniformsGpu frame;
+    frame.view = view;
+    frame.eyeView = eyeView;
+    frame.projection = projection;
+    frame.cameraPos = glm::vec4(camPos, 1.0f);
+    frame.viewportTime = glm::vec4(float(viewportWidth), float(viewportHeight), m_elapsedTime, deltaTime);
+    frame.stereoEyeViewProjection[0] = m_stereoEyeViewProjection[0];
+    frame.stereoEyeViewProjection[1] = m_stereoEyeViewProjection[1];
+
+    if (m_frameUBO == 0) {
+        m_gl->glGenBuffers(1, &m_frameUBO);
+        m_gl->glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+        GpuMemory::bufferData(m_gl, GL_UNIFORM_BUFFER, m_frameUBO, sizeof(FrameUniformsGpu), nullptr, GL_DYNAMIC_DRAW,
+            GpuMemory::Category::Other);
+    }
+    m_gl->glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+    m_gl->glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniformsGpu), &frame);
+    RenderStats::upload(sizeof(FrameUniformsGpu));
+    m_gl->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // Binding points are per-context state, so bind on every view.
+    m_gl->glBindBufferBase(GL_UNIFORM_BUFFER, kFrameUniformsBinding, m_frameUBO);
+}
+
 void RenderingSystem::initOrResizeFBOsForTarget(TargetFBOs& target, int width, int height) {
     ensureGlResolved();
 
-    // First, delete old resources if they exist
-    if (target.mainFBO != 0) {
-        m_gl->glDeleteFramebuffers(1, &target.mainFBO);
-        m_gl->glDeleteTextures(1, &target.mainColorTexture);
-        m_gl->glDeleteTextures(1, &target.mainDepthTexture);
-        m_gl->glDeleteFramebuffers(1, &target.glowFBO);
-        m_gl->glDeleteTextures(1, &target.glowTexture);
-        m_gl->glDeleteFramebuffers(2, target.pingpongFBO);
-        m_gl->glDeleteTextures(2, target.pingpongTexture);
-    }
+    // The old attachments go back to the pool; the FBO objects are kept and
+    // only re-attached.
+    recycleTargetTextures(target);
+    destroyBloomChain(target); // recreated at the new size on next use
+    destroyOcclusion(target);
+    destroyMsaa(target);
+    m_state.invalidateBindings();
 
     target.w = width;
     target.h = height;
+    target.depthFormat = reverseZActive() ? GL_DEPTH32F_STENCIL8 : GL_DEPTH24_STENCIL8;
+
+    if (target.mainFBO == 0) {
+        m_gl->glGenFramebuffers(1, &target.mainFBO);
+        m_gl->glGenFramebuffers(1, &target.glowFBO);
+        m_gl->glGenFramebuffers(2, target.pingpongFBO);
+    }
 
     // Main Scene FBO
-    m_gl->glGenFramebuffers(1, &target.mainFBO);
-    m_gl->glBindFramebuffer(GL_FRAMEBUFFER, target.mainFBO);
-    m_gl->glGenTextures(1, &target.mainColorTexture);
-    m_gl->glBindTexture(GL_TEXTURE_2D, target.mainColorTexture);
-    m_gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    target.mainColorTexture = acquireTexture(GL_RGBA16F, width, height);
+    target.mainDepthTexture = acquireTexture(target.depthFormat, width, height);
+    target.idTexture = m_idBufferPicking ? acquireTexture(GL_R32UI, width, height) : 0;
+    m_state.bindFramebuffer(target.mainFBO);
     m_gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.mainColorTexture, 0);
-
-    m_gl->glGenTextures(1, &target.mainDepthTexture);
-    m_gl->glBindTexture(GL_TEXTURE_2D, target.mainDepthTexture);
-    m_gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
     m_gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, target.mainDepthTexture, 0);
-
+    m_gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, target.idTexture, 0);
     if (m_gl->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         qWarning() << "Main FBO not complete!";
 
+    // Multisampled twins of the main attachments, which then only receive resolves.
+    target.msaaSamples = activeMsaaSamples();
+    if (target.msaaSamples) {
+        auto multisample = [&](GLenum format, std::size_t bytesPerSample) {
+            GLuint id = 0;
+            m_gl->glGenTextures(1, &id);
+            m_gl->glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, id);
+            m_gl->glTexStorage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, target.msaaSamples, format, width, height, GL_TRUE);
+            GpuMemory::trackTexture(id, std::size_t(width) * height * bytesPerSample * target.msaaSamples,
+                GpuMemory::Category::RenderTargets);
+            return id;
+        };
+        target.msaaColor = multisample(GL_RGBA16F, 8);
+        target.msaaDepth = multisample(target.depthFormat, target.depthFormat == GL_DEPTH24_STENCIL8 ? 4 : 8);
+        target.msaaId = m_idBufferPicking ? multisample(GL_R32UI, 4) : 0;
+        m_gl->glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+        if (target.msaaFBO == 0) m_gl->glGenFramebuffers(1, &target.msaaFBO);
+        m_state.bindFramebuffer(target.msaaFBO);
+        m_gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, target.msaaColor, 0);
+        m_gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D_MULTISAMPLE, target.msaaDepth, 0);
+        m_gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D_MULTISAMPLE, target.msaaId, 0);
+        if (m_gl->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            qWarning() << "MSAA FBO not complete!";
+    }
+    target.taaValid = false;
+
     // Glow FBO
-    m_gl->glGenFramebuffers(1, &target.glowFBO);
-    m_gl->glBindFramebuffer(GL_FRAMEBUFFER, target.glowFBO);
-    m_gl->glGenTextures(1, &target.glowTexture);
-    m_gl->glBindTexture(GL_TEXTURE_2D, target.glowTexture);
-    m_gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    target.glowTexture = acquireTexture(GL_RGBA16F, width, height);
+    m_state.bindFramebuffer(target.glowFBO);
     m_gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.glowTexture, 0);
     if (m_gl->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         qWarning() << "Glow FBO not complete!";
 
     // Ping-Pong FBOs for Blurring
-    m_gl->glGenFramebuffers(2, target.pingpongFBO);
-    m_gl->glGenTextures(2, target.pingpongTexture);
     for (unsigned int i = 0; i < 2; i++) {
-        m_gl->glBindFramebuffer(GL_FRAMEBUFFER, target.pingpongFBO[i]);
-        m_gl->glBindTexture(GL_TEXTURE_2D, target.pingpongTexture[i]);
-        m_gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        target.pingpongTexture[i] = acquireTexture(GL_RGBA16F, width, height);
+        m_state.bindFramebuffer(target.pingpongFBO[i]);
         m_gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.pingpongTexture[i], 0);
         if (m_gl->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
             qWarning() << "Pingpong FBO " << i << " not complete!";
     }
 
-    m_gl->glBindFramebuffer(GL_FRAMEBUFFER, 0); // Unbind FBO
+    m_state.bindFramebuffer(0); // Unbind FBO
+    KR_TRACE(Frame) << "Target resized to" << width << "x" << height
+        << "- pooled textures:" << m_texturePool.size();
+}
+
+void RenderingSystem::recycleTargetTextures(TargetFBOs& target)
+{
+    recycleTexture(target.mainColorTexture, GL_RGBA16F, target.w, target.h);
+    recycleTexture(target.mainDepthTexture, target.depthFormat, target.w, target.h);
+    recycleTexture(target.idTexture, GL_R32UI, target.w, target.h);
+    recycleTexture(target.glowTexture, GL_RGBA16F, target.w, target.h);
+    for (GLuint& texture : target.pingpongTexture)
+        recycleTexture(texture, GL_RGBA16F, target.w, target.h);
+    for (GLuint& texture : target.taaHistory)
+        recycleTexture(texture, GL_RGBA16F, target.w, target.h);
+}
+
+int RenderingSystem::activeMsaaSamples() const
+{
+    if (m_antiAliasing != AntiAliasing::Msaa || m_maxMsaaSamples < 2) return 0;
+    return std::min(m_msaaSamples, int(m_maxMsaaSamples));
+}
+
+void RenderingSystem::destroyMsaa(TargetFBOs& target)
+{
+    for (GLuint* texture : { &target.msaaColor, &target.msaaDepth, &target.msaaId }) {
+        if (*texture) GpuMemory::deleteTextures(m_gl, 1, texture);
+        *texture = 0;
+    }
+    target.msaaSamples = 0;   // the FBO is kept for the next size
+}
+
+void RenderingSystem::resolveMsaa(TargetFBOs& target, GLbitfield buffers, GLenum attachment)
+{
+    m_state.bindFramebuffer(target.mainFBO);
+    m_gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, target.msaaFBO);
+    if (attachment != GL_COLOR_ATTACHMENT0) {
+        m_gl->glReadBuffer(attachment);
+        m_gl->glDrawBuffers(1, &attachment);
+    }
+    m_gl->glBlitFramebuffer(0, 0, target.viewW, target.viewH, 0, 0, target.viewW, target.viewH, buffers, GL_NEAREST);
+    if (attachment != GL_COLOR_ATTACHMENT0) {
+        const GLenum colour = GL_COLOR_ATTACHMENT0;
+        m_gl->glReadBuffer(colour);
+        m_gl->glDrawBuffers(1, &colour);
+    }
+    m_gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, target.mainFBO);
+}
+
+glm::mat4 RenderingSystem::temporalJitter(const TargetFBOs& target) const
+{
+    // A pixel is 2 / size wide in NDC; the translation moves the image, not the camera.
+    const int phase = int(target.taaFrame % kTemporalJitterPhases) + 1;
+    const glm::vec2 pixels(halton(phase, 2) - 0.5f, halton(phase, 3) - 0.5f);
+    return glm::translate(glm::mat4(1.0f), glm::vec3(pixels * 2.0f / glm::vec2(target.viewW, target.viewH), 0.0f));
+}
+
+GLuint RenderingSystem::resolveTemporal(TargetFBOs& target, const glm::mat4& viewProjection,
+    const glm::mat4& jitteredViewProjection, GLuint compositeVAO)
+{
+    if (target.taaHistory[0] == 0) {
+        for (GLuint& texture : target.taaHistory) texture = acquireTexture(GL_RGBA16F, target.w, target.h);
+        target.taaValid = false;
+    }
+    if (target.taaFBO == 0) m_gl->glGenFramebuffers(1, &target.taaFBO);
+
+    const int next = 1 - target.taaCurrent;
+    m_state.bindFramebuffer(target.taaFBO);
+    m_gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.taaHistory[next], 0);
+    m_gl->glViewport(0, 0, target.viewW, target.viewH);
+    m_state.setDepthTest(false);
+    m_state.setDepthMask(false);
+    m_state.setBlend(false);
+
+    Shader& resolve = *m_taaResolveShader;
+    m_state.use(resolve);
+    resolve.setVec2("u_uvScale", targetUvScale(target));
+    resolve.setVec2("u_historyUvScale", glm::vec2(float(target.taaViewW) / float(target.w), float(target.taaViewH) / float(target.h)));
+    resolve.setMat4("u_reprojection", target.taaViewProjection * glm::inverse(jitteredViewProjection));
+    resolve.setBool("u_reverseZ", reverseZActive());
+    resolve.setFloat("u_feedback", target.taaValid ? 0.9f : 0.0f);
+    resolve.setInt("u_scene", 0);
+    resolve.setInt("u_depth", 1);
+    resolve.setInt("u_history", 2);
+    m_gl->glActiveTexture(GL_TEXTURE0);
+    m_gl->glBindTexture(GL_TEXTURE_2D, target.mainColorTexture);
+    m_gl->glActiveTexture(GL_TEXTURE1);
+    m_gl->glBindTexture(GL_TEXTURE_2D, target.mainDepthTexture);
+    m_gl->glActiveTexture(GL_TEXTURE2);
+    m_gl->glBindTexture(GL_TEXTURE_2D, target.taaHistory[target.taaCurrent]);
+    m_gl->glActiveTexture(GL_TEXTURE0);
+    m_state.bindVertexArray(compositeVAO);
+    m_gl->glDrawArrays(GL_TRIANGLES, 0, 3);
+    RenderStats::draw();
+
+    target.taaCurrent = next;
+    target.taaValid = true;
+    target.taaViewW = target.viewW;
+    target.taaViewH = target.viewH;
+    target.taaViewProjection = viewProjection;
+    ++target.taaFrame;
+    return target.taaHistory[next];
+}
+
+GLuint RenderingSystem::acquireTexture(GLenum format, int w, int h)
+{
+    for (auto it = m_texturePool.begin(); it != m_texturePool.end(); ++it) {
+        if (it->format == format && it->w == w && it->h == h) {
+            const GLuint id = it->id;
+            m_texturePool.erase(it);
+            return id;
+        }
+    }
+
+    GLuint id = 0;
+    m_gl->glGenTextures(1, &id);
+    m_gl->glBindTexture(GL_TEXTURE_2D, id);
+    std::size_t bytesPerPixel = 8;   // RGBA16F, D32F_S8
+    switch (format) {
+    case GL_R32UI:
+        m_gl->glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+        bytesPerPixel = 4;
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        break;
+    case GL_DEPTH24_STENCIL8:
+        m_gl->glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+        bytesPerPixel = 4;
+        // Complete without mips: the Hi-Z build fetches from it.
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        break;
+    case GL_DEPTH32F_STENCIL8:
+        m_gl->glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0, GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, NULL);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        break;
+    default:
+        m_gl->glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0, GL_RGBA, GL_FLOAT, NULL);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        break;
+    }
+    m_gl->glBindTexture(GL_TEXTURE_2D, 0);
+    GpuMemory::trackTexture(id, std::size_t(w) * h * bytesPerPixel, GpuMemory::Category::RenderTargets);
+    return id;
+}
+
+void RenderingSystem::recycleTexture(GLuint& texture, GLenum format, int w, int h)
+{
+    if (texture == 0) return;
+    // Oldest first out: the pool only bridges resizes and viewport churn.
+    if (m_texturePool.size() == kTexturePoolSize) {
+        GpuMemory::deleteTextures(m_gl, 1, &m_texturePool.front().id);
+        m_texturePool.erase(m_texturePool.begin());
+    }
+    m_texturePool.push_back({ texture, format, w, h });
+    texture = 0;
+}
+
+// --- ID-buffer picking ---
+
+void RenderingSystem::setIdBufferPicking(bool on)
+{
+    if (m_idBufferPicking == on) return;
+    m_idBufferPicking = on;
+    // Every target adds or drops its ID attachment on its next renderView.
+}
+
+void RenderingSystem::requestPick(QOpenGLWidget* viewport, int x, int y, int w, int h)
+{
+    TargetFBOs& target = m_targets[viewport];
+    target.pickRequested = true;
+    target.pickX = x;
+    target.pickY = y;
+    target.pickW = std::max(1, w);
+    target.pickH = std::max(1, h);
+}
+
+void RenderingSystem::issuePickRead(TargetFBOs& target)
+{
+    if (!target.pickRequested || target.pickFence || !target.widget) return;   // one read in flight per viewport
+    target.pickRequested = false;
+
+    // The drawn region is composited onto the whole widget, so map by fraction.
+    const float sx = float(target.viewW) / std::max(1, target.widget->width());
+    const float sy = float(target.viewH) / std::max(1, target.widget->height());
+    const int x0 = std::clamp(int(target.pickX * sx), 0, target.viewW - 1);
+    const int x1 = std::clamp(int((target.pickX + target.pickW) * sx), x0 + 1, target.viewW);
+    const int yTop = std::clamp(int(target.pickY * sy), 0, target.viewH - 1);
+    const int yBottom = std::clamp(int((target.pickY + target.pickH) * sy), yTop + 1, target.viewH);
+    target.readW = x1 - x0;
+    target.readH = yBottom - yTop;
+
+    const GLsizeiptr bytes = GLsizeiptr(target.readW) * target.readH * sizeof(std::uint32_t);
+    if (target.pickPBO == 0) m_gl->glGenBuffers(1, &target.pickPBO);
+    m_gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, target.pickPBO);
+    if (bytes > target.pickPBOSize) {
+        GpuMemory::bufferData(m_gl, GL_PIXEL_PACK_BUFFER, target.pickPBO, bytes, nullptr, GL_STREAM_READ, GpuMemory::Category::Readback);
+        target.pickPBOSize = bytes;
+    }
+
+    // Multisampled IDs cannot be read directly; the blit keeps one sample's.
+    if (target.msaaSamples) resolveMsaa(target, GL_COLOR_BUFFER_BIT, GL_COLOR_ATTACHMENT1);
+    m_gl->glReadBuffer(GL_COLOR_ATTACHMENT1);
+    m_gl->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    m_gl->glReadPixels(x0, target.viewH - yBottom, target.readW, target.readH, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    m_gl->glReadBuffer(GL_COLOR_ATTACHMENT0);
+    m_gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (target.msaaSamples) m_state.bindFramebuffer(target.msaaFBO);
+
+    target.pickFence = m_gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool RenderingSystem::takePickResult(QOpenGLWidget* viewport, std::vector<entt::entity>& entities)
+{
+    auto it = m_targets.find(viewport);
+    if (it == m_targets.end() || !it->second.pickFence || !m_gl) return false;
+    TargetFBOs& target = it->second;
+
+    if (m_gl->glClientWaitSync(target.pickFence, 0, 0) == GL_TIMEOUT_EXPIRED) return false;
+    m_gl->glDeleteSync(target.pickFence);
+    target.pickFence = nullptr;
+
+    const std::size_t count = std::size_t(target.readW) * target.readH;
+    entities.clear();
+    m_gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, target.pickPBO);
+    if (const auto* ids = static_cast<const std::uint32_t*>(m_gl->glMapBufferRange(
+            GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(count * sizeof(std::uint32_t)), GL_MAP_READ_BIT))) {
+        std::vector<std::uint32_t> unique(ids, ids + count);
+        std::sort(unique.begin(), unique.end());
+        unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+        for (std::uint32_t id : unique)
+            if (id != 0) entities.push_back(entt::entity(id - 1u));
+        m_gl->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    m_gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void RenderingSystem::ensureStereoTarget(TargetFBOs& target)
+{
+    // As large as the mono attachments, so a resize reallocates both.
+    if (target.stereoColor && target.stereoW == target.w && target.stereoH == target.h
+        && target.stereoDepthFormat == target.depthFormat) return;
+    destroyStereo(target);
+    target.stereoW = target.w;
+    target.stereoH = target.h;
+    target.stereoDepthFormat = target.depthFormat;
+
+    // Immutable, so each layer can have a plain 2D view for the composite.
+    auto layers = [&](GLenum format, std::size_t bytesPerPixel) {
+        GLuint id = 0;
+        m_gl->glGenTextures(1, &id);
+        m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+        m_gl->glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, format, target.w, target.h, 2);
+        GpuMemory::trackTexture(id, std::size_t(target.w) * target.h * bytesPerPixel * 2, GpuMemory::Category::RenderTargets);
+        return id;
+    };
+    target.stereoColor = layers(GL_RGBA16F, 8);
+    target.stereoDepth = layers(target.depthFormat, target.depthFormat == GL_DEPTH24_STENCIL8 ? 4 : 8);
+    m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    m_gl->glGenFramebuffers(1, &target.stereoFBO);
+    m_state.bindFramebuffer(target.stereoFBO);
+    m_gl->glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target.stereoColor, 0);   // layered
+    m_gl->glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, target.stereoDepth, 0);
+    if (m_gl->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        qWarning() << "Stereo FBO not complete!";
+
+    m_gl->glGenFramebuffers(2, target.stereoEyeFBO);
+    m_gl->glGenTextures(2, target.stereoEyeColor);
+    m_gl->glGenTextures(2, target.stereoEyeDepth);
+    for (int e = 0; e < 2; ++e) {
+        m_state.bindFramebuffer(target.stereoEyeFBO[e]);
+        m_gl->glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target.stereoColor, 0, e);
+        m_gl->glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, target.stereoDepth, 0, e);
+        if (m_gl->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            qWarning() << "Stereo eye FBO " << e << " not complete!";
+
+        m_gl->glTextureView(target.stereoEyeColor[e], GL_TEXTURE_2D, target.stereoColor, GL_RGBA16F, 0, 1, e, 1);
+        m_gl->glTextureView(target.stereoEyeDepth[e], GL_TEXTURE_2D, target.stereoDepth, target.depthFormat, 0, 1, e, 1);
+        m_gl->glBindTexture(GL_TEXTURE_2D, target.stereoEyeColor[e]);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        m_gl->glBindTexture(GL_TEXTURE_2D, target.stereoEyeDepth[e]);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        m_gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    m_gl->glBindTexture(GL_TEXTURE_2D, 0);
+    m_state.bindFramebuffer(0);
+}
+
+void RenderingSystem::destroyStereo(TargetFBOs& target)
+{
+    if (target.stereoFBO == 0) return;
+    m_gl->glDeleteFramebuffers(1, &target.stereoFBO);
+    m_gl->glDeleteFramebuffers(2, target.stereoEyeFBO);
+    m_gl->glDeleteTextures(2, target.stereoEyeColor);   // views: the arrays hold the memory
+    m_gl->glDeleteTextures(2, target.stereoEyeDepth);
+    GpuMemory::deleteTextures(m_gl, 1, &target.stereoColor);
+    GpuMemory::deleteTextures(m_gl, 1, &target.stereoDepth);
+    target.stereoFBO = target.stereoColor = target.stereoDepth = 0;
+    for (int e = 0; e < 2; ++e)
+        target.stereoEyeFBO[e] = target.stereoEyeColor[e] = target.stereoEyeDepth[e] = 0;
+    target.stereoW = target.stereoH = 0;
+    m_state.invalidateBindings();
+}
+
+void RenderingSystem::destroyTarget(TargetFBOs& target)
+{
+    m_gl->glDeleteFramebuffers(1, &target.mainFBO);
+    m_gl->glDeleteFramebuffers(1, &target.glowFBO);
+    m_gl->glDeleteFramebuffers(2, target.pingpongFBO);
+    if (target.msaaFBO) m_gl->glDeleteFramebuffers(1, &target.msaaFBO);
+    if (target.taaFBO) m_gl->glDeleteFramebuffers(1, &target.taaFBO);
+    recycleTargetTextures(target);
+    destroyMsaa(target);
+    destroyBloomChain(target);
+    destroyOcclusion(target);
+    destroyShadows(target);
+    destroyStereo(target);
+    if (target.visibilityBuffer) GpuMemory::deleteBuffers(m_gl, 1, &target.visibilityBuffer);
+    if (target.pickPBO) GpuMemory::deleteBuffers(m_gl, 1, &target.pickPBO);
+    if (target.pickFence) m_gl->glDeleteSync(target.pickFence);
+    target.profiler.destroy(m_gl);
+    delete target.debugLogger;
+    target = TargetFBOs{};
+}
+
+void RenderingSystem::releaseTarget(RenderTargetId targetId)
+{
+    auto it = m_targets.find(targetId);
+    if (it == m_targets.end()) return;
+    ensureGlResolved();
+    if (m_gl) destroyTarget(it->second);
+    m_targets.erase(it);
+}
+
+// --- Diagnostic GL capture ---
+
+void RenderingSystem::startGlCapture(int frames, const QString& path)
+{
+    if (frames <= 0) return;
+    if (m_glCaptureFrames == 0) {
+        m_profilingBeforeGlCapture = m_profiling;
+        std::lock_guard<std::mutex> lock(m_glMessageMutex);
+        m_glMessages.clear();
+        m_glMessagesDropped = 0;
+        m_glRecording = true;
+    }
+    m_glCaptureFrames = frames;
+    m_glCapturePath = path;
+    m_profiling = true;
+    setProfileCapture(true);
+    for (auto& [id, target] : m_targets) {
+        target.profiler.setDebugGroups(true);
+        target.debugLoggerTried = false;
+    }
+}
+
+void RenderingSystem::updateGlCapture(TargetFBOs& target, RenderTargetId targetId)
+{
+    if (m_glCaptureFrames == 0) {
+        // Stopped in advanceFrameTime(); the logger needs its context to go.
+        delete target.debugLogger;
+        target.debugLogger = nullptr;
+        target.debugLoggerTried = false;
+        target.profiler.setDebugGroups(false);
+        return;
+    }
+    target.profiler.setDebugGroups(true);
+    if (target.debugLogger || target.debugLoggerTried) return;
+    target.debugLoggerTried = true;
+
+    auto* logger = new QOpenGLDebugLogger();
+    if (!logger->initialize()) {   // no KHR_debug on this context
+        qWarning() << "[GlCapture] no debug output on this context; capturing timings only";
+        delete logger;
+        return;
+    }
+    // Direct: in asynchronous mode the driver may call back on its own thread.
+    QObject::connect(logger, &QOpenGLDebugLogger::messageLogged, logger,
+        [this, targetId](const QOpenGLDebugMessage& message) { recordGlMessage(targetId, message); }, Qt::DirectConnection);
+    // The pass groups are for external debuggers; the trace has the passes already.
+    logger->disableMessages(QOpenGLDebugMessage::AnySource,
+        QOpenGLDebugMessage::GroupPushType | QOpenGLDebugMessage::GroupPopType);
+    logger->startLogging(QOpenGLDebugLogger::AsynchronousLogging);
+    target.debugLogger = logger;
+    if (!QOpenGLContext::currentContext()->format().testOption(QSurfaceFormat::DebugContext))
+        qInfo() << "[GlCapture] not a debug context; run with KR_GL_DEBUG=1 for every driver message";
+}
+
+void RenderingSystem::recordGlMessage(RenderTargetId targetId, const QOpenGLDebugMessage& message)
+{
+    const double us = GpuProfiler::nowUs();
+    std::lock_guard<std::mutex> lock(m_glMessageMutex);
+    if (!m_glRecording) return;
+    if (m_glMessages.size() == kMaxGlMessages) {
+        ++m_glMessagesDropped;
+        return;
+    }
+    m_glMessages.push_back({ targetId, us, message.message(), int(message.severity()), int(message.type()),
+        int(message.source()), message.id() });
+}
+
+void RenderingSystem::finishGlCapture()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_glMessageMutex);
+        m_glRecording = false;
+    }
+    setProfileCapture(false);
+    m_profiling = m_profilingBeforeGlCapture;
+    if (writeProfileTrace(m_glCapturePath)) {
+        qInfo() << "[GlCapture]" << int(m_glMessages.size()) << "GL messages written to" << m_glCapturePath;
+        if (m_glMessagesDropped) qWarning() << "[GlCapture]" << int(m_glMessagesDropped) << "messages past the limit were dropped";
+    }
+    else {
+        qWarning() << "[GlCapture] could not write" << m_glCapturePath;
+    }
+}
+
+// --- Dynamic resolution ---
+
+void RenderingSystem::updateRenderScale(TargetFBOs& target)
+{
+    // Timings lag a few frames and are smoothed: after a change, wait until
+    // they describe the new scale before judging it.
+    if (target.scaleHoldFrames > 0) { --target.scaleHoldFrames; return; }
+    const double gpuMs = target.profiler.gpuFrameMs();
+    if (gpuMs <= 0.0) return;
+
+    // Fragment cost goes with the pixel count, i.e. the square of the scale.
+    constexpr float kStep = 0.05f;
+    float scale = target.renderScale;
+    if (gpuMs > m_gpuFrameBudgetMs) {
+        scale *= std::sqrt(float(m_gpuFrameBudgetMs / gpuMs));
+        scale = std::floor(scale / kStep) * kStep;
+    }
+    else if (gpuMs < 0.6 * m_gpuFrameBudgetMs) {
+        scale += kStep;   // creep back up; dropping is what must be fast
+    }
+    scale = std::clamp(scale, m_minRenderScale, 1.0f);
+    if (scale == target.renderScale) return;
+
+    KR_TRACE(Frame) << "Render scale" << target.renderScale << "->" << scale << "at" << gpuMs << "ms";
+    target.scaleHoldFrames = scale < target.renderScale ? 2 * GpuProfiler::kSlots : 6 * GpuProfiler::kSlots;
+    target.renderScale = scale;
+}
+
+float RenderingSystem::renderScale(RenderTargetId targetId) const
+{
+    auto it = m_targets.find(targetId);
+    return it == m_targets.end() ? 1.0f : it->second.drawnScale;
+}
+
+void RenderingSystem::requestFullResolution(RenderTargetId targetId)
+{
+    auto it = m_targets.find(targetId);
+    if (it == m_targets.end() || it->second.renderScale >= 1.0f) return;
+    it->second.fullResolutionOnce = true;
+    // That frame's time says nothing about the chosen scale.
+    it->second.scaleHoldFrames = std::max(it->second.scaleHoldFrames, 2 * GpuProfiler::kSlots);
+}
+
+const GpuProfiler* RenderingSystem::profiler(RenderTargetId targetId) const
+{
+    auto it = m_targets.find(targetId);
+    return it == m_targets.end() ? nullptr : &it->second.profiler;
 }
 
+void RenderingSystem::setProfileCapture(bool on)
+{
+    m_profileCapture = on;
+    for (auto& [id, target] : m_targets) target.profiler.setCapturing(on);
+    if (on) TraceZones::start();
+    else TraceZones::stop();
+}
+
+bool RenderingSystem::writeProfileTrace(const QString& path) const
+{
+    QJsonArray events;
+    int viewportIndex = 0;
+    for (const auto& [id, target] : m_targets) {
+        const int cpuTid = 2 * viewportIndex + 1, gpuTid = cpuTid + 1;
+        const QString label = target.widget && !target.widget->objectName().isEmpty()
+            ? target.widget->objectName()
+            : target.widget ? QStringLiteral("viewport %1").arg(viewportIndex)
+            : QStringLiteral("offscreen %1").arg(viewportIndex);
+        for (auto [tid, kind] : { std::pair{ cpuTid, "CPU" }, std::pair{ gpuTid, "GPU" } }) {
+            events.append(QJsonObject{ { "ph", "M" }, { "pid", 1 }, { "tid", tid },
+                { "name", "thread_name" }, { "args", QJsonObject{ { "name", label + " " + kind } } } });
+        }
+        // GL_TIME_ELAPSED has no start time; GPU slices are placed at their CPU start.
+        for (const auto& e : target.profiler.capturedEvents()) {
+            const QString name = QString::fromStdString(e.name);
+            events.append(QJsonObject{ { "ph", "X" }, { "pid", 1 }, { "tid", cpuTid }, { "cat", "cpu" },
+                { "name", name }, { "ts", e.cpuBeginUs }, { "dur", e.cpuDurUs } });
+            events.append(QJsonObject{ { "ph", "X" }, { "pid", 1 }, { "tid", gpuTid }, { "cat", "gpu" },
+                { "name", name }, { "ts", e.cpuBeginUs }, { "dur", e.gpuDurUs } });
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_glMessageMutex);
+            for (const GlMessage& m : m_glMessages) {
+                if (m.target != id) continue;
+                events.append(QJsonObject{ { "ph", "i" }, { "s", "t" }, { "pid", 1 }, { "tid", cpuTid }, { "cat", "gl" },
+                    { "name", m.text }, { "ts", m.us },
+                    { "args", QJsonObject{ { "id", qint64(m.id) }, { "severity", m.severity }, { "type", m.type },
+                        { "source", m.source } } } });
+            }
+        }
+        ++viewportIndex;
+    }
+    TraceZones::appendChromeEvents(events);
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(QJsonDocument(QJsonObject{ { "traceEvents", events }, { "displayTimeUnit", "ms" } }).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
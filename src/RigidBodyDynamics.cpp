@@ -0,0 +1,322 @@
+#include "RigidBodyDynamics.hpp"
+#include "components.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/quaternion.hpp>
+#include <entt/entt.hpp>
+
+namespace
+{
+    // Friction is smoothed over this speed so a joint at rest is not
+    // chattered back and forth by a discontinuous Coulomb term; the static
+    // level fades into the dynamic one over kStribeckSpeed.
+    constexpr double kFrictionSpeed = 1e-3;
+    constexpr double kStribeckSpeed = 0.05;
+
+    // skew(r) * x == cross(r, x).
+    glm::dmat3 skew(const glm::dvec3& r)
+    {
+        return glm::dmat3(0.0, r.z, -r.y,
+                          -r.z, 0.0, r.x,
+                          r.y, -r.x, 0.0);
+    }
+
+    glm::dmat3 axisRotation(const glm::dvec3& axis, double angle)
+    {
+        const glm::dmat3 K = skew(axis);
+        return glm::dmat3(1.0) + std::sin(angle) * K + (1.0 - std::cos(angle)) * (K * K);
+    }
+}
+
+RigidBodyDynamics::RigidBodyDynamics(std::shared_ptr<const KinematicModel> model, std::vector<LinkInertia> links,
+    std::vector<JointParameters> joints)
+    : m_model(std::move(model)), m_joints(std::move(joints))
+{
+    const KinematicModel& km = *m_model;
+    const std::size_t n = std::size_t(km.linkCount());
+    m_joints.resize(std::size_t(km.dofCount()));
+    links.resize(n);
+
+    m_parent.resize(n);
+    m_dof.resize(n);
+    m_axis.resize(n);
+    m_originRotation.resize(n);
+    m_originTranslation.resize(n);
+    m_inertia.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const int link = int(i);
+        m_parent[i] = km.parentOf(link);
+        m_dof[i] = km.dofOf(link);
+        const glm::dvec3 axis(km.axisOf(link));
+        if (km.motionOf(link) == KinematicModel::Motion::Revolute) m_axis[i].angular = axis;
+        else if (km.motionOf(link) == KinematicModel::Motion::Prismatic) m_axis[i].linear = axis;
+        m_originRotation[i] = glm::dmat3(glm::mat3_cast(km.originOf(link).rotation));
+        m_originTranslation[i] = glm::dvec3(km.originOf(link).translation);
+
+        // Spatial inertia about the link origin from the one about the
+        // centre of mass c: [Ic - m c~c~, m c~; -m c~, m 1].
+        const LinkInertia& body = links[i];
+        const glm::dmat3 c = skew(body.centerOfMass);
+        m_inertia[i].A = body.inertia - body.mass * (c * c);
+        m_inertia[i].B = body.mass * c;
+        m_inertia[i].D = glm::dmat3(body.mass);
+    }
+
+    m_E.resize(n);
+    m_r.resize(n);
+    m_v.resize(n);
+    m_a.resize(n);
+    m_c.resize(n);
+    m_f.resize(n);
+    m_U.resize(n);
+    m_IA.resize(n);
+    m_Dinv.resize(n);
+    m_u.resize(n);
+    m_tau.resize(m_joints.size());
+    m_qdd.resize(m_joints.size());
+}
+
+std::unique_ptr<RigidBodyDynamics> RigidBodyDynamics::fromRobot(const entt::registry& registry, entt::entity root)
+{
+    const auto* kin = registry.try_get<KinematicModelComponent>(root);
+    if (!kin || !kin->model || kin->links.size() != std::size_t(kin->model->linkCount())) return nullptr;
+    const KinematicModel& model = *kin->model;
+
+    std::vector<LinkInertia> links(kin->links.size());
+    for (std::size_t i = 0; i < links.size(); ++i) {
+        const auto* link = registry.try_get<LinkComponent>(kin->links[i]);
+        if (!link) continue;
+        links[i].mass = link->description.mass;
+        links[i].centerOfMass = glm::dvec3(link->description.center_of_mass_offset);
+        links[i].inertia = glm::dmat3(link->description.inertia);
+    }
+    std::vector<JointParameters> joints(std::size_t(model.dofCount()));
+    for (std::size_t dof = 0; dof < joints.size(); ++dof) {
+        const auto* joint = registry.try_get<JointComponent>(kin->links[std::size_t(model.dofLink(int(dof)))]);
+        if (!joint) continue;
+        const JointDescription& d = joint->description;
+        joints[dof].staticFriction = d.static_friction;
+        joints[dof].dynamicFriction = d.dynamic_friction;
+        joints[dof].effortLimit = d.limits.effort_limit;
+        joints[dof].velocityLimit = d.limits.velocity_limit;
+    }
+
+    auto dynamics = std::make_unique<RigidBodyDynamics>(kin->model, std::move(links), std::move(joints));
+    if (const auto* xf = registry.try_get<TransformComponent>(root))
+        dynamics->setGravity(glm::dvec3(glm::inverse(xf->rotation) * glm::vec3(0.0f, -9.81f, 0.0f)));
+    return dynamics;
+}
+
+void RigidBodyDynamics::updateTransforms(const double* q)
+{
+    for (std::size_t i = 0; i < m_parent.size(); ++i) {
+        glm::dmat3 rotation = m_originRotation[i];
+        glm::dvec3 translation = m_originTranslation[i];
+        if (const int dof = m_dof[i]; dof >= 0) {
+            if (m_axis[i].angular != glm::dvec3(0.0)) rotation = rotation * axisRotation(m_axis[i].angular, q[dof]);
+            else translation += rotation * (m_axis[i].linear * q[dof]);
+        }
+        m_E[i] = glm::transpose(rotation);
+        m_r[i] = translation;
+    }
+}
+
+// --- Spatial algebra, in the split form the header describes ---
+//
+// X = [E 0; -E r~ E] maps motion from the parent frame to the link frame;
+// X^T maps force from the link frame back to the parent.
+
+namespace
+{
+    template <class M>
+    M toLink(const glm::dmat3& E, const glm::dvec3& r, const M& m)
+    {
+        return { E * m.angular, E * (m.linear - glm::cross(r, m.angular)) };
+    }
+
+    template <class F>
+    F toParent(const glm::dmat3& E, const glm::dvec3& r, const F& f)
+    {
+        const glm::dmat3 Et = glm::transpose(E);
+        const glm::dvec3 force = Et * f.linear;
+        return { Et * f.angular + glm::cross(r, force), force };
+    }
+
+    template <class F, class I, class M>
+    F apply(const I& inertia, const M& m)
+    {
+        return { inertia.A * m.angular + inertia.B * m.linear,
+                 glm::transpose(inertia.B) * m.angular + inertia.D * m.linear };
+    }
+
+    // v x m and v x* f.
+    template <class M>
+    M crossMotion(const M& v, const M& m)
+    {
+        return { glm::cross(v.angular, m.angular), glm::cross(v.angular, m.linear) + glm::cross(v.linear, m.angular) };
+    }
+
+    template <class F, class M>
+    F crossForce(const M& v, const F& f)
+    {
+        return { glm::cross(v.angular, f.angular) + glm::cross(v.linear, f.linear), glm::cross(v.angular, f.linear) };
+    }
+
+    template <class M, class F>
+    double power(const M& m, const F& f)
+    {
+        return glm::dot(m.angular, f.angular) + glm::dot(m.linear, f.linear);
+    }
+
+    // X^T I X, from the link frame into the parent's.
+    template <class I>
+    I inertiaToParent(const glm::dmat3& E, const glm::dvec3& r, const I& in)
+    {
+        const glm::dmat3 Et = glm::transpose(E);
+        const glm::dmat3 A = Et * in.A * E, B = Et * in.B * E, D = Et * in.D * E;
+        const glm::dmat3 rx = skew(r);
+        return { A - B * rx + rx * glm::transpose(B) - rx * D * rx, B + rx * D, D };
+    }
+}
+
+void RigidBodyDynamics::inverseDynamics(const double* q, const double* qd, const double* qdd, double* tau)
+{
+    updateTransforms(q);
+    const std::size_t n = m_parent.size();
+    const Motion baseAcceleration{ glm::dvec3(0.0), -m_gravity };   // gravity as a base acceleration
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const int parent = m_parent[i], dof = m_dof[i];
+        const Motion vp = parent >= 0 ? m_v[std::size_t(parent)] : Motion{};
+        const Motion ap = parent >= 0 ? m_a[std::size_t(parent)] : baseAcceleration;
+        Motion vJ, aJ;
+        if (dof >= 0) {
+            vJ = { m_axis[i].angular * qd[dof], m_axis[i].linear * qd[dof] };
+            aJ = { m_axis[i].angular * qdd[dof], m_axis[i].linear * qdd[dof] };
+        }
+        Motion& v = m_v[i];
+        Motion& a = m_a[i];
+        v = toLink(m_E[i], m_r[i], vp);
+        v.angular += vJ.angular;
+        v.linear += vJ.linear;
+        a = toLink(m_E[i], m_r[i], ap);
+        const Motion coriolis = crossMotion(v, vJ);
+        a.angular += aJ.angular + coriolis.angular;
+        a.linear += aJ.linear + coriolis.linear;
+
+        const Force momentum = apply<Force>(m_inertia[i], v);
+        const Force inertial = apply<Force>(m_inertia[i], a);
+        const Force bias = crossForce(v, momentum);
+        m_f[i] = { inertial.angular + bias.angular, inertial.linear + bias.linear };
+    }
+
+    for (std::size_t i = n; i-- > 0;) {
+        const int parent = m_parent[i], dof = m_dof[i];
+        if (dof >= 0) tau[dof] = power(m_axis[i], m_f[i]) + m_joints[std::size_t(dof)].armature * qdd[dof];
+        if (parent >= 0) {
+            const Force up = toParent(m_E[i], m_r[i], m_f[i]);
+            m_f[std::size_t(parent)].angular += up.angular;
+            m_f[std::size_t(parent)].linear += up.linear;
+        }
+    }
+}
+
+void RigidBodyDynamics::forwardDynamics(const double* q, const double* qd, const double* tau, double* qdd)
+{
+    updateTransforms(q);
+    const std::size_t n = m_parent.size();
+
+    // --- Velocities, bias terms and the rigid inertias, root to tips ---
+    for (std::size_t i = 0; i < n; ++i) {
+        const int parent = m_parent[i], dof = m_dof[i];
+        Motion& v = m_v[i];
+        v = parent >= 0 ? toLink(m_E[i], m_r[i], m_v[std::size_t(parent)]) : Motion{};
+        Motion vJ;
+        if (dof >= 0) {
+            vJ = { m_axis[i].angular * qd[dof], m_axis[i].linear * qd[dof] };
+            v.angular += vJ.angular;
+            v.linear += vJ.linear;
+        }
+        m_c[i] = crossMotion(v, vJ);
+        m_IA[i] = m_inertia[i];
+        m_f[i] = crossForce(v, apply<Force>(m_inertia[i], v));
+    }
+
+    // --- Articulated inertias and bias forces, tips to root ---
+    for (std::size_t i = n; i-- > 0;) {
+        const int parent = m_parent[i], dof = m_dof[i];
+        Inertia Ia = m_IA[i];
+        Force pa = m_f[i];
+        if (dof >= 0) {
+            const Force U = apply<Force>(Ia, m_axis[i]);
+            const double Dinv = 1.0 / (power(m_axis[i], U) + m_joints[std::size_t(dof)].armature);
+            const double u = tau[dof] - power(m_axis[i], pa);
+            m_U[i] = U;
+            m_Dinv[i] = Dinv;
+            m_u[i] = u;
+            Ia.A -= Dinv * glm::outerProduct(U.angular, U.angular);
+            Ia.B -= Dinv * glm::outerProduct(U.angular, U.linear);
+            Ia.D -= Dinv * glm::outerProduct(U.linear, U.linear);
+            const Force Iac = apply<Force>(Ia, m_c[i]);
+            pa.angular += Iac.angular + U.angular * (u * Dinv);
+            pa.linear += Iac.linear + U.linear * (u * Dinv);
+        }
+        // A fixed joint has no velocity of its own, so its bias c is zero.
+        if (parent < 0) continue;
+        const Inertia up = inertiaToParent(m_E[i], m_r[i], Ia);
+        Inertia& IAp = m_IA[std::size_t(parent)];
+        IAp.A += up.A;
+        IAp.B += up.B;
+        IAp.D += up.D;
+        const Force pup = toParent(m_E[i], m_r[i], pa);
+        m_f[std::size_t(parent)].angular += pup.angular;
+        m_f[std::size_t(parent)].linear += pup.linear;
+    }
+
+    // --- Accelerations, root to tips ---
+    const Motion baseAcceleration{ glm::dvec3(0.0), -m_gravity };
+    for (std::size_t i = 0; i < n; ++i) {
+        const int parent = m_parent[i], dof = m_dof[i];
+        Motion& a = m_a[i];
+        a = toLink(m_E[i], m_r[i], parent >= 0 ? m_a[std::size_t(parent)] : baseAcceleration);
+        a.angular += m_c[i].angular;
+        a.linear += m_c[i].linear;
+        if (dof < 0) continue;
+        const double acceleration = (m_u[i] - power(a, m_U[i])) * m_Dinv[i];
+        qdd[dof] = acceleration;
+        a.angular += m_axis[i].angular * acceleration;
+        a.linear += m_axis[i].linear * acceleration;
+    }
+}
+
+void RigidBodyDynamics::step(double* q, double* qd, const double* tau, double dt, double* applied)
+{
+    const std::size_t dofs = m_joints.size();
+    for (std::size_t d = 0; d < dofs; ++d) {
+        const JointParameters& joint = m_joints[d];
+        double t = joint.effortLimit > 0.0 ? std::clamp(tau[d], -joint.effortLimit, joint.effortLimit) : tau[d];
+        const double speed = qd[d];
+        const double level = joint.dynamicFriction
+            + (joint.staticFriction - joint.dynamicFriction) * std::exp(-std::abs(speed) / kStribeckSpeed);
+        t -= level * std::tanh(speed / kFrictionSpeed);
+        m_tau[d] = t;
+    }
+    forwardDynamics(q, qd, m_tau.data(), m_qdd.data());
+
+    const KinematicModel& model = *m_model;
+    for (std::size_t d = 0; d < dofs; ++d) {
+        const JointParameters& joint = m_joints[d];
+        double v = qd[d] + m_qdd[d] * dt;
+        if (joint.velocityLimit > 0.0) v = std::clamp(v, -joint.velocityLimit, joint.velocityLimit);
+        double p = q[d] + v * dt;
+        if (model.isLimited(int(d))) {
+            const double lower = model.lowerLimit(int(d)), upper = model.upperLimit(int(d));
+            if (p < lower) { p = lower; v = std::max(v, 0.0); }
+            else if (p > upper) { p = upper; v = std::min(v, 0.0); }
+        }
+        q[d] = p;
+        qd[d] = v;
+    }
+    if (applied) std::copy(m_tau.begin(), m_tau.end(), applied);
+}
@@ -2,6 +2,7 @@
 #include "PreviewViewport.hpp"
 #include "LinkPropertiesWidget.hpp"
 #include "JointPropertiesWidget.hpp"
+#include "LinkThumbnails.hpp"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -12,6 +13,8 @@
 #include <QLabel>
 #include <QDialogButtonBox>
 #include <QSlider>
+#include <QIcon>
+#include <QPixmap>
 #include <QDebug>
 #include <algorithm> // For std::find_if
 
@@ -37,6 +40,8 @@ RobotEnrichmentDialog::RobotEnrichmentDialog(const RobotDescription& robotDesc,
     auto* leftPane = new QWidget(splitter);
     auto* leftLayout = new QVBoxLayout(leftPane);
     m_robotTreeWidget = new QTreeWidget(this);
+    m_robotTreeWidget->setIconSize(QSize(LinkThumbnails::kSize / 2, LinkThumbnails::kSize / 2));
+    m_thumbnails = new LinkThumbnails(this);
     m_propertyEditorStack = new QStackedWidget(this);
     leftLayout->addWidget(m_robotTreeWidget, 1);
     leftLayout->addWidget(m_propertyEditorStack, 2);
@@ -67,6 +72,12 @@ RobotEnrichmentDialog::RobotEnrichmentDialog(const RobotDescription& robotDesc,
     mainLayout->addWidget(buttonBox);
 
     createPropertyEditors();
+    connect(m_thumbnails, &LinkThumbnails::ready, this, [this](const QString& name, const QImage& image) {
+        const auto items = m_robotTreeWidget->findItems(name, Qt::MatchExactly | Qt::MatchRecursive);
+        for (QTreeWidgetItem* item : items)
+            if (static_cast<ItemType>(item->data(0, ItemTypeRole).toInt()) == ItemType::Link)
+                item->setIcon(0, QIcon(QPixmap::fromImage(image)));
+        });
     populateTree();
     m_robotTreeWidget->expandAll();
 
@@ -77,6 +88,7 @@ RobotEnrichmentDialog::RobotEnrichmentDialog(const RobotDescription& robotDesc,
     connect(speedSlider, &QSlider::valueChanged, m_previewViewport, &PreviewViewport::setAnimationSpeed);
     connect(m_robotTreeWidget, &QTreeWidget::currentItemChanged, this, &RobotEnrichmentDialog::onCurrentTreeItemChanged);
     connect(m_linkEditor, &LinkPropertiesWidget::propertiesChanged, this, &RobotEnrichmentDialog::onPropertiesChanged);
+    connect(m_jointEditor, &JointPropertiesWidget::propertiesChanged, this, &RobotEnrichmentDialog::onPropertiesChanged);
 
     connect(buttonBox, &QDialogButtonBox::accepted, this, &RobotEnrichmentDialog::onSave);
     connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
@@ -122,6 +134,7 @@ void RobotEnrichmentDialog::populateTree()
         auto* linkItem = new QTreeWidgetItem(linksRoot, { QString::fromStdString(link.name) });
         linkItem->setData(0, ItemTypeRole, QVariant::fromValue(static_cast<int>(ItemType::Link)));
         linkItem->setData(0, ItemNameRole, QVariant::fromValue(QString::fromStdString(link.name)));
+        requestThumbnail(link);
     }
 
     auto* jointsRoot = new QTreeWidgetItem(robotItem, { "Joints" });
@@ -134,6 +147,11 @@ void RobotEnrichmentDialog::populateTree()
     }
 }
 
+void RobotEnrichmentDialog::requestThumbnail(const LinkDescription& link)
+{
+    m_thumbnails->request(QString::fromStdString(link.name), link.mesh_filepath, link.material.albedo_color);
+}
+
 void RobotEnrichmentDialog::onCurrentTreeItemChanged(QTreeWidgetItem* current, QTreeWidgetItem* previous)
 {
     if (!current) {
@@ -157,8 +175,12 @@ void RobotEnrichmentDialog::onCurrentTreeItemChanged(QTreeWidgetItem* current, Q
         break;
     }
     case ItemType::Joint: {
-        // TODO: Implement the same logic for joints.
-        m_propertyEditorStack->setCurrentWidget(m_jointEditor);
+        auto it = std::find_if(m_robotDescription->joints.begin(), m_robotDescription->joints.end(),
+            [&](JointDescription& joint) { return joint.name == name; });
+        if (it != m_robotDescription->joints.end()) {
+            m_jointEditor->setJoint(&(*it)); // Repoints the editor's model; no widgets are rebuilt.
+            m_propertyEditorStack->setCurrentWidget(m_jointEditor);
+        }
         break;
     }
     default:
@@ -178,10 +200,12 @@ void RobotEnrichmentDialog::onPropertiesChanged()
     // so we just need to call its update function to write the UI values back to our data model.
     if (type == ItemType::Link) {
         m_linkEditor->updateLinkDescription();
+        // Cached by mesh and colour: only an edit to either draws again.
+        const std::string name = currentItem->data(0, ItemNameRole).toString().toStdString();
+        for (const LinkDescription& link : m_robotDescription->links)
+            if (link.name == name) requestThumbnail(link);
     }
-    else if (type == ItemType::Joint) {
-        // TODO: Implement for joints
-    }
+    // The joint editor's model writes each edit straight into the description.
 
     // After updating our data, tell the preview viewport to redraw.
     // Use * to dereference the unique_ptr to get the actual RobotDescription object.
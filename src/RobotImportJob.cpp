@@ -0,0 +1,183 @@
+#include "RobotImportJob.hpp"
+#include "URDFParser.hpp"
+#include "SDFParser.hpp"
+#include "KRobotParser.hpp"
+#include "TraceZones.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <exception>
+#include <utility>
+
+namespace
+{
+    bool hasExtension(const std::string& path, const char* extension)
+    {
+        const std::size_t length = std::char_traits<char>::length(extension);
+        if (path.size() < length) return false;
+        return std::equal(path.end() - length, path.end(), extension, [](char a, char b) {
+            return std::tolower(static_cast<unsigned char>(a)) == b;
+            });
+    }
+}
+
+RobotImportJob::~RobotImportJob()
+{
+    cancel();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+bool RobotImportJob::start(const std::string& path)
+{
+    if (busy()) return false;
+    launch(path, {});
+    return true;
+}
+
+bool RobotImportJob::start(RobotDescription description)
+{
+    if (busy()) return false;
+    launch({}, std::move(description));
+    return true;
+}
+
+void RobotImportJob::launch(std::string path, RobotDescription description)
+{
+    m_result = {};
+    m_stage.store(path.empty() ? Stage::Decoding : Stage::Parsing, std::memory_order_relaxed);
+    m_done.store(0, std::memory_order_relaxed);
+    m_total.store(0, std::memory_order_relaxed);
+    m_modelCount.store(0, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_modelsMutex);
+        m_models.clear();
+    }
+    m_cancel.store(false, std::memory_order_relaxed);
+    m_finished.store(false, std::memory_order_relaxed);
+
+    m_thread = std::thread([this, path = std::move(path), description = std::move(description)]() mutable {
+        TraceZones::setThreadName("robot import");
+        run(path, std::move(description));
+        m_stage.store(m_result.stage, std::memory_order_relaxed);
+        m_finished.store(true, std::memory_order_release);
+        });
+}
+
+RobotImportJob::Progress RobotImportJob::progress() const
+{
+    Progress p;
+    p.stage = m_stage.load(std::memory_order_relaxed);
+    p.done = m_done.load(std::memory_order_relaxed);
+    p.total = m_total.load(std::memory_order_relaxed);
+    p.models = m_modelCount.load(std::memory_order_relaxed);
+    return p;
+}
+
+RobotImportJob::Result RobotImportJob::take()
+{
+    if (m_thread.joinable()) m_thread.join();
+    m_finished.store(false, std::memory_order_relaxed);
+    m_stage.store(Stage::Idle, std::memory_order_relaxed);
+    return std::move(m_result);
+}
+
+std::vector<RobotSceneDelta> RobotImportJob::takeModels()
+{
+    std::lock_guard<std::mutex> lock(m_modelsMutex);
+    return std::exchange(m_models, {});
+}
+
+void RobotImportJob::run(const std::string& path, RobotDescription description)
+{
+    if (hasExtension(path, ".sdf")) {
+        runWorld(path);
+        return;
+    }
+
+    // --- Parsing ---
+    if (!path.empty()) {
+        try {
+            if (hasExtension(path, ".urdf"))        description = URDFParser::parse(path);
+            else if (hasExtension(path, ".krobot")) description = KRobotParser::parse(path);
+            else {
+                m_result.stage = Stage::Failed;
+                m_result.error = "Unsupported robot file type.";
+                return;
+            }
+        }
+        catch (const std::exception& e) {
+            m_result.stage = Stage::Failed;
+            m_result.error = e.what();
+            return;
+        }
+
+        if (m_cancel.load(std::memory_order_relaxed)) {
+            m_result.stage = Stage::Cancelled;
+            return;
+        }
+        if (description.needsEnrichment) {
+            m_result.stage = Stage::NeedsEnrichment;
+            m_result.delta.description = std::move(description);
+            return;
+        }
+    }
+
+    // --- Mesh decoding ---
+    m_stage.store(Stage::Decoding, std::memory_order_relaxed);
+
+    const bool prepared = prepare(std::move(description), m_result.delta);
+
+    if (prepared)                                      m_result.stage = Stage::Ready;
+    else if (m_cancel.load(std::memory_order_relaxed)) m_result.stage = Stage::Cancelled;
+    else {
+        m_result.stage = Stage::Failed;
+        m_result.error = "The robot description contains no links.";
+    }
+}
+
+void RobotImportJob::runWorld(const std::string& path)
+{
+    // Models are prepared on this thread as the parser yields them; each
+    // one's meshes still load in parallel, and files shared between models
+    // are decoded once by MeshCache while a queued delta holds them.
+    m_stage.store(Stage::Decoding, std::memory_order_relaxed);
+    try {
+        SDFParser::parseWorld(path, [this](RobotDescription&& model) {
+            RobotSceneDelta delta;
+            m_done.store(0, std::memory_order_relaxed);
+            m_total.store(0, std::memory_order_relaxed);
+            if (prepare(std::move(model), delta)) {
+                std::lock_guard<std::mutex> lock(m_modelsMutex);
+                m_models.push_back(std::move(delta));
+                m_modelCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            return !m_cancel.load(std::memory_order_relaxed);
+            });
+    }
+    catch (const std::exception& e) {
+        m_result.stage = Stage::Failed;
+        m_result.error = e.what();
+        return;
+    }
+
+    // Ready with an empty delta: every model went through takeModels().
+    if (m_cancel.load(std::memory_order_relaxed)) m_result.stage = Stage::Cancelled;
+    else if (m_modelCount.load(std::memory_order_relaxed) > 0) m_result.stage = Stage::Ready;
+    else {
+        m_result.stage = Stage::Failed;
+        m_result.error = "The SDF file contains no models with links.";
+    }
+}
+
+bool RobotImportJob::prepare(RobotDescription description, RobotSceneDelta& out)
+{
+    KR_ZONE("prepare robot");
+    return SceneBuilder::prepareRobot(std::move(description), out,
+        [this](std::size_t done, std::size_t total) {
+            m_total.store(total, std::memory_order_relaxed);
+            // Calls race; keep the largest count seen.
+            std::size_t seen = m_done.load(std::memory_order_relaxed);
+            while (seen < done && !m_done.compare_exchange_weak(seen, done, std::memory_order_relaxed)) {}
+            return !m_cancel.load(std::memory_order_relaxed);
+        });
+}
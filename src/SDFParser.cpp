@@ -1,24 +1,510 @@
 #include "SDFParser.hpp"
 #include "pugixml.hpp"
+#include "TraceZones.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    // --- Text ---
+
+    // Parses one number and advances 'str' past it. No locale, no allocation.
+    bool parseNumber(const char*& str, const char* end, double& out)
+    {
+        while (str < end && (*str == ' ' || *str == '\t' || *str == '\n' || *str == '\r')) ++str;
+        if (str < end && *str == '+') ++str; // from_chars rejects a leading '+'
+        const auto [next, ec] = std::from_chars(str, end, out);
+        if (ec != std::errc()) return false;
+        str = next;
+        return true;
+    }
+
+    // Up to 'count' whitespace separated numbers; missing ones keep their value.
+    int parseNumbers(const char* str, double* out, int count)
+    {
+        const char* end = str + std::strlen(str);
+        int parsed = 0;
+        while (parsed < count && parseNumber(str, end, out[parsed])) ++parsed;
+        return parsed;
+    }
+
+    double childDouble(pugi::xml_node node, const char* name, double fallback)
+    {
+        double value = fallback;
+        if (pugi::xml_node child = node.child(name)) parseNumbers(child.child_value(), &value, 1);
+        return value;
+    }
+
+    bool childBool(pugi::xml_node node, const char* name, bool fallback)
+    {
+        pugi::xml_node child = node.child(name);
+        if (!child) return fallback;
+        const char* text = child.child_value();
+        while (*text == ' ' || *text == '\t' || *text == '\n' || *text == '\r') ++text;
+        return std::strncmp(text, "true", 4) == 0 || *text == '1';
+    }
+
+    glm::vec3 childVec3(pugi::xml_node node, const char* name, const glm::vec3& fallback)
+    {
+        double v[3] = { fallback.x, fallback.y, fallback.z };
+        if (pugi::xml_node child = node.child(name)) parseNumbers(child.child_value(), v, 3);
+        return glm::vec3(float(v[0]), float(v[1]), float(v[2]));
+    }
+
+    // --- Poses ---
+
+    struct Pose
+    {
+        glm::vec3 translation{ 0.0f };
+        glm::quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+
+        Pose operator*(const Pose& rhs) const { return { translation + rotation * rhs.translation, rotation * rhs.rotation }; }
+        Pose inverse() const
+        {
+            const glm::quat inv = glm::conjugate(rotation);
+            return { inv * -translation, inv };
+        }
+    };
+
+    // SDF and URDF share the fixed-axis convention: roll about X, then pitch about Y, then yaw about Z.
+    glm::quat quatFromRpy(const glm::vec3& rpy)
+    {
+        return glm::angleAxis(rpy.z, glm::vec3(0, 0, 1))
+             * glm::angleAxis(rpy.y, glm::vec3(0, 1, 0))
+             * glm::angleAxis(rpy.x, glm::vec3(1, 0, 0));
+    }
+
+    glm::vec3 rpyFromQuat(const glm::quat& q)
+    {
+        const float sinPitch = std::clamp(2.0f * (q.w * q.y - q.z * q.x), -1.0f, 1.0f);
+        return glm::vec3(std::atan2(2.0f * (q.w * q.x + q.y * q.z), 1.0f - 2.0f * (q.x * q.x + q.y * q.y)),
+                         std::asin(sinPitch),
+                         std::atan2(2.0f * (q.w * q.z + q.x * q.y), 1.0f - 2.0f * (q.y * q.y + q.z * q.z)));
+    }
+
+    // The <pose> child of 'node': "x y z roll pitch yaw".
+    Pose childPose(pugi::xml_node node)
+    {
+        Pose pose;
+        if (pugi::xml_node poseNode = node.child("pose")) {
+            double v[6] = {};
+            parseNumbers(poseNode.child_value(), v, 6);
+            pose.translation = glm::vec3(float(v[0]), float(v[1]), float(v[2]));
+            pose.rotation = quatFromRpy(glm::vec3(float(v[3]), float(v[4]), float(v[5])));
+        }
+        return pose;
+    }
+
+    const char* relativeTo(pugi::xml_node node) { return node.child("pose").attribute("relative_to").as_string(); }
+
+    // --- Files ---
+
+    // Maps 'path' copy-on-write and parses it in place, as URDFParser does;
+    // 'file' has to outlive 'doc'.
+    void loadInPlace(QFile& file, pugi::xml_document& doc, const std::string& path)
+    {
+        file.setFileName(QString::fromStdString(path));
+        if (!file.open(QIODevice::ReadOnly)) {
+            throw std::runtime_error("Failed to open SDF file: " + path);
+        }
+        const qint64 size = file.size();
+        uchar* contents = size > 0 ? file.map(0, size, QFileDevice::MapPrivateOption) : nullptr;
+        if (!contents) {
+            throw std::runtime_error("Failed to read SDF file: " + path);
+        }
+        pugi::xml_parse_result result = doc.load_buffer_inplace(contents, static_cast<size_t>(size));
+        if (!result) {
+            throw std::runtime_error("Failed to load or parse SDF file: " + std::string(result.description()));
+        }
+    }
+
+    // A converted model and where it sits relative to the model of its file
+    // it was found in (itself, or a parent for a nested or included model).
+    struct Model
+    {
+        RobotDescription description;
+        Pose base;              ///< root link, in the frame of the enclosing top-level model
+        std::string suffix;     ///< appended to the top-level model's name; empty for it
+    };
+
+    struct IncludedFile
+    {
+        std::vector<Model> models;
+        Pose pose;              ///< the top model's own <pose>, used when <include> has none
+        std::string name;
+    };
+
+    class WorldReader
+    {
+    public:
+        explicit WorldReader(const std::string& path)
+        {
+            const QFileInfo info(QString::fromStdString(path));
+            const QString dir = info.absolutePath();
+
+            // model:// and package:// URIs name a model directory under one of these.
+            m_modelRoots << dir << QDir(dir).absoluteFilePath("models") << QFileInfo(dir).absolutePath();
+            for (const char* variable : { "GZ_SIM_RESOURCE_PATH", "IGN_GAZEBO_RESOURCE_PATH", "GAZEBO_MODEL_PATH", "SDF_PATH" }) {
+                const QString value = QString::fromLocal8Bit(qgetenv(variable));
+                m_modelRoots << value.split(QDir::listSeparator(), Qt::SkipEmptyParts);
+            }
+        }
+
+        // Collects 'node' (a <model>) and the models nested in it.
+        void collect(pugi::xml_node node, const QString& dir, const Pose& frame, const std::string& suffix, std::vector<Model>& out)
+        {
+            Model model;
+            model.suffix = suffix;
+            if (convert(node, dir, model.description, model.base)) {
+                model.base = frame * model.base;
+                out.push_back(std::move(model));
+            }
+
+            for (pugi::xml_node child : node.children()) {
+                if (std::strcmp(child.name(), "model") == 0) {
+                    collect(child, dir, frame * childPose(child), suffix + "::" + child.attribute("name").as_string(), out);
+                }
+                else if (std::strcmp(child.name(), "include") == 0) {
+                    if (const IncludedFile* file = include(child, dir))
+                        place(*file, child, frame, suffix + "::", out);
+                }
+            }
+        }
+
+        // Copies the models of an included file into 'out', placed by the
+        // <include> element and named 'prefix' + its name.
+        void place(const IncludedFile& file, pugi::xml_node include, const Pose& frame, const std::string& prefix, std::vector<Model>& out) const
+        {
+            const std::string name = include.child("name") ? include.child("name").child_value() : file.name;
+            const Pose pose = frame * (include.child("pose") ? childPose(include) : file.pose);
+            const bool overrideStatic = static_cast<bool>(include.child("static"));
+            const bool isStatic = childBool(include, "static", false);
+
+            for (const Model& model : file.models) {
+                Model placed = model;
+                placed.base = pose * model.base;
+                placed.suffix = prefix + name + model.suffix;
+                if (overrideStatic)
+                    for (LinkDescription& link : placed.description.links) link.is_static = isStatic;
+                out.push_back(std::move(placed));
+            }
+        }
+
+        // The file an <include> refers to, read once. Null if it cannot be found or read.
+        const IncludedFile* include(pugi::xml_node include, const QString& dir)
+        {
+            const std::string uri = include.child("uri").child_value();
+            std::string path = resolve(uri, dir);
+            const QFileInfo info(QString::fromStdString(path));
+            if (info.isDir()) {
+                QDir modelDir(info.absoluteFilePath());
+                const QStringList sdfs = modelDir.entryList({ "model.sdf", "*.sdf" }, QDir::Files, QDir::Name);
+                path = modelDir.absoluteFilePath(sdfs.contains("model.sdf") ? "model.sdf" : sdfs.value(0)).toStdString();
+            }
+
+            auto it = m_included.find(path);
+            if (it != m_included.end()) return it->second.get();
+            if (!m_reading.insert(path).second) return nullptr;   // includes itself
+
+            std::unique_ptr<IncludedFile> file;
+            try {
+                QFile source;
+                pugi::xml_document doc;
+                loadInPlace(source, doc, path);
+                if (pugi::xml_node node = doc.child("sdf").child("model")) {
+                    file = std::make_unique<IncludedFile>();
+                    file->name = node.attribute("name").as_string();
+                    file->pose = childPose(node);
+                    collect(node, QFileInfo(QString::fromStdString(path)).absolutePath(), Pose(), std::string(), file->models);
+                }
+            }
+            catch (const std::exception& e) {
+                qWarning() << "[SDFParser] Skipping <include>" << QString::fromStdString(uri) << ":" << e.what();
+            }
+            m_reading.erase(path);
+            return (m_included[path] = std::move(file)).get();
+        }
+
+    private:
+        // File path for a mesh or include URI.
+        std::string resolve(const std::string& uri, const QString& dir) const
+        {
+            for (const char* scheme : { "model://", "package://" }) {
+                const std::size_t length = std::strlen(scheme);
+                if (uri.compare(0, length, scheme) != 0) continue;
+                const QString relative = QString::fromStdString(uri.substr(length));
+                for (const QString& root : m_modelRoots) {
+                    const QString candidate = QDir(root).absoluteFilePath(relative);
+                    if (QFileInfo::exists(candidate)) return candidate.toStdString();
+                }
+                return QDir(dir).absoluteFilePath(relative).toStdString();
+            }
+            if (uri.compare(0, 7, "file://") == 0) return uri.substr(7);
+            return QDir(dir).absoluteFilePath(QString::fromStdString(uri)).toStdString();
+        }
+
+        // Fills 'out' from the links and joints of one <model>, in URDF terms:
+        // each link's frame is its joint frame. 'base' gets the root link's
+        // pose in the model frame. False for a model without links.
+        bool convert(pugi::xml_node model, const QString& dir, RobotDescription& out, Pose& base) const
+        {
+            std::vector<pugi::xml_node> linkNodes;
+            for (pugi::xml_node link : model.children("link")) linkNodes.push_back(link);
+            if (linkNodes.empty()) return false;
+
+            out.name = model.attribute("name").as_string("SDF Model");
+            const bool isStatic = childBool(model, "static", false);
+
+            // --- Link poses in the model frame ---
+            std::unordered_map<std::string, std::size_t> linkIndex;
+            for (std::size_t i = 0; i < linkNodes.size(); ++i) linkIndex.emplace(linkNodes[i].attribute("name").as_string(), i);
+
+            std::vector<Pose> linkPose(linkNodes.size());
+            std::vector<char> resolved(linkNodes.size(), 0);   // 0 not yet, 1 in progress, 2 done
+            auto frameOf = [&](auto& self, const std::string& name) -> Pose {
+                const auto it = linkIndex.find(name);
+                if (it == linkIndex.end()) return Pose();     // __model__ or a frame we do not model
+                const std::size_t i = it->second;
+                if (resolved[i] == 0) {
+                    resolved[i] = 1;
+                    const char* parent = relativeTo(linkNodes[i]);
+                    linkPose[i] = (*parent ? self(self, parent) : Pose()) * childPose(linkNodes[i]);
+                    resolved[i] = 2;
+                }
+                return linkPose[i];
+            };
+            for (pugi::xml_node link : linkNodes) frameOf(frameOf, link.attribute("name").as_string());
+
+            // --- Joints ---
+            // A link's URDF frame is its SDF frame moved to its joint.
+            std::vector<Pose> frame = linkPose;
+            std::vector<char> isChild(linkNodes.size(), 0);
+            std::vector<pugi::xml_node> jointNodes;
+            for (pugi::xml_node joint : model.children("joint")) {
+                const auto child = linkIndex.find(joint.child("child").child_value());
+                const auto parent = linkIndex.find(joint.child("parent").child_value());
+                // Joints to "world" only anchor the model, which its pose already does.
+                if (child == linkIndex.end() || parent == linkIndex.end() || isChild[child->second]) continue;
+
+                const char* relative = relativeTo(joint);
+                const Pose jointInModel = (*relative ? frameOf(frameOf, relative) : linkPose[child->second]) * childPose(joint);
+                frame[child->second] = jointInModel;
+                isChild[child->second] = 1;
+                jointNodes.push_back(joint);
+            }
+
+            out.links.reserve(linkNodes.size());
+            out.joints.reserve(linkNodes.size());
+            for (pugi::xml_node joint : jointNodes) {
+                const std::size_t child = linkIndex.at(joint.child("child").child_value());
+                const std::size_t parent = linkIndex.at(joint.child("parent").child_value());
+
+                JointDescription jointDesc;
+                jointDesc.name = joint.attribute("name").as_string();
+                jointDesc.parent_link_name = linkNodes[parent].attribute("name").as_string();
+                jointDesc.child_link_name = linkNodes[child].attribute("name").as_string();
+
+                const Pose origin = frame[parent].inverse() * frame[child];
+                jointDesc.origin_xyz = origin.translation;
+                jointDesc.origin_rpy = rpyFromQuat(origin.rotation);
+
+                const char* typeStr = joint.attribute("type").as_string();
+                pugi::xml_node axisNode = joint.child("axis");
+                pugi::xml_node limitNode = axisNode.child("limit");
+                if (std::strcmp(typeStr, "revolute") == 0 || std::strcmp(typeStr, "continuous") == 0) {
+                    jointDesc.type = JointType::REVOLUTE;
+                    // SDF marks an unlimited revolute joint with +-1e16.
+                    if (std::strcmp(typeStr, "continuous") == 0 || childDouble(limitNode, "upper", 1e16) - childDouble(limitNode, "lower", -1e16) > 1e15)
+                        jointDesc.type = JointType::CONTINUOUS;
+                }
+                else if (std::strcmp(typeStr, "prismatic") == 0) jointDesc.type = JointType::PRISMATIC;
+                else jointDesc.type = JointType::FIXED;   // ball, screw, universal, ... are not modelled
+
+                // The axis is in the joint frame unless it says otherwise.
+                glm::vec3 axis = childVec3(axisNode, "xyz", glm::vec3(0, 0, 1));
+                const char* expressedIn = axisNode.child("xyz").attribute("expressed_in").as_string();
+                if (childBool(axisNode, "use_parent_model_frame", false) || std::strcmp(expressedIn, "__model__") == 0)
+                    axis = glm::conjugate(frame[child].rotation) * axis;
+                else if (*expressedIn && linkIndex.count(expressedIn))
+                    axis = glm::conjugate(frame[child].rotation) * (linkPose[linkIndex.at(expressedIn)].rotation * axis);
+                jointDesc.axis = axis;
+
+                if (limitNode) {
+                    jointDesc.limits.lower = childDouble(limitNode, "lower", 0.0);
+                    jointDesc.limits.upper = childDouble(limitNode, "upper", 0.0);
+                    jointDesc.limits.effort_limit = childDouble(limitNode, "effort", jointDesc.limits.effort_limit);
+                    jointDesc.limits.velocity_limit = childDouble(limitNode, "velocity", jointDesc.limits.velocity_limit);
+                }
+                out.joints.push_back(std::move(jointDesc));
+            }
+
+            // --- Roots ---
+            // One root per model: the canonical link, and every other
+            // unjointed link welded to it where it sits.
+            std::size_t root = SIZE_MAX;
+            const auto canonical = linkIndex.find(model.attribute("canonical_link").as_string());
+            if (canonical != linkIndex.end() && !isChild[canonical->second]) root = canonical->second;
+            for (std::size_t i = 0; i < linkNodes.size() && root == SIZE_MAX; ++i)
+                if (!isChild[i]) root = i;
+            if (root == SIZE_MAX) root = 0;   // every link is a child: a loop, let KinematicModel report it
+            base = frame[root];
+
+            for (std::size_t i = 0; i < linkNodes.size(); ++i) {
+                if (isChild[i] || i == root) continue;
+                JointDescription weld;
+                weld.name = std::string(linkNodes[i].attribute("name").as_string()) + "_fixed";
+                weld.type = JointType::FIXED;
+                weld.parent_link_name = linkNodes[root].attribute("name").as_string();
+                weld.child_link_name = linkNodes[i].attribute("name").as_string();
+                const Pose origin = frame[root].inverse() * frame[i];
+                weld.origin_xyz = origin.translation;
+                weld.origin_rpy = rpyFromQuat(origin.rotation);
+                out.joints.push_back(std::move(weld));
+            }
+
+            // --- Links ---
+            for (std::size_t i = 0; i < linkNodes.size(); ++i) {
+                pugi::xml_node link = linkNodes[i];
+                LinkDescription linkDesc;
+                linkDesc.name = link.attribute("name").as_string();
+                linkDesc.is_static = isStatic;
+                linkDesc.material = MaterialDescription();
+
+                // SDF link frame -> URDF link frame.
+                const Pose toFrame = frame[i].inverse() * linkPose[i];
+
+                // First visual and collision with a mesh; primitives have no mesh file to point at.
+                for (pugi::xml_node visual : link.children("visual")) {
+                    pugi::xml_node mesh = visual.child("geometry").child("mesh");
+                    if (!mesh) continue;
+                    linkDesc.mesh_filepath = resolve(mesh.child("uri").child_value(), dir);
+                    const Pose visualOrigin = toFrame * childPose(visual);
+                    linkDesc.visual_origin_xyz = visualOrigin.translation;
+                    linkDesc.visual_origin_rpy = rpyFromQuat(visualOrigin.rotation);
+
+                    if (pugi::xml_node material = visual.child("material")) {
+                        double rgba[4] = { 0.8, 0.8, 0.8, 1.0 };
+                        if (pugi::xml_node diffuse = material.child("diffuse")) parseNumbers(diffuse.child_value(), rgba, 4);
+                        linkDesc.material.albedo_color = glm::vec4(float(rgba[0]), float(rgba[1]), float(rgba[2]), float(rgba[3]));
+                        linkDesc.material.emissive_color = childVec3(material, "emissive", glm::vec3(0.0f));
+                        pugi::xml_node metal = material.child("pbr").child("metal");
+                        linkDesc.material.metalness = float(childDouble(metal, "metalness", linkDesc.material.metalness));
+                        linkDesc.material.roughness = float(childDouble(metal, "roughness", linkDesc.material.roughness));
+                    }
+                    break;
+                }
+                for (pugi::xml_node collision : link.children("collision")) {
+                    pugi::xml_node mesh = collision.child("geometry").child("mesh");
+                    if (!mesh) continue;
+                    linkDesc.collision_mesh_filepath = resolve(mesh.child("uri").child_value(), dir);
+                    break;
+                }
+
+                if (pugi::xml_node inertial = link.child("inertial")) {
+                    linkDesc.mass = float(childDouble(inertial, "mass", linkDesc.mass));
+                    linkDesc.center_of_mass_offset = (toFrame * childPose(inertial)).translation;
+                    if (pugi::xml_node inertia = inertial.child("inertia")) {
+                        const float ixx = float(childDouble(inertia, "ixx", 0.0)), iyy = float(childDouble(inertia, "iyy", 0.0));
+                        const float izz = float(childDouble(inertia, "izz", 0.0)), ixy = float(childDouble(inertia, "ixy", 0.0));
+                        const float ixz = float(childDouble(inertia, "ixz", 0.0)), iyz = float(childDouble(inertia, "iyz", 0.0));
+                        linkDesc.inertia = glm::mat3(ixx, ixy, ixz,
+                                                     ixy, iyy, iyz,
+                                                     ixz, iyz, izz);
+                    }
+                }
+                out.links.push_back(std::move(linkDesc));
+            }
+            return true;
+        }
+
+        QStringList m_modelRoots;
+        std::unordered_map<std::string, std::unique_ptr<IncludedFile>> m_included;   ///< by file; null if unreadable
+        std::unordered_set<std::string> m_reading;
+    };
+
+    void setBase(RobotDescription& description, const Pose& pose)
+    {
+        description.base_origin_xyz = pose.translation;
+        description.base_origin_rpy = rpyFromQuat(pose.rotation);
+    }
+}
 
-// This is a stub implementation for the SDF parser.
-// SDF parsing is complex, often involving multiple <model> tags.
-// For now, we'll assume we're parsing the first model in the file.
 RobotDescription SDFParser::parse(const std::string& filepath)
 {
+    RobotDescription first;
+    const std::size_t count = parseWorld(filepath, [&](RobotDescription&& model) {
+        first = std::move(model);
+        return false;
+        });
+    if (count == 0) {
+        throw std::runtime_error("SDF file contains no <model> with links: " + filepath);
+    }
+    return first;
+}
+
+std::size_t SDFParser::parseWorld(const std::string& filepath, const ModelSink& sink)
+{
+    KR_ZONE("parse SDF");
+    // pugixml builds the whole tree, but parsing in place is a small part of
+    // a world import; the models are converted and handed on one at a time,
+    // so the caller can load meshes for the first while the rest wait.
+    QFile file;
     pugi::xml_document doc;
-    pugi::xml_parse_result result = doc.load_file(filepath.c_str());
+    loadInPlace(file, doc, filepath);
 
-    if (!result) {
-        throw std::runtime_error("Failed to load or parse SDF file: " + std::string(result.description()));
+    pugi::xml_node sdf = doc.child("sdf");
+    if (!sdf) {
+        throw std::runtime_error("SDF does not contain an <sdf> element.");
     }
 
-    // TODO: Add SDF parsing logic here. It's more complex than URDF
-    // as it involves finding <model> tags within a <world> or <sdf> tag.
+    WorldReader reader(filepath);
+    const QString dir = QFileInfo(QString::fromStdString(filepath)).absolutePath();
+    std::size_t delivered = 0;
+    std::vector<Model> models;
 
-    RobotDescription robotDesc;
-    robotDesc.name = "SDF_Robot_TODO";
+    // Models directly under <sdf> and in each <world>, in document order.
+    auto visit = [&](pugi::xml_node node) {
+        models.clear();
+        const bool isModel = std::strcmp(node.name(), "model") == 0;
+        std::string name;
+        if (isModel) {
+            name = node.attribute("name").as_string();
+            reader.collect(node, dir, childPose(node), std::string(), models);
+        }
+        else if (std::strcmp(node.name(), "include") == 0) {
+            if (const IncludedFile* included = reader.include(node, dir))
+                reader.place(*included, node, Pose(), std::string(), models);
+        }
 
-    return robotDesc;
+        for (Model& model : models) {
+            if (isModel) model.description.name = name + model.suffix;
+            else         model.description.name = model.suffix;
+            setBase(model.description, model.base);
+            ++delivered;
+            if (!sink(std::move(model.description))) return false;
+        }
+        return true;
+    };
+
+    for (pugi::xml_node node : sdf.children()) {
+        if (std::strcmp(node.name(), "world") == 0) {
+            for (pugi::xml_node child : node.children())
+                if (!visit(child)) return delivered;
+        }
+        else if (!visit(node)) return delivered;
+    }
+    return delivered;
 }
@@ -0,0 +1,186 @@
+#include "SafetyZones.hpp"
+#include "CollisionWorld.hpp"
+#include "FrameArena.hpp"
+#include "components.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define SAFETY_ZONES_SSE2 1
+#endif
+
+namespace {
+// Core points of a Volume zone, the entity's unit box.
+const glm::vec3 kUnitBoxCorners[8] = {
+    { -0.5f, -0.5f, -0.5f }, { 0.5f, -0.5f, -0.5f }, { -0.5f, 0.5f, -0.5f }, { 0.5f, 0.5f, -0.5f },
+    { -0.5f, -0.5f,  0.5f }, { 0.5f, -0.5f,  0.5f }, { -0.5f, 0.5f,  0.5f }, { 0.5f, 0.5f,  0.5f },
+};
+constexpr float kMinFaceArea = 1e-12f;   ///< below this a face has no usable normal
+
+entt::entity robotOf(const entt::registry& registry, entt::entity link)
+{
+    const auto* shape = registry.valid(link) ? registry.try_get<CollisionShapeComponent>(link) : nullptr;
+    return shape ? shape->robot : entt::entity(entt::null);
+}
+}
+
+bool SafetyZoneMonitor::buildZone(const glm::mat4& world, bool halfSpace, Zone& zone)
+{
+    const glm::vec3 axes[3] = { glm::vec3(world[0]), glm::vec3(world[1]), glm::vec3(world[2]) };
+    const glm::vec3 center(world[3]);
+
+    auto addPlane = [&zone](const glm::vec3& n, float d) {
+        zone.nx[zone.planes] = n.x;
+        zone.ny[zone.planes] = n.y;
+        zone.nz[zone.planes] = n.z;
+        zone.d[zone.planes] = d;
+        ++zone.planes;
+    };
+
+    zone.planes = 0;
+    zone.halfSpace = halfSpace;
+    if (halfSpace) {
+        // Local z = 0, inside towards local -z (also under a mirroring scale).
+        glm::vec3 n = glm::cross(axes[0], axes[1]);
+        const float area = glm::length(n);
+        if (area < kMinFaceArea) return false;
+        n /= area;
+        if (glm::dot(n, axes[2]) < 0.0f) n = -n;
+        addPlane(n, glm::dot(n, center));
+        zone.min = glm::vec3(-std::numeric_limits<float>::max());
+        zone.max = glm::vec3(std::numeric_limits<float>::max());
+    }
+    else {
+        // Face normals from the other two axes, so a curtain of zero
+        // thickness still has both of its faces.
+        for (int i = 0; i < 3; ++i) {
+            glm::vec3 n = glm::cross(axes[(i + 1) % 3], axes[(i + 2) % 3]);
+            const float area = glm::length(n);
+            if (area < kMinFaceArea) return false;
+            n /= area;
+            const float half = 0.5f * std::abs(glm::dot(n, axes[i]));
+            const float offset = glm::dot(n, center);
+            addPlane(n, offset + half);
+            addPlane(-n, half - offset);
+        }
+        const glm::vec3 extent = 0.5f * (glm::abs(axes[0]) + glm::abs(axes[1]) + glm::abs(axes[2]));
+        zone.min = center - extent;
+        zone.max = center + extent;
+
+        zone.shape.points = kUnitBoxCorners;
+        zone.shape.count = 8;
+        zone.shape.radius = 0.0f;
+        zone.shape.linear = glm::mat3(world);
+        zone.shape.translation = center;
+    }
+
+    // A zero normal puts the box's centre at distance 0 <= 0: never outside.
+    for (int i = zone.planes; i < Zone::kMaxPlanes; ++i) {
+        zone.nx[i] = zone.ny[i] = zone.nz[i] = 0.0f;
+        zone.d[i] = 0.0f;
+    }
+    return true;
+}
+
+bool SafetyZoneMonitor::boxOutside(const Zone& zone, const glm::vec3& center, const glm::vec3& extent)
+{
+    // Outside a plane when even the box corner deepest along -n is above it:
+    // n.c - |n|.e > d.
+#ifdef SAFETY_ZONES_SSE2
+    const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+    const __m128 ex = _mm_set1_ps(extent.x), ey = _mm_set1_ps(extent.y), ez = _mm_set1_ps(extent.z);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+    for (int i = 0; i < zone.planes; i += 4) {
+        const __m128 nx = _mm_load_ps(zone.nx + i);
+        const __m128 ny = _mm_load_ps(zone.ny + i);
+        const __m128 nz = _mm_load_ps(zone.nz + i);
+        const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_mul_ps(nz, cz));
+        const __m128 reach = _mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(_mm_and_ps(nx, absMask), ex),
+            _mm_mul_ps(_mm_and_ps(ny, absMask), ey)),
+            _mm_mul_ps(_mm_and_ps(nz, absMask), ez));
+        const __m128 outside = _mm_cmpgt_ps(_mm_sub_ps(dist, reach), _mm_load_ps(zone.d + i));
+        if (_mm_movemask_ps(outside)) return true;
+    }
+    return false;
+#else
+    for (int i = 0; i < zone.planes; ++i) {
+        const float dist = zone.nx[i] * center.x + zone.ny[i] * center.y + zone.nz[i] * center.z;
+        const float reach = std::abs(zone.nx[i]) * extent.x + std::abs(zone.ny[i]) * extent.y
+            + std::abs(zone.nz[i]) * extent.z;
+        if (dist - reach > zone.d[i]) return true;
+    }
+    return false;
+#endif
+}
+
+bool SafetyZoneMonitor::shapeOutside(const Zone& zone, const ConvexCollision::Shape& shape)
+{
+    for (int i = 0; i < zone.planes; ++i) {
+        const glm::vec3 n(zone.nx[i], zone.ny[i], zone.nz[i]);
+        if (glm::dot(n, shape.supportCore(-n)) - shape.radius > zone.d[i]) return true;
+    }
+    return false;
+}
+
+bool SafetyZoneMonitor::update(entt::registry& registry)
+{
+    const auto start = std::chrono::steady_clock::now();
+    m_stats = Stats();
+
+    // Violations of zones that stopped being zones.
+    FrameArena& arena = FrameArena::local();
+    FrameVector<entt::entity> orphaned(&arena);
+    for (entt::entity e : registry.view<SafetyZoneViolationComponent>(entt::exclude<SafetyZoneComponent>))
+        orphaned.push_back(e);
+    registry.remove<SafetyZoneViolationComponent>(orphaned.begin(), orphaned.end());
+
+    FrameVector<Event> events(&arena);
+    for (auto [entity, component, world] : registry.view<SafetyZoneComponent, WorldTransformComponent>().each()) {
+        m_inside.clear();
+        Zone zone;
+        if (component.armed && buildZone(world.matrix, component.kind == SafetyZoneComponent::Kind::HalfSpace, zone)) {
+            ++m_stats.zones;
+            m_world.queryLinks(zone.min, zone.max, [&](const CollisionWorld::LinkShape& link) {
+                ++m_stats.candidates;
+                const glm::vec3 center = 0.5f * (link.min + link.max);
+                if (boxOutside(zone, center, link.max - center)) return;
+                if (shapeOutside(zone, link.shape)) return;
+                if (!zone.halfSpace) {
+                    ++m_stats.narrowphaseTests;
+                    if (!ConvexCollision::intersects(zone.shape, link.shape)) return;
+                }
+                m_inside.push_back(link.entity);
+            });
+            std::sort(m_inside.begin(), m_inside.end());
+        }
+        m_stats.violations += m_inside.size();
+
+        const auto* previous = registry.try_get<SafetyZoneViolationComponent>(entity);
+        static const std::vector<entt::entity> kNone;
+        const std::vector<entt::entity>& before = previous ? previous->links : kNone;
+        if (before == m_inside) continue;
+
+        FrameVector<entt::entity> entered(&arena), left(&arena);
+        std::set_difference(m_inside.begin(), m_inside.end(), before.begin(), before.end(), std::back_inserter(entered));
+        std::set_difference(before.begin(), before.end(), m_inside.begin(), m_inside.end(), std::back_inserter(left));
+        for (entt::entity link : entered) events.push_back({ entity, link, robotOf(registry, link), true });
+        for (entt::entity link : left) events.push_back({ entity, link, robotOf(registry, link), false });
+
+        if (m_inside.empty()) registry.remove<SafetyZoneViolationComponent>(entity);
+        else registry.emplace_or_replace<SafetyZoneViolationComponent>(entity, m_inside);
+    }
+
+    m_stats.microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    // After the loop, so a handler may edit the registry.
+    if (m_handler)
+        for (const Event& event : events) m_handler(event);
+    return !events.empty();
+}
@@ -1,10 +1,13 @@
 #include "Scene.hpp"
+#include "components.hpp"
 #include <QDebug>
 
 Scene::Scene()
 {
-    // The constructor can be empty for now.
-    // We will create entities in ViewportWidget::initializeGL.
+    // Entities are created in ViewportWidget::initializeGL. The owning mesh
+    // group is made here, on the GUI thread, so no tick system running on
+    // the pool creates it on first use.
+    renderableMeshes(m_registry);
     ////qDebug() << ">>>>>> Scene constructed at:" << this;
 }
 
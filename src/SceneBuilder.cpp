@@ -1,11 +1,75 @@
 ﻿#include "SceneBuilder.hpp"
 #include "components.hpp"
+#include "KinematicModel.hpp"
+#include "JointStateBuffer.hpp"
 #include "Camera.hpp"
 #include "Mesh.hpp"
-#include "MeshUtils.hpp"
+#include "ConvexDecomposition.hpp"
+#include "MeshCache.hpp"
+#include "AssetPaths.hpp"
 #include "Primitivebuilders.hpp"
+#include "ThreadPool.hpp"
+#include "SensorStream.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <unordered_map>
 #include <QDebug>
 
+namespace
+{
+    // FNV-1a over "robot/kind/name": stable across runs and parsers.
+    std::uint64_t idFromName(const std::string& robot, const char* kind, const std::string& name)
+    {
+        std::uint64_t h = 0xcbf29ce484222325ull;
+        auto mix = [&h](const char* data, std::size_t size) {
+            for (std::size_t i = 0; i < size; ++i) { h ^= static_cast<unsigned char>(data[i]); h *= 0x100000001b3ull; }
+        };
+        mix(robot.data(), robot.size());
+        mix("/", 1);
+        mix(kind, std::char_traits<char>::length(kind));
+        mix("/", 1);
+        mix(name.data(), name.size());
+        return h ? h : 1;
+    }
+
+    // URDF and SDF carry no ids; derive them from names so loading the
+    // same file again matches link for link.
+    void assignPersistentIds(RobotDescription& description)
+    {
+        for (LinkDescription& link : description.links)
+            if (link.persistent_id == 0) link.persistent_id = idFromName(description.name, "link", link.name);
+        for (JointDescription& joint : description.joints)
+            if (joint.persistent_id == 0) joint.persistent_id = idFromName(description.name, "joint", joint.name);
+    }
+
+    bool sameMaterial(const MaterialDescription& a, const MaterialDescription& b)
+    {
+        return a.albedo_color == b.albedo_color && a.albedo_texture_path == b.albedo_texture_path
+            && a.metalness == b.metalness && a.roughness == b.roughness
+            && a.metal_roughness_texture_path == b.metal_roughness_texture_path
+            && a.emissive_color == b.emissive_color && a.emissive_intensity == b.emissive_intensity;
+    }
+
+    MaterialComponent materialFrom(const MaterialDescription& description)
+    {
+        MaterialComponent material;
+        material.albedo = glm::vec3(description.albedo_color);
+        material.metallic = description.metalness;
+        material.roughness = description.roughness;
+        material.emissive = description.emissive_color * description.emissive_intensity;
+        if (!description.albedo_texture_path.empty())
+            material.albedoMap = std::make_shared<Texture>(Texture{ 0, description.albedo_texture_path });
+        if (!description.metal_roughness_texture_path.empty())
+            material.metalRoughnessMap = std::make_shared<Texture>(Texture{ 0, description.metal_roughness_texture_path });
+        return material;
+    }
+}
+
 entt::entity SceneBuilder::createCamera(entt::registry& registry,
     const glm::vec3& position,
     const glm::vec3& colour)
@@ -21,6 +85,7 @@ entt::entity SceneBuilder::createCamera(entt::registry& registry,
     entt::entity gizE = registry.create();
     registry.emplace<ParentComponent>(gizE, camE);
     registry.emplace<CameraGizmoTag>(gizE);
+    registry.emplace<LayerComponent>(gizE, RenderLayers::Helpers);
 
     auto& gxf = registry.emplace<TransformComponent>(gizE);
     gxf.translation.z = -0.35f;
@@ -29,9 +94,9 @@ entt::entity SceneBuilder::createCamera(entt::registry& registry,
         glm::angleAxis(glm::radians(90.0f), glm::vec3(0, 1, 0)) *
         glm::angleAxis(glm::radians(-90.0f), glm::vec3(1, 0, 0));
 
-    auto& gmesh = registry.emplace<RenderableMeshComponent>(gizE);
-    loadStlIntoRenderable(
-        "D:/RoboticsSoftware/external/miniViewportCamera.stl", gmesh);
+    // Every camera shares the one decoded gizmo mesh.
+    registry.emplace<PendingMeshComponent>(gizE,
+        MeshCache::shared().loadAsync(AssetPaths::resolve("asset://miniViewportCamera.stl")));
 
     // FIX: Replaced C++20 designated initializer with C++17-compatible code.
 // First, emplace the component with its default values.
@@ -48,13 +113,19 @@ entt::entity SceneBuilder::createCamera(entt::registry& registry,
     lightPulse.onColor = glm::vec3(1.0f, 0.0f, 0.0f); // Example: Make one camera's light orange
     lightPulse.offColor = glm::vec3(0.3f, 0.0f, 0.0f);
     lightPulse.speed = 60.0f;
+    auto& ledLight = registry.emplace<PointLightComponent>(ledE);
+    ledLight.intensity = 0.6f;
+    ledLight.range = 1.5f;
 
     auto& lxf = registry.emplace<TransformComponent>(ledE);
     lxf.translation = { 0.1f, -0.115f, 0.275f };
     lxf.scale = glm::vec3(0.1f);
 
-    auto& lmesh = registry.emplace<RenderableMeshComponent>(ledE);
-    buildIcoSphere(lmesh.vertices, lmesh.indices);
+    std::vector<Vertex> ledVertices;
+    std::vector<unsigned> ledIndices;
+    buildIcoSphere(ledVertices, ledIndices);
+    registry.emplace<RenderableMeshComponent>(ledE,
+        MeshCache::shared().intern(std::move(ledVertices), std::move(ledIndices)));
 
     // FIX: Replaced C++20 designated initializer with C++17-compatible code.
     // Emplace the component for the LED, then set its albedo.
@@ -65,72 +136,304 @@ entt::entity SceneBuilder::createCamera(entt::registry& registry,
     return camE;
 }
 
+bool SceneBuilder::resolvePendingMeshes(entt::registry& registry)
+{
+    std::vector<entt::entity> ready;
+    for (auto [entity, pending] : registry.view<PendingMeshComponent>().each())
+        if (pending.mesh.wait_for(std::chrono::seconds(0)) == std::future_status::ready) ready.push_back(entity);
+
+    for (entt::entity entity : ready) {
+        try {
+            registry.emplace_or_replace<RenderableMeshComponent>(entity, registry.get<PendingMeshComponent>(entity).mesh.get());
+        }
+        catch (const std::exception& e) {
+            qWarning() << "[SceneBuilder]" << e.what();
+        }
+        registry.remove<PendingMeshComponent>(entity);
+    }
+    return !ready.empty();
+}
+
 void SceneBuilder::spawnRobot(Scene& scene, const RobotDescription& description)
 {
-    // --- DIAGNOSTIC LOGGING ---
-    ////qDebug() << "!!!!!!!! SceneBuilder::spawnRobot has been called! Now clearing previous robot... !!!!!!!!!";
+    RobotSceneDelta delta;
+    if (prepareRobot(description, delta))
+        commitRobot(scene, std::move(delta));
+}
 
-    auto& registry = scene.getRegistry();
+bool SceneBuilder::prepareRobot(RobotDescription description, RobotSceneDelta& out,
+    const ImportProgress& progress)
+{
+    out = {};
+    if (description.links.empty()) return false;
+    assignPersistentIds(description);
+
+    // Compile the tree once: parents before children, fixed origins baked.
+    auto model = std::make_shared<KinematicModel>(KinematicModel::fromDescription(description));
+    if (model->linkCount() == 0) return false;
+
+    const std::size_t linkCount = description.links.size();
+    out.meshes.resize(linkCount);
+    out.collisionMeshes.resize(linkCount);
+
+    // --- Mesh loading ---
+    // Each distinct file is one task. MeshCache decodes it only if no live
+    // entity holds it already, and links that share a file (wheels, mirrored
+    // arms) share one handle.
+    std::vector<std::string> files;
+    std::unordered_map<std::string, std::size_t> fileIndex;
+    std::vector<std::size_t> visualFile(linkCount, SIZE_MAX), collisionFile(linkCount, SIZE_MAX);
+    auto fileOf = [&](const std::string& path) {
+        const auto [it, inserted] = fileIndex.emplace(path, files.size());
+        if (inserted) files.push_back(path);
+        return it->second;
+    };
+    for (std::size_t i = 0; i < linkCount; ++i) {
+        const LinkDescription& link = description.links[i];
+        if (!link.mesh_filepath.empty()) visualFile[i] = fileOf(link.mesh_filepath);
+        // A collision mesh equal to the visual one adds nothing over fitting the render mesh.
+        if (!link.collision_mesh_filepath.empty() && link.collision_mesh_filepath != link.mesh_filepath)
+            collisionFile[i] = fileOf(link.collision_mesh_filepath);
+    }
 
-    // --- SAFER CLEANUP ---
-    // Instead of clearing the whole registry, we specifically find and
-    // destroy only the entities that are part of the old robot.
-    // We identify these by looking for a LinkComponent.
-    auto view = registry.view<LinkComponent>();
-    registry.destroy(view.begin(), view.end());
+    std::vector<MeshCache::Handle> loaded(files.size());
+    std::atomic<std::size_t> decoded{ 0 };
+    std::atomic<bool> cancelled{ false };
+    ThreadPool::shared().parallelFor(files.size(), [&](std::size_t f) {
+        if (cancelled.load(std::memory_order_relaxed)) return;
 
+        try {
+            loaded[f] = MeshCache::shared().load(files[f]);
+        }
+        catch (const std::exception& e) {
+            qWarning() << "[SceneBuilder]" << e.what();
+        }
 
-    // --- The rest of the function remains the same ---
-    std::unordered_map<std::string, entt::entity> linkNameToEntity;
+        const std::size_t done = decoded.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (progress && !progress(done, files.size()))
+            cancelled.store(true, std::memory_order_relaxed);
+    });
+    if (cancelled.load()) {
+        out = {};
+        return false;
+    }
 
-    for (const auto& linkDesc : description.links)
+    MeshCache::Handle placeholder;
+    for (std::size_t i = 0; i < linkCount; ++i)
     {
-        auto linkEntity = registry.create();
-        linkNameToEntity[linkDesc.name] = linkEntity;
-        registry.emplace<TagComponent>(linkEntity, linkDesc.name);
-        registry.emplace<LinkComponent>(linkEntity, linkDesc);
-        registry.emplace<TransformComponent>(linkEntity);
-
-        if (!linkDesc.mesh_filepath.empty())
+        if (visualFile[i] != SIZE_MAX)
         {
-            auto& meshComp = registry.emplace<RenderableMeshComponent>(linkEntity);
-
-            const std::vector<float>& raw = Mesh::getLitCubeVertices();
-            constexpr std::size_t stride = 6;
+            if (!loaded[visualFile[i]] && !placeholder) {
+                // Unreadable file: keep the link visible as the lit placeholder cube.
+                const std::vector<float>& raw = Mesh::getLitCubeVertices();
+                constexpr std::size_t stride = 6;
+
+                std::vector<Vertex> vertices;
+                vertices.reserve(raw.size() / stride);
+
+                for (std::size_t v = 0; v < raw.size(); v += stride)
+                {
+                    glm::vec3 pos{ raw[v],   raw[v + 1], raw[v + 2] };
+                    glm::vec3 normal{ raw[v + 3], raw[v + 4], raw[v + 5] };
+                    vertices.emplace_back(pos, normal);
+                }
+
+                placeholder = MeshCache::shared().intern(std::move(vertices), Mesh::getLitCubeIndices());
+            }
+            out.meshes[i].mesh = loaded[visualFile[i]] ? loaded[visualFile[i]] : placeholder;
+        }
+        if (collisionFile[i] != SIZE_MAX)
+            out.collisionMeshes[i].mesh = loaded[collisionFile[i]];
+    }
 
-            meshComp.vertices.clear();
-            meshComp.vertices.reserve(raw.size() / stride);
+    // --- Convex decomposition ---
+    // Of what CollisionWorld will fit each link from, once per distinct
+    // mesh. A mesh decomposed before is a file read; the placeholder cube
+    // is convex already.
+    static const bool decompose = qEnvironmentVariable("KR_CONVEX_DECOMPOSITION") != QLatin1String("0");
+    if (decompose) {
+        std::vector<MeshCache::Handle> sources;
+        std::unordered_map<const MeshData*, std::size_t> sourceIndex;
+        std::vector<std::size_t> linkSource(linkCount, SIZE_MAX);
+        for (std::size_t i = 0; i < linkCount; ++i) {
+            const MeshCache::Handle& source = out.collisionMeshes[i].mesh ? out.collisionMeshes[i].mesh : out.meshes[i].mesh;
+            if (!source || source == placeholder) continue;
+            const auto [it, inserted] = sourceIndex.emplace(source.get(), sources.size());
+            if (inserted) sources.push_back(source);
+            linkSource[i] = it->second;
+        }
+        std::vector<std::shared_ptr<const ConvexHullSet>> hulls(sources.size());
+        ThreadPool::shared().parallelFor(sources.size(), [&](std::size_t s) {
+            hulls[s] = MeshCache::shared().decomposition(sources[s]);
+        });
+        for (std::size_t i = 0; i < linkCount; ++i)
+            if (linkSource[i] != SIZE_MAX) out.collisionMeshes[i].hulls = hulls[linkSource[i]];
+    }
 
-            for (std::size_t i = 0; i < raw.size(); i += stride)
-            {
-                glm::vec3 pos{ raw[i],   raw[i + 1], raw[i + 2] };
-                glm::vec3 normal{ raw[i + 3], raw[i + 4], raw[i + 5] };
-                meshComp.vertices.emplace_back(pos, normal);
-            }
+    out.model = std::move(model);
+    out.description = std::move(description);
+    return true;
+}
 
-            meshComp.indices = Mesh::getLitCubeIndices();
+void SceneBuilder::commitRobot(Scene& scene, RobotSceneDelta&& delta, bool replaceExisting)
+{
+    if (!delta.model) return;
+    auto& registry = scene.getRegistry();
+    const RobotDescription& description = delta.description;
+    const KinematicModel& model = *delta.model;
+
+    // --- Matching ---
+    // Links already in the scene are patched in place when their persistent
+    // id comes back, so an edit to one link keeps every other entity, its
+    // GPU range and its fitted collision shape. Everything unmatched goes.
+    std::unordered_map<std::uint64_t, entt::entity> existing;
+    std::vector<entt::entity> stale;
+    if (replaceExisting) {
+        for (auto [e, link] : registry.view<LinkComponent>().each()) {
+            if (!existing.emplace(link.description.persistent_id, e).second) stale.push_back(e);
         }
     }
 
-    for (const auto& jointDesc : description.joints)
-    {
-        entt::entity parentEntity = entt::null;
-        entt::entity childEntity = entt::null;
+    std::unordered_map<std::string, entt::entity> linkNameToEntity;
+    linkNameToEntity.reserve(description.links.size());
+    std::vector<char> reused(description.links.size(), 0);
 
-        if (linkNameToEntity.count(jointDesc.parent_link_name)) {
-            parentEntity = linkNameToEntity.at(jointDesc.parent_link_name);
+    for (std::size_t i = 0; i < description.links.size(); ++i)
+    {
+        const auto& linkDesc = description.links[i];
+        entt::entity linkEntity = entt::null;
+        if (const auto it = existing.find(linkDesc.persistent_id); it != existing.end()) {
+            linkEntity = it->second;
+            existing.erase(it);
+            reused[i] = 1;
         }
-        if (linkNameToEntity.count(jointDesc.child_link_name)) {
-            childEntity = linkNameToEntity.at(jointDesc.child_link_name);
+        else {
+            linkEntity = registry.create();
+            registry.emplace<TransformComponent>(linkEntity);
         }
+        linkNameToEntity[linkDesc.name] = linkEntity;
 
-        if (registry.valid(parentEntity) && registry.valid(childEntity))
-        {
-            registry.emplace<ParentComponent>(childEntity, parentEntity);
-            auto& childTransform = registry.get<TransformComponent>(childEntity);
-            childTransform.translation = jointDesc.origin_xyz;
+        if (auto* tag = registry.try_get<TagComponent>(linkEntity); !tag || tag->tag != linkDesc.name)
+            registry.emplace_or_replace<TagComponent>(linkEntity, linkDesc.name);
+        // The description's material replaces the component only when it
+        // changed, so a patch keeps what was edited in the scene since.
+        const auto* oldLink = registry.try_get<LinkComponent>(linkEntity);
+        if (!oldLink || !registry.all_of<MaterialComponent>(linkEntity)
+            || !sameMaterial(oldLink->description.material, linkDesc.material))
+            registry.emplace_or_replace<MaterialComponent>(linkEntity, materialFrom(linkDesc.material));
+        registry.emplace_or_replace<LinkComponent>(linkEntity, linkDesc);
+        registry.emplace_or_replace<LayerComponent>(linkEntity, RenderLayers::fromName(linkDesc.editor_layer));
+
+        // Same file, same handle (MeshCache returns the live one): leave it alone.
+        const auto* mesh = registry.try_get<RenderableMeshComponent>(linkEntity);
+        if (!delta.meshes[i].mesh) registry.remove<RenderableMeshComponent>(linkEntity);
+        else if (!mesh || mesh->mesh != delta.meshes[i].mesh)
+            registry.emplace_or_replace<RenderableMeshComponent>(linkEntity, std::move(delta.meshes[i]));
+
+        const auto* collision = registry.try_get<CollisionMeshComponent>(linkEntity);
+        if (!delta.collisionMeshes[i].mesh && !delta.collisionMeshes[i].hulls) registry.remove<CollisionMeshComponent>(linkEntity);
+        else if (!collision || collision->mesh != delta.collisionMeshes[i].mesh || collision->hulls != delta.collisionMeshes[i].hulls)
+            registry.emplace_or_replace<CollisionMeshComponent>(linkEntity, std::move(delta.collisionMeshes[i]));
+    }
+    for (const auto& [id, e] : existing) stale.push_back(e);
+    registry.destroy(stale.begin(), stale.end());
+
+    KinematicModelComponent kin;
+    kin.model = delta.model;
+    kin.links.resize(model.linkCount());
+    kin.q.assign(model.dofCount(), 0.0);
+
+    for (int link = 0; link < model.linkCount(); ++link)
+    {
+        const entt::entity e = linkNameToEntity.at(model.linkName(link));
+        kin.links[link] = e;
+
+        // A fitted shape stays valid across the patch, but not its robot and link index.
+        if (const auto* shape = registry.try_get<CollisionShapeComponent>(e);
+            shape && (shape->link != link || shape->robot != kin.links[0]))
+            registry.remove<CollisionShapeComponent>(e);
+        if (link > 0) registry.remove<KinematicModelComponent, JointStateComponent>(e);
+
+        const int parent = model.parentOf(link);
+        if (parent < 0) {
+            registry.remove<JointComponent, ParentComponent>(e);
+            continue;
+        }
+
+        const auto& jointDesc = description.joints[model.descriptionJoint(link)];
+        JointComponent joint;
+        joint.description = jointDesc;
+        joint.parentLink = kin.links[parent];
+        joint.childLink = e;
+        joint.dof = model.dofOf(link);
+        registry.emplace_or_replace<JointComponent>(e, std::move(joint));
+
+        registry.emplace_or_replace<ParentComponent>(e, kin.links[parent]);
+        const KinematicModel::Pose local = model.localPose(link, 0.0);
+        auto& childTransform = registry.get<TransformComponent>(e);
+        childTransform.translation = local.translation;
+        childTransform.rotation = local.rotation;
+    }
+
+    // The root carries the robot's placement; KinematicSystem only writes
+    // joint children. A patched root stays where it was moved to.
+    const entt::entity root = kin.links[0];
+    if (!registry.all_of<KinematicModelComponent>(root)) {
+        auto& rootTransform = registry.get<TransformComponent>(root);
+        const glm::vec3& rpy = description.base_origin_rpy;
+        rootTransform.translation = description.base_origin_xyz;
+        rootTransform.rotation = glm::angleAxis(rpy.z, glm::vec3(0, 0, 1))
+                               * glm::angleAxis(rpy.y, glm::vec3(0, 1, 0))
+                               * glm::angleAxis(rpy.x, glm::vec3(1, 0, 0));
+    }
+
+    // Joint positions survive the patch while the DOFs do; the new q forces
+    // KinematicSystem to apply them again next tick.
+    const auto* state = registry.try_get<JointStateComponent>(root);
+    if (!state || !state->buffer || state->buffer->size() != std::size_t(model.dofCount()))
+        registry.emplace_or_replace<JointStateComponent>(root, std::make_shared<JointStateBuffer>(std::size_t(model.dofCount())));
+    registry.emplace_or_replace<KinematicModelComponent>(root, std::move(kin));
+}
+
+std::size_t SceneBuilder::addVirtualSensors(entt::registry& registry, entt::entity root)
+{
+    const auto* kin = registry.try_get<KinematicModelComponent>(root);
+    if (!kin) return 0;
+
+    std::size_t added = 0;
+    for (entt::entity link : kin->links) {
+        const auto* linkComponent = registry.try_get<LinkComponent>(link);
+        if (!linkComponent) continue;
+        for (const NamedTransform& mount : linkComponent->description.sensor_mounts) {
+            std::string lower = mount.name;
+            std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+            const bool camera = lower.find("camera") != std::string::npos || lower.find("depth") != std::string::npos
+                || lower.find("rgbd") != std::string::npos;
+
+            VirtualSensorComponent sensor;
+            sensor.kind = camera ? VirtualSensorComponent::Kind::DepthCamera : VirtualSensorComponent::Kind::Lidar;
+            sensor.mount = mount.name;
+            const std::size_t perFrame = camera
+                ? std::size_t(sensor.width) * std::size_t(sensor.height)
+                : std::size_t(sensor.beams) * std::size_t(sensor.stepsPerTurn);
+
+            const std::string name = linkComponent->description.name + "/" + mount.name;
+            const entt::entity e = registry.create();
+            registry.emplace<TagComponent>(e, name);
+            auto& transform = registry.emplace<TransformComponent>(e);
+            transform.translation = mount.position;
+            transform.rotation = glm::angleAxis(mount.rpy.z, glm::vec3(0, 0, 1))
+                               * glm::angleAxis(mount.rpy.y, glm::vec3(0, 1, 0))
+                               * glm::angleAxis(mount.rpy.x, glm::vec3(1, 0, 0));
+            registry.emplace<ParentComponent>(e, link);
+            auto& output = registry.emplace<SensorStreamComponent>(e);
+            output.stream = std::make_shared<SensorStream>(name, 2 * perFrame);
+            output.maxAge = camera ? 1.5f / sensor.framesPerSecond : 1.0f / sensor.turnsPerSecond;
+            registry.emplace<VirtualSensorComponent>(e, std::move(sensor));
+            ++added;
         }
     }
+    return added;
 }
 
 entt::entity SceneBuilder::makeCR(entt::registry& r,
@@ -164,7 +467,7 @@ entt::entity SceneBuilder::makeParam(entt::registry& r,
 
     SplineComponent sp;
     sp.type = SplineType::Parametric;
-    sp.parametric.func = std::move(f);
+    sp.parametric.func = std::make_shared<const std::function<glm::vec3(float)>>(std::move(f));
     sp.coreColour = coreColour;       // Set the new member
     sp.glowColour = glowColour;
     sp.thickness = glowThickness;
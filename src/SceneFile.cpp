@@ -0,0 +1,1022 @@
+#include "SceneFile.hpp"
+#include "SceneFileFormat.hpp"
+#include "components.hpp"
+#include "MeshBinary.hpp"
+#include "MeshCache.hpp"
+#include "ThreadPool.hpp"
+#include "TraceZones.hpp"
+
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <entt/entt.hpp>
+
+using namespace SceneFileFormat;
+
+// One chunk's components, staged off the GUI thread.
+struct SceneFile::Loaded::Column
+{
+    virtual ~Column() = default;
+    virtual void commit(entt::registry& registry, const std::vector<entt::entity>& entities) = 0;
+    // True if it changes components other columns add; those commit last.
+    virtual bool patches() const { return false; }
+};
+
+SceneFile::Loaded::Loaded() = default;
+SceneFile::Loaded::~Loaded() = default;
+SceneFile::Loaded::Loaded(Loaded&&) noexcept = default;
+SceneFile::Loaded& SceneFile::Loaded::operator=(Loaded&&) noexcept = default;
+
+namespace
+{
+    std::uint64_t align8(std::uint64_t offset) { return (offset + 7) & ~std::uint64_t(7); }
+
+    void put3(float out[3], const glm::vec3& v) { out[0] = v.x; out[1] = v.y; out[2] = v.z; }
+    void put4(float out[4], const glm::vec4& v) { out[0] = v.x; out[1] = v.y; out[2] = v.z; out[3] = v.w; }
+    glm::vec3 get3(const float v[3]) { return glm::vec3(v[0], v[1], v[2]); }
+    glm::vec4 get4(const float v[4]) { return glm::vec4(v[0], v[1], v[2], v[3]); }
+
+    // ========================================================================
+    // --- Writing ---
+    // ========================================================================
+
+    // Strings chunk under construction; equal strings are stored once.
+    class StringTable
+    {
+    public:
+        StringRef add(const std::string& s)
+        {
+            if (s.empty()) return {};
+            const auto [it, inserted] = m_offsets.emplace(s, std::uint32_t(m_bytes.size()));
+            if (inserted) m_bytes.insert(m_bytes.end(), s.begin(), s.end());
+            return { it->second, std::uint32_t(s.size()) };
+        }
+        const std::vector<unsigned char>& bytes() const { return m_bytes; }
+
+    private:
+        std::vector<unsigned char> m_bytes;
+        std::unordered_map<std::string, std::uint32_t> m_offsets;
+    };
+
+    struct PendingChunk {
+        ChunkType type;
+        std::uint32_t count = 0;
+        std::vector<unsigned char> bytes;
+
+        // Appends one column, padded so the next starts 8-byte aligned.
+        template <typename T>
+        void column(const std::vector<T>& values)
+        {
+            const auto* p = reinterpret_cast<const unsigned char*>(values.data());
+            bytes.insert(bytes.end(), p, p + values.size() * sizeof(T));
+            bytes.resize(std::size_t(align8(bytes.size())), 0);
+        }
+    };
+
+    // The saved entities in file order, and each one's number.
+    struct Numbering {
+        std::vector<entt::entity> entities;
+        std::unordered_map<entt::entity, std::uint32_t> numberOf;
+    };
+
+    bool isSaved(const entt::registry& registry, entt::entity e)
+    {
+        return !registry.any_of<LinkComponent, JointComponent, RobotRootComponent, CameraComponent, CameraGizmoTag,
+            PointCloudComponent, SensorStreamComponent, ReconstructionComponent, WorldCellProxyTag,
+            PrefabInstanceComponent>(e);
+    }
+
+    // Starts the chunk of component C: the rows and the entity column.
+    template <class C>
+    std::vector<const C*> beginChunk(const entt::registry& registry, const Numbering& numbering, PendingChunk& chunk)
+    {
+        std::vector<const C*> rows;
+        std::vector<std::uint32_t> numbers;
+        for (std::uint32_t i = 0; i < numbering.entities.size(); ++i)
+            if (const C* c = registry.try_get<C>(numbering.entities[i])) {
+                rows.push_back(c);
+                numbers.push_back(i);
+            }
+        chunk.count = std::uint32_t(rows.size());
+        chunk.column(numbers);
+        return rows;
+    }
+
+    template <class Tag>
+    PendingChunk tagChunk(const entt::registry& registry, const Numbering& numbering, ChunkType type)
+    {
+        PendingChunk chunk{ type };
+        std::vector<std::uint32_t> numbers;
+        for (std::uint32_t i = 0; i < numbering.entities.size(); ++i)
+            if (registry.all_of<Tag>(numbering.entities[i])) numbers.push_back(i);
+        chunk.count = std::uint32_t(numbers.size());
+        chunk.column(numbers);
+        return chunk;
+    }
+
+    GradientRef addGradient(std::vector<ColorStopRecord>& pool, const std::vector<ColorStop>& stops)
+    {
+        GradientRef ref{ std::uint32_t(pool.size()), std::uint32_t(stops.size()) };
+        for (const ColorStop& stop : stops) {
+            ColorStopRecord r;
+            r.position = stop.position;
+            put4(r.color, stop.color);
+            pool.push_back(r);
+        }
+        return ref;
+    }
+
+    VisualizerRecord toRecord(const FieldVisualizerComponent& v, std::vector<ColorStopRecord>& gradients)
+    {
+        VisualizerRecord r;
+        r.enabled = v.isEnabled;
+        r.displayMode = std::uint32_t(v.displayMode);
+        put3(r.boundsMin, v.bounds.min);
+        put3(r.boundsMax, v.bounds.max);
+        r.useBakedField = v.useBakedField;
+        for (int i = 0; i < 3; ++i) r.bakeResolution[i] = v.bakeResolution[i];
+
+        const auto& a = v.arrowSettings;
+        for (int i = 0; i < 3; ++i) r.arrows.density[i] = a.density[i];
+        r.arrows.vectorScale = a.vectorScale;
+        r.arrows.headScale = a.headScale;
+        r.arrows.intensityMultiplier = a.intensityMultiplier;
+        r.arrows.cullingThreshold = a.cullingThreshold;
+        r.arrows.scaleByLength = a.scaleByLength;
+        r.arrows.scaleByThickness = a.scaleByThickness;
+        r.arrows.adaptive = a.adaptive;
+        r.arrows.coloringMode = std::uint32_t(a.coloringMode);
+        r.arrows.lengthScaleMultiplier = a.lengthScaleMultiplier;
+        r.arrows.thicknessScaleMultiplier = a.thicknessScaleMultiplier;
+        r.arrows.refineLevels = a.refineLevels;
+        r.arrows.refineThreshold = a.refineThreshold;
+        const glm::vec4* arrowAxes[6] = { &a.xPosColor, &a.xNegColor, &a.yPosColor, &a.yNegColor, &a.zPosColor, &a.zNegColor };
+        for (int i = 0; i < 6; ++i) put4(r.arrows.axisColors[i], *arrowAxes[i]);
+        r.arrows.intensityGradient = addGradient(gradients, a.intensityGradient);
+
+        const auto& f = v.flowSettings;
+        r.flow.particleCount = f.particleCount;
+        r.flow.lifetime = f.lifetime;
+        r.flow.baseSpeed = f.baseSpeed;
+        r.flow.speedIntensityMultiplier = f.speedIntensityMultiplier;
+        r.flow.baseSize = f.baseSize;
+        r.flow.headScale = f.headScale;
+        r.flow.peakSizeMultiplier = f.peakSizeMultiplier;
+        r.flow.minSize = f.minSize;
+        r.flow.growthPercentage = f.growthPercentage;
+        r.flow.shrinkPercentage = f.shrinkPercentage;
+        r.flow.randomWalkStrength = f.randomWalkStrength;
+        r.flow.scaleByLength = f.scaleByLength;
+        r.flow.scaleByThickness = f.scaleByThickness;
+        r.flow.coloringMode = std::uint32_t(f.coloringMode);
+        r.flow.lengthScaleMultiplier = f.lengthScaleMultiplier;
+        r.flow.thicknessScaleMultiplier = f.thicknessScaleMultiplier;
+
+        const auto& p = v.particleSettings;
+        r.particles.solid = p.isSolid;
+        r.particles.particleCount = p.particleCount;
+        r.particles.lifetime = p.lifetime;
+        r.particles.baseSpeed = p.baseSpeed;
+        r.particles.speedIntensityMultiplier = p.speedIntensityMultiplier;
+        r.particles.baseSize = p.baseSize;
+        r.particles.peakSizeMultiplier = p.peakSizeMultiplier;
+        r.particles.minSize = p.minSize;
+        r.particles.baseGlowSize = p.baseGlowSize;
+        r.particles.peakGlowMultiplier = p.peakGlowMultiplier;
+        r.particles.minGlowSize = p.minGlowSize;
+        r.particles.randomWalkStrength = p.randomWalkStrength;
+        r.particles.emissionRate = p.emissionRate;
+        r.particles.coloringMode = std::uint32_t(p.coloringMode);
+        const glm::vec4* particleAxes[6] = { &p.xPosColor, &p.xNegColor, &p.yPosColor, &p.yNegColor, &p.zPosColor, &p.zNegColor };
+        for (int i = 0; i < 6; ++i) put4(r.particles.axisColors[i], *particleAxes[i]);
+        r.particles.intensityGradient = addGradient(gradients, p.intensityGradient);
+        r.particles.lifetimeGradient = addGradient(gradients, p.lifetimeGradient);
+
+        const auto& s = v.streamlineSettings;
+        for (int i = 0; i < 3; ++i) r.streamlines.seedDensity[i] = s.seedDensity[i];
+        r.streamlines.maxSteps = s.maxSteps;
+        r.streamlines.stepLength = s.stepLength;
+        r.streamlines.minSpeed = s.minSpeed;
+        r.streamlines.thickness = s.thickness;
+        put4(r.streamlines.glowColour, s.glowColour);
+        put4(r.streamlines.coreColour, s.coreColour);
+        return r;
+    }
+
+    // ========================================================================
+    // --- Reading ---
+    // ========================================================================
+
+    // Bounds-checked view of a mapped .krscene; values are copied out, so
+    // the mapping needs no particular alignment.
+    class Reader
+    {
+    public:
+        Reader(const unsigned char* data, std::size_t size) : m_data(data), m_size(size) {}
+
+        bool fits(std::uint64_t offset, std::uint64_t bytes) const { return offset <= m_size && bytes <= m_size - offset; }
+
+        template <typename T>
+        T read(std::uint64_t offset) const
+        {
+            if (!fits(offset, sizeof(T))) throw std::runtime_error(".krscene is truncated.");
+            T value;
+            std::memcpy(&value, m_data + offset, sizeof(T));
+            return value;
+        }
+
+        std::string string(const Chunk& strings, const StringRef& ref) const
+        {
+            if (ref.length == 0) return {};
+            if (std::uint64_t(ref.offset) + ref.length > strings.size)
+                throw std::runtime_error(".krscene string is out of range.");
+            return std::string(reinterpret_cast<const char*>(m_data + strings.offset + ref.offset), ref.length);
+        }
+
+        const unsigned char* at(std::uint64_t offset) const { return m_data + offset; }
+
+    private:
+        const unsigned char* m_data;
+        std::size_t m_size;
+    };
+
+    // Walks a component chunk's columns in order.
+    class ColumnReader
+    {
+    public:
+        ColumnReader(const Reader& in, const Chunk& chunk) : m_in(in), m_next(chunk.offset), m_end(chunk.offset + chunk.size) {}
+
+        template <typename T>
+        std::vector<T> next(std::uint64_t count)
+        {
+            const std::uint64_t bytes = count * sizeof(T);
+            if (bytes > m_end - m_next) throw std::runtime_error(".krscene chunk is truncated.");
+            std::vector<T> values(std::size_t(count));
+            if (bytes) std::memcpy(values.data(), m_in.at(m_next), std::size_t(bytes));
+            m_next = std::min(align8(m_next + bytes), m_end);
+            return values;
+        }
+
+    private:
+        const Reader& m_in;
+        std::uint64_t m_next, m_end;
+    };
+
+    template <class C>
+    struct Staged final : SceneFile::Loaded::Column
+    {
+        std::vector<std::uint32_t> rows;
+        std::vector<C> values;   ///< unused for tags
+
+        void commit(entt::registry& registry, const std::vector<entt::entity>& entities) override
+        {
+            std::vector<entt::entity> targets;
+            targets.reserve(rows.size());
+            for (std::uint32_t row : rows) targets.push_back(entities[row]);
+            if constexpr (std::is_empty_v<C>) registry.insert<C>(targets.begin(), targets.end());
+            else registry.insert<C>(targets.begin(), targets.end(), values.begin());
+        }
+    };
+
+    // Parents name file entities, so they are resolved at commit.
+    struct StagedParents final : SceneFile::Loaded::Column
+    {
+        std::vector<std::uint32_t> rows;
+        std::vector<std::uint32_t> parents;
+
+        void commit(entt::registry& registry, const std::vector<entt::entity>& entities) override
+        {
+            for (std::size_t i = 0; i < rows.size(); ++i)
+                if (parents[i] < entities.size())
+                    registry.emplace<ParentComponent>(entities[rows[i]], ParentComponent{ entities[parents[i]] });
+        }
+    };
+
+    // Temporal settings go onto visualizers their own chunk added.
+    struct StagedTemporal final : SceneFile::Loaded::Column
+    {
+        std::vector<std::uint32_t> rows;
+        std::vector<TemporalRecord> records;
+
+        void commit(entt::registry& registry, const std::vector<entt::entity>& entities) override
+        {
+            for (std::size_t i = 0; i < rows.size(); ++i) {
+                auto* vis = registry.try_get<FieldVisualizerComponent>(entities[rows[i]]);
+                const TemporalRecord& r = records[i];
+                if (!vis || r.version > kTemporalRecordVersion) continue;
+                vis->temporalSettings.enabled = r.enabled != 0;
+                vis->temporalSettings.keyInterval = r.keyInterval;
+                vis->temporalSettings.slicesPerTick = r.slicesPerTick;
+            }
+        }
+        bool patches() const override { return true; }
+    };
+
+    // The entity column of a component chunk, checked against the header.
+    std::vector<std::uint32_t> readRows(ColumnReader& columns, const Chunk& chunk, std::uint32_t entityCount)
+    {
+        std::vector<std::uint32_t> rows = columns.next<std::uint32_t>(chunk.count);
+        std::vector<bool> seen(entityCount, false);
+        for (std::uint32_t row : rows) {
+            if (row >= entityCount || seen[row]) throw std::runtime_error(".krscene chunk names a bad entity.");
+            seen[row] = true;
+        }
+        return rows;
+    }
+
+    template <class Tag>
+    std::unique_ptr<SceneFile::Loaded::Column> stageTag(std::vector<std::uint32_t> rows)
+    {
+        auto staged = std::make_unique<Staged<Tag>>();
+        staged->rows = std::move(rows);
+        return staged;
+    }
+
+    template <class C, class MakeFn>
+    std::unique_ptr<SceneFile::Loaded::Column> stage(std::vector<std::uint32_t> rows, MakeFn&& make)
+    {
+        auto staged = std::make_unique<Staged<C>>();
+        staged->values.reserve(rows.size());
+        for (std::size_t i = 0; i < rows.size(); ++i) staged->values.push_back(make(i));
+        staged->rows = std::move(rows);
+        return staged;
+    }
+
+    std::vector<ColorStop> readGradient(const std::vector<ColorStopRecord>& pool, const GradientRef& ref)
+    {
+        if (std::uint64_t(ref.first) + ref.count > pool.size()) throw std::runtime_error(".krscene gradient is out of range.");
+        std::vector<ColorStop> stops;
+        for (std::uint32_t i = 0; i < ref.count; ++i)
+            stops.push_back({ pool[ref.first + i].position, get4(pool[ref.first + i].color) });
+        return stops;
+    }
+
+    FieldVisualizerComponent fromRecord(const VisualizerRecord& r, const std::vector<ColorStopRecord>& gradients)
+    {
+        using Vis = FieldVisualizerComponent;
+        Vis v;
+        v.isEnabled = r.enabled != 0;
+        v.displayMode = Vis::DisplayMode(std::min<std::uint32_t>(r.displayMode, std::uint32_t(Vis::DisplayMode::Volume)));
+        v.bounds = { get3(r.boundsMin), get3(r.boundsMax) };
+        v.useBakedField = r.useBakedField != 0;
+        v.bakeResolution = glm::ivec3(r.bakeResolution[0], r.bakeResolution[1], r.bakeResolution[2]);
+        auto coloring = [](std::uint32_t mode) {
+            return Vis::ColoringMode(std::min<std::uint32_t>(mode, std::uint32_t(Vis::ColoringMode::Directional)));
+        };
+
+        auto& a = v.arrowSettings;
+        a.density = glm::ivec3(r.arrows.density[0], r.arrows.density[1], r.arrows.density[2]);
+        a.vectorScale = r.arrows.vectorScale;
+        a.headScale = r.arrows.headScale;
+        a.intensityMultiplier = r.arrows.intensityMultiplier;
+        a.cullingThreshold = r.arrows.cullingThreshold;
+        a.scaleByLength = r.arrows.scaleByLength != 0;
+        a.scaleByThickness = r.arrows.scaleByThickness != 0;
+        a.adaptive = r.arrows.adaptive != 0;
+        a.coloringMode = coloring(r.arrows.coloringMode);
+        a.lengthScaleMultiplier = r.arrows.lengthScaleMultiplier;
+        a.thicknessScaleMultiplier = r.arrows.thicknessScaleMultiplier;
+        a.refineLevels = r.arrows.refineLevels;
+        a.refineThreshold = r.arrows.refineThreshold;
+        glm::vec4* arrowAxes[6] = { &a.xPosColor, &a.xNegColor, &a.yPosColor, &a.yNegColor, &a.zPosColor, &a.zNegColor };
+        for (int i = 0; i < 6; ++i) *arrowAxes[i] = get4(r.arrows.axisColors[i]);
+        a.intensityGradient = readGradient(gradients, r.arrows.intensityGradient);
+
+        auto& f = v.flowSettings;
+        f.particleCount = r.flow.particleCount;
+        f.lifetime = r.flow.lifetime;
+        f.baseSpeed = r.flow.baseSpeed;
+        f.speedIntensityMultiplier = r.flow.speedIntensityMultiplier;
+        f.baseSize = r.flow.baseSize;
+        f.headScale = r.flow.headScale;
+        f.peakSizeMultiplier = r.flow.peakSizeMultiplier;
+        f.minSize = r.flow.minSize;
+        f.growthPercentage = r.flow.growthPercentage;
+        f.shrinkPercentage = r.flow.shrinkPercentage;
+        f.randomWalkStrength = r.flow.randomWalkStrength;
+        f.scaleByLength = r.flow.scaleByLength != 0;
+        f.scaleByThickness = r.flow.scaleByThickness != 0;
+        f.coloringMode = coloring(r.flow.coloringMode);
+        f.lengthScaleMultiplier = r.flow.lengthScaleMultiplier;
+        f.thicknessScaleMultiplier = r.flow.thicknessScaleMultiplier;
+
+        auto& p = v.particleSettings;
+        p.isSolid = r.particles.solid != 0;
+        p.particleCount = r.particles.particleCount;
+        p.lifetime = r.particles.lifetime;
+        p.baseSpeed = r.particles.baseSpeed;
+        p.speedIntensityMultiplier = r.particles.speedIntensityMultiplier;
+        p.baseSize = r.particles.baseSize;
+        p.peakSizeMultiplier = r.particles.peakSizeMultiplier;
+        p.minSize = r.particles.minSize;
+        p.baseGlowSize = r.particles.baseGlowSize;
+        p.peakGlowMultiplier = r.particles.peakGlowMultiplier;
+        p.minGlowSize = r.particles.minGlowSize;
+        p.randomWalkStrength = r.particles.randomWalkStrength;
+        p.emissionRate = r.particles.emissionRate;
+        p.coloringMode = coloring(r.particles.coloringMode);
+        glm::vec4* particleAxes[6] = { &p.xPosColor, &p.xNegColor, &p.yPosColor, &p.yNegColor, &p.zPosColor, &p.zNegColor };
+        for (int i = 0; i < 6; ++i) *particleAxes[i] = get4(r.particles.axisColors[i]);
+        p.intensityGradient = readGradient(gradients, r.particles.intensityGradient);
+        p.lifetimeGradient = readGradient(gradients, r.particles.lifetimeGradient);
+
+        auto& s = v.streamlineSettings;
+        s.seedDensity = glm::ivec3(r.streamlines.seedDensity[0], r.streamlines.seedDensity[1], r.streamlines.seedDensity[2]);
+        s.maxSteps = r.streamlines.maxSteps;
+        s.stepLength = r.streamlines.stepLength;
+        s.minSpeed = r.streamlines.minSpeed;
+        s.thickness = r.streamlines.thickness;
+        s.glowColour = get4(r.streamlines.glowColour);
+        s.coreColour = get4(r.streamlines.coreColour);
+        return v;
+    }
+
+    std::unique_ptr<SceneFile::Loaded::Column> decodeChunk(const Reader& in, const Chunk& chunk, const Chunk& strings,
+        const std::vector<MeshCache::Handle>& meshes, std::uint32_t entityCount)
+    {
+        ColumnReader columns(in, chunk);
+        std::vector<std::uint32_t> rows = readRows(columns, chunk, entityCount);
+        const std::uint64_t n = chunk.count;
+
+        switch (chunk.type) {
+        case Tags: {
+            const auto tags = columns.next<StringRef>(n);
+            return stage<TagComponent>(std::move(rows), [&](std::size_t i) { return TagComponent(in.string(strings, tags[i])); });
+        }
+        case Transforms: {
+            const auto t = columns.next<float>(n * 3), r = columns.next<float>(n * 4), s = columns.next<float>(n * 3);
+            return stage<TransformComponent>(std::move(rows), [&](std::size_t i) {
+                TransformComponent c;
+                c.translation = get3(&t[i * 3]);
+                c.rotation = glm::quat(r[i * 4 + 3], r[i * 4], r[i * 4 + 1], r[i * 4 + 2]);
+                c.scale = get3(&s[i * 3]);
+                return c;
+            });
+        }
+        case Parents: {
+            auto staged = std::make_unique<StagedParents>();
+            staged->parents = columns.next<std::uint32_t>(n);
+            staged->rows = std::move(rows);
+            return staged;
+        }
+        case RenderableMeshes: {
+            const auto index = columns.next<std::uint32_t>(n);
+            for (std::uint32_t m : index)
+                if (m >= meshes.size()) throw std::runtime_error(".krscene names a missing mesh.");
+            return stage<RenderableMeshComponent>(std::move(rows), [&](std::size_t i) { return RenderableMeshComponent{ meshes[index[i]] }; });
+        }
+        case Materials: {
+            const auto records = columns.next<MaterialRecord>(n);
+            return stage<MaterialComponent>(std::move(rows), [&](std::size_t i) {
+                const MaterialRecord& r = records[i];
+                MaterialComponent m;
+                m.albedo = get3(r.albedo);
+                m.emissive = get3(r.emissive);
+                m.metallic = r.metallic;
+                m.roughness = r.roughness;
+                if (r.albedoMap.length) m.albedoMap = std::make_shared<Texture>(Texture{ 0, in.string(strings, r.albedoMap) });
+                if (r.metalRoughnessMap.length)
+                    m.metalRoughnessMap = std::make_shared<Texture>(Texture{ 0, in.string(strings, r.metalRoughnessMap) });
+                return m;
+            });
+        }
+        case PointLights: {
+            const auto color = columns.next<float>(n * 3), intensity = columns.next<float>(n), range = columns.next<float>(n);
+            return stage<PointLightComponent>(std::move(rows), [&](std::size_t i) {
+                return PointLightComponent{ get3(&color[i * 3]), intensity[i], range[i] };
+            });
+        }
+        case PulsingLights: {
+            const auto on = columns.next<float>(n * 3), off = columns.next<float>(n * 3), speed = columns.next<float>(n);
+            return stage<PulsingLightComponent>(std::move(rows), [&](std::size_t i) {
+                return PulsingLightComponent{ get3(&on[i * 3]), get3(&off[i * 3]), speed[i] };
+            });
+        }
+        case BoundingBoxes: {
+            const auto mn = columns.next<float>(n * 3), mx = columns.next<float>(n * 3);
+            return stage<BoundingBoxComponent>(std::move(rows), [&](std::size_t i) {
+                return BoundingBoxComponent{ get3(&mn[i * 3]), get3(&mx[i * 3]) };
+            });
+        }
+        case Splines: {
+            const auto records = columns.next<SplineRecord>(n);
+            std::uint64_t pointCount = 0;
+            for (const SplineRecord& r : records) pointCount = std::max<std::uint64_t>(pointCount, std::uint64_t(r.firstPoint) + r.pointCount);
+            const auto points = columns.next<float>(pointCount * 3);
+            return stage<SplineComponent>(std::move(rows), [&](std::size_t i) {
+                const SplineRecord& r = records[i];
+                SplineComponent s;
+                s.type = r.type == std::uint32_t(SplineType::Parametric) || r.type > std::uint32_t(SplineType::PiecewiseBezier)
+                    ? SplineType::Linear : SplineType(r.type);
+                for (std::uint32_t k = 0; k < r.pointCount; ++k) s.controlPoints.push_back(get3(&points[(r.firstPoint + k) * 3]));
+                s.thickness = r.thickness;
+                s.glowColour = get4(r.glowColour);
+                s.coreColour = get4(r.coreColour);
+                return s;
+            });
+        }
+        case PointEffectors: {
+            const auto strength = columns.next<float>(n), radius = columns.next<float>(n);
+            const auto falloff = columns.next<std::uint32_t>(n);
+            return stage<PointEffectorComponent>(std::move(rows), [&](std::size_t i) {
+                using Falloff = PointEffectorComponent::FalloffType;
+                return PointEffectorComponent{ strength[i], radius[i],
+                    Falloff(std::min<std::uint32_t>(falloff[i], std::uint32_t(Falloff::InverseSquare))) };
+            });
+        }
+        case SplineEffectors: {
+            const auto strength = columns.next<float>(n), radius = columns.next<float>(n);
+            const auto direction = columns.next<std::uint32_t>(n);
+            return stage<SplineEffectorComponent>(std::move(rows), [&](std::size_t i) {
+                using Direction = SplineEffectorComponent::ForceDirection;
+                return SplineEffectorComponent{ strength[i], radius[i], direction[i] != 0 ? Direction::Tangent : Direction::Perpendicular };
+            });
+        }
+        case MeshEffectors: {
+            const auto strength = columns.next<float>(n), distance = columns.next<float>(n);
+            return stage<MeshEffectorComponent>(std::move(rows), [&](std::size_t i) { return MeshEffectorComponent{ strength[i], distance[i] }; });
+        }
+        case DirectionalEffectors: {
+            const auto direction = columns.next<float>(n * 3), strength = columns.next<float>(n);
+            return stage<DirectionalEffectorComponent>(std::move(rows), [&](std::size_t i) {
+                return DirectionalEffectorComponent{ get3(&direction[i * 3]), strength[i] };
+            });
+        }
+        case SafetyZones: {
+            const auto kind = columns.next<std::uint32_t>(n), armed = columns.next<std::uint32_t>(n);
+            return stage<SafetyZoneComponent>(std::move(rows), [&](std::size_t i) {
+                using Kind = SafetyZoneComponent::Kind;
+                return SafetyZoneComponent{ kind[i] != 0 ? Kind::HalfSpace : Kind::Volume, armed[i] != 0 };
+            });
+        }
+        case Grids: {
+            const auto records = columns.next<GridRecord>(n);
+            std::uint64_t levelCount = 0;
+            for (const GridRecord& r : records) levelCount = std::max<std::uint64_t>(levelCount, std::uint64_t(r.firstLevel) + r.levelCount);
+            const auto levels = columns.next<GridLevelRecord>(levelCount);
+            return stage<GridComponent>(std::move(rows), [&](std::size_t i) {
+                const GridRecord& r = records[i];
+                GridComponent g;
+                g.masterVisible = (r.flags & MasterVisible) != 0;
+                for (int k = 0; k < 5; ++k) g.levelVisible[k] = (r.flags & (LevelVisible0 << k)) != 0;
+                g.showAxes = (r.flags & ShowAxes) != 0;
+                g.isMetric = (r.flags & Metric) != 0;
+                g.showIntersections = (r.flags & ShowIntersections) != 0;
+                g.isDotted = (r.flags & Dotted) != 0;
+                g.snappingEnabled = (r.flags & Snapping) != 0;
+                g.baseLineWidthPixels = r.baseLineWidth;
+                g.axisLineWidthPixels = r.axisLineWidth;
+                g.xAxisColor = get3(r.xAxisColor);
+                g.zAxisColor = get3(r.zAxisColor);
+                for (std::uint32_t k = 0; k < r.levelCount; ++k) {
+                    const GridLevelRecord& l = levels[r.firstLevel + k];
+                    g.levels.emplace_back(l.spacing, get3(l.color), l.fadeEnd, l.fadeStart);
+                }
+                return g;
+            });
+        }
+        case FieldVisualizers: {
+            const auto records = columns.next<VisualizerRecord>(n);
+            std::uint64_t stopCount = 0;
+            for (const VisualizerRecord& r : records)
+                for (const GradientRef& g : { r.arrows.intensityGradient, r.particles.intensityGradient, r.particles.lifetimeGradient })
+                    stopCount = std::max<std::uint64_t>(stopCount, std::uint64_t(g.first) + g.count);
+            const auto stops = columns.next<ColorStopRecord>(stopCount);
+            return stage<FieldVisualizerComponent>(std::move(rows), [&](std::size_t i) { return fromRecord(records[i], stops); });
+        }
+        case FieldTemporal: {
+            auto staged = std::make_unique<StagedTemporal>();
+            staged->records = columns.next<TemporalRecord>(n);
+            staged->rows = std::move(rows);
+            return staged;
+        }
+        case FieldSources: return stageTag<FieldSourceTag>(std::move(rows));
+        case EnvironmentColliders: return stageTag<EnvironmentColliderTag>(std::move(rows));
+        case PulsingSplines: return stageTag<PulsingSplineTag>(std::move(rows));
+        default:
+            return nullptr;   // written by a newer version; not ours to read
+        }
+    }
+}
+
+// ============================================================================
+// --- Save ---
+// ============================================================================
+
+std::vector<entt::entity> SceneFile::savedEntities(const entt::registry& registry)
+{
+    std::vector<entt::entity> entities;
+    for (auto entity : registry.view<TransformComponent>())
+        if (isSaved(registry, entity)) entities.push_back(entity);
+    return entities;
+}
+
+bool SceneFile::save(const entt::registry& registry, const std::string& path, std::string* error)
+{
+    return save(registry, savedEntities(registry), path, error);
+}
+
+bool SceneFile::save(const entt::registry& registry, const std::vector<entt::entity>& entities, const std::string& path,
+    std::string* error)
+{
+    KR_ZONE("save krscene");
+    Numbering numbering;
+    for (entt::entity entity : entities) {
+        numbering.numberOf.emplace(entity, std::uint32_t(numbering.entities.size()));
+        numbering.entities.push_back(entity);
+    }
+
+    StringTable strings;
+    std::vector<PendingChunk> chunks;
+
+    {
+        PendingChunk chunk{ Tags };
+        std::vector<StringRef> tags;
+        for (const TagComponent* c : beginChunk<TagComponent>(registry, numbering, chunk)) tags.push_back(strings.add(c->tag));
+        chunk.column(tags);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ Transforms };
+        std::vector<float> t, r, s;
+        for (const TransformComponent* c : beginChunk<TransformComponent>(registry, numbering, chunk)) {
+            t.insert(t.end(), { c->translation.x, c->translation.y, c->translation.z });
+            r.insert(r.end(), { c->rotation.x, c->rotation.y, c->rotation.z, c->rotation.w });
+            s.insert(s.end(), { c->scale.x, c->scale.y, c->scale.z });
+        }
+        chunk.column(t); chunk.column(r); chunk.column(s);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ Parents };
+        std::vector<std::uint32_t> parents;
+        for (const ParentComponent* c : beginChunk<ParentComponent>(registry, numbering, chunk)) {
+            const auto it = numbering.numberOf.find(c->parent);
+            parents.push_back(it != numbering.numberOf.end() ? it->second : kNoEntity);
+        }
+        chunk.column(parents);
+        chunks.push_back(std::move(chunk));
+    }
+
+    // Meshes: one blob per distinct MeshData.
+    std::vector<MeshRecord> meshRecords;
+    std::vector<std::vector<unsigned char>> blobs;
+    {
+        PendingChunk chunk{ RenderableMeshes };
+        std::unordered_map<const MeshData*, std::uint32_t> meshIndex;
+        std::vector<std::uint32_t> index;
+        for (const RenderableMeshComponent* c : beginChunk<RenderableMeshComponent>(registry, numbering, chunk)) {
+            const MeshData& mesh = c->mesh ? *c->mesh : MeshData::empty();
+            const auto [it, inserted] = meshIndex.emplace(&mesh, std::uint32_t(meshRecords.size()));
+            if (inserted) {
+                MeshRecord r;
+                r.contentHash = mesh.contentHash;
+                r.vertexCount = std::uint32_t(mesh.vertices.size());
+                r.indexCount = std::uint32_t(mesh.indices.size());
+                blobs.push_back(MeshBinary::encode(mesh, {}, 0));
+                r.size = blobs.back().size();
+                meshRecords.push_back(r);
+            }
+            index.push_back(it->second);
+        }
+        chunk.column(index);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ Materials };
+        std::vector<MaterialRecord> records;
+        for (const MaterialComponent* c : beginChunk<MaterialComponent>(registry, numbering, chunk)) {
+            MaterialRecord r;
+            put3(r.albedo, c->albedo);
+            put3(r.emissive, c->emissive);
+            r.metallic = c->metallic;
+            r.roughness = c->roughness;
+            if (c->albedoMap) r.albedoMap = strings.add(c->albedoMap->path);
+            if (c->metalRoughnessMap) r.metalRoughnessMap = strings.add(c->metalRoughnessMap->path);
+            records.push_back(r);
+        }
+        chunk.column(records);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ PointLights };
+        std::vector<float> color, intensity, range;
+        for (const PointLightComponent* c : beginChunk<PointLightComponent>(registry, numbering, chunk)) {
+            color.insert(color.end(), { c->color.x, c->color.y, c->color.z });
+            intensity.push_back(c->intensity);
+            range.push_back(c->range);
+        }
+        chunk.column(color); chunk.column(intensity); chunk.column(range);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ PulsingLights };
+        std::vector<float> on, off, speed;
+        for (const PulsingLightComponent* c : beginChunk<PulsingLightComponent>(registry, numbering, chunk)) {
+            on.insert(on.end(), { c->onColor.x, c->onColor.y, c->onColor.z });
+            off.insert(off.end(), { c->offColor.x, c->offColor.y, c->offColor.z });
+            speed.push_back(c->speed);
+        }
+        chunk.column(on); chunk.column(off); chunk.column(speed);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ BoundingBoxes };
+        std::vector<float> mn, mx;
+        for (const BoundingBoxComponent* c : beginChunk<BoundingBoxComponent>(registry, numbering, chunk)) {
+            mn.insert(mn.end(), { c->min.x, c->min.y, c->min.z });
+            mx.insert(mx.end(), { c->max.x, c->max.y, c->max.z });
+        }
+        chunk.column(mn); chunk.column(mx);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ Splines };
+        std::vector<SplineRecord> records;
+        std::vector<float> points;
+        for (const SplineComponent* c : beginChunk<SplineComponent>(registry, numbering, chunk)) {
+            // A parametric curve is code: keep the points it was sampled at.
+            const bool sampled = c->type == SplineType::Parametric;
+            const std::vector<glm::vec3>& source = sampled ? c->cachedVertices() : c->controlPoints;
+            SplineRecord r;
+            r.type = std::uint32_t(sampled ? SplineType::Linear : c->type);
+            r.firstPoint = std::uint32_t(points.size() / 3);
+            r.pointCount = std::uint32_t(source.size());
+            r.thickness = c->thickness;
+            put4(r.glowColour, c->glowColour);
+            put4(r.coreColour, c->coreColour);
+            for (const glm::vec3& p : source) points.insert(points.end(), { p.x, p.y, p.z });
+            records.push_back(r);
+        }
+        chunk.column(records); chunk.column(points);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ PointEffectors };
+        std::vector<float> strength, radius;
+        std::vector<std::uint32_t> falloff;
+        for (const PointEffectorComponent* c : beginChunk<PointEffectorComponent>(registry, numbering, chunk)) {
+            strength.push_back(c->strength);
+            radius.push_back(c->radius);
+            falloff.push_back(std::uint32_t(c->falloff));
+        }
+        chunk.column(strength); chunk.column(radius); chunk.column(falloff);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ SplineEffectors };
+        std::vector<float> strength, radius;
+        std::vector<std::uint32_t> direction;
+        for (const SplineEffectorComponent* c : beginChunk<SplineEffectorComponent>(registry, numbering, chunk)) {
+            strength.push_back(c->strength);
+            radius.push_back(c->radius);
+            direction.push_back(std::uint32_t(c->direction));
+        }
+        chunk.column(strength); chunk.column(radius); chunk.column(direction);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ MeshEffectors };
+        std::vector<float> strength, distance;
+        for (const MeshEffectorComponent* c : beginChunk<MeshEffectorComponent>(registry, numbering, chunk)) {
+            strength.push_back(c->strength);
+            distance.push_back(c->distance);
+        }
+        chunk.column(strength); chunk.column(distance);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ DirectionalEffectors };
+        std::vector<float> direction, strength;
+        for (const DirectionalEffectorComponent* c : beginChunk<DirectionalEffectorComponent>(registry, numbering, chunk)) {
+            direction.insert(direction.end(), { c->direction.x, c->direction.y, c->direction.z });
+            strength.push_back(c->strength);
+        }
+        chunk.column(direction); chunk.column(strength);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ SafetyZones };
+        std::vector<std::uint32_t> kind, armed;
+        for (const SafetyZoneComponent* c : beginChunk<SafetyZoneComponent>(registry, numbering, chunk)) {
+            kind.push_back(std::uint32_t(c->kind));
+            armed.push_back(c->armed ? 1u : 0u);
+        }
+        chunk.column(kind); chunk.column(armed);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ Grids };
+        std::vector<GridRecord> records;
+        std::vector<GridLevelRecord> levels;
+        for (const GridComponent* c : beginChunk<GridComponent>(registry, numbering, chunk)) {
+            GridRecord r;
+            r.flags = (c->masterVisible ? MasterVisible : 0u) | (c->showAxes ? ShowAxes : 0u) | (c->isMetric ? Metric : 0u)
+                | (c->showIntersections ? ShowIntersections : 0u) | (c->isDotted ? Dotted : 0u) | (c->snappingEnabled ? Snapping : 0u);
+            for (int k = 0; k < 5; ++k) if (c->levelVisible[k]) r.flags |= LevelVisible0 << k;
+            r.firstLevel = std::uint32_t(levels.size());
+            r.levelCount = std::uint32_t(c->levels.size());
+            r.baseLineWidth = c->baseLineWidthPixels;
+            r.axisLineWidth = c->axisLineWidthPixels;
+            put3(r.xAxisColor, c->xAxisColor);
+            put3(r.zAxisColor, c->zAxisColor);
+            for (const GridLevel& level : c->levels) {
+                GridLevelRecord l;
+                l.spacing = level.spacing;
+                put3(l.color, level.color);
+                l.fadeEnd = level.fadeInCameraDistanceEnd;
+                l.fadeStart = level.fadeInCameraDistanceStart;
+                levels.push_back(l);
+            }
+            records.push_back(r);
+        }
+        chunk.column(records); chunk.column(levels);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ FieldVisualizers };
+        std::vector<VisualizerRecord> records;
+        std::vector<ColorStopRecord> gradients;
+        for (const FieldVisualizerComponent* c : beginChunk<FieldVisualizerComponent>(registry, numbering, chunk))
+            records.push_back(toRecord(*c, gradients));
+        chunk.column(records); chunk.column(gradients);
+        chunks.push_back(std::move(chunk));
+    }
+    {
+        PendingChunk chunk{ FieldTemporal };
+        std::vector<TemporalRecord> records;
+        for (const FieldVisualizerComponent* c : beginChunk<FieldVisualizerComponent>(registry, numbering, chunk)) {
+            TemporalRecord r;
+            r.enabled = c->temporalSettings.enabled ? 1u : 0u;
+            r.keyInterval = c->temporalSettings.keyInterval;
+            r.slicesPerTick = c->temporalSettings.slicesPerTick;
+            records.push_back(r);
+        }
+        chunk.column(records);
+        chunks.push_back(std::move(chunk));
+    }
+    chunks.push_back(tagChunk<FieldSourceTag>(registry, numbering, FieldSources));
+    chunks.push_back(tagChunk<EnvironmentColliderTag>(registry, numbering, EnvironmentColliders));
+    chunks.push_back(tagChunk<PulsingSplineTag>(registry, numbering, PulsingSplines));
+
+    // Empty component chunks are left out; readers treat missing as none.
+    chunks.erase(std::remove_if(chunks.begin(), chunks.end(), [](const PendingChunk& c) { return c.count == 0; }), chunks.end());
+
+    // --- Layout: header, chunk table, strings, meshes, then the component chunks ---
+    FileHeader header;
+    header.entityCount = std::uint32_t(numbering.entities.size());
+    header.chunkTableOffset = align8(sizeof(FileHeader));
+    header.chunkCount = std::uint32_t(chunks.size() + 1 + (meshRecords.empty() ? 0 : 1));
+    std::uint64_t offset = align8(header.chunkTableOffset + header.chunkCount * sizeof(Chunk));
+
+    std::vector<Chunk> table;
+    table.push_back({ Strings, std::uint32_t(strings.bytes().size()), offset, strings.bytes().size() });
+    offset = align8(offset + strings.bytes().size());
+    if (!meshRecords.empty()) {
+        Chunk c{ Meshes, std::uint32_t(meshRecords.size()), offset, 0 };
+        offset = align8(offset + meshRecords.size() * sizeof(MeshRecord));
+        for (MeshRecord& r : meshRecords) {
+            r.offset = offset;
+            offset = align8(offset + r.size);
+        }
+        c.size = offset - c.offset;
+        table.push_back(c);
+    }
+    for (const PendingChunk& p : chunks) {
+        table.push_back({ p.type, p.count, offset, p.bytes.size() });
+        offset = align8(offset + p.bytes.size());
+    }
+
+    std::vector<unsigned char> bytes(std::size_t(offset), 0);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + header.chunkTableOffset, table.data(), table.size() * sizeof(Chunk));
+    std::size_t next = 0;
+    if (!strings.bytes().empty()) std::memcpy(bytes.data() + table[next].offset, strings.bytes().data(), strings.bytes().size());
+    ++next;
+    if (!meshRecords.empty()) {
+        std::memcpy(bytes.data() + table[next++].offset, meshRecords.data(), meshRecords.size() * sizeof(MeshRecord));
+        for (std::size_t i = 0; i < meshRecords.size(); ++i)
+            std::memcpy(bytes.data() + meshRecords[i].offset, blobs[i].data(), blobs[i].size());
+    }
+    for (const PendingChunk& p : chunks) {
+        if (!p.bytes.empty()) std::memcpy(bytes.data() + table[next].offset, p.bytes.data(), p.bytes.size());
+        ++next;
+    }
+
+    QSaveFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(reinterpret_cast<const char*>(bytes.data()), qint64(bytes.size())) != qint64(bytes.size()) ||
+        !file.commit()) {
+        if (error) *error = "Could not write " + path;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// --- Load ---
+// ============================================================================
+
+bool SceneFile::read(const std::string& path, Loaded& out, std::string* error)
+{
+    KR_ZONE("read krscene");
+    // Read-only mapping; closing 'file' on return unmaps it.
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = "Could not open " + path;
+        return false;
+    }
+    const qint64 size = file.size();
+    const unsigned char* map = size >= qint64(sizeof(FileHeader)) ? file.map(0, size) : nullptr;
+
+    try {
+        if (!map) throw std::runtime_error("Not a .krscene file.");
+        const Reader in(map, std::size_t(size));
+        const FileHeader header = in.read<FileHeader>(0);
+        if (header.magic != kMagic) throw std::runtime_error("Not a .krscene file.");
+        if (header.version != kVersion)
+            throw std::runtime_error(".krscene version " + std::to_string(header.version) + " is not supported.");
+        // Counts that size allocations are held to the file first: the chunk
+        // table must be in it, and an entity costs at least a byte.
+        if (!in.fits(header.chunkTableOffset, std::uint64_t(header.chunkCount) * sizeof(Chunk)))
+            throw std::runtime_error(".krscene chunk table is truncated.");
+        if (header.entityCount > std::uint64_t(size))
+            throw std::runtime_error(".krscene has more entities than bytes.");
+
+        Chunk strings, meshes;
+        std::vector<Chunk> components;
+        std::unordered_set<std::uint32_t> types;
+        for (std::uint32_t i = 0; i < header.chunkCount; ++i) {
+            const Chunk c = in.read<Chunk>(header.chunkTableOffset + std::uint64_t(i) * sizeof(Chunk));
+            if (!in.fits(c.offset, c.size)) throw std::runtime_error(".krscene chunk is out of range.");
+            if (!types.insert(c.type).second) throw std::runtime_error(".krscene has two chunks of one type.");
+            if (c.type == Strings) strings = c;
+            else if (c.type == Meshes) meshes = c;
+            else components.push_back(c);
+        }
+        if (std::uint64_t(meshes.count) * sizeof(MeshRecord) > meshes.size)
+            throw std::runtime_error(".krscene mesh table is truncated.");
+
+        // Meshes first, each on its own task: a live one with the saved
+        // content is shared, the rest are decoded and handed to the cache.
+        std::vector<MeshCache::Handle> handles(meshes.count);
+        std::vector<std::string> errors(std::max<std::size_t>(meshes.count, components.size()));
+        ThreadPool::shared().parallelFor(meshes.count, [&](std::size_t i) {
+            try {
+                const MeshRecord r = in.read<MeshRecord>(meshes.offset + i * sizeof(MeshRecord));
+                if (!in.fits(r.offset, r.size)) throw std::runtime_error(".krscene mesh is out of range.");
+                handles[i] = MeshCache::shared().findContent(std::size_t(r.contentHash), r.vertexCount, r.indexCount);
+                if (handles[i]) return;
+                MeshData data;
+                if (!MeshBinary::decode(in.at(r.offset), std::size_t(r.size), data))
+                    throw std::runtime_error(".krscene mesh is not a valid .kmesh.");
+                handles[i] = MeshCache::shared().adopt(std::move(data));
+            }
+            catch (const std::exception& e) {
+                errors[i] = e.what();
+            }
+        });
+        for (const std::string& e : errors)
+            if (!e.empty()) throw std::runtime_error(e);
+
+        // Then every component chunk on its own task.
+        Loaded loaded;
+        loaded.entityCount = header.entityCount;
+        loaded.columns.resize(components.size());
+        ThreadPool::shared().parallelFor(components.size(), [&](std::size_t i) {
+            try {
+                loaded.columns[i] = decodeChunk(in, components[i], strings, handles, header.entityCount);
+            }
+            catch (const std::exception& e) {
+                errors[i] = e.what();
+            }
+        });
+        for (const std::string& e : errors)
+            if (!e.empty()) throw std::runtime_error(e);
+        loaded.columns.erase(std::remove(loaded.columns.begin(), loaded.columns.end(), nullptr), loaded.columns.end());
+        out = std::move(loaded);
+    }
+    catch (const std::exception& e) {
+        if (error) *error = e.what();
+        return false;
+    }
+    return true;
+}
+
+std::vector<entt::entity> SceneFile::commit(entt::registry& registry, Loaded&& loaded)
+{
+    KR_ZONE("commit krscene");
+    std::vector<entt::entity> entities(loaded.entityCount);
+    registry.create(entities.begin(), entities.end());
+    for (const auto& column : loaded.columns)
+        if (!column->patches()) column->commit(registry, entities);
+    for (const auto& column : loaded.columns)
+        if (column->patches()) column->commit(registry, entities);
+    loaded.columns.clear();
+    return entities;
+}
@@ -0,0 +1,76 @@
+#include "SceneIndex.hpp"
+#include "components.hpp"
+
+#include <entt/entt.hpp>
+
+void SceneIndex::removeItem(std::uint32_t slot)
+{
+    Item& item = m_items[slot];
+    m_tree.destroyProxy(item.proxy);
+    m_itemOf.erase(item.entity);
+    item = Item{};
+    m_freeItems.push_back(slot);
+}
+
+bool SceneIndex::update(entt::registry& registry)
+{
+    std::unique_lock lock(m_mutex);
+    bool changed = false;
+    if (&registry != m_registry) {
+        changed = !m_items.empty();
+        m_tree.clear();
+        m_items.clear();
+        m_freeItems.clear();
+        m_itemOf.clear();
+        m_registry = &registry;
+    }
+
+    for (std::uint32_t slot = 0; slot < m_items.size(); ++slot) {
+        const Item& item = m_items[slot];
+        if (item.entity == entt::null) continue;
+        const auto* bounds = registry.valid(item.entity) ? registry.try_get<WorldBoundsComponent>(item.entity) : nullptr;
+        if (!bounds || !bounds->valid) {
+            removeItem(slot);
+            changed = true;
+        }
+    }
+
+    for (auto [entity, bounds] : registry.view<WorldBoundsComponent>().each()) {
+        if (!bounds.valid) continue;
+
+        const auto it = m_itemOf.find(entity);
+        if (it == m_itemOf.end()) {
+            std::uint32_t slot;
+            if (!m_freeItems.empty()) { slot = m_freeItems.back(); m_freeItems.pop_back(); }
+            else { slot = std::uint32_t(m_items.size()); m_items.emplace_back(); }
+            m_items[slot] = { entity, m_tree.createProxy(bounds.min, bounds.max, slot), bounds.min, bounds.max };
+            m_itemOf.emplace(entity, slot);
+            changed = true;
+            continue;
+        }
+
+        Item& item = m_items[it->second];
+        if (item.min == bounds.min && item.max == bounds.max) continue;
+        item.min = bounds.min;
+        item.max = bounds.max;
+        m_tree.moveProxy(item.proxy, item.min, item.max);
+        changed = true;
+    }
+    return changed;
+}
+
+void SceneIndex::clear()
+{
+    std::unique_lock lock(m_mutex);
+    m_tree.clear();
+    m_items.clear();
+    m_freeItems.clear();
+    m_itemOf.clear();
+    m_registry = nullptr;
+}
+
+std::size_t SceneIndex::size() const
+{
+    std::shared_lock lock(m_mutex);
+    return m_tree.proxyCount();
+}
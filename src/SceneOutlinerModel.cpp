@@ -0,0 +1,280 @@
+#include "SceneOutlinerModel.hpp"
+#include "components.hpp"
+
+#include <algorithm>
+#include <utility>
+
+SceneOutlinerModel::SceneOutlinerModel(entt::registry& registry, QObject* parent)
+    : QAbstractItemModel(parent), m_registry(registry)
+{
+    auto structure = [&](auto&& sink) {
+        m_connections.emplace_back(sink.template connect<&SceneOutlinerModel::onStructureChanged>(this));
+    };
+    structure(registry.on_construct<TransformComponent>());
+    structure(registry.on_destroy<TransformComponent>());
+    structure(registry.on_construct<ParentComponent>());
+    structure(registry.on_update<ParentComponent>());
+    structure(registry.on_destroy<ParentComponent>());
+    m_connections.emplace_back(registry.on_construct<TagComponent>().connect<&SceneOutlinerModel::onRenamed>(this));
+    m_connections.emplace_back(registry.on_update<TagComponent>().connect<&SceneOutlinerModel::onRenamed>(this));
+    m_connections.emplace_back(registry.on_destroy<TagComponent>().connect<&SceneOutlinerModel::onRenamed>(this));
+}
+
+void SceneOutlinerModel::onStructureChanged(entt::registry&, entt::entity entity) { queue(entity, true); }
+void SceneOutlinerModel::onRenamed(entt::registry&, entt::entity entity) { queue(entity, false); }
+
+void SceneOutlinerModel::queue(entt::entity entity, bool structural)
+{
+    // Tick systems may emit from pool workers: queue, and sync on the GUI thread.
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        m_pending.push_back(entity);
+        m_structureChanged |= structural;
+    }
+    if (!m_syncQueued.exchange(true, std::memory_order_acq_rel))
+        QMetaObject::invokeMethod(this, &SceneOutlinerModel::sync, Qt::QueuedConnection);
+}
+
+entt::entity SceneOutlinerModel::parentOf(entt::entity entity) const
+{
+    const auto* parent = m_registry.try_get<ParentComponent>(entity);
+    return parent && m_registry.valid(parent->parent) ? parent->parent : entt::null;
+}
+
+bool SceneOutlinerModel::shown(entt::entity entity) const
+{
+    return m_registry.valid(entity) && m_registry.all_of<TransformComponent>(entity);
+}
+
+void SceneOutlinerModel::refreshParents()
+{
+    if (!m_parentsStale) return;
+    m_parents.clear();
+    for (auto [entity, parent] : m_registry.view<ParentComponent>().each())
+        if (m_registry.valid(parent.parent)) m_parents.insert(parent.parent);
+    m_parentsStale = false;
+}
+
+void SceneOutlinerModel::sync()
+{
+    m_syncQueued.store(false, std::memory_order_release);
+    bool structural;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        m_syncScratch.swap(m_pending);
+        m_pending.clear();
+        structural = std::exchange(m_structureChanged, false);
+    }
+    if (m_syncScratch.empty()) return;
+    if (structural) m_parentsStale = true;
+
+    std::sort(m_syncScratch.begin(), m_syncScratch.end());
+    m_syncScratch.erase(std::unique(m_syncScratch.begin(), m_syncScratch.end()), m_syncScratch.end());
+    if (m_syncScratch.size() > kResetThreshold) {
+        reset();
+        return;
+    }
+
+    for (const entt::entity entity : m_syncScratch) {
+        const bool show = shown(entity);
+        const entt::entity parent = show ? parentOf(entity) : entt::null;
+        const auto it = m_nodes.find(entity);
+        if (it != m_nodes.end() && show && it->second.parent == parent) {
+            const QModelIndex at = createIndex(it->second.row, 0, quintptr(entt::to_integral(entity)));
+            emit dataChanged(at, at, { Qt::DisplayRole });
+            continue;
+        }
+        // Unloaded ones may still sit in an old parent's unfetched list;
+        // fetchMore() skips those that no longer belong there.
+        if (it != m_nodes.end()) detach(entity);
+        if (show) attach(entity, parent);
+    }
+}
+
+void SceneOutlinerModel::reset()
+{
+    beginResetModel();
+    m_root = Node{};
+    m_nodes.clear();
+    m_parentsStale = true;
+    endResetModel();
+}
+
+void SceneOutlinerModel::detach(entt::entity entity)
+{
+    const Node& node = m_nodes.at(entity);
+    const entt::entity parent = node.parent;
+    const int row = node.row;
+    Node& owner = parent == entt::null ? m_root : m_nodes.at(parent);
+    const QModelIndex parentIndex = parent == entt::null
+        ? QModelIndex() : createIndex(owner.row, 0, quintptr(entt::to_integral(parent)));
+
+    beginRemoveRows(parentIndex, row, row);
+    owner.children.erase(owner.children.begin() + row);
+    for (int i = row; i < int(owner.children.size()); ++i) m_nodes.at(owner.children[std::size_t(i)]).row = i;
+    forget(entity);
+    endRemoveRows();
+}
+
+void SceneOutlinerModel::attach(entt::entity entity, entt::entity parent)
+{
+    Node* owner = &m_root;
+    if (parent != entt::null) {
+        const auto it = m_nodes.find(parent);
+        if (it == m_nodes.end()) return;   // its parent is not loaded: gathered with it later
+        owner = &it->second;
+    }
+    // Not gathered yet: the gather will find it. Gathered but with rows still
+    // to hand out: queue it behind them (fetchMore() drops a repeat).
+    if (!owner->gathered) return;
+    if (!owner->unfetched.empty()) {
+        owner->unfetched.push_back(entity);
+        return;
+    }
+    const QModelIndex parentIndex = parent == entt::null
+        ? QModelIndex() : createIndex(owner->row, 0, quintptr(entt::to_integral(parent)));
+    const int row = int(owner->children.size());
+    beginInsertRows(parentIndex, row, row);
+    owner->children.push_back(entity);
+    Node& node = m_nodes[entity];
+    node.parent = parent;
+    node.row = row;
+    endInsertRows();
+}
+
+void SceneOutlinerModel::forget(entt::entity entity)
+{
+    const auto it = m_nodes.find(entity);
+    if (it == m_nodes.end()) return;
+    std::vector<entt::entity> children = std::move(it->second.children);
+    m_nodes.erase(it);
+    for (const entt::entity child : children) forget(child);
+}
+
+void SceneOutlinerModel::gather(entt::entity parent, Node& node)
+{
+    node.gathered = true;
+    node.unfetched.clear();
+    if (parent == entt::null) {
+        for (const entt::entity entity : m_registry.view<TransformComponent>())
+            if (parentOf(entity) == entt::null) node.unfetched.push_back(entity);
+    }
+    else {
+        for (auto [entity, link] : m_registry.view<ParentComponent>().each())
+            if (link.parent == parent && m_registry.all_of<TransformComponent>(entity)) node.unfetched.push_back(entity);
+    }
+    // Storage order is newest first; show the scene in creation order.
+    std::reverse(node.unfetched.begin(), node.unfetched.end());
+}
+
+SceneOutlinerModel::Node& SceneOutlinerModel::nodeOf(const QModelIndex& index)
+{
+    return index.isValid() ? m_nodes.at(entityAt(index)) : m_root;
+}
+
+const SceneOutlinerModel::Node* SceneOutlinerModel::nodeOf(const QModelIndex& index) const
+{
+    if (!index.isValid()) return &m_root;
+    const auto it = m_nodes.find(entityAt(index));
+    return it == m_nodes.end() ? nullptr : &it->second;
+}
+
+entt::entity SceneOutlinerModel::entityAt(const QModelIndex& index) const
+{
+    return index.isValid() ? entt::entity(entt::id_type(index.internalId())) : entt::null;
+}
+
+QModelIndex SceneOutlinerModel::indexOf(entt::entity entity) const
+{
+    const auto it = m_nodes.find(entity);
+    return it == m_nodes.end() ? QModelIndex() : createIndex(it->second.row, 0, quintptr(entt::to_integral(entity)));
+}
+
+QModelIndex SceneOutlinerModel::index(int row, int column, const QModelIndex& parent) const
+{
+    const Node* node = nodeOf(parent);
+    if (!node || column != 0 || row < 0 || row >= int(node->children.size())) return {};
+    return createIndex(row, column, quintptr(entt::to_integral(node->children[std::size_t(row)])));
+}
+
+QModelIndex SceneOutlinerModel::parent(const QModelIndex& child) const
+{
+    const Node* node = nodeOf(child);
+    if (!child.isValid() || !node || node->parent == entt::null) return {};
+    return indexOf(node->parent);
+}
+
+int SceneOutlinerModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.column() > 0) return 0;
+    const Node* node = nodeOf(parent);
+    return node ? int(node->children.size()) : 0;
+}
+
+int SceneOutlinerModel::columnCount(const QModelIndex&) const
+{
+    return 1;
+}
+
+bool SceneOutlinerModel::hasChildren(const QModelIndex& parent) const
+{
+    const Node* node = nodeOf(parent);
+    if (!node) return false;
+    if (node->gathered) return !node->children.empty() || !node->unfetched.empty();
+    if (!parent.isValid()) return true;
+    const_cast<SceneOutlinerModel*>(this)->refreshParents();
+    return m_parents.count(entityAt(parent)) != 0;
+}
+
+bool SceneOutlinerModel::canFetchMore(const QModelIndex& parent) const
+{
+    const Node* node = nodeOf(parent);
+    return node && (!node->gathered || !node->unfetched.empty());
+}
+
+void SceneOutlinerModel::fetchMore(const QModelIndex& parent)
+{
+    if (!canFetchMore(parent)) return;
+    Node& node = nodeOf(parent);
+    const entt::entity owner = entityAt(parent);
+    if (!node.gathered) gather(owner, node);
+    if (node.unfetched.empty()) return;
+
+    // Up to kFetchBatch entries that still belong here and are not rows yet.
+    std::vector<entt::entity> batch;
+    std::size_t taken = 0;
+    for (; taken < node.unfetched.size() && batch.size() < std::size_t(kFetchBatch); ++taken) {
+        const entt::entity entity = node.unfetched[taken];
+        if (shown(entity) && parentOf(entity) == owner && !m_nodes.count(entity)
+            && std::find(batch.begin(), batch.end(), entity) == batch.end())
+            batch.push_back(entity);
+    }
+    node.unfetched.erase(node.unfetched.begin(), node.unfetched.begin() + std::ptrdiff_t(taken));
+    if (batch.empty()) return;
+
+    const int first = int(node.children.size());
+    beginInsertRows(parent, first, first + int(batch.size()) - 1);
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        Node& child = m_nodes[batch[i]];   // references into m_nodes survive a rehash
+        child.parent = owner;
+        child.row = first + int(i);
+    }
+    node.children.insert(node.children.end(), batch.begin(), batch.end());
+    endInsertRows();
+}
+
+QVariant SceneOutlinerModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || role != Qt::DisplayRole) return {};
+    const entt::entity entity = entityAt(index);
+    if (!m_registry.valid(entity)) return {};
+    if (const auto* tag = m_registry.try_get<TagComponent>(entity); tag && !tag->tag.empty())
+        return QString::fromStdString(tag->tag);
+    return QString("Entity %1").arg(entt::to_integral(entity));
+}
+
+QVariant SceneOutlinerModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (section == 0 && orientation == Qt::Horizontal && role == Qt::DisplayRole) return QStringLiteral("Name");
+    return {};
+}
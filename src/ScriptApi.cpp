@@ -0,0 +1,113 @@
+#include "ScriptApi.hpp"
+#include "components.hpp"
+#include "FieldSolver.hpp"
+#include "JointStateBuffer.hpp"
+#include "KinematicModel.hpp"
+#include "ThreadPool.hpp"
+#include "TransformSystem.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <entt/entt.hpp>
+
+namespace
+{
+    // Field points per pool task.
+    constexpr std::size_t kFieldChunk = 4096;
+
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "xyz arrays are read as glm::vec3");
+}
+
+std::vector<entt::entity> ScriptApi::robots(const entt::registry& registry)
+{
+    const auto view = registry.view<JointStateComponent>();
+    return std::vector<entt::entity>(view.begin(), view.end());
+}
+
+double* ScriptApi::jointPositions(entt::registry& registry, entt::entity robot, std::size_t& count)
+{
+    count = 0;
+    if (!registry.valid(robot)) return nullptr;
+    const auto* state = registry.try_get<JointStateComponent>(robot);
+    if (!state || !state->buffer) return nullptr;
+    count = state->buffer->size();
+    return state->buffer->position();
+}
+
+std::size_t ScriptApi::setJointPositions(entt::registry& registry, const entt::entity* robots, std::size_t robotCount,
+    const double* q, std::size_t stride)
+{
+    std::size_t set = 0;
+    for (std::size_t r = 0; r < robotCount; ++r) {
+        std::size_t dofs = 0;
+        double* position = jointPositions(registry, robots[r], dofs);
+        if (!position || dofs != stride) continue;
+        std::memcpy(position, q + r * stride, stride * sizeof(double));
+        ++set;
+    }
+    return set;
+}
+
+std::vector<entt::entity> ScriptApi::spawn(entt::registry& registry, const std::shared_ptr<const MeshData>& mesh,
+    const float* positions, std::size_t count, const std::string& tag)
+{
+    std::vector<entt::entity> entities(count);
+    registry.create(entities.begin(), entities.end());
+
+    std::vector<TransformComponent> transforms(count);
+    for (std::size_t i = 0; i < count; ++i)
+        transforms[i].translation = glm::vec3(positions[3 * i], positions[3 * i + 1], positions[3 * i + 2]);
+    registry.insert<TransformComponent>(entities.begin(), entities.end(), transforms.begin());
+    registry.insert<TagComponent>(entities.begin(), entities.end(), TagComponent(tag));
+    if (mesh) {
+        registry.insert<RenderableMeshComponent>(entities.begin(), entities.end(), RenderableMeshComponent{ mesh });
+        registry.insert<MaterialComponent>(entities.begin(), entities.end(), MaterialComponent{});
+    }
+    return entities;
+}
+
+void ScriptApi::setPositions(entt::registry& registry, const entt::entity* entities, const float* positions, std::size_t count)
+{
+    auto& storage = registry.storage<TransformComponent>();
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!storage.contains(entities[i])) continue;
+        storage.get(entities[i]).translation = glm::vec3(positions[3 * i], positions[3 * i + 1], positions[3 * i + 2]);
+    }
+}
+
+void ScriptApi::sampleField(entt::registry& registry, const float* points, std::size_t count, float* out)
+{
+    const FieldSnapshot snapshot = FieldSolver::snapshot(registry);
+    const auto* in = reinterpret_cast<const glm::vec3*>(points);
+    auto* result = reinterpret_cast<glm::vec3*>(out);
+    const std::size_t chunks = (count + kFieldChunk - 1) / kFieldChunk;
+    ThreadPool::shared().parallelFor(chunks, [&](std::size_t chunk) {
+        const std::size_t first = chunk * kFieldChunk;
+        FieldSolver::evaluateBatch(snapshot, in + first, result + first, std::min(kFieldChunk, count - first));
+    });
+}
+
+const float* ScriptApi::worldMatrices(entt::registry& registry, const entt::entity*& entities, std::size_t& count)
+{
+    const auto& matrices = TransformSystem::worldMatrices(registry);
+    const auto& order = TransformSystem::hierarchyOrder(registry);
+    count = std::min(matrices.size(), order.size());
+    entities = order.data();
+    return count ? &matrices.front()[0][0] : nullptr;
+}
+
+entt::entity ScriptApi::showTrajectory(entt::registry& registry, entt::entity robot, const double* q, std::size_t count, int ghosts)
+{
+    if (!registry.valid(robot)) return entt::null;
+    const auto* kin = registry.try_get<KinematicModelComponent>(robot);
+    if (!kin || !kin->model || kin->model->dofCount() == 0 || count == 0
+        || count % std::size_t(kin->model->dofCount()) != 0) return entt::null;
+
+    const entt::entity entity = registry.create();
+    registry.emplace<TagComponent>(entity, "Trajectory");
+    auto& ghost = registry.emplace<TrajectoryGhostComponent>(entity);
+    ghost.robot = robot;
+    ghost.q.assign(q, q + count);
+    ghost.ghosts = ghosts;
+    return entity;
+}
@@ -0,0 +1,343 @@
+// Python.h must come before any standard or Qt header.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "ScriptHost.hpp"
+#include "ScriptApi.hpp"
+#include "AssetPaths.hpp"
+#include "MeshCache.hpp"
+#include "TraceZones.hpp"
+
+#include <QDebug>
+#include <QFile>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <vector>
+#include <entt/entt.hpp>
+
+namespace
+{
+    static_assert(sizeof(entt::entity) == sizeof(std::uint32_t), "kr hands entity ids out as uint32");
+
+    entt::registry* s_registry = nullptr;
+    std::vector<PyObject*> s_views;   ///< views into scene arrays handed out this run
+
+    // A C-contiguous buffer argument with 'itemSize'-byte elements of one
+    // of the struct format characters in 'formats'.
+    class BufferArg
+    {
+    public:
+        ~BufferArg() { if (m_held) PyBuffer_Release(&m_view); }
+
+        bool get(PyObject* object, const char* formats, Py_ssize_t itemSize, const char* name, bool writable = false)
+        {
+            const int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0);
+            if (PyObject_GetBuffer(object, &m_view, flags) != 0) return false;
+            m_held = true;
+            const char* format = m_view.format ? m_view.format : "B";
+            if (*format == '@' || *format == '=') ++format;
+            if (m_view.itemsize != itemSize || format[0] == '\0' || format[1] != '\0' || !std::strchr(formats, format[0])) {
+                PyErr_Format(PyExc_TypeError, "%s: expected a contiguous array of %s", name,
+                    itemSize == 8 ? "float64" : formats[0] == 'f' ? "float32" : "uint32");
+                return false;
+            }
+            return true;
+        }
+
+        template <class T> T* data() const { return static_cast<T*>(m_view.buf); }
+        std::size_t count() const { return std::size_t(m_view.len / m_view.itemsize); }
+
+    private:
+        Py_buffer m_view{};
+        bool m_held = false;
+    };
+
+    entt::entity toEntity(unsigned long id) { return static_cast<entt::entity>(std::uint32_t(id)); }
+
+    // A typed memoryview straight over scene memory, released after the run.
+    PyObject* sceneView(void* data, std::size_t bytes, bool writable, const char* format, PyObject* shape = nullptr)
+    {
+        static char empty = 0;
+        PyObject* raw = PyMemoryView_FromMemory(data ? static_cast<char*>(data) : &empty, Py_ssize_t(bytes),
+            writable ? PyBUF_WRITE : PyBUF_READ);
+        PyObject* typed = raw ? (shape ? PyObject_CallMethod(raw, "cast", "sO", format, shape)
+                                       : PyObject_CallMethod(raw, "cast", "s", format))
+                              : nullptr;
+        Py_XDECREF(raw);
+        Py_XDECREF(shape);
+        if (typed) {
+            Py_INCREF(typed);
+            s_views.push_back(typed);
+        }
+        return typed;
+    }
+
+    // A uint32 memoryview over a copy of 'entities'.
+    PyObject* entityArray(const std::vector<entt::entity>& entities)
+    {
+        PyObject* bytes = PyBytes_FromStringAndSize(reinterpret_cast<const char*>(entities.data()),
+            Py_ssize_t(entities.size() * sizeof(entt::entity)));
+        PyObject* raw = bytes ? PyMemoryView_FromObject(bytes) : nullptr;
+        Py_XDECREF(bytes);
+        PyObject* typed = raw ? PyObject_CallMethod(raw, "cast", "s", "I") : nullptr;
+        Py_XDECREF(raw);
+        return typed;
+    }
+
+    std::string fetchTraceback()
+    {
+        PyObject *type = nullptr, *value = nullptr, *traceback = nullptr;
+        PyErr_Fetch(&type, &value, &traceback);
+        PyErr_NormalizeException(&type, &value, &traceback);
+        std::string text = "Python error";
+        if (PyObject* module = PyImport_ImportModule("traceback")) {
+            if (PyObject* lines = PyObject_CallMethod(module, "format_exception", "OOO", type ? type : Py_None,
+                    value ? value : Py_None, traceback ? traceback : Py_None)) {
+                PyObject* separator = PyUnicode_FromString("");
+                if (PyObject* joined = separator ? PyUnicode_Join(separator, lines) : nullptr) {
+                    if (const char* utf8 = PyUnicode_AsUTF8(joined)) text = utf8;
+                    Py_DECREF(joined);
+                }
+                Py_XDECREF(separator);
+                Py_DECREF(lines);
+            }
+            Py_DECREF(module);
+        }
+        PyErr_Clear();
+        Py_XDECREF(type);
+        Py_XDECREF(value);
+        Py_XDECREF(traceback);
+        return text;
+    }
+
+    void releaseViews()
+    {
+        for (PyObject* view : s_views) {
+            PyObject* result = PyObject_CallMethod(view, "release", nullptr);
+            if (!result) {
+                PyErr_Clear();
+                qWarning() << "[ScriptHost] A scene array view is still in use after the script returned";
+            }
+            Py_XDECREF(result);
+            Py_DECREF(view);
+        }
+        s_views.clear();
+    }
+
+    // --- kr module ---
+
+    PyObject* robots(PyObject*, PyObject*)
+    {
+        return entityArray(ScriptApi::robots(*s_registry));
+    }
+
+    PyObject* jointPositions(PyObject*, PyObject* args)
+    {
+        unsigned long id = 0;
+        if (!PyArg_ParseTuple(args, "k", &id)) return nullptr;
+        std::size_t count = 0;
+        double* q = ScriptApi::jointPositions(*s_registry, toEntity(id), count);
+        if (!q) {
+            PyErr_SetString(PyExc_ValueError, "joint_positions: not a robot");
+            return nullptr;
+        }
+        return sceneView(q, count * sizeof(double), true, "d");
+    }
+
+    PyObject* setJointPositions(PyObject*, PyObject* args)
+    {
+        PyObject *robotsArg = nullptr, *qArg = nullptr;
+        if (!PyArg_ParseTuple(args, "OO", &robotsArg, &qArg)) return nullptr;
+        BufferArg robots, q;
+        if (!robots.get(robotsArg, "IL", 4, "robots") || !q.get(qArg, "d", 8, "q")) return nullptr;
+        if (robots.count() == 0) return PyLong_FromSize_t(0);
+        if (q.count() % robots.count() != 0) {
+            PyErr_SetString(PyExc_ValueError, "set_joint_positions: q must hold one row per robot");
+            return nullptr;
+        }
+        return PyLong_FromSize_t(ScriptApi::setJointPositions(*s_registry, robots.data<entt::entity>(), robots.count(),
+            q.data<double>(), q.count() / robots.count()));
+    }
+
+    PyObject* spawn(PyObject*, PyObject* args, PyObject* kwargs)
+    {
+        static const char* keywords[] = { "uri", "positions", "tag", nullptr };
+        const char* uri = "";
+        const char* tag = "";
+        PyObject* positionsArg = nullptr;
+        if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|s", const_cast<char**>(keywords), &uri, &positionsArg, &tag))
+            return nullptr;
+        BufferArg positions;
+        if (!positions.get(positionsArg, "f", 4, "positions")) return nullptr;
+        if (positions.count() % 3 != 0) {
+            PyErr_SetString(PyExc_ValueError, "spawn: positions must be (n, 3)");
+            return nullptr;
+        }
+        std::shared_ptr<const MeshData> mesh;
+        if (*uri) {
+            try {
+                mesh = MeshCache::shared().load(AssetPaths::resolve(uri));
+            }
+            catch (const std::exception& e) {
+                PyErr_SetString(PyExc_RuntimeError, e.what());
+                return nullptr;
+            }
+        }
+        return entityArray(ScriptApi::spawn(*s_registry, mesh, positions.data<float>(), positions.count() / 3, tag));
+    }
+
+    PyObject* setPositions(PyObject*, PyObject* args)
+    {
+        PyObject *entitiesArg = nullptr, *positionsArg = nullptr;
+        if (!PyArg_ParseTuple(args, "OO", &entitiesArg, &positionsArg)) return nullptr;
+        BufferArg entities, positions;
+        if (!entities.get(entitiesArg, "IL", 4, "entities") || !positions.get(positionsArg, "f", 4, "positions"))
+            return nullptr;
+        if (positions.count() != 3 * entities.count()) {
+            PyErr_SetString(PyExc_ValueError, "set_positions: positions must be (len(entities), 3)");
+            return nullptr;
+        }
+        ScriptApi::setPositions(*s_registry, entities.data<entt::entity>(), positions.data<float>(), entities.count());
+        Py_RETURN_NONE;
+    }
+
+    PyObject* showTrajectory(PyObject*, PyObject* args, PyObject* kwargs)
+    {
+        static const char* keywords[] = { "robot", "q", "ghosts", nullptr };
+        unsigned long id = 0;
+        PyObject* qArg = nullptr;
+        int ghosts = 32;
+        if (!PyArg_ParseTupleAndKeywords(args, kwargs, "kO|i", const_cast<char**>(keywords), &id, &qArg, &ghosts))
+            return nullptr;
+        BufferArg q;
+        if (!q.get(qArg, "d", 8, "q")) return nullptr;
+        const entt::entity entity = ScriptApi::showTrajectory(*s_registry, toEntity(id), q.data<double>(), q.count(), ghosts);
+        if (entity == entt::null) {
+            PyErr_SetString(PyExc_ValueError, "show_trajectory: not a robot, or q is not whole waypoints of its joints");
+            return nullptr;
+        }
+        return PyLong_FromUnsignedLong(static_cast<unsigned long>(entt::to_integral(entity)));
+    }
+
+    PyObject* sampleField(PyObject*, PyObject* args, PyObject* kwargs)
+    {
+        static const char* keywords[] = { "points", "out", nullptr };
+        PyObject *pointsArg = nullptr, *outArg = Py_None;
+        if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", const_cast<char**>(keywords), &pointsArg, &outArg))
+            return nullptr;
+        BufferArg points;
+        if (!points.get(pointsArg, "f", 4, "points")) return nullptr;
+        if (points.count() % 3 != 0) {
+            PyErr_SetString(PyExc_ValueError, "sample_field: points must be (n, 3)");
+            return nullptr;
+        }
+        const std::size_t n = points.count() / 3;
+
+        // Into the caller's array, or a new one owned by Python.
+        if (outArg != Py_None) {
+            BufferArg out;
+            if (!out.get(outArg, "f", 4, "out", true)) return nullptr;
+            if (out.count() != points.count()) {
+                PyErr_SetString(PyExc_ValueError, "sample_field: out must have the shape of points");
+                return nullptr;
+            }
+            ScriptApi::sampleField(*s_registry, points.data<float>(), n, out.data<float>());
+            Py_INCREF(outArg);
+            return outArg;
+        }
+        PyObject* storage = PyByteArray_FromStringAndSize(nullptr, Py_ssize_t(points.count() * sizeof(float)));
+        if (!storage) return nullptr;
+        ScriptApi::sampleField(*s_registry, points.data<float>(), n, reinterpret_cast<float*>(PyByteArray_AsString(storage)));
+        PyObject* raw = PyMemoryView_FromObject(storage);
+        Py_DECREF(storage);
+        PyObject* typed = raw ? PyObject_CallMethod(raw, "cast", "s(nn)", "f", Py_ssize_t(n), Py_ssize_t(3)) : nullptr;
+        Py_XDECREF(raw);
+        return typed;
+    }
+
+    PyObject* worldMatrices(PyObject*, PyObject*)
+    {
+        const entt::entity* entities = nullptr;
+        std::size_t count = 0;
+        const float* matrices = ScriptApi::worldMatrices(*s_registry, entities, count);
+        PyObject* ids = sceneView(const_cast<entt::entity*>(entities), count * sizeof(entt::entity), false, "I");
+        PyObject* shape = Py_BuildValue("(nnn)", Py_ssize_t(count), Py_ssize_t(4), Py_ssize_t(4));
+        PyObject* values = ids && shape ? sceneView(const_cast<float*>(matrices), count * 16 * sizeof(float), false, "f", shape)
+                                        : (Py_XDECREF(shape), nullptr);
+        if (!values) {
+            Py_XDECREF(ids);
+            return nullptr;
+        }
+        return Py_BuildValue("(NN)", ids, values);
+    }
+
+    PyMethodDef kMethods[] = {
+        { "robots", robots, METH_NOARGS, "Robot root entity ids, uint32." },
+        { "joint_positions", jointPositions, METH_VARARGS, "A robot's joint positions: writable float64 view." },
+        { "set_joint_positions", setJointPositions, METH_VARARGS, "Joint positions of many robots, one row each." },
+        { "spawn", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(spawn)), METH_VARARGS | METH_KEYWORDS,
+          "Spawns one entity per row of positions (n, 3), showing the mesh at uri." },
+        { "set_positions", setPositions, METH_VARARGS, "Moves entities to positions (n, 3)." },
+        { "sample_field", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(sampleField)),
+          METH_VARARGS | METH_KEYWORDS, "Field vectors at points (n, 3)." },
+        { "world_matrices", worldMatrices, METH_NOARGS, "(entity ids, float32 (n, 4, 4) world matrices), read-only." },
+        { "show_trajectory", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(showTrajectory)),
+          METH_VARARGS | METH_KEYWORDS, "Ghosts of a robot along waypoints q (n, dofs); the ghost entity id." },
+        { nullptr, nullptr, 0, nullptr }
+    };
+
+    PyModuleDef kModule = { PyModuleDef_HEAD_INIT, "kr", "Batch scene operations (see ScriptHost.hpp).", -1, kMethods };
+
+    PyObject* initModule() { return PyModule_Create(&kModule); }
+}
+
+ScriptHost::ScriptHost(entt::registry& registry)
+{
+    s_registry = &registry;
+    if (!Py_IsInitialized()) {
+        PyImport_AppendInittab("kr", &initModule);
+        Py_InitializeEx(0);   // no signal handlers: Qt owns them
+    }
+}
+
+ScriptHost::~ScriptHost()
+{
+    releaseViews();
+    s_registry = nullptr;
+    Py_FinalizeEx();
+}
+
+bool ScriptHost::runFile(const std::string& path, std::string* error)
+{
+    KR_ZONE("run script");
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = "Could not open " + path;
+        return false;
+    }
+    const QByteArray source = file.readAll();
+
+    // A fresh __main__ namespace per run.
+    PyObject* globals = PyDict_New();
+    PyDict_SetItemString(globals, "__builtins__", PyEval_GetBuiltins());
+    PyObject* name = PyUnicode_FromString("__main__");
+    PyObject* filename = PyUnicode_FromString(path.c_str());
+    PyDict_SetItemString(globals, "__name__", name);
+    PyDict_SetItemString(globals, "__file__", filename);
+    Py_XDECREF(name);
+    Py_XDECREF(filename);
+
+    PyObject* code = Py_CompileString(source.constData(), path.c_str(), Py_file_input);
+    PyObject* result = code ? PyEval_EvalCode(code, globals, globals) : nullptr;
+    const bool ok = result != nullptr;
+    if (!ok) {
+        const std::string traceback = fetchTraceback();
+        if (error) *error = traceback;
+    }
+    Py_XDECREF(result);
+    Py_XDECREF(code);
+    Py_DECREF(globals);
+    releaseViews();
+    return ok;
+}
@@ -0,0 +1,210 @@
+#include "SensorBuffers.hpp"
+#include "GpuMemory.hpp"
+#include "components.hpp"
+#include "RenderStats.hpp"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_3_Core>
+#include <QSurfaceFormat>
+#include <QDebug>
+#include <entt/entt.hpp>
+#include <algorithm>
+
+#ifndef GL_MAP_PERSISTENT_BIT        // GL 4.4 / ARB_buffer_storage
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT   0x0080
+#endif
+
+void SensorBuffers::resolveBufferStorage()
+{
+    // Not part of the 4.3 core function table; resolve it from the context.
+    m_resolved = true;
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!ctx) return;
+    const QSurfaceFormat fmt = ctx->format();
+    const bool core44 = fmt.majorVersion() > 4 || (fmt.majorVersion() == 4 && fmt.minorVersion() >= 4);
+    if (core44 || ctx->hasExtension("GL_ARB_buffer_storage"))
+        m_bufferStorage = reinterpret_cast<BufferStorageFn>(ctx->getProcAddress("glBufferStorage"));
+    if (!m_bufferStorage)
+        qWarning() << "[SensorBuffers] glBufferStorage unavailable; sensor points are copied each tick";
+}
+
+void SensorBuffers::update(entt::registry& registry, std::uint64_t tick)
+{
+    if (!m_gl) return;
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+
+    // Once per tick, in whichever viewport gets here first.
+    if (m_tick == tick) {
+        if (m_uploadFence && m_uploadContext != ctx)
+            m_gl->glWaitSync(m_uploadFence, 0, GL_TIMEOUT_IGNORED);
+        return;
+    }
+    m_tick = tick;
+    if (!m_resolved) resolveBufferStorage();
+
+    // A ring outlives its stream: the stream's destructor joined the reader.
+    for (auto it = m_rings.begin(); it != m_rings.end();) {
+        if (it->second.stream.expired()) {
+            releaseRing(it->second);
+            it = m_rings.erase(it);
+        }
+        else ++it;
+    }
+
+    bool uploaded = false;
+    for (auto [entity, sensor] : registry.view<SensorStreamComponent>().each()) {
+        if (!sensor.stream) continue;
+        Ring& ring = m_rings[sensor.stream.get()];
+        if (ring.stream.lock() != sensor.stream) {
+            releaseRing(ring);   // an address reused by a new stream
+            ring = Ring{};
+            ring.stream = sensor.stream;   // kept on failure too: no retry every tick
+            if (!createRing(ring, *sensor.stream)) continue;
+        }
+        ring.head = sensor.stream->head();
+        if (!ring.mapped && !sensor.stream->gpuFed() && ring.head != ring.uploaded) {
+            upload(ring, sensor.stream->capacity());
+            uploaded = true;
+        }
+    }
+
+    if (uploaded) written();
+}
+
+void SensorBuffers::written()
+{
+    if (!m_gl) return;
+    if (m_uploadFence) m_gl->glDeleteSync(m_uploadFence);
+    m_uploadFence = m_gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_uploadContext = QOpenGLContext::currentContext();
+}
+
+bool SensorBuffers::createRing(Ring& ring, SensorStream& stream)
+{
+    const GLsizeiptr bytes = GLsizeiptr(stream.capacity() * sizeof(SensorPoint));
+    m_gl->glGenBuffers(1, &ring.buffer);
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, ring.buffer);
+    if (stream.gpuFed()) {
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, ring.buffer, bytes, nullptr, GL_DYNAMIC_COPY, GpuMemory::Category::Sensors);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        stream.start(nullptr);
+        return true;
+    }
+    if (m_bufferStorage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        m_bufferStorage(GL_SHADER_STORAGE_BUFFER, bytes, nullptr, flags);
+        GpuMemory::trackBuffer(ring.buffer, std::size_t(bytes), GpuMemory::Category::Sensors);
+        ring.mapped = static_cast<SensorPoint*>(m_gl->glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, bytes, flags));
+    }
+    if (!ring.mapped) {
+        if (m_bufferStorage) {   // immutable storage can't be respecified
+            GpuMemory::deleteBuffers(m_gl, 1, &ring.buffer);
+            m_gl->glGenBuffers(1, &ring.buffer);
+            m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, ring.buffer);
+        }
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, ring.buffer, bytes, nullptr, GL_STREAM_DRAW, GpuMemory::Category::Sensors);
+        ring.host.assign(stream.capacity(), SensorPoint{ 0.0f, 0.0f, 0.0f, -1e30f, 0u });
+    }
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    if (!stream.start(ring.mapped ? ring.mapped : ring.host.data())) {
+        releaseRing(ring);
+        return false;
+    }
+    return true;
+}
+
+void SensorBuffers::upload(Ring& ring, std::size_t capacity)
+{
+    // Copy what arrived since the last tick, never more than the drawable window.
+    const std::uint64_t window = capacity - capacity / 8;
+    const std::uint64_t from = std::max(ring.uploaded, ring.head > window ? ring.head - window : 0);
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, ring.buffer);
+    for (std::uint64_t at = from; at < ring.head;) {
+        const std::size_t index = std::size_t(at) & (capacity - 1);
+        const std::size_t run = std::min<std::size_t>(capacity - index, std::size_t(ring.head - at));
+        m_gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, GLintptr(index * sizeof(SensorPoint)),
+            GLsizeiptr(run * sizeof(SensorPoint)), ring.host.data() + index);
+        RenderStats::upload(run * sizeof(SensorPoint));
+        at += run;
+    }
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    ring.uploaded = ring.head;
+}
+
+GLuint SensorBuffers::buffer(const SensorStream& stream) const
+{
+    auto it = m_rings.find(&stream);
+    return it == m_rings.end() ? 0 : it->second.buffer;
+}
+
+bool SensorBuffers::ranges(const SensorStream& stream, Ranges& out)
+{
+    auto it = m_rings.find(&stream);
+    if (it == m_rings.end() || !it->second.buffer) return false;
+    const Ring& ring = it->second;
+
+    // Everything but the guard the reader may be writing into next.
+    const std::size_t capacity = stream.capacity();
+    const std::uint64_t count = std::min<std::uint64_t>(ring.head, capacity - stream.guard());
+    const std::size_t first = std::size_t(ring.head - count) & (capacity - 1);
+    const std::size_t tail = std::min<std::size_t>(capacity - first, std::size_t(count));
+    out.buffer = ring.buffer;
+    out.first[0] = GLint(first);
+    out.count[0] = GLsizei(tail);
+    out.first[1] = 0;
+    out.count[1] = GLsizei(count - tail);
+    return count > 0;
+}
+
+bool SensorBuffers::fresh(const SensorStream& stream, std::uint64_t& since, Ranges& out)
+{
+    auto it = m_rings.find(&stream);
+    if (it == m_rings.end() || !it->second.buffer) return false;
+    const Ring& ring = it->second;
+
+    const std::size_t capacity = stream.capacity();
+    const std::uint64_t window = capacity - stream.guard();
+    const std::uint64_t from = std::max(since, ring.head > window ? ring.head - window : 0);
+    since = ring.head;
+    if (from >= ring.head) return false;
+
+    const std::size_t first = std::size_t(from) & (capacity - 1);
+    const std::size_t tail = std::min<std::size_t>(capacity - first, std::size_t(ring.head - from));
+    out.buffer = ring.buffer;
+    out.first[0] = GLint(first);
+    out.count[0] = GLsizei(tail);
+    out.first[1] = 0;
+    out.count[1] = GLsizei(ring.head - from - tail);
+    return true;
+}
+
+void SensorBuffers::releaseRing(Ring& ring)
+{
+    if (!ring.buffer || !m_gl) return;
+    if (ring.mapped) {
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, ring.buffer);
+        m_gl->glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        ring.mapped = nullptr;
+    }
+    GpuMemory::deleteBuffers(m_gl, 1, &ring.buffer);
+    ring.buffer = 0;
+    ring.host.clear();
+    ring.host.shrink_to_fit();
+}
+
+void SensorBuffers::destroy()
+{
+    // Readers write into the rings: stop them before the memory goes away.
+    for (auto& [key, ring] : m_rings) {
+        if (auto stream = ring.stream.lock()) stream->stop();
+        releaseRing(ring);
+    }
+    m_rings.clear();
+    if (m_uploadFence && m_gl) m_gl->glDeleteSync(m_uploadFence);
+    m_uploadFence = nullptr;
+    m_uploadContext = nullptr;
+    m_tick = ~0ull;
+}
@@ -0,0 +1,150 @@
+#include "SensorStream.hpp"
+
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr std::chrono::milliseconds kReadTimeout{ 20 };
+constexpr std::size_t kReadBatch = 4096;
+static_assert(SensorReader::kMinRead <= kReadBatch, "a read must fit one batch");
+
+std::size_t roundUpPow2(std::size_t v)
+{
+    std::size_t p = 2;
+    while (p < v) p <<= 1;
+    return p;
+}
+
+std::uint32_t packColour(float r, float g, float b)
+{
+    auto byte = [](float v) { return std::uint32_t(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); };
+    return byte(r) | (byte(g) << 8) | (byte(b) << 16) | (255u << 24);
+}
+}
+
+SensorStream::SensorStream(std::string name, std::unique_ptr<SensorReader> reader, std::size_t capacity)
+    : m_name(std::move(name)), m_reader(std::move(reader)), m_capacity(roundUpPow2(std::max(capacity, 8 * SensorReader::kMinRead)))
+{
+}
+
+SensorStream::SensorStream(std::string name, std::size_t capacity)
+    : m_name(std::move(name)), m_capacity(roundUpPow2(std::max(capacity, 8 * SensorReader::kMinRead)))
+{
+}
+
+float SensorStream::clockSeconds()
+{
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration<float>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+bool SensorStream::start(SensorPoint* storage)
+{
+    if (running()) return false;
+    if (!m_reader) {
+        m_running.store(true, std::memory_order_relaxed);
+        return true;
+    }
+    if (!storage) return false;
+    if (!m_reader->open()) {
+        qWarning() << "[SensorStream]" << m_name.c_str() << "could not open its reader";
+        return false;
+    }
+    m_storage = storage;
+    m_running.store(true, std::memory_order_relaxed);
+    m_thread = std::thread(&SensorStream::run, this);
+    return true;
+}
+
+void SensorStream::stop()
+{
+    if (!m_reader) m_running.store(false, std::memory_order_relaxed);
+    if (!m_thread.joinable()) return;
+    m_running.store(false, std::memory_order_relaxed);
+    m_thread.join();
+    m_reader->close();
+}
+
+std::uint64_t SensorStream::publish(std::size_t count)
+{
+    const std::uint64_t first = m_head.load(std::memory_order_relaxed);
+    m_head.store(first + count, std::memory_order_release);
+    return first;
+}
+
+void SensorStream::run()
+{
+    const std::size_t mask = m_capacity - 1;
+    while (m_running.load(std::memory_order_relaxed)) {
+        // Decode straight into the ring, one contiguous run at a time.
+        std::uint64_t head = m_head.load(std::memory_order_relaxed);
+        std::size_t at = std::size_t(head) & mask;
+        if (m_capacity - at < SensorReader::kMinRead) {
+            // Too little room before the wrap for a packet: pad it with
+            // points that are already too old to draw.
+            for (; at < m_capacity; ++at, ++head) m_storage[at] = SensorPoint{ 0.0f, 0.0f, 0.0f, -1e30f, 0u };
+            m_head.store(head, std::memory_order_release);
+            at = 0;
+        }
+        SensorPoint* out = m_storage + at;
+        const std::size_t n = m_reader->read(out, std::min(kReadBatch, m_capacity - at), kReadTimeout);
+        if (n == 0) continue;
+
+        const float now = clockSeconds();
+        for (std::size_t i = 0; i < n; ++i) out[i].time = now;
+        m_head.store(head + n, std::memory_order_release);
+    }
+}
+
+// --- SimulatedLidarReader ---
+
+bool SimulatedLidarReader::open()
+{
+    m_step = 0;
+    m_start = std::chrono::steady_clock::now();
+    return m_settings.beams > 0 && m_settings.stepsPerTurn > 0 && m_settings.turnsPerSecond > 0.0f;
+}
+
+std::size_t SimulatedLidarReader::read(SensorPoint* out, std::size_t max, std::chrono::milliseconds timeout)
+{
+    const Settings& s = m_settings;
+    const double columnsPerSecond = double(s.turnsPerSecond) * s.stepsPerTurn;
+    const auto due = [&] {
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+        return std::uint64_t(elapsed * columnsPerSecond);
+    };
+
+    // Pace to the real rate: wait for the next column, at most 'timeout'.
+    if (m_step >= due()) {
+        const auto wait = std::chrono::duration<double>(double(m_step + 1 - due()) / columnsPerSecond);
+        std::this_thread::sleep_for(std::min<std::chrono::duration<double>>(wait, timeout));
+        if (m_step >= due()) return 0;
+    }
+
+    const float kPi = 3.14159265f;
+    const float fov = s.verticalFovDegrees * kPi / 180.0f;
+    const float wallHeight = 3.0f;
+    std::size_t written = 0;
+    for (const std::uint64_t end = due(); m_step < end && written + std::size_t(s.beams) <= max; ++m_step) {
+        const float azimuth = 2.0f * kPi * float(m_step % std::uint64_t(s.stepsPerTurn)) / float(s.stepsPerTurn);
+        const float sinA = std::sin(azimuth), cosA = std::cos(azimuth);
+        for (int beam = 0; beam < s.beams; ++beam) {
+            const float elevation = s.beams > 1 ? -0.5f * fov + fov * float(beam) / float(s.beams - 1) : 0.0f;
+            const float horizontal = std::cos(elevation), vertical = std::sin(elevation);
+
+            // Nearest of the floor and the wall ring; rays over the wall return nothing.
+            float range = s.wallRadius / horizontal;
+            if (vertical < 0.0f) range = std::min(range, s.mountHeight / -vertical);
+            if (s.mountHeight + vertical * range > wallHeight) continue;
+
+            SensorPoint& p = out[written++];
+            p.x = horizontal * sinA * range;
+            p.y = vertical * range;
+            p.z = horizontal * cosA * range;
+            const float t = std::clamp(range / s.wallRadius, 0.0f, 1.0f);
+            p.rgba = packColour(1.0f - t, 0.35f + 0.5f * t, t);
+        }
+    }
+    return written;
+}
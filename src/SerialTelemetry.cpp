@@ -0,0 +1,353 @@
+#include "SerialTelemetry.hpp"
+#include "TelemetryHub.hpp"
+
+#include <QDebug>
+#include <QString>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/serial.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#if !defined(__SSE4_2__) && !defined(__ARM_FEATURE_CRC32)
+constexpr std::array<std::uint32_t, 256> makeCrcTable()
+{
+    std::array<std::uint32_t, 256> table{};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+        table[i] = c;
+    }
+    return table;
+}
+constexpr std::array<std::uint32_t, 256> kCrcTable = makeCrcTable();
+#endif
+
+std::uint32_t readLe32(const std::uint8_t* p)
+{
+    return std::uint32_t(p[0]) | std::uint32_t(p[1]) << 8 | std::uint32_t(p[2]) << 16 | std::uint32_t(p[3]) << 24;
+}
+
+void writeLe32(std::uint8_t* p, std::uint32_t v)
+{
+    p[0] = std::uint8_t(v); p[1] = std::uint8_t(v >> 8); p[2] = std::uint8_t(v >> 16); p[3] = std::uint8_t(v >> 24);
+}
+
+int popcount4(std::uint8_t mask)
+{
+    return (mask & 1) + (mask >> 1 & 1) + (mask >> 2 & 1) + (mask >> 3 & 1);
+}
+}
+
+std::uint32_t SerialTelemetry::crc32c(const std::uint8_t* data, std::size_t size)
+{
+    std::uint32_t crc = 0xFFFFFFFFu;
+#if defined(__SSE4_2__)
+    for (; size >= 8; data += 8, size -= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data, 8);
+        crc = std::uint32_t(_mm_crc32_u64(crc, word));
+    }
+    for (; size; ++data, --size) crc = _mm_crc32_u8(crc, *data);
+#elif defined(__ARM_FEATURE_CRC32)
+    for (; size >= 8; data += 8, size -= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data, 8);
+        crc = __crc32cd(crc, word);
+    }
+    for (; size; ++data, --size) crc = __crc32cb(crc, *data);
+#else
+    for (; size; ++data, --size) crc = kCrcTable[(crc ^ *data) & 0xFF] ^ (crc >> 8);
+#endif
+    return ~crc;
+}
+
+std::size_t SerialTelemetry::encode(const std::uint8_t* data, std::size_t size, std::uint8_t* out)
+{
+    std::size_t code = 0, w = 1;   // 'code' is where the current block's length byte goes
+    std::uint8_t run = 1;
+    for (std::size_t i = 0; i < size; ++i) {
+        if (data[i] == 0) {
+            out[code] = run;
+            code = w++;
+            run = 1;
+            continue;
+        }
+        out[w++] = data[i];
+        if (++run == 0xFF) {
+            out[code] = run;
+            code = w++;
+            run = 1;
+        }
+    }
+    out[code] = run;
+    out[w++] = 0;
+    return w;
+}
+
+std::size_t SerialTelemetry::decodeInPlace(std::uint8_t* data, std::size_t size)
+{
+    // The output never overtakes the input: each block is one byte shorter
+    // decoded, which leaves room for the zero it stands for.
+    std::size_t r = 0, w = 0;
+    while (r < size) {
+        const std::uint8_t code = data[r++];
+        if (code == 0) return 0;
+        const std::size_t run = code - 1u;
+        if (run > size - r) return 0;
+        std::memmove(data + w, data + r, run);
+        w += run;
+        r += run;
+        if (code != 0xFF && r < size) data[w++] = 0;
+    }
+    return w;
+}
+
+std::size_t SerialTelemetry::encodeFrame(std::uint8_t controller, std::uint8_t mask, const float values[4], std::uint8_t* out)
+{
+    std::uint8_t payload[kMaxPayload];
+    std::size_t n = 0;
+    payload[n++] = controller;
+    payload[n++] = mask & 0x0F;
+    for (int q = 0; q < JointSample::kQuantityCount; ++q) {
+        if (!(mask & (1u << q))) continue;
+        std::uint32_t bits;
+        std::memcpy(&bits, &values[q], 4);
+        writeLe32(payload + n, bits);
+        n += 4;
+    }
+    writeLe32(payload + n, crc32c(payload, n));
+    return encode(payload, n + 4, out);
+}
+
+#ifdef __linux__
+namespace {
+constexpr std::size_t kPortBuffer = 16384;   ///< ~80 ms at 2 Mbaud
+
+speed_t speedOf(int baud)
+{
+    switch (baud) {
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+    case 460800:  return B460800;
+    case 500000:  return B500000;
+    case 921600:  return B921600;
+    case 1000000: return B1000000;
+    case 1500000: return B1500000;
+    case 2000000: return B2000000;
+    case 3000000: return B3000000;
+    case 4000000: return B4000000;
+    default:      return B0;
+    }
+}
+
+class Reader : public TelemetryReader
+{
+public:
+    explicit Reader(const SerialTelemetry::Settings& settings) : m_settings(settings) {}
+    ~Reader() override { close(); }
+
+    bool open(const std::vector<Endpoint>& endpoints) override
+    {
+        close();
+        for (std::size_t channel = 0; channel < endpoints.size(); ++channel) {
+            const Endpoint& ep = endpoints[channel];
+            if (ep.feedbackTopic.empty() || ep.controllerId > 0xFF) {
+                qWarning() << "[SerialTelemetry] joint" << QString::fromStdString(ep.jointName)
+                           << "needs a port in feedback_topic_name and a controller id of 0-255";
+                continue;
+            }
+            std::string path = ep.feedbackTopic;
+            int baud = m_settings.baud;
+            if (const std::size_t at = path.rfind('@'); at != std::string::npos) {
+                baud = std::atoi(path.c_str() + at + 1);
+                path.resize(at);
+            }
+            Port* port = portFor(path, baud);
+            if (!port) continue;
+            if (port->channelOf[ep.controllerId] >= 0)
+                qWarning() << "[SerialTelemetry] controller" << ep.controllerId << "on" << QString::fromStdString(path)
+                           << "is bound twice; keeping" << QString::fromStdString(ep.jointName);
+            port->channelOf[ep.controllerId] = std::int32_t(channel);
+        }
+        return !m_ports.empty();
+    }
+
+    std::size_t read(JointSample* out, std::size_t max, std::chrono::milliseconds timeout) override
+    {
+        const auto until = std::chrono::steady_clock::now() + timeout;
+        for (;;) {
+            // Whatever is buffered first: a full batch leaves frames behind.
+            std::size_t n = 0;
+            for (Port& port : m_ports) n += decode(port, out + n, max - n);
+            if (n) return n;
+
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(until - std::chrono::steady_clock::now());
+            if (left.count() <= 0) return 0;
+            const int ready = ::poll(m_pollFds.data(), nfds_t(m_pollFds.size()), int(left.count()));
+            if (ready < 0 && errno != EINTR) return 0;
+            for (std::size_t i = 0; ready > 0 && i < m_ports.size(); ++i)
+                if (m_pollFds[i].revents) fill(i);
+        }
+    }
+
+    void close() override
+    {
+        for (Port& port : m_ports)
+            if (port.fd >= 0) ::close(port.fd);
+        if (m_badFrames) qDebug() << "[SerialTelemetry] dropped" << qint64(m_badFrames) << "bad frames";
+        m_ports.clear();
+        m_pollFds.clear();
+        m_badFrames = 0;
+    }
+
+private:
+    struct Port {
+        std::string path;
+        int fd = -1;
+        std::vector<std::uint8_t> buffer = std::vector<std::uint8_t>(kPortBuffer);
+        std::size_t head = 0, tail = 0;        ///< undecoded bytes are [head, tail)
+        std::int64_t receivedNs = 0;           ///< when the newest bytes arrived
+        std::array<std::int32_t, 256> channelOf;
+    };
+
+    Port* portFor(const std::string& path, int baud)
+    {
+        for (Port& port : m_ports)
+            if (port.path == path) return &port;
+
+        const speed_t speed = speedOf(baud);
+        if (speed == B0) {
+            qWarning() << "[SerialTelemetry] unsupported baud rate" << baud << "for" << QString::fromStdString(path);
+            return nullptr;
+        }
+        const int fd = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            qWarning() << "[SerialTelemetry] cannot open" << QString::fromStdString(path) << ":" << std::strerror(errno);
+            return nullptr;
+        }
+        termios tio{};
+        ::tcgetattr(fd, &tio);
+        ::cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cflag &= ~CRTSCTS;
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        ::cfsetispeed(&tio, speed);
+        ::cfsetospeed(&tio, speed);
+        if (::tcsetattr(fd, TCSANOW, &tio) < 0) {
+            qWarning() << "[SerialTelemetry] cannot configure" << QString::fromStdString(path) << ":" << std::strerror(errno);
+            ::close(fd);
+            return nullptr;
+        }
+        // USB adapters otherwise hold bytes back for their latency timer
+        // (16 ms on FTDI); not every driver supports it.
+        serial_struct serial{};
+        if (::ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+            serial.flags |= ASYNC_LOW_LATENCY;
+            ::ioctl(fd, TIOCSSERIAL, &serial);
+        }
+        ::tcflush(fd, TCIFLUSH);
+
+        Port& port = m_ports.emplace_back();
+        port.path = path;
+        port.fd = fd;
+        port.channelOf.fill(-1);
+        m_pollFds.push_back({ fd, POLLIN, 0 });
+        return &port;
+    }
+
+    void fill(std::size_t index)
+    {
+        Port& port = m_ports[index];
+        if (m_pollFds[index].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            qWarning() << "[SerialTelemetry]" << QString::fromStdString(port.path) << "went away";
+            ::close(port.fd);
+            port.fd = -1;
+            m_pollFds[index].fd = -1;          // poll() skips it from now on
+            return;
+        }
+        if (port.tail == port.buffer.size()) {
+            if (port.head == 0) {              // no delimiter in a whole buffer: line noise
+                ++m_badFrames;
+                port.tail = 0;
+            }
+            else {
+                std::memmove(port.buffer.data(), port.buffer.data() + port.head, port.tail - port.head);
+                port.tail -= port.head;
+                port.head = 0;
+            }
+        }
+        const ssize_t got = ::read(port.fd, port.buffer.data() + port.tail, port.buffer.size() - port.tail);
+        if (got > 0) {
+            port.tail += std::size_t(got);
+            port.receivedNs = TelemetryHub::nowNs();
+        }
+    }
+
+    std::size_t decode(Port& port, JointSample* out, std::size_t room)
+    {
+        std::size_t n = 0;
+        while (room - n >= std::size_t(JointSample::kQuantityCount)) {
+            std::uint8_t* begin = port.buffer.data() + port.head;
+            auto* end = static_cast<std::uint8_t*>(std::memchr(begin, 0, port.tail - port.head));
+            if (!end) break;
+            port.head += std::size_t(end - begin) + 1;
+            if (end == begin) continue;        // back-to-back delimiters
+
+            const std::size_t size = SerialTelemetry::decodeInPlace(begin, std::size_t(end - begin));
+            const int values = size >= 2 ? popcount4(begin[1]) : 0;
+            if (size < 6 || (begin[1] & 0xF0) || size != std::size_t(2 + 4 * values + 4)
+                || readLe32(begin + size - 4) != SerialTelemetry::crc32c(begin, size - 4)) {
+                ++m_badFrames;
+                continue;
+            }
+            const std::int32_t channel = port.channelOf[begin[0]];
+            if (channel < 0) continue;         // a controller no joint is bound to
+
+            const std::uint8_t* p = begin + 2;
+            for (int q = 0; q < JointSample::kQuantityCount; ++q) {
+                if (!(begin[1] & (1u << q))) continue;
+                const std::uint32_t bits = readLe32(p);
+                float value;
+                std::memcpy(&value, &bits, 4);
+                p += 4;
+                out[n++] = { port.receivedNs, std::uint32_t(channel), JointSample::Quantity(q), double(value) };
+            }
+        }
+        if (port.head == port.tail) port.head = port.tail = 0;
+        return n;
+    }
+
+    SerialTelemetry::Settings m_settings;
+    std::vector<Port> m_ports;
+    std::vector<pollfd> m_pollFds;             ///< parallel to m_ports
+    std::uint64_t m_badFrames = 0;             ///< COBS, length or CRC failures
+};
+}
+
+void SerialTelemetry::install(TelemetryHub& hub, const Settings& settings)
+{
+    hub.registerReader(CommunicationProtocol::SERIAL_CUSTOM, [settings]() { return std::make_unique<Reader>(settings); });
+}
+#else
+void SerialTelemetry::install(TelemetryHub&, const Settings&) {}
+#endif
@@ -0,0 +1,252 @@
+#include "SessionLog.hpp"
+#include "TraceZones.hpp"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+using namespace SessionLogFormat;
+
+namespace {
+constexpr std::size_t padded(std::size_t bytes) { return (bytes + 7) & ~std::size_t(7); }
+
+std::int64_t steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+// --- SessionRecorder ---
+
+SessionRecorder::SessionRecorder() = default;
+SessionRecorder::~SessionRecorder() { close(); }
+
+bool SessionRecorder::isOpen() const { return m_file && m_file->isOpen(); }
+
+bool SessionRecorder::open(const std::string& path)
+{
+    close();
+    m_file = std::make_unique<QFile>(QString::fromStdString(path));
+    if (!m_file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "[SessionRecorder] cannot write" << path.c_str() << ":" << m_file->errorString();
+        m_file.reset();
+        return false;
+    }
+
+    FileHeader header;
+    header.wallClockStartMs = QDateTime::currentMSecsSinceEpoch();
+    header.steadyStartNs = steadyNowNs();
+    m_samples = 0;
+    if (!write(&header, sizeof(header))) return false;
+
+    // Channel ids outlive a file, so ids handed out earlier stay valid.
+    for (int i = 0; i < int(m_channels.size()); ++i) {
+        m_channels[i].t.clear();
+        m_channels[i].v.clear();
+        writeChannel(i);
+    }
+    return true;
+}
+
+void SessionRecorder::close()
+{
+    if (!isOpen()) return;
+    flush();
+    m_file->close();
+    m_file.reset();
+}
+
+int SessionRecorder::channel(const std::string& name)
+{
+    for (int i = 0; i < int(m_channels.size()); ++i)
+        if (m_channels[i].name == name) return i;
+
+    const int id = int(m_channels.size());
+    Buffer buffer;
+    buffer.name = name;
+    buffer.t.reserve(kChunkSamples);
+    buffer.v.reserve(kChunkSamples);
+    m_channels.push_back(std::move(buffer));
+    if (isOpen()) writeChannel(id);
+    return id;
+}
+
+void SessionRecorder::writeChannel(int channel)
+{
+    const std::string& name = m_channels[channel].name;
+    ChannelRecord record{ std::uint32_t(channel), std::uint32_t(name.size()) };
+    RecordHeader rh{ kChannelTag, std::uint32_t(sizeof(record) + padded(name.size())) };
+    std::string bytes = name;
+    bytes.resize(padded(name.size()), '\0');
+    write(&rh, sizeof(rh));
+    write(&record, sizeof(record));
+    write(bytes.data(), bytes.size());
+}
+
+void SessionRecorder::append(int channel, std::int64_t timestampNs, double value)
+{
+    if (!isOpen() || channel < 0 || channel >= int(m_channels.size())) return;
+    Buffer& b = m_channels[channel];
+    if (!b.t.empty() && timestampNs < b.t.back()) return;
+    b.t.push_back(timestampNs);
+    b.v.push_back(value);
+    ++m_samples;
+    if (b.t.size() == kChunkSamples) writeChunk(channel);
+}
+
+void SessionRecorder::flush()
+{
+    if (!isOpen()) return;
+    KR_ZONE("session flush");
+    for (int i = 0; i < int(m_channels.size()); ++i)
+        if (!m_channels[i].t.empty()) writeChunk(i);
+    m_file->flush();
+}
+
+void SessionRecorder::writeChunk(int channel)
+{
+    KR_ZONE("session write chunk");
+    Buffer& b = m_channels[channel];
+    const std::uint32_t count = std::uint32_t(b.t.size());
+    ChunkRecord record{ std::uint32_t(channel), count, b.t.front(), b.t.back() };
+    RecordHeader rh{ kChunkTag, std::uint32_t(sizeof(record) + count * (sizeof(std::int64_t) + sizeof(double))) };
+    write(&rh, sizeof(rh));
+    write(&record, sizeof(record));
+    write(b.t.data(), count * sizeof(std::int64_t));
+    write(b.v.data(), count * sizeof(double));
+    b.t.clear();
+    b.v.clear();
+}
+
+bool SessionRecorder::write(const void* data, std::size_t bytes)
+{
+    if (m_file->write(static_cast<const char*>(data), qint64(bytes)) == qint64(bytes)) return true;
+    qWarning() << "[SessionRecorder] write failed:" << m_file->errorString();
+    return false;
+}
+
+// --- SessionLog ---
+
+SessionLog::SessionLog() = default;
+SessionLog::~SessionLog() { close(); }
+
+void SessionLog::close()
+{
+    if (m_file && m_map) m_file->unmap(const_cast<unsigned char*>(m_map));
+    m_map = nullptr;
+    m_file.reset();
+    m_channels.clear();
+    m_beginNs = m_endNs = 0;
+}
+
+bool SessionLog::open(const std::string& path)
+{
+    close();
+    m_file = std::make_unique<QFile>(QString::fromStdString(path));
+    if (!m_file->open(QIODevice::ReadOnly) || m_file->size() < qint64(sizeof(FileHeader))) {
+        qWarning() << "[SessionLog] cannot read" << path.c_str();
+        m_file.reset();
+        return false;
+    }
+    const std::size_t size = std::size_t(m_file->size());
+    m_map = m_file->map(0, qint64(size));
+    if (!m_map) {
+        qWarning() << "[SessionLog] cannot map" << path.c_str() << ":" << m_file->errorString();
+        m_file.reset();
+        return false;
+    }
+
+    std::memcpy(&m_header, m_map, sizeof(m_header));
+    if (m_header.magic != kMagic || m_header.version != kVersion) {
+        qWarning() << "[SessionLog]" << path.c_str() << "is not a session log (or a newer version)";
+        close();
+        return false;
+    }
+
+    // Walk the record headers only; columns stay in the mapping. Ids are
+    // dense from 0 and each is declared by its own record, so no valid id
+    // reaches the number of records the file could hold.
+    const std::size_t maxChannels = size / (sizeof(RecordHeader) + sizeof(ChannelRecord));
+    m_beginNs = std::numeric_limits<std::int64_t>::max();
+    m_endNs = std::numeric_limits<std::int64_t>::min();
+    std::size_t offset = sizeof(FileHeader);
+    while (offset + sizeof(RecordHeader) <= size) {
+        RecordHeader rh;
+        std::memcpy(&rh, m_map + offset, sizeof(rh));
+        const std::size_t payload = offset + sizeof(rh);
+        if (payload + rh.payloadBytes > size) break;   // truncated tail
+        if (rh.payloadBytes % 8 != 0) break;            // corrupt: the columns after it would be misaligned
+
+        if (rh.tag == kChannelTag && rh.payloadBytes >= sizeof(ChannelRecord)) {
+            ChannelRecord record;
+            std::memcpy(&record, m_map + payload, sizeof(record));
+            if (record.channel < maxChannels) {
+                if (record.channel >= m_channels.size()) m_channels.resize(std::size_t(record.channel) + 1);
+                m_channels[record.channel].name.assign(
+                    reinterpret_cast<const char*>(m_map + payload + sizeof(record)),
+                    std::min<std::size_t>(record.nameBytes, rh.payloadBytes - sizeof(record)));
+            }
+        }
+        else if (rh.tag == kChunkTag && rh.payloadBytes >= sizeof(ChunkRecord)) {
+            ChunkRecord record;
+            std::memcpy(&record, m_map + payload, sizeof(record));
+            const std::size_t columns = std::size_t(record.count) * (sizeof(std::int64_t) + sizeof(double));
+            if (record.count > 0 && record.channel < maxChannels && sizeof(record) + columns <= rh.payloadBytes) {
+                if (record.channel >= m_channels.size()) m_channels.resize(std::size_t(record.channel) + 1);
+                const auto* t = reinterpret_cast<const std::int64_t*>(m_map + payload + sizeof(record));
+                auto& chunks = m_channels[record.channel].chunks;
+                // valueAt() searches by firstNs, then indexes the sample
+                // before the one found: a chunk whose bounds are not its
+                // first and last timestamps, or that starts before the one
+                // ahead of it ends, is dropped.
+                if (record.firstNs == t[0] && record.lastNs == t[record.count - 1] && record.firstNs <= record.lastNs
+                    && (chunks.empty() || chunks.back().lastNs <= record.firstNs)) {
+                    chunks.push_back({ record.firstNs, record.lastNs, record.count, t,
+                        reinterpret_cast<const double*>(t + record.count) });
+                    m_beginNs = std::min(m_beginNs, record.firstNs);
+                    m_endNs = std::max(m_endNs, record.lastNs);
+                }
+            }
+        }
+        offset = payload + rh.payloadBytes;
+    }
+    if (m_beginNs > m_endNs) m_beginNs = m_endNs = 0;
+
+    qDebug() << "[SessionLog] opened" << path.c_str() << "with" << channelCount() << "channels,"
+             << double(m_endNs - m_beginNs) * 1e-9 << "s";
+    return true;
+}
+
+int SessionLog::channelIndex(const std::string& name) const
+{
+    for (int i = 0; i < channelCount(); ++i)
+        if (m_channels[i].name == name) return i;
+    return -1;
+}
+
+bool SessionLog::valueAt(int channel, std::int64_t t, double& value) const
+{
+    if (channel < 0 || channel >= channelCount()) return false;
+    const auto& chunks = m_channels[channel].chunks;
+
+    // Last chunk starting at or before t, then the last sample at or before t in it.
+    auto c = std::upper_bound(chunks.begin(), chunks.end(), t,
+        [](std::int64_t time, const Chunk& chunk) { return time < chunk.firstNs; });
+    if (c == chunks.begin()) return false;
+    --c;
+    const std::int64_t* s = std::upper_bound(c->t, c->t + c->count, t);
+    value = c->v[(s - c->t) - 1];
+    return true;
+}
+
+std::size_t SessionLog::sampleCount(int channel) const
+{
+    std::size_t n = 0;
+    for (const Chunk& c : m_channels[channel].chunks) n += c.count;
+    return n;
+}
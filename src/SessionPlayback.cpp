@@ -0,0 +1,100 @@
+#include "SessionPlayback.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr std::chrono::milliseconds kEmitInterval{ 1 };
+constexpr JointSample::Quantity kReplayed[] = {
+    JointSample::Quantity::Position, JointSample::Quantity::Velocity, JointSample::Quantity::Effort };
+constexpr const char* kReplayedSuffix[] = { "/position", "/velocity", "/effort" };
+}
+
+class SessionPlayback::Reader : public TelemetryReader
+{
+public:
+    explicit Reader(std::shared_ptr<SessionPlayback> playback) : m_playback(std::move(playback)) {}
+
+    bool open(const std::vector<Endpoint>& endpoints) override
+    {
+        const SessionLog& log = m_playback->log();
+        m_sources.clear();
+        for (std::uint32_t i = 0; i < endpoints.size(); ++i)
+            for (std::size_t q = 0; q < std::size(kReplayed); ++q) {
+                const int channel = log.channelIndex(endpoints[i].jointName + kReplayedSuffix[q]);
+                if (channel >= 0) m_sources.push_back({ channel, i, kReplayed[q] });
+            }
+        m_last = TelemetryHub::nowNs();
+        return true; // joints missing from the log simply keep their position
+    }
+
+    std::size_t read(JointSample* out, std::size_t max, std::chrono::milliseconds timeout) override
+    {
+        std::this_thread::sleep_for(std::min(kEmitInterval, timeout));
+
+        const std::int64_t now = TelemetryHub::nowNs();
+        const std::int64_t cursor = m_playback->advance(now - m_last);
+        m_last = now;
+        if (cursor == m_emitted || m_sources.empty()) return 0;
+
+        // Emit a full frame at the cursor; resume from where the last read stopped if 'max' is short.
+        std::size_t n = 0;
+        const SessionLog& log = m_playback->log();
+        for (; m_next < m_sources.size() && n < max; ++m_next) {
+            const Source& s = m_sources[m_next];
+            double value;
+            if (log.valueAt(s.channel, cursor, value))
+                out[n++] = { now, s.endpoint, s.quantity, value };
+        }
+        if (m_next == m_sources.size()) {
+            m_next = 0;
+            m_emitted = cursor;
+        }
+        return n;
+    }
+
+private:
+    struct Source {
+        int channel;
+        std::uint32_t endpoint;
+        JointSample::Quantity quantity;
+    };
+
+    std::shared_ptr<SessionPlayback> m_playback;
+    std::vector<Source> m_sources;
+    std::size_t m_next = 0;
+    std::int64_t m_last = 0;
+    std::int64_t m_emitted = -1;
+};
+
+SessionPlayback::SessionPlayback(std::shared_ptr<const SessionLog> log)
+    : m_log(std::move(log)), m_cursor(m_log->beginNs())
+{
+}
+
+void SessionPlayback::seek(std::int64_t t)
+{
+    m_cursor.store(std::clamp(t, m_log->beginNs(), m_log->endNs()), std::memory_order_relaxed);
+}
+
+std::int64_t SessionPlayback::advance(std::int64_t elapsedNs)
+{
+    std::int64_t cursor = m_cursor.load(std::memory_order_relaxed);
+    if (!m_playing.load(std::memory_order_relaxed)) return cursor;
+
+    const std::int64_t next = std::min(m_log->endNs(),
+        cursor + std::int64_t(double(elapsedNs) * m_speed.load(std::memory_order_relaxed)));
+    // A seek from the GUI in between wins over this step.
+    m_cursor.compare_exchange_strong(cursor, next, std::memory_order_relaxed);
+    if (next >= m_log->endNs()) pause();
+    return m_cursor.load(std::memory_order_relaxed);
+}
+
+TelemetryHub::ReaderFactory SessionPlayback::makeReaderFactory()
+{
+    std::shared_ptr<SessionPlayback> self = shared_from_this();
+    return [self] { return std::make_unique<Reader>(self); };
+}
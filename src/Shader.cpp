@@ -1,59 +1,78 @@
 ﻿#include "Shader.hpp"
+#include "ShaderBinaryCache.hpp"
 #include <QOpenGLFunctions_4_3_Core>
-#include <fstream>
-#include <sstream>
 #include <iostream>
 #include <vector> // Needed for the dynamic error buffer
+#include <algorithm>
 #include <QDebug>
 
+#include <QFile>
 
-Shader::Shader(QOpenGLFunctions_4_3_Core* gl, const char* vertexPath, const char* fragmentPath) : m_gl(gl)
-{
-    if (!m_gl) throw std::runtime_error("OpenGL functions pointer is null.");
-
-    std::string vertexCode, fragmentCode;
-    std::ifstream vShaderFile, fShaderFile;
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+ShaderBinaryCache* Shader::s_binaryCache = nullptr;
 
-    try {
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vStream, fStream;
-        vStream << vShaderFile.rdbuf();
-        fStream << fShaderFile.rdbuf();
-        vertexCode = vStream.str();
-        fragmentCode = fStream.str();
-    }
-    catch (std::ifstream::failure&) {
-        throw std::runtime_error(std::string("SHADER::FILE_NOT_READ: ") + vertexPath + " or " + fragmentPath);
+namespace {
+// Accepts both Qt resource paths (":/shaders/...") and plain file paths, so
+// the same loaders serve embedded shaders and KR_SHADER_HOT_RELOAD builds.
+//
+// A line '#include "name.glsl"' is replaced by that file, read from the
+// same directory, followed by a #line so compiler errors keep pointing at
+// the including file. Includes may nest, eight deep at most.
+std::string readShaderSource(const std::string& path, int depth = 0)
+{
+    if (depth > 8) throw std::runtime_error("SHADER::INCLUDE_TOO_DEEP: " + path);
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly))
+        throw std::runtime_error("SHADER::FILE_NOT_READ: " + path);
+    const QByteArray bytes = file.readAll();
+    const std::string source(bytes.constData(), std::size_t(bytes.size()));
+    if (source.find("#include") == std::string::npos) return source;
+
+    const std::string dir = path.substr(0, path.find_last_of('/') + 1);
+    std::string out;
+    std::size_t line = 1;
+    for (std::size_t at = 0; at < source.size(); ++line) {
+        std::size_t end = source.find('\n', at);
+        if (end == std::string::npos) end = source.size();
+        const std::string text = source.substr(at, end - at);
+        const std::size_t open = text.find('"'), close = text.rfind('"');
+        if (text.rfind("#include", 0) == 0 && open != std::string::npos && close > open) {
+            out += readShaderSource(dir + text.substr(open + 1, close - open - 1), depth + 1);
+            out += "\n#line " + std::to_string(line + 1) + "\n";
+        }
+        else {
+            out.append(source, at, end - at).push_back('\n');
+        }
+        at = end + 1;
     }
+    return out;
+}
 
-    const char* vSrc = vertexCode.c_str();
-    const char* fSrc = fragmentCode.c_str();
+// GLSL wants #version first; the defines go on the line after it.
+std::string withDefines(std::string source, const std::string& defines)
+{
+    if (defines.empty()) return source;
+    const std::size_t version = source.find("#version");
+    const std::size_t at = version == std::string::npos ? 0 : source.find('\n', version);
+    source.insert(at == std::string::npos ? source.size() : at + 1, defines + "\n");
+    return source;
+}
+}
 
-    GLuint vertex = m_gl->glCreateShader(GL_VERTEX_SHADER);
-    m_gl->glShaderSource(vertex, 1, &vSrc, nullptr);
-    m_gl->glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
 
-    GLuint fragment = m_gl->glCreateShader(GL_FRAGMENT_SHADER);
-    m_gl->glShaderSource(fragment, 1, &fSrc, nullptr);
-    m_gl->glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+Shader::Shader(QOpenGLFunctions_4_3_Core* gl, const char* vertexPath, const char* fragmentPath) : m_gl(gl)
+{
+    if (!m_gl) throw std::runtime_error("OpenGL functions pointer is null.");
 
-    ID = m_gl->glCreateProgram();
-    m_gl->glAttachShader(ID, vertex);
-    m_gl->glAttachShader(ID, fragment);
-    m_gl->glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+    std::string vertexCode = readShaderSource(vertexPath);
+    std::string fragmentCode = readShaderSource(fragmentPath);
 
-    m_gl->glDeleteShader(vertex);
-    m_gl->glDeleteShader(fragment);
+    buildProgram({ { GL_VERTEX_SHADER, std::move(vertexCode) },
+                   { GL_FRAGMENT_SHADER, std::move(fragmentCode) } });
 }
 
 
-Shader::Shader(QOpenGLFunctions_4_3_Core* gl, const std::vector<std::string>& paths) : m_gl(gl), ID(0)
+Shader::Shader(QOpenGLFunctions_4_3_Core* gl, const std::vector<std::string>& paths, const std::string& defines)
+    : m_gl(gl), ID(0)
 {
     if (!m_gl) throw std::runtime_error("GL ptr null.");
 
@@ -67,34 +86,20 @@ Shader::Shader(QOpenGLFunctions_4_3_Core* gl, const std::vector<std::string>& pa
         throw std::runtime_error("Cannot infer shader stage from name: " + p);
         };
 
-    std::vector<GLuint> shaders;
-    shaders.reserve(paths.size());
+    std::vector<std::pair<GLenum, std::string>> stages;
+    stages.reserve(paths.size());
 
     for (const auto& file : paths) {
-        std::ifstream ifs(file, std::ios::in | std::ios::binary);
-        if (!ifs) throw std::runtime_error("Cannot open " + file);
-        std::stringstream ss;
-        ss << ifs.rdbuf();
-        std::string src = ss.str();
-
-        GLuint sh = m_gl->glCreateShader(stageFromName(file));
-        const char* csrc = src.c_str();
-        m_gl->glShaderSource(sh, 1, &csrc, nullptr);
-        m_gl->glCompileShader(sh);
-        checkCompileErrors(sh, "STAGE");
-        shaders.push_back(sh);
+        stages.emplace_back(stageFromName(file), withDefines(readShaderSource(file), defines));
     }
 
-    ID = m_gl->glCreateProgram();
-    for (auto sh : shaders) m_gl->glAttachShader(ID, sh);
-    m_gl->glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
-    for (auto sh : shaders) m_gl->glDeleteShader(sh);
+    buildProgram(stages);
 }
 
-std::unique_ptr<Shader> Shader::buildComputeShader(QOpenGLFunctions_4_3_Core* gl, const char* computePath)
+std::unique_ptr<Shader> Shader::buildComputeShader(QOpenGLFunctions_4_3_Core* gl, const char* computePath,
+    const std::string& defines)
 {
-    return std::make_unique<Shader>(gl, std::vector<std::string>{computePath});
+    return std::make_unique<Shader>(gl, std::vector<std::string>{computePath}, defines);
 }
 
 
@@ -118,13 +123,66 @@ void Shader::use()
     if (m_gl) m_gl->glUseProgram(ID);
 }
 
-void Shader::setBool(const std::string& name, bool value) const { if (m_gl) m_gl->glUniform1i(m_gl->glGetUniformLocation(ID, name.c_str()), (int)value); }
-void Shader::setInt(const std::string& name, int value) const { if (m_gl) m_gl->glUniform1i(m_gl->glGetUniformLocation(ID, name.c_str()), value); }
-void Shader::setFloat(const std::string& name, float value) const { if (m_gl) m_gl->glUniform1f(m_gl->glGetUniformLocation(ID, name.c_str()), value); }
-void Shader::setMat4(const std::string& name, const glm::mat4& mat) const { if (m_gl) m_gl->glUniformMatrix4fv(m_gl->glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]); }
-void Shader::setVec3(const std::string& name, const glm::vec3& value) const { if (m_gl) m_gl->glUniform3fv(m_gl->glGetUniformLocation(ID, name.c_str()), 1, &value[0]); }
-void Shader::setVec4(const std::string& name, const glm::vec4& value) const { if (m_gl) m_gl->glUniform4fv(m_gl->glGetUniformLocation(ID, name.c_str()), 1, &value[0]); }
-void Shader::setVec2(const std::string& name, const glm::vec2& value) const { if (m_gl) m_gl->glUniform2fv(m_gl->glGetUniformLocation(ID, name.c_str()), 1, &value[0]); }
+GLint Shader::uniformLocation(const std::string& name) const
+{
+    auto it = m_uniformLocations.find(name);
+    return it == m_uniformLocations.end() ? -1 : it->second;
+}
+
+void Shader::reflectUniforms()
+{
+    m_uniformLocations.clear();
+    if (!m_gl || ID == 0) return;
+
+    GLint count = 0, maxLen = 0;
+    m_gl->glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    m_gl->glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLen);
+    std::vector<char> buf(static_cast<size_t>(std::max(maxLen, 1)));
+
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei len = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        m_gl->glGetActiveUniform(ID, static_cast<GLuint>(i), maxLen, &len, &size, &type, buf.data());
+        std::string name(buf.data(), len);
+
+        GLint loc = m_gl->glGetUniformLocation(ID, name.c_str());
+        if (loc < 0) continue; // member of a uniform block
+
+        m_uniformLocations[name] = loc;
+
+        // Arrays are reported once as "a[0]": register "a" and every "a[i]".
+        // GL does not promise consecutive element locations, so each is asked for.
+        const auto bracket = name.rfind("[0]");
+        if (bracket != std::string::npos && bracket + 3 == name.size()) {
+            const std::string base = name.substr(0, bracket);
+            m_uniformLocations[base] = loc;
+            for (GLint e = 1; e < size; ++e) {
+                const std::string element = base + "[" + std::to_string(e) + "]";
+                const GLint elementLoc = m_gl->glGetUniformLocation(ID, element.c_str());
+                if (elementLoc >= 0) m_uniformLocations[element] = elementLoc;
+            }
+        }
+    }
+}
+
+void Shader::setBool(const std::string& name, bool value) const { setBool(uniformLocation(name), value); }
+void Shader::setInt(const std::string& name, int value) const { setInt(uniformLocation(name), value); }
+void Shader::setUInt(const std::string& name, unsigned value) const { setUInt(uniformLocation(name), value); }
+void Shader::setFloat(const std::string& name, float value) const { setFloat(uniformLocation(name), value); }
+void Shader::setMat4(const std::string& name, const glm::mat4& mat) const { setMat4(uniformLocation(name), mat); }
+void Shader::setVec3(const std::string& name, const glm::vec3& value) const { setVec3(uniformLocation(name), value); }
+void Shader::setVec4(const std::string& name, const glm::vec4& value) const { setVec4(uniformLocation(name), value); }
+void Shader::setVec2(const std::string& name, const glm::vec2& value) const { setVec2(uniformLocation(name), value); }
+
+void Shader::setBool(GLint loc, bool value) const { if (m_gl && loc >= 0) m_gl->glUniform1i(loc, (int)value); }
+void Shader::setInt(GLint loc, int value) const { if (m_gl && loc >= 0) m_gl->glUniform1i(loc, value); }
+void Shader::setUInt(GLint loc, unsigned value) const { if (m_gl && loc >= 0) m_gl->glUniform1ui(loc, value); }
+void Shader::setFloat(GLint loc, float value) const { if (m_gl && loc >= 0) m_gl->glUniform1f(loc, value); }
+void Shader::setMat4(GLint loc, const glm::mat4& mat) const { if (m_gl && loc >= 0) m_gl->glUniformMatrix4fv(loc, 1, GL_FALSE, &mat[0][0]); }
+void Shader::setVec3(GLint loc, const glm::vec3& value) const { if (m_gl && loc >= 0) m_gl->glUniform3fv(loc, 1, &value[0]); }
+void Shader::setVec4(GLint loc, const glm::vec4& value) const { if (m_gl && loc >= 0) m_gl->glUniform4fv(loc, 1, &value[0]); }
+void Shader::setVec2(GLint loc, const glm::vec2& value) const { if (m_gl && loc >= 0) m_gl->glUniform2fv(loc, 1, &value[0]); }
 
 // This function is now memory-safe. It dynamically allocates a buffer
 // of the correct size for the error log, preventing any buffer overflows.
@@ -176,88 +234,88 @@ std::unique_ptr<Shader> Shader::buildTessellatedShader(
     const char* vsPath,
     const char* tcsPath,
     const char* tesPath,
-    const char* fsPath)
+    const char* fsPath,
+    const char* gsPath)
 {
-    auto loadFile = [](const char* p) -> std::string
-        {
-            std::ifstream in(p, std::ios::in | std::ios::binary);
-            if (!in) throw std::runtime_error(std::string("Cannot open ") + p);
-            std::ostringstream s;  s << in.rdbuf();  return s.str();
-        };
+    std::string vsCode = readShaderSource(vsPath);
+    std::string tcsCode = readShaderSource(tcsPath);
+    std::string tesCode = readShaderSource(tesPath);
+    std::string fsCode = readShaderSource(fsPath);
+    std::string gsCode = gsPath ? readShaderSource(gsPath) : std::string();
+
+    std::vector<std::pair<GLenum, std::string>> stages{
+        { GL_VERTEX_SHADER, std::move(vsCode) },
+        { GL_TESS_CONTROL_SHADER, std::move(tcsCode) },
+        { GL_TESS_EVALUATION_SHADER, std::move(tesCode) },
+    };
+    if (gsPath) stages.emplace_back(GL_GEOMETRY_SHADER, std::move(gsCode));
+    stages.emplace_back(GL_FRAGMENT_SHADER, std::move(fsCode));
 
-    std::string vsCode = loadFile(vsPath);
-    std::string tcsCode = loadFile(tcsPath);
-    std::string tesCode = loadFile(tesPath);
-    std::string fsCode = loadFile(fsPath);
+    auto sh = std::unique_ptr<Shader>(new Shader);
+    // private default-ctor substitute: we immediately patch its members
+    sh->m_gl = gl;
+    sh->buildProgram(stages);
+    return sh;
+}
 
-    auto check = [&](GLuint obj, bool isProgram, const char* label)
-        {
-            GLint ok = 0;
-            if (!isProgram)
-            {
-                gl->glGetShaderiv(obj, GL_COMPILE_STATUS, &ok);
-                if (!ok)
-                {
-                    GLint len = 0;
-                    gl->glGetShaderiv(obj, GL_INFO_LOG_LENGTH, &len);
-                    std::string log(len > 0 ? len : 1, '\0');
-                    gl->glGetShaderInfoLog(obj, len, nullptr, log.data());
-                    throw std::runtime_error(
-                        std::string("SHADER::") + label +
-                        "::COMPILATION_FAILED\n" + log);
-                }
-            }
-            else
-            {
-                gl->glGetProgramiv(obj, GL_LINK_STATUS, &ok);
-                if (!ok)
-                {
-                    GLint len = 0;
-                    gl->glGetProgramiv(obj, GL_INFO_LOG_LENGTH, &len);
-                    std::string log(len > 0 ? len : 1, '\0');
-                    gl->glGetProgramInfoLog(obj, len, nullptr, log.data());
-                    throw std::runtime_error(
-                        std::string("SHADER::PROGRAM::LINK_FAILED\n") + log);
-                }
-            }
-        };
+void Shader::setBinaryCache(ShaderBinaryCache* cache)
+{
+    s_binaryCache = cache;
+}
 
-    auto compile = [&](const std::string& src, GLenum type) -> GLuint
-        {
-            GLuint id = gl->glCreateShader(type);
-            const char* csrc = src.c_str();
-            gl->glShaderSource(id, 1, &csrc, nullptr);
-            gl->glCompileShader(id);
-
-            check(id, /*isProgram=*/false,
-                type == GL_VERTEX_SHADER ? "VERTEX" :
-                type == GL_TESS_CONTROL_SHADER ? "TESS_CTRL" :
-                type == GL_TESS_EVALUATION_SHADER ? "TESS_EVAL" :
-                /* else */                          "FRAGMENT");
-            return id;
+void Shader::buildProgram(const std::vector<std::pair<GLenum, std::string>>& stages)
+{
+    auto stageLabel = [](GLenum type) -> const char* {
+        switch (type) {
+        case GL_VERTEX_SHADER:          return "VERTEX";
+        case GL_TESS_CONTROL_SHADER:    return "TESS_CTRL";
+        case GL_TESS_EVALUATION_SHADER: return "TESS_EVAL";
+        case GL_GEOMETRY_SHADER:        return "GEOMETRY";
+        case GL_COMPUTE_SHADER:         return "COMPUTE";
+        default:                        return "FRAGMENT";
+        }
         };
 
-    GLuint vs = compile(vsCode, GL_VERTEX_SHADER);
-    GLuint tcs = compile(tcsCode, GL_TESS_CONTROL_SHADER);
-    GLuint tes = compile(tesCode, GL_TESS_EVALUATION_SHADER);
-    GLuint fs = compile(fsCode, GL_FRAGMENT_SHADER);
+    ID = m_gl->glCreateProgram();
+
+    QByteArray key;
+    if (s_binaryCache && s_binaryCache->enabled()) {
+        key = s_binaryCache->key(stages);
+        if (s_binaryCache->load(key, ID)) {
+            reflectUniforms();
+            return;
+        }
+    }
 
-    GLuint prog = gl->glCreateProgram();
-    gl->glAttachShader(prog, vs);
-    gl->glAttachShader(prog, tcs);
-    gl->glAttachShader(prog, tes);
-    gl->glAttachShader(prog, fs);
-    gl->glLinkProgram(prog);
-    check(prog, /*isProgram=*/true, "PROGRAM");
+    std::vector<GLuint> shaders;
+    shaders.reserve(stages.size());
+    try {
+        for (const auto& [type, source] : stages) {
+            GLuint sh = m_gl->glCreateShader(type);
+            shaders.push_back(sh);
+            const char* csrc = source.c_str();
+            m_gl->glShaderSource(sh, 1, &csrc, nullptr);
+            m_gl->glCompileShader(sh);
+            checkCompileErrors(sh, stageLabel(type));
+        }
 
-    gl->glDeleteShader(vs);
-    gl->glDeleteShader(tcs);
-    gl->glDeleteShader(tes);
-    gl->glDeleteShader(fs);
+        for (auto sh : shaders) m_gl->glAttachShader(ID, sh);
+        if (!key.isEmpty())
+            m_gl->glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        m_gl->glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+    }
+    catch (...) {
+        for (auto sh : shaders) m_gl->glDeleteShader(sh);
+        m_gl->glDeleteProgram(ID);
+        ID = 0;
+        throw;
+    }
 
-    auto sh = std::unique_ptr<Shader>(new Shader);
-    // private default-ctor substitute: we immediately patch its members
-    sh->m_gl = gl;
-    sh->ID = prog;
-    return sh;
-}
\ No newline at end of file
+    for (auto sh : shaders) {
+        m_gl->glDetachShader(ID, sh);
+        m_gl->glDeleteShader(sh);
+    }
+    if (!key.isEmpty()) s_binaryCache->store(key, ID);
+    reflectUniforms();
+}
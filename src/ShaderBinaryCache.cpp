@@ -0,0 +1,131 @@
+#include "ShaderBinaryCache.hpp"
+
+#include <QOpenGLFunctions_4_3_Core>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions> // QOPENGLF_APIENTRYP
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+constexpr quint32 kFileMagic = 0x42505352; // "RSPB"
+
+// GL_KHR_parallel_shader_compile lets the driver compile on its own threads;
+// most drivers only do so once a thread count has been requested.
+using MaxShaderCompilerThreadsFn = void (QOPENGLF_APIENTRYP)(GLuint count);
+
+void enableParallelCompile()
+{
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!ctx) return;
+    const bool khr = ctx->hasExtension("GL_KHR_parallel_shader_compile");
+    if (!khr && !ctx->hasExtension("GL_ARB_parallel_shader_compile")) return;
+
+    auto fn = reinterpret_cast<MaxShaderCompilerThreadsFn>(ctx->getProcAddress(
+        khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB"));
+    if (fn) fn(0xFFFFFFFFu); // implementation-chosen thread count
+}
+}
+
+void ShaderBinaryCache::setFunctions(QOpenGLFunctions_4_3_Core* gl)
+{
+    m_gl = gl;
+    m_enabled = false;
+    if (!m_gl) return;
+
+    enableParallelCompile();
+
+    GLint formats = 0;
+    m_gl->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0) {
+        qDebug() << "[ShaderBinaryCache] driver exposes no program binary formats; cache disabled";
+        return;
+    }
+
+    auto str = [this](GLenum name) {
+        const auto* s = reinterpret_cast<const char*>(m_gl->glGetString(name));
+        return QByteArray(s ? s : "");
+    };
+    m_driverId = str(GL_VENDOR) + '\n' + str(GL_RENDERER) + '\n' + str(GL_VERSION);
+
+    const QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (base.isEmpty()) return;
+    m_directory = base + QStringLiteral("/shaders");
+    if (!QDir().mkpath(m_directory)) {
+        qWarning() << "[ShaderBinaryCache] cannot create" << m_directory << "; cache disabled";
+        return;
+    }
+    m_enabled = true;
+}
+
+QByteArray ShaderBinaryCache::key(const std::vector<Stage>& stages) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(m_driverId);
+    for (const auto& [type, source] : stages) {
+        const quint32 t = type;
+        hash.addData(QByteArrayView(reinterpret_cast<const char*>(&t), sizeof(t)));
+        hash.addData(QByteArrayView(source.data(), qsizetype(source.size())));
+    }
+    return hash.result().toHex();
+}
+
+QString ShaderBinaryCache::pathFor(const QByteArray& key) const
+{
+    return m_directory + QLatin1Char('/') + QString::fromLatin1(key) + QStringLiteral(".bin");
+}
+
+bool ShaderBinaryCache::load(const QByteArray& key, GLuint program)
+{
+    if (!m_enabled) return false;
+
+    QFile file(pathFor(key));
+    if (!file.open(QIODevice::ReadOnly)) { ++m_misses; return false; }
+    const QByteArray blob = file.readAll();
+
+    quint32 magic = 0, format = 0;
+    if (blob.size() <= qsizetype(2 * sizeof(quint32))) { ++m_misses; return false; }
+    std::memcpy(&magic, blob.constData(), sizeof(magic));
+    std::memcpy(&format, blob.constData() + sizeof(magic), sizeof(format));
+    if (magic != kFileMagic) { ++m_misses; return false; }
+
+    const char* binary = blob.constData() + 2 * sizeof(quint32);
+    const GLsizei length = GLsizei(blob.size() - 2 * sizeof(quint32));
+    m_gl->glProgramBinary(program, GLenum(format), binary, length);
+
+    GLint ok = GL_FALSE;
+    m_gl->glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) { ++m_misses; return false; }
+
+    ++m_hits;
+    return true;
+}
+
+void ShaderBinaryCache::store(const QByteArray& key, GLuint program)
+{
+    if (!m_enabled) return;
+
+    GLint length = 0;
+    m_gl->glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    QByteArray blob(qsizetype(2 * sizeof(quint32)) + length, Qt::Uninitialized);
+    GLenum format = 0;
+    GLsizei written = 0;
+    m_gl->glGetProgramBinary(program, length, &written, &format, blob.data() + 2 * sizeof(quint32));
+    if (written <= 0) return;
+    blob.resize(qsizetype(2 * sizeof(quint32)) + written);
+
+    const quint32 magic = kFileMagic, fmt = format;
+    std::memcpy(blob.data(), &magic, sizeof(magic));
+    std::memcpy(blob.data() + sizeof(magic), &fmt, sizeof(fmt));
+
+    // QSaveFile renames into place, so a crash never leaves a truncated entry.
+    QSaveFile file(pathFor(key));
+    if (!file.open(QIODevice::WriteOnly) || file.write(blob) != blob.size() || !file.commit())
+        qWarning() << "[ShaderBinaryCache] failed to write" << file.fileName();
+}
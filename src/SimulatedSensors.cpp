@@ -0,0 +1,244 @@
+#include "SimulatedSensors.hpp"
+#include "DynamicsSimulation.hpp"
+#include "components.hpp"
+
+#include <entt/entt.hpp>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <variant>
+
+namespace {
+constexpr double kTwoPi = 6.283185307179586;
+
+double uniform(std::uint64_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return double(state >> 11) * 0x1.0p-53;
+}
+
+// Irwin-Hall: four uniforms have variance 1/3, so scale by sqrt(3).
+double gaussian(std::uint64_t& state)
+{
+    const double sum = uniform(state) + uniform(state) + uniform(state) + uniform(state);
+    return (sum - 2.0) * 1.7320508075688772;
+}
+
+std::uint64_t seedOf(std::uint64_t seed, std::uint64_t lane)
+{
+    // splitmix64; never zero, which would stall xorshift.
+    std::uint64_t z = seed + (lane + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+std::chrono::steady_clock::duration periodOf(double hz)
+{
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / std::clamp(hz, 1.0, 100000.0)));
+}
+}
+
+void SimulatedSensors::Lanes::add(std::uint32_t channelIndex, std::uint32_t frameDof, double laneScale,
+    double laneOffset, double laneModulus, double laneOrigin, double laneLow, double laneHigh, std::uint64_t seed)
+{
+    channel.push_back(channelIndex);
+    dof.push_back(frameDof);
+    scale.push_back(laneScale);
+    offset.push_back(laneOffset);
+    modulus.push_back(laneModulus);
+    origin.push_back(laneOrigin);
+    low.push_back(laneLow);
+    high.push_back(laneHigh);
+    random.push_back(seed);
+}
+
+void SimulatedSensors::Lanes::resize()
+{
+    const std::size_t n = size();
+    truth.assign(n, 0.0);
+    reading.assign(n, 0.0);
+    count.assign(n, 0.0);
+    position.assign(n, 0.0);
+    lastPosition.assign(n, 0.0);
+    effort.assign(n, 0.0);
+    primed = false;
+}
+
+SimulatedSensors::SimulatedSensors(entt::registry& registry, DynamicsSimulation& dynamics, const Settings& settings)
+    : m_registry(registry), m_dynamics(dynamics), m_settings(settings)
+{
+}
+
+bool SimulatedSensors::open(const std::vector<Endpoint>& endpoints)
+{
+    m_encoders = Lanes{};
+    m_potentiometers = Lanes{};
+    m_exact = Lanes{};
+    if (!m_dynamics.running()) return false;
+
+    for (std::uint32_t i = 0; i < endpoints.size(); ++i) {
+        const int dof = m_dynamics.frameDof(endpoints[i].joint);
+        const auto* joint = m_registry.try_get<JointComponent>(endpoints[i].joint);
+        if (dof < 0 || !joint) continue;
+        const JointDescription& d = joint->description;
+        const std::uint64_t seed = seedOf(m_settings.seed, i);
+        const double revolution = d.type == JointType::PRISMATIC ? 1.0 : kTwoPi;
+
+        bool placed = false;
+        for (const SensorVariant& sensor : d.sensors) {
+            if (const auto* encoder = std::get_if<EncoderSensor>(&sensor)) {
+                const double scale = encoder->counts_per_revolution * encoder->gear_ratio_to_joint / revolution;
+                if (!(std::abs(scale) > 0.0)) continue;
+                const double modulus = encoder->type == EncoderType::ABSOLUTE_SINGLE_TURN
+                    ? std::abs(encoder->counts_per_revolution) : 0.0;
+                m_encoders.add(i, std::uint32_t(dof), scale, encoder->zero_offset, modulus, 0.0, 0.0, 0.0, seed);
+                placed = true;
+                break;
+            }
+            if (const auto* pot = std::get_if<PotentiometerSensor>(&sensor)) {
+                double lower = d.limits.lower, upper = d.limits.upper;
+                if (upper <= lower) {
+                    const double span = revolution / std::max(std::abs(pot->gear_ratio_to_joint), 1e-9);
+                    lower = -0.5 * span;
+                    upper = 0.5 * span;
+                }
+                const double scale = (pot->max_voltage - pot->min_voltage) / (upper - lower);
+                if (!(std::abs(scale) > 0.0)) continue;
+                m_potentiometers.add(i, std::uint32_t(dof), scale, lower, 0.0, pot->min_voltage,
+                    std::min(pot->min_voltage, pot->max_voltage), std::max(pot->min_voltage, pot->max_voltage), seed);
+                placed = true;
+                break;
+            }
+        }
+        if (!placed) m_exact.add(i, std::uint32_t(dof), 1.0, 0.0, 0.0, 0.0, 0.0, 0.0, seed);
+    }
+
+    const Clock::time_point now = Clock::now();
+    m_encoders.period = periodOf(m_settings.encoderRate);
+    m_exact.period = m_encoders.period;
+    m_potentiometers.period = periodOf(m_settings.potentiometerRate);
+    for (Lanes* lanes : { &m_encoders, &m_potentiometers, &m_exact }) {
+        lanes->resize();
+        lanes->deadline = now;
+    }
+    const std::size_t lanes = m_encoders.size() + m_potentiometers.size() + m_exact.size();
+    if (lanes == 0) return false;
+    m_pending.clear();
+    m_pending.reserve(lanes * JointSample::kQuantityCount);
+    m_next = 0;
+    m_dynamics.setMeasured(true);
+    return true;
+}
+
+void SimulatedSensors::close()
+{
+    m_dynamics.setMeasured(false);
+}
+
+std::size_t SimulatedSensors::read(JointSample* out, std::size_t max, std::chrono::milliseconds timeout)
+{
+    if (m_next == m_pending.size()) {
+        m_pending.clear();
+        m_next = 0;
+
+        Clock::time_point due = Clock::now() + timeout;
+        for (const Lanes* lanes : { &m_encoders, &m_potentiometers, &m_exact })
+            if (lanes->size()) due = std::min(due, lanes->deadline);
+        std::this_thread::sleep_until(due);
+
+        // The newest step, or the last one again if the sensors outpace the
+        // simulation: a sensor samples whatever the joint holds.
+        m_dynamics.pollSensorState();
+        const DynamicsSimulation::State& state = m_dynamics.sensorState();
+        const Clock::time_point now = Clock::now();
+        const std::int64_t stamp = TelemetryHub::nowNs();
+        for (Lanes* lanes : { &m_encoders, &m_potentiometers, &m_exact }) {
+            if (!lanes->size() || now < lanes->deadline) continue;
+            if (!gather(*lanes, state)) continue;
+            if (lanes == &m_encoders) quantizeEncoders();
+            else if (lanes == &m_potentiometers) quantizePotentiometers();
+            else std::copy(m_exact.truth.begin(), m_exact.truth.end(), m_exact.position.begin());
+            emit(*lanes, stamp, lanes != &m_exact);
+
+            // Keep the phase: a late read skips the periods it missed.
+            lanes->deadline += lanes->period;
+            if (now >= lanes->deadline) lanes->deadline += ((now - lanes->deadline) / lanes->period + 1) * lanes->period;
+        }
+    }
+
+    const std::size_t n = std::min(max, m_pending.size() - m_next);
+    std::copy_n(m_pending.begin() + std::ptrdiff_t(m_next), n, out);
+    m_next += n;
+    return n;
+}
+
+bool SimulatedSensors::gather(Lanes& lanes, const DynamicsSimulation::State& state)
+{
+    const std::size_t n = lanes.size();
+    for (std::size_t i = 0; i < n; ++i)
+        if (lanes.dof[i] >= state.position.size()) return false;
+    const double noise = m_settings.effortNoise;
+    for (std::size_t i = 0; i < n; ++i) {
+        lanes.truth[i] = state.position[lanes.dof[i]];
+        lanes.effort[i] = state.effort[lanes.dof[i]] + noise * gaussian(lanes.random[i]);
+    }
+    return true;
+}
+
+void SimulatedSensors::quantizeEncoders()
+{
+    Lanes& e = m_encoders;
+    const std::size_t n = e.size();
+    const double noise = m_settings.encoderNoise;
+    const bool primed = e.primed;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double counts = std::floor((e.truth[i] - e.offset[i]) * e.scale[i] + noise * gaussian(e.random[i]));
+        const double m = e.modulus[i];
+        const double wrapped = counts - m * std::floor(counts / std::max(m, 1.0));
+        // The drive's unwrap: the shorter way round since the last reading.
+        double step = wrapped - e.reading[i];
+        step -= m * std::round(step / std::max(m, 1.0));
+        e.count[i] = primed ? e.count[i] + step : counts;
+        e.reading[i] = wrapped;
+        // Mid-count, so truncation does not bias the position.
+        e.position[i] = (e.count[i] + 0.5) / e.scale[i] + e.offset[i];
+    }
+}
+
+void SimulatedSensors::quantizePotentiometers()
+{
+    Lanes& p = m_potentiometers;
+    const std::size_t n = p.size();
+    const double noise = m_settings.potentiometerNoise;
+    const double levels = double((std::uint64_t(1) << std::clamp(m_settings.adcBits, 1, 32)) - 1);
+    for (std::size_t i = 0; i < n; ++i) {
+        const double volts = p.origin[i] + (p.truth[i] - p.offset[i]) * p.scale[i] + noise * gaussian(p.random[i]);
+        const double range = std::max(p.high[i] - p.low[i], 1e-12);
+        const double code = std::round(std::clamp((volts - p.low[i]) / range, 0.0, 1.0) * levels);
+        p.reading[i] = p.low[i] + code * range / levels;
+        p.position[i] = (p.reading[i] - p.origin[i]) / p.scale[i] + p.offset[i];
+    }
+}
+
+void SimulatedSensors::emit(Lanes& lanes, std::int64_t now, bool raw)
+{
+    const std::size_t n = lanes.size();
+    const double dt = lanes.primed ? double(now - lanes.lastNs) * 1e-9 : 0.0;
+    const double rate = dt > 0.0 ? 1.0 / dt : 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double velocity = (lanes.position[i] - lanes.lastPosition[i]) * rate;
+        lanes.lastPosition[i] = lanes.position[i];
+        const std::uint32_t channel = lanes.channel[i];
+        m_pending.push_back({ now, channel, JointSample::Quantity::Position, lanes.position[i] });
+        m_pending.push_back({ now, channel, JointSample::Quantity::Velocity, velocity });
+        m_pending.push_back({ now, channel, JointSample::Quantity::Effort, lanes.effort[i] });
+        if (raw) m_pending.push_back({ now, channel, JointSample::Quantity::Sensor, lanes.reading[i] });
+    }
+    lanes.primed = true;
+    lanes.lastNs = now;
+}
@@ -0,0 +1,139 @@
+#include "SplineArena.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
+
+#include <QOpenGLFunctions_4_3_Core>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+constexpr GLsizei kInitialPointCapacity = 16 * 1024;
+}
+
+const SplineArena::Range* SplineArena::find(std::uint32_t key) const
+{
+    auto it = m_ranges.find(key);
+    return it == m_ranges.end() ? nullptr : &it->second;
+}
+
+const SplineArena::Range& SplineArena::upload(std::uint32_t key, std::uint32_t revision,
+    const std::vector<glm::vec3>& points)
+{
+    Range& r = m_ranges[key];
+    if (r.revision == revision) return r;
+
+    const GLsizei count = static_cast<GLsizei>(points.size());
+    if (count > r.capacity) {
+        free(r.first, r.capacity);
+        r.first = allocate(count);
+        r.capacity = count;
+    }
+    m_used += count;
+    m_used -= r.count;
+    r.count = count;
+    r.revision = revision;
+
+    if (count > 0) {
+        m_staging.resize(points.size());
+        for (std::size_t i = 0; i < points.size(); ++i) m_staging[i] = glm::vec4(points[i], 1.0f);
+
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        m_gl->glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(r.first) * sizeof(glm::vec4),
+            GLsizeiptr(count) * sizeof(glm::vec4), m_staging.data());
+        RenderStats::upload(std::uint64_t(count) * sizeof(glm::vec4));
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    return r;
+}
+
+void SplineArena::release(std::uint32_t key)
+{
+    auto it = m_ranges.find(key);
+    if (it == m_ranges.end()) return;
+
+    free(it->second.first, it->second.capacity);
+    m_used -= it->second.count;
+    m_ranges.erase(it);
+}
+
+void SplineArena::destroy()
+{
+    if (m_gl && m_buffer) GpuMemory::deleteBuffers(m_gl, 1, &m_buffer);
+    m_buffer = 0;
+    m_capacity = m_top = 0;
+    m_freeList.clear();
+    m_ranges.clear();
+    m_used = 0;
+    ++m_generation;
+}
+
+GLsizei SplineArena::allocate(GLsizei count)
+{
+    for (auto it = m_freeList.begin(); it != m_freeList.end(); ++it) {
+        if (it->size < count) continue;
+        const GLsizei offset = it->offset;
+        it->offset += count;
+        it->size -= count;
+        if (it->size == 0) m_freeList.erase(it);
+        return offset;
+    }
+
+    if (m_top + count > m_capacity) grow(m_top + count);
+    const GLsizei offset = m_top;
+    m_top += count;
+    return offset;
+}
+
+void SplineArena::free(GLsizei offset, GLsizei count)
+{
+    if (count == 0) return;
+
+    auto it = std::lower_bound(m_freeList.begin(), m_freeList.end(), offset,
+        [](const Block& b, GLsizei off) { return b.offset < off; });
+    it = m_freeList.insert(it, Block{ offset, count });
+
+    if (auto next = it + 1; next != m_freeList.end() && it->offset + it->size == next->offset) {
+        it->size += next->size;
+        m_freeList.erase(next);
+    }
+    if (it != m_freeList.begin()) {
+        auto prev = it - 1;
+        if (prev->offset + prev->size == it->offset) {
+            prev->size += it->size;
+            it = m_freeList.erase(it) - 1;
+        }
+    }
+
+    if (it->offset + it->size == m_top) {
+        m_top = it->offset;
+        m_freeList.erase(it);
+    }
+}
+
+void SplineArena::grow(GLsizei required)
+{
+    GLsizei newCapacity = std::max(m_capacity * 2, kInitialPointCapacity);
+    while (newCapacity < required) newCapacity *= 2;
+
+    GLuint newBuffer = 0;
+    m_gl->glGenBuffers(1, &newBuffer);
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    GpuMemory::bufferData(m_gl, GL_COPY_WRITE_BUFFER, newBuffer, GLsizeiptr(newCapacity) * sizeof(glm::vec4), nullptr,
+        GL_DYNAMIC_DRAW, GpuMemory::Category::Splines);
+
+    if (m_buffer != 0) {
+        // Offsets are preserved, so ranges handed out so far remain valid.
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+        m_gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+            GLsizeiptr(m_top) * sizeof(glm::vec4));
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        GpuMemory::deleteBuffers(m_gl, 1, &m_buffer);
+    }
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    qDebug() << "[SplineArena] grew point buffer to" << newCapacity << "points";
+
+    m_buffer = newBuffer;
+    m_capacity = newCapacity;
+    ++m_generation;
+}
@@ -0,0 +1,267 @@
+#include "SplineEvaluation.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace SplineEvaluation
+{
+    // Evaluates a Catmull-Rom spline on the CPU.
+    std::vector<glm::vec3> catmullRom(const std::vector<glm::vec3>& controlPoints, int segmentsPerCurve)
+    {
+        std::vector<glm::vec3> lineVertices;
+        if (controlPoints.size() < 4) { // A segment requires at least 4 control points.
+            return lineVertices;
+        }
+
+        lineVertices.reserve(static_cast<size_t>(controlPoints.size() - 3) * segmentsPerCurve); // Pre-allocate memory for efficiency.
+
+        // Iterate through each 4-point segment of the spline.
+        for (size_t i = 0; i < controlPoints.size() - 3; ++i) {
+            const glm::vec3& p0 = controlPoints[i];
+            const glm::vec3& p1 = controlPoints[i + 1];
+            const glm::vec3& p2 = controlPoints[i + 2];
+            const glm::vec3& p3 = controlPoints[i + 3];
+
+            // Generate the points for the current segment.
+            for (int j = 0; j < segmentsPerCurve; ++j) {
+                float t = static_cast<float>(j) / (segmentsPerCurve - 1); // Parameter t from 0 to 1.
+                float t2 = t * t;
+                float t3 = t2 * t;
+
+                // Catmull-Rom interpolation formula.
+                glm::vec3 point = 0.5f * (
+                    (2.0f * p1) +
+                    (-p0 + p2) * t +
+                    (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                    (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3
+                    );
+                lineVertices.push_back(point);
+            }
+        }
+        return lineVertices;
+    }
+
+    // Evaluates a single Bezier curve of degree n = controlPoints.size() - 1 on the CPU.
+    // Binomials are tabulated once and each sample is a scaled Horner sum, so the
+    // cost is O(n) per sample with no pow() calls.
+    std::vector<glm::vec3> bezier(const std::vector<glm::vec3>& controlPoints, int numSegments) {
+        std::vector<glm::vec3> lineVertices;
+        if (controlPoints.empty()) {
+            return lineVertices;
+        }
+        lineVertices.reserve(numSegments); // Pre-allocate memory.
+
+        const int n = static_cast<int>(controlPoints.size()) - 1; // Degree of the curve.
+        std::vector<float> binomial(n + 1, 1.0f);
+        for (int j = 1; j <= n; ++j)
+            binomial[j] = binomial[j - 1] * float(n - j + 1) / float(j);
+
+        for (int i = 0; i < numSegments; ++i) {
+            const float t = static_cast<float>(i) / (numSegments - 1); // Parameter t from 0 to 1.
+            // sum_j C(n,j) t^j (1-t)^(n-j) P_j = (1-t)^n * sum_j C(n,j) r^j P_j with r = t/(1-t).
+            // Mirroring for t > 0.5 keeps r <= 1 so nothing overflows.
+            const bool flip = t > 0.5f;
+            const float a = flip ? 1.0f - t : t;
+            const float b = 1.0f - a;
+            const float r = a / b;
+            glm::vec3 sum = controlPoints[flip ? n : 0];
+            float rj = 1.0f, bn = 1.0f;
+            for (int j = 1; j <= n; ++j) {
+                rj *= r;
+                bn *= b;
+                sum += (binomial[j] * rj) * controlPoints[flip ? n - j : j];
+            }
+            lineVertices.push_back(sum * bn);
+        }
+        return lineVertices;
+    }
+
+    // Evaluates a chain of cubic Bezier segments (anchor, control, control, anchor, ...;
+    // consecutive segments share their anchor) by forward differencing: three
+    // additions per sample after a constant setup per segment.
+    std::vector<glm::vec3> piecewiseBezier(const std::vector<glm::vec3>& controlPoints, int segmentsPerCurve)
+    {
+        std::vector<glm::vec3> lineVertices;
+        if (controlPoints.size() < 4) {
+            return lineVertices;
+        }
+        const std::size_t curves = (controlPoints.size() - 1) / 3;
+        lineVertices.reserve(curves * (segmentsPerCurve - 1) + 1);
+
+        const float h = 1.0f / (segmentsPerCurve - 1);
+        for (std::size_t c = 0; c < curves; ++c) {
+            const glm::vec3& p0 = controlPoints[3 * c];
+            const glm::vec3& p1 = controlPoints[3 * c + 1];
+            const glm::vec3& p2 = controlPoints[3 * c + 2];
+            const glm::vec3& p3 = controlPoints[3 * c + 3];
+
+            // Power basis: B(t) = a t^3 + b t^2 + k t + p0.
+            const glm::vec3 a = -p0 + 3.0f * p1 - 3.0f * p2 + p3;
+            const glm::vec3 b = 3.0f * p0 - 6.0f * p1 + 3.0f * p2;
+            const glm::vec3 k = -3.0f * p0 + 3.0f * p1;
+
+            glm::vec3 point = p0;
+            glm::vec3 d1 = a * (h * h * h) + b * (h * h) + k * h;
+            glm::vec3 d2 = a * (6.0f * h * h * h) + b * (2.0f * h * h);
+            const glm::vec3 d3 = a * (6.0f * h * h * h);
+
+            // Shared anchors are emitted once.
+            if (c == 0) lineVertices.push_back(point);
+            for (int j = 1; j < segmentsPerCurve - 1; ++j) {
+                point += d1;
+                d1 += d2;
+                d2 += d3;
+                lineVertices.push_back(point);
+            }
+            lineVertices.push_back(p3); // exact end point, free of accumulated error
+        }
+        return lineVertices;
+    }
+
+    // Evaluates a user-defined parametric function on the CPU.
+    std::vector<glm::vec3> parametric(const std::function<glm::vec3(float)>& func, int numSegments) {
+        std::vector<glm::vec3> lineVertices;
+        if (!func) { // Ensure the function object is valid.
+            return lineVertices;
+        }
+        lineVertices.reserve(numSegments);
+        for (int i = 0; i < numSegments; ++i) {
+            float t = static_cast<float>(i) / (numSegments - 1); // Parameter t from 0 to 1.
+            lineVertices.push_back(func(t)); // Evaluate the function at t.
+        }
+        return lineVertices;
+    }
+
+    namespace
+    {
+        // Below this squared length a segment or a tangent change is treated as none.
+        constexpr float kDegenerate = 1e-12f;
+
+        glm::vec3 anyPerpendicular(const glm::vec3& t)
+        {
+            const glm::vec3 axis = std::abs(t.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            return glm::normalize(axis - glm::dot(axis, t) * t);
+        }
+
+        ArcSample interpolate(const ArcLengthTable& table, const std::vector<glm::vec3>& vertices, std::size_t i, float s)
+        {
+            const float span = table.distance[i + 1] - table.distance[i];
+            const float f = span > 0.0f ? std::clamp((s - table.distance[i]) / span, 0.0f, 1.0f) : 0.0f;
+            ArcSample out;
+            out.position = vertices[i] + f * (vertices[i + 1] - vertices[i]);
+            glm::vec3 tangent = table.tangent[i] + f * (table.tangent[i + 1] - table.tangent[i]);
+            const float tangentLength2 = glm::dot(tangent, tangent);
+            out.tangent = tangentLength2 > kDegenerate ? tangent / std::sqrt(tangentLength2) : table.tangent[i];
+            // Lerped, then made perpendicular again: frames a segment apart
+            // differ by a small rotation, so this stays close to slerp.
+            glm::vec3 normal = table.normal[i] + f * (table.normal[i + 1] - table.normal[i]);
+            normal -= glm::dot(normal, out.tangent) * out.tangent;
+            const float normalLength2 = glm::dot(normal, normal);
+            out.normal = normalLength2 > kDegenerate ? normal / std::sqrt(normalLength2) : anyPerpendicular(out.tangent);
+            out.parameter = (float(i) + f) / float(vertices.size() - 1);
+            return out;
+        }
+    }
+
+    std::size_t ArcLengthTable::segmentAt(float s) const
+    {
+        if (distance.size() < 2) return 0;
+        const std::size_t k = std::size_t(std::upper_bound(distance.begin(), distance.end(), s) - distance.begin());
+        return std::min(k > 0 ? k - 1 : 0, distance.size() - 2);
+    }
+
+    float ArcLengthTable::parameterAt(float s) const
+    {
+        if (distance.size() < 2) return 0.0f;
+        const std::size_t i = segmentAt(s);
+        const float span = distance[i + 1] - distance[i];
+        const float f = span > 0.0f ? std::clamp((s - distance[i]) / span, 0.0f, 1.0f) : 0.0f;
+        return (float(i) + f) / float(distance.size() - 1);
+    }
+
+    // Frames by the double reflection method (Wang et al., "Computation of
+    // rotation minimizing frames", 2008): each normal is the previous one
+    // reflected across the segment's bisector plane, then across the plane
+    // between the reflected and the actual tangent.
+    ArcLengthTable arcLength(const std::vector<glm::vec3>& vertices)
+    {
+        ArcLengthTable table;
+        const std::size_t n = vertices.size();
+        if (n == 0) return table;
+        table.distance.resize(n);
+        table.tangent.resize(n);
+        table.normal.resize(n);
+
+        table.distance[0] = 0.0f;
+        for (std::size_t i = 1; i < n; ++i)
+            table.distance[i] = table.distance[i - 1] + glm::length(vertices[i] - vertices[i - 1]);
+
+        // Central differences; a repeated vertex keeps the tangent before it.
+        glm::vec3 previous(0.0f, 0.0f, 1.0f);
+        for (std::size_t i = 0; i < n; ++i) {
+            const glm::vec3 d = vertices[std::min(i + 1, n - 1)] - vertices[i > 0 ? i - 1 : 0];
+            const float length2 = glm::dot(d, d);
+            table.tangent[i] = previous = length2 > kDegenerate ? d / std::sqrt(length2) : previous;
+        }
+
+        table.normal[0] = anyPerpendicular(table.tangent[0]);
+        for (std::size_t i = 0; i + 1 < n; ++i) {
+            glm::vec3 r = table.normal[i];
+            const glm::vec3 v1 = vertices[i + 1] - vertices[i];
+            const float c1 = glm::dot(v1, v1);
+            if (c1 > kDegenerate) {
+                r -= (2.0f / c1) * glm::dot(v1, r) * v1;
+                const glm::vec3 t = table.tangent[i] - (2.0f / c1) * glm::dot(v1, table.tangent[i]) * v1;
+                const glm::vec3 v2 = table.tangent[i + 1] - t;
+                const float c2 = glm::dot(v2, v2);
+                if (c2 > kDegenerate) r -= (2.0f / c2) * glm::dot(v2, r) * v2;
+            }
+            // Re-orthonormalised so float error cannot build up along long paths.
+            const glm::vec3& tangent = table.tangent[i + 1];
+            r -= glm::dot(r, tangent) * tangent;
+            const float length2 = glm::dot(r, r);
+            table.normal[i + 1] = length2 > kDegenerate ? r / std::sqrt(length2) : anyPerpendicular(tangent);
+        }
+        return table;
+    }
+
+    ArcSample sampleAt(const ArcLengthTable& table, const std::vector<glm::vec3>& vertices, float s)
+    {
+        if (vertices.empty() || table.distance.size() != vertices.size()) return {};
+        if (vertices.size() == 1) {
+            ArcSample out;
+            out.position = vertices[0];
+            out.tangent = table.tangent[0];
+            out.normal = table.normal[0];
+            return out;
+        }
+        s = std::clamp(s, 0.0f, table.length());
+        return interpolate(table, vertices, table.segmentAt(s), s);
+    }
+
+    void sampleBatch(const ArcLengthTable& table, const std::vector<glm::vec3>& vertices,
+        const float* distances, std::size_t count, ArcSample* out)
+    {
+        if (vertices.size() < 2 || table.distance.size() != vertices.size()) {
+            for (std::size_t k = 0; k < count; ++k) out[k] = sampleAt(table, vertices, distances[k]);
+            return;
+        }
+        // Past this many segments ahead a search is cheaper than walking.
+        constexpr std::size_t kWalk = 8;
+        const std::size_t last = vertices.size() - 2;
+        const float length = table.length();
+        std::size_t i = 0;
+        for (std::size_t k = 0; k < count; ++k) {
+            const float s = std::clamp(distances[k], 0.0f, length);
+            if (s < table.distance[i]) {
+                i = table.segmentAt(s);
+            }
+            else if (s > table.distance[i + 1]) {
+                std::size_t steps = 0;
+                while (i < last && s > table.distance[i + 1] && steps++ < kWalk) ++i;
+                if (s > table.distance[i + 1]) i = table.segmentAt(s);
+            }
+            out[k] = interpolate(table, vertices, i, s);
+        }
+    }
+}
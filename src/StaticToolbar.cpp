@@ -1,6 +1,9 @@
 #include "StaticToolbar.hpp"
 #include "ui_static_toolbar.h" // Include the header generated by uic
 
+#include <QMenu>
+#include <QToolButton>
+
 StaticToolbar::StaticToolbar(QWidget* parent) :
     QWidget(parent),
     ui(new Ui::toolbarContainer) // Instantiate the UI class
@@ -10,6 +13,74 @@ StaticToolbar::StaticToolbar(QWidget* parent) :
     // You can connect signals/slots for your toolbar buttons here if needed
     // For example:
     connect(ui->load_robot_button, &QToolButton::clicked, this, &StaticToolbar::loadRobotClicked); // after a line, explain what it does
+
+    // Collision checking runs while this is down; on by default.
+    ui->show_collisions_button->setCheckable(true);
+    ui->show_collisions_button->setChecked(true);
+    connect(ui->show_collisions_button, &QToolButton::toggled, this, &StaticToolbar::showCollisionsToggled);
+
+    // A triad at every link frame and sensor mount while this is down.
+    ui->show_frames_button->setCheckable(true);
+    connect(ui->show_frames_button, &QToolButton::toggled, this, &StaticToolbar::showFramesToggled);
+
+    // Every joint labelled with its name while this is down.
+    ui->annotation_button->setCheckable(true);
+    connect(ui->annotation_button, &QToolButton::toggled, this, &StaticToolbar::annotationToggled);
+
+    connect(ui->find_replace_button, &QToolButton::clicked, this, &StaticToolbar::findReplaceClicked);
+    connect(ui->undo_button, &QToolButton::clicked, this, &StaticToolbar::undoClicked);
+    connect(ui->redo_button, &QToolButton::clicked, this, &StaticToolbar::redoClicked);
+    connect(ui->import_point_cloud_button, &QToolButton::clicked, this, &StaticToolbar::importPointCloudClicked);
+
+    // Streams the simulated LiDAR while this is down.
+    ui->show_lidar_point_cloud_button->setCheckable(true);
+    connect(ui->show_lidar_point_cloud_button, &QToolButton::toggled, this, &StaticToolbar::showLidarToggled);
+
+    // Fuses the running sensors into the scene's surface while this is down.
+    ui->live_scene_reconstruction_button->setCheckable(true);
+    connect(ui->live_scene_reconstruction_button, &QToolButton::toggled, this, &StaticToolbar::liveReconstructionToggled);
+
+    // Captures the CAN bus into the monitor panel while this is down.
+    ui->canbus_tools_button->setCheckable(true);
+    connect(ui->canbus_tools_button, &QToolButton::toggled, this, &StaticToolbar::canBusToggled);
+
+    // Shows the application's event log while this is down.
+    ui->fault_log_viewer_button->setCheckable(true);
+    connect(ui->fault_log_viewer_button, &QToolButton::toggled, this, &StaticToolbar::eventLogToggled);
+
+    // Serves the main viewport to web browsers while this is down.
+    ui->network_devices_button->setCheckable(true);
+    ui->network_devices_button->setToolTip("Stream the main viewport to web browsers on the network");
+    connect(ui->network_devices_button, &QToolButton::toggled, this, &StaticToolbar::remoteViewToggled);
+
+    // Publishes this scene to, or mirrors it from, other workstations while this is down.
+    ui->digital_twin_sync_mode_button->setCheckable(true);
+    connect(ui->digital_twin_sync_mode_button, &QToolButton::toggled, this, &StaticToolbar::twinSyncToggled);
+
+    connect(ui->add_laser_gate_button, &QToolButton::clicked, this, &StaticToolbar::addLaserGateClicked);
+
+    // On press, not release: the stop should not wait for the mouse button to come up.
+    connect(ui->estop_button, &QToolButton::pressed, this, &StaticToolbar::emergencyStopPressed);
+
+    ui->export_button->setToolTip("Export the scene as binary glTF (.glb)");
+    connect(ui->export_button, &QToolButton::clicked, this, &StaticToolbar::exportClicked);
+
+    // Settings that change how the viewports draw; the menu opens on press.
+    auto* viewButton = new QToolButton(this);
+    viewButton->setText("View");
+    viewButton->setToolTip("Display and renderer settings");
+    viewButton->setSizePolicy(ui->export_button->sizePolicy());
+    viewButton->setToolButtonStyle(Qt::ToolButtonTextUnderIcon);
+    viewButton->setPopupMode(QToolButton::InstantPopup);
+    m_viewMenu = new QMenu(viewButton);
+    viewButton->setMenu(m_viewMenu);
+    ui->horizontalLayout_14->addWidget(viewButton);
+}
+
+void StaticToolbar::setTwinSyncChecked(bool checked)
+{
+    const QSignalBlocker blocker(ui->digital_twin_sync_mode_button);
+    ui->digital_twin_sync_mode_button->setChecked(checked);
 }
 
 StaticToolbar::~StaticToolbar()
@@ -0,0 +1,115 @@
+#include "SystemScheduler.hpp"
+#include "AllocationCounter.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
+#include "TraceZones.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
+struct SystemScheduler::WaveSync
+{
+    entt::registry* registry;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t outstanding = 0;
+};
+
+namespace
+{
+    bool intersects(const std::vector<entt::id_type>& a, const std::vector<entt::id_type>& b)
+    {
+        for (auto id : a)
+            if (std::find(b.begin(), b.end(), id) != b.end()) return true;
+        return false;
+    }
+}
+
+bool SystemScheduler::conflicts(const Access& a, const Access& b)
+{
+    if (a.m_exclusive || b.m_exclusive) return true;
+    return intersects(a.m_writes, b.m_writes) || intersects(a.m_writes, b.m_reads) || intersects(a.m_reads, b.m_writes);
+}
+
+void SystemScheduler::add(std::string name, Access access, Fn fn)
+{
+    // One wave after the latest earlier system it conflicts with.
+    std::size_t wave = 0;
+    for (const System& earlier : m_systems)
+        if (earlier.wave + 1 > wave && conflicts(earlier.access, access)) wave = earlier.wave + 1;
+
+    if (m_waves.size() <= wave) m_waves.resize(wave + 1);
+    m_waves[wave].push_back(m_systems.size());
+    KR_TRACE(Frame) << "[Scheduler]" << QString::fromStdString(name) << "-> wave" << wave;
+    const char* zoneName = TraceZones::intern(name);
+    m_systems.push_back({ std::move(name), std::move(access), std::move(fn), wave, 0.0, zoneName });
+}
+
+bool SystemScheduler::run(entt::registry& registry)
+{
+    // Storage creation changes the registry's pool map; never do it concurrently.
+    for (const System& system : m_systems)
+        for (auto assure : system.access.m_assure) assure(registry);
+
+    for (const auto& wave : m_waves) {
+        if (wave.size() == 1) {
+            runSystem(m_systems[wave.front()], registry);
+            continue;
+        }
+
+        // Pool systems go out first so they overlap with the main-thread ones.
+        // The task captures two pointers, small enough for std::function to
+        // hold without a heap allocation.
+        WaveSync sync{ &registry };
+        sync.outstanding = std::count_if(wave.begin(), wave.end(),
+            [&](std::size_t index) { return !m_systems[index].access.m_mainThread; });
+        for (std::size_t index : wave) {
+            System& system = m_systems[index];
+            if (system.access.m_mainThread) continue;
+            ThreadPool::shared().submit([s = &sync, sys = &system] {
+                runSystem(*sys, *s->registry);
+                std::lock_guard<std::mutex> lock(s->mutex);
+                --s->outstanding;
+                s->cv.notify_one();
+            });
+        }
+        for (std::size_t index : wave)
+            if (m_systems[index].access.m_mainThread) runSystem(m_systems[index], registry);
+
+        KR_ZONE("wait for wave");
+        std::unique_lock<std::mutex> lock(sync.mutex);
+        sync.cv.wait(lock, [&] { return sync.outstanding == 0; });
+    }
+
+    bool changed = false;
+    for (const System& system : m_systems) changed |= system.lastChanged;
+
+#if KR_COUNT_ALLOCATIONS
+    // A system that changed nothing is in steady state and should run on
+    // member and FrameArena scratch alone. Reported once per system.
+    if (++m_ticks > kAllocationWarmupTicks) {
+        for (System& system : m_systems) {
+            if (system.lastChanged || system.lastAllocations == 0 || system.allocationReported) continue;
+            system.allocationReported = true;
+            qWarning() << "[Scheduler]" << QString::fromStdString(system.name) << "made"
+                       << system.lastAllocations << "heap allocations in a tick where it changed nothing";
+        }
+    }
+#endif
+    return changed;
+}
+
+void SystemScheduler::runSystem(System& system, entt::registry& registry)
+{
+    KR_ZONE(system.zoneName);
+    const auto start = std::chrono::steady_clock::now();
+    const std::uint64_t allocations = AllocationCounter::threadCount();
+    system.lastChanged = system.fn(registry);
+    system.lastAllocations = AllocationCounter::threadCount() - allocations;
+    system.lastMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
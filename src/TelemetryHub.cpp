@@ -0,0 +1,191 @@
+#include "TelemetryHub.hpp"
+#include "components.hpp"
+#include "SessionLog.hpp"
+#include "JointStateBuffer.hpp"
+#include "KinematicModel.hpp"
+#include "TraceZones.hpp"
+
+#include <QDebug>
+#include <entt/entt.hpp>
+#include <algorithm>
+
+namespace {
+constexpr std::chrono::milliseconds kReadTimeout{ 20 };
+
+const char* protocolName(CommunicationProtocol protocol)
+{
+    switch (protocol) {
+    case CommunicationProtocol::SERIAL_CUSTOM: return "serial";
+    case CommunicationProtocol::CANOPEN:       return "CANopen";
+    case CommunicationProtocol::ETHERCAT:      return "EtherCAT";
+    default:                                   return "none";
+    }
+}
+
+const char* quantityName(JointSample::Quantity quantity)
+{
+    switch (quantity) {
+    case JointSample::Quantity::Velocity: return "velocity";
+    case JointSample::Quantity::Effort:   return "effort";
+    case JointSample::Quantity::Sensor:   return "sensor";
+    default:                              return "position";
+    }
+}
+}
+
+std::int64_t TelemetryHub::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TelemetryHub::registerReader(CommunicationProtocol protocol, ReaderFactory factory)
+{
+    m_factories[protocol] = std::move(factory);
+}
+
+std::size_t TelemetryHub::bind(entt::registry& registry)
+{
+    return bindStreams(registry, nullptr);
+}
+
+std::size_t TelemetryHub::bindAll(entt::registry& registry, const ReaderFactory& factory)
+{
+    return bindStreams(registry, &factory);
+}
+
+void TelemetryHub::setRecorder(SessionRecorder* recorder)
+{
+    m_recorder = recorder;
+    for (auto& stream : m_streams)
+        stream->recordChannel.assign(stream->endpoints.size() * JointSample::kQuantityCount, -1);
+}
+
+std::size_t TelemetryHub::bindStreams(entt::registry& registry, const ReaderFactory* shared)
+{
+    stop();
+
+    // Moving joints only, robot by robot; with a shared factory every joint
+    // lands in the NONE bucket.
+    std::unordered_map<CommunicationProtocol, std::unique_ptr<Stream>> byProtocol;
+    for (auto [root, kin, state] : registry.view<KinematicModelComponent, JointStateComponent>().each()) {
+        if (!kin.model || !state.buffer) continue;
+        for (int dof = 0; dof < kin.model->dofCount(); ++dof) {
+            const entt::entity entity = kin.links[kin.model->dofLink(dof)];
+            const auto* joint = registry.try_get<JointComponent>(entity);
+            if (!joint) continue;
+            const HardwareInterface& hw = joint->description.interface;
+            CommunicationProtocol protocol = CommunicationProtocol::NONE;
+            if (!shared) {
+                if (hw.protocol == CommunicationProtocol::NONE) continue;
+                if (m_factories.find(hw.protocol) == m_factories.end()) continue;
+                protocol = hw.protocol;
+            }
+
+            auto& stream = byProtocol[protocol];
+            if (!stream) {
+                stream = std::make_unique<Stream>();
+                stream->protocol = protocol;
+            }
+            stream->endpoints.push_back({ hw.controller_id, hw.feedback_topic_name, joint->description.name, entity });
+            stream->targets.push_back({ state.buffer, dof });
+        }
+    }
+
+    std::size_t bound = 0;
+    for (auto& [protocol, stream] : byProtocol) {
+        stream->reader = shared ? (*shared)() : m_factories[protocol]();
+        if (!stream->reader || !stream->reader->open(stream->endpoints)) {
+            qWarning() << "[TelemetryHub] could not open the" << protocolName(protocol) << "reader";
+            continue;
+        }
+        stream->lastApplied.assign(stream->endpoints.size() * JointSample::kQuantityCount, 0);
+        stream->recordChannel.assign(stream->endpoints.size() * JointSample::kQuantityCount, -1);
+        stream->running.store(true, std::memory_order_relaxed);
+        stream->thread = std::thread(&TelemetryHub::run, std::ref(*stream));
+        qDebug() << "[TelemetryHub]" << protocolName(protocol) << "reader bound to"
+                 << int(stream->endpoints.size()) << "joints";
+        bound += stream->endpoints.size();
+        m_streams.push_back(std::move(stream));
+    }
+    return bound;
+}
+
+void TelemetryHub::stop()
+{
+    for (auto& stream : m_streams)
+        stream->running.store(false, std::memory_order_relaxed);
+    for (auto& stream : m_streams) {
+        if (stream->thread.joinable()) stream->thread.join();
+        stream->reader->close();
+    }
+    m_streams.clear();
+}
+
+void TelemetryHub::run(Stream& stream)
+{
+    TraceZones::setThreadName(std::string("telemetry ") + protocolName(stream.protocol));
+    JointSample batch[kReadBatch];
+    while (stream.running.load(std::memory_order_relaxed)) {
+        std::size_t n = 0;
+        {
+            KR_ZONE("telemetry read");   // blocks on the device
+            n = stream.reader->read(batch, kReadBatch, kReadTimeout);
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            if (batch[i].channel >= stream.endpoints.size()) continue;
+            if (!stream.ring.push(batch[i]))
+                stream.dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+std::size_t TelemetryHub::drain()
+{
+    KR_ZONE("telemetry drain");
+    std::size_t changed = 0;
+    JointSample sample;
+    for (auto& stream : m_streams) {
+        // Keep only the newest reading per channel; older ones are superseded.
+        std::int64_t newest = 0;
+        while (stream->ring.pop(sample)) {
+            if (m_recorder) record(*stream, sample);
+            if (sample.quantity == JointSample::Quantity::Sensor) continue;
+
+            std::int64_t& last = stream->lastApplied[sample.channel * JointSample::kQuantityCount + int(sample.quantity)];
+            if (sample.timestampNs < last) continue;
+            last = sample.timestampNs;
+            newest = std::max(newest, sample.timestampNs);
+
+            const Stream::Target& target = stream->targets[sample.channel];
+            JointStateBuffer& state = *target.buffer;
+            if (sample.quantity == JointSample::Quantity::Velocity) {
+                state.velocity()[target.dof] = sample.value;
+            }
+            else if (sample.quantity == JointSample::Quantity::Effort) {
+                state.effort()[target.dof] = sample.value;
+            }
+            else if (state.position()[target.dof] != sample.value) {
+                state.position()[target.dof] = sample.value;
+                ++changed;
+            }
+        }
+        m_latestNs = std::max(m_latestNs, newest);
+    }
+    return changed;
+}
+
+void TelemetryHub::record(Stream& stream, const JointSample& sample)
+{
+    int& channel = stream.recordChannel[sample.channel * JointSample::kQuantityCount + int(sample.quantity)];
+    if (channel < 0)
+        channel = m_recorder->channel(stream.endpoints[sample.channel].jointName + "/" + quantityName(sample.quantity));
+    m_recorder->append(channel, sample.timestampNs, sample.value);
+}
+
+std::uint64_t TelemetryHub::droppedSamples() const
+{
+    std::uint64_t dropped = 0;
+    for (const auto& stream : m_streams) dropped += stream->dropped.load(std::memory_order_relaxed);
+    return dropped;
+}
@@ -0,0 +1,380 @@
+#include "TextureStreamer.hpp"
+#include "GpuMemory.hpp"
+#include "RenderStats.hpp"
+#include "ThreadPool.hpp"
+
+#include <QOpenGLFunctions_4_3_Core>
+#include <QFile>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace {
+constexpr GLsizei kInitialLayers = 4;
+
+// Vulkan formats KTX2 names its payload by; only these need no transcoding.
+constexpr std::uint32_t kVkR8G8B8A8Unorm = 37;
+constexpr std::uint32_t kVkR8G8B8A8Srgb = 43;
+
+template<class T>
+T readAt(const QByteArray& bytes, qsizetype offset)
+{
+    T value{};
+    std::memcpy(&value, bytes.constData() + offset, sizeof(T));
+    return value;
+}
+
+// 'image' resized to size x size, then halved down to 1x1.
+std::vector<QImage> chainFrom(QImage image, GLsizei size)
+{
+    std::vector<QImage> chain;
+    image = image.convertToFormat(QImage::Format_RGBA8888);
+    if (image.width() != size || image.height() != size)
+        image = image.scaled(size, size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    chain.push_back(image);
+    for (GLsizei s = size / 2; s >= 1; s /= 2)
+        chain.push_back(chain.back().scaled(s, s, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+    return chain;
+}
+
+// KTX2 with uncompressed RGBA8 levels: the stored levels from the one that
+// matches 'size' on, the rest made from the finest one there is. Levels are
+// top row first, as QImage's are.
+bool readKtx2(const QByteArray& file, GLsizei size, std::vector<QImage>& chain, QString& error)
+{
+    static const unsigned char kIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    constexpr qsizetype kLevelIndex = 80;
+    if (file.size() < kLevelIndex || std::memcmp(file.constData(), kIdentifier, sizeof(kIdentifier)) != 0) {
+        error = QStringLiteral("not a KTX2 file");
+        return false;
+    }
+    const auto vkFormat = readAt<std::uint32_t>(file, 12);
+    const auto width = readAt<std::uint32_t>(file, 20);
+    const auto height = readAt<std::uint32_t>(file, 24);
+    const auto depth = readAt<std::uint32_t>(file, 28);
+    const auto layerCount = readAt<std::uint32_t>(file, 32);
+    const auto faceCount = readAt<std::uint32_t>(file, 36);
+    const auto levelCount = std::max<std::uint32_t>(readAt<std::uint32_t>(file, 40), 1);
+    const auto supercompression = readAt<std::uint32_t>(file, 44);
+    if (supercompression != 0 || (vkFormat != kVkR8G8B8A8Unorm && vkFormat != kVkR8G8B8A8Srgb)) {
+        error = QStringLiteral("KTX2 format %1 (supercompression %2) needs a transcoder").arg(vkFormat).arg(supercompression);
+        return false;
+    }
+    // Level i is width >> i wide, so more than 32 levels cannot be.
+    if (width == 0 || height == 0 || depth > 1 || layerCount > 1 || faceCount != 1 || levelCount > 32
+        || file.size() < kLevelIndex + qsizetype(levelCount) * 24) {
+        error = QStringLiteral("unsupported KTX2 layout");
+        return false;
+    }
+
+    std::vector<QImage> levels;
+    for (std::uint32_t i = 0; i < levelCount; ++i) {
+        const auto offset = readAt<std::uint64_t>(file, kLevelIndex + qsizetype(i) * 24);
+        const auto length = readAt<std::uint64_t>(file, kLevelIndex + qsizetype(i) * 24 + 8);
+        const std::uint64_t w = std::max<std::uint32_t>(width >> i, 1), h = std::max<std::uint32_t>(height >> i, 1);
+        const std::uint64_t bytes = std::uint64_t(file.size());
+        if (length != w * h * 4 || offset > bytes || length > bytes - offset) {
+            error = QStringLiteral("truncated KTX2 level %1").arg(i);
+            return false;
+        }
+        const auto* texels = reinterpret_cast<const uchar*>(file.constData() + offset);
+        levels.push_back(QImage(texels, int(w), int(h), int(w * 4), QImage::Format_RGBA8888).copy());
+    }
+
+    // Stored levels are used as they are where square and of the right size.
+    std::size_t first = 0;
+    while (first + 1 < levels.size() && levels[first].width() > size) ++first;
+    if (levels[first].width() != size || levels[first].height() != size) {
+        chain = chainFrom(levels[first], size);
+        return true;
+    }
+    for (std::size_t i = first; i < levels.size() && levels[i].width() == levels[i].height(); ++i)
+        chain.push_back(levels[i]);
+    for (GLsizei s = chain.back().width() / 2; s >= 1; s /= 2)
+        chain.push_back(chain.back().scaled(s, s, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+    return true;
+}
+}
+
+TextureStreamer::TextureStreamer(QOpenGLFunctions_4_3_Core* gl)
+    : m_gl(gl), m_inbox(std::make_shared<Inbox>())
+{
+}
+
+int TextureStreamer::levels() const
+{
+    int count = 1;
+    for (GLsizei s = m_layerSize; s > 1; s /= 2) ++count;
+    return count;
+}
+
+int TextureStreamer::levelFor(float pixels) const
+{
+    if (!(pixels > 1.0f)) return levels() - 1;
+    const int level = int(std::floor(std::log2(float(m_layerSize) / pixels)));
+    return std::clamp(level, 0, levels() - 1);
+}
+
+TextureStreamer::Residency TextureStreamer::residency(Kind kind, const std::string& path)
+{
+    LayerArray& array = m_arrays[std::size_t(kind)];
+    auto [it, inserted] = array.maps.try_emplace(path);
+    Map& map = it->second;
+    if (inserted) {
+        map.wanted = levels() - 1;
+        map.decoding = true;
+        m_queued.emplace_back(kind, path);
+        startDecodes();
+    }
+    if (map.layer < 0 || map.resident < 0) return {};
+    return { map.layer, float(map.resident) };
+}
+
+void TextureStreamer::request(Kind kind, const std::string& path, float pixels)
+{
+    LayerArray& array = m_arrays[std::size_t(kind)];
+    const auto it = array.maps.find(path);
+    if (it != array.maps.end()) it->second.wanted = std::min(it->second.wanted, levelFor(pixels));
+}
+
+void TextureStreamer::startDecodes()
+{
+    while (m_decoding < kMaxDecodes && !m_queued.empty()) {
+        auto [kind, path] = std::move(m_queued.front());
+        m_queued.pop_front();
+        ++m_decoding;
+        ThreadPool::shared().submit([inbox = m_inbox, kind, path, size = m_layerSize] {
+            Decoded decoded{ kind, path, {} };
+            QString error;
+            QFile file(QString::fromStdString(path));
+            if (!file.open(QIODevice::ReadOnly)) {
+                error = file.errorString();
+            }
+            else {
+                const QByteArray bytes = file.readAll();
+                if (bytes.startsWith("\xABKTX 20")) {
+                    readKtx2(bytes, size, decoded.chain, error);
+                }
+                else {
+                    QImage image;
+                    if (image.loadFromData(bytes)) decoded.chain = chainFrom(image, size);
+                    else error = QStringLiteral("unreadable image");
+                }
+            }
+            // GL samples the bottom row first.
+            for (QImage& level : decoded.chain) level = level.mirrored();
+            if (decoded.chain.empty())
+                qWarning() << "TextureStreamer: cannot load" << QString::fromStdString(path) << "-" << error;
+
+            std::lock_guard<std::mutex> lock(inbox->mutex);
+            inbox->done.push_back(std::move(decoded));
+        });
+    }
+}
+
+bool TextureStreamer::update()
+{
+    bool changed = std::exchange(m_changed, false);
+
+    // --- 1. Finished decodes get a layer; nothing is uploaded to it yet ---
+    std::vector<Decoded> done;
+    {
+        std::lock_guard<std::mutex> lock(m_inbox->mutex);
+        done.swap(m_inbox->done);
+    }
+    for (Decoded& decoded : done) {
+        --m_decoding;
+        LayerArray& array = m_arrays[std::size_t(decoded.kind)];
+        const auto it = array.maps.find(decoded.path);
+        if (it == array.maps.end()) continue;
+        Map& map = it->second;
+        map.decoding = false;
+        if (decoded.chain.empty()) {
+            map.failed = true;
+            continue;
+        }
+        map.chain = std::move(decoded.chain);
+        if (array.count == array.capacity) grow(decoded.kind);
+        map.layer = array.count++;
+    }
+    startDecodes();
+
+    // --- 2. Next level of every map short of its request, coarsest first ---
+    struct Upload { Kind kind; Map* map; int level; const QImage* image; };
+    std::vector<Upload> uploads;
+    const int levelCount = levels();
+    for (std::size_t k = 0; k < std::size_t(Kind::Count); ++k) {
+        for (auto& [path, map] : m_arrays[k].maps) {
+            if (map.layer < 0 || map.chain.empty()) continue;
+            const int next = map.resident < 0 ? levelCount - 1 : map.resident - 1;
+            if (next < map.wanted || next < 0) continue;
+            // The chain may be from before a trim(): skip its finer sizes.
+            const std::size_t skip = std::size_t(std::log2(float(map.chain.front().width()) / float(m_layerSize)) + 0.5f);
+            if (skip + std::size_t(next) >= map.chain.size()) continue;
+            uploads.push_back({ Kind(k), &map, next, &map.chain[skip + std::size_t(next)] });
+        }
+    }
+    if (uploads.empty()) return changed;
+    std::stable_sort(uploads.begin(), uploads.end(), [](const Upload& a, const Upload& b) { return a.level > b.level; });
+
+    // --- 3. Packed into the next PBO of the ring, then copied into the arrays ---
+    GLuint& pbo = m_pbos[m_nextPbo];
+    m_nextPbo = (m_nextPbo + 1) % kPboCount;
+    if (pbo == 0) {
+        m_gl->glGenBuffers(1, &pbo);
+        m_gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        GpuMemory::bufferData(m_gl, GL_PIXEL_UNPACK_BUFFER, pbo, GLsizeiptr(kUploadBytesPerFrame), nullptr, GL_STREAM_DRAW,
+            GpuMemory::Category::Materials);
+    }
+    m_gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    auto* staging = static_cast<unsigned char*>(m_gl->glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+        GLsizeiptr(kUploadBytesPerFrame), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (!staging) {
+        m_gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return changed;
+    }
+
+    std::size_t used = 0, count = 0;
+    std::vector<std::size_t> offsets;
+    for (const Upload& upload : uploads) {
+        const std::size_t bytes = std::size_t(upload.image->sizeInBytes());
+        if (used + bytes > kUploadBytesPerFrame) break;
+        std::memcpy(staging + used, upload.image->constBits(), bytes);
+        offsets.push_back(used);
+        used += bytes;
+        ++count;
+    }
+    m_gl->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    m_gl->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (std::size_t i = 0; i < count; ++i) {
+        const Upload& upload = uploads[i];
+        const GLsizei s = upload.image->width();
+        m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrays[std::size_t(upload.kind)].texture);
+        m_gl->glTexSubImage3D(GL_TEXTURE_2D_ARRAY, upload.level, 0, 0, upload.map->layer, s, s, 1,
+            GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(offsets[i]));
+        upload.map->resident = upload.level;
+        if (upload.level == 0) upload.map->chain.clear();   // all of it is up
+    }
+    m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    m_gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    RenderStats::upload(std::uint64_t(used));
+    return changed || count > 0;
+}
+
+bool TextureStreamer::busy() const
+{
+    if (m_decoding > 0 || !m_queued.empty()) return true;
+    for (const LayerArray& array : m_arrays)
+        for (const auto& [path, map] : array.maps)
+            if (!map.chain.empty() && (map.resident < 0 || map.resident > map.wanted)) return true;
+    return false;
+}
+
+std::size_t TextureStreamer::arrayBytes(GLsizei layerSize, GLsizei layers) const
+{
+    std::size_t bytes = 0;
+    for (GLsizei s = layerSize; s >= 1; s /= 2) bytes += std::size_t(s) * std::size_t(s) * 4;
+    return bytes * std::size_t(layers);
+}
+
+void TextureStreamer::grow(Kind kind)
+{
+    LayerArray& array = m_arrays[std::size_t(kind)];
+    const GLsizei capacity = std::max(kInitialLayers, array.capacity * 2);
+    const int levelCount = levels();
+    GLuint texture = 0;
+    m_gl->glGenTextures(1, &texture);
+    m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    m_gl->glTexStorage3D(GL_TEXTURE_2D_ARRAY, levelCount, kind == Kind::Color ? GL_SRGB8_ALPHA8 : GL_RGBA8,
+        m_layerSize, m_layerSize, capacity);
+    m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    GpuMemory::trackTexture(texture, arrayBytes(m_layerSize, capacity), GpuMemory::Category::Materials);
+
+    if (array.texture != 0) {
+        for (int level = 0; level < levelCount && array.count > 0; ++level) {
+            const GLsizei s = m_layerSize >> level;
+            m_gl->glCopyImageSubData(array.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, s, s, array.count);
+        }
+        GpuMemory::deleteTextures(m_gl, 1, &array.texture);
+    }
+    array.texture = texture;
+    array.capacity = capacity;
+}
+
+std::size_t TextureStreamer::shrink()
+{
+    if (m_layerSize <= kMinLayerSize) return 0;
+    const GLsizei size = m_layerSize / 2;
+    const int levelCount = levels() - 1;
+    std::size_t freed = 0;
+
+    for (std::size_t k = 0; k < std::size_t(Kind::Count); ++k) {
+        LayerArray& array = m_arrays[k];
+        for (auto& [path, map] : array.maps) {
+            if (map.resident >= 0) map.resident = std::max(map.resident - 1, 0);
+            map.wanted = std::max(map.wanted - 1, 0);
+        }
+        if (array.texture == 0) continue;
+
+        GLuint texture = 0;
+        m_gl->glGenTextures(1, &texture);
+        m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        m_gl->glTexStorage3D(GL_TEXTURE_2D_ARRAY, levelCount, Kind(k) == Kind::Color ? GL_SRGB8_ALPHA8 : GL_RGBA8,
+            size, size, array.capacity);
+        m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        GpuMemory::trackTexture(texture, arrayBytes(size, array.capacity), GpuMemory::Category::Materials);
+        for (int level = 0; level < levelCount && array.count > 0; ++level) {
+            const GLsizei s = size >> level;
+            m_gl->glCopyImageSubData(array.texture, GL_TEXTURE_2D_ARRAY, level + 1, 0, 0, 0,
+                texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, s, s, array.count);
+        }
+        GpuMemory::deleteTextures(m_gl, 1, &array.texture);
+        array.texture = texture;
+        freed += arrayBytes(m_layerSize, array.capacity) - arrayBytes(size, array.capacity);
+    }
+    m_layerSize = size;
+    m_changed = true;
+    return freed;
+}
+
+std::size_t TextureStreamer::trim(std::size_t bytes)
+{
+    std::size_t freed = 0;
+    while (freed < bytes) {
+        const std::size_t step = shrink();
+        if (step == 0) break;
+        freed += step;
+    }
+    if (freed > 0) qDebug() << "TextureStreamer: material map layers now" << m_layerSize << "texels";
+    return freed;
+}
+
+void TextureStreamer::destroy()
+{
+    if (!m_gl) return;
+    for (LayerArray& array : m_arrays) {
+        if (array.texture != 0) GpuMemory::deleteTextures(m_gl, 1, &array.texture);
+        array = LayerArray{};
+    }
+    for (GLuint& pbo : m_pbos) {
+        if (pbo != 0) GpuMemory::deleteBuffers(m_gl, 1, &pbo);
+        pbo = 0;
+    }
+    m_queued.clear();
+    m_decoding = 0;
+    m_inbox = std::make_shared<Inbox>();   // late decodes land in the old one
+    m_layerSize = kLayerSize;
+    m_changed = false;
+}
@@ -0,0 +1,164 @@
+#include "ThreadPool.hpp"
+#include "TraceZones.hpp"
+
+#include <algorithm>
+
+namespace {
+// Pool and worker index of the current thread; t_pool is null outside any pool.
+thread_local const ThreadPool* t_pool = nullptr;
+thread_local unsigned t_workerIndex = 0;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    m_queues.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) m_queues.push_back(std::make_unique<Queue>());
+
+    m_workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i)
+        m_workers.emplace_back([this, i] { workerLoop(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    waitIdle();
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) worker.join();
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(Task task)
+{
+    const unsigned index = (t_pool == this)
+        ? t_workerIndex
+        : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % size();
+
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+    m_queued.fetch_add(1, std::memory_order_release);
+    // Taking the wake mutex orders the push against a worker about to sleep.
+    { std::lock_guard<std::mutex> lock(m_wakeMutex); }
+    m_wake.notify_one();
+}
+
+void ThreadPool::waitIdle()
+{
+    KR_ZONE("pool wait idle");
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_idle.wait(lock, [this] { return m_pending.load() == 0; });
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& body)
+{
+    if (count == 0) return;
+    if (count == 1) { body(0); return; }
+
+    // The loop is done when every index has run, not when every helper has:
+    // a helper still queued when the caller has claimed the last index finds
+    // nothing left and returns at once, whenever it runs. So the job is
+    // shared rather than on this stack, and 'body' is only reached through
+    // an index that was claimed before parallelFor returned.
+    struct Job {
+        const std::function<void(std::size_t)>& body;
+        std::size_t count;
+        std::atomic<std::size_t> next{ 0 };
+        std::atomic<std::size_t> completed{ 0 };
+        std::mutex doneMutex;
+        std::condition_variable doneCv;
+
+        Job(const std::function<void(std::size_t)>& b, std::size_t n) : body(b), count(n) {}
+
+        void drain()
+        {
+            std::size_t ran = 0;
+            for (std::size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1), ++ran) body(i);
+            if (ran && completed.fetch_add(ran, std::memory_order_acq_rel) + ran == count) {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                doneCv.notify_all();
+            }
+        }
+    };
+    const auto job = std::make_shared<Job>(body, count);
+
+    // One helper per worker at most; each pulls indices until none are left.
+    const std::size_t helpers = std::min<std::size_t>(size(), count - 1);
+    for (std::size_t h = 0; h < helpers; ++h) submit([job] { job->drain(); });
+
+    // The caller helps with this loop's indices only. Once they are all
+    // claimed it waits for the ones still running elsewhere, even on a pool
+    // worker: those are on threads that are running, so nothing it could
+    // pick up instead (an unrelated and possibly long task) is needed.
+    job->drain();
+    if (job->completed.load(std::memory_order_acquire) == count) return;
+    KR_ZONE("parallelFor wait");
+    std::unique_lock<std::mutex> lock(job->doneMutex);
+    job->doneCv.wait(lock, [&] { return job->completed.load(std::memory_order_acquire) == count; });
+}
+
+bool ThreadPool::tryPop(unsigned index, Task& out)
+{
+    Queue& q = *m_queues[index];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) return false;
+    out = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    m_queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ThreadPool::trySteal(unsigned thief, Task& out)
+{
+    const unsigned n = size();
+    for (unsigned k = 1; k < n; ++k) {
+        Queue& q = *m_queues[(thief + k) % n];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) continue;
+        out = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::runOne(unsigned index)
+{
+    Task task;
+    if (!tryPop(index, task) && !trySteal(index, task)) return false;
+
+    task();
+    if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_idle.notify_all();
+    }
+    return true;
+}
+
+void ThreadPool::workerLoop(unsigned index)
+{
+    t_pool = this;
+    t_workerIndex = index;
+    TraceZones::setThreadName("pool worker " + std::to_string(index));
+
+    for (;;) {
+        if (runOne(index)) continue;
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wake.wait(lock, [this] { return m_stopping || m_queued.load(std::memory_order_acquire) > 0; });
+        if (m_stopping && m_queued.load() == 0) return;
+    }
+}
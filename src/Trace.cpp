@@ -0,0 +1,43 @@
+#include "Trace.hpp"
+
+#include <QByteArrayList>
+#include <QtGlobal>
+
+std::uint32_t Trace::parseMask(const QByteArray& spec)
+{
+    struct Entry { const char* name; Category bit; };
+    static const Entry kNames[] = {
+        { "frame",     Frame },
+        { "mesh",      Mesh },
+        { "spline",    Spline },
+        { "fieldviz",  FieldViz },
+        { "glow",      Glow },
+        { "lifecycle", Lifecycle },
+        { "all",       All },
+    };
+
+    std::uint32_t mask = 0;
+    for (QByteArray token : spec.split(',')) {
+        token = token.trimmed().toLower();
+        if (token.isEmpty()) continue;
+
+        bool known = false;
+        for (const Entry& e : kNames) {
+            if (token == e.name) { mask |= e.bit; known = true; break; }
+        }
+        if (!known)
+            qWarning() << "[Trace] unknown category" << token;
+    }
+    return mask;
+}
+
+void Trace::initFromEnvironment()
+{
+    const QByteArray spec = qgetenv("KR_TRACE");
+    if (spec.isEmpty()) return;
+
+    setMask(parseMask(spec));
+#if !KR_TRACE_ENABLED
+    qWarning() << "[Trace] KR_TRACE is set but tracing was compiled out (KR_ENABLE_TRACE=OFF)";
+#endif
+}
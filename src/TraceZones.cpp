@@ -0,0 +1,159 @@
+#include "TraceZones.hpp"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QString>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t kEventsPerThread = std::size_t(1) << 18;   ///< 6 MiB, on a thread's first event
+    constexpr int kFirstTid = 100;                                  ///< below: RenderingSystem's viewport tracks
+
+    struct Event {
+        const char* name;
+        double beginUs;
+        double durUs;
+    };
+
+    // Written only by its thread; read by the collector up to 'count'.
+    struct ThreadBuffer {
+        std::unique_ptr<Event[]> events;
+        std::atomic<std::size_t> count{ 0 };
+        std::atomic<std::uint64_t> capture{ 0 };   ///< capture the events belong to
+        std::atomic<std::uint64_t> dropped{ 0 };
+        std::string name;                          ///< guarded by State::mutex
+        int tid = 0;
+    };
+
+    struct State {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;   ///< outlive their threads
+        std::set<std::string> names;
+        std::atomic<std::uint64_t> capture{ 0 };
+    };
+
+    State& state()
+    {
+        static State s;
+        return s;
+    }
+
+    ThreadBuffer& threadBuffer()
+    {
+        thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+            auto b = std::make_shared<ThreadBuffer>();
+            State& s = state();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            b->tid = kFirstTid + int(s.buffers.size());
+            b->name = "thread " + std::to_string(s.buffers.size());
+            s.buffers.push_back(b);
+            return b;
+        }();
+        return *buffer;
+    }
+}
+
+void TraceZones::start()
+{
+    state().capture.fetch_add(1, std::memory_order_relaxed);
+    capturingFlag().store(true, std::memory_order_relaxed);
+}
+
+void TraceZones::stop()
+{
+    capturingFlag().store(false, std::memory_order_relaxed);
+}
+
+double TraceZones::nowUs()
+{
+    using namespace std::chrono;
+    static const steady_clock::time_point epoch = steady_clock::now();
+    return duration<double, std::micro>(steady_clock::now() - epoch).count();
+}
+
+void TraceZones::setThreadName(const std::string& name)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(state().mutex);
+    buffer.name = name;
+}
+
+const char* TraceZones::intern(const std::string& name)
+{
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.names.insert(name).first->c_str();
+}
+
+void TraceZones::record(const char* name, double beginUs, double endUs)
+{
+    ThreadBuffer& buffer = threadBuffer();
+
+    // The first event of a new capture resets this thread's buffer.
+    const std::uint64_t capture = state().capture.load(std::memory_order_relaxed);
+    if (buffer.capture.load(std::memory_order_relaxed) != capture) {
+        if (!buffer.events) buffer.events = std::make_unique<Event[]>(kEventsPerThread);
+        buffer.count.store(0, std::memory_order_relaxed);
+        buffer.dropped.store(0, std::memory_order_relaxed);
+        buffer.capture.store(capture, std::memory_order_release);
+    }
+
+    const std::size_t index = buffer.count.load(std::memory_order_relaxed);
+    if (index == kEventsPerThread) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[index] = { name, beginUs, endUs - beginUs };
+    buffer.count.store(index + 1, std::memory_order_release);
+}
+
+void TraceZones::appendChromeEvents(QJsonArray& events)
+{
+    State& s = state();
+    const std::uint64_t capture = s.capture.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    for (const auto& buffer : s.buffers) {
+        if (buffer->capture.load(std::memory_order_acquire) != capture) continue;
+        const std::size_t count = buffer->count.load(std::memory_order_acquire);
+        if (count == 0) continue;
+
+        events.append(QJsonObject{ { "ph", "M" }, { "pid", 1 }, { "tid", buffer->tid },
+            { "name", "thread_name" }, { "args", QJsonObject{ { "name", QString::fromStdString(buffer->name) } } } });
+        for (std::size_t i = 0; i < count; ++i) {
+            const Event& e = buffer->events[i];
+            events.append(QJsonObject{ { "ph", "X" }, { "pid", 1 }, { "tid", buffer->tid }, { "cat", "zone" },
+                { "name", QString::fromUtf8(e.name) }, { "ts", e.beginUs }, { "dur", e.durUs } });
+        }
+    }
+}
+
+bool TraceZones::writeChromeTrace(const QString& path)
+{
+    QJsonArray events;
+    appendChromeEvents(events);
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(QJsonDocument(QJsonObject{ { "traceEvents", events }, { "displayTimeUnit", "ms" } }).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+std::uint64_t TraceZones::droppedEvents()
+{
+    State& s = state();
+    const std::uint64_t capture = s.capture.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    std::uint64_t dropped = 0;
+    for (const auto& buffer : s.buffers)
+        if (buffer->capture.load(std::memory_order_acquire) == capture)
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+    return dropped;
+}
@@ -0,0 +1,198 @@
+#include "TrajectoryTiming.hpp"
+#include "RigidBodyDynamics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    constexpr double kInfinity = std::numeric_limits<double>::infinity();
+    constexpr double kTolerance = 1e-9;
+
+    // alpha u + beta x <= gamma.
+    struct Constraint {
+        double alpha, beta, gamma;
+    };
+
+    // The interval of x for which some u satisfies every constraint, by
+    // eliminating u (Fourier-Motzkin): each lower bound on u must lie below
+    // each upper bound. Empty if lo > hi.
+    void feasibleX(const std::vector<Constraint>& constraints, double& lo, double& hi)
+    {
+        struct Line { double offset, slope; };   // u >= or <= offset + slope x
+        thread_local std::vector<Line> lower, upper;
+        lower.clear();
+        upper.clear();
+        lo = 0.0;
+        hi = kInfinity;
+        auto boundX = [&](double k, double r) {   // k x <= r
+            if (k > kTolerance) hi = std::min(hi, r / k);
+            else if (k < -kTolerance) lo = std::max(lo, r / k);
+            else if (r < -kTolerance) lo = kInfinity;
+        };
+        for (const Constraint& c : constraints) {
+            if (c.alpha > kTolerance) upper.push_back({ c.gamma / c.alpha, -c.beta / c.alpha });
+            else if (c.alpha < -kTolerance) lower.push_back({ c.gamma / c.alpha, -c.beta / c.alpha });
+            else boundX(c.beta, c.gamma);
+        }
+        for (const Line& l : lower)
+            for (const Line& u : upper) boundX(l.slope - u.slope, u.offset - l.offset);
+    }
+
+    // The interval of u that satisfies every constraint at a given x.
+    void feasibleU(const std::vector<Constraint>& constraints, double x, double& lo, double& hi)
+    {
+        lo = -kInfinity;
+        hi = kInfinity;
+        for (const Constraint& c : constraints) {
+            const double r = c.gamma - c.beta * x;
+            if (c.alpha > kTolerance) hi = std::min(hi, r / c.alpha);
+            else if (c.alpha < -kTolerance) lo = std::max(lo, r / c.alpha);
+        }
+    }
+}
+
+TrajectoryTiming TrajectoryTiming::compute(RigidBodyDynamics& dynamics, const std::vector<double>& path,
+    const Settings& settings)
+{
+    TrajectoryTiming timing;
+    const std::size_t dofs = dynamics.dofCount();
+    timing.dofs = dofs;
+    const std::size_t waypoints = dofs ? path.size() / dofs : 0;
+    if (waypoints < 2) {
+        timing.error = "the path has fewer than two waypoints";
+        return timing;
+    }
+
+    std::vector<double> velocity(dofs), effort(dofs);
+    for (std::size_t d = 0; d < dofs; ++d) {
+        const RigidBodyDynamics::JointParameters& joint = dynamics.joint(d);
+        velocity[d] = joint.velocityLimit > 0.0 ? joint.velocityLimit : settings.defaultVelocity;
+        effort[d] = settings.useDynamics && joint.effortLimit > 0.0 ? joint.effortLimit : 0.0;
+    }
+
+    std::vector<double> q(dofs), tangent(dofs), zero(dofs, 0.0), a(dofs), b(dofs), c(dofs);
+    std::vector<std::vector<Constraint>> stages;      // per grid point of the segment
+    std::vector<double> xBound, kMin, kMax, x;
+    std::vector<Constraint> step;
+    const bool anyEffort = std::any_of(effort.begin(), effort.end(), [](double e) { return e > 0.0; });
+    timing.q.assign(path.begin(), path.begin() + std::ptrdiff_t(dofs));
+    timing.time.push_back(0.0);
+    timing.speed.push_back(0.0);
+
+    for (std::size_t w = 0; w + 1 < waypoints; ++w) {
+        const double* from = path.data() + w * dofs;
+        const double* to = from + dofs;
+        // q(s) = from + s q' over [0, length], |q'| = 1 in the largest joint.
+        double length = 0.0;
+        for (std::size_t d = 0; d < dofs; ++d) length = std::max(length, std::abs(to[d] - from[d]));
+        if (length <= kTolerance) continue;
+        for (std::size_t d = 0; d < dofs; ++d) tangent[d] = (to[d] - from[d]) / length;
+
+        const std::size_t intervals = std::max<std::size_t>(1, std::size_t(std::ceil(length / std::max(settings.gridStep, 1e-6))));
+        const double delta = length / double(intervals);
+        const std::size_t points = intervals + 1;
+
+        // Constraints on (u, x) at every grid point.
+        stages.resize(points);
+        xBound.assign(points, kInfinity);
+        for (std::size_t i = 0; i < points; ++i) {
+            const double s = delta * double(i);
+            for (std::size_t d = 0; d < dofs; ++d) q[d] = from[d] + s * tangent[d];
+
+            std::vector<Constraint>& stage = stages[i];
+            stage.clear();
+            stage.push_back({ 0.0, -1.0, 0.0 });   // x >= 0
+            for (std::size_t d = 0; d < dofs; ++d)
+                if (std::abs(tangent[d]) > kTolerance)
+                    xBound[i] = std::min(xBound[i], (velocity[d] / tangent[d]) * (velocity[d] / tangent[d]));
+            if (xBound[i] < kInfinity) stage.push_back({ 0.0, 1.0, xBound[i] });
+
+            // q'' = 0 on a straight segment, so b is the velocity product alone.
+            if (anyEffort) {
+                dynamics.inverseDynamics(q.data(), zero.data(), zero.data(), c.data());
+                dynamics.inverseDynamics(q.data(), zero.data(), tangent.data(), a.data());
+                dynamics.inverseDynamics(q.data(), tangent.data(), zero.data(), b.data());
+            }
+            for (std::size_t d = 0; d < dofs; ++d) {
+                if (effort[d] > 0.0) {
+                    const double ad = a[d] - c[d], bd = b[d] - c[d];
+                    stage.push_back({ ad, bd, effort[d] - c[d] });
+                    stage.push_back({ -ad, -bd, effort[d] + c[d] });
+                }
+                else {
+                    stage.push_back({ tangent[d], 0.0, settings.defaultAcceleration });
+                    stage.push_back({ -tangent[d], 0.0, settings.defaultAcceleration });
+                }
+            }
+        }
+
+        // Backward: the controllable sets, ending at rest.
+        kMin.assign(points, 0.0);
+        kMax.assign(points, 0.0);
+        for (std::size_t i = points - 1; i-- > 0;) {
+            step = stages[i];
+            step.push_back({ 2.0 * delta, 1.0, kMax[i + 1] });
+            step.push_back({ -2.0 * delta, -1.0, -kMin[i + 1] });
+            feasibleX(step, kMin[i], kMax[i]);
+            if (kMin[i] > kMax[i] + kTolerance) {
+                timing.error = "the joint limits cannot be met along the path";
+                return timing;
+            }
+            kMax[i] = std::max(kMax[i], kMin[i]);
+        }
+        if (kMin[0] > kTolerance) {
+            timing.error = "the effort limits cannot hold the robot at a waypoint";
+            return timing;
+        }
+
+        // Forward: the largest admissible acceleration at every point.
+        x.assign(points, 0.0);
+        for (std::size_t i = 0; i + 1 < points; ++i) {
+            double lo, hi;
+            feasibleU(stages[i], x[i], lo, hi);
+            hi = std::min(hi, (kMax[i + 1] - x[i]) / (2.0 * delta));
+            x[i + 1] = std::clamp(x[i] + 2.0 * delta * hi, kMin[i + 1], kMax[i + 1]);
+        }
+
+        double time = timing.time.back();
+        for (std::size_t i = 1; i < points; ++i) {
+            const double sdPrev = std::sqrt(x[i - 1]), sd = std::sqrt(x[i]);
+            if (sdPrev + sd <= kTolerance) {
+                timing.error = "the joint limits leave no speed to move along the path";
+                return timing;
+            }
+            time += 2.0 * delta / (sdPrev + sd);
+            for (std::size_t d = 0; d < dofs; ++d) timing.q.push_back(from[d] + delta * double(i) * tangent[d]);
+            timing.time.push_back(time);
+            timing.speed.push_back(sd);
+            if (x[i] >= xBound[i] * (1.0 - 1e-6)) ++timing.velocityLimited;
+        }
+    }
+    if (timing.time.size() < 2) {
+        timing.error = "the path does not move";
+        timing.q.clear();
+        timing.time.clear();
+        timing.speed.clear();
+        return timing;
+    }
+    timing.duration = timing.time.back();
+    return timing;
+}
+
+void TrajectoryTiming::sample(const std::vector<double>& q, const std::vector<double>& time, std::size_t dofs,
+    double seconds, double* out)
+{
+    if (time.empty()) return;
+    const auto next = std::upper_bound(time.begin(), time.end(), seconds);
+    if (next == time.begin() || next == time.end()) {
+        const double* row = q.data() + (next == time.begin() ? 0 : (time.size() - 1) * dofs);
+        std::copy_n(row, dofs, out);
+        return;
+    }
+    const std::size_t i = std::size_t(next - time.begin());
+    const double f = (seconds - time[i - 1]) / (time[i] - time[i - 1]);
+    const double* p = q.data() + (i - 1) * dofs;
+    for (std::size_t d = 0; d < dofs; ++d) out[d] = p[d] + (p[dofs + d] - p[d]) * f;
+}
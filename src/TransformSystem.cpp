@@ -0,0 +1,156 @@
+#include "TransformSystem.hpp"
+#include "components.hpp"
+#include "ThreadPool.hpp"
+
+#include <entt/entt.hpp>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // Cached depth-first order of the transform hierarchy, kept in the
+    // registry context. Parents always precede their children and every
+    // subtree is a contiguous range.
+    struct TransformHierarchy
+    {
+        std::vector<entt::entity> order;
+        std::vector<int> parentIndex;             ///< index into 'order', -1 for roots
+        std::vector<std::size_t> chunkStart;      ///< runs of whole root subtrees, see kMinChunk; back() == order.size()
+        std::vector<std::uint64_t> lastVersion;   ///< TransformComponent::version() the world matrix was built from
+        std::vector<glm::mat4> world;
+        std::vector<char> dirty;                  ///< scratch, per pass
+        bool stale = true;
+    };
+
+    // Root subtrees are grouped into chunks of at least this many entities
+    // before going to the pool; below two chunks everything runs inline.
+    constexpr std::size_t kMinChunk = 256;
+
+    void markStale(entt::registry& r, entt::entity)
+    {
+        if (auto* h = r.ctx().find<TransformHierarchy>()) h->stale = true;
+    }
+
+    TransformHierarchy& hierarchyOf(entt::registry& r)
+    {
+        if (auto* h = r.ctx().find<TransformHierarchy>()) return *h;
+
+        // Structural changes invalidate the order. In-place edits of
+        // ParentComponent::parent are caught by the per-pass check below.
+        r.on_construct<ParentComponent>().connect<&markStale>();
+        r.on_update<ParentComponent>().connect<&markStale>();
+        r.on_destroy<ParentComponent>().connect<&markStale>();
+        r.on_construct<TransformComponent>().connect<&markStale>();
+        r.on_destroy<TransformComponent>().connect<&markStale>();
+        return r.ctx().emplace<TransformHierarchy>();
+    }
+
+    void rebuild(entt::registry& r, TransformHierarchy& h)
+    {
+        std::unordered_map<entt::entity, std::vector<entt::entity>> children;
+        auto parented = r.view<ParentComponent, TransformComponent>();
+        for (auto e : parented)
+            children[parented.get<ParentComponent>(e).parent].push_back(e);
+
+        h.order.clear();
+        h.parentIndex.clear();
+        h.chunkStart.assign(1, 0);
+
+        std::vector<std::pair<entt::entity, int>> stack;
+        for (auto root : r.view<TransformComponent>(entt::exclude<ParentComponent>)) {
+            stack.push_back({ root, -1 });
+            while (!stack.empty()) {
+                const auto [e, parent] = stack.back();
+                stack.pop_back();
+                const int index = static_cast<int>(h.order.size());
+                h.order.push_back(e);
+                h.parentIndex.push_back(parent);
+
+                auto it = children.find(e);
+                if (it == children.end()) continue;
+                // Reverse so children come out in view order.
+                for (auto c = it->second.rbegin(); c != it->second.rend(); ++c)
+                    stack.push_back({ *c, index });
+            }
+            if (h.order.size() - h.chunkStart.back() >= kMinChunk) h.chunkStart.push_back(h.order.size());
+        }
+        if (h.chunkStart.back() != h.order.size()) h.chunkStart.push_back(h.order.size());
+
+        // Emplace up front so the (possibly parallel) pass never changes storage layout.
+        for (auto e : h.order) r.get_or_emplace<WorldTransformComponent>(e);
+
+        h.lastVersion.assign(h.order.size(), 0);
+        h.world.assign(h.order.size(), glm::mat4(1.0f));
+        h.dirty.assign(h.order.size(), 1);
+        h.stale = false;
+    }
+
+    // Cheap O(N) check that the cached order still matches the parent links.
+    bool orderMatches(entt::registry& r, const TransformHierarchy& h)
+    {
+        for (std::size_t i = 0; i < h.order.size(); ++i) {
+            const entt::entity e = h.order[i];
+            if (!r.valid(e)) return false;
+            const auto* p = r.try_get<ParentComponent>(e);
+            const entt::entity expected = h.parentIndex[i] < 0 ? entt::entity(entt::null) : h.order[h.parentIndex[i]];
+            if ((p ? p->parent : entt::entity(entt::null)) != expected) return false;
+        }
+        return true;
+    }
+}
+
+namespace TransformSystem
+{
+    std::size_t propagate(entt::registry& r)
+    {
+        TransformHierarchy& h = hierarchyOf(r);
+        if (h.stale || !orderMatches(r, h)) rebuild(r, h);
+
+        // Subtrees never reference each other, so chunks run independently.
+        // Only component values are touched here; storage is not resized.
+        std::atomic<std::size_t> changed{ 0 };
+        auto runChunk = [&](std::size_t c) {
+            std::size_t localChanged = 0;
+            for (std::size_t i = h.chunkStart[c]; i < h.chunkStart[c + 1]; ++i) {
+                const entt::entity e = h.order[i];
+                const auto& local = r.get<TransformComponent>(e);
+                const int parent = h.parentIndex[i];
+
+                const std::uint64_t version = local.version();
+                const bool dirty = h.dirty[i] || version != h.lastVersion[i] || (parent >= 0 && h.dirty[parent]);
+                h.dirty[i] = dirty;
+                if (!dirty) continue;
+
+                h.lastVersion[i] = version;
+                h.world[i] = parent >= 0 ? h.world[parent] * local.getTransform() : local.getTransform();
+                r.get<WorldTransformComponent>(e).matrix = h.world[i];
+                ++localChanged;
+            }
+            changed.fetch_add(localChanged, std::memory_order_relaxed);
+        };
+
+        const std::size_t chunks = h.chunkStart.size() - 1;
+        if (chunks > 1) ThreadPool::shared().parallelFor(chunks, runChunk);
+        else if (chunks == 1) runChunk(0);
+
+        // Dirty flags only need to survive until the children have been visited.
+        std::fill(h.dirty.begin(), h.dirty.end(), 0);
+        return changed.load();
+    }
+
+    const std::vector<glm::mat4>& worldMatrices(entt::registry& r)
+    {
+        return hierarchyOf(r).world;
+    }
+
+    const std::vector<entt::entity>& hierarchyOrder(entt::registry& r)
+    {
+        return hierarchyOf(r).order;
+    }
+
+    void invalidateHierarchy(entt::registry& r)
+    {
+        hierarchyOf(r).stale = true;
+    }
+}
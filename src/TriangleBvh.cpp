@@ -0,0 +1,78 @@
+#include "TriangleBvh.hpp"
+#include "GpuResources.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+void TriangleBvh::build(std::vector<TriangleGpu>& triangles, std::vector<BvhNodeGpu>& nodes)
+{
+    nodes.clear();
+    const std::uint32_t n = static_cast<std::uint32_t>(triangles.size());
+    if (n == 0) return;
+
+    // Per-triangle influence box and centroid, computed once.
+    std::vector<glm::vec3> boxMin(n), boxMax(n), centroid(n);
+    std::vector<std::uint32_t> order(n);
+    for (std::uint32_t i = 0; i < n; ++i) {
+        const TriangleGpu& t = triangles[i];
+        const glm::vec3 a(t.v0), b(t.v1), c(t.v2);
+        const glm::vec3 r(t.normal.w);
+        boxMin[i] = glm::min(glm::min(a, b), c) - r;
+        boxMax[i] = glm::max(glm::max(a, b), c) + r;
+        centroid[i] = (a + b + c) / 3.0f;
+        order[i] = i;
+    }
+
+    struct Task { std::uint32_t node, first, count, depth; };
+    std::vector<Task> stack;
+    stack.push_back({ 0, 0, n, 0 });
+    nodes.reserve(2 * (n / kLeafSize + 1));
+    nodes.emplace_back();
+
+    while (!stack.empty()) {
+        const Task task = stack.back();
+        stack.pop_back();
+
+        glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+        glm::vec3 cLo = lo, cHi = hi;
+        for (std::uint32_t i = task.first; i < task.first + task.count; ++i) {
+            const std::uint32_t t = order[i];
+            lo = glm::min(lo, boxMin[t]);
+            hi = glm::max(hi, boxMax[t]);
+            cLo = glm::min(cLo, centroid[t]);
+            cHi = glm::max(cHi, centroid[t]);
+        }
+        nodes[task.node].boundsMin = lo;
+        nodes[task.node].boundsMax = hi;
+
+        const glm::vec3 extent = cHi - cLo;
+        const int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+
+        if (task.count <= std::uint32_t(kLeafSize) || extent[axis] <= 1e-6f || task.depth >= std::uint32_t(kMaxDepth)) {
+            nodes[task.node].leftOrFirst = static_cast<std::int32_t>(task.first);
+            nodes[task.node].count = static_cast<std::int32_t>(task.count);
+            continue;
+        }
+
+        // Median split on the longest centroid axis: O(n) per level, balanced depth.
+        const std::uint32_t half = task.count / 2;
+        auto begin = order.begin() + task.first;
+        std::nth_element(begin, begin + half, begin + task.count,
+            [&](std::uint32_t a, std::uint32_t b) { return centroid[a][axis] < centroid[b][axis]; });
+
+        const std::uint32_t left = static_cast<std::uint32_t>(nodes.size());
+        nodes.emplace_back();
+        nodes.emplace_back();
+        nodes[task.node].leftOrFirst = static_cast<std::int32_t>(left);
+        nodes[task.node].count = 0;
+
+        stack.push_back({ left + 1, task.first + half, task.count - half, task.depth + 1 });
+        stack.push_back({ left, task.first, half, task.depth + 1 });
+    }
+
+    std::vector<TriangleGpu> sorted;
+    sorted.reserve(n);
+    for (std::uint32_t i : order) sorted.push_back(triangles[i]);
+    triangles.swap(sorted);
+}
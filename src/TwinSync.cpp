@@ -0,0 +1,582 @@
+#include "TwinSync.hpp"
+#include "JointStateBuffer.hpp"
+#include "components.hpp"
+
+#include <QDebug>
+#include <QNetworkDatagram>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QUdpSocket>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace TwinSyncFormat;
+
+namespace {
+
+void putVarint(QByteArray& out, std::uint32_t v)
+{
+    while (v >= 0x80) {
+        out.append(char(v | 0x80));
+        v >>= 7;
+    }
+    out.append(char(v));
+}
+
+bool getVarint(const char*& p, const char* end, std::uint32_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        const auto b = std::uint8_t(*p++);
+        v |= std::uint32_t(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+template <class T> void put(QByteArray& out, const T& v)
+{
+    out.append(reinterpret_cast<const char*>(&v), int(sizeof(T)));
+}
+
+template <class T> bool get(const char*& p, const char* end, T& v)
+{
+    if (end - p < std::ptrdiff_t(sizeof(T))) return false;
+    std::memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+std::int32_t quantizeStep(double value, double step)
+{
+    return std::int32_t(std::clamp(std::llround(value / step), -2147483647LL, 2147483647LL));
+}
+
+} // namespace
+
+// --- Format ---
+
+bool TwinSyncFormat::Transform::operator==(const Transform& o) const
+{
+    return std::memcmp(translation, o.translation, sizeof(translation)) == 0 && largest == o.largest
+        && std::memcmp(smallest, o.smallest, sizeof(smallest)) == 0 && std::memcmp(scale, o.scale, sizeof(scale)) == 0;
+}
+
+TwinSyncFormat::Transform TwinSyncFormat::quantize(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+    Transform q;
+    for (int i = 0; i < 3; ++i) {
+        q.translation[i] = quantizeStep(translation[i], kPositionStep);
+        q.scale[i] = scale[i];
+    }
+
+    // Smallest three: drop the largest component (recoverable from unit
+    // length) after flipping the quaternion so that it is positive.
+    const glm::quat r = glm::normalize(rotation);
+    const float c[4] = { r.x, r.y, r.z, r.w };
+    int largest = 0;
+    for (int i = 1; i < 4; ++i)
+        if (std::abs(c[i]) > std::abs(c[largest])) largest = i;
+    const float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+    for (int i = 0, k = 0; i < 4; ++i) {
+        if (i == largest) continue;
+        q.smallest[k++] = std::int16_t(std::clamp(std::lround(c[i] * sign * kRotationScale), -32767L, 32767L));
+    }
+    q.largest = std::uint8_t(largest);
+    return q;
+}
+
+void TwinSyncFormat::dequantize(const Transform& q, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale)
+{
+    for (int i = 0; i < 3; ++i) {
+        translation[i] = float(q.translation[i]) * kPositionStep;
+        scale[i] = q.scale[i];
+    }
+    float c[4] = {};
+    float sum = 0.0f;
+    for (int i = 0, k = 0; i < 4; ++i) {
+        if (i == q.largest) continue;
+        c[i] = float(q.smallest[k++]) / kRotationScale;
+        sum += c[i] * c[i];
+    }
+    c[q.largest & 3] = std::sqrt(std::max(0.0f, 1.0f - sum));
+    rotation = glm::quat(c[3], c[0], c[1], c[2]);
+}
+
+std::vector<std::pair<std::string, entt::entity>> TwinSyncFormat::entityKeys(entt::registry& registry)
+{
+    std::vector<std::pair<std::string, entt::entity>> keys;
+    for (auto [e, tag, xf] : registry.view<TagComponent, TransformComponent>().each()) {
+        if (tag.tag.empty() || registry.any_of<CameraComponent, CameraGizmoTag>(e)) continue;
+        // Links below the root are posed from the joints.
+        if (registry.all_of<LinkComponent>(e) && !registry.all_of<KinematicModelComponent>(e)) continue;
+        keys.emplace_back(tag.tag, e);
+    }
+    std::sort(keys.begin(), keys.end(), [](const auto& a, const auto& b) {
+        return entt::to_entity(a.second) < entt::to_entity(b.second);
+    });
+    std::unordered_map<std::string, int> seen;
+    for (auto& [key, e] : keys) key += '#' + std::to_string(seen[key]++);
+    return keys;
+}
+
+// --- Publisher ---
+
+TwinPublisher::TwinPublisher(entt::registry& registry, QObject* parent)
+    : QObject(parent)
+    , m_registry(registry)
+{
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &TwinPublisher::tick);
+}
+
+TwinPublisher::~TwinPublisher()
+{
+    stop();
+}
+
+bool TwinPublisher::start(quint16 port)
+{
+    stop();
+    m_socket = new QUdpSocket(this);
+    if (!m_socket->bind(QHostAddress::AnyIPv4, port)) {
+        qWarning() << "[TwinSync] Cannot bind port" << port << ":" << m_socket->errorString();
+        delete m_socket;
+        m_socket = nullptr;
+        return false;
+    }
+    connect(m_socket, &QUdpSocket::readyRead, this, &TwinPublisher::readAcks);
+
+    m_session = QRandomGenerator::global()->generate() | 1u;   // 0 is a mirror that has not heard from anyone
+    m_tick = 0;
+    m_replicas.clear();
+    m_netIds.clear();
+    m_clock.start();
+    m_keysRefreshedMs = -kKeyRefreshMs;
+    m_timer->start(1000 / kTickHz);
+    return true;
+}
+
+void TwinPublisher::stop()
+{
+    m_timer->stop();
+    delete m_socket;
+    m_socket = nullptr;
+    if (!m_peers.empty()) {
+        m_peers.clear();
+        emit mirrorsChanged(0);
+    }
+}
+
+bool TwinPublisher::running() const
+{
+    return m_socket != nullptr;
+}
+
+void TwinPublisher::tick()
+{
+    ++m_tick;
+    const qint64 now = m_clock.elapsed();
+    if (now - m_keysRefreshedMs >= kKeyRefreshMs) {
+        refreshKeys();
+        m_keysRefreshedMs = now;
+    }
+    sample();
+
+    const std::size_t before = m_peers.size();
+    m_peers.erase(std::remove_if(m_peers.begin(), m_peers.end(),
+        [now](const Peer& p) { return now - p.lastSeenMs > kPeerTimeoutMs; }), m_peers.end());
+    if (m_peers.size() != before) emit mirrorsChanged(int(m_peers.size()));
+
+    for (Peer& peer : m_peers) sendTo(peer);
+}
+
+void TwinPublisher::refreshKeys()
+{
+    // Net ids are handed out per key and never reused, so a mirror's table
+    // only grows; an entity that comes back under its key resends its identity.
+    for (Replica& r : m_replicas) r.alive = false;
+    for (auto& [key, e] : entityKeys(m_registry)) {
+        auto [it, inserted] = m_netIds.try_emplace(key, std::uint32_t(m_replicas.size()));
+        if (inserted) {
+            m_replicas.emplace_back();
+            m_replicas.back().key = key;
+        }
+        Replica& r = m_replicas[it->second];
+        if (r.entity != e) {
+            r.entity = e;
+            r.identityTick = r.transformTick = r.jointsTick = m_tick;
+            r.joints.clear();
+        }
+        r.alive = true;
+    }
+    for (Replica& r : m_replicas)
+        if (!r.alive) r.entity = entt::null;
+}
+
+void TwinPublisher::sample()
+{
+    for (Replica& r : m_replicas) {
+        if (!r.alive) continue;
+        if (!m_registry.valid(r.entity)) {   // destroyed since the last key refresh
+            r.alive = false;
+            r.entity = entt::null;
+            continue;
+        }
+        const auto* xf = m_registry.try_get<TransformComponent>(r.entity);
+        if (!xf) continue;
+        const Transform q = quantize(xf->translation, xf->rotation, xf->scale);
+        if (q != r.transform) {
+            r.transform = q;
+            r.transformTick = m_tick;
+        }
+        const auto* world = m_registry.try_get<WorldTransformComponent>(r.entity);
+        r.position = world ? glm::vec3(world->matrix[3]) : xf->translation;
+
+        const auto* state = m_registry.try_get<JointStateComponent>(r.entity);
+        r.robot = state && state->buffer;
+        if (!r.robot) continue;
+        const std::size_t dofs = std::min<std::size_t>(state->buffer->size(), 255);
+        const double* position = state->buffer->position();
+        bool changed = r.joints.size() != dofs;
+        r.joints.resize(dofs);
+        for (std::size_t i = 0; i < dofs; ++i) {
+            const std::int32_t v = quantizeStep(position[i], kJointStep);
+            changed |= v != r.joints[i];
+            r.joints[i] = v;
+        }
+        if (changed) r.jointsTick = m_tick;
+    }
+}
+
+void TwinPublisher::sendTo(Peer& peer)
+{
+    constexpr int kPayloadBytes = kMaxPacketBytes - int(sizeof(PacketHeader));
+    std::vector<QByteArray> payloads(1);
+    bool partial = false;
+    peer.entered.resize(m_replicas.size(), 0);
+
+    QByteArray record;
+    for (std::uint32_t id = 0; id < m_replicas.size() && !partial; ++id) {
+        const Replica& r = m_replicas[id];
+        std::uint32_t& entered = peer.entered[id];
+        const bool inside = r.alive && (r.robot || peer.radius <= 0.0f || glm::distance(r.position, peer.center) <= peer.radius);
+        if (!inside) {
+            entered = 0;
+            continue;
+        }
+        if (!entered) entered = m_tick;   // everything again once it comes into view
+
+        // Stamped after the mirror's last complete tick: it may not have it.
+        const auto stale = [&](std::uint32_t stamp) { return std::max(stamp, entered) > peer.acked; };
+        std::uint8_t mask = 0;
+        if (stale(r.identityTick)) mask |= kIdentity;
+        if (stale(r.transformTick)) mask |= r.transform.scaled() ? (kTransform | kScale) : kTransform;
+        if (r.robot && stale(r.jointsTick)) mask |= kJoints;
+        if (!mask) continue;
+
+        record.clear();
+        putVarint(record, id);
+        put(record, mask);
+        if (mask & kIdentity) {
+            const std::uint8_t length = std::uint8_t(std::min<std::size_t>(r.key.size(), 255));
+            put(record, length);
+            record.append(r.key.data(), length);
+        }
+        if (mask & kTransform) {
+            put(record, r.transform.translation);
+            put(record, r.transform.largest);
+            put(record, r.transform.smallest);
+        }
+        if (mask & kScale) put(record, r.transform.scale);
+        if (mask & kJoints) {
+            put(record, std::uint8_t(r.joints.size()));
+            record.append(reinterpret_cast<const char*>(r.joints.data()), int(r.joints.size() * sizeof(std::int32_t)));
+        }
+
+        if (payloads.back().size() + record.size() > kPayloadBytes) {
+            if (int(payloads.size()) == kMaxPacketsPerTick) {
+                partial = true;   // the rest is still stale next tick
+                break;
+            }
+            payloads.emplace_back();
+        }
+        payloads.back() += record;
+    }
+
+    PacketHeader header;
+    header.type = kState;
+    header.flags = partial ? kPartial : 0;
+    header.session = m_session;
+    header.tick = m_tick;
+    header.baseTick = peer.acked;
+    header.packetCount = std::uint16_t(payloads.size());
+    for (std::size_t i = 0; i < payloads.size(); ++i) {
+        header.packetIndex = std::uint16_t(i);
+        QByteArray datagram(reinterpret_cast<const char*>(&header), int(sizeof(header)));
+        datagram += payloads[i];
+        m_socket->writeDatagram(datagram, peer.address, peer.port);
+    }
+}
+
+void TwinPublisher::readAcks()
+{
+    const qint64 now = m_clock.elapsed();
+    while (m_socket && m_socket->hasPendingDatagrams()) {
+        const QNetworkDatagram datagram = m_socket->receiveDatagram();
+        const QByteArray data = datagram.data();
+        PacketHeader header;
+        AckPayload ack;
+        const char* p = data.constData();
+        const char* end = p + data.size();
+        if (!get(p, end, header) || !get(p, end, ack)) continue;
+        if (header.magic != kMagic || header.version != kVersion || header.type != kAck) continue;
+
+        auto it = std::find_if(m_peers.begin(), m_peers.end(), [&](const Peer& peer) {
+            return peer.port == datagram.senderPort() && peer.address.isEqual(datagram.senderAddress());
+        });
+        if (it == m_peers.end()) {
+            Peer peer;
+            peer.address = datagram.senderAddress();
+            peer.port = quint16(datagram.senderPort());
+            m_peers.push_back(peer);
+            it = m_peers.end() - 1;
+            qDebug() << "[TwinSync] Mirror joined:" << peer.address.toString() << peer.port;
+            emit mirrorsChanged(int(m_peers.size()));
+        }
+        Peer& peer = *it;
+        // An ack from an earlier session (or none yet) means "has nothing".
+        if (header.session != m_session) peer.acked = 0;
+        else if (header.tick <= m_tick) peer.acked = std::max(peer.acked, header.tick);
+        peer.center = glm::vec3(ack.center[0], ack.center[1], ack.center[2]);
+        peer.radius = ack.radius;
+        peer.lastSeenMs = now;
+    }
+}
+
+// --- Mirror ---
+
+TwinMirror::TwinMirror(entt::registry& registry, QObject* parent)
+    : QObject(parent)
+    , m_registry(registry)
+{
+    m_ackTimer = new QTimer(this);
+    m_ackTimer->setInterval(1000 / kAckHz);
+    connect(m_ackTimer, &QTimer::timeout, this, &TwinMirror::sendAck);
+}
+
+TwinMirror::~TwinMirror()
+{
+    stop();
+}
+
+bool TwinMirror::start(const QHostAddress& publisher, quint16 port)
+{
+    stop();
+    m_socket = new QUdpSocket(this);
+    if (!m_socket->bind(QHostAddress::AnyIPv4, 0)) {
+        qWarning() << "[TwinSync] Cannot open a UDP socket:" << m_socket->errorString();
+        delete m_socket;
+        m_socket = nullptr;
+        return false;
+    }
+    connect(m_socket, &QUdpSocket::readyRead, this, &TwinMirror::readState);
+    m_publisher = publisher;
+    m_port = port;
+    reset(0);
+    m_localKeys.clear();
+    m_clock.start();
+    m_lastPacketMs = -1;
+    m_keysResolvedMs = -kResolveRetryMs;
+    m_ackTimer->start();
+    sendAck();   // registers with the publisher
+    return true;
+}
+
+void TwinMirror::stop()
+{
+    m_ackTimer->stop();
+    delete m_socket;
+    m_socket = nullptr;
+    if (m_lastPacketMs >= 0) {
+        m_lastPacketMs = -1;
+        emit connectedChanged(false);
+    }
+}
+
+bool TwinMirror::running() const
+{
+    return m_socket != nullptr;
+}
+
+void TwinMirror::reset(std::uint32_t session)
+{
+    m_session = session;
+    m_complete = 0;
+    m_incoming.clear();
+    m_remotes.clear();
+}
+
+void TwinMirror::readState()
+{
+    bool applied = false;
+    while (m_socket && m_socket->hasPendingDatagrams()) {
+        const QNetworkDatagram datagram = m_socket->receiveDatagram();
+        if (!datagram.senderAddress().isEqual(m_publisher, QHostAddress::TolerantConversion)) continue;
+        applied |= applyPacket(datagram.data());
+    }
+    if (applied) emit sceneUpdated();
+}
+
+bool TwinMirror::applyPacket(const QByteArray& datagram)
+{
+    PacketHeader header;
+    const char* p = datagram.constData();
+    const char* end = p + datagram.size();
+    if (!get(p, end, header)) return false;
+    if (header.magic != kMagic || header.version != kVersion || header.type != kState) return false;
+    if (header.packetCount == 0 || header.packetIndex >= header.packetCount) return false;
+
+    if (header.session != m_session) reset(header.session);
+    if (m_lastPacketMs < 0) emit connectedChanged(true);
+    m_lastPacketMs = m_clock.elapsed();
+
+    const bool applied = applyRecords(p, int(end - p), header.tick);
+
+    // A tick is complete with all of its packets, provided it was built
+    // against a tick this mirror already had complete.
+    if (header.tick > m_complete) {
+        Incoming& in = m_incoming[header.tick];
+        if (in.received.empty()) {
+            in.received.assign(header.packetCount, false);
+            in.missing = header.packetCount;
+            in.baseTick = header.baseTick;
+            in.partial = header.flags & kPartial;
+        }
+        if (in.received.size() == header.packetCount && !in.received[header.packetIndex]) {
+            in.received[header.packetIndex] = true;
+            --in.missing;
+        }
+        if (in.missing == 0 && !in.partial && in.baseTick <= m_complete) m_complete = header.tick;
+
+        constexpr std::uint32_t kWindow = 4 * TwinPublisher::kTickHz;   // older partial ticks will not complete
+        for (auto it = m_incoming.begin(); it != m_incoming.end();) {
+            if (it->first <= m_complete || it->first + kWindow < header.tick) it = m_incoming.erase(it);
+            else ++it;
+        }
+    }
+    return applied;
+}
+
+bool TwinMirror::applyRecords(const char* p, int size, std::uint32_t tick)
+{
+    constexpr std::uint32_t kMaxNetIds = 1u << 20;
+    const char* end = p + size;
+    bool applied = false;
+    while (p < end) {
+        std::uint32_t id = 0;
+        std::uint8_t mask = 0;
+        if (!getVarint(p, end, id) || !get(p, end, mask) || id >= kMaxNetIds) return applied;
+
+        std::string key;
+        Transform transform;
+        std::int32_t joints[255];
+        std::uint8_t dofs = 0;
+        if (mask & kIdentity) {
+            std::uint8_t length = 0;
+            if (!get(p, end, length) || end - p < length) return applied;
+            key.assign(p, length);
+            p += length;
+        }
+        if ((mask & kTransform) && !(get(p, end, transform.translation) && get(p, end, transform.largest)
+            && get(p, end, transform.smallest)))
+            return applied;
+        if ((mask & kScale) && !get(p, end, transform.scale)) return applied;
+        if (mask & kJoints) {
+            if (!get(p, end, dofs) || end - p < std::ptrdiff_t(dofs * sizeof(std::int32_t))) return applied;
+            std::memcpy(joints, p, dofs * sizeof(std::int32_t));
+            p += dofs * sizeof(std::int32_t);
+        }
+
+        if (id >= m_remotes.size()) m_remotes.resize(id + 1);
+        Remote& remote = m_remotes[id];
+        if ((mask & kIdentity) && key != remote.key) {
+            remote.key = std::move(key);
+            remote.entity = entt::null;
+        }
+        // Each tick carries everything since its base, so a newer record
+        // for the entity supersedes an older one arriving late.
+        if (tick < remote.appliedTick) continue;
+        remote.appliedTick = tick;
+        const entt::entity e = resolve(remote);
+        if (e == entt::null) continue;
+
+        if ((mask & kTransform) && m_registry.all_of<TransformComponent>(e)) {
+            glm::vec3 translation, scale;
+            glm::quat rotation;
+            dequantize(transform, translation, rotation, scale);
+            m_registry.patch<TransformComponent>(e, [&](TransformComponent& xf) {
+                xf.translation = translation;
+                xf.rotation = rotation;
+                xf.scale = scale;
+            });
+            applied = true;
+        }
+        if (mask & kJoints) {
+            const auto* state = m_registry.try_get<JointStateComponent>(e);
+            if (state && state->buffer) {
+                // KinematicSystem poses the links and publishes next tick.
+                double* position = state->buffer->position();
+                for (std::size_t i = 0; i < std::min<std::size_t>(dofs, state->buffer->size()); ++i)
+                    position[i] = double(joints[i]) * kJointStep;
+                applied = true;
+            }
+        }
+    }
+    return applied;
+}
+
+entt::entity TwinMirror::resolve(Remote& remote)
+{
+    if (remote.entity != entt::null && m_registry.valid(remote.entity)) return remote.entity;
+    if (remote.key.empty()) return entt::null;
+
+    auto it = m_localKeys.find(remote.key);
+    if (it == m_localKeys.end() || !m_registry.valid(it->second)) {
+        // Rebuilding walks the scene, so unknown keys retry at most once per interval.
+        const qint64 now = m_clock.elapsed();
+        if (now - m_keysResolvedMs < kResolveRetryMs) return entt::null;
+        m_keysResolvedMs = now;
+        m_localKeys.clear();
+        for (auto& [key, e] : entityKeys(m_registry)) m_localKeys.emplace(std::move(key), e);
+        it = m_localKeys.find(remote.key);
+        if (it == m_localKeys.end()) return entt::null;
+    }
+    return remote.entity = it->second;
+}
+
+void TwinMirror::sendAck()
+{
+    if (!m_socket) return;
+    PacketHeader header;
+    header.type = kAck;
+    header.session = m_session;
+    header.tick = m_complete;
+    AckPayload ack;
+    if (m_interest) {
+        const Interest interest = m_interest();
+        for (int i = 0; i < 3; ++i) ack.center[i] = interest.center[i];
+        ack.radius = interest.radius;
+    }
+    QByteArray datagram(reinterpret_cast<const char*>(&header), int(sizeof(header)));
+    put(datagram, ack);
+    m_socket->writeDatagram(datagram, m_publisher, m_port);
+
+    constexpr qint64 kSilenceMs = 2000;
+    if (m_lastPacketMs >= 0 && m_clock.elapsed() - m_lastPacketMs > kSilenceMs) {
+        m_lastPacketMs = -1;
+        emit connectedChanged(false);
+    }
+}
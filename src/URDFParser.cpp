@@ -1,23 +1,67 @@
 #include "URDFParser.hpp"
 #include "pugixml.hpp"
+#include "TraceZones.hpp"
+#include "AssetPaths.hpp"
+
+#include <QFile>
+#include <QFileInfo>
+#include <charconv>
+#include <cstring>
+#include <iterator>
 #include <stdexcept>
-#include <iostream>
-#include <sstream>
+
+// Parses one number and advances 'str' past it. No locale, no allocation.
+static bool parseNumber(const char*& str, const char* end, double& out)
+{
+    while (str < end && (*str == ' ' || *str == '\t' || *str == '\n' || *str == '\r')) ++str;
+    if (str < end && *str == '+') ++str; // from_chars rejects a leading '+'
+    const auto [next, ec] = std::from_chars(str, end, out);
+    if (ec != std::errc()) return false;
+    str = next;
+    return true;
+}
 
 // Helper function to parse a "x y z" string into a glm::vec3
 static glm::vec3 parseVec3(const char* str)
 {
-    if (!str) return glm::vec3(0.0f);
-    glm::vec3 result;
-    std::stringstream ss(str);
-    ss >> result.x >> result.y >> result.z;
+    glm::vec3 result(0.0f);
+    if (!str) return result;
+    const char* end = str + std::strlen(str);
+    for (int i = 0; i < 3; ++i) {
+        double value = 0.0;
+        if (!parseNumber(str, end, value)) break;
+        result[i] = static_cast<float>(value);
+    }
     return result;
 }
 
+static double parseDouble(const pugi::xml_attribute& attribute)
+{
+    const char* str = attribute.as_string();
+    double value = 0.0;
+    return parseNumber(str, str + std::strlen(str), value) ? value : 0.0;
+}
+
 RobotDescription URDFParser::parse(const std::string& filepath)
 {
+    KR_ZONE("parse URDF");
+    // Map the file copy-on-write and let pugixml parse it in place: no copy
+    // of the text, and attribute values point straight into the mapping.
+    // The mapping has to outlive 'doc', which it does by scope.
+    QFile file(QString::fromStdString(filepath));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        throw std::runtime_error("Failed to open URDF file: " + filepath);
+    }
+    const qint64 size = file.size();
+    uchar* contents = size > 0 ? file.map(0, size, QFileDevice::MapPrivateOption) : nullptr;
+    if (!contents)
+    {
+        throw std::runtime_error("Failed to read URDF file: " + filepath);
+    }
+
     pugi::xml_document doc;
-    pugi::xml_parse_result result = doc.load_file(filepath.c_str());
+    pugi::xml_parse_result result = doc.load_buffer_inplace(contents, static_cast<size_t>(size));
 
     if (!result)
     {
@@ -32,9 +76,16 @@ RobotDescription URDFParser::parse(const std::string& filepath)
 
     RobotDescription robotDesc;
     robotDesc.name = robotNode.attribute("name").as_string("DefaultRobotName");
+    // Mesh filenames are package:// URIs or relative to the URDF.
+    const std::string baseDir = QFileInfo(QString::fromStdString(filepath)).absolutePath().toStdString();
+
+    const auto links = robotNode.children("link");
+    const auto joints = robotNode.children("joint");
+    robotDesc.links.reserve(static_cast<size_t>(std::distance(links.begin(), links.end())));
+    robotDesc.joints.reserve(static_cast<size_t>(std::distance(joints.begin(), joints.end())));
 
     // --- Parse Links ---
-    for (pugi::xml_node linkNode : robotNode.children("link"))
+    for (pugi::xml_node linkNode : links)
     {
         LinkDescription linkDesc;
         linkDesc.name = linkNode.attribute("name").as_string();
@@ -50,7 +101,8 @@ RobotDescription URDFParser::parse(const std::string& filepath)
             }
             if (pugi::xml_node geometryNode = visualNode.child("geometry")) {
                 if (pugi::xml_node meshNode = geometryNode.child("mesh")) {
-                    linkDesc.mesh_filepath = meshNode.attribute("filename").as_string();
+                    if (const char* filename = meshNode.attribute("filename").as_string(); *filename)
+                        linkDesc.mesh_filepath = AssetPaths::resolve(filename, baseDir);
                 }
             }
         }
@@ -58,11 +110,11 @@ RobotDescription URDFParser::parse(const std::string& filepath)
         // Assign a default material, which the user can edit.
         linkDesc.material = MaterialDescription();
 
-        robotDesc.links.push_back(linkDesc);
+        robotDesc.links.push_back(std::move(linkDesc));
     }
 
     // --- Parse Joints ---
-    for (pugi::xml_node jointNode : robotNode.children("joint"))
+    for (pugi::xml_node jointNode : joints)
     {
         JointDescription jointDesc;
         jointDesc.name = jointNode.attribute("name").as_string();
@@ -90,13 +142,13 @@ RobotDescription URDFParser::parse(const std::string& filepath)
             jointDesc.axis = parseVec3(axisNode.attribute("xyz").as_string());
         }
         if (pugi::xml_node limitNode = jointNode.child("limit")) {
-            jointDesc.limits.lower = limitNode.attribute("lower").as_double();
-            jointDesc.limits.upper = limitNode.attribute("upper").as_double();
-            jointDesc.limits.effort_limit = limitNode.attribute("effort").as_double();
-            jointDesc.limits.velocity_limit = limitNode.attribute("velocity").as_double();
+            jointDesc.limits.lower = parseDouble(limitNode.attribute("lower"));
+            jointDesc.limits.upper = parseDouble(limitNode.attribute("upper"));
+            jointDesc.limits.effort_limit = parseDouble(limitNode.attribute("effort"));
+            jointDesc.limits.velocity_limit = parseDouble(limitNode.attribute("velocity"));
         }
 
-        robotDesc.joints.push_back(jointDesc);
+        robotDesc.joints.push_back(std::move(jointDesc));
     }
 
     return robotDesc;
@@ -0,0 +1,474 @@
+#include "UndoStack.hpp"
+#include "components.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+
+namespace {
+
+using Bytes = std::vector<std::byte>;
+
+// Edits with the same label closer together than this become one step.
+constexpr auto kMergeWindow = std::chrono::milliseconds(800);
+// Equal bytes absorbed into a run rather than paying for another run header.
+constexpr std::size_t kRunGap = 8;
+
+/* ------------------------------------------------------------ */
+/*  Field lists                                                  */
+/* ------------------------------------------------------------ */
+
+class FieldWriter
+{
+public:
+    static constexpr bool reading = false;
+    explicit FieldWriter(Bytes& out) : m_out(out) {}
+
+    template <class T> FieldWriter& operator()(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "list the fields of this type instead");
+        const auto* p = reinterpret_cast<const std::byte*>(&value);
+        m_out.insert(m_out.end(), p, p + sizeof(T));
+        return *this;
+    }
+    template <class T> FieldWriter& operator()(const std::vector<T>& values)
+    {
+        (*this)(std::uint32_t(values.size()));
+        for (const T& v : values) (*this)(v);
+        return *this;
+    }
+    FieldWriter& operator()(const std::string& text)
+    {
+        (*this)(std::uint32_t(text.size()));
+        const auto* p = reinterpret_cast<const std::byte*>(text.data());
+        m_out.insert(m_out.end(), p, p + text.size());
+        return *this;
+    }
+
+private:
+    Bytes& m_out;
+};
+
+class FieldReader
+{
+public:
+    static constexpr bool reading = true;
+    FieldReader(const std::byte* data, std::size_t size) : m_p(data), m_end(data + size) {}
+
+    bool ok() const { return m_ok && m_p == m_end; }
+
+    template <class T> FieldReader& operator()(T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "list the fields of this type instead");
+        if (const std::byte* p = take(sizeof(T))) std::memcpy(&value, p, sizeof(T));
+        return *this;
+    }
+    template <class T> FieldReader& operator()(std::vector<T>& values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "vector elements are copied whole");
+        std::uint32_t count = 0;
+        (*this)(count);
+        const std::byte* p = take(std::size_t(count) * sizeof(T));
+        if (!p) return *this;
+        values.clear();
+        values.reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i, p += sizeof(T)) {
+            // Elements need not be default-constructible (GridLevel isn't).
+            alignas(T) std::byte element[sizeof(T)];
+            std::memcpy(element, p, sizeof(T));
+            values.push_back(*std::launder(reinterpret_cast<T*>(element)));
+        }
+        return *this;
+    }
+    FieldReader& operator()(std::string& text)
+    {
+        std::uint32_t size = 0;
+        (*this)(size);
+        if (const std::byte* p = take(size)) text.assign(reinterpret_cast<const char*>(p), size);
+        return *this;
+    }
+
+private:
+    const std::byte* take(std::size_t n)
+    {
+        if (!m_ok || std::size_t(m_end - m_p) < n) { m_ok = false; return nullptr; }
+        const std::byte* p = m_p;
+        m_p += n;
+        return p;
+    }
+
+    const std::byte* m_p;
+    const std::byte* m_end;
+    bool m_ok = true;
+};
+
+// The user-editable fields of each supported component, in a fixed order.
+// Caches, GPU handles and simulation state are left out. Structs are listed
+// member by member so padding bytes never show up as changes.
+template <class C> struct UndoFields;
+
+template <> struct UndoFields<TransformComponent> {
+    template <class A> static void visit(A& a, TransformComponent& t) { a(t.translation)(t.rotation)(t.scale); }
+};
+
+template <> struct UndoFields<FieldVisualizerComponent> {
+    template <class A> static void visit(A& a, FieldVisualizerComponent& v)
+    {
+        a(v.isEnabled)(v.displayMode)(v.bounds)(v.useBakedField)(v.bakeResolution);
+        a(v.temporalSettings.enabled)(v.temporalSettings.keyInterval)(v.temporalSettings.slicesPerTick);
+
+        auto& arrows = v.arrowSettings;
+        a(arrows.density)(arrows.vectorScale)(arrows.headScale)(arrows.intensityMultiplier)(arrows.cullingThreshold)
+            (arrows.scaleByLength)(arrows.lengthScaleMultiplier)(arrows.scaleByThickness)(arrows.thicknessScaleMultiplier)
+            (arrows.adaptive)(arrows.refineLevels)(arrows.refineThreshold)
+            (arrows.coloringMode)(arrows.xPosColor)(arrows.xNegColor)(arrows.yPosColor)(arrows.yNegColor)
+            (arrows.zPosColor)(arrows.zNegColor)(arrows.intensityGradient);
+
+        auto& flow = v.flowSettings;
+        a(flow.particleCount)(flow.lifetime)(flow.baseSpeed)(flow.speedIntensityMultiplier)(flow.baseSize)
+            (flow.headScale)(flow.peakSizeMultiplier)(flow.minSize)(flow.growthPercentage)(flow.shrinkPercentage)
+            (flow.randomWalkStrength)(flow.scaleByLength)(flow.lengthScaleMultiplier)(flow.scaleByThickness)
+            (flow.thicknessScaleMultiplier)(flow.coloringMode);
+
+        auto& particles = v.particleSettings;
+        a(particles.isSolid)(particles.particleCount)(particles.lifetime)(particles.baseSpeed)
+            (particles.speedIntensityMultiplier)(particles.baseSize)(particles.peakSizeMultiplier)(particles.minSize)
+            (particles.baseGlowSize)(particles.peakGlowMultiplier)(particles.minGlowSize)(particles.randomWalkStrength)(particles.emissionRate)
+            (particles.coloringMode)(particles.xPosColor)(particles.xNegColor)(particles.yPosColor)(particles.yNegColor)
+            (particles.zPosColor)(particles.zNegColor)(particles.intensityGradient)(particles.lifetimeGradient);
+
+        auto& lines = v.streamlineSettings;
+        a(lines.seedDensity)(lines.maxSteps)(lines.stepLength)(lines.minSpeed)(lines.thickness)
+            (lines.glowColour)(lines.coreColour);
+
+        if constexpr (A::reading) v.isGpuDataDirty = true;
+    }
+};
+
+template <> struct UndoFields<GridComponent> {
+    template <class A> static void visit(A& a, GridComponent& g)
+    {
+        a(g.masterVisible)(g.levelVisible)(g.levels)(g.baseLineWidthPixels)(g.showAxes)(g.isMetric)
+            (g.showIntersections)(g.isDotted)(g.snappingEnabled)(g.xAxisColor)(g.zAxisColor)(g.axisLineWidthPixels);
+    }
+};
+
+template <> struct UndoFields<MaterialComponent> {
+    template <class A> static void visit(A& a, MaterialComponent& m) { a(m.albedo)(m.metallic)(m.roughness)(m.emissive); }
+};
+
+template <> struct UndoFields<TagComponent> {
+    template <class A> static void visit(A& a, TagComponent& t) { a(t.tag); }
+};
+
+struct Codec {
+    bool (*encode)(const entt::registry&, entt::entity, Bytes&);
+    bool (*decode)(entt::registry&, entt::entity, const Bytes&);
+};
+
+template <class C> Codec codecFor()
+{
+    return {
+        [](const entt::registry& registry, entt::entity entity, Bytes& out) {
+            const C* component = registry.try_get<C>(entity);
+            if (!component) return false;
+            out.clear();
+            FieldWriter writer(out);
+            UndoFields<C>::visit(writer, const_cast<C&>(*component));   // the writer only reads
+            return true;
+        },
+        [](entt::registry& registry, entt::entity entity, const Bytes& image) {
+            const C* component = registry.try_get<C>(entity);
+            if (!component) return false;
+            C value = *component;
+            FieldReader reader(image.data(), image.size());
+            UndoFields<C>::visit(reader, value);
+            if (!reader.ok()) return false;
+            registry.replace<C>(entity, std::move(value));
+            return true;
+        },
+    };
+}
+
+const Codec* findCodec(entt::id_type type)
+{
+    static const std::unordered_map<entt::id_type, Codec> codecs = {
+        { entt::type_hash<TransformComponent>::value(), codecFor<TransformComponent>() },
+        { entt::type_hash<FieldVisualizerComponent>::value(), codecFor<FieldVisualizerComponent>() },
+        { entt::type_hash<GridComponent>::value(), codecFor<GridComponent>() },
+        { entt::type_hash<MaterialComponent>::value(), codecFor<MaterialComponent>() },
+        { entt::type_hash<TagComponent>::value(), codecFor<TagComponent>() },
+    };
+    const auto it = codecs.find(type);
+    return it == codecs.end() ? nullptr : &it->second;
+}
+
+/* ------------------------------------------------------------ */
+/*  Deltas                                                       */
+/* ------------------------------------------------------------ */
+
+// A step's record is a sequence of deltas, one per changed component: the
+// header, runCount x { offset, length, XOR of old and new bytes } within the
+// common prefix, then the old tail [prefix, oldSize) and the new tail
+// [prefix, newSize). Nothing is aligned; everything is read with memcpy.
+struct DeltaHeader {
+    std::uint32_t entity, type, oldSize, newSize, runCount, runBytes;
+};
+
+struct Delta {
+    DeltaHeader h;
+    const std::byte* begin;
+    const std::byte* runs;
+    const std::byte* oldTail;
+    const std::byte* newTail;
+
+    std::size_t prefix() const { return std::min(h.oldSize, h.newSize); }
+    const std::byte* end() const { return newTail + (h.newSize - prefix()); }
+};
+
+template <class T> void put(Bytes& out, T value)
+{
+    const auto* p = reinterpret_cast<const std::byte*>(&value);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <class T> T get(const std::byte* p)
+{
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+Delta readDelta(const std::byte* p)
+{
+    Delta d;
+    std::memcpy(&d.h, p, sizeof d.h);
+    d.begin = p;
+    d.runs = p + sizeof d.h;
+    d.oldTail = d.runs + d.h.runBytes;
+    d.newTail = d.oldTail + (d.h.oldSize - d.prefix());
+    return d;
+}
+
+// Appends the delta turning 'from' into 'to'. False (nothing written) if equal.
+bool appendDelta(Bytes& out, entt::entity entity, entt::id_type type, const Bytes& from, const Bytes& to)
+{
+    if (from == to) return false;
+    const std::size_t prefix = std::min(from.size(), to.size());
+    DeltaHeader h{ entt::to_integral(entity), type, std::uint32_t(from.size()), std::uint32_t(to.size()), 0, 0 };
+
+    const std::size_t headerAt = out.size();
+    out.resize(headerAt + sizeof h);
+    const std::size_t runsAt = out.size();
+    for (std::size_t i = 0; i < prefix;) {
+        if (from[i] == to[i]) { ++i; continue; }
+        std::size_t last = i;
+        for (std::size_t j = i + 1; j < prefix && j - last <= kRunGap; ++j)
+            if (from[j] != to[j]) last = j;
+        put(out, std::uint32_t(i));
+        put(out, std::uint32_t(last + 1 - i));
+        for (std::size_t k = i; k <= last; ++k) out.push_back(from[k] ^ to[k]);
+        ++h.runCount;
+        i = last + 1;
+    }
+    h.runBytes = std::uint32_t(out.size() - runsAt);
+    out.insert(out.end(), from.begin() + prefix, from.end());
+    out.insert(out.end(), to.begin() + prefix, to.end());
+    std::memcpy(out.data() + headerAt, &h, sizeof h);
+    return true;
+}
+
+// Turns the old image into the new one (forward) or back. False if 'image'
+// is not the size the delta starts from.
+bool applyDelta(const Delta& d, Bytes& image, bool forward)
+{
+    if (image.size() != (forward ? d.h.oldSize : d.h.newSize)) return false;
+    const std::byte* p = d.runs;
+    for (std::uint32_t r = 0; r < d.h.runCount; ++r) {
+        const auto offset = get<std::uint32_t>(p);
+        const auto length = get<std::uint32_t>(p + 4);
+        p += 8;
+        for (std::uint32_t k = 0; k < length; ++k) image[offset + k] ^= p[k];
+        p += length;
+    }
+    const std::size_t prefix = d.prefix();
+    const std::byte* tail = forward ? d.newTail : d.oldTail;
+    image.resize(prefix);
+    image.insert(image.end(), tail, tail + ((forward ? d.h.newSize : d.h.oldSize) - prefix));
+    return true;
+}
+
+} // namespace
+
+UndoStack::Scope::Scope(UndoStack& stack, entt::registry& registry, const char* label)
+    : m_stack(stack), m_registry(registry)
+{
+    m_stack.begin(label);
+}
+
+UndoStack::Scope::~Scope()
+{
+    m_stack.end(m_registry);
+}
+
+UndoStack::UndoStack(std::size_t arenaBytes)
+    : m_arena(arenaBytes)
+{
+}
+
+void UndoStack::begin(const char* label)
+{
+    if (m_depth++ == 0) m_label = label;
+}
+
+void UndoStack::track(entt::registry& registry, entt::entity entity, entt::id_type type)
+{
+    if (m_depth == 0) {
+        qWarning() << "[UndoStack] track() outside a Scope is ignored.";
+        return;
+    }
+    const Codec* codec = findCodec(type);
+    if (!codec) {
+        qWarning() << "[UndoStack] No field list for component type" << type;
+        return;
+    }
+    for (const Pending& p : m_pending)
+        if (p.entity == entity && p.type == type) return;
+
+    Pending p{ entity, type, {}, {} };
+    if (registry.valid(entity) && codec->encode(registry, entity, p.before))
+        m_pending.push_back(std::move(p));
+}
+
+void UndoStack::end(entt::registry& registry)
+{
+    if (--m_depth > 0) return;
+
+    m_record.clear();
+    for (Pending& p : m_pending) {
+        p.present = registry.valid(p.entity) && findCodec(p.type)->encode(registry, p.entity, p.after);
+        if (p.present) appendDelta(m_record, p.entity, p.type, p.before, p.after);
+    }
+    if (!m_record.empty()) {
+        const Clock::time_point now = Clock::now();
+        if (!mergeIntoTop(now)) push(m_record, now);
+    }
+    m_pending.clear();
+}
+
+bool UndoStack::mergeIntoTop(Clock::time_point now)
+{
+    if (m_cursor == 0 || m_cursor != m_steps.size()) return false;
+    const Step& top = m_steps.back();
+    if (top.label != m_label || now - top.lastEdit > kMergeWindow) return false;
+
+    // The top step ended where this edit began: run it backwards from the
+    // tracked 'before' images to get the state before both edits.
+    m_scratch.clear();
+    std::vector<bool> merged(m_pending.size(), false);
+    const std::byte* end = m_arena.data() + top.offset + top.size;
+    for (const std::byte* p = m_arena.data() + top.offset; p < end;) {
+        const Delta d = readDelta(p);
+        p = d.end();
+        const auto entity = entt::entity{ d.h.entity };
+        const auto it = std::find_if(m_pending.begin(), m_pending.end(),
+            [&](const Pending& x) { return x.entity == entity && x.type == d.h.type; });
+        if (it == m_pending.end() || !it->present) {
+            m_scratch.insert(m_scratch.end(), d.begin, d.end());   // untouched this time
+            continue;
+        }
+        m_image = it->before;
+        if (!applyDelta(d, m_image, false)) return false;
+        merged[it - m_pending.begin()] = true;
+        appendDelta(m_scratch, entity, d.h.type, m_image, it->after);
+    }
+    for (std::size_t i = 0; i < m_pending.size(); ++i) {
+        const Pending& p = m_pending[i];
+        if (!merged[i] && p.present) appendDelta(m_scratch, p.entity, p.type, p.before, p.after);
+    }
+
+    m_steps.pop_back();
+    --m_cursor;
+    if (!m_scratch.empty()) push(m_scratch, now);   // empty: the edits cancelled out
+    return true;
+}
+
+void UndoStack::push(const Bytes& record, Clock::time_point now)
+{
+    // A new edit discards whatever could have been redone.
+    m_steps.erase(m_steps.begin() + std::ptrdiff_t(m_cursor), m_steps.end());
+
+    const std::size_t n = record.size();
+    if (n > m_arena.size()) {
+        qWarning() << "[UndoStack] An edit of" << n << "bytes does not fit the undo arena; history cleared.";
+        clear();
+        return;
+    }
+
+    std::size_t offset = m_steps.empty() ? 0 : m_steps.back().offset + m_steps.back().size;
+    if (offset + n > m_arena.size()) {
+        // Wrap. Steps still in the skipped tail are the oldest of all.
+        while (!m_steps.empty() && m_steps.front().offset >= offset) m_steps.pop_front();
+        offset = 0;
+    }
+    // Drop the oldest steps this record overwrites.
+    while (!m_steps.empty() && m_steps.front().offset < offset + n
+        && offset < m_steps.front().offset + m_steps.front().size)
+        m_steps.pop_front();
+
+    std::memcpy(m_arena.data() + offset, record.data(), n);
+    m_steps.push_back({ offset, n, m_label, now });
+    m_cursor = m_steps.size();
+}
+
+bool UndoStack::apply(entt::registry& registry, const Step& step, bool forward)
+{
+    bool changed = false;
+    const std::byte* end = m_arena.data() + step.offset + step.size;
+    for (const std::byte* p = m_arena.data() + step.offset; p < end;) {
+        const Delta d = readDelta(p);
+        p = d.end();
+        const auto entity = entt::entity{ d.h.entity };
+        const Codec* codec = findCodec(d.h.type);
+        if (!codec || !registry.valid(entity) || !codec->encode(registry, entity, m_image)) continue;
+        if (!applyDelta(d, m_image, forward)) {
+            qWarning() << "[UndoStack]" << step.label.c_str() << ": component was resized outside the history, skipped.";
+            continue;
+        }
+        changed |= codec->decode(registry, entity, m_image);
+    }
+    return changed;
+}
+
+bool UndoStack::undo(entt::registry& registry)
+{
+    if (!canUndo()) return false;
+    apply(registry, m_steps[--m_cursor], false);
+    return true;
+}
+
+bool UndoStack::redo(entt::registry& registry)
+{
+    if (!canRedo()) return false;
+    Step& step = m_steps[m_cursor++];
+    step.lastEdit = {};   // a fresh edit starts its own step
+    apply(registry, step, true);
+    return true;
+}
+
+void UndoStack::clear()
+{
+    m_steps.clear();
+    m_cursor = 0;
+}
+
+std::size_t UndoStack::bytesUsed() const
+{
+    std::size_t bytes = 0;
+    for (const Step& s : m_steps) bytes += s.size;
+    return bytes;
+}
@@ -0,0 +1,87 @@
+#include "VideoEncoder.hpp"
+
+#include <QImage>
+#include <QDebug>
+
+VideoEncoder::~VideoEncoder()
+{
+    if (isOpen()) close();
+}
+
+bool VideoEncoder::open(const Settings& settings)
+{
+    if (isOpen() || settings.width <= 0 || settings.height <= 0) return false;
+    m_settings = settings;
+
+    const QString size = QStringLiteral("%1x%2").arg(settings.width).arg(settings.height);
+    QStringList args{
+        "-hide_banner", "-loglevel", "error", "-y",
+        "-f", "rawvideo", "-pix_fmt", "rgb0", "-s", size,
+        "-r", QString::number(settings.fps), "-i", "-",
+        "-c:v", settings.codec, "-pix_fmt", "yuv420p",
+    };
+    args += settings.extraArgs;
+    if (!settings.format.isEmpty()) args << "-f" << settings.format;
+    args << (settings.output ? QStringLiteral("pipe:1") : settings.path);
+
+    QObject::disconnect(m_outputConnection);
+    if (settings.output) {
+        m_outputConnection = QObject::connect(&m_process, &QProcess::readyReadStandardOutput, [this]() {
+            const QByteArray bytes = m_process.readAllStandardOutput();
+            if (!bytes.isEmpty() && m_settings.output) m_settings.output(bytes);
+        });
+    }
+    m_process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    m_process.start(settings.program, args, settings.output ? QIODevice::ReadWrite : QIODevice::WriteOnly);
+    if (!m_process.waitForStarted()) {
+        qCritical() << "[VideoEncoder] Could not start" << settings.program << ":" << m_process.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool VideoEncoder::write(const QImage& frame)
+{
+    if (!isOpen() || frame.width() != m_settings.width || frame.height() != m_settings.height)
+        return false;
+
+    // RGBX8888 rows are already tightly packed, matching ffmpeg's rgb0.
+    const QImage packed = frame.format() == QImage::Format_RGBX8888
+        ? frame : frame.convertToFormat(QImage::Format_RGBX8888);
+    const qint64 frameBytes = qint64(packed.sizeInBytes());
+    if (m_process.write(reinterpret_cast<const char*>(packed.constBits()), frameBytes) != frameBytes)
+        return false;
+
+    while (m_process.bytesToWrite() > kBufferedFrames * frameBytes) {
+        if (!m_process.waitForBytesWritten(-1)) return false;
+    }
+    return true;
+}
+
+bool VideoEncoder::close()
+{
+    if (!isOpen()) return false;
+    m_process.closeWriteChannel();
+    m_process.waitForFinished(-1);
+    return m_process.exitStatus() == QProcess::NormalExit && m_process.exitCode() == 0;
+}
+
+void VideoEncoder::abort()
+{
+    if (!isOpen()) return;
+    QObject::disconnect(m_outputConnection);
+    m_process.kill();
+    m_process.waitForFinished(-1);
+}
+
+bool VideoEncoder::ready() const
+{
+    // write() waits once more than kBufferedFrames are queued, counting the new one.
+    const qint64 frameBytes = qint64(m_settings.width) * m_settings.height * 4;
+    return isOpen() && m_process.bytesToWrite() <= (kBufferedFrames - 1) * frameBytes;
+}
+
+QString VideoEncoder::errorString() const
+{
+    return m_process.errorString();
+}
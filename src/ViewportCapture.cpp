@@ -0,0 +1,82 @@
+#include "ViewportCapture.hpp"
+#include "GpuMemory.hpp"
+
+#include <QImage>
+#include <QOpenGLFunctions_4_3_Core>
+#include <cstring>
+
+void ViewportCapture::capture(QOpenGLFunctions_4_3_Core& gl, GLuint fbo, int width, int height)
+{
+    collect(gl);
+
+    width &= ~1;
+    height &= ~1;
+    if (width <= 0 || height <= 0) return;
+    if (m_sinceCapture.isValid() && m_sinceCapture.elapsed() < m_minIntervalMs) return;
+    if (m_pending == kSlots) {
+        ++m_skipped;
+        return;
+    }
+
+    Slot& slot = m_slots[m_head];
+    const GLsizeiptr bytes = GLsizeiptr(width) * height * 4;
+    if (!slot.pbo) gl.glGenBuffers(1, &slot.pbo);
+    gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (slot.capacity < bytes) {
+        GpuMemory::bufferData(&gl, GL_PIXEL_PACK_BUFFER, slot.pbo, bytes, nullptr, GL_STREAM_READ, GpuMemory::Category::Readback);
+        slot.capacity = bytes;
+    }
+    gl.glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    gl.glReadBuffer(fbo ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+    gl.glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    gl.glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = gl.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    m_head = (m_head + 1) % kSlots;
+    ++m_pending;
+    m_sinceCapture.start();
+}
+
+void ViewportCapture::collect(QOpenGLFunctions_4_3_Core& gl)
+{
+    // Reads complete in order; retire every landed one but map only the newest.
+    Slot* newest = nullptr;
+    while (m_pending > 0) {
+        Slot& slot = m_slots[(m_head - m_pending + kSlots) % kSlots];
+        const GLenum result = gl.glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (result == GL_TIMEOUT_EXPIRED) break;
+        gl.glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        --m_pending;
+        if (result != GL_WAIT_FAILED) newest = &slot;
+    }
+    if (!newest || !m_sink) return;
+
+    const std::size_t rowBytes = std::size_t(newest->width) * 4;
+    gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, newest->pbo);
+    if (const auto* pixels = static_cast<const uchar*>(gl.glMapBufferRange(
+            GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(rowBytes * newest->height), GL_MAP_READ_BIT))) {
+        // GL rows start at the bottom.
+        QImage frame(newest->width, newest->height, QImage::Format_RGBX8888);
+        for (int y = 0; y < newest->height; ++y)
+            std::memcpy(frame.scanLine(newest->height - 1 - y), pixels + rowBytes * y, rowBytes);
+        gl.glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        m_sink(frame);
+    }
+    gl.glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void ViewportCapture::release(QOpenGLFunctions_4_3_Core& gl)
+{
+    for (Slot& slot : m_slots) {
+        if (slot.fence) gl.glDeleteSync(slot.fence);
+        if (slot.pbo) GpuMemory::deleteBuffers(&gl, 1, &slot.pbo);
+        slot = Slot{};
+    }
+    m_head = 0;
+    m_pending = 0;
+    m_sinceCapture.invalidate();
+}
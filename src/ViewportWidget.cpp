@@ -8,46 +8,43 @@
 #include <QWheelEvent>
 #include <QKeyEvent>
 #include <QCloseEvent>
+#include <QFocusEvent>
 #include <QDebug>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
+#include <utility>
 #include <QMessageBox>
+#include <QCursor>
+#include <QPainter>
+#include <QStandardPaths>
+#include <QDateTime>
+#include <QDir>
 
 #include "ViewportWidget.hpp"
+#include "PerfHud.hpp"
 #include "RenderingSystem.hpp"
 #include "Scene.hpp"
 #include "Camera.hpp"
 #include "Shader.hpp"
 #include "components.hpp"
 #include "IntersectionSystem.hpp"
+#include "KinematicModel.hpp"
+#include "KinematicSystem.hpp"
 #include "DebugHelpers.hpp"
 #include "LedTweakDialog.hpp"
 #include "FieldSolver.hpp"
+#include "Trace.hpp"
+#include "TraceZones.hpp"
+#include "TransformSystem.hpp"
+#include "ViewportCapture.hpp"
 
 int ViewportWidget::s_instanceCounter = 0;
 
 void ViewportWidget::propagateTransforms(entt::registry& r)
 {
-    auto viewParents = r.view<ParentComponent>(); // cache once
-
-    std::function<void(entt::entity, const glm::mat4&)> dfs =
-        [&](entt::entity e, const glm::mat4& parentW)
-        {
-            glm::mat4 local = r.get<TransformComponent>(e).getTransform();
-            glm::mat4 world = parentW * local;
-
-            r.emplace_or_replace<WorldTransformComponent>(e, world);
-
-            // recurse through children of e
-            for (auto child : viewParents) {
-                if (viewParents.get<ParentComponent>(child).parent == e)
-                    dfs(child, world);
-            }
-        };
-
-    // Process all root entities (those without a ParentComponent)
-    for (auto e : r.view<TransformComponent>(entt::exclude<ParentComponent>))
-        dfs(e, glm::mat4(1.0f));
+    TransformSystem::propagate(r);
 }
 
 ViewportWidget::ViewportWidget(Scene* scene, RenderingSystem* renderingSystem, entt::entity cameraEntity, QWidget* parent)
@@ -64,9 +61,20 @@ ViewportWidget::ViewportWidget(Scene* scene, RenderingSystem* renderingSystem, e
     format.setStencilBufferSize(8);
     format.setVersion(4, 3);
     format.setProfile(QSurfaceFormat::CoreProfile);
-    format.setOption(QSurfaceFormat::DebugContext);
+    format.setOption(QSurfaceFormat::DebugContext, QSurfaceFormat::defaultFormat().testOption(QSurfaceFormat::DebugContext));
     setFormat(format);
     setFocusPolicy(Qt::StrongFocus);
+
+    // Dynamic resolution only pays off while the view moves; once it has
+    // been still for a moment, draw one sharp frame.
+    m_refineTimer = new QTimer(this);
+    m_refineTimer->setSingleShot(true);
+    m_refineTimer->setInterval(250);
+    connect(m_refineTimer, &QTimer::timeout, this, [this]() {
+        if (!m_renderingSystem) return;
+        m_renderingSystem->requestFullResolution(this);
+        update();
+        });
 }
 
 void ViewportWidget::setRenderingSystem(RenderingSystem* system)
@@ -94,14 +102,21 @@ void ViewportWidget::shutdown()
     
     glDeleteVertexArrays(1, &m_outlineVAO);
     glDeleteBuffers(1, &m_outlineVBO);
+    if (m_frameTap) {
+        m_frameTap->release(*this);
+        m_frameTap = nullptr;
+    }
+    if (m_frameFence) {
+        glDeleteSync(m_frameFence);
+        m_frameFence = nullptr;
+    }
     doneCurrent();
 }
 
 void ViewportWidget::paintGL()
 {
-    //! DEBUG: Announce which viewport is starting its paint event.
-    qDebug().nospace() << "========================================";
-    qDebug() << "[PAINT EVENT] Starting for ViewportWidget instance:" << this;
+    KR_ZONE("paint viewport");
+    KR_TRACE(Frame) << "[PAINT EVENT] Starting for ViewportWidget instance:" << this;
 
     if (!m_renderingSystem || !m_renderingSystem->isInitialized()) {
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -109,6 +124,11 @@ void ViewportWidget::paintGL()
         return;
     }
 
+    // Sampled as late as possible, so the frame shows input that arrived
+    // after the master tick asked for it.
+    applyInput();
+    if (m_measuring) updateSnap();
+
     // Get the framebuffer dimensions for this specific viewport.
     const int fbW = static_cast<int>(width() * devicePixelRatioF());
     const int fbH = static_cast<int>(height() * devicePixelRatioF());
@@ -116,50 +136,283 @@ void ViewportWidget::paintGL()
     // Tell the rendering system to render a complete frame for this view.
     // We pass our specific camera and dimensions.
     m_renderingSystem->renderView(this, m_scene->getRegistry(), m_cameraEntity, fbW, fbH);
+    // A stereo view is painted once per eye; the tap records the left one.
+    bool rightEye = false;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    rightEye = currentTargetBuffer() == QOpenGLWidget::RightBuffer;
+#endif
+    if (m_frameTap && !rightEye) m_frameTap->capture(*this, defaultFramebufferObject(), fbW, fbH);   // before the overlays
+
+    if (m_pickPending) applyPickResult();
+    if (m_perfHud && m_perfHud->visible()) {
+        const GpuProfiler* prof = m_renderingSystem->profiler(this);
+        if (prof) m_perfHud->recordGpu(this, prof->lastGpuFrameMs());
+        QPainter painter(this);
+        m_perfHud->paint(painter, rect(), this, prof, &m_renderingSystem->computeDispatch());
+    }
+    else if (m_renderingSystem->profilingEnabled()) drawProfilerOverlay();
+    if (m_measuring) drawMeasureOverlay();
+    if (m_renderingSystem->renderScale(this) < 1.0f) m_refineTimer->start();
+
+    m_lastViewProj = currentViewProj();
+    m_forceRedraw = m_pickPending;
 }
 
-void ViewportWidget::renderNow()
+glm::mat4 ViewportWidget::currentViewProj()
 {
-    if (isVisible() && context()) {
-        makeCurrent();
-        paintGL();
+    const int fbW = static_cast<int>(width() * devicePixelRatioF());
+    const int fbH = static_cast<int>(height() * devicePixelRatioF());
+    const float aspect = (fbH > 0) ? static_cast<float>(fbW) / fbH : 1.0f;
+    const Camera& cam = getCamera();
+    return cam.getProjectionMatrix(aspect) * cam.getViewMatrix();
+}
 
-        //! DIAGNOSTIC: Force the GPU to finish all drawing for this viewport
-        //! before the CPU is allowed to continue to the next one.
-        glFinish();
+void ViewportWidget::drawProfilerOverlay()
+{
+    const GpuProfiler* prof = m_renderingSystem->profiler(this);
+    if (!prof || prof->timings().empty()) return;
+
+    QString text = QStringLiteral("%1  GPU ms   CPU ms\n").arg(QString(), -18);
+    for (const auto& t : prof->timings())
+        text += QStringLiteral("%1%2 %3\n").arg(QString::fromStdString(t.name), -18)
+            .arg(t.gpuMs, 7, 'f', 3).arg(t.cpuMs, 8, 'f', 3);
+    text += QStringLiteral("%1%2 %3").arg(QStringLiteral("total"), -18)
+        .arg(prof->gpuFrameMs(), 7, 'f', 3).arg(prof->cpuFrameMs(), 8, 'f', 3);
+    if (m_renderingSystem->dynamicResolution())
+        text += QStringLiteral("\nrender scale %1 (F5 to toggle)").arg(m_renderingSystem->renderScale(this), 0, 'f', 2);
+    if (m_renderingSystem->profileCapture()) text += QStringLiteral("\n[capturing trace - F4 to stop]");
+
+    QPainter painter(this);
+    QFont font(QStringLiteral("Consolas"));
+    font.setStyleHint(QFont::Monospace);
+    font.setPointSize(9);
+    painter.setFont(font);
+    const QRect box = painter.boundingRect(QRect(8, 8, width(), height()), Qt::AlignLeft | Qt::AlignTop, text)
+        .adjusted(-6, -4, 6, 4);
+    painter.fillRect(box, QColor(0, 0, 0, 160));
+    painter.setPen(Qt::white);
+    painter.drawText(box.adjusted(6, 4, -6, -4), Qt::AlignLeft | Qt::AlignTop, text);
+}
 
-        context()->swapBuffers(context()->surface());
-        doneCurrent();
+void ViewportWidget::updateSnap()
+{
+    if (height() <= 0) return;
+    const Camera& cam = getCamera();
+    const glm::mat4 viewProj = cam.getProjectionMatrix(static_cast<float>(width()) / height()) * cam.getViewMatrix();
+    if (!m_snapPending && viewProj == m_snapViewProj) return;
+
+    KR_ZONE("snap cursor");
+    m_snap = IntersectionSystem::snapPoint(*m_scene, cam, width(), height(), m_snapCursor.x(), m_snapCursor.y());
+    m_snapViewProj = viewProj;
+    m_snapPending = false;
+}
+
+void ViewportWidget::drawMeasureOverlay()
+{
+    // World -> widget pixels with the camera the snap was found with.
+    auto project = [this](const glm::vec3& p, QPointF& out) {
+        const glm::vec4 clip = m_snapViewProj * glm::vec4(p, 1.0f);
+        if (clip.w <= 1e-6f) return false;   // behind the camera
+        out = QPointF((clip.x / clip.w + 1.0f) * 0.5f * width(), (1.0f - clip.y / clip.w) * 0.5f * height());
+        return true;
+    };
+    auto length = [](float metres) {
+        return metres < 1.0f ? QStringLiteral("%1 mm").arg(metres * 1000.0f, 0, 'f', 1)
+                             : QStringLiteral("%1 m").arg(metres, 0, 'f', 3);
+    };
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    QFont font(QStringLiteral("Consolas"));
+    font.setStyleHint(QFont::Monospace);
+    font.setPointSize(9);
+    painter.setFont(font);
+
+    const bool live = m_snap.kind != IntersectionSystem::SnapKind::None;
+    std::vector<glm::vec3> points = m_measurePoints;
+    if (live && !points.empty()) points.push_back(m_snap.point);   // the segment still being placed
+
+    float total = 0.0f;
+    for (std::size_t i = 0; i + 1 < points.size(); ++i) {
+        const float d = glm::length(points[i + 1] - points[i]);
+        total += d;
+        QPointF a, b;
+        if (!project(points[i], a) || !project(points[i + 1], b)) continue;
+        const bool placing = live && i + 2 == points.size();
+        painter.setPen(QPen(placing ? QColor(255, 210, 60) : QColor(80, 200, 255), 1.5, placing ? Qt::DashLine : Qt::SolidLine));
+        painter.drawLine(a, b);
+        painter.setPen(Qt::white);
+        painter.drawText((a + b) * 0.5 + QPointF(6, -6), length(d));
+    }
+    painter.setPen(QPen(QColor(80, 200, 255), 1.5));
+    for (const glm::vec3& p : m_measurePoints) {
+        QPointF s;
+        if (project(p, s)) painter.drawEllipse(s, 3.0, 3.0);
+    }
+
+    // The snap marker: square on a corner, diamond on an edge, circle on a
+    // face, cross on a grid crossing.
+    QPointF c;
+    if (live && project(m_snap.point, c)) {
+        constexpr double r = 6.0;
+        painter.setPen(QPen(QColor(255, 210, 60), 2.0));
+        painter.setBrush(Qt::NoBrush);
+        switch (m_snap.kind) {
+        case IntersectionSystem::SnapKind::Vertex:
+            painter.drawRect(QRectF(c.x() - r, c.y() - r, 2 * r, 2 * r));
+            break;
+        case IntersectionSystem::SnapKind::Edge: {
+            const QPointF diamond[4] = { c + QPointF(0, -r), c + QPointF(r, 0), c + QPointF(0, r), c + QPointF(-r, 0) };
+            painter.drawPolygon(diamond, 4);
+            break;
+        }
+        case IntersectionSystem::SnapKind::Face:
+            painter.drawEllipse(c, r, r);
+            break;
+        default:
+            painter.drawLine(c + QPointF(-r, 0), c + QPointF(r, 0));
+            painter.drawLine(c + QPointF(0, -r), c + QPointF(0, r));
+            break;
+        }
+    }
+
+    QString text = QStringLiteral("Measure (M to leave, Esc to clear)");
+    if (live) {
+        static const char* kinds[] = { "", "vertex", "edge", "face", "grid" };
+        text += QStringLiteral("\n%1 %2 %3 %4").arg(QString::fromLatin1(kinds[int(m_snap.kind)]), -6)
+            .arg(m_snap.point.x, 0, 'f', 3).arg(m_snap.point.y, 0, 'f', 3).arg(m_snap.point.z, 0, 'f', 3);
     }
+    if (points.size() > 2) text += QStringLiteral("\ntotal %1").arg(length(total));
+    const QRect box = painter.boundingRect(QRect(8, 0, width(), height() - 8), Qt::AlignLeft | Qt::AlignBottom, text)
+        .adjusted(-6, -4, 6, 4);
+    painter.fillRect(box, QColor(0, 0, 0, 160));
+    painter.setPen(Qt::white);
+    painter.drawText(box.adjusted(6, 4, -6, -4), Qt::AlignLeft | Qt::AlignBottom, text);
 }
 
-void ViewportWidget::updateAnimations(entt::registry& registry, float frameDt)
+void ViewportWidget::applyPickResult()
 {
-    // A persistent timer, just like in your example
-    static float timer = 0.f;
-    timer += frameDt;
+    std::vector<entt::entity> picked;
+    if (!m_renderingSystem->takePickResult(this, picked))
+        return;                                  // paintGL keeps m_forceRedraw set until it lands
+    m_pickPending = false;
 
-    // --- Pulsing Spline Logic ---
-    float pulseSpeed = 3.0f; // Controls how fast the pulse is. Higher is faster.
+    auto& registry = m_scene->getRegistry();
+    registry.clear<SelectedComponent>();
+    for (entt::entity e : picked) {
+        if (registry.valid(e)) {
+            registry.emplace<SelectedComponent>(e);
+            break;
+        }
+    }
+    emit sceneEdited();
+}
+
+bool ViewportWidget::needsRedraw()
+{
+    if (m_forceRedraw || hasPendingInput()) return true;
+    if (height() <= 0) return false;
+    // Same size and rounding as paintGL, so an idle viewport compares equal
+    // on fractional scale factors too.
+    return currentViewProj() != m_lastViewProj;
+}
+
+unsigned ViewportWidget::navKeyOf(int key)
+{
+    switch (key) {
+    case Qt::Key_W: return KeyForward;
+    case Qt::Key_S: return KeyBackward;
+    case Qt::Key_A: return KeyLeft;
+    case Qt::Key_D: return KeyRight;
+    case Qt::Key_E: return KeyUp;
+    case Qt::Key_Q: return KeyDown;
+    default:        return 0;
+    }
+}
 
-    // A sine wave oscillates smoothly between -1.0 and 1.0.
-    // We map it to a 0.0 to 1.0 range to use as a brightness multiplier.
-    float brightness = (sin(timer * pulseSpeed) + 1.0f) / 2.0f;
+bool ViewportWidget::hasPendingInput() const
+{
+    return m_heldKeys != 0 || m_lookDelta != glm::vec2(0.0f) || m_orbitDelta != glm::vec2(0.0f)
+        || m_panDelta != glm::vec2(0.0f) || m_dollyDelta != 0.0f;
+}
 
-    // To prevent the glow from disappearing completely, we'll set a minimum brightness.
-    float minBrightness = 0.1f;
-    float finalBrightness = minBrightness + (1.0f - minBrightness) * brightness;
+void ViewportWidget::applyInput()
+{
+    if (!hasPendingInput()) return;
+    Camera& cam = getCamera();
 
-    // Find all entities that have BOTH a PulsingSplineTag and a SplineComponent
-    auto view = registry.view<PulsingSplineTag, SplineComponent>();
-    for (auto entity : view)
-    {
-        // Get the spline component for this entity
-        auto& spline = view.get<SplineComponent>(entity);
+    if (m_lookDelta != glm::vec2(0.0f))  cam.freeLook(m_lookDelta.x, m_lookDelta.y);
+    if (m_orbitDelta != glm::vec2(0.0f)) cam.orbit(m_orbitDelta.x, m_orbitDelta.y);
+    if (m_panDelta != glm::vec2(0.0f))   cam.pan(m_panDelta.x, m_panDelta.y, width(), height());
+    if (m_dollyDelta != 0.0f)            cam.dolly(m_dollyDelta);
+    m_lookDelta = m_orbitDelta = m_panDelta = glm::vec2(0.0f);
+    m_dollyDelta = 0.0f;
+
+    if (!m_heldKeys) return;
+    // Real time since the previous frame; clamped so a stall (modal dialog,
+    // breakpoint) does not throw the camera across the scene.
+    const float dt = std::clamp(static_cast<float>(m_inputClock.nsecsElapsed()) * 1e-9f, 0.0f, 0.1f);
+    m_inputClock.restart();
+
+    constexpr std::pair<unsigned, Camera::Camera_Movement> kMoves[] = {
+        { KeyForward, Camera::FORWARD }, { KeyBackward, Camera::BACKWARD }, { KeyLeft, Camera::LEFT },
+        { KeyRight, Camera::RIGHT }, { KeyUp, Camera::UP }, { KeyDown, Camera::DOWN } };
+    constexpr float kOrbitKeySpeed = 3.0f;        // the old 0.05 per key event at 60 Hz
+    for (const auto& [bit, dir] : kMoves) {
+        if (!(m_heldKeys & bit)) continue;
+        if (cam.navMode() == Camera::NavMode::FLY) cam.flyMove(dir, dt);
+        else                                       cam.move(dir, kOrbitKeySpeed * dt);
+    }
+}
+
+void ViewportWidget::requestRedraw()
+{
+    m_forceRedraw = true;
+    update();
+}
 
-        // Modulate the alpha of the glowColour to make it pulse.
-        // We set the base alpha to 1.0 and multiply by our pulsing brightness.
-        spline.glowColour.a = 1.0f * finalBrightness;
+void ViewportWidget::setFrameTap(ViewportCapture* tap)
+{
+    if (tap == m_frameTap) return;
+    if (m_frameTap && context()) {
+        makeCurrent();
+        m_frameTap->release(*this);
+        doneCurrent();
+    }
+    m_frameTap = tap;
+    requestRedraw();
+}
+
+void ViewportWidget::pollFrameTap()
+{
+    if (!m_frameTap || !m_frameTap->pending() || !context()) return;
+    makeCurrent();
+    m_frameTap->collect(*this);
+    doneCurrent();
+}
+
+void ViewportWidget::renderNow()
+{
+    if (isVisible() && context()) {
+        makeCurrent();
+
+        // Wait for the previous frame of this viewport only, instead of
+        // draining the whole pipeline with glFinish(). The GPU can keep
+        // working on this frame while the CPU moves to the next viewport.
+        if (m_frameFence) {
+            constexpr GLuint64 kOneMs = 1'000'000;
+            GLenum r = glClientWaitSync(m_frameFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            while (r == GL_TIMEOUT_EXPIRED)
+                r = glClientWaitSync(m_frameFence, 0, kOneMs);
+            glDeleteSync(m_frameFence);
+            m_frameFence = nullptr;
+        }
+
+        paintGL();
+        m_frameFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        context()->swapBuffers(context()->surface());
+        doneCurrent();
     }
 }
 
@@ -191,6 +444,7 @@ void ViewportWidget::resizeGL(int w, int h)
     const int ww = std::lround(w * devicePixelRatioF());
     const int hh = std::lround(h * devicePixelRatioF());
     m_renderingSystem->resize(ww, hh);                // single shared FBO
+    m_forceRedraw = true;
 }
 
 void ViewportWidget::mousePressEvent(QMouseEvent* ev)
@@ -201,10 +455,31 @@ void ViewportWidget::mousePressEvent(QMouseEvent* ev)
         getCamera().setNavMode(Camera::NavMode::FLY);
         setCursor(Qt::BlankCursor);
     }
-    if (ev->button() == Qt::LeftButton)
-        IntersectionSystem::selectObjectAt(*m_scene, *this, ev->pos().x(), ev->pos().y());
+    if (ev->button() == Qt::LeftButton && (ev->modifiers() & Qt::ControlModifier) && beginEndEffectorDrag(ev->pos()))
+    {
+        requestRedraw();
+    }
+    else if (ev->button() == Qt::LeftButton && m_measuring)
+    {
+        if (m_snap.kind != IntersectionSystem::SnapKind::None) m_measurePoints.push_back(m_snap.point);
+        requestRedraw();
+    }
+    else if (ev->button() == Qt::LeftButton)
+    {
+        // A stereo view's mesh pass has no ID attachment; it picks by ray.
+        if (m_renderingSystem && m_renderingSystem->idBufferPicking() && !m_renderingSystem->stereoActive(this)) {
+            // Resolved in paintGL once the ID-buffer read lands.
+            m_renderingSystem->requestPick(this, ev->pos().x(), ev->pos().y());
+            m_pickPending = true;
+            requestRedraw();
+        }
+        else {
+            IntersectionSystem::selectObjectAt(*m_scene,
+                IntersectionSystem::cameraRay(getCamera(), width(), height(), ev->pos().x(), ev->pos().y()));
+            emit sceneEdited();                  // selection highlight shows in every viewport
+        }
+    }
 
-    update();
     QOpenGLWidget::mousePressEvent(ev);
 }
 
@@ -214,66 +489,189 @@ void ViewportWidget::mouseReleaseEvent(QMouseEvent* ev)
         getCamera().setNavMode(Camera::NavMode::ORBIT);
         unsetCursor();
     }
+    if (ev->button() == Qt::LeftButton) m_dragRobot = entt::null;
     QOpenGLWidget::mouseReleaseEvent(ev);
 }
 
 void ViewportWidget::mouseMoveEvent(QMouseEvent* ev)
 {
-    int dx = ev->pos().x() - m_lastMousePos.x();
-    int dy = ev->pos().y() - m_lastMousePos.y();
-    Camera& cam = getCamera();
+    const glm::vec2 d(ev->pos().x() - m_lastMousePos.x(), ev->pos().y() - m_lastMousePos.y());
 
-    if (cam.navMode() == Camera::NavMode::FLY)            cam.freeLook(dx, dy);
+    // Summed until the next frame; the master loop sees hasPendingInput().
+    if (m_dragRobot != entt::null)                        dragEndEffector(ev->pos());
+    else if (getCamera().navMode() == Camera::NavMode::FLY) m_lookDelta += d;
     else if (ev->buttons() & Qt::MiddleButton ||
         (ev->buttons() & Qt::LeftButton && ev->modifiers() & Qt::ShiftModifier))
-        cam.pan(dx, dy, width(), height());
-    else if (ev->buttons() & Qt::LeftButton)              cam.orbit(dx, dy);
+        m_panDelta += d;
+    else if (ev->buttons() & Qt::LeftButton)              m_orbitDelta += d;
 
+    if (m_measuring) {
+        m_snapCursor = ev->pos();
+        m_snapPending = true;
+        requestRedraw();
+    }
     m_lastMousePos = ev->pos();
-    update();
+}
+
+bool ViewportWidget::beginEndEffectorDrag(const QPoint& pos)
+{
+    auto& registry = m_scene->getRegistry();
+    const auto ray = IntersectionSystem::cameraRay(getCamera(), width(), height(), pos.x(), pos.y());
+    entt::entity robot = entt::null;
+    for (entt::entity e = IntersectionSystem::pickEntity(*m_scene, ray); e != entt::null && robot == entt::null;) {
+        if (registry.all_of<RobotRootComponent>(e)) robot = e;
+        const auto* parent = registry.try_get<ParentComponent>(e);
+        e = parent ? parent->parent : entt::null;
+    }
+    const auto* kin = robot == entt::null ? nullptr : registry.try_get<KinematicModelComponent>(robot);
+    if (!kin || !kin->model || kin->model->dofCount() == 0) return false;
+
+    const int link = KinematicSystem::endEffectorLink(*kin->model);
+    const auto* tip = std::size_t(link) < kin->links.size() ? registry.try_get<WorldTransformComponent>(kin->links[link]) : nullptr;
+    if (!tip) return false;
+    m_dragRobot = robot;
+    m_dragLink = link;
+    m_dragPlanePoint = glm::vec3(tip->matrix[3]);
+    return true;
+}
+
+void ViewportWidget::dragEndEffector(const QPoint& pos)
+{
+    auto& registry = m_scene->getRegistry();
+    if (!registry.valid(m_dragRobot)) {
+        m_dragRobot = entt::null;
+        return;
+    }
+    const Camera& camera = getCamera();
+    const glm::vec3 normal = glm::normalize(camera.getFocalPoint() - camera.getPosition());
+    const auto ray = IntersectionSystem::cameraRay(camera, width(), height(), pos.x(), pos.y());
+    const float facing = glm::dot(ray.dir, normal);
+    if (std::abs(facing) < 1e-4f) return;   // ray along the plane
+
+    KinematicModel::Pose target;
+    target.translation = ray.origin + ray.dir * (glm::dot(m_dragPlanePoint - ray.origin, normal) / facing);
+    KinematicSystem::solveEndEffector(registry, m_dragRobot, m_dragLink, target);
+    emit sceneEdited();                      // the joints tick shows the solution in every viewport
+    requestRedraw();
 }
 
 void ViewportWidget::wheelEvent(QWheelEvent* event) {
-    getCamera().dolly(event->angleDelta().y());
-    update();
+    m_dollyDelta += event->angleDelta().y();
 }
 
 void ViewportWidget::keyPressEvent(QKeyEvent* ev)
 {
-    float dt = 1.0f / 60.0f;                      // per-frame step
-    Camera& cam = getCamera();
 
-    if (cam.navMode() == Camera::NavMode::FLY) {
-        switch (ev->key()) {
-        case Qt::Key_W: cam.flyMove(Camera::FORWARD, dt); break;
-        case Qt::Key_S: cam.flyMove(Camera::BACKWARD, dt); break;
-        case Qt::Key_A: cam.flyMove(Camera::LEFT, dt); break;
-        case Qt::Key_D: cam.flyMove(Camera::RIGHT, dt); break;
-        case Qt::Key_E: cam.flyMove(Camera::UP, dt); break;
-        case Qt::Key_Q: cam.flyMove(Camera::DOWN, dt); break;
+    // F3: per-pass timing overlay. F4: start/stop a Chrome trace capture.
+    // F5: dynamic resolution on/off. F6: performance HUD, which needs the
+    // profiler's GPU timings and primitive counts. F7: this view's layers,
+    // visual -> collision only -> both. F8: capture the GL debug output and
+    // pass timings of the next RenderingSystem::kGlCaptureFrames frames.
+    if (ev->key() == Qt::Key_F7) {
+        auto& layers = m_scene->getRegistry().get<CameraComponent>(m_cameraEntity).layerMask;
+        if (layers == RenderLayers::DefaultView) layers = RenderLayers::Collision | RenderLayers::Helpers;
+        else if (!(layers & RenderLayers::Visual)) layers = RenderLayers::DefaultView | RenderLayers::Collision;
+        else layers = RenderLayers::DefaultView;
+        emit sceneEdited();   // the next extract builds the new draw list
+        requestRedraw();
+        return;
+    }
+    if (m_renderingSystem && ev->key() == Qt::Key_F3) {
+        m_renderingSystem->setProfilingEnabled(!m_renderingSystem->profilingEnabled());
+        requestRedraw();
+        return;
+    }
+    if (m_renderingSystem && m_perfHud && ev->key() == Qt::Key_F6) {
+        m_perfHud->setVisible(!m_perfHud->visible());
+        m_renderingSystem->setProfilingEnabled(m_perfHud->visible());
+        requestRedraw();
+        return;
+    }
+    if (m_renderingSystem && ev->key() == Qt::Key_F5) {
+        m_renderingSystem->setDynamicResolution(!m_renderingSystem->dynamicResolution());
+        requestRedraw();
+        return;
+    }
+    if (m_renderingSystem && ev->key() == Qt::Key_F4) {
+        if (!m_renderingSystem->profileCapture()) {
+            m_renderingSystem->setProfilingEnabled(true);
+            m_renderingSystem->setProfileCapture(true);
+        }
+        else {
+            m_renderingSystem->setProfileCapture(false);
+            const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QStringLiteral("/traces");
+            QDir().mkpath(dir);
+            const QString path = dir + QStringLiteral("/frame-trace-%1.json")
+                .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss")));
+            if (m_renderingSystem->writeProfileTrace(path)) qDebug() << "[Profiler] trace written to" << path;
+            else qWarning() << "[Profiler] could not write" << path;
         }
+        requestRedraw();
+        return;
+    }
+    if (m_renderingSystem && ev->key() == Qt::Key_F8 && !m_renderingSystem->glCaptureActive()) {
+        const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QStringLiteral("/traces");
+        QDir().mkpath(dir);
+        m_renderingSystem->startGlCapture(RenderingSystem::kGlCaptureFrames, dir + QStringLiteral("/gl-capture-%1.json")
+            .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss"))));
+        requestRedraw();
+        return;
     }
-    else {                                         // orbit mode (old keys)
-        float s = 0.05f;
-        switch (ev->key()) {
-        case Qt::Key_W: cam.move(Camera::FORWARD, s); break;
-        case Qt::Key_S: cam.move(Camera::BACKWARD, s); break;
-        case Qt::Key_A: cam.move(Camera::LEFT, s); break;
-        case Qt::Key_D: cam.move(Camera::RIGHT, s); break;
-        case Qt::Key_E: cam.move(Camera::UP, s); break;
-        case Qt::Key_Q: cam.move(Camera::DOWN, s); break;
-        case Qt::Key_P: cam.toggleProjection();       break;
+
+    // Movement keys are held, not stepped: auto-repeat adds nothing, and
+    // applyInput() moves the camera for as long as the key is down.
+    if (const unsigned bit = navKeyOf(ev->key())) {
+        if (!ev->isAutoRepeat()) {
+            if (!m_heldKeys) m_inputClock.restart();
+            m_heldKeys |= bit;
         }
+        return;
     }
-    update();
+    // M: measuring with geometry snapping; Esc drops the measured points.
+    if (ev->key() == Qt::Key_M) {
+        m_measuring = !m_measuring;
+        setMouseTracking(m_measuring);   // snap without a button held
+        m_measurePoints.clear();
+        m_snap = {};
+        m_snapCursor = mapFromGlobal(QCursor::pos());
+        m_snapPending = m_measuring;
+        requestRedraw();
+        return;
+    }
+    if (ev->key() == Qt::Key_Escape && m_measuring) {
+        m_measurePoints.clear();
+        requestRedraw();
+        return;
+    }
+    if (ev->key() == Qt::Key_P && getCamera().navMode() == Camera::NavMode::ORBIT) {
+        getCamera().toggleProjection();
+        requestRedraw();
+    }
+}
+
+void ViewportWidget::keyReleaseEvent(QKeyEvent* ev)
+{
+    if (ev->isAutoRepeat()) return;
+    if (const unsigned bit = navKeyOf(ev->key())) {
+        applyInput();                              // the time the key was down since the last frame
+        m_heldKeys &= ~bit;
+    }
+    QOpenGLWidget::keyReleaseEvent(ev);
+}
+
+void ViewportWidget::focusOutEvent(QFocusEvent* ev)
+{
+    // The release goes to whichever widget has focus then.
+    m_heldKeys = 0;
+    QOpenGLWidget::focusOutEvent(ev);
 }
 
 void ViewportWidget::mouseDoubleClickEvent(QMouseEvent* ev)
 {
     if (ev->button() != Qt::LeftButton) return;
 
-    if (auto hit = IntersectionSystem::pickPoint(*m_scene, *this,
-        ev->pos().x(), ev->pos().y()))
+    if (auto hit = IntersectionSystem::pickPoint(*m_scene,
+        IntersectionSystem::cameraRay(getCamera(), width(), height(), ev->pos().x(), ev->pos().y())))
     {
         getCamera().focusOn(*hit,                    // new target
             glm::length(getCamera().getPosition() - *hit));
@@ -0,0 +1,361 @@
+#include "VirtualSensors.hpp"
+#include "GpuMemory.hpp"
+#include "GLStateCache.hpp"
+#include "GpuResources.hpp"
+#include "SensorBuffers.hpp"
+#include "Shader.hpp"
+
+#include <QOpenGLFunctions_4_3_Core>
+#include <QDebug>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace {
+constexpr float kPi = 3.14159265f;
+constexpr float kMaxFaceTangent = 8.0f;   ///< about 83 degrees above and below a face's centre
+}
+
+bool VirtualSensors::plan(entt::registry& registry, SensorBuffers& buffers, std::uint64_t tick)
+{
+    if (!m_gl || m_tick == tick) return false;
+    m_tick = tick;
+    m_jobs.clear();
+    m_views.clear();
+    deliver(registry);
+
+    const double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_epoch).count();
+    auto sensors = registry.view<VirtualSensorComponent, SensorStreamComponent, WorldTransformComponent>();
+    for (auto [entity, sensor, output, world] : sensors.each()) {
+        if (!output.stream || !output.stream->gpuFed() || !buffers.buffer(*output.stream)) continue;
+        Sensor& state = m_sensors[entity];
+        if (state.stream.lock() != output.stream) {
+            state = Sensor{};
+            state.stream = output.stream;
+            state.start = now;
+        }
+        state.seen = tick;
+
+        Job job;
+        job.entity = entity;
+        job.stream = output.stream;
+        job.kind = sensor.kind;
+        job.sink = bool(sensor.sink);
+        job.minRange = std::max(sensor.minRange, 1e-3f);
+        job.maxRange = std::max(sensor.maxRange, job.minRange * 2.0f);
+        job.origin = glm::vec3(world.matrix[3]);
+        job.firstView = int(m_views.size());
+        const glm::mat4 worldToSensor = glm::inverse(world.matrix);
+        const bool due = sensor.kind == VirtualSensorComponent::Kind::DepthCamera
+            ? planCamera(sensor, state, now, worldToSensor, job)
+            : planLidar(sensor, state, now, worldToSensor, job);
+        if (!due) {
+            m_views.resize(std::size_t(job.firstView));
+            continue;
+        }
+        job.views = int(m_views.size()) - job.firstView;
+        m_jobs.push_back(std::move(job));
+    }
+
+    for (auto it = m_sensors.begin(); it != m_sensors.end();) {
+        if (it->second.seen != tick) it = m_sensors.erase(it);
+        else ++it;
+    }
+    return !m_jobs.empty();
+}
+
+bool VirtualSensors::planCamera(const VirtualSensorComponent& sensor, Sensor& state, double now,
+    const glm::mat4& worldToSensor, Job& job)
+{
+    // The first frame at once, then one per period; a slow tick skips frames.
+    if (sensor.framesPerSecond <= 0.0f || sensor.width <= 0 || sensor.height <= 0) return false;
+    const std::uint64_t due = std::uint64_t((now - state.start) * sensor.framesPerSecond) + 1;
+    if (due <= state.emitted || int(m_views.size()) + 1 > kMaxViews) return false;
+    state.emitted = due;
+
+    View view;
+    view.width = std::min(sensor.width, kMaxLayerSize);
+    view.height = std::min(sensor.height, kMaxLayerSize);
+    const glm::mat4 projection = glm::perspective(glm::radians(std::clamp(sensor.fovDegrees, 1.0f, 170.0f)),
+        float(view.width) / float(view.height), job.minRange, job.maxRange);
+    view.viewProjection = projection * worldToSensor;
+    m_views.push_back(view);
+
+    job.width = view.width;
+    job.height = view.height;
+    job.inverseProjection = glm::inverse(projection);
+    job.count = std::uint32_t(view.width) * std::uint32_t(view.height);
+    return true;
+}
+
+bool VirtualSensors::planLidar(const VirtualSensorComponent& sensor, Sensor& state, double now,
+    const glm::mat4& worldToSensor, Job& job)
+{
+    if (sensor.beams <= 0 || sensor.stepsPerTurn < 4 || sensor.turnsPerSecond <= 0.0f) return false;
+    const std::uint64_t steps = std::uint64_t(sensor.stepsPerTurn);
+    const std::uint64_t due = std::uint64_t((now - state.start) * sensor.turnsPerSecond * double(steps));
+    if (due <= state.emitted) return false;
+    // At most one turn per tick; a stalled GUI drops the backlog.
+    const std::uint64_t first = std::max(state.emitted, due > steps ? due - steps : 0);
+    const std::uint64_t columns = due - first;
+
+    // The faces the new columns fall in; face f looks along azimuth f * 90 degrees.
+    bool faces[4] = {};
+    for (std::uint64_t c = first; c < due; ++c) {
+        const float azimuth = 2.0f * kPi * float(c % steps) / float(steps);
+        faces[int(std::floor(azimuth / (0.5f * kPi) + 0.5f)) & 3] = true;
+    }
+    const int needed = int(faces[0]) + int(faces[1]) + int(faces[2]) + int(faces[3]);
+    if (int(m_views.size()) + needed > kMaxViews) return false;
+    state.emitted = due;
+
+    // 90 degrees across; tall enough for the top beam at a face's corner,
+    // where it projects sqrt(2) times higher than at the centre.
+    const float halfFov = 0.5f * glm::radians(std::clamp(sensor.verticalFovDegrees, 0.0f, 170.0f));
+    const float tangent = std::clamp(std::tan(halfFov) * std::sqrt(2.0f), 0.05f, kMaxFaceTangent);
+    job.faceWidth = std::clamp(sensor.stepsPerTurn / 2, 64, kMaxLayerSize);
+    job.faceHeight = std::clamp(int(std::ceil(float(job.faceWidth) * tangent)), std::max(16, 2 * sensor.beams), kMaxLayerSize);
+    job.faceProjection = glm::perspective(2.0f * std::atan(tangent), 1.0f / tangent, job.minRange, job.maxRange);
+    for (int f = 0; f < 4; ++f) {
+        const float azimuth = 0.5f * kPi * float(f);
+        job.faceRotation[f] = glm::lookAt(glm::vec3(0.0f), glm::vec3(std::sin(azimuth), 0.0f, std::cos(azimuth)),
+            glm::vec3(0.0f, 1.0f, 0.0f));
+        if (!faces[f]) continue;
+        job.faceLayer[f] = int(m_views.size());
+        View view;
+        view.width = job.faceWidth;
+        view.height = job.faceHeight;
+        view.viewProjection = job.faceProjection * job.faceRotation[f] * worldToSensor;
+        m_views.push_back(view);
+    }
+
+    job.beams = sensor.beams;
+    job.steps = sensor.stepsPerTurn;
+    job.firstColumn = std::uint32_t(first % steps);
+    job.verticalFov = 2.0f * halfFov;
+    job.count = std::uint32_t(columns) * std::uint32_t(sensor.beams);
+    return true;
+}
+
+bool VirtualSensors::reaches(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const
+{
+    for (const Job& job : m_jobs) {
+        const glm::vec3 nearest = glm::clamp(job.origin, boundsMin, boundsMax);
+        if (glm::length(nearest - job.origin) <= job.maxRange) return true;
+    }
+    return false;
+}
+
+void VirtualSensors::ensureTarget(int width, int height, int layers)
+{
+    // Grows only; every view uses the corner its viewport covers.
+    if (m_depthTexture && width <= m_targetSize[0] && height <= m_targetSize[1] && layers <= m_targetLayers) return;
+    width = std::max(width, m_targetSize[0]);
+    height = std::max(height, m_targetSize[1]);
+    layers = std::max(layers, m_targetLayers);
+    if (m_depthTexture) GpuMemory::deleteTextures(m_gl, 1, &m_depthTexture);
+
+    m_gl->glGenTextures(1, &m_depthTexture);
+    m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, m_depthTexture);
+    m_gl->glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, width, height, layers);
+    GpuMemory::trackTexture(m_depthTexture, std::size_t(width) * height * 4 * layers, GpuMemory::Category::RenderTargets);
+    m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    m_gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    m_targetSize[0] = width;
+    m_targetSize[1] = height;
+    m_targetLayers = layers;
+    if (m_framebuffer == 0) m_gl->glGenFramebuffers(1, &m_framebuffer);
+}
+
+void VirtualSensors::render(GLStateCache& state, Shader& depthShader, const std::function<void()>& drawCasters)
+{
+    if (m_views.empty()) return;
+    int width = 1, height = 1;
+    for (const View& view : m_views) {
+        width = std::max(width, view.width);
+        height = std::max(height, view.height);
+    }
+    const int passes = (int(m_views.size()) + kViewsPerPass - 1) / kViewsPerPass;
+    ensureTarget(width, height, passes * kViewsPerPass);
+
+    state.bindFramebuffer(m_framebuffer);
+    if (m_attached != m_depthTexture) {
+        m_gl->glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0);   // layered
+        m_gl->glDrawBuffer(GL_NONE);
+        m_gl->glReadBuffer(GL_NONE);
+        m_attached = m_depthTexture;
+    }
+    state.setDepthTest(true);
+    state.setDepthMask(true);
+    state.setCullFace(true);
+    state.setBlend(false);
+    m_gl->glViewport(0, 0, m_targetSize[0], m_targetSize[1]);
+    m_gl->glClear(GL_DEPTH_BUFFER_BIT);   // every layer
+    state.use(depthShader);
+    for (int pass = 0; pass < passes; ++pass) {
+        const int first = pass * kViewsPerPass;
+        const int count = std::min(kViewsPerPass, int(m_views.size()) - first);
+        for (int i = 0; i < count; ++i) {
+            const View& view = m_views[std::size_t(first + i)];
+            m_gl->glViewportIndexedf(GLuint(i), 0.0f, 0.0f, float(view.width), float(view.height));
+            depthShader.setMat4("u_viewProjection[" + std::to_string(i) + "]", view.viewProjection);
+        }
+        depthShader.setInt("u_viewCount", count);
+        depthShader.setInt("u_firstLayer", first);
+        drawCasters();
+    }
+    state.setCullFace(false);
+}
+
+void VirtualSensors::pack(GLStateCache& state, Shader& packShader, SensorBuffers& buffers)
+{
+    if (m_jobs.empty()) return;
+    m_gl->glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    state.use(packShader);
+    m_gl->glActiveTexture(GL_TEXTURE0);
+    m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, m_depthTexture);
+    packShader.setInt("u_depth", 0);
+    packShader.setFloat("u_now", SensorStream::clockSeconds());
+
+    for (Job& job : m_jobs) {
+        const GLuint ring = buffers.buffer(*job.stream);
+        if (!ring || job.count == 0) continue;
+        // Larger than the ring: the oldest points of the batch would be overwritten anyway.
+        job.count = std::uint32_t(std::min<std::size_t>(job.count, job.stream->capacity()));
+        const std::uint64_t first = job.stream->head();
+
+        packShader.setUInt("u_base", unsigned(first & (job.stream->capacity() - 1)));
+        packShader.setUInt("u_mask", unsigned(job.stream->capacity() - 1));
+        packShader.setUInt("u_count", job.count);
+        packShader.setFloat("u_minRange", job.minRange);
+        packShader.setFloat("u_maxRange", job.maxRange);
+        const bool lidar = job.kind == VirtualSensorComponent::Kind::Lidar;
+        packShader.setBool("u_lidar", lidar);
+        if (!lidar) {
+            m_gl->glUniform2i(packShader.uniformLocation("u_size"), job.width, job.height);
+            packShader.setInt("u_layer", job.firstView);
+            packShader.setMat4("u_inverseProjection", job.inverseProjection);
+        }
+        else {
+            packShader.setUInt("u_beams", unsigned(job.beams));
+            packShader.setUInt("u_steps", unsigned(job.steps));
+            packShader.setUInt("u_firstColumn", job.firstColumn);
+            packShader.setFloat("u_verticalFov", job.verticalFov);
+            for (int f = 0; f < 4; ++f) {
+                const std::string index = "[" + std::to_string(f) + "]";
+                packShader.setInt("u_faceLayer" + index, job.faceLayer[f]);
+                packShader.setMat4("u_faceRotation" + index, job.faceRotation[f]);
+            }
+            packShader.setMat4("u_faceProjection", job.faceProjection);
+            m_gl->glUniform2i(packShader.uniformLocation("u_faceSize"), job.faceWidth, job.faceHeight);
+        }
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kSensorPointsBinding, ring);
+        m_gl->glDispatchCompute((job.count + 255) / 256, 1, 1);
+        job.stream->publish(job.count);
+        if (job.sink) {
+            m_gl->glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+            queueReadback(job, ring, first);
+        }
+    }
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kSensorPointsBinding, 0);
+    m_gl->glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    // The point pass reads the rings as storage from the next tick on.
+    m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    buffers.written();
+}
+
+void VirtualSensors::queueReadback(const Job& job, GLuint ring, std::uint64_t first)
+{
+    if (m_inFlight.size() >= kMaxReadbacks) {
+        if (!m_warnedReadbacks) qWarning() << "[VirtualSensors] sinks fall behind; dropping points";
+        m_warnedReadbacks = true;
+        return;
+    }
+    std::size_t slot;
+    if (!m_idle.empty()) {
+        slot = m_idle.back();
+        m_idle.pop_back();
+    }
+    else {
+        slot = m_readbacks.size();
+        m_readbacks.emplace_back();
+    }
+    Readback& r = m_readbacks[slot];
+    const GLsizeiptr bytes = GLsizeiptr(job.count) * GLsizeiptr(sizeof(SensorPoint));
+    if (r.buffer == 0) m_gl->glGenBuffers(1, &r.buffer);
+    if (bytes > r.capacity) {
+        r.capacity = std::max(bytes, r.capacity * 2);
+        GpuMemory::bufferData(m_gl, GL_COPY_WRITE_BUFFER, r.buffer, r.capacity, nullptr, GL_STREAM_READ,
+            GpuMemory::Category::Sensors);
+    }
+
+    // At most two runs: the ring may wrap within the batch.
+    const std::size_t capacity = job.stream->capacity();
+    const std::size_t index = std::size_t(first) & (capacity - 1);
+    const std::size_t tail = std::min<std::size_t>(capacity - index, job.count);
+    m_gl->glBindBuffer(GL_COPY_READ_BUFFER, ring);
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, r.buffer);
+    m_gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(index * sizeof(SensorPoint)), 0,
+        GLsizeiptr(tail * sizeof(SensorPoint)));
+    if (tail < job.count)
+        m_gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, GLintptr(tail * sizeof(SensorPoint)),
+            GLsizeiptr((job.count - tail) * sizeof(SensorPoint)));
+    m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    r.fence = m_gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    r.entity = job.entity;
+    r.count = job.count;
+    m_inFlight.push_back(slot);
+}
+
+void VirtualSensors::deliver(entt::registry& registry)
+{
+    // In order, and only what has finished: never waits.
+    while (!m_inFlight.empty()) {
+        Readback& r = m_readbacks[m_inFlight.front()];
+        const GLenum status = m_gl->glClientWaitSync(r.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        m_gl->glDeleteSync(r.fence);
+        r.fence = nullptr;
+
+        const auto* sensor = registry.valid(r.entity) ? registry.try_get<VirtualSensorComponent>(r.entity) : nullptr;
+        if (sensor && sensor->sink) {
+            m_gl->glBindBuffer(GL_COPY_READ_BUFFER, r.buffer);
+            const GLsizeiptr bytes = GLsizeiptr(r.count) * GLsizeiptr(sizeof(SensorPoint));
+            if (const auto* points = static_cast<const SensorPoint*>(
+                    m_gl->glMapBufferRange(GL_COPY_READ_BUFFER, 0, bytes, GL_MAP_READ_BIT))) {
+                m_sinkScratch.clear();
+                for (std::uint32_t i = 0; i < r.count; ++i)
+                    if (points[i].time >= 0.0f) m_sinkScratch.push_back(points[i]);
+                m_gl->glUnmapBuffer(GL_COPY_READ_BUFFER);
+            }
+            m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            if (!m_sinkScratch.empty()) sensor->sink(m_sinkScratch.data(), m_sinkScratch.size());
+        }
+        m_idle.push_back(m_inFlight.front());
+        m_inFlight.pop_front();
+    }
+}
+
+void VirtualSensors::destroy()
+{
+    if (!m_gl) return;
+    for (Readback& r : m_readbacks) {
+        if (r.fence) m_gl->glDeleteSync(r.fence);
+        if (r.buffer) GpuMemory::deleteBuffers(m_gl, 1, &r.buffer);
+    }
+    m_readbacks.clear();
+    m_inFlight.clear();
+    m_idle.clear();
+    if (m_depthTexture) GpuMemory::deleteTextures(m_gl, 1, &m_depthTexture);
+    if (m_framebuffer) m_gl->glDeleteFramebuffers(1, &m_framebuffer);
+    m_depthTexture = m_framebuffer = m_attached = 0;
+    m_targetSize[0] = m_targetSize[1] = m_targetLayers = 0;
+    m_sensors.clear();
+    m_jobs.clear();
+    m_views.clear();
+    m_tick = ~0ull;
+}
@@ -0,0 +1,674 @@
+#include "VoxelReconstruction.hpp"
+#include "GpuMemory.hpp"
+#include "components.hpp"
+#include "GLStateCache.hpp"
+#include "GpuProfiler.hpp"
+#include "MeshArena.hpp"
+#include "MeshCache.hpp"
+#include "RenderStats.hpp"
+#include "SensorBuffers.hpp"
+#include "Shader.hpp"
+#include "ThreadPool.hpp"
+
+#include <QOpenGLFunctions_4_3_Core>
+#include <QDebug>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+namespace {
+constexpr GLuint kBlockHashBinding = 11;
+constexpr GLuint kVoxelPoolBinding = 12;
+constexpr GLuint kActiveBlocksBinding = 13;
+constexpr GLuint kStagingBinding = 14;
+constexpr GLuint kRangeImageBinding = 15;
+constexpr GLuint kTrackPartialsBinding = 23;
+
+// Profiler pass names must outlive the frame; one per tracking iteration.
+constexpr const char* kTrackPassNames[VoxelReconstruction::kMaxTrackIterations] = {
+    "icp 1", "icp 2", "icp 3", "icp 4", "icp 5", "icp 6", "icp 7", "icp 8",
+    "icp 9", "icp 10", "icp 11", "icp 12", "icp 13", "icp 14", "icp 15", "icp 16",
+};
+
+constexpr std::uint32_t kImageWidth = 2048;    ///< azimuth bins, kImageSize in both shaders
+constexpr std::uint32_t kImageHeight = 256;    ///< elevation bins over -90..90 degrees
+constexpr std::uint32_t kMaxWeight = 64;       ///< caps the running average so the surface can still move
+constexpr std::uint32_t kEmptyKey = 0xFFFFFFFFu;
+
+constexpr GLsizeiptr kBlockBytes = GLsizeiptr(VoxelReconstruction::kBlockVoxels) * sizeof(std::uint32_t);
+constexpr GLsizeiptr kActiveBytes = GLsizeiptr(1 + VoxelReconstruction::kActiveCapacity) * 16;
+constexpr GLsizeiptr kStagingBytes = GLsizeiptr(VoxelReconstruction::kActiveCapacity) * kBlockBytes;
+// A readback slot is the active list followed by the staged voxels.
+constexpr GLsizeiptr kReadbackBytes = kActiveBytes + kStagingBytes;
+
+// Block keys pack coordinates biased by 512 into 10 bits each, as the shaders do.
+glm::ivec3 unpackKey(std::uint32_t key)
+{
+    return glm::ivec3(int(key & 0x3FFu), int((key >> 10) & 0x3FFu), int((key >> 20) & 0x3FFu)) - 512;
+}
+
+bool packKey(const glm::ivec3& block, std::uint32_t& key)
+{
+    const glm::ivec3 biased = block + 512;
+    if (glm::any(glm::lessThan(biased, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(biased, glm::ivec3(1024))))
+        return false;
+    key = std::uint32_t(biased.x) | (std::uint32_t(biased.y) << 10) | (std::uint32_t(biased.z) << 20);
+    return true;
+}
+
+// --- Marching cubes ---
+// Cube corner i sits at (i & 1, i >> 1 & 1, i >> 2 & 1). Instead of the
+// usual hand-written 256-case table, each case is triangulated from its
+// faces: on every face the sign changes pair up so that inside corners are
+// cut off one run at a time, which depends only on the face's own corners
+// and therefore matches the neighbouring cube. The segments chain into
+// closed loops around the inside region, fanned into triangles.
+struct CubeTables {
+    int edgeCorner[12][2];
+    int edgeAxis[12];
+    std::vector<std::int8_t> triangles[256];   ///< edge indices, three per triangle
+};
+
+CubeTables buildCubeTables()
+{
+    CubeTables t{};
+    int edgeOf[8][8];
+    std::memset(edgeOf, -1, sizeof(edgeOf));
+    int edges = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int c = 0; c < 8; ++c) {
+            if (c & (1 << axis)) continue;
+            const int d = c | (1 << axis);
+            t.edgeCorner[edges][0] = c;
+            t.edgeCorner[edges][1] = d;
+            t.edgeAxis[edges] = axis;
+            edgeOf[c][d] = edgeOf[d][c] = edges++;
+        }
+    }
+
+    // Each face's corners in counter-clockwise order seen from outside the cube.
+    int faces[6][4];
+    for (int f = 0; f < 6; ++f) {
+        const int axis = f / 2, side = f % 2;
+        const glm::vec3 normal = glm::vec3(axis == 0, axis == 1, axis == 2) * (side ? 1.0f : -1.0f);
+        const glm::vec3 u(axis == 1, axis == 2, axis == 0);
+        const glm::vec3 v = glm::cross(normal, u);
+        int n = 0;
+        for (int c = 0; c < 8; ++c)
+            if (((c >> axis) & 1) == side) faces[f][n++] = c;
+        auto angle = [&](int c) {
+            const glm::vec3 p = glm::vec3(c & 1, (c >> 1) & 1, (c >> 2) & 1) - 0.5f;
+            return std::atan2(glm::dot(p, v), glm::dot(p, u));
+        };
+        std::sort(faces[f], faces[f] + 4, [&](int a, int b) { return angle(a) < angle(b); });
+    }
+
+    for (int mask = 0; mask < 256; ++mask) {
+        auto inside = [mask](int c) { return (mask >> c) & 1; };
+        int next[12];
+        std::fill(std::begin(next), std::end(next), -1);
+        for (const auto& q : faces) {
+            for (int k = 0; k < 4; ++k) {
+                if (!inside(q[k]) || inside(q[(k + 1) % 4])) continue;
+                // Walk back over this run of inside corners to where it was entered.
+                int j = k;
+                while (inside(q[(j + 3) % 4])) j = (j + 3) % 4;
+                next[edgeOf[q[k]][q[(k + 1) % 4]]] = edgeOf[q[(j + 3) % 4]][q[j]];
+            }
+        }
+        bool visited[12] = {};
+        for (int start = 0; start < 12; ++start) {
+            if (next[start] < 0 || visited[start]) continue;
+            std::vector<int> loop;
+            for (int e = start; !visited[e]; e = next[e]) {
+                visited[e] = true;
+                loop.push_back(e);
+            }
+            // Fan from a vertex none of whose diagonals runs along a cube
+            // face, where it could overlap the neighbouring cube's triangles.
+            const std::size_t n = loop.size();
+            std::size_t fan = 0;
+            for (std::size_t s = 0; s < n; ++s) {
+                bool onFace = false;
+                for (std::size_t i = 2; i + 1 < n && !onFace; ++i) {
+                    const int a = loop[s], b = loop[(s + i) % n];
+                    const int corners[4] = { t.edgeCorner[a][0], t.edgeCorner[a][1], t.edgeCorner[b][0], t.edgeCorner[b][1] };
+                    for (int axis = 0; axis < 3 && !onFace; ++axis) {
+                        const int bit = (corners[0] >> axis) & 1;
+                        onFace = std::all_of(corners, corners + 4, [&](int c) { return ((c >> axis) & 1) == bit; });
+                    }
+                }
+                if (!onFace) { fan = s; break; }
+            }
+            for (std::size_t i = 1; i + 1 < n; ++i) {
+                t.triangles[mask].push_back(std::int8_t(loop[fan]));
+                t.triangles[mask].push_back(std::int8_t(loop[(fan + i + 1) % n]));
+                t.triangles[mask].push_back(std::int8_t(loop[(fan + i) % n]));
+            }
+        }
+    }
+    return t;
+}
+
+const CubeTables& cubeTables()
+{
+    static const CubeTables tables = buildCubeTables();
+    return tables;
+}
+
+// Solves A x = b by Cholesky for a symmetric positive definite A; false if
+// A is not (a scan that constrains too few directions).
+bool solveNormalEquations(const double (&A)[6][6], const double (&b)[6], double (&x)[6])
+{
+    double L[6][6] = {};
+    for (int i = 0; i < 6; ++i) {
+        for (int j = 0; j <= i; ++j) {
+            double sum = A[i][j];
+            for (int k = 0; k < j; ++k) sum -= L[i][k] * L[j][k];
+            if (i == j) {
+                if (sum <= 0.0) return false;
+                L[i][i] = std::sqrt(sum);
+            }
+            else {
+                L[i][j] = sum / L[j][j];
+            }
+        }
+    }
+    double y[6];
+    for (int i = 0; i < 6; ++i) {
+        double sum = b[i];
+        for (int k = 0; k < i; ++k) sum -= L[i][k] * y[k];
+        y[i] = sum / L[i][i];
+    }
+    for (int i = 5; i >= 0; --i) {
+        double sum = y[i];
+        for (int k = i + 1; k < 6; ++k) sum -= L[k][i] * x[k];
+        x[i] = sum / L[i][i];
+    }
+    return true;
+}
+
+// Rebuilds the rotation part from its quaternion so products of many small
+// updates stay rigid.
+glm::mat4 orthonormalized(const glm::mat4& m)
+{
+    glm::mat4 out = glm::mat4_cast(glm::normalize(glm::quat_cast(glm::mat3(m))));
+    out[3] = glm::vec4(glm::vec3(m[3]), 1.0f);
+    return out;
+}
+}
+
+bool VoxelReconstruction::busy() const
+{
+    return m_readbacksInFlight > 0 || !m_dirty.empty();
+}
+
+void VoxelReconstruction::update(entt::registry& registry, SensorBuffers& sensors, MeshArena& arena,
+    GLStateCache& state, Shader& splatShader, Shader& integrateShader, Shader& trackShader,
+    std::uint64_t tick, GpuProfiler* profiler)
+{
+    if (!m_gl || m_tick == tick) return;
+    m_tick = tick;
+
+    entt::entity entity = entt::null;
+    const ReconstructionComponent* settings = nullptr;
+    for (auto [e, component] : registry.view<ReconstructionComponent>().each()) {
+        entity = e;
+        settings = &component;
+        break;
+    }
+    if (!settings) {
+        if (m_entity != entt::null) destroy(arena);
+        return;
+    }
+
+    Settings wanted;
+    wanted.voxelSize = std::max(settings->voxelSize, 0.005f);
+    wanted.truncation = std::max(settings->truncation, wanted.voxelSize);
+    if (entity != m_entity || wanted != m_settings) releaseVolume(arena);
+    m_entity = entity;
+    m_settings = wanted;
+    m_albedo = settings->albedo;
+    if (!m_hashBuffer) createVolume();
+
+    {
+        GpuProfiler::Scope scope(profiler, m_gl, "reconstruction");
+        drainReadbacks();
+        remesh(arena);
+    }
+    if (settings->integrate) {
+        sensors.setFunctions(m_gl);
+        sensors.update(registry, tick);
+        integrate(registry, sensors, state, splatShader, integrateShader,
+            settings->track ? &trackShader : nullptr, std::clamp(settings->trackIterations, 1, kMaxTrackIterations),
+            settings->maxRange, profiler);
+    }
+}
+
+void VoxelReconstruction::createVolume()
+{
+    auto create = [this](GLuint& buffer, GLsizeiptr bytes, GLenum usage) {
+        m_gl->glGenBuffers(1, &buffer);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        GpuMemory::bufferData(m_gl, GL_SHADER_STORAGE_BUFFER, buffer, bytes, nullptr, usage, GpuMemory::Category::Reconstruction);
+    };
+    create(m_hashBuffer, GLsizeiptr(kBucketCount) * 8, GL_DYNAMIC_COPY);
+    const GLuint emptyBucket[2] = { kEmptyKey, 0u };
+    m_gl->glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT, emptyBucket);
+
+    create(m_voxelBuffer, GLsizeiptr(kBucketCount) * kBlockBytes, GL_DYNAMIC_COPY);
+    const GLuint unobserved = 0u;   // weight 0
+    m_gl->glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &unobserved);
+
+    create(m_activeBuffer, kActiveBytes, GL_DYNAMIC_COPY);
+    create(m_stagingBuffer, kStagingBytes, GL_DYNAMIC_COPY);
+    create(m_rangeImage, GLsizeiptr(kImageWidth) * kImageHeight * 4, GL_DYNAMIC_COPY);
+    create(m_trackPartials, GLsizeiptr(kTrackGroups) * kTrackRowStride * sizeof(float), GL_DYNAMIC_READ);
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    for (Readback& r : m_readbacks) {
+        m_gl->glGenBuffers(1, &r.buffer);
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, r.buffer);
+        GpuMemory::bufferData(m_gl, GL_COPY_WRITE_BUFFER, r.buffer, kReadbackBytes, nullptr, GL_STREAM_READ,
+            GpuMemory::Category::Reconstruction);
+    }
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void VoxelReconstruction::drainReadbacks()
+{
+    // Oldest first: a block read back twice keeps its newer voxels.
+    while (m_readbacksInFlight > 0) {
+        Readback& r = m_readbacks[m_readbackTail];
+        const GLenum status = m_gl->glClientWaitSync(r.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_TIMEOUT_EXPIRED) break;
+        m_gl->glDeleteSync(r.fence);
+        r.fence = nullptr;
+        m_readbackTail = (m_readbackTail + 1) % kReadbackSlots;
+        --m_readbacksInFlight;
+        if (status == GL_WAIT_FAILED) continue;
+
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, r.buffer);
+        std::uint32_t header[4] = {};
+        if (const void* p = m_gl->glMapBufferRange(GL_COPY_READ_BUFFER, 0, sizeof(header), GL_MAP_READ_BIT)) {
+            std::memcpy(header, p, sizeof(header));
+            m_gl->glUnmapBuffer(GL_COPY_READ_BUFFER);
+        }
+        const std::uint32_t count = std::min(header[0], kActiveCapacity);
+        if (header[0] > kActiveCapacity)
+            qDebug() << "[VoxelReconstruction]" << header[0] - kActiveCapacity << "blocks deferred to a later tick";
+
+        const GLsizeiptr mapped = kActiveBytes + GLsizeiptr(count) * kBlockBytes;
+        const auto* base = count ? static_cast<const unsigned char*>(
+            m_gl->glMapBufferRange(GL_COPY_READ_BUFFER, 0, mapped, GL_MAP_READ_BIT)) : nullptr;
+        if (base) {
+            const auto* entries = reinterpret_cast<const std::uint32_t*>(base + 16);
+            for (std::uint32_t i = 0; i < count; ++i) {
+                const std::uint32_t* e = entries + i * 4;
+                const std::uint32_t key = e[0] | (e[1] << 10) | (e[2] << 20);
+                std::memcpy(m_blocks[key].data(), base + kActiveBytes + GLsizeiptr(i) * kBlockBytes, kBlockBytes);
+
+                // This block's cubes and those of the -x/-y/-z neighbours that reach into it.
+                const glm::ivec3 block = unpackKey(key);
+                for (int d = 0; d < 8; ++d) {
+                    std::uint32_t neighbour;
+                    if (packKey(block - glm::ivec3(d & 1, (d >> 1) & 1, (d >> 2) & 1), neighbour)
+                        && m_blocks.count(neighbour))
+                        m_dirty.insert(neighbour);
+                }
+            }
+            m_gl->glUnmapBuffer(GL_COPY_READ_BUFFER);
+        }
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    if (!m_warnedFull && m_blocks.size() > kBucketCount / 4 * 3) {
+        qWarning() << "[VoxelReconstruction] block hash is" << m_blocks.size() << "/" << kBucketCount
+            << "full; raise the voxel size to cover more space";
+        m_warnedFull = true;
+    }
+}
+
+void VoxelReconstruction::remesh(MeshArena& arena)
+{
+    if (m_dirty.empty()) return;
+
+    m_meshScratch.clear();
+    for (auto it = m_dirty.begin(); it != m_dirty.end() && m_meshScratch.size() < kMeshBlocksPerTick;)
+    {
+        m_meshScratch.push_back(*it);
+        it = m_dirty.erase(it);
+    }
+
+    // The mirror is only read here; arena changes stay on this thread.
+    std::vector<BlockMesh> built(m_meshScratch.size());
+    ThreadPool::shared().parallelFor(m_meshScratch.size(), [&](std::size_t i) {
+        built[i] = meshBlock(m_meshScratch[i]);
+    });
+
+    for (std::size_t i = 0; i < m_meshScratch.size(); ++i) {
+        const std::uint32_t key = m_meshScratch[i];
+        auto old = m_meshes.find(key);
+        if (old != m_meshes.end()) {
+            if (built[i].mesh && built[i].mesh->contentHash == old->second.mesh->contentHash) continue;
+            arena.release(old->second.mesh->contentHash);
+            m_meshes.erase(old);
+        }
+        if (built[i].mesh) m_meshes.emplace(key, std::move(built[i]));
+    }
+}
+
+VoxelReconstruction::BlockMesh VoxelReconstruction::meshBlock(std::uint32_t key) const
+{
+    // Samples of this block plus one layer of its +x/+y/+z neighbours.
+    constexpr int kSide = kBlockSide + 1;
+    struct Sample { float tsdf; bool known; };
+    Sample samples[kSide * kSide * kSide];
+    const glm::ivec3 block = unpackKey(key);
+    const Voxels* sources[8];
+    for (int d = 0; d < 8; ++d) {
+        std::uint32_t neighbour;
+        const bool valid = packKey(block + glm::ivec3(d & 1, (d >> 1) & 1, (d >> 2) & 1), neighbour);
+        const auto it = valid ? m_blocks.find(neighbour) : m_blocks.end();
+        sources[d] = it == m_blocks.end() ? nullptr : &it->second;
+    }
+    for (int z = 0; z < kSide; ++z) {
+        for (int y = 0; y < kSide; ++y) {
+            for (int x = 0; x < kSide; ++x) {
+                const int d = (x >> 3) | ((y >> 3) << 1) | ((z >> 3) << 2);
+                Sample& s = samples[(z * kSide + y) * kSide + x];
+                const std::uint32_t v = sources[d]
+                    ? (*sources[d])[(x & 7) + 8 * (y & 7) + 64 * (z & 7)] : 0u;
+                s.known = (v >> 16) != 0;
+                s.tsdf = float(std::int16_t(v & 0xFFFFu)) / 32767.0f;
+            }
+        }
+    }
+
+    const CubeTables& tables = cubeTables();
+    const float voxel = m_settings.voxelSize;
+    const glm::vec3 origin = (glm::vec3(block * kBlockSide) + 0.5f) * voxel;   // voxel centres
+    std::vector<int> edgeVertex(kSide * kSide * kSide * 3, -1);
+    auto data = std::make_shared<MeshData>();
+
+    for (int z = 0; z < kBlockSide; ++z) {
+        for (int y = 0; y < kBlockSide; ++y) {
+            for (int x = 0; x < kBlockSide; ++x) {
+                const Sample* corner[8];
+                int mask = 0;
+                bool usable = true;
+                for (int c = 0; c < 8 && usable; ++c) {
+                    corner[c] = &samples[((z + (c >> 2)) * kSide + y + ((c >> 1) & 1)) * kSide + x + (c & 1)];
+                    usable = corner[c]->known;
+                    if (corner[c]->tsdf < 0.0f) mask |= 1 << c;
+                }
+                if (!usable || mask == 0 || mask == 255) continue;
+
+                // A sign change between truncated values is a band edge, not a surface.
+                for (int e = 0; e < 12 && usable; ++e) {
+                    const float a = corner[tables.edgeCorner[e][0]]->tsdf, b = corner[tables.edgeCorner[e][1]]->tsdf;
+                    usable = (a < 0.0f) == (b < 0.0f) || std::abs(a - b) <= 1.0f;
+                }
+                if (!usable) continue;
+
+                for (std::int8_t e : tables.triangles[mask]) {
+                    const int c0 = tables.edgeCorner[e][0], c1 = tables.edgeCorner[e][1];
+                    const glm::ivec3 p0(x + (c0 & 1), y + ((c0 >> 1) & 1), z + (c0 >> 2));
+                    int& index = edgeVertex[((p0.z * kSide + p0.y) * kSide + p0.x) * 3 + tables.edgeAxis[e]];
+                    if (index < 0) {
+                        const float a = corner[c0]->tsdf, b = corner[c1]->tsdf;
+                        glm::vec3 p(p0);
+                        p[tables.edgeAxis[e]] += a / (a - b);
+                        index = int(data->vertices.size());
+                        data->vertices.emplace_back(origin + p * voxel, glm::vec3(0.0f));
+                    }
+                    data->indices.push_back(unsigned(index));
+                }
+            }
+        }
+    }
+    if (data->indices.empty()) return {};
+
+    // Area-weighted face normals; blocks are meshed alone, so seams may shade slightly apart.
+    for (std::size_t i = 0; i + 2 < data->indices.size(); i += 3) {
+        Vertex& a = data->vertices[data->indices[i]];
+        Vertex& b = data->vertices[data->indices[i + 1]];
+        Vertex& c = data->vertices[data->indices[i + 2]];
+        const glm::vec3 n = glm::cross(b.position - a.position, c.position - a.position);
+        a.normal += n;
+        b.normal += n;
+        c.normal += n;
+    }
+    BlockMesh out;
+    out.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    out.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    for (Vertex& v : data->vertices) {
+        const float length = glm::length(v.normal);
+        v.normal = length > 0.0f ? v.normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        out.boundsMin = glm::min(out.boundsMin, v.position);
+        out.boundsMax = glm::max(out.boundsMax, v.position);
+    }
+    data->contentHash = MeshCache::hashContent(data->vertices, data->indices);
+    out.mesh = std::move(data);
+    return out;
+}
+
+bool VoxelReconstruction::integrate(entt::registry& registry, SensorBuffers& sensors, GLStateCache& state,
+    Shader& splat, Shader& fuse, Shader* trackShader, int trackIterations, float maxRange, GpuProfiler* profiler)
+{
+    // Every slot is still waiting for its readback: the mirror would fall
+    // behind, so leave the points in their rings for the next tick.
+    if (m_readbacksInFlight == kReadbackSlots) return false;
+
+    for (auto it = m_sources.begin(); it != m_sources.end();)
+        it = it->second.stream.expired() ? m_sources.erase(it) : std::next(it);
+
+    bool any = false;
+    for (auto [entity, sensor] : registry.view<SensorStreamComponent>().each()) {
+        if (!sensor.stream || !sensor.stream->running()) continue;
+        Source& source = m_sources[sensor.stream.get()];
+        if (source.stream.lock() != sensor.stream) source = Source{ sensor.stream, 0 };
+        SensorBuffers::Ranges fresh;
+        if (!sensors.fresh(*sensor.stream, source.integrated, fresh)) continue;
+
+        if (!any) {
+            // First sensor this tick: empty the active list and bind the volume.
+            const GLuint header[4] = { 0u, 1u, 1u, 0u };
+            m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_activeBuffer);
+            m_gl->glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), header);
+            RenderStats::upload(sizeof(header));
+            if (++m_stamp == 0) ++m_stamp;   // buckets start at stamp 0
+            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kBlockHashBinding, m_hashBuffer);
+            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kVoxelPoolBinding, m_voxelBuffer);
+            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kActiveBlocksBinding, m_activeBuffer);
+            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kStagingBinding, m_stagingBuffer);
+            m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kRangeImageBinding, m_rangeImage);
+            m_gl->glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_activeBuffer);
+            any = true;
+        }
+
+        const glm::mat4 entityPose = registry.all_of<WorldTransformComponent>(entity)
+            ? registry.get<WorldTransformComponent>(entity).matrix
+            : registry.all_of<TransformComponent>(entity)
+                ? registry.get<TransformComponent>(entity).getTransform()
+                : glm::mat4(1.0f);
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kSensorPointsBinding, fresh.buffer);
+
+        // Scan-to-map: until the surface holds enough of the scan, fuse at the last correction.
+        TrackResult tracked;
+        if (trackShader && track(fresh, source.correction * entityPose, state, *trackShader,
+                trackIterations, maxRange, profiler, tracked)) {
+            source.correction = orthonormalized(tracked.pose * glm::inverse(entityPose));
+            SensorTrackingComponent& out = registry.emplace_or_replace<SensorTrackingComponent>(entity);
+            out.pose = tracked.pose;
+            out.correction = source.correction;
+            out.rmsResidual = float(tracked.rmsResidual);
+            out.inliers = tracked.inliers;
+            out.iterations = tracked.iterations;
+            out.converged = tracked.converged;
+        }
+        const glm::mat4 sensorToWorld = source.correction * entityPose;
+
+        GpuProfiler::Scope scope(profiler, m_gl, "fusion");
+        const GLuint noReturn = 0xFFFFFFFFu;
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_rangeImage);
+        m_gl->glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &noReturn);
+
+        state.use(splat);
+        splat.setMat4("u_sensorToWorld", sensorToWorld);
+        splat.setFloat("u_blockSize", m_settings.voxelSize * kBlockSide);
+        splat.setFloat("u_truncation", m_settings.truncation);
+        splat.setFloat("u_maxRange", maxRange);
+        splat.setUInt("u_stamp", m_stamp);
+        splat.setUInt("u_activeCapacity", kActiveCapacity);
+        for (int run = 0; run < 2; ++run) {
+            if (fresh.count[run] <= 0) continue;
+            splat.setUInt("u_first", GLuint(fresh.first[run]));
+            splat.setUInt("u_count", GLuint(fresh.count[run]));
+            m_gl->glDispatchCompute((GLuint(fresh.count[run]) + 255) / 256, 1, 1);
+            RenderStats::dispatch();
+        }
+        m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+        state.use(fuse);
+        fuse.setMat4("u_worldToSensor", glm::inverse(sensorToWorld));
+        fuse.setFloat("u_voxelSize", m_settings.voxelSize);
+        fuse.setFloat("u_truncation", m_settings.truncation);
+        fuse.setUInt("u_maxWeight", kMaxWeight);
+        fuse.setUInt("u_activeCapacity", kActiveCapacity);
+        m_gl->glDispatchComputeIndirect(0);
+        RenderStats::dispatch();
+        m_gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+    if (!any) return false;
+
+    // Queue this tick's blocks for the CPU mirror.
+    m_gl->glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    Readback& r = m_readbacks[m_readbackHead];
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, r.buffer);
+    m_gl->glBindBuffer(GL_COPY_READ_BUFFER, m_activeBuffer);
+    m_gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, kActiveBytes);
+    m_gl->glBindBuffer(GL_COPY_READ_BUFFER, m_stagingBuffer);
+    m_gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, kActiveBytes, kStagingBytes);
+    m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    r.fence = m_gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_readbackHead = (m_readbackHead + 1) % kReadbackSlots;
+    ++m_readbacksInFlight;
+
+    for (GLuint binding = kSensorPointsBinding; binding <= kRangeImageBinding; ++binding)
+        m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kTrackPartialsBinding, 0);
+    m_gl->glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return true;
+}
+
+bool VoxelReconstruction::track(const SensorBuffers::Ranges& scan, const glm::mat4& guess, GLStateCache& state,
+    Shader& shader, int iterations, float maxRange, GpuProfiler* profiler, TrackResult& result)
+{
+    const std::uint32_t total = std::uint32_t(scan.count[0]) + std::uint32_t(scan.count[1]);
+    if (total == 0) return false;
+
+    // The volume and the scan are bound by integrate().
+    m_gl->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kTrackPartialsBinding, m_trackPartials);
+    state.use(shader);
+    for (int run = 0; run < 2; ++run) {
+        shader.setUInt(run ? "u_first[1]" : "u_first[0]", GLuint(std::max(scan.first[run], 0)));
+        shader.setUInt(run ? "u_count[1]" : "u_count[0]", GLuint(std::max(scan.count[run], 0)));
+    }
+    shader.setUInt("u_stride", std::max<std::uint32_t>(1, total / kTrackMaxPoints));
+    shader.setFloat("u_voxelSize", m_settings.voxelSize);
+    shader.setFloat("u_truncation", m_settings.truncation);
+    shader.setFloat("u_maxRange", maxRange);
+    shader.setFloat("u_huber", m_settings.voxelSize);
+
+    m_trackScratch.resize(std::size_t(kTrackGroups) * kTrackRowStride);
+    glm::mat4 pose = guess;
+    bool solved = false;
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        GpuProfiler::Scope scope(profiler, m_gl, kTrackPassNames[iteration]);
+        shader.setMat4("u_sensorToWorld", pose);
+        m_gl->glDispatchCompute(kTrackGroups, 1, 1);
+        RenderStats::dispatch();
+        m_gl->glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_trackPartials);
+        m_gl->glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+            GLsizeiptr(m_trackScratch.size() * sizeof(float)), m_trackScratch.data());
+
+        double sums[kTrackSums] = {};
+        for (GLuint group = 0; group < kTrackGroups; ++group)
+            for (int s = 0; s < kTrackSums; ++s)
+                sums[s] += m_trackScratch[std::size_t(group) * kTrackRowStride + std::size_t(s)];
+        const double inliers = sums[28];
+        if (inliers < kMinTrackInliers) break;
+
+        double A[6][6], b[6], x[6];
+        int s = 0;
+        for (int i = 0; i < 6; ++i)
+            for (int j = i; j < 6; ++j)
+                A[i][j] = A[j][i] = sums[s++];
+        double trace = 0.0;
+        for (int i = 0; i < 6; ++i) {
+            b[i] = -sums[21 + i];
+            trace += A[i][i];
+        }
+        // A little damping keeps directions the scan barely constrains where they were.
+        for (int i = 0; i < 6; ++i) A[i][i] += 1e-6 * trace / 6.0;
+        if (!solveNormalEquations(A, b, x)) break;
+
+        // The twist is about the sensor origin, where the Jacobian was taken.
+        const glm::vec3 omega(float(x[0]), float(x[1]), float(x[2]));
+        const glm::vec3 v(float(x[3]), float(x[4]), float(x[5]));
+        const glm::vec3 centre(pose[3]);
+        const float angle = glm::length(omega);
+        const glm::mat4 rotation = angle > 1e-9f ? glm::mat4_cast(glm::angleAxis(angle, omega / angle)) : glm::mat4(1.0f);
+        pose = orthonormalized(glm::translate(glm::mat4(1.0f), centre + v) * rotation
+            * glm::translate(glm::mat4(1.0f), -centre) * pose);
+
+        solved = true;
+        result.inliers = std::uint32_t(inliers);
+        result.rmsResidual = std::sqrt(sums[27] / inliers);
+        result.iterations = iteration + 1;
+        result.converged = angle < 1e-4f && glm::length(v) < 0.01f * m_settings.voxelSize;
+        if (result.converged) break;
+    }
+    m_gl->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    if (solved) result.pose = pose;
+    return solved;
+}
+
+void VoxelReconstruction::releaseVolume(MeshArena& arena)
+{
+    for (auto& [key, mesh] : m_meshes) arena.release(mesh.mesh->contentHash);
+    m_meshes.clear();
+    m_blocks.clear();
+    m_dirty.clear();
+    m_sources.clear();
+    m_stamp = 0;
+    m_warnedFull = false;
+
+    if (!m_gl) return;
+    for (GLuint* buffer : { &m_hashBuffer, &m_voxelBuffer, &m_activeBuffer, &m_stagingBuffer, &m_rangeImage, &m_trackPartials }) {
+        if (*buffer) GpuMemory::deleteBuffers(m_gl, 1, buffer);
+        *buffer = 0;
+    }
+    for (Readback& r : m_readbacks) {
+        if (r.fence) m_gl->glDeleteSync(r.fence);
+        if (r.buffer) GpuMemory::deleteBuffers(m_gl, 1, &r.buffer);
+        r = Readback{};
+    }
+    m_readbackHead = m_readbackTail = m_readbacksInFlight = 0;
+}
+
+void VoxelReconstruction::destroy(MeshArena& arena)
+{
+    releaseVolume(arena);
+    m_entity = entt::null;
+    m_settings = Settings{};
+    m_tick = ~0ull;
+}
@@ -0,0 +1,168 @@
+#include "WorkspaceMap.hpp"
+#include "components.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <glm/gtc/constants.hpp>
+
+namespace
+{
+    // Samples per pool task when drawing and evaluating a batch.
+    constexpr std::size_t kChunk = 2048;
+    constexpr std::uint32_t kOutside = ~0u;
+
+    int defaultTip(const KinematicModel& model)
+    {
+        for (int link = model.linkCount() - 1; link > 0; --link)
+            if (model.isEndEffector(link)) return link;
+        return model.linkCount() - 1;
+    }
+
+    // det(J J^T) for a 3 x n positional Jacobian, det(J^T J) below three
+    // columns, where the other is always 0.
+    double manipulability(const glm::dvec3* columns, std::size_t n)
+    {
+        if (n >= 3) {
+            glm::dmat3 jjt(0.0);
+            for (std::size_t c = 0; c < n; ++c) jjt += glm::outerProduct(columns[c], columns[c]);
+            return std::sqrt(std::max(glm::determinant(jjt), 0.0));
+        }
+        if (n == 2) {
+            const double a = glm::dot(columns[0], columns[0]), b = glm::dot(columns[0], columns[1]),
+                         d = glm::dot(columns[1], columns[1]);
+            return std::sqrt(std::max(a * d - b * b, 0.0));
+        }
+        return n == 1 ? glm::length(columns[0]) : 0.0;
+    }
+}
+
+WorkspaceMap WorkspaceMap::compute(const KinematicModel& model, const Settings& settings,
+    const KinematicModel::Pose& base, const std::atomic<bool>* cancel)
+{
+    WorkspaceMap map;
+    const std::size_t dofs = std::size_t(model.dofCount());
+    const std::size_t links = std::size_t(model.linkCount());
+    if (dofs == 0 || settings.samples == 0) return map;
+
+    map.tip = settings.tip >= 0 && settings.tip < model.linkCount() ? settings.tip : defaultTip(model);
+    map.resolution = glm::clamp(settings.resolution, glm::ivec3(1), glm::ivec3(512));
+    const std::size_t voxels = std::size_t(map.resolution.x) * map.resolution.y * map.resolution.z;
+
+    // Moving joints between the tip and the root: the Jacobian's columns.
+    std::vector<int> chain;
+    for (int link = map.tip; link >= 0; link = model.parentOf(link))
+        if (model.dofOf(link) >= 0) chain.push_back(link);
+
+    std::vector<double> lower(dofs), range(dofs);
+    for (std::size_t d = 0; d < dofs; ++d) {
+        const int dof = int(d);
+        const bool revolute = model.motionOf(model.dofLink(dof)) == KinematicModel::Motion::Revolute;
+        lower[d] = model.isLimited(dof) ? model.lowerLimit(dof) : revolute ? -glm::pi<double>() : -1.0;
+        range[d] = model.isLimited(dof) ? model.upperLimit(dof) - model.lowerLimit(dof) : revolute ? 2.0 * glm::pi<double>() : 2.0;
+    }
+
+    std::vector<double> q(kBatch * dofs);
+    std::vector<KinematicModel::Pose> world(kBatch * links);
+    std::vector<glm::vec3> tips(kBatch);
+    std::vector<float> dexterity(kBatch);
+    std::vector<std::uint32_t> voxelOf(kBatch);
+    ThreadPool& pool = ThreadPool::shared();
+
+    for (std::uint64_t drawn = 0; drawn < settings.samples;) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) return WorkspaceMap{};
+        const std::size_t count = std::size_t(std::min<std::uint64_t>(kBatch, settings.samples - drawn));
+        const std::size_t chunks = (count + kChunk - 1) / kChunk;
+
+        // Every chunk has its own stream, so the map does not depend on the pool's size.
+        pool.parallelFor(chunks, [&](std::size_t chunk) {
+            std::mt19937_64 random(settings.seed * 0x9e3779b97f4a7c15ull + (drawn / kChunk + chunk));
+            std::uniform_real_distribution<double> unit(0.0, 1.0);
+            const std::size_t end = std::min(count, (chunk + 1) * kChunk);
+            for (std::size_t s = chunk * kChunk; s < end; ++s)
+                for (std::size_t d = 0; d < dofs; ++d) q[s * dofs + d] = lower[d] + range[d] * unit(random);
+        });
+        model.forwardBatch(q.data(), count, world.data(), base);
+
+        pool.parallelFor(chunks, [&](std::size_t chunk) {
+            std::vector<glm::dvec3> columns(chain.size());
+            const std::size_t end = std::min(count, (chunk + 1) * kChunk);
+            for (std::size_t s = chunk * kChunk; s < end; ++s) {
+                const KinematicModel::Pose* poses = world.data() + s * links;
+                const glm::dvec3 tip(poses[map.tip].translation);
+                for (std::size_t c = 0; c < chain.size(); ++c) {
+                    const int link = chain[c];
+                    const glm::dvec3 axis(poses[link].rotation * model.axisOf(link));
+                    columns[c] = model.motionOf(link) == KinematicModel::Motion::Revolute
+                        ? glm::cross(axis, tip - glm::dvec3(poses[link].translation))
+                        : axis;
+                }
+                tips[s] = glm::vec3(tip);
+                dexterity[s] = float(manipulability(columns.data(), columns.size()));
+            }
+        });
+
+        if (drawn == 0) {
+            glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+            for (std::size_t s = 0; s < count; ++s) {
+                lo = glm::min(lo, tips[s]);
+                hi = glm::max(hi, tips[s]);
+            }
+            const glm::vec3 pad = glm::max(hi - lo, glm::vec3(1e-3f)) * kPadding;
+            map.boundsMin = lo - pad;
+            map.boundsMax = hi + pad;
+            map.hits.assign(voxels, 0);
+            map.manipulability.assign(voxels, 0.0f);
+        }
+
+        const glm::vec3 scale = glm::vec3(map.resolution) / (map.boundsMax - map.boundsMin);
+        pool.parallelFor(chunks, [&](std::size_t chunk) {
+            const std::size_t end = std::min(count, (chunk + 1) * kChunk);
+            for (std::size_t s = chunk * kChunk; s < end; ++s) {
+                const glm::ivec3 cell = glm::ivec3(glm::floor((tips[s] - map.boundsMin) * scale));
+                const bool inside = glm::all(glm::greaterThanEqual(cell, glm::ivec3(0)))
+                    && glm::all(glm::lessThan(cell, map.resolution));
+                voxelOf[s] = inside ? std::uint32_t((cell.z * map.resolution.y + cell.y) * map.resolution.x + cell.x) : kOutside;
+            }
+        });
+        // Accumulated here: a voxel would otherwise need atomics.
+        std::uint64_t outside = 0;
+        for (std::size_t s = 0; s < count; ++s) {
+            const std::uint32_t voxel = voxelOf[s];
+            if (voxel == kOutside) {
+                ++outside;
+                continue;
+            }
+            map.maxHits = std::max(map.maxHits, ++map.hits[voxel]);
+            map.manipulability[voxel] = std::max(map.manipulability[voxel], dexterity[s]);
+            map.maxManipulability = std::max(map.maxManipulability, dexterity[s]);
+        }
+        map.outside += outside;
+        map.samples += count - outside;
+        drawn += count;
+    }
+    return map;
+}
+
+std::size_t WorkspaceMap::reachedVoxels() const
+{
+    return std::size_t(std::count_if(hits.begin(), hits.end(), [](std::uint32_t h) { return h > 0; }));
+}
+
+std::shared_ptr<const ScalarVolume> WorkspaceMap::volume(Quantity quantity) const
+{
+    auto out = std::make_shared<ScalarVolume>();
+    out->resolution = resolution;
+    out->values.resize(hits.size());
+    if (quantity == Quantity::Reachability) {
+        const float norm = maxHits ? 1.0f / std::log1p(float(maxHits)) : 0.0f;
+        for (std::size_t i = 0; i < hits.size(); ++i) out->values[i] = std::log1p(float(hits[i])) * norm;
+    }
+    else {
+        const float norm = maxManipulability > 0.0f ? 1.0f / maxManipulability : 0.0f;
+        for (std::size_t i = 0; i < manipulability.size(); ++i) out->values[i] = manipulability[i] * norm;
+    }
+    return out;
+}
@@ -0,0 +1,439 @@
+#include "WorldPartition.hpp"
+#include "SceneFileFormat.hpp"
+#include "components.hpp"
+#include "CullingSystem.hpp"
+#include "MeshBinary.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimize.hpp"
+#include "ThreadPool.hpp"
+#include "TraceZones.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_set>
+#include <entt/entt.hpp>
+
+using namespace SceneFileFormat;
+
+namespace
+{
+    // A cell's proxy is simplified down to about this many triangles.
+    constexpr std::size_t kProxyTriangles = 4096;
+
+    std::uint64_t align8(std::uint64_t offset) { return (offset + 7) & ~std::uint64_t(7); }
+
+    QString cellDirectory(const QFileInfo& index)
+    {
+        return QDir(index.absolutePath()).absoluteFilePath(index.completeBaseName() + "_cells");
+    }
+
+    QString cellPath(const QString& directory, const glm::ivec3& coord)
+    {
+        return QDir(directory).absoluteFilePath(QString("%1_%2_%3.krscene").arg(coord.x).arg(coord.y).arg(coord.z));
+    }
+
+    struct CellBuild {
+        glm::ivec3 coord{ 0 };
+        std::vector<entt::entity> entities;
+        std::vector<glm::mat4> world;                ///< per entity, taken on the GUI thread
+        glm::vec3 min{ FLT_MAX }, max{ -FLT_MAX };
+        std::vector<unsigned char> proxy;            ///< .kmesh
+        std::string error;
+    };
+
+    // The cell's meshes merged around the centre of its bounds, simplified.
+    std::vector<unsigned char> buildProxy(const entt::registry& registry, const CellBuild& cell)
+    {
+        const glm::vec3 centre = 0.5f * (cell.min + cell.max);
+        MeshData merged;
+        for (std::size_t i = 0; i < cell.entities.size(); ++i) {
+            const auto& mesh = registry.get<RenderableMeshComponent>(cell.entities[i]);
+            const glm::mat4& m = cell.world[i];
+            const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(m)));
+            const unsigned base = unsigned(merged.vertices.size());
+            for (const Vertex& v : mesh.vertices()) {
+                const glm::vec3 n = normalMatrix * v.normal;
+                const float length = glm::length(n);
+                merged.vertices.emplace_back(glm::vec3(m * glm::vec4(v.position, 1.0f)) - centre,
+                    length > 0.0f ? n / length : n, v.uv);
+            }
+            for (unsigned index : mesh.indices()) merged.indices.push_back(base + index);
+        }
+        if (merged.indices.empty()) return {};
+
+        if (merged.indices.size() > kProxyTriangles * 3)
+            merged.indices = MeshOptimize::simplify(merged.vertices, merged.indices, kProxyTriangles * 3);
+        MeshOptimize::optimizeVertexFetch(merged.vertices, merged.indices);
+        return MeshBinary::encode(merged, {}, 0);
+    }
+}
+
+WorldPartition::WorldPartition()
+    : m_loader([this] { loaderLoop(); })
+{
+}
+
+WorldPartition::~WorldPartition()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stopping = true;
+        m_queue.clear();
+    }
+    m_queueCv.notify_all();
+    m_loader.join();
+}
+
+// ============================================================================
+// --- Build ---
+// ============================================================================
+
+bool WorldPartition::build(entt::registry& registry, const std::string& path, float cellSize, std::string* error)
+{
+    KR_ZONE("build world partition");
+    auto fail = [error](const std::string& message) {
+        if (error) *error = message;
+        return false;
+    };
+    if (!(cellSize > 0.0f)) return fail("The cell size must be positive.");
+
+    CullingSystem::updateWorldBounds(registry);
+    std::unordered_set<entt::entity> parents;
+    for (auto [entity, parent] : registry.view<ParentComponent>().each()) parents.insert(parent.parent);
+
+    // Top-level meshes are streamed; hierarchies and everything without a
+    // mesh stay resident.
+    std::vector<entt::entity> resident;
+    std::map<std::tuple<int, int, int>, CellBuild> byCoord;   // ordered: files and records come out stable
+    for (entt::entity entity : SceneFile::savedEntities(registry)) {
+        const auto* bounds = registry.try_get<WorldBoundsComponent>(entity);
+        const bool streamed = bounds && bounds->valid && registry.all_of<RenderableMeshComponent>(entity)
+            && !registry.all_of<ParentComponent>(entity) && !parents.count(entity);
+        if (!streamed) {
+            resident.push_back(entity);
+            continue;
+        }
+        const glm::ivec3 coord(glm::floor(0.5f * (bounds->min + bounds->max) / cellSize));
+        CellBuild& cell = byCoord[std::make_tuple(coord.x, coord.y, coord.z)];
+        cell.coord = coord;
+        cell.entities.push_back(entity);
+        const auto* world = registry.try_get<WorldTransformComponent>(entity);
+        cell.world.push_back(world ? world->matrix : registry.get<TransformComponent>(entity).getTransform());
+        cell.min = glm::min(cell.min, bounds->min);
+        cell.max = glm::max(cell.max, bounds->max);
+    }
+    std::vector<CellBuild> cells;
+    cells.reserve(byCoord.size());
+    for (auto& [coord, cell] : byCoord) cells.push_back(std::move(cell));
+
+    const QFileInfo info(QString::fromStdString(path));
+    const QString directory = cellDirectory(info);
+    if (!QDir().mkpath(directory)) return fail("Could not create " + directory.toStdString());
+    // Cells of an earlier build that no longer exist would otherwise linger.
+    QDir dir(directory);
+    for (const QString& stale : dir.entryList({ "*.krscene" }, QDir::Files)) dir.remove(stale);
+
+    // Each task reads the registry only, so the cells are written in parallel.
+    ThreadPool::shared().parallelFor(cells.size(), [&](std::size_t i) {
+        CellBuild& cell = cells[i];
+        try {
+            if (SceneFile::save(registry, cell.entities, cellPath(directory, cell.coord).toStdString(), &cell.error))
+                cell.proxy = buildProxy(registry, cell);
+        }
+        catch (const std::exception& e) {
+            cell.error = e.what();
+        }
+    });
+    for (const CellBuild& cell : cells)
+        if (!cell.error.empty()) return fail(cell.error);
+    std::string residentError;
+    if (!SceneFile::save(registry, resident, dir.absoluteFilePath("resident.krscene").toStdString(), &residentError))
+        return fail(residentError);
+
+    // --- Index: header, cell records, proxy blobs ---
+    WorldHeader header;
+    header.cellCount = std::uint32_t(cells.size());
+    header.cellSize = cellSize;
+    std::vector<CellRecord> records(cells.size());
+    std::uint64_t offset = align8(sizeof(WorldHeader) + records.size() * sizeof(CellRecord));
+    for (std::size_t i = 0; i < cells.size(); ++i) {
+        const CellBuild& cell = cells[i];
+        CellRecord& r = records[i];
+        for (int a = 0; a < 3; ++a) {
+            r.coord[a] = cell.coord[a];
+            r.boundsMin[a] = cell.min[a];
+            r.boundsMax[a] = cell.max[a];
+        }
+        r.entityCount = std::uint32_t(cell.entities.size());
+        if (!cell.proxy.empty()) {
+            r.proxyOffset = offset;
+            r.proxySize = cell.proxy.size();
+            offset = align8(offset + r.proxySize);
+        }
+    }
+
+    std::vector<unsigned char> bytes(std::size_t(offset), 0);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    if (!records.empty()) std::memcpy(bytes.data() + sizeof(header), records.data(), records.size() * sizeof(CellRecord));
+    for (std::size_t i = 0; i < cells.size(); ++i)
+        if (!cells[i].proxy.empty())
+            std::memcpy(bytes.data() + records[i].proxyOffset, cells[i].proxy.data(), cells[i].proxy.size());
+
+    QSaveFile file(info.absoluteFilePath());
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(reinterpret_cast<const char*>(bytes.data()), qint64(bytes.size())) != qint64(bytes.size()) ||
+        !file.commit())
+        return fail("Could not write " + path);
+    return true;
+}
+
+// ============================================================================
+// --- Open / close ---
+// ============================================================================
+
+bool WorldPartition::open(entt::registry& registry, const std::string& path, std::string* error)
+{
+    KR_ZONE("open world partition");
+    close(registry);
+    auto fail = [error](const std::string& message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    const QFileInfo info(QString::fromStdString(path));
+    QFile file(info.absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly)) return fail("Could not open " + path);
+    const qint64 size = file.size();
+    const unsigned char* map = size >= qint64(sizeof(WorldHeader)) ? file.map(0, size) : nullptr;
+    if (!map) return fail("Not a .krworld file.");
+
+    WorldHeader header;
+    std::memcpy(&header, map, sizeof(header));
+    if (header.magic != kWorldMagic) return fail("Not a .krworld file.");
+    if (header.version != kWorldVersion)
+        return fail(".krworld version " + std::to_string(header.version) + " is not supported.");
+    if (sizeof(WorldHeader) + std::uint64_t(header.cellCount) * sizeof(CellRecord) > std::uint64_t(size))
+        return fail(".krworld is truncated.");
+    std::vector<CellRecord> records(header.cellCount);
+    if (!records.empty()) std::memcpy(records.data(), map + sizeof(WorldHeader), records.size() * sizeof(CellRecord));
+
+    // Proxies are small; decoded in parallel, then shown in one go.
+    const QString directory = cellDirectory(info);
+    std::vector<Cell> cells(records.size());
+    ThreadPool::shared().parallelFor(records.size(), [&](std::size_t i) {
+        const CellRecord& r = records[i];
+        Cell& cell = cells[i];
+        cell.coord = glm::ivec3(r.coord[0], r.coord[1], r.coord[2]);
+        cell.min = glm::vec3(r.boundsMin[0], r.boundsMin[1], r.boundsMin[2]);
+        cell.max = glm::vec3(r.boundsMax[0], r.boundsMax[1], r.boundsMax[2]);
+        cell.entityCount = r.entityCount;
+        cell.path = cellPath(directory, cell.coord).toStdString();
+        if (r.proxySize == 0 || r.proxyOffset > std::uint64_t(size) || r.proxySize > std::uint64_t(size) - r.proxyOffset)
+            return;
+        try {
+            MeshData mesh;
+            if (MeshBinary::decode(map + r.proxyOffset, std::size_t(r.proxySize), mesh))
+                cell.proxyMesh = MeshCache::shared().adopt(std::move(mesh));
+        }
+        catch (const std::exception& e) {
+            qWarning() << "[WorldPartition] Cell proxy:" << e.what();
+        }
+    });
+
+    m_cells = std::move(cells);
+    m_name = info.completeBaseName().toStdString();
+    for (Cell& cell : m_cells) showProxy(registry, cell);
+    m_resident = startLoad(QDir(directory).absoluteFilePath("resident.krscene").toStdString());
+    return true;
+}
+
+void WorldPartition::close(entt::registry& registry)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_queue.clear();
+    }
+    for (Cell& cell : m_cells) {
+        for (entt::entity entity : cell.entities)
+            if (registry.valid(entity)) registry.destroy(entity);
+        if (registry.valid(cell.proxy)) registry.destroy(cell.proxy);
+    }
+    for (entt::entity entity : m_residentEntities)
+        if (registry.valid(entity)) registry.destroy(entity);
+    m_cells.clear();
+    m_residentEntities.clear();
+    m_resident.reset();
+}
+
+// ============================================================================
+// --- Streaming ---
+// ============================================================================
+
+std::shared_ptr<WorldPartition::Load> WorldPartition::startLoad(const std::string& path)
+{
+    auto load = std::make_shared<Load>();
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_queue.emplace_back(path, load);
+    }
+    m_queueCv.notify_one();
+    return load;
+}
+
+void WorldPartition::loaderLoop()
+{
+    TraceZones::setThreadName("world streaming");
+    for (;;) {
+        std::pair<std::string, std::shared_ptr<Load>> job;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_queueCv.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_stopping) return;
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        // Dropped by update() while it waited: nobody wants it any more.
+        if (job.second.use_count() == 1) continue;
+
+        KR_ZONE("stream cell");
+        Load& load = *job.second;
+        load.ok = SceneFile::read(job.first, load.scene, &load.error);
+        load.done.store(true, std::memory_order_release);
+    }
+}
+
+double WorldPartition::distance(const Cell& cell, const std::vector<glm::dvec3>& viewers) const
+{
+    double nearest = std::numeric_limits<double>::infinity();
+    const glm::dvec3 min(cell.min), max(cell.max);
+    for (const glm::dvec3& viewer : viewers) {
+        const glm::dvec3 d = viewer - glm::clamp(viewer, min, max);
+        nearest = std::min(nearest, glm::dot(d, d));
+    }
+    return std::sqrt(nearest);
+}
+
+void WorldPartition::showProxy(entt::registry& registry, Cell& cell)
+{
+    if (!cell.proxyMesh || cell.proxy != entt::null) return;
+    cell.proxy = registry.create();
+    registry.emplace<TagComponent>(cell.proxy, m_name + " cell " + std::to_string(cell.coord.x) + ","
+        + std::to_string(cell.coord.y) + "," + std::to_string(cell.coord.z));
+    registry.emplace<TransformComponent>(cell.proxy).translation = 0.5f * (cell.min + cell.max);
+    registry.emplace<RenderableMeshComponent>(cell.proxy, cell.proxyMesh);
+    registry.emplace<MaterialComponent>(cell.proxy);
+    registry.emplace<WorldCellProxyTag>(cell.proxy);
+}
+
+void WorldPartition::unload(entt::registry& registry, Cell& cell)
+{
+    for (entt::entity entity : cell.entities)
+        if (registry.valid(entity)) registry.destroy(entity);
+    cell.entities.clear();
+    cell.load.reset();
+    cell.state = CellState::Proxy;
+    showProxy(registry, cell);
+}
+
+bool WorldPartition::update(entt::registry& registry, const std::vector<glm::dvec3>& viewers)
+{
+    if (!isOpen()) return false;
+    KR_ZONE("world streaming");
+    bool changed = false;
+
+    if (m_resident && m_resident->done.load(std::memory_order_acquire)) {
+        if (m_resident->ok) m_residentEntities = SceneFile::commit(registry, std::move(m_resident->scene));
+        else qWarning() << "[WorldPartition]" << QString::fromStdString(m_resident->error);
+        m_resident.reset();
+        changed = true;
+    }
+
+    // Finished loads take their proxy's place.
+    for (Cell& cell : m_cells) {
+        if (cell.state != CellState::Loading || !cell.load->done.load(std::memory_order_acquire)) continue;
+        if (cell.load->ok) {
+            cell.entities = SceneFile::commit(registry, std::move(cell.load->scene));
+            if (registry.valid(cell.proxy)) registry.destroy(cell.proxy);
+            cell.proxy = entt::null;
+            cell.state = CellState::Loaded;
+        }
+        else {
+            qWarning() << "[WorldPartition]" << QString::fromStdString(cell.load->error);
+            cell.failed = true;
+            cell.state = CellState::Proxy;
+        }
+        cell.load.reset();
+        changed = true;
+    }
+
+    // Drop what left the hysteresis band; collect what entered the radius.
+    const double keepRadius = double(m_settings.loadRadius) + double(std::max(0.0f, m_settings.hysteresis));
+    std::size_t budgetUsed = 0;
+    int inFlight = 0;
+    std::vector<std::pair<double, std::size_t>> wanted, held;
+    for (std::size_t i = 0; i < m_cells.size(); ++i) {
+        Cell& cell = m_cells[i];
+        const double d = distance(cell, viewers);
+        if (cell.state == CellState::Proxy) {
+            if (!cell.failed && d <= m_settings.loadRadius) wanted.emplace_back(d, i);
+            continue;
+        }
+        if (d > keepRadius) {
+            unload(registry, cell);
+            changed = true;
+            continue;
+        }
+        budgetUsed += cell.entityCount;
+        inFlight += cell.state == CellState::Loading;
+        held.emplace_back(d, i);
+    }
+
+    // Over budget (it was lowered): the farthest cells go first.
+    std::sort(held.begin(), held.end());
+    while (budgetUsed > m_settings.maxResidentEntities && !held.empty()) {
+        Cell& cell = m_cells[held.back().second];
+        held.pop_back();
+        budgetUsed -= cell.entityCount;
+        inFlight -= cell.state == CellState::Loading;
+        unload(registry, cell);
+        changed = true;
+    }
+
+    // Nearest first; a cell too big for what is left of the budget lets a
+    // smaller, further one in.
+    std::sort(wanted.begin(), wanted.end());
+    for (const auto& [d, i] : wanted) {
+        if (inFlight >= m_settings.maxLoadsInFlight) break;
+        Cell& cell = m_cells[i];
+        if (budgetUsed + cell.entityCount > m_settings.maxResidentEntities) continue;
+        cell.load = startLoad(cell.path);
+        cell.state = CellState::Loading;
+        budgetUsed += cell.entityCount;
+        ++inFlight;
+    }
+    return changed;
+}
+
+WorldPartition::Stats WorldPartition::stats() const
+{
+    Stats s;
+    s.cells = m_cells.size();
+    for (const Cell& cell : m_cells) {
+        s.loaded += cell.state == CellState::Loaded;
+        s.loading += cell.state == CellState::Loading;
+        s.streamedEntities += cell.entities.size();
+    }
+    if (m_resident) ++s.loading;
+    return s;
+}
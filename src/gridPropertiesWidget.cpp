@@ -63,6 +63,11 @@ gridPropertiesWidget::~gridPropertiesWidget()
     delete ui;
 }
 
+void gridPropertiesWidget::refresh()
+{
+    initializeUI();
+}
+
 void gridPropertiesWidget::initializeUI()
 {
     QSignalBlocker blocker(this);
@@ -76,6 +81,10 @@ void gridPropertiesWidget::initializeUI()
     ui->lineThicknessBox->setValue(grid.baseLineWidthPixels);
     ui->visualizationCombo->setCurrentIndex(grid.isDotted ? 1 : 0);
     ui->gridSnapToggleButton->setChecked(grid.snappingEnabled);
+    {
+        const QSignalBlocker unitBlocker(ui->unitInputBox);
+        ui->unitInputBox->setCurrentIndex(grid.isMetric ? 0 : 1);
+    }
     onUnitSystemChanged();
 }
 
@@ -89,7 +98,10 @@ void gridPropertiesWidget::setupConnections()
 
     connect(ui->gridNameInput, &QLineEdit::textChanged, this, [this](const QString& text) {
         if (m_scene->getRegistry().valid(m_entity)) {
-            m_scene->getRegistry().get<TagComponent>(m_entity).tag = text.toStdString();
+            UndoStack::Scope edit(m_scene->undo(), m_scene->getRegistry(), "Rename grid");
+            edit.track<TagComponent>(m_entity);
+            // Patched, so the scene's NameIndex sees the new name.
+            m_scene->getRegistry().patch<TagComponent>(m_entity, [&](TagComponent& t) { t.tag = text.toStdString(); });
         }
         });
 
@@ -97,24 +109,32 @@ void gridPropertiesWidget::setupConnections()
 
     connect(ui->lineThicknessBox, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this](double value) {
         if (m_scene->getRegistry().valid(m_entity)) {
+            UndoStack::Scope edit(m_scene->undo(), m_scene->getRegistry(), "Grid line width");
+            edit.track<GridComponent>(m_entity);
             m_scene->getRegistry().get<GridComponent>(m_entity).baseLineWidthPixels = static_cast<float>(value);
         }
         });
 
     connect(ui->visualizationCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
         if (m_scene->getRegistry().valid(m_entity)) {
+            UndoStack::Scope edit(m_scene->undo(), m_scene->getRegistry(), "Grid style");
+            edit.track<GridComponent>(m_entity);
             m_scene->getRegistry().get<GridComponent>(m_entity).isDotted = (index == 1);
         }
         });
 
     connect(ui->gridSnapToggleButton, &QToolButton::toggled, this, [this](bool checked) {
         if (m_scene->getRegistry().valid(m_entity)) {
+            UndoStack::Scope edit(m_scene->undo(), m_scene->getRegistry(), "Grid snapping");
+            edit.track<GridComponent>(m_entity);
             m_scene->getRegistry().get<GridComponent>(m_entity).snappingEnabled = checked;
         }
         });
 
     connect(ui->masterVisibilityCheck, &QCheckBox::toggled, this, [this](bool checked) {
         if (m_scene->getRegistry().valid(m_entity)) {
+            UndoStack::Scope edit(m_scene->undo(), m_scene->getRegistry(), "Grid visibility");
+            edit.track<GridComponent>(m_entity);
             m_scene->getRegistry().get<GridComponent>(m_entity).masterVisible = checked;
         }
         });
@@ -122,6 +142,8 @@ void gridPropertiesWidget::setupConnections()
     auto connect_axis_color = [&](QToolButton* button, QFrame* frame, bool is_x_axis) {
         connect(button, &QToolButton::clicked, this, [this, frame, is_x_axis]() {
             if (!m_scene->getRegistry().valid(m_entity)) return;
+            UndoStack::Scope edit(m_scene->undo(), m_scene->getRegistry(), "Grid axis colour");
+            edit.track<GridComponent>(m_entity);
             auto& grid = m_scene->getRegistry().get<GridComponent>(m_entity);
             glm::vec3& color_vec = is_x_axis ? grid.xAxisColor : grid.zAxisColor;
 
@@ -144,6 +166,8 @@ void gridPropertiesWidget::setupConnections()
         if (level_vis_checks[i]) {
             connect(level_vis_checks[i], &QCheckBox::toggled, this, [this, i](bool checked) {
                 if (m_scene->getRegistry().valid(m_entity)) {
+                    UndoStack::Scope edit(m_scene->undo(), m_scene->getRegistry(), "Grid level visibility");
+                    edit.track<GridComponent>(m_entity);
                     m_scene->getRegistry().get<GridComponent>(m_entity).levelVisible[i] = checked;
                 }
                 });
@@ -151,6 +175,8 @@ void gridPropertiesWidget::setupConnections()
         if (level_color_buttons[i] && level_color_frames[i]) {
             connect(level_color_buttons[i], &QToolButton::clicked, this, [this, frame = level_color_frames[i], i]() {
                 if (!m_scene->getRegistry().valid(m_entity)) return;
+                UndoStack::Scope edit(m_scene->undo(), m_scene->getRegistry(), "Grid level colour");
+                edit.track<GridComponent>(m_entity);
                 auto& grid = m_scene->getRegistry().get<GridComponent>(m_entity);
                 if (static_cast<size_t>(i) < grid.levels.size()) {
                     glm::vec3& color_ref = grid.levels[i].color;
@@ -169,6 +195,8 @@ void gridPropertiesWidget::setupConnections()
         connect(spinbox, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this, component_index](double value) {
             if (m_updating) return;
             if (!m_scene->getRegistry().valid(m_entity)) return;
+            UndoStack::Scope edit(m_scene->undo(), m_scene->getRegistry(), "Move grid");
+            edit.track<TransformComponent>(m_entity);
             auto& transform = m_scene->getRegistry().get<TransformComponent>(m_entity);
             auto& grid = m_scene->getRegistry().get<GridComponent>(m_entity);
             float final_value = grid.isMetric ? value : value * 0.0254f;
@@ -196,6 +224,8 @@ void gridPropertiesWidget::onUnitSystemChanged()
     m_updating = true;
     if (!m_scene->getRegistry().valid(m_entity)) { m_updating = false; return; }
 
+    UndoStack::Scope edit(m_scene->undo(), m_scene->getRegistry(), "Grid units");
+    edit.track<GridComponent>(m_entity);
     auto& grid = m_scene->getRegistry().get<GridComponent>(m_entity);
     auto& transform = m_scene->getRegistry().get<TransformComponent>(m_entity);
     grid.isMetric = (ui->unitInputBox->currentIndex() == 0);
@@ -277,7 +307,11 @@ void gridPropertiesWidget::onEulerChanged()
     );
     glm::quat new_rotation = glm::quat(glm::radians(euler_deg));
 
-    m_scene->getRegistry().get<TransformComponent>(m_entity).rotation = new_rotation;
+    {
+        UndoStack::Scope edit(m_scene->undo(), m_scene->getRegistry(), "Rotate grid");
+        edit.track<TransformComponent>(m_entity);
+        m_scene->getRegistry().get<TransformComponent>(m_entity).rotation = new_rotation;
+    }
     updateOrientationInputs(new_rotation);
 }
 
@@ -293,6 +327,10 @@ void gridPropertiesWidget::onQuaternionChanged()
         (float)ui->angleInputQuatZ->value()
     ));
 
-    m_scene->getRegistry().get<TransformComponent>(m_entity).rotation = new_rotation;
+    {
+        UndoStack::Scope edit(m_scene->undo(), m_scene->getRegistry(), "Rotate grid");
+        edit.track<TransformComponent>(m_entity);
+        m_scene->getRegistry().get<TransformComponent>(m_entity).rotation = new_rotation;
+    }
     updateOrientationInputs(new_rotation);
 }
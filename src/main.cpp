@@ -1,36 +1,110 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QFile>
 #include <QSurfaceFormat>
 #include <QLoggingCategory>
+#include <QStandardPaths>
 
-static void qtMessageOutput(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+#include <algorithm>
+
+#include "EventLog.hpp"
+#include "FrameBenchmark.hpp"
+#include "GpuMemory.hpp"
+#include "MainWindow.hpp"
+#include "PerfGate.hpp"
+#include "Trace.hpp"
+#include "TraceZones.hpp"
+
+// --benchmark <report.json> renders FrameBenchmark's scene headless and
+// exits: 0 on success, 1 if it could not run, 2 if a timing regressed
+// against the baseline (PerfGate: median beyond --bench-tolerance and
+// Mann-Whitney p below --bench-alpha). The baseline is --bench-baseline, or
+// this machine's under --bench-baseline-dir, recorded there by the first
+// run or by --bench-record. With
+// --bench-sweep robots=1,4,16,64 it runs once per value and writes the
+// scaling report instead.
+static int runFrameBenchmark(const QStringList& arguments)
 {
-    QByteArray localMsg = msg.toLocal8Bit();
-    const char *file = context.file ? context.file : "";
-    const char *function = context.function ? context.function : "";
-    switch (type) {
-    case QtDebugMsg:
-        fprintf(stderr, "Debug: %s (%s:%u, %s)\n", localMsg.constData(), file, context.line, function);
-        break;
-    case QtInfoMsg:
-        fprintf(stderr, "Info: %s (%s:%u, %s)\n", localMsg.constData(), file, context.line, function);
-        break;
-    case QtWarningMsg:
-        fprintf(stderr, "Warning: %s (%s:%u, %s)\n", localMsg.constData(), file, context.line, function);
-        break;
-    case QtCriticalMsg:
-        fprintf(stderr, "Critical: %s (%s:%u, %s)\n", localMsg.constData(), file, context.line, function);
-        break;
-    case QtFatalMsg:
-        fprintf(stderr, "Fatal: %s (%s:%u, %s)\n", localMsg.constData(), file, context.line, function);
-        abort();
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption report("benchmark", "Run the frame benchmark, write the report to <file>.", "file");
+    const QCommandLineOption robots("bench-robots", "Robots in the scene.", "n", "4");
+    const QCommandLineOption splines("bench-splines", "Splines in the scene.", "n", "16");
+    const QCommandLineOption arrows("bench-arrows", "Arrow field density per axis.", "n", "16");
+    const QCommandLineOption particles("bench-particles", "Flow particles.", "n", "20000");
+    const QCommandLineOption visualizers("bench-visualizers", "Arrow + flow visualizer pairs.", "n", "1");
+    const QCommandLineOption effectors("bench-effectors", "Effectors beyond the default three.", "n", "0");
+    const QCommandLineOption sweep("bench-sweep", "Run once per value of one parameter.", "name=v1,v2,...");
+    const QCommandLineOption frames("bench-frames", "Measured frames.", "n", "600");
+    const QCommandLineOption warmup("bench-warmup", "Frames rendered before measuring.", "n", "60");
+    const QCommandLineOption size("bench-size", "Output size.", "WxH", "1920x1080");
+    const QCommandLineOption seed("bench-seed", "Scene seed.", "n", "1");
+    const QCommandLineOption robotFile("bench-robot", "Robot URDF.", "file", "simple_arm.urdf");
+    const QCommandLineOption camera("bench-camera", "Camera path JSON (default: built-in orbit).", "file");
+    const QCommandLineOption baseline("bench-baseline", "Report to compare against.", "file");
+    const QCommandLineOption baselineDir("bench-baseline-dir", "Per-machine baselines.", "dir");
+    const QCommandLineOption record("bench-record", "Store the report as this machine's baseline.");
+    const QCommandLineOption tolerance("bench-tolerance", "Allowed median growth over the baseline.", "fraction", "0.1");
+    const QCommandLineOption alpha("bench-alpha", "Significance level of a regression.", "p", "0.01");
+    const QCommandLineOption verdict("bench-verdict", "Write the gate's verdict JSON to <file>.", "file");
+    parser.addOptions({ report, robots, splines, arrows, particles, visualizers, effectors, sweep, frames, warmup,
+        size, seed, robotFile, camera, baseline, baselineDir, record, tolerance, alpha, verdict });
+    parser.process(arguments);
+
+    FrameBenchmark::Config config;
+    config.robots = parser.value(robots).toInt();
+    config.splines = parser.value(splines).toInt();
+    config.arrowDensity = parser.value(arrows).toInt();
+    config.particles = parser.value(particles).toInt();
+    config.visualizers = parser.value(visualizers).toInt();
+    config.effectors = parser.value(effectors).toInt();
+    config.frames = parser.value(frames).toInt();
+    config.warmupFrames = parser.value(warmup).toInt();
+    config.seed = parser.value(seed).toUInt();
+    config.robotFile = parser.value(robotFile);
+    config.cameraPath = parser.value(camera);
+    const QStringList wh = parser.value(size).split('x');
+    if (wh.size() == 2) {
+        config.width = wh[0].toInt();
+        config.height = wh[1].toInt();
+    }
+
+    const QString reportPath = parser.value(report);
+    if (parser.isSet(sweep)) {
+        const QStringList spec = parser.value(sweep).split('=');
+        std::vector<int> values;
+        for (const QString& v : spec.value(1).split(',', Qt::SkipEmptyParts)) values.push_back(v.toInt());
+        return FrameBenchmark::runSweep(config, spec.value(0), values, reportPath) ? 0 : 1;
+    }
+    if (!FrameBenchmark::run(config, reportPath)) return 1;
+
+    QString baselinePath = parser.value(baseline);
+    if (baselinePath.isEmpty() && parser.isSet(baselineDir)) {
+        const QString machine = FrameBenchmark::machineKey(PerfGate::readJson(reportPath));
+        baselinePath = PerfGate::baselinePath(parser.value(baselineDir), machine, "frame_benchmark.json");
+        if (parser.isSet(record) || !QFile::exists(baselinePath)) {
+            qInfo().noquote() << "[FrameBenchmark] Recording the baseline for" << machine;
+            QFile::remove(baselinePath);
+            return QFile::copy(reportPath, baselinePath) ? 0 : 1;
+        }
     }
-    fflush(stderr);
+    PerfGate::Thresholds thresholds;
+    thresholds.tolerance = parser.value(tolerance).toDouble();
+    thresholds.alpha = parser.value(alpha).toDouble();
+    if (!baselinePath.isEmpty()
+        && !FrameBenchmark::compareWithBaseline(reportPath, baselinePath, thresholds, parser.value(verdict)))
+        return 2;
+    return 0;
 }
-#include "MainWindow.hpp"
 
 int main(int argc, char* argv[])
 {
-    qInstallMessageHandler(qtMessageOutput);
+    qInstallMessageHandler(EventLog::message);   // synchronous to stderr until EventLog::start()
+    Trace::initFromEnvironment();   // e.g. KR_TRACE=spline,glow
+    TraceZones::setThreadName("GUI");
+    // All viewports share one context group so mesh buffers are uploaded once.
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
     QApplication app(argc, argv);
 
     // Enable verbose Qt logging for OpenGL and platform issues
@@ -42,14 +116,74 @@ int main(int argc, char* argv[])
     format.setStencilBufferSize(8);
     format.setVersion(4, 3); // Or your target OpenGL version
     format.setProfile(QSurfaceFormat::CoreProfile);
-    format.setSamples(4); // Request a Core Profile context
+    // No samples: the viewports draw into their own targets and anti-alias
+    // those (RenderingSystem::AntiAliasing); the window only receives the
+    // composite, so a multisampled back buffer would cost memory for nothing.
+    format.setSamples(0);
+    // Stereo walls: where the driver grants quad-buffered stereo, viewports
+    // draw both eyes in one pass (RenderingSystem::setStereo). Elsewhere the
+    // request is ignored and they render mono.
     format.setOption(QSurfaceFormat::StereoBuffers, true);
-    format.setOption(QSurfaceFormat::DebugContext);
+    // Debug contexts validate every call, so release builds run without one.
+    // KR_GL_DEBUG=1 (or 0) overrides; F8 / KR_GL_CAPTURE record the driver's
+    // messages either way, all of them only on a debug context.
+    bool debugContext = true;
+#ifdef NDEBUG
+    debugContext = false;
+#endif
+    if (qEnvironmentVariableIsSet("KR_GL_DEBUG")) debugContext = qEnvironmentVariableIntValue("KR_GL_DEBUG") != 0;
+    format.setOption(QSurfaceFormat::DebugContext, debugContext);
     format.setColorSpace(QSurfaceFormat::sRGBColorSpace);
+    format.setSwapInterval(1); // vsync; MainWindow::FramePacing::VSync relies on swaps blocking
     QSurfaceFormat::setDefaultFormat(format);
     // ----------------------------------------------------------------
 
-    MainWindow mainWindow;
-    mainWindow.show();
-    return app.exec();
+    // KR_GPU_BUDGET_MB=<n>: evict render caches once tracked VRAM passes n MiB.
+    if (const int budgetMb = qEnvironmentVariableIntValue("KR_GPU_BUDGET_MB"); budgetMb > 0)
+        GpuMemory::setBudget(std::size_t(budgetMb) << 20);
+
+    const QStringList arguments = app.arguments();
+    if (std::any_of(arguments.begin(), arguments.end(), [](const QString& a) { return a.startsWith("--benchmark"); })) {
+        // A debug context validates every call; timings should not include that.
+        format.setOption(QSurfaceFormat::DebugContext, false);
+        QSurfaceFormat::setDefaultFormat(format);
+        return runFrameBenchmark(arguments);
+    }
+
+    // From here on messages are queued and written by the log's own thread,
+    // so logging costs the render thread no I/O. Warnings still reach stderr.
+    {
+        const QString logDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QStringLiteral("/logs");
+        std::string error;
+        if (!EventLog::start(logDir, &error)) qWarning() << "[EventLog]" << QString::fromStdString(error);
+    }
+
+    // KR_TRACE_CAPTURE=<file.json>: a zone capture from start-up to exit,
+    // for machines where nobody presses F4.
+    const QString captureFile = qEnvironmentVariable("KR_TRACE_CAPTURE");
+    if (!captureFile.isEmpty()) TraceZones::start();
+
+    // --stress-scene [robots=16,splines=200,effectors=40,visualizers=2]: adds
+    // FrameBenchmark's seeded scene to the editor's, for interactive profiling.
+    const int stressArg = int(arguments.indexOf(QStringLiteral("--stress-scene")));
+
+    int result = 0;
+    {
+        MainWindow mainWindow;
+        if (stressArg >= 0 && !mainWindow.addStressScene(arguments.value(stressArg + 1))) {
+            result = 1;
+        } else {
+            mainWindow.show();
+            result = app.exec();
+        }
+    }
+
+    if (!captureFile.isEmpty()) {
+        TraceZones::stop();
+        if (!TraceZones::writeChromeTrace(captureFile)) qWarning() << "[TraceZones] could not write" << captureFile;
+        else if (const auto dropped = TraceZones::droppedEvents())
+            qWarning() << "[TraceZones]" << dropped << "events did not fit the per-thread buffers";
+    }
+    EventLog::stop();
+    return result;
 }